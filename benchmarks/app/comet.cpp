@@ -0,0 +1,42 @@
+// The sparse particle system of c_api/tests/comet.cpp, on the LLVM backends
+// only. A frame is one launch of the "update" graph: the emission, seven
+// substeps over the bitmasked particles, and the rendering into an image.
+#include "benchmarks/app/scenario.h"
+
+namespace taichi::benchmarks::app {
+namespace {
+
+class Comet : public Scenario {
+ public:
+  Comet(ti::Runtime &runtime, ScenarioConfig &config) {
+    // Has to match the --res the AOT module was compiled with.
+    const uint32_t res = resolve_size(config.resolution, 640);
+
+    module_ = runtime.load_aot_module(config.aot_path);
+    g_init_ = module_.get_compute_graph("init");
+    g_update_ = module_.get_compute_graph("update");
+
+    image_ = allocate<float>(runtime, {res, res, 4}, {});
+    g_update_["arr"] = image_;
+
+    g_init_.launch();
+  }
+
+  void frame() override {
+    g_update_.launch();
+  }
+
+ private:
+  ti::AotModule module_;
+  ti::ComputeGraph g_init_;
+  ti::ComputeGraph g_update_;
+  ti::NdArray<float> image_;
+};
+
+TI_APP_SCENARIO("comet",
+                [](ti::Runtime &runtime, ScenarioConfig &config) {
+                  return std::make_unique<Comet>(runtime, config);
+                });
+
+}  // namespace
+}  // namespace taichi::benchmarks::app
@@ -0,0 +1,377 @@
+// Runs one application scenario through the C API and writes the per-frame
+// timings and the memory high-water marks as JSON:
+//
+//   taichi_app_benchmarks --scenario=<mpm88|sph|comet> --arch=<arch>
+//                         --aot=<dir> [--particles=<n>] [--grid=<n>]
+//                         [--res=<n>] [--substeps=<n>] [--warmup=<n>]
+//                         [--frames=<n>] [--out=<file>]
+//
+// benchmarks/app/run.py compiles the AOT modules and runs every scenario on
+// every available arch.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <sys/resource.h>
+#endif
+
+#include "benchmarks/app/scenario.h"
+
+using namespace taichi::benchmarks::app;
+
+namespace {
+
+struct Options {
+  std::string scenario;
+  std::string arch_name;
+  ScenarioConfig config;
+  int warmup{10};
+  int frames{100};
+  std::string out;
+};
+
+bool parse_flag(const std::string &arg,
+                const std::string &flag,
+                std::string &value) {
+  auto prefix = "--" + flag + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+bool parse_arch(const std::string &name, TiArch &arch) {
+  static const std::pair<const char *, TiArch> kArchs[] = {
+      {"vulkan", TI_ARCH_VULKAN}, {"metal", TI_ARCH_METAL},
+      {"cuda", TI_ARCH_CUDA},     {"x64", TI_ARCH_X64},
+      {"arm64", TI_ARCH_ARM64},   {"opengl", TI_ARCH_OPENGL},
+      {"gles", TI_ARCH_GLES},
+  };
+  for (const auto &[arch_name, value] : kArchs) {
+    if (name == arch_name) {
+      arch = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+[[noreturn]] void usage_error(const std::string &message) {
+  std::fprintf(stderr, "%s\n", message.c_str());
+  std::exit(2);
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    std::string value;
+    auto as_uint = [&]() {
+      return (uint32_t)std::strtoul(value.c_str(), nullptr, 10);
+    };
+    if (parse_flag(arg, "scenario", value)) {
+      options.scenario = value;
+    } else if (parse_flag(arg, "arch", value)) {
+      options.arch_name = value;
+      if (!parse_arch(value, options.config.arch)) {
+        usage_error("Unknown arch " + value);
+      }
+    } else if (parse_flag(arg, "aot", value)) {
+      options.config.aot_path = value;
+    } else if (parse_flag(arg, "particles", value)) {
+      options.config.particles = as_uint();
+    } else if (parse_flag(arg, "grid", value)) {
+      options.config.grid = as_uint();
+    } else if (parse_flag(arg, "res", value)) {
+      options.config.resolution = as_uint();
+    } else if (parse_flag(arg, "substeps", value)) {
+      options.config.substeps = as_uint();
+    } else if (parse_flag(arg, "warmup", value)) {
+      options.warmup = std::max(0, std::atoi(value.c_str()));
+    } else if (parse_flag(arg, "frames", value)) {
+      options.frames = std::max(1, std::atoi(value.c_str()));
+    } else if (parse_flag(arg, "out", value)) {
+      options.out = value;
+    } else {
+      usage_error("Unknown argument " + arg);
+    }
+  }
+  if (options.scenario.empty() || options.arch_name.empty() ||
+      options.config.aot_path.empty()) {
+    usage_error("--scenario, --arch and --aot are required");
+  }
+  return options;
+}
+
+// The peak resident set size of the process. On the CPU backend it includes
+// the device memory.
+double peak_rss_mb() {
+#if defined(_WIN32)
+  return -1;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return usage.ru_maxrss / double(1 << 20);
+#else
+  return usage.ru_maxrss / double(1 << 10);
+#endif
+#endif
+}
+
+// The used memory of the current CUDA device, through the driver Taichi has
+// already loaded. It covers every process on the device.
+class CudaMemoryProbe {
+ public:
+  CudaMemoryProbe() {
+#if defined(_WIN32)
+    auto lib = LoadLibraryA("nvcuda.dll");
+    if (lib) {
+      mem_get_info_ =
+          (MemGetInfo)(void *)GetProcAddress(lib, "cuMemGetInfo_v2");
+    }
+#else
+    auto *lib = dlopen("libcuda.so.1", RTLD_LAZY | RTLD_NOLOAD);
+    if (lib) {
+      mem_get_info_ = (MemGetInfo)dlsym(lib, "cuMemGetInfo_v2");
+    }
+#endif
+  }
+
+  // Returns a negative value if the memory can't be queried.
+  double used_mb() const {
+    std::size_t free = 0, total = 0;
+    if (mem_get_info_ == nullptr || mem_get_info_(&free, &total) != 0) {
+      return -1;
+    }
+    return (total - free) / double(1 << 20);
+  }
+
+ private:
+  using MemGetInfo = int (*)(std::size_t *, std::size_t *);
+  MemGetInfo mem_get_info_{nullptr};
+};
+
+struct Percentiles {
+  double mean{0};
+  double p50{0};
+  double p90{0};
+  double p99{0};
+  double max{0};
+};
+
+Percentiles percentiles(std::vector<double> samples) {
+  Percentiles out;
+  std::sort(samples.begin(), samples.end());
+  auto rank = [&](double p) {
+    auto i = (std::size_t)(p * (samples.size() - 1) + 0.5);
+    return samples[i];
+  };
+  for (auto s : samples) {
+    out.mean += s / samples.size();
+  }
+  out.p50 = rank(0.5);
+  out.p90 = rank(0.9);
+  out.p99 = rank(0.99);
+  out.max = samples.back();
+  return out;
+}
+
+struct Result {
+  std::string skip_reason;
+  std::string error;
+  double setup_ms{0};
+  double first_frame_ms{0};
+  std::vector<double> frame_ms;
+  std::vector<double> submit_ms;
+  double ndarray_mb{0};
+  double device_used_before_mb{-1};
+  double device_used_high_water_mb{-1};
+};
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Fills |result.error| and returns true if the C API reported an error.
+bool failed(Result &result) {
+  auto error = ti::get_last_error();
+  if (error.error >= TI_ERROR_SUCCESS) {
+    return false;
+  }
+  result.error = error.message.empty() ? "error " + std::to_string(error.error)
+                                       : error.message;
+  return true;
+}
+
+Result run(const ScenarioInfo &info, Options &options) {
+  Result result;
+  auto arch = options.config.arch;
+  ti::Runtime runtime(arch);
+  if (failed(result)) {
+    return result;
+  }
+  CudaMemoryProbe cuda_memory;
+  auto sample_device_memory = [&]() {
+    if (arch != TI_ARCH_CUDA) {
+      return -1.0;
+    }
+    return cuda_memory.used_mb();
+  };
+  result.device_used_before_mb = sample_device_memory();
+  result.device_used_high_water_mb = result.device_used_before_mb;
+
+  auto start = std::chrono::steady_clock::now();
+  auto scenario = info.factory(runtime, options.config);
+  runtime.wait();
+  result.setup_ms = ms_since(start);
+  result.ndarray_mb = scenario->allocated_bytes() / double(1 << 20);
+  if (failed(result)) {
+    return result;
+  }
+
+  for (int i = 0; i < options.warmup + options.frames; i++) {
+    auto frame_start = std::chrono::steady_clock::now();
+    scenario->frame();
+    auto submit_ms = ms_since(frame_start);
+    runtime.wait();
+    auto frame_ms = ms_since(frame_start);
+    if (failed(result)) {
+      return result;
+    }
+    result.device_used_high_water_mb =
+        std::max(result.device_used_high_water_mb, sample_device_memory());
+    if (i == 0) {
+      // Includes the pipeline creation or JIT of the first launches.
+      result.first_frame_ms = frame_ms;
+    }
+    if (i >= options.warmup) {
+      result.frame_ms.push_back(frame_ms);
+      result.submit_ms.push_back(submit_ms);
+    }
+  }
+  return result;
+}
+
+void write_percentiles(std::FILE *file,
+                       const char *name,
+                       const std::vector<double> &samples) {
+  auto p = percentiles(samples);
+  std::fprintf(file,
+               "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+               "\"p99\": %.4f, \"max\": %.4f},\n",
+               name, p.mean, p.p50, p.p90, p.p99, p.max);
+}
+
+void write_optional(std::FILE *file, const char *name, double value) {
+  if (value < 0) {
+    std::fprintf(file, "    \"%s\": null", name);
+  } else {
+    std::fprintf(file, "    \"%s\": %.2f", name, value);
+  }
+}
+
+void write_json(std::FILE *file, const Options &options, const Result &r) {
+  char date[64];
+  auto now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  auto version = ti::get_version();
+  const auto &config = options.config;
+  std::fprintf(file, "{\n  \"context\": {\n");
+  std::fprintf(file, "    \"date\": \"%s\",\n", date);
+  std::fprintf(file, "    \"version\": \"%u.%u.%u\",\n", version.major(),
+               version.minor(), version.patch());
+  std::fprintf(file, "    \"num_cpus\": %u\n  },\n",
+               std::thread::hardware_concurrency());
+  std::fprintf(file, "  \"scenario\": \"%s\",\n", options.scenario.c_str());
+  std::fprintf(file, "  \"arch\": \"%s\",\n", options.arch_name.c_str());
+  std::fprintf(file,
+               "  \"config\": {\"particles\": %u, \"grid\": %u, \"res\": %u, "
+               "\"substeps\": %u, \"warmup\": %d, \"frames\": %d},\n",
+               config.particles, config.grid, config.resolution,
+               config.substeps, options.warmup, options.frames);
+  if (!r.skip_reason.empty()) {
+    std::fprintf(file, "  \"skipped\": \"%s\"\n}\n", r.skip_reason.c_str());
+    return;
+  }
+  if (!r.error.empty()) {
+    std::string message;
+    for (char c : r.error) {
+      if (c == '"' || c == '\\') {
+        message += '\\';
+      }
+      message += c == '\n' ? ' ' : c;
+    }
+    std::fprintf(file, "  \"error\": \"%s\"\n}\n", message.c_str());
+    return;
+  }
+  std::fprintf(file, "  \"setup_ms\": %.3f,\n", r.setup_ms);
+  std::fprintf(file, "  \"first_frame_ms\": %.3f,\n", r.first_frame_ms);
+  write_percentiles(file, "frame_ms", r.frame_ms);
+  write_percentiles(file, "submit_ms", r.submit_ms);
+  std::fprintf(file, "  \"memory_mb\": {\n");
+  std::fprintf(file, "    \"ndarrays\": %.2f,\n", r.ndarray_mb);
+  write_optional(file, "peak_rss", peak_rss_mb());
+  std::fprintf(file, ",\n");
+  write_optional(file, "device_used_before", r.device_used_before_mb);
+  std::fprintf(file, ",\n");
+  write_optional(file, "device_used_high_water", r.device_used_high_water_mb);
+  std::fprintf(file, "\n  }\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  auto options = parse_options(argc, argv);
+  const auto &scenarios = get_scenarios();
+  auto info = std::find_if(
+      scenarios.begin(), scenarios.end(),
+      [&](const ScenarioInfo &s) { return s.name == options.scenario; });
+  if (info == scenarios.end()) {
+    usage_error("Unknown scenario " + options.scenario);
+  }
+  Result result;
+  if (ti::is_arch_available(options.config.arch)) {
+    result = run(*info, options);
+  } else {
+    result.skip_reason = "arch not available";
+  }
+  if (!result.skip_reason.empty()) {
+    std::fprintf(stderr, "%s/%s: skipped, %s\n", options.scenario.c_str(),
+                 options.arch_name.c_str(), result.skip_reason.c_str());
+  } else if (result.error.empty()) {
+    auto p = percentiles(result.frame_ms);
+    std::fprintf(stderr, "%s/%s: %.3f ms/frame (p90 %.3f, p99 %.3f)\n",
+                 options.scenario.c_str(), options.arch_name.c_str(), p.p50,
+                 p.p90, p.p99);
+  } else {
+    std::fprintf(stderr, "%s/%s: %s\n", options.scenario.c_str(),
+                 options.arch_name.c_str(), result.error.c_str());
+  }
+
+  std::FILE *file = stdout;
+  if (!options.out.empty()) {
+    file = std::fopen(options.out.c_str(), "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "Cannot open %s\n", options.out.c_str());
+      return 1;
+    }
+  }
+  write_json(file, options, result);
+  if (file != stdout) {
+    std::fclose(file);
+  }
+  return result.error.empty() ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// The 2D MLS-MPM of c_api/tests/mpm88_test.cpp. The kernels read the sizes
+// from the ndarrays, so the number of particles and the grid resolution can
+// be changed without recompiling the AOT module.
+#include "benchmarks/app/scenario.h"
+
+namespace taichi::benchmarks::app {
+namespace {
+
+class Mpm88 : public Scenario {
+ public:
+  Mpm88(ti::Runtime &runtime, ScenarioConfig &config) {
+    const uint32_t num_particles = resolve_size(config.particles, 16384);
+    const uint32_t num_grid = resolve_size(config.grid, 128);
+    substeps_ = resolve_size(config.substeps, 50);
+
+    module_ = runtime.load_aot_module(config.aot_path);
+
+    x_ = allocate<float>(runtime, {num_particles}, {2});
+    v_ = allocate<float>(runtime, {num_particles}, {2});
+    pos_ = allocate<float>(runtime, {num_particles}, {3});
+    C_ = allocate<float>(runtime, {num_particles}, {2, 2});
+    J_ = allocate<float>(runtime, {num_particles}, {});
+    grid_v_ = allocate<float>(runtime, {num_grid, num_grid}, {2});
+    grid_m_ = allocate<float>(runtime, {num_grid, num_grid}, {});
+
+    k_init_particles_ = module_.get_kernel("init_particles");
+    k_substep_reset_grid_ = module_.get_kernel("substep_reset_grid");
+    k_substep_p2g_ = module_.get_kernel("substep_p2g");
+    k_substep_update_grid_v_ = module_.get_kernel("substep_update_grid_v");
+    k_substep_g2p_ = module_.get_kernel("substep_g2p");
+
+    k_init_particles_[0] = x_;
+    k_init_particles_[1] = v_;
+    k_init_particles_[2] = J_;
+
+    k_substep_reset_grid_[0] = grid_v_;
+    k_substep_reset_grid_[1] = grid_m_;
+
+    k_substep_p2g_[0] = x_;
+    k_substep_p2g_[1] = v_;
+    k_substep_p2g_[2] = C_;
+    k_substep_p2g_[3] = J_;
+    k_substep_p2g_[4] = grid_v_;
+    k_substep_p2g_[5] = grid_m_;
+
+    k_substep_update_grid_v_[0] = grid_v_;
+    k_substep_update_grid_v_[1] = grid_m_;
+
+    k_substep_g2p_[0] = x_;
+    k_substep_g2p_[1] = v_;
+    k_substep_g2p_[2] = C_;
+    k_substep_g2p_[3] = J_;
+    k_substep_g2p_[4] = grid_v_;
+    k_substep_g2p_[5] = pos_;
+
+    k_init_particles_.launch();
+  }
+
+  void frame() override {
+    for (uint32_t i = 0; i < substeps_; i++) {
+      k_substep_reset_grid_.launch();
+      k_substep_p2g_.launch();
+      k_substep_update_grid_v_.launch();
+      k_substep_g2p_.launch();
+    }
+  }
+
+ private:
+  uint32_t substeps_{0};
+  ti::AotModule module_;
+
+  ti::NdArray<float> x_;
+  ti::NdArray<float> v_;
+  ti::NdArray<float> pos_;
+  ti::NdArray<float> C_;
+  ti::NdArray<float> J_;
+  ti::NdArray<float> grid_v_;
+  ti::NdArray<float> grid_m_;
+
+  ti::Kernel k_init_particles_;
+  ti::Kernel k_substep_reset_grid_;
+  ti::Kernel k_substep_p2g_;
+  ti::Kernel k_substep_update_grid_v_;
+  ti::Kernel k_substep_g2p_;
+};
+
+TI_APP_SCENARIO("mpm88",
+                [](ti::Runtime &runtime, ScenarioConfig &config) {
+                  return std::make_unique<Mpm88>(runtime, config);
+                });
+
+}  // namespace
+}  // namespace taichi::benchmarks::app
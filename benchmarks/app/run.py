@@ -0,0 +1,199 @@
+"""Runs the application scenarios of benchmarks/app end to end.
+
+    python3 run.py [--driver build/taichi_app_benchmarks]
+                   [--scenario mpm88 sph comet] [--arch x64 cuda vulkan]
+                   [--size small medium large] [--warmup 10] [--frames 100]
+                   [--out results.json] [--baseline old.json]
+
+For each scenario, backend and problem size, the AOT module is compiled with
+the script of the C API test (tests/cpp/aot/python_scripts), then the C++
+driver loads it through the C API, runs the warm-up frames and reports the
+percentiles of the frame times of the other frames, the time of the setup
+and of the first frame, and the memory high-water marks.
+
+With --baseline, the median frame times are compared, and the script exits
+with 1 if one of them grew by more than --threshold.
+"""
+import argparse
+import datetime
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(
+    os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+AOT_SCRIPTS = os.path.join(ROOT, 'tests', 'cpp', 'aot', 'python_scripts')
+
+# The --arch of the AOT scripts for the C API archs they support.
+MPM88_ARCHS = {'x64': 'cpu', 'cuda': 'cuda', 'vulkan': 'vulkan'}
+SPH_ARCHS = {'x64': 'x64', 'cuda': 'cuda', 'vulkan': 'vulkan'}
+COMET_ARCHS = {'x64': 'x64', 'cuda': 'cuda'}
+
+
+def mpm88(size):
+    particles, grid = {
+        'small': (8192, 64),
+        'medium': (32768, 128),
+        'large': (131072, 256),
+    }[size]
+    # The kernels take the sizes from the ndarrays.
+    return [], [f'--particles={particles}', f'--grid={grid}']
+
+
+def sph(size):
+    # The neighbor search is brute force, O(particles^2).
+    per_axis = {'small': 12, 'medium': 20, 'large': 28}[size]
+    return [f'--particles-per-axis={per_axis}'
+            ], [f'--particles={per_axis ** 3}']
+
+
+def comet(size):
+    particles, res = {
+        'small': (8192, 320),
+        'medium': (32768, 640),
+        'large': (131072, 1024),
+    }[size]
+    return [f'--particles={particles}', f'--res={res}'], [f'--res={res}']
+
+
+# name: (AOT script, archs, the arguments of the script and of the driver)
+SCENARIOS = {
+    'mpm88': ('mpm88_graph_aot.py', MPM88_ARCHS, mpm88),
+    'sph': ('sph_aot.py', SPH_ARCHS, sph),
+    'comet': ('comet_aot.py', COMET_ARCHS, comet),
+}
+
+
+def compile_aot(script, script_arch, script_args, folder):
+    env = dict(os.environ, TAICHI_AOT_FOLDER_PATH=folder)
+    proc = subprocess.run([
+        sys.executable,
+        os.path.join(AOT_SCRIPTS, script), f'--arch={script_arch}'
+    ] + script_args,
+                          env=env,
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE,
+                          universal_newlines=True,
+                          check=False)
+    if proc.returncode != 0:
+        return proc.stderr.strip()[-500:]
+    return None
+
+
+def run_scenario(args, name, arch, size):
+    script, archs, sizes = SCENARIOS[name]
+    result = {'scenario': name, 'arch': arch, 'size': size}
+    if arch not in archs:
+        result['skipped'] = 'not supported by the AOT script'
+        return result
+    script_args, driver_args = sizes(size)
+    with tempfile.TemporaryDirectory() as folder:
+        error = compile_aot(script, archs[arch], script_args, folder)
+        if error is not None:
+            result['skipped'] = f'AOT compilation failed: {error}'
+            return result
+        proc = subprocess.run([
+            args.driver, f'--scenario={name}', f'--arch={arch}',
+            f'--aot={folder}', f'--warmup={args.warmup}',
+            f'--frames={args.frames}'
+        ] + driver_args,
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE,
+                              universal_newlines=True,
+                              check=False)
+    try:
+        output = json.loads(proc.stdout)
+    except ValueError:
+        result['skipped'] = f'driver failed: {proc.stderr.strip()[-500:]}'
+        return result
+    output.pop('context', None)
+    result.update(output)
+    return result
+
+
+def compare(baseline, results, threshold):
+    def key(r):
+        return r['scenario'], r['arch'], r['size']
+
+    old = {key(r): r for r in baseline['results'] if 'frame_ms' in r}
+    regressions = 0
+    for r in results:
+        base = old.get(key(r))
+        if base is None or 'frame_ms' not in r:
+            continue
+        before = base['frame_ms']['p50']
+        after = r['frame_ms']['p50']
+        change = after / max(before, 1e-6) - 1
+        flag = ''
+        if change > threshold:
+            regressions += 1
+            flag = '  REGRESSION'
+        print(f"{'/'.join(key(r))}: {before:.3f} -> {after:.3f} ms/frame "
+              f"({change:+.1%}){flag}")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--driver',
+                        default=os.path.join(ROOT, 'build',
+                                             'taichi_app_benchmarks'))
+    parser.add_argument('--scenario',
+                        nargs='+',
+                        choices=sorted(SCENARIOS),
+                        default=sorted(SCENARIOS))
+    parser.add_argument('--arch', nargs='+', default=['x64', 'cuda', 'vulkan'])
+    parser.add_argument('--size',
+                        nargs='+',
+                        choices=['small', 'medium', 'large'],
+                        default=['medium'])
+    parser.add_argument('--warmup', type=int, default=10)
+    parser.add_argument('--frames', type=int, default=100)
+    parser.add_argument('--out', default='app_results.json')
+    parser.add_argument('--baseline')
+    parser.add_argument('--threshold', type=float, default=0.1)
+    args = parser.parse_args()
+
+    results = []
+    for name in args.scenario:
+        for arch in args.arch:
+            for size in args.size:
+                r = run_scenario(args, name, arch, size)
+                label = f'{name}/{arch}/{size}'
+                if 'frame_ms' in r:
+                    memory = r['memory_mb']
+                    print(f"{label}: {r['frame_ms']['p50']:.3f} ms/frame "
+                          f"(p90 {r['frame_ms']['p90']:.3f}, "
+                          f"p99 {r['frame_ms']['p99']:.3f}), "
+                          f"{memory['peak_rss']} MB peak RSS")
+                else:
+                    print(f"{label}: skipped, "
+                          f"{r.get('skipped', r.get('error'))}")
+                results.append(r)
+
+    output = {
+        'context': {
+            'date': datetime.datetime.utcnow().isoformat() + 'Z',
+            'warmup': args.warmup,
+            'frames': args.frames,
+        },
+        'results': results,
+    }
+    with open(args.out, 'w') as f:
+        json.dump(output, f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(baseline, results, args.threshold)
+        if regressions:
+            print(f'{regressions} scenario(s) are more than '
+                  f'{args.threshold:.0%} slower per frame')
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
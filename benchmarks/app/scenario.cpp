@@ -0,0 +1,22 @@
+#include "benchmarks/app/scenario.h"
+
+namespace taichi::benchmarks::app {
+namespace {
+
+std::vector<ScenarioInfo> &scenarios() {
+  static std::vector<ScenarioInfo> scenarios;
+  return scenarios;
+}
+
+}  // namespace
+
+const std::vector<ScenarioInfo> &get_scenarios() {
+  return scenarios();
+}
+
+bool register_scenario(const std::string &name, ScenarioFactory factory) {
+  scenarios().push_back({name, std::move(factory)});
+  return true;
+}
+
+}  // namespace taichi::benchmarks::app
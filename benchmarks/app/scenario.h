@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taichi/cpp/taichi.hpp"
+
+namespace taichi::benchmarks::app {
+
+// The problem size of a scenario. The sizes the AOT module was compiled with
+// must be passed again, see benchmarks/app/run.py.
+struct ScenarioConfig {
+  std::string aot_path;
+  TiArch arch{TI_ARCH_VULKAN};
+  // Zero selects the default of the scenario, which the scenario writes back.
+  uint32_t particles{0};
+  uint32_t grid{0};
+  uint32_t resolution{0};
+  uint32_t substeps{0};
+};
+
+// Replaces a zero size by |default_value| and returns it.
+inline uint32_t resolve_size(uint32_t &size, uint32_t default_value) {
+  if (size == 0) {
+    size = default_value;
+  }
+  return size;
+}
+
+// One application, driven frame by frame through the C API.
+class Scenario {
+ public:
+  virtual ~Scenario() = default;
+
+  // Submits the work of one frame, without waiting for it.
+  virtual void frame() = 0;
+
+  // The bytes of the ndarrays the scenario allocated.
+  std::size_t allocated_bytes() const {
+    return allocated_bytes_;
+  }
+
+ protected:
+  template <typename T>
+  ti::NdArray<T> allocate(ti::Runtime &runtime,
+                          const std::vector<uint32_t> &shape,
+                          const std::vector<uint32_t> &elem_shape) {
+    auto ndarray = runtime.allocate_ndarray<T>(shape, elem_shape);
+    allocated_bytes_ += ndarray.scalar_count() * sizeof(T);
+    return ndarray;
+  }
+
+ private:
+  std::size_t allocated_bytes_{0};
+};
+
+using ScenarioFactory = std::function<std::unique_ptr<Scenario>(
+    ti::Runtime &runtime,
+    ScenarioConfig &config)>;
+
+struct ScenarioInfo {
+  std::string name;
+  ScenarioFactory factory;
+};
+
+const std::vector<ScenarioInfo> &get_scenarios();
+
+bool register_scenario(const std::string &name, ScenarioFactory factory);
+
+#define TI_APP_SCENARIO_CONCAT_IMPL(a, b) a##b
+#define TI_APP_SCENARIO_CONCAT(a, b) TI_APP_SCENARIO_CONCAT_IMPL(a, b)
+
+#define TI_APP_SCENARIO(name, factory)                                   \
+  static const bool TI_APP_SCENARIO_CONCAT(ti_app_scenario_, __LINE__) = \
+      ::taichi::benchmarks::app::register_scenario(name, factory)
+
+}  // namespace taichi::benchmarks::app
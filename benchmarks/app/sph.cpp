@@ -0,0 +1,102 @@
+// The 3D SPH fluid of c_api/tests/sph.cpp. The number of particles is baked
+// into the kernels, so it has to match the --particles-per-axis the AOT
+// module was compiled with.
+#include "benchmarks/app/scenario.h"
+
+namespace taichi::benchmarks::app {
+namespace {
+
+class Sph : public Scenario {
+ public:
+  Sph(ti::Runtime &runtime, ScenarioConfig &config) {
+    const uint32_t num_particles = resolve_size(config.particles, 8000);
+    substeps_ = resolve_size(config.substeps, 5);
+
+    module_ = runtime.load_aot_module(config.aot_path);
+
+    N_ = allocate<int32_t>(runtime, {3}, {});
+    den_ = allocate<float>(runtime, {num_particles}, {});
+    pre_ = allocate<float>(runtime, {num_particles}, {});
+    pos_ = allocate<float>(runtime, {num_particles}, {3});
+    vel_ = allocate<float>(runtime, {num_particles}, {3});
+    acc_ = allocate<float>(runtime, {num_particles}, {3});
+    boundary_box_ = allocate<float>(runtime, {2}, {3});
+    spawn_box_ = allocate<float>(runtime, {2}, {3});
+    gravity_ = allocate<float>(runtime, {}, {3});
+
+    k_initialize_ = module_.get_kernel("initialize");
+    k_initialize_particle_ = module_.get_kernel("initialize_particle");
+    k_update_density_ = module_.get_kernel("update_density");
+    k_update_force_ = module_.get_kernel("update_force");
+    k_advance_ = module_.get_kernel("advance");
+    k_boundary_handle_ = module_.get_kernel("boundary_handle");
+
+    k_initialize_[0] = boundary_box_;
+    k_initialize_[1] = spawn_box_;
+    k_initialize_[2] = N_;
+
+    k_initialize_particle_[0] = pos_;
+    k_initialize_particle_[1] = spawn_box_;
+    k_initialize_particle_[2] = N_;
+    k_initialize_particle_[3] = gravity_;
+
+    k_update_density_[0] = pos_;
+    k_update_density_[1] = den_;
+    k_update_density_[2] = pre_;
+
+    k_update_force_[0] = pos_;
+    k_update_force_[1] = vel_;
+    k_update_force_[2] = den_;
+    k_update_force_[3] = pre_;
+    k_update_force_[4] = acc_;
+    k_update_force_[5] = gravity_;
+
+    k_advance_[0] = pos_;
+    k_advance_[1] = vel_;
+    k_advance_[2] = acc_;
+
+    k_boundary_handle_[0] = pos_;
+    k_boundary_handle_[1] = vel_;
+    k_boundary_handle_[2] = boundary_box_;
+
+    k_initialize_.launch();
+    k_initialize_particle_.launch();
+  }
+
+  void frame() override {
+    for (uint32_t i = 0; i < substeps_; i++) {
+      k_update_density_.launch();
+      k_update_force_.launch();
+      k_advance_.launch();
+      k_boundary_handle_.launch();
+    }
+  }
+
+ private:
+  uint32_t substeps_{0};
+  ti::AotModule module_;
+
+  ti::NdArray<int32_t> N_;
+  ti::NdArray<float> den_;
+  ti::NdArray<float> pre_;
+  ti::NdArray<float> pos_;
+  ti::NdArray<float> vel_;
+  ti::NdArray<float> acc_;
+  ti::NdArray<float> boundary_box_;
+  ti::NdArray<float> spawn_box_;
+  ti::NdArray<float> gravity_;
+
+  ti::Kernel k_initialize_;
+  ti::Kernel k_initialize_particle_;
+  ti::Kernel k_update_density_;
+  ti::Kernel k_update_force_;
+  ti::Kernel k_advance_;
+  ti::Kernel k_boundary_handle_;
+};
+
+TI_APP_SCENARIO("sph", [](ti::Runtime &runtime, ScenarioConfig &config) {
+  return std::make_unique<Sph>(runtime, config);
+});
+
+}  // namespace
+}  // namespace taichi::benchmarks::app
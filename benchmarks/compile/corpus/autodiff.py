@@ -0,0 +1,27 @@
+"""Reverse-mode autodiff through nested loops with a dynamic inner loop,
+which needs the AD-stack."""
+import taichi as ti
+
+REQUIRES = [ti.extension.adstack]
+
+
+def build():
+    n = 256
+    x = ti.field(ti.f32, shape=n, needs_grad=True)
+    y = ti.field(ti.f32, shape=n, needs_grad=True)
+    loss = ti.field(ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def forward(steps: ti.i32):
+        for i in x:
+            v = x[i]
+            for _ in range(steps):
+                v = ti.sin(v) * ti.exp(-v * v) + ti.sqrt(v * v + 1.0)
+            y[i] = v
+            loss[None] += v * v
+
+    def compile_grad():
+        forward(4)
+        forward.grad(4)
+
+    return [compile_grad]
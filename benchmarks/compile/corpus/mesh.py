@@ -0,0 +1,34 @@
+"""Mesh-for loops over the relations of a tetrahedral mesh."""
+import os
+
+import taichi as ti
+
+REQUIRES = [ti.extension.mesh]
+
+MESH_FILE = os.path.join(os.path.dirname(__file__), '..', '..', '..',
+                         'tests', 'python', 'ell.json')
+
+
+def build():
+    builder = ti.TetMesh()
+    builder.verts.place({'x': ti.f32, 'y': ti.f32})
+    builder.cells.place({'vol': ti.f32})
+    model = builder.build(ti.Mesh.load_meta(MESH_FILE))
+
+    @ti.kernel
+    def cell_volume():
+        for c in model.cells:
+            acc = 0.0
+            for j in range(c.verts.size):
+                acc += c.verts[j].x * (j + 1)
+            c.vol = acc
+
+    @ti.kernel
+    def scatter():
+        for v in model.verts:
+            acc = 0.0
+            for j in range(v.cells.size):
+                acc += v.cells[j].vol
+            v.y = acc
+
+    return [cell_volume, scatter]
@@ -0,0 +1,35 @@
+"""Struct-for loops over pointer, bitmasked and dynamic SNodes, with
+activation and deactivation."""
+import taichi as ti
+
+REQUIRES = [ti.extension.sparse]
+
+
+def build():
+    x = ti.field(ti.f32)
+    block = ti.root.pointer(ti.ij, 32)
+    block.bitmasked(ti.ij, 8).place(x)
+    lst = ti.field(ti.i32)
+    ti.root.dense(ti.i, 64).dynamic(ti.j, 1024, chunk_size=32).place(lst)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(256, 256):
+            if (i + j) % 3 == 0:
+                x[i, j] = i * j
+
+    @ti.kernel
+    def stencil():
+        for i, j in x:
+            x[i, j] = (x[i - 1, j] + x[i + 1, j] + x[i, j - 1] +
+                       x[i, j + 1]) * 0.25
+            if x[i, j] < 1e-3:
+                ti.deactivate(block, [i, j])
+
+    @ti.kernel
+    def append():
+        for i, j in ti.ndrange(64, 128):
+            if ti.is_active(block, [i, j]):
+                lst[i].append(j)
+
+    return [activate, stencil, append]
@@ -0,0 +1,28 @@
+"""Large kernels from compile-time unrolling: a 12x12 matrix product and an
+unrolled polynomial, the shape of most FEM and MPM kernels."""
+import taichi as ti
+
+REQUIRES = []
+
+
+def build():
+    n = 12
+    a = ti.Matrix.field(n, n, ti.f32, shape=64)
+    b = ti.Matrix.field(n, n, ti.f32, shape=64)
+    c = ti.Matrix.field(n, n, ti.f32, shape=64)
+    x = ti.field(ti.f32, shape=1024)
+
+    @ti.kernel
+    def matmul():
+        for i in c:
+            c[i] = a[i] @ b[i] + a[i].transpose() @ b[i]
+
+    @ti.kernel
+    def polynomial():
+        for i in x:
+            acc = 0.0
+            for k in ti.static(range(256)):
+                acc = acc * x[i] + ti.sin(k * 0.1)
+            x[i] = acc
+
+    return [matmul, polynomial]
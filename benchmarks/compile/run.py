@@ -0,0 +1,218 @@
+"""Measures how long Taichi takes to compile the kernels in corpus/.
+
+    python3 run.py [--arch cpu cuda vulkan] [--corpus sparse] [--repeat 3]
+                   [--out results.json] [--baseline old.json]
+
+Each corpus entry is compiled in a fresh process per repetition, with the
+offline cache disabled. For each entry and backend, the results hold the
+median over the repetitions of:
+
+- the time of each IR pass and of the backend codegen (see
+  ti.profiler.get_compile_profiler_records()), per kernel;
+- the bytes of the generated code;
+- how much the peak RSS of the process grew while compiling.
+
+Each kernel also records its offline cache key. With --baseline, the
+compile times of the kernels whose key did not change are compared, and the
+script exits with 1 if one of them grew by more than --threshold.
+"""
+import argparse
+import datetime
+import glob
+import importlib.util
+import json
+import os
+import resource
+import statistics
+import subprocess
+import sys
+
+CORPUS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          'corpus')
+RESULT_PREFIX = 'COMPILE_BENCHMARK_RESULT '
+
+
+def corpus_names():
+    return sorted(
+        os.path.splitext(os.path.basename(path))[0]
+        for path in glob.glob(os.path.join(CORPUS_DIR, '*.py')))
+
+
+def load_entry(name):
+    path = os.path.join(CORPUS_DIR, f'{name}.py')
+    spec = importlib.util.spec_from_file_location(name, path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def current_rss_kb():
+    try:
+        with open('/proc/self/statm') as f:
+            pages = int(f.read().split()[1])
+        return pages * os.sysconf('SC_PAGESIZE') // 1024
+    except OSError:
+        return peak_rss_kb()
+
+
+def peak_rss_kb():
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # In bytes on macOS.
+    return peak // 1024 if sys.platform == 'darwin' else peak
+
+
+def run_worker(name, arch):
+    """Compiles one corpus entry in this process and prints the result."""
+    import taichi as ti  # pylint: disable=C0415
+
+    ti.init(arch=getattr(ti, arch), offline_cache=False, compile_profiler=True)
+    entry = load_entry(name)
+    actual_arch = ti.lang.impl.current_cfg().arch
+    for ext in entry.REQUIRES:
+        if not ti.lang.misc.is_extension_supported(actual_arch, ext):
+            print(RESULT_PREFIX + json.dumps({'skipped': f'no {ext}'}))
+            return
+    kernels = entry.build()
+    ti.sync()
+    ti.profiler.clear_compile_profiler_info()
+
+    rss_before = current_rss_kb()
+    for kernel in kernels:
+        kernel()
+    ti.sync()
+    peak_increase = max(peak_rss_kb() - rss_before, 0)
+
+    keys = ti.profiler.get_compile_profiler_kernel_keys()
+    result = {}
+    for r in ti.profiler.get_compile_profiler_records():
+        kernel = result.setdefault(r['kernel'], {
+            'key': keys.get(r['kernel']),
+            'passes_ms': {},
+            'code_size': {},
+        })
+        passes = kernel['passes_ms']
+        passes[r['pass']] = passes.get(r['pass'], 0) + r['time_ms']
+        if r['code_size'] is not None:
+            kernel['code_size'][r['pass']] = r['code_size']
+    print(RESULT_PREFIX + json.dumps({
+        'kernels': result,
+        'peak_rss_increase_mb': peak_increase / 1024,
+    }))
+
+
+def run_once(name, arch):
+    proc = subprocess.run(
+        [sys.executable, __file__, '--worker', name, '--arch', arch],
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+        check=False)
+    for line in proc.stdout.splitlines():
+        if line.startswith(RESULT_PREFIX):
+            return json.loads(line[len(RESULT_PREFIX):])
+    return {'skipped': f'failed: {proc.stderr.strip()[-500:]}'}
+
+
+def median_of(runs):
+    """Merges the results of the repetitions of one entry."""
+    kernels = {}
+    for name, first in runs[0]['kernels'].items():
+        same = [r['kernels'][name] for r in runs if name in r['kernels']]
+        passes = {
+            p: statistics.median(k['passes_ms'].get(p, 0) for k in same)
+            for p in first['passes_ms']
+        }
+        kernels[name] = {
+            'key': first['key'],
+            'total_ms': sum(passes.values()),
+            'passes_ms': passes,
+            'code_size': first['code_size'],
+        }
+    return {
+        'total_ms': sum(k['total_ms'] for k in kernels.values()),
+        'peak_rss_increase_mb':
+        statistics.median(r['peak_rss_increase_mb'] for r in runs),
+        'kernels': kernels,
+    }
+
+
+def compare(baseline, results, threshold):
+    old = {(r['corpus'], r['arch']): r for r in baseline['results']}
+    regressions = 0
+    for r in results:
+        base = old.get((r['corpus'], r['arch']))
+        if base is None or 'kernels' not in r or 'kernels' not in base:
+            continue
+        for name, kernel in r['kernels'].items():
+            base_kernel = base['kernels'].get(name)
+            if base_kernel is None or base_kernel['key'] != kernel['key']:
+                # The frontend IR changed, the times aren't comparable.
+                continue
+            change = kernel['total_ms'] / max(base_kernel['total_ms'],
+                                              1e-6) - 1
+            flag = ''
+            if change > threshold:
+                regressions += 1
+                flag = '  REGRESSION'
+            print(f"{r['corpus']}/{r['arch']}/{name}: "
+                  f"{base_kernel['total_ms']:.1f} -> "
+                  f"{kernel['total_ms']:.1f} ms ({change:+.1%}){flag}")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--arch', nargs='+', default=['cpu'])
+    parser.add_argument('--corpus', nargs='+', default=corpus_names())
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--out', default='compile_results.json')
+    parser.add_argument('--baseline')
+    parser.add_argument('--threshold', type=float, default=0.1)
+    parser.add_argument('--worker', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker:
+        run_worker(args.worker, args.arch[0])
+        return 0
+
+    results = []
+    for arch in args.arch:
+        for name in args.corpus:
+            runs = [run_once(name, arch) for _ in range(args.repeat)]
+            result = {'corpus': name, 'arch': arch}
+            skipped = [r['skipped'] for r in runs if 'skipped' in r]
+            if skipped:
+                result['skipped'] = skipped[0]
+                print(f'{name}/{arch}: skipped, {skipped[0]}')
+            else:
+                result.update(median_of(runs))
+                print(f"{name}/{arch}: {result['total_ms']:.1f} ms, "
+                      f"+{result['peak_rss_increase_mb']:.1f} MB peak RSS")
+            results.append(result)
+
+    from taichi._lib import core as ti_python_core  # pylint: disable=C0415
+    output = {
+        'context': {
+            'date': datetime.datetime.utcnow().isoformat() + 'Z',
+            'version': ti_python_core.get_version_string(),
+            'commit': ti_python_core.get_commit_hash(),
+            'repeat': args.repeat,
+        },
+        'results': results,
+    }
+    with open(args.out, 'w') as f:
+        json.dump(output, f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(baseline, results, args.threshold)
+        if regressions:
+            print(f'{regressions} kernel(s) compile more than '
+                  f'{args.threshold:.0%} slower')
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
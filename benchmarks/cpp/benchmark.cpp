@@ -0,0 +1,114 @@
+#include "benchmarks/cpp/benchmark.h"
+
+#include "taichi/common/logging.h"
+#include "taichi/platform/cuda/detect_cuda.h"
+#ifdef TI_WITH_VULKAN
+#include "taichi/rhi/vulkan/vulkan_loader.h"
+#endif
+#ifdef TI_WITH_OPENGL
+#include "taichi/rhi/opengl/opengl_api.h"
+#endif
+#ifdef TI_WITH_METAL
+#include "taichi/rhi/metal/metal_api.h"
+#endif
+
+namespace taichi::benchmarks {
+
+State::State(double min_batch_time, int repetitions)
+    : min_batch_time_(min_batch_time), repetitions_(repetitions) {
+  TI_ASSERT(repetitions_ > 0);
+}
+
+bool State::next_batch() {
+  auto now = Clock::now();
+  if (skipped()) {
+    return false;
+  }
+  if (started_) {
+    auto elapsed = std::chrono::duration<double>(now - batch_begin_ - paused_);
+    if (calibrated_) {
+      samples_.push_back(elapsed.count() * 1e9 / batch_size_);
+      if ((int)samples_.size() == repetitions_) {
+        return false;
+      }
+    } else if (elapsed.count() >= min_batch_time_) {
+      calibrated_ = true;
+    } else {
+      batch_size_ *= 2;
+    }
+  }
+  started_ = true;
+  // keep_running() returns true once here and |remaining_| more times.
+  remaining_ = batch_size_ - 1;
+  paused_ = Clock::duration::zero();
+  batch_begin_ = Clock::now();
+  return true;
+}
+
+void State::pause_timing() {
+  pause_begin_ = Clock::now();
+}
+
+void State::resume_timing() {
+  paused_ += Clock::now() - pause_begin_;
+}
+
+void State::skip(const std::string &reason) {
+  skip_reason_ = reason.empty() ? "skipped" : reason;
+  remaining_ = 0;
+}
+
+std::vector<BenchmarkInfo> &get_benchmarks() {
+  static std::vector<BenchmarkInfo> benchmarks;
+  return benchmarks;
+}
+
+bool register_benchmark(const std::string &name, BenchmarkFunction func) {
+  get_benchmarks().push_back({name, std::move(func)});
+  return true;
+}
+
+bool register_arch_benchmark(const std::string &name,
+                             const std::vector<Arch> &archs,
+                             std::function<void(State &, Arch)> func) {
+  for (auto arch : archs) {
+    register_benchmark(name + "/" + arch_name(arch),
+                       [func, arch](State &state) { func(state, arch); });
+  }
+  return true;
+}
+
+std::vector<Arch> all_archs() {
+  return {host_arch(), Arch::cuda, Arch::vulkan, Arch::opengl, Arch::metal};
+}
+
+bool arch_available(Arch arch) {
+#ifdef TI_WITH_LLVM
+  if (arch_is_cpu(arch)) {
+    return arch == host_arch();
+  }
+#endif
+#ifdef TI_WITH_CUDA
+  if (arch == Arch::cuda) {
+    return is_cuda_api_available();
+  }
+#endif
+#ifdef TI_WITH_VULKAN
+  if (arch == Arch::vulkan) {
+    return lang::vulkan::is_vulkan_api_available();
+  }
+#endif
+#ifdef TI_WITH_OPENGL
+  if (arch == Arch::opengl) {
+    return lang::opengl::is_opengl_api_available();
+  }
+#endif
+#ifdef TI_WITH_METAL
+  if (arch == Arch::metal) {
+    return lang::metal::is_metal_api_available();
+  }
+#endif
+  return false;
+}
+
+}  // namespace taichi::benchmarks
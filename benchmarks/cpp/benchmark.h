@@ -0,0 +1,148 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "taichi/rhi/arch.h"
+
+namespace taichi::benchmarks {
+
+// The timing loop of one benchmark:
+//
+//   void bm_foo(State &state) {
+//     ... setup, not timed ...
+//     while (state.keep_running()) {
+//       ... timed ...
+//     }
+//   }
+//
+// The loop first runs batches of 1, 2, 4, ... iterations, which also warm
+// up caches and JIT compilation, until a batch takes at least
+// |min_batch_time|. It then runs |repetitions| batches of that size, each
+// giving one sample of the time per iteration.
+class State {
+ public:
+  State(double min_batch_time, int repetitions);
+
+  bool keep_running() {
+    if (remaining_ > 0) {
+      remaining_--;
+      return true;
+    }
+    return next_batch();
+  }
+
+  // Excludes the work between the two calls from the timing, e.g. resetting
+  // an allocator that is exhausted.
+  void pause_timing();
+  void resume_timing();
+
+  // Makes the report include the throughput derived from the median.
+  void set_bytes_per_iteration(uint64_t bytes) {
+    bytes_per_iteration_ = bytes;
+  }
+
+  void set_items_per_iteration(uint64_t items) {
+    items_per_iteration_ = items;
+  }
+
+  // Marks the benchmark as skipped, e.g. when the backend isn't available.
+  // keep_running() returns false afterwards.
+  void skip(const std::string &reason);
+
+  bool skipped() const {
+    return !skip_reason_.empty();
+  }
+
+  const std::string &skip_reason() const {
+    return skip_reason_;
+  }
+
+  // Nanoseconds per iteration, one sample per repetition.
+  const std::vector<double> &samples() const {
+    return samples_;
+  }
+
+  uint64_t batch_size() const {
+    return batch_size_;
+  }
+
+  uint64_t bytes_per_iteration() const {
+    return bytes_per_iteration_;
+  }
+
+  uint64_t items_per_iteration() const {
+    return items_per_iteration_;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  bool next_batch();
+
+  double min_batch_time_;
+  int repetitions_;
+  bool calibrated_{false};
+  bool started_{false};
+  uint64_t batch_size_{1};
+  uint64_t remaining_{0};
+  Clock::time_point batch_begin_;
+  Clock::time_point pause_begin_;
+  Clock::duration paused_{0};
+  uint64_t bytes_per_iteration_{0};
+  uint64_t items_per_iteration_{0};
+  std::string skip_reason_;
+  std::vector<double> samples_;
+};
+
+using BenchmarkFunction = std::function<void(State &)>;
+
+struct BenchmarkInfo {
+  std::string name;
+  BenchmarkFunction func;
+};
+
+std::vector<BenchmarkInfo> &get_benchmarks();
+
+bool register_benchmark(const std::string &name, BenchmarkFunction func);
+
+// Registers |name|/<arch> for each backend in |archs|.
+bool register_arch_benchmark(const std::string &name,
+                             const std::vector<Arch> &archs,
+                             std::function<void(State &, Arch)> func);
+
+// The host CPU and all GPU backends.
+std::vector<Arch> all_archs();
+
+// Whether the backend is built and has a device.
+bool arch_available(Arch arch);
+
+// Keeps the compiler from optimizing |value| away.
+template <typename T>
+inline void do_not_optimize(T const &value) {
+#if defined(_MSC_VER)
+  static const void *volatile sink;
+  sink = &value;
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+}  // namespace taichi::benchmarks
+
+#define TI_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define TI_BENCHMARK_CONCAT(a, b) TI_BENCHMARK_CONCAT_IMPL(a, b)
+
+// Registers |func|, a void(State &), under |name|.
+#define TI_BENCHMARK(name, func)                                  \
+  static bool TI_BENCHMARK_CONCAT(ti_benchmark_, __LINE__) =      \
+      ::taichi::benchmarks::register_benchmark(name, func)
+
+// Registers |func|, a void(State &, Arch), under |name|/<arch> for each arch
+// in |archs|.
+#define TI_ARCH_BENCHMARK(name, archs, func)                      \
+  static bool TI_BENCHMARK_CONCAT(ti_benchmark_, __LINE__) =      \
+      ::taichi::benchmarks::register_arch_benchmark(name, archs, func)
@@ -0,0 +1,53 @@
+"""Compares two result files of taichi_cpp_benchmarks.
+
+    python3 compare.py baseline.json new.json [--threshold 0.1]
+
+Exits with 1 if the median time of a benchmark run by both grew by more than
+the threshold, so that it can gate upgrades.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)["benchmarks"]
+    return {r["name"]: r for r in results if "skipped" not in r}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("new")
+    parser.add_argument("--threshold",
+                        type=float,
+                        default=0.1,
+                        help="The relative slowdown of the median allowed")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    new = load(args.new)
+    regressions = []
+    for name in sorted(baseline.keys() & new.keys()):
+        old_ns = baseline[name]["median_ns"]
+        new_ns = new[name]["median_ns"]
+        change = new_ns / old_ns - 1
+        flag = ""
+        if change > args.threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print(f"{name:48} {old_ns:14.1f} -> {new_ns:14.1f} ns "
+              f"({change:+.1%}){flag}")
+    for name in sorted(baseline.keys() - new.keys()):
+        print(f"{name:48} missing from {args.new}")
+
+    if regressions:
+        print(f"{len(regressions)} benchmark(s) regressed by more than "
+              f"{args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/aot/graph_data.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/graph_builder.h"
+#include "taichi/program/ndarray.h"
+#include "taichi/program/program.h"
+
+namespace taichi::benchmarks {
+namespace {
+
+using namespace lang;
+
+std::unique_ptr<Program> make_program(Arch arch) {
+  auto program = std::make_unique<Program>(arch);
+  program->materialize_runtime();
+  program->add_snode_tree(std::make_unique<SNode>(/*depth=*/0, SNodeType::root),
+                          /*compile_only=*/false);
+  return program;
+}
+
+// a[0] = x, the smallest kernel that isn't optimized away.
+std::unique_ptr<Kernel> make_store_kernel(Program *program,
+                                          const std::string &name) {
+  IRBuilder builder;
+  auto *arr = builder.create_arg_load(/*arg_id=*/0, get_data_type<int>(),
+                                      /*is_ptr=*/true);
+  auto *x = builder.create_arg_load(/*arg_id=*/1, get_data_type<int>(),
+                                    /*is_ptr=*/false);
+  builder.create_global_store(
+      builder.create_external_ptr(arr, {builder.get_int32(0)}), x);
+  auto kernel =
+      std::make_unique<Kernel>(*program, builder.extract_ir(), name);
+  kernel->insert_arr_param(get_data_type<int>(), /*total_dim=*/1, {1});
+  kernel->insert_scalar_param(get_data_type<int>());
+  return kernel;
+}
+
+// The host overhead of a launch: the launches are only synchronized every
+// |kSyncInterval| iterations, so on the GPU backends they queue up.
+constexpr int kSyncInterval = 256;
+
+void bm_launch(State &state, Arch arch, bool sync_each_launch) {
+  if (!arch_available(arch)) {
+    state.skip("backend not available");
+    return;
+  }
+  auto program = make_program(arch);
+  auto kernel = make_store_kernel(program.get(), "store");
+  Ndarray arr(program.get(), PrimitiveType::i32, {1});
+  auto ctx = kernel->make_launch_context();
+  ctx.set_arg_ndarray(0, arr);
+  ctx.set_arg_int(1, 1);
+  const auto &config = program->this_thread_config();
+  int i = 0;
+  while (state.keep_running()) {
+    (*kernel)(config, ctx);
+    if (sync_each_launch || ++i % kSyncInterval == 0) {
+      program->synchronize();
+    }
+  }
+  program->synchronize();
+}
+
+TI_ARCH_BENCHMARK("launch/async", all_archs(), [](State &state, Arch arch) {
+  bm_launch(state, arch, /*sync_each_launch=*/false);
+});
+
+// The round trip of a launch followed by a synchronization.
+TI_ARCH_BENCHMARK("launch/sync", all_archs(), [](State &state, Arch arch) {
+  bm_launch(state, arch, /*sync_each_launch=*/true);
+});
+
+// A graph of |kNumDispatches| store kernels sharing the same arguments.
+constexpr int kNumDispatches = 8;
+
+void bm_graph_run(State &state, Arch arch, bool bound) {
+  if (!arch_available(arch)) {
+    state.skip("backend not available");
+    return;
+  }
+  auto program = make_program(arch);
+  std::vector<std::unique_ptr<Kernel>> kernels;
+  auto builder = std::make_unique<GraphBuilder>();
+  auto *seq = builder->seq();
+  auto arr_arg = aot::Arg{aot::ArgKind::kNdarray, "arr", PrimitiveType::i32, 1};
+  auto x_arg = aot::Arg{aot::ArgKind::kScalar, "x", PrimitiveType::i32};
+  for (int i = 0; i < kNumDispatches; i++) {
+    kernels.push_back(
+        make_store_kernel(program.get(), "store_" + std::to_string(i)));
+    seq->dispatch(kernels.back().get(), {arr_arg, x_arg});
+  }
+  auto graph = builder->compile();
+
+  Ndarray arr(program.get(), PrimitiveType::i32, {1});
+  std::unordered_map<std::string, aot::IValue> args;
+  args.insert({"arr", aot::IValue::create(arr)});
+  args.insert({"x", aot::IValue::create<int>(1)});
+  if (bound) {
+    graph->bind(graph->get_arg_slot("arr"), args.at("arr"));
+    graph->bind(graph->get_arg_slot("x"), args.at("x"));
+  }
+  state.set_items_per_iteration(kNumDispatches);
+  int i = 0;
+  while (state.keep_running()) {
+    if (bound) {
+      graph->run_bound();
+    } else {
+      graph->run(args);
+    }
+    if (++i % kSyncInterval == 0) {
+      program->synchronize();
+    }
+  }
+  program->synchronize();
+}
+
+TI_ARCH_BENCHMARK("graph/run", all_archs(), [](State &state, Arch arch) {
+  bm_graph_run(state, arch, /*bound=*/false);
+});
+
+TI_ARCH_BENCHMARK("graph/run_bound",
+                  all_archs(),
+                  [](State &state, Arch arch) {
+                    bm_graph_run(state, arch, /*bound=*/true);
+                  });
+
+}  // namespace
+}  // namespace taichi::benchmarks
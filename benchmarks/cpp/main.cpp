@@ -0,0 +1,196 @@
+// Runs the C++ benchmarks and writes the results as JSON:
+//
+//   taichi_cpp_benchmarks [--filter=<regex>] [--out=<file>]
+//                         [--repetitions=<n>] [--min_batch_time=<seconds>]
+//                         [--list]
+//
+// See benchmarks/cpp/compare.py for comparing two result files.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <regex>
+#include <string>
+#include <thread>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/common/core.h"
+
+using namespace taichi::benchmarks;
+
+namespace {
+
+struct Options {
+  std::string filter{".*"};
+  std::string out;
+  int repetitions{10};
+  double min_batch_time{0.05};
+  bool list{false};
+};
+
+bool parse_flag(const std::string &arg,
+                const std::string &flag,
+                std::string &value) {
+  auto prefix = "--" + flag + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    std::string value;
+    if (arg == "--list") {
+      options.list = true;
+    } else if (parse_flag(arg, "filter", value)) {
+      options.filter = value;
+    } else if (parse_flag(arg, "out", value)) {
+      options.out = value;
+    } else if (parse_flag(arg, "repetitions", value)) {
+      options.repetitions = std::max(1, std::atoi(value.c_str()));
+    } else if (parse_flag(arg, "min_batch_time", value)) {
+      options.min_batch_time = std::atof(value.c_str());
+    } else {
+      std::fprintf(stderr, "Unknown argument %s\n", arg.c_str());
+      std::exit(1);
+    }
+  }
+  return options;
+}
+
+struct Result {
+  std::string name;
+  std::string skip_reason;
+  uint64_t batch_size{0};
+  double min_ns{0};
+  double median_ns{0};
+  double mean_ns{0};
+  double stddev_ns{0};
+  uint64_t bytes_per_iteration{0};
+  uint64_t items_per_iteration{0};
+};
+
+Result run(const BenchmarkInfo &info, const Options &options) {
+  State state(options.min_batch_time, options.repetitions);
+  info.func(state);
+  Result result;
+  result.name = info.name;
+  if (state.skipped()) {
+    result.skip_reason = state.skip_reason();
+    return result;
+  }
+  auto samples = state.samples();
+  if (samples.empty()) {
+    result.skip_reason = "the benchmark did not run its timing loop";
+    return result;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto n = samples.size();
+  result.batch_size = state.batch_size();
+  result.min_ns = samples.front();
+  result.median_ns = n % 2 ? samples[n / 2]
+                           : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  for (auto s : samples) {
+    result.mean_ns += s / n;
+  }
+  for (auto s : samples) {
+    result.stddev_ns += (s - result.mean_ns) * (s - result.mean_ns) / n;
+  }
+  result.stddev_ns = std::sqrt(result.stddev_ns);
+  result.bytes_per_iteration = state.bytes_per_iteration();
+  result.items_per_iteration = state.items_per_iteration();
+  return result;
+}
+
+void write_json(std::FILE *file,
+                const Options &options,
+                const std::vector<Result> &results) {
+  char date[64];
+  auto now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  std::fprintf(file, "{\n  \"context\": {\n");
+  std::fprintf(file, "    \"date\": \"%s\",\n", date);
+  std::fprintf(file, "    \"version\": \"%s\",\n",
+               taichi::get_version_string().c_str());
+  std::fprintf(file, "    \"commit\": \"%s\",\n",
+               taichi::get_commit_hash().c_str());
+  std::fprintf(file, "    \"num_cpus\": %u,\n",
+               std::thread::hardware_concurrency());
+  std::fprintf(file, "    \"repetitions\": %d,\n", options.repetitions);
+  std::fprintf(file, "    \"min_batch_time\": %g\n  },\n",
+               options.min_batch_time);
+  std::fprintf(file, "  \"benchmarks\": [");
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const auto &r = results[i];
+    std::fprintf(file, "%s\n    {\"name\": \"%s\"", i ? "," : "",
+                 r.name.c_str());
+    if (!r.skip_reason.empty()) {
+      std::fprintf(file, ", \"skipped\": \"%s\"}", r.skip_reason.c_str());
+      continue;
+    }
+    std::fprintf(file,
+                 ", \"iterations\": %llu, \"min_ns\": %.3f, "
+                 "\"median_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f",
+                 (unsigned long long)r.batch_size, r.min_ns, r.median_ns,
+                 r.mean_ns, r.stddev_ns);
+    if (r.bytes_per_iteration) {
+      std::fprintf(file, ", \"bytes_per_second\": %.6g",
+                   r.bytes_per_iteration * 1e9 / r.median_ns);
+    }
+    if (r.items_per_iteration) {
+      std::fprintf(file, ", \"items_per_second\": %.6g",
+                   r.items_per_iteration * 1e9 / r.median_ns);
+    }
+    std::fprintf(file, "}");
+  }
+  std::fprintf(file, "\n  ]\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  auto options = parse_options(argc, argv);
+  std::regex filter(options.filter);
+  std::vector<Result> results;
+  for (const auto &info : get_benchmarks()) {
+    if (!std::regex_search(info.name, filter)) {
+      continue;
+    }
+    if (options.list) {
+      std::printf("%s\n", info.name.c_str());
+      continue;
+    }
+    auto result = run(info, options);
+    // The progress goes to stderr so that stdout stays valid JSON.
+    if (result.skip_reason.empty()) {
+      std::fprintf(stderr, "%-48s %14.1f ns (min %.1f, %llu iterations)\n",
+                   result.name.c_str(), result.median_ns, result.min_ns,
+                   (unsigned long long)result.batch_size);
+    } else {
+      std::fprintf(stderr, "%-48s skipped: %s\n", result.name.c_str(),
+                   result.skip_reason.c_str());
+    }
+    results.push_back(std::move(result));
+  }
+  if (options.list) {
+    return 0;
+  }
+  std::FILE *file = stdout;
+  if (!options.out.empty()) {
+    file = std::fopen(options.out.c_str(), "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "Cannot open %s\n", options.out.c_str());
+      return 1;
+    }
+  }
+  write_json(file, options, results);
+  if (file != stdout) {
+    std::fclose(file);
+  }
+  return 0;
+}
@@ -0,0 +1,240 @@
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/inc/constants.h"
+#include "taichi/program/program.h"
+#ifdef TI_WITH_LLVM
+#include "taichi/rhi/cpu/cpu_device.h"
+#include "taichi/rhi/llvm/llvm_caching_allocator.h"
+#include "taichi/system/unified_allocator.h"
+#endif
+#ifdef TI_WITH_CUDA
+#include "taichi/rhi/cuda/cuda_device.h"
+#endif
+
+namespace taichi::benchmarks {
+namespace {
+
+using namespace lang;
+
+#ifdef TI_WITH_LLVM
+
+void bm_unified_allocator(State &state, std::size_t size) {
+  cpu::CpuDevice device;
+  UnifiedAllocator allocator(std::size_t(1) << 28, host_arch(), &device);
+  state.set_items_per_iteration(1);
+  while (state.keep_running()) {
+    auto *ptr = allocator.allocate(size, /*alignment=*/64);
+    if (ptr == nullptr) {
+      state.pause_timing();
+      allocator.head = allocator.data;
+      state.resume_timing();
+      ptr = allocator.allocate(size, /*alignment=*/64);
+    }
+    do_not_optimize(ptr);
+  }
+}
+
+TI_BENCHMARK("alloc/unified/64B",
+             [](State &state) { bm_unified_allocator(state, 64); });
+TI_BENCHMARK("alloc/unified/64KB",
+             [](State &state) { bm_unified_allocator(state, 64 << 10); });
+
+// Serves segments from host memory, so that the bookkeeping of the caching
+// allocator shared by the LLVM GPU backends is measured without the driver.
+class HostCachingAllocator : public LlvmCachingAllocator {
+ public:
+  HostCachingAllocator() : LlvmCachingAllocator(nullptr) {
+  }
+
+  ~HostCachingAllocator() override {
+    for (auto *ptr : live_segments_) {
+      std::free(ptr);
+    }
+  }
+
+ protected:
+  uint64_t *driver_allocate(std::size_t size) override {
+    auto *ptr = (uint64_t *)std::aligned_alloc(taichi_page_size, size);
+    live_segments_.insert(ptr);
+    return ptr;
+  }
+
+  void driver_free(uint64_t *ptr) override {
+    live_segments_.erase(ptr);
+    std::free(ptr);
+  }
+
+ private:
+  std::set<uint64_t *> live_segments_;
+};
+
+LlvmDevice::LlvmRuntimeAllocParams make_params(std::size_t size) {
+  LlvmDevice::LlvmRuntimeAllocParams params;
+  params.size = size;
+  return params;
+}
+
+// One allocation and release of the same size, always served by the cache.
+void bm_caching_allocator(State &state, std::size_t size) {
+  HostCachingAllocator allocator;
+  state.set_items_per_iteration(1);
+  while (state.keep_running()) {
+    auto *ptr = allocator.allocate(make_params(size));
+    allocator.release(size, ptr);
+  }
+}
+
+TI_BENCHMARK("alloc/caching/host/4KB",
+             [](State &state) { bm_caching_allocator(state, 4 << 10); });
+TI_BENCHMARK("alloc/caching/host/8MB",
+             [](State &state) { bm_caching_allocator(state, 8 << 20); });
+
+// Keeps |kNumLive| blocks of random sizes alive and replaces one of them per
+// iteration, so that blocks are split and merged.
+void bm_caching_allocator_mixed(State &state) {
+  constexpr int kNumLive = 256;
+  HostCachingAllocator allocator;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<std::size_t> size_dist(1, 4 << 20);
+  std::vector<std::pair<std::size_t, uint64_t *>> live;
+  for (int i = 0; i < kNumLive; i++) {
+    auto size = size_dist(rng);
+    live.emplace_back(size, allocator.allocate(make_params(size)));
+  }
+  state.set_items_per_iteration(1);
+  int victim = 0;
+  while (state.keep_running()) {
+    auto &[size, ptr] = live[victim];
+    allocator.release(size, ptr);
+    size = size_dist(rng);
+    ptr = allocator.allocate(make_params(size));
+    victim = (victim + 1) % kNumLive;
+  }
+  for (auto &[size, ptr] : live) {
+    allocator.release(size, ptr);
+  }
+}
+
+TI_BENCHMARK("alloc/caching/host/mixed", bm_caching_allocator_mixed);
+
+#endif  // TI_WITH_LLVM
+
+// CudaCachingAllocator, through the device the CUDA backend allocates
+// ndarrays with.
+void bm_cuda_caching_allocator(State &state, std::size_t size) {
+#ifdef TI_WITH_CUDA
+  if (!arch_available(Arch::cuda)) {
+    state.skip("backend not available");
+    return;
+  }
+  Program program(Arch::cuda);
+  program.materialize_runtime();
+  auto *device = static_cast<cuda::CudaDevice *>(program.get_compute_device());
+  LlvmDevice::LlvmRuntimeAllocParams params;
+  params.size = size;
+  params.use_cached = true;
+  state.set_items_per_iteration(1);
+  while (state.keep_running()) {
+    auto alloc = device->allocate_memory_runtime(params);
+    device->dealloc_memory(alloc);
+  }
+#else
+  state.skip("built without CUDA");
+#endif
+}
+
+TI_BENCHMARK("alloc/caching/cuda/4KB",
+             [](State &state) { bm_cuda_caching_allocator(state, 4 << 10); });
+TI_BENCHMARK("alloc/caching/cuda/8MB",
+             [](State &state) { bm_cuda_caching_allocator(state, 8 << 20); });
+
+constexpr std::size_t kCopySize = 16 << 20;
+
+// Device::memcpy_direct() between two allocations of the same device.
+void bm_memcpy_device_to_device(State &state, Arch arch) {
+  if (!arch_available(arch)) {
+    state.skip("backend not available");
+    return;
+  }
+  Program program(arch);
+  program.materialize_runtime();
+  auto *device = program.get_compute_device();
+  Device::AllocParams params;
+  params.size = kCopySize;
+  auto src = device->allocate_memory_unique(params);
+  auto dst = device->allocate_memory_unique(params);
+  state.set_bytes_per_iteration(kCopySize);
+  while (state.keep_running()) {
+    Device::memcpy_direct(dst->get_ptr(), src->get_ptr(), kCopySize);
+  }
+}
+
+TI_ARCH_BENCHMARK("memcpy/device_to_device", all_archs(),
+                  bm_memcpy_device_to_device);
+
+// Uploads through a host visible staging buffer, as Ndarray::write() does.
+void bm_memcpy_host_to_device(State &state, Arch arch) {
+  if (!arch_available(arch)) {
+    state.skip("backend not available");
+    return;
+  }
+  Program program(arch);
+  program.materialize_runtime();
+  auto *device = program.get_compute_device();
+  Device::AllocParams params;
+  params.size = kCopySize;
+  auto dst = device->allocate_memory_unique(params);
+  params.host_write = true;
+  auto staging = device->allocate_memory_unique(params);
+  std::vector<char> host(kCopySize, 1);
+  state.set_bytes_per_iteration(kCopySize);
+  while (state.keep_running()) {
+    void *mapped{nullptr};
+    TI_ASSERT(device->map(*staging, &mapped) == RhiResult::success);
+    std::memcpy(mapped, host.data(), kCopySize);
+    device->unmap(*staging);
+    Device::memcpy_direct(dst->get_ptr(), staging->get_ptr(), kCopySize);
+  }
+}
+
+TI_ARCH_BENCHMARK("memcpy/host_to_device", all_archs(),
+                  bm_memcpy_host_to_device);
+
+// The cross-device copy from a CPU allocation into Vulkan memory.
+void bm_memcpy_cpu_to_vulkan(State &state) {
+#if defined(TI_WITH_VULKAN) && defined(TI_WITH_LLVM)
+  if (!arch_available(Arch::vulkan)) {
+    state.skip("backend not available");
+    return;
+  }
+  Program program(Arch::vulkan);
+  program.materialize_runtime();
+  auto *device = program.get_compute_device();
+  cpu::CpuDevice cpu_device;
+  Device::AllocParams params;
+  params.size = kCopySize;
+  auto src = cpu_device.allocate_memory_unique(params);
+  auto dst = device->allocate_memory_unique(params);
+  params.host_write = true;
+  auto staging = device->allocate_memory_unique(params);
+  TI_ASSERT(Device::check_memcpy_capability(dst->get_ptr(), src->get_ptr(),
+                                            kCopySize) ==
+            Device::MemcpyCapability::RequiresStagingBuffer);
+  state.set_bytes_per_iteration(kCopySize);
+  while (state.keep_running()) {
+    Device::memcpy_via_staging(dst->get_ptr(), staging->get_ptr(),
+                               src->get_ptr(), kCopySize);
+  }
+#else
+  state.skip("built without Vulkan");
+#endif
+}
+
+TI_BENCHMARK("memcpy/cpu_to_vulkan", bm_memcpy_cpu_to_vulkan);
+
+}  // namespace
+}  // namespace taichi::benchmarks
@@ -0,0 +1,167 @@
+// Sparse SNodes on the LLVM backends. NodeManager lives in the runtime
+// module, so its allocation and recycling are measured through the kernels
+// that activate and deactivate pointer cells.
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/program.h"
+
+namespace taichi::benchmarks {
+namespace {
+
+using namespace lang;
+
+constexpr int kNumBlocks = 1024;
+constexpr int kBlockSize = 256;
+constexpr int kNumCells = kNumBlocks * kBlockSize;
+
+// ti.root.pointer(ti.i, kNumBlocks).dense(ti.i, kBlockSize).place(x)
+class SparseProgram {
+ public:
+  explicit SparseProgram(Arch arch) : program_(arch) {
+    program_.materialize_runtime();
+    auto root = std::make_unique<SNode>(/*depth=*/0, SNodeType::root);
+    pointer_ = &root->pointer(Axis(0), kNumBlocks, "");
+    dense_ = &pointer_->dense(Axis(0), kBlockSize, "");
+    place_ = &dense_->insert_children(SNodeType::place);
+    place_->dt = PrimitiveType::i32;
+    program_.add_snode_tree(std::move(root), /*compile_only=*/false);
+
+    {
+      // for i in range(kNumCells): x[i] = 1
+      IRBuilder builder;
+      auto *loop = builder.create_range_for(builder.get_int32(0),
+                                            builder.get_int32(kNumCells));
+      {
+        auto _ = builder.get_loop_guard(loop);
+        auto *ptr =
+            builder.create_global_ptr(place_, {builder.get_loop_index(loop)});
+        builder.create_global_store(ptr, builder.get_int32(1));
+      }
+      activate_ = std::make_unique<Kernel>(program_, builder.extract_ir(),
+                                           "activate");
+    }
+    {
+      // for i in pointer: ti.deactivate(pointer, i)
+      IRBuilder builder;
+      auto *loop = builder.create_struct_for(pointer_);
+      {
+        auto _ = builder.get_loop_guard(loop);
+        auto *ptr = builder.insert(Stmt::make_typed<GlobalPtrStmt>(
+            pointer_, std::vector<Stmt *>{builder.get_loop_index(loop)},
+            /*activate=*/true, /*is_cell_access=*/true));
+        builder.insert(Stmt::make_typed<SNodeOpStmt>(SNodeOpType::deactivate,
+                                                     pointer_, ptr));
+      }
+      deactivate_ = std::make_unique<Kernel>(program_, builder.extract_ir(),
+                                             "deactivate");
+    }
+    {
+      // for i in x: x[i] += 1
+      IRBuilder builder;
+      auto *loop = builder.create_struct_for(dense_);
+      {
+        auto _ = builder.get_loop_guard(loop);
+        auto *ptr =
+            builder.create_global_ptr(place_, {builder.get_loop_index(loop)});
+        builder.create_global_store(
+            ptr, builder.create_add(builder.create_global_load(ptr),
+                                    builder.get_int32(1)));
+      }
+      increment_ = std::make_unique<Kernel>(program_, builder.extract_ir(),
+                                            "increment");
+    }
+  }
+
+  void launch(Kernel *kernel) {
+    auto ctx = kernel->make_launch_context();
+    (*kernel)(program_.this_thread_config(), ctx);
+    program_.synchronize();
+  }
+
+  void activate() {
+    launch(activate_.get());
+  }
+
+  void deactivate() {
+    launch(deactivate_.get());
+  }
+
+  void increment() {
+    launch(increment_.get());
+  }
+
+ private:
+  Program program_;
+  SNode *pointer_{nullptr};
+  SNode *dense_{nullptr};
+  SNode *place_{nullptr};
+  std::unique_ptr<Kernel> activate_;
+  std::unique_ptr<Kernel> deactivate_;
+  std::unique_ptr<Kernel> increment_;
+};
+
+bool check_sparse_arch(State &state, Arch arch) {
+  if (!arch_available(arch)) {
+    state.skip("backend not available");
+    return false;
+  }
+  if (!arch_uses_llvm(arch)) {
+    state.skip("pointer SNodes are only supported on the LLVM backends");
+    return false;
+  }
+  return true;
+}
+
+// Allocates every block from the NodeManager of the pointer.
+void bm_activate(State &state, Arch arch) {
+  if (!check_sparse_arch(state, arch)) {
+    return;
+  }
+  SparseProgram program(arch);
+  state.set_items_per_iteration(kNumBlocks);
+  while (state.keep_running()) {
+    program.activate();
+    state.pause_timing();
+    program.deactivate();
+    state.resume_timing();
+  }
+}
+
+TI_ARCH_BENCHMARK("sparse/activate", all_archs(), bm_activate);
+
+// Recycles every block, including the listgen of the pointer.
+void bm_deactivate(State &state, Arch arch) {
+  if (!check_sparse_arch(state, arch)) {
+    return;
+  }
+  SparseProgram program(arch);
+  state.set_items_per_iteration(kNumBlocks);
+  while (state.keep_running()) {
+    state.pause_timing();
+    program.activate();
+    state.resume_timing();
+    program.deactivate();
+  }
+}
+
+TI_ARCH_BENCHMARK("sparse/deactivate", all_archs(), bm_deactivate);
+
+// A struct-for with a trivial body over fully active blocks, so that the
+// listgen tasks of the pointer and the dense dominate.
+void bm_listgen(State &state, Arch arch) {
+  if (!check_sparse_arch(state, arch)) {
+    return;
+  }
+  SparseProgram program(arch);
+  program.activate();
+  state.set_items_per_iteration(kNumCells);
+  while (state.keep_running()) {
+    program.increment();
+  }
+}
+
+TI_ARCH_BENCHMARK("sparse/listgen", all_archs(), bm_listgen);
+
+}  // namespace
+}  // namespace taichi::benchmarks
@@ -1,5 +1,6 @@
 from .atomic_ops import AtomicOpsPlan
 from .fill import FillPlan
+from .launch_overhead import LaunchOverheadPlan
 from .math_opts import MathOpsPlan
 from .matrix_ops import MatrixOpsPlan
 from .memcpy import MemcpyPlan
@@ -7,6 +8,6 @@ from .saxpy import SaxpyPlan
 from .stencil2d import Stencil2DPlan
 
 benchmark_plan_list = [
-    AtomicOpsPlan, FillPlan, MathOpsPlan, MatrixOpsPlan, MemcpyPlan, SaxpyPlan,
-    Stencil2DPlan
+    AtomicOpsPlan, FillPlan, LaunchOverheadPlan, MathOpsPlan, MatrixOpsPlan,
+    MemcpyPlan, SaxpyPlan, Stencil2DPlan
 ]
@@ -0,0 +1,46 @@
+from microbenchmarks._items import BenchmarkItem
+from microbenchmarks._metric import MetricType
+from microbenchmarks._plan import BenchmarkPlan
+
+import taichi as ti
+
+
+class NumArgs(BenchmarkItem):
+    name = 'num_args'
+
+    def __init__(self):
+        self._items = {'1arg': 1, '4args': 4}
+
+
+class LaunchMetricType(MetricType):
+    def __init__(self):
+        super().__init__()
+        # Kernel time is negligible here, only the host-side cost matters.
+        self.remove(['kernel_elapsed_time_ms'])
+
+
+def launch_overhead_default(arch, repeat, num_args, get_metric):
+    # Tiny kernels launched many times: the time is dominated by the host-side
+    # launch path rather than by the device.
+    repeat *= 1000
+    arrays = [ti.ndarray(ti.f32, 16) for _ in range(num_args)]
+
+    @ti.kernel
+    def tiny_1(a: ti.types.ndarray()):
+        a[0] += 1.0
+
+    @ti.kernel
+    def tiny_4(a: ti.types.ndarray(), b: ti.types.ndarray(),
+               c: ti.types.ndarray(), d: ti.types.ndarray()):
+        a[0] += b[0] + c[0] + d[0]
+
+    func = tiny_1 if num_args == 1 else tiny_4
+    return get_metric(repeat, func, *arrays)
+
+
+class LaunchOverheadPlan(BenchmarkPlan):
+    def __init__(self, arch: str):
+        super().__init__('launch_overhead', arch, basic_repeat_times=1)
+        self.create_plan(NumArgs(), LaunchMetricType())
+        self.add_func(['1arg'], launch_overhead_default)
+        self.add_func(['4args'], launch_overhead_default)
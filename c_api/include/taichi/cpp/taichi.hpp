@@ -783,12 +783,29 @@ class AotModule {
     TiKernel kernel_ = ti_get_aot_module_kernel(aot_module_, name);
     return Kernel(runtime_, kernel_);
   }
+  Kernel get_specialized_kernel(
+      const char *name,
+      const std::vector<TiNamedArgument> &constants) {
+    TiKernel kernel_ = ti_get_aot_module_specialized_kernel(
+        aot_module_, name, constants.size(), constants.data());
+    return Kernel(runtime_, kernel_);
+  }
   ComputeGraph get_compute_graph(const char *name) {
     TiComputeGraph compute_graph_ =
         ti_get_aot_module_compute_graph(aot_module_, name);
     return ComputeGraph(runtime_, compute_graph_);
   }
 
+  // Prefetches every kernel in the module if |names| is empty.
+  void prefetch_kernels(const std::vector<const char *> &names = {}) {
+    ti_prefetch_aot_module_kernels(aot_module_, names.size(), names.data());
+  }
+  TiAotModulePrefetchProgress get_prefetch_progress() const {
+    TiAotModulePrefetchProgress progress{};
+    ti_get_aot_module_prefetch_progress(aot_module_, &progress);
+    return progress;
+  }
+
   constexpr TiAotModule aot_module() const {
     return aot_module_;
   }
@@ -1135,6 +1152,12 @@ class Runtime {
   void wait() {
     ti_wait(runtime_);
   }
+  uint64_t signal() {
+    return ti_signal(runtime_);
+  }
+  void wait_for(uint64_t value) {
+    ti_wait_for(runtime_, value);
+  }
 
   constexpr TiArch arch() const {
     return arch_;
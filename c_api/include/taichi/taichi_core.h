@@ -804,6 +804,43 @@ typedef struct TiNamedArgument {
   TiArgument argument;
 } TiNamedArgument;
 
+// Structure `TiKernelLaunch` (1.5.0)
+//
+// A kernel launch to be batched by `ti_launch_kernels`.
+typedef struct TiKernelLaunch {
+  // Kernel to launch.
+  TiKernel kernel;
+  // Number of arguments in `args`.
+  uint32_t arg_count;
+  // Arguments of the launch, as in `ti_launch_kernel`.
+  const TiArgument *args;
+} TiKernelLaunch;
+
+// Structure `TiAotModulePrefetchProgress` (1.5.0)
+//
+// Progress of the kernels being prefetched in an AOT module.
+typedef struct TiAotModulePrefetchProgress {
+  // Number of kernels requested by all prefetches so far.
+  uint32_t kernel_count;
+  // Number of requested kernels that are ready.
+  uint32_t prefetched_kernel_count;
+} TiAotModulePrefetchProgress;
+
+// Structure `TiMemoryStats` (1.5.0)
+//
+// Memory usage of a runtime, in bytes.
+typedef struct TiMemoryStats {
+  // Memory backing the fields of the loaded AOT modules.
+  uint64_t snode_tree_bytes;
+  // Memory requested by the runtime for sparse data structures and other
+  // runtime data.
+  uint64_t runtime_requested_bytes;
+  // Memory handed out by the caching allocator, if any.
+  uint64_t cached_allocated_bytes;
+  // Memory held by the caching allocator, in use or not.
+  uint64_t cached_reserved_bytes;
+} TiMemoryStats;
+
 // Function `ti_get_version` (1.4.0)
 //
 // Get the current taichi version. It has the same value as `TI_C_API_VERSION`
@@ -975,10 +1012,23 @@ TI_DLL_EXPORT void TI_API_CALL ti_launch_kernel(TiRuntime runtime,
                                                 uint32_t arg_count,
                                                 const TiArgument *args);
 
+// Function `ti_launch_kernels` (Device Command) (1.5.0)
+//
+// Launches a sequence of Taichi kernels in order, each with its own arguments,
+// as if by calling `ti_launch_kernel` on each of `launches`. Batching the
+// launches avoids the per-call overhead of setting up the kernel arguments.
+TI_DLL_EXPORT void TI_API_CALL
+ti_launch_kernels(TiRuntime runtime,
+                  uint32_t launch_count,
+                  const TiKernelLaunch *launches);
+
 // Function `ti_launch_compute_graph` (Device Command) (1.4.0)
 //
 // Launches a Taichi compute graph with provided named arguments. The named
 // arguments *must* have the same count, names, and types as in the source code.
+// The arguments equal to those of the previous launch of the same graph are not
+// validated or set up again, so that relaunching a graph with few changed
+// arguments is cheap.
 TI_DLL_EXPORT void TI_API_CALL
 ti_launch_compute_graph(TiRuntime runtime,
                         TiComputeGraph compute_graph,
@@ -997,11 +1047,38 @@ TI_DLL_EXPORT void TI_API_CALL ti_flush(TiRuntime runtime);
 // command that has not been submitted is submitted first.
 TI_DLL_EXPORT void TI_API_CALL ti_wait(TiRuntime runtime);
 
+// Function `ti_signal` (1.5.0)
+//
+// Submits all previously invoked device commands like
+// [`ti_flush`](#function-ti_flush), and returns a value that
+// [`ti_wait_for`](#function-ti_wait_for) can wait on for them. The values
+// increase monotonically, so the results of a frame can be read back while
+// the later frames are still in flight.
+TI_DLL_EXPORT uint64_t TI_API_CALL ti_signal(TiRuntime runtime);
+
+// Function `ti_wait_for` (1.5.0)
+//
+// Waits until the device commands submitted by the
+// [`ti_signal`](#function-ti_signal) that returned `value` are executed. The
+// commands submitted after it are not waited for. On the backends that can't
+// tell the submissions apart, it waits like [`ti_wait`](#function-ti_wait).
+// `ti_signal` and `ti_wait_for` must be called on the same thread.
+TI_DLL_EXPORT void TI_API_CALL ti_wait_for(TiRuntime runtime, uint64_t value);
+
+// Function `ti_get_memory_stats` (1.5.0)
+//
+// Gets the current memory usage of the runtime. It is cheap enough to be
+// called every frame. Only supported on the LLVM backends (CPU and CUDA).
+TI_DLL_EXPORT void TI_API_CALL ti_get_memory_stats(TiRuntime runtime,
+                                                   TiMemoryStats *stats);
+
 // Function `ti_load_aot_module` (1.4.0)
 //
 // Loads a pre-compiled AOT module from the file system.
 // Returns [`TI_NULL_HANDLE`](#definition-ti_null_handle) if the runtime fails
-// to load the AOT module from the specified path.
+// to load the AOT module from the specified path. On the graphics backends, a
+// `.tcm` archive is mapped into memory and each kernel is only read and
+// compiled when it is first retrieved.
 TI_DLL_EXPORT TiAotModule TI_API_CALL
 ti_load_aot_module(TiRuntime runtime, const char *module_path);
 
@@ -1027,6 +1104,22 @@ TI_DLL_EXPORT void TI_API_CALL ti_destroy_aot_module(TiAotModule aot_module);
 TI_DLL_EXPORT TiKernel TI_API_CALL
 ti_get_aot_module_kernel(TiAotModule aot_module, const char *name);
 
+// Function `ti_get_aot_module_specialized_kernel` (1.5.0)
+//
+// Retrieves a Taichi kernel from the AOT module, with its specialization
+// constants set to the `TI_ARGUMENT_TYPE_I32` or `TI_ARGUMENT_TYPE_F32` values
+// of `constants`. Constants that are not specified are zero. The kernel is
+// specialized once for each distinct set of values, and the values are ignored
+// if passed again as kernel arguments at launch. Returns
+// [`TI_NULL_HANDLE`](#definition-ti_null_handle) if the module does not have a
+// kernel of the specified name, or the kernel has no constant of a specified
+// name.
+TI_DLL_EXPORT TiKernel TI_API_CALL
+ti_get_aot_module_specialized_kernel(TiAotModule aot_module,
+                                     const char *name,
+                                     uint32_t constant_count,
+                                     const TiNamedArgument *constants);
+
 // Function `ti_get_aot_module_compute_graph` (1.4.0)
 //
 // Retrieves a pre-compiled compute graph from the AOT module.
@@ -1035,6 +1128,26 @@ ti_get_aot_module_kernel(TiAotModule aot_module, const char *name);
 TI_DLL_EXPORT TiComputeGraph TI_API_CALL
 ti_get_aot_module_compute_graph(TiAotModule aot_module, const char *name);
 
+// Function `ti_prefetch_aot_module_kernels` (1.5.0)
+//
+// Starts loading the kernels of `kernel_names` in the AOT module on worker
+// threads, or every kernel if `kernel_count` is 0. On Vulkan, their pipelines
+// are created there too, through the persistent pipeline cache, so that
+// retrieving and launching them later doesn't stall. Unknown names are
+// ignored. Call it after the module is loaded, e.g. behind a loading screen.
+TI_DLL_EXPORT void TI_API_CALL
+ti_prefetch_aot_module_kernels(TiAotModule aot_module,
+                               uint32_t kernel_count,
+                               const char *const *kernel_names);
+
+// Function `ti_get_aot_module_prefetch_progress` (1.5.0)
+//
+// Gets the progress of the prefetches of an AOT module. They are complete when
+// all requested kernels are ready.
+TI_DLL_EXPORT void TI_API_CALL
+ti_get_aot_module_prefetch_progress(TiAotModule aot_module,
+                                    TiAotModulePrefetchProgress *progress);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
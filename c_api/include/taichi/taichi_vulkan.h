@@ -89,6 +89,31 @@ typedef struct TiVulkanImageInteropInfo {
   VkImageUsageFlags usage;
 } TiVulkanImageInteropInfo;
 
+// Structure `TiVulkanSubmitInfo` (1.5.0)
+//
+// Semaphores of an external application that a submission of Taichi commands
+// waits for and signals on the Vulkan queue of the runtime.
+typedef struct TiVulkanSubmitInfo {
+  // Number of semaphores to wait for.
+  uint32_t wait_semaphore_count;
+  // Semaphores the commands wait for before they run.
+  const VkSemaphore *wait_semaphores;
+  // Values to wait for, one for each of
+  // `structure.vulkan_submit_info.wait_semaphores`. Binary semaphores ignore
+  // their values. Can be null if all the semaphores to wait for and to signal
+  // are binary.
+  const uint64_t *wait_semaphore_values;
+  // Number of semaphores to signal.
+  uint32_t signal_semaphore_count;
+  // Semaphores signaled once the commands have completed.
+  const VkSemaphore *signal_semaphores;
+  // Values to signal, one for each of
+  // `structure.vulkan_submit_info.signal_semaphores`. Binary semaphores
+  // ignore their values. Can be null if all the semaphores to wait for and to
+  // signal are binary.
+  const uint64_t *signal_semaphore_values;
+} TiVulkanSubmitInfo;
+
 // Function `ti_create_vulkan_runtime_ext` (1.4.0)
 //
 // Creates a Vulkan Taichi runtime with user-controlled capability settings.
@@ -144,6 +169,19 @@ ti_export_vulkan_image(TiRuntime runtime,
                        TiImage image,
                        TiVulkanImageInteropInfo *interop_info);
 
+// Function `ti_submit_vulkan_ext` (1.5.0)
+//
+// Submits all previously invoked device commands like
+// [`ti_flush`](#function-ti_flush), making them wait for and signal the
+// semaphores in `submit_info` on the Vulkan queue of the runtime. Nothing is
+// waited for on the host. A runtime imported with the queue of an engine can
+// thus call it from the engine's render thread, e.g. in a native plugin event,
+// to interleave Taichi commands with rendering on the same queue. Every
+// function taking the runtime has to be called on that thread then, since
+// Taichi records commands per thread.
+TI_DLL_EXPORT void TI_API_CALL
+ti_submit_vulkan_ext(TiRuntime runtime, const TiVulkanSubmitInfo *submit_info);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
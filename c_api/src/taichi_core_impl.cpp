@@ -104,6 +104,16 @@ Runtime::Runtime(taichi::Arch arch) : arch(arch) {
 Runtime::~Runtime() {
 }
 
+taichi::lang::DeviceAllocation *Runtime::acquire_devalloc(
+    const taichi::lang::DeviceAllocation &devalloc) {
+  if (num_used_devallocs_ == devalloc_pool_.size()) {
+    devalloc_pool_.emplace_back();
+  }
+  auto *out = &devalloc_pool_[num_used_devallocs_++];
+  *out = devalloc;
+  return out;
+}
+
 VulkanRuntime *Runtime::as_vk() {
   TI_ASSERT(arch == taichi::Arch::vulkan);
 #ifdef TI_WITH_VULKAN
@@ -630,13 +640,14 @@ TiAotModule ti_create_aot_module(TiRuntime runtime,
   TI_CAPI_ARGUMENT_NULL_RV(runtime);
   TI_CAPI_ARGUMENT_NULL_RV(tcm);
 
-  auto dir = taichi::io::VirtualDir::from_zip(tcm, size);
+  std::shared_ptr<taichi::io::VirtualDir> dir =
+      taichi::io::VirtualDir::from_zip(tcm, size);
   if (dir == TI_NULL_HANDLE) {
     ti_set_last_error(TI_ERROR_CORRUPTED_DATA, "tcm");
     return TI_NULL_HANDLE;
   }
 
-  Error err = ((Runtime *)runtime)->create_aot_module(dir.get(), out);
+  Error err = ((Runtime *)runtime)->create_aot_module(dir, out);
   err.set_last_error();
 
   TI_CAPI_TRY_CATCH_END();
@@ -669,6 +680,59 @@ TiKernel ti_get_aot_module_kernel(TiAotModule aot_module, const char *name) {
   return out;
 }
 
+TiKernel ti_get_aot_module_specialized_kernel(
+    TiAotModule aot_module,
+    const char *name,
+    uint32_t constant_count,
+    const TiNamedArgument *constants) {
+  TiKernel out = TI_NULL_HANDLE;
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL_RV(aot_module);
+  TI_CAPI_ARGUMENT_NULL_RV(name);
+  if (constant_count > 0) {
+    TI_CAPI_ARGUMENT_NULL_RV(constants);
+  }
+
+  std::vector<taichi::lang::aot::KernelTemplateArg> targs;
+  for (uint32_t i = 0; i < constant_count; ++i) {
+    const TiNamedArgument &constant = constants[i];
+    TI_CAPI_ARGUMENT_NULL_RV(constant.name);
+    switch (constant.argument.type) {
+      case TI_ARGUMENT_TYPE_I32: {
+        targs.emplace_back(constant.name,
+                           (int64_t)constant.argument.value.i32);
+        break;
+      }
+      case TI_ARGUMENT_TYPE_F32: {
+        targs.emplace_back(constant.name,
+                           (double)constant.argument.value.f32);
+        break;
+      }
+      default: {
+        ti_set_last_error(TI_ERROR_ARGUMENT_OUT_OF_RANGE,
+                          "constants[i].argument.type");
+        return TI_NULL_HANDLE;
+      }
+    }
+  }
+
+  taichi::lang::aot::KernelTemplate *kernel_template =
+      ((AotModule *)aot_module)->get().get_kernel_template(name);
+  taichi::lang::aot::Kernel *kernel = nullptr;
+  if (kernel_template != nullptr) {
+    kernel = kernel_template->get_kernel(targs);
+  }
+
+  if (kernel == nullptr) {
+    ti_set_last_error(TI_ERROR_NAME_NOT_FOUND, name);
+    return TI_NULL_HANDLE;
+  }
+
+  out = (TiKernel)kernel;
+  TI_CAPI_TRY_CATCH_END();
+  return out;
+}
+
 TiComputeGraph ti_get_aot_module_compute_graph(TiAotModule aot_module,
                                                const char *name) {
   TiComputeGraph out = TI_NULL_HANDLE;
@@ -689,20 +753,54 @@ TiComputeGraph ti_get_aot_module_compute_graph(TiAotModule aot_module,
   return out;
 }
 
-void ti_launch_kernel(TiRuntime runtime,
-                      TiKernel kernel,
-                      uint32_t arg_count,
-                      const TiArgument *args) {
+void ti_prefetch_aot_module_kernels(TiAotModule aot_module,
+                                    uint32_t kernel_count,
+                                    const char *const *kernel_names) {
   TI_CAPI_TRY_CATCH_BEGIN();
-  TI_CAPI_ARGUMENT_NULL(runtime);
-  TI_CAPI_ARGUMENT_NULL(kernel);
-  if (arg_count > 0) {
-    TI_CAPI_ARGUMENT_NULL(args);
+  TI_CAPI_ARGUMENT_NULL(aot_module);
+  if (kernel_count > 0) {
+    TI_CAPI_ARGUMENT_NULL(kernel_names);
   }
 
-  Runtime &runtime2 = *((Runtime *)runtime);
-  taichi::lang::RuntimeContext &runtime_context = runtime2.runtime_context_;
-  std::vector<std::unique_ptr<taichi::lang::DeviceAllocation>> devallocs;
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < kernel_count; ++i) {
+    if (kernel_names[i] == nullptr) {
+      ti_set_last_error(
+          TI_ERROR_ARGUMENT_NULL,
+          ("kernel_names[" + std::to_string(i) + "]").c_str());
+      return;
+    }
+    names.emplace_back(kernel_names[i]);
+  }
+  ((AotModule *)aot_module)->get().prefetch_kernels(names);
+  TI_CAPI_TRY_CATCH_END();
+}
+
+void ti_get_aot_module_prefetch_progress(
+    TiAotModule aot_module,
+    TiAotModulePrefetchProgress *progress) {
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL(aot_module);
+  TI_CAPI_ARGUMENT_NULL(progress);
+
+  taichi::lang::aot::Module::PrefetchProgress out =
+      ((AotModule *)aot_module)->get().get_prefetch_progress();
+  progress->kernel_count = out.num_kernels;
+  progress->prefetched_kernel_count = out.num_prefetched_kernels;
+  TI_CAPI_TRY_CATCH_END();
+}
+
+namespace {
+
+// Sets up the host context of |runtime| with |args| and launches |kernel|.
+Error launch_kernel(Runtime &runtime,
+                    TiKernel kernel,
+                    uint32_t arg_count,
+                    const TiArgument *args) {
+  taichi::lang::RuntimeContext &runtime_context = runtime.runtime_context_;
+  // The allocations are only referred to during the launch, e.g. by
+  // `GfxRuntime::launch_kernel`.
+  runtime.reset_devalloc_pool();
 
   for (uint32_t i = 0; i < arg_count; ++i) {
     const auto &arg = args[i];
@@ -716,44 +814,90 @@ void ti_launch_kernel(TiRuntime runtime,
         break;
       }
       case TI_ARGUMENT_TYPE_NDARRAY: {
-        TI_CAPI_ARGUMENT_NULL(args[i].value.ndarray.memory);
-
-        // Don't allocate it on stack. `DeviceAllocation` is referred to by
-        // `GfxRuntime::launch_kernel`.
-        std::unique_ptr<taichi::lang::DeviceAllocation> devalloc =
-            std::make_unique<taichi::lang::DeviceAllocation>(
-                devmem2devalloc(runtime2, arg.value.ndarray.memory));
+        if (arg.value.ndarray.memory == TI_NULL_HANDLE) {
+          return Error(TI_ERROR_ARGUMENT_NULL,
+                       "args[" + std::to_string(i) + "].value.ndarray.memory");
+        }
+        auto *devalloc = runtime.acquire_devalloc(
+            devmem2devalloc(runtime, arg.value.ndarray.memory));
         const TiNdArray &ndarray = arg.value.ndarray;
 
         std::vector<int> shape(ndarray.shape.dims,
                                ndarray.shape.dims + ndarray.shape.dim_count);
 
-        runtime_context.set_arg_ndarray(i, (intptr_t)devalloc.get(), shape);
-
-        devallocs.emplace_back(std::move(devalloc));
+        runtime_context.set_arg_ndarray(i, (intptr_t)devalloc, shape);
         break;
       }
       case TI_ARGUMENT_TYPE_TEXTURE: {
-        TI_CAPI_ARGUMENT_NULL(args[i].value.texture.image);
-        std::unique_ptr<taichi::lang::DeviceAllocation> devalloc =
-            std::make_unique<taichi::lang::DeviceAllocation>(
-                devimg2devalloc(runtime2, arg.value.texture.image));
+        if (arg.value.texture.image == TI_NULL_HANDLE) {
+          return Error(TI_ERROR_ARGUMENT_NULL,
+                       "args[" + std::to_string(i) + "].value.texture.image");
+        }
+        auto *devalloc = runtime.acquire_devalloc(
+            devimg2devalloc(runtime, arg.value.texture.image));
         int width = arg.value.texture.extent.width;
         int height = arg.value.texture.extent.height;
         int depth = arg.value.texture.extent.depth;
-        runtime_context.set_arg_rw_texture(i, (intptr_t)devalloc.get(),
+        runtime_context.set_arg_rw_texture(i, (intptr_t)devalloc,
                                            {width, height, depth});
-        devallocs.emplace_back(std::move(devalloc));
         break;
       }
       default: {
-        ti_set_last_error(TI_ERROR_ARGUMENT_OUT_OF_RANGE,
-                          ("args[" + std::to_string(i) + "].type").c_str());
-        return;
+        return Error(TI_ERROR_ARGUMENT_OUT_OF_RANGE,
+                     "args[" + std::to_string(i) + "].type");
       }
     }
   }
   ((taichi::lang::aot::Kernel *)kernel)->launch(&runtime_context);
+  return Error();
+}
+
+}  // namespace
+
+void ti_launch_kernel(TiRuntime runtime,
+                      TiKernel kernel,
+                      uint32_t arg_count,
+                      const TiArgument *args) {
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL(runtime);
+  TI_CAPI_ARGUMENT_NULL(kernel);
+  if (arg_count > 0) {
+    TI_CAPI_ARGUMENT_NULL(args);
+  }
+
+  launch_kernel(*((Runtime *)runtime), kernel, arg_count, args)
+      .set_last_error();
+  TI_CAPI_TRY_CATCH_END();
+}
+
+void ti_launch_kernels(TiRuntime runtime,
+                       uint32_t launch_count,
+                       const TiKernelLaunch *launches) {
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL(runtime);
+  if (launch_count > 0) {
+    TI_CAPI_ARGUMENT_NULL(launches);
+  }
+
+  Runtime &runtime2 = *((Runtime *)runtime);
+  for (uint32_t i = 0; i < launch_count; ++i) {
+    const auto &launch = launches[i];
+    if (launch.kernel == TI_NULL_HANDLE ||
+        (launch.arg_count > 0 && launch.args == nullptr)) {
+      ti_set_last_error(
+          TI_ERROR_ARGUMENT_NULL,
+          ("launches[" + std::to_string(i) + "]").c_str());
+      return;
+    }
+    Error err =
+        launch_kernel(runtime2, launch.kernel, launch.arg_count, launch.args);
+    if (err.error != TI_ERROR_SUCCESS) {
+      // The launches before this one have been recorded already.
+      err.message = "launches[" + std::to_string(i) + "]." + err.message;
+      err.set_last_error();
+      return;
+    }
+  }
   TI_CAPI_TRY_CATCH_END();
 }
 
@@ -769,27 +913,27 @@ void ti_launch_compute_graph(TiRuntime runtime,
   }
 
   Runtime &runtime2 = *((Runtime *)runtime);
-  std::unordered_map<std::string, taichi::lang::aot::IValue> arg_map{};
-  std::vector<taichi::lang::Ndarray> ndarrays;
-  ndarrays.reserve(arg_count);
-  std::vector<taichi::lang::Texture> textures;
-  textures.reserve(arg_count);
+  auto *graph = (taichi::lang::aot::CompiledGraph *)compute_graph;
 
+  // The arguments are bound to the slots of the graph, which only validates
+  // and sets up the ones that differ from the previous launch.
   for (uint32_t i = 0; i < arg_count; ++i) {
     TI_CAPI_ARGUMENT_NULL(args[i].name);
 
     const auto &arg = args[i];
+    const int slot = graph->get_arg_slot(arg.name);
+    if (slot < 0) {
+      continue;
+    }
     switch (arg.argument.type) {
       case TI_ARGUMENT_TYPE_I32: {
-        arg_map.emplace(
-            std::make_pair(arg.name, taichi::lang::aot::IValue::create<int32_t>(
-                                         arg.argument.value.i32)));
+        graph->bind(slot, taichi::lang::aot::IValue::create<int32_t>(
+                              arg.argument.value.i32));
         break;
       }
       case TI_ARGUMENT_TYPE_F32: {
-        arg_map.emplace(std::make_pair(
-            arg.name,
-            taichi::lang::aot::IValue::create<float>(arg.argument.value.f32)));
+        graph->bind(slot, taichi::lang::aot::IValue::create<float>(
+                              arg.argument.value.f32));
         break;
       }
       case TI_ARGUMENT_TYPE_NDARRAY: {
@@ -858,9 +1002,8 @@ void ti_launch_compute_graph(TiRuntime runtime,
           dtype = taichi::lang::TypeFactory::get_instance().get_tensor_type(
               elem_shape, dtype);
         }
-        ndarrays.emplace_back(taichi::lang::Ndarray(devalloc, dtype, shape));
-        arg_map.emplace(std::make_pair(
-            arg.name, taichi::lang::aot::IValue::create(ndarrays.back())));
+        taichi::lang::Ndarray arr(devalloc, dtype, shape);
+        graph->bind(slot, taichi::lang::aot::IValue::create(arr));
         break;
       }
       case TI_ARGUMENT_TYPE_TEXTURE: {
@@ -874,10 +1017,8 @@ void ti_launch_compute_graph(TiRuntime runtime,
         uint32_t height = arg.argument.value.texture.extent.height;
         uint32_t depth = arg.argument.value.texture.extent.depth;
 
-        textures.emplace_back(
-            taichi::lang::Texture(devalloc, format, width, height, depth));
-        arg_map.emplace(std::make_pair(
-            arg.name, taichi::lang::aot::IValue::create(textures.back())));
+        taichi::lang::Texture texture(devalloc, format, width, height, depth);
+        graph->bind(slot, taichi::lang::aot::IValue::create(texture));
         break;
       }
       default: {
@@ -888,7 +1029,7 @@ void ti_launch_compute_graph(TiRuntime runtime,
       }
     }
   }
-  ((taichi::lang::aot::CompiledGraph *)compute_graph)->run(arg_map);
+  graph->run_bound();
   TI_CAPI_TRY_CATCH_END();
 }
 
@@ -906,3 +1047,29 @@ void ti_wait(TiRuntime runtime) {
   ((Runtime *)runtime)->wait();
   TI_CAPI_TRY_CATCH_END();
 }
+uint64_t ti_signal(TiRuntime runtime) {
+  uint64_t out = 0;
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL_RV(runtime);
+
+  out = ((Runtime *)runtime)->signal();
+  TI_CAPI_TRY_CATCH_END();
+  return out;
+}
+void ti_wait_for(TiRuntime runtime, uint64_t value) {
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL(runtime);
+
+  ((Runtime *)runtime)->wait_for(value);
+  TI_CAPI_TRY_CATCH_END();
+}
+
+void ti_get_memory_stats(TiRuntime runtime, TiMemoryStats *stats) {
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL(runtime);
+  TI_CAPI_ARGUMENT_NULL(stats);
+
+  Error err = ((Runtime *)runtime)->get_memory_stats(*stats);
+  err.set_last_error();
+  TI_CAPI_TRY_CATCH_END();
+}
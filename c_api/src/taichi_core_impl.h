@@ -1,4 +1,5 @@
 #pragma once
+#include <deque>
 #include <vector>
 #include <memory>
 #include <string>
@@ -129,14 +130,17 @@ class Runtime {
 
   [[deprecated("create_aot_module")]] virtual TiAotModule load_aot_module(
       const char *module_path) {
-    auto dir = taichi::io::VirtualDir::open(module_path);
+    std::shared_ptr<taichi::io::VirtualDir> dir =
+        taichi::io::VirtualDir::open(module_path);
     TiAotModule aot_module = TI_NULL_HANDLE;
-    Error err = create_aot_module(dir.get(), aot_module);
+    Error err = create_aot_module(dir, aot_module);
     err.set_last_error();
     return aot_module;
   }
-  virtual Error create_aot_module(const taichi::io::VirtualDir *dir,
-                                  TiAotModule &out) {
+  // |dir| can be kept by the module to load its kernels lazily.
+  virtual Error create_aot_module(
+      const std::shared_ptr<taichi::io::VirtualDir> &dir,
+      TiAotModule &out) {
     TI_NOT_IMPLEMENTED
   }
   virtual TiMemory allocate_memory(
@@ -171,9 +175,37 @@ class Runtime {
   }
   virtual void flush() = 0;
   virtual void wait() = 0;
+  // The runtimes that can't wait for a particular submission wait for all of
+  // them, so the values only have to increase.
+  virtual uint64_t signal() {
+    flush();
+    return ++num_signals_;
+  }
+  virtual void wait_for(uint64_t value) {
+    wait();
+  }
+
+  virtual Error get_memory_stats(TiMemoryStats &out) {
+    return Error(TI_ERROR_NOT_SUPPORTED, "get_memory_stats");
+  }
 
   class VulkanRuntime *as_vk();
   class MetalRuntime *as_mtl();
+
+  // Returns a copy of |devalloc| for the host context of a kernel launch,
+  // which stays valid until the next reset_devalloc_pool().
+  taichi::lang::DeviceAllocation *acquire_devalloc(
+      const taichi::lang::DeviceAllocation &devalloc);
+  void reset_devalloc_pool() {
+    num_used_devallocs_ = 0;
+  }
+
+ private:
+  // Reused by the launches, so that they allocate nothing in steady state.
+  // The elements of a deque keep their addresses when it grows.
+  std::deque<taichi::lang::DeviceAllocation> devalloc_pool_;
+  std::size_t num_used_devallocs_{0};
+  uint64_t num_signals_{0};
 };
 
 class AotModule {
@@ -4,11 +4,14 @@
 GfxRuntime::GfxRuntime(taichi::Arch arch) : Runtime(arch) {
 }
 
-Error GfxRuntime::create_aot_module(const taichi::io::VirtualDir *dir,
-                                    TiAotModule &out) {
+Error GfxRuntime::create_aot_module(
+    const std::shared_ptr<taichi::io::VirtualDir> &dir,
+    TiAotModule &out) {
   taichi::lang::gfx::AotModuleParams params{};
-  params.dir = dir;
+  params.shared_dir = dir;
   params.runtime = &get_gfx_runtime();
+  // Most apps only use a part of the kernels in a module.
+  params.enable_lazy_loading = true;
   std::unique_ptr<taichi::lang::aot::Module> aot_module =
       taichi::lang::aot::Module::load(arch, params);
   if (aot_module->is_corrupted()) {
@@ -33,6 +36,10 @@ Error GfxRuntime::create_aot_module(const taichi::io::VirtualDir *dir,
   out = (TiAotModule) new AotModule(*this, std::move(aot_module));
   return Error();
 }
+void GfxRuntime::free_memory(TiMemory devmem) {
+  get_gfx_runtime().invalidate_recorded_launches();
+  Runtime::free_memory(devmem);
+}
 void GfxRuntime::buffer_copy(const taichi::lang::DevicePtr &dst,
                              const taichi::lang::DevicePtr &src,
                              size_t size) {
@@ -62,3 +69,9 @@ void GfxRuntime::wait() {
   // Should be simply waiting for its fence to finish.
   get_gfx_runtime().synchronize();
 }
+uint64_t GfxRuntime::signal() {
+  return get_gfx_runtime().signal();
+}
+void GfxRuntime::wait_for(uint64_t value) {
+  get_gfx_runtime().wait_for(value);
+}
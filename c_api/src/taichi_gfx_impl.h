@@ -11,8 +11,10 @@ class GfxRuntime : public Runtime {
   GfxRuntime(taichi::Arch arch);
   virtual taichi::lang::gfx::GfxRuntime &get_gfx_runtime() = 0;
 
-  virtual Error create_aot_module(const taichi::io::VirtualDir *dir,
-                                  TiAotModule &out) override final;
+  virtual Error create_aot_module(
+      const std::shared_ptr<taichi::io::VirtualDir> &dir,
+      TiAotModule &out) override final;
+  virtual void free_memory(TiMemory devmem) override final;
   virtual void buffer_copy(const taichi::lang::DevicePtr &dst,
                            const taichi::lang::DevicePtr &src,
                            size_t size) override final;
@@ -29,4 +31,6 @@ class GfxRuntime : public Runtime {
       taichi::lang::ImageLayout layout) override final;
   virtual void flush() override final;
   virtual void wait() override final;
+  virtual uint64_t signal() override final;
+  virtual void wait_for(uint64_t value) override final;
 };
@@ -122,7 +122,9 @@ TiAotModule LlvmRuntime::load_aot_module(const char *module_path) {
 void LlvmRuntime::buffer_copy(const taichi::lang::DevicePtr &dst,
                               const taichi::lang::DevicePtr &src,
                               size_t size) {
-  TI_NOT_IMPLEMENTED;
+  // Issued on the stream of the calling thread, so that it is ordered with
+  // the kernel launches. ti_wait() waits for it.
+  executor_->copy_ndarray_async(dst, src, size);
 }
 
 void LlvmRuntime::flush() {
@@ -134,6 +136,17 @@ void LlvmRuntime::wait() {
   executor_->synchronize();
 }
 
+Error LlvmRuntime::get_memory_stats(TiMemoryStats &out) {
+  // The fields of AOT modules are not backed by SNodeTree instances, so only
+  // the totals are available.
+  auto stats = executor_->get_memory_stats({}, result_buffer);
+  out.snode_tree_bytes = stats.snode_tree_bytes;
+  out.runtime_requested_bytes = stats.runtime_requested_bytes;
+  out.cached_allocated_bytes = stats.cached_allocated_bytes;
+  out.cached_reserved_bytes = stats.cached_reserved_bytes;
+  return Error();
+}
+
 }  // namespace capi
 
 // function.export_cpu_runtime
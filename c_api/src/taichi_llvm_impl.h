@@ -37,6 +37,8 @@ class LlvmRuntime : public Runtime {
 
   void wait() override;
 
+  Error get_memory_stats(TiMemoryStats &out) override;
+
  private:
   taichi::uint64 *result_buffer{nullptr};
   std::unique_ptr<taichi::lang::LlvmRuntimeExecutor> executor_{nullptr};
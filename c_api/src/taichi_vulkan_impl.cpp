@@ -112,6 +112,14 @@ taichi::lang::gfx::GfxRuntime &VulkanRuntimeOwned::get_gfx_runtime() {
   return gfx_runtime_;
 }
 
+TiMemory VulkanRuntime::allocate_memory(
+    const taichi::lang::Device::AllocParams &params) {
+  // `TiMemory`s can be exported with `ti_export_vulkan_memory`, which has no
+  // way to express an offset in a shared buffer.
+  taichi::lang::DeviceAllocation devalloc =
+      get_vk().allocate_dedicated_memory(params);
+  return devalloc2devmem(*this, devalloc);
+}
 TiImage VulkanRuntime::allocate_image(const taichi::lang::ImageParams &params) {
   taichi::lang::DeviceAllocation devalloc =
       get_gfx_runtime().create_image(params);
@@ -337,4 +345,55 @@ void ti_export_vulkan_image(TiRuntime runtime,
   TI_CAPI_TRY_CATCH_END();
 }
 
+void ti_submit_vulkan_ext(TiRuntime runtime,
+                          const TiVulkanSubmitInfo *submit_info) {
+  TI_CAPI_TRY_CATCH_BEGIN();
+  TI_CAPI_ARGUMENT_NULL(runtime);
+  TI_CAPI_ARGUMENT_NULL(submit_info);
+  if (submit_info->wait_semaphore_count > 0) {
+    TI_CAPI_ARGUMENT_NULL(submit_info->wait_semaphores);
+  }
+  if (submit_info->signal_semaphore_count > 0) {
+    TI_CAPI_ARGUMENT_NULL(submit_info->signal_semaphores);
+  }
+  TI_CAPI_INVALID_INTEROP_ARCH(((Runtime *)runtime)->arch, vulkan);
+
+  VulkanRuntime *runtime2 = ((Runtime *)runtime)->as_vk();
+
+  // Either both or none of the value arrays are given, unless there is
+  // nothing to wait for or to signal.
+  const bool timeline = submit_info->wait_semaphore_values != nullptr ||
+                        submit_info->signal_semaphore_values != nullptr;
+  if (timeline) {
+    if (submit_info->wait_semaphore_count > 0) {
+      TI_CAPI_ARGUMENT_NULL(submit_info->wait_semaphore_values);
+    }
+    if (submit_info->signal_semaphore_count > 0) {
+      TI_CAPI_ARGUMENT_NULL(submit_info->signal_semaphore_values);
+    }
+  }
+  std::vector<std::pair<VkSemaphore, uint64_t>> waits;
+  for (uint32_t i = 0; i < submit_info->wait_semaphore_count; ++i) {
+    waits.emplace_back(
+        submit_info->wait_semaphores[i],
+        timeline ? submit_info->wait_semaphore_values[i] : 0);
+  }
+  std::vector<std::pair<VkSemaphore, uint64_t>> signals;
+  for (uint32_t i = 0; i < submit_info->signal_semaphore_count; ++i) {
+    signals.emplace_back(
+        submit_info->signal_semaphores[i],
+        timeline ? submit_info->signal_semaphore_values[i] : 0);
+  }
+
+  // Taichi records and submits the commands of every thread on its own
+  // stream, all of which share the queue of the runtime.
+  auto *stream = static_cast<taichi::lang::vulkan::VulkanStream *>(
+      runtime2->get_vk().get_compute_stream());
+  stream->add_external_semaphores(waits, signals, timeline);
+  // Always submits, even without pending commands, so the semaphores are
+  // consumed.
+  runtime2->flush();
+  TI_CAPI_TRY_CATCH_END();
+}
+
 #endif  // TI_WITH_VULKAN
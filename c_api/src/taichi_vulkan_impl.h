@@ -17,6 +17,8 @@ class VulkanRuntime : public GfxRuntime {
   VulkanRuntime();
 
   taichi::lang::vulkan::VulkanDevice &get_vk();
+  virtual TiMemory allocate_memory(
+      const taichi::lang::Device::AllocParams &params) override final;
   virtual TiImage allocate_image(
       const taichi::lang::ImageParams &params) override final;
   virtual void free_image(TiImage image) override final;
@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "c_api_test_utils.h"
 #include "taichi/cpp/taichi.hpp"
@@ -92,6 +94,16 @@ void texture_aot_kernel_test(TiArch arch) {
 
   ti::AotModule aot_mod = runtime.load_aot_module(aot_mod_ss.str());
 
+  // Warm up the pipelines as an app would behind a loading screen.
+  aot_mod.prefetch_kernels();
+  TiAotModulePrefetchProgress progress{};
+  do {
+    std::this_thread::yield();
+    progress = aot_mod.get_prefetch_progress();
+  } while (progress.prefetched_kernel_count < progress.kernel_count);
+  EXPECT_GE(progress.kernel_count, 3);
+  capi::utils::check_runtime_error(runtime);
+
   ti::Kernel k_run0 = aot_mod.get_kernel("run0");
   ti::Kernel k_run1 = aot_mod.get_kernel("run1");
   ti::Kernel k_run2 = aot_mod.get_kernel("run2");
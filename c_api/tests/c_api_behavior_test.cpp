@@ -500,3 +500,71 @@ TEST_F(CapiTest, TestBehaviorGetCgraphVulkan) {
 
   test_behavior_get_cgraph_impl(TI_ARCH_VULKAN);
 }
+
+TEST_F(CapiTest, TestBehaviorLaunchKernels) {
+  auto inner = [this](TiArch arch) {
+    if (!ti::is_arch_available(arch)) {
+      TI_WARN("arch {} is not supported, so the test is skipped", arch);
+      return;
+    }
+
+    ti::Runtime runtime(arch);
+
+    // Attempt to launch with a null runtime.
+    ti_launch_kernels(TI_NULL_HANDLE, 0, nullptr);
+    EXPECT_TAICHI_ERROR(TI_ERROR_ARGUMENT_NULL);
+
+    // An empty batch is a no-op.
+    ti_launch_kernels(runtime, 0, nullptr);
+    ASSERT_TAICHI_SUCCESS();
+
+    // Attempt to launch a null batch.
+    ti_launch_kernels(runtime, 1, nullptr);
+    EXPECT_TAICHI_ERROR(TI_ERROR_ARGUMENT_NULL);
+
+    // Attempt to launch a null kernel.
+    TiKernelLaunch launch{};
+    ti_launch_kernels(runtime, 1, &launch);
+    EXPECT_TAICHI_ERROR(TI_ERROR_ARGUMENT_NULL);
+  };
+
+  inner(TI_ARCH_VULKAN);
+}
+
+TEST_F(CapiTest, TestBehaviorSignalAndWaitFor) {
+  auto inner = [this](TiArch arch) {
+    if (!ti::is_arch_available(arch)) {
+      TI_WARN("arch {} is not supported, so the test is skipped", arch);
+      return;
+    }
+
+    ti::Runtime runtime(arch);
+    ti::Memory src = runtime.allocate_memory(2048);
+    ti::Memory dst = runtime.allocate_memory(2048);
+
+    // Attempt to signal with a null runtime.
+    ti_signal(TI_NULL_HANDLE);
+    EXPECT_TAICHI_ERROR(TI_ERROR_ARGUMENT_NULL);
+
+    src.slice(0, 1024).copy_to(dst.slice(0, 1024));
+    uint64_t first = runtime.signal();
+    ASSERT_TAICHI_SUCCESS();
+    src.slice(1024, 1024).copy_to(dst.slice(1024, 1024));
+    uint64_t second = runtime.signal();
+    ASSERT_TAICHI_SUCCESS();
+    EXPECT_LT(first, second);
+
+    // The values may be waited for in any order.
+    runtime.wait_for(first);
+    ASSERT_TAICHI_SUCCESS();
+    runtime.wait_for(second);
+    ASSERT_TAICHI_SUCCESS();
+    runtime.wait_for(first);
+    ASSERT_TAICHI_SUCCESS();
+
+    ti_wait_for(TI_NULL_HANDLE, second);
+    EXPECT_TAICHI_ERROR(TI_ERROR_ARGUMENT_NULL);
+  };
+
+  inner(TI_ARCH_VULKAN);
+}
@@ -86,4 +86,48 @@ TEST_F(CapiTest, AotTestVulkanTextureInterop) {
   }
 }
 
+TEST_F(CapiTest, TestVulkanSubmitSemaphores) {
+  if (!ti::is_arch_available(TI_ARCH_VULKAN)) {
+    return;
+  }
+  ti::Runtime runtime(TI_ARCH_VULKAN);
+
+  TiVulkanRuntimeInteropInfo vrii{};
+  ti_export_vulkan_runtime(runtime, &vrii);
+  auto get_device_proc_addr = (PFN_vkGetDeviceProcAddr)
+      vrii.get_instance_proc_addr(vrii.instance, "vkGetDeviceProcAddr");
+  auto create_semaphore = (PFN_vkCreateSemaphore)get_device_proc_addr(
+      vrii.device, "vkCreateSemaphore");
+  auto destroy_semaphore = (PFN_vkDestroySemaphore)get_device_proc_addr(
+      vrii.device, "vkDestroySemaphore");
+
+  VkSemaphoreCreateInfo sci{};
+  sci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  VkSemaphore semaphore = VK_NULL_HANDLE;
+  ASSERT_EQ(create_semaphore(vrii.device, &sci, nullptr, &semaphore),
+            VK_SUCCESS);
+
+  // The first submission signals what the second one waits for, as an engine
+  // would between its own submissions.
+  TiVulkanSubmitInfo signal_info{};
+  signal_info.signal_semaphore_count = 1;
+  signal_info.signal_semaphores = &semaphore;
+  ti_submit_vulkan_ext(runtime, &signal_info);
+  ASSERT_TAICHI_SUCCESS();
+
+  TiVulkanSubmitInfo wait_info{};
+  wait_info.wait_semaphore_count = 1;
+  wait_info.wait_semaphores = &semaphore;
+  ti_submit_vulkan_ext(runtime, &wait_info);
+  ASSERT_TAICHI_SUCCESS();
+
+  runtime.wait();
+  destroy_semaphore(vrii.device, semaphore, nullptr);
+
+  TiVulkanSubmitInfo bad_info{};
+  bad_info.wait_semaphore_count = 1;
+  ti_submit_vulkan_ext(runtime, &bad_info);
+  EXPECT_TAICHI_ERROR(TI_ERROR_ARGUMENT_NULL);
+}
+
 #endif  // TI_WITH_VULKAN
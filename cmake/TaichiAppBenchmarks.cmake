@@ -0,0 +1,28 @@
+cmake_minimum_required(VERSION 3.0)
+
+set(APP_BENCHMARKS_NAME taichi_app_benchmarks)
+
+file(GLOB_RECURSE TAICHI_APP_BENCHMARKS_SOURCE
+"benchmarks/app/*.cpp"
+)
+
+add_executable(${APP_BENCHMARKS_NAME} ${TAICHI_APP_BENCHMARKS_SOURCE})
+if (WIN32)
+    # Output the executable to build/ instead of build/Debug/...
+    set(APP_BENCHMARKS_OUTPUT_DIR "${CMAKE_CURRENT_SOURCE_DIR}/build")
+    set_target_properties(${APP_BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${APP_BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${APP_BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_DEBUG ${APP_BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${APP_BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_RELEASE ${APP_BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${APP_BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_MINSIZEREL ${APP_BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${APP_BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_RELWITHDEBINFO ${APP_BENCHMARKS_OUTPUT_DIR})
+endif()
+
+# The scenarios only use the C API, like an application would.
+target_link_libraries(${APP_BENCHMARKS_NAME} PRIVATE taichi_c_api)
+target_link_libraries(${APP_BENCHMARKS_NAME} PRIVATE ${CMAKE_DL_LIBS})
+
+target_include_directories(${APP_BENCHMARKS_NAME}
+  PRIVATE
+    ${PROJECT_SOURCE_DIR}
+    ${PROJECT_SOURCE_DIR}/c_api/include
+  )
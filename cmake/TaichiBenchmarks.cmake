@@ -0,0 +1,43 @@
+cmake_minimum_required(VERSION 3.0)
+
+set(BENCHMARKS_NAME taichi_cpp_benchmarks)
+
+file(GLOB_RECURSE TAICHI_BENCHMARKS_SOURCE
+"benchmarks/cpp/*.cpp"
+)
+
+add_executable(${BENCHMARKS_NAME} ${TAICHI_BENCHMARKS_SOURCE})
+if (WIN32)
+    # Output the executable to build/ instead of build/Debug/...
+    set(BENCHMARKS_OUTPUT_DIR "${CMAKE_CURRENT_SOURCE_DIR}/build")
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_DEBUG ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_RELEASE ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_MINSIZEREL ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_RELWITHDEBINFO ${BENCHMARKS_OUTPUT_DIR})
+endif()
+
+target_link_libraries(${BENCHMARKS_NAME} PRIVATE taichi_core)
+
+if (TI_WITH_VULKAN OR TI_WITH_OPENGL OR TI_WITH_METAL)
+  target_link_libraries(${BENCHMARKS_NAME} PRIVATE gfx_runtime)
+endif()
+
+if (TI_WITH_VULKAN)
+  target_link_libraries(${BENCHMARKS_NAME} PRIVATE vulkan_rhi)
+endif()
+
+if (TI_WITH_OPENGL)
+  target_link_libraries(${BENCHMARKS_NAME} PRIVATE opengl_rhi)
+endif()
+
+if (TI_WITH_METAL)
+  target_link_libraries(${BENCHMARKS_NAME} PRIVATE metal_rhi)
+endif()
+
+target_include_directories(${BENCHMARKS_NAME}
+  PRIVATE
+    ${PROJECT_SOURCE_DIR}
+    ${PROJECT_SOURCE_DIR}/external/spdlog/include
+    ${PROJECT_SOURCE_DIR}/external/eigen
+  )
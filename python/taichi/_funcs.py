@@ -1,10 +1,13 @@
 import math
 
+from taichi._lib import core as _ti_core
 from taichi.lang import impl, ops
+from taichi.lang.enums import AutodiffMode
+from taichi.lang.expr import Expr, make_expr_group
 from taichi.lang.impl import get_runtime, grouped, static
 from taichi.lang.kernel_impl import func
 from taichi.lang.matrix import Matrix, Vector
-from taichi.types import f32, f64
+from taichi.types import f32, f64, i32, i64
 from taichi.types.annotations import template
 
 
@@ -148,6 +151,36 @@ def _svd2d(A, dt):
     return U, Matrix([[s1, ops.cast(0, dt)], [ops.cast(0, dt), s2]], dt=dt), V
 
 
+def _use_svd3d_intrinsic():
+    # The runtime function is not differentiable, so gradient kernels keep
+    # expanding the SVD inline.
+    return impl.current_cfg().arch in [
+        _ti_core.Arch.x64, _ti_core.Arch.arm64, _ti_core.Arch.cuda
+    ] and get_runtime().current_kernel.autodiff_mode == AutodiffMode.NONE
+
+
+def _svd3d_intrinsic(A, dt, iters):
+    """Call the sifakis_svd_* runtime function instead of expanding the SVD
+    into ~800 statements, which keeps compilation of SVD-heavy kernels fast.
+    """
+    args = [ops.cast(A[i, j], dt) for i in range(3) for j in range(3)]
+    if dt == f32:
+        func_name = "sifakis_svd_f32"
+        args.append(Expr(iters, dtype=i32))
+    else:
+        func_name = "sifakis_svd_f64"
+        args.append(Expr(iters, dtype=i64))
+    rets = _ti_core.insert_internal_func_call(func_name,
+                                              make_expr_group(args), False,
+                                              dt)
+    return [
+        impl.call_internal(f"composite_extract_{i}",
+                           rets,
+                           with_runtime_context=False,
+                           ret_type=dt) for i in range(21)
+    ]
+
+
 def _svd3d(A, dt, iters=None):
     """Perform singular value decomposition (A=USV^T) for 3x3 matrix.
 
@@ -168,7 +201,9 @@ def _svd3d(A, dt, iters=None):
             iters = 5
         else:
             iters = 8
-    if dt == f32:
+    if _use_svd3d_intrinsic():
+        rets = _svd3d_intrinsic(A, dt, iters)
+    elif dt == f32:
         rets = get_runtime().compiling_callable.ast_builder().sifakis_svd_f32(
             A.ptr, iters)
     else:
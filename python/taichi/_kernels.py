@@ -9,10 +9,10 @@ from taichi.lang.impl import grouped, static, static_assert
 from taichi.lang.kernel_impl import func, kernel
 from taichi.lang.misc import loop_config
 from taichi.lang.simt import block, warp
-from taichi.lang.snode import deactivate
+from taichi.lang.snode import activate, deactivate
 from taichi.types import ndarray_type, texture_type, vector
 from taichi.types.annotations import template
-from taichi.types.primitive_types import f16, f32, f64, i32, u8
+from taichi.types.primitive_types import f16, f32, f64, i32, u8, u32
 
 from taichi.math import vec3
 
@@ -126,6 +126,46 @@ def ext_arr_to_tensor(arr: ndarray_type.ndarray(), tensor: template()):
         tensor[I] = arr[I]
 
 
+@kernel
+def tensors_to_ext_arr(_vars: template(), offsets: template(),
+                       strides: template(), arr: ndarray_type.ndarray()):
+    for k in static(range(len(_vars))):
+        for I in grouped(ScalarField(_vars[k])):
+            j = 0
+            for d in static(range(len(ScalarField(_vars[k]).shape))):
+                j = j * ScalarField(_vars[k]).shape[d] + I[d]
+            arr[offsets[k] + j * strides[k]] = ScalarField(_vars[k])[I]
+
+
+@kernel
+def ext_arr_to_tensors(arr: ndarray_type.ndarray(), _vars: template(),
+                       offsets: template(), strides: template()):
+    for k in static(range(len(_vars))):
+        for I in grouped(ScalarField(_vars[k])):
+            j = 0
+            for d in static(range(len(ScalarField(_vars[k]).shape))):
+                j = j * ScalarField(_vars[k]).shape[d] + I[d]
+            ScalarField(_vars[k])[I] = arr[offsets[k] + j * strides[k]]
+
+
+@kernel
+def tensor_rows_to_ext_arr(tensor: template(), begin: i32,
+                           arr: ndarray_type.ndarray()):
+    for I in grouped(arr):
+        J = I
+        J[0] += begin
+        arr[I] = tensor[J]
+
+
+@kernel
+def ext_arr_to_tensor_rows(arr: ndarray_type.ndarray(), tensor: template(),
+                           begin: i32):
+    for I in grouped(arr):
+        J = I
+        J[0] += begin
+        tensor[J] = arr[I]
+
+
 @kernel
 def ndarray_to_ndarray(ndarray: ndarray_type.ndarray(),
                        other: ndarray_type.ndarray()):
@@ -255,6 +295,33 @@ def snode_deactivate_dynamic(b: template()):
         deactivate(b, I)
 
 
+@kernel
+def snode_activate_cells(b: template(), indices: ndarray_type.ndarray()):
+    for i in range(indices.shape[0]):
+        activate(b, [indices[i, k] for k in static(range(len(b.shape)))])
+
+
+@kernel
+def snode_deactivate_cells(b: template(), indices: ndarray_type.ndarray()):
+    for i in range(indices.shape[0]):
+        deactivate(b, [indices[i, k] for k in static(range(len(b.shape)))])
+
+
+@kernel
+def scatter_to_field(field: template(), indices: ndarray_type.ndarray(),
+                     values: ndarray_type.ndarray()):
+    for i in range(indices.shape[0]):
+        field[indices[i]] = values[i]
+
+
+@kernel
+def move_field_entries(field: template(), moves: ndarray_type.ndarray()):
+    # A move may read an entry an earlier one wrote.
+    loop_config(serialize=True)
+    for i in range(moves.shape[0]):
+        field[moves[i, 1]] = field[moves[i, 0]]
+
+
 @kernel
 def load_texture_from_numpy(tex: texture_type.rw_texture(num_dimensions=2,
                                                          fmt=Format.rgba8u,
@@ -384,3 +451,128 @@ def blit_from_field_to_field(
         dst: template(), src: template(), offset: i32, size: i32):
     for i in range(size):
         dst[i + offset] = src[i]
+
+
+# Device-wide primitives on 1D ndarrays (see taichi.algorithms). Each thread
+# processes a tile of consecutive elements in order, which keeps the results
+# stable and only relies on features of every backend.
+@kernel
+def tile_reduce_add(src: ndarray_type.ndarray(), n: i32, tile: i32,
+                    partials: ndarray_type.ndarray(), dtype: template()):
+    for t in range(partials.shape[0]):
+        acc = ops.cast(0, dtype)
+        for k in range(t * tile, ops.min(n, (t + 1) * tile)):
+            acc += src[k]
+        partials[t] = acc
+
+
+@kernel
+def tile_scan_add(src: ndarray_type.ndarray(), dst: ndarray_type.ndarray(),
+                  n: i32, tile: i32, partials: ndarray_type.ndarray(),
+                  inclusive: template()):
+    # |partials| holds the exclusive prefix sums of the tiles.
+    for t in range(partials.shape[0]):
+        acc = partials[t]
+        for k in range(t * tile, ops.min(n, (t + 1) * tile)):
+            val = src[k]
+            if static(inclusive):
+                acc += val
+                dst[k] = acc
+            else:
+                dst[k] = acc
+                acc += val
+
+
+@func
+def radix_sort_digit(key, shift, dtype: template()):
+    # Maps the key to an unsigned integer of the same order.
+    bits = ops.cast(0, u32)
+    sign = ops.cast(1, u32) << ops.cast(31, u32)
+    if static(dtype == f32):
+        bits = ops.bit_cast(key, u32)
+        if (bits & sign) != ops.cast(0, u32):
+            bits = ~bits
+        else:
+            bits |= sign
+    else:
+        bits = ops.cast(key, u32)
+        if static(dtype == i32):
+            bits ^= sign
+    return ops.cast((bits >> ops.cast(shift, u32)) & ops.cast(15, u32), i32)
+
+
+@kernel
+def radix_sort_count(keys: ndarray_type.ndarray(), n: i32, tile: i32,
+                     shift: i32, counts: ndarray_type.ndarray(),
+                     dtype: template()):
+    # counts[digit * num_tiles + t] is the number of keys of tile t with this
+    # digit, so that the exclusive scan of |counts| gives where they go.
+    num_tiles = (n + tile - 1) // tile
+    for t in range(num_tiles):
+        for k in range(t * tile, ops.min(n, (t + 1) * tile)):
+            digit = radix_sort_digit(keys[k], shift, dtype)
+            counts[digit * num_tiles + t] += 1
+
+
+@kernel
+def radix_sort_scatter(keys: ndarray_type.ndarray(),
+                       values: ndarray_type.ndarray(),
+                       keys_out: ndarray_type.ndarray(),
+                       values_out: ndarray_type.ndarray(), n: i32, tile: i32,
+                       shift: i32, offsets: ndarray_type.ndarray(),
+                       dtype: template(), has_values: template()):
+    num_tiles = (n + tile - 1) // tile
+    for t in range(num_tiles):
+        for k in range(t * tile, ops.min(n, (t + 1) * tile)):
+            key = keys[k]
+            digit = radix_sort_digit(key, shift, dtype)
+            # Only this thread updates the offsets of its tile.
+            pos = ops.atomic_add(offsets[digit * num_tiles + t], 1)
+            keys_out[pos] = key
+            if static(has_values):
+                values_out[pos] = values[k]
+
+
+@kernel
+def compact_scatter(src: ndarray_type.ndarray(), flags: ndarray_type.ndarray(),
+                    positions: ndarray_type.ndarray(),
+                    dst: ndarray_type.ndarray(),
+                    count: ndarray_type.ndarray()):
+    n = src.shape[0]
+    for i in range(n):
+        if flags[i] != 0:
+            dst[positions[i]] = src[i]
+        if i == n - 1:
+            count[0] = positions[i] + ops.cast(flags[i] != 0, i32)
+
+
+@kernel
+def segmented_reduce_kernel(src: ndarray_type.ndarray(),
+                            offsets: ndarray_type.ndarray(),
+                            dst: ndarray_type.ndarray(), op: template(),
+                            identity: template(), dtype: template()):
+    for s in range(dst.shape[0]):
+        acc = ops.cast(identity, dtype)
+        for k in range(offsets[s], offsets[s + 1]):
+            if static(op == 'add'):
+                acc += src[k]
+            elif static(op == 'min'):
+                acc = ops.min(acc, src[k])
+            else:
+                acc = ops.max(acc, src[k])
+        dst[s] = acc
+
+
+@kernel
+def histogram_kernel(src: ndarray_type.ndarray(),
+                     counts: ndarray_type.ndarray(), lo: f32, hi: f32,
+                     binned: template()):
+    num_bins = counts.shape[0]
+    for i in range(src.shape[0]):
+        b = 0
+        if static(binned):
+            b = ops.cast(src[i], i32)
+        else:
+            b = ops.floor((src[i] - lo) / (hi - lo) * num_bins, i32)
+        if 0 <= b < num_bins:
+            counts[b] += 1
@@ -64,37 +64,39 @@ class FieldsBuilder:
                 """'deactivate_all()' would do nothing if FieldsBuilder is not finalized"""
             )
 
-    def dense(self, indices: Union[Sequence[_Axis], _Axis],
-              dimensions: Union[Sequence[int], int]):
+    def dense(self,
+              indices: Union[Sequence[_Axis], _Axis],
+              dimensions: Union[Sequence[int], int],
+              morton: bool = False):
         """Same as :func:`taichi.lang.snode.SNode.dense`"""
         self._check_not_finalized()
         self.empty = False
-        return self.root.dense(indices, dimensions)
+        return self.root.dense(indices, dimensions, morton)
 
     def pointer(self, indices: Union[Sequence[_Axis], _Axis],
                 dimensions: Union[Sequence[int], int]):
         """Same as :func:`taichi.lang.snode.SNode.pointer`"""
-        if not _ti_core.is_extension_supported(impl.current_cfg().arch,
-                                               _ti_core.Extension.sparse):
-            raise TaichiRuntimeError(
-                "Pointer SNode is not supported on this backend.")
+        snode.check_sparse_supported("Pointer")
         self._check_not_finalized()
         self.empty = False
         return self.root.pointer(indices, dimensions)
 
-    def _hash(self, indices, dimensions):
+    def hash(self,
+             indices: Union[Sequence[_Axis], _Axis],
+             dimensions: Union[Sequence[int], int],
+             table_size: Optional[int] = None):
         """Same as :func:`taichi.lang.snode.SNode.hash`"""
-        raise NotImplementedError()
+        snode.check_sparse_supported("Hash", gfx=False)
+        self._check_not_finalized()
+        self.empty = False
+        return self.root.hash(indices, dimensions, table_size)
 
     def dynamic(self,
                 index: Union[Sequence[_Axis], _Axis],
                 dimension: Union[Sequence[int], int],
                 chunk_size: Optional[int] = None):
         """Same as :func:`taichi.lang.snode.SNode.dynamic`"""
-        if not _ti_core.is_extension_supported(impl.current_cfg().arch,
-                                               _ti_core.Extension.sparse):
-            raise TaichiRuntimeError(
-                "Dynamic SNode is not supported on this backend.")
+        snode.check_sparse_supported("Dynamic")
         self._check_not_finalized()
         self.empty = False
         return self.root.dynamic(index, dimension, chunk_size)
@@ -102,10 +104,7 @@ class FieldsBuilder:
     def bitmasked(self, indices: Union[Sequence[_Axis], _Axis],
                   dimensions: Union[Sequence[int], int]):
         """Same as :func:`taichi.lang.snode.SNode.bitmasked`"""
-        if not _ti_core.is_extension_supported(impl.current_cfg().arch,
-                                               _ti_core.Extension.sparse):
-            raise TaichiRuntimeError(
-                "Bitmasked SNode is not supported on this backend.")
+        snode.check_sparse_supported("Bitmasked")
         self._check_not_finalized()
         self.empty = False
         return self.root.bitmasked(indices, dimensions)
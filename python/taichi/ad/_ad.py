@@ -394,6 +394,7 @@ class FwdMode:
         self.loss = loss
         self.param = param
         self.seed = seed
+        self.lane_seeds = None
         self.clear_gradients = clear_gradients
 
     def __enter__(self):
@@ -434,23 +435,35 @@ class FwdMode:
                     '      seed = [0, 0, 1] indicates compute derivative respect to the third element of `x`.'
                     '      seed = [1, 1, 1] indicates compute the sum of derivatives respect to all three element of `x`, i.e., Jacobian-vector product(Jvp) for each element in `loss`'
                 )
+
+        # A list of seeds computes one Jvp per tangent lane, in `loss.duals`.
+        if isinstance(self.seed[0], (list, tuple)):
+            self.lane_seeds = self.seed
+            if len(self.lane_seeds) > len(self.param.duals):
+                raise RuntimeError(
+                    f'{len(self.lane_seeds)} seeds are given but the fields only have {len(self.param.duals)} dual lanes.'
+                    ' Set `forward_ad_lanes` in `ti.init()` before creating the fields.'
+                )
         else:
-            assert parameters_shape_flatten == len(self.seed)
+            self.lane_seeds = [self.seed]
+        for seed in self.lane_seeds:
+            assert parameters_shape_flatten == len(seed)
 
         # Clear gradients
         if self.clear_gradients:
             clear_all_gradients(gradient_type=SNodeGradType.DUAL)
 
         # Set seed for each variable
-        if len(self.seed) == 1:
-            if len(self.param.shape) == 0:
-                # e.g., x= ti.field(float, shape = ())
-                self.param.dual[None] = 1.0 * self.seed[0]
+        for dual, seed in zip(self.param.duals, self.lane_seeds):
+            if len(seed) == 1:
+                if len(self.param.shape) == 0:
+                    # e.g., x= ti.field(float, shape = ())
+                    dual[None] = 1.0 * seed[0]
+                else:
+                    # e.g., ti.root.dense(ti.i, 1).place(x.dual)
+                    dual[0] = 1.0 * seed[0]
             else:
-                # e.g., ti.root.dense(ti.i, 1).place(x.dual)
-                self.param.dual[0] = 1.0 * self.seed[0]
-        else:
-            self.param.dual.from_numpy(np.array(self.seed, dtype=np.float32))
+                dual.from_numpy(np.array(seed, dtype=np.float32))
 
         # Attach the context manager to the runtime
         self.runtime.fwd_mode_manager = self
@@ -474,15 +487,16 @@ class FwdMode:
 
     def clear_seed(self):
         # clear seed values
-        if len(self.seed) == 1:
-            if len(self.param.shape) == 0:
-                # e.g., x= ti.field(float, shape = ())
-                self.param.dual[None] = 0.0
+        for dual, seed in zip(self.param.duals, self.lane_seeds):
+            if len(seed) == 1:
+                if len(self.param.shape) == 0:
+                    # e.g., x= ti.field(float, shape = ())
+                    dual[None] = 0.0
+                else:
+                    # e.g., ti.root.dense(ti.i, 1).place(x.dual)
+                    dual[0] = 0.0
             else:
-                # e.g., ti.root.dense(ti.i, 1).place(x.dual)
-                self.param.dual[0] = 0.0
-        else:
-            self.param.dual.fill(0)
+                dual.fill(0)
 
 
 __all__ = [
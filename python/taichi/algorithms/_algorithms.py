@@ -1,11 +1,17 @@
-from taichi._kernels import (blit_from_field_to_field, scan_add_inclusive,
-                             sort_stage, uniform_add, warp_shfl_up_i32)
-from taichi.lang.impl import current_cfg, field
+import numpy as np
+from taichi._kernels import (blit_from_field_to_field, compact_scatter,
+                             histogram_kernel, radix_sort_count,
+                             radix_sort_scatter, scan_add_inclusive,
+                             segmented_reduce_kernel, sort_stage,
+                             tile_reduce_add, tile_scan_add, uniform_add,
+                             warp_shfl_up_i32)
+from taichi.lang.impl import current_cfg, field, ndarray
 from taichi.lang.kernel_impl import data_oriented
 from taichi.lang.misc import cuda, vulkan
 from taichi.lang.runtime_ops import sync
 from taichi.lang.simt import subgroup
-from taichi.types.primitive_types import i32
+from taichi.lang.util import to_numpy_type
+from taichi.types.primitive_types import f32, i32, u32
 
 
 def parallel_sort(keys, values=None):
@@ -97,4 +103,166 @@ class PrefixSumExecutor:
         blit_from_field_to_field(input_arr, self.large_arr, 0, length)
 
 
-__all__ = ['parallel_sort', 'PrefixSumExecutor']
+# The number of consecutive elements each thread processes in the primitives
+# below.
+_TILE = 64
+_RADIX_BITS = 4
+
+
+def _num_tiles(n):
+    return (n + _TILE - 1) // _TILE
+
+
+def scan(src, dst=None, inclusive=True):
+    """Computes the prefix sums of a 1D ndarray.
+
+    Args:
+        src (Ndarray): The values.
+        dst (Ndarray): Where the prefix sums go, ``src`` by default. Has the
+            same shape and dtype as ``src``.
+        inclusive (bool): Whether ``dst[i]`` includes ``src[i]``.
+
+    Example::
+
+        >>> x = ti.ndarray(ti.i32, 4)
+        >>> x.from_numpy(np.array([1, 2, 3, 4], dtype=np.int32))
+        >>> ti.algorithms.scan(x, inclusive=False)  # [0, 1, 3, 6]
+    """
+    if dst is None:
+        dst = src
+    assert dst.shape == src.shape and dst.dtype == src.dtype
+    n = src.shape[0]
+    # The prefix sums of the tiles, which are scanned recursively.
+    partials = ndarray(src.dtype, max(_num_tiles(n), 1))
+    if _num_tiles(n) > 1:
+        tile_reduce_add(src, n, _TILE, partials, src.dtype)
+        scan(partials, inclusive=False)
+    else:
+        partials.fill(0)
+    tile_scan_add(src, dst, n, _TILE, partials, inclusive)
+
+
+def radix_sort(keys, values=None, key_bits=32):
+    """Sorts a 1D ndarray of keys, and optionally a 1D ndarray of values along
+    with them, with a stable LSD radix sort.
+
+    Args:
+        keys (Ndarray): The keys, of type ``ti.i32``, ``ti.u32`` or
+            ``ti.f32``.
+        values (Ndarray): The values, of any type.
+        key_bits (int): The number of low bits the keys differ in. Sorting
+            e.g. the indices of the cells of a grid with ``2 ** 20`` cells
+            only needs 20 bits. Less than 32 bits only work for non-negative
+            keys.
+
+    Example::
+
+        >>> # Sorts the particles by cell.
+        >>> ti.algorithms.radix_sort(cell_of_particle, particle_ids, 20)
+    """
+    if keys.dtype not in (i32, u32, f32):
+        raise ValueError(
+            f'Keys of type {keys.dtype} are not supported by radix sort')
+    n = keys.shape[0]
+    if values is not None:
+        assert values.shape == keys.shape
+    if n <= 1:
+        return
+    num_tiles = _num_tiles(n)
+    counts = ndarray(i32, num_tiles << _RADIX_BITS)
+    buffers = [(keys, values),
+               (ndarray(keys.dtype, n),
+                None if values is None else ndarray(values.dtype, n))]
+    num_passes = (key_bits + _RADIX_BITS - 1) // _RADIX_BITS
+    for i in range(num_passes):
+        (src_keys, src_values), (dst_keys, dst_values) = buffers
+        shift = i * _RADIX_BITS
+        counts.fill(0)
+        radix_sort_count(src_keys, n, _TILE, shift, counts, keys.dtype)
+        scan(counts, inclusive=False)
+        if values is None:
+            radix_sort_scatter(src_keys, src_keys, dst_keys, dst_keys, n,
+                               _TILE, shift, counts, keys.dtype, False)
+        else:
+            radix_sort_scatter(src_keys, src_values, dst_keys, dst_values, n,
+                               _TILE, shift, counts, keys.dtype, True)
+        buffers.reverse()
+    if num_passes % 2:
+        keys.copy_from(buffers[0][0])
+        if values is not None:
+            values.copy_from(buffers[0][1])
+
+
+def compact(src, flags, dst):
+    """Copies the elements of a 1D ndarray whose flag is nonzero to the
+    beginning of ``dst``, in order.
+
+    Args:
+        src (Ndarray): The values.
+        flags (Ndarray): A ``ti.i32`` flag for each value, 0 or 1.
+        dst (Ndarray): Where the kept values go, with room for all of them.
+
+    Returns:
+        int: The number of values that are kept.
+    """
+    assert flags.shape == src.shape and flags.dtype == i32
+    n = src.shape[0]
+    if n == 0:
+        return 0
+    positions = ndarray(i32, n)
+    scan(flags, positions, inclusive=False)
+    count = ndarray(i32, 1)
+    compact_scatter(src, flags, positions, dst, count)
+    return int(count[0])
+
+
+def segmented_reduce(src, offsets, dst, op='add'):
+    """Reduces each segment of a 1D ndarray.
+
+    Args:
+        src (Ndarray): The values.
+        offsets (Ndarray): The ``ti.i32`` offsets of the segments in ``src``,
+            with one more element than ``dst``: segment ``s`` is ``src[
+            offsets[s]:offsets[s + 1]]``.
+        dst (Ndarray): The reduction of each segment. Empty segments get the
+            identity of ``op``.
+        op (str): ``'add'``, ``'min'`` or ``'max'``.
+    """
+    if op not in ('add', 'min', 'max'):
+        raise ValueError(f'Unsupported reduction {op}')
+    assert offsets.shape[0] == dst.shape[0] + 1
+    identity = 0
+    if op != 'add':
+        np_dtype = to_numpy_type(dst.dtype)
+        if np.issubdtype(np_dtype, np.floating):
+            info = np.finfo(np_dtype)
+            identity = float(info.max if op == 'min' else info.min)
+        else:
+            info = np.iinfo(np_dtype)
+            identity = int(info.max if op == 'min' else info.min)
+    segmented_reduce_kernel(src, offsets, dst, op, identity, dst.dtype)
+
+
+def histogram(src, counts, lo=None, hi=None):
+    """Adds to ``counts`` the number of values of a 1D ndarray in each bin.
+
+    Args:
+        src (Ndarray): The values.
+        counts (Ndarray): The ``ti.i32`` count of each bin.
+        lo (float): The lower bound of the first bin. If ``lo`` and ``hi`` are
+            omitted, the values are the indices of the bins.
+        hi (float): The upper bound of the last bin.
+
+    Values out of the bins are ignored.
+    """
+    assert counts.dtype == i32
+    binned = lo is None and hi is None
+    if binned:
+        lo, hi = 0, 1
+    histogram_kernel(src, counts, lo, hi, binned)
+
+
+__all__ = [
+    'compact', 'histogram', 'parallel_sort', 'PrefixSumExecutor',
+    'radix_sort', 'scan', 'segmented_reduce'
+]
@@ -16,6 +16,22 @@ from taichi.types.annotations import template
 import taichi
 
 
+def _resolve_spec_constants(kernel, spec_constants):
+    # Template parameters are not passed to the compiled kernel, so the
+    # argument index only counts the other parameters.
+    arg_ids = {}
+    for arg in kernel.arguments:
+        if not isinstance(arg.annotation, template):
+            arg_ids[arg.name] = len(arg_ids)
+    resolved = []
+    for name in spec_constants:
+        if name not in arg_ids:
+            raise ValueError(
+                f"'{name}' is not a non-template parameter of the kernel")
+        resolved.append((name, arg_ids[name]))
+    return resolved
+
+
 class KernelTemplate:
     def __init__(self, kernel_fn, aot_module):
         self._kernel_fn = kernel_fn
@@ -140,7 +156,11 @@ class Module:
                                     field.dtype, field.snode.shape, row_num,
                                     column_num)
 
-    def add_kernel(self, kernel_fn, template_args=None, name=None):
+    def add_kernel(self,
+                   kernel_fn,
+                   template_args=None,
+                   name=None,
+                   spec_constants=None):
         """Add a taichi kernel to the AOT module.
 
         Args:
@@ -151,6 +171,10 @@ class Module:
             `:class:`~taichi.types.ndarray`.
           name (str): Name to identify this kernel in the module. If not
             provided, uses the built-in ``__name__`` attribute of `kernel_fn`.
+          spec_constants (List[str]): names of the scalar parameters to be
+            compiled as specialization constants. Their values are provided
+            when the kernel is loaded from the module instead of at each
+            launch. Only supported on the SPIR-V based backends.
 
         """
         kernel_name = name or kernel_fn.__name__
@@ -162,7 +186,12 @@ class Module:
         else:
             injected_args = produce_injected_args(kernel)
         kernel.ensure_compiled(*injected_args)
-        self._aot_builder.add(kernel_name, kernel.kernel_cpp)
+        if spec_constants:
+            self._aot_builder.add_with_spec_constants(
+                kernel_name, kernel.kernel_cpp,
+                _resolve_spec_constants(kernel, spec_constants))
+        else:
+            self._aot_builder.add(kernel_name, kernel.kernel_cpp)
 
         # kernel AOT
         self._kernels.append(kernel)
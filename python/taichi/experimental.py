@@ -1,3 +1,10 @@
+from taichi.lang._distributed import (DistributedField, DistributedKernel,
+                                      LocalComm)
+from taichi.lang._layout import suggest_layout
+from taichi.lang._sharding import ShardedNdarray, shard_range
 from taichi.lang.kernel_impl import real_func
 
-__all__ = ["real_func"]
+__all__ = [
+    "real_func", "DistributedField", "DistributedKernel", "LocalComm",
+    "ShardedNdarray", "shard_range", "suggest_layout"
+]
@@ -42,6 +42,17 @@ class Sequential:
         self.seq_.dispatch(kernel_cpp, unzipped_args)
 
 
+class Loop(Sequential):
+    """A loop of a graph, whose condition is evaluated on the device.
+
+    Dispatches are added to its body with `dispatch()`, see
+    `GraphBuilder.create_loop()`.
+    """
+    def __init__(self, loop):
+        super().__init__(loop.body())
+        self.loop_ = loop
+
+
 class GraphBuilder:
     def __init__(self):
         self._graph_builder = _ti_core.GraphBuilder()
@@ -51,13 +62,54 @@ class GraphBuilder:
         unzipped_args = flatten_args(args)
         self._graph_builder.dispatch(kernel_cpp, unzipped_args)
 
+    def declare_temporary(self, arg, shape):
+        """Declares an ndarray argument allocated by the graph.
+
+        The temporary only passes data between the dispatches of the graph and
+        is not given to `Graph.run()`. Its contents are undefined before the
+        first dispatch taking it writes them. Temporaries that no dispatch
+        takes together share the same memory.
+
+        Args:
+            arg (Arg): The symbolic ndarray argument.
+            shape (Tuple[int]): The shape of the ndarray.
+        """
+        self._graph_builder.declare_temporary(arg, list(shape))
+
     def create_sequential(self):
         return Sequential(self._graph_builder.create_sequential())
 
+    def create_loop(self, cond, max_iterations, check_every=1):
+        """Creates a loop running its body until the body sets `cond` to 0.
+
+        The condition is written by the kernels of the body, and only read by
+        the host every `check_every` iterations. The iterations in between are
+        submitted together, so the kernels of the body must do nothing once
+        the condition is 0, e.g. by checking it themselves. With
+        `check_every=0` the condition is never read, and the whole loop runs
+        as one submission without waiting for the device.
+
+        Args:
+            cond (Arg): The 0-D i32 ndarray argument stopping the loop, which
+                the body must take.
+            max_iterations (int): The number of iterations launched at most.
+            check_every (int): The iterations launched between two reads of
+                `cond`.
+
+        Returns:
+            Loop: The loop, to be appended to the graph with `append()`.
+        """
+        return Loop(
+            self._graph_builder.create_loop(cond, max_iterations,
+                                            check_every))
+
     def append(self, node):
         # TODO: support appending dispatch node as well.
         assert isinstance(node, Sequential)
-        self._graph_builder.seq().append(node.seq_)
+        if isinstance(node, Loop):
+            self._graph_builder.seq().append(node.loop_)
+        else:
+            self._graph_builder.seq().append(node.seq_)
 
     def compile(self):
         return Graph(self._graph_builder.compile())
@@ -169,4 +221,4 @@ def Arg(tag,
     raise TaichiRuntimeError(f'Unknowm tag {tag} for graph Arg {name}.')
 
 
-__all__ = ['GraphBuilder', 'Graph', 'Arg', 'ArgKind']
+__all__ = ['GraphBuilder', 'Graph', 'Arg', 'ArgKind', 'Loop']
@@ -0,0 +1,362 @@
+import numpy as np
+from taichi.lang import impl
+from taichi.lang._sharding import shard_range
+from taichi.lang.kernel_impl import _process_args
+from taichi.lang.util import cook_dtype, python_scope, to_numpy_type
+
+
+class _LocalRequest:
+    def __init__(self, wait=None):
+        self._wait = wait
+
+    def Wait(self):  # pylint: disable=C0103
+        if self._wait is not None:
+            self._wait()
+
+
+class LocalComm:
+    """A stand-in for an ``mpi4py`` communicator between ranks that all live
+    in this process, which is mostly useful for testing.
+
+    Only the methods used by :class:`DistributedField` are provided.
+    :meth:`ranks` returns the communicator of each rank.
+
+    Args:
+        size (int): The number of ranks.
+    """
+    def __init__(self, size, rank=0, mailbox=None):
+        self.size = size
+        self.rank = rank
+        self._mailbox = {} if mailbox is None else mailbox
+
+    def ranks(self):
+        return [LocalComm(self.size, r, self._mailbox) for r in range(self.size)]
+
+    def Get_size(self):  # pylint: disable=C0103
+        return self.size
+
+    def Get_rank(self):  # pylint: disable=C0103
+        return self.rank
+
+    def Isend(self, buf, dest, tag=0):  # pylint: disable=C0103
+        self._mailbox[(self.rank, dest, tag)] = np.copy(buf)
+        return _LocalRequest()
+
+    def Irecv(self, buf, source, tag=0):  # pylint: disable=C0103
+        def wait():
+            key = (source, self.rank, tag)
+            if key not in self._mailbox:
+                raise RuntimeError(
+                    f'Rank {self.rank} waits for a message (tag={tag}) that '
+                    f'rank {source} has not sent')
+            buf[...] = self._mailbox.pop(key)
+
+        return _LocalRequest(wait)
+
+
+class _GhostExchange:
+    def __init__(self, field, width):
+        self.field = field
+        self.width = width
+        self.requests = []
+        # (first row, buffer) of the ghost rows being received.
+        self.recvs = []
+        # Kept alive until the sends are done.
+        self.sends = []
+
+
+class DistributedField:
+    """One rank's part of a scalar field split along its outermost axis, with
+    ghost rows mirroring the boundary rows of the neighboring ranks.
+
+    This is experimental. Each rank owns the rows ``[begin, end)`` of
+    ``field``, whose indices are the global ones: rows ``[begin - ghost,
+    begin)`` and ``[end, end + ghost)`` are the ghost rows. The ghost rows at
+    the ends of the global field are left untouched. Kernels should loop over
+    the owned rows only, e.g. with ``for i in range(begin, end)``, and be
+    launched through :class:`DistributedKernel`, which exchanges the ghost rows
+    they read.
+
+    The ghost rows are sent with the ``Isend()`` and ``Irecv()`` methods of
+    ``comm``, typically an ``mpi4py`` communicator whose ranks run in
+    different processes, or a :class:`LocalComm`.
+
+    Args:
+        dtype (DataType): Data type of each value.
+        shape (Tuple[int]): Shape of the global field.
+        comm: The communicator between the ranks.
+        ghost (int): The number of ghost rows on each side.
+        tag (int): Tells apart the messages of the fields exchanged at the
+            same time. Has to be the same on every rank.
+        block_shape (Tuple[int]): If given, the rows are stored in sparse
+            blocks of this shape (under a pointer SNode), else in a dense
+            SNode.
+
+    Example::
+
+        >>> comm = mpi4py.MPI.COMM_WORLD
+        >>> x = ti.experimental.DistributedField(ti.f32, (n, m), comm, 1, 0)
+        >>> y = ti.experimental.DistributedField(ti.f32, (n, m), comm, 1, 1)
+        >>>
+        >>> @ti.kernel
+        >>> def smooth(lo: ti.i32, hi: ti.i32):
+        >>>     for i in range(lo, hi):
+        >>>         for j in range(m):
+        >>>             y.field[i, j] = x.field[i - 1, j] + x.field[i + 1, j]
+        >>>
+        >>> ti.experimental.DistributedKernel(smooth, [x, y])()
+    """
+    def __init__(self, dtype, shape, comm, ghost, tag=0, block_shape=None):
+        shape = tuple(shape)
+        self.dtype = cook_dtype(dtype)
+        self.global_shape = shape
+        self.comm = comm
+        self.num_ranks = comm.Get_size()
+        self.rank = comm.Get_rank()
+        self.ghost = ghost
+        self.tag = tag
+        self.begin, self.end = shard_range(shape[0], self.num_ranks,
+                                           self.rank)
+        self.num_rows = self.end - self.begin
+        if self.num_ranks > 1 and self.num_rows < ghost:
+            raise ValueError(
+                f'Rank {self.rank} owns {self.num_rows} rows, fewer than the '
+                f'{ghost} ghost rows')
+        local_shape = (self.num_rows + 2 * ghost, ) + shape[1:]
+        axes = impl.axes(*range(len(shape)))
+        offset = (self.begin - ghost, ) + (0, ) * (len(shape) - 1)
+        self.field = impl.field(self.dtype)
+        if block_shape is None:
+            impl.root.dense(axes, local_shape).place(self.field, offset=offset)
+        else:
+            block_shape = tuple(block_shape)
+            grid = tuple(-(-n // b) for n, b in zip(local_shape, block_shape))
+            impl.root.pointer(axes, grid).dense(axes, block_shape).place(
+                self.field, offset=offset)
+        # The number of ghost rows on each side that mirror the current rows
+        # of the neighbors.
+        self.valid_ghost = 0
+
+    def _rows(self, rows, begin):
+        from taichi._kernels import \
+            tensor_rows_to_ext_arr  # pylint: disable=C0415
+        buf = np.empty((rows, ) + self.global_shape[1:],
+                       dtype=to_numpy_type(self.dtype))
+        tensor_rows_to_ext_arr(self.field, begin, buf)
+        return buf
+
+    def _set_rows(self, buf, begin):
+        from taichi._kernels import \
+            ext_arr_to_tensor_rows  # pylint: disable=C0415
+        ext_arr_to_tensor_rows(buf, self.field, begin)
+
+    @python_scope
+    def start_ghost_exchange(self, width=None):
+        """Sends the boundary rows to the neighbors and starts receiving theirs.
+
+        Args:
+            width (int): The number of ghost rows to exchange on each side,
+                ``ghost`` by default.
+
+        Returns:
+            The exchange to pass to :meth:`finish_ghost_exchange`.
+        """
+        width = self.ghost if width is None else width
+        assert 0 <= width <= self.ghost
+        exchange = _GhostExchange(self, width)
+        if width == 0:
+            return exchange
+        row_shape = (width, ) + self.global_shape[1:]
+        np_dtype = to_numpy_type(self.dtype)
+        # Messages sent to the previous rank are tagged with 2 * tag, those
+        # sent to the next one with 2 * tag + 1.
+        if self.rank > 0:
+            send = self._rows(width, self.begin)
+            recv = np.empty(row_shape, dtype=np_dtype)
+            exchange.sends.append(send)
+            exchange.requests.append(
+                self.comm.Isend(send, dest=self.rank - 1, tag=2 * self.tag))
+            exchange.requests.append(
+                self.comm.Irecv(recv,
+                                source=self.rank - 1,
+                                tag=2 * self.tag + 1))
+            exchange.recvs.append((self.begin - width, recv))
+        if self.rank + 1 < self.num_ranks:
+            send = self._rows(width, self.end - width)
+            recv = np.empty(row_shape, dtype=np_dtype)
+            exchange.sends.append(send)
+            exchange.requests.append(
+                self.comm.Isend(send,
+                                dest=self.rank + 1,
+                                tag=2 * self.tag + 1))
+            exchange.requests.append(
+                self.comm.Irecv(recv, source=self.rank + 1, tag=2 * self.tag))
+            exchange.recvs.append((self.end, recv))
+        return exchange
+
+    @python_scope
+    def finish_ghost_exchange(self, exchange):
+        """Waits for the ghost rows of an exchange, and stores them."""
+        assert exchange.field is self
+        for request in exchange.requests:
+            request.Wait()
+        for begin, recv in exchange.recvs:
+            self._set_rows(recv, begin)
+        self.valid_ghost = max(self.valid_ghost, exchange.width)
+
+    @python_scope
+    def exchange_ghosts(self, width=None):
+        """Exchanges ``width`` ghost rows with the neighbors, see
+        :meth:`start_ghost_exchange`."""
+        self.finish_ghost_exchange(self.start_ghost_exchange(width))
+
+    @python_scope
+    def invalidate_ghosts(self):
+        """Tells that the owned rows were written outside of
+        :class:`DistributedKernel`, so that the ghost rows are exchanged again
+        before they are read."""
+        self.valid_ghost = 0
+
+    @python_scope
+    def from_numpy(self, arr):
+        """Loads the owned rows from ``arr``, which has ``end - begin`` rows."""
+        arr = np.ascontiguousarray(arr, dtype=to_numpy_type(self.dtype))
+        assert arr.shape == (self.num_rows, ) + self.global_shape[1:]
+        self._set_rows(arr, self.begin)
+        self.invalidate_ghosts()
+
+    @python_scope
+    def to_numpy(self):
+        """Returns the owned rows, without the ghost rows."""
+        return self._rows(self.num_rows, self.begin)
+
+
+class _PendingLaunch:
+    def __init__(self, kernel, args, exchanges, strips, written):
+        self._kernel = kernel
+        self._args = args
+        self._exchanges = exchanges
+        self._strips = strips
+        self._written = written
+
+    def finish(self):
+        """Waits for the ghost rows and updates the rows next to them."""
+        for exchange in self._exchanges:
+            exchange.field.finish_ghost_exchange(exchange)
+        for lo, hi in self._strips:
+            self._kernel(lo, hi, *self._args)
+        for field in self._written:
+            field.invalidate_ghosts()
+
+
+class DistributedKernel:
+    """Launches a kernel on the rows of the :class:`DistributedField` ``fields``
+    owned by this rank, exchanging beforehand the ghost rows it reads.
+
+    This is experimental. The first two arguments of ``kernel`` are the range
+    of rows ``[lo, hi)`` it updates. How far from those rows each field is
+    read is found by analyzing the loops of the kernel (see
+    ``gather_access_footprints()``). The ghost rows of the fields read beyond
+    ``[lo, hi)`` and written since their last exchange are exchanged while the
+    rows far enough from the ghost rows are updated, and the remaining rows
+    are updated once the ghost rows arrive.
+
+    Args:
+        kernel (Callable): A kernel whose first two arguments are ``lo`` and
+            ``hi``.
+        fields (List[DistributedField]): The distributed fields that the
+            kernel accesses, which have to be owned by the same rows.
+    """
+    def __init__(self, kernel, fields):
+        self.kernel = kernel
+        self.fields = list(fields)
+        assert self.fields, 'A distributed kernel needs distributed fields'
+        ranges = {(f.begin, f.end) for f in self.fields}
+        assert len(ranges) == 1, 'The fields have to own the same rows'
+        self.begin, self.end = ranges.pop()
+        self._plans = {}
+
+    def _plan(self, args):
+        """Returns the number of ghost rows each field is read at, and the
+        fields that are written."""
+        primal = self.kernel._primal
+        args = _process_args(primal, args, {})
+        instance_id, _ = primal.mapper.lookup(args)
+        if instance_id in self._plans:
+            return self._plans[instance_id]
+        widths = [0] * len(self.fields)
+        written = [False] * len(self.fields)
+        for task in primal.gather_access_footprints(*args):
+            for i, field in enumerate(self.fields):
+                footprint = task.get(field.field.snode.ptr.id)
+                if footprint is None:
+                    continue
+                reads, writes = footprint
+                if reads:
+                    if reads[0] is None:
+                        # Reads rows that can't be told apart, so all the
+                        # ghost rows are exchanged.
+                        width = field.ghost
+                    else:
+                        width = max(-reads[0][0], reads[0][1], 0)
+                        if width > field.ghost:
+                            raise ValueError(
+                                f'Kernel {primal.func.__name__} reads '
+                                f'{width} rows away from its own rows but '
+                                f'the field has {field.ghost} ghost rows')
+                    if width and written[i]:
+                        raise ValueError(
+                            f'Kernel {primal.func.__name__} reads ghost rows '
+                            f'of a field written by an earlier loop of it, '
+                            f'please split the kernel')
+                    widths[i] = max(widths[i], width)
+                if writes:
+                    if writes[0] != (0, 0):
+                        raise ValueError(
+                            f'Kernel {primal.func.__name__} writes rows other '
+                            f'than its own rows, which is not supported')
+                    written[i] = True
+        plan = widths, written
+        self._plans[instance_id] = plan
+        return plan
+
+    @python_scope
+    def start(self, *args):
+        """Starts exchanging the ghost rows and updating the rows that don't
+        depend on them.
+
+        Args:
+            *args: The arguments of the kernel after ``lo`` and ``hi``.
+
+        Returns:
+            The launch whose ``finish()`` updates the remaining rows.
+        """
+        widths, written = self._plan((self.begin, self.end) + args)
+        exchanges = []
+        for field, width in zip(self.fields, widths):
+            if width > field.valid_ghost:
+                exchanges.append(field.start_ghost_exchange(width))
+        tags = [exchange.field.tag for exchange in exchanges]
+        if len(set(tags)) != len(tags):
+            raise ValueError('The fields exchanged at the same time need '
+                             'different tags')
+        # The rows within |margin| of the ghost rows are updated last.
+        margin = max([exchange.width for exchange in exchanges], default=0)
+        if 2 * margin >= self.end - self.begin:
+            strips = [(self.begin, self.end)]
+        else:
+            self.kernel(self.begin + margin, self.end - margin, *args)
+            strips = []
+            if margin:
+                strips = [(self.begin, self.begin + margin),
+                          (self.end - margin, self.end)]
+        return _PendingLaunch(
+            self.kernel, args, exchanges, strips,
+            [field for field, w in zip(self.fields, written) if w])
+
+    @python_scope
+    def __call__(self, *args):
+        self.start(*args).finish()
+
+
+__all__ = ['DistributedField', 'DistributedKernel', 'LocalComm']
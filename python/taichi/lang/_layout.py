@@ -0,0 +1,76 @@
+import numpy as np
+from taichi.lang.enums import Layout
+from taichi.lang.kernel_impl import _process_args
+from taichi.lang.util import python_scope, to_numpy_type
+
+# The bytes moved from memory at a time.
+_CACHE_LINE_BYTES = 64
+
+
+def _member_sizes(fields):
+    sizes = {}
+    for field in fields:
+        for var in field._get_field_members():
+            snode = var.ptr.snode()
+            sizes[snode.id] = np.dtype(to_numpy_type(
+                snode.data_type())).itemsize
+    return sizes
+
+
+def _is_streamed(footprint):
+    # An access follows the loop index if it does along at least one axis, so
+    # that neighboring iterations access neighboring elements.
+    return all(
+        any(axis is not None for axis in ranges) for ranges in footprint
+        if ranges)
+
+
+@python_scope
+def suggest_layout(fields, launches):
+    """Suggests whether the members of ``fields`` should be placed together
+    (``ti.Layout.AOS``) or apart (``ti.Layout.SOA``), from how ``launches``
+    access them.
+
+    This is experimental and only a suggestion: the fields are left as they
+    are, and are to be declared again with the suggested layout, e.g. with
+    ``ti.Vector.field(3, ti.f32, n, layout=layout)``. The accesses of each
+    offloaded task are found as in ``gather_access_footprints()``. A task
+    whose accesses follow its loop index is assumed to move each cache line
+    of the members it touches once, so that untouched members placed in
+    between are moved for nothing. Any other task is assumed to move a whole
+    cache line for each member it touches, unless they are placed together.
+
+    Args:
+        fields (List[Field]): The fields whose members are placed together
+            or apart, e.g. a single ``ti.Vector.field``.
+        launches (List[Tuple[Callable, Tuple]]): The kernels accessing the
+            fields, each with the arguments it is called with.
+
+    Returns:
+        Layout: The layout that moves fewer bytes.
+    """
+    sizes = _member_sizes(fields)
+    element_bytes = sum(sizes.values())
+    aos_bytes = 0
+    soa_bytes = 0
+    for kernel, args in launches:
+        primal = kernel._primal
+        args = _process_args(primal, args, {})
+        for task in primal.gather_access_footprints(*args):
+            touched = [
+                snode_id for snode_id in sizes
+                if task.get(snode_id) is not None and any(task[snode_id])
+            ]
+            if not touched:
+                continue
+            if all(_is_streamed(task[snode_id]) for snode_id in touched):
+                aos_bytes += element_bytes
+                soa_bytes += sum(sizes[snode_id] for snode_id in touched)
+            else:
+                aos_bytes += -(-element_bytes //
+                               _CACHE_LINE_BYTES) * _CACHE_LINE_BYTES
+                soa_bytes += _CACHE_LINE_BYTES * len(touched)
+    return Layout.AOS if aos_bytes <= soa_bytes else Layout.SOA
+
+
+__all__ = ['suggest_layout']
@@ -8,6 +8,12 @@ from taichi.types.ndarray_type import NdarrayTypeMetadata
 from taichi.types.utils import is_real, is_signed
 
 
+# Backends on which ndarrays can be copied without launching a kernel.
+_async_copy_archs = (_ti_core.Arch.x64, _ti_core.Arch.arm64,
+                     _ti_core.Arch.cuda, _ti_core.Arch.vulkan,
+                     _ti_core.Arch.metal, _ti_core.Arch.opengl)
+
+
 class Ndarray:
     """Taichi ndarray class.
 
@@ -59,23 +65,109 @@ class Ndarray:
         raise NotImplementedError()
 
     @python_scope
-    def fill(self, val):
+    def read(self, keys):
+        """Reads a batch of scalar elements in Python scope.
+
+        All the elements are copied to the host in a single transfer, which is
+        much faster than reading them one by one with ``__getitem__``.
+
+        Args:
+            keys (List[Tuple[int]]): Coordinates of the scalar elements, with
+                the element indices of a vector/matrix ndarray appended.
+
+        Returns:
+            numpy.ndarray: The values, in the order of ``keys``.
+        """
+        indices = self._flatten_keys(keys)
+        values = np.empty(len(indices), dtype=to_numpy_type(self.dtype))
+        self.arr.read_batch(indices, values.ctypes.data)
+        return values
+
+    @python_scope
+    def write(self, keys, values):
+        """Writes a batch of scalar elements in Python scope.
+
+        All the elements are copied to the device in a single transfer.
+
+        Args:
+            keys (List[Tuple[int]]): Coordinates of the scalar elements, see
+                :meth:`read`.
+            values (Union[numpy.ndarray, List]): Values to write, in the order
+                of ``keys``.
+        """
+        indices = self._flatten_keys(keys)
+        values = np.ascontiguousarray(values, dtype=to_numpy_type(self.dtype))
+        if values.shape != (len(indices), ):
+            raise ValueError(
+                f"Mismatch shape: {(len(indices), )} expected, but {values.shape} provided"
+            )
+        self.arr.write_batch(indices, values.ctypes.data)
+
+    @python_scope
+    def _flatten_keys(self, keys):
+        total_shape = tuple(self.arr.total_shape())
+        keys = np.asarray(keys, dtype=np.int64).reshape(-1, len(total_shape))
+        return np.ravel_multi_index(keys.T, total_shape).tolist()
+
+    @python_scope
+    def _slice_range(self, key):
+        """Returns the flattened range and shape of ``self[key]`` for a slice
+        of the first axis, or None if it is not contiguous."""
+        total_shape = tuple(self.arr.total_shape())
+        start, stop, step = key.indices(total_shape[0])
+        if step != 1:
+            return None
+        rows = max(stop - start, 0)
+        row_size = int(np.prod(total_shape[1:], dtype=np.int64))
+        return start * row_size, rows * row_size, (rows, ) + total_shape[1:]
+
+    @python_scope
+    def _read_slice(self, key):
+        begin, count, shape = self._slice_range(key)
+        values = np.empty(count, dtype=to_numpy_type(self.dtype))
+        self.arr.read_range(begin, count, values.ctypes.data)
+        return values.reshape(shape)
+
+    @python_scope
+    def _write_slice(self, key, value):
+        begin, count, shape = self._slice_range(key)
+        values = np.broadcast_to(
+            np.asarray(value, dtype=to_numpy_type(self.dtype)), shape)
+        values = np.ascontiguousarray(values)
+        self.arr.write_range(begin, count, values.ctypes.data)
+
+    @python_scope
+    def fill(self, val, blocking=True):
         """Fills ndarray with a specific scalar value.
 
         Args:
             val (Union[int, float]): Value to fill.
+            blocking (bool): Whether to wait for the fill. If False, the fill is
+                only queued; kernels launched afterwards still see its result.
+
+        Returns:
+            Optional[StreamSemaphore]: If not blocking, a handle of the queued
+            fill, or None if it has already completed.
         """
+        prog = impl.get_runtime().prog
         if impl.current_cfg().arch != _ti_core.Arch.cuda and impl.current_cfg(
         ).arch != _ti_core.Arch.x64:
             self._fill_by_kernel(val)
         elif self.dtype == primitive_types.f32:
-            impl.get_runtime().prog.fill_float(self.arr, val)
+            if not blocking:
+                return prog.fill_float_async(self.arr, val)
+            prog.fill_float(self.arr, val)
         elif self.dtype == primitive_types.i32:
-            impl.get_runtime().prog.fill_int(self.arr, val)
+            if not blocking:
+                return prog.fill_int_async(self.arr, val)
+            prog.fill_int(self.arr, val)
         elif self.dtype == primitive_types.u32:
-            impl.get_runtime().prog.fill_uint(self.arr, val)
+            if not blocking:
+                return prog.fill_uint_async(self.arr, val)
+            prog.fill_uint(self.arr, val)
         else:
             self._fill_by_kernel(val)
+        return None
 
     @python_scope
     def _ndarray_to_numpy(self):
@@ -86,6 +178,9 @@ class Ndarray:
         """
         arr = np.zeros(shape=self.arr.total_shape(),
                        dtype=to_numpy_type(self.dtype))
+        if self.arr.is_host_mapped():
+            self.arr.read_range(0, arr.size, arr.ctypes.data)
+            return arr
         from taichi._kernels import ndarray_to_ext_arr  # pylint: disable=C0415
         ndarray_to_ext_arr(self, arr)
         impl.get_runtime().sync()
@@ -100,6 +195,10 @@ class Ndarray:
         """
         arr = np.zeros(shape=self.arr.total_shape(),
                        dtype=to_numpy_type(self.dtype))
+        if self.arr.is_host_mapped():
+            # The flattened elements are already laid out as in |arr|.
+            self.arr.read_range(0, arr.size, arr.ctypes.data)
+            return arr
         from taichi._kernels import \
             ndarray_matrix_to_ext_arr  # pylint: disable=C0415
         layout_is_aos = 1
@@ -122,6 +221,10 @@ class Ndarray:
             )
         if not arr.flags.c_contiguous:
             arr = np.ascontiguousarray(arr)
+        if self.arr.is_host_mapped() and arr.dtype == to_numpy_type(
+                self.dtype):
+            self.arr.write_range(0, arr.size, arr.ctypes.data)
+            return
 
         from taichi._kernels import ext_arr_to_ndarray  # pylint: disable=C0415
         ext_arr_to_ndarray(arr, self)
@@ -142,6 +245,10 @@ class Ndarray:
             )
         if not arr.flags.c_contiguous:
             arr = np.ascontiguousarray(arr)
+        if self.arr.is_host_mapped() and arr.dtype == to_numpy_type(
+                self.dtype):
+            self.arr.write_range(0, arr.size, arr.ctypes.data)
+            return
 
         from taichi._kernels import \
             ext_arr_to_ndarray_matrix  # pylint: disable=C0415
@@ -168,19 +275,34 @@ class Ndarray:
         return self.arr.nelement()
 
     @python_scope
-    def copy_from(self, other):
+    def copy_from(self, other, blocking=True):
         """Copies all elements from another ndarray.
 
         The shape of the other ndarray needs to be the same as `self`.
 
         Args:
             other (Ndarray): The source ndarray.
+            blocking (bool): Whether to wait for the copy. If False, the copy
+                is only queued; kernels launched afterwards still see its
+                result.
+
+        Returns:
+            Optional[StreamSemaphore]: If not blocking, a handle of the queued
+            copy, or None if it has already completed.
         """
         assert isinstance(other, Ndarray)
         assert tuple(self.arr.shape) == tuple(other.arr.shape)
+        if not blocking and impl.current_cfg().arch in _async_copy_archs and \
+                self.dtype == other.dtype and tuple(
+                    self.arr.element_shape()) == tuple(
+                        other.arr.element_shape()):
+            return impl.get_runtime().prog.copy_ndarray_async(
+                self.arr, other.arr)
         from taichi._kernels import ndarray_to_ndarray  # pylint: disable=C0415
         ndarray_to_ndarray(self, other)
-        impl.get_runtime().sync()
+        if blocking:
+            impl.get_runtime().sync()
+        return None
 
     def _set_grad(self, grad):
         """Sets the gradient ndarray.
@@ -206,6 +328,26 @@ class Ndarray:
         """
         raise NotImplementedError()
 
+    @python_scope
+    def to_dlpack(self):
+        """Exports the ndarray as a DLPack capsule without copying.
+
+        Only the CPU and CUDA backends are supported. The ndarray is kept alive
+        until the consumer of the capsule releases it.
+
+        Returns:
+            PyCapsule: A DLPack capsule named ``dltensor``.
+        """
+        return impl.get_runtime().prog.ndarray_to_dlpack(self, self.arr)
+
+    def __dlpack__(self, stream=None):
+        return self.to_dlpack()
+
+    def __dlpack_device__(self):
+        if impl.current_cfg().arch == _ti_core.Arch.cuda:
+            return (2, 0)  # kDLCUDA
+        return (1, 0)  # kDLCPU
+
     @python_scope
     def _pad_key(self, key):
         if key is None:
@@ -238,7 +380,7 @@ class ScalarNdarray(Ndarray):
                                                           layout=Layout.NULL,
                                                           zero_fill=True)
         self.shape = tuple(self.arr.shape)
-        self.element_type = dtype
+        self.element_type = self.dtype
 
     def __del__(self):
         if impl is not None and impl.get_runtime(
@@ -251,11 +393,16 @@ class ScalarNdarray(Ndarray):
 
     @python_scope
     def __setitem__(self, key, value):
+        if isinstance(key, slice) and self._slice_range(key) is not None:
+            self._write_slice(key, value)
+            return
         self._initialize_host_accessor()
         self.host_accessor.setter(value, *self._pad_key(key))
 
     @python_scope
     def __getitem__(self, key):
+        if isinstance(key, slice) and self._slice_range(key) is not None:
+            return self._read_slice(key)
         self._initialize_host_accessor()
         return self.host_accessor.getter(*self._pad_key(key))
 
@@ -280,6 +427,128 @@ class ScalarNdarray(Ndarray):
         return '<ti.ndarray>'
 
 
+@python_scope
+def from_dlpack(tensor):
+    """Creates a scalar ndarray sharing the memory of a DLPack tensor.
+
+    The tensor must be compact, row-major and on the device of the current
+    backend (CPU or CUDA).
+
+    Args:
+        tensor: An object implementing ``__dlpack__`` (e.g. a PyTorch tensor or
+            a NumPy array), or a DLPack capsule.
+
+    Returns:
+        ScalarNdarray: The ndarray viewing the memory of ``tensor``.
+
+    Example::
+
+        >>> t = torch.zeros(4, 4, device='cuda')
+        >>> x = ti.from_dlpack(t)
+        >>> x.fill(1)  # t is filled as well
+    """
+    capsule = tensor.__dlpack__() if hasattr(tensor, '__dlpack__') else tensor
+    impl.get_runtime().materialize()
+    arr = impl.get_runtime().prog.ndarray_from_dlpack(capsule)
+    ret = ScalarNdarray.__new__(ScalarNdarray)
+    Ndarray.__init__(ret)
+    ret.arr = arr
+    ret.dtype = arr.element_data_type()
+    ret.element_type = ret.dtype
+    ret.shape = tuple(arr.shape)
+    return ret
+
+
+class _OutOfCoreTile(ScalarNdarray):
+    """A loaded tile of an :class:`OutOfCoreNdarray`, which owns its memory."""
+    def __init__(self, arr):
+        Ndarray.__init__(self)  # pylint: disable=W0233
+        self.arr = arr
+        self.dtype = arr.element_data_type()
+        self.element_type = self.dtype
+        self.shape = tuple(arr.shape)
+
+    def __del__(self):
+        pass
+
+
+class OutOfCoreNdarray:
+    """Scalar ndarray kept in host memory or in a file, for data sets larger
+    than the device memory.
+
+    Kernels can't take it directly. Instead, :meth:`for_each_tile` runs a
+    kernel on each tile of consecutive rows (indices along the first axis),
+    which is loaded to the device as an ordinary ndarray. On CUDA, the next
+    tile is copied to the device while the kernel runs on the current one.
+    Only the CPU and CUDA backends are supported.
+
+    Args:
+        dtype (DataType): Data type of each value.
+        shape (Tuple[int]): Shape of the ndarray.
+        path (str, optional): The file keeping the data, which is created or
+            resized as needed. If None, the data is kept in host memory.
+        tile_rows (int, optional): The number of rows of each tile. By
+            default, two tiles take at most a quarter of `device_memory_GB`.
+    """
+    def __init__(self, dtype, shape, path=None, tile_rows=None):
+        if isinstance(shape, int):
+            shape = (shape, )
+        self.dtype = cook_dtype(dtype)
+        impl.get_runtime().materialize()
+        self.arr = impl.get_runtime().prog.create_out_of_core_ndarray(
+            self.dtype, list(shape), path or '', tile_rows or 0)
+        self.shape = tuple(self.arr.shape)
+
+    def __del__(self):
+        if impl is not None and impl.get_runtime(
+        ) is not None and impl.get_runtime().prog is not None:
+            impl.get_runtime().prog.delete_out_of_core_ndarray(self.arr)
+
+    @property
+    def num_tiles(self):
+        return self.arr.num_tiles()
+
+    @property
+    def tile_rows(self):
+        return self.arr.tile_rows()
+
+    @python_scope
+    def for_each_tile(self, kernel, *args, writeback=True):
+        """Calls ``kernel(*args)`` once per tile, with each occurrence of this
+        array in ``args`` replaced by the tile.
+
+        Args:
+            kernel: The Taichi kernel to call.
+            writeback (bool): Whether to write the tiles back to the host
+                memory, i.e. whether ``kernel`` modifies this array.
+        """
+        for i in range(self.num_tiles):
+            tile = _OutOfCoreTile(self.arr.load_tile(i))
+            kernel(*[tile if arg is self else arg for arg in args])
+            if writeback:
+                self.arr.store_tile(i)
+
+    @python_scope
+    def to_numpy(self):
+        arr = np.empty(self.shape, dtype=to_numpy_type(self.dtype))
+        self.arr.read(arr.ctypes.data)
+        return arr
+
+    @python_scope
+    def from_numpy(self, arr):
+        if not isinstance(arr, np.ndarray):
+            raise TypeError(f"{np.ndarray} expected, but {type(arr)} provided")
+        if tuple(arr.shape) != self.shape:
+            raise ValueError(
+                f"Mismatch shape: {tuple(self.shape)} expected, but {tuple(arr.shape)} provided"
+            )
+        arr = np.ascontiguousarray(arr, dtype=to_numpy_type(self.dtype))
+        self.arr.write(arr.ctypes.data)
+
+    def __repr__(self):
+        return '<ti.OutOfCoreNdarray>'
+
+
 class NdarrayHostAccessor:
     def __init__(self, ndarray):
         dtype = ndarray.element_data_type()
@@ -333,4 +602,4 @@ class NdarrayHostAccess:
         self.setter = setter
 
 
-__all__ = ["Ndarray", "ScalarNdarray"]
+__all__ = ["Ndarray", "ScalarNdarray", "OutOfCoreNdarray", "from_dlpack"]
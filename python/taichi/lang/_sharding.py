@@ -0,0 +1,145 @@
+from taichi.lang import impl
+from taichi.lang._ndarray import Ndarray, ScalarNdarray
+from taichi.lang.util import cook_dtype, python_scope
+
+
+def shard_range(extent, num_shards, shard_id):
+    """Returns the rows ``[begin, end)`` of shard ``shard_id`` when ``extent``
+    rows are split as evenly as possible across ``num_shards`` shards.
+    """
+    assert 0 <= shard_id < num_shards
+    base, rem = divmod(extent, num_shards)
+    begin = shard_id * base + min(shard_id, rem)
+    return begin, begin + base + (shard_id < rem)
+
+
+def _ndarray_from_ipc_handle(handle, dtype, shape):
+    arr = impl.get_runtime().prog.import_ndarray_from_ipc_handle(
+        handle, dtype, shape)
+    ret = ScalarNdarray.__new__(ScalarNdarray)
+    Ndarray.__init__(ret)
+    ret.arr = arr
+    ret.dtype = dtype
+    ret.element_type = dtype
+    ret.shape = tuple(arr.shape)
+    return ret
+
+
+class ShardedNdarray:
+    """One shard of a scalar ndarray split along its outermost axis, with
+    copies of the boundary rows of the neighboring shards (halos).
+
+    This is experimental. A program drives a single device, so the shards
+    usually live in the processes of a node, each one using its own GPU
+    (selected with ``TI_VISIBLE_DEVICE``). The halos are then copied directly
+    from the memory of the neighboring GPUs. Shards of the same process share
+    memory the same way, which only makes sense for testing.
+
+    ``local`` holds ``halo`` rows mirroring the previous shard, the rows of
+    this shard, and ``halo`` rows mirroring the next shard. Row ``i`` of the
+    global array is row ``i - begin + halo`` of ``local``. The halos at the
+    ends of the global array are left untouched.
+
+    Args:
+        dtype (DataType): Data type of each value.
+        shape (Tuple[int]): Shape of the global array.
+        num_shards (int): The number of shards.
+        shard_id (int): The index of this shard.
+        halo (int): The number of rows mirrored from each neighbor.
+
+    Example::
+
+        >>> x = ti.experimental.ShardedNdarray(ti.f32, (n, m), size, rank, 1)
+        >>> x.connect(comm.allgather(x.ipc_handle))
+        >>> for _ in range(steps):
+        >>>     x.exchange_halos(barrier=comm.Barrier)
+        >>>     stencil(x.local, x.halo, x.num_local_rows)
+    """
+    def __init__(self, dtype, shape, num_shards, shard_id, halo):
+        shape = tuple(shape)
+        self.dtype = cook_dtype(dtype)
+        self.global_shape = shape
+        self.num_shards = num_shards
+        self.shard_id = shard_id
+        self.halo = halo
+        self.begin, self.end = shard_range(shape[0], num_shards, shard_id)
+        self.num_local_rows = self.end - self.begin
+        if num_shards > 1 and self.num_local_rows < halo:
+            raise ValueError(
+                f'Shard {shard_id} has {self.num_local_rows} rows, fewer '
+                f'than the {halo} rows of the halo')
+        self.local = ScalarNdarray(self.dtype,
+                                   (self.num_local_rows + 2 * halo, ) +
+                                   shape[1:])
+        self._prev = None
+        self._next = None
+
+    @property
+    @python_scope
+    def ipc_handle(self):
+        """bytes: The handle to pass to :meth:`connect` of the other shards."""
+        return impl.get_runtime().prog.get_ndarray_ipc_handle(self.local.arr)
+
+    @python_scope
+    def connect(self, handles):
+        """Maps the memory of the neighboring shards.
+
+        Args:
+            handles (List[bytes]): The ``ipc_handle`` of every shard, in shard
+                order, e.g. gathered with ``mpi4py``'s ``comm.allgather``.
+        """
+        assert len(handles) == self.num_shards
+
+        def neighbor(shard_id):
+            begin, end = shard_range(self.global_shape[0], self.num_shards,
+                                     shard_id)
+            return _ndarray_from_ipc_handle(
+                handles[shard_id], self.dtype,
+                (end - begin + 2 * self.halo, ) + self.global_shape[1:])
+
+        if self.shard_id > 0:
+            self._prev = neighbor(self.shard_id - 1)
+        if self.shard_id + 1 < self.num_shards:
+            self._next = neighbor(self.shard_id + 1)
+
+    @python_scope
+    def exchange_halos(self, barrier=None):
+        """Copies the boundary rows of the neighboring shards into the halos.
+
+        Args:
+            barrier (Callable[[], None]): Waits for every shard, e.g.
+                ``mpi4py``'s ``comm.Barrier``. It is called once every shard
+                is done writing its rows, and again once the halos are
+                copied, so that the rows are not overwritten while being
+                read. May be omitted if all the shards are in this process.
+        """
+        if self.halo == 0:
+            return
+        runtime = impl.get_runtime()
+        assert self.num_shards == 1 or self._prev is not None or \
+            self._next is not None, 'connect() has to be called first'
+        runtime.sync()
+        if barrier is not None:
+            barrier()
+        if self._prev is not None:
+            # The last rows of the previous shard.
+            runtime.prog.copy_ndarray_rows_async(
+                self.local.arr, 0, self._prev.arr,
+                self._prev.shape[0] - 2 * self.halo, self.halo)
+        if self._next is not None:
+            # The first rows of the next shard.
+            runtime.prog.copy_ndarray_rows_async(
+                self.local.arr, self.halo + self.num_local_rows,
+                self._next.arr, self.halo, self.halo)
+        runtime.sync()
+        if barrier is not None:
+            barrier()
+
+    @python_scope
+    def to_numpy(self):
+        """Returns the rows of this shard, without the halos."""
+        return self.local.to_numpy()[self.halo:self.halo +
+                                     self.num_local_rows]
+
+
+__all__ = ['ShardedNdarray', 'shard_range']
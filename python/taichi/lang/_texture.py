@@ -40,6 +40,31 @@ class TextureSampler:
                                with_runtime_context=False)
         return vector(4, f32)([r, g, b, a])
 
+    @taichi_scope
+    def sample_grad(self, uv, dx, dy):
+        """Samples the texture with the derivatives of the coordinates along
+        the X and Y axes of the output, from which the level-of-detail of a
+        mipmapped texture is chosen.
+        """
+        ast_builder = impl.get_runtime().compiling_callable.ast_builder()
+        args_group = make_expr_group(*_get_entries(uv), *_get_entries(dx),
+                                     *_get_entries(dy))
+        v = ast_builder.make_texture_op_expr(
+            _ti_core.TextureOpType.kSampleGrad, self.ptr_expr, args_group)
+        r = impl.call_internal("composite_extract_0",
+                               v,
+                               with_runtime_context=False)
+        g = impl.call_internal("composite_extract_1",
+                               v,
+                               with_runtime_context=False)
+        b = impl.call_internal("composite_extract_2",
+                               v,
+                               with_runtime_context=False)
+        a = impl.call_internal("composite_extract_3",
+                               v,
+                               with_runtime_context=False)
+        return vector(4, f32)([r, g, b, a])
+
     @taichi_scope
     def fetch(self, index, lod):
         ast_builder = impl.get_runtime().compiling_callable.ast_builder()
@@ -128,16 +153,19 @@ class Texture:
     Args:
         fmt (ti.Format): Color format of the texture.
         shape (Tuple[int]): Shape of the Texture.
+        mip_levels (int): Number of levels in the mip chain, clamped to the
+            full chain. Only supported on Vulkan when greater than 1.
     """
-    def __init__(self, fmt, arr_shape):
+    def __init__(self, fmt, arr_shape, mip_levels=1):
         dtype, num_channels = FORMAT2TY_CH[fmt]
         self.tex = impl.get_runtime().prog.create_texture(
-            dtype, num_channels, arr_shape)
+            dtype, num_channels, arr_shape, mip_levels)
         self.fmt = fmt
         self.dtype = dtype
         self.num_channels = num_channels
         self.num_dims = len(arr_shape)
         self.shape = arr_shape
+        self.mip_levels = mip_levels
 
     def from_ndarray(self, ndarray):
         """Loads an ndarray to texture.
@@ -155,6 +183,12 @@ class Texture:
         """
         self.tex.from_snode(field.snode.ptr)
 
+    def generate_mipmaps(self):
+        """Fills the mip levels but the first one by downsampling the first
+        one, e.g. after it is loaded or written by a kernel.
+        """
+        self.tex.generate_mipmaps()
+
     def _device_allocation_ptr(self):
         return self.tex.device_allocation_ptr()
 
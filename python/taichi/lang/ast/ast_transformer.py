@@ -46,8 +46,14 @@ def reshape_list(flat_list, target_shape):
     return reshape_list(curr_list, target_shape[:-1])
 
 
-def boundary_type_cast_warning(expression):
+def boundary_type_cast_warning(expression, index_dtype=primitive_types.i32):
     expr_dtype = expression.ptr.get_ret_type()
+    if index_dtype == primitive_types.i64:
+        if not is_integral(expr_dtype) or expr_dtype == primitive_types.u64:
+            warnings.warn(
+                f"Casting range_for boundary values from {expr_dtype} to i64, which may cause numerical issues",
+                Warning)
+        return
     if not is_integral(expr_dtype) or expr_dtype in [
             primitive_types.i64, primitive_types.u64, primitive_types.u32
     ]:
@@ -56,6 +62,20 @@ def boundary_type_cast_warning(expression):
             Warning)
 
 
+def range_for_index_type(*expressions):
+    """Range-fors over 64-bit bounds get a 64-bit index on LLVM backends."""
+    if impl.current_cfg().arch not in [
+            _ti_core.x64, _ti_core.arm64, _ti_core.cuda, _ti_core.amdgpu
+    ]:
+        return primitive_types.i32
+    for expression in expressions:
+        if expression.ptr.get_ret_type() in [
+                primitive_types.i64, primitive_types.u64
+        ]:
+            return primitive_types.i64
+    return primitive_types.i32
+
+
 class ASTTransformer(Builder):
     @staticmethod
     def build_Name(ctx, node):
@@ -1090,22 +1110,24 @@ class ASTTransformer(Builder):
             if len(node.iter.args) == 2:
                 begin_expr = expr.Expr(build_stmt(ctx, node.iter.args[0]))
                 end_expr = expr.Expr(build_stmt(ctx, node.iter.args[1]))
+                index_dtype = range_for_index_type(begin_expr, end_expr)
 
                 # Warning for implicit dtype conversion
-                boundary_type_cast_warning(begin_expr)
-                boundary_type_cast_warning(end_expr)
+                boundary_type_cast_warning(begin_expr, index_dtype)
+                boundary_type_cast_warning(end_expr, index_dtype)
 
-                begin = ti_ops.cast(begin_expr, primitive_types.i32)
-                end = ti_ops.cast(end_expr, primitive_types.i32)
+                begin = ti_ops.cast(begin_expr, index_dtype)
+                end = ti_ops.cast(end_expr, index_dtype)
 
             else:
                 end_expr = expr.Expr(build_stmt(ctx, node.iter.args[0]))
+                index_dtype = range_for_index_type(end_expr)
 
                 # Warning for implicit dtype conversion
-                boundary_type_cast_warning(end_expr)
+                boundary_type_cast_warning(end_expr, index_dtype)
 
-                begin = ti_ops.cast(expr.Expr(0), primitive_types.i32)
-                end = ti_ops.cast(end_expr, primitive_types.i32)
+                begin = ti_ops.cast(expr.Expr(0), index_dtype)
+                end = ti_ops.cast(end_expr, index_dtype)
 
             ctx.ast_builder.begin_frontend_range_for(loop_var.ptr, begin.ptr,
                                                      end.ptr)
@@ -33,6 +33,8 @@ class DeviceCapability:
     spirv_has_subgroup_ballot = "spirv_has_subgroup_ballot"
     spirv_has_non_semantic_info = "spirv_has_non_semantic_info"
     spirv_has_no_integer_wrap_decoration = "spirv_has_no_integer_wrap_decoration"
+    spirv_has_storage_buffer_16bit_access = "spirv_has_storage_buffer_16bit_access"
+    unified_memory = "unified_memory"
 
 
 __all__ = [
@@ -5,6 +5,7 @@ from taichi.lang import impl
 from taichi.lang.exception import TaichiSyntaxError
 from taichi.lang.util import (in_python_scope, python_scope, to_numpy_type,
                               to_paddle_type, to_pytorch_type)
+from taichi.types.primitive_types import f16
 
 
 class Field:
@@ -23,6 +24,7 @@ class Field:
         self.host_accessors = None
         self.grad = None
         self.dual = None
+        self.duals = []
 
     @property
     def snode(self):
@@ -103,13 +105,16 @@ class Field:
         """
         self.grad = grad
 
-    def _set_dual(self, dual):
+    def _set_dual(self, dual, lanes=()):
         """Sets corresponding dual field (forward mode).
 
         Args:
             dual (Field): Corresponding dual field.
+            lanes (List[Field]): The dual fields of tangent lanes 1, 2, ...
+                when ``forward_ad_lanes`` is larger than one.
         """
         self.dual = dual
+        self.duals = [dual, *lanes]
 
     @python_scope
     def fill(self, val):
@@ -318,6 +323,29 @@ class ScalarField(Field):
         taichi.lang.runtime_ops.sync()
         return arr
 
+    @python_scope
+    def to_dlpack(self):
+        """Exports this field as a DLPack capsule without copying.
+
+        Only fields placed directly under a dense SNode of the root (e.g. those
+        created by ``ti.field(dtype, shape)``) on the CPU and CUDA backends are
+        supported. The field memory stays valid as long as the program is.
+
+        Returns:
+            PyCapsule: A DLPack capsule named ``dltensor``.
+        """
+        taichi.lang.impl.get_runtime().materialize()
+        return impl.get_runtime().prog.field_to_dlpack(self,
+                                                       self.vars[0].ptr.snode())
+
+    def __dlpack__(self, stream=None):
+        return self.to_dlpack()
+
+    def __dlpack_device__(self):
+        if impl.current_cfg().arch == _ti_core.Arch.cuda:
+            return (2, 0)  # kDLCUDA
+        return (1, 0)  # kDLCPU
+
     @python_scope
     def to_paddle(self, place=None):
         """Converts this field to a `paddle.Tensor`.
@@ -358,11 +386,24 @@ class ScalarField(Field):
 
     @python_scope
     def __setitem__(self, key, value):
+        batch = self._batch_indices(key)
+        if batch is not None and not self._grad_checked():
+            self._write_batch(*batch, value)
+            return
+        if batch is not None:
+            import numpy as np  # pylint: disable=C0415
+            values = np.broadcast_to(value, batch[1]).reshape(-1)
+            for index, val in zip(batch[0], values):
+                self[tuple(index)] = val.item()
+            return
         self._initialize_host_accessors()
         self.host_accessors[0].setter(value, *self._pad_key(key))
 
     @python_scope
     def __getitem__(self, key):
+        batch = self._batch_indices(key)
+        if batch is not None:
+            return self._read_batch(*batch)
         self._initialize_host_accessors()
         # Check for potential slicing behaviour
         # for instance: x[0, :]
@@ -376,6 +417,57 @@ class ScalarField(Field):
                 )
         return self.host_accessors[0].getter(*padded_key)
 
+    def _batch_indices(self, key):
+        """Returns the [n, dim] coordinates and the shape of the result if
+        ``key`` holds numpy integer arrays, which select many elements at once.
+        """
+        import numpy as np  # pylint: disable=C0415
+        if not isinstance(key, tuple):
+            key = (key, )
+        if not any(isinstance(k, np.ndarray) and k.ndim > 0 for k in key):
+            return None
+        if len(key) != len(self.shape):
+            raise AssertionError("Slicing is not supported on ti.field")
+        arrays = np.broadcast_arrays(*[np.asarray(k) for k in key])
+        for a in arrays:
+            if not np.issubdtype(a.dtype, np.integer):
+                raise TypeError(
+                    f"Field indices must be integers, but {a.dtype} provided")
+        indices = np.stack([a.reshape(-1) for a in arrays],
+                           axis=1).astype(np.int32)
+        return np.ascontiguousarray(indices), arrays[0].shape
+
+    def _batch_numpy_type(self):
+        import numpy as np  # pylint: disable=C0415
+        if self.dtype == f16:
+            # The accessor kernels use the compute type of f16.
+            return np.float32
+        return to_numpy_type(self.dtype)
+
+    def _grad_checked(self):
+        runtime = impl.get_runtime()
+        return bool(runtime.target_tape and runtime.target_tape.grad_checker
+                    and not runtime.grad_replaced)
+
+    @python_scope
+    def _read_batch(self, indices, shape):
+        import numpy as np  # pylint: disable=C0415
+        taichi.lang.impl.get_runtime().materialize()
+        values = np.empty(len(indices), dtype=self._batch_numpy_type())
+        self.vars[0].ptr.snode().read_batch(indices.ctypes.data,
+                                            values.ctypes.data, len(indices))
+        return values.reshape(shape)
+
+    @python_scope
+    def _write_batch(self, indices, shape, value):
+        import numpy as np  # pylint: disable=C0415
+        taichi.lang.impl.get_runtime().materialize()
+        values = np.ascontiguousarray(
+            np.broadcast_to(np.asarray(value, dtype=self._batch_numpy_type()),
+                            shape)).reshape(-1)
+        self.vars[0].ptr.snode().write_batch(indices.ctypes.data,
+                                             values.ctypes.data, len(indices))
+
     def __repr__(self):
         # make interactive shell happy, prevent materialization
         return '<ti.field>'
@@ -644,6 +644,15 @@ def create_field_member(dtype, name, needs_grad, needs_dual):
         x_dual.ptr.set_name(name + ".dual")
         x_dual.ptr.set_grad_type(SNodeGradType.DUAL)
         x.ptr.set_dual(x_dual.ptr)
+        # The tangents of the other lanes are placed along with x_dual.
+        x_dual.lanes = []
+        for lane in range(1, prog.config().forward_ad_lanes):
+            x_dual_lane = Expr(get_runtime().prog.make_id_expr(""))
+            x_dual_lane.ptr = _ti_core.expr_field(x_dual_lane.ptr, dtype)
+            x_dual_lane.ptr.set_name(f'{name}.dual{lane}')
+            x_dual_lane.ptr.set_grad_type(SNodeGradType.DUAL)
+            x_dual.ptr.add_dual_lane(x_dual_lane.ptr)
+            x_dual.lanes.append(x_dual_lane)
         if needs_dual:
             pytaichi.dual_vars.append(x_dual)
     elif needs_grad or needs_dual:
@@ -704,8 +713,9 @@ def field(dtype,
         x_grad = ScalarField(x_grad)
         x._set_grad(x_grad)
     if x_dual:
+        x_dual_lanes = [ScalarField(lane) for lane in x_dual.lanes]
         x_dual = ScalarField(x_dual)
-        x._set_dual(x_dual)
+        x._set_dual(x_dual, x_dual_lanes)
 
     if shape is None:
         if offset is not None:
@@ -756,7 +766,7 @@ def ndarray(dtype, shape, needs_grad=False):
     """Defines a Taichi ndarray with scalar elements.
 
     Args:
-        dtype (Union[DataType, MatrixType]): Data type of each element. This can be either a scalar type like ti.f32 or a compound type like ti.types.vector(3, ti.i32).
+        dtype (Union[DataType, MatrixType]): Data type of each element. This can be either a scalar type like ti.f32, a quantized type like ti.types.quant.fixed(bits=12), or a compound type like ti.types.vector(3, ti.i32).
         shape (Union[int, tuple[int]]): Shape of the ndarray.
 
     Example:
@@ -770,7 +780,7 @@ def ndarray(dtype, shape, needs_grad=False):
     """
     if isinstance(shape, numbers.Number):
         shape = (shape, )
-    if dtype in all_types:
+    if dtype in all_types or isinstance(dtype, _ti_core.Type):
         x = ScalarNdarray(dtype, shape)
         if needs_grad:
             x_grad = ScalarNdarray(dtype, shape)
@@ -1081,10 +1091,10 @@ def default_cfg():
     return _ti_core.default_compile_config()
 
 
-def call_internal(name, *args, with_runtime_context=True):
+def call_internal(name, *args, with_runtime_context=True, ret_type=i32):
     return expr_init(
         _ti_core.insert_internal_func_call(name, make_expr_group(args),
-                                           with_runtime_context))
+                                           with_runtime_context, ret_type))
 
 
 def get_cuda_compute_capability():
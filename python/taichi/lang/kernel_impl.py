@@ -183,6 +183,62 @@ def _process_args(self, args, kwargs):
     return ret
 
 
+def _get_ret(source, ret_dt):
+    """Converts the return value of type |ret_dt| read through |source|, a
+    kernel or a KernelReturnFuture of the core."""
+    if id(ret_dt) in primitive_types.integer_type_ids:
+        if is_signed(cook_dtype(ret_dt)):
+            return source.get_ret_int(0)
+        return source.get_ret_uint(0)
+    if id(ret_dt) in primitive_types.real_type_ids:
+        return source.get_ret_float(0)
+    if id(ret_dt.dtype) in primitive_types.integer_type_ids:
+        if is_signed(cook_dtype(ret_dt.dtype)):
+            it = iter(source.get_ret_int_tensor(0))
+        else:
+            it = iter(source.get_ret_uint_tensor(0))
+    else:
+        it = iter(source.get_ret_float_tensor(0))
+    return Matrix([[next(it) for _ in range(ret_dt.m)]
+                   for _ in range(ret_dt.n)],
+                  ndim=getattr(ret_dt, 'ndim', 2))
+
+
+class KernelReturnFuture:
+    """The return value of a kernel launched with ``kernel.deferred(...)``.
+
+    The value is copied to the host behind the launch, so that the kernels
+    launched afterwards are queued without waiting for it. Only
+    :meth:`result` waits, and only for this launch.
+
+    Example::
+
+        >>> residual = reduce.deferred(x)
+        >>> update(x)  # Queued right away.
+        >>> if residual.result() < 1e-6:
+        >>>     ...
+    """
+    def __init__(self, future, ret_dt):
+        self._future = future
+        self._ret_dt = ret_dt
+        self._value = None
+        self._resolved = False
+
+    def ready(self):
+        """Returns whether :meth:`result` would return without waiting."""
+        return self._resolved or self._future.ready()
+
+    def result(self):
+        """Waits for the launch, and returns its return value."""
+        if not self._resolved:
+            self._future.wait()
+            self._value = _get_ret(self._future, self._ret_dt)
+            self._resolved = True
+            # Gives the pinned memory back.
+            self._future = None
+        return self._value
+
+
 class Func:
     function_counter = 0
 
@@ -211,6 +267,14 @@ class Func:
         self.has_print = False
 
     def __call__(self, *args, **kwargs):
+        return self._call(args, kwargs, deferred_ret=False)
+
+    def deferred(self, *args, **kwargs):
+        """Launches the kernel like a call, and returns its return value as a
+        :class:`KernelReturnFuture` instead of waiting for the kernel."""
+        return self._call(args, kwargs, deferred_ret=True)
+
+    def _call(self, args, kwargs, deferred_ret):
         args = _process_args(self, args, kwargs)
 
         if not impl.inside_kernel():
@@ -352,6 +416,20 @@ class TaichiCallableTemplateMapper:
         self.num_args = len(arguments)
         self.template_slot_locations = template_slot_locations
         self.mapping = {}
+        # Only the arguments at these positions select the instance, the
+        # others always map to the placeholder in |self.placeholder_key|.
+        self.instantiating_positions = [
+            i for i, arg in enumerate(arguments)
+            if self.is_instantiating(arg.annotation)
+        ]
+        self.placeholder_key = ('#', ) * self.num_args
+
+    @staticmethod
+    def is_instantiating(anno):
+        return isinstance(
+            anno,
+            (template, texture_type.TextureType, texture_type.RWTextureType,
+             ndarray_type.NdarrayType, sparse_matrix_builder))
 
     @staticmethod
     def extract_arg(arg, anno):
@@ -388,9 +466,7 @@ class TaichiCallableTemplateMapper:
         if isinstance(anno, texture_type.TextureType):
             return arg.num_dims, arg.dtype
         if isinstance(anno, texture_type.RWTextureType):
-            # (penguinliong) '0' is the assumed LOD level. We currently don't
-            # support mip-mapping.
-            return arg.num_dims, arg.num_channels, arg.dtype, 0
+            return arg.num_dims, arg.num_channels, arg.dtype, anno.lod
         if isinstance(anno, ndarray_type.NdarrayType):
             if isinstance(arg, taichi.lang._ndarray.ScalarNdarray):
                 anno.check_matched(arg.get_type())
@@ -442,9 +518,12 @@ class TaichiCallableTemplateMapper:
         return '#'
 
     def extract(self, args):
-        extracted = []
-        for arg, kernel_arg in zip(args, self.arguments):
-            extracted.append(self.extract_arg(arg, kernel_arg.annotation))
+        if not self.instantiating_positions:
+            return self.placeholder_key
+        extracted = list(self.placeholder_key)
+        for i in self.instantiating_positions:
+            extracted[i] = self.extract_arg(args[i],
+                                            self.arguments[i].annotation)
         return tuple(extracted)
 
     def lookup(self, args):
@@ -454,10 +533,11 @@ class TaichiCallableTemplateMapper:
             )
 
         key = self.extract(args)
-        if key not in self.mapping:
-            count = len(self.mapping)
-            self.mapping[key] = count
-        return self.mapping[key], key
+        instance_id = self.mapping.get(key)
+        if instance_id is None:
+            instance_id = len(self.mapping)
+            self.mapping[key] = instance_id
+        return instance_id, key
 
 
 def _get_global_vars(_func):
@@ -624,9 +704,91 @@ class Kernel:
             taichi_kernel)
         self.compiled_kernels[key] = taichi_kernel
 
+    def get_packed_arg_kinds(self):
+        """The kinds of the arguments for KernelLaunchContext.set_args, or
+        None if some of them, e.g. textures, must be set one by one."""
+        kinds = []
+        for arg in self.arguments:
+            needed = arg.annotation
+            if isinstance(needed, template):
+                kinds.append(None)
+            elif id(needed) in primitive_types.real_type_ids:
+                kinds.append('f')
+            elif id(needed) in primitive_types.integer_type_ids:
+                kinds.append('i')
+            elif isinstance(needed, sparse_matrix_builder):
+                kinds.append('sparse')
+            elif isinstance(needed, ndarray_type.NdarrayType):
+                kinds.append('ndarray')
+            elif isinstance(needed, MatrixType):
+                if needed.dtype in primitive_types.real_types:
+                    kinds.append('fmat')
+                elif needed.dtype in primitive_types.integer_types:
+                    kinds.append('imat')
+                else:
+                    return None
+            else:
+                return None
+        return kinds
+
+    def get_num_argument_slots(self, kinds):
+        num_slots = 0
+        for arg, kind in zip(self.arguments, kinds):
+            if kind in ('fmat', 'imat'):
+                num_slots += arg.annotation.n * arg.annotation.m
+            elif kind is not None:
+                num_slots += 1
+        return num_slots
+
+    def pack_args(self, kinds, args):
+        """Flattens |args| into the values of KernelLaunchContext.set_args.
+        Returns None if one of them isn't of the expected type, so that the
+        per-argument path reports the error."""
+        values = []
+        for i, v in enumerate(args):
+            kind = kinds[i]
+            if kind is None:
+                continue
+            if kind == 'f':
+                if not isinstance(v, (float, int)):
+                    return None
+                values.append(float(v))
+            elif kind == 'i':
+                if not isinstance(v, int):
+                    return None
+                values.append(v)
+            elif kind == 'sparse':
+                values.append(v._get_ndarray_addr())
+            elif kind == 'ndarray':
+                if not isinstance(v, taichi.lang._ndarray.Ndarray):
+                    return None
+                values.append(v.arr)
+                values.append(v.grad.arr if v.grad else None)
+            else:
+                needed = self.arguments[i].annotation
+                scalar = (float, int) if kind == 'fmat' else int
+                cast = float if kind == 'fmat' else int
+                for a in range(needed.n):
+                    for b in range(needed.m):
+                        val = v[a, b] if needed.ndim == 2 else v[a]
+                        if not isinstance(val, scalar):
+                            return None
+                        values.append(cast(val))
+        return values
+
     def get_function_body(self, t_kernel):
+        packed_arg_kinds = self.get_packed_arg_kinds()
+        num_packed_slots = 0
+        if packed_arg_kinds is not None:
+            num_packed_slots = self.get_num_argument_slots(packed_arg_kinds)
+            max_num_slots = 8 if impl.current_cfg(
+            ).arch == _ti_core.cc else 64
+            if num_packed_slots > max_num_slots:
+                # The per-argument path reports the error.
+                packed_arg_kinds = None
+
         # The actual function body
-        def func__(*args):
+        def func__(*args, deferred_ret=False):
             assert len(args) == len(
                 self.arguments
             ), f'{len(self.arguments)} arguments needed but {len(args)} provided'
@@ -636,7 +798,14 @@ class Kernel:
 
             actual_argument_slot = 0
             launch_ctx = t_kernel.make_launch_context()
-            for i, v in enumerate(args):
+            packed = None
+            if packed_arg_kinds is not None:
+                packed = self.pack_args(packed_arg_kinds, args)
+            if packed is not None:
+                # All the arguments are set in one call into C++.
+                launch_ctx.set_args(packed)
+                actual_argument_slot = num_packed_slots
+            for i, v in enumerate(args if packed is None else ()):
                 needed = self.arguments[i].annotation
                 if isinstance(needed, template):
                     continue
@@ -836,31 +1005,21 @@ class Kernel:
             ret = None
             ret_dt = self.return_type
             has_ret = ret_dt is not None
-
-            if has_ret or self.has_print:
-                runtime_ops.sync()
-
-            if has_ret:
-                if id(ret_dt) in primitive_types.integer_type_ids:
-                    if is_signed(cook_dtype(ret_dt)):
-                        ret = t_kernel.get_ret_int(0)
-                    else:
-                        ret = t_kernel.get_ret_uint(0)
-                elif id(ret_dt) in primitive_types.real_type_ids:
-                    ret = t_kernel.get_ret_float(0)
-                elif id(ret_dt.dtype) in primitive_types.integer_type_ids:
-                    if is_signed(cook_dtype(ret_dt.dtype)):
-                        it = iter(t_kernel.get_ret_int_tensor(0))
-                    else:
-                        it = iter(t_kernel.get_ret_uint_tensor(0))
-                    ret = Matrix([[next(it) for _ in range(ret_dt.m)]
-                                  for _ in range(ret_dt.n)],
-                                 ndim=getattr(ret_dt, 'ndim', 2))
-                else:
-                    it = iter(t_kernel.get_ret_float_tensor(0))
-                    ret = Matrix([[next(it) for _ in range(ret_dt.m)]
-                                  for _ in range(ret_dt.n)],
-                                 ndim=getattr(ret_dt, 'ndim', 2))
+            sync_after_print = self.has_print and impl.current_cfg(
+            ).sync_after_print
+
+            if deferred_ret:
+                if not has_ret:
+                    raise TaichiRuntimeError(
+                        f'Kernel {self.func.__name__} has no return value')
+                if sync_after_print:
+                    runtime_ops.sync()
+                ret = KernelReturnFuture(t_kernel.get_ret_future(), ret_dt)
+            else:
+                if has_ret or sync_after_print:
+                    runtime_ops.sync()
+                if has_ret:
+                    ret = _get_ret(t_kernel, ret_dt)
             if callbacks:
                 for c in callbacks:
                     c()
@@ -875,6 +1034,23 @@ class Kernel:
         self.materialize(key=key, args=args, arg_features=arg_features)
         return key
 
+    def gather_access_footprints(self, *args):
+        """Returns how each offloaded task of this kernel, when called with
+        ``args``, accesses the fields, as a list of dicts from the ids of the
+        SNodes to ``(reads, writes)``. For each axis, ``reads`` holds the
+        inclusive range ``(low, high)`` of the offsets of the read indices from
+        the loop index, or None if they are not the loop index plus constants.
+        ``reads`` is empty if the SNode is not read. The same goes for
+        ``writes``.
+        """
+        instance_id, arg_features = self.mapper.lookup(args)
+        # The footprints are gathered on a copy of the kernel that is lowered
+        # in place and never launched.
+        key = (self.func, f'{instance_id}_footprints', self.autodiff_mode)
+        self.materialize(key=key, args=args, arg_features=arg_features)
+        return self.compiled_kernels[key].gather_access_footprints(
+            impl.current_cfg())
+
     # For small kernels (< 3us), the performance can be pretty sensitive to overhead in __call__
     # Thus this part needs to be fast. (i.e. < 3us on a 4 GHz x64 CPU)
     @_shell_pop_print
@@ -906,7 +1082,8 @@ class Kernel:
             )
             impl.current_cfg().opt_level = 1
         key = self.ensure_compiled(*args)
-        return self.runtime.compiled_functions[key](*args)
+        return self.runtime.compiled_functions[key](*args,
+                                                    deferred_ret=deferred_ret)
 
 
 # For a Taichi class definition like below:
@@ -984,6 +1161,7 @@ def _kernel_impl(_func, level_of_class_stackframe, verbose=False):
                 raise type(e)('\n' + str(e)) from None
 
         wrapped.grad = adjoint
+        wrapped.deferred = primal.deferred
 
     wrapped._is_wrapped_kernel = True
     wrapped._is_classkernel = is_classkernel
@@ -1047,6 +1225,11 @@ class _BoundedDifferentiableMethod:
     def grad(self, *args, **kwargs):
         return self._adjoint(self._kernel_owner, *args, **kwargs)
 
+    def deferred(self, *args, **kwargs):
+        if self._is_staticmethod:
+            return self._primal.deferred(*args, **kwargs)
+        return self._primal.deferred(self._kernel_owner, *args, **kwargs)
+
 
 def data_oriented(cls):
     """Marks a class as Taichi compatible.
@@ -8,7 +8,7 @@ from taichi.lang.exception import TaichiSyntaxError
 from taichi.lang.field import Field, ScalarField
 from taichi.lang.matrix import Matrix, MatrixField
 from taichi.lang.struct import StructField
-from taichi.lang.util import python_scope
+from taichi.lang.util import python_scope, to_numpy_type
 from taichi.types import u16, u32
 from taichi.types.compound_types import CompoundType
 
@@ -334,6 +334,16 @@ class MeshInstance:
         _ti_core.set_index_mapping(self.mesh_ptr, element_type, conv_type,
                                    mapping.vars[0].ptr.snode())
 
+    def set_owned_num(self, element_type: MeshElementType,
+                      owned_num: ScalarField):
+        _ti_core.set_owned_num(self.mesh_ptr, element_type,
+                               owned_num.vars[0].ptr.snode())
+
+    def set_total_num(self, element_type: MeshElementType,
+                      total_num: ScalarField):
+        _ti_core.set_total_num(self.mesh_ptr, element_type,
+                               total_num.vars[0].ptr.snode())
+
     def set_num_patches(self, num_patches: int):
         _ti_core.set_num_patches(self.mesh_ptr, num_patches)
 
@@ -370,6 +380,93 @@ class MeshInstance:
         return _ti_core.get_relation_access(self.mesh_ptr, from_index.ptr,
                                             to_element_type, neighbor_idx_ptr)
 
+    @python_scope
+    def update_topology(self,
+                        remove_cells=None,
+                        add_cells=None,
+                        add_positions=None):
+        """Removes and inserts cells of a mesh built with
+        `ti.Mesh.build_meta(..., dynamic=True)`, re-uploading only the
+        patches the change touches.
+
+        Vertices are never removed. The global indices of removed edges,
+        faces and cells are reused by later insertions, and attributes placed
+        with `reorder=True` are moved along with their elements.
+
+        Args:
+            remove_cells (numpy.ndarray, optional): global indices of the
+                cells to remove.
+            add_cells (numpy.ndarray, optional): (num_cells, 3) or
+                (num_cells, 4) vertex indices of the cells to insert, which
+                may refer to the vertices of `add_positions`.
+            add_positions (numpy.ndarray, optional): (num_vertices, 3)
+                positions of the vertices to append.
+
+        Returns:
+            Dict[str, numpy.ndarray]: the global indices of the inserted
+            verts, edges, faces and cells.
+        """
+        if getattr(self, "dynamic_patcher", None) is None:
+            raise RuntimeError(
+                "The mesh was not built with ti.Mesh.build_meta(..., "
+                "dynamic=True)")
+        from taichi._kernels import (  # pylint: disable=C0415
+            move_field_entries, scatter_to_field)
+
+        remove_cells = np.ascontiguousarray(
+            [] if remove_cells is None else remove_cells,
+            dtype=np.uint32).reshape(-1)
+        add_cells = np.ascontiguousarray([] if add_cells is None else
+                                         add_cells,
+                                         dtype=np.uint32).reshape(-1)
+        add_positions = np.ascontiguousarray(
+            np.zeros((0, 3)) if add_positions is None else add_positions,
+            dtype=np.float32).reshape(-1, 3)
+        update = self.dynamic_patcher.update(remove_cells, add_cells,
+                                             add_positions.shape[0])
+
+        def scatter(field, entries):
+            indices, values = entries
+            if indices.shape[0] > 0:
+                scatter_to_field(
+                    field, indices,
+                    values.astype(to_numpy_type(field.dtype), copy=False))
+
+        metadata = self.metadata
+        for order, element in enumerate(update["elements"]):
+            fields = metadata.element_fields[MeshElementType(order)]
+            scatter(fields["owned_num"], element["owned_nums"])
+            scatter(fields["total_num"], element["total_nums"])
+            scatter(fields["l2g"], element["l2g_mapping"])
+            scatter(fields["l2r"], element["l2r_mapping"])
+            scatter(fields["g2r"], element["g2r_mapping"])
+        for fields, relation in zip(metadata.relation_fields.values(),
+                                    update["relations"]):
+            scatter(fields["value"], relation["value"])
+            if fields["from_order"] <= fields["to_order"]:
+                scatter(fields["offset"], relation["offset"])
+                scatter(fields["patch_offset"], relation["patch_offset"])
+
+        for order, moved in enumerate(update["moved"]):
+            if moved.shape[0] == 0:
+                continue
+            moved = moved.reshape(-1, 2)
+            element_field = self.fields[MeshElementType(order)]
+            for key, attr in element_field.attr_dict.items():
+                if not attr.reorder:
+                    continue
+                field = element_field.field_dict[key]
+                move_field_entries(field, moved)
+                if attr.needs_grad:
+                    move_field_entries(field.grad, moved)
+
+        self._vert_position = np.concatenate(
+            [self._vert_position, add_positions])
+        return {
+            element_type_name(MeshElementType(order)): added
+            for order, added in enumerate(update["added"])
+        }
+
 
 class MeshMetadata:
     def __init__(self, data):
@@ -399,6 +496,11 @@ class MeshMetadata:
                 dtype=u32, shape=element["l2r_mapping"].shape[0])
             self.element_fields[element_type]["g2r"] = impl.field(
                 dtype=u32, shape=element["g2r_mapping"].shape[0])
+            if "owned_nums" in element:
+                self.element_fields[element_type]["owned_num"] = impl.field(
+                    dtype=u32, shape=self.num_patches)
+                self.element_fields[element_type]["total_num"] = impl.field(
+                    dtype=u32, shape=self.num_patches)
 
         for relation in data["relations"]:
             from_order = relation["from_order"]
@@ -428,6 +530,11 @@ class MeshMetadata:
                 element["l2r_mapping"])
             self.element_fields[element_type]["g2r"].from_numpy(
                 element["g2r_mapping"])
+            if "owned_nums" in element:
+                self.element_fields[element_type]["owned_num"].from_numpy(
+                    np.array(element["owned_nums"]))
+                self.element_fields[element_type]["total_num"].from_numpy(
+                    np.array(element["total_nums"]))
 
         for relation in data["relations"]:
             from_order = relation["from_order"]
@@ -448,6 +555,8 @@ class MeshMetadata:
             self.patcher = data["patcher"]
         else:
             self.patcher = None
+        # Set by ti.Mesh.build_meta(..., dynamic=True).
+        self.dynamic_patcher = None
 
 
 # Define the Mesh Type, stores the field type info
@@ -493,6 +602,11 @@ class MeshBuilder:
                                        metadata.element_fields[element]["l2r"])
             instance.set_index_mapping(element, ConvType.g2r,
                                        metadata.element_fields[element]["g2r"])
+            if "owned_num" in metadata.element_fields[element]:
+                instance.set_owned_num(
+                    element, metadata.element_fields[element]["owned_num"])
+                instance.set_total_num(
+                    element, metadata.element_fields[element]["total_num"])
 
         for rel_type in metadata.relation_fields:
             from_order = metadata.relation_fields[rel_type]["from_order"]
@@ -508,6 +622,8 @@ class MeshBuilder:
 
         instance._vert_position = metadata.attrs["x"]
         instance.patcher = metadata.patcher
+        instance.metadata = metadata
+        instance.dynamic_patcher = metadata.dynamic_patcher
 
         return instance
 
@@ -555,6 +671,11 @@ class Mesh:
                                        metadata.element_fields[element]["l2r"])
             instance.set_index_mapping(element, ConvType.g2r,
                                        metadata.element_fields[element]["g2r"])
+            if "owned_num" in metadata.element_fields[element]:
+                instance.set_owned_num(
+                    element, metadata.element_fields[element]["owned_num"])
+                instance.set_total_num(
+                    element, metadata.element_fields[element]["total_num"])
 
         for rel_type in metadata.relation_fields:
             from_order = metadata.relation_fields[rel_type]["from_order"]
@@ -570,6 +691,8 @@ class Mesh:
 
         instance._vert_position = metadata.attrs["x"]
         instance.patcher = metadata.patcher
+        instance.metadata = metadata
+        instance.dynamic_patcher = metadata.dynamic_patcher
 
         return instance
 
@@ -583,6 +706,81 @@ class Mesh:
     def generate_meta(data):
         return MeshMetadata(data)
 
+    @staticmethod
+    def build_meta(positions,
+                   cells,
+                   relations=None,
+                   max_elements_per_patch=None,
+                   shared_memory_bytes=48 * 1024,
+                   bytes_per_element=32,
+                   dynamic=False,
+                   slack=0.25):
+        """Partitions a triangle or tetrahedron mesh into patches natively,
+        instead of loading metadata generated offline.
+
+        Patches are grown along a Morton curve through the cell centroids, and
+        the elements of each type are renumbered in the order the curve first
+        touches them, so that attributes placed with `reorder=True` are laid
+        out for cache reuse.
+
+        Args:
+            positions (numpy.ndarray): (num_vertices, 3) vertex positions.
+            cells (numpy.ndarray): (num_cells, 3) triangles or (num_cells, 4)
+                tetrahedra as vertex indices.
+            relations (List[str], optional): the relations kernels access,
+                e.g. `["CV", "VV"]`. All relations of the mesh by default.
+            max_elements_per_patch (int, optional): the number of elements of
+                any type the owned cells of a patch may touch. Derived from
+                `shared_memory_bytes / bytes_per_element` by default, so that
+                the attributes cached by `ti.mesh_local()` fit in shared
+                memory.
+            shared_memory_bytes (int): shared memory available to a block.
+            bytes_per_element (int): bytes cached per element of a patch.
+            dynamic (bool): leaves each patch room to grow by `slack`, so
+                that the topology of the mesh can be changed in place with
+                `MeshInstance.update_topology()`. The attributes of a dynamic
+                mesh have room for the elements to be inserted, and the
+                owned and total elements of each patch are stored besides
+                their offsets.
+            slack (float): the relative room of a dynamic mesh.
+
+        Returns:
+            MeshMetadata: the metadata to build a mesh with.
+        """
+        positions = np.ascontiguousarray(positions, dtype=np.float32)
+        cells = np.ascontiguousarray(cells, dtype=np.uint32)
+        if positions.ndim != 2 or positions.shape[1] != 3:
+            raise ValueError("positions must have the shape (num_vertices, 3)")
+        if cells.ndim != 2 or cells.shape[1] not in (3, 4):
+            raise ValueError(
+                "cells must have the shape (num_cells, 3) or (num_cells, 4)")
+        topology = MeshTopology.Triangle if cells.shape[
+            1] == 3 else MeshTopology.Tetrahedron
+        top_order = cells.shape[1] - 1
+        if relations is None:
+            relations = [
+                relation_by_orders(i, j) for i in range(top_order + 1)
+                for j in range(top_order + 1)
+            ]
+        else:
+            relations = [getattr(MeshRelationType, name) for name in relations]
+        if dynamic:
+            patcher = _ti_core.DynamicPatchedMesh(topology, positions, cells,
+                                                  relations,
+                                                  max_elements_per_patch or 0,
+                                                  shared_memory_bytes,
+                                                  bytes_per_element, slack)
+            data = patcher.metadata()
+        else:
+            data = _ti_core.patch_mesh(topology, positions, cells, relations,
+                                       max_elements_per_patch or 0,
+                                       shared_memory_bytes, bytes_per_element)
+        data["attrs"] = {"x": positions}
+        metadata = MeshMetadata(data)
+        if dynamic:
+            metadata.dynamic_patcher = patcher
+        return metadata
+
 
 def _TriMesh():
     """(Deprecated) Create a triangle mesh (a set of vert/edge/face elements, attributes, and connectivity) builder.
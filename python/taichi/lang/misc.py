@@ -616,12 +616,35 @@ def _bit_vectorize():
     get_runtime().compiling_callable.ast_builder().bit_vectorize()
 
 
+def _tile_size(size):
+    """Set the shape of the tiles that struct fors over dense fields iterate over.
+    """
+    if isinstance(size, int):
+        size = [size]
+    get_runtime().compiling_callable.ast_builder().tile_shape(list(size))
+
+
+def _sort_elements():
+    """Iterate the next struct for over a sparse field in coordinate order.
+    """
+    get_runtime().compiling_callable.ast_builder().sort_elements()
+
+
+def _balance_elements():
+    """Spread the cells of the next struct for evenly over the GPU threads.
+    """
+    get_runtime().compiling_callable.ast_builder().balance_elements()
+
+
 def loop_config(*,
                 block_dim=None,
                 serialize=False,
                 parallelize=None,
                 block_dim_adaptive=True,
-                bit_vectorize=False):
+                bit_vectorize=False,
+                tile_size=None,
+                sort_elements=False,
+                balance_elements=False):
     """Sets directives for the next loop
 
     Args:
@@ -630,6 +653,9 @@ def loop_config(*,
         parallelize (int): The number of threads to use on CPU
         block_dim_adaptive (bool): Whether to allow backends set block_dim adaptively, enabled by default
         bit_vectorize (bool): Whether to enable bit vectorization of struct fors on quant_arrays.
+        tile_size (Union[int, Tuple[int]]): The shape of the tiles that a struct for over a multi-dimensional dense field iterates over. Each tile is rounded down to divide the field.
+        sort_elements (bool): Whether a struct for over a sparse field visits the active blocks in the coordinate order of the field, so that neighbouring blocks are processed together. This makes building the lists of active blocks slower on GPUs.
+        balance_elements (bool): Whether a struct for on CUDA spreads the cells of all the active blocks evenly over the threads, instead of running a GPU block per active block. This helps with dynamic fields whose cells hold very different numbers of elements, e.g. particle lists built with `ti.append`. Only struct fors without block local storage, and with block dims that are multiples of 32, are balanced.
 
     Examples::
 
@@ -682,6 +708,15 @@ def loop_config(*,
     if bit_vectorize:
         _bit_vectorize()
 
+    if tile_size is not None:
+        _tile_size(tile_size)
+
+    if sort_elements:
+        _sort_elements()
+
+    if balance_elements:
+        _balance_elements()
+
 
 def global_thread_idx():
     """Returns the global thread id of this running thread,
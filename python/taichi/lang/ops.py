@@ -625,6 +625,20 @@ def bit_not(a):
     return _unary_operation(_ti_core.expr_bit_not, _bt_ops_mod.invert, a)
 
 
+@unary
+def popcnt(a):
+    """The population count function.
+
+    Args:
+        a (Union[:class:`~taichi.lang.expr.Expr`, :class:`~taichi.lang.matrix.Matrix`]): An integer or an integer matrix.
+
+    Returns:
+        The number of set bits in the binary representation of `a`.
+    """
+    return _unary_operation(_ti_core.expr_popcnt,
+                            lambda x: bin(x & ((1 << 64) - 1)).count('1'), a)
+
+
 @unary
 def logical_not(a):
     """The logical not function.
@@ -1530,5 +1544,5 @@ __all__ = [
     "atomic_max", "atomic_sub", "atomic_min", "atomic_add", "bit_cast",
     "bit_shr", "cast", "ceil", "cos", "exp", "floor", "log", "random",
     "raw_mod", "raw_div", "round", "rsqrt", "sin", "sqrt", "tan", "tanh",
-    "max", "min", "select", "abs", "pow"
+    "max", "min", "select", "abs", "pow", "popcnt"
 ]
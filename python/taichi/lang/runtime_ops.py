@@ -1,3 +1,5 @@
+import contextlib
+
 from taichi.lang import impl
 
 
@@ -8,4 +10,188 @@ def sync():
     impl.get_runtime().sync()
 
 
-__all__ = ['sync']
+@contextlib.contextmanager
+def cuda_stream(stream):
+    """Launches the Taichi kernels, fills and copies issued by the calling
+    thread in the scope on the given CUDA stream, instead of the default one.
+
+    Work on the stream is only ordered with the caller's own work on it, so
+    that e.g. a PyTorch training step on a side stream is not serialized
+    against every Taichi call. Has no effect on backends other than CUDA
+    when ``stream`` is 0.
+
+    Args:
+        stream (Union[int, torch.cuda.Stream]): A raw ``CUstream``, or any
+            object with a ``cuda_stream`` attribute holding one.
+
+    Example::
+
+        >>> with ti.cuda_stream(torch.cuda.current_stream()):
+        >>>     step(x)
+    """
+    handle = int(getattr(stream, 'cuda_stream', stream))
+    prog = impl.get_runtime().prog
+    prev = prog.get_launch_stream()
+    prog.set_launch_stream(handle)
+    try:
+        yield
+    finally:
+        prog.set_launch_stream(prev)
+
+
+def _snapshot_ndarrays(ndarrays):
+    return [ndarray.arr for ndarray in ndarrays]
+
+
+def save_snapshot(path, ndarrays=(), compress=False):
+    """Writes the data of all the fields and of the given ndarrays to a file,
+    copying the device memory directly instead of going through
+    :func:`to_numpy`.
+
+    Args:
+        path (str): The file to write.
+        ndarrays (Sequence[Ndarray]): The ndarrays to save, in the order
+            :func:`load_snapshot` has to be given them.
+        compress (bool): Whether to deflate the data, on multiple threads.
+            Slower, but smaller for data with redundancy.
+
+    Fields under pointer, dynamic or hash SNodes are not supported.
+    """
+    impl.get_runtime().materialize()
+    impl.get_runtime().prog.save_snapshot(path, _snapshot_ndarrays(ndarrays),
+                                          compress)
+
+
+def load_snapshot(path, ndarrays=()):
+    """Restores the data of all the fields and of the given ndarrays from a
+    file written by :func:`save_snapshot`.
+
+    The fields must have been declared in the same way, and the ndarrays must
+    have the same sizes and be given in the same order as when saving.
+
+    Args:
+        path (str): The file to read.
+        ndarrays (Sequence[Ndarray]): The ndarrays to restore.
+    """
+    impl.get_runtime().materialize()
+    impl.get_runtime().prog.load_snapshot(path, _snapshot_ndarrays(ndarrays))
+
+
+def _bulk_layout(fields):
+    """Lays the given fields out in one flat array per dtype.
+
+    Returns a dict from each dtype to the field members of that dtype, with
+    the offset and stride in the flat array of each of them, and the size of
+    the array. The members of matrix fields are interleaved the same way as
+    in the arrays returned by their ``to_numpy``. Members rather than fields
+    are passed to the kernels, so that they are only compiled once.
+    """
+    from taichi.lang.matrix import MatrixField  # pylint: disable=C0415
+    groups = {}
+    sizes = {}
+    for field in fields:
+        members, offsets, strides = groups.setdefault(field.dtype,
+                                                      ([], [], []))
+        base = sizes.get(field.dtype, 0)
+        num_cells = 1
+        for n in field.shape:
+            num_cells *= n
+        if isinstance(field, MatrixField):
+            width = field.n * field.m
+            for p in range(field.n):
+                for q in range(field.m):
+                    members.append(field.vars[p * field.m + q])
+                    offsets.append(base + p * field.m + q)
+                    strides.append(width)
+        else:
+            width = 1
+            members.append(field.vars[0])
+            offsets.append(base)
+            strides.append(1)
+        sizes[field.dtype] = base + num_cells * width
+    return {
+        dtype: (tuple(members), tuple(offsets), tuple(strides), sizes[dtype])
+        for dtype, (members, offsets, strides) in groups.items()
+    }
+
+
+def _numpy_shape(field):
+    from taichi.lang.matrix import MatrixField  # pylint: disable=C0415
+    if isinstance(field, MatrixField):
+        # As with keep_dims=False.
+        if field.m == 1:
+            return field.shape + (field.n, )
+        return field.shape + (field.n, field.m)
+    return field.shape
+
+
+def fields_to_numpy(fields):
+    """Copies many fields to numpy arrays at once.
+
+    The fields of each dtype are copied by a single kernel into one host
+    array, so that exporting many fields takes a launch per dtype and a
+    single sync, instead of both for each field as with ``to_numpy``.
+
+    Args:
+        fields (Sequence[Union[ScalarField, MatrixField]]): The fields to copy.
+
+    Returns:
+        List[numpy.ndarray]: One array for each field, shaped as its
+        ``to_numpy`` would return it. The arrays of the fields of the same
+        dtype are views into the same buffer.
+    """
+    import numpy as np  # pylint: disable=C0415
+    from taichi._kernels import tensors_to_ext_arr  # pylint: disable=C0415
+    from taichi.lang.util import to_numpy_type  # pylint: disable=C0415
+    buffers = {}
+    for dtype, (members, offsets, strides,
+                size) in _bulk_layout(fields).items():
+        buffers[dtype] = np.zeros(size, dtype=to_numpy_type(dtype))
+        tensors_to_ext_arr(members, offsets, strides, buffers[dtype])
+    sync()
+
+    arrays = []
+    offsets = {dtype: 0 for dtype in buffers}
+    for field in fields:
+        shape = _numpy_shape(field)
+        size = int(np.prod(shape, dtype=np.int64))
+        begin = offsets[field.dtype]
+        arrays.append(buffers[field.dtype][begin:begin + size].reshape(shape))
+        offsets[field.dtype] += size
+    return arrays
+
+
+def fields_from_numpy(fields, arrays):
+    """Copies many numpy arrays to fields at once, see
+    :func:`fields_to_numpy`.
+
+    Args:
+        fields (Sequence[Union[ScalarField, MatrixField]]): The fields to copy
+            to.
+        arrays (Sequence[numpy.ndarray]): One array for each field, shaped as
+            its ``from_numpy`` takes it.
+    """
+    import numpy as np  # pylint: disable=C0415
+    from taichi._kernels import ext_arr_to_tensors  # pylint: disable=C0415
+    from taichi.lang.util import to_numpy_type  # pylint: disable=C0415
+    if len(fields) != len(arrays):
+        raise ValueError(f"{len(fields)} fields but {len(arrays)} arrays")
+    parts = {}
+    for field, arr in zip(fields, arrays):
+        shape = _numpy_shape(field)
+        if tuple(arr.shape) != tuple(shape):
+            raise ValueError(f"field shape {shape} does not match"
+                             f" the numpy array shape {arr.shape}")
+        parts.setdefault(field.dtype, []).append(
+            np.ravel(arr).astype(to_numpy_type(field.dtype), copy=False))
+    for dtype, (members, offsets, strides,
+                _) in _bulk_layout(fields).items():
+        ext_arr_to_tensors(np.concatenate(parts[dtype]), members, offsets,
+                           strides)
+    sync()
+
+
+__all__ = [
+    'sync', 'cuda_stream', 'save_snapshot', 'load_snapshot', 'fields_to_numpy',
+    'fields_from_numpy'
+]
@@ -1,4 +1,7 @@
-from taichi.lang import impl
+from taichi._lib import core as _ti_core
+from taichi.lang import impl, ops
+from taichi.lang.matrix import Vector
+from taichi.types.primitive_types import f32
 
 
 def all_nonzero(mask, predicate):
@@ -129,6 +132,47 @@ def sync(mask):
     return impl.call_internal("warp_barrier", mask, with_runtime_context=False)
 
 
+# The elements of the fragments of A and B, and the mma.sync runtime function.
+_mma_shapes = {
+    'tf32': (4, 2, 'cuda_mma_sync_m16n8k8_tf32'),
+    'f16': (8, 4, 'cuda_mma_sync_m16n8k16_f16'),
+    'bf16': (8, 4, 'cuda_mma_sync_m16n8k16_bf16'),
+}
+
+
+def mma_sync(a, b, c, precision='f16'):
+    """Warp-level matrix multiply-accumulate D = A @ B + C on Tensor Cores.
+
+    The tile is m16n8k8 with ``precision='tf32'``, and m16n8k16 with ``'f16'``
+    or ``'bf16'``. ``a``, ``b`` and ``c`` are the fragments of A, B and C held
+    by the calling lane, as vectors of f32 in the layout of PTX ``mma.sync``,
+    and the fragment of D is returned as a 4D f32 vector. The inputs are
+    rounded to ``precision``, and the products accumulate in f32. All the 32
+    lanes of the warp must call it together.
+
+    GPUs older than sm_80 run the same tile product with warp shuffles.
+    """
+    if precision not in _mma_shapes:
+        raise ValueError(f"Unsupported mma_sync precision: {precision}")
+    if impl.get_runtime().prog.config().arch != _ti_core.cuda:
+        raise RuntimeError("mma_sync is only available on CUDA")
+    num_a, num_b, func_name = _mma_shapes[precision]
+    if a.n != num_a or b.n != num_b or c.n != 4:
+        raise ValueError(
+            f"The {precision} fragments of A, B and C take {num_a}, {num_b} "
+            f"and 4 elements, got {a.n}, {b.n} and {c.n}")
+    args = [ops.cast(a[i], f32) for i in range(num_a)]
+    args += [ops.cast(b[i], f32) for i in range(num_b)]
+    args += [ops.cast(c[i], f32) for i in range(4)]
+    return Vector([
+        impl.call_internal(func_name,
+                           *args,
+                           k,
+                           with_runtime_context=False,
+                           ret_type=f32) for k in range(4)
+    ])
+
+
 __all__ = [
     'all_nonzero',
     'any_nonzero',
@@ -145,4 +189,5 @@ __all__ = [
     'match_all',
     'active_mask',
     'sync',
+    'mma_sync',
 ]
@@ -1,5 +1,6 @@
 import numbers
 
+import numpy as np
 from taichi._lib import core as _ti_core
 from taichi.lang import expr, impl, matrix
 from taichi.lang.exception import TaichiRuntimeError
@@ -22,19 +23,26 @@ class SNode:
     def __init__(self, ptr):
         self.ptr = ptr
 
-    def dense(self, axes, dimensions):
+    def dense(self, axes, dimensions, morton=False):
         """Adds a dense SNode as a child component of `self`.
 
         Args:
             axes (List[Axis]): Axes to activate.
             dimensions (Union[List[int], int]): Shape of each axis.
+            morton (bool): Whether the cells are ordered along a Z-order
+                (Morton) curve instead of row-major, which keeps neighbors
+                along every axis close in memory. The shape of each axis has
+                to be a power of two.
 
         Returns:
             The added :class:`~taichi.lang.SNode` instance.
         """
         if isinstance(dimensions, numbers.Number):
             dimensions = [dimensions] * len(axes)
-        return SNode(self.ptr.dense(axes, dimensions, get_traceback()))
+        snode = self.ptr.dense(axes, dimensions, get_traceback())
+        if morton:
+            snode.morton(True)
+        return SNode(snode)
 
     def pointer(self, axes, dimensions):
         """Adds a pointer SNode as a child component of `self`.
@@ -46,22 +54,33 @@ class SNode:
         Returns:
             The added :class:`~taichi.lang.SNode` instance.
         """
-        if not _ti_core.is_extension_supported(impl.current_cfg().arch,
-                                               _ti_core.Extension.sparse):
-            raise TaichiRuntimeError(
-                "Pointer SNode is not supported on this backend.")
+        check_sparse_supported("Pointer")
         if isinstance(dimensions, numbers.Number):
             dimensions = [dimensions] * len(axes)
         return SNode(self.ptr.pointer(axes, dimensions, get_traceback()))
 
-    @staticmethod
-    def _hash(axes, dimensions):
-        # original code is #def hash(self,axes, dimensions) without #@staticmethod   before fix pylint R0201
-        """Not supported."""
-        raise RuntimeError('hash not yet supported')
-        # if isinstance(dimensions, int):
-        #     dimensions = [dimensions] * len(axes)
-        # return SNode(self.ptr.hash(axes, dimensions))
+    def hash(self, axes, dimensions, table_size=None):
+        """Adds a hash SNode as a child component of `self`.
+
+        Only the cells activated so far take up memory, in an open-addressing
+        table. A hash SNode must be a child of the root.
+
+        Args:
+            axes (List[Axis]): Axes to activate.
+            dimensions (Union[List[int], int]): Shape of each axis.
+            table_size (int): Number of distinct cells that can be
+                activated. Defaults to the number of cells, up to 65536.
+
+        Returns:
+            The added :class:`~taichi.lang.SNode` instance.
+        """
+        check_sparse_supported("Hash", gfx=False)
+        if isinstance(dimensions, numbers.Number):
+            dimensions = [dimensions] * len(axes)
+        if table_size is None:
+            table_size = min(int(np.prod(dimensions)), 65536)
+        return SNode(
+            self.ptr.hash(axes, dimensions, table_size, get_traceback()))
 
     def dynamic(self, axis, dimension, chunk_size=None):
         """Adds a dynamic SNode as a child component of `self`.
@@ -69,15 +88,13 @@ class SNode:
         Args:
             axis (List[Axis]): Axis to activate, must be 1.
             dimension (int): Shape of the axis.
-            chunk_size (int): Chunk size.
+            chunk_size (int): Chunk size. Larger chunks are used when the
+                shape would need more than 64 of them.
 
         Returns:
             The added :class:`~taichi.lang.SNode` instance.
         """
-        if not _ti_core.is_extension_supported(impl.current_cfg().arch,
-                                               _ti_core.Extension.sparse):
-            raise TaichiRuntimeError(
-                "Dynamic SNode is not supported on this backend.")
+        check_sparse_supported("Dynamic")
         assert len(axis) == 1
         if chunk_size is None:
             chunk_size = dimension
@@ -94,10 +111,7 @@ class SNode:
         Returns:
             The added :class:`~taichi.lang.SNode` instance.
         """
-        if not _ti_core.is_extension_supported(impl.current_cfg().arch,
-                                               _ti_core.Extension.sparse):
-            raise TaichiRuntimeError(
-                "Bitmasked SNode is not supported on this backend.")
+        check_sparse_supported("Bitmasked")
         if isinstance(dimensions, numbers.Number):
             dimensions = [dimensions] * len(axes)
         return SNode(self.ptr.bitmasked(axes, dimensions, get_traceback()))
@@ -308,6 +322,69 @@ class SNode:
                 snode_deactivate_dynamic  # pylint: disable=C0415
             snode_deactivate_dynamic(self)
 
+    def _cell_indices(self, indices):
+        """Converts a list or mask of cells of `self` into an array of unique
+        cell indices, sorted in coordinate order."""
+        indices = np.asarray(indices)
+        dim = len(self.shape)
+        if indices.dtype == np.bool_:
+            if indices.shape != self.shape:
+                raise TaichiRuntimeError(
+                    f"The mask has shape {indices.shape}, but the SNode has shape {self.shape}."
+                )
+            indices = np.argwhere(indices)
+        indices = indices.reshape(-1, dim)
+        return np.unique(indices.astype(np.int32), axis=0)
+
+    def activate_cells(self, indices):
+        """Activates many cells of `self` at once, from the Python scope.
+
+        The cells are deduplicated and sorted on the host. The sparse ancestors
+        of `self` are then activated level by level, each level in a single
+        parallel pass, so that every node along the path is allocated once and
+        the passes further down only find active ancestors.
+
+        Args:
+            indices (Union[numpy.ndarray, List]): Either the indices of the
+                cells, with shape `(n, len(self.shape))`, or a boolean mask with
+                the shape of `self`.
+        """
+        from taichi._kernels import \
+            snode_activate_cells  # pylint: disable=C0415
+        indices = self._cell_indices(indices)
+        if len(indices) == 0:
+            return
+        SNodeType = _ti_core.SNodeType
+        sparse_types = (SNodeType.pointer, SNodeType.bitmasked,
+                        SNodeType.hash)
+        if self.ptr.type not in sparse_types:
+            raise TaichiRuntimeError(
+                f"Cannot activate the cells of a {self.ptr.type.name} SNode.")
+        dim = len(self.shape)
+        for node in self._path_from_root()[1:]:
+            if node.ptr.type not in sparse_types or len(node.shape) != dim:
+                continue
+            scale = np.array(self.shape) // np.array(node.shape)
+            node_indices = indices
+            if node != self:
+                node_indices = np.unique(indices // scale, axis=0)
+            snode_activate_cells(node, node_indices.astype(np.int32))
+
+    def deactivate_cells(self, indices):
+        """Deactivates many cells of `self` at once, from the Python scope.
+
+        Args:
+            indices (Union[numpy.ndarray, List]): Either the indices of the
+                cells, with shape `(n, len(self.shape))`, or a boolean mask with
+                the shape of `self`.
+        """
+        from taichi._kernels import \
+            snode_deactivate_cells  # pylint: disable=C0415
+        indices = self._cell_indices(indices)
+        if len(indices) == 0:
+            return
+        snode_deactivate_cells(self, indices)
+
     def __repr__(self):
         type_ = str(self.ptr.type)[len('SNodeType.'):]
         return f'<ti.SNode of type {type_}>'
@@ -337,6 +414,16 @@ class SNode:
         return ret
 
 
+def check_sparse_supported(name, gfx=True):
+    arch = impl.current_cfg().arch
+    if _ti_core.is_extension_supported(arch, _ti_core.Extension.sparse):
+        return
+    # The SPIR-V codegen implements pointer, dynamic and bitmasked SNodes.
+    if gfx and arch == _ti_core.Arch.vulkan:
+        return
+    raise TaichiRuntimeError(f"{name} SNode is not supported on this backend.")
+
+
 def rescale_index(a, b, I):
     """Rescales the index 'I' of field (or SNode) 'a' to match the shape of SNode 'b'.
 
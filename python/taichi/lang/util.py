@@ -120,6 +120,9 @@ def to_numpy_type(dt):
         return np.uint64
     if dt == f16:
         return np.half
+    if _ti_core.is_quant(dt):
+        # Quantized values are exchanged in their compute type.
+        return to_numpy_type(dt.compute_type())
     assert False
 
 
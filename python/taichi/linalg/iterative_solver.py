@@ -0,0 +1,468 @@
+from taichi._lib import core as _ti_core
+from taichi.lang._ndarray import Ndarray, ScalarNdarray
+from taichi.lang.exception import TaichiRuntimeError
+from taichi.lang.impl import get_runtime
+from taichi.lang.kernel_impl import kernel
+from taichi.lang.ops import max as ti_max
+from taichi.lang.ops import sqrt
+from taichi.linalg.sparse_matrix import SparseMatrix
+from taichi.types import ndarray_type
+from taichi.types.annotations import template
+from taichi.types.primitive_types import f32
+
+# Slots of the scalar ndarray shared by the solver kernels. The scalars stay
+# on the device, so the host only synchronizes to test for convergence.
+_DONE = 0
+_ITER = 1
+_THRESHOLD = 2
+_RES = 3
+_S0 = 4  # First algorithm specific slot.
+_NUM_SCALARS = 24
+
+
+@kernel
+def _dot(x: ndarray_type.ndarray(), y: ndarray_type.ndarray(),
+         s: ndarray_type.ndarray(), slot: template()):
+    s[slot] = 0.0
+    for i in range(x.shape[0]):
+        s[slot] += x[i] * y[i]
+
+
+@kernel
+def _copy(src: ndarray_type.ndarray(), dst: ndarray_type.ndarray()):
+    for i in range(src.shape[0]):
+        dst[i] = src[i]
+
+
+@kernel
+def _residual(b: ndarray_type.ndarray(), ax: ndarray_type.ndarray(),
+              r: ndarray_type.ndarray()):
+    for i in range(b.shape[0]):
+        r[i] = b[i] - ax[i]
+
+
+@kernel
+def _init_scalars(s: ndarray_type.ndarray(), tol: f32):
+    # |s[_THRESHOLD]| holds the squared norm of the right-hand side.
+    s[_THRESHOLD] *= tol * tol
+    s[_DONE] = 0
+    s[_ITER] = 0
+    if s[_RES] <= s[_THRESHOLD]:
+        s[_DONE] = 1
+
+
+@kernel
+def _check(s: ndarray_type.ndarray()):
+    if s[_DONE] == 0:
+        s[_ITER] += 1
+        if s[_RES] <= s[_THRESHOLD]:
+            s[_DONE] = 1
+
+
+# Conjugate gradient
+_CG_RZ = _S0
+_CG_RZ_NEW = _S0 + 1
+_CG_PQ = _S0 + 2
+
+
+@kernel
+def _cg_update_x_r(x: ndarray_type.ndarray(), r: ndarray_type.ndarray(),
+                   p: ndarray_type.ndarray(), q: ndarray_type.ndarray(),
+                   s: ndarray_type.ndarray()):
+    for i in range(x.shape[0]):
+        if s[_DONE] == 0:
+            alpha = s[_CG_RZ] / s[_CG_PQ]
+            x[i] += alpha * p[i]
+            r[i] -= alpha * q[i]
+
+
+@kernel
+def _cg_update_p(p: ndarray_type.ndarray(), z: ndarray_type.ndarray(),
+                 s: ndarray_type.ndarray()):
+    for i in range(p.shape[0]):
+        if s[_DONE] == 0:
+            p[i] = z[i] + s[_CG_RZ_NEW] / s[_CG_RZ] * p[i]
+    if s[_DONE] == 0:
+        s[_CG_RZ] = s[_CG_RZ_NEW]
+
+
+# BiCGSTAB
+_BI_RHO = _S0
+_BI_RHO_NEW = _S0 + 1
+_BI_ALPHA = _S0 + 2
+_BI_OMEGA = _S0 + 3
+_BI_RV = _S0 + 4
+_BI_TS = _S0 + 5
+_BI_TT = _S0 + 6
+
+
+@kernel
+def _bicgstab_init(s: ndarray_type.ndarray()):
+    s[_BI_RHO] = 1.0
+    s[_BI_ALPHA] = 1.0
+    s[_BI_OMEGA] = 1.0
+
+
+@kernel
+def _bicgstab_update_p(p: ndarray_type.ndarray(), r: ndarray_type.ndarray(),
+                       v: ndarray_type.ndarray(), s: ndarray_type.ndarray()):
+    for i in range(p.shape[0]):
+        if s[_DONE] == 0:
+            beta = s[_BI_RHO_NEW] / s[_BI_RHO] * s[_BI_ALPHA] / s[_BI_OMEGA]
+            p[i] = r[i] + beta * (p[i] - s[_BI_OMEGA] * v[i])
+
+
+@kernel
+def _bicgstab_update_s(r: ndarray_type.ndarray(), v: ndarray_type.ndarray(),
+                       s: ndarray_type.ndarray()):
+    if s[_DONE] == 0:
+        s[_BI_ALPHA] = s[_BI_RHO_NEW] / s[_BI_RV]
+    for i in range(r.shape[0]):
+        if s[_DONE] == 0:
+            r[i] -= s[_BI_ALPHA] * v[i]
+
+
+@kernel
+def _bicgstab_update_x_r(x: ndarray_type.ndarray(), y: ndarray_type.ndarray(),
+                         z: ndarray_type.ndarray(), r: ndarray_type.ndarray(),
+                         t: ndarray_type.ndarray(), s: ndarray_type.ndarray()):
+    if s[_DONE] == 0:
+        s[_BI_OMEGA] = 0.0
+        if s[_BI_TT] != 0.0:
+            s[_BI_OMEGA] = s[_BI_TS] / s[_BI_TT]
+    for i in range(x.shape[0]):
+        if s[_DONE] == 0:
+            x[i] += s[_BI_ALPHA] * y[i] + s[_BI_OMEGA] * z[i]
+            r[i] -= s[_BI_OMEGA] * t[i]
+    if s[_DONE] == 0:
+        s[_BI_RHO] = s[_BI_RHO_NEW]
+
+
+# MINRES, following Paige and Saunders
+_MR_BETA = _S0
+_MR_OLDB = _S0 + 1
+_MR_DBAR = _S0 + 2
+_MR_EPSLN = _S0 + 3
+_MR_PHIBAR = _S0 + 4
+_MR_CS = _S0 + 5
+_MR_SN = _S0 + 6
+_MR_ALFA = _S0 + 7
+_MR_BETA_SQ = _S0 + 8
+_MR_OLDEPS = _S0 + 9
+_MR_DELTA = _S0 + 10
+_MR_GAMMA = _S0 + 11
+_MR_PHI = _S0 + 12
+
+
+@kernel
+def _minres_init(s: ndarray_type.ndarray()):
+    beta1 = sqrt(ti_max(s[_MR_BETA_SQ], 0.0))
+    s[_MR_BETA] = beta1
+    s[_MR_OLDB] = 0.0
+    s[_MR_DBAR] = 0.0
+    s[_MR_EPSLN] = 0.0
+    s[_MR_PHIBAR] = beta1
+    s[_MR_CS] = -1.0
+    s[_MR_SN] = 0.0
+    s[_RES] = beta1 * beta1
+
+
+@kernel
+def _minres_lanczos_v(v: ndarray_type.ndarray(), y: ndarray_type.ndarray(),
+                      s: ndarray_type.ndarray()):
+    for i in range(v.shape[0]):
+        if s[_DONE] == 0:
+            v[i] = y[i] / s[_MR_BETA]
+
+
+@kernel
+def _minres_lanczos_r1(y: ndarray_type.ndarray(), r1: ndarray_type.ndarray(),
+                       s: ndarray_type.ndarray()):
+    for i in range(y.shape[0]):
+        if s[_DONE] == 0 and s[_MR_OLDB] != 0.0:
+            y[i] -= s[_MR_BETA] / s[_MR_OLDB] * r1[i]
+
+
+@kernel
+def _minres_lanczos_r2(y: ndarray_type.ndarray(), r2: ndarray_type.ndarray(),
+                       s: ndarray_type.ndarray()):
+    for i in range(y.shape[0]):
+        if s[_DONE] == 0:
+            y[i] -= s[_MR_ALFA] / s[_MR_BETA] * r2[i]
+
+
+@kernel
+def _minres_update(x: ndarray_type.ndarray(), v: ndarray_type.ndarray(),
+                   w: ndarray_type.ndarray(), w2: ndarray_type.ndarray(),
+                   s: ndarray_type.ndarray()):
+    if s[_DONE] == 0:
+        # Apply the previous rotation, then compute and apply the next one.
+        s[_MR_OLDB] = s[_MR_BETA]
+        beta = sqrt(ti_max(s[_MR_BETA_SQ], 0.0))
+        s[_MR_BETA] = beta
+        s[_MR_OLDEPS] = s[_MR_EPSLN]
+        cs = s[_MR_CS]
+        sn = s[_MR_SN]
+        dbar = s[_MR_DBAR]
+        alfa = s[_MR_ALFA]
+        s[_MR_DELTA] = cs * dbar + sn * alfa
+        gbar = sn * dbar - cs * alfa
+        s[_MR_EPSLN] = sn * beta
+        s[_MR_DBAR] = -cs * beta
+        gamma = ti_max(sqrt(gbar * gbar + beta * beta), 1e-30)
+        s[_MR_GAMMA] = gamma
+        s[_MR_CS] = gbar / gamma
+        s[_MR_SN] = beta / gamma
+        s[_MR_PHI] = s[_MR_CS] * s[_MR_PHIBAR]
+        s[_MR_PHIBAR] = s[_MR_SN] * s[_MR_PHIBAR]
+        s[_RES] = s[_MR_PHIBAR] * s[_MR_PHIBAR]
+    for i in range(x.shape[0]):
+        if s[_DONE] == 0:
+            w_old = w[i]
+            w1 = w2[i]
+            w2[i] = w_old
+            w[i] = (v[i] - s[_MR_OLDEPS] * w1 -
+                    s[_MR_DELTA] * w_old) / s[_MR_GAMMA]
+            x[i] += s[_MR_PHI] * w[i]
+
+
+class IterativeSolver:
+    """Preconditioned iterative solver of sparse linear systems.
+
+    Unlike :class:`SparseSolver`, it does not factorize the matrix, so it
+    scales to systems too large for a direct solver. The iterations only
+    launch kernels and SpMVs on the device of the matrix; the host
+    synchronizes every ``check_every`` iterations to test for convergence.
+
+    Args:
+        dtype (ti.dtype): The data type of the matrix and the vectors.
+        solver_type (str): "CG" for symmetric positive definite matrices,
+            "MINRES" for symmetric ones and "BiCGSTAB" for general ones.
+        preconditioner (str): None, "jacobi", "ic0" or "ilu0". The
+            preconditioner of CG and MINRES must be symmetric positive
+            definite. The incomplete factorizations need the diagonal to be
+            stored in the matrix.
+        max_iter (int): The maximum number of iterations.
+        tol (float): The solve stops when the residual norm is below ``tol``
+            times the norm of the right-hand side. MINRES measures both in
+            the norm given by the preconditioner.
+        check_every (int): The number of iterations between two convergence
+            tests.
+    """
+    def __init__(self,
+                 dtype=f32,
+                 solver_type="CG",
+                 preconditioner=None,
+                 max_iter=1000,
+                 tol=1e-6,
+                 check_every=10):
+        solver_type_list = ["CG", "BiCGSTAB", "MINRES"]
+        preconditioner_list = [None, "jacobi", "ic0", "ilu0"]
+        if solver_type not in solver_type_list or preconditioner not in preconditioner_list:
+            raise TaichiRuntimeError(
+                f"The iterative solver {solver_type} with preconditioner {preconditioner} is not supported for now. Only {solver_type_list} with {preconditioner_list} are supported."
+            )
+        taichi_arch = get_runtime().prog.config().arch
+        assert taichi_arch in [
+            _ti_core.Arch.x64, _ti_core.Arch.arm64, _ti_core.Arch.cuda
+        ], "IterativeSolver only supports CPU and CUDA for now."
+        self.dtype = dtype
+        self.solver_type = solver_type
+        self.max_iter = max_iter
+        self.tol = tol
+        self.check_every = max(check_every, 1)
+        self.matrix = None
+        self.preconditioner = None
+        if preconditioner is not None:
+            if taichi_arch == _ti_core.Arch.cuda:
+                self.preconditioner = _ti_core.make_cusparse_preconditioner(
+                    dtype, preconditioner)
+            else:
+                self.preconditioner = _ti_core.make_sparse_preconditioner(
+                    dtype, preconditioner)
+        self._vectors = {}
+        self._scalars = None
+        self._num_iterations = 0
+        self._residual = 0.0
+        self._converged = False
+
+    def compute(self, sparse_matrix):
+        """Sets the matrix of the system and computes the preconditioner.
+
+        Args:
+            sparse_matrix (SparseMatrix): The square matrix of the system.
+        """
+        if not isinstance(sparse_matrix, SparseMatrix):
+            raise TaichiRuntimeError(
+                f"The parameter type: {type(sparse_matrix)} is not supported in linear solvers for now."
+            )
+        if sparse_matrix.n != sparse_matrix.m:
+            raise TaichiRuntimeError(
+                "IterativeSolver only solves square systems.")
+        self.matrix = sparse_matrix
+        if self.preconditioner is not None:
+            self.preconditioner.compute(sparse_matrix.matrix)
+
+    def _vector(self, name):
+        # The work vectors are kept across solves with the same matrix size.
+        n = self.matrix.n
+        vec = self._vectors.get(name)
+        if vec is None or vec.shape != (n, ):
+            vec = ScalarNdarray(dtype=self.dtype, arr_shape=(n, ))
+            self._vectors[name] = vec
+        return vec
+
+    def _spmv(self, x, y):
+        self.matrix.matrix.spmv(get_runtime().prog, x.arr, y.arr)
+
+    def _precondition(self, r, z):
+        if self.preconditioner is None:
+            _copy(r, z)
+        else:
+            self.preconditioner.apply(get_runtime().prog, r.arr, z.arr)
+
+    def solve(self, b, x=None):
+        """Solves the system with the right-hand side `b`.
+
+        Args:
+            b (Ndarray): The right-hand side.
+            x (Ndarray, optional): The initial guess. It is updated in place
+                with the solution.
+
+        Returns:
+            Ndarray: The solution.
+        """
+        if self.matrix is None:
+            raise TaichiRuntimeError(
+                "Call compute() before solving with an IterativeSolver.")
+        if not isinstance(b, Ndarray):
+            raise TaichiRuntimeError(
+                f"The parameter type: {type(b)} is not supported in linear solvers for now."
+            )
+        if x is None:
+            x = ScalarNdarray(dtype=self.dtype, arr_shape=(self.matrix.n, ))
+            x.fill(0)
+        if self._scalars is None:
+            self._scalars = ScalarNdarray(dtype=self.dtype,
+                                          arr_shape=(_NUM_SCALARS, ))
+        s = self._scalars
+        if self.solver_type == "CG":
+            step = self._cg(b, x, s)
+        elif self.solver_type == "BiCGSTAB":
+            step = self._bicgstab(b, x, s)
+        else:
+            step = self._minres(b, x, s)
+        _init_scalars(s, self.tol)
+        for it in range(self.max_iter):
+            if it % self.check_every == 0 and s[_DONE] != 0:
+                break
+            step()
+        scalars = s.to_numpy()
+        self._converged = scalars[_DONE] != 0
+        self._num_iterations = int(scalars[_ITER])
+        self._residual = float(scalars[_RES])**0.5
+        return x
+
+    def _initial_residual(self, b, x, r):
+        self._spmv(x, r)
+        _residual(b, r, r)
+
+    def _cg(self, b, x, s):
+        r, z, p, q = (self._vector(name) for name in ("r", "z", "p", "q"))
+        self._initial_residual(b, x, r)
+        _dot(b, b, s, _THRESHOLD)
+        _dot(r, r, s, _RES)
+        self._precondition(r, z)
+        _copy(z, p)
+        _dot(r, z, s, _CG_RZ)
+
+        def step():
+            self._spmv(p, q)
+            _dot(p, q, s, _CG_PQ)
+            _cg_update_x_r(x, r, p, q, s)
+            _dot(r, r, s, _RES)
+            _check(s)
+            self._precondition(r, z)
+            _dot(r, z, s, _CG_RZ_NEW)
+            _cg_update_p(p, z, s)
+
+        return step
+
+    def _bicgstab(self, b, x, s):
+        r, r_hat, p, v, y, z, t = (self._vector(name)
+                                   for name in ("r", "r_hat", "p", "v", "y",
+                                                "z", "t"))
+        self._initial_residual(b, x, r)
+        _copy(r, r_hat)
+        p.fill(0)
+        v.fill(0)
+        _dot(b, b, s, _THRESHOLD)
+        _dot(r, r, s, _RES)
+        _bicgstab_init(s)
+
+        def step():
+            _dot(r_hat, r, s, _BI_RHO_NEW)
+            _bicgstab_update_p(p, r, v, s)
+            self._precondition(p, y)
+            self._spmv(y, v)
+            _dot(r_hat, v, s, _BI_RV)
+            # |r| now holds the intermediate residual.
+            _bicgstab_update_s(r, v, s)
+            self._precondition(r, z)
+            self._spmv(z, t)
+            _dot(t, r, s, _BI_TS)
+            _dot(t, t, s, _BI_TT)
+            _bicgstab_update_x_r(x, y, z, r, t, s)
+            _dot(r, r, s, _RES)
+            _check(s)
+
+        return step
+
+    def _minres(self, b, x, s):
+        v, w, w2 = (self._vector(name) for name in ("v", "w", "w2"))
+        # The Lanczos vectors rotate between these three buffers.
+        vecs = [self._vector(name) for name in ("r1", "r2", "y")]
+        r1, r2, y = vecs
+        self._precondition(b, y)
+        _dot(b, y, s, _THRESHOLD)
+        self._initial_residual(b, x, r1)
+        self._precondition(r1, y)
+        _dot(r1, y, s, _MR_BETA_SQ)
+        _copy(r1, r2)
+        w.fill(0)
+        w2.fill(0)
+        _minres_init(s)
+
+        def step():
+            r1, r2, y = vecs
+            _minres_lanczos_v(v, y, s)
+            self._spmv(v, y)
+            _minres_lanczos_r1(y, r1, s)
+            _dot(v, y, s, _MR_ALFA)
+            _minres_lanczos_r2(y, r2, s)
+            # r1 <- r2, r2 <- y; the old r1 receives the next y.
+            r1, r2, y = r2, y, r1
+            vecs[:] = [r1, r2, y]
+            self._precondition(r2, y)
+            _dot(r2, y, s, _MR_BETA_SQ)
+            _minres_update(x, v, w, w2, s)
+            _check(s)
+
+        return step
+
+    def info(self):
+        """Whether the last solve converged."""
+        return self._converged
+
+    @property
+    def num_iterations(self):
+        """The number of iterations of the last solve."""
+        return self._num_iterations
+
+    @property
+    def residual(self):
+        """The residual norm at the end of the last solve."""
+        return self._residual
+
+
+__all__ = ['IterativeSolver']
@@ -19,18 +19,22 @@ class SparseMatrix:
         n (int): the first dimension of a sparse matrix.
         m (int): the second dimension of a sparse matrix.
         sm (SparseMatrix): another sparse matrix that will be built from.
+        parallel (bool): run the SpMV, addition and matmul of the matrix, and
+            of the matrices computed from it, on the CPU thread pool of the
+            kernels. Ignored on CUDA.
     """
     def __init__(self,
                  n=None,
                  m=None,
                  sm=None,
                  dtype=f32,
-                 storage_format="col_major"):
+                 storage_format="col_major",
+                 parallel=False):
         if sm is None:
             self.n = n
             self.m = m if m else n
             self.matrix = get_runtime().prog.create_sparse_matrix(
-                n, m, dtype, storage_format)
+                n, m, dtype, storage_format, parallel)
         else:
             self.n = sm.num_rows()
             self.m = sm.num_cols()
@@ -149,6 +153,25 @@ class SparseMatrix:
             f"Sparse matrix-matrix/vector multiplication does not support {type(other)} for now. Supported types are SparseMatrix, ti.field, and numpy ndarray."
         )
 
+    def solve_triangular(self, b, lower=True):
+        """Solves the triangular system of a BSR matrix.
+
+        Only matrices built with a `block_size` greater than 1 support this.
+
+        Args:
+            b (ti.ndarray): the right-hand side.
+            lower (bool): solve with the lower triangular part of the matrix,
+                diagonal included, or else with the upper one.
+        Returns:
+            ti.ndarray: the solution.
+        """
+        if not isinstance(b, Ndarray):
+            raise TaichiRuntimeError(
+                f"Triangular solves only support ti.ndarray, not {type(b)}.")
+        x = ScalarNdarray(dtype=b.dtype, arr_shape=(self.m, ))
+        self.matrix.solve_triangular(get_runtime().prog, b.arr, x.arr, lower)
+        return x
+
     def __getitem__(self, indices):
         return self.matrix.get_element(indices[0], indices[1])
 
@@ -219,19 +242,32 @@ class SparseMatrixBuilder:
         max_num_triplets (int): the maximum number of triplets.
         dtype (ti.dtype): the data type of the sparse matrix.
         storage_format (str): the storage format of the sparse matrix.
+        reuse_pattern (bool): keep the sparsity pattern of the first build.
+            Later assemblies add the entries found in it directly to its
+            values, so building again with the same pattern needs no sort.
+            Entries outside of it extend the pattern at the next build.
+        parallel (bool): build matrices whose SpMV, addition and matmul run
+            on the CPU thread pool of the kernels. Ignored on CUDA.
+        block_size (int): build block sparse row (BSR) matrices of square
+            blocks of this size, which must divide the shape. Such matrices
+            support SpMV, element access and `solve_triangular()`.
     """
     def __init__(self,
                  num_rows=None,
                  num_cols=None,
                  max_num_triplets=0,
                  dtype=f32,
-                 storage_format="col_major"):
+                 storage_format="col_major",
+                 reuse_pattern=False,
+                 parallel=False,
+                 block_size=1):
         self.num_rows = num_rows
         self.num_cols = num_cols if num_cols else num_rows
         self.dtype = dtype
         if num_rows is not None:
             self.ptr = get_runtime().prog.create_sparse_matrix_builder(
-                num_rows, num_cols, max_num_triplets, dtype, storage_format)
+                num_rows, num_cols, max_num_triplets, dtype, storage_format,
+                reuse_pattern, parallel, block_size)
 
     def _get_addr(self):
         """Get the address of the sparse matrix"""
@@ -15,14 +15,25 @@ class SparseSolver:
     Use this class to solve linear systems represented by sparse matrices.
 
     Args:
-        solver_type (str): The factorization type.
+        solver_type (str): The factorization type. The types prefixed by
+            "Mixed", e.g. "MixedLLT", factorize in f32 and refine the solution
+            in f64 until the relative residual drops below `tol`, for at most
+            `max_refine_iter` f32 solves.
         ordering (str): The method for matrices re-ordering.
     """
-    def __init__(self, dtype=f32, solver_type="LLT", ordering="AMD"):
+    def __init__(self,
+                 dtype=f32,
+                 solver_type="LLT",
+                 ordering="AMD",
+                 tol=1e-10,
+                 max_refine_iter=20):
         self.matrix = None
+        self.dtype = dtype
         solver_type_list = ["LLT", "LDLT", "LU"]
         solver_ordering = ['AMD', 'COLAMD']
-        if solver_type in solver_type_list and ordering in solver_ordering:
+        self._mixed = solver_type.startswith("Mixed")
+        base_solver_type = solver_type[len("Mixed"):] if self._mixed else solver_type
+        if base_solver_type in solver_type_list and ordering in solver_ordering:
             taichi_arch = taichi.lang.impl.get_runtime().prog.config().arch
             assert taichi_arch == _ti_core.Arch.x64 or taichi_arch == _ti_core.Arch.arm64 or taichi_arch == _ti_core.Arch.cuda, "SparseSolver only supports CPU and CUDA for now."
             if taichi_arch == _ti_core.Arch.cuda:
@@ -31,9 +42,11 @@ class SparseSolver:
             else:
                 self.solver = _ti_core.make_sparse_solver(
                     dtype, solver_type, ordering)
+            if self._mixed:
+                self.solver.set_refinement(max_refine_iter, tol)
         else:
             raise TaichiRuntimeError(
-                f"The solver type {solver_type} with {ordering} is not supported for now. Only {solver_type_list} with {solver_ordering} are supported."
+                f"The solver type {solver_type} with {ordering} is not supported for now. Only {solver_type_list}, optionally prefixed by Mixed, with {solver_ordering} are supported."
             )
 
     @staticmethod
@@ -94,6 +107,10 @@ class SparseSolver:
         if self.matrix is None:
             raise TaichiRuntimeError(
                 "Please call compute() before calling solve().")
+        if self._mixed and isinstance(b, (Field, np.ndarray)):
+            b_arr = ScalarNdarray(self.dtype, [self.matrix.n])
+            b_arr.from_numpy(b.to_numpy() if isinstance(b, Field) else b)
+            return self.solve(b_arr).to_numpy()
         if isinstance(b, Field):
             return self.solver.solve(b.to_numpy())
         if isinstance(b, np.ndarray):
@@ -1,3 +1,5 @@
+from taichi.profiler.compile_profiler import *
+from taichi.profiler.flight_recorder import *
 from taichi.profiler.kernel_metrics import *
 from taichi.profiler.kernel_profiler import *
 from taichi.profiler.memory_profiler import *
@@ -0,0 +1,82 @@
+from taichi.lang.impl import get_runtime
+
+
+def get_compile_profiler_records():
+    """Returns how long each pass of the IR pipelines took for each kernel.
+
+    The compile profiler is enabled by ``ti.init(compile_profiler=True)``.
+    With ``ti.init(timeline=True)`` as well, the passes also show up in
+    the Chrome trace saved by ``ti.timeline_save()``.
+
+    The backend codegen shows up as the passes ``codegen_llvm``,
+    ``link_llvm`` and ``jit`` on the LLVM backends, and ``codegen_spirv``
+    on the others.
+
+    Returns:
+        list: One dict per pass run, with the keys ``kernel``, ``pass``,
+        ``time_ms``, ``num_statements_before``, ``num_statements_after``,
+        ``code_size`` and ``peak_memory``. ``code_size`` is the bytes of the
+        code generated by a codegen pass (the LLVM bitcode, SPIR-V or native
+        code), None for the passes that don't generate code. ``peak_memory``
+        is the high-water mark of the resident memory of the process in bytes
+        when the pass finished, None if unknown.
+
+    Example::
+
+        >>> import taichi as ti
+        >>> ti.init(arch=ti.cpu, compile_profiler=True)
+        >>> x = ti.field(ti.f32, shape=16)
+        >>> @ti.kernel
+        >>> def fill():
+        >>>     for i in x:
+        >>>         x[i] = i
+        >>> fill()
+        >>> for r in ti.profiler.get_compile_profiler_records():
+        >>>     print(r['kernel'], r['pass'], r['time_ms'])
+    """
+    get_runtime().materialize()
+    return [{
+        'kernel': r.kernel_name,
+        'pass': r.pass_name,
+        'time_ms': (r.end_time - r.begin_time) * 1000,
+        'num_statements_before': r.num_statements_before,
+        'num_statements_after': r.num_statements_after,
+        'code_size': r.code_size if r.code_size >= 0 else None,
+        'peak_memory': r.peak_memory if r.peak_memory >= 0 else None,
+    } for r in get_runtime().prog.get_compile_profiler_records()]
+
+
+def get_compile_profiler_kernel_keys():
+    """Returns the offline cache key of each kernel compiled while the
+    compile profiler was enabled.
+
+    The key is a hash of the frontend IR of the kernel and of the compile
+    config. Compile times of two Taichi versions are comparable for the
+    kernels whose key is the same in both.
+
+    Returns:
+        dict: The key of each kernel, by kernel name.
+    """
+    get_runtime().materialize()
+    return dict(get_runtime().prog.get_compile_profiler_kernel_keys())
+
+
+def print_compile_profiler_info():
+    """Prints the total time and the IR statement count change of each pass,
+    over all the kernels compiled so far. See
+    :func:`~taichi.profiler.get_compile_profiler_records`.
+    """
+    get_runtime().materialize()
+    get_runtime().prog.print_compile_profiler_info()
+
+
+def clear_compile_profiler_info():
+    """Clears the records of the compile profiler."""
+    get_runtime().materialize()
+    get_runtime().prog.clear_compile_profiler()
+
+
+__all__ = [
+    'clear_compile_profiler_info', 'get_compile_profiler_kernel_keys',
+    'get_compile_profiler_records', 'print_compile_profiler_info'
+]
@@ -0,0 +1,36 @@
+from taichi._lib import core as _ti_core
+
+
+def dump_flight_recorder(filename='taichi_flight_recorder.json'):
+    """Saves the latest compile, launch, synchronize and memory operations
+    of every thread as a Chrome trace (open it in ``chrome://tracing``).
+
+    The flight recorder is enabled by the environment variable
+    ``TI_FLIGHT_RECORDER=1`` and keeps the last ``TI_FLIGHT_RECORDER_SIZE``
+    (8192 by default) operations of each thread in a ring buffer, at a cost
+    low enough to leave it on in production. The records are also dumped to
+    ``TI_FLIGHT_RECORDER_FILE`` when the process crashes.
+
+    Args:
+        filename (str): The path of the ``.json`` file to write.
+
+    Example::
+
+        $ TI_FLIGHT_RECORDER=1 python train.py
+
+        >>> # Once a slowdown has been noticed
+        >>> ti.profiler.dump_flight_recorder('slow_frames.json')
+    """
+    if not _ti_core.flight_recorder_enabled():
+        _ti_core.warn(
+            'The flight recorder is disabled, set TI_FLIGHT_RECORDER=1 to '
+            'enable it.')
+    _ti_core.flight_recorder_dump(filename)
+
+
+def clear_flight_recorder():
+    """Forgets the operations recorded so far by the flight recorder."""
+    _ti_core.flight_recorder_clear()
+
+
+__all__ = ['clear_flight_recorder', 'dump_flight_recorder']
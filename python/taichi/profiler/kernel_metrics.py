@@ -166,6 +166,24 @@ achieved_occupancy = CuptiMetric(
     header=' occupancy',
     val_format='   {:6.0f} ')
 
+# CPU Metrics, read from hardware counters with perf_event_open on Linux and
+# summed over the threads running a kernel.
+cpu_cycles = CuptiMetric(name='cycles',
+                         header='    cycles ',
+                         val_format=' {:9.3e} ')
+
+cpu_instructions = CuptiMetric(name='instructions',
+                               header='     insts ',
+                               val_format=' {:9.3e} ')
+
+cpu_llc_misses = CuptiMetric(name='llc_misses',
+                             header=' LLC.miss ',
+                             val_format='{:9.3e} ')
+
+cpu_branch_misses = CuptiMetric(name='branch_misses',
+                                header=' br.miss ',
+                                val_format='{:8.2e} ')
+
 # metric suite: global load & store
 global_access = [
     dram_bytes_sum,
@@ -205,6 +223,15 @@ device_utilization = [
     l2_throughput,
 ]
 
+# metric suite: CPU counters, telling memory-bound kernels (many LLC misses
+# per instruction, few instructions per cycle) from compute-bound ones
+cpu_counters = [
+    cpu_cycles,
+    cpu_instructions,
+    cpu_llc_misses,
+    cpu_branch_misses,
+]
+
 # Predefined metrics suites
 predefined_cupti_metrics = {
     'global_access': global_access,
@@ -212,6 +239,7 @@ predefined_cupti_metrics = {
     'atomic_access': atomic_access,
     'cache_hit_rate': cache_hit_rate,
     'device_utilization': device_utilization,
+    'cpu_counters': cpu_counters,
 }
 
 
@@ -219,7 +247,8 @@ def get_predefined_cupti_metrics(name=''):
     """Returns the specified cupti metric.
 
     Accepted arguments are 'global_access', 'shared_access', 'atomic_access',
-    'cache_hit_rate', 'device_utilization'.
+    'cache_hit_rate', 'device_utilization', and 'cpu_counters' for the CPU
+    backends.
 
     Args:
         name (str): cupti metri name.
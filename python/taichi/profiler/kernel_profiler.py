@@ -43,7 +43,8 @@ class KernelProfiler:
     and prints the results to the console by :func:`~taichi.profiler.kernel_profiler.KernelProfiler.print_info`.
 
     ``KernelProfiler`` now support detailed low-level performance metrics (such as memory bandwidth consumption) in its advanced mode.
-    This mode is only available for the CUDA backend with CUPTI toolkit, i.e. you need ``ti.init(kernel_profiler=True, arch=ti.cuda)``.
+    This mode is available for the CUDA backend with CUPTI toolkit, i.e. you need ``ti.init(kernel_profiler=True, arch=ti.cuda)``,
+    and for the CPU backends on Linux, which read hardware counters (cycles, instructions, LLC and branch misses) with ``perf_event_open``.
 
     Note:
         For details about using CUPTI in Taichi, please visit https://docs.taichi-lang.org/docs/profiler#advanced-mode.
@@ -121,10 +122,15 @@ class KernelProfiler:
         # TODO : query self.StatisticalResult in python scope
         return impl.get_runtime().prog.query_kernel_profile_info(name)
 
-    def set_metrics(self, metric_list=default_cupti_metrics):
+    def set_metrics(self, metric_list=None):
         """For docstring of this function, see :func:`~taichi.profiler.set_kernel_profiler_metrics`."""
         if self._check_not_turned_on_with_warning_message():
             return None
+        if metric_list is None:
+            # The CPU backends only time kernels by default.
+            metric_list = [] if impl.current_cfg().arch in (
+                _ti_core.Arch.x64,
+                _ti_core.Arch.arm64) else default_cupti_metrics
         self._metric_list = metric_list
         metric_name_list = [metric.name for metric in metric_list]
         self.clear_info()
@@ -134,7 +140,7 @@ class KernelProfiler:
         return None
 
     @contextmanager
-    def collect_metrics_in_context(self, metric_list=default_cupti_metrics):
+    def collect_metrics_in_context(self, metric_list=None):
         """This function is not exposed to user now.
 
         For usage of this function, see :func:`~taichi.profiler.collect_kernel_profiler_metrics`.
@@ -150,6 +156,7 @@ class KernelProfiler:
     # mode of print_info
     COUNT = 'count'  # print the statistical results (min,max,avg time) of Taichi kernels.
     TRACE = 'trace'  # print the records of launched Taichi kernels with specific profiling metrics (time, memory load/store and core utilization etc.)
+    ROOFLINE = 'roofline'  # print the achieved bandwidth and FLOP rate of each task against the device peaks.
 
     def print_info(self, mode=COUNT):
         """Print the profiling results of Taichi kernels.
@@ -170,14 +177,116 @@ class KernelProfiler:
         #TRACE mode : print records of launched kernel
         elif mode == self.TRACE:
             self._print_kernel_info()
+        #ROOFLINE mode : print achieved throughput of each task
+        elif mode == self.ROOFLINE:
+            self._print_roofline_info(self._roofline())
         else:
             raise ValueError(
-                'Arg `mode` must be of type \'str\', and has the value \'count\' or \'trace\'.'
+                'Arg `mode` must be of type \'str\', and has the value \'count\', \'trace\' or \'roofline\'.'
             )
 
         return None
 
+    def get_roofline(self, peak_gbps=None, peak_gflops=None):
+        """Returns the roofline analysis of the launched tasks.
+
+        For usage of this function, see :func:`~taichi.profiler.get_kernel_profiler_roofline`.
+        """
+        if self._check_not_turned_on_with_warning_message():
+            return []
+        self._update_records()
+        self._count_statistics()
+        return self._roofline(peak_gbps, peak_gflops)
+
     # private methods
+    def _roofline(self, peak_gbps=None, peak_gflops=None):
+        """Combines the static cost estimate of each task with its measured
+        time, sorted by total time."""
+        prog = impl.get_runtime().prog
+        device_peaks = prog.get_kernel_profiler_device_peaks()
+        if device_peaks is not None:
+            peak_gbps = device_peaks[0] if peak_gbps is None else peak_gbps
+            peak_gflops = device_peaks[
+                1] if peak_gflops is None else peak_gflops
+        rows = []
+        for name, result in self._statistical_results.items():
+            row = {
+                'name': name,
+                'counter': result.counter,
+                'total_time_ms': result.total_time,
+                'flops': None,
+                'bytes': None,
+                'arithmetic_intensity': None,
+                'gflops': None,
+                'gbps': None,
+                'bound': None,
+                'fraction_of_peak': None,
+                'is_lower_bound': False,
+            }
+            rows.append(row)
+            cost = prog.get_task_cost(name)
+            if cost is None or cost.num_iterations < 0:
+                continue
+            flops = cost.flops_per_iteration * cost.num_iterations
+            num_bytes = cost.bytes_per_iteration * cost.num_iterations
+            seconds = result.total_time / result.counter / 1000.0
+            row.update(flops=flops,
+                       bytes=num_bytes,
+                       is_lower_bound=cost.is_lower_bound)
+            if num_bytes > 0:
+                row['arithmetic_intensity'] = flops / num_bytes
+            if seconds > 0:
+                row['gflops'] = flops / seconds / 1e9
+                row['gbps'] = num_bytes / seconds / 1e9
+            if peak_gbps and peak_gflops and seconds > 0:
+                # Tasks left of the ridge point can't reach the peak FLOP
+                # rate, as the memory bandwidth limits them first.
+                ridge = peak_gflops / peak_gbps
+                intensity = row['arithmetic_intensity']
+                if intensity is None:
+                    intensity = float('inf') if flops > 0 else 0.0
+                if intensity < ridge:
+                    row['bound'] = 'memory'
+                    row['fraction_of_peak'] = row['gbps'] / peak_gbps
+                else:
+                    row['bound'] = 'compute'
+                    row['fraction_of_peak'] = row['gflops'] / peak_gflops
+        return rows
+
+    def _print_roofline_info(self, rows):
+        """Print the roofline analysis of launched tasks."""
+        table_header = self._make_table_header('roofline')
+        column_header = '[ total.time   count |    GB/s   GFLOP/s  FLOP/B |  bound  %peak ] Task name'
+        line_length = max(len(column_header), len(table_header))
+        outer_partition_line = '=' * line_length
+        inner_partition_line = '-' * line_length
+
+        def fmt(value, width, precision):
+            if value is None:
+                return f'{"n/a":>{width}}'
+            return f'{value:{width}.{precision}f}'
+
+        print(outer_partition_line)
+        print(table_header)
+        print(outer_partition_line)
+        print(column_header)
+        print(inner_partition_line)
+        for row in rows:
+            bound = row['bound'] or 'n/a'
+            if row['is_lower_bound']:
+                bound += '+'
+            percent = row['fraction_of_peak']
+            if percent is not None:
+                percent *= 100
+            print(f"[{row['total_time_ms']:8.3f} ms {row['counter']:6d}x |"
+                  f"{fmt(row['gbps'], 8, 2)} {fmt(row['gflops'], 9, 2)} "
+                  f"{fmt(row['arithmetic_intensity'], 7, 2)} | {bound:>7} "
+                  f"{fmt(percent, 5, 1)}% ] {row['name']}")
+        print(inner_partition_line)
+        print('Bytes and FLOPs are static estimates, \'+\' marks tasks with '
+              'loops of unknown trip counts, counted once.')
+        print(outer_partition_line)
+
     def _check_not_turned_on_with_warning_message(self):
         if self._profiling_mode is False:
             _ti_core.warn(
@@ -293,7 +402,7 @@ class KernelProfiler:
         column_header = ('[  start.time | kernel.time |')  #default
         if kernel_attribute_state:
             column_header += (
-                '   regs  |   shared mem | grid size | block size | occupancy |'
+                '   regs  |  spills  |   shared mem | grid size | block size |    occupancy    |'
             )  #kernel_attributes
         for idx in range(values_num):
             column_header += metric_list[idx].header + '|'
@@ -312,11 +421,12 @@ class KernelProfiler:
             formatted_str = '[{:9.3f} ms |{:9.3f} ms |'  #default
             values = [fake_timestamp, record.kernel_time]  #default
             if kernel_attribute_state:
-                formatted_str += '    {:4d} | {:6d} bytes |    {:6d} |     {:6d} | {:2d} blocks |'
+                formatted_str += '    {:4d} | {:5d} B  | {:6d} bytes |    {:6d} |     {:6d} | {:2d} blocks {:4.0f}% |'
                 values += [
-                    record.register_per_thread, record.shared_mem_per_block,
-                    record.grid_size, record.block_size,
-                    record.active_blocks_per_multiprocessor
+                    record.register_per_thread, record.local_mem_per_thread,
+                    record.shared_mem_per_block, record.grid_size,
+                    record.block_size, record.active_blocks_per_multiprocessor,
+                    record.occupancy * 100
                 ]
             for idx in range(values_num):
                 formatted_str += metric_list[idx].val_format + '|'
@@ -362,6 +472,7 @@ def print_kernel_profiler_info(mode='count'):
     To enable this profiler, set ``kernel_profiler=True`` in ``ti.init()``.
     ``'count'`` mode: print the statistics (min,max,avg time) of launched kernels,
     ``'trace'`` mode: print the records of launched kernels with specific profiling metrics (time, memory load/store and core utilization etc.),
+    ``'roofline'`` mode: print the achieved bandwidth and FLOP rate of each task, see :func:`~taichi.profiler.get_kernel_profiler_roofline`,
     and defaults to ``'count'``.
 
     Args:
@@ -394,6 +505,49 @@ def print_kernel_profiler_info(mode='count'):
     get_default_kernel_profiler().print_info(mode)
 
 
+def get_kernel_profiler_roofline(peak_gbps=None, peak_gflops=None):
+    """Returns the roofline analysis of the launched offloaded tasks, to find
+    the tasks worth optimizing.
+
+    The bytes of global memory accessed and the floating-point operations of
+    each task are estimated from its IR when it is compiled, and divided by
+    its average measured time. Tasks whose loop range is only known at
+    runtime, or that were loaded from the offline cache, have no estimate.
+    To enable this profiler, set ``kernel_profiler=True`` in ``ti.init()``.
+
+    Args:
+        peak_gbps (float): The peak memory bandwidth of the device in GB/s.
+            Defaults to the one reported by the backend (CUDA only).
+        peak_gflops (float): The peak FLOP rate of the device in GFLOP/s.
+            Defaults to the one reported by the backend (CUDA only).
+
+    Returns:
+        list: One dict per task sorted by total time, with the keys ``name``,
+        ``counter``, ``total_time_ms``, ``flops`` and ``bytes`` (per launch),
+        ``arithmetic_intensity``, ``gflops``, ``gbps``, ``bound``
+        (``'memory'`` or ``'compute'``), ``fraction_of_peak`` and
+        ``is_lower_bound``. Values that can't be estimated are ``None``.
+
+    Example::
+
+        >>> import taichi as ti
+
+        >>> ti.init(ti.cuda, kernel_profiler=True)
+        >>> x = ti.field(ti.f32, shape=1024 * 1024)
+
+        >>> @ti.kernel
+        >>> def saxpy(a: ti.f32):
+        >>>     for i in x:
+        >>>         x[i] = a * x[i] + 1.0
+
+        >>> saxpy(2.0)
+        >>> for row in ti.profiler.get_kernel_profiler_roofline():
+        >>>     print(row['name'], row['gbps'], row['bound'])
+        >>> ti.profiler.print_kernel_profiler_info('roofline')
+    """
+    return get_default_kernel_profiler().get_roofline(peak_gbps, peak_gflops)
+
+
 def query_kernel_profiler_info(name):
     """Query kernel elapsed time(min,avg,max) on devices using the kernel name.
 
@@ -455,7 +609,10 @@ def get_kernel_profiler_total_time():
 def set_kernel_profiler_toolkit(toolkit_name='default'):
     """Set the toolkit used by KernelProfiler.
 
-    Currently, we only support toolkits: ``'default'`` and ``'cupti'``.
+    Currently, we only support toolkits: ``'default'``, ``'cupti'`` and ``'activity'``.
+    ``'activity'`` times the kernels with the CUPTI Activity API on the CUDA backend,
+    which neither serializes nor replays them, so it can stay on with little overhead.
+    It collects no metrics.
 
     Args:
         toolkit_name (str): string of toolkit name.
@@ -488,11 +645,12 @@ def set_kernel_profiler_toolkit(toolkit_name='default'):
     return get_default_kernel_profiler().set_toolkit(toolkit_name)
 
 
-def set_kernel_profiler_metrics(metric_list=default_cupti_metrics):
+def set_kernel_profiler_metrics(metric_list=None):
     """Set metrics that will be collected by the CUPTI toolkit.
 
     Args:
-        metric_list (list): a list of :class:`~taichi.profiler.CuptiMetric()` instances, default value: :data:`~taichi.profiler.kernel_metrics.default_cupti_metrics`.
+        metric_list (list): a list of :class:`~taichi.profiler.CuptiMetric()` instances, default value: :data:`~taichi.profiler.kernel_metrics.default_cupti_metrics`,
+            or no metrics on the CPU backends, which accept the metrics of ``get_predefined_cupti_metrics('cpu_counters')``.
 
     Example::
 
@@ -536,11 +694,12 @@ def set_kernel_profiler_metrics(metric_list=default_cupti_metrics):
 
 
 @contextmanager
-def collect_kernel_profiler_metrics(metric_list=default_cupti_metrics):
+def collect_kernel_profiler_metrics(metric_list=None):
     """Set temporary metrics that will be collected by the CUPTI toolkit within this context.
 
     Args:
-        metric_list (list): a list of :class:`~taichi.profiler.CuptiMetric()` instances, default value: :data:`~taichi.profiler.kernel_metrics.default_cupti_metrics`.
+        metric_list (list): a list of :class:`~taichi.profiler.CuptiMetric()` instances, default value: :data:`~taichi.profiler.kernel_metrics.default_cupti_metrics`,
+            or no metrics on the CPU backends, which accept the metrics of ``get_predefined_cupti_metrics('cpu_counters')``.
 
     Example::
 
@@ -587,7 +746,8 @@ def collect_kernel_profiler_metrics(metric_list=default_cupti_metrics):
 
 __all__ = [
     'clear_kernel_profiler_info', 'collect_kernel_profiler_metrics',
-    'get_kernel_profiler_total_time', 'print_kernel_profiler_info',
+    'get_kernel_profiler_roofline', 'get_kernel_profiler_total_time',
+    'print_kernel_profiler_info',
     'query_kernel_profiler_info', 'set_kernel_profiler_metrics',
     'set_kernel_profiler_toolkit'
 ]
@@ -10,4 +10,28 @@ def print_memory_profiler_info():
     get_runtime().prog.print_memory_profiler_info()
 
 
-__all__ = ['print_memory_profiler_info']
+def get_memory_stats():
+    """Returns the current memory usage of the program.
+
+    The returned object has the sizes in bytes of the SNode trees
+    (``snode_tree_bytes``), ndarrays (``ndarray_bytes``), memory requested by
+    the LLVM runtime (``runtime_requested_bytes``) and the caching allocator
+    (``cached_allocated_bytes``, ``cached_reserved_bytes``). On the LLVM
+    backends, ``snodes`` lists for each SNode other than places the length of
+    its element list and, for pointer, dynamic and hash SNodes, the nodes
+    allocated, active, free and waiting for gc.
+
+    It takes one small device-to-host copy per SNode, so it can be called
+    every frame.
+
+    Example::
+
+        >>> stats = ti.profiler.get_memory_stats()
+        >>> for s in stats.snodes:
+        >>>     print(s.name, s.num_active_nodes, s.fragmentation)
+    """
+    get_runtime().materialize()
+    return get_runtime().prog.get_memory_stats()
+
+
+__all__ = ['print_memory_profiler_info', 'get_memory_stats']
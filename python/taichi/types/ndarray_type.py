@@ -93,6 +93,9 @@ class NdarrayType:
                 DeprecationWarning)
             self.dtype = _make_matrix_dtype_from_element_shape(
                 element_dim, element_shape, dtype)
+        elif isinstance(dtype, _ti_core.Type):
+            # Quantized types, see ti.types.quant
+            self.dtype = _ti_core.DataType(dtype)
         else:
             self.dtype = dtype
 
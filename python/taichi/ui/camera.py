@@ -34,6 +34,7 @@ class Camera:
         self.position(0.0, 0.0, 0.0)
         self.lookat(0.0, 0.0, 1.0)
         self.up(0.0, 1.0, 0.0)
+        self.curr_fov = 45
 
         # used for tracking user inputs
         self.last_mouse_x = None
@@ -93,6 +94,7 @@ class Camera:
 
             >>> camera.fov(45)
         """
+        self.curr_fov = fov
         self.ptr.fov(fov)
 
     def left(self, left):
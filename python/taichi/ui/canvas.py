@@ -14,8 +14,9 @@ class Canvas:
     You should not instantiate this class directly via `__init__`, instead
     please call the `get_canvas()` method of :class:`~taichi.ui.Window`.
     """
-    def __init__(self, canvas) -> None:
+    def __init__(self, canvas, window=None) -> None:
         self.canvas = canvas  #reference to a PyCanvas
+        self.window = window
 
     def set_background_color(self, color):
         """Set the background color of this canvas.
@@ -133,4 +134,6 @@ class Canvas:
         """
         # FIXME: (penguinliong) Add a point light to ensure the allocation of light source SSBO.
         scene.point_light((0.0, 0.0, 0.0), (0.0, 0.0, 0.0))
+        if self.window is not None:
+            scene.run_culling(*self.window.get_window_shape())
         self.canvas.scene(scene.scene)
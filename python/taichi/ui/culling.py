@@ -0,0 +1,133 @@
+from math import radians, tan
+
+import numpy as np
+from taichi.lang.impl import field
+from taichi.lang.matrix import Matrix, Vector
+from taichi.types.primitive_types import f32, u32
+
+import taichi as ti
+
+culled_field_cache = {}
+bounding_radius_cache = {}
+
+
+def get_culled_fields(src, num_draw_args):
+    """Returns a field shaped like `src` that receives the elements left after
+    culling, and the u32 field holding the arguments of the indirect draw."""
+    if src not in culled_field_cache:
+        if src.m == 1:
+            dst = Vector.field(src.n, src.dtype, shape=src.shape)
+        else:
+            dst = Matrix.field(src.n, src.m, src.dtype, shape=src.shape)
+        draw_args = field(u32, shape=num_draw_args)
+        culled_field_cache[src] = (dst, draw_args)
+    return culled_field_cache[src]
+
+
+def get_bounding_radius_field(vertices):
+    if vertices not in bounding_radius_cache:
+        bounding_radius_cache[vertices] = field(f32, shape=())
+    return bounding_radius_cache[vertices]
+
+
+class CullingView:
+    """The camera of a scene as seen by the culling kernels."""
+    def __init__(self, view, position, fov, projection, width, height):
+        # The matrices of the camera are returned transposed, see
+        # mat4_to_nparray() in export_ggui.cpp.
+        view_proj = (view @ projection).T
+        self.view_proj = Matrix(view_proj.tolist())
+        self.camera_pos = Vector(list(position))
+        self.tan_half_fov = tan(radians(fov) / 2)
+        self.width = float(width)
+        self.height = float(height)
+        # The left, right, bottom and top planes, and the plane through the
+        # camera for perspective projections, pointing inwards and normalized
+        # so that they give the distance of a point.
+        planes = [view_proj[3] + view_proj[0], view_proj[3] - view_proj[0],
+                  view_proj[3] + view_proj[1], view_proj[3] - view_proj[1],
+                  view_proj[3]]
+        for k, plane in enumerate(planes):
+            norm = np.linalg.norm(plane[:3])
+            planes[k] = plane / norm if norm > 0 else np.array([0, 0, 0, 1])
+        self.planes = Matrix(np.array(planes).tolist())
+
+
+@ti.kernel
+def cull_particles(dst: ti.template(), src: ti.template(), begin: ti.i32,
+                   end: ti.i32, radius: ti.f32,
+                   view_proj: ti.types.matrix(4, 4, ti.f32),
+                   camera_pos: ti.types.vector(3, ti.f32),
+                   tan_half_fov: ti.f32, width: ti.f32, height: ti.f32,
+                   min_pixel_radius: ti.f32, draw_args: ti.template()):
+    # VkDrawIndirectCommand, six vertices form the quad of each particle.
+    draw_args[0] = ti.u32(6)
+    draw_args[1] = ti.u32(0)
+    draw_args[2] = ti.u32(0)
+    draw_args[3] = ti.u32(0)
+    for i in range(begin, end):
+        pos = ti.Vector([src[i][0], src[i][1], src[i][2]])
+        # The half size of the quad in NDC, as in Particles_vk.vert.
+        hsize = radius / (tan_half_fov * (pos - camera_pos).norm())
+        clip = view_proj @ ti.Vector([pos[0], pos[1], pos[2], 1.0])
+        visible = clip[3] > 0.0
+        if visible:
+            visible = ti.abs(clip[0]) <= (1.0 + hsize) * clip[3] and ti.abs(
+                clip[1]) <= (1.0 + hsize * width / height) * clip[3]
+        pixel_radius = hsize * width * 0.5
+        if visible and pixel_radius < min_pixel_radius:
+            # Keeps a stable subset of the particles smaller than
+            # `min_pixel_radius` in proportion to their area, so that distant
+            # clouds keep their coverage.
+            h = ti.cast(i, ti.u32) * ti.u32(747796405)
+            h ^= h >> 16
+            keep = ti.cast(h >> 8, ti.f32) / 16777216.0
+            visible = keep < (pixel_radius / min_pixel_radius)**2
+        if visible:
+            j = ti.atomic_add(draw_args[1], ti.u32(1))
+            dst[ti.cast(j, ti.i32)] = src[i]
+
+
+@ti.kernel
+def compute_bounding_radius(vertices: ti.template(), bound: ti.template()):
+    bound[None] = 0.0
+    for i in vertices:
+        ti.atomic_max(bound[None], vertices[i].norm())
+
+
+@ti.kernel
+def cull_instances(dst: ti.template(), src: ti.template(), begin: ti.i32,
+                   end: ti.i32, bound: ti.template(),
+                   planes: ti.types.matrix(5, 4, ti.f32),
+                   draw_params: ti.types.vector(3, ti.i32),
+                   indexed: ti.template(), draw_args: ti.template()):
+    if ti.static(indexed):
+        # VkDrawIndexedIndirectCommand
+        draw_args[0] = ti.cast(draw_params[0], ti.u32)
+        draw_args[1] = ti.u32(0)
+        draw_args[2] = ti.cast(draw_params[1], ti.u32)
+        draw_args[3] = ti.cast(draw_params[2], ti.u32)
+        draw_args[4] = ti.u32(0)
+    else:
+        # VkDrawIndirectCommand
+        draw_args[0] = ti.cast(draw_params[0], ti.u32)
+        draw_args[1] = ti.u32(0)
+        draw_args[2] = ti.cast(draw_params[2], ti.u32)
+        draw_args[3] = ti.u32(0)
+    for i in range(begin, end):
+        model = src[i]
+        center = ti.Vector([model[0, 3], model[1, 3], model[2, 3], 1.0])
+        scale = ti.max(
+            ti.Vector([model[0, 0], model[1, 0], model[2, 0]]).norm(),
+            ti.Vector([model[0, 1], model[1, 1], model[2, 1]]).norm(),
+            ti.Vector([model[0, 2], model[1, 2], model[2, 2]]).norm())
+        r = bound[None] * scale
+        visible = True
+        for k in ti.static(range(5)):
+            plane = ti.Vector(
+                [planes[k, 0], planes[k, 1], planes[k, 2], planes[k, 3]])
+            if plane.dot(center) < -r:
+                visible = False
+        if visible:
+            j = ti.atomic_add(draw_args[1], ti.u32(1))
+            dst[ti.cast(j, ti.i32)] = model
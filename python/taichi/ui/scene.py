@@ -6,6 +6,9 @@ from taichi.lang.ops import atomic_add
 from taichi.types.annotations import template
 from taichi.types.primitive_types import f32
 
+from .culling import (CullingView, compute_bounding_radius, cull_instances,
+                      cull_particles, get_bounding_radius_field,
+                      get_culled_fields)
 from .staging_buffer import (copy_colors_to_vbo, copy_normals_to_vbo,
                              copy_vertices_to_vbo, get_vbo_field)
 from .utils import check_ggui_availability, get_field_info
@@ -79,6 +82,9 @@ class Scene:
     def __init__(self):
         check_ggui_availability()
         self.scene = _ti_core.PyScene()
+        self.camera = None
+        # Culling kernels to run once the size of the canvas is known.
+        self.culling_jobs = []
 
     def set_camera(self, camera):
         """Set the camera for this scene.
@@ -87,6 +93,24 @@ class Scene:
             camera (:class:`~taichi.ui.Camera`): A camera instance.
         """
         self.scene.set_camera(camera.ptr)
+        self.camera = (camera, camera.get_view_matrix(),
+                       camera.curr_position.to_list(), camera.curr_fov)
+
+    def run_culling(self, width, height):
+        """Runs the culling requested for this frame against the camera of
+        the scene, drawn on a canvas of `width` x `height` pixels.
+        """
+        if not self.culling_jobs:
+            return
+        if self.camera is None:
+            raise Exception("culling needs the camera set with set_camera()")
+        camera, view, position, fov = self.camera
+        projection = camera.get_projection_matrix(width / height)
+        culling_view = CullingView(view, position, fov, projection, width,
+                                   height)
+        for job in self.culling_jobs:
+            job(culling_view)
+        self.culling_jobs.clear()
 
     def lines(self,
               vertices,
@@ -245,7 +269,8 @@ class Scene:
                       vertex_count: int = None,
                       index_offset: int = 0,
                       index_count: int = None,
-                      show_wireframe: bool = False):
+                      show_wireframe: bool = False,
+                      culling: bool = False):
         """Declare mesh instances inside the scene.
 
         If transforms is given, then according to the shape of transforms, it will
@@ -292,6 +317,11 @@ class Scene:
                 of indices to draw.
             show_wireframe (bool, optional):
                 turn on/off WareFrame mode.
+            culling (bool, optional):
+                if True, the instances outside of the view of the camera are
+                skipped on the device, and the rest is drawn indirectly. This
+                needs `transforms` of dtype ti.f32 and a camera set with
+                `set_camera()`.
         """
         vbo = get_vbo_field(vertices)
         copy_vertices_to_vbo(vbo, vertices)
@@ -318,12 +348,33 @@ class Scene:
         copy_normals_to_vbo(vbo, normals)
         vbo_info = get_field_info(vbo)
         indices_info = get_field_info(indices)
+        draw_args = None
+        if culling:
+            if not transforms or transforms.dtype != f32:
+                raise Exception(
+                    "culling needs transforms in a ti.f32 Matrix field")
+            culled_transforms, draw_args = get_culled_fields(transforms, 5)
+            bound = get_bounding_radius_field(vertices)
+            begin = instance_offset
+            end = min(instance_offset + instance_count, transforms.shape[0])
+            count = vertex_count if indices is None else index_count
+            draw_params = Vector([count, index_offset, vertex_offset])
+            src_transforms = transforms
+
+            def cull(view):
+                compute_bounding_radius(vertices, bound)
+                cull_instances(culled_transforms, src_transforms, begin, end,
+                               bound, view.planes, draw_params,
+                               indices is not None, draw_args)
+
+            self.culling_jobs.append(cull)
+            transforms = culled_transforms
         transform_info = get_field_info(transforms)
         self.scene.mesh_instance(vbo_info, has_per_vertex_color, indices_info,
                                  color, two_sided, transform_info,
                                  instance_count, instance_offset, index_count,
                                  index_offset, vertex_count, vertex_offset,
-                                 show_wireframe)
+                                 show_wireframe, get_field_info(draw_args))
 
     def particles(self,
                   centers,
@@ -331,7 +382,9 @@ class Scene:
                   color=(0.5, 0.5, 0.5),
                   per_vertex_color=None,
                   index_offset: int = 0,
-                  index_count: int = None):
+                  index_count: int = None,
+                  culling: bool = False,
+                  min_pixel_radius: float = 0.0):
         """Declare a set of particles within the scene.
 
         Args:
@@ -345,6 +398,14 @@ class Scene:
                 the index of the first vertex to draw.
             index_count (int, optional):
                 the number of vertices to draw.
+            culling (bool, optional):
+                if True, the particles outside of the view of the camera are
+                skipped on the device, and the rest is drawn indirectly. This
+                needs a camera set with `set_camera()`.
+            min_pixel_radius (float, optional):
+                only used with `culling`. Particles that look smaller than
+                this radius in pixels are thinned out in proportion to their
+                area, so that distant clouds keep their coverage.
         """
         vbo = get_vbo_field(centers)
         copy_vertices_to_vbo(vbo, centers)
@@ -353,9 +414,25 @@ class Scene:
             copy_colors_to_vbo(vbo, per_vertex_color)
         if index_count is None:
             index_count = centers.shape[0]
+        draw_args = None
+        if culling:
+            culled_vbo, draw_args = get_culled_fields(vbo, 4)
+            begin = index_offset
+            end = min(index_offset + index_count, centers.shape[0])
+            src_vbo = vbo
+
+            def cull(view):
+                cull_particles(culled_vbo, src_vbo, begin, end, radius,
+                               view.view_proj, view.camera_pos,
+                               view.tan_half_fov, view.width, view.height,
+                               min_pixel_radius, draw_args)
+
+            self.culling_jobs.append(cull)
+            vbo = culled_vbo
         vbo_info = get_field_info(vbo)
         self.scene.particles(vbo_info, has_per_vertex_color, color, radius,
-                             index_count, index_offset)
+                             index_count, index_offset,
+                             get_field_info(draw_args))
 
     def point_light(self, pos, color):  # pylint: disable=W0235
         """Set a point light in this scene.
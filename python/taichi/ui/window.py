@@ -26,19 +26,21 @@ class Window:
         vsync (bool): whether or not vertical sync should be enabled.
         show_window (bool): where or not display the window after initialization.
         pos (tuple[int]): position (left to right, up to bottom) of the window which origins from the left-top of your main screen, in pixels.
+        pipelined (bool): if True, `show()` returns once the frame is submitted instead of waiting for it to be rendered, so that the kernels launched next overlap with rendering. The frame is waited for before the next one is drawn.
     """
     def __init__(self,
                  name,
                  res,
                  vsync=False,
                  show_window=True,
-                 pos=(100, 100)):
+                 pos=(100, 100),
+                 pipelined=False):
         check_ggui_availability()
         package_path = str(pathlib.Path(__file__).parent.parent)
         ti_arch = default_cfg().arch
         self.window = _ti_core.PyWindow(get_runtime().prog, name, res, pos,
                                         vsync, show_window, package_path,
-                                        ti_arch)
+                                        ti_arch, pipelined)
 
     @property
     def running(self):
@@ -113,7 +115,7 @@ class Window:
 
     def get_canvas(self):
         """Returns a canvas handle. See :class`~taichi.ui.canvas.Canvas` """
-        return Canvas(self.window.get_canvas())
+        return Canvas(self.window.get_canvas(), self)
 
     @property
     def GUI(self):
@@ -201,6 +203,44 @@ class Window:
         """
         return self.window.get_image_buffer_as_numpy()
 
+    def start_capture(self,
+                      filename_pattern=None,
+                      pipe_command=None,
+                      num_readback_slots=3,
+                      num_workers=4):
+        """Start writing every frame shown by this window out, without
+        stalling the rendering on the readback.
+
+        The frames are read back asynchronously into `num_readback_slots`
+        host buffers and written out by background threads, until
+        :func:`stop_capture` is called. This also works for windows created
+        with `show_window=False`.
+
+        Args:
+            filename_pattern (str, optional): pattern of the image file of each
+                frame, formatted with the index of the frame, e.g.
+                `"frames/{:06d}.png"`.
+            pipe_command (str, optional): a shell command the frames are
+                written to as raw RGBA8 rows, top row first, e.g.
+                `"ffmpeg -y -f rawvideo -pix_fmt rgba -s 640x480 -i - -c:v
+                h264_nvenc out.mp4"`. Used instead of `filename_pattern`.
+            num_readback_slots (int): the number of frames whose readback can
+                be in flight at once.
+            num_workers (int): the number of threads writing image files.
+        """
+        if (filename_pattern is None) == (pipe_command is None):
+            raise ValueError(
+                "Exactly one of filename_pattern and pipe_command is required"
+            )
+        self.window.start_capture(filename_pattern or "", pipe_command or "",
+                                  num_readback_slots, num_workers)
+
+    def stop_capture(self):
+        """Wait until the frames captured since :func:`start_capture` are
+        written, and stop capturing.
+        """
+        self.window.stop_capture()
+
     def destroy(self):
         """Destroy this window. The window will be unavailable then.
         """
@@ -1,6 +1,10 @@
 #include "taichi/analysis/arithmetic_interpretor.h"
 
 #include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <type_traits>
 #include <vector>
 
@@ -12,6 +16,338 @@ namespace {
 
 using CodeRegion = ArithmeticInterpretor::CodeRegion;
 using EvalContext = ArithmeticInterpretor::EvalContext;
+using EvalOptions = ArithmeticInterpretor::EvalOptions;
+
+// Calls |f| with a value of the C++ type of |dt|. Returns false if |dt| cannot
+// be evaluated on the host.
+template <typename F>
+bool dispatch_type(DataType dt, F &&f) {
+  if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    f(int32());
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    f(int64());
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    f(uint32());
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    f(uint64());
+  } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    f(float32());
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    f(float64());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+T get_value(const TypedConstant &c) {
+  T val;
+  std::memcpy(&val, &c.value_bits, sizeof(T));
+  return val;
+}
+
+template <typename T>
+TypedConstant make_constant(DataType dt, T val) {
+  TypedConstant c(dt);
+  std::memcpy(&c.value_bits, &val, sizeof(T));
+  return c;
+}
+
+// Integer arithmetic wraps around as in LLVM (and SPIR-V).
+template <typename T>
+T wrap(BinaryOpType op, T a, T b) {
+  using U = std::make_unsigned_t<T>;
+  if (op == BinaryOpType::add) {
+    return T(U(a) + U(b));
+  } else if (op == BinaryOpType::sub) {
+    return T(U(a) - U(b));
+  } else if (op == BinaryOpType::mul) {
+    return T(U(a) * U(b));
+  } else {
+    TI_ASSERT(op == BinaryOpType::bit_shl);
+    return T(U(a) << b);
+  }
+}
+
+// Mirrors the debug_{add,sub,mul,shl} checks in runtime.cpp.
+template <typename T>
+bool overflows(BinaryOpType op, T a, T b) {
+#if defined(__clang__) || defined(__GNUC__)
+  T c;
+  if (op == BinaryOpType::add) {
+    return __builtin_add_overflow(a, b, &c);
+  } else if (op == BinaryOpType::sub) {
+    return __builtin_sub_overflow(a, b, &c);
+  } else if (op == BinaryOpType::mul) {
+    return __builtin_mul_overflow(a, b, &c);
+  } else if (op == BinaryOpType::bit_shl) {
+    return (wrap(op, a, b) >> b) != a;
+  }
+#endif
+  return false;
+}
+
+// Evaluates |op| on operands of the same type and returns the result of the
+// same type. Comparisons are handled separately.
+template <typename T>
+std::optional<T> eval_same_type_bin_op(BinaryOpType op,
+                                       T a,
+                                       T b,
+                                       const EvalOptions &options) {
+  if constexpr (std::is_floating_point_v<T>) {
+    switch (op) {
+      case BinaryOpType::add:
+        return a + b;
+      case BinaryOpType::sub:
+        return a - b;
+      case BinaryOpType::mul:
+        return a * b;
+      case BinaryOpType::div:
+        return a / b;
+      case BinaryOpType::floordiv:
+        return std::floor(a / b);
+      // llvm.maxnum/minnum return the non-NaN operand, as fmax/fmin do.
+      case BinaryOpType::max:
+        return std::fmax(a, b);
+      case BinaryOpType::min:
+        return std::fmin(a, b);
+      case BinaryOpType::atan2:
+        if (options.host_math) {
+          return std::atan2(a, b);
+        }
+        return std::nullopt;
+      case BinaryOpType::pow:
+        if (options.host_math) {
+          return std::pow(a, b);
+        }
+        return std::nullopt;
+      default:
+        return std::nullopt;
+    }
+  } else {
+    constexpr int bits = sizeof(T) * 8;
+    using U = std::make_unsigned_t<T>;
+    constexpr bool is_signed_type = std::is_signed_v<T>;
+    constexpr T min_value = std::numeric_limits<T>::min();
+    switch (op) {
+      case BinaryOpType::add:
+      case BinaryOpType::sub:
+      case BinaryOpType::mul:
+        if (options.check_overflow && overflows(op, a, b)) {
+          return std::nullopt;
+        }
+        return wrap(op, a, b);
+      case BinaryOpType::div:
+        if (b == 0 || (is_signed_type && a == min_value && b == T(-1))) {
+          return std::nullopt;
+        }
+        return a / b;
+      case BinaryOpType::floordiv: {
+        // See demote_ifloordiv() in demote_operations.cpp.
+        if (b == 0 || (is_signed_type && a == min_value && b == T(-1))) {
+          return std::nullopt;
+        }
+        T r = a / b;
+        if (((a < 0) != (b < 0)) && a != 0 && T(U(b) * U(r)) != a) {
+          r = T(U(r) - 1);
+        }
+        return r;
+      }
+      case BinaryOpType::mod:
+        if (b == 0 || (is_signed_type && a == min_value && b == T(-1))) {
+          return std::nullopt;
+        }
+        if constexpr (!is_signed_type) {
+          // The LLVM backends lower mod into srem regardless of signedness, so
+          // only fold where srem and urem agree.
+          if ((a >> (bits - 1)) || (b >> (bits - 1))) {
+            return std::nullopt;
+          }
+        }
+        return a % b;
+      case BinaryOpType::max:
+        return a > b ? a : b;
+      case BinaryOpType::min:
+        return a < b ? a : b;
+      case BinaryOpType::bit_and:
+        return a & b;
+      case BinaryOpType::bit_or:
+        return a | b;
+      case BinaryOpType::bit_xor:
+        return a ^ b;
+      case BinaryOpType::bit_shl:
+      case BinaryOpType::bit_sar:
+      case BinaryOpType::bit_shr:
+        // Shifting by the bit width or more yields poison in LLVM.
+        if (b < 0 || b >= bits) {
+          return std::nullopt;
+        }
+        if (op == BinaryOpType::bit_shl) {
+          if (options.check_overflow && overflows(op, a, b)) {
+            return std::nullopt;
+          }
+          return wrap(op, a, b);
+        } else if (op == BinaryOpType::bit_sar) {
+          return a >> b;
+        } else {
+          return T(U(a) >> b);
+        }
+      default:
+        return std::nullopt;
+    }
+  }
+}
+
+template <typename T>
+std::optional<bool> eval_comparison(BinaryOpType op, T a, T b) {
+  // Floating-point comparisons are ordered, i.e. false if any operand is NaN.
+  switch (op) {
+    case BinaryOpType::cmp_lt:
+      return a < b;
+    case BinaryOpType::cmp_le:
+      return a <= b;
+    case BinaryOpType::cmp_gt:
+      return a > b;
+    case BinaryOpType::cmp_ge:
+      return a >= b;
+    case BinaryOpType::cmp_eq:
+      return a == b;
+    case BinaryOpType::cmp_ne:
+      return a < b || a > b;
+    default:
+      return std::nullopt;
+  }
+}
+
+// pow() with an integral exponent, following the loop emitted by
+// demote_operations.
+template <typename T, typename E>
+std::optional<T> eval_integral_pow(T a, E e, const EvalOptions &options) {
+  using UE = std::make_unsigned_t<E>;
+  E b = e >= 0 ? e : E(UE(0) - UE(e));
+  T result = 1;
+  while (b > 0) {
+    if (b & 1) {
+      if constexpr (std::is_integral_v<T>) {
+        if (options.check_overflow &&
+            overflows(BinaryOpType::mul, result, a)) {
+          return std::nullopt;
+        }
+        result = wrap(BinaryOpType::mul, result, a);
+      } else {
+        result = result * a;
+      }
+    }
+    if constexpr (std::is_integral_v<T>) {
+      if (options.check_overflow && overflows(BinaryOpType::mul, a, a)) {
+        return std::nullopt;
+      }
+      a = wrap(BinaryOpType::mul, a, a);
+    } else {
+      a = a * a;
+    }
+    b = b >> 1;
+  }
+  if constexpr (std::is_floating_point_v<T>) {
+    if (e <= 0) {
+      result = T(1) / result;
+    }
+  }
+  return result;
+}
+
+template <typename From, typename To>
+std::optional<To> eval_cast_value(From val) {
+  if constexpr (std::is_floating_point_v<From> && std::is_integral_v<To>) {
+    // fptosi/fptoui yield poison when the truncated value does not fit, i.e.
+    // outside of [-2^(N-1), 2^(N-1)) or [0, 2^N).
+    constexpr int bits = sizeof(To) * 8;
+    const float64 upper =
+        std::ldexp(1.0, std::is_signed_v<To> ? bits - 1 : bits);
+    const float64 lower = std::is_signed_v<To> ? -upper : 0.0;
+    const float64 truncated = std::trunc(float64(val));
+    if (!(truncated >= lower && truncated < upper)) {
+      return std::nullopt;
+    }
+    return To(truncated);
+  } else {
+    return To(val);
+  }
+}
+
+template <typename T>
+std::optional<T> eval_same_type_unary_op(UnaryOpType op,
+                                         T a,
+                                         const EvalOptions &options) {
+  if constexpr (std::is_floating_point_v<T>) {
+    switch (op) {
+      case UnaryOpType::neg:
+        return -a;
+      case UnaryOpType::abs:
+        return std::fabs(a);
+      // sqrt and division are correctly rounded on every backend.
+      case UnaryOpType::sqrt:
+        return std::sqrt(a);
+      case UnaryOpType::rsqrt:
+        return T(1) / std::sqrt(a);
+      // llvm.round rounds half away from zero, as std::round does.
+      case UnaryOpType::round:
+        return std::round(a);
+      case UnaryOpType::floor:
+        return std::floor(a);
+      case UnaryOpType::ceil:
+        return std::ceil(a);
+      case UnaryOpType::sgn:
+        return a > 0 ? T(1) : (a < 0 ? T(-1) : T(0));
+      default:
+        break;
+    }
+    if (!options.host_math) {
+      return std::nullopt;
+    }
+    switch (op) {
+      case UnaryOpType::sin:
+        return std::sin(a);
+      case UnaryOpType::asin:
+        return std::asin(a);
+      case UnaryOpType::cos:
+        return std::cos(a);
+      case UnaryOpType::acos:
+        return std::acos(a);
+      case UnaryOpType::tan:
+        return std::tan(a);
+      case UnaryOpType::tanh:
+        return std::tanh(a);
+      case UnaryOpType::exp:
+        return std::exp(a);
+      case UnaryOpType::log:
+        return std::log(a);
+      default:
+        return std::nullopt;
+    }
+  } else {
+    using U = std::make_unsigned_t<T>;
+    switch (op) {
+      case UnaryOpType::neg:
+        return T(U(0) - U(a));
+      case UnaryOpType::abs:
+        if constexpr (std::is_signed_v<T>) {
+          return a >= 0 ? a : T(U(0) - U(a));
+        }
+        return std::nullopt;
+      case UnaryOpType::bit_not:
+        return T(~a);
+      case UnaryOpType::popcnt:
+        return T(std::bitset<sizeof(T) * 8>(U(a)).count());
+      case UnaryOpType::logic_not:
+        return T(!a);
+      default:
+        return std::nullopt;
+    }
+  }
+}
+
 
 std::vector<Stmt *> get_raw_statements(const Block *block) {
   const auto &stmts = block->statements;
@@ -68,31 +404,25 @@ class EvalVisitor : public IRVisitor {
       failed_ = true;
       return;
     }
-    auto lhs = lhs_opt.value();
-    auto rhs = rhs_opt.value();
-    if (lhs.dt != rhs.dt) {
-      failed_ = true;
-      return;
-    }
+    // Statements built by tests may not be type-checked yet, so derive the
+    // result type from the operands.
+    DataType ret_type =
+        is_comparison(stmt->op_type) ? PrimitiveType::i32 : lhs_opt->dt;
+    insert_or_failed(stmt, ArithmeticInterpretor::eval_binary_op(
+                               stmt->op_type, ret_type, lhs_opt.value(),
+                               rhs_opt.value(), EvalOptions()));
+  }
 
-    const auto op = stmt->op_type;
-    const auto dt = lhs.dt;
-    // TODO: Consider using macros to avoid duplication
-    if (is_real(dt)) {
-      // Put floating point numbers first because is_signed/unsigned asserts
-      // that the data type being integral.
-      auto res_opt = eval_bin_op(lhs.val_float(), rhs.val_float(), op);
-      insert_or_failed(stmt, dt, res_opt);
-    } else if (is_signed(dt)) {
-      auto res_opt = eval_bin_op(lhs.val_int(), rhs.val_int(), op);
-      insert_or_failed(stmt, dt, res_opt);
-    } else if (is_unsigned(dt)) {
-      auto res_opt = eval_bin_op(lhs.val_uint(), rhs.val_uint(), op);
-      insert_or_failed(stmt, dt, res_opt);
-    } else {
-      TI_NOT_IMPLEMENTED;
+  void visit(UnaryOpStmt *stmt) override {
+    auto operand_opt = context_.maybe_get(stmt->operand);
+    if (!operand_opt) {
       failed_ = true;
+      return;
     }
+    DataType ret_type = stmt->is_cast() ? stmt->cast_type : operand_opt->dt;
+    insert_or_failed(stmt, ArithmeticInterpretor::eval_unary_op(
+                               stmt->op_type, ret_type, stmt->cast_type,
+                               operand_opt.value(), EvalOptions()));
   }
 
   void visit(BitExtractStmt *stmt) override {
@@ -128,43 +458,13 @@ class EvalVisitor : public IRVisitor {
   }
 
  private:
-  template <typename T>
-  static std::optional<T> eval_bin_op(T lhs, T rhs, BinaryOpType op) {
-    if (op == BinaryOpType::add) {
-      return lhs + rhs;
-    }
-    if (op == BinaryOpType::sub) {
-      return lhs - rhs;
-    }
-    if (op == BinaryOpType::mul) {
-      return lhs * rhs;
-    }
-    if (op == BinaryOpType::div) {
-      return lhs / rhs;
-    }
-    if constexpr (std::is_integral_v<T>) {
-      if (op == BinaryOpType::mod) {
-        return lhs % rhs;
-      }
-      if (op == BinaryOpType::bit_and) {
-        return lhs & rhs;
-      }
-      if (op == BinaryOpType::bit_shr) {
-        return static_cast<std::make_unsigned_t<T>>(lhs) >> rhs;
-      }
-    }
-    return std::nullopt;
-  }
-
-  template <typename T>
   void insert_or_failed(const Stmt *stmt,
-                        DataType dt,
-                        std::optional<T> val_opt) {
+                        const std::optional<TypedConstant> &val_opt) {
     if (!val_opt) {
       failed_ = true;
       return;
     }
-    context_.insert(stmt, TypedConstant(dt, val_opt.value()));
+    context_.insert(stmt, val_opt.value());
   }
 
   template <typename T>
@@ -178,6 +478,99 @@ class EvalVisitor : public IRVisitor {
 
 }  // namespace
 
+std::optional<TypedConstant> ArithmeticInterpretor::eval_binary_op(
+    BinaryOpType op,
+    DataType ret_type,
+    const TypedConstant &lhs,
+    const TypedConstant &rhs,
+    const EvalOptions &options) {
+  std::optional<TypedConstant> result;
+  if (op == BinaryOpType::pow && is_integral(rhs.dt)) {
+    if (ret_type != lhs.dt) {
+      return std::nullopt;
+    }
+    dispatch_type(lhs.dt, [&](auto lhs_tag) {
+      using T = decltype(lhs_tag);
+      dispatch_type(rhs.dt, [&](auto rhs_tag) {
+        using E = decltype(rhs_tag);
+        if constexpr (std::is_integral_v<E>) {
+          auto res = eval_integral_pow<T, E>(get_value<T>(lhs),
+                                             get_value<E>(rhs), options);
+          if (res) {
+            result = make_constant(ret_type, res.value());
+          }
+        }
+      });
+    });
+    return result;
+  }
+  if (lhs.dt != rhs.dt) {
+    return std::nullopt;
+  }
+  dispatch_type(lhs.dt, [&](auto tag) {
+    using T = decltype(tag);
+    if (is_comparison(op)) {
+      // The backends sign-extend the i1 result, so true becomes -1.
+      auto res = eval_comparison(op, get_value<T>(lhs), get_value<T>(rhs));
+      if (res && ret_type->is_primitive(PrimitiveTypeID::i32)) {
+        result = make_constant(ret_type, int32(res.value() ? -1 : 0));
+      }
+    } else if (ret_type == lhs.dt) {
+      auto res = eval_same_type_bin_op(op, get_value<T>(lhs),
+                                       get_value<T>(rhs), options);
+      if (res) {
+        result = make_constant(ret_type, res.value());
+      }
+    }
+  });
+  return result;
+}
+
+std::optional<TypedConstant> ArithmeticInterpretor::eval_unary_op(
+    UnaryOpType op,
+    DataType ret_type,
+    DataType cast_type,
+    const TypedConstant &operand,
+    const EvalOptions &options) {
+  std::optional<TypedConstant> result;
+  if (op == UnaryOpType::cast_bits) {
+    if (ret_type != cast_type || !ret_type->is<PrimitiveType>() ||
+        data_type_size(ret_type) != data_type_size(operand.dt)) {
+      return std::nullopt;
+    }
+    TypedConstant c(ret_type);
+    std::memcpy(&c.value_bits, &operand.value_bits, data_type_size(ret_type));
+    return c;
+  }
+  if (op == UnaryOpType::cast_value) {
+    if (ret_type != cast_type) {
+      return std::nullopt;
+    }
+    dispatch_type(operand.dt, [&](auto from_tag) {
+      using From = decltype(from_tag);
+      dispatch_type(cast_type, [&](auto to_tag) {
+        using To = decltype(to_tag);
+        auto res = eval_cast_value<From, To>(get_value<From>(operand));
+        if (res) {
+          result = make_constant(ret_type, res.value());
+        }
+      });
+    });
+    return result;
+  }
+  if (ret_type != operand.dt) {
+    return std::nullopt;
+  }
+  dispatch_type(operand.dt, [&](auto tag) {
+    using T = decltype(tag);
+    auto res = eval_same_type_unary_op(op, get_value<T>(operand), options);
+    if (res) {
+      result = make_constant(ret_type, res.value());
+    }
+  });
+  return result;
+}
+
 std::optional<TypedConstant> ArithmeticInterpretor::evaluate(
     const CodeRegion &region,
     const EvalContext &init_ctx) const {
@@ -85,6 +85,44 @@ class ArithmeticInterpretor {
     Stmt *end{nullptr};
   };
 
+  /**
+   * Options for evaluating a single operation on the host.
+   */
+  struct EvalOptions {
+    // Whether transcendental functions (sin, exp, pow, ...) may be evaluated
+    // with the host's libm. This is only bit-exact when the kernel runs on the
+    // host CPU, where the runtime calls the same functions.
+    bool host_math{false};
+    // Whether integer arithmetic that overflows should be left unevaluated,
+    // so that the overflow checks of the debug mode still fire at runtime.
+    bool check_overflow{false};
+  };
+
+  /**
+   * Evaluates a binary operation on constants with the semantics of the
+   * code generated by the backends, after demote_operations.
+   *
+   * @return: The result of type |ret_type|, empty if the result is undefined
+   *   (e.g. integer division by zero) or cannot be determined on the host.
+   */
+  static std::optional<TypedConstant> eval_binary_op(
+      BinaryOpType op,
+      DataType ret_type,
+      const TypedConstant &lhs,
+      const TypedConstant &rhs,
+      const EvalOptions &options);
+
+  /**
+   * Evaluates a unary operation (including casts to |cast_type|) on a
+   * constant. See eval_binary_op().
+   */
+  static std::optional<TypedConstant> eval_unary_op(
+      UnaryOpType op,
+      DataType ret_type,
+      DataType cast_type,
+      const TypedConstant &operand,
+      const EvalOptions &options);
+
   /**
    * Evaluates the sequence of CHI as defined in |region|.
    * @param region: A sequence of CHI statements to be evaluated
@@ -0,0 +1,161 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/ir/visitors.h"
+
+namespace taichi::lang {
+
+// Counts the floating-point operations and the bytes of global memory
+// accessed by one iteration of an offloaded task, weighting the bodies of
+// inner loops by their trip counts.
+class TaskCostEstimator : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  TaskCostEstimator() {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = false;
+  }
+
+  // Thread and block local storage is also accessed with global loads and
+  // stores, but isn't global memory traffic.
+  void visit(GlobalLoadStmt *stmt) override {
+    if (!is_local_ptr(stmt->src)) {
+      add_bytes(stmt->ret_type);
+    }
+  }
+
+  void visit(GlobalStoreStmt *stmt) override {
+    if (!is_local_ptr(stmt->dest)) {
+      add_bytes(stmt->val->ret_type);
+    }
+  }
+
+  void visit(AtomicOpStmt *stmt) override {
+    if (is_local_ptr(stmt->dest)) {
+      if (is_real(element_type(stmt->val->ret_type))) {
+        add_flops(stmt->val->ret_type);
+      }
+      return;
+    }
+    // The value is read and written back.
+    add_bytes(stmt->val->ret_type);
+    add_bytes(stmt->val->ret_type);
+    if (is_real(element_type(stmt->val->ret_type))) {
+      add_flops(stmt->val->ret_type);
+    }
+  }
+
+  void visit(BinaryOpStmt *stmt) override {
+    // Comparisons have integral results, and aren't counted.
+    if (is_real(element_type(stmt->ret_type))) {
+      add_flops(stmt->ret_type);
+    }
+  }
+
+  void visit(UnaryOpStmt *stmt) override {
+    if (stmt->is_cast()) {
+      return;
+    }
+    if (is_real(element_type(stmt->ret_type))) {
+      add_flops(stmt->ret_type);
+    }
+  }
+
+  void visit(RangeForStmt *stmt) override {
+    auto *begin = stmt->begin->cast<ConstStmt>();
+    auto *end = stmt->end->cast<ConstStmt>();
+    float64 trip_count = 1;
+    if (begin && end) {
+      trip_count =
+          std::max<int64>(0, end->val.val_int() - begin->val.val_int());
+    } else {
+      cost_.is_lower_bound = true;
+    }
+    auto saved = weight_;
+    weight_ *= trip_count;
+    stmt->body->accept(this);
+    weight_ = saved;
+  }
+
+  void visit(WhileStmt *stmt) override {
+    cost_.is_lower_bound = true;
+    stmt->body->accept(this);
+  }
+
+  static TaskCost run(OffloadedStmt *task) {
+    TaskCostEstimator estimator;
+    auto &cost = estimator.cost_;
+    if (task->body) {
+      task->body->accept(&estimator);
+    }
+    using Type = OffloadedStmt::TaskType;
+    if (task->task_type == Type::serial) {
+      cost.num_iterations = 1;
+    } else if (task->task_type == Type::range_for) {
+      if (task->const_begin && task->const_end) {
+        cost.num_iterations =
+            std::max<int64>(0, task->end_value - task->begin_value);
+      }
+    } else if (task->task_type == Type::struct_for) {
+      // Only dense loops visit every cell.
+      bool dense = true;
+      for (auto *s = task->snode; s != nullptr; s = s->parent) {
+        dense = dense && (s->type == SNodeType::dense ||
+                          s->type == SNodeType::root);
+      }
+      if (dense) {
+        cost.num_iterations =
+            task->snode->get_total_num_elements_towards_root();
+      }
+    }
+    return cost;
+  }
+
+ private:
+  static DataType element_type(DataType dt) {
+    if (auto *tensor_type = dt->cast<TensorType>()) {
+      return tensor_type->get_element_type();
+    }
+    return dt;
+  }
+
+  static int num_elements(DataType dt) {
+    if (auto *tensor_type = dt->cast<TensorType>()) {
+      return tensor_type->get_num_elements();
+    }
+    return 1;
+  }
+
+  static bool is_local_ptr(Stmt *ptr) {
+    if (auto *matrix_ptr = ptr->cast<MatrixPtrStmt>()) {
+      ptr = matrix_ptr->origin;
+    }
+    return ptr->is<AllocaStmt>() || ptr->is<ThreadLocalPtrStmt>() ||
+           ptr->is<BlockLocalPtrStmt>();
+  }
+
+  void add_bytes(DataType dt) {
+    cost_.bytes_per_iteration += weight_ * std::max(0, data_type_size(dt));
+  }
+
+  void add_flops(DataType dt) {
+    cost_.flops_per_iteration += weight_ * num_elements(dt);
+  }
+
+  TaskCost cost_;
+  float64 weight_{1};
+};
+
+namespace irpass::analysis {
+
+TaskCost estimate_task_cost(OffloadedStmt *task) {
+  TI_ASSERT(task);
+  return TaskCostEstimator::run(task);
+}
+
+}  // namespace irpass::analysis
+
+}  // namespace taichi::lang
@@ -0,0 +1,109 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi::lang {
+
+namespace irpass::analysis {
+
+namespace {
+
+// The union of two ranges, which is unrelated unless both of them are the
+// loop index plus a constant.
+DiffRange merge(const DiffRange &a, const DiffRange &b) {
+  if (!a.linear_related() || !b.linear_related()) {
+    return DiffRange();
+  }
+  return DiffRange(/*related=*/true, /*coeff=*/1, std::min(a.low, b.low),
+                   std::max(a.high, b.high));
+}
+
+void merge_into(const std::vector<DiffRange> &offsets,
+                std::vector<DiffRange> *ranges) {
+  if (ranges->empty()) {
+    *ranges = offsets;
+    return;
+  }
+  TI_ASSERT(ranges->size() == offsets.size());
+  for (int i = 0; i < (int)offsets.size(); i++) {
+    (*ranges)[i] = merge((*ranges)[i], offsets[i]);
+  }
+}
+
+void record_access(OffloadedStmt *task,
+                   GlobalPtrStmt *ptr,
+                   bool read,
+                   bool write,
+                   AccessFootprint *footprint) {
+  const bool is_loop = task->task_type == OffloadedTaskType::struct_for ||
+                       task->task_type == OffloadedTaskType::range_for;
+  const int num_indices = ptr->indices.size();
+  std::vector<DiffRange> offsets(num_indices);
+  for (int i = 0; i < num_indices; i++) {
+    // A range-for only has one loop index.
+    if (!is_loop || (task->task_type == OffloadedTaskType::range_for && i)) {
+      continue;
+    }
+    auto diff = value_diff_loop_index(ptr->indices[i], task, i);
+    if (!diff.linear_related()) {
+      continue;
+    }
+    // Both the indices of the SNode and the loop indices of a struct-for are
+    // shifted by the offsets of their fields.
+    int shift = 0;
+    if (!ptr->snode->index_offsets.empty()) {
+      shift += ptr->snode->index_offsets[i];
+    }
+    if (i < (int)task->index_offsets.size()) {
+      shift -= task->index_offsets[i];
+    }
+    offsets[i] = DiffRange(/*related=*/true, /*coeff=*/1, diff.low + shift,
+                           diff.high + shift);
+  }
+  if (read) {
+    merge_into(offsets, &footprint->reads);
+  }
+  if (write) {
+    merge_into(offsets, &footprint->writes);
+  }
+}
+
+}  // namespace
+
+std::vector<std::unordered_map<SNode *, AccessFootprint>>
+gather_access_footprints(IRNode *root) {
+  auto *block = root->as<Block>();
+  std::vector<std::unordered_map<SNode *, AccessFootprint>> footprints;
+  for (auto &offload : block->statements) {
+    auto *task = offload->as<OffloadedStmt>();
+    auto &task_footprints = footprints.emplace_back();
+    gather_statements(task, [&](Stmt *stmt) {
+      Stmt *ptr = nullptr;
+      bool read = false, write = false;
+      if (auto global_load = stmt->cast<GlobalLoadStmt>()) {
+        read = true;
+        ptr = global_load->src;
+      } else if (auto global_store = stmt->cast<GlobalStoreStmt>()) {
+        write = true;
+        ptr = global_store->dest;
+      } else if (auto global_atomic = stmt->cast<AtomicOpStmt>()) {
+        read = true;
+        write = true;
+        ptr = global_atomic->dest;
+      }
+      if (ptr) {
+        if (auto *global_ptr = ptr->cast<GlobalPtrStmt>()) {
+          record_access(task, global_ptr, read, write,
+                        &task_footprints[global_ptr->snode]);
+        }
+      }
+      return false;
+    });
+  }
+  return footprints;
+}
+
+}  // namespace irpass::analysis
+
+}  // namespace taichi::lang
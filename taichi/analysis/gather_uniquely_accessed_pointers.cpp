@@ -53,7 +53,8 @@ class LoopUniqueStmtSearcher : public BasicStmtVisitor {
 
     // op loop-unique -> loop-unique
     if (loop_unique_.count(stmt->operand) > 0 &&
-        (stmt->op_type == UnaryOpType::neg)) {
+        (stmt->op_type == UnaryOpType::neg ||
+         stmt->op_type == UnaryOpType::bit_not)) {
       // TODO: Other injective unary operations
       loop_unique_[stmt] = loop_unique_[stmt->operand];
     }
@@ -98,6 +99,24 @@ class LoopUniqueStmtSearcher : public BasicStmtVisitor {
          stmt->op_type == BinaryOpType::bit_xor)) {
       loop_unique_[stmt] = loop_unique_[stmt->rhs];
     }
+
+    // loop-unique * non-zero constant -> loop-unique
+    // The product only wraps around for indices that are out of bound anyway,
+    // e.g. a[2 * i] for i in range(n) is loop-unique.
+    if (stmt->op_type == BinaryOpType::mul) {
+      auto is_non_zero_constant = [](Stmt *operand) {
+        auto const_stmt = operand->cast<ConstStmt>();
+        return const_stmt && is_integral(const_stmt->val.dt) &&
+               const_stmt->val.val_int() != 0;
+      };
+      if (loop_unique_.count(stmt->lhs) > 0 &&
+          is_non_zero_constant(stmt->rhs)) {
+        loop_unique_[stmt] = loop_unique_[stmt->lhs];
+      } else if (loop_unique_.count(stmt->rhs) > 0 &&
+                 is_non_zero_constant(stmt->lhs)) {
+        loop_unique_[stmt] = loop_unique_[stmt->rhs];
+      }
+    }
   }
 
   bool is_partially_loop_unique(Stmt *stmt) const {
@@ -1,5 +1,8 @@
 #include "offline_cache_util.h"
 
+#include <cstring>
+#include <set>
+
 #include "taichi/ir/expr.h"
 #include "taichi/ir/frontend_ir.h"
 #include "taichi/ir/ir.h"
@@ -7,11 +10,60 @@
 #include "taichi/ir/type.h"
 #include "taichi/program/function.h"
 #include "taichi/program/program.h"
+#include "taichi/struct/snode_tree.h"
+
+#include "picosha2.h"
 
 namespace taichi::lang {
 
 namespace {
 
+// Buffers the serialized AST on its way to a stream or to a hasher, so that
+// hashing a kernel doesn't build its whole serialization in memory.
+class KeyWriter {
+ public:
+  explicit KeyWriter(std::ostream *os) : os_(os) {
+  }
+
+  explicit KeyWriter(picosha2::hash256_one_by_one *hasher) : hasher_(hasher) {
+  }
+
+  ~KeyWriter() {
+    flush();
+  }
+
+  void write(const char *bytes, std::size_t len) {
+    if (size_ + len > sizeof(buffer_)) {
+      flush();
+      if (len > sizeof(buffer_)) {
+        write_through(bytes, len);
+        return;
+      }
+    }
+    std::memcpy(buffer_ + size_, bytes, len);
+    size_ += len;
+  }
+
+  void flush() {
+    write_through(buffer_, size_);
+    size_ = 0;
+  }
+
+ private:
+  void write_through(const char *bytes, std::size_t len) {
+    if (os_) {
+      os_->write(bytes, len);
+    } else {
+      hasher_->process(bytes, bytes + len);
+    }
+  }
+
+  std::ostream *os_{nullptr};
+  picosha2::hash256_one_by_one *hasher_{nullptr};
+  char buffer_[4096];
+  std::size_t size_{0};
+};
+
 enum class ExprOpCode : std::uint8_t {
   NIL,
 #define PER_EXPRESSION(x) x,
@@ -47,27 +99,25 @@ enum class MeshRelationAccessType {
   Size,    // mesh_relation_size
 };
 
+struct SNodeTreeIdLess {
+  bool operator()(const SNodeTree *a, const SNodeTree *b) const {
+    return a->id() < b->id();
+  }
+};
+
 class ASTSerializer : public IRVisitor, public ExpressionVisitor {
  private:
   using ExpressionVisitor::visit;
   using IRVisitor::visit;
 
  public:
-  ASTSerializer(Program *prog, std::ostream *os)
-      : ExpressionVisitor(true), prog_(prog), os_(os) {
+  ASTSerializer(Program *prog, KeyWriter *out)
+      : ExpressionVisitor(true), prog_(prog), out_(out) {
     // TODO(PGZXB): Set allow_undefined_visitor as false. (blocked by
     // constant-folding)
     this->allow_undefined_visitor = true;
   }
 
-  void set_ostream(std::ostream *os) {
-    this->os_ = os;
-  }
-
-  std::ostream *get_ostream() {
-    return this->os_;
-  }
-
   void visit(Expression *expr) override {
     this->ExpressionVisitor::visit(expr);
   }
@@ -388,6 +438,9 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
     emit(stmt->strictly_serialized);
     emit(stmt->mem_access_opt);
     emit(stmt->block_dim);
+    emit(stmt->tile_shape);
+    emit(stmt->sort_elements);
+    emit(stmt->balance_elements);
     emit(stmt->body.get());
   }
 
@@ -414,28 +467,32 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
     emit(stmt->outputs);
   }
 
-  static void run(Program *prog, IRNode *ast, std::ostream *os) {
-    ASTSerializer serializer(prog, os);
+  static void run(Program *prog, IRNode *ast, KeyWriter *out) {
+    ASTSerializer serializer(prog, out);
     ast->accept(&serializer);
     serializer.emit_dependencies();
   }
 
  private:
   void emit_dependencies() {
-    // Serialize dependent real-functions
-    emit(real_funcs_.size());
+    // Serialize dependent real-functions, by the keys of their ASTs, in the
+    // order they are called first
+    std::vector<Function *> funcs(real_funcs_.size());
     for (auto &[func, id] : real_funcs_) {
-      if (auto &ast_str = func->try_get_ast_serialization_data();
-          ast_str.has_value()) {
-        emit_bytes(ast_str->c_str(), ast_str->size());
+      funcs[id] = func;
+    }
+    emit(funcs.size());
+    for (auto *func : funcs) {
+      if (const auto &ast_key = func->try_get_ast_key(); ast_key.has_value()) {
+        emit_bytes(ast_key->c_str(), ast_key->size());
       }
     }
 
     // Serialize snode_trees(Temporary: using offline-cache-key of SNode)
-    // Note: The result of serializing snode_tree_roots_ is not parsable now
-    emit(static_cast<std::size_t>(snode_tree_roots_.size()));
-    for (auto *snode : snode_tree_roots_) {
-      auto key = get_hashed_offline_cache_key_of_snode(snode);
+    // Note: The result of serializing snode_trees_ is not parsable now
+    emit(static_cast<std::size_t>(snode_trees_.size()));
+    for (auto *tree : snode_trees_) {
+      const auto &key = tree->get_offline_cache_key();
       emit_bytes(key.c_str(), key.size());
     }
 
@@ -447,15 +504,13 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
   template <typename T>
   void emit_pod(const T &val) {
     static_assert(std::is_pod<T>::value);
-    TI_ASSERT(os_);
-    os_->write((const char *)&val, sizeof(T));
+    out_->write((const char *)&val, sizeof(T));
   }
 
   void emit_bytes(const char *bytes, std::size_t len) {
-    TI_ASSERT(os_);
     if (!bytes)
       return;
-    os_->write(bytes, len);
+    out_->write(bytes, len);
   }
 
   template <typename T>
@@ -522,8 +577,7 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
     if (snode) {
       emit(static_cast<std::size_t>(snode->get_snode_tree_id()));
       emit(static_cast<std::size_t>(snode->id));
-      auto *root = prog_->get_snode_root(snode->get_snode_tree_id());
-      snode_tree_roots_.insert(root);
+      snode_trees_.insert(prog_->get_snode_tree(snode->get_snode_tree_id()));
     } else {
       emit(std::numeric_limits<std::size_t>::max());
       emit(std::numeric_limits<std::size_t>::max());
@@ -544,6 +598,8 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
     emit(mesh->patch_max_element_num);
     emit(mesh->owned_offset);
     emit(mesh->total_offset);
+    emit(mesh->owned_num);
+    emit(mesh->total_num);
     emit(mesh->index_mapping);
     emit(mesh->relations);
   }
@@ -644,8 +700,9 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
 #undef DEFINE_EMIT_ENUM
 
   Program *prog_{nullptr};
-  std::ostream *os_{nullptr};
-  std::unordered_set<SNode *> snode_tree_roots_;
+  KeyWriter *out_{nullptr};
+  // Ordered by id, so that the order doesn't depend on the addresses.
+  std::set<SNodeTree *, SNodeTreeIdLess> snode_trees_;
   std::unordered_map<Function *, std::size_t> real_funcs_;
   std::vector<char> string_pool_;
 };
@@ -653,7 +710,19 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
 }  // namespace
 
 void gen_offline_cache_key(Program *prog, IRNode *ast, std::ostream *os) {
-  ASTSerializer::run(prog, ast, os);
+  TI_ASSERT(os);
+  KeyWriter out(os);
+  ASTSerializer::run(prog, ast, &out);
+}
+
+std::string get_hashed_offline_cache_key_of_ast(Program *prog, IRNode *ast) {
+  picosha2::hash256_one_by_one hasher;
+  {
+    KeyWriter out(&hasher);
+    ASTSerializer::run(prog, ast, &out);
+  }
+  hasher.finish();
+  return picosha2::get_hash_hex_string(hasher);
 }
 
 }  // namespace taichi::lang
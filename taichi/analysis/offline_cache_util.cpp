@@ -2,13 +2,17 @@
 
 #include "taichi/common/core.h"
 #include "taichi/common/serialization.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/program/compile_config.h"
 #include "taichi/program/kernel.h"
+#include "taichi/program/program.h"
 
 #include "picosha2.h"
 
+#include <set>
 #include <vector>
 
 namespace taichi::lang {
@@ -25,9 +29,13 @@ static std::vector<std::uint8_t> get_offline_cache_key_of_compile_config(
   serializer(config->opt_level);
   serializer(config->external_optimization_level);
   serializer(config->move_loop_invariant_outside_if);
+  serializer(config->cache_loop_carried_global_loads);
   serializer(config->demote_dense_struct_fors);
+  serializer(config->fuse_offloads);
+  serializer(config->struct_for_tile_size);
   serializer(config->advanced_optimization);
   serializer(config->constant_folding);
+  serializer(config->worklist_simplify);
   serializer(config->kernel_profiler);
   serializer(config->fast_math);
   serializer(config->flatten_if);
@@ -39,21 +47,33 @@ static std::vector<std::uint8_t> get_offline_cache_key_of_compile_config(
   if (arch_is_cpu(config->arch)) {
     serializer(config->default_cpu_block_dim);
     serializer(config->cpu_max_num_threads);
+    serializer(config->cpu_tls_per_thread);
+    serializer(config->cpu_vectorize_width);
+    serializer(config->cpu_shared_runtime);
   } else if (arch_is_gpu(config->arch)) {
     serializer(config->default_gpu_block_dim);
     serializer(config->gpu_max_reg);
     serializer(config->saturating_grid_dim);
     serializer(config->cpu_max_num_threads);
+    serializer(config->gpu_autotune_block_dim);
+    serializer(config->gpu_warp_aggregated_atomics);
+    serializer(config->gpu_persistent_kernel);
+    serializer(config->gpu_fuse_serial_tasks);
   }
   serializer(config->ad_stack_size);
   serializer(config->default_ad_stack_size);
+  serializer(config->ad_stack_memory_budget);
+  serializer(config->ad_stack_window_size);
+  serializer(config->forward_ad_lanes);
   serializer(config->random_seed);
+  serializer(config->counter_based_rand);
   if (config->arch == Arch::cc) {
     serializer(config->cc_compile_cmd);
     serializer(config->cc_link_cmd);
   } else if (config->arch == Arch::opengl || config->arch == Arch::gles) {
     serializer(config->allow_nv_shader_extension);
   }
+  serializer(config->make_ndarray_block_local);
   serializer(config->make_mesh_block_local);
   serializer(config->optimize_mesh_reordered_mapping);
   serializer(config->mesh_localize_to_end_mapping);
@@ -100,6 +120,7 @@ static void get_offline_cache_key_of_snode_impl(
   serializer(snode->total_num_bits);
   serializer(snode->total_bit_start);
   serializer(snode->chunk_size);
+  serializer(snode->hash_table_size);
   serializer(snode->cell_size_bytes);
   serializer(snode->offset_bytes_in_parent_cell);
   serializer(snode->dt->to_string());
@@ -147,11 +168,23 @@ std::string get_hashed_offline_cache_key_of_snode(SNode *snode) {
 
 std::string get_hashed_offline_cache_key(const CompileConfig *config,
                                          Kernel *kernel) {
-  std::string kernel_ast_string;
+  std::string kernel_ast_key;
   if (kernel) {
-    std::ostringstream oss;
-    gen_offline_cache_key(kernel->program, kernel->ir.get(), &oss);
-    kernel_ast_string = oss.str();
+    if (kernel->ir_is_ast()) {
+      // The AST is left as is until it is lowered.
+      kernel_ast_key = kernel->get_cached_ast_key();
+      if (kernel_ast_key.empty()) {
+        kernel_ast_key = get_hashed_offline_cache_key_of_ast(kernel->program,
+                                                             kernel->ir.get());
+        kernel->set_ast_key_for_cache(kernel_ast_key);
+      }
+    } else if (!kernel->get_cached_ast_key().empty()) {
+      // e.g. the variants of a kernel specialized on its ndarray shapes.
+      kernel_ast_key = kernel->get_cached_ast_key();
+    } else {
+      kernel_ast_key = get_hashed_offline_cache_key_of_ast(kernel->program,
+                                                           kernel->ir.get());
+    }
   }
 
   std::vector<std::uint8_t> compile_config_key;
@@ -163,7 +196,7 @@ std::string get_hashed_offline_cache_key(const CompileConfig *config,
       std::to_string(static_cast<std::size_t>(kernel->autodiff_mode));
   picosha2::hash256_one_by_one hasher;
   hasher.process(compile_config_key.begin(), compile_config_key.end());
-  hasher.process(kernel_ast_string.begin(), kernel_ast_string.end());
+  hasher.process(kernel_ast_key.begin(), kernel_ast_key.end());
   hasher.process(autodiff_mode.begin(), autodiff_mode.end());
   hasher.finish();
 
@@ -172,4 +205,72 @@ std::string get_hashed_offline_cache_key(const CompileConfig *config,
   return res;
 }
 
+std::string get_hashed_offline_cache_key_of_task(const CompileConfig *config,
+                                                 Program *prog,
+                                                 OffloadedStmt *task) {
+  if (task->task_type == OffloadedTaskType::mesh_for) {
+    return "";
+  }
+  // The SNode trees the task accesses. Their layout is not part of the IR.
+  std::set<int> tree_ids;
+  bool cacheable = true;
+  auto add_snode = [&](SNode *snode) {
+    if (snode) {
+      tree_ids.insert(snode->get_snode_tree_id());
+    }
+  };
+  add_snode(task->snode);
+  irpass::analysis::gather_statements(task, [&](Stmt *stmt) {
+    if (stmt->is<FuncCallStmt>() || stmt->is<ExternalFuncCallStmt>()) {
+      // The printed IR does not cover the callee.
+      cacheable = false;
+    } else if (auto *ptr = stmt->cast<GlobalPtrStmt>()) {
+      add_snode(ptr->snode);
+    } else if (auto *ptrs = stmt->cast<MatrixOfGlobalPtrStmt>()) {
+      for (auto *snode : ptrs->snodes) {
+        add_snode(snode);
+      }
+    } else if (auto *snode_op = stmt->cast<SNodeOpStmt>()) {
+      add_snode(snode_op->snode);
+    } else if (auto *clear_list = stmt->cast<ClearListStmt>()) {
+      add_snode(clear_list->snode);
+    }
+    return false;
+  });
+  if (!cacheable) {
+    return "";
+  }
+
+  std::string task_ir_string;
+  irpass::print(task, &task_ir_string);
+  // Fields of the task that the IR printer leaves out.
+  BinaryOutputSerializer serializer;
+  serializer.initialize();
+  serializer(task->reversed);
+  serializer(task->is_bit_vectorized);
+  serializer(task->num_cpu_threads);
+  serializer(task->tls_size);
+  serializer(task->bls_size);
+  serializer(task->index_offsets);
+  serializer(task->tile_shape);
+  serializer(task->sort_elements);
+  serializer(task->balance_elements);
+  serializer.finalize();
+
+  auto compile_config_key = get_offline_cache_key_of_compile_config(config);
+  picosha2::hash256_one_by_one hasher;
+  hasher.process(compile_config_key.begin(), compile_config_key.end());
+  hasher.process(task_ir_string.begin(), task_ir_string.end());
+  hasher.process(serializer.data.begin(), serializer.data.end());
+  for (int tree_id : tree_ids) {
+    const auto &key = prog->get_snode_tree(tree_id)->get_offline_cache_key();
+    hasher.process(key.begin(), key.end());
+  }
+  hasher.finish();
+
+  auto res = picosha2::get_hash_hex_string(hasher);
+  res.insert(res.begin(), 'O');  // Unlike kernel keys, which start with 'T'
+  return res;
+}
+
 }  // namespace taichi::lang
@@ -11,10 +11,20 @@ class Program;
 class IRNode;
 class SNode;
 class Kernel;
+class OffloadedStmt;
 
 std::string get_hashed_offline_cache_key_of_snode(SNode *snode);
 std::string get_hashed_offline_cache_key(const CompileConfig *config,
                                          Kernel *kernel);
+// The key of a single offloaded task of the LLVM backends, so that the tasks
+// left unchanged by an edit to a kernel are reused from the offline cache.
+// Returns an empty string if the task cannot be cached on its own.
+std::string get_hashed_offline_cache_key_of_task(const CompileConfig *config,
+                                                 Program *prog,
+                                                 OffloadedStmt *task);
 void gen_offline_cache_key(Program *prog, IRNode *ast, std::ostream *os);
+// The hash of what gen_offline_cache_key() writes, without building it in
+// memory.
+std::string get_hashed_offline_cache_key_of_ast(Program *prog, IRNode *ast);
 
 }  // namespace taichi::lang
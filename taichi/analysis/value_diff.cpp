@@ -174,8 +174,9 @@ namespace analysis {
 DiffRange value_diff_loop_index(Stmt *stmt, Stmt *loop, int index_id) {
   TI_ASSERT(loop->is<StructForStmt>() || loop->is<OffloadedStmt>());
   if (loop->is<OffloadedStmt>()) {
-    TI_ASSERT(loop->as<OffloadedStmt>()->task_type ==
-              OffloadedStmt::TaskType::struct_for);
+    const auto task_type = loop->as<OffloadedStmt>()->task_type;
+    TI_ASSERT(task_type == OffloadedStmt::TaskType::struct_for ||
+              task_type == OffloadedStmt::TaskType::range_for);
   }
   if (auto loop_index = stmt->cast<LoopIndexStmt>(); loop_index) {
     if (loop_index->loop == loop && loop_index->index == index_id) {
@@ -4,15 +4,74 @@
 #include "taichi/program/texture.h"
 #include "taichi/program/kernel.h"
 
+#include <deque>
 #include <numeric>
 
 namespace taichi::lang {
 namespace aot {
 
+namespace {
+
+// Checks that |ival| can be passed as |symbolic_arg|.
+void check_arg(const Arg &symbolic_arg, const IValue &ival) {
+  if (symbolic_arg.tag == aot::ArgKind::kNdarray) {
+    TI_ASSERT(ival.tag == aot::ArgKind::kNdarray);
+    Ndarray *arr = reinterpret_cast<Ndarray *>(ival.val);
+
+    TI_ERROR_IF(arr->get_element_shape() != symbolic_arg.element_shape,
+                "Mismatched shape information for argument {}",
+                symbolic_arg.name);
+    TI_ERROR_IF(arr->shape.size() != symbolic_arg.field_dim,
+                "Dispatch node is compiled for argument {} with "
+                "field_dim={} but got an ndarray with field_dim={}",
+                symbolic_arg.name, symbolic_arg.field_dim, arr->shape.size());
+
+    // CGraph uses aot::Arg as symbolic argument, which represents
+    // TensorType via combination of element_shape and PrimitiveTypeID
+    // Therefore we only check for element_type for now.
+    //
+    // TODO(zhanlue): Replace all "element_shape + PrimitiveType" use cases
+    // with direct use of "TensorType",
+    //                In the end, "element_shape" should only appear inside
+    //                TensorType and nowhere else.
+    //
+    //                This refactor includes aot::Arg, kernel::Arg,
+    //                MetalDataType, and more...
+    DataType symbolic_arg_primitive_dtype = symbolic_arg.dtype();
+    if (symbolic_arg.dtype()->is<TensorType>()) {
+      symbolic_arg_primitive_dtype =
+          symbolic_arg.dtype()->cast<TensorType>()->get_element_type();
+    }
+
+    DataType arr_primitive_dtype = arr->dtype;
+    if (arr->dtype->is<TensorType>()) {
+      arr_primitive_dtype = arr->dtype->cast<TensorType>()->get_element_type();
+    }
+
+    TI_ERROR_IF(arr_primitive_dtype != symbolic_arg_primitive_dtype,
+                "Dispatch node is compiled for argument {} with "
+                "dtype={} but got an ndarray with dtype={}",
+                symbolic_arg.name, symbolic_arg_primitive_dtype.to_string(),
+                arr_primitive_dtype.to_string());
+  } else if (symbolic_arg.tag == aot::ArgKind::kScalar ||
+             symbolic_arg.tag == aot::ArgKind::kMatrix) {
+    TI_ASSERT(ival.tag == aot::ArgKind::kScalar);
+  } else if (symbolic_arg.tag == aot::ArgKind::kTexture ||
+             symbolic_arg.tag == aot::ArgKind::kRWTexture) {
+    TI_ASSERT(ival.tag == aot::ArgKind::kTexture);
+  } else {
+    TI_ERROR("Error in compiled graph: unknown tag {}", ival.tag);
+  }
+}
+
+}  // namespace
+
 void CompiledGraph::run(
     const std::unordered_map<std::string, IValue> &args) const {
-  for (const auto &dispatch : dispatches) {
-    RuntimeContext ctx = ctx_;
+  std::vector<RuntimeContext> ctxs(dispatches.size(), ctx_);
+  for (int dispatch_id = 0; dispatch_id < dispatches.size(); ++dispatch_id) {
+    const auto &dispatch = dispatches[dispatch_id];
+    RuntimeContext &ctx = ctxs[dispatch_id];
 
     TI_ASSERT(dispatch.ti_kernel || dispatch.compiled_kernel);
 
@@ -20,82 +79,238 @@ void CompiledGraph::run(
     const auto &symbolic_args_ = dispatch.symbolic_args;
     for (int i = 0; i < symbolic_args_.size(); ++i) {
       auto &symbolic_arg = symbolic_args_[i];
+      auto temp = temporaries.find(symbolic_arg.name);
+      if (temp != temporaries.end()) {
+        TI_ERROR_IF(args.count(symbolic_arg.name),
+                    "{} is a temporary of the graph", symbolic_arg.name);
+        const auto &buffer = temporary_buffers[temp->second.buffer_id];
+        ctx.set_arg_ndarray(i, buffer->get_device_allocation_ptr_as_int(),
+                            temp->second.shape);
+        continue;
+      }
       auto found = args.find(symbolic_arg.name);
       TI_ERROR_IF(found == args.end(), "Missing runtime value for {}",
                   symbolic_arg.name);
       const aot::IValue &ival = found->second;
+      check_arg(symbolic_arg, ival);
       if (symbolic_arg.tag == aot::ArgKind::kNdarray) {
-        TI_ASSERT(ival.tag == aot::ArgKind::kNdarray);
         Ndarray *arr = reinterpret_cast<Ndarray *>(ival.val);
-
-        TI_ERROR_IF(arr->get_element_shape() != symbolic_arg.element_shape,
-                    "Mismatched shape information for argument {}",
-                    symbolic_arg.name);
-        TI_ERROR_IF(arr->shape.size() != symbolic_arg.field_dim,
-                    "Dispatch node is compiled for argument {} with "
-                    "field_dim={} but got an ndarray with field_dim={}",
-                    symbolic_arg.name, symbolic_arg.field_dim,
-                    arr->shape.size());
-
-        // CGraph uses aot::Arg as symbolic argument, which represents
-        // TensorType via combination of element_shape and PrimitiveTypeID
-        // Therefore we only check for element_type for now.
-        //
-        // TODO(zhanlue): Replace all "element_shape + PrimitiveType" use cases
-        // with direct use of "TensorType",
-        //                In the end, "element_shape" should only appear inside
-        //                TensorType and nowhere else.
-        //
-        //                This refactor includes aot::Arg, kernel::Arg,
-        //                MetalDataType, and more...
-        DataType symbolic_arg_primitive_dtype = symbolic_arg.dtype();
-        if (symbolic_arg.dtype()->is<TensorType>()) {
-          symbolic_arg_primitive_dtype =
-              symbolic_arg.dtype()->cast<TensorType>()->get_element_type();
-        }
-
-        DataType arr_primitive_dtype = arr->dtype;
-        if (arr->dtype->is<TensorType>()) {
-          arr_primitive_dtype =
-              arr->dtype->cast<TensorType>()->get_element_type();
-        }
-
-        TI_ERROR_IF(arr_primitive_dtype != symbolic_arg_primitive_dtype,
-                    "Dispatch node is compiled for argument {} with "
-                    "dtype={} but got an ndarray with dtype={}",
-                    symbolic_arg.name, symbolic_arg_primitive_dtype.to_string(),
-                    arr_primitive_dtype.to_string());
         ctx.set_arg_ndarray(i, arr->get_device_allocation_ptr_as_int(),
                             arr->shape);
       } else if (symbolic_arg.tag == aot::ArgKind::kScalar ||
                  symbolic_arg.tag == aot::ArgKind::kMatrix) {
-        TI_ASSERT(ival.tag == aot::ArgKind::kScalar);
         // Matrix args are flattened so they're same as scalars.
         ctx.set_arg(i, ival.val);
       } else if (symbolic_arg.tag == aot::ArgKind::kTexture) {
-        TI_ASSERT(ival.tag == aot::ArgKind::kTexture);
         Texture *tex = reinterpret_cast<Texture *>(ival.val);
         ctx.set_arg_texture(i, tex->get_device_allocation_ptr_as_int());
-      } else if (symbolic_arg.tag == aot::ArgKind::kRWTexture) {
-        TI_ASSERT(ival.tag == aot::ArgKind::kTexture);
+      } else {
         Texture *tex = reinterpret_cast<Texture *>(ival.val);
         ctx.set_arg_rw_texture(i, tex->get_device_allocation_ptr_as_int(),
                                tex->get_size());
-      } else {
-        TI_ERROR("Error in compiled graph: unknown tag {}", ival.tag);
       }
     }
+  }
+
+  std::vector<RuntimeContext *> ctx_ptrs;
+  for (auto &ctx : ctxs) {
+    ctx_ptrs.push_back(&ctx);
+  }
+  launch_all(ctx_ptrs);
+}
+
+void CompiledGraph::init_arg_slots() {
+  if (bound_ctxs_.size() == dispatches.size()) {
+    return;
+  }
+  bound_ctxs_.assign(dispatches.size(), ctx_);
+  for (int dispatch_id = 0; dispatch_id < dispatches.size(); ++dispatch_id) {
+    const auto &dispatch = dispatches[dispatch_id];
+    TI_ASSERT(dispatch.ti_kernel || dispatch.compiled_kernel);
+    for (int i = 0; i < dispatch.symbolic_args.size(); ++i) {
+      const auto &name = dispatch.symbolic_args[i].name;
+      auto [it, inserted] = arg_slot_ids_.try_emplace(name, arg_slots_.size());
+      if (inserted) {
+        arg_slots_.emplace_back().name = name;
+      }
+      arg_slots_[it->second].uses.emplace_back(dispatch_id, i);
+    }
+  }
+  // The temporaries stay bound to their buffers.
+  for (auto &arg_slot : arg_slots_) {
+    auto temp = temporaries.find(arg_slot.name);
+    if (temp == temporaries.end()) {
+      continue;
+    }
+    arg_slot.tag = aot::ArgKind::kNdarray;
+    arg_slot.shape = temp->second.shape;
+    arg_slot.alloc =
+        temporary_buffers[temp->second.buffer_id]->ndarray_alloc_;
+    const auto alloc_ptr = reinterpret_cast<intptr_t>(&arg_slot.alloc);
+    for (auto [dispatch_id, i] : arg_slot.uses) {
+      bound_ctxs_[dispatch_id].set_arg_ndarray(i, alloc_ptr, arg_slot.shape);
+    }
+  }
+}
+
+int CompiledGraph::get_arg_slot(const std::string &name) {
+  init_arg_slots();
+  auto found = arg_slot_ids_.find(name);
+  return found == arg_slot_ids_.end() ? -1 : found->second;
+}
+
+void CompiledGraph::bind(int slot, const IValue &value) {
+  init_arg_slots();
+  TI_ASSERT(slot >= 0 && slot < arg_slots_.size());
+  auto &arg_slot = arg_slots_[slot];
+  TI_ERROR_IF(temporaries.count(arg_slot.name),
+              "{} is a temporary of the graph", arg_slot.name);
+  uint64 val = value.val;
+  std::vector<int> shape;
+  DeviceAllocation alloc = kDeviceNullAllocation;
+  if (value.tag == aot::ArgKind::kNdarray) {
+    const auto *arr = reinterpret_cast<const Ndarray *>(value.val);
+    alloc = arr->ndarray_alloc_;
+    shape = arr->shape;
+    val = 0;
+  } else if (value.tag == aot::ArgKind::kTexture) {
+    const auto *tex = reinterpret_cast<const Texture *>(value.val);
+    alloc = tex->get_device_allocation();
+    const auto size = tex->get_size();
+    shape.assign(size.begin(), size.end());
+    val = 0;
+  }
+  if (arg_slot.tag == value.tag && arg_slot.val == val &&
+      arg_slot.alloc == alloc && arg_slot.shape == shape) {
+    return;
+  }
+
+  for (auto [dispatch_id, i] : arg_slot.uses) {
+    check_arg(dispatches[dispatch_id].symbolic_args[i], value);
+  }
+  arg_slot.tag = value.tag;
+  arg_slot.val = val;
+  arg_slot.shape = std::move(shape);
+  arg_slot.alloc = alloc;
+  const auto alloc_ptr = reinterpret_cast<intptr_t>(&arg_slot.alloc);
+  for (auto [dispatch_id, i] : arg_slot.uses) {
+    RuntimeContext &ctx = bound_ctxs_[dispatch_id];
+    const auto tag = dispatches[dispatch_id].symbolic_args[i].tag;
+    if (tag == aot::ArgKind::kNdarray) {
+      ctx.set_arg_ndarray(i, alloc_ptr, arg_slot.shape);
+    } else if (tag == aot::ArgKind::kScalar || tag == aot::ArgKind::kMatrix) {
+      ctx.set_arg(i, val);
+    } else if (tag == aot::ArgKind::kTexture) {
+      ctx.set_arg_texture(i, alloc_ptr);
+    } else {
+      ctx.set_arg_rw_texture(
+          i, alloc_ptr,
+          {arg_slot.shape[0], arg_slot.shape[1], arg_slot.shape[2]});
+    }
+  }
+}
+
+void CompiledGraph::run_bound() {
+  init_arg_slots();
+  for (const auto &arg_slot : arg_slots_) {
+    TI_ERROR_IF(arg_slot.tag == aot::ArgKind::kUnknown,
+                "Missing runtime value for {}", arg_slot.name);
+  }
+  std::vector<RuntimeContext *> ctx_ptrs;
+  for (auto &ctx : bound_ctxs_) {
+    ctx_ptrs.push_back(&ctx);
+  }
+  launch_all(ctx_ptrs);
+}
 
-    if (dispatch.compiled_kernel) {
-      // Run cgraph loaded from AOT module
-      dispatch.compiled_kernel->launch(&ctx);
+void CompiledGraph::launch_all(
+    const std::vector<RuntimeContext *> &ctxs) const {
+  // The launches submitted at once, with their host contexts.
+  std::vector<int> dispatch_ids;
+  std::vector<RuntimeContext *> launch_ctxs;
+  // Launches may overwrite the arguments of their host contexts, so the
+  // dispatches of loop bodies, which are launched more than once, get copies.
+  std::deque<RuntimeContext> copies;
+  auto add = [&](int dispatch_id, bool copy) {
+    dispatch_ids.push_back(dispatch_id);
+    if (copy) {
+      launch_ctxs.push_back(&copies.emplace_back(*ctxs[dispatch_id]));
     } else {
-      // JIT & Run
-      TI_ASSERT(dispatch.ti_kernel);
-      lang::Kernel::LaunchContextBuilder launch_ctx(dispatch.ti_kernel, &ctx);
-      auto *ker = dispatch.ti_kernel;
-      ker->operator()(ker->program->this_thread_config(), launch_ctx);
+      launch_ctxs.push_back(ctxs[dispatch_id]);
     }
+  };
+  auto submit = [&]() {
+    if (dispatch_ids.empty()) {
+      return;
+    }
+    if (!runner || !runner->run(*this, dispatch_ids, launch_ctxs)) {
+      for (int i = 0; i < dispatch_ids.size(); ++i) {
+        launch_dispatch(dispatch_ids[i], launch_ctxs[i]);
+      }
+    }
+    dispatch_ids.clear();
+    launch_ctxs.clear();
+    copies.clear();
+  };
+
+  int next = 0;
+  for (const auto &loop : loops) {
+    for (; next < loop.begin; ++next) {
+      add(next, /*copy=*/false);
+    }
+    for (int iter = 0; iter < loop.max_iterations;) {
+      const int remaining = loop.max_iterations - iter;
+      const int n = loop.check_every > 0
+                        ? std::min(loop.check_every, remaining)
+                        : remaining;
+      for (int i = 0; i < n; ++i) {
+        for (int dispatch_id = loop.begin; dispatch_id < loop.end;
+             ++dispatch_id) {
+          add(dispatch_id, /*copy=*/true);
+        }
+      }
+      iter += n;
+      if (loop.check_every > 0 && iter < loop.max_iterations) {
+        submit();
+        if (!loop_condition(loop, ctxs)) {
+          break;
+        }
+      }
+    }
+    next = loop.end;
+  }
+  for (; next < dispatches.size(); ++next) {
+    add(next, /*copy=*/false);
+  }
+  submit();
+}
+
+bool CompiledGraph::loop_condition(
+    const CompiledLoop &loop,
+    const std::vector<RuntimeContext *> &ctxs) const {
+  auto *kernel = dispatches[loop.cond_dispatch].ti_kernel;
+  TI_ERROR_IF(kernel == nullptr,
+              "Loops are only supported in graphs compiled at runtime");
+  // The host contexts of loop bodies are never launched, so they still point
+  // to the allocations of the ndarrays.
+  auto *alloc =
+      ctxs[loop.cond_dispatch]->get_arg<DeviceAllocation *>(loop.cond_arg);
+  Ndarray cond(kernel->program, *alloc, PrimitiveType::i32, {}, [] {});
+  return cond.read_int({}) != 0;
+}
+
+void CompiledGraph::launch_dispatch(int dispatch_id,
+                                    RuntimeContext *ctx) const {
+  const auto &dispatch = dispatches[dispatch_id];
+  if (dispatch.compiled_kernel) {
+    // Run cgraph loaded from AOT module
+    dispatch.compiled_kernel->launch(ctx);
+  } else {
+    // JIT & Run
+    TI_ASSERT(dispatch.ti_kernel);
+    lang::Kernel::LaunchContextBuilder launch_ctx(dispatch.ti_kernel, ctx);
+    auto *ker = dispatch.ti_kernel;
+    ker->operator()(ker->program->this_thread_config(), launch_ctx);
   }
 }
 }  // namespace aot
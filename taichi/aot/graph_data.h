@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -155,14 +156,147 @@ struct CompiledDispatch {
   TI_IO_DEF(kernel_name, symbolic_args);
 };
 
+/**
+ * A bounded loop over a range of the dispatches of a graph, see
+ * GraphBuilder::new_loop_node().
+ */
+struct CompiledLoop {
+  // The dispatches [begin, end) of the body.
+  int begin{0};
+  int end{0};
+  // The 0-D i32 ndarray argument that the body clears to stop the loop.
+  std::string cond;
+  // The first dispatch of the body taking |cond|, and the argument id.
+  int cond_dispatch{-1};
+  int cond_arg{-1};
+  int max_iterations{0};
+  // The iterations launched between two reads of |cond| by the host, or 0 to
+  // launch all of them at once.
+  int check_every{1};
+
+  TI_IO_DEF(begin,
+            end,
+            cond,
+            cond_dispatch,
+            cond_arg,
+            max_iterations,
+            check_every);
+};
+
+struct CompiledGraph;
+
+class TI_DLL_EXPORT GraphRunner {
+ public:
+  virtual ~GraphRunner() = default;
+
+  /**
+   * @brief Launches a sequence of dispatches of a graph at once
+   *
+   * @param graph The graph to run
+   * @param dispatch_ids The dispatches to launch, in order. A dispatch appears
+   * more than once in the bodies of loops.
+   * @param ctxs The host context of every launch
+   * @return false if nothing has been launched, and the dispatches have to be
+   * launched one by one instead
+   */
+  virtual bool run(const CompiledGraph &graph,
+                   const std::vector<int> &dispatch_ids,
+                   const std::vector<RuntimeContext *> &ctxs) = 0;
+};
+
+/**
+ * An ndarray argument owned by the graph, which is only passed between its
+ * dispatches. See GraphBuilder::declare_temporary().
+ */
+struct Temporary {
+  std::vector<int> shape;
+  // In bytes.
+  size_t size{0};
+  // The first and the last dispatch taking the temporary.
+  int first_use{-1};
+  int last_use{-1};
+  // Temporaries whose lifetimes do not overlap share a buffer.
+  int buffer_id{-1};
+};
+
 struct TI_DLL_EXPORT CompiledGraph {
   std::vector<CompiledDispatch> dispatches;
   std::unordered_map<std::string, aot::Arg> args;
   RuntimeContext ctx_;
+  // Backends may set this to replay commands recorded for previous runs,
+  // instead of launching every dispatch again.
+  std::shared_ptr<GraphRunner> runner{nullptr};
+  // The temporaries are not passed to run() or bind(). Their contents are
+  // undefined at the first dispatch taking them.
+  std::unordered_map<std::string, Temporary> temporaries;
+  std::vector<std::shared_ptr<Ndarray>> temporary_buffers;
+  // Sorted and disjoint. Their dispatches are launched by run() and
+  // run_bound() as many times as the loops iterate.
+  std::vector<CompiledLoop> loops;
 
   void run(const std::unordered_map<std::string, IValue> &args) const;
 
+  // Launches a single dispatch with its prepared host context. Runners use
+  // this to launch the dispatches themselves.
+  void launch_dispatch(int dispatch_id, RuntimeContext *ctx) const;
+
+  /**
+   * @brief Returns the slot of an argument for bind()
+   *
+   * The names of the arguments are resolved to slots on the first call.
+   *
+   * @param name The name of the symbolic argument
+   * @return -1 if no dispatch of the graph takes the argument
+   */
+  int get_arg_slot(const std::string &name);
+
+  /**
+   * @brief Sets an argument of the following run_bound() calls
+   *
+   * The value is only validated and written to the host contexts of the
+   * dispatches taking it if it differs from the value bound last time. The
+   * ndarrays and textures are not referenced after this returns.
+   *
+   * @param slot The slot returned by get_arg_slot()
+   * @param value The runtime value of the argument
+   */
+  void bind(int slot, const IValue &value);
+
+  /**
+   * @brief Launches the dispatches with the bound arguments
+   *
+   * Unlike run(), this reuses the host contexts of the graph, so a graph must
+   * not be bound or run this way from several threads at once.
+   */
+  void run_bound();
+
   TI_IO_DEF(dispatches);
+
+  // The state of bind() and run_bound(). These are public so that graphs can
+  // still be aggregate-initialized.
+  struct ArgSlot {
+    std::string name;
+    // The (dispatch id, argument id) pairs taking the argument.
+    std::vector<std::pair<int, int>> uses;
+    // What the host contexts are set to, kUnknown until the slot is bound:
+    // the scalar, or the allocation and the shape of the ndarray or texture.
+    ArgKind tag{ArgKind::kUnknown};
+    uint64 val{0};
+    std::vector<int> shape;
+    // The contexts point to this, since the bound values may be temporaries.
+    DeviceAllocation alloc{kDeviceNullAllocation};
+  };
+  std::unordered_map<std::string, int> arg_slot_ids_;
+  std::vector<ArgSlot> arg_slots_;
+  std::vector<RuntimeContext> bound_ctxs_;
+
+ private:
+  void init_arg_slots();
+  // Launches the dispatches and the loops with the host contexts |ctxs|.
+  void launch_all(const std::vector<RuntimeContext *> &ctxs) const;
+  // Reads whether the body of |loop| has cleared its condition.
+  bool loop_condition(const CompiledLoop &loop,
+                      const std::vector<RuntimeContext *> &ctxs) const;
 };
 
 }  // namespace aot
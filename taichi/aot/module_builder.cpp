@@ -24,6 +24,13 @@ void AotModuleBuilder::add_kernel_template(const std::string &identifier,
   add_per_backend_tmpl(identifier, key, kernel);
 }
 
+void AotModuleBuilder::add_with_spec_constants(
+    const std::string &identifier,
+    Kernel *kernel,
+    const std::vector<std::pair<std::string, int>> &spec_constant_args) {
+  add_per_backend_with_spec_constants(identifier, kernel, spec_constant_args);
+}
+
 bool AotModuleBuilder::all_fields_are_dense_in_container(
     const SNode *container) {
   for (const auto &ch : container->ch) {
@@ -55,6 +62,10 @@ void AotModuleBuilder::add_graph(const std::string &name,
   if (graphs_.count(name) != 0) {
     TI_ERROR("Graph {} already exists", name);
   }
+  TI_ERROR_IF(!graph.temporaries.empty(),
+              "Graph {} with temporaries cannot be saved", name);
+  TI_ERROR_IF(!graph.loops.empty(), "Graph {} with loops cannot be saved",
+              name);
   // Handle adding kernels separately.
   std::unordered_map<std::string, lang::Kernel *> kernels;
   for (const auto &dispatch : graph.dispatches) {
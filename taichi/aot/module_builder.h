@@ -32,6 +32,14 @@ class AotModuleBuilder {
                            const std::string &key,
                            Kernel *kernel);
 
+  // Like add(), but the scalar arguments of |spec_constant_args|, given by
+  // name and index, are compiled as specialization constants. Their values
+  // are set when the kernel is loaded, through aot::KernelTemplate.
+  void add_with_spec_constants(
+      const std::string &identifier,
+      Kernel *kernel,
+      const std::vector<std::pair<std::string, int>> &spec_constant_args);
+
   virtual void load(const std::string &output_dir);
 
   virtual void dump(const std::string &output_dir,
@@ -70,6 +78,15 @@ class AotModuleBuilder {
     TI_NOT_IMPLEMENTED;
   }
 
+  virtual void add_per_backend_with_spec_constants(
+      const std::string &identifier,
+      Kernel *kernel,
+      const std::vector<std::pair<std::string, int>> &spec_constant_args) {
+    TI_ERROR(
+        "Specialization constants are only supported on the SPIR-V based "
+        "backends");
+  }
+
   void dump_graph(std::string output_dir) const;
 
   static bool all_fields_are_dense_in_container(const SNode *container);
@@ -9,8 +9,25 @@ namespace {
 
 std::string make_kernel_key(
     const std::vector<KernelTemplateArg> &template_args) {
-  TI_NOT_IMPLEMENTED;
-  return "";
+  std::string key;
+  for (const auto &arg : template_args) {
+    key += arg.name();
+    key += '=';
+    key += std::to_string(arg.targ().index());
+    key += ':';
+    std::visit(
+        [&key](const auto &v) {
+          using T = std::decay_t<decltype(v)>;
+          if constexpr (std::is_same_v<T, const Field *>) {
+            key += fmt::format("{}", static_cast<const void *>(v));
+          } else {
+            key += fmt::format("{}", v);
+          }
+        },
+        arg.targ());
+    key += ';';
+  }
+  return key;
 }
 
 }  // namespace
@@ -23,6 +40,9 @@ Kernel *KernelTemplate::get_kernel(
     return itr->second.get();
   }
   auto k = make_new_kernel(template_args);
+  if (k == nullptr) {
+    return nullptr;
+  }
   auto *kptr = k.get();
   loaded_kernels_[key] = std::move(k);
   return kptr;
@@ -31,12 +31,21 @@ class TI_DLL_EXPORT Field {
 
 class TI_DLL_EXPORT KernelTemplateArg {
  public:
-  using ArgUnion = std::variant<bool, int64_t, uint64_t, const Field *>;
+  using ArgUnion =
+      std::variant<bool, int64_t, uint64_t, double, const Field *>;
   template <typename T>
   KernelTemplateArg(const std::string &name, T &&arg)
       : name_(name), targ_(std::forward<T>(arg)) {
   }
 
+  const std::string &name() const {
+    return name_;
+  }
+
+  const ArgUnion &targ() const {
+    return targ_;
+  }
+
  private:
   std::string name_;
   /**
@@ -88,6 +97,22 @@ class TI_DLL_EXPORT Module {
   Kernel *get_kernel(const std::string &name);
   KernelTemplate *get_kernel_template(const std::string &name);
   Field *get_snode_tree(const std::string &name);
+  struct PrefetchProgress {
+    std::size_t num_kernels{0};
+    std::size_t num_prefetched_kernels{0};
+  };
+
+  // Starts loading the kernels of |names|, or every kernel if |names| is
+  // empty, on worker threads, so that they are ready when asked for. Where
+  // the backend allows, the pipelines are created there too. The root buffer
+  // of the module must have been set up already.
+  virtual void prefetch_kernels(const std::vector<std::string> &names) {
+  }
+  // The kernels requested by all prefetch_kernels() calls so far, and how many
+  // of them are done.
+  virtual PrefetchProgress get_prefetch_progress() const {
+    return {};
+  }
 
   virtual std::unique_ptr<aot::CompiledGraph> get_graph(
       const std::string &name) {
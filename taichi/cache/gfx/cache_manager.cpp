@@ -18,8 +18,26 @@ constexpr char kAotMetadataFilename[] = "metadata.tcb";
 constexpr char kDebuggingAotMetadataFilename[] = "metadata.json";
 constexpr char kGraphMetadataFilename[] = "graphs.tcb";
 constexpr char kOfflineCacheMetadataFilename[] = "offline_cache_metadata.tcb";
+constexpr char kRemoteKernelFilenameExt[] = "spvpack";
 using CompiledKernelData = gfx::GfxRuntime::RegisterParams;
 
+// A kernel in the remote store of the offline cache.
+struct RemoteKernelData {
+  spirv::TaichiKernelAttributes kernel_attribs;
+  std::vector<std::vector<uint32_t>> task_spirv_source_codes;
+
+  TI_IO_DEF(kernel_attribs, task_spirv_source_codes);
+};
+
+std::string make_device_fingerprint(Arch arch,
+                                    const DeviceCapabilityConfig &caps) {
+  std::string res = arch_name(arch);
+  for (const auto &[cap, level] : caps.to_inner()) {
+    res += fmt::format(",{}={}", static_cast<int>(cap), level);
+  }
+  return res;
+}
+
 inline gfx::CacheManager::Metadata::KernelMetadata make_kernel_metadata(
     const std::string &key,
     const gfx::GfxRuntime::RegisterParams &compiled) {
@@ -150,6 +168,13 @@ CacheManager::CacheManager(Params &&init_params)
     }
   }
 
+  if (mode_ == MemAndDiskCache) {
+    remote_cache_ = offline_cache::make_cache_storage(
+        compile_config_.offline_cache_remote_url);
+    device_fingerprint_ =
+        make_device_fingerprint(init_params.arch, init_params.caps);
+  }
+
   caching_module_builder_ = std::make_unique<gfx::AotModuleBuilderImpl>(
       compiled_structs_, init_params.arch, compile_config_,
       std::move(init_params.caps));
@@ -271,6 +296,13 @@ std::optional<CompiledKernelData> CacheManager::try_load_cached_kernel(
       return compiled;
     }
   }
+  if (mode_ == MemAndDiskCache && remote_cache_) {
+    if (auto compiled = try_fetch_remote_kernel(key)) {
+      TI_DEBUG("Create kernel '{}' from the remote cache (key='{}')",
+               kernel->get_name(), key);
+      return compiled;
+    }
+  }
   return std::nullopt;
 }
 
@@ -290,9 +322,56 @@ CompiledKernelData CacheManager::compile_and_cache_kernel(
   auto kmetadata = make_kernel_metadata(key, *params_opt);
   offline_cache_metadata_.size += kmetadata.size;
   offline_cache_metadata_.kernels[key] = std::move(kmetadata);
+  if (mode_ == MemAndDiskCache && remote_cache_) {
+    publish_remote_kernel(key, *params_opt);
+  }
   return *params_opt;
 }
 
+std::optional<CompiledKernelData> CacheManager::try_fetch_remote_kernel(
+    const std::string &key) {
+  const auto remote_key = offline_cache::make_remote_cache_key(
+      offline_cache::kSpirvCacheSubPath,
+      key + "." + kRemoteKernelFilenameExt, device_fingerprint_);
+  std::string bytes;
+  RemoteKernelData data;
+  if (!remote_cache_->get(remote_key, bytes) ||
+      !read_from_binary(data, bytes.data(), bytes.size()) ||
+      data.kernel_attribs.name != key) {
+    return std::nullopt;
+  }
+  // Written to the local cache along with the kernels compiled here.
+  auto *cache_builder =
+      static_cast<gfx::AotModuleBuilderImpl *>(caching_module_builder_.get());
+  cache_builder->add_compiled_kernel(data.kernel_attribs,
+                                     data.task_spirv_source_codes);
+  auto params_opt = cache_builder->try_get_kernel_register_params(key);
+  TI_ASSERT(params_opt.has_value());
+  // TODO: Support multiple SNodeTrees in AOT.
+  params_opt->num_snode_trees = compiled_structs_.size();
+  auto kmetadata = make_kernel_metadata(key, *params_opt);
+  offline_cache_metadata_.size += kmetadata.size;
+  offline_cache_metadata_.kernels[key] = std::move(kmetadata);
+  return params_opt;
+}
+
+void CacheManager::publish_remote_kernel(const std::string &key,
+                                         const CompiledKernelData &compiled) {
+  RemoteKernelData data;
+  data.kernel_attribs = compiled.kernel_attribs;
+  data.task_spirv_source_codes = compiled.task_spirv_source_codes;
+  BinaryOutputSerializer writer;
+  writer.initialize();
+  writer(data);
+  writer.finalize();
+  const auto remote_key = offline_cache::make_remote_cache_key(
+      offline_cache::kSpirvCacheSubPath,
+      key + "." + kRemoteKernelFilenameExt, device_fingerprint_);
+  if (!remote_cache_->put(remote_key, writer.data.data(), writer.head)) {
+    TI_DEBUG("Failed to put {} to the remote offline cache", remote_key);
+  }
+}
+
 std::string CacheManager::make_kernel_key(const CompileConfig *config,
                                           Kernel *kernel) const {
   if (mode_ < MemAndDiskCache) {
@@ -52,6 +52,10 @@ class CacheManager {
                                               Kernel *kernel);
   std::string make_kernel_key(const CompileConfig *config,
                               Kernel *kernel) const;
+  std::optional<CompiledKernelData> try_fetch_remote_kernel(
+      const std::string &key);
+  void publish_remote_kernel(const std::string &key,
+                             const CompiledKernelData &compiled);
 
   Mode mode_{MemCache};
   std::string path_;
@@ -61,6 +65,10 @@ class CacheManager {
   Metadata offline_cache_metadata_;
   std::unique_ptr<AotModuleBuilder> caching_module_builder_{nullptr};
   std::unique_ptr<aot::Module> cached_module_{nullptr};
+  // The store of offline_cache_remote_url. The SPIR-V is kept there for each
+  // arch and set of device capabilities.
+  std::unique_ptr<offline_cache::CacheStorage> remote_cache_{nullptr};
+  std::string device_fingerprint_;
 };
 
 }  // namespace gfx
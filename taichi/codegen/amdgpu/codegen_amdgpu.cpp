@@ -171,19 +171,25 @@ class TaskCodeGenAMDGPU : public TaskCodeGenLLVM {
                        std::unordered_map<AtomicOpType, std::string>>
         fast_reductions;
 
-    fast_reductions[PrimitiveTypeID::i32][AtomicOpType::add] = "reduce_add_i32";
-    fast_reductions[PrimitiveTypeID::f32][AtomicOpType::add] = "reduce_add_f32";
-    fast_reductions[PrimitiveTypeID::i32][AtomicOpType::min] = "reduce_min_i32";
-    fast_reductions[PrimitiveTypeID::f32][AtomicOpType::min] = "reduce_min_f32";
-    fast_reductions[PrimitiveTypeID::i32][AtomicOpType::max] = "reduce_max_i32";
-    fast_reductions[PrimitiveTypeID::f32][AtomicOpType::max] = "reduce_max_f32";
+    fast_reductions[PrimitiveTypeID::i32][AtomicOpType::add] =
+        "amdgpu_reduce_add_i32";
+    fast_reductions[PrimitiveTypeID::f32][AtomicOpType::add] =
+        "amdgpu_reduce_add_f32";
+    fast_reductions[PrimitiveTypeID::i32][AtomicOpType::min] =
+        "amdgpu_reduce_min_i32";
+    fast_reductions[PrimitiveTypeID::f32][AtomicOpType::min] =
+        "amdgpu_reduce_min_f32";
+    fast_reductions[PrimitiveTypeID::i32][AtomicOpType::max] =
+        "amdgpu_reduce_max_i32";
+    fast_reductions[PrimitiveTypeID::f32][AtomicOpType::max] =
+        "amdgpu_reduce_max_f32";
 
     fast_reductions[PrimitiveTypeID::i32][AtomicOpType::bit_and] =
-        "reduce_and_i32";
+        "amdgpu_reduce_and_i32";
     fast_reductions[PrimitiveTypeID::i32][AtomicOpType::bit_or] =
-        "reduce_or_i32";
+        "amdgpu_reduce_or_i32";
     fast_reductions[PrimitiveTypeID::i32][AtomicOpType::bit_xor] =
-        "reduce_xor_i32";
+        "amdgpu_reduce_xor_i32";
 
     AtomicOpType op = stmt->op_type;
     if (fast_reductions.find(prim_type) == fast_reductions.end()) {
@@ -206,11 +212,9 @@ class TaskCodeGenAMDGPU : public TaskCodeGenLLVM {
     {
       auto guard = get_function_creation_guard(
           {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
-           get_tls_buffer_type(), tlctx->get_data_type<int>()});
+           get_tls_buffer_type(), get_range_for_index_type(stmt)});
 
-      auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
-      loop_vars_llvm[stmt].push_back(loop_var);
-      builder->CreateStore(get_arg(2), loop_var);
+      create_range_for_loop_var(stmt, get_arg(2));
       stmt->body->accept(this);
 
       body = guard.body;
@@ -219,7 +223,8 @@ class TaskCodeGenAMDGPU : public TaskCodeGenLLVM {
     auto epilogue = create_xlogue(stmt->tls_epilogue);
 
     auto [begin, end] = get_range_for_bounds(stmt);
-    call("gpu_parallel_range_for",
+    call(is_i64_range_for(stmt) ? "gpu_parallel_range_for_i64"
+                                : "gpu_parallel_range_for",
          {get_arg(0), begin, end, tls_prologue, body, epilogue,
           tlctx->get_constant(stmt->tls_size)});
   }
@@ -308,12 +313,13 @@ class TaskCodeGenAMDGPU : public TaskCodeGenLLVM {
       current_task->grid_dim = stmt->grid_dim;
       if (stmt->task_type == Type::range_for) {
         if (stmt->const_begin && stmt->const_end) {
-          int num_threads = stmt->end_value - stmt->begin_value;
-          int grid_dim = ((num_threads % stmt->block_dim) == 0)
-                             ? (num_threads / stmt->block_dim)
-                             : (num_threads / stmt->block_dim) + 1;
-          grid_dim = std::max(grid_dim, 1);
-          current_task->grid_dim = std::min(stmt->grid_dim, grid_dim);
+          int64 num_threads = stmt->end_value - stmt->begin_value;
+          int64 grid_dim = ((num_threads % stmt->block_dim) == 0)
+                               ? (num_threads / stmt->block_dim)
+                               : (num_threads / stmt->block_dim) + 1;
+          grid_dim = std::max<int64>(grid_dim, 1);
+          current_task->grid_dim =
+              (int)std::min<int64>(stmt->grid_dim, grid_dim);
         }
       }
       if (stmt->task_type == Type::listgen) {
@@ -327,6 +333,11 @@ class TaskCodeGenAMDGPU : public TaskCodeGenLLVM {
         AMDGPUDriver::get_instance().device_get_attribute(
             &num_SMs, HIP_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, 0);
         current_task->grid_dim = num_SMs * query_max_block_per_sm;
+        if (stmt->sort_elements &&
+            stmt->snode->parent->type != SNodeType::root) {
+          // element_listgen_nonroot_sorted runs in a single block.
+          current_task->grid_dim = 1;
+        }
       }
       current_task->block_dim = stmt->block_dim;
       TI_ASSERT(current_task->grid_dim != 0);
@@ -406,6 +417,11 @@ LLVMCompiledTask KernelCodeGenAMDGPU::compile_task(
 }
 
 FunctionType KernelCodeGenAMDGPU::compile_to_function() {
+  return convert_to_function(compile_kernel_to_module());
+}
+
+FunctionType KernelCodeGenAMDGPU::convert_to_function(
+    LLVMCompiledKernel data) {
   auto *llvm_prog = get_llvm_program(prog);
   const auto &config = *get_compile_config();
   auto *tlctx = llvm_prog->get_llvm_context(config.arch);
@@ -413,7 +429,7 @@ FunctionType KernelCodeGenAMDGPU::compile_to_function() {
   AMDGPUModuleToFunctionConverter converter{tlctx,
                                             llvm_prog->get_runtime_executor()};
 
-  return converter.convert(this->kernel, compile_kernel_to_module());
+  return converter.convert(this->kernel, std::move(data));
 }
 
 FunctionType AMDGPUModuleToFunctionConverter::convert(
@@ -19,6 +19,8 @@ class KernelCodeGenAMDGPU : public KernelCodeGen {
       const CompileConfig *config,
       std::unique_ptr<llvm::Module> &&module = nullptr,
       OffloadedStmt *stmt = nullptr) override;
+
+  FunctionType convert_to_function(LLVMCompiledKernel data) override;
 #endif  // TI_WITH_LLVM
 
   bool supports_offline_cache() const override {
@@ -61,10 +61,56 @@ void CCProgramImpl::materialize_snode_tree(SNodeTree *tree,
 }
 
 void CCProgramImpl::add_kernel(std::unique_ptr<CCKernel> kernel) {
+  pending_kernels_.push_back(kernel.get());
   kernels_.push_back(std::move(kernel));
   need_relink_ = true;
 }
 
+void CCProgramImpl::compile_pending_kernels() {
+  if (pending_kernels_.empty())
+    return;
+
+  // Every kernel is a single Tk_ function, so the queued ones share
+  // translation units, each of which pays for parsing the runtime header and
+  // the layout once. Large batches are split to use several compilers at once.
+  const std::size_t num_kernels = pending_kernels_.size();
+  const std::size_t num_units = std::min<std::size_t>(
+      std::max(1u, std::thread::hardware_concurrency()),
+      (num_kernels + kMinKernelsPerUnit - 1) / kMinKernelsPerUnit);
+  const std::size_t kernels_per_unit =
+      (num_kernels + num_units - 1) / num_units;
+
+  std::vector<std::string> src_paths;
+  for (std::size_t begin = 0; begin < num_kernels; begin += kernels_per_unit) {
+    const std::size_t end = std::min(begin + kernels_per_unit, num_kernels);
+    auto base_path =
+        fmt::format("{}/_rti_kernels{}", runtime_tmp_dir, num_kernel_units_++);
+    src_paths.push_back(base_path + ".c");
+    kernel_objects_.push_back(base_path + ".o");
+
+    std::ofstream src(src_paths.back());
+    src << runtime_->header << "\n" << layout_->source << "\n";
+    for (std::size_t i = begin; i < end; i++) {
+      src << pending_kernels_[i]->get_source() << "\n";
+    }
+  }
+  pending_kernels_.clear();
+
+  const std::size_t first = kernel_objects_.size() - src_paths.size();
+  std::vector<std::thread> compilers;
+  for (std::size_t i = 0; i < src_paths.size(); i++) {
+    compilers.emplace_back([this, &src_paths, first, i]() {
+      TI_DEBUG("[cc] compiling kernels [{}] -> [{}]", src_paths[i],
+               kernel_objects_[first + i]);
+      execute(config->cc_compile_cmd, kernel_objects_[first + i],
+              src_paths[i]);
+    });
+  }
+  for (auto &compiler : compilers) {
+    compiler.join();
+  }
+}
+
 void CCKernel::compile() {
   if (!kernel_->is_evaluator)
     ActionRecorder::get_instance().record(
@@ -73,14 +119,7 @@ void CCKernel::compile() {
                               ActionArg("kernel_source", source_),
                           });
 
-  obj_path_ = fmt::format("{}/{}.o", runtime_tmp_dir, name_);
-  src_path_ = fmt::format("{}/{}.c", runtime_tmp_dir, name_);
-
-  std::ofstream(src_path_) << cc_program_impl_->get_runtime()->header << "\n"
-                           << cc_program_impl_->get_layout()->source << "\n"
-                           << source_;
-  TI_DEBUG("[cc] compiling [{}] -> [{}]:\n{}\n", name_, obj_path_, source_);
-  execute(cc_program_impl_->config->cc_compile_cmd, obj_path_, src_path_);
+  TI_DEBUG("[cc] queueing [{}]:\n{}\n", name_, source_);
 }
 
 void CCRuntime::compile() {
@@ -153,13 +192,13 @@ void CCProgramImpl::relink() {
   if (!need_relink_)
     return;
 
+  compile_pending_kernels();
+
   dll_path_ = fmt::format("{}/libti_program.so", runtime_tmp_dir);
 
   std::vector<std::string> objects;
   objects.push_back(runtime_->get_object());
-  for (auto const &ker : kernels_) {
-    objects.push_back(ker->get_object());
-  }
+  objects.insert(objects.end(), kernel_objects_.begin(), kernel_objects_.end());
 
   TI_DEBUG("[cc] linking shared object [{}] with [{}]", dll_path_,
            fmt::join(objects, "] ["));
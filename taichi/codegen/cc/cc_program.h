@@ -15,6 +15,7 @@
 #include "taichi/util/lang_util.h"
 #include <vector>
 #include <memory>
+#include <thread>
 
 namespace taichi {
 class DynamicLoader;
@@ -76,9 +77,16 @@ class CCProgramImpl : public ProgramImpl {
   void context_to_result_buffer();
 
  private:
+  // Translation units of fewer kernels are not worth a compiler of their own.
+  static constexpr std::size_t kMinKernelsPerUnit = 16;
+
   void add_kernel(std::unique_ptr<CCKernel> kernel);
+  void compile_pending_kernels();
 
   std::vector<std::unique_ptr<CCKernel>> kernels_;
+  std::vector<CCKernel *> pending_kernels_;
+  std::vector<std::string> kernel_objects_;
+  int num_kernel_units_{0};
   std::unique_ptr<CCContext> context_;
   std::unique_ptr<CCRuntime> runtime_;
   std::unique_ptr<CCLayout> layout_;
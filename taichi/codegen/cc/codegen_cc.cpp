@@ -277,7 +277,7 @@ class CCTransformer : public IRVisitor {
       TI_ERROR("Unsupported function \"{}\" for DataType={} on C backend", name,
                data_type_name(dt));
 
-    if (name == "rsqrt") {
+    if (name == "rsqrt" || name == "popcnt") {
       ret = "Ti_" + ret;
     } else if (name == "sgn") {
       if (is_real(dt)) {
@@ -53,6 +53,12 @@ static inline Ti_f64 Ti_rsqrt(Ti_f64 x) {
 static inline Ti_i64 Ti_llabs(Ti_i64 x) {
   return x >= 0 ? x : -x;
 }
+static inline Ti_i32 Ti_popcnt(Ti_i32 x) {
+  return __builtin_popcount(x);
+}
+static inline Ti_i64 Ti_llpopcnt(Ti_i64 x) {
+  return __builtin_popcountll(x);
+}
 
 ) "\n" STR(
 
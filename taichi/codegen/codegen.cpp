@@ -16,11 +16,135 @@
 #endif
 #include "taichi/system/timer.h"
 #include "taichi/ir/analysis.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/analysis/offline_cache_util.h"
 
+#if defined(TI_WITH_LLVM)
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#endif
+
 namespace taichi::lang {
 
+#ifdef TI_WITH_LLVM
+namespace {
+
+// What link_compiled_tasks() needs to know about a cached task, besides its
+// module, is kept in the module as named metadata.
+constexpr char kUsedTreeIdsMetadata[] = "taichi.used_tree_ids";
+constexpr char kStructForTlsSizesMetadata[] = "taichi.struct_for_tls_sizes";
+
+void set_int_set_metadata(llvm::Module *module,
+                          const char *name,
+                          const std::unordered_set<int> &values) {
+  auto &ctx = module->getContext();
+  std::vector<llvm::Metadata *> elements;
+  for (int value : values) {
+    elements.push_back(llvm::ConstantAsMetadata::get(
+        llvm::ConstantInt::get(llvm::Type::getInt32Ty(ctx), value)));
+  }
+  module->getOrInsertNamedMetadata(name)->addOperand(
+      llvm::MDNode::get(ctx, elements));
+}
+
+std::optional<std::unordered_set<int>> take_int_set_metadata(
+    llvm::Module *module,
+    const char *name) {
+  auto *metadata = module->getNamedMetadata(name);
+  if (!metadata || metadata->getNumOperands() != 1) {
+    return std::nullopt;
+  }
+  std::unordered_set<int> values;
+  for (auto &element : metadata->getOperand(0)->operands()) {
+    auto *value = llvm::mdconst::dyn_extract<llvm::ConstantInt>(element);
+    if (!value) {
+      return std::nullopt;
+    }
+    values.insert((int)value->getSExtValue());
+  }
+  module->eraseNamedMetadata(metadata);
+  return values;
+}
+
+// Drops the entries of nvvm.annotations whose function has been removed from
+// |module|.
+void prune_nvvm_annotations(llvm::Module *module) {
+  auto *annotations = module->getNamedMetadata("nvvm.annotations");
+  if (!annotations) {
+    return;
+  }
+  std::vector<llvm::MDNode *> kept;
+  for (auto *node : annotations->operands()) {
+    if (node->getNumOperands() > 0 && node->getOperand(0) != nullptr) {
+      kept.push_back(node);
+    }
+  }
+  annotations->clearOperands();
+  for (auto *node : kept) {
+    annotations->addOperand(node);
+  }
+}
+
+// Compiles the tasks of the linked |module| in up to |num_parts| parts on
+// |workers|, each part in an LLVM context of its own.
+std::string compile_tasks_to_native(JITSession *jit,
+                                    ParallelExecutor &workers,
+                                    std::unique_ptr<llvm::Module> module,
+                                    const std::vector<OffloadedTask> &tasks,
+                                    int num_parts,
+                                    int max_reg) {
+  TI_AUTO_PROF;
+  llvm::SmallVector<char, 0> bitcode;
+  {
+    llvm::raw_svector_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(*module, os);
+  }
+  module.reset();
+
+  const int num_tasks = tasks.size();
+  num_parts = std::clamp(num_parts, 1, num_tasks);
+  std::vector<std::string> objects(num_parts);
+  std::vector<std::future<void>> compilations;
+  for (int part = 0; part < num_parts; part++) {
+    compilations.push_back(workers.enqueue([&, part] {
+      std::unordered_set<std::string> names;
+      for (int i = part * num_tasks / num_parts;
+           i < (part + 1) * num_tasks / num_parts; i++) {
+        names.insert(tasks[i].name);
+      }
+      llvm::LLVMContext context;
+      auto part_module = llvm::parseBitcodeFile(
+          llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()),
+                                "kernel"),
+          context);
+      TI_ERROR_IF(!part_module, "Failed to parse the kernel module: {}",
+                  llvm::toString(part_module.takeError()));
+      TaichiLLVMContext::eliminate_unused_functions(
+          part_module->get(),
+          [&](const std::string &name) { return names.count(name) > 0; });
+      prune_nvvm_annotations(part_module->get());
+      objects[part] = jit->compile_module_to_object(std::move(*part_module));
+    }));
+  }
+  // The pending compilations refer to the locals.
+  for (auto &compilation : compilations) {
+    compilation.wait();
+  }
+  for (auto &compilation : compilations) {
+    compilation.get();
+  }
+  return jit->link_objects_to_native(objects, max_reg);
+}
+
+}  // namespace
+#endif
+
 KernelCodeGen::KernelCodeGen(const CompileConfig *compile_config,
                              Kernel *kernel)
     : prog(kernel->program), kernel(kernel), compile_config_(compile_config) {
@@ -72,6 +196,14 @@ KernelCodeGen::maybe_read_compilation_from_cache(
   auto *tlctx = llvm_prog->get_llvm_context(config.arch);
   auto &llvm_ctx = *tlctx->get_this_thread_context();
 
+  if (config.offline_cache_native_code) {
+    const auto native_code_key = tlctx->jit->get_native_code_key();
+    LLVMCompiledKernel native;
+    if (!native_code_key.empty() &&
+        reader->get_native_code(native, kernel_key, native_code_key)) {
+      return {std::move(native)};
+    }
+  }
   if (!reader->get_kernel_cache(cache_data, kernel_key, llvm_ctx)) {
     return std::nullopt;
   }
@@ -84,20 +216,172 @@ void KernelCodeGen::cache_kernel(const std::string &kernel_key,
                                        infer_launch_args(kernel));
 }
 
+void KernelCodeGen::maybe_compile_to_native_code(LLVMCompiledKernel &data) {
+  const auto &config = *compile_config_;
+  const auto &kernel_key = kernel->get_cached_kernel_key();
+  if (!data.module) {
+    return;
+  }
+  const bool cache_native_code = uses_offline_cache() &&
+                                 config.offline_cache_native_code &&
+                                 !kernel_key.empty();
+  const bool split = config.llvm_split_kernel_module &&
+                     data.tasks.size() > 1 && !kernel->is_evaluator;
+  if (!cache_native_code && !split) {
+    return;
+  }
+  auto *llvm_prog = get_llvm_program(prog);
+  auto *jit = llvm_prog->get_llvm_context(config.arch)->jit.get();
+  data.native_code_key = jit->get_native_code_key();
+  if (data.native_code_key.empty()) {
+    return;
+  }
+  const int max_reg = arch_is_cpu(config.arch) ? 0 : config.gpu_max_reg;
+  if (split) {
+    data.native_code = compile_tasks_to_native(
+        jit, llvm_prog->compilation_workers, std::move(data.module),
+        data.tasks, config.num_compile_threads, max_reg);
+  } else {
+    data.native_code =
+        jit->compile_module_to_native(std::move(data.module), max_reg);
+  }
+  if (cache_native_code) {
+    llvm_prog->cache_native_code(kernel_key, data);
+  }
+}
+
+FunctionType KernelCodeGen::maybe_make_tiered_function(
+    LLVMCompiledKernel &data,
+    std::function<FunctionType(LLVMCompiledKernel)> convert) {
+  const auto &config = *compile_config_;
+  if (!config.tiered_compilation || !data.module || kernel->is_evaluator) {
+    return nullptr;
+  }
+  auto *llvm_prog = get_llvm_program(prog);
+  auto *tlctx = llvm_prog->get_llvm_context(config.arch);
+  auto *workers = &llvm_prog->compilation_workers;
+  // The optimized compilation parses a copy of the module in the LLVM context
+  // of the thread it runs on.
+  auto bitcode = std::make_shared<std::string>();
+  {
+    llvm::raw_string_ostream os(*bitcode);
+    llvm::WriteBitcodeToFile(*data.module, os);
+  }
+  auto tasks = data.tasks;
+  JITSession::set_module_opt_level(*data.module, 0);
+
+  struct TieredFunction {
+    // Swapped atomically, the launches in flight keep the code they run.
+    std::shared_ptr<FunctionType> func;
+    std::atomic<int> num_launches{0};
+  };
+  auto tiered = std::make_shared<TieredFunction>();
+  tiered->func = std::make_shared<FunctionType>(convert(std::move(data)));
+  const int threshold = std::max(config.tiered_compilation_threshold, 1);
+  const auto kernel_name = kernel->get_name();
+  return [=](RuntimeContext &ctx) {
+    auto func = std::atomic_load(&tiered->func);
+    (*func)(ctx);
+    if (tiered->num_launches.fetch_add(1) + 1 != threshold) {
+      return;
+    }
+    TI_TRACE("Recompiling kernel '{}' optimized", kernel_name);
+    workers->enqueue([=] {
+      try {
+        auto module = llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(*bitcode, kernel_name),
+            *tlctx->get_this_thread_context());
+        TI_ERROR_IF(!module, "Failed to parse the kernel module: {}",
+                    llvm::toString(module.takeError()));
+        auto optimized = convert(LLVMCompiledKernel(tasks, std::move(*module)));
+        std::atomic_store(&tiered->func,
+                          std::make_shared<FunctionType>(std::move(optimized)));
+      } catch (const std::exception &e) {
+        TI_WARN("Kernel '{}' keeps its unoptimized code: {}", kernel_name,
+                e.what());
+      }
+    });
+  };
+}
+
+std::unique_ptr<LLVMCompiledTask> KernelCodeGen::maybe_read_task_from_cache(
+    const std::string &task_key) {
+  TI_AUTO_PROF;
+  const auto &config = *compile_config_;
+  auto *llvm_prog = get_llvm_program(prog);
+  const auto &reader = llvm_prog->get_cache_reader();
+  if (!reader || !reader->has_kernel(task_key)) {
+    return nullptr;
+  }
+
+  LlvmOfflineCache::KernelCacheData cache_data;
+  auto *tlctx = llvm_prog->get_llvm_context(config.arch);
+  auto &llvm_ctx = *tlctx->get_this_thread_context();
+  if (!reader->get_kernel_cache(cache_data, task_key, llvm_ctx,
+                                /*keep_module=*/false)) {
+    return nullptr;
+  }
+  auto &compiled_data = cache_data.compiled_data;
+  auto *module = compiled_data.module.get();
+  auto used_tree_ids = take_int_set_metadata(module, kUsedTreeIdsMetadata);
+  auto struct_for_tls_sizes =
+      take_int_set_metadata(module, kStructForTlsSizesMetadata);
+  if (!used_tree_ids || !struct_for_tls_sizes) {
+    return nullptr;
+  }
+  return std::make_unique<LLVMCompiledTask>(
+      std::move(compiled_data.tasks), std::move(compiled_data.module),
+      std::move(*used_tree_ids), std::move(*struct_for_tls_sizes));
+}
+
+void KernelCodeGen::cache_tasks(const CompiledTasks &data) {
+  auto *llvm_prog = get_llvm_program(prog);
+  for (int i = 0; i < (int)uncached_task_keys_.size(); i++) {
+    const auto &task_key = uncached_task_keys_[i];
+    if (task_key.empty()) {
+      continue;
+    }
+    LLVMCompiledKernel task_data(data[i]->tasks,
+                                 llvm::CloneModule(*data[i]->module));
+    set_int_set_metadata(task_data.module.get(), kUsedTreeIdsMetadata,
+                         data[i]->used_tree_ids);
+    set_int_set_metadata(task_data.module.get(), kStructForTlsSizesMetadata,
+                         data[i]->struct_for_tls_sizes);
+    llvm_prog->cache_kernel(task_key, task_data, /*args=*/{});
+  }
+  uncached_task_keys_.clear();
+}
+
 LLVMCompiledKernel KernelCodeGen::compile_kernel_to_module() {
+  return link_kernel_tasks(compile_kernel_to_tasks());
+}
+
+bool KernelCodeGen::uses_offline_cache() const {
+  return compile_config_->offline_cache && this->supports_offline_cache() &&
+         !kernel->is_evaluator;
+}
+
+std::optional<KernelCodeGen::CompiledTasks>
+KernelCodeGen::compile_kernel_to_tasks(bool check_offline_cache) {
   const auto &config = *compile_config_;
   auto *llvm_prog = get_llvm_program(prog);
   auto *tlctx = llvm_prog->get_llvm_context(config.arch);
-  std::string kernel_key = get_hashed_offline_cache_key(&config, kernel);
-  kernel->set_kernel_key_for_cache(kernel_key);
-  if (config.offline_cache && this->supports_offline_cache() &&
-      !kernel->is_evaluator) {
-    auto res = maybe_read_compilation_from_cache(kernel_key);
-    if (res) {
-      TI_DEBUG("Create kernel '{}' from cache (key='{}')", kernel->get_name(),
-               kernel_key);
-      cache_kernel(kernel_key, *res);
-      return std::move(*res);
+  if (check_offline_cache) {
+    std::string kernel_key = get_hashed_offline_cache_key(&config, kernel);
+    kernel->set_kernel_key_for_cache(kernel_key);
+    const auto &reader = llvm_prog->get_cache_reader();
+    if (uses_offline_cache() && reader && reader->has_kernel(kernel_key)) {
+      // Loaded by link_kernel_tasks().
+      return std::nullopt;
+    }
+    if (uses_offline_cache() && reader) {
+      // Another process may be compiling the same kernel, and cache it in the
+      // meantime.
+      compile_lease_ = llvm_prog->acquire_compile_lease(kernel_key);
+      if (compile_lease_ && reader->has_kernel(kernel_key)) {
+        compile_lease_.reset();
+        return std::nullopt;
+      }
     }
   }
 
@@ -108,33 +392,94 @@ LLVMCompiledKernel KernelCodeGen::compile_kernel_to_module() {
   TI_ASSERT(block);
 
   auto &offloads = block->statements;
-  std::vector<std::unique_ptr<LLVMCompiledTask>> data(offloads.size());
-  using TaskFunc = int32 (*)(void *);
-  std::vector<TaskFunc> task_funcs(offloads.size());
+  CompiledTasks data(offloads.size());
+  // Each task is cloned once, lowered and compiled on its own, and its IR is
+  // freed as soon as its LLVM module is generated, so that the compilation of
+  // a huge kernel doesn't hold the IR of all its tasks at the same time.
+  std::vector<std::unique_ptr<IRNode>> task_irs(offloads.size());
+  uncached_task_keys_.assign(offloads.size(), "");
+  std::unordered_set<std::string> task_keys;
+  std::vector<std::future<void>> compilations;
+  const bool caches_tasks = uses_offline_cache() && config.offline_cache_tasks;
   for (int i = 0; i < offloads.size(); i++) {
+    if (caches_tasks) {
+      // The cache key of a task is computed from its cloned IR.
+      task_irs[i] = irpass::analysis::clone(offloads[i].get());
+      irpass::re_id(task_irs[i].get());
+      auto task_key = get_hashed_offline_cache_key_of_task(
+          &config, prog, task_irs[i]->as<OffloadedStmt>());
+      // Identical tasks of the same kernel would end up with the same
+      // function name, so only the first one of them is cached.
+      if (!task_key.empty() && task_keys.insert(task_key).second) {
+        data[i] = maybe_read_task_from_cache(task_key);
+        if (data[i]) {
+          TI_DEBUG("Load task {} of kernel '{}' from cache (key='{}')", i,
+                   kernel->get_name(), task_key);
+          task_irs[i].reset();
+          continue;
+        }
+        uncached_task_keys_[i] = task_key;
+      }
+    }
     auto compile_func = [&, i] {
-      tlctx->fetch_this_thread_struct_module();
-      auto offload = irpass::analysis::clone(offloads[i].get());
-      irpass::re_id(offload.get());
-      auto new_data =
-          this->compile_task(&config, nullptr, offload->as<OffloadedStmt>());
+      // Otherwise cloned here, so that at most one task per worker is cloned
+      // at a time. The kernel IR is not modified during the compilation.
+      if (!task_irs[i]) {
+        task_irs[i] = irpass::analysis::clone(offloads[i].get());
+        irpass::re_id(task_irs[i].get());
+      }
+      auto new_data = this->compile_task(&config, nullptr,
+                                         task_irs[i]->as<OffloadedStmt>());
+      task_irs[i].reset();
       data[i] = std::make_unique<LLVMCompiledTask>(std::move(new_data));
     };
     if (kernel->is_evaluator) {
       compile_func();
     } else {
-      worker.enqueue(compile_func);
+      compilations.push_back(worker.enqueue(compile_func));
     }
   }
+  // Only wait for the tasks of this kernel, other kernels may be compiling
+  // on the same workers.
+  for (auto &compilation : compilations) {
+    compilation.get();
+  }
+  return data;
+}
+
+LLVMCompiledKernel KernelCodeGen::link_kernel_tasks(
+    std::optional<CompiledTasks> data) {
+  const auto &config = *compile_config_;
+  auto *tlctx = get_llvm_program(prog)->get_llvm_context(config.arch);
+  const std::string kernel_key = kernel->get_cached_kernel_key();
+  if (!data.has_value()) {
+    auto res = maybe_read_compilation_from_cache(kernel_key);
+    if (res) {
+      TI_DEBUG("Create kernel '{}' from cache (key='{}')", kernel->get_name(),
+               kernel_key);
+      cache_kernel(kernel_key, *res);
+      return std::move(*res);
+    }
+    data = compile_kernel_to_tasks(/*check_offline_cache=*/false);
+  }
   if (!kernel->is_evaluator) {
-    worker.flush();
+    cache_tasks(*data);
+  }
+  CompileProfiler::Scope profiled(kernel->get_name(), "link_llvm");
+  auto linked = tlctx->link_compiled_tasks(std::move(*data));
+  profiled.stop();
+  if (profiled.active() && linked.module) {
+    std::string bitcode;
+    llvm::raw_string_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(*linked.module, os);
+    profiled.set_code_size(os.str().size());
   }
-  auto linked = tlctx->link_compiled_tasks(std::move(data));
 
   if (!kernel->is_evaluator) {
     TI_DEBUG("Cache kernel '{}' (key='{}')", kernel->get_name(), kernel_key);
     cache_kernel(kernel_key, linked);
   }
+  compile_lease_.reset();
   return linked;
 }
 
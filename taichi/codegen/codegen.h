@@ -1,9 +1,11 @@
 // Driver class for kernel code generators.
 
 #pragma once
+#include <optional>
 #include <taichi/runtime/llvm/llvm_runtime_executor.h>
 #include "taichi/ir/ir.h"
 #include "taichi/program/program.h"
+#include "taichi/common/cleanup.h"
 #ifdef TI_WITH_LLVM
 #include "llvm/IR/Module.h"
 #include "taichi/codegen/llvm/codegen_llvm.h"
@@ -56,8 +58,28 @@ class KernelCodeGen {
   }
 
 #ifdef TI_WITH_LLVM
+  using CompiledTasks = std::vector<std::unique_ptr<LLVMCompiledTask>>;
+
   virtual LLVMCompiledKernel compile_kernel_to_module();
 
+  // compile_kernel_to_module() is split into two steps, so that different
+  // kernels can go through the first one concurrently:
+  // * compile_kernel_to_tasks() lowers the kernel and compiles its offloaded
+  //   tasks. It returns nullopt if the kernel can be loaded from the offline
+  //   cache instead.
+  // * link_kernel_tasks() links the tasks, or loads the kernel from the
+  //   offline cache. Since all kernels are linked in the same LLVM context,
+  //   it must not run concurrently for different kernels.
+  std::optional<CompiledTasks> compile_kernel_to_tasks(
+      bool check_offline_cache = true);
+  LLVMCompiledKernel link_kernel_tasks(std::optional<CompiledTasks> data);
+
+  // Turns a linked kernel into a function. Like link_kernel_tasks(), it runs
+  // on the thread that requested the compilation.
+  virtual FunctionType convert_to_function(LLVMCompiledKernel data) {
+    TI_NOT_IMPLEMENTED;
+  }
+
   virtual LLVMCompiledTask compile_task(
       const CompileConfig *config,
       std::unique_ptr<llvm::Module> &&module = nullptr,
@@ -67,14 +89,48 @@ class KernelCodeGen {
       const std::string &kernel_key);
   void cache_kernel(const std::string &kernel_key,
                     const LLVMCompiledKernel &data);
+
+  // With offline_cache_native_code, replaces the module of |data| by its
+  // native code, which is added to the offline cache. With
+  // llvm_split_kernel_module, the native code is compiled from the tasks in
+  // parallel. The backends that support native code call it in
+  // convert_to_function().
+  void maybe_compile_to_native_code(LLVMCompiledKernel &data);
+
+  // With tiered_compilation, turns |data| into a function running code
+  // compiled without optimizations, which switches to code compiled optimized
+  // in the background once the kernel has been launched often enough.
+  // |convert| turns a linked kernel into a function on any thread. Returns
+  // nullptr if |data| is not compiled in tiers.
+  FunctionType maybe_make_tiered_function(
+      LLVMCompiledKernel &data,
+      std::function<FunctionType(LLVMCompiledKernel)> convert);
+
+  // Offloaded tasks are also cached on their own, so that editing a kernel
+  // only recompiles the tasks that changed.
+  std::unique_ptr<LLVMCompiledTask> maybe_read_task_from_cache(
+      const std::string &task_key);
+  void cache_tasks(const CompiledTasks &data);
 #endif
  protected:
   const CompileConfig *get_compile_config() const {
     return compile_config_;
   }
 
+#ifdef TI_WITH_LLVM
+  bool uses_offline_cache() const;
+#endif
+
  private:
   const CompileConfig *compile_config_{nullptr};
+#ifdef TI_WITH_LLVM
+  // The keys of the tasks compiled by compile_kernel_to_tasks() that are to be
+  // added to the offline cache. Empty for tasks that are not.
+  std::vector<std::string> uncached_task_keys_;
+  // Held from the cache miss of the kernel until it is cached, see
+  // LlvmProgramImpl::acquire_compile_lease().
+  std::optional<RaiiCleanup> compile_lease_;
+#endif
 };
 
 #ifdef TI_WITH_LLVM
@@ -4,6 +4,7 @@
 #include "taichi/common/core.h"
 #include "taichi/util/io.h"
 #include "taichi/util/lang_util.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/program.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
@@ -41,15 +42,19 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
       auto guard = get_function_creation_guard(
           {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
            llvm::Type::getInt8PtrTy(*llvm_context),
-           tlctx->get_data_type<int>()});
+           get_range_for_index_type(stmt)});
 
-      auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
-      loop_vars_llvm[stmt].push_back(loop_var);
-      builder->CreateStore(get_arg(2), loop_var);
+      create_range_for_loop_var(stmt, get_arg(2));
       stmt->body->accept(this);
 
       body = guard.body;
     }
+    body->addFnAttr(llvm::Attribute::AlwaysInline);
+
+    // The runtime calls the loop over a block rather than the body of each
+    // iteration, so that the body is inlined into a loop that LLVM can
+    // vectorize.
+    llvm::Function *block_body = create_range_for_block_body(stmt, body, step);
 
     llvm::Value *epilogue = create_xlogue(stmt->tls_epilogue);
 
@@ -57,18 +62,73 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
 
     // adaptive block_dim
     if (compile_config->cpu_block_dim_adaptive) {
-      int num_items = (stmt->end_value - stmt->begin_value) / std::abs(step);
-      int num_threads = stmt->num_cpu_threads;
-      int items_per_thread = std::max(1, num_items / (num_threads * 32));
+      int64 num_items = (stmt->end_value - stmt->begin_value) / std::abs(step);
+      int64 num_threads = stmt->num_cpu_threads;
+      int64 items_per_thread =
+          std::max<int64>(1, num_items / (num_threads * 32));
       // keep each task has at least 512 items to amortize scheduler overhead
       // also saturate the value to 1024 for better load balancing
-      stmt->block_dim = std::min(1024, std::max(512, items_per_thread));
+      stmt->block_dim = (int)std::min<int64>(
+          1024, std::max<int64>(512, items_per_thread));
+    }
+
+    if (is_i64_range_for(stmt)) {
+      call("cpu_parallel_range_for_i64", get_arg(0),
+           tlctx->get_constant(stmt->num_cpu_threads), begin, end,
+           tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
+           tls_prologue, block_body, epilogue,
+           tlctx->get_constant(stmt->tls_size));
+      return;
     }
 
     call("cpu_parallel_range_for", get_arg(0),
          tlctx->get_constant(stmt->num_cpu_threads), begin, end,
          tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
-         tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size));
+         tls_prologue, block_body, epilogue,
+         tlctx->get_constant(stmt->tls_size),
+         tlctx->get_constant(compile_config->cpu_tls_per_thread));
+  }
+
+  // Creates a function that calls |body| for the indices [begin, end) of a
+  // block, in the order given by |step|.
+  llvm::Function *create_range_for_block_body(OffloadedStmt *stmt,
+                                              llvm::Function *body,
+                                              int step) {
+    auto index_type = get_range_for_index_type(stmt);
+    auto guard = get_function_creation_guard(
+        {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
+         llvm::Type::getInt8PtrTy(*llvm_context), index_type, index_type},
+        "block_body");
+
+    auto *begin = get_arg(2);
+    auto *end = get_arg(3);
+    auto *loop_test_bb =
+        llvm::BasicBlock::Create(*llvm_context, "loop_test", func);
+    auto *loop_body_bb =
+        llvm::BasicBlock::Create(*llvm_context, "loop_body", func);
+    auto *loop_exit_bb =
+        llvm::BasicBlock::Create(*llvm_context, "loop_exit", func);
+    auto *index = create_entry_block_alloca(index_type);
+    auto *one = llvm::ConstantInt::get(index_type, 1);
+    builder->CreateStore(step == 1 ? begin : builder->CreateSub(end, one),
+                         index);
+    builder->CreateBr(loop_test_bb);
+
+    builder->SetInsertPoint(loop_test_bb);
+    auto *index_value = builder->CreateLoad(index_type, index);
+    auto *cond = step == 1 ? builder->CreateICmpSLT(index_value, end)
+                           : builder->CreateICmpSGE(index_value, begin);
+    builder->CreateCondBr(cond, loop_body_bb, loop_exit_bb);
+
+    builder->SetInsertPoint(loop_body_bb);
+    builder->CreateCall(body, {get_arg(0), get_arg(1), index_value});
+    builder->CreateStore(step == 1 ? builder->CreateAdd(index_value, one)
+                                   : builder->CreateSub(index_value, one),
+                         index);
+    set_loop_vectorize_hints(builder->CreateBr(loop_test_bb));
+
+    builder->SetInsertPoint(loop_exit_bb);
+    return guard.body;
   }
 
   void create_offload_mesh_for(OffloadedStmt *stmt) override {
@@ -141,7 +201,8 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
          tlctx->get_constant(stmt->num_cpu_threads),
          tlctx->get_constant(stmt->mesh->num_patches),
          tlctx->get_constant(stmt->block_dim), tls_prologue, body, epilogue,
-         tlctx->get_constant(stmt->tls_size));
+         tlctx->get_constant(stmt->tls_size),
+         tlctx->get_constant(compile_config->cpu_tls_per_thread));
   }
 
   void create_bls_buffer(OffloadedStmt *stmt) {
@@ -219,20 +280,30 @@ FunctionType CPUModuleToFunctionConverter::convert(
     const std::vector<LlvmLaunchArgInfo> &args,
     LLVMCompiledKernel data) const {
   TI_AUTO_PROF;
-  auto jit_module = tlctx_->create_jit_module(std::move(data.module));
+  auto jit_module =
+      data.module ? tlctx_->create_jit_module(std::move(data.module))
+                  : tlctx_->jit->add_native_module(data.native_code);
   using TaskFunc = int32 (*)(void *);
   std::vector<TaskFunc> task_funcs;
   task_funcs.reserve(data.tasks.size());
+  // The tasks run one after another, so they can share the AD-stack arena.
+  std::size_t ad_stack_spill_bytes = 0;
   for (auto &task : data.tasks) {
     auto *func_ptr = jit_module->lookup_function(task.name);
     TI_ASSERT_INFO(func_ptr, "Offloaded datum function {} not found",
                    task.name);
     task_funcs.push_back((TaskFunc)(func_ptr));
+    ad_stack_spill_bytes =
+        std::max(ad_stack_spill_bytes, task.ad_stack_spill_bytes);
   }
+  ad_stack_spill_bytes *= executor_->get_config()->cpu_max_num_threads;
   // Do NOT capture `this`...
-  return [executor = this->executor_, args, kernel_name,
-          task_funcs](RuntimeContext &context) {
+  return [executor = this->executor_, args, kernel_name, task_funcs,
+          ad_stack_spill_bytes](RuntimeContext &context) {
     TI_TRACE("Launching kernel {}", kernel_name);
+    if (ad_stack_spill_bytes > 0) {
+      executor->ensure_ad_stack_spill_buffer(ad_stack_spill_bytes);
+    }
     // For taichi ndarrays, context.args saves pointer to its
     // |DeviceAllocation|, CPU backend actually want to use the raw ptr here.
     for (int i = 0; i < (int)args.size(); i++) {
@@ -273,12 +344,29 @@ LLVMCompiledTask KernelCodeGenCPU::compile_task(
 
 FunctionType KernelCodeGenCPU::compile_to_function() {
   TI_AUTO_PROF;
+  return convert_to_function(compile_kernel_to_module());
+}
+
+FunctionType KernelCodeGenCPU::convert_to_function(LLVMCompiledKernel data) {
   auto *llvm_prog = get_llvm_program(prog);
   const auto &config = *get_compile_config();
   auto *tlctx = llvm_prog->get_llvm_context(config.arch);
 
   CPUModuleToFunctionConverter converter(
       tlctx, get_llvm_program(prog)->get_runtime_executor());
-  return converter.convert(kernel, compile_kernel_to_module());
+  CompileProfiler::Scope profiled(kernel->get_name(), "jit");
+  maybe_compile_to_native_code(data);
+  if (!data.native_code.empty()) {
+    profiled.set_code_size(data.native_code.size());
+  }
+  auto tiered = maybe_make_tiered_function(
+      data, [converter, name = kernel->name,
+             args = infer_launch_args(kernel)](LLVMCompiledKernel linked) {
+        return converter.convert(name, args, std::move(linked));
+      });
+  if (tiered) {
+    return tiered;
+  }
+  return converter.convert(kernel, std::move(data));
 }
 }  // namespace taichi::lang
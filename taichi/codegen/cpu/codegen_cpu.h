@@ -25,6 +25,7 @@ class KernelCodeGenCPU : public KernelCodeGen {
       std::unique_ptr<llvm::Module> &&module = nullptr,
       OffloadedStmt *stmt = nullptr) override;
 
+  FunctionType convert_to_function(LLVMCompiledKernel data) override;
 #endif  // TI_WITH_LLVM
 
   FunctionType compile_to_function() override;
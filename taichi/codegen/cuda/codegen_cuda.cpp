@@ -1,17 +1,23 @@
 #include "taichi/codegen/cuda/codegen_cuda.h"
 
+#include <cstring>
 #include <vector>
 #include <set>
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <mutex>
 
 #include "taichi/common/core.h"
 #include "taichi/util/io.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/program.h"
 #include "taichi/util/lang_util.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/rhi/cuda/cuda_pinned_memory_pool.h"
 #include "taichi/runtime/program_impls/llvm/llvm_program.h"
 #include "taichi/util/action_recorder.h"
 #include "taichi/analysis/offline_cache_util.h"
@@ -19,6 +25,8 @@
 #include "taichi/ir/transforms.h"
 #include "taichi/codegen/codegen_utils.h"
 
+#include "llvm/IR/InlineAsm.h"
+
 namespace taichi::lang {
 
 using namespace llvm;
@@ -224,7 +232,7 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
   // If the operation cannot be optimized, this function returns nullptr.
   llvm::Value *optimized_reduction(AtomicOpStmt *stmt) override {
     if (!stmt->is_reduction) {
-      return nullptr;
+      return warp_aggregated_atomic(stmt);
     }
     TI_ASSERT(stmt->val->ret_type->is<PrimitiveType>());
     PrimitiveTypeID prim_type =
@@ -258,6 +266,29 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
                 llvm_val[stmt->val]);
   }
 
+  llvm::Value *real_type_atomic(AtomicOpStmt *stmt) override {
+#if defined(TI_WITH_CUDA)
+    // sm_70 adds native atomic adds of halves, which would otherwise be
+    // emulated by CAS loops.
+    if (stmt->op_type == AtomicOpType::add &&
+        stmt->val->ret_type->is_primitive(PrimitiveTypeID::f16) &&
+        CUDAContext::get_instance().get_compute_capability() >= 70) {
+      auto *i16_ty = llvm::Type::getInt16Ty(*llvm_context);
+      auto *asm_ty = llvm::FunctionType::get(
+          i16_ty, {llvm_val[stmt->dest]->getType(), i16_ty}, false);
+      auto *atom_add = llvm::InlineAsm::get(
+          asm_ty, "atom.add.noftz.f16 $0, [$1], $2;", "=h,l,h",
+          /*hasSideEffects=*/true);
+      auto *old_value = builder->CreateCall(
+          atom_add, {llvm_val[stmt->dest],
+                     builder->CreateBitCast(llvm_val[stmt->val], i16_ty)});
+      return builder->CreateBitCast(old_value,
+                                    llvm::Type::getHalfTy(*llvm_context));
+    }
+#endif
+    return TaskCodeGenLLVM::real_type_atomic(stmt);
+  }
+
   void visit(RangeForStmt *for_stmt) override {
     create_naive_range_for(for_stmt);
   }
@@ -269,21 +300,68 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
     {
       auto guard = get_function_creation_guard(
           {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
-           get_tls_buffer_type(), tlctx->get_data_type<int>()});
+           get_tls_buffer_type(), get_range_for_index_type(stmt)});
 
-      auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
-      loop_vars_llvm[stmt].push_back(loop_var);
-      builder->CreateStore(get_arg(2), loop_var);
+      if (stmt->bls_prologue) {
+        range_for_block_corner =
+            builder->CreateSub(get_arg(2), call("thread_idx"));
+      }
+      create_range_for_loop_var(stmt, get_arg(2));
       stmt->body->accept(this);
+      range_for_block_corner = nullptr;
 
       body = guard.body;
     }
 
+    if (stmt->bls_prologue) {
+      body = create_range_for_bls_block_body(stmt, body);
+    }
+
     auto epilogue = create_xlogue(stmt->tls_epilogue);
 
     auto [begin, end] = get_range_for_bounds(stmt);
-    call("gpu_parallel_range_for", get_arg(0), begin, end, tls_prologue, body,
-         epilogue, tlctx->get_constant(stmt->tls_size));
+    if (stmt->bls_prologue) {
+      call("gpu_parallel_range_for_blocks", get_arg(0), begin, end,
+           tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size));
+      return;
+    }
+    call(is_i64_range_for(stmt) ? "gpu_parallel_range_for_i64"
+                                : "gpu_parallel_range_for",
+         get_arg(0), begin, end, tls_prologue, body, epilogue,
+         tlctx->get_constant(stmt->tls_size));
+  }
+
+  // Fills the BLS buffer of the block starting at the index |corner|, then runs
+  // |body| on the indices of the block that are less than |end|.
+  llvm::Function *create_range_for_bls_block_body(OffloadedStmt *stmt,
+                                                  llvm::Function *body) {
+    auto i32_ty = tlctx->get_data_type<int>();
+    auto guard = get_function_creation_guard(
+        {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
+         get_tls_buffer_type(), i32_ty, i32_ty},
+        "block_body");
+    auto corner = get_arg(2);
+    auto end = get_arg(3);
+
+    range_for_block_corner = corner;
+    stmt->bls_prologue->accept(this);
+    range_for_block_corner = nullptr;
+    call("block_barrier");  // "__syncthreads()"
+
+    auto idx = builder->CreateAdd(corner, call("thread_idx"));
+    auto body_bb = llvm::BasicBlock::Create(*llvm_context, "body", func);
+    auto after_body_bb =
+        llvm::BasicBlock::Create(*llvm_context, "after_body", func);
+    builder->CreateCondBr(
+        builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT, idx, end),
+        body_bb, after_body_bb);
+    builder->SetInsertPoint(body_bb);
+    builder->CreateCall(body, {get_arg(0), get_arg(1), idx});
+    builder->CreateBr(after_body_bb);
+    builder->SetInsertPoint(after_body_bb);
+    // The BLS buffer is reused by the next block of the grid-stride loop.
+    call("block_barrier");
+    return guard.body;
   }
 
   void create_offload_mesh_for(OffloadedStmt *stmt) override {
@@ -368,6 +446,7 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       finalize_offloaded_task_function();
       current_task->grid_dim = compile_config->saturating_grid_dim;
       current_task->block_dim = 64;
+      mark_task_fusable(/*serial=*/false);
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
@@ -377,6 +456,7 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       finalize_offloaded_task_function();
       current_task->grid_dim = 1;
       current_task->block_dim = 1;
+      mark_task_fusable(/*serial=*/true);
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
@@ -386,6 +466,7 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       finalize_offloaded_task_function();
       current_task->grid_dim = compile_config->saturating_grid_dim;
       current_task->block_dim = 64;
+      mark_task_fusable(/*serial=*/false);
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
@@ -398,6 +479,7 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       finalize_offloaded_task_function();
       current_task->grid_dim = compile_config->saturating_grid_dim;
       current_task->block_dim = 64;
+      mark_task_fusable(/*serial=*/false);
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
@@ -407,6 +489,7 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       finalize_offloaded_task_function();
       current_task->grid_dim = 1;
       current_task->block_dim = 1;
+      mark_task_fusable(/*serial=*/true);
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
@@ -416,11 +499,46 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       finalize_offloaded_task_function();
       current_task->grid_dim = compile_config->saturating_grid_dim;
       current_task->block_dim = 64;
+      mark_task_fusable(/*serial=*/false);
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
   }
 
+  // See OffloadedTask::fusable.
+  void mark_task_fusable(bool serial) {
+    if (compile_config->gpu_persistent_kernel ||
+        compile_config->gpu_fuse_serial_tasks) {
+      current_task->fusable = true;
+      current_task->serial = serial;
+    }
+  }
+
+  bool is_fusable(OffloadedStmt *stmt) {
+    using Type = OffloadedStmt::TaskType;
+    if (stmt->task_type == Type::listgen) {
+      // element_listgen_nonroot_sorted runs in a single block.
+      return !stmt->sort_elements ||
+             stmt->snode->parent->type == SNodeType::root;
+    }
+    if (stmt->task_type != Type::serial && stmt->task_type != Type::range_for &&
+        stmt->task_type != Type::struct_for) {
+      return false;
+    }
+    // The AD-stack arena is sized by the number of threads of the task.
+    if (stmt->bls_size > 0 || current_task->ad_stack_spill_bytes > 0) {
+      return false;
+    }
+    // Shared arrays and SIMT intrinsics depend on the block size of the task.
+    return irpass::analysis::gather_statements(stmt, [](Stmt *s) {
+             if (auto alloca = s->cast<AllocaStmt>()) {
+               return alloca->is_shared;
+             }
+             return s->is<InternalFuncStmt>();
+           })
+        .empty();
+  }
+
   bool kernel_argument_by_val() const override {
     return true;  // on CUDA, pass the argument by value
   }
@@ -437,8 +555,13 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
 
   void visit(GlobalLoadStmt *stmt) override {
     if (auto get_ch = stmt->src->cast<GetChStmt>()) {
-      bool should_cache_as_read_only = current_offload->mem_access_opt.has_flag(
-          get_ch->output_snode, SNodeAccessFlag::read_only);
+      // The read-only data cache is not coherent with the writes of the
+      // previous tasks of a persistent kernel.
+      bool should_cache_as_read_only =
+          !compile_config->gpu_persistent_kernel &&
+          !compile_config->gpu_fuse_serial_tasks &&
+          current_offload->mem_access_opt.has_flag(get_ch->output_snode,
+                                                   SNodeAccessFlag::read_only);
       create_global_load(stmt, should_cache_as_read_only);
     } else {
       create_global_load(stmt, false);
@@ -486,13 +609,21 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
       current_task->grid_dim = stmt->grid_dim;
       if (stmt->task_type == Type::range_for) {
         if (stmt->const_begin && stmt->const_end) {
-          int num_threads = stmt->end_value - stmt->begin_value;
-          int grid_dim = ((num_threads % stmt->block_dim) == 0)
-                             ? (num_threads / stmt->block_dim)
-                             : (num_threads / stmt->block_dim) + 1;
-          grid_dim = std::max(grid_dim, 1);
-          current_task->grid_dim = std::min(stmt->grid_dim, grid_dim);
+          int64 num_threads = stmt->end_value - stmt->begin_value;
+          int64 grid_dim = ((num_threads % stmt->block_dim) == 0)
+                               ? (num_threads / stmt->block_dim)
+                               : (num_threads / stmt->block_dim) + 1;
+          grid_dim = std::max<int64>(grid_dim, 1);
+          current_task->grid_dim =
+              (int)std::min<int64>(stmt->grid_dim, grid_dim);
+          current_task->num_threads = num_threads;
         }
+        // The range-fors without BLS read the block size at run time. Those
+        // with a block size set by ti.loop_config() are left alone.
+        current_task->block_dim_tunable =
+            compile_config->gpu_autotune_block_dim && !stmt->bls_prologue &&
+            stmt->block_dim == Program::default_block_dim(*compile_config) &&
+            stmt->grid_dim == compile_config->saturating_grid_dim;
       }
       if (stmt->task_type == Type::listgen) {
         int query_max_block_per_sm;
@@ -503,10 +634,18 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
         CUDADriver::get_instance().device_get_attribute(
             &num_SMs, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, nullptr);
         current_task->grid_dim = num_SMs * query_max_block_per_sm;
+        if (stmt->sort_elements &&
+            stmt->snode->parent->type != SNodeType::root) {
+          // element_listgen_nonroot_sorted runs in a single block.
+          current_task->grid_dim = 1;
+        }
       }
       current_task->block_dim = stmt->block_dim;
       TI_ASSERT(current_task->grid_dim != 0);
       TI_ASSERT(current_task->block_dim != 0);
+      if (is_fusable(stmt)) {
+        mark_task_fusable(stmt->task_type == Type::serial);
+      }
       offloaded_tasks.push_back(*current_task);
       current_task = nullptr;
     }
@@ -584,6 +723,300 @@ class TaskCodeGenCUDA : public TaskCodeGenLLVM {
           llvm_val[stmt], llvm::Type::getHalfTy(*llvm_context));
     }
   }
+
+  // The texture argument holds a CUtexObject, or a CUsurfObject for storage
+  // textures, set by the launcher.
+  void visit(TexturePtrStmt *stmt) override {
+    TI_ERROR_IF(stmt->dimensions < 1 || stmt->dimensions > 3,
+                "Unsupported texture dimensions: {}", stmt->dimensions);
+    llvm_val[stmt] = builder->CreatePtrToInt(
+        llvm_val[stmt->arg_load_stmt], llvm::Type::getInt64Ty(*llvm_context));
+  }
+
+  // The result of each TextureOpStmt but kStore is a struct of four f32s,
+  // taken apart by the composite_extract_* internal functions.
+  void visit(TextureOpStmt *stmt) override {
+    auto *ptr = stmt->texture_ptr->as<TexturePtrStmt>();
+    auto *handle = llvm_val[ptr];
+    auto *f32_ty = llvm::Type::getFloatTy(*llvm_context);
+    const int dims = ptr->dimensions;
+    std::vector<llvm::Value *> coords;
+    for (int i = 0; i < dims; i++) {
+      coords.push_back(llvm_val[stmt->args[i]]);
+    }
+
+    TI_ERROR_IF(stmt->op == TextureOpType::kSampleGrad,
+                "Sampling with gradients is not supported on CUDA yet");
+    if (stmt->op == TextureOpType::kSampleLod ||
+        stmt->op == TextureOpType::kFetchTexel) {
+      llvm::Value *lod = llvm_val[stmt->args[dims]];
+      if (stmt->op == TextureOpType::kFetchTexel) {
+        // Linear filtering at the center of a texel returns the texel itself.
+        const llvm::Intrinsic::ID size_intrinsics[] = {
+            llvm::Intrinsic::nvvm_txq_width, llvm::Intrinsic::nvvm_txq_height,
+            llvm::Intrinsic::nvvm_txq_depth};
+        for (int i = 0; i < dims; i++) {
+          auto *size = builder->CreateIntrinsic(size_intrinsics[i], {}, handle);
+          coords[i] = builder->CreateFDiv(
+              builder->CreateFAdd(builder->CreateSIToFP(coords[i], f32_ty),
+                                  llvm::ConstantFP::get(f32_ty, 0.5)),
+              builder->CreateSIToFP(size, f32_ty));
+        }
+        lod = builder->CreateSIToFP(lod, f32_ty);
+      }
+      const llvm::Intrinsic::ID sample_intrinsics[] = {
+          llvm::Intrinsic::nvvm_tex_unified_1d_level_v4f32_f32,
+          llvm::Intrinsic::nvvm_tex_unified_2d_level_v4f32_f32,
+          llvm::Intrinsic::nvvm_tex_unified_3d_level_v4f32_f32};
+      std::vector<llvm::Value *> args{handle};
+      args.insert(args.end(), coords.begin(), coords.end());
+      args.push_back(lod);
+      llvm_val[stmt] =
+          builder->CreateIntrinsic(sample_intrinsics[dims - 1], {}, args);
+      return;
+    }
+
+    TI_ASSERT(ptr->is_storage);
+    const int num_channels = ptr->num_channels;
+    TI_ERROR_IF(num_channels != 1 && num_channels != 2 && num_channels != 4,
+                "Storage textures of {} channels are not supported on CUDA",
+                num_channels);
+    const auto channel_format = ptr->channel_format;
+    const int channel_bits = data_type_bits(channel_format);
+    TI_ERROR_IF(!channel_format->is_primitive(PrimitiveTypeID::u8) &&
+                    !channel_format->is_primitive(PrimitiveTypeID::u16) &&
+                    !channel_format->is_primitive(PrimitiveTypeID::f16) &&
+                    !channel_format->is_primitive(PrimitiveTypeID::f32),
+                "Storage textures of {} channels are not supported on CUDA",
+                data_type_name(channel_format));
+    const bool is_unorm = is_integral(channel_format);
+    const double unorm_max = (double)((1 << channel_bits) - 1);
+    // Surface coordinates along x are in bytes.
+    coords[0] = builder->CreateMul(
+        coords[0],
+        tlctx->get_constant(num_channels * data_type_size(channel_format)));
+
+    // Surface intrinsics, indexed by dimensions, channel bits and channels.
+    const int dim_idx = dims - 1;
+    const int bits_idx = channel_bits == 8 ? 0 : (channel_bits == 16 ? 1 : 2);
+    const int channels_idx = num_channels == 4 ? 2 : num_channels - 1;
+    // 8-bit channels are passed as i16.
+    auto *channel_ty =
+        llvm::Type::getIntNTy(*llvm_context, std::max(channel_bits, 16));
+
+    if (stmt->op == TextureOpType::kLoad) {
+      static const llvm::Intrinsic::ID load_intrinsics[3][3][3] = {
+          {{llvm::Intrinsic::nvvm_suld_1d_i8_trap,
+            llvm::Intrinsic::nvvm_suld_1d_v2i8_trap,
+            llvm::Intrinsic::nvvm_suld_1d_v4i8_trap},
+           {llvm::Intrinsic::nvvm_suld_1d_i16_trap,
+            llvm::Intrinsic::nvvm_suld_1d_v2i16_trap,
+            llvm::Intrinsic::nvvm_suld_1d_v4i16_trap},
+           {llvm::Intrinsic::nvvm_suld_1d_i32_trap,
+            llvm::Intrinsic::nvvm_suld_1d_v2i32_trap,
+            llvm::Intrinsic::nvvm_suld_1d_v4i32_trap}},
+          {{llvm::Intrinsic::nvvm_suld_2d_i8_trap,
+            llvm::Intrinsic::nvvm_suld_2d_v2i8_trap,
+            llvm::Intrinsic::nvvm_suld_2d_v4i8_trap},
+           {llvm::Intrinsic::nvvm_suld_2d_i16_trap,
+            llvm::Intrinsic::nvvm_suld_2d_v2i16_trap,
+            llvm::Intrinsic::nvvm_suld_2d_v4i16_trap},
+           {llvm::Intrinsic::nvvm_suld_2d_i32_trap,
+            llvm::Intrinsic::nvvm_suld_2d_v2i32_trap,
+            llvm::Intrinsic::nvvm_suld_2d_v4i32_trap}},
+          {{llvm::Intrinsic::nvvm_suld_3d_i8_trap,
+            llvm::Intrinsic::nvvm_suld_3d_v2i8_trap,
+            llvm::Intrinsic::nvvm_suld_3d_v4i8_trap},
+           {llvm::Intrinsic::nvvm_suld_3d_i16_trap,
+            llvm::Intrinsic::nvvm_suld_3d_v2i16_trap,
+            llvm::Intrinsic::nvvm_suld_3d_v4i16_trap},
+           {llvm::Intrinsic::nvvm_suld_3d_i32_trap,
+            llvm::Intrinsic::nvvm_suld_3d_v2i32_trap,
+            llvm::Intrinsic::nvvm_suld_3d_v4i32_trap}}};
+      std::vector<llvm::Value *> args{handle};
+      args.insert(args.end(), coords.begin(), coords.end());
+      auto *texel = builder->CreateIntrinsic(
+          load_intrinsics[dim_idx][bits_idx][channels_idx], {}, args);
+
+      // Missing channels read as (0, 0, 0, 1).
+      llvm::Value *ret = llvm::UndefValue::get(llvm::StructType::get(
+          *llvm_context, {f32_ty, f32_ty, f32_ty, f32_ty}));
+      for (int i = 0; i < 4; i++) {
+        llvm::Value *channel = nullptr;
+        if (i >= num_channels) {
+          channel = llvm::ConstantFP::get(f32_ty, i == 3 ? 1.0 : 0.0);
+        } else {
+          auto *bits = num_channels == 1
+                           ? texel
+                           : builder->CreateExtractValue(texel, {(unsigned)i});
+          if (is_unorm) {
+            bits = builder->CreateAnd(
+                bits,
+                llvm::ConstantInt::get(channel_ty, (1 << channel_bits) - 1));
+            channel =
+                builder->CreateFDiv(builder->CreateUIToFP(bits, f32_ty),
+                                    llvm::ConstantFP::get(f32_ty, unorm_max));
+          } else if (channel_bits == 16) {
+            channel = builder->CreateFPExt(
+                builder->CreateBitCast(bits,
+                                       llvm::Type::getHalfTy(*llvm_context)),
+                f32_ty);
+          } else {
+            channel = builder->CreateBitCast(bits, f32_ty);
+          }
+        }
+        ret = builder->CreateInsertValue(ret, channel, {(unsigned)i});
+      }
+      llvm_val[stmt] = ret;
+      return;
+    }
+
+    TI_ASSERT(stmt->op == TextureOpType::kStore);
+    static const llvm::Intrinsic::ID store_intrinsics[3][3][3] = {
+        {{llvm::Intrinsic::nvvm_sust_b_1d_i8_trap,
+          llvm::Intrinsic::nvvm_sust_b_1d_v2i8_trap,
+          llvm::Intrinsic::nvvm_sust_b_1d_v4i8_trap},
+         {llvm::Intrinsic::nvvm_sust_b_1d_i16_trap,
+          llvm::Intrinsic::nvvm_sust_b_1d_v2i16_trap,
+          llvm::Intrinsic::nvvm_sust_b_1d_v4i16_trap},
+         {llvm::Intrinsic::nvvm_sust_b_1d_i32_trap,
+          llvm::Intrinsic::nvvm_sust_b_1d_v2i32_trap,
+          llvm::Intrinsic::nvvm_sust_b_1d_v4i32_trap}},
+        {{llvm::Intrinsic::nvvm_sust_b_2d_i8_trap,
+          llvm::Intrinsic::nvvm_sust_b_2d_v2i8_trap,
+          llvm::Intrinsic::nvvm_sust_b_2d_v4i8_trap},
+         {llvm::Intrinsic::nvvm_sust_b_2d_i16_trap,
+          llvm::Intrinsic::nvvm_sust_b_2d_v2i16_trap,
+          llvm::Intrinsic::nvvm_sust_b_2d_v4i16_trap},
+         {llvm::Intrinsic::nvvm_sust_b_2d_i32_trap,
+          llvm::Intrinsic::nvvm_sust_b_2d_v2i32_trap,
+          llvm::Intrinsic::nvvm_sust_b_2d_v4i32_trap}},
+        {{llvm::Intrinsic::nvvm_sust_b_3d_i8_trap,
+          llvm::Intrinsic::nvvm_sust_b_3d_v2i8_trap,
+          llvm::Intrinsic::nvvm_sust_b_3d_v4i8_trap},
+         {llvm::Intrinsic::nvvm_sust_b_3d_i16_trap,
+          llvm::Intrinsic::nvvm_sust_b_3d_v2i16_trap,
+          llvm::Intrinsic::nvvm_sust_b_3d_v4i16_trap},
+         {llvm::Intrinsic::nvvm_sust_b_3d_i32_trap,
+          llvm::Intrinsic::nvvm_sust_b_3d_v2i32_trap,
+          llvm::Intrinsic::nvvm_sust_b_3d_v4i32_trap}}};
+    std::vector<llvm::Value *> args{handle};
+    args.insert(args.end(), coords.begin(), coords.end());
+    for (int i = 0; i < num_channels; i++) {
+      llvm::Value *channel = llvm_val[stmt->args[dims + i]];
+      if (is_unorm) {
+        // Round to the nearest unorm value.
+        channel = builder->CreateMaxNum(
+            builder->CreateMinNum(channel, llvm::ConstantFP::get(f32_ty, 1.0)),
+            llvm::ConstantFP::get(f32_ty, 0.0));
+        channel = builder->CreateFAdd(
+            builder->CreateFMul(channel,
+                                llvm::ConstantFP::get(f32_ty, unorm_max)),
+            llvm::ConstantFP::get(f32_ty, 0.5));
+        channel = builder->CreateFPToUI(channel, channel_ty);
+      } else if (channel_bits == 16) {
+        channel = builder->CreateBitCast(
+            builder->CreateFPTrunc(channel,
+                                   llvm::Type::getHalfTy(*llvm_context)),
+            channel_ty);
+      } else {
+        channel = builder->CreateBitCast(channel, channel_ty);
+      }
+      args.push_back(channel);
+    }
+    builder->CreateIntrinsic(store_intrinsics[dim_idx][bits_idx][channels_idx],
+                             {}, args);
+  }
+
+ private:
+  // Emits the atomics whose address may be shared by several lanes of a warp
+  // as warp-aggregated ones, see CompileConfig::gpu_warp_aggregated_atomics.
+  // Returns nullptr for the other atomics.
+  llvm::Value *warp_aggregated_atomic(AtomicOpStmt *stmt) {
+    if (!compile_config->gpu_warp_aggregated_atomics ||
+        current_offload == nullptr ||
+        current_offload->task_type == OffloadedTaskType::serial ||
+        stmt->dest->ret_type->as<PointerType>()->is_bit_pointer()) {
+      return nullptr;
+    }
+    const auto prim_type = stmt->val->ret_type->cast<PrimitiveType>();
+    if (!prim_type || (prim_type->type != PrimitiveTypeID::i32 &&
+                       prim_type->type != PrimitiveTypeID::f32)) {
+      return nullptr;
+    }
+    const std::unordered_map<AtomicOpType, std::string> ops{
+        {AtomicOpType::add, "add"},     {AtomicOpType::min, "min"},
+        {AtomicOpType::max, "max"},     {AtomicOpType::bit_and, "and"},
+        {AtomicOpType::bit_or, "or"},   {AtomicOpType::bit_xor, "xor"}};
+    auto op = ops.find(stmt->op_type);
+    if (op == ops.end()) {
+      return nullptr;
+    }
+    // The lanes other than the leader do not get the old value.
+    if (get_used_stmts().count(stmt) || !may_conflict(stmt->dest)) {
+      return nullptr;
+    }
+    call(fmt::format("warp_aggregated_atomic_{}_{}", op->second,
+                     data_type_name(stmt->val->ret_type)),
+         llvm_val[stmt->dest], llvm_val[stmt->val]);
+    return llvm::UndefValue::get(tlctx->get_data_type(stmt->val->ret_type));
+  }
+
+  // Whether the lanes of a warp may access |ptr| at the same address, i.e.
+  // its address does not derive from the index of the offloaded loop alone.
+  bool may_conflict(Stmt *ptr) {
+    bool uses_loop_index = false;
+    std::unordered_set<Stmt *> visited;
+    std::vector<Stmt *> stack{ptr};
+    while (!stack.empty()) {
+      auto *s = stack.back();
+      stack.pop_back();
+      if (s == nullptr || !visited.insert(s).second) {
+        continue;
+      }
+      if (s->is<ThreadLocalPtrStmt>()) {
+        return false;
+      }
+      if (auto *index = s->cast<LoopIndexStmt>()) {
+        if (index->loop != current_offload) {
+          // Indices of inner loops are shared by the threads.
+          return true;
+        }
+        uses_loop_index = true;
+        continue;
+      }
+      if (s->is<LoopLinearIndexStmt>() || s->is<LoopUniqueStmt>()) {
+        uses_loop_index = true;
+        continue;
+      }
+      if (s->cast<ir_traits::Load>() || s->is<RandStmt>()) {
+        // Data-dependent addresses, e.g. the grid nodes of a particle.
+        return true;
+      }
+      for (auto *operand : s->get_operands()) {
+        stack.push_back(operand);
+      }
+    }
+    return !uses_loop_index;
+  }
+
+  // The statements of the current offloaded task used by other statements.
+  const std::unordered_set<Stmt *> &get_used_stmts() {
+    if (used_stmts_offload_ != current_offload) {
+      used_stmts_offload_ = current_offload;
+      used_stmts_.clear();
+      irpass::analysis::gather_statements(current_offload, [&](Stmt *s) {
+        for (auto *operand : s->get_operands()) {
+          used_stmts_.insert(operand);
+        }
+        return false;
+      });
+    }
+    return used_stmts_;
+  }
+
+  OffloadedStmt *used_stmts_offload_{nullptr};
+  std::unordered_set<Stmt *> used_stmts_;
 };
 
 LLVMCompiledTask KernelCodeGenCUDA::compile_task(
@@ -596,16 +1029,495 @@ LLVMCompiledTask KernelCodeGenCUDA::compile_task(
 
 FunctionType KernelCodeGenCUDA::compile_to_function() {
   TI_AUTO_PROF
+  return convert_to_function(compile_kernel_to_module());
+}
+
+#ifdef TI_WITH_CUDA
+namespace {
+
+// Drops the nvvm.annotations of |func|, which makes it a device function.
+void unmark_cuda_kernel(llvm::Module *module, llvm::Function *func) {
+  auto *annotations = module->getNamedMetadata("nvvm.annotations");
+  if (!annotations) {
+    return;
+  }
+  std::vector<llvm::MDNode *> kept;
+  for (auto *node : annotations->operands()) {
+    if (node->getNumOperands() == 0 ||
+        llvm::mdconst::dyn_extract_or_null<llvm::Function>(
+            node->getOperand(0)) != func) {
+      kept.push_back(node);
+    }
+  }
+  annotations->clearOperands();
+  for (auto *node : kept) {
+    annotations->addOperand(node);
+  }
+}
+
+// Waits for all the blocks of a cooperative launch. Every barrier adds 2^31
+// to |arrived| in total, so that the leader of each block waits until the
+// highest bit flips, and the counter never has to be reset.
+void create_grid_barrier(llvm::IRBuilder<> &builder,
+                         llvm::Function *func,
+                         llvm::GlobalVariable *arrived) {
+  auto &ctx = builder.getContext();
+  auto *i32_ty = builder.getInt32Ty();
+  auto *arrive_bb = llvm::BasicBlock::Create(ctx, "arrive", func);
+  auto *wait_bb = llvm::BasicBlock::Create(ctx, "wait", func);
+  auto *waited_bb = llvm::BasicBlock::Create(ctx, "waited", func);
+  auto *after_bb = llvm::BasicBlock::Create(ctx, "after_grid_barrier", func);
+
+  builder.CreateIntrinsic(Intrinsic::nvvm_barrier0, {}, {});
+  auto *thread_idx =
+      builder.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_tid_x, {}, {});
+  builder.CreateCondBr(builder.CreateICmpEQ(thread_idx, builder.getInt32(0)),
+                       arrive_bb, after_bb);
+
+  builder.SetInsertPoint(arrive_bb);
+  builder.CreateIntrinsic(Intrinsic::nvvm_membar_gl, {}, {});
+  auto *block_idx =
+      builder.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_ctaid_x, {}, {});
+  auto *grid_dim =
+      builder.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_nctaid_x, {}, {});
+  const auto kFlip = builder.getInt32(0x80000000u);
+  auto *increment = builder.CreateSelect(
+      builder.CreateICmpEQ(block_idx, builder.getInt32(0)),
+      builder.CreateSub(kFlip,
+                        builder.CreateSub(grid_dim, builder.getInt32(1))),
+      builder.getInt32(1));
+  auto *old = builder.CreateAtomicRMW(
+      llvm::AtomicRMWInst::BinOp::Add, arrived, increment, llvm::MaybeAlign(4),
+      llvm::AtomicOrdering::SequentiallyConsistent);
+  builder.CreateBr(wait_bb);
+
+  builder.SetInsertPoint(wait_bb);
+  auto *current = builder.CreateLoad(i32_ty, arrived, /*isVolatile=*/true);
+  auto *flipped = builder.CreateICmpNE(
+      builder.CreateAnd(builder.CreateXor(old, current), kFlip),
+      builder.getInt32(0));
+  builder.CreateCondBr(flipped, waited_bb, wait_bb);
+
+  builder.SetInsertPoint(waited_bb);
+  builder.CreateIntrinsic(Intrinsic::nvvm_membar_gl, {}, {});
+  builder.CreateBr(after_bb);
+
+  builder.SetInsertPoint(after_bb);
+  builder.CreateIntrinsic(Intrinsic::nvvm_barrier0, {}, {});
+}
+
+// Creates the persistent kernel |name| that runs |tasks| one after another,
+// with grid-wide barriers in between. The tasks become device functions.
+OffloadedTask create_persistent_kernel(TaichiLLVMContext *tlctx,
+                                       llvm::Module *module,
+                                       const std::string &name,
+                                       const std::vector<OffloadedTask> &tasks,
+                                       int max_block_dim) {
+  OffloadedTask persistent(name, 1, 0);
+  persistent.cooperative = true;
+  for (const auto &task : tasks) {
+    if (!task.serial) {
+      persistent.block_dim = std::max(persistent.block_dim, task.block_dim);
+    }
+    for (auto [arg_id, access] : task.arr_access) {
+      persistent.arr_access[arg_id] |= access;
+    }
+  }
+  persistent.block_dim = std::min(persistent.block_dim, max_block_dim);
+
+  auto &ctx = module->getContext();
+  auto *first = module->getFunction(tasks.front().name);
+  TI_ASSERT(first != nullptr);
+  auto *func = llvm::Function::Create(first->getFunctionType(),
+                                      llvm::Function::ExternalLinkage, name,
+                                      module);
+  func->copyAttributesFrom(first);
+  auto *arrived = new llvm::GlobalVariable(
+      *module, llvm::Type::getInt32Ty(ctx), false,
+      llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantInt::get(llvm::Type::getInt32Ty(ctx), 0),
+      name + "_arrived", nullptr, llvm::GlobalVariable::NotThreadLocal,
+      1 /*addrspace=global*/);
+  arrived->setAlignment(llvm::MaybeAlign(4));
+
+  llvm::IRBuilder<> builder(ctx);
+  builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", func));
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    auto *task_func = module->getFunction(tasks[i].name);
+    TI_ASSERT(task_func != nullptr);
+    unmark_cuda_kernel(module, task_func);
+    task_func->setLinkage(llvm::GlobalValue::InternalLinkage);
+    // The device functions share the copy of the context of the kernel.
+    task_func->removeParamAttr(0, llvm::Attribute::ByVal);
+    if (i > 0) {
+      create_grid_barrier(builder, func, arrived);
+    }
+    if (!tasks[i].serial) {
+      builder.CreateCall(task_func, {func->getArg(0)});
+      continue;
+    }
+    auto *run_bb = llvm::BasicBlock::Create(ctx, "run_serial", func);
+    auto *after_bb = llvm::BasicBlock::Create(ctx, "after_serial", func);
+    auto *thread_idx =
+        builder.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_tid_x, {}, {});
+    auto *block_idx =
+        builder.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_ctaid_x, {}, {});
+    builder.CreateCondBr(
+        builder.CreateICmpEQ(builder.CreateOr(thread_idx, block_idx),
+                             builder.getInt32(0)),
+        run_bb, after_bb);
+    builder.SetInsertPoint(run_bb);
+    builder.CreateCall(task_func, {func->getArg(0)});
+    builder.CreateBr(after_bb);
+    builder.SetInsertPoint(after_bb);
+  }
+  builder.CreateRetVoid();
+  tlctx->mark_function_as_cuda_kernel(func, persistent.block_dim);
+  return persistent;
+}
+
+// Fuses each run of consecutive fusable tasks of |data| into a persistent
+// kernel, so that a kernel made of many small tasks takes fewer launches.
+// With only CompileConfig::gpu_fuse_serial_tasks, the runs are the serial
+// tasks before a parallel one.
+void fuse_persistent_tasks(TaichiLLVMContext *tlctx,
+                           LLVMCompiledKernel &data,
+                           const CompileConfig &config) {
+  int cooperative_launch = 0;
+  CUDADriver::get_instance().device_get_attribute(
+      &cooperative_launch, CU_DEVICE_ATTRIBUTE_COOPERATIVE_LAUNCH, nullptr);
+  if (!cooperative_launch) {
+    TI_WARN("The device does not support cooperative launches, "
+            "gpu_persistent_kernel and gpu_fuse_serial_tasks are ignored");
+    return;
+  }
+  std::vector<OffloadedTask> tasks;
+  std::size_t begin = 0;
+  while (begin < data.tasks.size()) {
+    auto end = begin;
+    if (config.gpu_persistent_kernel) {
+      while (end < data.tasks.size() && data.tasks[end].fusable) {
+        end++;
+      }
+    } else {
+      while (end < data.tasks.size() && data.tasks[end].fusable &&
+             data.tasks[end].serial) {
+        end++;
+      }
+      if (end > begin && end < data.tasks.size() && data.tasks[end].fusable) {
+        end++;
+      } else {
+        // Nothing to run the serial tasks in.
+        end = begin;
+      }
+    }
+    if (end - begin < 2) {
+      end = std::max(end, begin + 1);
+      tasks.insert(tasks.end(), data.tasks.begin() + begin,
+                   data.tasks.begin() + end);
+      begin = end;
+      continue;
+    }
+    std::vector<OffloadedTask> fused(data.tasks.begin() + begin,
+                                     data.tasks.begin() + end);
+    const auto name = fused.front().name + "_persistent";
+    TI_TRACE("Fusing {} tasks into {}", fused.size(), name);
+    tasks.push_back(create_persistent_kernel(tlctx, data.module.get(), name,
+                                             fused, config.max_block_dim));
+    begin = end;
+  }
+  data.tasks = std::move(tasks);
+}
+
+}  // namespace
+#endif  // TI_WITH_CUDA
+
+FunctionType KernelCodeGenCUDA::convert_to_function(LLVMCompiledKernel data) {
   auto *llvm_prog = get_llvm_program(prog);
   const auto &config = *get_compile_config();
   auto *tlctx = llvm_prog->get_llvm_context(config.arch);
 
   CUDAModuleToFunctionConverter converter{tlctx,
                                           llvm_prog->get_runtime_executor()};
+  const auto &kernel_key = kernel->get_cached_kernel_key();
+  if (config.gpu_autotune_block_dim && uses_offline_cache() &&
+      !kernel_key.empty()) {
+    converter.on_block_dim_tuned =
+        [llvm_prog, kernel_key](const std::vector<OffloadedTask> &tasks) {
+          llvm_prog->cache_block_dims(kernel_key, tasks);
+        };
+  }
 
-  return converter.convert(this->kernel, compile_kernel_to_module());
+#ifdef TI_WITH_CUDA
+  if ((config.gpu_persistent_kernel || config.gpu_fuse_serial_tasks) &&
+      data.module) {
+    fuse_persistent_tasks(tlctx, data, config);
+  }
+#endif
+  CompileProfiler::Scope profiled(kernel->get_name(), "jit");
+  maybe_compile_to_native_code(data);
+  if (!data.native_code.empty()) {
+    profiled.set_code_size(data.native_code.size());
+  }
+  auto tiered = maybe_make_tiered_function(
+      data, [converter, name = kernel->name,
+             args = infer_launch_args(kernel)](LLVMCompiledKernel linked) {
+        return converter.convert(name, args, std::move(linked));
+      });
+  if (tiered) {
+    return tiered;
+  }
+  return converter.convert(this->kernel, std::move(data));
 }
 
+#ifdef TI_WITH_CUDA
+namespace {
+
+// Times the candidate block sizes of the tunable tasks of a kernel, one
+// candidate per launch after a warm-up launch, and keeps the fastest ones.
+class BlockDimTuner {
+ public:
+  using LaunchFunc = std::function<void(const OffloadedTask &)>;
+  using TunedCallback = std::function<void(const std::vector<OffloadedTask> &)>;
+
+  BlockDimTuner(const std::vector<OffloadedTask> &tasks,
+                const CompileConfig &config,
+                TunedCallback on_tuned)
+      : tasks_(tasks),
+        saturating_grid_dim_(config.saturating_grid_dim),
+        on_tuned_(std::move(on_tuned)) {
+    for (int block_dim = 32; block_dim <= std::min(config.max_block_dim, 1024);
+         block_dim *= 2) {
+      candidates_.push_back(block_dim);
+    }
+    elapsed_ms_.assign(tasks_.size(), std::vector<float>(candidates_.size()));
+    done_ = candidates_.empty();
+  }
+
+  static bool needs_tuning(const std::vector<OffloadedTask> &tasks) {
+    return std::any_of(tasks.begin(), tasks.end(), [](const auto &task) {
+      return task.block_dim_tunable && !task.block_dim_tuned;
+    });
+  }
+
+  bool done() const {
+    return done_.load(std::memory_order_acquire);
+  }
+
+  // Only valid once done() returns true.
+  const std::vector<OffloadedTask> &tasks() const {
+    return tasks_;
+  }
+
+  // Launches the tasks with the next candidate. Returns false if nothing has
+  // been launched.
+  bool launch(void *stream, const LaunchFunc &launch_task) {
+    std::lock_guard<std::mutex> _(mut_);
+    // Timing is not possible while the launches are recorded.
+    if (done() || CUDAContext::get_instance().is_recording()) {
+      return false;
+    }
+    if (!warmed_up_) {
+      warmed_up_ = true;
+      return false;
+    }
+    const int candidate = next_candidate_;
+    std::vector<std::pair<void *, void *>> events(tasks_.size(),
+                                                  {nullptr, nullptr});
+    for (std::size_t i = 0; i < tasks_.size(); i++) {
+      if (!tasks_[i].block_dim_tunable) {
+        launch_task(tasks_[i]);
+        continue;
+      }
+      auto &[start, stop] = events[i];
+      CUDADriver::get_instance().event_create(&start, CU_EVENT_DEFAULT);
+      CUDADriver::get_instance().event_create(&stop, CU_EVENT_DEFAULT);
+      CUDADriver::get_instance().event_record(start, stream);
+      launch_task(with_block_dim(tasks_[i], candidates_[candidate]));
+      CUDADriver::get_instance().event_record(stop, stream);
+    }
+    for (std::size_t i = 0; i < tasks_.size(); i++) {
+      auto [start, stop] = events[i];
+      if (start == nullptr) {
+        continue;
+      }
+      CUDADriver::get_instance().event_synchronize(stop);
+      CUDADriver::get_instance().event_elapsed_time(
+          &elapsed_ms_[i][candidate], start, stop);
+      CUDADriver::get_instance().event_destroy(start);
+      CUDADriver::get_instance().event_destroy(stop);
+    }
+    if (++next_candidate_ == (int)candidates_.size()) {
+      finish();
+    }
+    return true;
+  }
+
+ private:
+  OffloadedTask with_block_dim(OffloadedTask task, int block_dim) const {
+    task.block_dim = block_dim;
+    task.grid_dim = saturating_grid_dim_;
+    if (task.num_threads > 0) {
+      task.grid_dim = (int)std::clamp<int64>(
+          (task.num_threads + block_dim - 1) / block_dim, 1,
+          saturating_grid_dim_);
+    }
+    return task;
+  }
+
+  void finish() {
+    for (std::size_t i = 0; i < tasks_.size(); i++) {
+      if (!tasks_[i].block_dim_tunable) {
+        continue;
+      }
+      const auto &elapsed = elapsed_ms_[i];
+      const int best =
+          std::min_element(elapsed.begin(), elapsed.end()) - elapsed.begin();
+      tasks_[i] = with_block_dim(tasks_[i], candidates_[best]);
+      tasks_[i].block_dim_tuned = true;
+      TI_TRACE("Tuned {}<<<{}, {}>>> ({} ms)", tasks_[i].name,
+               tasks_[i].grid_dim, tasks_[i].block_dim, elapsed[best]);
+    }
+    done_.store(true, std::memory_order_release);
+    if (on_tuned_) {
+      on_tuned_(tasks_);
+    }
+  }
+
+  std::vector<OffloadedTask> tasks_;
+  int saturating_grid_dim_;
+  TunedCallback on_tuned_;
+  std::vector<int> candidates_;
+  // The time taken by each task with each candidate.
+  std::vector<std::vector<float>> elapsed_ms_;
+  std::mutex mut_;
+  bool warmed_up_{false};
+  int next_candidate_{0};
+  std::atomic<bool> done_{false};
+};
+
+// The fewest registers per thread a task is capped to.
+constexpr int kMinTaskMaxReg = 32;
+
+struct TaskRegisterUsage {
+  int regs{0};
+  // Bytes of local memory per thread, mostly register spills.
+  int local_bytes{0};
+  int active_blocks{0};
+};
+
+TaskRegisterUsage get_register_usage(JITModule *module,
+                                     const OffloadedTask &task) {
+  TaskRegisterUsage usage;
+  void *func = module->lookup_function(task.name);
+  CUDADriver::get_instance().kernel_get_attribute(
+      &usage.regs, CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS, func);
+  CUDADriver::get_instance().kernel_get_attribute(
+      &usage.local_bytes,
+      CUfunction_attribute::CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, func);
+  CUDADriver::get_instance().kernel_get_occupancy(&usage.active_blocks, func,
+                                                  task.block_dim, 0);
+  return usage;
+}
+
+// Compiles |module|, then caps the registers of the tasks whose occupancy is
+// limited by their registers, so that one more block fits on each
+// multiprocessor. The caps that make a task spill more are dropped.
+JITModule *add_module_with_task_max_reg(TaichiLLVMContext *tlctx,
+                                        std::unique_ptr<llvm::Module> module,
+                                        const std::vector<OffloadedTask> &tasks,
+                                        int max_reg) {
+  auto *jit = tlctx->jit.get();
+  auto source = llvm::CloneModule(*module);
+  auto *jit_module = jit->add_module(std::move(module), max_reg);
+
+  int regs_per_sm = 0;
+  int threads_per_sm = 0;
+  CUDADriver::get_instance().device_get_attribute(
+      &regs_per_sm, CU_DEVICE_ATTRIBUTE_MAX_REGISTERS_PER_MULTIPROCESSOR,
+      nullptr);
+  CUDADriver::get_instance().device_get_attribute(
+      &threads_per_sm, CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR,
+      nullptr);
+
+  std::vector<TaskRegisterUsage> usage(tasks.size());
+  std::vector<int> task_max_reg(tasks.size(), 0);
+  bool capped = false;
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    const auto &task = tasks[i];
+    usage[i] = get_register_usage(jit_module, task);
+    const int active_threads = usage[i].active_blocks * task.block_dim;
+    if (task.block_dim == 0 || active_threads >= threads_per_sm) {
+      continue;
+    }
+    // Registers are allocated in units of 8 per thread.
+    const int cap =
+        regs_per_sm / ((usage[i].active_blocks + 1) * task.block_dim) / 8 * 8;
+    if (cap >= kMinTaskMaxReg && cap < usage[i].regs) {
+      task_max_reg[i] = cap;
+      capped = true;
+    }
+  }
+
+  // One more try is given without the caps that make tasks spill.
+  for (int attempt = 0; capped && attempt < 2; attempt++) {
+    auto capped_module = llvm::CloneModule(*source);
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+      if (task_max_reg[i] != 0) {
+        auto *func = capped_module->getFunction(tasks[i].name);
+        TI_ASSERT(func);
+        tlctx->set_cuda_kernel_max_reg(func, task_max_reg[i]);
+      }
+    }
+    auto *capped_jit_module =
+        jit->add_module(std::move(capped_module), max_reg);
+    bool spilled = false;
+    capped = false;
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+      if (task_max_reg[i] == 0) {
+        continue;
+      }
+      const auto capped_usage =
+          get_register_usage(capped_jit_module, tasks[i]);
+      if (capped_usage.local_bytes > usage[i].local_bytes) {
+        task_max_reg[i] = 0;
+        spilled = true;
+        continue;
+      }
+      capped = true;
+      TI_TRACE("Capped {} to {} registers: {} -> {} active blocks",
+               tasks[i].name, task_max_reg[i], usage[i].active_blocks,
+               capped_usage.active_blocks);
+    }
+    if (!spilled) {
+      return capped_jit_module;
+    }
+  }
+  return jit_module;
+}
+
+// The number of blocks of the persistent kernel |task| that can be resident
+// at once, which is as many as a cooperative launch takes.
+int get_resident_grid_dim(JITModule *module,
+                          const OffloadedTask &task,
+                          const CompileConfig &config) {
+  int blocks_per_sm = 0;
+  CUDADriver::get_instance().kernel_get_occupancy(
+      &blocks_per_sm, module->lookup_function(task.name), task.block_dim, 0);
+  int num_SMs = 0;
+  CUDADriver::get_instance().device_get_attribute(
+      &num_SMs, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, nullptr);
+  TI_ERROR_IF(blocks_per_sm == 0,
+              "The persistent kernel {} does not fit on a multiprocessor with "
+              "{} threads per block",
+              task.name, task.block_dim);
+  // The random number generator has no more states than this.
+  return std::min(blocks_per_sm * num_SMs, config.saturating_grid_dim);
+}
+
+}  // namespace
+#endif  // TI_WITH_CUDA
+
 FunctionType CUDAModuleToFunctionConverter::convert(
     const std::string &kernel_name,
     const std::vector<LlvmLaunchArgInfo> &args,
@@ -614,19 +1526,58 @@ FunctionType CUDAModuleToFunctionConverter::convert(
   auto &tasks = data.tasks;
 #ifdef TI_WITH_CUDA
   auto jit = tlctx_->jit.get();
-  auto cuda_module =
-      jit->add_module(std::move(mod), executor_->get_config()->gpu_max_reg);
+  const auto &config = *executor_->get_config();
+  JITModule *cuda_module = nullptr;
+  if (!mod) {
+    cuda_module = jit->add_native_module(data.native_code);
+  } else if (config.gpu_tune_max_reg) {
+    cuda_module = add_module_with_task_max_reg(tlctx_, std::move(mod), tasks,
+                                               config.gpu_max_reg);
+  } else {
+    cuda_module = jit->add_module(std::move(mod), config.gpu_max_reg);
+  }
 
-  return [cuda_module, kernel_name, args, offloaded_tasks = tasks,
+  for (auto &task : tasks) {
+    if (task.cooperative) {
+      task.grid_dim = get_resident_grid_dim(cuda_module, task, config);
+    }
+  }
+
+  std::shared_ptr<BlockDimTuner> tuner;
+  if (config.gpu_autotune_block_dim && BlockDimTuner::needs_tuning(tasks)) {
+    tuner = std::make_shared<BlockDimTuner>(tasks, config, on_block_dim_tuned);
+  }
+
+  return [cuda_module, kernel_name, args, offloaded_tasks = tasks, tuner,
           executor = this->executor_](RuntimeContext &context) {
     CUDAContext::get_instance().make_current();
+    // All transfers and launches of this kernel are issued on the stream the
+    // calling thread is bound to, so that independent kernels on different
+    // streams can overlap.
+    void *stream = CUDAContext::get_instance().get_stream();
     std::vector<void *> arg_buffers(args.size(), nullptr);
     std::vector<void *> device_buffers(args.size(), nullptr);
     std::vector<DeviceAllocation> temporary_devallocs(args.size());
+    // The allocations of the ndarray arguments.
+    std::vector<DeviceAllocation *> ndarray_allocs(args.size(), nullptr);
+    // Host arrays are staged through page-locked buffers so that the
+    // transfers are real asynchronous DMA copies.
+    std::vector<void *> pinned_buffers(args.size(), nullptr);
+    auto *pinned_pool = executor->pinned_staging_pool();
 
     bool transferred = false;
     for (int i = 0; i < (int)args.size(); i++) {
       if (args[i].is_array) {
+        const auto dev_alloc_type = context.device_allocation_type[i];
+        if (dev_alloc_type == RuntimeContext::DevAllocType::kTexture ||
+            dev_alloc_type == RuntimeContext::DevAllocType::kRWTexture) {
+          // Kernels access textures through texture or surface objects.
+          const bool is_rw =
+              dev_alloc_type == RuntimeContext::DevAllocType::kRWTexture;
+          auto *texture = context.get_arg<DeviceAllocation *>(i);
+          context.set_arg(i, executor->get_texture_handle(*texture, is_rw));
+          continue;
+        }
         const auto arr_sz = context.array_runtime_sizes[i];
         if (arr_sz == 0) {
           continue;
@@ -637,20 +1588,13 @@ FunctionType CUDAModuleToFunctionConverter::convert(
           // Note: both numpy and PyTorch support arrays/tensors with zeros
           // in shapes, e.g., shape=(0) or shape=(100, 0, 200). This makes
           // `arr_sz` zero.
-          unsigned int attr_val = 0;
-          uint32_t ret_code = CUDADriver::get_instance().mem_get_attribute.call(
-              &attr_val, CU_POINTER_ATTRIBUTE_MEMORY_TYPE,
-              (void *)arg_buffers[i]);
-
-          if (ret_code != CUDA_SUCCESS || attr_val != CU_MEMORYTYPE_DEVICE) {
+          if (!CUDAContext::get_instance().is_device_pointer(
+                  arg_buffers[i])) {
             // Copy to device buffer if arg is on host
-            // - ret_code != CUDA_SUCCESS:
-            //   arg_buffers[i] is not on device
-            // - attr_val != CU_MEMORYTYPE_DEVICE:
-            //   Cuda driver is aware of arg_buffers[i] but it might be on
-            //   host.
-            // See CUDA driver API `cuPointerGetAttribute` for more details.
             transferred = true;
+            // The copies have to be ordered with the launches recorded so
+            // far.
+            CUDAContext::get_instance().interrupt_recording();
 
             auto result_buffer = context.result_buffer;
             DeviceAllocation devalloc =
@@ -658,8 +1602,14 @@ FunctionType CUDAModuleToFunctionConverter::convert(
             device_buffers[i] = executor->get_ndarray_alloc_info_ptr(devalloc);
             temporary_devallocs[i] = devalloc;
 
-            CUDADriver::get_instance().memcpy_host_to_device(
-                (void *)device_buffers[i], arg_buffers[i], arr_sz);
+            pinned_buffers[i] = pinned_pool->acquire(arr_sz);
+            void *src = arg_buffers[i];
+            if (pinned_buffers[i] != nullptr) {
+              std::memcpy(pinned_buffers[i], arg_buffers[i], arr_sz);
+              src = pinned_buffers[i];
+            }
+            CUDADriver::get_instance().memcpy_host_to_device_async(
+                (void *)device_buffers[i], src, arr_sz, stream);
           } else {
             device_buffers[i] = arg_buffers[i];
           }
@@ -672,6 +1622,7 @@ FunctionType CUDAModuleToFunctionConverter::convert(
           // since it's shared by cpu and cuda.
           DeviceAllocation *ptr =
               static_cast<DeviceAllocation *>(arg_buffers[i]);
+          ndarray_allocs[i] = ptr;
           device_buffers[i] = executor->get_ndarray_alloc_info_ptr(*ptr);
           // We compare arg_buffers[i] and device_buffers[i] later to check
           // if transfer happened.
@@ -684,27 +1635,76 @@ FunctionType CUDAModuleToFunctionConverter::convert(
         }
       }
     }
-    if (transferred) {
-      CUDADriver::get_instance().stream_synchronize(nullptr);
+    // Host-to-device copies above are ordered before the launches below since
+    // they share the same stream. No synchronization is needed here.
+    if (executor->get_config()->ndarray_use_managed_memory &&
+        !CUDAContext::get_instance().is_recording()) {
+      // Migrate the ndarrays in unified memory ahead of the faults. The
+      // prefetches are skipped while recording, as they are only hints.
+      std::unordered_map<int, int> arr_access;
+      for (const auto &task : offloaded_tasks) {
+        for (auto [arg_id, access] : task.arr_access) {
+          arr_access[arg_id] |= access;
+        }
+      }
+      for (auto [arg_id, access] : arr_access) {
+        if (arg_id < (int)args.size() && ndarray_allocs[arg_id] != nullptr) {
+          executor->prefetch_ndarray(
+              *ndarray_allocs[arg_id],
+              !(access & (int)irpass::ExternalPtrAccess::WRITE), stream);
+        }
+      }
     }
-    CUDADriver::get_instance().context_set_limit(
-        CU_LIMIT_STACK_SIZE, executor->get_config()->cuda_stack_limit);
-
-    for (auto task : offloaded_tasks) {
+    CUDAContext::get_instance().set_stack_limit(
+        executor->get_config()->cuda_stack_limit);
+
+    auto launch_task = [&](const OffloadedTask &task) {
+      if (task.cooperative) {
+        TI_TRACE("Launching persistent kernel {}<<<{}, {}>>>", task.name,
+                 task.grid_dim, task.block_dim);
+        CUDAContext::get_instance().launch(
+            cuda_module->lookup_function(task.name), task.name, {&context},
+            {(int)sizeof(context)}, task.grid_dim, task.block_dim, 0,
+            /*cooperative=*/true);
+        return;
+      }
+      if (task.ad_stack_spill_bytes > 0) {
+        executor->ensure_ad_stack_spill_buffer(
+            task.ad_stack_spill_bytes * task.grid_dim * task.block_dim);
+      }
       TI_TRACE("Launching kernel {}<<<{}, {}>>>", task.name, task.grid_dim,
                task.block_dim);
       cuda_module->launch(task.name, task.grid_dim, task.block_dim, 0,
-                          {&context}, {});
+                          {&context}, {(int)sizeof(context)});
+    };
+    if (!tuner || !tuner->launch(stream, launch_task)) {
+      const auto &tasks_to_launch =
+          tuner && tuner->done() ? tuner->tasks() : offloaded_tasks;
+      for (const auto &task : tasks_to_launch) {
+        launch_task(task);
+      }
     }
 
     // copy data back to host
     if (transferred) {
-      CUDADriver::get_instance().stream_synchronize(nullptr);
       for (int i = 0; i < (int)args.size(); i++) {
         if (device_buffers[i] != arg_buffers[i]) {
-          CUDADriver::get_instance().memcpy_device_to_host(
-              arg_buffers[i], (void *)device_buffers[i],
-              context.array_runtime_sizes[i]);
+          void *dst = pinned_buffers[i] ? pinned_buffers[i] : arg_buffers[i];
+          CUDADriver::get_instance().memcpy_device_to_host_async(
+              dst, (void *)device_buffers[i], context.array_runtime_sizes[i],
+              stream);
+        }
+      }
+      // Only the stream of this kernel has to be drained before the host
+      // buffers are valid again.
+      CUDADriver::get_instance().stream_synchronize(stream);
+      for (int i = 0; i < (int)args.size(); i++) {
+        if (device_buffers[i] != arg_buffers[i]) {
+          if (pinned_buffers[i] != nullptr) {
+            std::memcpy(arg_buffers[i], pinned_buffers[i],
+                        context.array_runtime_sizes[i]);
+            pinned_pool->release(pinned_buffers[i]);
+          }
           executor->deallocate_memory_ndarray(temporary_devallocs[i]);
         }
       }
@@ -20,6 +20,8 @@ class KernelCodeGenCUDA : public KernelCodeGen {
       const CompileConfig *config,
       std::unique_ptr<llvm::Module> &&module = nullptr,
       OffloadedStmt *stmt = nullptr) override;
+
+  FunctionType convert_to_function(LLVMCompiledKernel data) override;
 #endif  // TI_WITH_LLVM
 
   bool supports_offline_cache() const override {
@@ -40,6 +42,10 @@ class CUDAModuleToFunctionConverter : public ModuleToFunctionConverter {
   FunctionType convert(const std::string &kernel_name,
                        const std::vector<LlvmLaunchArgInfo> &args,
                        LLVMCompiledKernel data) const override;
+
+  // Called with the tasks of a kernel once their block sizes are tuned, see
+  // CompileConfig::gpu_autotune_block_dim.
+  std::function<void(const std::vector<OffloadedTask> &)> on_block_dim_tuned;
 };
 
 }  // namespace taichi::lang
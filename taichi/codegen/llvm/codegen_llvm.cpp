@@ -1,13 +1,19 @@
 #include "taichi/codegen/llvm/codegen_llvm.h"
 
 #include <algorithm>
+#include <limits>
 
 #ifdef TI_WITH_LLVM
 #include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
 #include "taichi/analysis/offline_cache_util.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
+#include "taichi/program/compile_profiler.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/math/arithmetic.h"
 #include "taichi/runtime/llvm/launch_arg_info.h"
 #include "taichi/runtime/llvm/llvm_offline_cache.h"
 #include "taichi/runtime/program_impls/llvm/llvm_program.h"
@@ -76,6 +82,9 @@ FunctionCreationGuard::~FunctionCreationGuard() {
 
 namespace {
 
+// Real functions with more statements are not inlined into their callers.
+constexpr int kMaxInlinedRealFunctionStatements = 256;
+
 class CodeGenStmtGuard {
  public:
   using Getter = std::function<llvm::BasicBlock *(void)>;
@@ -149,15 +158,65 @@ void TaskCodeGenLLVM::visit(AllocaStmt *stmt) {
 }
 
 void TaskCodeGenLLVM::visit(RandStmt *stmt) {
-  if (stmt->ret_type->is_primitive(PrimitiveTypeID::f16)) {
+  DataType dt = stmt->ret_type;
+  if (dt->is_primitive(PrimitiveTypeID::f16)) {
     // Promoting to f32 since there's no rand_f16 support in runtime.cpp.
-    auto val_f32 = call("rand_f32", get_context());
-    llvm_val[stmt] =
-        builder->CreateFPTrunc(val_f32, llvm::Type::getHalfTy(*llvm_context));
-  } else {
-    llvm_val[stmt] = call(
-        fmt::format("rand_{}", data_type_name(stmt->ret_type)), get_context());
+    dt = PrimitiveType::f32;
+  }
+  llvm::Value *val = nullptr;
+  if (compile_config->counter_based_rand) {
+    val = create_counter_based_rand(stmt, dt);
+  }
+  if (!val) {
+    val = call(fmt::format("rand_{}", data_type_name(dt)), get_context());
+  }
+  if (stmt->ret_type->is_primitive(PrimitiveTypeID::f16)) {
+    val = builder->CreateFPTrunc(val, llvm::Type::getHalfTy(*llvm_context));
   }
+  llvm_val[stmt] = val;
+}
+
+llvm::Value *TaskCodeGenLLVM::create_counter_based_rand(RandStmt *stmt,
+                                                        DataType dt) {
+  if (!current_offload) {
+    return nullptr;
+  }
+  auto *i32_ty = llvm::Type::getInt32Ty(*llvm_context);
+  const auto task_type = current_offload->task_type;
+  if (task_type == OffloadedTaskType::serial &&
+      rand_counters.find(current_offload) == rand_counters.end()) {
+    // The task function runs once, so the counter starts in its entry.
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    auto *counter = create_entry_block_alloca(i32_ty);
+    builder->SetInsertPoint(entry_block);
+    builder->CreateStore(tlctx->get_constant(0), counter);
+    rand_counters[current_offload] = counter;
+  }
+  // The counter of a range-for is reset with its loop variable, see
+  // create_range_for_loop_var(). Neither exists in TLS prologues and
+  // epilogues, which are functions of their own.
+  auto iter = rand_counters.find(current_offload);
+  if (iter == rand_counters.end() ||
+      llvm::cast<llvm::Instruction>(iter->second)->getFunction() != func) {
+    return nullptr;
+  }
+  llvm::Value *iteration = tlctx->get_constant((uint64)0);
+  if (task_type == OffloadedTaskType::range_for) {
+    iteration = builder->CreateSExt(
+        builder->CreateLoad(tlctx->get_data_type(current_offload->index_type),
+                            loop_vars_llvm[current_offload][0]),
+        llvm::Type::getInt64Ty(*llvm_context));
+  } else if (task_type != OffloadedTaskType::serial) {
+    return nullptr;
+  }
+  auto *counter = iter->second;
+  auto *count = builder->CreateLoad(i32_ty, counter);
+  builder->CreateStore(builder->CreateAdd(count, tlctx->get_constant(1)),
+                       counter);
+  return call(fmt::format("rand_philox_{}", data_type_name(dt)), get_context(),
+              tlctx->get_constant((uint32)compile_config->random_seed),
+              tlctx->get_constant((uint32)current_offload->id), iteration,
+              count);
 }
 
 void TaskCodeGenLLVM::emit_extra_unary(UnaryOpStmt *stmt) {
@@ -226,6 +285,10 @@ std::unique_ptr<RuntimeObject> TaskCodeGenLLVM::emit_struct_meta_object(
   } else if (snode->type == SNodeType::pointer) {
     meta = std::make_unique<RuntimeObject>("PointerMeta", this, builder.get());
     emit_struct_meta_base("Pointer", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    meta->call("set_table_size", tlctx->get_constant(snode->hash_table_size));
   } else if (snode->type == SNodeType::root) {
     meta = std::make_unique<RuntimeObject>("RootMeta", this, builder.get());
     emit_struct_meta_base("Root", meta->ptr, snode);
@@ -257,7 +320,8 @@ void TaskCodeGenLLVM::emit_struct_meta_base(const std::string &name,
         StructCompilerLLVM::get_llvm_body_type(module.get(), snode);
     auto element_ty = body_type->getArrayElementType();
     element_size = tlctx->get_type_size(element_ty);
-  } else if (snode->type == SNodeType::pointer) {
+  } else if (snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash) {
     auto element_ty = StructCompilerLLVM::get_llvm_node_type(
         module.get(), snode->ch[0].get());
     element_size = tlctx->get_type_size(element_ty);
@@ -288,6 +352,17 @@ void TaskCodeGenLLVM::emit_struct_meta_base(const std::string &name,
   for (auto const &f : functions)
     common.set(f, get_runtime_function(fmt::format("{}_{}", name, f)));
 
+  // Only hash SNodes iterate over slots instead of cells.
+  if (snode->type == SNodeType::hash) {
+    common.set("get_element_index",
+               get_runtime_function("Hash_get_element_index"));
+  } else {
+    auto setter = common.get_func("set_get_element_index");
+    common.set("get_element_index",
+               llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+                   setter->getFunctionType()->getParamType(1))));
+  }
+
   // "from_parent_element", "refine_coordinates" are different for different
   // snodes, even if they have the same type.
   if (snode->parent)
@@ -512,6 +587,9 @@ void TaskCodeGenLLVM::visit(UnaryOpStmt *stmt) {
         tlctx->get_constant(stmt->ret_type, 1.0), intermediate);
   } else if (op == UnaryOpType::bit_not) {
     llvm_val[stmt] = builder->CreateNot(input);
+  } else if (op == UnaryOpType::popcnt) {
+    llvm_val[stmt] = builder->CreateUnaryIntrinsic(llvm::Intrinsic::ctpop,
+                                                   input, nullptr, "popcnt");
   } else if (op == UnaryOpType::neg) {
     if (is_real(stmt->operand->ret_type)) {
       llvm_val[stmt] = builder->CreateFNeg(input, "neg");
@@ -859,7 +937,8 @@ void TaskCodeGenLLVM::visit(IfStmt *if_stmt) {
       llvm::BasicBlock::Create(*llvm_context, "false_block", func);
   llvm::BasicBlock *after_if =
       llvm::BasicBlock::Create(*llvm_context, "after_if", func);
-  builder->CreateCondBr(
+  create_profiled_cond_br(
+      if_stmt,
       builder->CreateICmpNE(llvm_val[if_stmt->cond], tlctx->get_constant(0)),
       true_block, false_block);
   builder->SetInsertPoint(true_block);
@@ -1111,6 +1190,9 @@ void TaskCodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
     // Since there's only one container to expand, we need a special kernel for
     // more parallelism.
     call("element_listgen_root", get_runtime(), meta_parent, meta_child);
+  } else if (listgen->sort_elements) {
+    call("element_listgen_nonroot_sorted", get_runtime(), meta_parent,
+         meta_child);
   } else {
     call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child);
   }
@@ -1130,6 +1212,32 @@ void TaskCodeGenLLVM::create_increment(llvm::Value *ptr, llvm::Value *value) {
   builder->CreateStore(builder->CreateAdd(original_value, value), ptr);
 }
 
+void TaskCodeGenLLVM::set_loop_vectorize_hints(llvm::BranchInst *latch) {
+  set_loop_vectorize_hints(latch, compile_config->cpu_vectorize_width);
+}
+
+void TaskCodeGenLLVM::set_loop_vectorize_hints(llvm::BranchInst *latch,
+                                               int width) {
+  if (width <= 0) {
+    // Leave the decision to the cost model of the vectorizer.
+    return;
+  }
+  auto make_hint = [&](const std::string &name, llvm::Constant *value) {
+    return llvm::MDNode::get(
+        *llvm_context, {llvm::MDString::get(*llvm_context, name),
+                        llvm::ConstantAsMetadata::get(value)});
+  };
+  // The first operand of a loop ID refers to itself.
+  std::vector<llvm::Metadata *> operands{nullptr};
+  operands.push_back(make_hint("llvm.loop.vectorize.enable",
+                               builder->getInt1(width > 1)));
+  operands.push_back(
+      make_hint("llvm.loop.vectorize.width", builder->getInt32(width)));
+  auto *loop_id = llvm::MDNode::getDistinct(*llvm_context, operands);
+  loop_id->replaceOperandWith(0, loop_id);
+  latch->setMetadata(llvm::LLVMContext::MD_loop, loop_id);
+}
+
 void TaskCodeGenLLVM::create_naive_range_for(RangeForStmt *for_stmt) {
   using namespace llvm;
   BasicBlock *body = BasicBlock::Create(*llvm_context, "for_loop_body", func);
@@ -1139,16 +1247,21 @@ void TaskCodeGenLLVM::create_naive_range_for(RangeForStmt *for_stmt) {
   BasicBlock *loop_test =
       BasicBlock::Create(*llvm_context, "for_loop_test", func);
 
-  auto loop_var_ty = tlctx->get_data_type(PrimitiveType::i32);
+  // Range-fors over 64-bit bounds have 64-bit indices.
+  auto index_type = for_stmt->begin->ret_type == PrimitiveType::i64
+                        ? PrimitiveType::i64
+                        : PrimitiveType::i32;
+  auto loop_var_ty = tlctx->get_data_type(index_type);
 
-  auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+  auto loop_var = create_entry_block_alloca(index_type);
   loop_vars_llvm[for_stmt].push_back(loop_var);
 
   if (!for_stmt->reversed) {
     builder->CreateStore(llvm_val[for_stmt->begin], loop_var);
   } else {
     builder->CreateStore(
-        builder->CreateSub(llvm_val[for_stmt->end], tlctx->get_constant(1)),
+        builder->CreateSub(llvm_val[for_stmt->end],
+                           tlctx->get_constant(index_type, 1)),
         loop_var);
   }
   builder->CreateBr(loop_test);
@@ -1166,7 +1279,7 @@ void TaskCodeGenLLVM::create_naive_range_for(RangeForStmt *for_stmt) {
                                  builder->CreateLoad(loop_var_ty, loop_var),
                                  llvm_val[for_stmt->begin]);
     }
-    builder->CreateCondBr(cond, body, after_loop);
+    create_profiled_cond_br(for_stmt, cond, body, after_loop);
   }
 
   {
@@ -1187,9 +1300,9 @@ void TaskCodeGenLLVM::create_naive_range_for(RangeForStmt *for_stmt) {
     builder->SetInsertPoint(loop_inc);
 
     if (!for_stmt->reversed) {
-      create_increment(loop_var, tlctx->get_constant(1));
+      create_increment(loop_var, tlctx->get_constant(index_type, 1));
     } else {
-      create_increment(loop_var, tlctx->get_constant(-1));
+      create_increment(loop_var, tlctx->get_constant(index_type, -1));
     }
     builder->CreateBr(loop_test);
   }
@@ -1202,6 +1315,80 @@ void TaskCodeGenLLVM::visit(RangeForStmt *for_stmt) {
   create_naive_range_for(for_stmt);
 }
 
+void TaskCodeGenLLVM::init_branch_profile() {
+  if (branch_profile_key.empty()) {
+    return;
+  }
+  irpass::analysis::gather_statements(ir, [&](Stmt *stmt) {
+    if (stmt->is<IfStmt>() || stmt->is<RangeForStmt>()) {
+      int id = branch_profile_ids.size();
+      branch_profile_ids[stmt] = id;
+    }
+    return false;
+  });
+  if (branch_profile_ids.empty()) {
+    return;
+  }
+  const auto &config = *compile_config;
+  if (config.pgo_instrument) {
+    branch_profile_counters =
+        get_llvm_program(prog)
+            ->get_runtime_executor()
+            ->allocate_branch_profile_counters(branch_profile_key,
+                                               branch_profile_ids.size());
+  } else {
+    branch_profile = load_branch_profile(
+        get_branch_profile_path(config.pgo_profile_dir, branch_profile_key));
+    if (branch_profile.size() != branch_profile_ids.size()) {
+      // Not profiled, or profiled with other passes.
+      branch_profile.clear();
+      branch_profile_ids.clear();
+    }
+  }
+}
+
+void TaskCodeGenLLVM::create_profiled_cond_br(const Stmt *stmt,
+                                              llvm::Value *cond,
+                                              llvm::BasicBlock *true_block,
+                                              llvm::BasicBlock *false_block) {
+  auto id = branch_profile_ids.find(stmt);
+  if (id == branch_profile_ids.end()) {
+    builder->CreateCondBr(cond, true_block, false_block);
+    return;
+  }
+  if (branch_profile_counters) {
+    // The threads of a parallel task share the counters.
+    auto *i64_type = llvm::Type::getInt64Ty(*llvm_context);
+    auto *counters = builder->CreateIntToPtr(
+        tlctx->get_constant((uint64)branch_profile_counters),
+        llvm::PointerType::get(i64_type, 0));
+    auto *index = builder->CreateAdd(
+        tlctx->get_constant(2 * id->second),
+        builder->CreateZExt(builder->CreateNot(cond),
+                            llvm::Type::getInt32Ty(*llvm_context)));
+    builder->CreateAtomicRMW(
+        llvm::AtomicRMWInst::Add,
+        builder->CreateGEP(i64_type, counters, index),
+        tlctx->get_constant((uint64)1), llvm::MaybeAlign(8),
+        llvm::AtomicOrdering::Monotonic);
+    builder->CreateCondBr(cond, true_block, false_block);
+    return;
+  }
+  auto [taken, not_taken] = branch_profile[id->second];
+  if (taken + not_taken == 0) {
+    // Never reached in the profiled runs.
+    builder->CreateCondBr(cond, true_block, false_block);
+    return;
+  }
+  // Branch weights are 32-bit.
+  const uint64 scale =
+      std::max(taken, not_taken) / std::numeric_limits<uint32>::max() + 1;
+  builder->CreateCondBr(cond, true_block, false_block,
+                        llvm::MDBuilder(*llvm_context)
+                            .createBranchWeights(taken / scale,
+                                                 not_taken / scale));
+}
+
 llvm::Value *TaskCodeGenLLVM::bitcast_from_u64(llvm::Value *val,
                                                DataType type) {
   llvm::Type *dest_ty = nullptr;
@@ -1317,6 +1504,18 @@ void TaskCodeGenLLVM::visit(AssertStmt *stmt) {
   // TODO: maybe let all asserts in a single offload share a single buffer?
   auto arguments = create_entry_block_alloca(argument_buffer_size);
 
+  // Only the failing path stores the arguments and calls into the runtime, so
+  // that a passing check costs no more than a compare and a branch.
+  auto *failed_block =
+      llvm::BasicBlock::Create(*llvm_context, "assert_failed", func);
+  auto *passed_block =
+      llvm::BasicBlock::Create(*llvm_context, "assert_passed", func);
+  builder->CreateCondBr(
+      builder->CreateIsNotNull(llvm_val[stmt->cond]), passed_block,
+      failed_block,
+      llvm::MDBuilder(*llvm_context).createBranchWeights(1 << 20, 1));
+  builder->SetInsertPoint(failed_block);
+
   std::vector<llvm::Value *> args;
   args.emplace_back(get_runtime());
   args.emplace_back(llvm_val[stmt->cond]);
@@ -1349,6 +1548,8 @@ void TaskCodeGenLLVM::visit(AssertStmt *stmt) {
                          {tlctx->get_constant(0), tlctx->get_constant(0)}));
 
   llvm_val[stmt] = call("taichi_assert_format", std::move(args));
+  builder->CreateBr(passed_block);
+  builder->SetInsertPoint(passed_block);
 }
 
 void TaskCodeGenLLVM::visit(SNodeOpStmt *stmt) {
@@ -1562,7 +1763,9 @@ void TaskCodeGenLLVM::visit(GlobalStoreStmt *stmt) {
       TI_NOT_IMPLEMENTED;
     }
   } else {
-    builder->CreateStore(llvm_val[stmt->val], llvm_val[stmt->dest]);
+    auto store =
+        builder->CreateStore(llvm_val[stmt->val], llvm_val[stmt->dest]);
+    annotate_global_access(store, stmt->dest);
   }
 }
 
@@ -1603,10 +1806,67 @@ void TaskCodeGenLLVM::create_global_load(GlobalLoadStmt *stmt,
       llvm_val[stmt] =
           create_intrinsic_load(ptr, tlctx->get_data_type(stmt->ret_type));
     } else {
-      llvm_val[stmt] =
+      auto load =
           builder->CreateLoad(tlctx->get_data_type(stmt->ret_type), ptr);
+      annotate_global_access(load, stmt->src);
+      llvm_val[stmt] = load;
+    }
+  }
+}
+
+namespace {
+
+std::optional<std::pair<int, bool>> get_global_alias_scope_key(Stmt *ptr) {
+  if (auto matrix_ptr = ptr->cast<MatrixPtrStmt>()) {
+    ptr = matrix_ptr->origin;
+  }
+  if (auto external_ptr = ptr->cast<ExternalPtrStmt>()) {
+    if (auto arg = external_ptr->base_ptr->cast<ArgLoadStmt>()) {
+      return std::make_pair(arg->arg_id, arg->is_grad);
+    }
+  } else if (ptr->is<GetChStmt>()) {
+    return std::make_pair(-1, false);
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+void TaskCodeGenLLVM::annotate_global_access(llvm::Instruction *inst,
+                                             Stmt *ptr) {
+  auto key = get_global_alias_scope_key(ptr);
+  if (!key.has_value()) {
+    return;
+  }
+  if (global_alias_scopes.empty()) {
+    llvm::MDBuilder md_builder(*llvm_context);
+    auto domain = md_builder.createAnonymousAliasScopeDomain("taichi_global");
+    auto ptrs = irpass::analysis::gather_statements(ir, [](Stmt *s) {
+      return get_global_alias_scope_key(s).has_value();
+    });
+    for (auto s : ptrs) {
+      auto scope_key = get_global_alias_scope_key(s).value();
+      if (global_alias_scopes.find(scope_key) == global_alias_scopes.end()) {
+        global_alias_scopes[scope_key] = md_builder.createAnonymousAliasScope(
+            domain, fmt::format("arg_{}{}", scope_key.first,
+                                scope_key.second ? "_grad" : ""));
+      }
+    }
+  }
+  auto it = global_alias_scopes.find(key.value());
+  if (it == global_alias_scopes.end() || global_alias_scopes.size() < 2) {
+    return;
+  }
+  std::vector<llvm::Metadata *> other_scopes;
+  for (auto &[other_key, scope] : global_alias_scopes) {
+    if (other_key != key.value()) {
+      other_scopes.push_back(scope);
     }
   }
+  inst->setMetadata(llvm::LLVMContext::MD_alias_scope,
+                    llvm::MDNode::get(*llvm_context, {it->second}));
+  inst->setMetadata(llvm::LLVMContext::MD_noalias,
+                    llvm::MDNode::get(*llvm_context, other_scopes));
 }
 
 void TaskCodeGenLLVM::visit(GlobalLoadStmt *stmt) {
@@ -1778,6 +2038,7 @@ void TaskCodeGenLLVM::visit(SNodeLookupStmt *stmt) {
         builder->CreateGEP(parent_ty, parent, llvm_val[stmt->input_index]);
   } else if (snode->type == SNodeType::dense ||
              snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash ||
              snode->type == SNodeType::dynamic ||
              snode->type == SNodeType::bitmasked) {
     if (stmt->activate) {
@@ -1964,6 +2225,19 @@ std::string TaskCodeGenLLVM::init_offloaded_task_function(OffloadedStmt *stmt,
                                 task_kernel_name, module.get());
 
   current_task = std::make_unique<OffloadedTask>(task_kernel_name);
+  // The list maintenance tasks of struct-fors share |stmt| but run none of
+  // its AD-stacks.
+  init_ad_stack_spills(suffix.empty() ? stmt : nullptr);
+  if (suffix.empty()) {
+    for (auto [arg_id, access] :
+         irpass::detect_external_ptr_access_in_task(stmt)) {
+      current_task->arr_access[arg_id] = (int)access;
+    }
+    if (compile_config->kernel_profiler) {
+      KernelProfilerBase::register_task_cost(
+          task_kernel_name, irpass::analysis::estimate_task_cost(stmt));
+    }
+  }
 
   for (auto &arg : func->args()) {
     kernel_args.push_back(&arg);
@@ -2004,30 +2278,108 @@ void TaskCodeGenLLVM::finalize_offloaded_task_function() {
   // TI_INFO("Kernel function verified.");
 }
 
+void TaskCodeGenLLVM::init_ad_stack_spills(OffloadedStmt *stmt) {
+  ad_stack_spill_offsets.clear();
+  const auto window = compile_config->ad_stack_window_size;
+  const auto arch = current_arch();
+  if (stmt == nullptr || window <= 0 ||
+      !(arch == Arch::x64 || arch == Arch::arm64 || arch == Arch::cuda)) {
+    return;
+  }
+  std::size_t bytes = 0;
+  auto stacks = irpass::analysis::gather_statements(
+      stmt, [](Stmt *s) { return s->is<AdStackAllocaStmt>(); });
+  for (auto *s : stacks) {
+    auto *stack = s->as<AdStackAllocaStmt>();
+    if (stack->max_size <= window) {
+      continue;
+    }
+    ad_stack_spill_offsets[stack] = bytes;
+    bytes += iroundup((stack->max_size - window) * stack->entry_size_in_bytes(),
+                      sizeof(int64));
+  }
+  current_task->ad_stack_spill_bytes = bytes;
+}
+
+llvm::Value *TaskCodeGenLLVM::ad_stack_top_primal(AdStackAllocaStmt *stack) {
+  auto element_size = tlctx->get_constant(stack->element_size_in_bytes());
+  if (ad_stack_spill_offsets.count(stack) == 0) {
+    return call("stack_top_primal", llvm_val[stack], element_size);
+  }
+  return call("stack_top_primal_spilled", llvm_val[stack],
+              tlctx->get_constant(
+                  (std::size_t)compile_config->ad_stack_window_size),
+              element_size);
+}
+
+llvm::Value *TaskCodeGenLLVM::ad_stack_top_adjoint(AdStackAllocaStmt *stack) {
+  auto element_size = tlctx->get_constant(stack->element_size_in_bytes());
+  if (ad_stack_spill_offsets.count(stack) == 0) {
+    return call("stack_top_adjoint", llvm_val[stack], element_size);
+  }
+  return call("stack_top_adjoint_spilled", llvm_val[stack],
+              tlctx->get_constant(
+                  (std::size_t)compile_config->ad_stack_window_size),
+              element_size);
+}
+
+bool TaskCodeGenLLVM::is_i64_range_for(OffloadedStmt *stmt) {
+  if (stmt->index_type != PrimitiveType::i64) {
+    return false;
+  }
+  auto fits_i32 = [](int64 value) {
+    return value >= std::numeric_limits<int32>::min() &&
+           value <= std::numeric_limits<int32>::max();
+  };
+  return !(stmt->const_begin && stmt->const_end &&
+           fits_i32(stmt->begin_value) && fits_i32(stmt->end_value));
+}
+
+llvm::Type *TaskCodeGenLLVM::get_range_for_index_type(OffloadedStmt *stmt) {
+  return tlctx->get_data_type(is_i64_range_for(stmt) ? PrimitiveType::i64
+                                                     : PrimitiveType::i32);
+}
+
 std::tuple<llvm::Value *, llvm::Value *> TaskCodeGenLLVM::get_range_for_bounds(
     OffloadedStmt *stmt) {
-  llvm::Value *begin, *end;
-  if (stmt->const_begin) {
-    begin = tlctx->get_constant(stmt->begin_value);
-  } else {
-    auto begin_stmt =
-        Stmt::make<GlobalTemporaryStmt>(stmt->begin_offset, PrimitiveType::i32);
-    begin_stmt->accept(this);
-    begin = builder->CreateLoad(tlctx->get_data_type(PrimitiveType::i32),
-                                llvm_val[begin_stmt.get()]);
-  }
-  if (stmt->const_end) {
-    end = tlctx->get_constant(stmt->end_value);
-  } else {
-    auto end_stmt =
-        Stmt::make<GlobalTemporaryStmt>(stmt->end_offset, PrimitiveType::i32);
-    end_stmt->accept(this);
-    end = builder->CreateLoad(tlctx->get_data_type(PrimitiveType::i32),
-                              llvm_val[end_stmt.get()]);
-  }
+  const bool is_i64 = is_i64_range_for(stmt);
+  auto get_bound = [&](bool is_const, int64 value,
+                       std::size_t offset) -> llvm::Value * {
+    if (is_const) {
+      return is_i64 ? tlctx->get_constant(value)
+                    : tlctx->get_constant((int32)value);
+    }
+    // Non-constant bounds are stored with the type of the index, so only
+    // 64-bit indices take the 64-bit path here.
+    auto bound_stmt =
+        Stmt::make<GlobalTemporaryStmt>(offset, stmt->index_type);
+    bound_stmt->accept(this);
+    return builder->CreateLoad(tlctx->get_data_type(stmt->index_type),
+                               llvm_val[bound_stmt.get()]);
+  };
+  auto begin =
+      get_bound(stmt->const_begin, stmt->begin_value, stmt->begin_offset);
+  auto end = get_bound(stmt->const_end, stmt->end_value, stmt->end_offset);
   return std::tuple(begin, end);
 }
 
+void TaskCodeGenLLVM::create_range_for_loop_var(OffloadedStmt *stmt,
+                                                llvm::Value *index) {
+  auto loop_var = create_entry_block_alloca(stmt->index_type);
+  loop_vars_llvm[stmt].push_back(loop_var);
+  auto index_ty = tlctx->get_data_type(stmt->index_type);
+  if (index->getType() != index_ty) {
+    index = builder->CreateSExt(index, index_ty);
+  }
+  builder->CreateStore(index, loop_var);
+  if (compile_config->counter_based_rand) {
+    auto *counter =
+        create_entry_block_alloca(llvm::Type::getInt32Ty(*llvm_context));
+    builder->CreateStore(tlctx->get_constant(0), counter);
+    rand_counters[stmt] = counter;
+  }
+}
+
 void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
                                                 bool spmd) {
   using namespace llvm;
@@ -2051,6 +2403,17 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
     }
   }
 
+  // The blocks of tasks with BLS share the cells of an element.
+  const bool balanced = spmd && stmt->balance_elements && !stmt->bls_prologue;
+  // Bitmasked leaves iterate over their active cells only. On CPUs the loop
+  // skips to the next set bit of the mask. On CUDA each warp compacts the
+  // active cells of the element with a prefix sum of the popcounts of the
+  // mask words, so that the threads of the block take one active cell each.
+  const bool skip_inactive = leaf_block->type == SNodeType::bitmasked;
+  const bool compact_active = skip_inactive && spmd && !balanced &&
+                              compile_config->arch == Arch::cuda &&
+                              stmt->block_dim % 32 == 0;
+
   {
     // Create the loop body function
     auto guard = get_function_creation_guard({
@@ -2130,14 +2493,27 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
     }
 
     llvm::Value *thread_idx = nullptr, *block_dim = nullptr;
+    // With |compact_active|, the loop index is the rank of the active cell.
+    llvm::Value *active_word = nullptr, *active_sum = nullptr;
+    llvm::Value *num_active = nullptr, *lane = nullptr;
 
     if (spmd) {
       thread_idx =
           builder->CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_tid_x, {}, {});
       block_dim = builder->CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_ntid_x,
                                            {}, {});
-      builder->CreateStore(builder->CreateAdd(thread_idx, lower_bound),
-                           loop_index);
+      if (compact_active) {
+        active_word = create_entry_block_alloca(loop_index_ty);
+        active_sum = create_entry_block_alloca(loop_index_ty);
+        num_active = call(leaf_block, element.get("element"),
+                          "gpu_scan_active",
+                          {lower_bound, upper_bound, active_word, active_sum});
+        lane = builder->CreateAnd(thread_idx, tlctx->get_constant(31));
+        builder->CreateStore(thread_idx, loop_index);
+      } else {
+        builder->CreateStore(builder->CreateAdd(thread_idx, lower_bound),
+                             loop_index);
+      }
     } else {
       builder->CreateStore(lower_bound, loop_index);
     }
@@ -2163,9 +2539,25 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
       //     goto func_exit
 
       builder->SetInsertPoint(loop_test_bb);
-      auto cond = builder->CreateICmp(
-          llvm::CmpInst::Predicate::ICMP_SLT,
-          builder->CreateLoad(loop_index_ty, loop_index), upper_bound);
+      llvm::Value *cond = nullptr;
+      if (compact_active) {
+        // The lanes of a warp leave the loop together, as they all take part
+        // in the lookups of the active cells.
+        auto warp_rank = builder->CreateSub(
+            builder->CreateLoad(loop_index_ty, loop_index), lane);
+        cond = builder->CreateICmpSLT(warp_rank, num_active);
+      } else {
+        if (skip_inactive && !spmd) {
+          builder->CreateStore(
+              call(leaf_block, element.get("element"), "next_active",
+                   {builder->CreateLoad(loop_index_ty, loop_index),
+                    upper_bound}),
+              loop_index);
+        }
+        cond = builder->CreateICmp(
+            llvm::CmpInst::Predicate::ICMP_SLT,
+            builder->CreateLoad(loop_index_ty, loop_index), upper_bound);
+      }
       builder->CreateCondBr(cond, loop_body_bb, func_exit);
     }
 
@@ -2176,8 +2568,20 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
     // initialize the coordinates
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    call(refine, parent_coordinates, new_coordinates,
-         builder->CreateLoad(loop_index_ty, loop_index));
+    // A hash leaf block is iterated over its slots, which hold the cells.
+    llvm::Value *cell_index = builder->CreateLoad(loop_index_ty, loop_index);
+    if (leaf_block->type == SNodeType::hash) {
+      cell_index = call(leaf_block, element.get("element"),
+                        "get_element_index", {cell_index});
+    } else if (compact_active) {
+      cell_index = call(leaf_block, element.get("element"), "gpu_active_cell",
+                        {lower_bound,
+                         builder->CreateLoad(loop_index_ty, active_word),
+                         builder->CreateLoad(loop_index_ty, active_sum),
+                         cell_index});
+    }
+
+    call(refine, parent_coordinates, new_coordinates, cell_index);
 
     // For a bit-vectorized loop over a quant array, one more refine step is
     // needed to make final coordinates non-consecutive, since each thread will
@@ -2198,11 +2602,17 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
     auto coord_object = RuntimeObject(kLLVMPhysicalCoordinatesName, this,
                                       builder.get(), new_coordinates);
 
-    if (leaf_block->type == SNodeType::bitmasked ||
-        leaf_block->type == SNodeType::pointer) {
+    if (compact_active) {
+      // Lanes past the last active cell have none to run.
+      exec_cond = builder->CreateICmpSGE(cell_index, tlctx->get_constant(0));
+    } else if ((leaf_block->type == SNodeType::bitmasked && spmd) ||
+               leaf_block->type == SNodeType::pointer ||
+               leaf_block->type == SNodeType::hash) {
+      // On CPUs, the loop index is always at an active cell of a bitmasked
+      // leaf.
       // test whether the current voxel is active or not
       auto is_active = call(leaf_block, element.get("element"), "is_active",
-                            {builder->CreateLoad(loop_index_ty, loop_index)});
+                            {cell_index});
       is_active =
           builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
       exec_cond = builder->CreateAnd(exec_cond, is_active);
@@ -2228,7 +2638,11 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
       } else {
         create_increment(loop_index, tlctx->get_constant(1));
       }
-      builder->CreateBr(loop_test_bb);
+      auto *latch = builder->CreateBr(loop_test_bb);
+      if (!spmd && !skip_inactive && arch_is_cpu(compile_config->arch)) {
+        // Inactive elements of the leaf block are masked off by |exec_cond|.
+        set_loop_vectorize_hints(latch);
+      }
 
       builder->SetInsertPoint(func_exit);
     }
@@ -2264,7 +2678,8 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt,
   // Loop over nodes in the element list, in parallel
   call(struct_for_func, get_context(), tlctx->get_constant(leaf_block->id),
        tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
-       body, tlctx->get_constant(stmt->tls_size),
+       tlctx->get_constant((int)balanced), body,
+       tlctx->get_constant(stmt->tls_size),
        tlctx->get_constant(stmt->num_cpu_threads));
   // TODO: why do we need num_cpu_threads on GPUs?
 
@@ -2293,7 +2708,7 @@ void TaskCodeGenLLVM::visit(LoopIndexStmt *stmt) {
         builder->CreateLoad(llvm::Type::getInt32Ty(*llvm_context), GEP);
   } else {
     llvm_val[stmt] =
-        builder->CreateLoad(llvm::Type::getInt32Ty(*llvm_context),
+        builder->CreateLoad(tlctx->get_data_type(stmt->ret_type),
                             loop_vars_llvm[stmt->loop][stmt->index]);
   }
 }
@@ -2303,7 +2718,9 @@ void TaskCodeGenLLVM::visit(LoopLinearIndexStmt *stmt) {
       (stmt->loop->as<OffloadedStmt>()->task_type ==
            OffloadedStmt::TaskType::struct_for ||
        stmt->loop->as<OffloadedStmt>()->task_type ==
-           OffloadedStmt::TaskType::mesh_for)) {
+           OffloadedStmt::TaskType::mesh_for ||
+       stmt->loop->as<OffloadedStmt>()->task_type ==
+           OffloadedStmt::TaskType::range_for)) {
     llvm_val[stmt] = call("thread_idx");
   } else {
     TI_NOT_IMPLEMENTED;
@@ -2332,6 +2749,11 @@ void TaskCodeGenLLVM::visit(BlockCornerIndexStmt *stmt) {
         builder->CreateGEP(physical_coordinate_ty, block_corner_coordinates,
                            {tlctx->get_constant(0), tlctx->get_constant(0),
                             tlctx->get_constant(stmt->index)}));
+  } else if (stmt->loop->is<OffloadedStmt>() &&
+             stmt->loop->as<OffloadedStmt>()->task_type ==
+                 OffloadedStmt::TaskType::range_for) {
+    TI_ASSERT(range_for_block_corner);
+    llvm_val[stmt] = range_for_block_corner;
   } else {
     TI_NOT_IMPLEMENTED;
   }
@@ -2376,6 +2798,16 @@ void TaskCodeGenLLVM::visit(ClearListStmt *stmt) {
 }
 
 void TaskCodeGenLLVM::visit(InternalFuncStmt *stmt) {
+  // The channels of the texels returned by TextureOpStmt.
+  const std::string composite_extract = "composite_extract_";
+  if (starts_with(stmt->func_name, composite_extract)) {
+    const auto index =
+        std::stoi(stmt->func_name.substr(composite_extract.size()));
+    llvm_val[stmt] =
+        builder->CreateExtractValue(llvm_val[stmt->args[0]], {(unsigned)index});
+    return;
+  }
+
   std::vector<llvm::Value *> args;
 
   if (stmt->with_runtime_context)
@@ -2384,30 +2816,73 @@ void TaskCodeGenLLVM::visit(InternalFuncStmt *stmt) {
   for (auto s : stmt->args) {
     args.push_back(llvm_val[s]);
   }
+
+  // Functions returning several values (e.g. sifakis_svd_f32) write them
+  // through a trailing out pointer. Load the aggregate so that
+  // composite_extract_N can pick the results from it.
+  auto func_type = get_runtime_function(stmt->func_name)->getFunctionType();
+  if (func_type->getReturnType()->isVoidTy() &&
+      func_type->getNumParams() == args.size() + 1) {
+    auto result_type =
+        func_type->getParamType(args.size())->getPointerElementType();
+    auto result = create_entry_block_alloca(result_type);
+    args.push_back(result);
+    call(stmt->func_name, std::move(args));
+    llvm_val[stmt] = builder->CreateLoad(result_type, result);
+    return;
+  }
   llvm_val[stmt] = call(stmt->func_name, std::move(args));
 }
 
 void TaskCodeGenLLVM::visit(AdStackAllocaStmt *stmt) {
   TI_ASSERT_INFO(stmt->max_size > 0,
                  "Adaptive autodiff stack's size should have been determined.");
-  auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
-                                   stmt->size_in_bytes());
+  auto spill = ad_stack_spill_offsets.find(stmt);
+  if (spill == ad_stack_spill_offsets.end()) {
+    auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
+                                     stmt->size_in_bytes());
+    auto alloca = create_entry_block_alloca(type, sizeof(int64));
+    llvm_val[stmt] = builder->CreateBitCast(
+        alloca, llvm::PointerType::getInt8PtrTy(*llvm_context));
+    call("stack_init", llvm_val[stmt]);
+    return;
+  }
+  // Only the top entries stay here, after the size and the spill pointer.
+  auto type = llvm::ArrayType::get(
+      llvm::Type::getInt8Ty(*llvm_context),
+      2 * sizeof(int64) +
+          compile_config->ad_stack_window_size * stmt->entry_size_in_bytes());
   auto alloca = create_entry_block_alloca(type, sizeof(int64));
   llvm_val[stmt] = builder->CreateBitCast(
       alloca, llvm::PointerType::getInt8PtrTy(*llvm_context));
-  call("stack_init", llvm_val[stmt]);
+  auto region = call("stack_spill_region", get_context(),
+                     tlctx->get_constant(current_task->ad_stack_spill_bytes),
+                     tlctx->get_constant(spill->second));
+  call("stack_init_spilled", llvm_val[stmt], region);
 }
 
 void TaskCodeGenLLVM::visit(AdStackPopStmt *stmt) {
-  call("stack_pop", llvm_val[stmt->stack]);
+  auto stack = stmt->stack->as<AdStackAllocaStmt>();
+  if (ad_stack_spill_offsets.count(stack) == 0) {
+    call("stack_pop", llvm_val[stack]);
+    return;
+  }
+  call("stack_pop_spilled", llvm_val[stack],
+       tlctx->get_constant((std::size_t)compile_config->ad_stack_window_size),
+       tlctx->get_constant(stack->element_size_in_bytes()));
 }
 
 void TaskCodeGenLLVM::visit(AdStackPushStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
-  call("stack_push", llvm_val[stack], tlctx->get_constant(stack->max_size),
-       tlctx->get_constant(stack->element_size_in_bytes()));
-  auto primal_ptr = call("stack_top_primal", llvm_val[stack],
-                         tlctx->get_constant(stack->element_size_in_bytes()));
+  if (ad_stack_spill_offsets.count(stack) == 0) {
+    call("stack_push", llvm_val[stack], tlctx->get_constant(stack->max_size),
+         tlctx->get_constant(stack->element_size_in_bytes()));
+  } else {
+    call("stack_push_spilled", llvm_val[stack],
+         tlctx->get_constant((std::size_t)compile_config->ad_stack_window_size),
+         tlctx->get_constant(stack->element_size_in_bytes()));
+  }
+  auto primal_ptr = ad_stack_top_primal(stack);
   primal_ptr = builder->CreateBitCast(
       primal_ptr,
       llvm::PointerType::get(tlctx->get_data_type(stmt->ret_type), 0));
@@ -2416,8 +2891,7 @@ void TaskCodeGenLLVM::visit(AdStackPushStmt *stmt) {
 
 void TaskCodeGenLLVM::visit(AdStackLoadTopStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
-  auto primal_ptr = call("stack_top_primal", llvm_val[stack],
-                         tlctx->get_constant(stack->element_size_in_bytes()));
+  auto primal_ptr = ad_stack_top_primal(stack);
   auto primal_ty = tlctx->get_data_type(stmt->ret_type);
   primal_ptr =
       builder->CreateBitCast(primal_ptr, llvm::PointerType::get(primal_ty, 0));
@@ -2426,8 +2900,7 @@ void TaskCodeGenLLVM::visit(AdStackLoadTopStmt *stmt) {
 
 void TaskCodeGenLLVM::visit(AdStackLoadTopAdjStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
-  auto adjoint = call("stack_top_adjoint", llvm_val[stack],
-                      tlctx->get_constant(stack->element_size_in_bytes()));
+  auto adjoint = ad_stack_top_adjoint(stack);
   auto adjoint_ty = tlctx->get_data_type(stmt->ret_type);
   adjoint =
       builder->CreateBitCast(adjoint, llvm::PointerType::get(adjoint_ty, 0));
@@ -2436,8 +2909,7 @@ void TaskCodeGenLLVM::visit(AdStackLoadTopAdjStmt *stmt) {
 
 void TaskCodeGenLLVM::visit(AdStackAccAdjointStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
-  auto adjoint_ptr = call("stack_top_adjoint", llvm_val[stack],
-                          tlctx->get_constant(stack->element_size_in_bytes()));
+  auto adjoint_ptr = ad_stack_top_adjoint(stack);
   auto adjoint_ty = tlctx->get_data_type(stack->ret_type);
   adjoint_ptr = builder->CreateBitCast(adjoint_ptr,
                                        llvm::PointerType::get(adjoint_ty, 0));
@@ -2627,8 +3099,18 @@ LLVMCompiledTask TaskCodeGenLLVM::run_compilation() {
   // Final lowering
 
   const auto &config = *compile_config;
+  if ((config.pgo_instrument || config.pgo_use) && !kernel->is_evaluator &&
+      ir->is<OffloadedStmt>()) {
+    // Empty for the tasks the offline cache can't tell apart either.
+    branch_profile_key = get_hashed_offline_cache_key_of_task(
+        &config, kernel->program, ir->as<OffloadedStmt>());
+  }
   kernel->offload_to_executable(config, ir);
+  init_branch_profile();
 
+  // The passes above are recorded on their own. The tasks of a kernel may
+  // emit their code concurrently.
+  CompileProfiler::Scope profiled(kernel->get_name(), "codegen_llvm");
   emit_to_module();
   eliminate_unused_functions();
 
@@ -2637,7 +3119,9 @@ LLVMCompiledTask TaskCodeGenLLVM::run_compilation() {
     for (const auto &task : offloaded_tasks) {
       llvm::Function *func = module->getFunction(task.name);
       TI_ASSERT(func);
-      tlctx->mark_function_as_cuda_kernel(func, task.block_dim);
+      // Tunable tasks get no launch bounds.
+      tlctx->mark_function_as_cuda_kernel(
+          func, task.block_dim_tunable ? 0 : task.block_dim);
     }
   }
 
@@ -2686,9 +3170,24 @@ void TaskCodeGenLLVM::visit(ReferenceStmt *stmt) {
 
 void TaskCodeGenLLVM::visit(FuncCallStmt *stmt) {
   if (!func_map.count(stmt->func)) {
+    // The AST key tells apart the functions of the same name in the tasks
+    // loaded from the offline cache.
+    auto name = stmt->func->get_name();
+    if (const auto &ast_key = stmt->func->try_get_ast_key()) {
+      name += "_" + *ast_key;
+    }
     auto guard = get_function_creation_guard(
         {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0)},
-        stmt->func->get_name());
+        name);
+    // All the tasks of a kernel calling the function generate the same
+    // body, which is kept once when the tasks are linked.
+    guard.body->setLinkage(llvm::GlobalValue::LinkOnceODRLinkage);
+    // Inlining a large function into each of its call sites would multiply
+    // the code to optimize, so it is called instead.
+    if (irpass::analysis::count_statements(stmt->func->ir.get()) >
+        kMaxInlinedRealFunctionStatements) {
+      guard.body->addFnAttr(llvm::Attribute::NoInline);
+    }
     Function *old_real_func = current_real_func;
     current_real_func = stmt->func;
     func_map.insert({stmt->func, guard.body});
@@ -2781,7 +3280,11 @@ LLVMCompiledTask LLVMCompiledTask::clone() const {
 }
 
 LLVMCompiledKernel LLVMCompiledKernel::clone() const {
-  return {tasks, llvm::CloneModule(*module)};
+  LLVMCompiledKernel result(tasks,
+                            module ? llvm::CloneModule(*module) : nullptr);
+  result.native_code_key = native_code_key;
+  result.native_code = native_code;
+  return result;
 }
 
 }  // namespace taichi::lang
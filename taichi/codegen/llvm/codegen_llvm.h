@@ -1,12 +1,14 @@
 // The LLVM backend for CPUs/NVPTX/AMDGPU
 #pragma once
 
+#include <map>
 #include <set>
 #include <unordered_map>
 
 #ifdef TI_WITH_LLVM
 
 #include "taichi/ir/ir.h"
+#include "taichi/runtime/llvm/branch_profile.h"
 #include "taichi/runtime/llvm/launch_arg_info.h"
 #include "taichi/codegen/llvm/llvm_codegen_utils.h"
 #include "taichi/codegen/llvm/llvm_compiled_data.h"
@@ -44,6 +46,8 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   llvm::Value *current_coordinates;
   llvm::Value *parent_coordinates{nullptr};
   llvm::Value *block_corner_coordinates{nullptr};
+  // The first index of the block of a GPU range-for that uses BLS.
+  llvm::Value *range_for_block_corner{nullptr};
   llvm::GlobalVariable *bls_buffer{nullptr};
   // Mainly for supporting continue stmt
   llvm::BasicBlock *current_loop_reentry;
@@ -67,6 +71,28 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   std::unordered_map<Function *, llvm::Function *> func_map;
 
+  // The offsets in the spill region of each thread of the AD-stacks of the
+  // current task that are deeper than |ad_stack_window_size|.
+  std::unordered_map<const Stmt *, std::size_t> ad_stack_spill_offsets;
+
+  // Scoped-noalias metadata of the disjoint global buffers accessed by the
+  // kernel, keyed by ndarray (arg_id, is_grad). SNode accesses use
+  // {-1, false}.
+  std::map<std::pair<int, bool>, llvm::MDNode *> global_alias_scopes;
+
+  // Profile-guided optimization: the offline cache key of the task before
+  // lowering, which its branch profile is saved under, the index of each
+  // branching IfStmt and RangeForStmt in the profile, and the counters of
+  // CompileConfig::pgo_instrument or the profile of CompileConfig::pgo_use.
+  std::string branch_profile_key;
+  std::unordered_map<const Stmt *, int> branch_profile_ids;
+  uint64 *branch_profile_counters{nullptr};
+  BranchProfile branch_profile;
+
+  // The number of random numbers drawn so far in the current iteration of
+  // each offloaded task, with CompileConfig::counter_based_rand.
+  std::unordered_map<OffloadedStmt *, llvm::Value *> rand_counters;
+
   using IRVisitor::visit;
   using LLVMModuleBuilder::call;
 
@@ -163,9 +189,26 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void create_increment(llvm::Value *ptr, llvm::Value *value);
 
+  // Attaches the vectorization hints of |compile_config| to the loop whose
+  // back edge is |latch|.
+  void set_loop_vectorize_hints(llvm::BranchInst *latch);
+  // Same, with a vectorization width of |width| instead.
+  void set_loop_vectorize_hints(llvm::BranchInst *latch, int width);
+
   // Direct translation
   void create_naive_range_for(RangeForStmt *for_stmt);
 
+  // Numbers the branches of the lowered task and sets up their counters or
+  // loads their profile.
+  void init_branch_profile();
+
+  // The branch of |stmt| to |true_block| if |cond| holds, counted or weighted
+  // by its profile.
+  void create_profiled_cond_br(const Stmt *stmt,
+                               llvm::Value *cond,
+                               llvm::BasicBlock *true_block,
+                               llvm::BasicBlock *false_block);
+
   static std::string get_runtime_snode_name(SNode *snode);
 
   void visit(Block *stmt_list) override;
@@ -174,6 +217,10 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void visit(RandStmt *stmt) override;
 
+  // Draws the random number of |stmt| from the Philox stream of the current
+  // iteration. Returns nullptr if the task has no such stream.
+  llvm::Value *create_counter_based_rand(RandStmt *stmt, DataType dt);
+
   virtual void emit_extra_unary(UnaryOpStmt *stmt);
 
   void visit(DecorationStmt *stmt) override;
@@ -290,6 +337,10 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void create_global_load(GlobalLoadStmt *stmt, bool should_cache_as_read_only);
 
+  // Tells LLVM that |inst| accessing |ptr| does not alias accesses to the
+  // other ndarrays or to SNodes, mirroring irpass::analysis::alias_analysis.
+  void annotate_global_access(llvm::Instruction *inst, Stmt *ptr);
+
   void visit(GlobalLoadStmt *stmt) override;
 
   void visit(GetRootStmt *stmt) override;
@@ -321,13 +372,31 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void finalize_offloaded_task_function();
 
+  void init_ad_stack_spills(OffloadedStmt *stmt);
+
+  llvm::Value *ad_stack_top_primal(AdStackAllocaStmt *stack);
+
+  llvm::Value *ad_stack_top_adjoint(AdStackAllocaStmt *stack);
+
   FunctionCreationGuard get_function_creation_guard(
       std::vector<llvm::Type *> argument_types,
       const std::string &func_name = "function_body");
 
+  // Whether an offloaded range-for needs the 64-bit runtime helpers. Loops
+  // with a 64-bit index whose constant bounds fit in 32 bits still use the
+  // 32-bit path.
+  bool is_i64_range_for(OffloadedStmt *stmt);
+
+  // The type of the index passed to the body of an offloaded range-for.
+  llvm::Type *get_range_for_index_type(OffloadedStmt *stmt);
+
   std::tuple<llvm::Value *, llvm::Value *> get_range_for_bounds(
       OffloadedStmt *stmt);
 
+  // Stores the index passed to the body of an offloaded range-for into its
+  // loop variable, widening it if the 32-bit path is used for a 64-bit index.
+  void create_range_for_loop_var(OffloadedStmt *stmt, llvm::Value *index);
+
   virtual void create_offload_range_for(OffloadedStmt *stmt) = 0;
 
   virtual void create_offload_mesh_for(OffloadedStmt *stmt) {
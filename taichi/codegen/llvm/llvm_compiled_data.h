@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "llvm/IR/Module.h"
@@ -12,12 +13,41 @@ class OffloadedTask {
   std::string name;
   int block_dim{0};
   int grid_dim{0};
+  // Bytes of the AD-stack arena taken by each thread.
+  std::size_t ad_stack_spill_bytes{0};
+  // The irpass::ExternalPtrAccess bits of each array argument the task
+  // accesses, by argument id.
+  std::unordered_map<int, int> arr_access;
+  // With CompileConfig::gpu_autotune_block_dim, whether the block size can be
+  // changed at launch time, and whether it has been tuned already.
+  bool block_dim_tunable{false};
+  bool block_dim_tuned{false};
+  // The number of threads of a range-for with a constant range, 0 otherwise.
+  int64 num_threads{0};
+  // With CompileConfig::gpu_persistent_kernel or gpu_fuse_serial_tasks,
+  // whether the task can be fused into a persistent kernel, i.e. it is correct with any grid size and block
+  // size and uses no shared memory, and whether it runs in a single thread.
+  bool fusable{false};
+  bool serial{false};
+  // Whether the task is a persistent kernel, launched cooperatively with as
+  // many blocks as can be resident. Its |grid_dim| is set at load time.
+  bool cooperative{false};
 
   explicit OffloadedTask(const std::string &name = "",
                          int block_dim = 0,
                          int grid_dim = 0)
       : name(name), block_dim(block_dim), grid_dim(grid_dim){};
-  TI_IO_DEF(name, block_dim, grid_dim);
+  TI_IO_DEF(name,
+            block_dim,
+            grid_dim,
+            ad_stack_spill_bytes,
+            arr_access,
+            block_dim_tunable,
+            block_dim_tuned,
+            num_threads,
+            fusable,
+            serial,
+            cooperative);
 };
 
 struct LLVMCompiledTask {
@@ -44,6 +74,10 @@ struct LLVMCompiledTask {
 struct LLVMCompiledKernel {
   std::vector<OffloadedTask> tasks;
   std::unique_ptr<llvm::Module> module{nullptr};
+  // The machine code of the kernel, see JITSession::get_native_code_key().
+  // Kernels loaded from native code in the offline cache have no |module|.
+  std::string native_code_key;
+  std::string native_code;
   LLVMCompiledKernel() = default;
   LLVMCompiledKernel(LLVMCompiledKernel &&) = default;
   LLVMCompiledKernel &operator=(LLVMCompiledKernel &&) = default;
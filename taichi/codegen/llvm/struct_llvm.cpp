@@ -68,7 +68,6 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
 
   llvm::Type *body_type = nullptr, *aux_type = nullptr;
   if (type == SNodeType::dense || type == SNodeType::bitmasked) {
-    TI_ASSERT(snode._morton == false);
     body_type = llvm::ArrayType::get(ch_type, snode.max_num_elements());
     if (type == SNodeType::bitmasked) {
       aux_type = llvm::ArrayType::get(llvm::Type::getInt32Ty(*llvm_ctx_),
@@ -106,12 +105,21 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
                                     snode.max_num_elements());
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
+  } else if (type == SNodeType::hash) {
+    // keys and mutexes
+    auto slots_type = llvm::ArrayType::get(llvm::PointerType::getInt32Ty(*ctx),
+                                           snode.hash_table_size);
+    aux_type = llvm::StructType::get(*ctx, {slots_type, slots_type});
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     snode.hash_table_size);
   } else if (type == SNodeType::dynamic) {
     // mutex and n (number of elements)
     aux_type =
         llvm::StructType::get(*ctx, {llvm::PointerType::getInt32Ty(*ctx),
                                      llvm::PointerType::getInt32Ty(*ctx)});
-    body_type = llvm::PointerType::getInt8PtrTy(*ctx);
+    // the chunk directory
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     snode.num_dynamic_chunks());
   } else {
     TI_P(snode.type_name());
     TI_NOT_IMPLEMENTED;
@@ -170,7 +178,21 @@ void StructCompilerLLVM::generate_refine_coordinates(SNode *snode) {
 
   for (int i = 0; i < taichi_max_num_indices; i++) {
     auto addition = tlctx_->get_constant(0);
-    if (snode->extractors[i].shape > 1) {
+    if (snode->_morton) {
+      for (const auto &run : snode->morton_runs(i)) {
+        auto mask = tlctx_->get_constant(
+            (int32)(((1LL << run.num_bits) - 1) << run.index_bit));
+        auto bits = builder.CreateAnd(l, mask);
+        if (run.index_bit > run.coord_bit) {
+          bits = builder.CreateLShr(
+              bits, tlctx_->get_constant(run.index_bit - run.coord_bit));
+        } else {
+          bits = builder.CreateShl(
+              bits, tlctx_->get_constant(run.coord_bit - run.index_bit));
+        }
+        addition = builder.CreateOr(addition, bits);
+      }
+    } else if (snode->extractors[i].shape > 1) {
       auto prev = tlctx_->get_constant(snode->extractors[i].acc_shape *
                                        snode->extractors[i].shape);
       auto next = tlctx_->get_constant(snode->extractors[i].acc_shape);
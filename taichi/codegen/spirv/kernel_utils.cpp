@@ -2,6 +2,8 @@
 
 #include <unordered_map>
 
+#include <spirv/unified1/spirv.hpp>
+
 #include "taichi/program/kernel.h"
 #define TI_RUNTIME_HOST
 #include "taichi/program/context.h"
@@ -21,6 +23,9 @@ std::string TaskAttributes::buffers_name(BufferInfo b) {
   if (b.type == BufferType::GlobalTmps) {
     return "GlobalTmps";
   }
+  if (b.type == BufferType::DispatchArgs) {
+    return "DispatchArgs";
+  }
   if (b.type == BufferType::Root) {
     return std::string("Root: ") + std::to_string(b.root_id);
   }
@@ -59,7 +64,10 @@ KernelContextAttributes::KernelContextAttributes(
   // as well but let's leave that as a followup up PR.
   for (const auto &ka : kernel.parameter_list) {
     ArgAttributes aa;
-    aa.dtype = ka.get_element_type()->as<PrimitiveType>()->type;
+    // Quantized ndarray elements are bound as their integer containers.
+    aa.dtype = quant_storage_type(ka.get_element_type())
+                   ->as<PrimitiveType>()
+                   ->type;
     const size_t dt_bytes = ka.get_element_size();
     aa.is_array = ka.is_array;
     if (aa.is_array) {
@@ -126,5 +134,51 @@ KernelContextAttributes::KernelContextAttributes(
   TI_ASSERT(has_rets() == (rets_bytes_ > 0));
 }
 
+int KernelContextAttributes::get_spec_constant_id(int arg_id) const {
+  for (int i = 0; i < spec_constant_args.size(); ++i) {
+    if (spec_constant_args[i].arg_id == arg_id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void specialize_spirv(std::vector<uint32_t> &spirv,
+                      const std::unordered_map<uint32_t, uint32_t> &values) {
+  // Skips the header of the module.
+  constexpr size_t kFirstInstr = 5;
+  auto for_each_instr = [&](auto &&f) {
+    for (size_t i = kFirstInstr; i < spirv.size();) {
+      uint32_t num_words = spirv[i] >> spv::WordCountShift;
+      TI_ASSERT(num_words > 0 && i + num_words <= spirv.size());
+      f((spv::Op)(spirv[i] & spv::OpCodeMask), &spirv[i], num_words);
+      i += num_words;
+    }
+  };
+
+  // The result ids of the specialization constants and their SpecIds.
+  std::unordered_map<uint32_t, uint32_t> spec_ids;
+  for_each_instr([&](spv::Op op, uint32_t *words, uint32_t num_words) {
+    if (op == spv::OpDecorate && num_words == 4 &&
+        words[2] == spv::DecorationSpecId) {
+      spec_ids[words[1]] = words[3];
+    }
+  });
+  for_each_instr([&](spv::Op op, uint32_t *words, uint32_t num_words) {
+    // Only 32-bit scalars are declared as specialization constants.
+    if (op != spv::OpSpecConstant || num_words != 4) {
+      return;
+    }
+    auto id = spec_ids.find(words[2]);
+    if (id == spec_ids.end()) {
+      return;
+    }
+    auto value = values.find(id->second);
+    if (value != values.end()) {
+      words[3] = value->second;
+    }
+  });
+}
+
 }  // namespace spirv
 }  // namespace taichi::lang
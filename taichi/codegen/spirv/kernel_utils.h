@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "taichi/ir/offloaded_task_type.h"
@@ -20,7 +21,15 @@ namespace spirv {
  * Per offloaded task attributes.
  */
 struct TaskAttributes {
-  enum class BufferType { Root, GlobalTmps, Args, Rets, ListGen, ExtArr };
+  enum class BufferType {
+    Root,
+    GlobalTmps,
+    Args,
+    Rets,
+    ListGen,
+    ExtArr,
+    DispatchArgs
+  };
 
   struct BufferInfo {
     BufferType type;
@@ -68,12 +77,21 @@ struct TaskAttributes {
     TI_IO_DEF(buffer, binding);
   };
 
+  struct BufferAccess {
+    BufferInfo buffer;
+    bool is_written{false};
+
+    TI_IO_DEF(buffer, is_written);
+  };
+
   struct TextureBind {
     int arg_id{0};
     int binding{0};
     bool is_storage{false};
+    // The mip level bound to a storage image.
+    int lod{0};
 
-    TI_IO_DEF(arg_id, binding, is_storage);
+    TI_IO_DEF(arg_id, binding, is_storage, lod);
   };
 
   std::string name;
@@ -104,9 +122,20 @@ struct TaskAttributes {
     TI_IO_DEF(begin, end, const_begin, const_end);
   };
   std::vector<BufferBind> buffer_binds;
+  // Every buffer the task may access, including the arrays that are accessed
+  // through physical pointers and thus have no binding. Empty if unknown.
+  std::vector<BufferAccess> buffer_accesses;
   std::vector<TextureBind> texture_binds;
   // Only valid when |task_type| is range_for.
   std::optional<RangeForAttributes> range_for_attribs;
+  // Slot in the dispatch args buffer holding the {x, y, z} workgroup counts.
+  // * If |writes_dispatch_args|, this task computes the counts of the task
+  //   right after it and stores them in the slot.
+  // * Otherwise, if the slot is non-negative, the task can be dispatched
+  //   indirectly from the slot instead of with the advisory sizes, which
+  //   remain an upper bound.
+  int dispatch_args_slot{-1};
+  bool writes_dispatch_args{false};
 
   static std::string buffers_name(BufferInfo b);
 
@@ -117,8 +146,28 @@ struct TaskAttributes {
             advisory_num_threads_per_group,
             task_type,
             buffer_binds,
+            buffer_accesses,
             texture_binds,
-            range_for_attribs);
+            range_for_attribs,
+            dispatch_args_slot,
+            writes_dispatch_args);
+};
+
+// The dispatch args buffer has one 16-byte slot per indirectly dispatched
+// task of a kernel. Tasks beyond the last slot are dispatched directly.
+constexpr int kMaxDispatchArgsSlots = 4096;
+constexpr size_t kDispatchArgsSlotSize = 16;
+
+/**
+ * A scalar argument compiled as a SPIR-V specialization constant, so that its
+ * value is set when the pipelines are created rather than at each launch. Its
+ * SpecId is its index in KernelContextAttributes::spec_constant_args.
+ */
+struct SpecConstantArg {
+  std::string name;
+  int arg_id{-1};
+
+  TI_IO_DEF(name, arg_id);
 };
 
 /**
@@ -240,14 +289,22 @@ class KernelContextAttributes {
     return args_bytes();
   }
 
+  /**
+   * The SpecId of the argument |arg_id|, or -1 if it is not a specialization
+   * constant.
+   */
+  int get_spec_constant_id(int arg_id) const;
+
   std::vector<irpass::ExternalPtrAccess> arr_access;
+  std::vector<SpecConstantArg> spec_constant_args;
 
   TI_IO_DEF(arg_attribs_vec_,
             ret_attribs_vec_,
             args_bytes_,
             rets_bytes_,
             extra_args_bytes_,
-            arr_access);
+            arr_access,
+            spec_constant_args);
 
  private:
   std::vector<ArgAttributes> arg_attribs_vec_;
@@ -274,5 +331,13 @@ struct TaichiKernelAttributes {
   TI_IO_DEF(name, is_jit_evaluator, tasks_attribs, ctx_attribs);
 };
 
+/**
+ * Overrides the default values of the specialization constants in |spirv|,
+ * keyed by SpecId, with the bits of 32-bit scalars. Drivers then specialize
+ * the module when its pipeline is created.
+ */
+void specialize_spirv(std::vector<uint32_t> &spirv,
+                      const std::unordered_map<uint32_t, uint32_t> &values);
+
 }  // namespace spirv
 }  // namespace taichi::lang
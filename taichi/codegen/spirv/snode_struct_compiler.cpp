@@ -4,6 +4,10 @@ namespace taichi::lang {
 namespace spirv {
 namespace {
 
+size_t align_up(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
 class StructCompiler {
  public:
   CompiledSNodeStructs run(SNode &root) {
@@ -12,6 +16,15 @@ class StructCompiler {
     CompiledSNodeStructs result;
     result.root = &root;
     result.root_size = compute_snode_size(&root);
+    // The pools of the pointer SNodes go after the tree. Each of them can
+    // hold all the cells of its SNode.
+    for (auto &[id, desc] : snode_descriptors_) {
+      if (desc.snode->type == SNodeType::pointer) {
+        desc.pool_offset = align_up(result.root_size, 8);
+        desc.pool_capacity = desc.total_num_cells_from_root;
+        result.root_size = desc.pool_offset + desc.pool_size();
+      }
+    }
     result.snode_descriptors = std::move(snode_descriptors_);
     /*
     result.type_factory = new tinyir::Block;
@@ -104,6 +117,10 @@ class StructCompiler {
             num_cells % 32 == 0 ? (num_cells / 32) : (num_cells / 32 + 1);
         sn_desc.container_stride =
             cell_stride * num_cells + bitmask_num_words * 4;
+      } else if (sn->type == SNodeType::pointer) {
+        sn_desc.container_stride = 4 * sn_desc.cells_per_container_pot();
+      } else if (sn->type == SNodeType::dynamic) {
+        sn_desc.container_stride = sn_desc.dynamic_length_offset() + 4;
       } else {
         sn_desc.container_stride =
             cell_stride * sn_desc.cells_per_container_pot();
@@ -168,6 +185,14 @@ size_t SNodeDescriptor::cells_per_container_pot() const {
   return snode->num_cells_per_container;
 }
 
+size_t SNodeDescriptor::pool_ambient_offset() const {
+  return align_up(pool_recycle_list_offset() + 4 * pool_capacity, 8);
+}
+
+size_t SNodeDescriptor::dynamic_length_offset() const {
+  return align_up(cell_stride * (cells_per_container_pot() + 1), 4);
+}
+
 CompiledSNodeStructs compile_snode_structs(SNode &root) {
   StructCompiler compiler;
   return compiler.run(root);
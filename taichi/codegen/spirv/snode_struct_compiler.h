@@ -36,6 +36,41 @@ struct SNodeDescriptor {
   int axis_bits_sum[taichi_max_num_indices] = {0};
   int axis_start_bit[taichi_max_num_indices] = {0};
 
+  // A pointer SNode container holds the offsets of its cells in the root
+  // buffer, 0 for inactive cells and 1 for those being allocated. The cells
+  // are allocated from a pool placed after the SNode tree in the root buffer,
+  // laid out as
+  //   u32 bump, i32 num_free, u32 num_recycled, u32 (padding)
+  //   u32 free_list[pool_capacity]
+  //   u32 recycle_list[pool_capacity]
+  //   the ambient cell, read when a cell is inactive
+  //   the cells
+  size_t pool_offset = 0;
+  size_t pool_capacity = 0;
+
+  size_t pool_free_list_offset() const {
+    return pool_offset + 16;
+  }
+  size_t pool_recycle_list_offset() const {
+    return pool_free_list_offset() + 4 * pool_capacity;
+  }
+  size_t pool_ambient_offset() const;
+  // Pool cells are padded to words, so that they can be cleared word by word.
+  size_t pool_cell_stride() const {
+    return (cell_stride + 3) / 4 * 4;
+  }
+  size_t pool_cells_offset() const {
+    return pool_ambient_offset() + pool_cell_stride();
+  }
+  size_t pool_size() const {
+    return pool_cells_offset() + pool_cell_stride() * pool_capacity -
+           pool_offset;
+  }
+
+  // A dynamic SNode container holds its cells, one more cell that takes the
+  // appends past the end, and then the length.
+  size_t dynamic_length_offset() const;
+
   SNode *get_child(int ch_i) const {
     return snode->ch[ch_i].get();
   }
@@ -1,5 +1,6 @@
 #include "taichi/codegen/spirv/spirv_codegen.h"
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <variant>
@@ -27,12 +28,20 @@ constexpr char kArgsBufferName[] = "args_buffer";
 constexpr char kRetBufferName[] = "ret_buffer";
 constexpr char kListgenBufferName[] = "listgen_buffer";
 constexpr char kExtArrBufferName[] = "ext_arr_buffer";
+constexpr char kDispatchArgsBufferName[] = "dispatch_args_buffer";
 
 constexpr int kMaxNumThreadsGridStrideLoop = 65536 * 2;
+constexpr int kMaxNumThreadsStructFor = 65536;
+constexpr int kNumThreadsPerGroupStructFor = 128;
+
+// Marks the slot of a pointer SNode cell being allocated. Cell offsets are
+// multiples of 4.
+constexpr uint32_t kClaimedSlot = 1;
 
 using BufferType = TaskAttributes::BufferType;
 using BufferInfo = TaskAttributes::BufferInfo;
 using BufferBind = TaskAttributes::BufferBind;
+using BufferAccess = TaskAttributes::BufferAccess;
 using BufferInfoHasher = TaskAttributes::BufferInfoHasher;
 
 using TextureBind = TaskAttributes::TextureBind;
@@ -52,6 +61,8 @@ std::string buffer_instance_name(BufferInfo b) {
       return kListgenBufferName;
     case BufferType::ExtArr:
       return std::string(kExtArrBufferName) + "_" + std::to_string(b.root_id);
+    case BufferType::DispatchArgs:
+      return kDispatchArgsBufferName;
     default:
       TI_NOT_IMPLEMENTED;
       break;
@@ -69,6 +80,10 @@ class TaskCodegen : public IRVisitor {
     const KernelContextAttributes *ctx_attribs;
     std::string ti_kernel_name;
     int task_id_in_kernel;
+    // See TaskAttributes::dispatch_args_slot.
+    int dispatch_args_slot{-1};
+    // Generates the task writing the dispatch args of |task_ir| instead.
+    bool write_dispatch_args{false};
   };
 
   const bool use_64bit_pointers = false;
@@ -79,9 +94,12 @@ class TaskCodegen : public IRVisitor {
         task_ir_(params.task_ir),
         compiled_structs_(params.compiled_structs),
         ctx_attribs_(params.ctx_attribs),
-        task_name_(fmt::format("{}_t{:02d}",
+        task_name_(fmt::format("{}_t{:02d}{}",
                                params.ti_kernel_name,
-                               params.task_id_in_kernel)) {
+                               params.task_id_in_kernel,
+                               params.write_dispatch_args ? "_args" : "")),
+        dispatch_args_slot_(params.dispatch_args_slot),
+        write_dispatch_args_(params.write_dispatch_args) {
     allow_undefined_visitor = true;
     invoke_default_visitor = true;
 
@@ -108,7 +126,9 @@ class TaskCodegen : public IRVisitor {
     kernel_function_ = ir_->new_function();  // void main();
     ir_->debug_name(spv::OpName, kernel_function_, "main");
 
-    if (task_ir_->task_type == OffloadedTaskType::serial) {
+    if (write_dispatch_args_) {
+      generate_dispatch_args_kernel(task_ir_);
+    } else if (task_ir_->task_type == OffloadedTaskType::serial) {
       generate_serial_kernel(task_ir_);
     } else if (task_ir_->task_type == OffloadedTaskType::range_for) {
       // struct_for is automatically lowered to ranged_for for dense snodes
@@ -117,6 +137,10 @@ class TaskCodegen : public IRVisitor {
       generate_listgen_kernel(task_ir_);
     } else if (task_ir_->task_type == OffloadedTaskType::struct_for) {
       generate_struct_for_kernel(task_ir_);
+    } else if (task_ir_->task_type == OffloadedTaskType::gc) {
+      generate_gc_kernel(task_ir_);
+    } else if (task_ir_->task_type == OffloadedTaskType::mesh_for) {
+      generate_mesh_for_kernel(task_ir_);
     } else {
       TI_ERROR("Unsupported offload type={} on SPIR-V codegen",
                task_ir_->task_name());
@@ -125,6 +149,9 @@ class TaskCodegen : public IRVisitor {
     // the task IR.
     emit_headers();
 
+    task_attribs_.dispatch_args_slot = dispatch_args_slot_;
+    task_attribs_.writes_dispatch_args = write_dispatch_args_;
+
     Result res;
     res.spirv_code = ir_->finalize();
     res.task_attribs = std::move(task_attribs_);
@@ -365,6 +392,250 @@ class TaskCodegen : public IRVisitor {
     }
   }
 
+  spirv::Value u32_immediate(uint32_t value) {
+    return ir_->uint_immediate_number(ir_->u32_type(), value);
+  }
+
+  // Returns a pointer to the word of the root buffer at the byte offset |ptr|.
+  spirv::Value root_word(int root_id, spirv::Value ptr) {
+    auto buffer = get_buffer_value(BufferInfo(BufferType::Root, root_id),
+                                   PrimitiveType::u32);
+    auto index =
+        ir_->make_value(spv::OpShiftRightLogical, ir_->u32_type(),
+                        ir_->cast(ir_->u32_type(), ptr), u32_immediate(2));
+    return ir_->struct_array_access(ir_->u32_type(), buffer, index);
+  }
+
+  spirv::Value root_atomic(spv::Op op, spirv::Value word, spirv::Value val) {
+    return ir_->make_value(op, ir_->u32_type(), word,
+                           /*scope=*/ir_->const_i32_one_,
+                           /*semantics=*/ir_->const_i32_zero_, val);
+  }
+
+  template <typename ThenFn, typename ElseFn>
+  void emit_if(spirv::Value cond,
+               const ThenFn &then_body,
+               const ElseFn &else_body) {
+    spirv::Label then_label = ir_->new_label();
+    spirv::Label else_label = ir_->new_label();
+    spirv::Label merge_label = ir_->new_label();
+    ir_->make_inst(spv::OpSelectionMerge, merge_label,
+                   spv::SelectionControlMaskNone);
+    ir_->make_inst(spv::OpBranchConditional, cond, then_label, else_label);
+    ir_->start_label(then_label);
+    then_body();
+    ir_->make_inst(spv::OpBranch, merge_label);
+    ir_->start_label(else_label);
+    else_body();
+    ir_->make_inst(spv::OpBranch, merge_label);
+    ir_->start_label(merge_label);
+  }
+
+  template <typename ThenFn>
+  void emit_if(spirv::Value cond, const ThenFn &then_body) {
+    emit_if(cond, then_body, [] {});
+  }
+
+  // Runs |body| for each u32 k in [0, count).
+  template <typename BodyFn>
+  void emit_loop(spirv::Value count, const BodyFn &body) {
+    spirv::Label init_label = ir_->current_label();
+    spirv::Label head_label = ir_->new_label();
+    spirv::Label body_label = ir_->new_label();
+    spirv::Label continue_label = ir_->new_label();
+    spirv::Label merge_label = ir_->new_label();
+    ir_->make_inst(spv::OpBranch, head_label);
+
+    ir_->start_label(head_label);
+    spirv::PhiValue k = ir_->make_phi(ir_->u32_type(), 2);
+    k.set_incoming(0, u32_immediate(0), init_label);
+    ir_->make_inst(spv::OpLoopMerge, merge_label, continue_label,
+                   spv::LoopControlMaskNone);
+    ir_->make_inst(spv::OpBranchConditional, ir_->lt(k, count), body_label,
+                   merge_label);
+
+    ir_->start_label(body_label);
+    body(spirv::Value(k));
+    ir_->make_inst(spv::OpBranch, continue_label);
+
+    ir_->start_label(continue_label);
+    k.set_incoming(1, ir_->add(k, u32_immediate(1)), ir_->current_label());
+    ir_->make_inst(spv::OpBranch, head_label);
+    ir_->start_label(merge_label);
+  }
+
+  void clear_root_words(int root_id, spirv::Value ptr, spirv::Value num_words) {
+    ptr = ir_->cast(ir_->u32_type(), ptr);
+    emit_loop(num_words, [&](spirv::Value k) {
+      auto word = root_word(
+          root_id, ir_->add(ptr, ir_->mul(k, u32_immediate(4))));
+      ir_->store_variable(word, u32_immediate(0));
+    });
+  }
+
+  // Returns the offset of a cleared cell from the pool of a pointer SNode, or
+  // 0 if the pool is exhausted. The cells recycled by the last gc come first.
+  spirv::Value pointer_pool_allocate(int root_id, const SNodeDescriptor &desc) {
+    auto cell_var = ir_->alloca_variable(ir_->u32_type());
+    ir_->store_variable(cell_var, u32_immediate(0));
+    // |num_free| goes negative once the free list is used up, and is reset by
+    // the next gc.
+    auto num_free = ir_->cast(
+        ir_->i32_type(),
+        root_atomic(spv::OpAtomicISub,
+                    root_word(root_id, u32_immediate(desc.pool_offset + 4)),
+                    u32_immediate(1)));
+    emit_if(
+        ir_->gt(num_free, ir_->const_i32_zero_),
+        [&] {
+          auto index = ir_->cast(ir_->u32_type(),
+                                 ir_->sub(num_free, ir_->const_i32_one_));
+          auto entry = root_word(
+              root_id, ir_->add(u32_immediate(desc.pool_free_list_offset()),
+                                ir_->mul(index, u32_immediate(4))));
+          ir_->store_variable(cell_var,
+                              ir_->load_variable(entry, ir_->u32_type()));
+        },
+        [&] {
+          auto index = root_atomic(
+              spv::OpAtomicIAdd,
+              root_word(root_id, u32_immediate(desc.pool_offset)),
+              u32_immediate(1));
+          emit_if(ir_->lt(index, u32_immediate(desc.pool_capacity)), [&] {
+            ir_->store_variable(
+                cell_var,
+                ir_->add(u32_immediate(desc.pool_cells_offset()),
+                         ir_->mul(index,
+                                  u32_immediate(desc.pool_cell_stride()))));
+          });
+        });
+    return ir_->load_variable(cell_var, ir_->u32_type());
+  }
+
+  // Clears |cell| and queues it for the next gc.
+  void pointer_pool_recycle(int root_id,
+                            const SNodeDescriptor &desc,
+                            spirv::Value cell) {
+    clear_root_words(root_id, cell,
+                     u32_immediate(desc.pool_cell_stride() / 4));
+    auto index = root_atomic(
+        spv::OpAtomicIAdd,
+        root_word(root_id, u32_immediate(desc.pool_offset + 8)),
+        u32_immediate(1));
+    auto entry =
+        root_word(root_id, ir_->add(u32_immediate(desc.pool_recycle_list_offset()),
+                                    ir_->mul(index, u32_immediate(4))));
+    ir_->store_variable(entry, cell);
+  }
+
+  spirv::Value pointer_slot(int root_id,
+                            spirv::Value parent_ptr,
+                            spirv::Value input_index) {
+    return root_word(
+        root_id, ir_->add(ir_->cast(ir_->u32_type(), parent_ptr),
+                          ir_->mul(ir_->cast(ir_->u32_type(), input_index),
+                                   u32_immediate(4))));
+  }
+
+  spirv::Value pointer_activation(ActivationOp op,
+                                  spirv::Value parent_ptr,
+                                  int root_id,
+                                  const SNode *sn,
+                                  spirv::Value input_index) {
+    const auto &desc = compiled_structs_[root_id].snode_descriptors.at(sn->id);
+    auto slot = pointer_slot(root_id, parent_ptr, input_index);
+    if (op == ActivationOp::activate) {
+      // A slot is 0 for an inactive cell, and kClaimedSlot while the cell is
+      // being allocated. The thread claiming the slot stores the cell before
+      // its subgroup reconverges, so the others wait on it only after that.
+      emit_if(ir_->eq(ir_->load_variable(slot, ir_->u32_type()),
+                      u32_immediate(0)),
+              [&] {
+                auto old = ir_->make_value(
+                    spv::OpAtomicCompareExchange, ir_->u32_type(), slot,
+                    /*scope=*/ir_->const_i32_one_,
+                    /*semantics_equal=*/ir_->const_i32_zero_,
+                    /*semantics_unequal=*/ir_->const_i32_zero_,
+                    u32_immediate(kClaimedSlot), u32_immediate(0));
+                emit_if(ir_->eq(old, u32_immediate(0)), [&] {
+                  root_atomic(spv::OpAtomicExchange, slot,
+                              pointer_pool_allocate(root_id, desc));
+                });
+              });
+      spirv::Label head_label = ir_->new_label();
+      spirv::Label body_label = ir_->new_label();
+      spirv::Label merge_label = ir_->new_label();
+      ir_->make_inst(spv::OpBranch, head_label);
+      ir_->start_label(head_label);
+      auto value = ir_->make_value(spv::OpAtomicLoad, ir_->u32_type(), slot,
+                                   /*scope=*/ir_->const_i32_one_,
+                                   /*semantics=*/ir_->const_i32_zero_);
+      ir_->make_inst(spv::OpLoopMerge, merge_label, body_label,
+                     spv::LoopControlMaskNone);
+      ir_->make_inst(spv::OpBranchConditional,
+                     ir_->eq(value, u32_immediate(kClaimedSlot)), body_label,
+                     merge_label);
+      ir_->start_label(body_label);
+      ir_->make_inst(spv::OpBranch, head_label);
+      ir_->start_label(merge_label);
+      return spirv::Value();
+    } else if (op == ActivationOp::deactivate) {
+      auto old = root_atomic(spv::OpAtomicExchange, slot, u32_immediate(0));
+      emit_if(ir_->gt(old, u32_immediate(kClaimedSlot)),
+              [&] { pointer_pool_recycle(root_id, desc, old); });
+      return spirv::Value();
+    } else {
+      return ir_->gt(ir_->load_variable(slot, ir_->u32_type()),
+                     u32_immediate(kClaimedSlot));
+    }
+  }
+
+  // The cell, or the ambient cell if it is inactive.
+  spirv::Value pointer_lookup(spirv::Value parent_ptr,
+                              int root_id,
+                              const SNode *sn,
+                              spirv::Value input_index) {
+    const auto &desc = compiled_structs_[root_id].snode_descriptors.at(sn->id);
+    auto cell = ir_->load_variable(
+        pointer_slot(root_id, parent_ptr, input_index), ir_->u32_type());
+    cell = ir_->select(ir_->gt(cell, u32_immediate(kClaimedSlot)), cell,
+                       u32_immediate(desc.pool_ambient_offset()));
+    return ir_->cast(parent_ptr.stype, cell);
+  }
+
+  spirv::Value dynamic_length_word(spirv::Value parent_ptr,
+                                   int root_id,
+                                   const SNode *sn) {
+    const auto &desc = compiled_structs_[root_id].snode_descriptors.at(sn->id);
+    return root_word(root_id,
+                     ir_->add(ir_->cast(ir_->u32_type(), parent_ptr),
+                              u32_immediate(desc.dynamic_length_offset())));
+  }
+
+  // The cell |input_index| of a dynamic SNode. Indices past the end map to the
+  // extra cell after the others.
+  spirv::Value dynamic_lookup(spirv::Value parent_ptr,
+                              int root_id,
+                              const SNode *sn,
+                              spirv::Value input_index) {
+    const auto &desc = compiled_structs_[root_id].snode_descriptors.at(sn->id);
+    auto num_cells = u32_immediate(desc.cells_per_container_pot());
+    auto index = ir_->cast(ir_->u32_type(), input_index);
+    index = ir_->select(ir_->lt(index, num_cells), index, num_cells);
+    auto offset = ir_->mul(index, u32_immediate(desc.cell_stride));
+    return ir_->add(parent_ptr, ir_->cast(parent_ptr.stype, offset));
+  }
+
+  spirv::Value dynamic_length(spirv::Value parent_ptr,
+                              int root_id,
+                              const SNode *sn) {
+    const auto &desc = compiled_structs_[root_id].snode_descriptors.at(sn->id);
+    auto num_cells = u32_immediate(desc.cells_per_container_pot());
+    auto length = ir_->load_variable(
+        dynamic_length_word(parent_ptr, root_id, sn), ir_->u32_type());
+    return ir_->select(ir_->lt(length, num_cells), length, num_cells);
+  }
+
   void visit(SNodeOpStmt *stmt) override {
     const int root_id = snode_to_root_.at(stmt->snode->id);
     std::string parent = stmt->ptr->raw_name();
@@ -391,6 +662,57 @@ class TaskCodegen : public IRVisitor {
       } else {
         TI_NOT_IMPLEMENTED;
       }
+    } else if (stmt->snode->type == SNodeType::pointer) {
+      spirv::Value input_index_val = ir_->query_value(stmt->val->raw_name());
+      if (stmt->op_type == SNodeOpType::is_active) {
+        auto is_active =
+            pointer_activation(ActivationOp::query, parent_val, root_id,
+                               stmt->snode, input_index_val);
+        is_active =
+            ir_->cast(ir_->get_primitive_type(stmt->ret_type), is_active);
+        is_active = ir_->make_value(spv::OpSNegate, is_active.stype, is_active);
+        ir_->register_value(stmt->raw_name(), is_active);
+      } else if (stmt->op_type == SNodeOpType::deactivate) {
+        pointer_activation(ActivationOp::deactivate, parent_val, root_id,
+                           stmt->snode, input_index_val);
+      } else if (stmt->op_type == SNodeOpType::activate) {
+        pointer_activation(ActivationOp::activate, parent_val, root_id,
+                           stmt->snode, input_index_val);
+      } else {
+        TI_NOT_IMPLEMENTED;
+      }
+    } else if (stmt->snode->type == SNodeType::dynamic) {
+      const auto &desc = compiled_structs_[root_id].snode_descriptors.at(
+          stmt->snode->id);
+      auto length_word = dynamic_length_word(parent_val, root_id, stmt->snode);
+      if (stmt->op_type == SNodeOpType::allocate) {
+        auto index =
+            root_atomic(spv::OpAtomicIAdd, length_word, u32_immediate(1));
+        ir_->store_variable(ir_->query_value(stmt->val->raw_name()),
+                            ir_->cast(ir_->i32_type(), index));
+        ir_->register_value(
+            stmt->raw_name(),
+            dynamic_lookup(parent_val, root_id, stmt->snode, index));
+      } else if (stmt->op_type == SNodeOpType::length) {
+        auto length = dynamic_length(parent_val, root_id, stmt->snode);
+        ir_->register_value(
+            stmt->raw_name(),
+            ir_->cast(ir_->get_primitive_type(stmt->ret_type), length));
+      } else if (stmt->op_type == SNodeOpType::deactivate) {
+        // The cells are cleared, so that appending again starts from zeros.
+        auto num_cells = u32_immediate(desc.cells_per_container_pot());
+        auto length =
+            root_atomic(spv::OpAtomicExchange, length_word, u32_immediate(0));
+        length = ir_->select(ir_->lt(length, num_cells), length, num_cells);
+        auto num_words = ir_->make_value(
+            spv::OpShiftRightLogical, ir_->u32_type(),
+            ir_->add(ir_->mul(length, u32_immediate(desc.cell_stride)),
+                     u32_immediate(3)),
+            u32_immediate(2));
+        clear_root_words(root_id, parent_val, num_words);
+      } else {
+        TI_NOT_IMPLEMENTED;
+      }
     } else {
       TI_NOT_IMPLEMENTED;
     }
@@ -420,6 +742,21 @@ class TaskCodegen : public IRVisitor {
             ir_->query_value(stmt->input_index->raw_name());
         bitmasked_activation(ActivationOp::activate, parent_val, root_id, sn,
                              input_index_val);
+      } else if (sn->type == SNodeType::pointer) {
+        spirv::Value input_index_val =
+            ir_->query_value(stmt->input_index->raw_name());
+        pointer_activation(ActivationOp::activate, parent_val, root_id, sn,
+                           input_index_val);
+      } else if (sn->type == SNodeType::dynamic) {
+        const auto &desc =
+            compiled_structs_[root_id].snode_descriptors.at(sn->id);
+        auto index = ir_->cast(ir_->u32_type(),
+                               ir_->query_value(stmt->input_index->raw_name()));
+        auto length = ir_->add(index, u32_immediate(1));
+        auto num_cells = u32_immediate(desc.cells_per_container_pot());
+        length = ir_->select(ir_->lt(length, num_cells), length, num_cells);
+        root_atomic(spv::OpAtomicUMax,
+                    dynamic_length_word(parent_val, root_id, sn), length);
       } else {
         TI_NOT_IMPLEMENTED;
       }
@@ -428,6 +765,12 @@ class TaskCodegen : public IRVisitor {
     spirv::Value val;
     if (is_root) {
       val = parent_val;  // Assert Root[0] access at first time
+    } else if (sn->type == SNodeType::pointer) {
+      val = pointer_lookup(parent_val, root_id, sn,
+                           ir_->query_value(stmt->input_index->raw_name()));
+    } else if (sn->type == SNodeType::dynamic) {
+      val = dynamic_lookup(parent_val, root_id, sn,
+                           ir_->query_value(stmt->input_index->raw_name()));
     } else {
       const auto &snode_descs = compiled_structs_[root_id].snode_descriptors;
       const auto &desc = snode_descs.at(sn->id);
@@ -508,6 +851,9 @@ class TaskCodegen : public IRVisitor {
                                        (1 << axis_bits_sum[stmt->index]) - 1));
         val = ir_->cast(ir_->i32_type(), val);
         ir_->register_value(stmt_name, val);
+      } else if (type == OffloadedTaskType::mesh_for) {
+        TI_ASSERT(stmt->index == 0);
+        ir_->register_value(stmt_name, ir_->query_value("ii"));
       } else {
         TI_NOT_IMPLEMENTED;
       }
@@ -524,17 +870,61 @@ class TaskCodegen : public IRVisitor {
   void visit(GlobalStoreStmt *stmt) override {
     spirv::Value val = ir_->query_value(stmt->val->raw_name());
 
+    if (stmt->dest->is<ThreadLocalPtrStmt>()) {
+      ir_->store_variable(ir_->query_value(stmt->dest->raw_name()), val);
+      return;
+    }
     store_buffer(stmt->dest, val);
   }
 
   void visit(GlobalLoadStmt *stmt) override {
     auto dt = stmt->element_type();
 
-    auto val = load_buffer(stmt->src, dt);
+    spirv::Value val;
+    if (stmt->src->is<ThreadLocalPtrStmt>()) {
+      val = ir_->load_variable(ir_->query_value(stmt->src->raw_name()),
+                               ir_->get_primitive_type(dt));
+    } else {
+      val = load_buffer(stmt->src, dt);
+    }
 
     ir_->register_value(stmt->raw_name(), val);
   }
 
+  void visit(LoopLinearIndexStmt *stmt) override {
+    // Only the xlogues of block local storage ask for it, to stride over the
+    // elements of a patch.
+    TI_ASSERT(stmt->loop->is<OffloadedStmt>() &&
+              stmt->loop->as<OffloadedStmt>()->task_type ==
+                  OffloadedTaskType::mesh_for);
+    ir_->register_value(
+        stmt->raw_name(),
+        ir_->cast(ir_->i32_type(), ir_->get_local_invocation_id(0)));
+  }
+
+  void visit(MeshPatchIndexStmt *stmt) override {
+    ir_->register_value(stmt->raw_name(), ir_->query_value("patch_idx"));
+  }
+
+  void visit(BlockLocalPtrStmt *stmt) override {
+    // Block local storage is a workgroup array of words, addressed by the
+    // byte offset like the buffers are, see at_buffer().
+    TI_ASSERT(bls_buffer_.id != 0);
+    ir_->register_value(stmt->raw_name(),
+                        ir_->query_value(stmt->offset->raw_name()));
+  }
+
+  void visit(ThreadLocalPtrStmt *stmt) override {
+    // Every invocation runs the whole loop of the task, so its thread local
+    // storage is just a set of function variables.
+    auto [it, inserted] = tls_vars_.try_emplace(stmt->offset);
+    if (inserted) {
+      it->second = ir_->alloca_variable(
+          ir_->get_primitive_type(stmt->ret_type.ptr_removed()));
+    }
+    ir_->register_value(stmt->raw_name(), it->second);
+  }
+
   void visit(ArgLoadStmt *stmt) override {
     const auto arg_id = stmt->arg_id;
     const auto &arg_attribs = ctx_attribs_->args()[arg_id];
@@ -546,6 +936,12 @@ class TaskCodegen : public IRVisitor {
     } else {
       const auto dt = PrimitiveType::get(arg_attribs.dtype);
       const auto val_type = ir_->get_primitive_type(dt);
+      const int spec_id = ctx_attribs_->get_spec_constant_id(arg_id);
+      if (spec_id >= 0) {
+        ir_->register_value(stmt->raw_name(),
+                            ir_->spec_constant(val_type, spec_id));
+        return;
+      }
       spirv::Value buffer_val = ir_->make_value(
           spv::OpAccessChain,
           ir_->get_pointer_type(val_type, spv::StorageClassUniform),
@@ -746,6 +1142,13 @@ class TaskCodegen : public IRVisitor {
       } else {
         TI_NOT_IMPLEMENTED
       }
+    } else if (stmt->op_type == UnaryOpType::popcnt) {
+      operand_val = ir_->cast(dst_type, operand_val);
+      if (is_integral(dst_dt)) {
+        val = ir_->make_value(spv::OpBitCount, dst_type, operand_val);
+      } else {
+        TI_NOT_IMPLEMENTED
+      }
     } else if (stmt->op_type == UnaryOpType::cast_value) {
       val = ir_->cast(dst_type, operand_val);
     } else if (stmt->op_type == UnaryOpType::cast_bits) {
@@ -1201,6 +1604,7 @@ class TaskCodegen : public IRVisitor {
         bind.arg_id = arg_id;
         bind.binding = binding;
         bind.is_storage = true;
+        bind.lod = stmt->lod;
         texture_binds_.push_back(bind);
         argid_to_tex_value_[arg_id] = val;
       } else {
@@ -1237,6 +1641,16 @@ class TaskCodegen : public IRVisitor {
         val = ir_->fetch_texel(tex, args, lod);
       }
       ir_->register_value(stmt->raw_name(), val);
+    } else if (stmt->op == TextureOpType::kSampleGrad) {
+      // Sample with explicit gradients, laid out as UV, dUV/dx, dUV/dy
+      const int num_dims = stmt->args.size() / 3;
+      std::vector<spirv::Value> args[3];
+      for (int i = 0; i < stmt->args.size(); i++) {
+        args[i / num_dims].push_back(
+            ir_->query_value(stmt->args[i]->raw_name()));
+      }
+      val = ir_->sample_texture_grad(tex, args[0], args[1], args[2]);
+      ir_->register_value(stmt->raw_name(), val);
     } else if (stmt->op == TextureOpType::kLoad ||
                stmt->op == TextureOpType::kStore) {
       // Image Ops
@@ -1406,38 +1820,46 @@ class TaskCodegen : public IRVisitor {
     spirv::Value val;
     bool use_subgroup_reduction = false;
 
-    if (stmt->is_reduction &&
+    // Subgroup operations on 8, 16 and 64-bit integers or on f16 need extended
+    // types support.
+    const bool has_subgroup_type =
+        dt->is_primitive(PrimitiveTypeID::i32) ||
+        dt->is_primitive(PrimitiveTypeID::u32) ||
+        dt->is_primitive(PrimitiveTypeID::f32) ||
+        dt->is_primitive(PrimitiveTypeID::f64);
+    if (stmt->is_reduction && has_subgroup_type &&
         caps_->get(DeviceCapability::spirv_has_subgroup_arithmetic)) {
+      // The atomics of reductions are only emitted in uniform control flow,
+      // i.e. by the epilogues of thread local storage.
       spv::Op atomic_op = spv::OpNop;
       bool negation = false;
       if (is_integral(dt)) {
         if (stmt->op_type == AtomicOpType::add) {
-          atomic_op = spv::OpGroupIAdd;
+          atomic_op = spv::OpGroupNonUniformIAdd;
         } else if (stmt->op_type == AtomicOpType::sub) {
-          atomic_op = spv::OpGroupIAdd;
+          atomic_op = spv::OpGroupNonUniformIAdd;
           negation = true;
         } else if (stmt->op_type == AtomicOpType::min) {
-          atomic_op = is_signed(dt) ? spv::OpGroupSMin : spv::OpGroupUMin;
+          atomic_op = is_signed(dt) ? spv::OpGroupNonUniformSMin
+                                    : spv::OpGroupNonUniformUMin;
         } else if (stmt->op_type == AtomicOpType::max) {
-          atomic_op = is_signed(dt) ? spv::OpGroupSMax : spv::OpGroupUMax;
+          atomic_op = is_signed(dt) ? spv::OpGroupNonUniformSMax
+                                    : spv::OpGroupNonUniformUMax;
         }
       } else if (is_real(dt)) {
         if (stmt->op_type == AtomicOpType::add) {
-          atomic_op = spv::OpGroupFAdd;
+          atomic_op = spv::OpGroupNonUniformFAdd;
         } else if (stmt->op_type == AtomicOpType::sub) {
-          atomic_op = spv::OpGroupFAdd;
+          atomic_op = spv::OpGroupNonUniformFAdd;
           negation = true;
         } else if (stmt->op_type == AtomicOpType::min) {
-          atomic_op = spv::OpGroupFMin;
+          atomic_op = spv::OpGroupNonUniformFMin;
         } else if (stmt->op_type == AtomicOpType::max) {
-          atomic_op = spv::OpGroupFMax;
+          atomic_op = spv::OpGroupNonUniformFMax;
         }
       }
 
       if (atomic_op != spv::OpNop) {
-        spirv::Value scope_subgroup =
-            ir_->int_immediate_number(ir_->i32_type(), 3);
-        spirv::Value operation_reduce = ir_->const_i32_zero_;
         if (negation) {
           if (is_integral(dt)) {
             data = ir_->make_value(spv::OpSNegate, data.stype, data);
@@ -1445,8 +1867,10 @@ class TaskCodegen : public IRVisitor {
             data = ir_->make_value(spv::OpFNegate, data.stype, data);
           }
         }
-        data = ir_->make_value(atomic_op, ir_->get_primitive_type(dt),
-                               scope_subgroup, operation_reduce, data);
+        data = ir_->make_value(
+            atomic_op, ir_->get_primitive_type(dt),
+            ir_->int_immediate_number(ir_->i32_type(), spv::ScopeSubgroup),
+            spv::GroupOperationReduce, data);
         val = data;
         use_subgroup_reduction = true;
       }
@@ -1456,9 +1880,42 @@ class TaskCodegen : public IRVisitor {
     spirv::Label merge_label;
 
     if (use_subgroup_reduction) {
-      spirv::Value subgroup_id = ir_->get_subgroup_invocation_id();
-      spirv::Value cond = ir_->make_value(spv::OpIEqual, ir_->bool_type(),
-                                          subgroup_id, ir_->const_i32_zero_);
+      const int group_size = task_attribs_.advisory_num_threads_per_group;
+      const bool use_workgroup_reduction =
+          group_size > 1 &&
+          caps_->get(DeviceCapability::spirv_has_subgroup_basic);
+      spirv::Value subgroup_results;
+      spirv::Value cond;
+      if (use_workgroup_reduction) {
+        // The subgroups meet in shared memory, so that only one invocation
+        // per workgroup issues the atomic.
+        subgroup_results = ir_->alloca_workgroup_array(
+            ir_->get_array_type(ir_->get_primitive_type(dt), group_size));
+        shared_array_binds_.push_back(subgroup_results);
+        spirv::Value subgroup_id = ir_->get_subgroup_id();
+        make_if(ir_->make_value(spv::OpIEqual, ir_->bool_type(),
+                                ir_->get_subgroup_invocation_id(),
+                                ir_->const_i32_zero_),
+                [&]() {
+                  ir_->store_variable(
+                      workgroup_array_access(subgroup_results, subgroup_id, dt),
+                      data);
+                });
+        ir_->make_inst(
+            spv::OpControlBarrier,
+            ir_->int_immediate_number(ir_->i32_type(), spv::ScopeWorkgroup),
+            ir_->int_immediate_number(ir_->i32_type(), spv::ScopeWorkgroup),
+            ir_->int_immediate_number(
+                ir_->i32_type(), spv::MemorySemanticsWorkgroupMemoryMask |
+                                     spv::MemorySemanticsAcquireReleaseMask));
+        cond = ir_->make_value(spv::OpIEqual, ir_->bool_type(),
+                               ir_->get_local_invocation_id(0),
+                               ir_->const_i32_zero_);
+      } else {
+        cond = ir_->make_value(spv::OpIEqual, ir_->bool_type(),
+                               ir_->get_subgroup_invocation_id(),
+                               ir_->const_i32_zero_);
+      }
 
       then_label = ir_->new_label();
       merge_label = ir_->new_label();
@@ -1466,9 +1923,17 @@ class TaskCodegen : public IRVisitor {
                      spv::SelectionControlMaskNone);
       ir_->make_inst(spv::OpBranchConditional, cond, then_label, merge_label);
       ir_->start_label(then_label);
+
+      if (use_workgroup_reduction) {
+        data = reduce_subgroup_results(subgroup_results, stmt->op_type, dt);
+        val = data;
+      }
     }
 
     spirv::Value addr_ptr;
+    // Workgroup memory has no native float atomics here, and is only viewed
+    // as words.
+    const bool is_bls = stmt->dest->is<BlockLocalPtrStmt>();
 
     if (dt->is_primitive(PrimitiveTypeID::f64)) {
       if (caps_->get(DeviceCapability::spirv_has_atomic_float64_add) &&
@@ -1478,7 +1943,8 @@ class TaskCodegen : public IRVisitor {
         addr_ptr = at_buffer(stmt->dest, ir_->get_taichi_uint_type(dt));
       }
     } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
-      if (caps_->get(DeviceCapability::spirv_has_atomic_float_add) &&
+      if (!is_bls &&
+          caps_->get(DeviceCapability::spirv_has_atomic_float_add) &&
           stmt->op_type == AtomicOpType::add) {
         addr_ptr = at_buffer(stmt->dest, dt);
       } else {
@@ -1504,7 +1970,8 @@ class TaskCodegen : public IRVisitor {
           use_native_atomics = true;
         }
       } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
-        if (caps_->get(DeviceCapability::spirv_has_atomic_float_add) &&
+        if (!is_bls &&
+            caps_->get(DeviceCapability::spirv_has_atomic_float_add) &&
             stmt->op_type == AtomicOpType::add) {
           use_native_atomics = true;
         }
@@ -1544,9 +2011,10 @@ class TaskCodegen : public IRVisitor {
       }
 
       auto uint_type = ir_->get_primitive_uint_type(dt);
+      const auto atomic_type = is_bls ? uint_type : ret_type;
 
-      if (data.stype.id != addr_ptr.stype.element_type_id) {
-        data = ir_->make_value(spv::OpBitcast, ret_type, data);
+      if (data.stype.id != atomic_type.id) {
+        data = ir_->make_value(spv::OpBitcast, atomic_type, data);
       }
 
       // Semantics = (UniformMemory 0x40) | (AcquireRelease 0x8)
@@ -1555,7 +2023,7 @@ class TaskCodegen : public IRVisitor {
           ir_->uint_immediate_number(
               ir_->u32_type(), spv::MemorySemanticsAcquireReleaseMask |
                                    spv::MemorySemanticsUniformMemoryMask));
-      val = ir_->make_value(op, ret_type, addr_ptr,
+      val = ir_->make_value(op, atomic_type, addr_ptr,
                             /*scope=*/ir_->const_i32_one_,
                             /*semantics=*/ir_->const_i32_zero_, data);
 
@@ -1718,7 +2186,8 @@ class TaskCodegen : public IRVisitor {
       TI_ASSERT(stmt->scope != nullptr);
       if (auto *offl = stmt->scope->cast<OffloadedStmt>(); offl) {
         TI_ASSERT(offl->task_type == OffloadedStmt::TaskType::range_for ||
-                  offl->task_type == OffloadedStmt::TaskType::struct_for);
+                  offl->task_type == OffloadedStmt::TaskType::struct_for ||
+                  offl->task_type == OffloadedStmt::TaskType::mesh_for);
         return true;
       }
       return false;
@@ -1797,6 +2266,7 @@ class TaskCodegen : public IRVisitor {
     ir_->make_inst(spv::OpFunctionEnd);  // } Close kernel
 
     task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
     task_attribs_.texture_binds = get_texture_binds();
   }
 
@@ -1809,6 +2279,57 @@ class TaskCodegen : public IRVisitor {
     stmt->accept(this);
   }
 
+  // Returns {begin, total number of elements} of a range-for whose bounds
+  // are only known when the task runs.
+  std::pair<spirv::Value, spirv::Value> gen_dynamic_range(
+      OffloadedStmt *stmt) {
+    spirv::Value begin_expr_value;
+    spirv::Value end_expr_value;
+    if (stmt->end_stmt) {
+      // Range from args
+      TI_ASSERT(stmt->const_begin);
+      begin_expr_value = ir_->int_immediate_number(ir_->i32_type(),
+                                                   stmt->begin_value, false);
+      gen_array_range(stmt->end_stmt);
+      end_expr_value = ir_->query_value(stmt->end_stmt->raw_name());
+    } else {
+      // Range from gtmp / constant
+      if (!stmt->const_begin) {
+        spirv::Value begin_idx = ir_->make_value(
+            spv::OpShiftRightArithmetic, ir_->i32_type(),
+            ir_->int_immediate_number(ir_->i32_type(), stmt->begin_offset),
+            ir_->int_immediate_number(ir_->i32_type(), 2));
+        begin_expr_value = ir_->load_variable(
+            ir_->struct_array_access(
+                ir_->i32_type(),
+                get_buffer_value(BufferType::GlobalTmps, PrimitiveType::i32,
+                                 /*is_write=*/false),
+                begin_idx),
+            ir_->i32_type());
+      } else {
+        begin_expr_value = ir_->int_immediate_number(
+            ir_->i32_type(), stmt->begin_value, false);  // Named Constant
+      }
+      if (!stmt->const_end) {
+        spirv::Value end_idx = ir_->make_value(
+            spv::OpShiftRightArithmetic, ir_->i32_type(),
+            ir_->int_immediate_number(ir_->i32_type(), stmt->end_offset),
+            ir_->int_immediate_number(ir_->i32_type(), 2));
+        end_expr_value = ir_->load_variable(
+            ir_->struct_array_access(
+                ir_->i32_type(),
+                get_buffer_value(BufferType::GlobalTmps, PrimitiveType::i32,
+                                 /*is_write=*/false),
+                end_idx),
+            ir_->i32_type());
+      } else {
+        end_expr_value =
+            ir_->int_immediate_number(ir_->i32_type(), stmt->end_value, true);
+      }
+    }
+    return {begin_expr_value, ir_->sub(end_expr_value, begin_expr_value)};
+  }
+
   void generate_range_for_kernel(OffloadedStmt *stmt) {
     task_attribs_.name = task_name_;
     task_attribs_.task_type = OffloadedTaskType::range_for;
@@ -1834,48 +2355,7 @@ class TaskCodegen : public IRVisitor {
                                               false);  // Named Constant
       task_attribs_.advisory_total_num_threads = num_elems;
     } else {
-      spirv::Value end_expr_value;
-      if (stmt->end_stmt) {
-        // Range from args
-        TI_ASSERT(stmt->const_begin);
-        begin_expr_value = ir_->int_immediate_number(ir_->i32_type(),
-                                                     stmt->begin_value, false);
-        gen_array_range(stmt->end_stmt);
-        end_expr_value = ir_->query_value(stmt->end_stmt->raw_name());
-      } else {
-        // Range from gtmp / constant
-        if (!stmt->const_begin) {
-          spirv::Value begin_idx = ir_->make_value(
-              spv::OpShiftRightArithmetic, ir_->i32_type(),
-              ir_->int_immediate_number(ir_->i32_type(), stmt->begin_offset),
-              ir_->int_immediate_number(ir_->i32_type(), 2));
-          begin_expr_value = ir_->load_variable(
-              ir_->struct_array_access(
-                  ir_->i32_type(),
-                  get_buffer_value(BufferType::GlobalTmps, PrimitiveType::i32),
-                  begin_idx),
-              ir_->i32_type());
-        } else {
-          begin_expr_value = ir_->int_immediate_number(
-              ir_->i32_type(), stmt->begin_value, false);  // Named Constant
-        }
-        if (!stmt->const_end) {
-          spirv::Value end_idx = ir_->make_value(
-              spv::OpShiftRightArithmetic, ir_->i32_type(),
-              ir_->int_immediate_number(ir_->i32_type(), stmt->end_offset),
-              ir_->int_immediate_number(ir_->i32_type(), 2));
-          end_expr_value = ir_->load_variable(
-              ir_->struct_array_access(
-                  ir_->i32_type(),
-                  get_buffer_value(BufferType::GlobalTmps, PrimitiveType::i32),
-                  end_idx),
-              ir_->i32_type());
-        } else {
-          end_expr_value =
-              ir_->int_immediate_number(ir_->i32_type(), stmt->end_value, true);
-        }
-      }
-      total_elems = ir_->sub(end_expr_value, begin_expr_value);
+      std::tie(begin_expr_value, total_elems) = gen_dynamic_range(stmt);
       task_attribs_.advisory_total_num_threads = kMaxNumThreadsGridStrideLoop;
     }
     task_attribs_.advisory_num_threads_per_group = stmt->block_dim;
@@ -1911,6 +2391,10 @@ class TaskCodegen : public IRVisitor {
 
     ir_->debug_name(spv::OpName, total_invocs, total_invocs_name);
 
+    if (stmt->tls_prologue) {
+      stmt->tls_prologue->accept(this);
+    }
+
     // Must get init label after making value(to make sure they are correct)
     spirv::Label init_label = ir_->current_label();
     spirv::Label head_label = ir_->new_label();
@@ -1948,10 +2432,16 @@ class TaskCodegen : public IRVisitor {
     // loop merge
     ir_->start_label(merge_label);
 
+    // Every invocation gets here, so the epilogue is in uniform control flow.
+    if (stmt->tls_epilogue) {
+      stmt->tls_epilogue->accept(this);
+    }
+
     ir_->make_inst(spv::OpReturn);
     ir_->make_inst(spv::OpFunctionEnd);
 
     task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
     task_attribs_.texture_binds = get_texture_binds();
   }
 
@@ -2001,117 +2491,169 @@ class TaskCodegen : public IRVisitor {
 
     ir_->start_function(kernel_function_);
 
-    if (snode->type == SNodeType::bitmasked) {
-      task_attribs_.advisory_total_num_threads = total_num_cells;
-      int num_cells = snode->num_cells_per_container;
-
-      TI_INFO("ListGen {} * {}", total_num_cells / num_cells, num_cells);
-
-      auto listgen_buffer =
-          get_buffer_value(BufferInfo(BufferType::ListGen), PrimitiveType::i32);
-      auto invoc_index = ir_->get_global_invocation_id(0);
-
-      auto container_ptr = make_pointer(0);
-      std::vector<spirv::Value> linear_indices(snode_path.size());
-      for (int i = snode_path.size() - 1; i >= 0; i--) {
-        // Offset the ptr to the cell on layer up
-        SNode *this_snode = snode_path[i];
-        const auto &this_snode_desc = snode_descs.at(this_snode->id);
-
-        auto snode_linear_index =
-            ir_->uint_immediate_number(ir_->u32_type(), 0);
-        if (this_snode->num_active_indices) {
-          for (int idx = 0; idx < taichi_max_num_indices; idx++) {
-            if (this_snode->extractors[idx].active) {
-              auto axis_local_index = ir_->make_value(
-                  spv::OpShiftRightLogical, ir_->u32_type(), invoc_index,
-                  ir_->uint_immediate_number(
-                      ir_->u32_type(), sn_desc.axis_start_bit[idx] +
-                                           snode_path_index_start_bit[i][idx]));
-              axis_local_index = ir_->make_value(
-                  spv::OpBitwiseAnd, ir_->u32_type(), axis_local_index,
-                  ir_->uint_immediate_number(
-                      ir_->u32_type(),
-                      (1 << this_snode->extractors[idx].num_bits) - 1));
-              snode_linear_index = ir_->make_value(
-                  spv::OpBitwiseOr, ir_->u32_type(),
-                  ir_->make_value(spv::OpShiftLeftLogical, ir_->u32_type(),
-                                  snode_linear_index,
-                                  ir_->uint_immediate_number(
-                                      ir_->u32_type(),
-                                      this_snode->extractors[idx].num_bits)),
-                  axis_local_index);
-            }
-          }
-        }
+    // Each invocation checks a cell of |snode|, and the bits of its index
+    // hold the local index at every level of the path.
+    int num_index_bits = 0;
+    for (int i = 0; i < taichi_max_num_indices; i++) {
+      num_index_bits += sn_desc.axis_bits_sum[i];
+    }
+    task_attribs_.advisory_total_num_threads = 1 << num_index_bits;
+    TI_TRACE("ListGen {} cells", total_num_cells);
 
-        if (i > 0) {
-          const auto &next_snode_desc = snode_descs.at(snode_path[i - 1]->id);
-          if (this_snode->num_active_indices) {
-            container_ptr = ir_->add(
-                container_ptr,
-                ir_->mul(snode_linear_index,
-                         ir_->uint_immediate_number(
-                             ir_->u32_type(), this_snode_desc.cell_stride)));
-          } else {
-            container_ptr = ir_->add(
-                container_ptr,
-                make_pointer(next_snode_desc.mem_offset_in_parent_cell));
-          }
+    auto listgen_buffer =
+        get_buffer_value(BufferInfo(BufferType::ListGen), PrimitiveType::i32);
+    auto invoc_index = ir_->get_global_invocation_id(0);
+
+    auto container_ptr = make_pointer(0);
+    spirv::Value index_is_active = ir_->make_value(
+        spv::OpULessThan, ir_->bool_type(), invoc_index,
+        u32_immediate(task_attribs_.advisory_total_num_threads));
+    for (int i = snode_path.size() - 1; i >= 0; i--) {
+      SNode *this_snode = snode_path[i];
+      const auto &this_snode_desc = snode_descs.at(this_snode->id);
+
+      auto snode_linear_index = u32_immediate(0);
+      for (int idx = 0; idx < taichi_max_num_indices; idx++) {
+        const auto &extractor = this_snode->extractors[idx];
+        if (!extractor.active) {
+          continue;
         }
+        auto axis_local_index = ir_->make_value(
+            spv::OpShiftRightLogical, ir_->u32_type(), invoc_index,
+            u32_immediate(sn_desc.axis_start_bit[idx] +
+                          snode_path_index_start_bit[i][idx]));
+        axis_local_index =
+            ir_->make_value(spv::OpBitwiseAnd, ir_->u32_type(),
+                            axis_local_index,
+                            u32_immediate((1 << extractor.num_bits) - 1));
+        // The padding of non-POT shapes.
+        index_is_active = ir_->make_value(
+            spv::OpLogicalAnd, ir_->bool_type(), index_is_active,
+            ir_->lt(axis_local_index, u32_immediate(extractor.shape)));
+        snode_linear_index = ir_->add(
+            ir_->mul(snode_linear_index, u32_immediate(extractor.shape)),
+            axis_local_index);
+      }
 
-        linear_indices[i] = snode_linear_index;
+      if (this_snode->type == SNodeType::bitmasked) {
+        index_is_active = ir_->make_value(
+            spv::OpLogicalAnd, ir_->bool_type(), index_is_active,
+            bitmasked_activation(ActivationOp::query, container_ptr, root_id,
+                                 this_snode, snode_linear_index));
+      } else if (this_snode->type == SNodeType::pointer) {
+        index_is_active = ir_->make_value(
+            spv::OpLogicalAnd, ir_->bool_type(), index_is_active,
+            pointer_activation(ActivationOp::query, container_ptr, root_id,
+                               this_snode, snode_linear_index));
+      } else if (this_snode->type == SNodeType::dynamic) {
+        index_is_active = ir_->make_value(
+            spv::OpLogicalAnd, ir_->bool_type(), index_is_active,
+            ir_->lt(snode_linear_index,
+                    dynamic_length(container_ptr, root_id, this_snode)));
       }
 
-      // Check current bitmask mask within the cell
-      auto index_is_active =
-          bitmasked_activation(ActivationOp::query, container_ptr, root_id,
-                               snode, linear_indices[0]);
+      if (i > 0) {
+        // Step into the container of the next SNode in the cell. Inactive
+        // pointer cells lead to the ambient cell, which has nothing active.
+        spirv::Value cell_ptr;
+        if (this_snode->type == SNodeType::pointer) {
+          cell_ptr = pointer_lookup(container_ptr, root_id, this_snode,
+                                    snode_linear_index);
+        } else {
+          cell_ptr = ir_->add(
+              container_ptr,
+              ir_->cast(container_ptr.stype,
+                        ir_->mul(snode_linear_index,
+                                 u32_immediate(this_snode_desc.cell_stride))));
+        }
+        const auto &next_snode_desc = snode_descs.at(snode_path[i - 1]->id);
+        container_ptr = ir_->add(
+            cell_ptr, make_pointer(next_snode_desc.mem_offset_in_parent_cell));
+      }
+    }
+
+    emit_if(index_is_active, [&] {
+      auto listgen_count_ptr = ir_->struct_array_access(
+          ir_->u32_type(), listgen_buffer, ir_->const_i32_zero_);
+      auto index_count = root_atomic(spv::OpAtomicIAdd, listgen_count_ptr,
+                                     u32_immediate(1));
+      auto listgen_index_ptr = ir_->struct_array_access(
+          ir_->u32_type(), listgen_buffer,
+          ir_->add(u32_immediate(1), index_count));
+      ir_->store_variable(listgen_index_ptr, invoc_index);
+    });
 
-      auto if_then_label = ir_->new_label();
-      auto if_merge_label = ir_->new_label();
+    ir_->make_inst(spv::OpReturn);       // return;
+    ir_->make_inst(spv::OpFunctionEnd);  // } Close kernel
 
-      ir_->make_inst(spv::OpSelectionMerge, if_merge_label,
-                     spv::SelectionControlMaskNone);
-      ir_->make_inst(spv::OpBranchConditional, index_is_active, if_then_label,
-                     if_merge_label);
-      // if (is_active)
-      {
-        ir_->start_label(if_then_label);
-
-        auto listgen_count_ptr = ir_->struct_array_access(
-            ir_->u32_type(), listgen_buffer, ir_->const_i32_zero_);
-        auto index_count = ir_->make_value(
-            spv::OpAtomicIAdd, ir_->u32_type(), listgen_count_ptr,
-            /*scope=*/ir_->const_i32_one_,
-            /*semantics=*/ir_->const_i32_zero_,
-            ir_->uint_immediate_number(ir_->u32_type(), 1));
-        auto listgen_index_ptr = ir_->struct_array_access(
-            ir_->u32_type(), listgen_buffer,
-            ir_->add(ir_->uint_immediate_number(ir_->u32_type(), 1),
-                     index_count));
-        ir_->store_variable(listgen_index_ptr, invoc_index);
-        ir_->make_inst(spv::OpBranch, if_merge_label);
-      }
-      ir_->start_label(if_merge_label);
-    } else if (snode->type == SNodeType::dense) {
-      // Why??
-    } else {
-      TI_NOT_IMPLEMENTED;
+    task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
+    task_attribs_.texture_binds = get_texture_binds();
+  }
+
+  void generate_gc_kernel(OffloadedStmt *stmt) {
+    task_attribs_.name = task_name_;
+    task_attribs_.task_type = OffloadedTaskType::gc;
+    task_attribs_.advisory_total_num_threads = 1;
+    task_attribs_.advisory_num_threads_per_group = 1;
+
+    ir_->start_function(kernel_function_);
+
+    // Dynamic SNodes keep their cells in place, so only the pools of pointer
+    // SNodes need collecting.
+    auto snode = stmt->snode;
+    if (snode->type == SNodeType::pointer) {
+      const int root_id = snode_to_root_.at(snode->id);
+      const auto &desc =
+          compiled_structs_[root_id].snode_descriptors.at(snode->id);
+      emit_if(ir_->eq(ir_->get_global_invocation_id(0), u32_immediate(0)),
+              [&] {
+                auto num_free_word = root_word(
+                    root_id, u32_immediate(desc.pool_offset + 4));
+                auto num_recycled_word = root_word(
+                    root_id, u32_immediate(desc.pool_offset + 8));
+                auto num_free = ir_->cast(
+                    ir_->i32_type(),
+                    ir_->load_variable(num_free_word, ir_->u32_type()));
+                num_free = ir_->cast(
+                    ir_->u32_type(),
+                    ir_->select(ir_->gt(num_free, ir_->const_i32_zero_),
+                                num_free, ir_->const_i32_zero_));
+                auto num_recycled =
+                    ir_->load_variable(num_recycled_word, ir_->u32_type());
+                // The recycled cells are appended to the free list.
+                emit_loop(num_recycled, [&](spirv::Value k) {
+                  auto recycled = root_word(
+                      root_id,
+                      ir_->add(u32_immediate(desc.pool_recycle_list_offset()),
+                               ir_->mul(k, u32_immediate(4))));
+                  auto entry = root_word(
+                      root_id,
+                      ir_->add(u32_immediate(desc.pool_free_list_offset()),
+                               ir_->mul(ir_->add(num_free, k),
+                                        u32_immediate(4))));
+                  ir_->store_variable(
+                      entry, ir_->load_variable(recycled, ir_->u32_type()));
+                });
+                ir_->store_variable(num_free_word,
+                                    ir_->add(num_free, num_recycled));
+                ir_->store_variable(num_recycled_word, u32_immediate(0));
+              });
     }
 
     ir_->make_inst(spv::OpReturn);       // return;
     ir_->make_inst(spv::OpFunctionEnd);  // } Close kernel
 
     task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
     task_attribs_.texture_binds = get_texture_binds();
   }
 
   void generate_struct_for_kernel(OffloadedStmt *stmt) {
     task_attribs_.name = task_name_;
     task_attribs_.task_type = OffloadedTaskType::struct_for;
-    task_attribs_.advisory_total_num_threads = 65536;
-    task_attribs_.advisory_num_threads_per_group = 128;
+    task_attribs_.advisory_total_num_threads = kMaxNumThreadsStructFor;
+    task_attribs_.advisory_num_threads_per_group = kNumThreadsPerGroupStructFor;
 
     // The computation for a single work is wrapped inside a function, so that
     // we can do grid-strided loop.
@@ -2132,6 +2674,10 @@ class TaskCodegen : public IRVisitor {
     auto loop_index_var = ir_->alloca_variable(ir_->u32_type());
     ir_->store_variable(loop_index_var, invoc_index);
 
+    if (stmt->tls_prologue) {
+      stmt->tls_prologue->accept(this);
+    }
+
     ir_->make_inst(spv::OpBranch, loop_head);
     ir_->start_label(loop_head);
     // for (; index < list_size; index += gl_NumWorkGroups.x *
@@ -2167,17 +2713,241 @@ class TaskCodegen : public IRVisitor {
     }
     ir_->start_label(loop_merge);
 
+    if (stmt->tls_epilogue) {
+      stmt->tls_epilogue->accept(this);
+    }
+
+    ir_->make_inst(spv::OpReturn);       // return;
+    ir_->make_inst(spv::OpFunctionEnd);  // } Close kernel
+
+    task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
+    task_attribs_.texture_binds = get_texture_binds();
+  }
+
+  // A workgroup processes a patch at a time, its invocations striding over the
+  // elements the patch owns, as gpu_parallel_mesh_for does on CUDA:
+  //
+  // for (patch_idx = WorkGroupID.x; patch_idx < num_patches;
+  //      patch_idx += NumWorkGroups.x) {
+  //   tls_prologue(); mesh_prologue();
+  //   bls_prologue(); barrier();
+  //   for (ii = LocalInvocationID.x; ii < owned_num; ii += block_dim) body();
+  //   barrier(); bls_epilogue();
+  //   tls_epilogue(); barrier();
+  // }
+  //
+  // The patch index is uniform in the workgroup, so the barriers are in
+  // uniform control flow.
+  void generate_mesh_for_kernel(OffloadedStmt *stmt) {
+    task_attribs_.name = task_name_;
+    task_attribs_.task_type = OffloadedTaskType::mesh_for;
+    task_attribs_.advisory_num_threads_per_group = stmt->block_dim;
+    task_attribs_.advisory_total_num_threads =
+        std::min(stmt->mesh->num_patches * stmt->block_dim,
+                 kMaxNumThreadsGridStrideLoop);
+
+    ir_->start_function(kernel_function_);
+
+    if (stmt->bls_size > 0) {
+      bls_buffer_ = ir_->alloca_workgroup_array(ir_->get_array_type(
+          ir_->u32_type(), (stmt->bls_size + 3) / sizeof(uint32_t)));
+      shared_array_binds_.push_back(bls_buffer_);
+    }
+    auto workgroup_barrier = [&]() {
+      ir_->make_inst(
+          spv::OpControlBarrier,
+          ir_->int_immediate_number(ir_->i32_type(), spv::ScopeWorkgroup),
+          ir_->int_immediate_number(ir_->i32_type(), spv::ScopeWorkgroup),
+          ir_->int_immediate_number(
+              ir_->i32_type(), spv::MemorySemanticsWorkgroupMemoryMask |
+                                   spv::MemorySemanticsAcquireReleaseMask));
+    };
+
+    auto num_patches =
+        ir_->int_immediate_number(ir_->i32_type(), stmt->mesh->num_patches);
+    auto block_dim =
+        ir_->int_immediate_number(ir_->i32_type(), stmt->block_dim);
+    auto patch_var = ir_->alloca_variable(ir_->i32_type());
+    ir_->store_variable(patch_var,
+                        ir_->cast(ir_->i32_type(), ir_->get_work_group_id(0)));
+    auto thread_var = ir_->alloca_variable(ir_->i32_type());
+
+    spirv::Label patch_head = ir_->new_label();
+    spirv::Label patch_body = ir_->new_label();
+    spirv::Label patch_continue = ir_->new_label();
+    spirv::Label patch_merge = ir_->new_label();
+    ir_->make_inst(spv::OpBranch, patch_head);
+    ir_->start_label(patch_head);
+    auto patch_idx = ir_->load_variable(patch_var, ir_->i32_type());
+    ir_->make_inst(spv::OpLoopMerge, patch_merge, patch_continue,
+                   spv::LoopControlMaskNone);
+    ir_->make_inst(spv::OpBranchConditional, ir_->lt(patch_idx, num_patches),
+                   patch_body, patch_merge);
+    {
+      ir_->start_label(patch_body);
+      ir_->register_value("patch_idx", patch_idx);
+      if (stmt->tls_prologue) {
+        stmt->tls_prologue->accept(this);
+      }
+      stmt->mesh_prologue->accept(this);
+      if (stmt->bls_prologue) {
+        stmt->bls_prologue->accept(this);
+        workgroup_barrier();
+      }
+
+      auto owned_num = ir_->query_value(
+          stmt->owned_num_local.at(stmt->major_from_type)->raw_name());
+      ir_->store_variable(
+          thread_var,
+          ir_->cast(ir_->i32_type(), ir_->get_local_invocation_id(0)));
+      spirv::Label thread_head = ir_->new_label();
+      spirv::Label thread_body = ir_->new_label();
+      spirv::Label thread_continue = ir_->new_label();
+      spirv::Label thread_merge = ir_->new_label();
+      ir_->make_inst(spv::OpBranch, thread_head);
+      ir_->start_label(thread_head);
+      auto thread_idx = ir_->load_variable(thread_var, ir_->i32_type());
+      ir_->make_inst(spv::OpLoopMerge, thread_merge, thread_continue,
+                     spv::LoopControlMaskNone);
+      ir_->make_inst(spv::OpBranchConditional, ir_->lt(thread_idx, owned_num),
+                     thread_body, thread_merge);
+      {
+        ir_->start_label(thread_body);
+        push_loop_control_labels(thread_continue, thread_merge);
+        ir_->register_value("ii", thread_idx);
+        stmt->body->accept(this);
+        pop_loop_control_labels();
+        ir_->make_inst(spv::OpBranch, thread_continue);
+
+        ir_->start_label(thread_continue);
+        ir_->store_variable(thread_var, ir_->add(thread_idx, block_dim));
+        ir_->make_inst(spv::OpBranch, thread_head);
+      }
+      ir_->start_label(thread_merge);
+
+      if (stmt->bls_epilogue) {
+        workgroup_barrier();
+        stmt->bls_epilogue->accept(this);
+      }
+      if (stmt->tls_epilogue) {
+        stmt->tls_epilogue->accept(this);
+      }
+      if (bls_buffer_.id != 0) {
+        // The block local storage is reused by the next patch.
+        workgroup_barrier();
+      }
+      ir_->make_inst(spv::OpBranch, patch_continue);
+
+      ir_->start_label(patch_continue);
+      ir_->store_variable(
+          patch_var,
+          ir_->add(patch_idx,
+                   ir_->cast(ir_->i32_type(), ir_->get_num_work_groups(0))));
+      ir_->make_inst(spv::OpBranch, patch_head);
+    }
+    ir_->start_label(patch_merge);
+
+    ir_->make_inst(spv::OpReturn);
+    ir_->make_inst(spv::OpFunctionEnd);
+
+    task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
+    task_attribs_.texture_binds = get_texture_binds();
+  }
+
+  // Computes the workgroup counts of a range-for or struct-for with a dynamic
+  // number of elements, so that the task can be dispatched indirectly with
+  // just enough groups instead of the maximum.
+  void generate_dispatch_args_kernel(OffloadedStmt *stmt) {
+    task_attribs_.name = task_name_;
+    task_attribs_.task_type = OffloadedTaskType::serial;
+    task_attribs_.advisory_total_num_threads = 1;
+    task_attribs_.advisory_num_threads_per_group = 1;
+
+    ir_->start_function(kernel_function_);
+
+    spirv::Value total_elems;
+    int num_threads_per_group = 0;
+    int max_num_threads = 0;
+    if (stmt->task_type == OffloadedTaskType::range_for) {
+      total_elems = gen_dynamic_range(stmt).second;
+      num_threads_per_group = stmt->block_dim;
+      max_num_threads = kMaxNumThreadsGridStrideLoop;
+    } else {
+      TI_ASSERT(stmt->task_type == OffloadedTaskType::struct_for);
+      auto listgen_count_ptr = ir_->struct_array_access(
+          ir_->u32_type(),
+          get_buffer_value(BufferType::ListGen, PrimitiveType::u32,
+                           /*is_write=*/false),
+          ir_->const_i32_zero_);
+      total_elems = ir_->cast(
+          ir_->i32_type(),
+          ir_->load_variable(listgen_count_ptr, ir_->u32_type()));
+      num_threads_per_group = kNumThreadsPerGroupStructFor;
+      max_num_threads = kMaxNumThreadsStructFor;
+    }
+    const int max_num_groups =
+        (max_num_threads + num_threads_per_group - 1) / num_threads_per_group;
+
+    // group_x = clamp(ceil(total_elems / block_dim), 0, max_num_groups). The
+    // grid-strided loops cover the elements beyond the maximum.
+    auto zero = ir_->const_i32_zero_;
+    auto num_groups = ir_->div(
+        ir_->add(total_elems, ir_->int_immediate_number(
+                                  ir_->i32_type(), num_threads_per_group - 1)),
+        ir_->int_immediate_number(ir_->i32_type(), num_threads_per_group));
+    num_groups = ir_->select(ir_->gt(total_elems, zero), num_groups, zero);
+    auto max_groups_value =
+        ir_->int_immediate_number(ir_->i32_type(), max_num_groups);
+    num_groups = ir_->select(ir_->lt(num_groups, max_groups_value), num_groups,
+                             max_groups_value);
+    ir_->debug_name(spv::OpName, num_groups, "num_groups");
+
+    auto dispatch_args =
+        get_buffer_value(BufferType::DispatchArgs, PrimitiveType::u32);
+    const int base = dispatch_args_slot_ *
+                     int(kDispatchArgsSlotSize / sizeof(uint32_t));
+    auto one = ir_->uint_immediate_number(ir_->u32_type(), 1);
+    const spirv::Value dims[3] = {ir_->cast(ir_->u32_type(), num_groups), one,
+                                  one};
+    for (int i = 0; i < 3; ++i) {
+      ir_->store_variable(
+          ir_->struct_array_access(
+              ir_->u32_type(), dispatch_args,
+              ir_->int_immediate_number(ir_->i32_type(), base + i)),
+          dims[i]);
+    }
+
     ir_->make_inst(spv::OpReturn);       // return;
     ir_->make_inst(spv::OpFunctionEnd);  // } Close kernel
 
     task_attribs_.buffer_binds = get_buffer_binds();
+    task_attribs_.buffer_accesses = get_buffer_accesses();
     task_attribs_.texture_binds = get_texture_binds();
   }
 
-  spirv::Value at_buffer(const Stmt *ptr, DataType dt) {
+  spirv::Value at_buffer(const Stmt *ptr, DataType dt, bool is_write = true) {
     spirv::Value ptr_val = ir_->query_value(ptr->raw_name());
 
+    if (ptr->is<BlockLocalPtrStmt>()) {
+      TI_ERROR_IF(data_type_size(dt) != 4,
+                  "Block local storage of {} is not supported on SPIR-V, "
+                  "please set make_mesh_block_local=False",
+                  ptr->ret_type.ptr_removed()->to_string());
+      spirv::Value idx_val = ir_->make_value(
+          spv::OpShiftRightLogical, ptr_val.stype, ptr_val,
+          ir_->uint_immediate_number(ptr_val.stype, 2));
+      return workgroup_array_access(bls_buffer_, idx_val, PrimitiveType::u32);
+    }
+
     if (ptr_val.stype.dt == PrimitiveType::u64) {
+      // There is no binding to tell which buffer this accesses.
+      if (auto it = ptr_to_buffers_.find(ptr); it != ptr_to_buffers_.end()) {
+        record_buffer_access(it->second, is_write);
+      } else {
+        buffer_accesses_known_ = false;
+      }
       spirv::Value paddr_ptr = ir_->make_value(
           spv::OpConvertUToPtr,
           ir_->get_pointer_type(ir_->get_primitive_type(dt),
@@ -2187,7 +2957,8 @@ class TaskCodegen : public IRVisitor {
       return paddr_ptr;
     }
 
-    spirv::Value buffer = get_buffer_value(ptr_to_buffers_.at(ptr), dt);
+    spirv::Value buffer =
+        get_buffer_value(ptr_to_buffers_.at(ptr), dt, is_write);
     size_t width = ir_->get_primitive_type_size(dt);
     spirv::Value idx_val = ir_->make_value(
         spv::OpShiftRightLogical, ptr_val.stype, ptr_val,
@@ -2197,16 +2968,99 @@ class TaskCodegen : public IRVisitor {
     return ret;
   }
 
+  spirv::Value workgroup_array_access(spirv::Value array,
+                                      spirv::Value index,
+                                      DataType dt) {
+    spirv::Value ptr = ir_->make_value(
+        spv::OpAccessChain,
+        ir_->get_pointer_type(ir_->get_primitive_type(dt),
+                              spv::StorageClassWorkgroup),
+        array, index);
+    ptr.flag = ValueKind::kVariablePtr;
+    return ptr;
+  }
+
+  // Combines the reductions that the subgroups of the workgroup have stored in
+  // |results|, indexed by subgroup ID.
+  spirv::Value reduce_subgroup_results(spirv::Value results,
+                                       AtomicOpType op_type,
+                                       DataType dt) {
+    const spirv::SType stype = ir_->get_primitive_type(dt);
+    spirv::Value num_subgroups = ir_->get_num_subgroups();
+    spirv::Value one = ir_->uint_immediate_number(ir_->u32_type(), 1);
+    spirv::Value first = ir_->load_variable(
+        workgroup_array_access(results, ir_->const_i32_zero_, dt), stype);
+
+    spirv::Label init_label = ir_->current_label();
+    spirv::Label head_label = ir_->new_label();
+    spirv::Label body_label = ir_->new_label();
+    spirv::Label continue_label = ir_->new_label();
+    spirv::Label merge_label = ir_->new_label();
+    ir_->make_inst(spv::OpBranch, head_label);
+
+    ir_->start_label(head_label);
+    spirv::PhiValue index = ir_->make_phi(ir_->u32_type(), 2);
+    spirv::PhiValue acc = ir_->make_phi(stype, 2);
+    index.set_incoming(0, one, init_label);
+    acc.set_incoming(0, first, init_label);
+    spirv::Value cond = ir_->make_value(spv::OpULessThan, ir_->bool_type(),
+                                        index, num_subgroups);
+    ir_->make_inst(spv::OpLoopMerge, merge_label, continue_label,
+                   spv::LoopControlMaskNone);
+    ir_->make_inst(spv::OpBranchConditional, cond, body_label, merge_label);
+
+    ir_->start_label(body_label);
+    spirv::Value elem =
+        ir_->load_variable(workgroup_array_access(results, index, dt), stype);
+    spirv::Value next_acc;
+    if (op_type == AtomicOpType::min) {
+      next_acc = ir_->select(ir_->lt(elem, acc), elem, acc);
+    } else if (op_type == AtomicOpType::max) {
+      next_acc = ir_->select(ir_->gt(elem, acc), elem, acc);
+    } else {
+      // Subtractions have been negated into additions.
+      next_acc = ir_->add(acc, elem);
+    }
+    ir_->make_inst(spv::OpBranch, continue_label);
+
+    ir_->start_label(continue_label);
+    index.set_incoming(1, ir_->add(index, one), continue_label);
+    acc.set_incoming(1, next_acc, continue_label);
+    ir_->make_inst(spv::OpBranch, head_label);
+
+    ir_->start_label(merge_label);
+    return acc;
+  }
+
+  void make_if(spirv::Value cond, const std::function<void()> &then_body) {
+    spirv::Label then_label = ir_->new_label();
+    spirv::Label merge_label = ir_->new_label();
+    ir_->make_inst(spv::OpSelectionMerge, merge_label,
+                   spv::SelectionControlMaskNone);
+    ir_->make_inst(spv::OpBranchConditional, cond, then_label, merge_label);
+    ir_->start_label(then_label);
+    then_body();
+    ir_->make_inst(spv::OpBranch, merge_label);
+    ir_->start_label(merge_label);
+  }
+
+  // Devices with f16 arithmetic don't necessarily have 16-bit integers to
+  // move the bits of f16 values through, so those are accessed as f16.
+  bool use_f16_buffer(DataType dt) const {
+    return dt->is_primitive(PrimitiveTypeID::f16) &&
+           !caps_->get(DeviceCapability::spirv_has_int16);
+  }
+
   spirv::Value load_buffer(const Stmt *ptr, DataType dt) {
     spirv::Value ptr_val = ir_->query_value(ptr->raw_name());
 
     DataType ti_buffer_type = ir_->get_taichi_uint_type(dt);
 
-    if (ptr_val.stype.dt == PrimitiveType::u64) {
+    if (ptr_val.stype.dt == PrimitiveType::u64 || use_f16_buffer(dt)) {
       ti_buffer_type = dt;
     }
 
-    auto buf_ptr = at_buffer(ptr, ti_buffer_type);
+    auto buf_ptr = at_buffer(ptr, ti_buffer_type, /*is_write=*/false);
     auto val_bits =
         ir_->load_variable(buf_ptr, ir_->get_primitive_type(ti_buffer_type));
     auto ret = ti_buffer_type == dt
@@ -2221,7 +3075,8 @@ class TaskCodegen : public IRVisitor {
 
     DataType ti_buffer_type = ir_->get_taichi_uint_type(val.stype.dt);
 
-    if (ptr_val.stype.dt == PrimitiveType::u64) {
+    if (ptr_val.stype.dt == PrimitiveType::u64 ||
+        use_f16_buffer(val.stype.dt)) {
       ti_buffer_type = val.stype.dt;
     }
 
@@ -2234,7 +3089,11 @@ class TaskCodegen : public IRVisitor {
     ir_->store_variable(buf_ptr, val_bits);
   }
 
-  spirv::Value get_buffer_value(BufferInfo buffer, DataType dt) {
+  // Unless |is_write| is false, the task is assumed to write to |buffer|.
+  spirv::Value get_buffer_value(BufferInfo buffer,
+                                DataType dt,
+                                bool is_write = true) {
+    record_buffer_access(buffer, is_write);
     auto type = ir_->get_primitive_type(dt);
     auto key = std::make_pair(buffer, type.id);
 
@@ -2359,6 +3218,22 @@ class TaskCodegen : public IRVisitor {
     return result;
   }
 
+  void record_buffer_access(const BufferInfo &buffer, bool is_write) {
+    // The args buffer is a uniform buffer, so shaders never write to it.
+    buffer_accesses_[buffer] |= is_write && buffer.type != BufferType::Args;
+  }
+
+  std::vector<BufferAccess> get_buffer_accesses() {
+    std::vector<BufferAccess> result;
+    if (!buffer_accesses_known_) {
+      return result;
+    }
+    for (auto &[buffer, is_written] : buffer_accesses_) {
+      result.push_back(BufferAccess{buffer, is_written});
+    }
+    return result;
+  }
+
   std::vector<TextureBind> get_texture_binds() {
     return texture_binds_;
   }
@@ -2412,6 +3287,10 @@ class TaskCodegen : public IRVisitor {
       buffer_binding_map_;
   std::vector<TextureBind> texture_binds_;
   std::vector<spirv::Value> shared_array_binds_;
+  // Maps the offsets of thread local storage to their variables.
+  std::unordered_map<std::size_t, spirv::Value> tls_vars_;
+  // The block local storage of a mesh-for, as u32 words.
+  spirv::Value bls_buffer_;
   spirv::Value kernel_function_;
   spirv::Label kernel_return_label_;
   bool gen_label_{false};
@@ -2428,6 +3307,8 @@ class TaskCodegen : public IRVisitor {
   std::unordered_map<int, int> snode_to_root_;
   const KernelContextAttributes *const ctx_attribs_;  // not owned
   const std::string task_name_;
+  const int dispatch_args_slot_;
+  const bool write_dispatch_args_;
   std::vector<spirv::Label> continue_label_stack_;
   std::vector<spirv::Label> merge_label_stack_;
 
@@ -2437,6 +3318,9 @@ class TaskCodegen : public IRVisitor {
   std::unordered_map<int, GetRootStmt *>
       root_stmts_;  // maps root id to get root stmt
   std::unordered_map<const Stmt *, BufferInfo> ptr_to_buffers_;
+  // Whether each accessed buffer is written to.
+  std::unordered_map<BufferInfo, bool, BufferInfoHasher> buffer_accesses_;
+  bool buffer_accesses_known_{true};
   std::unordered_map<int, Value> argid_to_tex_value_;
 };
 }  // namespace
@@ -2463,6 +3347,21 @@ static void spriv_message_consumer(spv_message_level_t level,
 
 KernelCodegen::KernelCodegen(const Params &params)
     : params_(params), ctx_attribs_(*params.kernel, &params.caps) {
+  for (const auto &spec_arg : params.spec_constant_args) {
+    TI_ERROR_IF(spec_arg.arg_id < 0 ||
+                    spec_arg.arg_id >= ctx_attribs_.args().size(),
+                "Specialization constant {} is not an argument of {}",
+                spec_arg.name, params.kernel->name);
+    const auto &arg = ctx_attribs_.args()[spec_arg.arg_id];
+    const auto dtype = arg.dtype;
+    TI_ERROR_IF(arg.is_array || (dtype != PrimitiveTypeID::i32 &&
+                                 dtype != PrimitiveTypeID::u32 &&
+                                 dtype != PrimitiveTypeID::f32),
+                "Specialization constant {} must be a 32-bit scalar",
+                spec_arg.name);
+  }
+  ctx_attribs_.spec_constant_args = params.spec_constant_args;
+
   uint32_t spirv_version = params.caps.get(DeviceCapability::spirv_version);
 
   spv_target_env target_env;
@@ -2516,16 +3415,7 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
                         std::vector<std::vector<uint32_t>> &generated_spirv) {
   auto *root = params_.kernel->ir->as<Block>();
   auto &tasks = root->statements;
-  for (int i = 0; i < tasks.size(); ++i) {
-    TaskCodegen::Params tp;
-    tp.task_ir = tasks[i]->as<OffloadedStmt>();
-    tp.task_id_in_kernel = i;
-    tp.compiled_structs = params_.compiled_structs;
-    tp.ctx_attribs = &ctx_attribs_;
-    tp.ti_kernel_name = fmt::format("{}_{}", params_.ti_kernel_name, i);
-    tp.arch = params_.arch;
-    tp.caps = &params_.caps;
-
+  auto generate_task = [&](const TaskCodegen::Params &tp) {
     TaskCodegen cgen(tp);
     auto task_res = cgen.run();
 
@@ -2569,6 +3459,33 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
 
     kernel_attribs.tasks_attribs.push_back(std::move(task_res.task_attribs));
     generated_spirv.push_back(std::move(optimized_spv));
+  };
+
+  int num_dispatch_args_slots = 0;
+  for (int i = 0; i < tasks.size(); ++i) {
+    TaskCodegen::Params tp;
+    tp.task_ir = tasks[i]->as<OffloadedStmt>();
+    tp.task_id_in_kernel = i;
+    tp.compiled_structs = params_.compiled_structs;
+    tp.ctx_attribs = &ctx_attribs_;
+    tp.ti_kernel_name = fmt::format("{}_{}", params_.ti_kernel_name, i);
+    tp.arch = params_.arch;
+    tp.caps = &params_.caps;
+
+    // Loops over a number of elements that is only known on the device get
+    // their workgroup counts from a tiny task run right before them.
+    const auto task_type = tp.task_ir->task_type;
+    const bool dynamic_range =
+        (task_type == OffloadedTaskType::range_for &&
+         !(tp.task_ir->const_begin && tp.task_ir->const_end)) ||
+        task_type == OffloadedTaskType::struct_for;
+    if (dynamic_range && num_dispatch_args_slots < kMaxDispatchArgsSlots) {
+      tp.dispatch_args_slot = num_dispatch_args_slots++;
+      TaskCodegen::Params writer_tp = tp;
+      writer_tp.write_dispatch_args = true;
+      generate_task(writer_tp);
+    }
+    generate_task(tp);
   }
   kernel_attribs.ctx_attribs = std::move(ctx_attribs_);
   kernel_attribs.name = params_.ti_kernel_name;
@@ -2577,11 +3494,13 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
 
 void lower(const CompileConfig &config, Kernel *kernel) {
   if (!kernel->lowered()) {
-    irpass::compile_to_executable(kernel->ir.get(), config, kernel,
-                                  kernel->autodiff_mode,
-                                  /*ad_use_stack=*/false, config.print_ir,
-                                  /*lower_global_access=*/true,
-                                  /*make_thread_local=*/false);
+    // Reductions into thread local storage end in uniform control flow, where
+    // they can be combined across subgroups and workgroups.
+    irpass::compile_to_executable(
+        kernel->ir.get(), config, kernel, kernel->autodiff_mode,
+        /*ad_use_stack=*/false, config.print_ir,
+        /*lower_global_access=*/true,
+        /*make_thread_local=*/config.make_thread_local);
     kernel->set_lowered(true);
   }
 }
@@ -25,6 +25,7 @@ class KernelCodegen {
     Arch arch;
     DeviceCapabilityConfig caps;
     bool enable_spv_opt{true};
+    std::vector<SpecConstantArg> spec_constant_args;
   };
 
   explicit KernelCodegen(const Params &params);
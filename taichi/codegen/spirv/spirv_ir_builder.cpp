@@ -1,5 +1,6 @@
 #include "taichi/codegen/spirv/spirv_ir_builder.h"
 #include "taichi/rhi/dx/dx_device.h"
+#include "fp16.h"
 
 namespace taichi::lang {
 
@@ -69,16 +70,45 @@ void IRBuilder::init_header() {
   if (caps_->get(cap::spirv_has_float64)) {
     ib_.begin(spv::OpCapability).add(spv::CapabilityFloat64).commit(&header_);
   }
+  if (caps_->get(cap::spirv_has_storage_buffer_16bit_access)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityStorageBuffer16BitAccess)
+        .commit(&header_);
+  }
   if (caps_->get(cap::spirv_has_physical_storage_buffer)) {
     ib_.begin(spv::OpCapability)
         .add(spv::CapabilityPhysicalStorageBufferAddresses)
         .commit(&header_);
   }
+  if (caps_->get(cap::spirv_has_subgroup_basic)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniform)
+        .commit(&header_);
+  }
+  if (caps_->get(cap::spirv_has_subgroup_vote)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniformVote)
+        .commit(&header_);
+  }
+  if (caps_->get(cap::spirv_has_subgroup_arithmetic)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniformArithmetic)
+        .commit(&header_);
+  }
+  if (caps_->get(cap::spirv_has_subgroup_ballot)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniformBallot)
+        .commit(&header_);
+  }
 
   ib_.begin(spv::OpExtension)
       .add("SPV_KHR_storage_buffer_storage_class")
       .commit(&header_);
 
+  if (caps_->get(cap::spirv_has_storage_buffer_16bit_access)) {
+    ib_.begin(spv::OpExtension).add("SPV_KHR_16bit_storage").commit(&header_);
+  }
+
   if (caps_->get(cap::spirv_has_no_integer_wrap_decoration)) {
     ib_.begin(spv::OpExtension)
         .add("SPV_KHR_no_integer_wrap_decoration")
@@ -267,15 +297,31 @@ Value IRBuilder::float_immediate_number(const SType &dtype,
     uint64_t data = ptr[0];
     return get_const(dtype, &data, cache);
   } else if (data_type_bits(dtype.dt) == 16) {
-    float fvalue = static_cast<float>(value);
-    uint16_t *ptr = reinterpret_cast<uint16_t *>(&fvalue);
-    uint64_t data = ptr[0];
+    uint64_t data = fp16_ieee_from_fp32_value(static_cast<float>(value));
     return get_const(dtype, &data, cache);
   } else {
     TI_ERROR("Type {} not supported.", dtype.dt->to_string());
   }
 }
 
+Value IRBuilder::spec_constant(const SType &dtype, uint32_t spec_id) {
+  auto it = spec_const_tbl_.find(spec_id);
+  if (it != spec_const_tbl_.end()) {
+    TI_ASSERT(it->second.stype.id == dtype.id);
+    return it->second;
+  }
+
+  TI_ASSERT(dtype.flag == TypeKind::kPrimitive &&
+            data_type_bits(dtype.dt) == 32);
+  Value ret = new_value(dtype, ValueKind::kConstant);
+  ib_.begin(spv::OpSpecConstant)
+      .add_seq(dtype, ret, static_cast<uint32_t>(0))
+      .commit(&global_);
+  decorate(spv::OpDecorate, ret, spv::DecorationSpecId, spec_id);
+  spec_const_tbl_[spec_id] = ret;
+  return ret;
+}
+
 SType IRBuilder::get_null_type() {
   SType res;
   res.id = id_counter_++;
@@ -826,6 +872,33 @@ Value IRBuilder::sample_texture(Value texture_var,
   return res_vec4;
 }
 
+Value IRBuilder::sample_texture_grad(Value texture_var,
+                                     const std::vector<Value> &args,
+                                     const std::vector<Value> &dx,
+                                     const std::vector<Value> &dy) {
+  auto image = this->load_variable(
+      texture_var, this->get_sampled_image_type(f32_type(), args.size()));
+  auto make_vector = [&](const std::vector<Value> &comps) {
+    if (comps.size() == 1) {
+      return comps[0];
+    } else if (comps.size() == 2) {
+      return make_value(spv::OpCompositeConstruct, t_v2_fp32_, comps[0],
+                        comps[1]);
+    } else if (comps.size() == 3) {
+      return make_value(spv::OpCompositeConstruct, t_v3_fp32_, comps[0],
+                        comps[1], comps[2]);
+    }
+    TI_ERROR("Unsupported number of texture coordinates");
+  };
+  Value uv = make_vector(args);
+  Value uv_dx = make_vector(dx);
+  Value uv_dy = make_vector(dy);
+  uint32_t grad_operand = 0x4;
+  auto res_vec4 = make_value(spv::OpImageSampleExplicitLod, t_v4_fp32_, image,
+                             uv, grad_operand, uv_dx, uv_dy);
+  return res_vec4;
+}
+
 Value IRBuilder::fetch_texel(Value texture_var,
                              const std::vector<Value> &args,
                              Value lod) {
@@ -926,6 +999,24 @@ Value IRBuilder::get_num_work_groups(uint32_t dim_index) {
   return this->make_value(spv::OpLoad, t_uint32_, ptr);
 }
 
+Value IRBuilder::get_work_group_id(uint32_t dim_index) {
+  if (gl_work_group_id_.id == 0) {
+    SType ptr_type = this->get_pointer_type(t_v3_uint_, spv::StorageClassInput);
+    gl_work_group_id_ = new_value(ptr_type, ValueKind::kVectorPtr);
+    ib_.begin(spv::OpVariable)
+        .add_seq(ptr_type, gl_work_group_id_, spv::StorageClassInput)
+        .commit(&global_);
+    this->decorate(spv::OpDecorate, gl_work_group_id_, spv::DecorationBuiltIn,
+                   spv::BuiltInWorkgroupId);
+  }
+  SType pint_type = this->get_pointer_type(t_uint32_, spv::StorageClassInput);
+  Value ptr = this->make_value(
+      spv::OpAccessChain, pint_type, gl_work_group_id_,
+      uint_immediate_number(t_uint32_, static_cast<uint64_t>(dim_index)));
+
+  return this->make_value(spv::OpLoad, t_uint32_, ptr);
+}
+
 Value IRBuilder::get_local_invocation_id(uint32_t dim_index) {
   if (gl_local_invocation_id_.id == 0) {
     SType ptr_type = this->get_pointer_type(t_v3_uint_, spv::StorageClassInput);
@@ -996,6 +1087,36 @@ Value IRBuilder::get_subgroup_size() {
   return this->make_value(spv::OpLoad, t_uint32_, subgroup_size_);
 }
 
+Value IRBuilder::get_subgroup_id() {
+  if (subgroup_id_.id == 0) {
+    SType ptr_type = this->get_pointer_type(t_uint32_, spv::StorageClassInput);
+    subgroup_id_ = new_value(ptr_type, ValueKind::kVariablePtr);
+    ib_.begin(spv::OpVariable)
+        .add_seq(ptr_type, subgroup_id_, spv::StorageClassInput)
+        .commit(&global_);
+    this->decorate(spv::OpDecorate, subgroup_id_, spv::DecorationBuiltIn,
+                   spv::BuiltInSubgroupId);
+    global_values.push_back(subgroup_id_);
+  }
+
+  return this->make_value(spv::OpLoad, t_uint32_, subgroup_id_);
+}
+
+Value IRBuilder::get_num_subgroups() {
+  if (num_subgroups_.id == 0) {
+    SType ptr_type = this->get_pointer_type(t_uint32_, spv::StorageClassInput);
+    num_subgroups_ = new_value(ptr_type, ValueKind::kVariablePtr);
+    ib_.begin(spv::OpVariable)
+        .add_seq(ptr_type, num_subgroups_, spv::StorageClassInput)
+        .commit(&global_);
+    this->decorate(spv::OpDecorate, num_subgroups_, spv::DecorationBuiltIn,
+                   spv::BuiltInNumSubgroups);
+    global_values.push_back(num_subgroups_);
+  }
+
+  return this->make_value(spv::OpLoad, t_uint32_, num_subgroups_);
+}
+
 #define DEFINE_BUILDER_BINARY_USIGN_OP(_OpName, _Op)   \
   Value IRBuilder::_OpName(Value a, Value b) {         \
     TI_ASSERT(a.stype.id == b.stype.id);               \
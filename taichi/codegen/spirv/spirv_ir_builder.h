@@ -305,6 +305,8 @@ class IRBuilder {
   Value float_immediate_number(const SType &dtype,
                                double value,
                                bool cache = true);
+  // Create a 32-bit scalar specialization constant, which defaults to 0
+  Value spec_constant(const SType &dtype, uint32_t spec_id);
 
   // Match zero type
   Value get_zero(const SType &stype) {
@@ -381,6 +383,13 @@ class IRBuilder {
                        const std::vector<Value> &args,
                        Value lod);
 
+  // Samples with explicit derivatives of the coordinates, from which the LOD
+  // and the anisotropy of the filter are derived.
+  Value sample_texture_grad(Value texture_var,
+                            const std::vector<Value> &args,
+                            const std::vector<Value> &dx,
+                            const std::vector<Value> &dy);
+
   Value fetch_texel(Value texture_var,
                     const std::vector<Value> &args,
                     Value lod);
@@ -418,6 +427,12 @@ class IRBuilder {
     if (gl_num_work_groups_.id != 0) {
       ib_.add(gl_num_work_groups_);
     }
+    if (gl_local_invocation_id_.id != 0) {
+      ib_.add(gl_local_invocation_id_);
+    }
+    if (gl_work_group_id_.id != 0) {
+      ib_.add(gl_work_group_id_);
+    }
     ib_.commit(&entry_);
     ib_.begin(spv::OpExecutionMode)
         .add_seq(func, spv::ExecutionModeLocalSize, local_size[0],
@@ -441,10 +456,13 @@ class IRBuilder {
   void set_work_group_size(const std::array<int, 3> group_size);
   Value get_work_group_size(uint32_t dim_index);
   Value get_num_work_groups(uint32_t dim_index);
+  Value get_work_group_id(uint32_t dim_index);
   Value get_local_invocation_id(uint32_t dim_index);
   Value get_global_invocation_id(uint32_t dim_index);
   Value get_subgroup_invocation_id();
   Value get_subgroup_size();
+  Value get_subgroup_id();
+  Value get_num_subgroups();
 
   // Expressions
   Value add(Value a, Value b);
@@ -606,9 +624,12 @@ class IRBuilder {
   Value gl_global_invocation_id_;
   Value gl_local_invocation_id_;
   Value gl_num_work_groups_;
+  Value gl_work_group_id_;
   Value gl_work_group_size_;
   Value subgroup_local_invocation_id_;
   Value subgroup_size_;
+  Value subgroup_id_;
+  Value num_subgroups_;
 
   // Random function and variables
   bool init_rand_{false};
@@ -627,6 +648,7 @@ class IRBuilder {
 
   // map from constant int to its value
   std::map<std::pair<uint32_t, uint64_t>, Value> const_tbl_;
+  std::unordered_map<uint32_t, Value> spec_const_tbl_;
   // map from raw_name(string) to Value
   std::unordered_map<std::string, Value> value_name_tbl_;
 
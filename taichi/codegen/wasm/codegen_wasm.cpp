@@ -17,6 +17,9 @@ namespace {
 constexpr std::array<const char *, 5> kPreloadedFuncNames = {
     "wasm_materialize", "wasm_set_kernel_parameter_i32",
     "wasm_set_kernel_parameter_f32", "wasm_set_print_buffer", "wasm_print"};
+
+// Lanes of 32-bit elements in a WASM SIMD128 vector.
+constexpr int kSimd128Lanes = 4;
 }
 
 class TaskCodeGenWASM : public TaskCodeGenLLVM {
@@ -88,7 +91,12 @@ class TaskCodeGenWASM : public TaskCodeGenLLVM {
       } else {
         create_increment(loop_var, tlctx->get_constant(-1));
       }
-      builder->CreateBr(loop_test);
+      // The module is optimized for the host but runs on WASM, so the width
+      // of the host's vectors would not fit SIMD128.
+      const int width = compile_config->cpu_vectorize_width > 0
+                            ? compile_config->cpu_vectorize_width
+                            : kSimd128Lanes;
+      set_loop_vectorize_hints(builder->CreateBr(loop_test), width);
     }
 
     // next cfg
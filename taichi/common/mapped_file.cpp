@@ -0,0 +1,77 @@
+#include "taichi/common/mapped_file.h"
+
+#if defined(TI_PLATFORM_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include "taichi/platform/windows/windows.h"
+#endif
+
+namespace taichi {
+namespace io {
+
+std::unique_ptr<MappedFile> MappedFile::create(const std::string &path) {
+  std::unique_ptr<MappedFile> out(new MappedFile);
+#if defined(TI_PLATFORM_UNIX)
+  out->fd_ = ::open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if (out->fd_ < 0 || fstat(out->fd_, &st) != 0 || st.st_size == 0) {
+    return nullptr;
+  }
+  void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, out->fd_, 0);
+  if (ptr == MAP_FAILED) {
+    return nullptr;
+  }
+  out->ptr_ = ptr;
+  out->size_ = st.st_size;
+#else
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  out->file_ = file;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    return nullptr;
+  }
+  out->mapping_ =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (out->mapping_ == nullptr) {
+    return nullptr;
+  }
+  out->ptr_ = MapViewOfFile(out->mapping_, FILE_MAP_READ, 0, 0, 0);
+  if (out->ptr_ == nullptr) {
+    return nullptr;
+  }
+  out->size_ = file_size.QuadPart;
+#endif
+  return out;
+}
+
+MappedFile::~MappedFile() {
+#if defined(TI_PLATFORM_UNIX)
+  if (ptr_ != nullptr) {
+    munmap(ptr_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#else
+  if (ptr_ != nullptr) {
+    UnmapViewOfFile(ptr_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    CloseHandle(file_);
+  }
+#endif
+}
+
+}  // namespace io
+}  // namespace taichi
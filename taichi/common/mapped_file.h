@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "taichi/common/platform_macros.h"
+
+namespace taichi {
+namespace io {
+
+// A read-only mapping of a whole file. Pages are only read in when they are
+// accessed.
+class TI_DLL_EXPORT MappedFile {
+ public:
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  // Returns nullptr if the file can't be opened or is empty.
+  static std::unique_ptr<MappedFile> create(const std::string &path);
+
+  const void *data() const {
+    return ptr_;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  MappedFile() = default;
+
+  void *ptr_{nullptr};
+  size_t size_{0};
+#if defined(TI_PLATFORM_UNIX)
+  int fd_{-1};
+#else
+  // HANDLEs, so that this header doesn't pull in windows.h.
+  void *file_{nullptr};
+  void *mapping_{nullptr};
+#endif
+};
+
+}  // namespace io
+}  // namespace taichi
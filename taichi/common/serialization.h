@@ -7,6 +7,7 @@
 
 #include <array>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -20,6 +21,7 @@
 #include <vector>
 #include "taichi/common/json.h"
 #include "taichi/common/json_serde.h"
+#include "taichi/common/mapped_file.h"
 
 #ifdef TI_INCLUDED
 namespace taichi {
@@ -285,6 +287,14 @@ class BinarySerializer : public Serializer {
   std::size_t head;
   std::size_t preserved;
 
+  // The output file in streaming mode, see initialize_streaming().
+  std::FILE *file{nullptr};
+  // The number of bytes already written to |file|, which precede |data|.
+  std::size_t flushed{0};
+
+  // The size at which |data| is written to |file| in streaming mode.
+  static constexpr std::size_t kStreamBufferBytes = 1 << 20;
+
   using Base = Serializer;
   using Base::assets;
 
@@ -330,6 +340,19 @@ class BinarySerializer : public Serializer {
     return true;
   }
 
+  // Writes the output to |file_| as it is serialized, keeping at most about
+  // kStreamBufferBytes of it in |data|. finalize() seeks back to write the
+  // length, so |file_| must be seekable.
+  template <bool writing_ = writing>
+  typename std::enable_if<writing_, bool>::type initialize_streaming(
+      std::FILE *file_) {
+    initialize();
+    file = file_;
+    flushed = 0;
+    data.reserve(kStreamBufferBytes);
+    return true;
+  }
+
   template <bool writing_ = writing>
   typename std::enable_if<!writing_, void>::type initialize(
       void *raw_data,
@@ -353,7 +376,14 @@ class BinarySerializer : public Serializer {
 
   void finalize() {
     if constexpr (writing) {
-      if (c_data) {
+      if (file) {
+        flush();
+        if (std::fseek(file, 0, SEEK_SET) != 0 ||
+            std::fwrite(&head, sizeof(head), 1, file) != 1 ||
+            std::fseek(file, 0, SEEK_END) != 0) {
+          TI_ERROR("Failed to write the serialized data");
+        }
+      } else if (c_data) {
         *reinterpret_cast<std::size_t *>(&c_data[0]) = head;
       } else {
         *reinterpret_cast<std::size_t *>(&data[0]) = head;
@@ -374,16 +404,55 @@ class BinarySerializer : public Serializer {
   }
 
  private:
-  // std::string
+  void flush() {
+    if (!data.empty() &&
+        std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+      TI_ERROR("Failed to write the serialized data");
+    }
+    flushed += data.size();
+    data.clear();
+  }
+
+  void write_bytes(const void *src, std::size_t size) {
+    if (c_data) {
+      if (head + size > preserved) {
+        TI_CRITICAL("Preserved Buffer (size {}) Overflow.", preserved);
+      }
+      std::memcpy(&c_data[head], src, size);
+    } else if (file && size >= kStreamBufferBytes) {
+      // Large blobs skip the buffer.
+      flush();
+      if (std::fwrite(src, 1, size, file) != size) {
+        TI_ERROR("Failed to write the serialized data");
+      }
+      flushed += size;
+    } else {
+      const std::size_t offset = head - flushed;
+      data.resize(offset + size);
+      std::memcpy(data.data() + offset, src, size);
+      if (file && data.size() >= kStreamBufferBytes) {
+        flush();
+      }
+    }
+    head += size;
+  }
+
+  void read_bytes(void *dst, std::size_t size) {
+    std::memcpy(dst, &c_data[head], size);
+    head += size;
+  }
+
+  // std::string, stored like a std::vector<char>
   void process(const std::string &val_) {
     auto &val = get_writable(val_);
-    if (writing) {
-      std::vector<char> val_vector(val.begin(), val.end());
-      this->process(val_vector);
+    if constexpr (writing) {
+      this->process(val.size());
+      write_bytes(val.data(), val.size());
     } else {
-      std::vector<char> val_vector;
-      this->process(val_vector);
-      val = std::string(val_vector.begin(), val_vector.end());
+      std::size_t n = 0;
+      this->process(n);
+      val.resize(n);
+      read_bytes(val.data(), n);
     }
   }
 
@@ -418,27 +487,10 @@ class BinarySerializer : public Serializer {
     static_assert(!std::is_volatile<T>::value, "T cannot be volatile");
     static_assert(!std::is_pointer<T>::value, "T cannot be pointer");
     if (writing) {
-      std::size_t new_size = head + sizeof(T);
-      if (c_data) {
-        if (new_size > preserved) {
-          TI_CRITICAL("Preserved Buffer (size {}) Overflow.", preserved);
-        }
-        //*reinterpret_cast<typename type::remove_cvref_t<T> *>(&c_data[head]) =
-        //    val;
-        std::memcpy(&c_data[head], &val, sizeof(T));
-      } else {
-        data.resize(new_size);
-        //*reinterpret_cast<typename type::remove_cvref_t<T> *>(&data[head]) =
-        //    val;
-        std::memcpy(&data[head], &val, sizeof(T));
-      }
+      write_bytes(&val, sizeof(T));
     } else {
-      // get_writable(val) =
-      //    *reinterpret_cast<typename std::remove_reference<T>::type *>(
-      //        &c_data[head]);
-      std::memcpy(&get_writable(val), &c_data[head], sizeof(T));
+      read_bytes(&get_writable(val), sizeof(T));
     }
-    head += sizeof(T);
   }
 
   template <typename T>
@@ -549,8 +601,18 @@ class BinarySerializer : public Serializer {
       this->process(n);
       val.resize(n);
     }
-    for (std::size_t i = 0; i < val.size(); i++) {
-      this->process(val[i]);
+    // Vectors of elementary types, e.g. SPIR-V code, are copied in one piece.
+    // The layout is the same as element by element.
+    if constexpr (is_elementary_type_v<T> && !std::is_same_v<T, bool>) {
+      if (writing) {
+        write_bytes(val.data(), val.size() * sizeof(T));
+      } else {
+        read_bytes(val.data(), val.size() * sizeof(T));
+      }
+    } else {
+      for (std::size_t i = 0; i < val.size(); i++) {
+        this->process(val[i]);
+      }
     }
   }
 
@@ -891,6 +953,9 @@ bool read_from_binary(T &t,
                       const void *bin,
                       std::size_t len,
                       bool match_all = true) {
+  if (len < sizeof(std::size_t)) {
+    return false;
+  }
   BinaryInputSerializer reader;
   reader.initialize(const_cast<void *>(bin));
   if (len != reader.retrieve_length()) {
@@ -901,24 +966,48 @@ bool read_from_binary(T &t,
   return match_all ? head == len : head <= len;
 }
 
+// Uncompressed files are mapped and deserialized in place, instead of being
+// read into a buffer first.
 template <typename T>
 bool read_from_binary_file(T &t, const std::string &file_name) {
-  BinaryInputSerializer reader;
-  if (!reader.initialize(file_name)) {
+  if (ends_with(file_name, ".zip")) {
+    BinaryInputSerializer reader;
+    if (!reader.initialize(file_name)) {
+      return false;
+    }
+    reader(t);
+    reader.finalize();
+    return true;
+  }
+  auto file = taichi::io::MappedFile::create(file_name);
+  if (file == nullptr) {
+    TI_DEBUG("Cannot open file: {}", file_name);
     return false;
   }
-  reader(t);
-  reader.finalize();
-  return true;
+  return read_from_binary(t, file->data(), file->size());
 }
 
+// Uncompressed files are written as they are serialized, instead of from a
+// copy of the whole output in memory.
 template <typename T>
 void write_to_binary_file(const T &t, const std::string &file_name) {
   BinaryOutputSerializer writer;
-  writer.initialize();
+  if (ends_with(file_name, ".zip")) {
+    writer.initialize();
+    writer(t);
+    writer.finalize();
+    writer.write_to_file(file_name);
+    return;
+  }
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(
+      std::fopen(file_name.c_str(), "wb"), &std::fclose);
+  if (file == nullptr) {
+    TI_ERROR("Cannot open file [{}] for writing. (Does the directory exist?)",
+             file_name);
+  }
+  writer.initialize_streaming(file.get());
   writer(t);
   writer.finalize();
-  writer.write_to_file(file_name);
 }
 
 // Compile-Time Tests
@@ -1,4 +1,5 @@
 #include "taichi/common/virtual_dir.h"
+#include "taichi/common/mapped_file.h"
 #include "taichi/common/zip.h"
 
 namespace taichi {
@@ -96,6 +97,36 @@ struct ZipArchiveVirtualDir : public VirtualDir {
   }
 };
 
+// A Zip archive mapped from the filesystem. Only the files being loaded are
+// paged in and extracted, which keeps opening a large module cheap.
+struct MappedZipArchiveVirtualDir : public VirtualDir {
+  std::unique_ptr<MappedFile> file_;
+  zip::ZipArchiveView archive_;
+
+  static std::unique_ptr<VirtualDir> create(const std::string &archive_path) {
+    auto file = MappedFile::create(archive_path);
+    if (file == nullptr) {
+      return nullptr;
+    }
+    auto out = std::make_unique<MappedZipArchiveVirtualDir>();
+    if (!zip::ZipArchiveView::try_from_bytes(file->data(), file->size(),
+                                             out->archive_)) {
+      return nullptr;
+    }
+    out->file_ = std::move(file);
+    return out;
+  }
+
+  bool get_file_size(const std::string &path, size_t &size) const override {
+    return archive_.get_file_size(path, size);
+  }
+  size_t load_file(const std::string &path,
+                   void *data,
+                   size_t size) const override {
+    return archive_.extract_file(path, data, size);
+  }
+};
+
 inline bool is_zip_file(const std::string &path) {
   std::fstream f(path, std::ios::in | std::ios::binary);
   if (!f.is_open()) {
@@ -115,7 +146,11 @@ inline bool is_zip_file(const std::string &path) {
 
 std::unique_ptr<VirtualDir> VirtualDir::open(const std::string &path) {
   if (is_zip_file(path)) {
-    return ZipArchiveVirtualDir::create(path);
+    auto out = MappedZipArchiveVirtualDir::create(path);
+    if (out == nullptr) {
+      out = ZipArchiveVirtualDir::create(path);
+    }
+    return out;
   } else {
     // (penguinliong) I wanted to use `std::filesyste::is_directory`. But it
     // seems `<filesystem>` is only supported in MSVC.
@@ -10,7 +10,8 @@ struct TI_DLL_EXPORT VirtualDir {
   }
 
   // Open a virtual directory based on what `path` points to. Zip files and
-  // filesystem directories are supported.
+  // filesystem directories are supported. Zip files are mapped into memory
+  // and their files are only extracted when loaded.
   static std::unique_ptr<VirtualDir> open(const std::string &path);
   static std::unique_ptr<VirtualDir> from_zip(const void *data, size_t size);
   static std::unique_ptr<VirtualDir> from_fs_dir(const std::string &base_dir);
@@ -1,6 +1,8 @@
 #include "taichi/common/zip.h"
 #include "taichi/common/miniz.h"
 
+#include <mutex>
+
 namespace taichi {
 namespace zip {
 
@@ -43,5 +45,86 @@ fail:
   return succ;
 }
 
+struct ZipArchiveView::Impl {
+  // miniz keeps the last error of an archive, so the reads are serialized.
+  mutable std::mutex mut;
+  mutable mz_zip_archive zip;
+
+  Impl() {
+    mz_zip_zero_struct(&zip);
+  }
+  ~Impl() {
+    mz_zip_reader_end(&zip);
+  }
+
+  bool locate_file(const std::string &path,
+                   int &i,
+                   mz_zip_archive_file_stat &file_stat) const {
+    i = mz_zip_reader_locate_file(&zip, path.c_str(), nullptr, 0);
+    return i >= 0 && mz_zip_reader_file_stat(&zip, i, &file_stat) == MZ_TRUE;
+  }
+};
+
+ZipArchiveView::ZipArchiveView() = default;
+ZipArchiveView::ZipArchiveView(ZipArchiveView &&) = default;
+ZipArchiveView::~ZipArchiveView() = default;
+ZipArchiveView &ZipArchiveView::operator=(ZipArchiveView &&) = default;
+
+bool ZipArchiveView::try_from_bytes(const void *data,
+                                    size_t size,
+                                    ZipArchiveView &ar) {
+  auto impl = std::make_unique<Impl>();
+  if (mz_zip_reader_init_mem(&impl->zip, data, size, 0) != MZ_TRUE) {
+    return false;
+  }
+  ar.impl_ = std::move(impl);
+  return true;
+}
+
+bool ZipArchiveView::get_file_size(const std::string &path,
+                                   size_t &size) const {
+  if (impl_ == nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> _(impl_->mut);
+  int i = 0;
+  mz_zip_archive_file_stat file_stat;
+  if (!impl_->locate_file(path, i, file_stat)) {
+    return false;
+  }
+  size = file_stat.m_uncomp_size;
+  return true;
+}
+
+size_t ZipArchiveView::extract_file(const std::string &path,
+                                    void *data,
+                                    size_t size) const {
+  if (impl_ == nullptr) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> _(impl_->mut);
+  int i = 0;
+  mz_zip_archive_file_stat file_stat;
+  if (!impl_->locate_file(path, i, file_stat)) {
+    return 0;
+  }
+  if (size >= file_stat.m_uncomp_size) {
+    size = file_stat.m_uncomp_size;
+    if (mz_zip_reader_extract_to_mem(&impl_->zip, i, data, size, 0) !=
+        MZ_TRUE) {
+      return 0;
+    }
+    return size;
+  }
+  // miniz doesn't extract a prefix of deflated files.
+  std::vector<uint8_t> file_data(file_stat.m_uncomp_size);
+  if (mz_zip_reader_extract_to_mem(&impl_->zip, i, file_data.data(),
+                                   file_data.size(), 0) != MZ_TRUE) {
+    return 0;
+  }
+  std::memcpy(data, file_data.data(), size);
+  return size;
+}
+
 }  // namespace zip
 }  // namespace taichi
@@ -20,5 +20,35 @@ struct ZipArchive {
   static bool try_from_bytes(const void *data, size_t size, ZipArchive &ar);
 };
 
+// A Zip archive read in place from memory owned by the caller, e.g. a mapped
+// file. Nothing is extracted until asked for, and stored (uncompressed) files
+// are copied straight out of the archive.
+struct ZipArchiveView {
+  ZipArchiveView();
+  ZipArchiveView(const ZipArchiveView &) = delete;
+  ZipArchiveView(ZipArchiveView &&);
+  ~ZipArchiveView();
+
+  ZipArchiveView &operator=(const ZipArchiveView &) = delete;
+  ZipArchiveView &operator=(ZipArchiveView &&);
+
+  // Parse the directory of a serialized Zip archive. `data` must outlive the
+  // view. Returns true if success.
+  static bool try_from_bytes(const void *data,
+                             size_t size,
+                             ZipArchiveView &ar);
+
+  // Get the uncompressed `size` of the file at `path`. Returns false when the
+  // file doesn't exist.
+  bool get_file_size(const std::string &path, size_t &size) const;
+  // Extract the first `size` bytes of the file at `path`. Returns the number
+  // of bytes extracted, 0 if the file doesn't exist. Thread-safe.
+  size_t extract_file(const std::string &path, void *data, size_t size) const;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
 }  // namespace zip
 }  // namespace taichi
@@ -10,6 +10,8 @@ constexpr int taichi_max_num_args = 8;
 constexpr int taichi_max_num_args_total = 64;
 constexpr int taichi_max_num_args_extra = 32;
 constexpr int taichi_max_num_snodes = 1024;
+// length of the chunk directory of a dynamic SNode
+constexpr int taichi_max_num_dynamic_chunks = 64;
 constexpr int kMaxNumSnodeTreesLlvm = 512;
 constexpr int taichi_max_gpu_block_dim = 1024;
 constexpr std::size_t taichi_global_tmp_buffer_size = 1024 * 1024;
@@ -24,6 +26,8 @@ constexpr std::size_t taichi_result_buffer_ret_value_id = 0;
 // slot for error code and error message char *
 constexpr std::size_t taichi_result_buffer_error_id = 30;
 constexpr std::size_t taichi_result_buffer_runtime_query_id = 31;
+// slots taken by runtime_get_snode_memory_stats, from the return value slot
+constexpr int taichi_snode_memory_stats_entries = 10;
 
 constexpr int taichi_listgen_max_element_size = 1024;
 
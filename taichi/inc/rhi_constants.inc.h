@@ -32,6 +32,14 @@ PER_DEVICE_CAPABILITY(spirv_has_subgroup_arithmetic)
 PER_DEVICE_CAPABILITY(spirv_has_subgroup_ballot)
 PER_DEVICE_CAPABILITY(spirv_has_non_semantic_info)
 PER_DEVICE_CAPABILITY(spirv_has_no_integer_wrap_decoration)
+// Ray queries against acceleration structures (SPV_KHR_ray_query)
+PER_DEVICE_CAPABILITY(spirv_has_ray_query)
+// 16-bit loads and stores in storage buffers (SPV_KHR_16bit_storage)
+PER_DEVICE_CAPABILITY(spirv_has_storage_buffer_16bit_access)
+// Memory Caps
+// Device-local memory is also host-visible and coherent, so the host can access
+// device allocations without staging.
+PER_DEVICE_CAPABILITY(unified_memory)
 #endif
 
 #ifdef PER_BUFFER_FORMAT
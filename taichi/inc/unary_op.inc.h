@@ -20,4 +20,5 @@ PER_UNARY_OP(log)
 PER_UNARY_OP(rsqrt)
 PER_UNARY_OP(bit_not)
 PER_UNARY_OP(logic_not)
+PER_UNARY_OP(popcnt)
 PER_UNARY_OP(undefined)
@@ -52,6 +52,32 @@ class DiffRange {
   }
 };
 
+// How an offloaded task accesses an SNode, relative to its loop indices.
+struct AccessFootprint {
+  // For each index of the SNode, the range of the offsets of the read indices
+  // from the loop index of the same axis, in the index space of the program
+  // (i.e. with the offsets of the fields applied). Empty if the SNode is not
+  // read. A range is unrelated if some read index isn't the loop index plus a
+  // constant, e.g. in a serial task.
+  std::vector<DiffRange> reads;
+  // Same as |reads|, for the written indices.
+  std::vector<DiffRange> writes;
+};
+
+// A static estimate of the work of an offloaded task, for roofline reports.
+// Every global load, store and atomic is counted as memory traffic, so
+// accesses that hit in caches are overestimated.
+struct TaskCost {
+  // Per loop index of range-fors, struct-fors and mesh-fors.
+  float64 flops_per_iteration{0};
+  float64 bytes_per_iteration{0};
+  // -1 if it's only known at runtime.
+  int64 num_iterations{-1};
+  // True if the body has loops whose trip counts are only known at runtime,
+  // whose bodies are counted once.
+  bool is_lower_bound{false};
+};
+
 enum AliasResult { same, uncertain, different };
 
 class ControlFlowGraph;
@@ -101,6 +127,11 @@ std::unordered_set<Stmt *> gather_immutable_local_vars(IRNode *root);
 std::unordered_set<SNode *> gather_deactivations(IRNode *root);
 std::pair<std::unordered_set<SNode *>, std::unordered_set<SNode *>>
 gather_snode_read_writes(IRNode *root);
+// Returns how each offloaded task of |root| accesses the SNodes, in task
+// order.
+std::vector<std::unordered_map<SNode *, AccessFootprint>>
+gather_access_footprints(IRNode *root);
+TaskCost estimate_task_cost(OffloadedStmt *task);
 std::vector<Stmt *> gather_statements(IRNode *root,
                                       const std::function<bool(Stmt *)> &test);
 void gather_uniquely_accessed_bit_structs(IRNode *root, AnalysisManager *amgr);
@@ -82,13 +82,13 @@ void CFGNode::replace_with(int location,
                       replace_usages);
 }
 
-bool CFGNode::contain_variable(const std::unordered_set<Stmt *> &var_set,
-                               Stmt *var) {
+template <typename StmtSet>
+bool CFGNode::contain_variable(const StmtSet &var_set, Stmt *var) {
   if (var->is<AllocaStmt>() || var->is<AdStackAllocaStmt>()) {
-    return var_set.find(var) != var_set.end();
+    return var_set.count(var) > 0;
   } else {
     // TODO: How to optimize this?
-    if (var_set.find(var) != var_set.end())
+    if (var_set.count(var) > 0)
       return true;
     return std::any_of(var_set.begin(), var_set.end(), [&](Stmt *set_var) {
       return irpass::analysis::definitely_same_address(var, set_var);
@@ -96,13 +96,13 @@ bool CFGNode::contain_variable(const std::unordered_set<Stmt *> &var_set,
   }
 }
 
-bool CFGNode::may_contain_variable(const std::unordered_set<Stmt *> &var_set,
-                                   Stmt *var) {
+template <typename StmtSet>
+bool CFGNode::may_contain_variable(const StmtSet &var_set, Stmt *var) {
   if (var->is<AllocaStmt>() || var->is<AdStackAllocaStmt>()) {
-    return var_set.find(var) != var_set.end();
+    return var_set.count(var) > 0;
   } else {
     // TODO: How to optimize this?
-    if (var_set.find(var) != var_set.end())
+    if (var_set.count(var) > 0)
       return true;
     return std::any_of(var_set.begin(), var_set.end(), [&](Stmt *set_var) {
       return irpass::analysis::maybe_same_address(var, set_var);
@@ -110,6 +110,14 @@ bool CFGNode::may_contain_variable(const std::unordered_set<Stmt *> &var_set,
   }
 }
 
+template bool CFGNode::contain_variable(const std::unordered_set<Stmt *> &,
+                                        Stmt *);
+template bool CFGNode::contain_variable(const StmtBitSet &, Stmt *);
+template bool CFGNode::may_contain_variable(
+    const std::unordered_set<Stmt *> &,
+    Stmt *);
+template bool CFGNode::may_contain_variable(const StmtBitSet &, Stmt *);
+
 bool CFGNode::reach_kill_variable(Stmt *var) const {
   // Does this node (definitely) kill a definition of var?
   return contain_variable(reach_kill, var);
@@ -331,7 +339,7 @@ void CFGNode::gather_loaded_snodes(std::unordered_set<SNode *> &snodes) const {
         if (snodes.count(snode) > 0) {
           continue;
         }
-        if (reach_in.find(global_ptr) != reach_in.end() &&
+        if (reach_in.count(global_ptr) > 0 &&
             !contain_variable(killed_in_this_node, global_ptr)) {
           // The UD-chain contains the value before this offloaded task.
           snodes.insert(snode);
@@ -591,8 +599,6 @@ void ControlFlowGraph::print_graph_structure() const {
 void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
   TI_AUTO_PROF;
   const int num_nodes = size();
-  std::queue<CFGNode *> to_visit;
-  std::unordered_map<CFGNode *, bool> in_queue;
   TI_ASSERT(nodes[start_node]->empty());
   nodes[start_node]->reach_gen.clear();
   nodes[start_node]->reach_kill.clear();
@@ -612,56 +618,40 @@ void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
       }
     }
   }
+  definitions_.clear();
   for (int i = 0; i < num_nodes; i++) {
     if (i != start_node) {
       nodes[i]->reaching_definition_analysis(after_lower_access);
     }
-    nodes[i]->reach_in.clear();
-    nodes[i]->reach_out = nodes[i]->reach_gen;
-    to_visit.push(nodes[i].get());
-    in_queue[nodes[i].get()] = true;
+    for (auto stmt : nodes[i]->reach_gen) {
+      definitions_.insert(stmt);
+    }
   }
 
-  // The worklist algorithm.
-  while (!to_visit.empty()) {
-    auto now = to_visit.front();
-    to_visit.pop();
-    in_queue[now] = false;
-
-    now->reach_in.clear();
-    for (auto prev_node : now->prev) {
-      now->reach_in.insert(prev_node->reach_out.begin(),
-                           prev_node->reach_out.end());
+  GenKillDataflow dataflow(*this, GenKillDataflow::Direction::forward,
+                           definitions_.size());
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto stmt : nodes[i]->reach_gen) {
+      dataflow.gen(i)[definitions_.find(stmt)] = true;
     }
-    auto old_out = std::move(now->reach_out);
-    now->reach_out = now->reach_gen;
-    for (auto stmt : now->reach_in) {
-      auto store_ptrs = irpass::analysis::get_store_destination(stmt);
-      bool killed;
-      if (store_ptrs.empty()) {  // the case of a global pointer
-        killed = now->reach_kill_variable(stmt);
-      } else {
-        killed = true;
-        for (auto store_ptr : store_ptrs) {
-          if (!now->reach_kill_variable(store_ptr)) {
-            killed = false;
-            break;
-          }
-        }
-      }
-      if (!killed) {
-        now->reach_out.insert(stmt);
-      }
+  }
+  dataflow.solve([&](int node_id, int id) {
+    auto now = nodes[node_id].get();
+    auto stmt = definitions_.stmt(id);
+    auto store_ptrs = irpass::analysis::get_store_destination(stmt);
+    if (store_ptrs.empty()) {  // the case of a global pointer
+      return now->reach_kill_variable(stmt);
     }
-    if (now->reach_out != old_out) {
-      // changed
-      for (auto next_node : now->next) {
-        if (!in_queue[next_node]) {
-          to_visit.push(next_node);
-          in_queue[next_node] = true;
-        }
+    for (auto store_ptr : store_ptrs) {
+      if (!now->reach_kill_variable(store_ptr)) {
+        return false;
       }
     }
+    return true;
+  });
+  for (int i = 0; i < num_nodes; i++) {
+    nodes[i]->reach_in = StmtBitSet(&definitions_, dataflow.input(i));
+    nodes[i]->reach_out = StmtBitSet(&definitions_, dataflow.output(i));
   }
 }
 
@@ -670,8 +660,6 @@ void ControlFlowGraph::live_variable_analysis(
     const std::optional<LiveVarAnalysisConfig> &config_opt) {
   TI_AUTO_PROF;
   const int num_nodes = size();
-  std::queue<CFGNode *> to_visit;
-  std::unordered_map<CFGNode *, bool> in_queue;
   TI_ASSERT(nodes[final_node]->empty());
   nodes[final_node]->live_gen.clear();
   nodes[final_node]->live_kill.clear();
@@ -704,45 +692,31 @@ void ControlFlowGraph::live_variable_analysis(
       }
     }
   }
-  for (int i = num_nodes - 1; i >= 0; i--) {
-    // push into the queue in reversed order to make it slightly faster
+  variables_.clear();
+  for (int i = 0; i < num_nodes; i++) {
     if (i != final_node) {
       nodes[i]->live_variable_analysis(after_lower_access);
     }
-    nodes[i]->live_out.clear();
-    nodes[i]->live_in = nodes[i]->live_gen;
-    to_visit.push(nodes[i].get());
-    in_queue[nodes[i].get()] = true;
+    for (auto stmt : nodes[i]->live_gen) {
+      variables_.insert(stmt);
+    }
   }
 
-  // The worklist algorithm.
-  while (!to_visit.empty()) {
-    auto now = to_visit.front();
-    to_visit.pop();
-    in_queue[now] = false;
-
-    now->live_out.clear();
-    for (auto next_node : now->next) {
-      now->live_out.insert(next_node->live_in.begin(),
-                           next_node->live_in.end());
-    }
-    auto old_in = std::move(now->live_in);
-    now->live_in = now->live_gen;
-    for (auto stmt : now->live_out) {
-      if (!CFGNode::contain_variable(now->live_kill, stmt)) {
-        now->live_in.insert(stmt);
-      }
-    }
-    if (now->live_in != old_in) {
-      // changed
-      for (auto prev_node : now->prev) {
-        if (!in_queue[prev_node]) {
-          to_visit.push(prev_node);
-          in_queue[prev_node] = true;
-        }
-      }
+  GenKillDataflow dataflow(*this, GenKillDataflow::Direction::backward,
+                           variables_.size());
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto stmt : nodes[i]->live_gen) {
+      dataflow.gen(i)[variables_.find(stmt)] = true;
     }
   }
+  dataflow.solve([&](int node_id, int id) {
+    return CFGNode::contain_variable(nodes[node_id]->live_kill,
+                                     variables_.stmt(id));
+  });
+  for (int i = 0; i < num_nodes; i++) {
+    nodes[i]->live_out = StmtBitSet(&variables_, dataflow.input(i));
+    nodes[i]->live_in = StmtBitSet(&variables_, dataflow.output(i));
+  }
 }
 
 void ControlFlowGraph::simplify_graph() {
@@ -852,7 +826,7 @@ std::unordered_set<SNode *> ControlFlowGraph::gather_loaded_snodes() {
   // output_value_state = merge(input_value_state, written_part)
   //
   // Therefore we include the nodes[final_node]->reach_in in snodes.
-  for (auto &stmt : nodes[final_node]->reach_in) {
+  for (auto stmt : nodes[final_node]->reach_in) {
     if (auto global_ptr = stmt->cast<GlobalPtrStmt>()) {
       snodes.insert(global_ptr->snode);
     }
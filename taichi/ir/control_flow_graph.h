@@ -3,6 +3,7 @@
 #include <optional>
 #include <unordered_set>
 
+#include "taichi/ir/dataflow.h"
 #include "taichi/ir/ir.h"
 
 namespace taichi::lang {
@@ -37,11 +38,13 @@ class CFGNode {
 
   // Reaching definition analysis
   // https://en.wikipedia.org/wiki/Reaching_definition
-  std::unordered_set<Stmt *> reach_gen, reach_kill, reach_in, reach_out;
+  std::unordered_set<Stmt *> reach_gen, reach_kill;
+  StmtBitSet reach_in, reach_out;
 
   // Live variable analysis
   // https://en.wikipedia.org/wiki/Live_variable_analysis
-  std::unordered_set<Stmt *> live_gen, live_kill, live_in, live_out;
+  std::unordered_set<Stmt *> live_gen, live_kill;
+  StmtBitSet live_in, live_out;
 
   CFGNode(Block *block,
           int begin_location,
@@ -66,10 +69,11 @@ class CFGNode {
                     bool replace_usages = true) const;
 
   // Utility methods.
-  static bool contain_variable(const std::unordered_set<Stmt *> &var_set,
-                               Stmt *var);
-  static bool may_contain_variable(const std::unordered_set<Stmt *> &var_set,
-                                   Stmt *var);
+  // |StmtSet| is either std::unordered_set<Stmt *> or StmtBitSet.
+  template <typename StmtSet>
+  static bool contain_variable(const StmtSet &var_set, Stmt *var);
+  template <typename StmtSet>
+  static bool may_contain_variable(const StmtSet &var_set, Stmt *var);
   bool reach_kill_variable(Stmt *var) const;
   Stmt *get_store_forwarding_data(Stmt *var, int position) const;
 
@@ -86,6 +90,10 @@ class ControlFlowGraph {
   // Erase an empty node.
   void erase(int node_id);
 
+  // The universes of the sets in the results of the analyses.
+  StmtNumbering definitions_;
+  StmtNumbering variables_;
+
  public:
   struct LiveVarAnalysisConfig {
     // This is mostly useful for SFG task-level dead store elimination. SFG may
@@ -0,0 +1,151 @@
+#include "taichi/ir/dataflow.h"
+
+#include "taichi/ir/control_flow_graph.h"
+#include "taichi/system/profiler.h"
+
+namespace taichi::lang {
+
+int StmtNumbering::insert(Stmt *stmt) {
+  auto [iter, inserted] = ids_.try_emplace(stmt, (int)stmts_.size());
+  if (inserted) {
+    stmts_.push_back(stmt);
+  }
+  return iter->second;
+}
+
+int StmtNumbering::find(Stmt *stmt) const {
+  auto iter = ids_.find(stmt);
+  return iter == ids_.end() ? -1 : iter->second;
+}
+
+void StmtNumbering::clear() {
+  ids_.clear();
+  stmts_.clear();
+}
+
+std::size_t StmtBitSet::count(Stmt *stmt) const {
+  if (!numbering_) {
+    return 0;
+  }
+  const int id = numbering_->find(stmt);
+  return id != -1 && bits_.test(id);
+}
+
+GenKillDataflow::GenKillDataflow(const ControlFlowGraph &graph,
+                                 Direction direction,
+                                 int num_elements)
+    : direction_(direction), num_elements_(num_elements) {
+  const int num_nodes = graph.size();
+  std::unordered_map<CFGNode *, int> node_ids;
+  for (int i = 0; i < num_nodes; i++) {
+    node_ids[graph.nodes[i].get()] = i;
+  }
+  preds_.resize(num_nodes);
+  succs_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto *next : graph.nodes[i]->next) {
+      const int j = node_ids.at(next);
+      if (direction == Direction::forward) {
+        succs_[i].push_back(j);
+        preds_[j].push_back(i);
+      } else {
+        succs_[j].push_back(i);
+        preds_[i].push_back(j);
+      }
+    }
+  }
+  entry_node_ = direction == Direction::forward ? graph.start_node
+                                                : graph.final_node;
+  gen_.assign(num_nodes, bit::Bitset(num_elements));
+  input_.assign(num_nodes, bit::Bitset(num_elements));
+  output_.assign(num_nodes, bit::Bitset(num_elements));
+  kill_known_.assign(num_nodes, bit::Bitset(num_elements));
+  kill_.assign(num_nodes, bit::Bitset(num_elements));
+}
+
+std::vector<int> GenKillDataflow::get_visit_order() const {
+  const int num_nodes = preds_.size();
+  std::vector<int> post_order;
+  std::vector<bool> visited(num_nodes, false);
+  // (node, index of the next successor to visit)
+  std::vector<std::pair<int, int>> stack;
+  stack.emplace_back(entry_node_, 0);
+  visited[entry_node_] = true;
+  while (!stack.empty()) {
+    auto &[node, next] = stack.back();
+    if (next < (int)succs_[node].size()) {
+      const int succ = succs_[node][next++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.emplace_back(succ, 0);
+      }
+    } else {
+      post_order.push_back(node);
+      stack.pop_back();
+    }
+  }
+  std::vector<int> order(post_order.rbegin(), post_order.rend());
+  // The nodes unreachable from the entry still get their sets computed.
+  for (int i = 0; i < num_nodes; i++) {
+    if (!visited[i]) {
+      order.push_back(i);
+    }
+  }
+  return order;
+}
+
+void GenKillDataflow::solve(const KillPredicate &is_killed) {
+  TI_AUTO_PROF;
+  const int num_nodes = preds_.size();
+  if (num_nodes == 0) {
+    return;
+  }
+  const auto order = get_visit_order();
+  std::vector<int> position(num_nodes);
+  for (int i = 0; i < num_nodes; i++) {
+    position[order[i]] = i;
+    input_[i].reset();
+    output_[i] = gen_[i];
+  }
+
+  // The positions in |order| of the nodes to visit.
+  bit::Bitset pending(num_nodes);
+  for (int i = 0; i < num_nodes; i++) {
+    pending[i] = true;
+  }
+  int cursor = 0;
+  while (pending.any()) {
+    int pos = pending.lower_bound(cursor);
+    if (pos == -1) {
+      pos = pending.find_first_one();
+    }
+    pending[pos] = false;
+    cursor = pos + 1;
+    const int node = order[pos];
+
+    auto &input = input_[node];
+    input.reset();
+    for (auto pred : preds_[node]) {
+      input |= output_[pred];
+    }
+    auto &kill_known = kill_known_[node];
+    auto &kill = kill_[node];
+    auto unknown = input & ~kill_known;
+    for (int i = unknown.find_first_one(); i != -1 && i < num_elements_;
+         i = unknown.lower_bound(i + 1)) {
+      kill_known[i] = true;
+      if (is_killed(node, i)) {
+        kill[i] = true;
+      }
+    }
+    auto output = gen_[node] | (input & ~kill);
+    if (output != output_[node]) {
+      output_[node] = std::move(output);
+      for (auto succ : succs_[node]) {
+        pending[position[succ]] = true;
+      }
+    }
+  }
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/util/bit.h"
+
+namespace taichi::lang {
+
+class Stmt;
+class ControlFlowGraph;
+
+/**
+ * Assigns consecutive numbers to the statements a dataflow analysis tracks, so
+ * that sets of them can be stored as dense bitsets.
+ */
+class StmtNumbering {
+ public:
+  // Returns the number of |stmt|, numbering it if it is new.
+  int insert(Stmt *stmt);
+  // Returns -1 if |stmt| is not numbered.
+  int find(Stmt *stmt) const;
+  Stmt *stmt(int id) const {
+    return stmts_[id];
+  }
+  int size() const {
+    return (int)stmts_.size();
+  }
+  void clear();
+
+ private:
+  std::unordered_map<Stmt *, int> ids_;
+  std::vector<Stmt *> stmts_;
+};
+
+/**
+ * A set of statements numbered by a StmtNumbering, which must outlive it.
+ */
+class StmtBitSet {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Stmt *;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Stmt *const *;
+    using reference = Stmt *;
+
+    iterator(const StmtBitSet *set, int id) : set_(set), id_(id) {
+    }
+    Stmt *operator*() const {
+      return set_->numbering_->stmt(id_);
+    }
+    iterator &operator++() {
+      id_ = set_->bits_.lower_bound(id_ + 1);
+      return *this;
+    }
+    bool operator==(const iterator &other) const {
+      return id_ == other.id_;
+    }
+    bool operator!=(const iterator &other) const {
+      return id_ != other.id_;
+    }
+
+   private:
+    const StmtBitSet *set_;
+    int id_;
+  };
+
+  StmtBitSet() = default;
+  StmtBitSet(const StmtNumbering *numbering, bit::Bitset bits)
+      : numbering_(numbering), bits_(std::move(bits)) {
+  }
+
+  bool empty() const {
+    return bits_.none();
+  }
+  std::size_t count(Stmt *stmt) const;
+  iterator begin() const {
+    return iterator(this, bits_.find_first_one());
+  }
+  iterator end() const {
+    return iterator(this, -1);
+  }
+  const bit::Bitset &bits() const {
+    return bits_;
+  }
+
+ private:
+  const StmtNumbering *numbering_{nullptr};
+  bit::Bitset bits_;
+};
+
+/**
+ * Solves a gen/kill dataflow problem on a ControlFlowGraph:
+ *   input(n) = union of output(p) over the predecessors p of n,
+ *   output(n) = gen(n) | (input(n) - kill(n)).
+ * For a backward problem, "predecessors" are the successors in the graph, so
+ * input(n) is the set at the exit of n and output(n) the one at its entry.
+ *
+ * The nodes are visited from a worklist in reverse post order (of the
+ * reversed graph for backward problems), which reaches the fixed point in few
+ * passes over the graph.
+ *
+ * Kill sets of the analyses in this codebase depend on alias queries that are
+ * expensive to run for every element, so they are given as a predicate that
+ * is evaluated lazily, at most once per node and element, and only for the
+ * elements that reach the node.
+ */
+class GenKillDataflow {
+ public:
+  enum class Direction { forward, backward };
+  // Returns true if the node kills the element.
+  using KillPredicate = std::function<bool(int node_id, int element)>;
+
+  GenKillDataflow(const ControlFlowGraph &graph,
+                  Direction direction,
+                  int num_elements);
+
+  bit::Bitset &gen(int node_id) {
+    return gen_[node_id];
+  }
+  const bit::Bitset &input(int node_id) const {
+    return input_[node_id];
+  }
+  const bit::Bitset &output(int node_id) const {
+    return output_[node_id];
+  }
+
+  void solve(const KillPredicate &is_killed);
+
+ private:
+  // Returns the node ids in the order to visit them first.
+  std::vector<int> get_visit_order() const;
+
+  const Direction direction_;
+  const int num_elements_;
+  // The edges in the direction of the dataflow.
+  std::vector<std::vector<int>> preds_, succs_;
+  int entry_node_;
+  std::vector<bit::Bitset> gen_, input_, output_;
+  // For the lazy evaluation of the kill predicate.
+  std::vector<bit::Bitset> kill_known_, kill_;
+};
+
+}  // namespace taichi::lang
@@ -45,6 +45,10 @@ void Expr::set_dual(const Expr &o) {
   this->cast<FieldExpression>()->dual.set(o);
 }
 
+void Expr::add_dual_lane(const Expr &o) {
+  this->cast<FieldExpression>()->dual_lanes.push_back(o);
+}
+
 void Expr::set_adjoint_checkbit(const Expr &o) {
   this->cast<FieldExpression>()->adjoint_checkbit.set(o);
 }
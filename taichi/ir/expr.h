@@ -97,6 +97,8 @@ class Expr {
 
   void set_dual(const Expr &o);
 
+  void add_dual_lane(const Expr &o);
+
   void set_adjoint_checkbit(const Expr &o);
 
   DataType get_ret_type() const;
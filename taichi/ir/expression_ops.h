@@ -86,6 +86,7 @@ DEFINE_EXPRESSION_FUNC_UNARY(rsqrt)
 DEFINE_EXPRESSION_FUNC_UNARY(exp)
 DEFINE_EXPRESSION_FUNC_UNARY(log)
 DEFINE_EXPRESSION_FUNC_UNARY(logic_not)
+DEFINE_EXPRESSION_FUNC_UNARY(popcnt)
 DEFINE_EXPRESSION_OP_UNARY(~, bit_not)
 DEFINE_EXPRESSION_OP_UNARY(-, neg)
 
@@ -77,6 +77,10 @@ FrontendForStmt::FrontendForStmt(const Expr &loop_var,
     : begin(begin), end(end) {
   init_config(arch, config);
   add_loop_var(loop_var);
+  // The frontend casts both bounds to either i32 or i64.
+  if (begin->ret_type == PrimitiveType::i64) {
+    loop_var.expr->ret_type = PrimitiveType::i64;
+  }
 }
 
 void FrontendForStmt::init_config(Arch arch, const ForLoopConfig &config) {
@@ -84,6 +88,9 @@ void FrontendForStmt::init_config(Arch arch, const ForLoopConfig &config) {
   strictly_serialized = config.strictly_serialized;
   mem_access_opt = config.mem_access_opt;
   block_dim = config.block_dim;
+  tile_shape = config.tile_shape;
+  sort_elements = config.sort_elements;
+  balance_elements = config.balance_elements;
   if (arch == Arch::cuda) {
     num_cpu_threads = 1;
     TI_ASSERT(block_dim <= taichi_max_gpu_block_dim);
@@ -168,6 +175,11 @@ void UnaryOpExpression::type_check(CompileConfig *config) {
         "'{}' takes real inputs only, however '{}' is provided",
         unary_op_type_name(type), operand_primitive_type->to_string()));
 
+  if (type == UnaryOpType::popcnt && !is_integral(operand_primitive_type))
+    throw TaichiTypeError(fmt::format(
+        "'{}' takes integral inputs only, however '{}' is provided",
+        unary_op_type_name(type), operand_primitive_type->to_string()));
+
   if ((type == UnaryOpType::sqrt || type == UnaryOpType::exp ||
        type == UnaryOpType::log) &&
       !is_real(operand_primitive_type)) {
@@ -514,8 +526,7 @@ void InternalFuncCallExpression::type_check(CompileConfig *) {
     TI_ASSERT_TYPE_CHECKED(arg);
     // no arg type compatibility check for now due to lack of specification
   }
-  // internal func calls have default return type
-  ret_type = PrimitiveType::i32;
+  ret_type = func_ret_type;
 }
 
 void InternalFuncCallExpression::flatten(FlattenContext *ctx) {
@@ -523,7 +534,7 @@ void InternalFuncCallExpression::flatten(FlattenContext *ctx) {
   for (int i = 0; i < (int)args.size(); ++i) {
     args_stmts[i] = flatten_rvalue(args[i], ctx);
   }
-  ctx->push_back<InternalFuncStmt>(func_name, args_stmts, nullptr,
+  ctx->push_back<InternalFuncStmt>(func_name, args_stmts, func_ret_type,
                                    with_runtime_context);
   stmt = ctx->back_stmt();
   stmt->tb = tb;
@@ -793,12 +804,18 @@ void IndexExpression::type_check(CompileConfig *) {
                       total_dim - element_dim, index_dim));
     }
 
+    auto dt = external_tensor_expr->dt;
+    auto element_type = dt.get_element_type();
     if (index_dim == total_dim) {
       // Access all the way to a single element
-      ret_type = var.cast<ExternalTensorExpression>()->dt.get_element_type();
+      ret_type = element_type->get_compute_type();
+    } else if (is_quant(element_type)) {
+      // Access to a Tensor of quantized elements
+      ret_type = TypeFactory::create_tensor_type(
+          dt.get_shape(), element_type->get_compute_type());
     } else {
       // Access to a Tensor
-      ret_type = var.cast<ExternalTensorExpression>()->dt;
+      ret_type = dt;
     }
   } else if (is_tensor()) {  // local tensor
     auto shape = var->ret_type->as<TensorType>()->get_shape();
@@ -1053,6 +1070,21 @@ void TextureOpExpression::type_check(CompileConfig *config) {
                         args[i].get_ret_type()->to_string()));
       }
     }
+  } else if (op == TextureOpType::kSampleGrad) {
+    // UV, dUV/dx, dUV/dy
+    TI_ASSERT_INFO(args.size() == ptr->num_dims * 3,
+                   "Invalid number of args for sample_grad Texture op with a "
+                   "{}-dimension texture",
+                   ptr->num_dims);
+    for (int i = 0; i < ptr->num_dims * 3; i++) {
+      TI_ASSERT_TYPE_CHECKED(args[i]);
+      if (args[i].get_ret_type() != PrimitiveType::f32) {
+        throw TaichiTypeError(
+            fmt::format("Invalid type for texture sample_grad: '{}', all "
+                        "arguments must be f32",
+                        args[i].get_ret_type()->to_string()));
+      }
+    }
   } else if (op == TextureOpType::kFetchTexel) {
     // index, int LOD
     TI_ASSERT_INFO(args.size() == ptr->num_dims + 1,
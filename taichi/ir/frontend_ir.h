@@ -22,6 +22,13 @@ struct ForLoopConfig {
   MemoryAccessOptions mem_access_opt;
   int block_dim{0};
   bool uniform{false};
+  // The shape of the tiles that struct-fors over dense SNodes iterate over.
+  std::vector<int> tile_shape;
+  // Whether struct-fors over sparse SNodes iterate in coordinate order.
+  bool sort_elements{false};
+  // Whether struct-fors spread the cells of all the elements evenly over the
+  // GPU threads.
+  bool balance_elements{false};
 };
 
 // Frontend Statements
@@ -175,6 +182,9 @@ class FrontendForStmt : public Stmt {
   bool strictly_serialized;
   MemoryAccessOptions mem_access_opt;
   int block_dim;
+  std::vector<int> tile_shape;
+  bool sort_elements;
+  bool balance_elements;
 
   FrontendForStmt(const ExprGroup &loop_vars,
                   SNode *snode,
@@ -419,11 +429,16 @@ class InternalFuncCallExpression : public Expression {
   std::string func_name;
   std::vector<Expr> args;
   bool with_runtime_context;
+  // The type of the value returned by the function.
+  DataType func_ret_type;
 
   InternalFuncCallExpression(const std::string &func_name,
                              const std::vector<Expr> &args_,
-                             bool with_runtime_context)
-      : func_name(func_name), with_runtime_context(with_runtime_context) {
+                             bool with_runtime_context,
+                             DataType func_ret_type = PrimitiveType::i32)
+      : func_name(func_name),
+        with_runtime_context(with_runtime_context),
+        func_ret_type(func_ret_type) {
     for (auto &a : args_) {
       args.push_back(a);
     }
@@ -520,6 +535,9 @@ class FieldExpression : public Expression {
   Expr adjoint;
   Expr dual;
   Expr adjoint_checkbit;
+  // Only on dual fields: the tangents of lanes 1, 2, ... in batched
+  // forward-mode autodiff. Placed wherever the field itself is placed.
+  std::vector<Expr> dual_lanes;
 
   FieldExpression(DataType dt, const Identifier &ident) : ident(ident), dt(dt) {
   }
@@ -914,6 +932,9 @@ class ASTBuilder {
       config.mem_access_opt.clear();
       config.block_dim = 0;
       config.strictly_serialized = false;
+      config.tile_shape.clear();
+      config.sort_elements = false;
+      config.balance_elements = false;
     }
   };
 
@@ -1037,6 +1058,21 @@ class ASTBuilder {
     for_loop_dec_.config.block_dim = v;
   }
 
+  void tile_shape(const std::vector<int> &shape) {
+    for (auto edge : shape) {
+      TI_ASSERT(edge > 0);
+    }
+    for_loop_dec_.config.tile_shape = shape;
+  }
+
+  void sort_elements() {
+    for_loop_dec_.config.sort_elements = true;
+  }
+
+  void balance_elements() {
+    for_loop_dec_.config.balance_elements = true;
+  }
+
   void insert_snode_access_flag(SNodeAccessFlag v, const Expr &field) {
     for_loop_dec_.config.mem_access_opt.add_flag(field.snode(), v);
   }
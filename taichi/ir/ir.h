@@ -11,6 +11,7 @@
 #include "taichi/common/core.h"
 #include "taichi/common/exceptions.h"
 #include "taichi/common/one_or_more.h"
+#include "taichi/ir/ir_allocator.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/mesh.h"
 #include "taichi/ir/type_factory.h"
@@ -106,9 +107,12 @@ class Identifier {
 #ifdef TI_WITH_LLVM
 using stmt_vector = llvm::SmallVector<pStmt, 8>;
 using stmt_ref_vector = llvm::SmallVector<Stmt *, 2>;
+// Most statements have no more than 4 operands.
+using stmt_operand_vector = llvm::SmallVector<Stmt **, 4>;
 #else
 using stmt_vector = std::vector<pStmt>;
 using stmt_ref_vector = std::vector<Stmt *>;
+using stmt_operand_vector = std::vector<Stmt **>;
 #endif
 
 class VecStatement {
@@ -285,6 +289,8 @@ class IRNode {
 
 class StmtField {
  public:
+  TI_IR_ALLOCATED
+
   StmtField() = default;
 
   virtual bool equal(const StmtField *other) const = 0;
@@ -388,9 +394,11 @@ class StmtFieldManager {
 
 class Stmt : public IRNode {
  protected:
-  std::vector<Stmt **> operands;
+  stmt_operand_vector operands;
 
  public:
+  TI_IR_ALLOCATED
+
   StmtFieldManager field_manager;
   static std::atomic<int> instance_id_counter;
   int instance_id;
@@ -501,6 +509,8 @@ class Stmt : public IRNode {
 
 class Block : public IRNode {
  public:
+  TI_IR_ALLOCATED
+
   Stmt *parent_stmt{nullptr};
   stmt_vector statements;
   stmt_vector trash_bin;
@@ -0,0 +1,176 @@
+#include "taichi/ir/ir_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace taichi::lang {
+
+namespace {
+
+constexpr std::size_t kAlignment = 16;
+// Larger objects (e.g. OffloadedStmt) are rare enough to use malloc().
+constexpr std::size_t kMaxPooledSize = 512;
+constexpr std::size_t kNumSizeClasses = kMaxPooledSize / kAlignment;
+constexpr std::size_t kChunkSize = 256 << 10;
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+std::size_t size_class_of(std::size_t size) {
+  return (std::max(size, std::size_t(1)) + kAlignment - 1) / kAlignment - 1;
+}
+
+// Holds the free blocks of the threads that have exited. Never destroyed,
+// since IR objects may be freed during static destruction.
+class GlobalFreeLists {
+ public:
+  static GlobalFreeLists &get_instance() {
+    static auto instance = new GlobalFreeLists();
+    return *instance;
+  }
+
+  FreeBlock *take(std::size_t size_class) {
+    std::lock_guard<std::mutex> _(mut_);
+    auto *list = lists_[size_class];
+    lists_[size_class] = nullptr;
+    return list;
+  }
+
+  void give(std::size_t size_class, FreeBlock *list) {
+    if (!list) {
+      return;
+    }
+    auto *last = list;
+    while (last->next) {
+      last = last->next;
+    }
+    std::lock_guard<std::mutex> _(mut_);
+    last->next = lists_[size_class];
+    lists_[size_class] = list;
+  }
+
+  // For threads whose cache is gone.
+  void *allocate(std::size_t size_class) {
+    std::lock_guard<std::mutex> _(mut_);
+    if (auto *block = lists_[size_class]) {
+      lists_[size_class] = block->next;
+      return block;
+    }
+    return std::malloc((size_class + 1) * kAlignment);
+  }
+
+  void deallocate(void *ptr, std::size_t size_class) {
+    std::lock_guard<std::mutex> _(mut_);
+    auto *block = static_cast<FreeBlock *>(ptr);
+    block->next = lists_[size_class];
+    lists_[size_class] = block;
+  }
+
+ private:
+  std::mutex mut_;
+  FreeBlock *lists_[kNumSizeClasses]{};
+};
+
+class ThreadCache {
+ public:
+  ~ThreadCache() {
+    for (std::size_t i = 0; i < kNumSizeClasses; i++) {
+      GlobalFreeLists::get_instance().give(i, lists_[i]);
+    }
+  }
+
+  void *allocate(std::size_t size_class) {
+    if (auto *block = lists_[size_class]) {
+      lists_[size_class] = block->next;
+      return block;
+    }
+    if ((lists_[size_class] =
+             GlobalFreeLists::get_instance().take(size_class))) {
+      return allocate(size_class);
+    }
+    const std::size_t block_size = (size_class + 1) * kAlignment;
+    if (chunk_begin_ + block_size > chunk_end_) {
+      // The tail of the previous chunk is lost.
+      chunk_begin_ = static_cast<char *>(std::malloc(kChunkSize));
+      if (!chunk_begin_) {
+        throw std::bad_alloc();
+      }
+      chunk_end_ = chunk_begin_ + kChunkSize;
+    }
+    void *ptr = chunk_begin_;
+    chunk_begin_ += block_size;
+    return ptr;
+  }
+
+  void deallocate(void *ptr, std::size_t size_class) {
+    auto *block = static_cast<FreeBlock *>(ptr);
+    block->next = lists_[size_class];
+    lists_[size_class] = block;
+  }
+
+ private:
+  FreeBlock *lists_[kNumSizeClasses]{};
+  char *chunk_begin_{nullptr};
+  char *chunk_end_{nullptr};
+};
+
+// |thread_cache| is trivially destructible, so that it stays readable after
+// |thread_cache_owner| is destroyed at thread exit.
+thread_local ThreadCache *thread_cache{nullptr};
+thread_local bool thread_cache_destroyed{false};
+
+struct ThreadCacheOwner {
+  ~ThreadCacheOwner() {
+    delete thread_cache;
+    thread_cache = nullptr;
+    thread_cache_destroyed = true;
+  }
+};
+thread_local ThreadCacheOwner thread_cache_owner;
+
+ThreadCache *get_thread_cache() {
+  if (!thread_cache && !thread_cache_destroyed) {
+    // Makes sure that the cache is released at thread exit.
+    (void)&thread_cache_owner;
+    thread_cache = new ThreadCache();
+  }
+  return thread_cache;
+}
+
+}  // namespace
+
+void *allocate_ir_object(std::size_t size) {
+  if (size > kMaxPooledSize) {
+    return ::operator new(size);
+  }
+  const auto size_class = size_class_of(size);
+  if (auto *cache = get_thread_cache()) {
+    return cache->allocate(size_class);
+  }
+  auto *ptr = GlobalFreeLists::get_instance().allocate(size_class);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void deallocate_ir_object(void *ptr, std::size_t size) {
+  if (!ptr) {
+    return;
+  }
+  if (size > kMaxPooledSize) {
+    ::operator delete(ptr);
+    return;
+  }
+  const auto size_class = size_class_of(size);
+  if (auto *cache = get_thread_cache()) {
+    cache->deallocate(ptr, size_class);
+  } else {
+    GlobalFreeLists::get_instance().deallocate(ptr, size_class);
+  }
+}
+
+}  // namespace taichi::lang
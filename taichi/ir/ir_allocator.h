@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+namespace taichi::lang {
+
+// Allocator of IR nodes (statements, blocks, statement fields).
+//
+// Passes create and destroy lots of small IR objects, one at a time. Instead
+// of going through malloc() for each of them, objects up to a few hundred
+// bytes are carved out of large chunks, and recycled through per-thread free
+// lists of their size class. The chunks are never returned to the system;
+// the free blocks of a thread go back to a global list when the thread exits.
+void *allocate_ir_object(std::size_t size);
+void deallocate_ir_object(void *ptr, std::size_t size);
+
+// Adds class-specific allocation functions that use the allocator above to
+// a class hierarchy. The class must have a virtual destructor, so that the
+// size of the most derived object is passed on deletion.
+#define TI_IR_ALLOCATED                                              \
+  static void *operator new(std::size_t size) {                      \
+    return ::taichi::lang::allocate_ir_object(size);                 \
+  }                                                                  \
+  static void operator delete(void *ptr, std::size_t size) noexcept { \
+    ::taichi::lang::deallocate_ir_object(ptr, size);                 \
+  }
+
+}  // namespace taichi::lang
@@ -81,6 +81,10 @@ class Mesh {
 
   MeshMapping<SNode *> owned_offset{};  // prefix of owned element
   MeshMapping<SNode *> total_offset{};  // prefix of total element
+  // Optional, the numbers of owned / total elements in each patch when they
+  // are not the differences of the offsets (dynamic meshes).
+  MeshMapping<SNode *> owned_num{};
+  MeshMapping<SNode *> total_num{};
   std::map<std::pair<MeshElementType, ConvType>, SNode *>
       index_mapping{};  // mapping from one index space to another index space
 
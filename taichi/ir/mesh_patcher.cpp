@@ -0,0 +1,1605 @@
+#include "taichi/ir/mesh_patcher.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+#include "taichi/common/logging.h"
+
+namespace taichi::lang {
+namespace mesh {
+
+namespace {
+
+constexpr uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+// Local indices and local relation offsets are stored as u16.
+constexpr size_t kMaxLocalIndex = std::numeric_limits<uint16_t>::max();
+
+// Vertex pairs of the edges of a triangle and a tetrahedron, and vertex
+// triples of the faces of a tetrahedron, the i-th face facing away from the
+// i-th vertex.
+constexpr int kTriangleEdges[3][2] = {{0, 1}, {1, 2}, {2, 0}};
+constexpr int kTetEdges[6][2] = {{0, 1}, {0, 2}, {0, 3},
+                                 {1, 2}, {1, 3}, {2, 3}};
+constexpr int kTetFaces[4][3] = {{1, 2, 3}, {0, 3, 2}, {0, 1, 3}, {0, 2, 1}};
+
+// The number of |to| elements of a |from| element, for from > to.
+int relation_arity(int from, int to) {
+  return (from == 3 && to == 1) ? 6 : from + 1;
+}
+
+// Runs |func(i)| for i in [0, n) on up to |num_threads| threads, handing out
+// chunks dynamically since the work per index can vary a lot. |func| must not
+// throw.
+template <typename Func>
+void parallel_for(size_t n, int num_threads, const Func &func) {
+  const size_t num_workers = std::min<size_t>(num_threads, n);
+  if (num_workers <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      func(i);
+    }
+    return;
+  }
+  const size_t chunk = std::max<size_t>(1, n / (num_workers * 16));
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    while (true) {
+      const size_t begin = next.fetch_add(chunk);
+      if (begin >= n) {
+        return;
+      }
+      const size_t end = std::min(n, begin + chunk);
+      for (size_t i = begin; i < end; i++) {
+        func(i);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_workers; t++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// Sorts equally sized chunks on their own threads, then merges them pairwise.
+template <typename T>
+void parallel_sort(std::vector<T> &data, int num_threads) {
+  const size_t num_chunks =
+      std::max<size_t>(1, std::min<size_t>(num_threads, data.size() / 4096));
+  std::vector<size_t> bounds(num_chunks + 1);
+  for (size_t i = 0; i <= num_chunks; i++) {
+    bounds[i] = data.size() * i / num_chunks;
+  }
+  parallel_for(num_chunks, num_threads, [&](size_t i) {
+    std::sort(data.begin() + bounds[i], data.begin() + bounds[i + 1]);
+  });
+  for (size_t width = 1; width < num_chunks; width *= 2) {
+    const size_t num_merges = (num_chunks + 2 * width - 1) / (2 * width);
+    parallel_for(num_merges, num_threads, [&](size_t i) {
+      const size_t lo = 2 * width * i;
+      const size_t mid = std::min(lo + width, num_chunks);
+      const size_t hi = std::min(lo + 2 * width, num_chunks);
+      std::inplace_merge(data.begin() + bounds[lo], data.begin() + bounds[mid],
+                         data.begin() + bounds[hi]);
+    });
+  }
+}
+
+struct Csr {
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> values;
+
+  const uint32_t *begin(size_t i) const {
+    return values.data() + offsets[i];
+  }
+  const uint32_t *end(size_t i) const {
+    return values.data() + offsets[i + 1];
+  }
+};
+
+// The unique sorted keys of a multiset, bucketed by the smallest vertex of
+// each key. Used to number edges and faces.
+template <typename Key>
+struct VertexBuckets {
+  std::vector<size_t> begin;  // num_vertices + 1
+  std::vector<Key> keys;
+
+  uint32_t find(uint32_t vertex, Key key) const {
+    auto first = keys.begin() + begin[vertex];
+    auto last = keys.begin() + begin[vertex + 1];
+    auto it = std::lower_bound(first, last, key);
+    TI_ASSERT(it != last && *it == key);
+    return uint32_t(begin[vertex] + (it - first));
+  }
+};
+
+// |emit(i, push)| calls push(vertex, key) for the keys of the i-th of |n|
+// items.
+template <typename Key, typename Emit>
+VertexBuckets<Key> make_buckets(size_t num_vertices,
+                                size_t n,
+                                int num_threads,
+                                const Emit &emit) {
+  std::vector<size_t> offsets(num_vertices + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    emit(i, [&](uint32_t v, Key) { offsets[v + 1]++; });
+  }
+  for (size_t v = 0; v < num_vertices; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<Key> keys(offsets[num_vertices]);
+  {
+    std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+      emit(i, [&](uint32_t v, Key key) { keys[cursor[v]++] = key; });
+    }
+  }
+
+  VertexBuckets<Key> buckets;
+  buckets.begin.assign(num_vertices + 1, 0);
+  parallel_for(num_vertices, num_threads, [&](size_t v) {
+    auto first = keys.begin() + offsets[v];
+    auto last = keys.begin() + offsets[v + 1];
+    std::sort(first, last);
+    buckets.begin[v + 1] = std::unique(first, last) - first;
+  });
+  for (size_t v = 0; v < num_vertices; v++) {
+    buckets.begin[v + 1] += buckets.begin[v];
+  }
+  buckets.keys.resize(buckets.begin[num_vertices]);
+  parallel_for(num_vertices, num_threads, [&](size_t v) {
+    std::copy(keys.begin() + offsets[v],
+              keys.begin() + offsets[v] + (buckets.begin[v + 1] -
+                                           buckets.begin[v]),
+              buckets.keys.begin() + buckets.begin[v]);
+  });
+  return buckets;
+}
+
+// Inverts a relation of fixed |arity|, the result lists the elements in
+// increasing order.
+Csr invert(const std::vector<uint32_t> &down, int arity, size_t num_to) {
+  Csr up;
+  up.offsets.assign(num_to + 1, 0);
+  for (uint32_t x : down) {
+    up.offsets[x + 1]++;
+  }
+  for (size_t i = 0; i < num_to; i++) {
+    up.offsets[i + 1] += up.offsets[i];
+  }
+  up.values.resize(down.size());
+  std::vector<size_t> cursor(up.offsets.begin(), up.offsets.end() - 1);
+  for (size_t i = 0; i < down.size(); i++) {
+    up.values[cursor[down[i]]++] = uint32_t(i / arity);
+  }
+  return up;
+}
+
+// Elements reachable in two hops, |first| then |second|, excluding the
+// element itself.
+template <typename First, typename Second>
+Csr two_hop(size_t n, int num_threads, const First &first,
+            const Second &second) {
+  auto gather = [&](size_t i, std::vector<uint32_t> &out) {
+    out.clear();
+    first(i, [&](uint32_t mid) {
+      second(mid, [&](uint32_t j) {
+        if (j != i) {
+          out.push_back(j);
+        }
+      });
+    });
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  };
+  Csr csr;
+  csr.offsets.assign(n + 1, 0);
+  parallel_for(n, num_threads, [&](size_t i) {
+    thread_local std::vector<uint32_t> out;
+    gather(i, out);
+    csr.offsets[i + 1] = out.size();
+  });
+  for (size_t i = 0; i < n; i++) {
+    csr.offsets[i + 1] += csr.offsets[i];
+  }
+  csr.values.resize(csr.offsets[n]);
+  parallel_for(n, num_threads, [&](size_t i) {
+    thread_local std::vector<uint32_t> out;
+    gather(i, out);
+    std::copy(out.begin(), out.end(), csr.values.begin() + csr.offsets[i]);
+  });
+  return csr;
+}
+
+// Permutes the rows of a relation to the reordered indices of its |from|
+// elements and maps its values to those of its |to| elements.
+std::vector<uint32_t> relabel(const std::vector<uint32_t> &down,
+                              int arity,
+                              const std::vector<uint32_t> &from_r2g,
+                              const std::vector<uint32_t> &to_g2r,
+                              int num_threads) {
+  std::vector<uint32_t> result(down.size());
+  parallel_for(from_r2g.size(), num_threads, [&](size_t r) {
+    for (int k = 0; k < arity; k++) {
+      result[r * arity + k] = to_g2r[down[size_t(from_r2g[r]) * arity + k]];
+    }
+  });
+  return result;
+}
+
+Csr relabel(const Csr &csr,
+            const std::vector<uint32_t> &from_r2g,
+            const std::vector<uint32_t> &to_g2r,
+            int num_threads) {
+  const size_t n = from_r2g.size();
+  Csr result;
+  result.offsets.assign(n + 1, 0);
+  for (size_t r = 0; r < n; r++) {
+    const uint32_t g = from_r2g[r];
+    result.offsets[r + 1] =
+        result.offsets[r] + (csr.offsets[g + 1] - csr.offsets[g]);
+  }
+  result.values.resize(csr.values.size());
+  parallel_for(n, num_threads, [&](size_t r) {
+    auto *out = result.values.data() + result.offsets[r];
+    const uint32_t g = from_r2g[r];
+    for (auto *x = csr.begin(g); x != csr.end(g); x++) {
+      *out++ = to_g2r[*x];
+    }
+  });
+  return result;
+}
+
+uint64_t spread_bits(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
+
+// The connectivity of the whole mesh in global indices.
+struct GlobalMesh {
+  int top{0};
+  std::array<size_t, 4> num{};
+  // down[a][b] lists the b-elements of each a-element, for a > b.
+  std::array<std::array<std::vector<uint32_t>, 4>, 4> down;
+  // up[a][b] for a < b and same[a] list neighbours in increasing order.
+  std::array<std::array<Csr, 4>, 4> up;
+  std::array<Csr, 4> same;
+  std::array<std::array<bool, 4>, 4> has_up{};
+  std::array<bool, 4> has_same{};
+
+  const Csr &dynamic(int from, int to) const {
+    return from == to ? same[from] : up[from][to];
+  }
+
+  void build_up(int from, int to) {
+    if (!has_up[from][to]) {
+      up[from][to] =
+          invert(down[to][from], relation_arity(to, from), num[from]);
+      has_up[from][to] = true;
+    }
+  }
+};
+
+void build_elements(GlobalMesh &mesh,
+                    const std::vector<uint32_t> &cells,
+                    int num_threads) {
+  const int top = mesh.top;
+  const size_t nv = mesh.num[0];
+  const size_t nc = mesh.num[top];
+  const int cell_size = top + 1;
+  mesh.down[top][0] = cells;
+
+  // Edges of the cells.
+  const int num_cell_edges = top == 3 ? 6 : 3;
+  auto cell_edge = [&](size_t c, int k, uint32_t &a, uint32_t &b) {
+    const int *e = top == 3 ? kTetEdges[k] : kTriangleEdges[k];
+    a = cells[c * cell_size + e[0]];
+    b = cells[c * cell_size + e[1]];
+    if (a > b) {
+      std::swap(a, b);
+    }
+  };
+  auto edges = make_buckets<uint32_t>(
+      nv, nc, num_threads, [&](size_t c, const auto &push) {
+        for (int k = 0; k < num_cell_edges; k++) {
+          uint32_t a, b;
+          cell_edge(c, k, a, b);
+          push(a, b);
+        }
+      });
+  mesh.num[1] = edges.keys.size();
+  auto &ev = mesh.down[1][0];
+  ev.resize(mesh.num[1] * 2);
+  parallel_for(nv, num_threads, [&](size_t v) {
+    for (size_t e = edges.begin[v]; e < edges.begin[v + 1]; e++) {
+      ev[e * 2] = uint32_t(v);
+      ev[e * 2 + 1] = edges.keys[e];
+    }
+  });
+  auto &ce = mesh.down[top][1];
+  ce.resize(nc * num_cell_edges);
+  parallel_for(nc, num_threads, [&](size_t c) {
+    for (int k = 0; k < num_cell_edges; k++) {
+      uint32_t a, b;
+      cell_edge(c, k, a, b);
+      ce[c * num_cell_edges + k] = edges.find(a, b);
+    }
+  });
+  if (top == 2) {
+    return;
+  }
+
+  // Faces of the tetrahedra, oriented as in the first cell they belong to.
+  auto face_key = [&](size_t c, int k, uint32_t &a, uint64_t &key) {
+    std::array<uint32_t, 3> v;
+    for (int i = 0; i < 3; i++) {
+      v[i] = cells[c * 4 + kTetFaces[k][i]];
+    }
+    std::sort(v.begin(), v.end());
+    a = v[0];
+    key = (uint64_t(v[1]) << 32) | v[2];
+  };
+  auto faces = make_buckets<uint64_t>(
+      nv, nc, num_threads, [&](size_t c, const auto &push) {
+        for (int k = 0; k < 4; k++) {
+          uint32_t a;
+          uint64_t key;
+          face_key(c, k, a, key);
+          push(a, key);
+        }
+      });
+  mesh.num[2] = faces.keys.size();
+  auto &cf = mesh.down[3][2];
+  cf.resize(nc * 4);
+  parallel_for(nc, num_threads, [&](size_t c) {
+    for (int k = 0; k < 4; k++) {
+      uint32_t a;
+      uint64_t key;
+      face_key(c, k, a, key);
+      cf[c * 4 + k] = faces.find(a, key);
+    }
+  });
+  auto &fv = mesh.down[2][0];
+  fv.assign(mesh.num[2] * 3, kInvalid);
+  for (size_t c = 0; c < nc; c++) {
+    for (int k = 0; k < 4; k++) {
+      const uint32_t f = cf[c * 4 + k];
+      if (fv[f * 3] == kInvalid) {
+        for (int i = 0; i < 3; i++) {
+          fv[f * 3 + i] = cells[c * 4 + kTetFaces[k][i]];
+        }
+      }
+    }
+  }
+  auto &fe = mesh.down[2][1];
+  fe.resize(mesh.num[2] * 3);
+  parallel_for(mesh.num[2], num_threads, [&](size_t f) {
+    for (int k = 0; k < 3; k++) {
+      uint32_t a = fv[f * 3 + kTriangleEdges[k][0]];
+      uint32_t b = fv[f * 3 + kTriangleEdges[k][1]];
+      if (a > b) {
+        std::swap(a, b);
+      }
+      fe[f * 3 + k] = edges.find(a, b);
+    }
+  });
+}
+
+// Sorts the cells along a Morton curve through their centroids.
+std::vector<uint32_t> morton_order(const GlobalMesh &mesh,
+                                   const std::vector<float> &positions,
+                                   int num_threads) {
+  std::array<float, 3> lo, hi;
+  lo.fill(std::numeric_limits<float>::max());
+  hi.fill(std::numeric_limits<float>::lowest());
+  for (size_t v = 0; v < mesh.num[0]; v++) {
+    for (int i = 0; i < 3; i++) {
+      lo[i] = std::min(lo[i], positions[v * 3 + i]);
+      hi[i] = std::max(hi[i], positions[v * 3 + i]);
+    }
+  }
+  std::array<float, 3> scale;
+  for (int i = 0; i < 3; i++) {
+    scale[i] = hi[i] > lo[i] ? float(0x1fffff) / (hi[i] - lo[i]) : 0.0f;
+  }
+
+  const int cell_size = mesh.top + 1;
+  const auto &cells = mesh.down[mesh.top][0];
+  const size_t nc = mesh.num[mesh.top];
+  std::vector<std::pair<uint64_t, uint32_t>> keys(nc);
+  parallel_for(nc, num_threads, [&](size_t c) {
+    uint64_t code = 0;
+    for (int i = 0; i < 3; i++) {
+      float centroid = 0;
+      for (int k = 0; k < cell_size; k++) {
+        centroid += positions[size_t(cells[c * cell_size + k]) * 3 + i];
+      }
+      centroid /= cell_size;
+      code |= spread_bits(uint64_t((centroid - lo[i]) * scale[i])) << i;
+    }
+    keys[c] = {code, uint32_t(c)};
+  });
+  parallel_sort(keys, num_threads);
+  std::vector<uint32_t> order(nc);
+  for (size_t i = 0; i < nc; i++) {
+    order[i] = keys[i].second;
+  }
+  return order;
+}
+
+// The local view of one patch, see PatchedMesh.
+struct Patch {
+  std::array<std::vector<uint32_t>, 4> ribbon;  // Reordered indices.
+  std::vector<std::vector<uint16_t>> values;
+  std::vector<std::vector<uint16_t>> offsets;
+  bool overflow{false};
+};
+
+int resolve_num_threads(const MeshPatcherConfig &config) {
+  return config.num_threads > 0
+             ? config.num_threads
+             : std::max<int>(1, std::thread::hardware_concurrency());
+}
+
+size_t resolve_max_elements(const MeshPatcherConfig &config) {
+  size_t max_elements = config.max_elements_per_patch;
+  if (max_elements == 0) {
+    TI_ERROR_IF(config.bytes_per_element <= 0,
+                "bytes_per_element must be positive");
+    max_elements = config.shared_memory_bytes / config.bytes_per_element;
+  }
+  return std::clamp<size_t>(max_elements, 1, kMaxLocalIndex);
+}
+
+// Checks the input of the patchers and sets the numbers of vertices and cells
+// of |mesh|.
+void init_mesh(GlobalMesh &mesh,
+               MeshTopology topology,
+               const std::vector<float> &positions,
+               const std::vector<uint32_t> &cells,
+               const std::vector<MeshRelationType> &relations) {
+  const int top = int(topology) - 1;
+  const int cell_size = top + 1;
+  mesh.top = top;
+  TI_ERROR_IF(positions.size() % 3 != 0,
+              "Mesh positions must hold 3 floats per vertex");
+  TI_ERROR_IF(cells.empty() || cells.size() % cell_size != 0,
+              "Mesh cells must hold {} vertices each", cell_size);
+  mesh.num[0] = positions.size() / 3;
+  mesh.num[top] = cells.size() / cell_size;
+  for (uint32_t v : cells) {
+    TI_ERROR_IF(v >= mesh.num[0], "Mesh cell refers to vertex {} of {}", v,
+                mesh.num[0]);
+  }
+  for (auto rel : relations) {
+    TI_ERROR_IF(from_end_element_order(rel) > top ||
+                    to_end_element_order(rel) > top,
+                "Relation {} is not defined on this mesh",
+                relation_type_name(rel));
+  }
+}
+
+struct Partition {
+  int num_patches{0};
+  // The cells along the curve, and the patch of each cell.
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> cell_patch;
+};
+
+// Grows patches along the curve until the owned cells touch too many
+// elements of some type.
+Partition partition_cells(const GlobalMesh &mesh,
+                          const std::vector<float> &positions,
+                          size_t max_elements,
+                          int num_threads) {
+  const int top = mesh.top;
+  Partition partition;
+  partition.order = morton_order(mesh, positions, num_threads);
+  const auto &order = partition.order;
+  const size_t nc = mesh.num[top];
+  auto &cell_patch = partition.cell_patch;
+  cell_patch.resize(nc);
+  std::array<std::vector<uint32_t>, 3> stamp;
+  for (int d = 0; d < top; d++) {
+    stamp[d].assign(mesh.num[d], kInvalid);
+  }
+  std::array<size_t, 4> touched{};
+  uint32_t patch = 0;
+  auto count_new = [&](uint32_t c, int d) {
+    const int arity = relation_arity(top, d);
+    size_t count = 0;
+    for (int k = 0; k < arity; k++) {
+      count += stamp[d][mesh.down[top][d][c * arity + k]] != patch;
+    }
+    return count;
+  };
+  for (size_t i = 0; i < nc; i++) {
+    const uint32_t c = order[i];
+    bool full = touched[top] + 1 > max_elements;
+    for (int d = 0; d < top && !full; d++) {
+      full = touched[d] + count_new(c, d) > max_elements;
+    }
+    if (full && touched[top] > 0) {
+      patch++;
+      touched.fill(0);
+    }
+    for (int d = 0; d < top; d++) {
+      const int arity = relation_arity(top, d);
+      for (int k = 0; k < arity; k++) {
+        uint32_t &s = stamp[d][mesh.down[top][d][c * arity + k]];
+        if (s != patch) {
+          s = patch;
+          touched[d]++;
+        }
+      }
+    }
+    touched[top]++;
+    cell_patch[c] = patch;
+  }
+  partition.num_patches = int(patch + 1);
+  return partition;
+}
+
+struct Ownership {
+  std::array<std::vector<uint32_t>, 4> g2r, r2g;
+  std::array<std::vector<uint32_t>, 4> owned_offsets;
+};
+
+// Each element is owned by the first patch touching it, and numbered in the
+// order the curve first touches it.
+Ownership assign_owners(const GlobalMesh &mesh, const Partition &partition) {
+  const int top = mesh.top;
+  const int num_patches = partition.num_patches;
+  const size_t nc = mesh.num[top];
+  const auto &order = partition.order;
+  Ownership ownership;
+  auto &g2r = ownership.g2r;
+  auto &r2g = ownership.r2g;
+  auto &owned_offsets = ownership.owned_offsets;
+  for (int d = 0; d <= top; d++) {
+    g2r[d].assign(mesh.num[d], kInvalid);
+    r2g[d].resize(mesh.num[d]);
+    owned_offsets[d].assign(num_patches + 1, 0);
+  }
+  std::array<uint32_t, 4> next{};
+  auto own = [&](int d, uint32_t e) {
+    if (g2r[d][e] == kInvalid) {
+      g2r[d][e] = next[d];
+      r2g[d][next[d]++] = e;
+    }
+  };
+  size_t i = 0;
+  for (int p = 0; p < num_patches; p++) {
+    for (; i < nc && partition.cell_patch[order[i]] == uint32_t(p); i++) {
+      const uint32_t c = order[i];
+      own(top, c);
+      for (int d = 0; d < top; d++) {
+        const int arity = relation_arity(top, d);
+        for (int k = 0; k < arity; k++) {
+          own(d, mesh.down[top][d][c * arity + k]);
+        }
+      }
+    }
+    if (p == num_patches - 1) {
+      // Vertices not in any cell.
+      for (uint32_t v = 0; v < mesh.num[0]; v++) {
+        own(0, v);
+      }
+    }
+    for (int d = 0; d <= top; d++) {
+      owned_offsets[d][p + 1] = next[d];
+    }
+  }
+  return ownership;
+}
+
+}  // namespace
+
+PatchedMesh patch_mesh(MeshTopology topology,
+                       const std::vector<float> &positions,
+                       const std::vector<uint32_t> &cells,
+                       const std::vector<MeshRelationType> &relations,
+                       const MeshPatcherConfig &config) {
+  GlobalMesh mesh;
+  init_mesh(mesh, topology, positions, cells, relations);
+  const int top = mesh.top;
+  const int num_threads = resolve_num_threads(config);
+  const size_t max_elements = resolve_max_elements(config);
+
+  build_elements(mesh, cells, num_threads);
+  for (auto rel : relations) {
+    const int from = from_end_element_order(rel);
+    const int to = to_end_element_order(rel);
+    if (from < to) {
+      mesh.build_up(from, to);
+    } else if (from == to && !mesh.has_same[from]) {
+      // Vertices sharing an edge, or elements sharing a face of one order
+      // lower.
+      const int mid = from == 0 ? 1 : from - 1;
+      if (from == 0) {
+        mesh.build_up(0, 1);
+      } else {
+        mesh.build_up(mid, from);
+      }
+      const Csr &up_csr = from == 0 ? mesh.up[0][1] : mesh.up[mid][from];
+      const auto &down_map = from == 0 ? mesh.down[1][0] : mesh.down[from][mid];
+      const int arity = from == 0 ? 2 : relation_arity(from, mid);
+      auto first = [&](size_t i, const auto &f) {
+        if (from == 0) {
+          for (auto *e = up_csr.begin(i); e != up_csr.end(i); e++) {
+            f(*e);
+          }
+        } else {
+          for (int k = 0; k < arity; k++) {
+            f(down_map[i * arity + k]);
+          }
+        }
+      };
+      auto second = [&](size_t m, const auto &f) {
+        if (from == 0) {
+          for (int k = 0; k < arity; k++) {
+            f(down_map[m * arity + k]);
+          }
+        } else {
+          for (auto *x = up_csr.begin(m); x != up_csr.end(m); x++) {
+            f(*x);
+          }
+        }
+      };
+      mesh.same[from] = two_hop(mesh.num[from], num_threads, first, second);
+      mesh.has_same[from] = true;
+    }
+  }
+
+  const Partition partition =
+      partition_cells(mesh, positions, max_elements, num_threads);
+  const int num_patches = partition.num_patches;
+  Ownership ownership = assign_owners(mesh, partition);
+  auto &g2r = ownership.g2r;
+  const auto &r2g = ownership.r2g;
+  const auto &owned_offsets = ownership.owned_offsets;
+
+  // From here on the connectivity is relabelled to reordered indices, so
+  // that each patch scans contiguous rows and tells owned elements by range.
+  std::array<std::array<bool, 4>, 4> fixed{}, relabelled{};
+  for (auto rel : relations) {
+    const int from = from_end_element_order(rel);
+    const int to = to_end_element_order(rel);
+    if (from > to && !fixed[from][to]) {
+      fixed[from][to] = true;
+      mesh.down[from][to] =
+          relabel(mesh.down[from][to], relation_arity(from, to), r2g[from],
+                  g2r[to], num_threads);
+    } else if (from <= to && !relabelled[from][to]) {
+      relabelled[from][to] = true;
+      Csr &csr = from == to ? mesh.same[from] : mesh.up[from][to];
+      csr = relabel(csr, r2g[from], g2r[to], num_threads);
+    }
+  }
+
+  std::vector<Patch> patches(num_patches);
+  parallel_for(num_patches, num_threads, [&](size_t p) {
+    Patch &patch = patches[p];
+    auto owned_begin = [&](int d) { return owned_offsets[d][p]; };
+    auto owned_end = [&](int d) { return owned_offsets[d][p + 1]; };
+    auto for_each_local = [&](int d, const auto &f) {
+      for (uint32_t r = owned_begin(d); r < owned_end(d); r++) {
+        f(r);
+      }
+      for (uint32_t r : patch.ribbon[d]) {
+        f(r);
+      }
+    };
+    auto local = [&](int d, uint32_t r) -> uint32_t {
+      if (r >= owned_begin(d) && r < owned_end(d)) {
+        return r - owned_begin(d);
+      }
+      const auto &ribbon = patch.ribbon[d];
+      return owned_end(d) - owned_begin(d) +
+             uint32_t(std::lower_bound(ribbon.begin(), ribbon.end(), r) -
+                      ribbon.begin());
+    };
+
+    // Ribbons from the top order down, so that the closure of the fixed
+    // relations sees the final ribbons of the higher orders.
+    for (int d = top; d >= 0; d--) {
+      auto &ribbon = patch.ribbon[d];
+      auto add = [&](uint32_t r) {
+        if (r < owned_begin(d) || r >= owned_end(d)) {
+          ribbon.push_back(r);
+        }
+      };
+      for (int from = 0; from <= d; from++) {
+        if (!relabelled[from][d]) {
+          continue;
+        }
+        const Csr &csr = mesh.dynamic(from, d);
+        std::for_each(csr.begin(owned_begin(from)), csr.begin(owned_end(from)),
+                      add);
+      }
+      for (int h = d + 1; h <= top; h++) {
+        if (!fixed[h][d]) {
+          continue;
+        }
+        const int arity = relation_arity(h, d);
+        for_each_local(h, [&](uint32_t x) {
+          for (int k = 0; k < arity; k++) {
+            add(mesh.down[h][d][x * arity + k]);
+          }
+        });
+      }
+      std::sort(ribbon.begin(), ribbon.end());
+      ribbon.erase(std::unique(ribbon.begin(), ribbon.end()), ribbon.end());
+      if (owned_end(d) - owned_begin(d) + ribbon.size() > kMaxLocalIndex + 1) {
+        patch.overflow = true;
+        return;
+      }
+    }
+
+    patch.values.resize(relations.size());
+    patch.offsets.resize(relations.size());
+    for (size_t i = 0; i < relations.size(); i++) {
+      const int from = from_end_element_order(relations[i]);
+      const int to = to_end_element_order(relations[i]);
+      auto &values = patch.values[i];
+      if (from > to) {
+        const int arity = relation_arity(from, to);
+        for_each_local(from, [&](uint32_t x) {
+          for (int k = 0; k < arity; k++) {
+            const uint32_t y = mesh.down[from][to][x * arity + k];
+            values.push_back(uint16_t(local(to, y)));
+          }
+        });
+        continue;
+      }
+      auto &offsets = patch.offsets[i];
+      const Csr &csr = mesh.dynamic(from, to);
+      offsets.push_back(0);
+      for (uint32_t x = owned_begin(from); x < owned_end(from); x++) {
+        const size_t begin = values.size();
+        for (auto *y = csr.begin(x); y != csr.end(x); y++) {
+          values.push_back(uint16_t(local(to, *y)));
+        }
+        std::sort(values.begin() + begin, values.end());
+        if (values.size() > kMaxLocalIndex) {
+          patch.overflow = true;
+          return;
+        }
+        offsets.push_back(uint16_t(values.size()));
+      }
+    }
+  });
+  for (int p = 0; p < num_patches; p++) {
+    TI_ERROR_IF(patches[p].overflow,
+                "Patch {} of the mesh exceeds {} local elements, decrease "
+                "max_elements_per_patch",
+                p, kMaxLocalIndex + 1);
+  }
+
+  PatchedMesh result;
+  result.num_patches = num_patches;
+  for (int d = 0; d <= top; d++) {
+    PatchedMesh::Element element;
+    element.order = d;
+    element.num = int(mesh.num[d]);
+    element.owned_offsets = owned_offsets[d];
+    element.total_offsets.assign(num_patches + 1, 0);
+    size_t max_total = 0;
+    for (int p = 0; p < num_patches; p++) {
+      const size_t total = owned_offsets[d][p + 1] - owned_offsets[d][p] +
+                           patches[p].ribbon[d].size();
+      max_total = std::max(max_total, total);
+      element.total_offsets[p + 1] = element.total_offsets[p] + total;
+    }
+    // Rounded up like the offline patcher does.
+    element.max_num_per_patch = int((max_total + 31) / 32 * 32);
+    element.l2g_mapping.resize(element.total_offsets[num_patches]);
+    element.l2r_mapping.resize(element.total_offsets[num_patches]);
+    parallel_for(num_patches, num_threads, [&](size_t p) {
+      size_t l = element.total_offsets[p];
+      for (uint32_t r = owned_offsets[d][p]; r < owned_offsets[d][p + 1];
+           r++, l++) {
+        element.l2g_mapping[l] = r2g[d][r];
+        element.l2r_mapping[l] = r;
+      }
+      for (uint32_t r : patches[p].ribbon[d]) {
+        element.l2g_mapping[l] = r2g[d][r];
+        element.l2r_mapping[l] = r;
+        l++;
+      }
+    });
+    element.g2r_mapping = std::move(g2r[d]);
+    result.elements.push_back(std::move(element));
+  }
+
+  for (size_t i = 0; i < relations.size(); i++) {
+    PatchedMesh::Relation relation;
+    relation.from_order = from_end_element_order(relations[i]);
+    relation.to_order = to_end_element_order(relations[i]);
+    std::vector<size_t> value_offsets(num_patches + 1, 0);
+    for (int p = 0; p < num_patches; p++) {
+      value_offsets[p + 1] = value_offsets[p] + patches[p].values[i].size();
+    }
+    relation.value.resize(value_offsets[num_patches]);
+    const bool dynamic = relation.from_order <= relation.to_order;
+    const auto &owned_from = owned_offsets[relation.from_order];
+    if (dynamic) {
+      TI_ERROR_IF(value_offsets[num_patches] >
+                      std::numeric_limits<uint32_t>::max(),
+                  "Relation {} is too large", relation_type_name(relations[i]));
+      relation.patch_offset.resize(num_patches);
+      relation.offset.resize(owned_from[num_patches] + num_patches);
+      for (int p = 0; p < num_patches; p++) {
+        relation.patch_offset[p] = uint32_t(value_offsets[p]);
+      }
+    }
+    parallel_for(num_patches, num_threads, [&](size_t p) {
+      auto &values = patches[p].values[i];
+      std::copy(values.begin(), values.end(),
+                relation.value.begin() + value_offsets[p]);
+      std::vector<uint16_t>().swap(values);
+      if (dynamic) {
+        auto &offsets = patches[p].offsets[i];
+        std::copy(offsets.begin(), offsets.end(),
+                  relation.offset.begin() + p + owned_from[p]);
+        std::vector<uint16_t>().swap(offsets);
+      }
+    });
+    result.relations.push_back(std::move(relation));
+  }
+  return result;
+}
+
+namespace {
+
+// The room to reserve for |n| elements.
+size_t with_slack(size_t n, float slack) {
+  return size_t(std::ceil(double(n) * (1.0 + slack)));
+}
+
+// Records the entries written to the arrays of a dynamic mesh.
+template <typename T>
+void write(std::vector<T> &array,
+           size_t index,
+           uint32_t value,
+           DynamicPatchedMesh::Scatter *scatter) {
+  array[index] = T(value);
+  if (scatter) {
+    scatter->indices.push_back(uint32_t(index));
+    scatter->values.push_back(value);
+  }
+}
+
+// Edges are keyed by their sorted vertices, faces by their sorted vertices.
+uint64_t edge_key(uint32_t a, uint32_t b) {
+  return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+std::array<uint32_t, 3> face_key(std::array<uint32_t, 3> v) {
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+}  // namespace
+
+struct DynamicPatchedMesh::Impl {
+  // The local view of a patch being rebuilt.
+  struct PatchData {
+    // Global indices, owned elements first.
+    std::array<std::vector<uint32_t>, 4> locals;
+    std::vector<std::vector<uint16_t>> values;
+    std::vector<std::vector<uint16_t>> offsets;
+    bool overflow{false};
+  };
+
+  int top{0};
+  int num_threads{1};
+  float slack{0};
+  int num_patches{0};
+  std::vector<MeshRelationType> relations;
+  std::array<std::array<bool, 4>, 4> fixed{}, dynamic{};
+
+  // The connectivity in global indices, with room for |capacity| elements.
+  std::array<size_t, 4> capacity{}, num_ids{};
+  std::array<std::array<std::vector<uint32_t>, 4>, 4> down;
+  std::array<std::vector<bool>, 4> alive;
+  std::array<std::vector<uint32_t>, 4> free_ids;
+  // The number of cells using each edge and face.
+  std::array<std::vector<uint32_t>, 3> uses;
+  std::vector<std::vector<uint32_t>> cells_of_vertex;
+  std::unordered_map<uint64_t, uint32_t> edge_ids;
+  std::map<std::array<uint32_t, 3>, uint32_t> face_ids;
+
+  // Ownership: element e of order d has the reordered index
+  // owner[d][e] * owned_capacity[d] + slot[d][e].
+  std::array<size_t, 4> owned_capacity{}, local_capacity{};
+  std::array<std::vector<uint32_t>, 4> owner, slot;
+  std::array<std::vector<std::vector<uint32_t>>, 4> owned;
+  // The patches seeing each element, and the local view of each patch.
+  std::array<std::vector<std::vector<uint32_t>>, 4> seen_by;
+  std::vector<std::array<std::vector<uint32_t>, 4>> locals;
+  // The segment of each patch in the values of each dynamic relation.
+  std::vector<std::vector<uint32_t>> segment_capacity;
+  std::vector<size_t> value_cursor;
+
+  PatchedMesh mesh;
+
+  uint32_t reordered(int d, uint32_t e) const {
+    return uint32_t(owner[d][e] * owned_capacity[d] + slot[d][e]);
+  }
+
+  bool contains(int a, uint32_t x, int b, uint32_t y) const {
+    const int arity = relation_arity(a, b);
+    const uint32_t *first = down[a][b].data() + size_t(x) * arity;
+    return std::find(first, first + arity, y) != first + arity;
+  }
+
+  void cells_of(int d, uint32_t e, std::vector<uint32_t> &out) const {
+    out.clear();
+    if (d == top) {
+      out.push_back(e);
+      return;
+    }
+    const uint32_t v = d == 0 ? e : down[d][0][size_t(e) * (d + 1)];
+    for (uint32_t c : cells_of_vertex[v]) {
+      if (d == 0 || contains(top, c, d, e)) {
+        out.push_back(c);
+      }
+    }
+  }
+
+  // The |to| elements adjacent to element |e| of order |from|, as the static
+  // patcher defines the relations.
+  void row(int from, int to, uint32_t e, std::vector<uint32_t> &out) const {
+    out.clear();
+    std::vector<uint32_t> tmp;
+    if (from > to) {
+      const int arity = relation_arity(from, to);
+      const uint32_t *first = down[from][to].data() + size_t(e) * arity;
+      out.assign(first, first + arity);
+      return;
+    }
+    if (from < to) {
+      cells_of(from, e, tmp);
+      for (uint32_t c : tmp) {
+        if (to == top) {
+          out.push_back(c);
+          continue;
+        }
+        const int arity = relation_arity(top, to);
+        for (int k = 0; k < arity; k++) {
+          const uint32_t y = down[top][to][size_t(c) * arity + k];
+          if (contains(to, y, from, e)) {
+            out.push_back(y);
+          }
+        }
+      }
+    } else if (from == 0) {
+      // Vertices sharing an edge, that is a cell.
+      for (uint32_t c : cells_of_vertex[e]) {
+        for (int k = 0; k <= top; k++) {
+          const uint32_t v = down[top][0][size_t(c) * (top + 1) + k];
+          if (v != e) {
+            out.push_back(v);
+          }
+        }
+      }
+    } else {
+      // Elements sharing a face of one order lower.
+      std::vector<uint32_t> up;
+      const int arity = relation_arity(from, from - 1);
+      for (int k = 0; k < arity; k++) {
+        row(from - 1, from, down[from][from - 1][size_t(e) * arity + k], up);
+        for (uint32_t x : up) {
+          if (x != e) {
+            out.push_back(x);
+          }
+        }
+      }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  }
+
+  // Mirrors the ribbons and values of the static patcher, in global indices.
+  void build_patch(int p, PatchData &data) const {
+    std::array<std::unordered_map<uint32_t, uint32_t>, 4> local;
+    std::vector<uint32_t> tmp;
+    for (int d = top; d >= 0; d--) {
+      auto &view = data.locals[d];
+      view = owned[d][p];
+      std::vector<uint32_t> ribbon;
+      auto add = [&](uint32_t e) {
+        if (owner[d][e] != uint32_t(p)) {
+          ribbon.push_back(e);
+        }
+      };
+      for (int from = 0; from <= d; from++) {
+        if (!dynamic[from][d]) {
+          continue;
+        }
+        for (uint32_t x : owned[from][p]) {
+          row(from, d, x, tmp);
+          std::for_each(tmp.begin(), tmp.end(), add);
+        }
+      }
+      for (int h = d + 1; h <= top; h++) {
+        if (!fixed[h][d]) {
+          continue;
+        }
+        const int arity = relation_arity(h, d);
+        for (uint32_t x : data.locals[h]) {
+          for (int k = 0; k < arity; k++) {
+            add(down[h][d][size_t(x) * arity + k]);
+          }
+        }
+      }
+      std::sort(ribbon.begin(), ribbon.end(), [&](uint32_t a, uint32_t b) {
+        return reordered(d, a) < reordered(d, b);
+      });
+      ribbon.erase(std::unique(ribbon.begin(), ribbon.end()), ribbon.end());
+      if (view.size() + ribbon.size() > local_capacity[d]) {
+        data.overflow = true;
+        return;
+      }
+      view.insert(view.end(), ribbon.begin(), ribbon.end());
+      for (size_t l = 0; l < view.size(); l++) {
+        local[d][view[l]] = uint32_t(l);
+      }
+    }
+
+    data.values.resize(relations.size());
+    data.offsets.resize(relations.size());
+    for (size_t i = 0; i < relations.size(); i++) {
+      const int from = from_end_element_order(relations[i]);
+      const int to = to_end_element_order(relations[i]);
+      auto &values = data.values[i];
+      if (from > to) {
+        const int arity = relation_arity(from, to);
+        for (uint32_t x : data.locals[from]) {
+          for (int k = 0; k < arity; k++) {
+            values.push_back(
+                uint16_t(local[to].at(down[from][to][size_t(x) * arity + k])));
+          }
+        }
+        continue;
+      }
+      auto &offsets = data.offsets[i];
+      offsets.push_back(0);
+      for (uint32_t x : owned[from][p]) {
+        const size_t begin = values.size();
+        row(from, to, x, tmp);
+        for (uint32_t y : tmp) {
+          values.push_back(uint16_t(local[to].at(y)));
+        }
+        std::sort(values.begin() + begin, values.end());
+        if (values.size() > kMaxLocalIndex) {
+          data.overflow = true;
+          return;
+        }
+        offsets.push_back(uint16_t(values.size()));
+      }
+    }
+  }
+
+  // Writes the rebuilt view of patch |p| to the arrays of |mesh|.
+  void commit(int p, PatchData &data, Update *update) {
+    for (int d = 0; d <= top; d++) {
+      auto &element = mesh.elements[d];
+      auto *scatter = update ? &update->elements[d] : nullptr;
+      const auto &view = data.locals[d];
+      write(element.owned_nums, p, uint32_t(owned[d][p].size()),
+            scatter ? &scatter->owned_nums : nullptr);
+      write(element.total_nums, p, uint32_t(view.size()),
+            scatter ? &scatter->total_nums : nullptr);
+      const size_t begin = size_t(p) * local_capacity[d];
+      for (size_t l = 0; l < local_capacity[d]; l++) {
+        const bool used = l < view.size();
+        write(element.l2g_mapping, begin + l, used ? view[l] : 0,
+              scatter ? &scatter->l2g_mapping : nullptr);
+        write(element.l2r_mapping, begin + l, used ? reordered(d, view[l]) : 0,
+              scatter ? &scatter->l2r_mapping : nullptr);
+      }
+      for (uint32_t e : locals[p][d]) {
+        auto &patches = seen_by[d][e];
+        patches.erase(std::find(patches.begin(), patches.end(), uint32_t(p)));
+      }
+      for (uint32_t e : view) {
+        seen_by[d][e].push_back(uint32_t(p));
+      }
+      locals[p][d] = std::move(data.locals[d]);
+    }
+
+    for (size_t i = 0; i < relations.size(); i++) {
+      auto &relation = mesh.relations[i];
+      auto *scatter = update ? &update->relations[i] : nullptr;
+      const auto &values = data.values[i];
+      const int from = relation.from_order;
+      const int to = relation.to_order;
+      if (from > to) {
+        const size_t size = local_capacity[from] * relation_arity(from, to);
+        for (size_t j = 0; j < size; j++) {
+          write(relation.value, p * size + j,
+                j < values.size() ? values[j] : 0,
+                scatter ? &scatter->value : nullptr);
+        }
+        continue;
+      }
+      const auto &offsets = data.offsets[i];
+      const size_t begin = size_t(p) * (owned_capacity[from] + 1);
+      for (size_t l = 0; l < offsets.size(); l++) {
+        write(relation.offset, begin + l, offsets[l],
+              scatter ? &scatter->offset : nullptr);
+      }
+      if (values.size() > segment_capacity[i][p]) {
+        // Moves the patch to the room left at the end of the values.
+        const size_t size = with_slack(values.size(), slack);
+        TI_ERROR_IF(value_cursor[i] + size > relation.value.size(),
+                    "Relation {} of the dynamic mesh is out of room, patch "
+                    "the mesh again with a larger slack",
+                    relation_type_name(relations[i]));
+        segment_capacity[i][p] = uint32_t(size);
+        write(relation.patch_offset, p, uint32_t(value_cursor[i]),
+              scatter ? &scatter->patch_offset : nullptr);
+        value_cursor[i] += size;
+      }
+      for (size_t j = 0; j < values.size(); j++) {
+        write(relation.value, relation.patch_offset[p] + j, values[j],
+              scatter ? &scatter->value : nullptr);
+      }
+    }
+  }
+
+  void rebuild(const std::vector<int> &patches, Update *update) {
+    std::vector<PatchData> data(patches.size());
+    parallel_for(patches.size(), num_threads,
+                 [&](size_t i) { build_patch(patches[i], data[i]); });
+    for (size_t i = 0; i < patches.size(); i++) {
+      TI_ERROR_IF(data[i].overflow,
+                  "Patch {} of the dynamic mesh is out of room, patch the "
+                  "mesh again with a larger slack",
+                  patches[i]);
+    }
+    for (size_t i = 0; i < patches.size(); i++) {
+      commit(patches[i], data[i], update);
+    }
+  }
+
+  void set_g2r(int d, uint32_t e, Update *update) {
+    write(mesh.elements[d].g2r_mapping, e,
+          owner[d][e] == kInvalid ? 0 : reordered(d, e),
+          update ? &update->elements[d].g2r_mapping : nullptr);
+  }
+
+  uint32_t allocate(int d) {
+    uint32_t e;
+    if (!free_ids[d].empty()) {
+      e = free_ids[d].back();
+      free_ids[d].pop_back();
+    } else {
+      TI_ERROR_IF(num_ids[d] >= capacity[d],
+                  "The dynamic mesh is out of room for {}, patch the mesh "
+                  "again with a larger slack",
+                  element_type_name(MeshElementType(d)));
+      e = uint32_t(num_ids[d]++);
+    }
+    alive[d][e] = true;
+    return e;
+  }
+
+  uint32_t least_owned(int d) const {
+    uint32_t p = 0;
+    for (int q = 1; q < num_patches; q++) {
+      if (owned[d][q].size() < owned[d][p].size()) {
+        p = q;
+      }
+    }
+    return p;
+  }
+
+  // Makes patch |p| own element |e|, or the patch owning the fewest elements
+  // of its order if |p| is full. Returns the owner.
+  uint32_t own(int d, uint32_t e, uint32_t p, Update *update) {
+    if (owned[d][p].size() >= owned_capacity[d]) {
+      p = least_owned(d);
+    }
+    TI_ERROR_IF(owned[d][p].size() >= owned_capacity[d],
+                "The patches of the dynamic mesh are out of room for {}, "
+                "patch the mesh again with a larger slack",
+                element_type_name(MeshElementType(d)));
+    owner[d][e] = p;
+    slot[d][e] = uint32_t(owned[d][p].size());
+    owned[d][p].push_back(e);
+    set_g2r(d, e, update);
+    return p;
+  }
+
+  // Frees element |e|, filling its slot with the last element of its patch.
+  void release(int d, uint32_t e, Update &update, std::vector<bool> &dirty) {
+    const uint32_t p = owner[d][e];
+    auto &list = owned[d][p];
+    const uint32_t last = list.back();
+    if (last != e) {
+      const uint32_t from = reordered(d, last);
+      list[slot[d][e]] = last;
+      slot[d][last] = slot[d][e];
+      update.moved[d].emplace_back(from, reordered(d, last));
+      set_g2r(d, last, &update);
+      mark(d, last, dirty);
+    }
+    list.pop_back();
+    owner[d][e] = kInvalid;
+    alive[d][e] = false;
+    free_ids[d].push_back(e);
+    set_g2r(d, e, &update);
+  }
+
+  void mark(int d, uint32_t e, std::vector<bool> &dirty) const {
+    if (owner[d][e] != kInvalid) {
+      dirty[owner[d][e]] = true;
+    }
+    for (uint32_t p : seen_by[d][e]) {
+      dirty[p] = true;
+    }
+  }
+
+  // Marks the patches seeing any element incident to a vertex of cell |c|,
+  // which are all the elements whose relations |c| can change.
+  void mark_star(uint32_t c, std::vector<bool> &dirty) const {
+    for (int k = 0; k <= top; k++) {
+      const uint32_t v = down[top][0][size_t(c) * (top + 1) + k];
+      mark(0, v, dirty);
+      for (uint32_t x : cells_of_vertex[v]) {
+        mark(top, x, dirty);
+        for (int d = 1; d < top; d++) {
+          const int arity = relation_arity(top, d);
+          for (int i = 0; i < arity; i++) {
+            mark(d, down[top][d][size_t(x) * arity + i], dirty);
+          }
+        }
+      }
+    }
+  }
+
+  void remove_cell(uint32_t c, Update &update, std::vector<bool> &dirty) {
+    mark_star(c, dirty);
+    const int cell_size = top + 1;
+    for (int k = 0; k < cell_size; k++) {
+      auto &cells = cells_of_vertex[down[top][0][size_t(c) * cell_size + k]];
+      cells.erase(std::find(cells.begin(), cells.end(), c));
+    }
+    for (int d = 1; d < top; d++) {
+      const int arity = relation_arity(top, d);
+      for (int k = 0; k < arity; k++) {
+        const uint32_t x = down[top][d][size_t(c) * arity + k];
+        if (--uses[d][x] > 0) {
+          continue;
+        }
+        if (d == 1) {
+          edge_ids.erase(edge_key(down[1][0][x * 2], down[1][0][x * 2 + 1]));
+        } else {
+          const uint32_t *v = down[2][0].data() + size_t(x) * 3;
+          face_ids.erase(face_key({v[0], v[1], v[2]}));
+        }
+        release(d, x, update, dirty);
+      }
+    }
+    release(top, c, update, dirty);
+  }
+
+  uint32_t add_edge(uint32_t a, uint32_t b, uint32_t p, Update &update) {
+    auto [it, inserted] = edge_ids.emplace(edge_key(a, b), 0);
+    if (inserted) {
+      it->second = allocate(1);
+      down[1][0][it->second * 2] = std::min(a, b);
+      down[1][0][it->second * 2 + 1] = std::max(a, b);
+      own(1, it->second, p, &update);
+      update.added[1].push_back(it->second);
+    }
+    return it->second;
+  }
+
+  void add_cell(const uint32_t *vertices, Update &update,
+                std::vector<bool> &dirty) {
+    const int cell_size = top + 1;
+    // Preferably owned by the patch owning its first vertex, and its new
+    // vertices, edges and faces by the patch owning the cell.
+    uint32_t p = kInvalid;
+    for (int k = 0; k < cell_size && p == kInvalid; k++) {
+      p = owner[0][vertices[k]];
+    }
+    const uint32_t c = allocate(top);
+    p = own(top, c, p == kInvalid ? least_owned(top) : p, &update);
+    update.added[top].push_back(c);
+    for (int k = 0; k < cell_size; k++) {
+      down[top][0][size_t(c) * cell_size + k] = vertices[k];
+      if (owner[0][vertices[k]] == kInvalid) {
+        own(0, vertices[k], p, &update);
+      }
+      cells_of_vertex[vertices[k]].push_back(c);
+    }
+    const int num_cell_edges = top == 3 ? 6 : 3;
+    for (int k = 0; k < num_cell_edges; k++) {
+      const int *e = top == 3 ? kTetEdges[k] : kTriangleEdges[k];
+      const uint32_t x = add_edge(vertices[e[0]], vertices[e[1]], p, update);
+      down[top][1][size_t(c) * num_cell_edges + k] = x;
+      uses[1][x]++;
+    }
+    if (top == 3) {
+      for (int k = 0; k < 4; k++) {
+        std::array<uint32_t, 3> v;
+        for (int i = 0; i < 3; i++) {
+          v[i] = vertices[kTetFaces[k][i]];
+        }
+        auto [it, inserted] = face_ids.emplace(face_key(v), 0);
+        if (inserted) {
+          // Oriented as in the cell creating it.
+          const uint32_t f = allocate(2);
+          it->second = f;
+          for (int i = 0; i < 3; i++) {
+            down[2][0][f * 3 + i] = v[i];
+            down[2][1][f * 3 + i] =
+                edge_ids.at(edge_key(v[kTriangleEdges[i][0]],
+                                     v[kTriangleEdges[i][1]]));
+          }
+          own(2, f, p, &update);
+          update.added[2].push_back(f);
+        }
+        down[3][2][size_t(c) * 4 + k] = it->second;
+        uses[2][it->second]++;
+      }
+    }
+    mark_star(c, dirty);
+  }
+
+  Impl(MeshTopology topology,
+       const std::vector<float> &positions,
+       const std::vector<uint32_t> &cells,
+       const std::vector<MeshRelationType> &relations_,
+       const MeshPatcherConfig &config,
+       float slack_)
+      : slack(slack_), relations(relations_) {
+    TI_ERROR_IF(!(slack >= 0), "The slack of a dynamic mesh must be >= 0");
+    GlobalMesh global;
+    init_mesh(global, topology, positions, cells, relations);
+    top = global.top;
+    num_threads = resolve_num_threads(config);
+    build_elements(global, cells, num_threads);
+    const Partition partition = partition_cells(
+        global, positions, resolve_max_elements(config), num_threads);
+    num_patches = partition.num_patches;
+    const Ownership ownership = assign_owners(global, partition);
+    for (auto rel : relations) {
+      const int from = from_end_element_order(rel);
+      const int to = to_end_element_order(rel);
+      (from > to ? fixed : dynamic)[from][to] = true;
+    }
+
+    for (int d = 0; d <= top; d++) {
+      const auto &offsets = ownership.owned_offsets[d];
+      size_t max_owned = 1;
+      for (int p = 0; p < num_patches; p++) {
+        max_owned = std::max<size_t>(max_owned, offsets[p + 1] - offsets[p]);
+      }
+      owned_capacity[d] = std::min(with_slack(max_owned, slack),
+                                   kMaxLocalIndex + 1);
+      capacity[d] = std::max(with_slack(global.num[d], slack),
+                             num_patches * owned_capacity[d]);
+      num_ids[d] = global.num[d];
+      alive[d].assign(capacity[d], false);
+      std::fill(alive[d].begin(), alive[d].begin() + num_ids[d], true);
+      owner[d].assign(capacity[d], kInvalid);
+      slot[d].assign(capacity[d], 0);
+      owned[d].resize(num_patches);
+      seen_by[d].resize(capacity[d]);
+      for (int p = 0; p < num_patches; p++) {
+        for (uint32_t r = offsets[p]; r < offsets[p + 1]; r++) {
+          const uint32_t e = ownership.r2g[d][r];
+          owner[d][e] = p;
+          slot[d][e] = r - offsets[p];
+          owned[d][p].push_back(e);
+        }
+      }
+      for (int b = 0; b < d; b++) {
+        down[d][b] = global.down[d][b];
+        down[d][b].resize(capacity[d] * relation_arity(d, b));
+      }
+    }
+    cells_of_vertex.resize(capacity[0]);
+    for (size_t c = 0; c < global.num[top]; c++) {
+      for (int k = 0; k <= top; k++) {
+        cells_of_vertex[cells[c * (top + 1) + k]].push_back(uint32_t(c));
+      }
+    }
+    for (int d = 1; d < top; d++) {
+      uses[d].assign(capacity[d], 0);
+      for (uint32_t x : global.down[top][d]) {
+        uses[d][x]++;
+      }
+    }
+    for (size_t e = 0; e < global.num[1]; e++) {
+      edge_ids[edge_key(down[1][0][e * 2], down[1][0][e * 2 + 1])] =
+          uint32_t(e);
+    }
+    if (top == 3) {
+      for (size_t f = 0; f < global.num[2]; f++) {
+        face_ids[face_key({down[2][0][f * 3], down[2][0][f * 3 + 1],
+                           down[2][0][f * 3 + 2]})] = uint32_t(f);
+      }
+    }
+
+    // Sizes the local ranges after the first build of all patches.
+    std::vector<PatchData> data(num_patches);
+    local_capacity.fill(kMaxLocalIndex + 1);
+    parallel_for(num_patches, num_threads,
+                 [&](size_t p) { build_patch(int(p), data[p]); });
+    for (int p = 0; p < num_patches; p++) {
+      TI_ERROR_IF(data[p].overflow,
+                  "Patch {} of the mesh exceeds {} local elements, decrease "
+                  "max_elements_per_patch",
+                  p, kMaxLocalIndex + 1);
+    }
+    mesh.num_patches = num_patches;
+    for (int d = 0; d <= top; d++) {
+      size_t max_total = 0;
+      for (int p = 0; p < num_patches; p++) {
+        max_total = std::max(max_total, data[p].locals[d].size());
+      }
+      local_capacity[d] = std::clamp<size_t>(
+          (with_slack(max_total, slack) + 31) / 32 * 32, max_total,
+          kMaxLocalIndex + 1);
+      PatchedMesh::Element element;
+      element.order = d;
+      element.num = int(capacity[d]);
+      element.max_num_per_patch = int(local_capacity[d]);
+      for (int p = 0; p <= num_patches; p++) {
+        element.owned_offsets.push_back(uint32_t(p * owned_capacity[d]));
+        element.total_offsets.push_back(uint32_t(p * local_capacity[d]));
+      }
+      element.owned_nums.resize(num_patches);
+      element.total_nums.resize(num_patches);
+      element.l2g_mapping.resize(num_patches * local_capacity[d]);
+      element.l2r_mapping.resize(num_patches * local_capacity[d]);
+      element.g2r_mapping.resize(capacity[d]);
+      mesh.elements.push_back(std::move(element));
+      for (size_t e = 0; e < num_ids[d]; e++) {
+        set_g2r(d, uint32_t(e), nullptr);
+      }
+    }
+    segment_capacity.resize(relations.size());
+    value_cursor.resize(relations.size());
+    for (size_t i = 0; i < relations.size(); i++) {
+      PatchedMesh::Relation relation;
+      relation.from_order = from_end_element_order(relations[i]);
+      relation.to_order = to_end_element_order(relations[i]);
+      if (relation.from_order > relation.to_order) {
+        relation.value.resize(
+            num_patches * local_capacity[relation.from_order] *
+            relation_arity(relation.from_order, relation.to_order));
+      } else {
+        relation.offset.resize(num_patches *
+                               (owned_capacity[relation.from_order] + 1));
+        relation.patch_offset.resize(num_patches);
+        size_t size = 0;
+        for (int p = 0; p < num_patches; p++) {
+          relation.patch_offset[p] = uint32_t(size);
+          segment_capacity[i].push_back(
+              uint32_t(with_slack(data[p].values[i].size(), slack)));
+          size += segment_capacity[i].back();
+        }
+        value_cursor[i] = size;
+        size = with_slack(size, slack);
+        TI_ERROR_IF(size > std::numeric_limits<uint32_t>::max(),
+                    "Relation {} is too large",
+                    relation_type_name(relations[i]));
+        relation.value.resize(size);
+      }
+      mesh.relations.push_back(std::move(relation));
+    }
+    locals.resize(num_patches);
+    for (int p = 0; p < num_patches; p++) {
+      commit(p, data[p], nullptr);
+    }
+  }
+
+  Update update(const std::vector<uint32_t> &removed_cells,
+                const std::vector<uint32_t> &added_cells,
+                uint32_t num_added_vertices) {
+    const int cell_size = top + 1;
+    TI_ERROR_IF(added_cells.size() % cell_size != 0,
+                "Mesh cells must hold {} vertices each", cell_size);
+    TI_ERROR_IF(num_ids[0] + num_added_vertices > capacity[0],
+                "The dynamic mesh is out of room for verts, patch the mesh "
+                "again with a larger slack");
+    {
+      std::vector<uint32_t> sorted = removed_cells;
+      std::sort(sorted.begin(), sorted.end());
+      TI_ERROR_IF(std::adjacent_find(sorted.begin(), sorted.end()) !=
+                      sorted.end(),
+                  "A cell is removed twice");
+      for (uint32_t c : sorted) {
+        TI_ERROR_IF(c >= num_ids[top] || !alive[top][c],
+                    "Cell {} is not in the mesh", c);
+      }
+      for (size_t i = 0; i < added_cells.size(); i += cell_size) {
+        for (int k = 0; k < cell_size; k++) {
+          TI_ERROR_IF(added_cells[i + k] >= num_ids[0] + num_added_vertices,
+                      "Mesh cell refers to vertex {} of {}",
+                      added_cells[i + k], num_ids[0] + num_added_vertices);
+          for (int j = 0; j < k; j++) {
+            TI_ERROR_IF(added_cells[i + j] == added_cells[i + k],
+                        "Mesh cell repeats vertex {}", added_cells[i + k]);
+          }
+        }
+      }
+    }
+
+    Update update;
+    update.elements.resize(top + 1);
+    update.relations.resize(relations.size());
+    std::vector<bool> dirty(num_patches, false);
+    for (uint32_t c : removed_cells) {
+      remove_cell(c, update, dirty);
+    }
+    for (uint32_t i = 0; i < num_added_vertices; i++) {
+      const uint32_t v = allocate(0);
+      update.added[0].push_back(v);
+    }
+    for (size_t i = 0; i < added_cells.size(); i += cell_size) {
+      add_cell(added_cells.data() + i, update, dirty);
+    }
+    // Vertices not in any cell go to the patch owning the fewest vertices.
+    for (uint32_t v : update.added[0]) {
+      if (owner[0][v] == kInvalid) {
+        dirty[own(0, v, least_owned(0), &update)] = true;
+      }
+    }
+    for (int p = 0; p < num_patches; p++) {
+      if (dirty[p]) {
+        update.dirty_patches.push_back(p);
+      }
+    }
+    rebuild(update.dirty_patches, &update);
+    return update;
+  }
+};
+
+DynamicPatchedMesh::DynamicPatchedMesh(
+    MeshTopology topology,
+    const std::vector<float> &positions,
+    const std::vector<uint32_t> &cells,
+    const std::vector<MeshRelationType> &relations,
+    const MeshPatcherConfig &config,
+    float slack)
+    : impl_(std::make_unique<Impl>(topology, positions, cells, relations,
+                                   config, slack)) {
+}
+
+DynamicPatchedMesh::~DynamicPatchedMesh() = default;
+
+const PatchedMesh &DynamicPatchedMesh::mesh() const {
+  return impl_->mesh;
+}
+
+DynamicPatchedMesh::Update DynamicPatchedMesh::update(
+    const std::vector<uint32_t> &removed_cells,
+    const std::vector<uint32_t> &added_cells,
+    uint32_t num_added_vertices) {
+  return impl_->update(removed_cells, added_cells, num_added_vertices);
+}
+
+}  // namespace mesh
+}  // namespace taichi::lang
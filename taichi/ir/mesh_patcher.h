@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "taichi/ir/mesh.h"
+
+namespace taichi::lang {
+namespace mesh {
+
+struct MeshPatcherConfig {
+  // The number of elements of any type the owned cells of a patch may touch.
+  // If 0, it is derived from |shared_memory_bytes| / |bytes_per_element|, so
+  // that the attributes a kernel caches in block local storage fit.
+  int max_elements_per_patch{0};
+  int shared_memory_bytes{48 * 1024};
+  int bytes_per_element{32};
+  // 0 uses std::thread::hardware_concurrency().
+  int num_threads{0};
+};
+
+// The patched mesh in the layout of the metadata MeshTaichi loads, see
+// MeshMetadata in python/taichi/lang/mesh.py:
+//  - Each patch owns a contiguous range of the reordered index space of every
+//    element type, and sees the elements it owns followed by the ribbon of
+//    elements owned by other patches that its relations reach, in the order
+//    of their reordered indices.
+//  - Mappings are indexed by total_offsets[patch] + local index.
+//  - Fixed (high-to-low) relations store |arity| local indices per element
+//    in a patch, dynamic ones a CSR of local indices per owned element.
+struct PatchedMesh {
+  struct Element {
+    int order{0};
+    int num{0};
+    int max_num_per_patch{0};
+    std::vector<uint32_t> owned_offsets;
+    std::vector<uint32_t> total_offsets;
+    std::vector<uint32_t> l2g_mapping;
+    std::vector<uint32_t> l2r_mapping;
+    std::vector<uint32_t> g2r_mapping;
+    // Only for meshes whose patches leave room to grow, see
+    // DynamicPatchedMesh: the numbers of owned and total elements of each
+    // patch, which no longer follow from the offsets.
+    std::vector<uint32_t> owned_nums;
+    std::vector<uint32_t> total_nums;
+  };
+
+  struct Relation {
+    int from_order{0};
+    int to_order{0};
+    std::vector<uint16_t> value;
+    // Only for dynamic relations.
+    std::vector<uint16_t> offset;
+    std::vector<uint32_t> patch_offset;
+  };
+
+  int num_patches{0};
+  std::vector<Element> elements;
+  std::vector<Relation> relations;
+};
+
+// Derives the edges (and faces of tetrahedra) of a mesh given by its cells,
+// and partitions it into patches along a Morton curve through the cell
+// centroids. Elements are renumbered in the order the curve first touches
+// them, so that neighbouring elements have nearby reordered indices.
+//
+// |positions| holds 3 floats per vertex, |cells| the vertices of each
+// triangle or tetrahedron as given by |topology|.
+PatchedMesh patch_mesh(MeshTopology topology,
+                       const std::vector<float> &positions,
+                       const std::vector<uint32_t> &cells,
+                       const std::vector<MeshRelationType> &relations,
+                       const MeshPatcherConfig &config);
+
+// A patched mesh that follows local insertions and removals of cells without
+// being patched again from scratch. Each patch gets room to grow by |slack|:
+//  - The owned range of a patch in the reordered index space, its range of
+//    local indices and its segment of each relation are reserved up front, so
+//    offsets never move and owned_nums / total_nums hold the actual counts.
+//  - An update only rebuilds the patches whose local view it changes, and
+//    reports the entries of the arrays that differ from the previous mesh().
+// Vertices are never removed, and the global indices of removed edges, faces
+// and cells are reused by later insertions. Running out of room is an error,
+// after which the mesh has to be patched again with a larger |slack|.
+class DynamicPatchedMesh {
+ public:
+  // Entries to overwrite in an array of mesh(), in order.
+  struct Scatter {
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> values;
+  };
+
+  struct Update {
+    struct Element {
+      Scatter owned_nums, total_nums;
+      Scatter l2g_mapping, l2r_mapping, g2r_mapping;
+    };
+    struct Relation {
+      Scatter value, offset, patch_offset;
+    };
+
+    std::vector<int> dirty_patches;
+    // Global indices of the inserted elements of each order.
+    std::array<std::vector<uint32_t>, 4> added;
+    // Elements that changed their reordered index, as (from, to) pairs.
+    // Attributes placed with reorder=True have to be copied along, in order.
+    std::array<std::vector<std::pair<uint32_t, uint32_t>>, 4> moved;
+    std::vector<Element> elements;
+    std::vector<Relation> relations;
+  };
+
+  DynamicPatchedMesh(MeshTopology topology,
+                     const std::vector<float> &positions,
+                     const std::vector<uint32_t> &cells,
+                     const std::vector<MeshRelationType> &relations,
+                     const MeshPatcherConfig &config,
+                     float slack);
+  ~DynamicPatchedMesh();
+
+  const PatchedMesh &mesh() const;
+
+  // Removes the cells with global indices |removed_cells|, then appends
+  // |num_added_vertices| vertices and inserts |added_cells|, which holds the
+  // vertices of each new cell like the cells passed to the constructor.
+  Update update(const std::vector<uint32_t> &removed_cells,
+                const std::vector<uint32_t> &added_cells,
+                uint32_t num_added_vertices);
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace mesh
+}  // namespace taichi::lang
@@ -127,7 +127,27 @@ SNode &SNode::dynamic(const Axis &expr,
                       int chunk_size,
                       const std::string &tb) {
   auto &snode = create_node({expr}, {n}, SNodeType::dynamic, tb);
-  snode.chunk_size = chunk_size;
+  // Chunks are indexed through a directory of at most
+  // taichi_max_num_dynamic_chunks entries. Larger chunks are used if the
+  // requested ones do not fit.
+  const int64 min_chunk_size =
+      (snode.num_cells_per_container + taichi_max_num_dynamic_chunks - 1) /
+      taichi_max_num_dynamic_chunks;
+  snode.chunk_size = std::max<int64>(chunk_size, min_chunk_size);
+  return snode;
+}
+
+SNode &SNode::hash(const std::vector<Axis> &axes,
+                   const std::vector<int> &sizes,
+                   int table_size,
+                   const std::string &tb) {
+  auto &snode = create_node(axes, sizes, SNodeType::hash, tb);
+  if (table_size <= 0) {
+    throw TaichiRuntimeError("The table size of a hash SNode must be positive");
+  }
+  // There is no point in more slots than cells.
+  snode.hash_table_size =
+      (int)std::min<int64>(table_size, snode.num_cells_per_container);
   return snode;
 }
 
@@ -194,6 +214,16 @@ void SNode::write_float(const std::vector<int> &i, float64 val) {
   snode_rw_accessors_bank_->get(this).write_float(i, val);
 }
 
+void SNode::read_batch(uint64 indices_ptr, uint64 values_ptr, int n) {
+  snode_rw_accessors_bank_->get_batch(this).read_batch(indices_ptr, values_ptr,
+                                                       n);
+}
+
+void SNode::write_batch(uint64 indices_ptr, uint64 values_ptr, int n) {
+  snode_rw_accessors_bank_->get_batch(this).write_batch(indices_ptr,
+                                                        values_ptr, n);
+}
+
 Expr SNode::get_expr() const {
   return Expr(snode_to_fields_->at(this));
 }
@@ -251,6 +281,48 @@ int SNode::get_num_bits(int physical_index) const {
   return result;
 }
 
+SNode &SNode::morton(bool val) {
+  if (val) {
+    TI_ERROR_IF(type != SNodeType::dense,
+                "Only dense SNodes can be Morton-ordered, got {}.",
+                snode_type_name(type));
+    for (int i = 0; i < taichi_max_num_indices; i++) {
+      TI_ERROR_IF(extractors[i].active &&
+                      !bit::is_power_of_two(extractors[i].shape),
+                  "The shape of a Morton-ordered SNode has to be powers of "
+                  "two, got {} on axis {}.",
+                  extractors[i].shape, char('i' + i));
+    }
+  }
+  _morton = val;
+  return *this;
+}
+
+std::vector<MortonRun> SNode::morton_runs(int physical_index) const {
+  std::vector<MortonRun> runs;
+  const int num_bits = extractors[physical_index].num_bits;
+  int index_bit = 0;
+  for (int b = 0; b < num_bits; b++) {
+    // Bit |b| of each axis, from the last one, comes after bit |b - 1| of all
+    // the axes.
+    for (int i = taichi_max_num_indices - 1; i >= 0; i--) {
+      if (b >= extractors[i].num_bits) {
+        continue;
+      }
+      if (i == physical_index) {
+        if (!runs.empty() && runs.back().index_bit + runs.back().num_bits ==
+                                 index_bit) {
+          runs.back().num_bits++;
+        } else {
+          runs.push_back({b, index_bit, 1});
+        }
+      }
+      index_bit++;
+    }
+  }
+  return runs;
+}
+
 void SNode::print() {
   for (int i = 0; i < depth; i++) {
     fmt::print("  ");
@@ -346,6 +418,11 @@ SNode *SNode::get_dual() const {
   return grad_info->dual_snode();
 }
 
+SNode *SNode::get_dual_lane(int lane) const {
+  TI_ASSERT(has_dual());
+  return grad_info->dual_lane_snode(lane);
+}
+
 void SNode::set_snode_tree_id(int id) {
   snode_tree_id_ = id;
   for (auto &child : ch) {
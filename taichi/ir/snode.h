@@ -31,6 +31,22 @@ class Axis {
   }
 };
 
+/**
+ * A run of consecutive bits of the coordinate on an axis of a Morton-ordered
+ * SNode, which are also consecutive in the linearized index.
+ */
+struct MortonRun {
+  /**
+   * The first bit of the run in the coordinate.
+   */
+  int coord_bit{0};
+  /**
+   * The first bit of the run in the linearized index.
+   */
+  int index_bit{0};
+  int num_bits{0};
+};
+
 /**
  * SNode shape metadata at a specific Axis.
  */
@@ -94,6 +110,11 @@ class SNode {
     virtual SNode *adjoint_snode() const = 0;
     virtual SNode *dual_snode() const = 0;
     virtual SNode *adjoint_checkbit_snode() const = 0;
+    // The dual of tangent |lane| in batched forward-mode autodiff, where lane
+    // 0 is dual_snode().
+    virtual SNode *dual_lane_snode(int lane) const {
+      return lane == 0 ? dual_snode() : nullptr;
+    }
 
     template <typename T>
     T *cast() {
@@ -125,6 +146,8 @@ class SNode {
   int total_num_bits{0};
   int total_bit_start{0};
   int chunk_size{0};
+  // The number of slots in the table of a hash SNode.
+  int hash_table_size{0};
   std::size_t cell_size_bytes{0};
   std::size_t offset_bytes_in_parent_cell{0};
   DataType dt;
@@ -222,17 +245,8 @@ class SNode {
 
   SNode &hash(const std::vector<Axis> &axes,
               const std::vector<int> &sizes,
-              const std::string &tb) {
-    return create_node(axes, sizes, SNodeType::hash, tb);
-  }
-
-  SNode &hash(const std::vector<Axis> &axes, int sizes, const std::string &tb) {
-    return create_node(axes, std::vector<int>{sizes}, SNodeType::hash, tb);
-  }
-
-  SNode &hash(const Axis &axis, int size, const std::string &tb) {
-    return hash(std::vector<Axis>{axis}, size, tb);
-  }
+              int table_size,
+              const std::string &tb);
 
   std::string type_name() {
     return snode_type_name(type);
@@ -254,10 +268,14 @@ class SNode {
                  int chunk_size,
                  const std::string &tb);
 
-  SNode &morton(bool val = true) {
-    _morton = val;
-    return *this;
-  }
+  // Orders the cells of a dense SNode along a Z-order (Morton) curve: the
+  // bits of the coordinates are interleaved in the linearized index, starting
+  // with the least significant bit of the last axis.
+  SNode &morton(bool val = true);
+
+  // The runs of bits of the coordinate on |physical_index| in the linearized
+  // index of a Morton-ordered SNode, from the least significant one.
+  std::vector<MortonRun> morton_runs(int physical_index) const;
 
   int child_id(SNode *c) {
     for (int i = 0; i < (int)ch.size(); i++) {
@@ -299,6 +317,9 @@ class SNode {
 
   SNode *get_dual() const;
 
+  // Returns nullptr if the dual has no such lane.
+  SNode *get_dual_lane(int lane) const;
+
   SNode *get_least_sparse_ancestor() const;
 
   std::string get_name() const {
@@ -323,6 +344,11 @@ class SNode {
     return num_cells_per_container;
   }
 
+  // The length of the chunk directory of a dynamic SNode.
+  int num_dynamic_chunks() const {
+    return (int)((num_cells_per_container + chunk_size - 1) / chunk_size);
+  }
+
   int64 get_total_num_elements_towards_root() const {
     int64 total_num_elemts = 1;
     for (auto *s = this; s != nullptr; s = s->parent)
@@ -347,6 +373,10 @@ class SNode {
   float64 read_float(const std::vector<int> &i);
   void write_int(const std::vector<int> &i, int64 val);
   void write_float(const std::vector<int> &i, float64 val);
+  // |n| elements at the [n, num_active_indices] i32 indices at |indices_ptr|,
+  // in one kernel launch.
+  void read_batch(uint64 indices_ptr, uint64 values_ptr, int n);
+  void write_batch(uint64 indices_ptr, uint64 values_ptr, int n);
 
   Expr get_expr() const;
 
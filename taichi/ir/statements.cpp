@@ -223,6 +223,9 @@ std::unique_ptr<Stmt> StructForStmt::clone() const {
   auto new_stmt = std::make_unique<StructForStmt>(
       snode, body->clone(), is_bit_vectorized, num_cpu_threads, block_dim);
   new_stmt->mem_access_opt = mem_access_opt;
+  new_stmt->tile_shape = tile_shape;
+  new_stmt->sort_elements = sort_elements;
+  new_stmt->balance_elements = balance_elements;
   return new_stmt;
 }
 
@@ -332,12 +335,16 @@ std::unique_ptr<Stmt> OffloadedStmt::clone() const {
   new_stmt->const_end = const_end;
   new_stmt->begin_value = begin_value;
   new_stmt->end_value = end_value;
+  new_stmt->index_type = index_type;
   new_stmt->grid_dim = grid_dim;
   new_stmt->block_dim = block_dim;
   new_stmt->reversed = reversed;
   new_stmt->is_bit_vectorized = is_bit_vectorized;
   new_stmt->num_cpu_threads = num_cpu_threads;
   new_stmt->index_offsets = index_offsets;
+  new_stmt->tile_shape = tile_shape;
+  new_stmt->sort_elements = sort_elements;
+  new_stmt->balance_elements = balance_elements;
 
   new_stmt->mesh = mesh;
   new_stmt->major_from_type = major_from_type;
@@ -977,6 +977,13 @@ class StructForStmt : public Stmt {
   int num_cpu_threads;
   int block_dim;
   MemoryAccessOptions mem_access_opt;
+  std::vector<int> tile_shape;
+  // Generate the element lists in coordinate order, see
+  // element_listgen_nonroot_sorted in the LLVM runtime.
+  bool sort_elements{false};
+  // Run the cells of the elements on the GPU threads one by one instead of an
+  // element per block, see gpu_balanced_struct_for in the LLVM runtime.
+  bool balance_elements{false};
 
   StructForStmt(SNode *snode,
                 std::unique_ptr<Block> &&body,
@@ -995,7 +1002,10 @@ class StructForStmt : public Stmt {
                      is_bit_vectorized,
                      num_cpu_threads,
                      block_dim,
-                     mem_access_opt);
+                     mem_access_opt,
+                     tile_shape,
+                     sort_elements,
+                     balance_elements);
   TI_DEFINE_ACCEPT
 };
 
@@ -1329,8 +1339,11 @@ class OffloadedStmt : public Stmt {
   std::size_t end_offset{0};
   bool const_begin{false};
   bool const_end{false};
-  int32 begin_value{0};
-  int32 end_value{0};
+  int64 begin_value{0};
+  int64 end_value{0};
+  // Type of the range-for index, i32 or i64. 64-bit indices are only supported
+  // on LLVM backends.
+  DataType index_type{PrimitiveType::i32};
   int grid_dim{1};
   int block_dim{1};
   bool reversed{false};
@@ -1354,6 +1367,12 @@ class OffloadedStmt : public Stmt {
       total_num_local;  // |total_offset[idx+1] - total_offset[idx]|
 
   std::vector<int> index_offsets;
+  // See StructForStmt::tile_shape.
+  std::vector<int> tile_shape;
+  // For listgen tasks, see StructForStmt::sort_elements.
+  bool sort_elements{false};
+  // For struct-for tasks, see StructForStmt::balance_elements.
+  bool balance_elements{false};
 
   std::unique_ptr<Block> tls_prologue;
   std::unique_ptr<Block> mesh_prologue;  // mesh-for only block
@@ -1394,11 +1413,15 @@ class OffloadedStmt : public Stmt {
                      const_end,
                      begin_value,
                      end_value,
+                     index_type,
                      grid_dim,
                      block_dim,
                      reversed,
                      num_cpu_threads,
                      index_offsets,
+                     tile_shape,
+                     sort_elements,
+                     balance_elements,
                      mem_access_opt);
   TI_DEFINE_ACCEPT
 };
@@ -1605,6 +1628,12 @@ class InternalFuncStmt : public Stmt {
     TI_STMT_REG_FIELDS;
   }
 
+  // Pure runtime helpers may be merged by CSE and removed when unused.
+  bool has_global_side_effect() const override {
+    return !starts_with(func_name, "sifakis_svd_") &&
+           !starts_with(func_name, "composite_extract_");
+  }
+
   TI_STMT_DEF_FIELDS(ret_type, func_name, args, with_runtime_context);
   TI_DEFINE_ACCEPT_AND_CLONE
 };
@@ -32,6 +32,7 @@ void flag_access(IRNode *root);
 void eliminate_immutable_local_vars(IRNode *root);
 void scalarize(IRNode *root);
 void lower_matrix_ptr(IRNode *root);
+bool lower_quant_external_access(IRNode *root);
 bool die(IRNode *root);
 bool simplify(IRNode *root, const CompileConfig &config);
 bool cfg_optimization(
@@ -42,14 +43,23 @@ bool cfg_optimization(
     const std::optional<ControlFlowGraph::LiveVarAnalysisConfig>
         &lva_config_opt = std::nullopt);
 bool alg_simp(IRNode *root, const CompileConfig &config);
+std::unique_ptr<StmtRewriter> make_alg_simp_rewriter(
+    const CompileConfig &config);
 bool demote_operations(IRNode *root, const CompileConfig &config);
 bool binary_op_simplify(IRNode *root, const CompileConfig &config);
+std::unique_ptr<StmtRewriter> make_binary_op_simplify_rewriter(
+    const CompileConfig &config);
 bool whole_kernel_cse(IRNode *root);
 bool extract_constant(IRNode *root, const CompileConfig &config);
 bool unreachable_code_elimination(IRNode *root);
 bool loop_invariant_code_motion(IRNode *root, const CompileConfig &config);
 bool cache_loop_invariant_global_vars(IRNode *root,
                                       const CompileConfig &config);
+bool cache_loop_carried_global_loads(IRNode *root,
+                                     const CompileConfig &config);
+bool worklist_simplify(IRNode *root,
+                       const CompileConfig &config,
+                       const ConstantFoldPass::Args &args);
 void full_simplify(IRNode *root,
                    const CompileConfig &config,
                    const FullSimplifyPass::Args &args);
@@ -82,6 +92,10 @@ void demote_mesh_statements(IRNode *root,
                             const DemoteMeshStatements::Args &args);
 bool remove_loop_unique(IRNode *root);
 bool remove_range_assumption(IRNode *root);
+// Replaces the shapes along the axes of the ndarray arguments with the values
+// in |shapes|, by arg id. The arguments without values are left dynamic.
+bool specialize_ndarray_shapes(IRNode *root,
+                               const std::vector<std::vector<int32>> &shapes);
 bool lower_access(IRNode *root,
                   const CompileConfig &config,
                   const LowerAccessPass::Args &args);
@@ -106,6 +120,9 @@ bool determine_ad_stack_size(IRNode *root, const CompileConfig &config);
 bool constant_fold(IRNode *root,
                    const CompileConfig &config,
                    const ConstantFoldPass::Args &args);
+std::unique_ptr<StmtRewriter> make_constant_fold_rewriter(
+    const CompileConfig &config,
+    const ConstantFoldPass::Args &args);
 void offload(IRNode *root, const CompileConfig &config);
 bool transform_statements(
     IRNode *root,
@@ -131,8 +148,9 @@ bool replace_and_insert_statements(
 bool replace_statements(IRNode *root,
                         std::function<bool(Stmt *)> filter,
                         std::function<Stmt *(Stmt *)> finder);
-void demote_dense_struct_fors(IRNode *root);
+void demote_dense_struct_fors(IRNode *root, const CompileConfig &config);
 void demote_no_access_mesh_fors(IRNode *root);
+bool fuse_offloads(IRNode *root);
 bool demote_atomics(IRNode *root, const CompileConfig &config);
 void reverse_segments(IRNode *root);  // for autograd
 void detect_read_only(IRNode *root);
@@ -48,6 +48,10 @@ int data_type_size(DataType t) {
            data_type_size(tensor_type->get_element_type());
   }
 
+  if (is_quant(t)) {
+    return data_type_size(quant_storage_type(t));
+  }
+
 #define REGISTER_DATA_TYPE(i, j) \
   else if (t->is_primitive(PrimitiveTypeID::i)) return sizeof(j)
 
@@ -68,6 +72,30 @@ int data_type_size(DataType t) {
   }
 }
 
+DataType quant_storage_type(DataType t) {
+  int num_bits = 0;
+  if (auto qit = t->cast<QuantIntType>()) {
+    num_bits = qit->get_num_bits();
+  } else if (auto qfxt = t->cast<QuantFixedType>()) {
+    num_bits = qfxt->get_digits_type()->as<QuantIntType>()->get_num_bits();
+  } else if (auto qflt = t->cast<QuantFloatType>()) {
+    num_bits = qflt->get_digits_type()->as<QuantIntType>()->get_num_bits() +
+               qflt->get_exponent_type()->as<QuantIntType>()->get_num_bits();
+  } else {
+    return t;
+  }
+  if (num_bits <= 8) {
+    return PrimitiveType::u8;
+  } else if (num_bits <= 16) {
+    return PrimitiveType::u16;
+  } else if (num_bits <= 32) {
+    return PrimitiveType::u32;
+  }
+  TI_ERROR("{} bits of quant type {} do not fit in a 32-bit container",
+           num_bits, t->to_string());
+  return PrimitiveType::unknown;
+}
+
 std::string tensor_type_format_helper(const std::vector<int> &shape,
                                       std::string format_str,
                                       int dim) {
@@ -12,6 +12,11 @@ TI_DLL_EXPORT std::string data_type_name(DataType t);
 
 TI_DLL_EXPORT int data_type_size(DataType t);
 
+// Returns the unsigned integer type holding one element of quant type |t| when
+// it is stored outside of a bit struct, e.g. in an ndarray. Non-quant types are
+// returned unchanged.
+TI_DLL_EXPORT DataType quant_storage_type(DataType t);
+
 TI_DLL_EXPORT std::string data_type_format(DataType dt, Arch arch = Arch::x64);
 
 inline int data_type_bits(DataType t) {
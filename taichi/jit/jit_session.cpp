@@ -1,7 +1,11 @@
 #include "taichi/jit/jit_session.h"
 
 #ifdef TI_WITH_LLVM
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Type.h"
 #endif
 
 namespace taichi::lang {
@@ -48,4 +52,24 @@ std::unique_ptr<JITSession> JITSession::create(TaichiLLVMContext *tlctx,
   return nullptr;
 }
 
+#ifdef TI_WITH_LLVM
+namespace {
+constexpr char kOptLevelModuleFlag[] = "taichi.opt_level";
+}  // namespace
+
+int JITSession::get_module_opt_level(const llvm::Module &module) {
+  auto *flag = llvm::mdconst::extract_or_null<llvm::ConstantInt>(
+      module.getModuleFlag(kOptLevelModuleFlag));
+  return flag ? (int)flag->getZExtValue() : 3;
+}
+
+void JITSession::set_module_opt_level(llvm::Module &module, int opt_level) {
+  TI_ASSERT(0 <= opt_level && opt_level <= 3);
+  auto *value = llvm::ConstantInt::get(
+      llvm::Type::getInt32Ty(module.getContext()), opt_level);
+  module.setModuleFlag(llvm::Module::Override, kOptLevelModuleFlag,
+                       llvm::ConstantAsMetadata::get(value));
+}
+#endif
+
 }  // namespace taichi::lang
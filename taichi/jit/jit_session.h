@@ -27,6 +27,12 @@ class JITSession {
   virtual JITModule *add_module(std::unique_ptr<llvm::Module> M,
                                 int max_reg = 0) = 0;
 
+  // Adds a module defining functions that the modules added afterwards may
+  // leave undefined, e.g. the runtime functions with cpu_shared_runtime.
+  virtual void add_shared_module(std::unique_ptr<llvm::Module> M) {
+    TI_NOT_IMPLEMENTED
+  }
+
   // virtual void remove_module(JITModule *module) = 0;
 
   virtual void *lookup(const std::string Name) {
@@ -42,6 +48,44 @@ class JITSession {
   virtual void global_optimize_module(llvm::Module *module) {
   }
 
+  // Identifies the machine code compile_module_to_native() produces, e.g. by
+  // the target GPU and driver version. Native code is only loaded by sessions
+  // of the same key. Empty if native code is not supported.
+  virtual std::string get_native_code_key() {
+    return "";
+  }
+
+  // add_module() split into two steps, so that the native code can be cached.
+  virtual std::string compile_module_to_native(std::unique_ptr<llvm::Module> M,
+                                               int max_reg = 0) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  virtual JITModule *add_native_module(const std::string &native_code) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // compile_module_to_native() split into two steps, so that the parts of a
+  // kernel can be compiled concurrently, e.g. to PTX on CUDA or to object
+  // files on CPUs. compile_module_to_object() may run on any thread, as long
+  // as concurrent calls get modules of different LLVM contexts. The objects
+  // must not refer to each other.
+  virtual std::string compile_module_to_object(
+      std::unique_ptr<llvm::Module> M) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  virtual std::string link_objects_to_native(
+      const std::vector<std::string> &objects,
+      int max_reg = 0) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // The optimization level (0 to 3) of the pass pipeline |module| is compiled
+  // with. 3 unless set otherwise, e.g. by tiered_compilation.
+  static int get_module_opt_level(const llvm::Module &module);
+  static void set_module_opt_level(llvm::Module &module, int opt_level);
+
   virtual ~JITSession() = default;
 };
 
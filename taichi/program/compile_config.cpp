@@ -2,6 +2,7 @@
 
 #include <thread>
 #include "taichi/rhi/arch.h"
+#include "taichi/util/io.h"
 #include "taichi/util/offline_cache.h"
 
 namespace taichi::lang {
@@ -74,6 +75,15 @@ void CompileConfig::fit() {
   if (arch == Arch::cc || arch_uses_spirv(arch)) {
     demote_dense_struct_fors = true;
   }
+  // Only the CPU and CUDA codegen emit native vectors for matrices; the other
+  // backends need every matrix operation scalarized.
+  if (!real_matrix_scalarize &&
+      !((arch_is_cpu(arch) && arch != Arch::wasm) || arch == Arch::cuda)) {
+    real_matrix_scalarize = true;
+  }
+  if (pgo_profile_dir.empty()) {
+    pgo_profile_dir = join_path(offline_cache_file_path, "branch_profiles");
+  }
   offline_cache::disable_offline_cache_if_needed(this);
 }
 
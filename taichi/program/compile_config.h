@@ -25,13 +25,41 @@ struct CompileConfig {
   bool simplify_after_lower_access;
   bool move_loop_invariant_outside_if;
   bool cache_loop_invariant_global_vars{true};
+  // Keep the loads of x[i + c] at consecutive constant offsets c in registers
+  // across the iterations of serial range-fors over i.
+  bool cache_loop_carried_global_loads{true};
   bool demote_dense_struct_fors;
+  // Fuse adjacent range-for tasks over the same range.
+  bool fuse_offloads{true};
+  // The number of elements in each tile of multi-dimensional dense
+  // struct-fors without a tile_size loop config. 0 disables tiling.
+  int struct_for_tile_size{0};
   bool advanced_optimization;
   bool constant_folding;
+  // Run the local rewrites of full_simplify off a worklist of the statements
+  // around previous rewrites, instead of traversing the whole IR repeatedly.
+  bool worklist_simplify{true};
   bool use_llvm;
   bool verbose_kernel_launches;
+  // Defer the launches of kernels that only take scalars and only access
+  // SNodes, until the device has to catch up or |async_launch_window|
+  // launches are queued. Redundant launches are dropped, and on CUDA,
+  // independent ones overlap on several streams. Only the LLVM backends
+  // defer launches. See LaunchQueue.
+  bool async_launch{false};
+  int async_launch_window{64};
+  // Synchronize after each launch of a kernel that prints, so that its output
+  // shows up right away. Otherwise the output buffered on the device shows up
+  // at the next synchronization.
+  bool sync_after_print{true};
+  // CUDA only: the size in bytes of the device-side buffer of the output of
+  // print(), which has to hold all the output between two synchronizations.
+  // 0 = the driver default.
+  int64 print_buffer_size{0};
   bool kernel_profiler;
   bool timeline{false};
+  // Record the time and the IR size change of each pass, see CompileProfiler.
+  bool compile_profiler{false};
   bool verbose;
   bool fast_math;
   bool flatten_if;
@@ -39,6 +67,9 @@ struct CompileConfig {
   bool make_block_local;
   bool detect_read_only;
   bool ndarray_use_cached_allocator;
+  // CUDA only: allocate ndarrays in unified memory, which can exceed the
+  // device memory and be accessed by the host directly.
+  bool ndarray_use_managed_memory{false};
   bool real_matrix_scalarize;
   DataType default_fp;
   DataType default_ip;
@@ -52,19 +83,87 @@ struct CompileConfig {
   // The default size when the Taichi compiler is unable to automatically
   // determine the autodiff stack size.
   int default_ad_stack_size{32};
+  // When the AD-stacks of an inner loop with a constant trip count would take
+  // more than this many bytes per thread, only every k-th iteration is stored
+  // and the others are recomputed in the backward pass. 0 = never.
+  int64 ad_stack_memory_budget{0};
+  // On the LLVM backends, only the top entries of the AD-stacks deeper than
+  // this stay in thread-local memory, and the others spill to a global arena.
+  // 0 = keep whole stacks thread-local.
+  int ad_stack_window_size{0};
+  // The number of tangents carried by every value in forward-mode autodiff.
+  // The fields created afterwards get a dual field for each of them.
+  int forward_ad_lanes{1};
 
   int saturating_grid_dim;
   int max_block_dim;
   int cpu_max_num_threads;
+  // Use WorkStealingThreadPool instead of ThreadPool on CPU backends.
+  bool cpu_work_stealing{false};
+  // Pin CPU worker threads, grouped by NUMA node. Only used by the
+  // work-stealing scheduler.
+  bool cpu_pin_threads{false};
+  // Run the TLS prologue/epilogue of CPU range-fors and mesh-fors once per
+  // thread rather than once per block.
+  bool cpu_tls_per_thread{false};
+  // The vector width forced on the loops of CPU range-fors and struct-fors. 0
+  // lets LLVM choose it, and 1 disables vectorization.
+  int cpu_vectorize_width{0};
+  // Compile the runtime functions once into a module that the kernels link
+  // against, instead of into every kernel. Only small runtime functions are
+  // still inlined. Cuts the compile time and code size of the kernels.
+  bool cpu_shared_runtime{false};
   int random_seed;
+  // Draw ti.random() in range-for and serial tasks from a Philox stream keyed
+  // by the seed, the launch, the task and the loop index, instead of from
+  // per-thread states in global memory. The results do not depend on how the
+  // iterations are scheduled. Other tasks keep using the per-thread states.
+  bool counter_based_rand{false};
 
   // LLVM backend options:
   bool print_struct_llvm_ir;
   bool print_kernel_llvm_ir;
   bool print_kernel_llvm_ir_optimized;
   bool print_kernel_nvptx;
+  // Optimize and emit the offloaded tasks of a kernel as separate modules, in
+  // parallel on num_compile_threads threads, and link them afterwards. Each
+  // part gets its own copy of the runtime functions it uses.
+  bool llvm_split_kernel_module{false};
+  // Compile kernels without LLVM optimizations first, and recompile them
+  // optimized in the background once they have been launched
+  // tiered_compilation_threshold times.
+  bool tiered_compilation{false};
+  int tiered_compilation_threshold{16};
+  // Profile-guided optimization on CPUs: count how often each branch of the
+  // kernels goes each way and save the counts to pgo_profile_dir when the
+  // program finalizes, or use the saved counts as branch weights. Both
+  // disable the offline cache.
+  bool pgo_instrument{false};
+  bool pgo_use{false};
+  // Defaults to the "branch_profiles" directory of offline_cache_file_path.
+  std::string pgo_profile_dir;
 
   // CUDA backend options:
+  // Time the power-of-two block sizes up to max_block_dim on the first
+  // launches of the range-fors running at the default block size, and keep
+  // the fastest one of each. The results are saved in the offline cache.
+  bool gpu_autotune_block_dim{false};
+  // Cap the registers of each task whose occupancy is limited by its register
+  // usage, on top of gpu_max_reg, unless that makes it spill. Takes up to two
+  // more compilations of each kernel.
+  bool gpu_tune_max_reg{false};
+  // Combine the atomics of the lanes of a warp that update the same address,
+  // for the atomics whose address may not be unique to a thread and whose
+  // result is unused, e.g. scatters to a grid. Needs sm_70 or later.
+  bool gpu_warp_aggregated_atomics{false};
+  // Fuse the consecutive tasks of a kernel that work with any grid size into
+  // one persistent kernel, launched cooperatively with as many blocks as can
+  // be resident, with grid-wide barriers between the tasks.
+  bool gpu_persistent_kernel{false};
+  // Run the serial tasks of a kernel in the first thread of the next task
+  // that works with any grid size, behind a grid barrier, instead of as
+  // single-thread kernels of their own. Implied by gpu_persistent_kernel.
+  bool gpu_fuse_serial_tasks{false};
   float64 device_memory_GB;
   float64 device_memory_fraction;
 
@@ -77,6 +176,9 @@ struct CompileConfig {
 
   bool quant_opt_store_fusion{true};
   bool quant_opt_atomic_demotion{true};
+  // Stage the ndarray elements read by 1-D stencils of CUDA range-fors in
+  // shared memory.
+  bool make_ndarray_block_local{true};
 
   // Mesh related.
   // MeshTaichi options
@@ -97,11 +199,57 @@ struct CompileConfig {
   int offline_cache_max_size_of_files{100 * 1024 *
                                       1024};   // bytes, default: 100MB
   double offline_cache_cleaning_factor{0.25};  // [0.f, 1.f]
+  // LLVM backends: store the cached kernels in a single memory-mapped file
+  // instead of one file per kernel.
+  bool offline_cache_packed{false};
+  // LLVM backends: store each cached kernel in a file of its own, written as
+  // soon as the kernel is compiled and replaced in one step, so that processes
+  // sharing the cache don't take its lock. Takes precedence over
+  // offline_cache_packed.
+  bool offline_cache_shared{false};
+  // With offline_cache_shared: while another process compiles a kernel that
+  // is not cached yet, wait up to this long for it instead of compiling it
+  // too. 0 disables the waiting.
+  int offline_cache_compile_lease_ms{0};
+  // LLVM backends: also cache each offloaded task on its own, so that the
+  // unchanged tasks of an edited kernel are not recompiled.
+  bool offline_cache_tasks{false};
+  // LLVM backends: also cache the machine code of each kernel (CUBINs on
+  // CUDA, object files on CPUs), so that cached kernels skip LLVM codegen.
+  bool offline_cache_native_code{false};
+  // The store shared with other machines that the kernels missing from the
+  // local offline cache are looked up in, e.g. "file:///mnt/ticache" or
+  // "http://cache-server:8080/ticache". Empty disables it.
+  std::string offline_cache_remote_url;
+  // Let kernels with the same offline cache key share their compiled code
+  // within a process.
+  bool in_process_kernel_cache{true};
+  // LLVM backends: once a kernel has been launched this many times with the
+  // same ndarray shapes, compile a variant of it specialized on these shapes
+  // in the background, and launch that one for them. 0 keeps a single
+  // shape-dynamic kernel for all the shapes.
+  int specialize_ndarray_shapes{0};
 
   int num_compile_threads{4};
   std::string vk_api_version;
 
+  // GFX backends: when to submit the commands recorded for kernel launches.
+  // Thresholds of 0 are disabled.
+  int gfx_max_pending_dispatches{0};
+  uint64 gfx_max_pending_invocations{0};
+  double gfx_max_pending_time_us{2000.0};
+  // Submit once the recorded work is estimated, from the device time of the
+  // previous submissions, to take this long. Only supported on Vulkan.
+  double gfx_target_device_time_us{0.0};
+
   size_t cuda_stack_limit{8192};
+  // CUDA AOT modules: also build the kernels for the comma-separated compute
+  // capabilities, e.g. "75,86", so that they are loaded without LLVM. Empty
+  // only saves the LLVM IR.
+  std::string cuda_aot_archs;
+  // Bytes the ndarray caching allocator of GPU backends may reserve before it
+  // returns free memory to the driver. 0 means never release.
+  size_t cached_allocator_high_water_mark{0};
 
   CompileConfig();
 
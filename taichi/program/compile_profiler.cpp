@@ -0,0 +1,152 @@
+#include "taichi/program/compile_profiler.h"
+
+#include <algorithm>
+#include <map>
+
+#include "taichi/system/timeline.h"
+#include "taichi/system/timer.h"
+
+#if defined(TI_PLATFORM_UNIX)
+#include <sys/resource.h>
+#else
+#include "taichi/platform/windows/windows.h"
+#include <psapi.h>
+#endif
+
+namespace taichi::lang {
+
+namespace {
+
+int64 get_peak_memory() {
+#if defined(TI_PLATFORM_UNIX)
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+#if defined(TI_PLATFORM_OSX)
+  return usage.ru_maxrss;
+#else
+  // In kilobytes on Linux.
+  return int64(usage.ru_maxrss) * 1024;
+#endif
+#else
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                               sizeof(counters))) {
+    return -1;
+  }
+  return counters.PeakWorkingSetSize;
+#endif
+}
+
+}  // namespace
+
+CompileProfiler &CompileProfiler::get_instance() {
+  static auto instance = new CompileProfiler();
+  return *instance;
+}
+
+void CompileProfiler::insert_record(const Record &record) {
+  if (!enabled_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    records_.push_back(record);
+    records_.back().peak_memory = get_peak_memory();
+  }
+  auto &timeline = Timeline::get_this_thread_instance();
+  const auto name = fmt::format("{}: {}", record.kernel_name, record.pass_name);
+  timeline.insert_event({name, true, record.begin_time, timeline.get_name()});
+  timeline.insert_event({name, false, record.end_time, timeline.get_name()});
+}
+
+std::vector<CompileProfiler::Record> CompileProfiler::get_records() {
+  std::lock_guard<std::mutex> _(mut_);
+  return records_;
+}
+
+void CompileProfiler::insert_kernel_key(const std::string &kernel_name,
+                                        const std::string &key) {
+  if (!enabled_) {
+    return;
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  kernel_keys_[kernel_name] = key;
+}
+
+std::map<std::string, std::string> CompileProfiler::get_kernel_keys() {
+  std::lock_guard<std::mutex> _(mut_);
+  return kernel_keys_;
+}
+
+void CompileProfiler::clear() {
+  std::lock_guard<std::mutex> _(mut_);
+  records_.clear();
+  kernel_keys_.clear();
+}
+
+CompileProfiler::Scope::Scope(const std::string &kernel_name,
+                              const std::string &pass_name)
+    : active_(get_instance().get_enabled()) {
+  if (active_) {
+    record_.kernel_name = kernel_name;
+    record_.pass_name = pass_name;
+    record_.begin_time = Time::get_time();
+  }
+}
+
+void CompileProfiler::Scope::stop() {
+  if (active_ && !stopped_) {
+    record_.end_time = Time::get_time();
+    stopped_ = true;
+  }
+}
+
+CompileProfiler::Scope::~Scope() {
+  if (active_) {
+    stop();
+    get_instance().insert_record(record_);
+  }
+}
+
+void CompileProfiler::print_summary() {
+  struct PassSummary {
+    int count{0};
+    float64 total_time{0};
+    int64 statement_delta{0};
+  };
+  std::map<std::string, PassSummary> passes;
+  float64 total_time = 0;
+  int64 peak_memory = -1;
+  for (const auto &record : get_records()) {
+    peak_memory = std::max(peak_memory, record.peak_memory);
+    auto &pass = passes[record.pass_name];
+    const auto time = record.end_time - record.begin_time;
+    pass.count++;
+    pass.total_time += time;
+    pass.statement_delta +=
+        record.num_statements_after - record.num_statements_before;
+    total_time += time;
+  }
+
+  std::vector<std::pair<std::string, PassSummary>> sorted(passes.begin(),
+                                                          passes.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+    return a.second.total_time > b.second.total_time;
+  });
+  fmt::print("{:>10} {:>7} {:>6} {:>12}  {}\n", "time(ms)", "%", "runs",
+             "stmts(+/-)", "pass");
+  for (const auto &[name, pass] : sorted) {
+    fmt::print("{:>10.3f} {:>6.2f}% {:>6} {:>12}  {}\n",
+               pass.total_time * 1000,
+               total_time > 0 ? pass.total_time / total_time * 100 : 0.0,
+               pass.count, pass.statement_delta, name);
+  }
+  fmt::print("{:>10.3f} total\n", total_time * 1000);
+  if (peak_memory >= 0) {
+    fmt::print("{:>10.1f} MB peak memory\n", peak_memory / (1024.0 * 1024.0));
+  }
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+namespace taichi::lang {
+
+// Records how long each pass of the IR pipelines (compile_to_offloads(),
+// compile_to_executable(), ...) takes for each kernel, and how it changes the
+// number of IR statements.
+//
+// Kernels may be compiled on several threads, so the records of a kernel may
+// interleave with others. A record covers the wall time since the previous
+// record of the same pipeline run.
+class CompileProfiler {
+ public:
+  struct Record {
+    std::string kernel_name;
+    std::string pass_name;
+    // In seconds, see Time::get_time().
+    float64 begin_time{0};
+    float64 end_time{0};
+    int num_statements_before{0};
+    int num_statements_after{0};
+    // Bytes of the code generated by a backend codegen record, -1 otherwise.
+    int64 code_size{-1};
+    // The high-water mark of the resident memory of the process in bytes when
+    // the record was inserted, or -1 if unknown.
+    int64 peak_memory{-1};
+  };
+
+  // Records the wall time from its construction to stop(), or else to its
+  // destruction, as a pass of |kernel_name|. Does nothing if the profiler is
+  // disabled, so that callers only measure the generated code if active().
+  class Scope {
+   public:
+    Scope(const std::string &kernel_name, const std::string &pass_name);
+    ~Scope();
+
+    bool active() const {
+      return active_;
+    }
+
+    void stop();
+
+    void set_code_size(int64 code_size) {
+      record_.code_size = code_size;
+    }
+
+   private:
+    bool active_;
+    bool stopped_{false};
+    Record record_;
+  };
+
+  static CompileProfiler &get_instance();
+
+  bool get_enabled() const {
+    return enabled_;
+  }
+
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+  // Also adds the record to the timeline of this thread, if timelines are
+  // enabled.
+  void insert_record(const Record &record);
+
+  std::vector<Record> get_records();
+
+  // The offline cache key of each kernel compiled while the profiler was
+  // enabled, by name. The key only changes with the frontend IR and the
+  // compile config, so compile times can be compared across versions for
+  // the kernels whose key stayed the same.
+  void insert_kernel_key(const std::string &kernel_name,
+                         const std::string &key);
+
+  std::map<std::string, std::string> get_kernel_keys();
+
+  void clear();
+
+  // Prints the total time and the statement count change of each pass, over
+  // all kernels, and the peak memory of the compilation.
+  void print_summary();
+
+ private:
+  std::mutex mut_;
+  std::vector<Record> records_;
+  std::map<std::string, std::string> kernel_keys_;
+  bool enabled_{false};
+};
+
+}  // namespace taichi::lang
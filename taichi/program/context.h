@@ -48,6 +48,9 @@ struct RuntimeContext {
   // LLVMRuntime is shared among functions. So we moved the pointer to
   // RuntimeContext which each function have one.
   uint64 *result_buffer;
+  // Distinguishes the random streams of the launches with
+  // counter_based_rand.
+  uint64 rand_launch_id{0};
 
   static constexpr size_t extra_args_size = sizeof(extra_args);
 
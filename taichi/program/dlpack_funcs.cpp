@@ -0,0 +1,200 @@
+#include "taichi/program/dlpack_funcs.h"
+
+#include <vector>
+
+#include "taichi/ir/snode.h"
+#include "taichi/program/ndarray.h"
+#include "taichi/program/program.h"
+
+namespace taichi::lang {
+
+namespace {
+
+struct DLPackExportContext {
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+  std::shared_ptr<void> owner;
+  DLManagedTensor tensor;
+};
+
+DLDataType to_dlpack_dtype(DataType dt) {
+  TI_ERROR_IF(!dt->is<PrimitiveType>() || is_quant(dt),
+              "DLPack does not support data type {}", dt->to_string());
+  DLDataType ret;
+  ret.bits = (uint8_t)data_type_bits(dt);
+  ret.lanes = 1;
+  if (is_real(dt)) {
+    ret.code = kDLFloat;
+  } else if (is_signed(dt)) {
+    ret.code = kDLInt;
+  } else {
+    ret.code = kDLUInt;
+  }
+  return ret;
+}
+
+DataType from_dlpack_dtype(const DLDataType &dtype) {
+  TI_ERROR_IF(dtype.lanes != 1, "Vectorized DLPack types are not supported");
+  if (dtype.code == kDLFloat) {
+    switch (dtype.bits) {
+      case 16:
+        return PrimitiveType::f16;
+      case 32:
+        return PrimitiveType::f32;
+      case 64:
+        return PrimitiveType::f64;
+    }
+  } else if (dtype.code == kDLInt) {
+    switch (dtype.bits) {
+      case 8:
+        return PrimitiveType::i8;
+      case 16:
+        return PrimitiveType::i16;
+      case 32:
+        return PrimitiveType::i32;
+      case 64:
+        return PrimitiveType::i64;
+    }
+  } else if (dtype.code == kDLUInt) {
+    switch (dtype.bits) {
+      case 8:
+        return PrimitiveType::u8;
+      case 16:
+        return PrimitiveType::u16;
+      case 32:
+        return PrimitiveType::u32;
+      case 64:
+        return PrimitiveType::u64;
+    }
+  }
+  TI_ERROR("Unsupported DLPack data type (code={}, bits={})", dtype.code,
+           dtype.bits);
+  return PrimitiveType::unknown;
+}
+
+DLDevice dlpack_device_of(Program *program) {
+  Arch arch = program->this_thread_config().arch;
+  if (arch_is_cpu(arch)) {
+    return {kDLCPU, 0};
+  } else if (arch == Arch::cuda) {
+    return {kDLCUDA, 0};
+  }
+  TI_ERROR("DLPack is not supported on {}", arch_name(arch));
+  return {kDLExtDev, 0};
+}
+
+DLManagedTensor *make_exported_tensor(Program *program,
+                                      void *data,
+                                      DataType dt,
+                                      std::vector<int64_t> shape,
+                                      std::vector<int64_t> strides,
+                                      std::shared_ptr<void> owner) {
+  auto ctx = new DLPackExportContext;
+  ctx->shape = std::move(shape);
+  ctx->strides = std::move(strides);
+  ctx->owner = std::move(owner);
+
+  DLTensor &t = ctx->tensor.dl_tensor;
+  t.data = data;
+  t.device = dlpack_device_of(program);
+  t.ndim = (int32_t)ctx->shape.size();
+  t.dtype = to_dlpack_dtype(dt);
+  t.shape = ctx->shape.data();
+  t.strides = ctx->strides.empty() ? nullptr : ctx->strides.data();
+  t.byte_offset = 0;
+  ctx->tensor.manager_ctx = ctx;
+  ctx->tensor.deleter = [](DLManagedTensor *self) {
+    delete static_cast<DLPackExportContext *>(self->manager_ctx);
+  };
+  return &ctx->tensor;
+}
+
+}  // namespace
+
+Ndarray *ndarray_from_dlpack(Program *program, DLManagedTensor *tensor) {
+  const DLTensor &t = tensor->dl_tensor;
+  const DLDevice device = dlpack_device_of(program);
+  TI_ERROR_IF(t.device.device_type != device.device_type &&
+                  !(device.device_type == kDLCUDA &&
+                    t.device.device_type == kDLCUDAManaged),
+              "The DLPack tensor is on device type {}, but the ndarray would "
+              "be on {}",
+              (int)t.device.device_type, (int)device.device_type);
+  DataType dt = from_dlpack_dtype(t.dtype);
+
+  std::vector<int> shape(t.shape, t.shape + t.ndim);
+  if (t.strides) {
+    // Dimensions of size 1 can have any stride.
+    int64_t expected = 1;
+    for (int i = t.ndim - 1; i >= 0; i--) {
+      TI_ERROR_IF(t.shape[i] != 1 && t.strides[i] != expected,
+                  "Only compact row-major DLPack tensors can be imported");
+      expected *= t.shape[i];
+    }
+  }
+  void *data = (char *)t.data + t.byte_offset;
+  return program->import_ndarray(data, dt, shape, [tensor]() {
+    if (tensor->deleter) {
+      tensor->deleter(tensor);
+    }
+  });
+}
+
+DLManagedTensor *ndarray_to_dlpack(Program *program,
+                                   Ndarray *ndarray,
+                                   std::shared_ptr<void> owner) {
+  program->synchronize();
+  void *data = (void *)program->get_ndarray_data_ptr_as_int(ndarray);
+  TI_ERROR_IF(data == nullptr, "DLPack is not supported on {}",
+              arch_name(program->this_thread_config().arch));
+  const auto &total_shape = ndarray->total_shape();
+  return make_exported_tensor(
+      program, data, ndarray->get_element_data_type(),
+      std::vector<int64_t>(total_shape.begin(), total_shape.end()), {},
+      std::move(owner));
+}
+
+DLManagedTensor *field_to_dlpack(Program *program,
+                                 SNode *snode,
+                                 std::shared_ptr<void> owner) {
+  TI_ERROR_IF(!arch_uses_llvm(program->this_thread_config().arch),
+              "DLPack is not supported on {}",
+              arch_name(program->this_thread_config().arch));
+  TI_ASSERT(snode->type == SNodeType::place);
+  SNode *dense = snode->parent;
+  TI_ERROR_IF(dense == nullptr || dense->type != SNodeType::dense ||
+                  dense->parent == nullptr ||
+                  dense->parent->type != SNodeType::root,
+              "Only fields placed directly under a dense SNode of the root can "
+              "be exported through DLPack");
+  TI_ERROR_IF(dense->_morton,
+              "Fields placed under a Morton-ordered SNode have no strides and "
+              "can't be exported through DLPack");
+  const std::size_t element_size = data_type_size(snode->dt);
+  TI_ERROR_IF(dense->cell_size_bytes % element_size != 0,
+              "The cells of SNode {} are not aligned to its elements",
+              dense->get_node_type_name_hinted());
+
+  // A dense SNode is laid out row-major over its cells, see
+  // AxisExtractor::acc_shape.
+  std::vector<int64_t> shape, strides;
+  for (int i = 0; i < dense->num_active_indices; i++) {
+    const auto &extractor =
+        dense->extractors[dense->physical_index_position[i]];
+    shape.push_back(extractor.shape);
+    strides.push_back((int64_t)extractor.acc_shape * dense->cell_size_bytes /
+                      element_size);
+  }
+
+  program->synchronize();
+  DevicePtr root =
+      program->get_snode_tree_device_ptr(snode->get_snode_tree_id());
+  char *data =
+      (char *)program->get_program_impl()->get_ndarray_alloc_info_ptr(root) +
+      root.offset + dense->offset_bytes_in_parent_cell +
+      snode->offset_bytes_in_parent_cell;
+  return make_exported_tensor(program, data, snode->dt, std::move(shape),
+                              std::move(strides), std::move(owner));
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+
+#include "taichi/program/dlpack.h"
+
+namespace taichi::lang {
+
+class Ndarray;
+class Program;
+class SNode;
+
+/* Wraps the memory of |tensor| in a new Ndarray of |program| without copying.
+ * The tensor must be compact, on the device of |program| (CPU or CUDA), and
+ * its deleter is invoked once the Ndarray is deleted.
+ */
+Ndarray *ndarray_from_dlpack(Program *program, DLManagedTensor *tensor);
+
+/* Exports |ndarray| as a DLPack tensor sharing its memory. |owner| is
+ * released when the consumer deletes the tensor and should keep |ndarray|
+ * alive until then.
+ */
+DLManagedTensor *ndarray_to_dlpack(Program *program,
+                                   Ndarray *ndarray,
+                                   std::shared_ptr<void> owner);
+
+/* Same as above for the field placed at |snode|. Only fields placed directly
+ * under a dense SNode of the root can be expressed as strided tensors.
+ */
+DLManagedTensor *field_to_dlpack(Program *program,
+                                 SNode *snode,
+                                 std::shared_ptr<void> owner);
+
+}  // namespace taichi::lang
@@ -22,7 +22,7 @@ bool is_extension_supported(Arch arch, Extension ext) {
       {Arch::metal, {}},
       {Arch::opengl, {Extension::extfunc}},
       {Arch::gles, {}},
-      {Arch::vulkan, {}},
+      {Arch::vulkan, {Extension::mesh}},
       {Arch::dx11, {}},
       {Arch::cc, {Extension::data64, Extension::extfunc, Extension::adstack}},
   };
@@ -17,10 +17,10 @@ void Function::set_function_body(const std::function<void()> &func) {
 
   func();
 
-  if (program->this_thread_config().offline_cache) {  // For generating AST-Key
-    std::ostringstream oss;
-    gen_offline_cache_key(program, ir.get(), &oss);
-    ast_serialization_data_ = oss.str();
+  // For generating AST-Key
+  if (program->this_thread_config().offline_cache ||
+      program->this_thread_config().in_process_kernel_cache) {
+    ast_key_ = get_hashed_offline_cache_key_of_ast(program, ir.get());
   }
   irpass::compile_function(ir.get(), program->this_thread_config(), this,
                            /*autodiff_mode=*/AutodiffMode::kNone,
@@ -22,12 +22,15 @@ class Function : public Callable {
 
   [[nodiscard]] std::string get_name() const override;
 
-  std::optional<std::string> &try_get_ast_serialization_data() {
-    return ast_serialization_data_;
+  // The hash of the frontend AST, which is part of the offline cache keys of
+  // the kernels calling the function. The AST is lowered right away, so it is
+  // hashed beforehand.
+  const std::optional<std::string> &try_get_ast_key() const {
+    return ast_key_;
   }
 
  private:
-  std::optional<std::string> ast_serialization_data_;  // For generating AST-Key
+  std::optional<std::string> ast_key_;
 };
 
 }  // namespace taichi::lang
@@ -1,10 +1,14 @@
 #include "taichi/program/graph_builder.h"
+
+#include <algorithm>
+#include <tuple>
+
 #include "taichi/program/ndarray.h"
 #include "taichi/program/program.h"
 
 namespace taichi::lang {
-void Dispatch::compile(
-    std::vector<aot::CompiledDispatch> &compiled_dispatches) {
+void Dispatch::compile(std::vector<aot::CompiledDispatch> &compiled_dispatches,
+                       std::vector<aot::CompiledLoop> &compiled_loops) {
   aot::CompiledDispatch dispatch;
   dispatch.kernel_name = kernel_->get_name();
   dispatch.symbolic_args = symbolic_args_;
@@ -14,11 +18,41 @@ void Dispatch::compile(
 }
 
 void Sequential::compile(
-    std::vector<aot::CompiledDispatch> &compiled_dispatches) {
+    std::vector<aot::CompiledDispatch> &compiled_dispatches,
+    std::vector<aot::CompiledLoop> &compiled_loops) {
   // In the future we can do more across-kernel optimization here.
   for (Node *n : sequence_) {
-    n->compile(compiled_dispatches);
+    n->compile(compiled_dispatches, compiled_loops);
+  }
+}
+
+void Loop::compile(std::vector<aot::CompiledDispatch> &compiled_dispatches,
+                   std::vector<aot::CompiledLoop> &compiled_loops) {
+  aot::CompiledLoop loop;
+  loop.begin = compiled_dispatches.size();
+  const auto num_loops = compiled_loops.size();
+  body_->compile(compiled_dispatches, compiled_loops);
+  TI_ERROR_IF(compiled_loops.size() != num_loops,
+              "Loops of compute graphs cannot be nested");
+  loop.end = compiled_dispatches.size();
+  loop.cond = cond_.name;
+  loop.max_iterations = max_iterations_;
+  loop.check_every = check_every_;
+  for (int dispatch_id = loop.begin;
+       dispatch_id < loop.end && loop.cond_dispatch == -1; ++dispatch_id) {
+    const auto &args = compiled_dispatches[dispatch_id].symbolic_args;
+    for (int i = 0; i < args.size(); ++i) {
+      if (args[i].name == cond_.name) {
+        loop.cond_dispatch = dispatch_id;
+        loop.cond_arg = i;
+        break;
+      }
+    }
   }
+  TI_ERROR_IF(loop.cond_dispatch == -1,
+              "The body of the loop does not take its condition {}",
+              cond_.name);
+  compiled_loops.push_back(std::move(loop));
 }
 
 void Sequential::append(Node *node) {
@@ -30,19 +64,111 @@ void Sequential::dispatch(Kernel *kernel, const std::vector<aot::Arg> &args) {
   sequence_.push_back(n);
 }
 
+namespace {
+
+// Assigns the temporaries to buffers, and returns the sizes of the buffers.
+// The temporaries are visited in the order of their first uses, and each of
+// them takes the free buffer closest in size, where a buffer is free once the
+// last dispatch taking its previous temporary has been launched.
+std::vector<size_t> plan_temporaries(
+    const std::vector<aot::CompiledDispatch> &dispatches,
+    const std::vector<aot::CompiledLoop> &loops,
+    const std::unordered_map<std::string, aot::Arg> &args,
+    const std::unordered_map<std::string, std::vector<int>> &shapes,
+    std::unordered_map<std::string, aot::Temporary> &temporaries) {
+  for (int dispatch_id = 0; dispatch_id < dispatches.size(); ++dispatch_id) {
+    for (const auto &arg : dispatches[dispatch_id].symbolic_args) {
+      auto found = shapes.find(arg.name);
+      if (found == shapes.end()) {
+        continue;
+      }
+      auto [it, inserted] = temporaries.try_emplace(arg.name);
+      auto &temp = it->second;
+      if (inserted) {
+        temp.shape = found->second;
+        size_t num_elements = data_type_size(arg.dtype());
+        for (int i : temp.shape) {
+          num_elements *= i;
+        }
+        for (int i : arg.element_shape) {
+          num_elements *= i;
+        }
+        temp.size = num_elements;
+        temp.first_use = dispatch_id;
+      }
+      temp.last_use = dispatch_id;
+    }
+  }
+  // The temporaries taken in a loop may carry data over to the next
+  // iteration, so they live through the whole loop.
+  for (auto &[name, temp] : temporaries) {
+    for (const auto &loop : loops) {
+      if (temp.first_use < loop.end && temp.last_use >= loop.begin) {
+        temp.first_use = std::min(temp.first_use, loop.begin);
+        temp.last_use = std::max(temp.last_use, loop.end - 1);
+      }
+    }
+  }
+
+  std::vector<aot::Temporary *> order;
+  for (auto &[name, temp] : temporaries) {
+    order.push_back(&temp);
+  }
+  std::sort(order.begin(), order.end(),
+            [](const aot::Temporary *a, const aot::Temporary *b) {
+              return std::tie(a->first_use, b->size) <
+                     std::tie(b->first_use, a->size);
+            });
+  std::vector<size_t> sizes;
+  // The last dispatch taking each buffer.
+  std::vector<int> last_uses;
+  for (auto *temp : order) {
+    // Prefer the smallest buffer large enough, then the largest one to grow.
+    auto better = [&](int i, int j) {
+      const bool fits_i = sizes[i] >= temp->size;
+      const bool fits_j = sizes[j] >= temp->size;
+      if (fits_i != fits_j) {
+        return fits_i;
+      }
+      return fits_i ? sizes[i] < sizes[j] : sizes[i] > sizes[j];
+    };
+    int best = -1;
+    for (int i = 0; i < sizes.size(); ++i) {
+      if (last_uses[i] < temp->first_use && (best == -1 || better(i, best))) {
+        best = i;
+      }
+    }
+    if (best == -1) {
+      best = sizes.size();
+      sizes.push_back(0);
+      last_uses.push_back(-1);
+    }
+    sizes[best] = std::max(sizes[best], temp->size);
+    last_uses[best] = temp->last_use;
+    temp->buffer_id = best;
+  }
+  return sizes;
+}
+
+}  // namespace
+
 GraphBuilder::GraphBuilder() {
   seq_ = std::make_unique<Sequential>(this);
 }
 
+void GraphBuilder::register_arg(const aot::Arg &arg) {
+  if (all_args_.find(arg.name) != all_args_.end()) {
+    TI_ERROR_IF(all_args_[arg.name] != arg,
+                "An arg with name {} already exists!", arg.name);
+  } else {
+    all_args_[arg.name] = arg;
+  }
+}
+
 Node *GraphBuilder::new_dispatch_node(Kernel *kernel,
                                       const std::vector<aot::Arg> &args) {
   for (const auto &arg : args) {
-    if (all_args_.find(arg.name) != all_args_.end()) {
-      TI_ERROR_IF(all_args_[arg.name] != arg,
-                  "An arg with name {} already exists!", arg.name);
-    } else {
-      all_args_[arg.name] = arg;
-    }
+    register_arg(arg);
   }
   all_nodes_.push_back(std::make_unique<Dispatch>(kernel, args));
   return all_nodes_.back().get();
@@ -53,10 +179,42 @@ Sequential *GraphBuilder::new_sequential_node() {
   return static_cast<Sequential *>(all_nodes_.back().get());
 }
 
+Loop *GraphBuilder::new_loop_node(const aot::Arg &cond,
+                                  int max_iterations,
+                                  int check_every) {
+  TI_ERROR_IF(cond.tag != aot::ArgKind::kNdarray || cond.field_dim != 0 ||
+                  !cond.element_shape.empty() ||
+                  cond.dtype() != PrimitiveType::i32,
+              "The condition {} of a loop must be a 0-D i32 ndarray",
+              cond.name);
+  TI_ERROR_IF(max_iterations < 0 || check_every < 0,
+              "Loop {} has a negative iteration count", cond.name);
+  register_arg(cond);
+  auto *body = new_sequential_node();
+  all_nodes_.push_back(
+      std::make_unique<Loop>(body, cond, max_iterations, check_every));
+  return static_cast<Loop *>(all_nodes_.back().get());
+}
+
 std::unique_ptr<aot::CompiledGraph> GraphBuilder::compile() {
   std::vector<aot::CompiledDispatch> dispatches;
-  seq()->compile(dispatches);
+  std::vector<aot::CompiledLoop> loops;
+  seq()->compile(dispatches, loops);
   aot::CompiledGraph graph{dispatches, all_args_};
+  graph.loops = std::move(loops);
+  if (!graph.dispatches.empty()) {
+    auto *prog = graph.dispatches.front().ti_kernel->program;
+    graph.runner = prog->get_program_impl()->make_graph_runner();
+    const auto buffer_sizes =
+        plan_temporaries(graph.dispatches, graph.loops, all_args_,
+                         temporary_shapes_, graph.temporaries);
+    for (size_t size : buffer_sizes) {
+      graph.temporary_buffers.emplace_back(
+          prog->create_ndarray(PrimitiveType::u8,
+                              {int(std::max(size, size_t(1)))}),
+          [prog](Ndarray *arr) { prog->delete_ndarray(arr); });
+    }
+  }
   return std::make_unique<aot::CompiledGraph>(std::move(graph));
 }
 
@@ -68,4 +226,16 @@ void GraphBuilder::dispatch(Kernel *kernel, const std::vector<aot::Arg> &args) {
   seq()->dispatch(kernel, args);
 }
 
+void GraphBuilder::declare_temporary(const aot::Arg &arg,
+                                     const std::vector<int> &shape) {
+  TI_ERROR_IF(arg.tag != aot::ArgKind::kNdarray,
+              "Temporary {} must be an ndarray", arg.name);
+  TI_ERROR_IF(shape.size() != arg.field_dim,
+              "Temporary {} is declared with field_dim={} but got a shape "
+              "with {} dimensions",
+              arg.name, arg.field_dim, shape.size());
+  register_arg(arg);
+  temporary_shapes_[arg.name] = shape;
+}
+
 }  // namespace taichi::lang
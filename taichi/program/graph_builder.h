@@ -19,8 +19,9 @@ class Node {
   Node(Node &&) = default;
   Node &operator=(Node &&) = default;
 
-  virtual void compile(
-      std::vector<aot::CompiledDispatch> &compiled_dispatches) = 0;
+  // Appends the dispatches of the node, and the loops among them.
+  virtual void compile(std::vector<aot::CompiledDispatch> &compiled_dispatches,
+                       std::vector<aot::CompiledLoop> &compiled_loops) = 0;
 };
 
 class Dispatch : public Node {
@@ -29,8 +30,8 @@ class Dispatch : public Node {
       : kernel_(kernel), symbolic_args_(args) {
   }
 
-  void compile(
-      std::vector<aot::CompiledDispatch> &compiled_dispatches) override;
+  void compile(std::vector<aot::CompiledDispatch> &compiled_dispatches,
+               std::vector<aot::CompiledLoop> &compiled_loops) override;
 
  private:
   mutable bool serialized_{false};
@@ -47,14 +48,44 @@ class Sequential : public Node {
 
   void dispatch(Kernel *kernel, const std::vector<aot::Arg> &args);
 
-  void compile(
-      std::vector<aot::CompiledDispatch> &compiled_dispatches) override;
+  void compile(std::vector<aot::CompiledDispatch> &compiled_dispatches,
+               std::vector<aot::CompiledLoop> &compiled_loops) override;
 
  private:
   std::vector<Node *> sequence_;
   GraphBuilder *owning_graph_{nullptr};
 };
 
+/**
+ * Runs its body at most |max_iterations| times, until the body sets the 0-D
+ * i32 ndarray |cond| to 0. See GraphBuilder::new_loop_node().
+ */
+class Loop : public Node {
+ public:
+  explicit Loop(Sequential *body,
+                const aot::Arg &cond,
+                int max_iterations,
+                int check_every)
+      : body_(body),
+        cond_(cond),
+        max_iterations_(max_iterations),
+        check_every_(check_every) {
+  }
+
+  Sequential *body() const {
+    return body_;
+  }
+
+  void compile(std::vector<aot::CompiledDispatch> &compiled_dispatches,
+               std::vector<aot::CompiledLoop> &compiled_loops) override;
+
+ private:
+  Sequential *body_{nullptr};
+  aot::Arg cond_;
+  int max_iterations_{0};
+  int check_every_{1};
+};
+
 class GraphBuilder {
  public:
   explicit GraphBuilder();
@@ -66,13 +97,46 @@ class GraphBuilder {
 
   Sequential *new_sequential_node();
 
+  /**
+   * @brief Creates a loop whose condition is evaluated on the device
+   *
+   * The dispatches of the body write the condition themselves. The host only
+   * reads it every |check_every| iterations, and the iterations in between
+   * are submitted at once, so the kernels of the body have to do nothing once
+   * the condition has been cleared. With |check_every| = 0, the condition is
+   * never read, and the whole loop is a single submission.
+   *
+   * @param cond The 0-D i32 ndarray argument stopping the loop when it is 0.
+   * It must be taken by the body.
+   * @param max_iterations The number of iterations launched at most
+   * @param check_every The iterations launched between two reads of |cond|
+   */
+  Loop *new_loop_node(const aot::Arg &cond,
+                      int max_iterations,
+                      int check_every);
+
   void dispatch(Kernel *kernel, const std::vector<aot::Arg> &args);
 
+  /**
+   * @brief Declares an ndarray argument allocated by the graph itself
+   *
+   * The argument can only be used to pass data between the dispatches of the
+   * graph, and is not given to run(). Temporaries that are never taken by the
+   * same dispatch share the memory.
+   *
+   * @param arg The symbolic ndarray argument
+   * @param shape The shape of the ndarray, without the element shape
+   */
+  void declare_temporary(const aot::Arg &arg, const std::vector<int> &shape);
+
   Sequential *seq() const;
 
  private:
+  void register_arg(const aot::Arg &arg);
+
   std::unique_ptr<Sequential> seq_{nullptr};
   std::unordered_map<std::string, aot::Arg> all_args_;
+  std::unordered_map<std::string, std::vector<int>> temporary_shapes_;
   std::vector<std::unique_ptr<Node>> all_nodes_;
 };
 
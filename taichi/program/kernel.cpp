@@ -1,13 +1,18 @@
 #include "taichi/program/kernel.h"
 
+#include <chrono>
+
 #include "taichi/rhi/cuda/cuda_driver.h"
+#include "taichi/analysis/offline_cache_util.h"
 #include "taichi/codegen/codegen.h"
 #include "taichi/common/logging.h"
 #include "taichi/common/task.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/program.h"
+#include "taichi/system/flight_recorder.h"
 #include "taichi/util/action_recorder.h"
 
 #ifdef TI_WITH_LLVM
@@ -56,16 +61,47 @@ Kernel::Kernel(Program &program,
 }
 
 void Kernel::compile(const CompileConfig &compile_config) {
-  compiled_ = program->compile(compile_config, *this);
+  set_compiled(program->compile(compile_config, *this));
+}
+
+std::vector<std::unordered_map<SNode *, AccessFootprint>>
+Kernel::gather_access_footprints(const CompileConfig &compile_config) {
+  TI_ERROR_IF(lowered() || is_compiled(),
+              "The access footprints of kernel '{}' can't be gathered after "
+              "it is compiled",
+              get_name());
+  irpass::compile_to_offloads(ir.get(), compile_config, this,
+                              /*verbose=*/false, autodiff_mode,
+                              /*ad_use_stack=*/true,
+                              /*start_from_ast=*/ir_is_ast());
+  set_lowered(true);
+  return irpass::analysis::gather_access_footprints(ir.get());
 }
 
 void Kernel::operator()(const CompileConfig &compile_config,
                         LaunchContextBuilder &ctx_builder) {
-  if (!compiled_) {
-    compile(compile_config);
+  if (!is_compiled()) {
+    if (pending_compilation_.valid()) {
+      // Only block on the warm-up once. Should it have failed, the error is
+      // rethrown here and later launches compile the kernel themselves.
+      auto compilation = std::move(pending_compilation_);
+      pending_compilation_ = {};
+      compilation.get();
+    }
+    if (!is_compiled()) {
+      compile(compile_config);
+    }
   }
 
-  compiled_(ctx_builder.get_context());
+  Kernel *kernel = this;
+  if (may_specialize_shapes(compile_config)) {
+    kernel = get_shape_variant(compile_config, ctx_builder.get_context());
+  }
+  auto *queue = program->get_launch_queue();
+  if (queue && queue->enqueue(kernel, ctx_builder.get_context())) {
+    return;
+  }
+  kernel->launch_compiled(ctx_builder.get_context());
 
   const auto arch = compile_config.arch;
   if (compile_config.debug && (arch_is_cpu(arch) || arch == Arch::cuda)) {
@@ -73,6 +109,149 @@ void Kernel::operator()(const CompileConfig &compile_config,
   }
 }
 
+bool Kernel::may_specialize_shapes(const CompileConfig &config) const {
+  if (config.specialize_ndarray_shapes <= 0 || !arch_uses_llvm(config.arch) ||
+      autodiff_mode != AutodiffMode::kNone || is_accessor || is_evaluator ||
+      !specialized_shapes_.empty()) {
+    return false;
+  }
+  for (const auto &param : parameter_list) {
+    if (param.is_array) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Kernel *Kernel::get_shape_variant(const CompileConfig &config,
+                                  const RuntimeContext &ctx) {
+  // Kernels launched with ever-changing shapes stop tracking new ones.
+  constexpr std::size_t kMaxTrackedShapes = 64;
+  const int num_args =
+      std::min((int)parameter_list.size(), taichi_max_num_args_extra);
+  std::vector<std::vector<int32>> shapes(num_args);
+  for (int i = 0; i < num_args; i++) {
+    const auto &param = parameter_list[i];
+    if (!param.is_array) {
+      continue;
+    }
+    // Only the array axes are in the context, element shapes are static.
+    const int ndim = std::clamp(
+        (int)param.total_dim - (int)param.get_element_shape().size(), 0,
+        taichi_max_num_indices);
+    shapes[i].assign(ctx.extra_args[i], ctx.extra_args[i] + ndim);
+  }
+  auto iter = shape_variants_.find(shapes);
+  if (iter == shape_variants_.end()) {
+    if (shape_variants_.size() >= kMaxTrackedShapes) {
+      return this;
+    }
+    iter = shape_variants_.emplace(std::move(shapes), ShapeVariant()).first;
+  }
+  auto &variant = iter->second;
+  if (!variant.kernel) {
+    if (++variant.num_launches == config.specialize_ndarray_shapes &&
+        !shape_dynamic_ir_ && ir_is_ast() && !lowered()) {
+      // The kernel was loaded from the offline cache, so its AST has not been
+      // lowered yet.
+      if (ast_key_.empty()) {
+        ast_key_ = get_hashed_offline_cache_key_of_ast(program, ir.get());
+      }
+      irpass::frontend_type_check(ir.get());
+      irpass::lower_ast(ir.get());
+      ir_is_ast_ = false;
+      shape_dynamic_ir_ = irpass::analysis::clone(ir.get());
+    }
+    if (variant.num_launches == config.specialize_ndarray_shapes &&
+        shape_dynamic_ir_) {
+      variant.kernel = std::make_unique<Kernel>(
+          *program, irpass::analysis::clone(shape_dynamic_ir_.get()),
+          fmt::format("{}_shapes{}", name, num_shape_variants_++));
+      auto &specialized = *variant.kernel;
+      specialized.parameter_list = parameter_list;
+      specialized.rets = rets;
+      specialized.ret_type = ret_type;
+      specialized.no_activate = no_activate;
+      specialized.specialized_shapes_ = iter->first;
+      // The offline cache key of the variant is that of the AST it was
+      // lowered from, along with its shapes.
+      std::string ast_key = ast_key_;
+      for (const auto &shape : iter->first) {
+        ast_key += fmt::format(";{}", fmt::join(shape, ","));
+      }
+      specialized.set_ast_key_for_cache(ast_key);
+      program->warm_up_kernels(config, {&specialized});
+    }
+    return this;
+  }
+  auto *specialized = variant.kernel.get();
+  if (specialized->is_compiled()) {
+    return specialized;
+  }
+  auto &compilation = specialized->pending_compilation_;
+  if (compilation.valid() &&
+      compilation.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready &&
+      !specialized->is_compiled()) {
+    // The variant failed to compile, the shapes keep using this kernel.
+    TI_WARN("Failed to specialize kernel '{}' on its ndarray shapes", name);
+    variant.kernel.reset();
+  }
+  return this;
+}
+
+void Kernel::launch_compiled(RuntimeContext &ctx) {
+  uint64 args_bytes = 0;
+  if (FlightRecorder::enabled()) {
+    for (int i = 0; i < (int)parameter_list.size(); i++) {
+      if (parameter_list[i].is_array) {
+        args_bytes += ctx.array_runtime_sizes[i];
+      }
+    }
+  }
+  FlightRecorder::Scope trace(TraceEvent::launch, get_trace_name_id(),
+                              args_bytes);
+  compiled_(ctx);
+}
+
+uint32 Kernel::get_trace_name_id() {
+  if (!FlightRecorder::enabled()) {
+    return 0;
+  }
+  auto id = trace_name_id_.load(std::memory_order_relaxed);
+  if (id == 0) {
+    id = FlightRecorder::get_instance().intern(get_name());
+    trace_name_id_.store(id, std::memory_order_relaxed);
+  }
+  return id;
+}
+
+const Kernel::LaunchArgLayout &Kernel::get_launch_arg_layout() {
+  if (!launch_arg_layout_.has_value()) {
+    LaunchArgLayout layout;
+    using Kind = LaunchArgLayout::Kind;
+    for (const auto &param : parameter_list) {
+      LaunchArgLayout::Entry entry;
+      if (param.is_array) {
+        entry.kind = Kind::kNdarray;
+      } else {
+        auto dt = param.get_dtype();
+        TI_ASSERT_INFO(dt->is<PrimitiveType>(),
+                       "Parameters of type {} can't be set with set_args",
+                       dt->to_string());
+        entry.dt = dt->as<PrimitiveType>()->type;
+        entry.kind = is_real(dt)     ? Kind::kFloat
+                     : is_signed(dt) ? Kind::kInt
+                                     : Kind::kUInt;
+      }
+      layout.num_values += entry.kind == Kind::kNdarray ? 2 : 1;
+      layout.entries.push_back(entry);
+    }
+    launch_arg_layout_ = std::move(layout);
+  }
+  return *launch_arg_layout_;
+}
+
 Kernel::LaunchContextBuilder Kernel::make_launch_context() {
   return LaunchContextBuilder(this);
 }
@@ -233,6 +412,86 @@ void Kernel::LaunchContextBuilder::set_arg_raw(int arg_id, uint64 d) {
   ctx_->set_arg<uint64>(arg_id, d);
 }
 
+void Kernel::LaunchContextBuilder::set_args(const LaunchArgValue *values,
+                                            std::size_t num_values) {
+  const auto &layout = get_arg_layout();
+  TI_ASSERT_INFO(num_values == layout.num_values,
+                 "Kernel {} takes {} argument values, {} provided",
+                 kernel_->name, layout.num_values, num_values);
+  using Kind = LaunchArgLayout::Kind;
+  if (ActionRecorder::get_instance().is_recording()) {
+    // Goes through the setters that record the arguments.
+    for (int arg_id = 0; arg_id < (int)layout.entries.size(); arg_id++) {
+      const auto &entry = layout.entries[arg_id];
+      if (entry.kind == Kind::kNdarray) {
+        if (values[1].arr) {
+          set_arg_ndarray_with_grad(arg_id, *values[0].arr, *values[1].arr);
+        } else {
+          set_arg_ndarray(arg_id, *values[0].arr);
+        }
+        values += 2;
+      } else if (entry.kind == Kind::kFloat) {
+        set_arg_float(arg_id, (values++)->f);
+      } else {
+        set_arg_int(arg_id, (values++)->i);
+      }
+    }
+    return;
+  }
+  for (int arg_id = 0; arg_id < (int)layout.entries.size(); arg_id++) {
+    const auto &entry = layout.entries[arg_id];
+    if (entry.kind == Kind::kNdarray) {
+      const auto &arr = *values[0].arr;
+      TI_ASSERT_INFO(arr.shape.size() <= taichi_max_num_indices,
+                     "External array cannot have > {max_num_indices} indices");
+      const auto *grad = values[1].arr;
+      const intptr_t grad_ptr =
+          grad ? grad->get_device_allocation_ptr_as_int() : 0;
+      ctx_->set_arg_ndarray(arg_id, arr.get_device_allocation_ptr_as_int(),
+                            arr.shape, grad != nullptr, grad_ptr);
+      values += 2;
+      continue;
+    }
+    const auto &v = *(values++);
+    switch (entry.dt) {
+      case PrimitiveTypeID::f16:
+        // use f32 to interact with python
+      case PrimitiveTypeID::f32:
+        ctx_->set_arg(arg_id, (float32)v.f);
+        break;
+      case PrimitiveTypeID::f64:
+        ctx_->set_arg(arg_id, v.f);
+        break;
+      case PrimitiveTypeID::i8:
+        ctx_->set_arg(arg_id, (int8)v.i);
+        break;
+      case PrimitiveTypeID::i16:
+        ctx_->set_arg(arg_id, (int16)v.i);
+        break;
+      case PrimitiveTypeID::i32:
+        ctx_->set_arg(arg_id, (int32)v.i);
+        break;
+      case PrimitiveTypeID::i64:
+        ctx_->set_arg(arg_id, v.i);
+        break;
+      case PrimitiveTypeID::u8:
+        ctx_->set_arg(arg_id, (uint8)v.u);
+        break;
+      case PrimitiveTypeID::u16:
+        ctx_->set_arg(arg_id, (uint16)v.u);
+        break;
+      case PrimitiveTypeID::u32:
+        ctx_->set_arg(arg_id, (uint32)v.u);
+        break;
+      case PrimitiveTypeID::u64:
+        ctx_->set_arg(arg_id, v.u);
+        break;
+      default:
+        TI_NOT_IMPLEMENTED
+    }
+  }
+}
+
 RuntimeContext &Kernel::LaunchContextBuilder::get_context() {
   kernel_->program->prepare_runtime_context(ctx_);
   return *ctx_;
@@ -240,32 +499,7 @@ RuntimeContext &Kernel::LaunchContextBuilder::get_context() {
 
 template <typename T>
 T Kernel::fetch_ret(DataType dt, int i) {
-  if (dt->is_primitive(PrimitiveTypeID::f32)) {
-    return (T)program->fetch_result<float32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
-    return (T)program->fetch_result<float64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i32)) {
-    return (T)program->fetch_result<int32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
-    return (T)program->fetch_result<int64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
-    return (T)program->fetch_result<int8>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
-    return (T)program->fetch_result<int16>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
-    return (T)program->fetch_result<uint8>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
-    return (T)program->fetch_result<uint16>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
-    return (T)program->fetch_result<uint32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
-    return (T)program->fetch_result<uint64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
-    // use f32 to interact with python
-    return (T)program->fetch_result<float32>(i);
-  } else {
-    TI_NOT_IMPLEMENTED
-  }
+  return decode_ret_value<T>(dt, program->fetch_result_uint64(i));
 }
 
 float64 Kernel::get_ret_float(int i) {
@@ -313,6 +547,13 @@ std::vector<float64> Kernel::get_ret_float_tensor(int i) {
   return res;
 }
 
+std::unique_ptr<KernelReturnFuture> Kernel::get_ret_future() {
+  TI_ASSERT_INFO(!rets.empty(), "Kernel {} has no return value", name);
+  const int num_slots = KernelReturnFuture::get_num_slots(rets[0].dt);
+  return std::make_unique<KernelReturnFuture>(
+      rets[0].dt, program->fetch_results_deferred(num_slots));
+}
+
 std::string Kernel::get_name() const {
   return name;
 }
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <map>
+#include <optional>
+
 #include "taichi/util/lang_util.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/ir.h"
 #include "taichi/rhi/arch.h"
 #include "taichi/program/callable.h"
+#include "taichi/program/kernel_return_future.h"
 #include "taichi/program/ndarray.h"
 #include "taichi/program/texture.h"
 #include "taichi/aot/graph_data.h"
@@ -12,6 +18,7 @@
 namespace taichi::lang {
 
 class Program;
+struct AccessFootprint;
 
 class TI_DLL_EXPORT Kernel : public Callable {
  public:
@@ -22,6 +29,30 @@ class TI_DLL_EXPORT Kernel : public Callable {
   bool is_evaluator{false};
   AutodiffMode autodiff_mode{AutodiffMode::kNone};
 
+  // How LaunchContextBuilder::set_args() reads each parameter, resolved once
+  // per kernel rather than on each launch.
+  struct LaunchArgLayout {
+    // Which member of LaunchArgValue holds the value.
+    enum class Kind : uint8 { kFloat, kInt, kUInt, kNdarray };
+    struct Entry {
+      Kind kind{Kind::kFloat};
+      // PrimitiveTypeID::unknown for ndarrays.
+      PrimitiveTypeID dt{PrimitiveTypeID::unknown};
+    };
+    // By arg id.
+    std::vector<Entry> entries;
+    // A scalar takes one value, an ndarray two: itself and its gradient.
+    std::size_t num_values{0};
+  };
+
+  // A value of LaunchContextBuilder::set_args().
+  union LaunchArgValue {
+    float64 f;  // Floating-point parameters
+    int64 i;    // Signed integer parameters
+    uint64 u;   // Unsigned integer parameters
+    const Ndarray *arr;  // Ndarrays and their gradients, which may be null
+  };
+
   class LaunchContextBuilder {
    public:
     LaunchContextBuilder(Kernel *kernel, RuntimeContext *ctx);
@@ -57,6 +88,15 @@ class TI_DLL_EXPORT Kernel : public Callable {
     // This ignores the underlying kernel's |arg_id|-th arg type.
     void set_arg_raw(int arg_id, uint64 d);
 
+    // Sets all the arguments in one go from the |num_values| values laid out
+    // as described by get_arg_layout(). Textures and external arrays are not
+    // supported.
+    void set_args(const LaunchArgValue *values, std::size_t num_values);
+
+    const LaunchArgLayout &get_arg_layout() const {
+      return kernel_->get_launch_arg_layout();
+    }
+
     RuntimeContext &get_context();
 
    private:
@@ -98,9 +138,39 @@ class TI_DLL_EXPORT Kernel : public Callable {
 
   void compile(const CompileConfig &compile_config);
 
+  // Lowers the kernel to offloaded tasks in place, and returns how each of
+  // them accesses the SNodes. The kernel is not meant to be launched then.
+  std::vector<std::unordered_map<SNode *, AccessFootprint>>
+  gather_access_footprints(const CompileConfig &compile_config);
+
+  bool is_compiled() const {
+    return is_compiled_.load(std::memory_order_acquire);
+  }
+
+  // Publishes |compiled|. This may happen on a warm-up thread while the
+  // kernel is being launched, see Program::warm_up_kernels().
+  void set_compiled(FunctionType compiled) {
+    compiled_ = std::move(compiled);
+    is_compiled_.store(true, std::memory_order_release);
+  }
+
+  // |compilation| becomes ready once a background compilation of this kernel
+  // has published its result, or rethrows the error of that compilation.
+  void set_pending_compilation(std::shared_future<void> compilation) {
+    pending_compilation_ = std::move(compilation);
+  }
+
+  bool has_pending_compilation() const {
+    return pending_compilation_.valid();
+  }
+
   void operator()(const CompileConfig &compile_config,
                   LaunchContextBuilder &ctx_builder);
 
+  // Launches the compiled kernel with |ctx| right away, bypassing the
+  // LaunchQueue of the program.
+  void launch_compiled(RuntimeContext &ctx);
+
   LaunchContextBuilder make_launch_context();
 
   template <typename T>
@@ -113,12 +183,23 @@ class TI_DLL_EXPORT Kernel : public Callable {
   std::vector<uint64> get_ret_uint_tensor(int i);
   std::vector<float64> get_ret_float_tensor(int i);
 
+  // Reads the return value of the last launch once it is needed, instead of
+  // synchronizing the device now.
+  std::unique_ptr<KernelReturnFuture> get_ret_future();
+
   uint64 get_next_task_id() {
     return task_counter_++;
   }
 
   [[nodiscard]] std::string get_name() const override;
 
+  // The name of the kernel as interned by the FlightRecorder, 0 if the
+  // recorder is disabled.
+  uint32 get_trace_name_id();
+
+  // Made on first use, once all the parameters are inserted.
+  const LaunchArgLayout &get_launch_arg_layout();
+
   void set_kernel_key_for_cache(const std::string &kernel_key) {
     kernel_key_ = kernel_key;
   }
@@ -127,24 +208,71 @@ class TI_DLL_EXPORT Kernel : public Callable {
     return kernel_key_;
   }
 
+  // The hash of the frontend AST, which is part of the offline cache key of
+  // the kernel for any compile config. Empty until it is computed.
+  void set_ast_key_for_cache(const std::string &ast_key) {
+    ast_key_ = ast_key;
+  }
+
+  const std::string &get_cached_ast_key() const {
+    return ast_key_;
+  }
+
   void offload_to_executable(const CompileConfig &config, IRNode *stmt);
 
+  // Whether launches of the kernel may switch to variants specialized on
+  // their ndarray shapes, see CompileConfig::specialize_ndarray_shapes. The
+  // variants are built from the lowered AST passed to set_shape_dynamic_ir().
+  bool may_specialize_shapes(const CompileConfig &config) const;
+
+  void set_shape_dynamic_ir(std::unique_ptr<IRNode> ir) {
+    shape_dynamic_ir_ = std::move(ir);
+  }
+
+  // The shapes of the ndarrays, by arg id, that this variant of a kernel is
+  // specialized on. Empty for any other kernel.
+  const std::vector<std::vector<int32>> &get_specialized_shapes() const {
+    return specialized_shapes_;
+  }
+
  private:
   void init(Program &program,
             const std::function<void()> &func,
             const std::string &name = "",
             AutodiffMode autodiff_mode = AutodiffMode::kNone);
 
+  // Returns the kernel to launch with |ctx|. That's this one, unless the
+  // variant specialized on the ndarray shapes in |ctx| has been compiled.
+  Kernel *get_shape_variant(const CompileConfig &config,
+                            const RuntimeContext &ctx);
+
+  struct ShapeVariant {
+    int num_launches{0};
+    // Null until the shapes have been launched with often enough, and again
+    // if the compilation of the variant fails.
+    std::unique_ptr<Kernel> kernel;
+  };
+
   // True if |ir| is a frontend AST. False if it's already offloaded to CHI IR.
   bool ir_is_ast_{false};
   // The closure that, if invoked, launches the backend kernel (shader)
   FunctionType compiled_{nullptr};
+  std::atomic<bool> is_compiled_{false};
+  std::shared_future<void> pending_compilation_;
   // A flag to record whether |ir| has been fully lowered.
   // lower initial AST all the way down to a bunch of
   // OffloadedStmt for async execution TODO(Lin): Check this comment
   bool lowered_{false};
   std::atomic<uint64> task_counter_{0};
   std::string kernel_key_;
+  std::string ast_key_;
+  std::atomic<uint32> trace_name_id_{0};
+  std::optional<LaunchArgLayout> launch_arg_layout_;
+  std::unique_ptr<IRNode> shape_dynamic_ir_;
+  // By the shapes of the ndarrays.
+  std::map<std::vector<std::vector<int32>>, ShapeVariant> shape_variants_;
+  int num_shape_variants_{0};
+  std::vector<std::vector<int32>> specialized_shapes_;
 };
 
 }  // namespace taichi::lang
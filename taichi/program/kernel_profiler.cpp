@@ -1,8 +1,13 @@
 #include "kernel_profiler.h"
 
+#include <mutex>
+#include <unordered_map>
+
+#include "taichi/ir/analysis.h"
 #include "taichi/system/timer.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/rhi/cuda/cuda_profiler.h"
+#include "taichi/program/kernel_profiler_cpu.h"
 #include "taichi/system/timeline.h"
 
 namespace taichi::lang {
@@ -61,10 +66,55 @@ void KernelProfilerBase::query(const std::string &kernel_name,
   }
 }
 
+namespace {
+
+std::mutex task_costs_mut;
+std::unordered_map<std::string, TaskCost> task_costs;
+
+}  // namespace
+
+void KernelProfilerBase::register_task_cost(const std::string &task_name,
+                                            const TaskCost &cost) {
+  std::lock_guard<std::mutex> _(task_costs_mut);
+  task_costs[task_name] = cost;
+}
+
+bool KernelProfilerBase::get_task_cost(const std::string &task_name,
+                                       TaskCost &cost) {
+  std::lock_guard<std::mutex> _(task_costs_mut);
+  auto iter = task_costs.find(task_name);
+  if (iter == task_costs.end()) {
+    return false;
+  }
+  cost = iter->second;
+  return true;
+}
+
 double KernelProfilerBase::get_total_time() const {
   return total_time_ms_ / 1000.0;
 }
 
+void KernelProfilerBase::insert_record(const std::string &kernel_name,
+                                       double elapsed_ms) {
+  // trace record
+  KernelProfileTracedRecord record;
+  record.name = kernel_name;
+  record.kernel_elapsed_time_in_ms = elapsed_ms;
+  traced_records_.push_back(record);
+  // count record
+  auto it =
+      std::find_if(statistical_results_.begin(), statistical_results_.end(),
+                   [&](KernelProfileStatisticalResult &r) {
+                     return r.name == kernel_name;
+                   });
+  if (it == statistical_results_.end()) {
+    statistical_results_.emplace_back(kernel_name);
+    it = std::prev(statistical_results_.end());
+  }
+  it->insert_record(elapsed_ms);
+  total_time_ms_ += elapsed_ms;
+}
+
 namespace {
 // A simple profiler that uses Time::get_time()
 class DefaultProfiler : public KernelProfilerBase {
@@ -89,24 +139,7 @@ class DefaultProfiler : public KernelProfilerBase {
 
   void stop() override {
     auto t = Time::get_time() - start_t_;
-    auto ms = t * 1000.0;
-    // trace record
-    KernelProfileTracedRecord record;
-    record.name = event_name_;
-    record.kernel_elapsed_time_in_ms = ms;
-    traced_records_.push_back(record);
-    // count record
-    auto it =
-        std::find_if(statistical_results_.begin(), statistical_results_.end(),
-                     [&](KernelProfileStatisticalResult &r) {
-                       return r.name == event_name_;
-                     });
-    if (it == statistical_results_.end()) {
-      statistical_results_.emplace_back(event_name_);
-      it = std::prev(statistical_results_.end());
-    }
-    it->insert_record(ms);
-    total_time_ms_ += ms;
+    insert_record(event_name_, t * 1000.0);
   }
 
  private:
@@ -125,6 +158,8 @@ std::unique_ptr<KernelProfilerBase> make_profiler(Arch arch, bool enable) {
 #else
     TI_NOT_IMPLEMENTED;
 #endif
+  } else if (arch_is_cpu(arch)) {
+    return std::make_unique<KernelProfilerCPU>();
   } else {
     return std::make_unique<DefaultProfiler>();
   }
@@ -12,13 +12,19 @@
 
 namespace taichi::lang {
 
+struct TaskCost;
+
 struct KernelProfileTracedRecord {
   // kernel attributes
   int register_per_thread{0};
+  // Bytes of local memory, mostly register spills, taken by each thread.
+  int local_mem_per_thread{0};
   int shared_mem_per_block{0};
   int grid_size{0};
   int block_size{0};
   int active_blocks_per_multiprocessor{0};
+  // The fraction of the threads of a multiprocessor that can be active.
+  float occupancy{0.0};
   // kernel time
   float kernel_elapsed_time_in_ms{0.0};
   float time_since_base{0.0};        // for Timeline
@@ -48,6 +54,7 @@ class KernelProfilerBase {
   std::vector<KernelProfileTracedRecord> traced_records_;
   std::vector<KernelProfileStatisticalResult> statistical_results_;
   double total_time_ms_{0};
+  std::map<std::string, double> counters_;
 
  public:
   // Needed for the CUDA backend since we need to know which task to "stop"
@@ -94,11 +101,39 @@ class KernelProfilerBase {
 
   double get_total_time() const;
 
+  // Adds a kernel launch timed by the backend itself, e.g. with the timestamp
+  // queries of the GFX backends.
+  void insert_record(const std::string &kernel_name, double elapsed_ms);
+
+  // Counters reported by the runtime rather than by kernels, e.g. how the
+  // command queue of the GFX backends is used.
+  void set_counter(const std::string &name, double value) {
+    counters_[name] = value;
+  }
+
+  const std::map<std::string, double> &get_counters() const {
+    return counters_;
+  }
+
   virtual std::string get_device_name() {
     std::string str(" ");
     return str;
   }
 
+  // The peak memory bandwidth in GB/s and the peak FP32 throughput in
+  // GFLOP/s of the device, if the backend can tell.
+  virtual bool get_device_peaks(double &gbps, double &gflops) {
+    return false;
+  }
+
+  // Static estimates of the work of the offloaded tasks, by the names the
+  // tasks are profiled with. The codegens register them when the kernel
+  // profiler is on, so tasks loaded from the offline cache have none.
+  static void register_task_cost(const std::string &task_name,
+                                 const TaskCost &cost);
+
+  static bool get_task_cost(const std::string &task_name, TaskCost &cost);
+
   virtual ~KernelProfilerBase() {
   }
 };
@@ -0,0 +1,242 @@
+#include "taichi/program/kernel_profiler_cpu.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "taichi/system/timer.h"
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace taichi::lang {
+
+namespace {
+
+struct CpuMetric {
+  const char *name;
+  uint32_t type;
+  uint64_t config;
+};
+
+#if defined(__linux__)
+constexpr CpuMetric kCpuMetrics[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    // The generic cache events count the last level cache on most CPUs.
+    {"llc_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int perf_event_open(const CpuMetric &metric, int tid, int group_fd) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = metric.type;
+  attr.config = metric.config;
+  // User space only, which perf_event_paranoid <= 2 allows.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return int(syscall(SYS_perf_event_open, &attr, tid, -1, group_fd,
+                     PERF_FLAG_FD_CLOEXEC));
+}
+
+std::vector<int> list_threads() {
+  std::vector<int> tids;
+  if (DIR *dir = opendir("/proc/self/task")) {
+    while (dirent *entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') {
+        tids.push_back(std::atoi(entry->d_name));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(tids.begin(), tids.end());
+  return tids;
+}
+#else
+constexpr CpuMetric kCpuMetrics[] = {{"", 0, 0}};
+#endif
+
+}  // namespace
+
+KernelProfilerCPU::~KernelProfilerCPU() {
+  for (auto &counters : threads_) {
+    close_counters(counters);
+  }
+}
+
+std::vector<std::string> KernelProfilerCPU::get_metric_names() {
+  std::vector<std::string> names;
+#if defined(__linux__)
+  for (const auto &metric : kCpuMetrics) {
+    names.push_back(metric.name);
+  }
+#endif
+  return names;
+}
+
+bool KernelProfilerCPU::reinit_with_metrics(
+    const std::vector<std::string> metrics) {
+  for (auto &counters : threads_) {
+    close_counters(counters);
+  }
+  threads_.clear();
+  metric_ids_.clear();
+  if (metrics.empty()) {
+    return true;
+  }
+#if defined(__linux__)
+  const auto names = get_metric_names();
+  for (const auto &metric : metrics) {
+    auto it = std::find(names.begin(), names.end(), metric);
+    if (it == names.end()) {
+      TI_WARN("Unknown CPU kernel profiler metric {}, valid metrics are {}",
+              metric, fmt::join(names, ", "));
+      metric_ids_.clear();
+      return false;
+    }
+    metric_ids_.push_back(int(it - names.begin()));
+  }
+  ThreadCounters counters;
+  if (!open_counters(int(syscall(SYS_gettid)), counters)) {
+    TI_WARN(
+        "perf_event_open failed ({}), hardware counters are unavailable. "
+        "Lowering /proc/sys/kernel/perf_event_paranoid may help.",
+        std::strerror(errno));
+    metric_ids_.clear();
+    return false;
+  }
+  close_counters(counters);
+  return true;
+#else
+  TI_WARN("Hardware counters of the CPU kernel profiler need Linux");
+  return false;
+#endif
+}
+
+bool KernelProfilerCPU::open_counters(int tid, ThreadCounters &counters) {
+#if defined(__linux__)
+  counters.tid = tid;
+  for (int id : metric_ids_) {
+    const int fd = perf_event_open(
+        kCpuMetrics[id], tid, counters.fds.empty() ? -1 : counters.fds[0]);
+    if (fd < 0) {
+      close_counters(counters);
+      return false;
+    }
+    counters.fds.push_back(fd);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void KernelProfilerCPU::close_counters(ThreadCounters &counters) {
+#if defined(__linux__)
+  // Members of the group first.
+  for (auto it = counters.fds.rbegin(); it != counters.fds.rend(); ++it) {
+    close(*it);
+  }
+#endif
+  counters.fds.clear();
+}
+
+// Follows the threads of the process, which include the workers the
+// ThreadPool starts lazily.
+void KernelProfilerCPU::refresh_threads() {
+#if defined(__linux__)
+  const auto tids = list_threads();
+  std::vector<ThreadCounters> threads;
+  auto it = threads_.begin();
+  for (int tid : tids) {
+    while (it != threads_.end() && it->tid < tid) {
+      close_counters(*it++);
+    }
+    if (it != threads_.end() && it->tid == tid) {
+      threads.push_back(std::move(*it++));
+      continue;
+    }
+    // The thread may have exited since.
+    ThreadCounters counters;
+    if (open_counters(tid, counters)) {
+      threads.push_back(std::move(counters));
+    }
+  }
+  for (; it != threads_.end(); ++it) {
+    close_counters(*it);
+  }
+  threads_ = std::move(threads);
+#endif
+}
+
+bool KernelProfilerCPU::read_counters(const ThreadCounters &counters,
+                                      std::vector<double> &values) {
+#if defined(__linux__)
+  // nr, time_enabled, time_running, then the values.
+  std::vector<uint64_t> buffer(3 + counters.fds.size());
+  const auto size = sizeof(uint64_t) * buffer.size();
+  if (read(counters.fds[0], buffer.data(), size) != ssize_t(size)) {
+    return false;
+  }
+  // Scales up counts of groups that were multiplexed with other events.
+  const double scale =
+      buffer[2] > 0 ? double(buffer[1]) / double(buffer[2]) : 0.0;
+  values.resize(counters.fds.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = double(buffer[3 + i]) * scale;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void KernelProfilerCPU::clear() {
+  total_time_ms_ = 0;
+  traced_records_.clear();
+  statistical_results_.clear();
+}
+
+void KernelProfilerCPU::start(const std::string &kernel_name) {
+  event_name_ = kernel_name;
+  if (!metric_ids_.empty()) {
+    refresh_threads();
+    for (auto &counters : threads_) {
+      if (!read_counters(counters, counters.start_values)) {
+        counters.start_values.clear();
+      }
+    }
+  }
+  start_t_ = Time::get_time();
+}
+
+void KernelProfilerCPU::stop() {
+  const auto t = Time::get_time() - start_t_;
+  insert_record(event_name_, t * 1000.0);
+  if (metric_ids_.empty()) {
+    return;
+  }
+  auto &metric_values = traced_records_.back().metric_values;
+  metric_values.assign(metric_ids_.size(), 0.0f);
+  std::vector<double> values;
+  for (const auto &counters : threads_) {
+    if (counters.start_values.empty() || !read_counters(counters, values)) {
+      continue;
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+      metric_values[i] += float(values[i] - counters.start_values[i]);
+    }
+  }
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "taichi/program/kernel_profiler.h"
+
+#include <string>
+#include <vector>
+
+namespace taichi::lang {
+
+// Times the offloaded tasks of the CPU backends. With metrics such as
+// "cycles" or "llc_misses", it also reads hardware counters through
+// perf_event_open (Linux only), summed over all threads of the process so
+// that the work of the ThreadPool workers is included.
+class KernelProfilerCPU : public KernelProfilerBase {
+ public:
+  KernelProfilerCPU() = default;
+  ~KernelProfilerCPU() override;
+
+  bool reinit_with_metrics(const std::vector<std::string> metrics) override;
+
+  void sync() override {
+  }
+
+  void update() override {
+  }
+
+  void clear() override;
+
+  void start(const std::string &kernel_name) override;
+
+  void stop() override;
+
+  // The metrics reinit_with_metrics() accepts.
+  static std::vector<std::string> get_metric_names();
+
+ private:
+  struct ThreadCounters {
+    int tid{0};
+    // One counter per metric, the first one leading the group.
+    std::vector<int> fds;
+    std::vector<double> start_values;
+  };
+
+  bool open_counters(int tid, ThreadCounters &counters);
+  void close_counters(ThreadCounters &counters);
+  void refresh_threads();
+  bool read_counters(const ThreadCounters &counters,
+                     std::vector<double> &values);
+
+  double start_t_{0};
+  std::string event_name_;
+  std::vector<int> metric_ids_;
+  std::vector<ThreadCounters> threads_;
+};
+
+}  // namespace taichi::lang
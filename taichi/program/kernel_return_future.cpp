@@ -0,0 +1,53 @@
+#include "taichi/program/kernel_return_future.h"
+
+namespace taichi::lang {
+
+float64 KernelReturnFuture::get_ret_float(int i) {
+  return decode_ret_value<float64>(ret_dt_->get_compute_type(),
+                                   results_->wait()[i]);
+}
+
+int64 KernelReturnFuture::get_ret_int(int i) {
+  return decode_ret_value<int64>(ret_dt_->get_compute_type(),
+                                 results_->wait()[i]);
+}
+
+uint64 KernelReturnFuture::get_ret_uint(int i) {
+  return decode_ret_value<uint64>(ret_dt_->get_compute_type(),
+                                  results_->wait()[i]);
+}
+
+template <typename T>
+std::vector<T> KernelReturnFuture::get_tensor() {
+  const auto *tensor_type = ret_dt_->as<TensorType>();
+  DataType dt = tensor_type->get_element_type();
+  const int size = tensor_type->get_num_elements();
+  const uint64 *slots = results_->wait();
+  std::vector<T> res;
+  res.reserve(size);
+  for (int j = 0; j < size; j++) {
+    res.emplace_back(decode_ret_value<T>(dt, slots[j]));
+  }
+  return res;
+}
+
+std::vector<int64> KernelReturnFuture::get_ret_int_tensor(int i) {
+  return get_tensor<int64>();
+}
+
+std::vector<uint64> KernelReturnFuture::get_ret_uint_tensor(int i) {
+  return get_tensor<uint64>();
+}
+
+std::vector<float64> KernelReturnFuture::get_ret_float_tensor(int i) {
+  return get_tensor<float64>();
+}
+
+int KernelReturnFuture::get_num_slots(DataType ret_dt) {
+  if (auto *tensor_type = ret_dt->cast<TensorType>()) {
+    return tensor_type->get_num_elements();
+  }
+  return 1;
+}
+
+}  // namespace taichi::lang
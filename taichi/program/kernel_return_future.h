@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "taichi/ir/type.h"
+#include "taichi/inc/constants.h"
+
+namespace taichi::lang {
+
+// The first slots of the result buffer, as left by one launch, being copied
+// to the host behind the work queued on the device.
+class DeferredResults {
+ public:
+  virtual ~DeferredResults() = default;
+
+  // Whether wait() returns without blocking.
+  virtual bool ready() = 0;
+
+  // Blocks until the copy is done. The slots stay valid as long as this
+  // object.
+  virtual const uint64 *wait() = 0;
+};
+
+// Slots that have already been copied, for the backends that can't copy them
+// asynchronously.
+class HostDeferredResults : public DeferredResults {
+ public:
+  explicit HostDeferredResults(std::vector<uint64> values)
+      : values_(std::move(values)) {
+  }
+
+  bool ready() override {
+    return true;
+  }
+
+  const uint64 *wait() override {
+    return values_.data();
+  }
+
+ private:
+  std::vector<uint64> values_;
+};
+
+// Reinterprets the result buffer slot |raw| holding a value of type |dt|.
+template <typename T>
+T decode_ret_value(DataType dt, uint64 raw) {
+  if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    return (T)taichi_union_cast_with_different_sizes<float32>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    return (T)taichi_union_cast_with_different_sizes<float64>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    return (T)taichi_union_cast_with_different_sizes<int32>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    return (T)taichi_union_cast_with_different_sizes<int64>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
+    return (T)taichi_union_cast_with_different_sizes<int8>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
+    return (T)taichi_union_cast_with_different_sizes<int16>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
+    return (T)taichi_union_cast_with_different_sizes<uint8>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
+    return (T)taichi_union_cast_with_different_sizes<uint16>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    return (T)taichi_union_cast_with_different_sizes<uint32>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    return (T)taichi_union_cast_with_different_sizes<uint64>(raw);
+  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
+    // use f32 to interact with python
+    return (T)taichi_union_cast_with_different_sizes<float32>(raw);
+  } else {
+    TI_NOT_IMPLEMENTED
+  }
+}
+
+/*
+ * The return value of a kernel launch, read without synchronizing the device
+ * right after the launch: the result slots are copied to pinned host memory
+ * behind the launch, so that the following kernels can be queued before the
+ * value is needed. The getters mirror those of Kernel and block until the
+ * copy is done.
+ */
+class TI_DLL_EXPORT KernelReturnFuture {
+ public:
+  KernelReturnFuture(DataType ret_dt, std::unique_ptr<DeferredResults> results)
+      : ret_dt_(ret_dt), results_(std::move(results)) {
+  }
+
+  bool ready() {
+    return results_->ready();
+  }
+
+  void wait() {
+    results_->wait();
+  }
+
+  float64 get_ret_float(int i);
+  int64 get_ret_int(int i);
+  uint64 get_ret_uint(int i);
+  std::vector<int64> get_ret_int_tensor(int i);
+  std::vector<uint64> get_ret_uint_tensor(int i);
+  std::vector<float64> get_ret_float_tensor(int i);
+
+  // The number of result buffer slots a return value of type |ret_dt| takes.
+  static int get_num_slots(DataType ret_dt);
+
+ private:
+  template <typename T>
+  std::vector<T> get_tensor();
+
+  DataType ret_dt_;
+  std::unique_ptr<DeferredResults> results_;
+};
+
+}  // namespace taichi::lang
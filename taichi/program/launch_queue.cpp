@@ -0,0 +1,264 @@
+#include "taichi/program/launch_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/kernel.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// Returns the SNode accessed through |ptr|, or nullptr if it's not a pointer
+// into an SNode.
+SNode *get_accessed_snode(Stmt *ptr) {
+  if (auto *matrix_ptr = ptr->cast<MatrixPtrStmt>()) {
+    ptr = matrix_ptr->origin;
+  }
+  if (auto *global_ptr = ptr->cast<GlobalPtrStmt>()) {
+    return global_ptr->snode;
+  }
+  return nullptr;
+}
+
+bool is_ancestor(const SNode *ancestor, const SNode *snode) {
+  for (; snode != nullptr; snode = snode->parent) {
+    if (snode == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The structure of an SNode, e.g. which cells of a pointer SNode are active,
+// is shared with its descendants.
+bool overlap(const std::unordered_set<SNode *> &a,
+             const std::unordered_set<SNode *> &b) {
+  for (auto *s : a) {
+    for (auto *t : b) {
+      if (is_ancestor(s, t) || is_ancestor(t, s)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+LaunchQueue::LaunchQueue(std::unique_ptr<LaunchStreams> streams, int window)
+    : streams_(std::move(streams)), window_(std::max(window, 1)) {
+}
+
+bool LaunchQueue::enqueue(Kernel *kernel, const RuntimeContext &ctx) {
+  std::lock_guard<std::mutex> _(mut_);
+  const auto &accesses = get_accesses(kernel);
+  if (!accesses.deferrable) {
+    flush_locked();
+    return false;
+  }
+  Launch launch{kernel, ctx, &accesses};
+  if (accesses.idempotent) {
+    for (auto it = launches_.rbegin(); it != launches_.rend(); ++it) {
+      if (it->kernel == kernel && same_args(*it, launch)) {
+        return true;
+      }
+      if (conflict(*it->accesses, accesses)) {
+        break;
+      }
+    }
+  }
+  launches_.push_back(std::move(launch));
+  if (launches_.size() >= window_) {
+    flush_locked();
+  }
+  return true;
+}
+
+void LaunchQueue::flush() {
+  std::lock_guard<std::mutex> _(mut_);
+  flush_locked();
+}
+
+void LaunchQueue::flush_locked() {
+  if (launches_.empty()) {
+    return;
+  }
+  auto launches = std::move(launches_);
+  launches_.clear();
+  const int num_streams = streams_ ? streams_->num_streams() : 1;
+  if (num_streams <= 1) {
+    for (auto &launch : launches) {
+      launch.kernel->launch_compiled(launch.ctx);
+    }
+    return;
+  }
+
+  // The stream of each launch, and whether each stream has been used.
+  std::vector<int> launch_streams(launches.size(), 0);
+  std::vector<bool> used(num_streams, false);
+  int next_stream = 0;
+  try {
+    for (int i = 0; i < launches.size(); i++) {
+      const auto &accesses = *launches[i].accesses;
+      std::vector<bool> waits(num_streams, false);
+      int stream = -1;
+      for (int j = i - 1; j >= 0; j--) {
+        if (conflict(*launches[j].accesses, accesses)) {
+          waits[launch_streams[j]] = true;
+          if (stream == -1) {
+            stream = launch_streams[j];
+          }
+        }
+      }
+      // Launches sharing runtime state are serialized on stream 0.
+      if (!accesses.concurrent) {
+        stream = 0;
+      } else if (stream == -1) {
+        stream = next_stream;
+        next_stream = (next_stream + 1) % num_streams;
+      }
+      if (stream != 0 && !used[stream]) {
+        streams_->wait(stream, 0);
+      }
+      for (int s = 0; s < num_streams; s++) {
+        if (waits[s] && s != stream) {
+          streams_->wait(stream, s);
+        }
+      }
+      used[stream] = true;
+      launch_streams[i] = stream;
+      streams_->select(stream);
+      launches[i].kernel->launch_compiled(launches[i].ctx);
+    }
+  } catch (...) {
+    streams_->select(0);
+    throw;
+  }
+  streams_->select(0);
+  for (int s = 1; s < num_streams; s++) {
+    if (used[s]) {
+      streams_->wait(0, s);
+    }
+  }
+}
+
+const LaunchQueue::Accesses &LaunchQueue::get_accesses(Kernel *kernel) {
+  auto &result = accesses_[kernel];
+  if (result) {
+    return *result;
+  }
+  result = std::make_unique<Accesses>();
+  auto &accesses = *result;
+  if (!kernel->rets.empty() || kernel->is_evaluator) {
+    return accesses;
+  }
+  for (const auto &param : kernel->parameter_list) {
+    if (param.is_array) {
+      return accesses;
+    }
+  }
+  // Only the offloaded tasks still refer to SNodes through GlobalPtrStmts.
+  // Kernels that are lowered further, or not at all, are launched right away.
+  auto *block = kernel->lowered() ? kernel->ir->cast<Block>() : nullptr;
+  if (block == nullptr) {
+    return accesses;
+  }
+  for (const auto &stmt : block->statements) {
+    if (!stmt->is<OffloadedStmt>()) {
+      return accesses;
+    }
+  }
+
+  bool deferrable = true;
+  bool concurrent = true;
+  bool idempotent = true;
+  auto access = [&](SNode *snode, bool read, bool write) {
+    if (read) {
+      accesses.reads.insert(snode);
+    }
+    if (write) {
+      accesses.writes.insert(snode);
+    }
+    if (!snode->is_path_all_dense) {
+      // e.g. activations use the node allocators as garbage collection does.
+      concurrent = false;
+    }
+  };
+  irpass::analysis::gather_statements(block, [&](Stmt *stmt) {
+    if (auto *offload = stmt->cast<OffloadedStmt>()) {
+      if (offload->task_type == OffloadedTaskType::struct_for) {
+        access(offload->snode, /*read=*/true, /*write=*/false);
+      } else if (offload->task_type == OffloadedTaskType::listgen ||
+                 offload->task_type == OffloadedTaskType::gc ||
+                 offload->task_type == OffloadedTaskType::gc_rc) {
+        access(offload->snode, /*read=*/true, /*write=*/true);
+      }
+      // Element lists and global temporaries live in the runtime.
+      if (!(offload->task_type == OffloadedTaskType::serial ||
+            (offload->task_type == OffloadedTaskType::range_for &&
+             offload->const_begin && offload->const_end))) {
+        concurrent = false;
+      }
+      if (offload->task_type == OffloadedTaskType::mesh_for) {
+        deferrable = false;
+      }
+      return false;
+    }
+    if (stmt->is<ExternalPtrStmt>() || stmt->is<ExternalFuncCallStmt>() ||
+        stmt->is<FuncCallStmt>() || stmt->is<PrintStmt>() ||
+        stmt->is<AssertStmt>() || stmt->is<ReturnStmt>() ||
+        stmt->is<TexturePtrStmt>()) {
+      deferrable = false;
+      return false;
+    }
+    if (stmt->is<RandStmt>()) {
+      concurrent = false;
+      idempotent = false;
+    } else if (stmt->is<GlobalTemporaryStmt>() ||
+               stmt->is<AdStackAllocaStmt>()) {
+      concurrent = false;
+    } else if (auto *snode_op = stmt->cast<SNodeOpStmt>()) {
+      access(snode_op->snode, /*read=*/true, /*write=*/true);
+      idempotent = false;
+    }
+    for (auto *op : stmt->get_operands()) {
+      SNode *snode = op ? get_accessed_snode(op) : nullptr;
+      if (snode == nullptr || stmt->is<MatrixPtrStmt>()) {
+        continue;
+      }
+      if (auto *load = stmt->cast<GlobalLoadStmt>(); load && load->src == op) {
+        access(snode, /*read=*/true, /*write=*/false);
+      } else if (auto *store = stmt->cast<GlobalStoreStmt>();
+                 store && store->dest == op) {
+        access(snode, /*read=*/false, /*write=*/true);
+      } else {
+        // Atomics, SNode ops, and anything else taking the pointer.
+        access(snode, /*read=*/true, /*write=*/true);
+      }
+    }
+    return false;
+  });
+  if (overlap(accesses.reads, accesses.writes)) {
+    idempotent = false;
+  }
+  accesses.deferrable = deferrable;
+  accesses.concurrent = deferrable && concurrent;
+  accesses.idempotent = deferrable && idempotent;
+  return accesses;
+}
+
+bool LaunchQueue::conflict(const Accesses &a, const Accesses &b) {
+  return overlap(a.writes, b.reads) || overlap(a.writes, b.writes) ||
+         overlap(a.reads, b.writes);
+}
+
+bool LaunchQueue::same_args(const Launch &a, const Launch &b) {
+  const auto num_args = a.kernel->parameter_list.size();
+  return std::memcmp(a.ctx.args, b.ctx.args, num_args * sizeof(uint64)) == 0;
+}
+
+}  // namespace taichi::lang
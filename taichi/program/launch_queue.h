@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "taichi/util/lang_util.h"
+#define TI_RUNTIME_HOST
+#include "taichi/program/context.h"
+#undef TI_RUNTIME_HOST
+
+namespace taichi::lang {
+
+class Kernel;
+class SNode;
+
+/**
+ * Device queues that independent launches can overlap on, see
+ * ProgramImpl::make_launch_streams().
+ *
+ * Stream 0 is the one the calling thread launches on outside of the
+ * LaunchQueue, so that the work around a flush stays ordered with it.
+ */
+class LaunchStreams {
+ public:
+  virtual ~LaunchStreams() = default;
+
+  virtual int num_streams() const = 0;
+
+  // Makes the launches of the calling thread go to |stream|. Stream 0 must be
+  // selected again before the flush returns.
+  virtual void select(int stream) = 0;
+
+  // Makes the work enqueued on |stream| from now on wait for the work that
+  // has been enqueued on |dependency| so far.
+  virtual void wait(int stream, int dependency) = 0;
+};
+
+/**
+ * Defers the kernel launches of a Program until the device has to catch up,
+ * see CompileConfig::async_launch.
+ *
+ * Only the launches of kernels taking scalars and accessing nothing but
+ * SNodes are deferred. Their read and write sets are gathered from the
+ * offloaded IR of the kernels. Any other launch flushes the queue first, as
+ * do synchronizations and host accesses through the Program. On flush:
+ * - A launch identical to an earlier queued one is dropped if the kernel
+ *   doesn't read what it writes, and nothing in between accessed what either
+ *   of them writes.
+ * - With LaunchStreams, the launches are spread over the streams, and each of
+ *   them only waits for the earlier launches it conflicts with.
+ */
+class LaunchQueue {
+ public:
+  explicit LaunchQueue(std::unique_ptr<LaunchStreams> streams, int window);
+
+  /**
+   * @brief Enqueues a launch of |kernel| with |ctx|
+   *
+   * @return false if the launch can't be deferred, in which case the queue has
+   * been flushed and the caller has to launch it now
+   */
+  bool enqueue(Kernel *kernel, const RuntimeContext &ctx);
+
+  // Launches all the queued launches.
+  void flush();
+
+ private:
+  struct Accesses {
+    bool deferrable{false};
+    // False if the kernel shares runtime state, e.g. global temporaries or
+    // element lists, with kernels launched at the same time.
+    bool concurrent{false};
+    // Launching the kernel twice in a row with the same arguments is the same
+    // as launching it once.
+    bool idempotent{false};
+    std::unordered_set<SNode *> reads;
+    std::unordered_set<SNode *> writes;
+  };
+
+  struct Launch {
+    Kernel *kernel;
+    RuntimeContext ctx;
+    const Accesses *accesses;
+  };
+
+  const Accesses &get_accesses(Kernel *kernel);
+  void flush_locked();
+
+  static bool conflict(const Accesses &a, const Accesses &b);
+  static bool same_args(const Launch &a, const Launch &b);
+
+  std::unique_ptr<LaunchStreams> streams_;
+  const int window_;
+  std::mutex mut_;
+  std::unordered_map<Kernel *, std::unique_ptr<Accesses>> accesses_;
+  std::vector<Launch> launches_;
+};
+
+}  // namespace taichi::lang
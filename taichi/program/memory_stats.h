@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+namespace taichi::lang {
+
+/**
+ * Memory usage of the lists behind an SNode on the LLVM backends. The counts
+ * are in elements and the sizes in bytes.
+ */
+struct SNodeMemoryStats {
+  int snode_id{-1};
+  int tree_id{-1};
+  std::string name;
+
+  // The cells found active by the last listgen.
+  std::size_t element_list_length{0};
+  std::size_t element_list_bytes{0};
+
+  // Only the SNodes with a node allocator (pointer, dynamic and hash) have the
+  // following.
+  std::size_t node_size{0};
+  // Nodes ever allocated; the chunks holding them take |data_bytes|.
+  std::size_t num_allocated_nodes{0};
+  std::size_t data_bytes{0};
+  // Nodes freed by gc and not reused yet.
+  std::size_t num_free_nodes{0};
+  // Nodes deactivated since the last gc.
+  std::size_t num_recycled_nodes{0};
+  // Bytes taken by the free and recycled lists themselves.
+  std::size_t free_list_bytes{0};
+
+  std::size_t num_active_nodes() const {
+    return num_allocated_nodes - num_free_nodes - num_recycled_nodes;
+  }
+
+  // The share of the allocated nodes that hold no active cell.
+  double fragmentation() const {
+    return num_allocated_nodes == 0
+               ? 0.0
+               : 1.0 - (double)num_active_nodes() / num_allocated_nodes;
+  }
+};
+
+struct MemoryStats {
+  // The SNodes other than places, tree by tree.
+  std::vector<SNodeMemoryStats> snodes;
+  // Sum of the root buffers of the SNode trees.
+  std::size_t snode_tree_bytes{0};
+  // Memory requested by the LLVM runtime for node and element lists, and
+  // the other runtime data.
+  std::size_t runtime_requested_bytes{0};
+  std::size_t num_ndarrays{0};
+  std::size_t ndarray_bytes{0};
+  // The device caching allocator, if any.
+  std::size_t cached_allocated_bytes{0};
+  std::size_t cached_reserved_bytes{0};
+};
+
+}  // namespace taichi::lang
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <numeric>
 
 #include "taichi/program/ndarray.h"
@@ -113,10 +114,27 @@ Ndarray::Ndarray(DeviceAllocation &devalloc,
   TI_ASSERT(type->is<PrimitiveType>());
 }
 
+Ndarray::Ndarray(Program *prog,
+                 DeviceAllocation &devalloc,
+                 const DataType type,
+                 const std::vector<int> &shape,
+                 std::function<void()> release)
+    : Ndarray(devalloc, type, shape) {
+  prog_ = prog;
+  release_external_ = std::move(release);
+}
+
 Ndarray::~Ndarray() {
   if (prog_) {
     // prog_->flush();
-    ndarray_alloc_.device->dealloc_memory(ndarray_alloc_);
+    if (host_mapped_ptr_) {
+      ndarray_alloc_.device->unmap(ndarray_alloc_);
+    }
+    if (release_external_) {
+      release_external_();
+    } else {
+      ndarray_alloc_.device->dealloc_memory(ndarray_alloc_);
+    }
   }
 }
 
@@ -146,10 +164,38 @@ std::size_t Ndarray::get_nelement() const {
   return nelement_;
 }
 
-TypedConstant Ndarray::read(const std::vector<int> &I) const {
+bool Ndarray::is_host_mapped() const {
+  return host_mapped_ptr() != nullptr;
+}
+
+char *Ndarray::host_mapped_ptr() const {
+  if (!host_map_checked_) {
+    host_map_checked_ = true;
+    const Arch arch = prog_->config().arch;
+    const bool unified_memory = ndarray_alloc_.device->get_caps().get(
+        DeviceCapability::unified_memory);
+    // Mapping a DeviceAllocation is only cheap and persistent where the ndarray
+    // itself lives in host-visible memory; elsewhere map() makes a copy.
+    if (unified_memory || ((arch_is_cpu(arch) || arch == Arch::metal) &&
+                           nelement_ * element_size_ <= kHostMappedMaxBytes)) {
+      void *ptr{nullptr};
+      if (ndarray_alloc_.device->map(ndarray_alloc_, &ptr) ==
+          RhiResult::success) {
+        host_mapped_ptr_ = (char *)ptr;
+      }
+    }
+  }
+  return host_mapped_ptr_;
+}
+
+void Ndarray::copy_to_host(std::size_t offset,
+                           std::size_t size,
+                           void *dst) const {
   prog_->synchronize();
-  size_t index = flatten_index(total_shape_, I);
-  size_t size = data_type_size(get_element_data_type());
+  if (auto *mapped = host_mapped_ptr()) {
+    std::memcpy(dst, mapped + offset, size);
+    return;
+  }
   taichi::lang::Device::AllocParams alloc_params;
   alloc_params.host_write = false;
   alloc_params.host_read = true;
@@ -158,46 +204,119 @@ TypedConstant Ndarray::read(const std::vector<int> &I) const {
   auto staging_buf_ =
       this->ndarray_alloc_.device->allocate_memory_unique(alloc_params);
   staging_buf_->device->memcpy_internal(
-      staging_buf_->get_ptr(),
-      this->ndarray_alloc_.get_ptr(/*offset=*/index * size), size);
+      staging_buf_->get_ptr(), this->ndarray_alloc_.get_ptr(offset), size);
 
   char *device_arr_ptr{nullptr};
   TI_ASSERT(staging_buf_->device->map(
                 *staging_buf_, (void **)&device_arr_ptr) == RhiResult::success);
-
-  TypedConstant data(get_element_data_type());
-  std::memcpy(&data.value_bits, device_arr_ptr, size);
+  std::memcpy(dst, device_arr_ptr, size);
   staging_buf_->device->unmap(*staging_buf_);
-  return data;
 }
 
-template <typename T>
-void Ndarray::write(const std::vector<int> &I, T val) const {
-  size_t index = flatten_index(total_shape_, I);
-  size_t size_ = sizeof(T);
+void Ndarray::copy_from_host(std::size_t offset,
+                             std::size_t size,
+                             const void *src) const {
+  if (auto *mapped = host_mapped_ptr()) {
+    // Kernels still in flight may be reading the old values.
+    prog_->synchronize();
+    std::memcpy(mapped + offset, src, size);
+    return;
+  }
   taichi::lang::Device::AllocParams alloc_params;
   alloc_params.host_write = true;
   alloc_params.host_read = false;
-  alloc_params.size = size_;
+  alloc_params.size = size;
   alloc_params.usage = taichi::lang::AllocUsage::Storage;
   auto staging_buf_ =
       this->ndarray_alloc_.device->allocate_memory_unique(alloc_params);
 
-  T *device_arr_ptr{nullptr};
+  char *device_arr_ptr{nullptr};
   TI_ASSERT(staging_buf_->device->map(
                 *staging_buf_, (void **)&device_arr_ptr) == RhiResult::success);
-
   TI_ASSERT(device_arr_ptr);
-  device_arr_ptr[0] = val;
-
+  std::memcpy(device_arr_ptr, src, size);
   staging_buf_->device->unmap(*staging_buf_);
-  staging_buf_->device->memcpy_internal(
-      this->ndarray_alloc_.get_ptr(index * sizeof(T)), staging_buf_->get_ptr(),
-      size_);
+  staging_buf_->device->memcpy_internal(this->ndarray_alloc_.get_ptr(offset),
+                                        staging_buf_->get_ptr(), size);
 
   prog_->synchronize();
 }
 
+TypedConstant Ndarray::read(const std::vector<int> &I) const {
+  TI_ERROR_IF(is_quant(get_element_data_type()),
+              "Quantized ndarrays can only be accessed in kernels");
+  size_t index = flatten_index(total_shape_, I);
+  size_t size = data_type_size(get_element_data_type());
+  TypedConstant data(get_element_data_type());
+  copy_to_host(index * size, size, &data.value_bits);
+  return data;
+}
+
+void Ndarray::write(const std::vector<int> &I, TypedConstant val) const {
+  TI_ERROR_IF(is_quant(get_element_data_type()),
+              "Quantized ndarrays can only be accessed in kernels");
+  size_t index = flatten_index(total_shape_, I);
+  size_t size = data_type_size(get_element_data_type());
+  copy_from_host(index * size, size, &val.value_bits);
+}
+
+void Ndarray::read_range(std::size_t begin,
+                         std::size_t count,
+                         void *dst) const {
+  if (count == 0) {
+    return;
+  }
+  size_t size = data_type_size(get_element_data_type());
+  TI_ASSERT(begin + count <= nelement_ * element_size_ / size);
+  copy_to_host(begin * size, count * size, dst);
+}
+
+void Ndarray::write_range(std::size_t begin,
+                          std::size_t count,
+                          const void *src) const {
+  if (count == 0) {
+    return;
+  }
+  size_t size = data_type_size(get_element_data_type());
+  TI_ASSERT(begin + count <= nelement_ * element_size_ / size);
+  copy_from_host(begin * size, count * size, src);
+}
+
+void Ndarray::read_batch(const std::vector<std::size_t> &indices,
+                         void *dst) const {
+  if (indices.empty()) {
+    return;
+  }
+  auto [lo, hi] = std::minmax_element(indices.begin(), indices.end());
+  size_t size = data_type_size(get_element_data_type());
+  std::vector<char> span((*hi - *lo + 1) * size);
+  read_range(*lo, *hi - *lo + 1, span.data());
+  for (size_t i = 0; i < indices.size(); i++) {
+    std::memcpy((char *)dst + i * size, span.data() + (indices[i] - *lo) * size,
+                size);
+  }
+}
+
+void Ndarray::write_batch(const std::vector<std::size_t> &indices,
+                          const void *src) const {
+  if (indices.empty()) {
+    return;
+  }
+  auto [lo, hi] = std::minmax_element(indices.begin(), indices.end());
+  size_t size = data_type_size(get_element_data_type());
+  size_t span_count = *hi - *lo + 1;
+  std::vector<char> span(span_count * size);
+  // Elements of the span not in |indices| must keep their values.
+  if (span_count != indices.size()) {
+    read_range(*lo, span_count, span.data());
+  }
+  for (size_t i = 0; i < indices.size(); i++) {
+    std::memcpy(span.data() + (indices[i] - *lo) * size, (char *)src + i * size,
+                size);
+  }
+  write_range(*lo, span_count, span.data());
+}
+
 int64 Ndarray::read_int(const std::vector<int> &i) {
   return read(i).val_int();
 }
@@ -211,11 +330,11 @@ float64 Ndarray::read_float(const std::vector<int> &i) {
 }
 
 void Ndarray::write_int(const std::vector<int> &i, int64 val) {
-  write<int>(i, val);
+  write(i, TypedConstant(get_element_data_type(), val));
 }
 
 void Ndarray::write_float(const std::vector<int> &i, float64 val) {
-  write<float>(i, val);
+  write(i, TypedConstant(get_element_data_type(), val));
 }
 
 }  // namespace taichi::lang
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "taichi/inc/constants.h"
@@ -43,6 +44,16 @@ class TI_DLL_EXPORT Ndarray {
                    const std::vector<int> &element_shape,
                    ExternalArrayLayout layout = ExternalArrayLayout::kNull);
 
+  /* Constructs a Ndarray of |prog| viewing memory Taichi does not own, e.g.
+   * a DLPack tensor imported into |devalloc|. |release| is called instead of
+   * deallocating the memory when the Ndarray is destroyed.
+   */
+  explicit Ndarray(Program *prog,
+                   DeviceAllocation &devalloc,
+                   const DataType type,
+                   const std::vector<int> &shape,
+                   std::function<void()> release);
+
   DeviceAllocation ndarray_alloc_{kDeviceNullAllocation};
   DataType dtype;
   // Invariant: Since ndarray indices are flattened for vector/matrix, this is
@@ -58,14 +69,34 @@ class TI_DLL_EXPORT Ndarray {
   std::size_t get_element_size() const;
   std::size_t get_nelement() const;
   TypedConstant read(const std::vector<int> &I) const;
-  template <typename T>
-  void write(const std::vector<int> &I, T val) const;
+  void write(const std::vector<int> &I, TypedConstant val) const;
   int64 read_int(const std::vector<int> &i);
   uint64 read_uint(const std::vector<int> &i);
   float64 read_float(const std::vector<int> &i);
   void write_int(const std::vector<int> &i, int64 val);
   void write_float(const std::vector<int> &i, float64 val);
 
+  /* Batched host access to the scalar elements. |indices| are flattened
+   * indices into total_shape(), and |dst| / |src| hold one element of
+   * get_element_data_type() per index. All the elements are moved in a single
+   * transfer covering the range spanned by |indices|.
+   */
+  void read_batch(const std::vector<std::size_t> &indices, void *dst) const;
+  void write_batch(const std::vector<std::size_t> &indices,
+                   const void *src) const;
+  // Same as above for the |count| elements starting at flattened |begin|.
+  void read_range(std::size_t begin, std::size_t count, void *dst) const;
+  void write_range(std::size_t begin, std::size_t count, const void *src) const;
+
+  // Ndarrays on unified-memory devices, and those up to this size that live in
+  // host-visible memory otherwise, are mapped once and accessed from the host
+  // directly.
+  static constexpr std::size_t kHostMappedMaxBytes = 1 << 20;
+
+  // Whether host accesses go through a persistent mapping rather than staging
+  // buffers.
+  bool is_host_mapped() const;
+
   const std::vector<int> &total_shape() const {
     return total_shape_;
   }
@@ -77,6 +108,19 @@ class TI_DLL_EXPORT Ndarray {
   std::vector<int> total_shape_;
 
   Program *prog_{nullptr};
+
+  // Returns the persistent host mapping of the ndarray, or nullptr if the
+  // ndarray is accessed through staging buffers.
+  char *host_mapped_ptr() const;
+  void copy_to_host(std::size_t offset, std::size_t size, void *dst) const;
+  void copy_from_host(std::size_t offset,
+                      std::size_t size,
+                      const void *src) const;
+
+  mutable bool host_map_checked_{false};
+  mutable char *host_mapped_ptr_{nullptr};
+
+  std::function<void()> release_external_;
 };
 
 }  // namespace taichi::lang
@@ -0,0 +1,267 @@
+#include "taichi/program/out_of_core_ndarray.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "taichi/program/program.h"
+#include "taichi/system/virtual_memory.h"
+
+#if defined(TI_PLATFORM_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include "taichi/platform/windows/windows.h"
+#endif
+
+namespace taichi::lang {
+
+// The host memory holding the data, either anonymous or mapped from a file.
+class OutOfCoreNdarray::HostStorage {
+ public:
+  explicit HostStorage(std::size_t size) : size_(size) {
+    if (size_ > 0) {
+      memory_ = std::make_unique<VirtualMemoryAllocator>(size_);
+      ptr_ = (char *)memory_->ptr;
+    }
+  }
+
+  HostStorage(const std::string &path, std::size_t size) : size_(size) {
+#if defined(TI_PLATFORM_UNIX)
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    TI_ERROR_IF(fd_ < 0, "Failed to open {}", path);
+    struct stat st;
+    TI_ERROR_IF(fstat(fd_, &st) != 0, "Failed to stat {}", path);
+    if ((std::size_t)st.st_size != size_) {
+      TI_ERROR_IF(ftruncate(fd_, size_) != 0, "Failed to resize {} to {} B",
+                  path, size_);
+    }
+    if (size_ > 0) {
+      void *ptr =
+          mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+      TI_ERROR_IF(ptr == MAP_FAILED, "Failed to map {}", path);
+      ptr_ = (char *)ptr;
+    }
+#else
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    TI_ERROR_IF(file_ == INVALID_HANDLE_VALUE, "Failed to open {}", path);
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = size_;
+    TI_ERROR_IF(!SetFilePointerEx(file_, file_size, nullptr, FILE_BEGIN) ||
+                    !SetEndOfFile(file_),
+                "Failed to resize {} to {} B", path, size_);
+    if (size_ > 0) {
+      mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, 0, 0,
+                                    nullptr);
+      TI_ERROR_IF(mapping_ == nullptr, "Failed to map {}", path);
+      ptr_ = (char *)MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size_);
+      TI_ERROR_IF(ptr_ == nullptr, "Failed to map {}", path);
+    }
+#endif
+  }
+
+  ~HostStorage() {
+    if (memory_) {
+      return;
+    }
+#if defined(TI_PLATFORM_UNIX)
+    if (ptr_ != nullptr) {
+      munmap(ptr_, size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#else
+    if (ptr_ != nullptr) {
+      UnmapViewOfFile(ptr_);
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+#endif
+  }
+
+  char *ptr() const {
+    return ptr_;
+  }
+
+ private:
+  std::size_t size_{0};
+  char *ptr_{nullptr};
+  std::unique_ptr<VirtualMemoryAllocator> memory_;
+#if defined(TI_PLATFORM_UNIX)
+  int fd_{-1};
+#else
+  HANDLE file_{INVALID_HANDLE_VALUE};
+  HANDLE mapping_{nullptr};
+#endif
+};
+
+OutOfCoreNdarray::OutOfCoreNdarray(Program *prog,
+                                   DataType type,
+                                   const std::vector<int> &shape,
+                                   const std::string &path,
+                                   int tile_rows)
+    : dtype(type), shape(shape), prog_(prog) {
+  const auto &config = prog->this_thread_config();
+  TI_ERROR_IF(!arch_uses_llvm(config.arch),
+              "Out-of-core ndarrays are not supported on {}",
+              arch_name(config.arch));
+  TI_ERROR_IF(shape.empty(), "Out-of-core ndarrays need at least one axis");
+  TI_ERROR_IF(tile_rows < 0, "Invalid number of rows per tile: {}", tile_rows);
+  zero_copy_ = arch_is_cpu(config.arch);
+  row_bytes_ = std::accumulate(shape.begin() + 1, shape.end(),
+                               (std::size_t)data_type_size(type),
+                               std::multiplies<>());
+  nbytes_ = row_bytes_ * shape[0];
+  if (path.empty()) {
+    host_ = std::make_unique<HostStorage>(nbytes_);
+  } else {
+    host_ = std::make_unique<HostStorage>(path, nbytes_);
+  }
+
+  if (tile_rows > 0) {
+    tile_rows_ = tile_rows;
+  } else if (zero_copy_) {
+    // Nothing is copied, so there is no reason to split the data.
+    tile_rows_ = shape[0];
+  } else {
+    const auto tile_bytes =
+        (std::size_t)(config.device_memory_GB * (1LL << 30)) / 8;
+    tile_rows_ = row_bytes_ == 0 ? shape[0]
+                                 : (int)std::clamp<std::size_t>(
+                                       tile_bytes / row_bytes_, 1, shape[0]);
+  }
+  tile_rows_ = std::max(std::min(tile_rows_, shape[0]), 1);
+  num_tiles_ = (shape[0] + tile_rows_ - 1) / tile_rows_;
+  TI_TRACE("Out-of-core ndarray of {} B in {} tile(s) of {} row(s)", nbytes_,
+           num_tiles_, tile_rows_);
+
+  if (zero_copy_) {
+    tile_views_.resize(num_tiles_, nullptr);
+  }
+}
+
+OutOfCoreNdarray::~OutOfCoreNdarray() {
+  // The kernels in flight may still access the tiles.
+  prog_->synchronize();
+  for (auto *view : tile_views_) {
+    if (view != nullptr) {
+      prog_->delete_ndarray(view);
+    }
+  }
+  for (auto &view : last_tile_views_) {
+    view.reset();
+  }
+  for (auto *buffer : buffers_) {
+    if (buffer != nullptr) {
+      prog_->delete_ndarray(buffer);
+    }
+  }
+}
+
+int OutOfCoreNdarray::rows_of(int tile) const {
+  return std::min(tile_rows_, shape[0] - tile * tile_rows_);
+}
+
+std::vector<int> OutOfCoreNdarray::tile_shape(int tile) const {
+  auto ret = shape;
+  ret[0] = rows_of(tile);
+  return ret;
+}
+
+void OutOfCoreNdarray::upload(int tile, int buffer) {
+  if (buffers_[buffer] == nullptr) {
+    auto buffer_shape = shape;
+    buffer_shape[0] = tile_rows_;
+    buffers_[buffer] = prog_->create_ndarray(dtype, buffer_shape,
+                                             ExternalArrayLayout::kAOS);
+  }
+  auto *impl = prog_->get_program_impl();
+  // The kernels launched so far may still use the buffer.
+  auto in_use = impl->signal_semaphore();
+  uploads_[buffer] = impl->copy_from_host_async(
+      buffers_[buffer]->ndarray_alloc_.get_ptr(0),
+      host_->ptr() + tile * tile_rows_ * row_bytes_, rows_of(tile) * row_bytes_,
+      in_use);
+  buffer_tiles_[buffer] = tile;
+}
+
+Ndarray *OutOfCoreNdarray::load_tile(int i) {
+  TI_ERROR_IF(i < 0 || i >= num_tiles_, "Tile {} out of range [0, {})", i,
+              num_tiles_);
+  if (zero_copy_) {
+    if (tile_views_[i] == nullptr) {
+      tile_views_[i] =
+          prog_->import_ndarray(host_->ptr() + i * tile_rows_ * row_bytes_,
+                                dtype, tile_shape(i), []() {});
+    }
+    return tile_views_[i];
+  }
+
+  const int buffer = i % 2;
+  if (buffer_tiles_[buffer] != i) {
+    upload(i, buffer);
+  }
+  auto *impl = prog_->get_program_impl();
+  if (uploads_[buffer] != nullptr) {
+    impl->wait_semaphore(uploads_[buffer]);
+    uploads_[buffer] = nullptr;
+  }
+  if (i + 1 < num_tiles_ && buffer_tiles_[1 - buffer] != i + 1) {
+    upload(i + 1, 1 - buffer);
+  }
+
+  if (rows_of(i) == tile_rows_) {
+    return buffers_[buffer];
+  }
+  auto &view = last_tile_views_[buffer];
+  if (view == nullptr) {
+    view = std::make_unique<Ndarray>(buffers_[buffer]->ndarray_alloc_, dtype,
+                                     tile_shape(i));
+  }
+  return view.get();
+}
+
+void OutOfCoreNdarray::store_tile(int i) {
+  if (zero_copy_) {
+    return;
+  }
+  const int buffer = i % 2;
+  TI_ERROR_IF(buffer_tiles_[buffer] != i || uploads_[buffer] != nullptr,
+              "Tile {} is not loaded", i);
+  prog_->get_program_impl()->copy_to_host(
+      host_->ptr() + i * tile_rows_ * row_bytes_,
+      buffers_[buffer]->ndarray_alloc_.get_ptr(0), rows_of(i) * row_bytes_);
+}
+
+void OutOfCoreNdarray::read(void *dst) const {
+  if (zero_copy_) {
+    // Kernels may be writing to the tiles.
+    prog_->synchronize();
+  }
+  std::memcpy(dst, host_->ptr(), nbytes_);
+}
+
+void OutOfCoreNdarray::write(const void *src) {
+  if (zero_copy_) {
+    prog_->synchronize();
+  }
+  std::memcpy(host_->ptr(), src, nbytes_);
+  // The device buffers are stale now. Pending copies have been staged already.
+  buffer_tiles_ = {-1, -1};
+  for (auto &upload : uploads_) {
+    if (upload != nullptr) {
+      prog_->get_program_impl()->wait_semaphore(upload);
+      upload = nullptr;
+    }
+  }
+}
+
+}  // namespace taichi::lang
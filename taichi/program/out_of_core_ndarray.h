@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taichi/ir/type_utils.h"
+#include "taichi/program/ndarray.h"
+#include "taichi/rhi/device.h"
+
+namespace taichi::lang {
+
+class Program;
+
+/* An ndarray kept in host memory or in a memory-mapped file instead of device
+ * memory, for data sets larger than the device memory. Kernels process it in
+ * tiles of consecutive rows, i.e. indices along the first axis. Each tile is
+ * a device Ndarray of its own while it is loaded, so that a range-for over the
+ * tile covers exactly its rows.
+ *
+ * On CUDA, tiles are double-buffered: loading a tile starts copying the next
+ * one to the other buffer, which overlaps with the kernels on the current
+ * tile. On the CPU, tiles view the host memory directly and are never copied.
+ */
+class TI_DLL_EXPORT OutOfCoreNdarray {
+ public:
+  /* If |path| is empty, the data is kept in zero-initialized host memory.
+   * Otherwise it is kept in the file at |path|, which is created or resized as
+   * needed. If |tile_rows| is 0, it is chosen such that the two device tiles
+   * take at most a quarter of device_memory_GB.
+   */
+  OutOfCoreNdarray(Program *prog,
+                   DataType type,
+                   const std::vector<int> &shape,
+                   const std::string &path = "",
+                   int tile_rows = 0);
+  ~OutOfCoreNdarray();
+
+  OutOfCoreNdarray(const OutOfCoreNdarray &) = delete;
+  OutOfCoreNdarray &operator=(const OutOfCoreNdarray &) = delete;
+
+  /* Returns tile |i| as an Ndarray of shape (rows of tile |i|, shape[1:]).
+   * Kernels launched afterwards from the calling thread observe its contents.
+   * Also starts loading tile |i + 1|. The returned Ndarray is valid until the
+   * next call of load_tile().
+   */
+  Ndarray *load_tile(int i);
+
+  /* Writes tile |i|, which must be the last tile loaded, back to the host
+   * memory once the kernels launched so far complete.
+   */
+  void store_tile(int i);
+
+  // Copy all the data from or to host memory. Tiles modified on the device
+  // must be stored first to be observed by read().
+  void read(void *dst) const;
+  void write(const void *src);
+
+  int get_num_tiles() const {
+    return num_tiles_;
+  }
+
+  int get_tile_rows() const {
+    return tile_rows_;
+  }
+
+  std::size_t get_nbytes() const {
+    return nbytes_;
+  }
+
+  const DataType dtype;
+  const std::vector<int> shape;
+
+ private:
+  class HostStorage;
+
+  int rows_of(int tile) const;
+  std::vector<int> tile_shape(int tile) const;
+  void upload(int tile, int buffer);
+
+  Program *prog_{nullptr};
+  bool zero_copy_{false};
+  std::size_t row_bytes_{0};
+  std::size_t nbytes_{0};
+  int tile_rows_{0};
+  int num_tiles_{0};
+  std::unique_ptr<HostStorage> host_;
+
+  // zero_copy_: the Ndarray viewing each tile, created on first use.
+  std::vector<Ndarray *> tile_views_;
+
+  // !zero_copy_: the device buffers, each of |tile_rows_| rows.
+  std::array<Ndarray *, 2> buffers_{nullptr, nullptr};
+  // Views of the buffers for the last tile, which may have fewer rows.
+  std::array<std::unique_ptr<Ndarray>, 2> last_tile_views_;
+  // The tile each buffer holds (or is being loaded with), or -1.
+  std::array<int, 2> buffer_tiles_{-1, -1};
+  // The copies to the buffers that have not been waited for.
+  std::array<StreamSemaphore, 2> uploads_;
+};
+
+}  // namespace taichi::lang
@@ -3,36 +3,31 @@
 
 namespace taichi::lang {
 
+namespace {
+
+// Number of failed polls before an idle worker parks itself.
+constexpr int kSpinIterations = 1 << 10;
+
+}  // namespace
+
 ParallelExecutor::ParallelExecutor(const std::string &name, int num_threads)
-    : name_(name),
-      num_threads_(num_threads),
-      status_(ExecutorStatus::uninitialized),
-      running_threads_(0) {
+    : name_(name), num_threads_(num_threads) {
   if (num_threads <= 0) {
     return;
   }
-  {
-    auto _ = std::lock_guard<std::mutex>(mut_);
-
-    for (int i = 0; i < num_threads; i++) {
-      threads_.emplace_back([this]() { this->worker_loop(); });
-    }
-
-    status_ = ExecutorStatus::initialized;
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back([this]() { this->worker_loop(); });
   }
-  init_cv_.notify_all();
 }
 
 ParallelExecutor::~ParallelExecutor() {
-  // TODO: We should have a new ExecutorStatus, e.g. shutting_down, to prevent
-  // new tasks from being enqueued during shut down.
   if (num_threads_ <= 0) {
     return;
   }
   flush();
   {
-    auto _ = std::lock_guard<std::mutex>(mut_);
-    status_ = ExecutorStatus::finalized;
+    auto _ = std::lock_guard<std::mutex>(park_mut_);
+    finalized_ = true;
   }
   // Signal the workers that they need to shutdown.
   worker_cv_.notify_all();
@@ -41,30 +36,62 @@ ParallelExecutor::~ParallelExecutor() {
   }
 }
 
-void ParallelExecutor::enqueue(const TaskType &func) {
+std::future<void> ParallelExecutor::enqueue(const TaskType &func) {
   if (num_threads_ <= 0) {
+    std::promise<void> promise;
     func();
-    return;
+    promise.set_value();
+    return promise.get_future();
   }
-  {
-    std::lock_guard<std::mutex> _(mut_);
-    task_queue_.push_back(func);
+  auto task = std::make_shared<std::packaged_task<void()>>(func);
+  auto future = task->get_future();
+  TaskType wrapped = [task]() { (*task)(); };
+
+  num_pending_tasks_++;
+  while (!task_queue_.try_push(std::move(wrapped))) {
+    // The queue is full. Make progress instead of waiting for the workers.
+    if (!run_one_task()) {
+      std::this_thread::yield();
+    }
   }
-  worker_cv_.notify_all();
+  // Pairs with the fence in worker_loop(): either a parking worker sees the
+  // new task, or we see that it is parked and wake it up.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_parked_workers_.load() > 0) {
+    std::lock_guard<std::mutex> _(park_mut_);
+    worker_cv_.notify_one();
+  }
+  return future;
 }
 
 void ParallelExecutor::flush() {
   if (num_threads_ <= 0) {
     return;
   }
-  std::unique_lock<std::mutex> lock(mut_);
-  while (!flush_cv_cond()) {
-    flush_cv_.wait(lock);
+  while (num_pending_tasks_.load() > 0) {
+    if (!run_one_task()) {
+      break;
+    }
   }
+  std::unique_lock<std::mutex> lock(park_mut_);
+  num_flush_waiters_++;
+  flush_cv_.wait(lock, [this]() { return num_pending_tasks_.load() == 0; });
+  num_flush_waiters_--;
 }
 
-bool ParallelExecutor::flush_cv_cond() {
-  return (task_queue_.empty() && running_threads_ == 0);
+bool ParallelExecutor::run_one_task() {
+  TaskType task;
+  if (!task_queue_.try_pop(task)) {
+    return false;
+  }
+  task();
+  if (--num_pending_tasks_ == 0 && num_flush_waiters_.load() > 0) {
+    // Taking the lock makes sure a flushing caller is either already waiting
+    // or is yet to check |num_pending_tasks_|.
+    std::lock_guard<std::mutex> _(park_mut_);
+    flush_cv_.notify_all();
+  }
+  return true;
 }
 
 void ParallelExecutor::worker_loop() {
@@ -76,44 +103,28 @@ void ParallelExecutor::worker_loop() {
     thread_name += fmt::format("_{}", thread_id);
   Timeline::get_this_thread_instance().set_name(thread_name);
 
-  {
-    std::unique_lock<std::mutex> lock(mut_);
-    while (status_ == ExecutorStatus::uninitialized) {
-      init_cv_.wait(lock);
-    }
-  }
-
   TI_DEBUG("Worker thread initialized and running.");
-  bool done = false;
-  while (!done) {
-    bool notify_flush_cv = false;
-    {
-      std::unique_lock<std::mutex> lock(mut_);
-      while (task_queue_.empty() && status_ == ExecutorStatus::initialized) {
-        worker_cv_.wait(lock);
-      }
-      // So long as |task_queue| is not empty, we keep running.
-      if (!task_queue_.empty()) {
-        auto task = task_queue_.front();
-        running_threads_++;
-        task_queue_.pop_front();
-        lock.unlock();
-
-        // Run the task
-        task();
-
-        lock.lock();
-        running_threads_--;
-      }
-      notify_flush_cv = flush_cv_cond();
-      if (status_ == ExecutorStatus::finalized && task_queue_.empty()) {
-        done = true;
-      }
+  int spins = 0;
+  while (true) {
+    if (run_one_task()) {
+      spins = 0;
+      continue;
+    }
+    // So long as |task_queue_| is not empty, we keep running.
+    if (finalized_.load()) {
+      break;
     }
-    if (notify_flush_cv) {
-      // It is fine to notify |flush_cv_| while nobody is waiting on it.
-      flush_cv_.notify_one();
+    if (++spins < kSpinIterations) {
+      std::this_thread::yield();
+      continue;
     }
+    std::unique_lock<std::mutex> lock(park_mut_);
+    num_parked_workers_++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    worker_cv_.wait(lock,
+                    [this]() { return !task_queue_.empty() || finalized_; });
+    num_parked_workers_--;
+    spins = 0;
   }
 }
 }  // namespace taichi::lang
@@ -2,13 +2,13 @@
 
 #include <atomic>
 #include <condition_variable>
-#include <deque>
 #include <functional>
 #include <future>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
 #include "taichi/common/core.h"
+#include "taichi/system/lock_free_queue.h"
 
 namespace taichi::lang {
 class ParallelExecutor {
@@ -18,48 +18,48 @@ class ParallelExecutor {
   explicit ParallelExecutor(const std::string &name, int num_threads);
   ~ParallelExecutor();
 
-  void enqueue(const TaskType &func);
+  // The returned future becomes ready once |func| has run, and rethrows any
+  // exception thrown by it. Without worker threads, |func| runs immediately on
+  // the calling thread.
+  std::future<void> enqueue(const TaskType &func);
 
+  // Waits for every enqueued task to finish. The calling thread helps running
+  // the pending tasks in the meantime.
   void flush();
 
   int get_num_threads() {
     return num_threads_;
   }
 
- private:
-  enum class ExecutorStatus {
-    uninitialized,
-    initialized,
-    finalized,
-  };
+  static constexpr std::size_t kTaskQueueCapacity = 1 << 12;
 
+ private:
   void worker_loop();
 
-  // Must be called while holding |mut|.
-  bool flush_cv_cond();
+  // Pops a task and runs it. Returns false if the queue was empty.
+  bool run_one_task();
 
   std::string name_;
   int num_threads_;
   std::atomic<int> thread_counter_{0};
-  std::mutex mut_;
-
-  // All guarded by |mut|
-  ExecutorStatus status_;
   std::vector<std::thread> threads_;
-  std::deque<TaskType> task_queue_;
-  int running_threads_;
 
-  // Used to signal the workers that they can start polling from |task_queue|.
-  std::condition_variable init_cv_;
-  // Used by |this| to instruct the worker thread that there is an event:
+  // Enqueueing and running tasks only touch |task_queue_| and the atomics
+  // below. |park_mut_| is taken only to put idle workers or a flushing caller
+  // to sleep, and to wake them up.
+  LockFreeQueue<TaskType> task_queue_{kTaskQueueCapacity};
+  // Number of tasks that have been enqueued but have not finished yet.
+  std::atomic<int64> num_pending_tasks_{0};
+  std::atomic<int> num_parked_workers_{0};
+  std::atomic<int> num_flush_waiters_{0};
+  std::atomic<bool> finalized_{false};
+
+  std::mutex park_mut_;
+  // Used by |this| to wake up parked workers when there is an event:
   // * task being enqueued
   // * shutting down
   std::condition_variable worker_cv_;
-  // Used by a worker thread to unblock the caller from waiting for a flush.
-  //
-  // TODO: Instead of having this as a member variable, we can enqueue a
-  // callback upon flush(). The flush() will then block waiting for that
-  // callback to be executed?
+  // Used by a worker thread to unblock the callers waiting for a flush.
   std::condition_variable flush_cv_;
 };
 }  // namespace taichi::lang
@@ -1,8 +1,12 @@
 // Program, context for Taichi program execution
 
+#include <numeric>
+
 #include "program.h"
 
 #include "taichi/ir/statements.h"
+#include "taichi/analysis/offline_cache_util.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/program/extension.h"
 #include "taichi/codegen/cpu/codegen_cpu.h"
 #include "taichi/struct/struct.h"
@@ -12,7 +16,9 @@
 #include "taichi/codegen/cc/cc_program.h"
 #include "taichi/platform/cuda/detect_cuda.h"
 #include "taichi/system/unified_allocator.h"
+#include "taichi/system/flight_recorder.h"
 #include "taichi/system/timeline.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/frontend_ir.h"
 #include "taichi/program/snode_expr_utils.h"
@@ -53,8 +59,19 @@
 
 namespace taichi::lang {
 std::atomic<int> Program::num_instances_;
+std::mutex Program::instances_mut_;
+int Program::num_cpu_instances_{0};
+
+Program::Program(Arch desired_arch)
+    : Program([&] {
+        auto config = default_compile_config;
+        config.arch = desired_arch;
+        return config;
+      }()) {
+}
 
-Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
+Program::Program(const CompileConfig &compile_config)
+    : snode_rw_accessors_bank_(this) {
   TI_TRACE("Program initializing...");
 
   // For performance considerations and correctness of QuantFloatType
@@ -77,9 +94,8 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
 #endif  // defined(__arm64__) || defined(__aarch64__)
   main_thread_id_ = std::this_thread::get_id();
   // Rehash in advance to avoid rehashing during compilation
-  configs.rehash(default_compile_config.num_compile_threads + 1);
-  configs[main_thread_id_] = default_compile_config;
-  configs[main_thread_id_].arch = desired_arch;
+  configs.rehash(compile_config.num_compile_threads + 1);
+  configs[main_thread_id_] = compile_config;
   auto &config = this_thread_config();
   config.fit();
 
@@ -152,10 +168,26 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
   compute_device = program_impl_->get_compute_device();
   // Must have handled all the arch fallback logic by this point.
   memory_pool_ = std::make_unique<MemoryPool>(config.arch, compute_device);
-  TI_ASSERT_INFO(num_instances_ == 0, "Only one instance at a time");
+  {
+    // Programs on CPUs own their runtimes, thread pools and LLVM contexts,
+    // so that any number of them can run side by side. The GPU backends
+    // share process-wide device contexts.
+    std::lock_guard<std::mutex> _(instances_mut_);
+    TI_ASSERT_INFO(num_instances_ == 0 || (arch_is_cpu(config.arch) &&
+                                           num_cpu_instances_ == num_instances_),
+                   "Only one instance at a time, unless all of them are on "
+                   "CPUs");
+    // The SNode ids index the arrays of each runtime, and are only reused
+    // once no program holds them.
+    if (num_instances_ == 0) {
+      SNode::counter = 0;
+    }
+    num_instances_ += 1;
+    if (arch_is_cpu(config.arch)) {
+      num_cpu_instances_ += 1;
+    }
+  }
   total_compilation_time_ = 0;
-  num_instances_ += 1;
-  SNode::counter = 0;
 
   result_buffer = nullptr;
   finalized_ = false;
@@ -168,7 +200,16 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
     }
   }
 
+  if ((config.pgo_instrument || config.pgo_use) &&
+      config.arch != Arch::x64 && config.arch != Arch::arm64) {
+    TI_WARN("Profile-guided optimization is not supported on arch={}",
+            arch_name(config.arch));
+    config.pgo_instrument = false;
+    config.pgo_use = false;
+  }
+
   Timelines::get_instance().set_enabled(config.timeline);
+  CompileProfiler::get_instance().set_enabled(config.compile_profiler);
 
   TI_TRACE("Program ({}) arch={} initialized.", fmt::ptr(this),
            arch_name(config.arch));
@@ -189,32 +230,211 @@ Function *Program::create_function(const FunctionKey &func_key) {
   return functions_.back().get();
 }
 
+std::string Program::get_shared_kernel_key(
+    const CompileConfig &compile_config,
+    Kernel &kernel) {
+  if (!compile_config.in_process_kernel_cache || !kernel.ir_is_ast() ||
+      kernel.is_evaluator) {
+    return "";
+  }
+  // The body of a real function is part of the key only if it is serialized.
+  bool has_unserialized_func = false;
+  irpass::analysis::gather_statements(kernel.ir.get(), [&](Stmt *stmt) {
+    if (auto *call = stmt->cast<FrontendFuncCallStmt>()) {
+      if (!call->func->try_get_ast_key().has_value()) {
+        has_unserialized_func = true;
+      }
+    }
+    return false;
+  });
+  if (has_unserialized_func) {
+    return "";
+  }
+  return get_hashed_offline_cache_key(&compile_config, &kernel);
+}
+
+void Program::compile_kernels_impl(
+    const CompileConfig &compile_config,
+    const std::vector<Kernel *> &kernels,
+    const ProgramImpl::CompiledKernelCallback &on_compiled) {
+  std::vector<Kernel *> pending;
+  std::vector<int> pending_indices;
+  std::vector<std::string> pending_keys;
+  std::unordered_map<std::string, int> key_to_pending;
+  // (index in |kernels|, index in |pending|) of the kernels identical to a
+  // pending one.
+  std::vector<std::pair<int, int>> duplicates;
+  for (int i = 0; i < (int)kernels.size(); i++) {
+    auto key = get_shared_kernel_key(compile_config, *kernels[i]);
+    if (CompileProfiler::get_instance().get_enabled() &&
+        kernels[i]->ir_is_ast()) {
+      CompileProfiler::get_instance().insert_kernel_key(
+          kernels[i]->get_name(),
+          key.empty() ? get_hashed_offline_cache_key(&compile_config,
+                                                     kernels[i])
+                      : key);
+    }
+    if (!key.empty()) {
+      if (auto iter = shared_kernels_.find(key);
+          iter != shared_kernels_.end()) {
+        TI_DEBUG("Kernel '{}' reuses the code of an identical kernel (key={})",
+                 kernels[i]->get_name(), key);
+        on_compiled(i, iter->second);
+        continue;
+      }
+      auto [iter, inserted] = key_to_pending.try_emplace(key, pending.size());
+      if (!inserted) {
+        duplicates.emplace_back(i, iter->second);
+        continue;
+      }
+    }
+    pending.push_back(kernels[i]);
+    pending_indices.push_back(i);
+    pending_keys.push_back(std::move(key));
+  }
+  std::vector<FunctionType> pending_funcs(pending.size());
+  program_impl_->compile_kernels(
+      compile_config, pending, [&](int i, FunctionType func) {
+        TI_ASSERT(func);
+        if (!pending_keys[i].empty()) {
+          shared_kernels_[pending_keys[i]] = func;
+          pending_funcs[i] = func;
+        }
+        on_compiled(pending_indices[i], std::move(func));
+      });
+  for (auto &[i, j] : duplicates) {
+    TI_DEBUG("Kernel '{}' reuses the code of kernel '{}'",
+             kernels[i]->get_name(), pending[j]->get_name());
+    on_compiled(i, pending_funcs[j]);
+  }
+}
+
 FunctionType Program::compile(const CompileConfig &compile_config,
                               Kernel &kernel) {
+  std::lock_guard<std::recursive_mutex> _(compile_mut_);
+  FlightRecorder::Scope trace(TraceEvent::compile, kernel.get_trace_name_id(),
+                              /*payload=*/1);
   auto start_t = Time::get_time();
   TI_AUTO_PROF;
-  auto ret = program_impl_->compile(compile_config, &kernel);
+  FunctionType ret;
+  compile_kernels_impl(compile_config, {&kernel},
+                       [&](int, FunctionType func) { ret = std::move(func); });
   TI_ASSERT(ret);
   total_compilation_time_ += Time::get_time() - start_t;
   return ret;
 }
 
+void Program::compile_kernels(const CompileConfig &compile_config,
+                              const std::vector<Kernel *> &kernels) {
+  std::lock_guard<std::recursive_mutex> _(compile_mut_);
+  auto start_t = Time::get_time();
+  TI_AUTO_PROF;
+  std::vector<Kernel *> pending;
+  for (auto *kernel : kernels) {
+    if (!kernel->is_compiled()) {
+      pending.push_back(kernel);
+    }
+  }
+  FlightRecorder::Scope trace(TraceEvent::compile, /*name_id=*/0,
+                              pending.size());
+  compile_kernels_impl(compile_config, pending, [&](int i, FunctionType func) {
+    TI_ASSERT(func);
+    pending[i]->set_compiled(std::move(func));
+  });
+  total_compilation_time_ += Time::get_time() - start_t;
+}
+
+void Program::warm_up_kernels(const CompileConfig &compile_config,
+                              const std::vector<Kernel *> &kernels) {
+  std::vector<Kernel *> pending;
+  for (auto *kernel : kernels) {
+    if (!kernel->is_compiled() && !kernel->has_pending_compilation()) {
+      pending.push_back(kernel);
+    }
+  }
+  if (pending.empty()) {
+    return;
+  }
+  if (!warm_up_worker_) {
+    warm_up_worker_ = std::make_unique<ParallelExecutor>("warm_up", 1);
+  }
+  auto promises =
+      std::make_shared<std::vector<std::promise<void>>>(pending.size());
+  for (int i = 0; i < (int)pending.size(); i++) {
+    pending[i]->set_pending_compilation((*promises)[i].get_future().share());
+  }
+  // Copy |compile_config| as the caller may change its config in the
+  // meantime.
+  warm_up_worker_->enqueue([this, compile_config, pending, promises]() {
+    std::lock_guard<std::recursive_mutex> _(compile_mut_);
+    FlightRecorder::Scope trace(TraceEvent::compile, /*name_id=*/0,
+                                pending.size());
+    auto start_t = Time::get_time();
+    std::vector<bool> published(pending.size(), false);
+    try {
+      compile_kernels_impl(
+          compile_config, pending, [&](int i, FunctionType func) {
+            TI_ASSERT(func);
+            pending[i]->set_compiled(std::move(func));
+            (*promises)[i].set_value();
+            published[i] = true;
+          });
+    } catch (...) {
+      // Report the error to every kernel that has not been published, the
+      // first one to be launched rethrows it.
+      for (int i = 0; i < (int)pending.size(); i++) {
+        if (!published[i]) {
+          (*promises)[i].set_exception(std::current_exception());
+        }
+      }
+    }
+    total_compilation_time_ += Time::get_time() - start_t;
+  });
+}
+
+void Program::wait_for_warm_up() {
+  if (warm_up_worker_) {
+    warm_up_worker_->flush();
+  }
+}
+
 void Program::materialize_runtime() {
   program_impl_->materialize_runtime(memory_pool_.get(), profiler.get(),
                                      &result_buffer);
+  const auto &program_config = config();
+  // Debug mode and the kernel profiler check or time every launch when it
+  // happens.
+  if (program_config.async_launch && !program_config.debug &&
+      !program_config.kernel_profiler) {
+    launch_queue_ = std::make_unique<LaunchQueue>(
+        program_impl_->make_launch_streams(),
+        program_config.async_launch_window);
+  }
+}
+
+void Program::flush_launch_queue() {
+  if (launch_queue_) {
+    launch_queue_->flush();
+  }
 }
 
 void Program::destroy_snode_tree(SNodeTree *snode_tree) {
+  flush_launch_queue();
+  std::lock_guard<std::recursive_mutex> _(compile_mut_);
   TI_ASSERT(arch_uses_llvm(this_thread_config().arch) ||
             this_thread_config().arch == Arch::vulkan ||
             this_thread_config().arch == Arch::dx11 ||
             this_thread_config().arch == Arch::dx12);
   program_impl_->destroy_snode_tree(snode_tree);
   free_snode_tree_ids_.push(snode_tree->id());
+  // Don't hand out code compiled against the destroyed tree to kernels that
+  // access a new tree with the same id and layout.
+  shared_kernels_.clear();
 }
 
 SNodeTree *Program::add_snode_tree(std::unique_ptr<SNode> root,
                                    bool compile_only) {
+  std::lock_guard<std::recursive_mutex> _(compile_mut_);
   const int id = allocate_snode_tree_id();
   auto tree = std::make_unique<SNodeTree>(id, std::move(root));
   tree->root()->set_snode_tree_id(id);
@@ -237,14 +457,26 @@ SNode *Program::get_snode_root(int tree_id) {
 }
 
 void Program::check_runtime_error() {
+  flush_launch_queue();
   program_impl_->check_runtime_error(result_buffer);
 }
 
 void Program::synchronize() {
+  FlightRecorder::Scope trace(TraceEvent::synchronize);
+  flush_launch_queue();
   program_impl_->synchronize();
+  // Without debug mode, kernel launches do not wait for the out-of-bound
+  // checks, whose first failure is reported here instead.
+  const auto &program_config = config();
+  const auto arch = program_config.arch;
+  if (program_config.check_out_of_bound && !program_config.debug &&
+      (arch_is_cpu(arch) || arch == Arch::cuda)) {
+    check_runtime_error();
+  }
 }
 
 StreamSemaphore Program::flush() {
+  flush_launch_queue();
   return program_impl_->flush();
 }
 
@@ -252,6 +484,44 @@ int Program::get_snode_tree_size() {
   return snode_trees_.size();
 }
 
+namespace {
+
+// The batched accessor kernels take ([n, num_active_indices] i32 indices,
+// [n] values, n). Returns the element of |field| at the |i|-th indices.
+Expr batch_accessor_subscript(ASTBuilder &builder,
+                              CompileConfig *config,
+                              const Expr &field,
+                              int num_active_indices,
+                              const Expr &i) {
+  auto indices_arr = Expr::make<ExternalTensorExpression>(
+      PrimitiveType::i32, /*dim=*/2, /*arg_id=*/0, /*element_dim=*/0);
+  indices_arr->type_check(config);
+  ExprGroup indices;
+  for (int d = 0; d < num_active_indices; d++) {
+    auto index = builder.expr_subscript(indices_arr, ExprGroup(i, Expr(d)));
+    index->type_check(config);
+    indices.push_back(index);
+  }
+  auto ret = builder.expr_subscript(field, indices);
+  ret->type_check(config);
+  return ret;
+}
+
+Expr batch_accessor_value(ASTBuilder &builder,
+                          CompileConfig *config,
+                          SNode *snode,
+                          const Expr &i) {
+  auto values_arr = Expr::make<ExternalTensorExpression>(
+      snode->dt->get_compute_type(), /*dim=*/1, /*arg_id=*/1,
+      /*element_dim=*/0);
+  values_arr->type_check(config);
+  auto ret = builder.expr_subscript(values_arr, ExprGroup(i));
+  ret->type_check(config);
+  return ret;
+}
+
+}  // namespace
+
 Kernel &Program::get_snode_reader(SNode *snode) {
   TI_ASSERT(snode->type == SNodeType::place);
   auto kernel_name = fmt::format("snode_reader_{}", snode->id);
@@ -302,28 +572,94 @@ Kernel &Program::get_snode_writer(SNode *snode) {
   return ker;
 }
 
+Kernel &Program::get_snode_batch_reader(SNode *snode) {
+  TI_ASSERT(snode->type == SNodeType::place);
+  auto kernel_name = fmt::format("snode_batch_reader_{}", snode->id);
+  auto &ker = kernel([snode, this](Kernel *kernel) {
+    auto *config = &this->this_thread_config();
+    auto n = Expr::make<ArgLoadExpression>(2, PrimitiveType::i32);
+    n->type_check(config);
+    ASTBuilder &builder = kernel->context->builder();
+    builder.insert_for(Expr(0), n, [&](Expr i) {
+      auto value = batch_accessor_value(builder, config, snode, i);
+      builder.insert_assignment(
+          value, batch_accessor_subscript(builder, config,
+                                          Expr(snode_to_fields_.at(snode)),
+                                          snode->num_active_indices, i));
+    });
+  });
+  ker.name = kernel_name;
+  ker.is_accessor = true;
+  ker.insert_arr_param(PrimitiveType::i32, /*total_dim=*/2, {});
+  ker.insert_arr_param(snode->dt, /*total_dim=*/1, {});
+  ker.insert_scalar_param(PrimitiveType::i32);
+  return ker;
+}
+
+Kernel &Program::get_snode_batch_writer(SNode *snode) {
+  TI_ASSERT(snode->type == SNodeType::place);
+  auto kernel_name = fmt::format("snode_batch_writer_{}", snode->id);
+  auto &ker = kernel([snode, this](Kernel *kernel) {
+    auto *config = &this->this_thread_config();
+    auto n = Expr::make<ArgLoadExpression>(2, PrimitiveType::i32);
+    n->type_check(config);
+    ASTBuilder &builder = kernel->context->builder();
+    builder.insert_for(Expr(0), n, [&](Expr i) {
+      auto expr = batch_accessor_subscript(builder, config,
+                                           Expr(snode_to_fields_.at(snode)),
+                                           snode->num_active_indices, i);
+      builder.insert_assignment(
+          expr, batch_accessor_value(builder, config, snode, i), expr->tb);
+    });
+  });
+  ker.name = kernel_name;
+  ker.is_accessor = true;
+  ker.insert_arr_param(PrimitiveType::i32, /*total_dim=*/2, {});
+  ker.insert_arr_param(snode->dt, /*total_dim=*/1, {});
+  ker.insert_scalar_param(PrimitiveType::i32);
+  return ker;
+}
+
 uint64 Program::fetch_result_uint64(int i) {
+  flush_launch_queue();
   return program_impl_->fetch_result_uint64(i, result_buffer);
 }
 
+std::unique_ptr<DeferredResults> Program::fetch_results_deferred(int n) {
+  return program_impl_->fetch_results_deferred(n, result_buffer);
+}
+
 void Program::finalize() {
   if (finalized_) {
     return;
   }
+  wait_for_warm_up();
   synchronize();
   TI_ASSERT(std::this_thread::get_id() == main_thread_id_);
   TI_TRACE("Program finalizing...");
 
   synchronize();
+  launch_queue_.reset();
+  out_of_core_ndarrays_.clear();
   memory_pool_->terminate();
   if (arch_uses_llvm(this_thread_config().arch)) {
     program_impl_->finalize();
   }
 
-  Stmt::reset_counter();
+  shared_kernels_.clear();
 
   finalized_ = true;
-  num_instances_ -= 1;
+  {
+    std::lock_guard<std::mutex> _(instances_mut_);
+    num_instances_ -= 1;
+    if (arch_is_cpu(this_thread_config().arch)) {
+      num_cpu_instances_ -= 1;
+    }
+    // The other programs may still be compiling.
+    if (num_instances_ == 0) {
+      Stmt::reset_counter();
+    }
+  }
   program_impl_->dump_cache_data_to_disk();
   configs.clear();
   configs[main_thread_id_] = default_compile_config;
@@ -339,19 +675,32 @@ int Program::default_block_dim(const CompileConfig &config) {
 }
 
 void Program::print_memory_profiler_info() {
+  flush_launch_queue();
   program_impl_->print_memory_profiler_info(snode_trees_, result_buffer);
 }
 
 std::size_t Program::get_snode_num_dynamically_allocated(SNode *snode) {
+  flush_launch_queue();
   return program_impl_->get_snode_num_dynamically_allocated(snode,
                                                             result_buffer);
 }
 
+MemoryStats Program::get_memory_stats() {
+  auto stats = program_impl_->get_memory_stats(snode_trees_, result_buffer);
+  for (const auto &[_, arr] : ndarrays_) {
+    stats.num_ndarrays++;
+    stats.ndarray_bytes += arr->get_nelement() * arr->get_element_size();
+  }
+  return stats;
+}
+
 Ndarray *Program::create_ndarray(const DataType type,
                                  const std::vector<int> &shape,
                                  ExternalArrayLayout layout,
                                  bool zero_fill) {
   auto arr = std::make_unique<Ndarray>(this, type, shape, layout);
+  flight_record(TraceEvent::memory_alloc, /*name_id=*/0,
+                arr->get_nelement() * arr->get_element_size());
   if (zero_fill) {
     Arch arch = this_thread_config().arch;
     if (arch_is_cpu(arch) || arch == Arch::cuda) {
@@ -373,6 +722,65 @@ Ndarray *Program::create_ndarray(const DataType type,
   return arr_ptr;
 }
 
+Ndarray *Program::import_ndarray(void *ptr,
+                                 const DataType type,
+                                 const std::vector<int> &shape,
+                                 std::function<void()> release) {
+  std::size_t size = std::accumulate(shape.begin(), shape.end(),
+                                     data_type_size(type), std::multiplies<>());
+  auto alloc = program_impl_->import_memory(ptr, size);
+  TI_ERROR_IF(alloc == kDeviceNullAllocation,
+              "Importing external memory is not supported on {}",
+              arch_name(this_thread_config().arch));
+  auto arr =
+      std::make_unique<Ndarray>(this, alloc, type, shape, std::move(release));
+  auto arr_ptr = arr.get();
+  ndarrays_.insert({arr_ptr, std::move(arr)});
+  return arr_ptr;
+}
+
+std::string Program::get_ndarray_ipc_handle(Ndarray *ndarray) {
+  auto handle = program_impl_->export_memory_ipc_handle(
+      ndarray->ndarray_alloc_.get_ptr());
+  TI_ERROR_IF(handle.empty(), "Sharing ndarrays is not supported on {}",
+              arch_name(this_thread_config().arch));
+  return handle;
+}
+
+Ndarray *Program::import_ndarray_from_ipc_handle(
+    const std::string &handle,
+    const DataType type,
+    const std::vector<int> &shape) {
+  std::function<void()> release;
+  void *ptr = program_impl_->open_memory_ipc_handle(handle, &release);
+  TI_ERROR_IF(ptr == nullptr, "Sharing ndarrays is not supported on {}",
+              arch_name(this_thread_config().arch));
+  return import_ndarray(ptr, type, shape, std::move(release));
+}
+
+StreamSemaphore Program::copy_ndarray_rows_async(Ndarray *dst,
+                                                 int dst_row,
+                                                 Ndarray *src,
+                                                 int src_row,
+                                                 int num_rows) {
+  auto row_size = [](Ndarray *arr) {
+    TI_ERROR_IF(arr->shape.empty(), "Ndarrays without axes have no rows");
+    return arr->get_nelement() * arr->get_element_size() / arr->shape[0];
+  };
+  const std::size_t row = row_size(dst);
+  TI_ERROR_IF(row != row_size(src),
+              "Rows of {} and {} bytes can not be copied", row, row_size(src));
+  TI_ERROR_IF(num_rows < 0 || dst_row < 0 || src_row < 0 ||
+                  dst_row + num_rows > dst->shape[0] ||
+                  src_row + num_rows > src->shape[0],
+              "Rows [{}, {}) of {} and [{}, {}) of {} are out of bounds",
+              dst_row, dst_row + num_rows, dst->shape[0], src_row,
+              src_row + num_rows, src->shape[0]);
+  return program_impl_->copy_ndarray_async(
+      dst->ndarray_alloc_.get_ptr(dst_row * row),
+      src->ndarray_alloc_.get_ptr(src_row * row), num_rows * row);
+}
+
 void Program::delete_ndarray(Ndarray *ndarray) {
   // [Note] Ndarray memory deallocation
   // Ndarray's memory allocation is managed by Taichi and Python can control
@@ -391,19 +799,36 @@ void Program::delete_ndarray(Ndarray *ndarray) {
   }
 }
 
+OutOfCoreNdarray *Program::create_out_of_core_ndarray(
+    const DataType type,
+    const std::vector<int> &shape,
+    const std::string &path,
+    int tile_rows) {
+  auto arr =
+      std::make_unique<OutOfCoreNdarray>(this, type, shape, path, tile_rows);
+  auto arr_ptr = arr.get();
+  out_of_core_ndarrays_.insert({arr_ptr, std::move(arr)});
+  return arr_ptr;
+}
+
+void Program::delete_out_of_core_ndarray(OutOfCoreNdarray *ndarray) {
+  out_of_core_ndarrays_.erase(ndarray);
+}
+
 Texture *Program::create_texture(const DataType type,
                                  int num_channels,
-                                 const std::vector<int> &shape) {
+                                 const std::vector<int> &shape,
+                                 int num_mip_levels) {
   BufferFormat buffer_format = type_channels2buffer_format(type, num_channels);
   if (shape.size() == 1) {
-    textures_.push_back(
-        std::make_unique<Texture>(this, buffer_format, shape[0], 1, 1));
+    textures_.push_back(std::make_unique<Texture>(this, buffer_format, shape[0],
+                                                  1, 1, num_mip_levels));
   } else if (shape.size() == 2) {
-    textures_.push_back(
-        std::make_unique<Texture>(this, buffer_format, shape[0], shape[1], 1));
+    textures_.push_back(std::make_unique<Texture>(
+        this, buffer_format, shape[0], shape[1], 1, num_mip_levels));
   } else if (shape.size() == 3) {
-    textures_.push_back(std::make_unique<Texture>(this, buffer_format, shape[0],
-                                                  shape[1], shape[2]));
+    textures_.push_back(std::make_unique<Texture>(
+        this, buffer_format, shape[0], shape[1], shape[2], num_mip_levels));
   } else {
     TI_ERROR("Texture shape invalid");
   }
@@ -425,12 +850,41 @@ intptr_t Program::get_ndarray_data_ptr_as_int(const Ndarray *ndarray) {
 void Program::fill_ndarray_fast_u32(Ndarray *ndarray, uint32_t val) {
   // This is a temporary solution to bypass device api.
   // Should be moved to CommandList once available in CUDA.
+  FlightRecorder::Scope trace(
+      TraceEvent::memory_fill, /*name_id=*/0,
+      ndarray->get_nelement() * ndarray->get_element_size());
   program_impl_->fill_ndarray(
       ndarray->ndarray_alloc_,
       ndarray->get_nelement() * ndarray->get_element_size() / sizeof(uint32_t),
       val);
 }
 
+StreamSemaphore Program::fill_ndarray_fast_u32_async(Ndarray *ndarray,
+                                                     uint32_t val) {
+  FlightRecorder::Scope trace(
+      TraceEvent::memory_fill, /*name_id=*/0,
+      ndarray->get_nelement() * ndarray->get_element_size());
+  return program_impl_->fill_ndarray_async(
+      ndarray->ndarray_alloc_,
+      ndarray->get_nelement() * ndarray->get_element_size() / sizeof(uint32_t),
+      val);
+}
+
+StreamSemaphore Program::copy_ndarray_async(Ndarray *dst, Ndarray *src) {
+  const std::size_t size = dst->get_nelement() * dst->get_element_size();
+  TI_ERROR_IF(size != src->get_nelement() * src->get_element_size(),
+              "Ndarrays of {} and {} bytes can not be copied", size,
+              src->get_nelement() * src->get_element_size());
+  FlightRecorder::Scope trace(TraceEvent::memory_copy, /*name_id=*/0, size);
+  return program_impl_->copy_ndarray_async(dst->ndarray_alloc_.get_ptr(0),
+                                           src->ndarray_alloc_.get_ptr(0),
+                                           size);
+}
+
+void Program::wait_semaphore(const StreamSemaphore &sema) {
+  program_impl_->wait_semaphore(sema);
+}
+
 Program::~Program() {
   finalize();
 }
@@ -523,6 +977,7 @@ void Program::prepare_runtime_context(RuntimeContext *ctx) {
 void Program::enqueue_compute_op_lambda(
     std::function<void(Device *device, CommandList *cmdlist)> op,
     const std::vector<ComputeOpImageRef> &image_refs) {
+  flush_launch_queue();
   program_impl_->enqueue_compute_op_lambda(op, image_refs);
 }
 
@@ -7,6 +7,7 @@
 #include <atomic>
 #include <stack>
 #include <shared_mutex>
+#include <mutex>
 
 #define TI_RUNTIME_HOST
 #include "taichi/aot/module_builder.h"
@@ -20,6 +21,9 @@
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/kernel_profiler.h"
+#include "taichi/program/launch_queue.h"
+#include "taichi/program/out_of_core_ndarray.h"
+#include "taichi/program/parallel_executor.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/program/snode_rw_accessors_bank.h"
 #include "taichi/program/context.h"
@@ -32,48 +36,6 @@
 
 namespace taichi::lang {
 
-struct JITEvaluatorId {
-  std::thread::id thread_id;
-  // Note that on certain backends (e.g. CUDA), functions created in one
-  // thread cannot be used in another. Hence the thread_id member.
-  int op;
-  DataType ret, lhs, rhs;
-  std::string tb;
-  bool is_binary;
-
-  UnaryOpType unary_op() const {
-    TI_ASSERT(!is_binary);
-    return (UnaryOpType)op;
-  }
-
-  BinaryOpType binary_op() const {
-    TI_ASSERT(is_binary);
-    return (BinaryOpType)op;
-  }
-
-  bool operator==(const JITEvaluatorId &o) const {
-    return thread_id == o.thread_id && op == o.op && ret == o.ret &&
-           lhs == o.lhs && rhs == o.rhs && is_binary == o.is_binary &&
-           tb == o.tb;
-  }
-};
-
-}  // namespace taichi::lang
-
-namespace std {
-template <>
-struct hash<taichi::lang::JITEvaluatorId> {
-  std::size_t operator()(
-      taichi::lang::JITEvaluatorId const &id) const noexcept {
-    return ((std::size_t)id.op | (id.ret.hash() << 8) | (id.lhs.hash() << 16) |
-            (id.rhs.hash() << 24) | ((std::size_t)id.is_binary << 31)) ^
-           (std::hash<std::thread::id>{}(id.thread_id) << 32);
-  }
-};
-}  // namespace std
-
-namespace taichi::lang {
-
 class StructCompiler;
 
 /**
@@ -105,10 +67,6 @@ class TI_DLL_EXPORT Program {
 
   std::unique_ptr<KernelProfilerBase> profiler{nullptr};
 
-  std::unordered_map<JITEvaluatorId, std::unique_ptr<Kernel>>
-      jit_evaluator_cache;
-  std::mutex jit_evaluator_cache_mut;
-
   // Note: for now we let all Programs share a single TypeFactory for smooth
   // migration. In the future each program should have its own copy.
   static TypeFactory &get_type_factory();
@@ -118,6 +76,9 @@ class TI_DLL_EXPORT Program {
 
   explicit Program(Arch arch);
 
+  // Unlike the other constructors, does not read default_compile_config.
+  explicit Program(const CompileConfig &compile_config);
+
   ~Program();
 
   CompileConfig &this_thread_config() {
@@ -172,6 +133,27 @@ class TI_DLL_EXPORT Program {
 
   StreamSemaphore flush();
 
+  /**
+   * Binds the calling thread to the native queue |stream|, e.g. the CUstream
+   * of the caller on CUDA, so that its kernels, fills and copies are ordered
+   * with the caller's work instead of the whole device. 0 restores the
+   * default queue.
+   */
+  void set_launch_stream(uint64 stream) {
+    // The deferred launches were issued against the previous stream.
+    flush_launch_queue();
+    program_impl_->set_launch_stream(stream);
+  }
+
+  uint64 get_launch_stream() {
+    return program_impl_->get_launch_stream();
+  }
+
+  // See CompileConfig::async_launch. nullptr if launches are not deferred.
+  LaunchQueue *get_launch_queue() {
+    return launch_queue_.get();
+  }
+
   /**
    * Materializes the runtime.
    */
@@ -195,14 +177,41 @@ class TI_DLL_EXPORT Program {
   // offloading them to each backend. We should probably separate the logic?
   FunctionType compile(const CompileConfig &compile_config, Kernel &kernel);
 
+  // Compiles |kernels| ahead of their first launch. Backends that support it
+  // compile different kernels concurrently. Kernels that have already been
+  // compiled are skipped.
+  void compile_kernels(const CompileConfig &compile_config,
+                       const std::vector<Kernel *> &kernels);
+
+  // Like compile_kernels(), but returns immediately and compiles |kernels| on
+  // a background thread. Each kernel is published as soon as it is ready, so
+  // that launching a kernel only blocks if its own compilation is still in
+  // flight.
+  void warm_up_kernels(const CompileConfig &compile_config,
+                       const std::vector<Kernel *> &kernels);
+
+  // Blocks until all the kernels passed to warm_up_kernels() are compiled.
+  void wait_for_warm_up();
+
   void check_runtime_error();
 
   Kernel &get_snode_reader(SNode *snode);
 
   Kernel &get_snode_writer(SNode *snode);
 
+  // Accessors of many elements of |snode| in one launch, see
+  // SNodeRwAccessorsBank::Accessors::read_batch().
+  Kernel &get_snode_batch_reader(SNode *snode);
+
+  Kernel &get_snode_batch_writer(SNode *snode);
+
   uint64 fetch_result_uint64(int i);
 
+  // Copies the first |n| slots of the result buffer behind the kernels
+  // launched so far, without synchronizing the device where the backend
+  // allows it.
+  std::unique_ptr<DeferredResults> fetch_results_deferred(int n);
+
   template <typename T>
   T fetch_result(int i) {
     return taichi_union_cast_with_different_sizes<T>(fetch_result_uint64(i));
@@ -219,7 +228,7 @@ class TI_DLL_EXPORT Program {
   void finalize();
 
   static int get_kernel_id() {
-    static int id = 0;
+    static std::atomic<int> id{0};
     TI_ASSERT(id < 100000);
     return id++;
   }
@@ -233,6 +242,8 @@ class TI_DLL_EXPORT Program {
   // Returns zero if the SNode is statically allocated
   std::size_t get_snode_num_dynamically_allocated(SNode *snode);
 
+  MemoryStats get_memory_stats();
+
   inline SNodeFieldMap *get_snode_to_fields() {
     return &snode_to_fields_;
   }
@@ -281,6 +292,16 @@ class TI_DLL_EXPORT Program {
    */
   SNode *get_snode_root(int tree_id);
 
+  /**
+   * Gets a SNode tree.
+   *
+   * @param tree_id Index of the SNode tree
+   * @return The tree
+   */
+  SNodeTree *get_snode_tree(int tree_id) {
+    return snode_trees_[tree_id].get();
+  }
+
   std::unique_ptr<AotModuleBuilder> make_aot_module_builder(
       Arch arch,
       const std::vector<std::string> &caps);
@@ -290,9 +311,14 @@ class TI_DLL_EXPORT Program {
   }
 
   DevicePtr get_snode_tree_device_ptr(int tree_id) {
+    flush_launch_queue();
     return program_impl_->get_snode_tree_device_ptr(tree_id);
   }
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) {
+    return program_impl_->get_snode_tree_buffer_size(tree_id);
+  }
+
   Device *get_compute_device() {
     return program_impl_->get_compute_device();
   }
@@ -316,16 +342,64 @@ class TI_DLL_EXPORT Program {
       ExternalArrayLayout layout = ExternalArrayLayout::kNull,
       bool zero_fill = false);
 
+  /* Creates a Ndarray viewing the device memory at |ptr| without copying it.
+   * |release| is called from the destructor of the Ndarray instead of
+   * deallocating the memory.
+   */
+  Ndarray *import_ndarray(void *ptr,
+                          const DataType type,
+                          const std::vector<int> &shape,
+                          std::function<void()> release);
+
+  /* Returns a handle with which another process on the same node, e.g. the
+   * one driving a neighboring GPU, can access the memory of |ndarray| through
+   * import_ndarray_from_ipc_handle(). Only CUDA memory can be shared across
+   * processes; a handle opened by this process views the same memory.
+   */
+  std::string get_ndarray_ipc_handle(Ndarray *ndarray);
+  Ndarray *import_ndarray_from_ipc_handle(const std::string &handle,
+                                          const DataType type,
+                                          const std::vector<int> &shape);
+
+  /* Copies |num_rows| indices along the outermost axis of |src| starting at
+   * |src_row| into |dst| at |dst_row| without waiting, e.g. to exchange the
+   * halos of arrays sharded along that axis. The rows must have the same
+   * size. On CUDA, a peer ndarray is copied directly between the GPUs.
+   */
+  StreamSemaphore copy_ndarray_rows_async(Ndarray *dst,
+                                          int dst_row,
+                                          Ndarray *src,
+                                          int src_row,
+                                          int num_rows);
+
   void delete_ndarray(Ndarray *ndarray);
 
+  // See OutOfCoreNdarray. Returns an array owned by the program, which lives
+  // until delete_out_of_core_ndarray() or finalize().
+  OutOfCoreNdarray *create_out_of_core_ndarray(const DataType type,
+                                               const std::vector<int> &shape,
+                                               const std::string &path,
+                                               int tile_rows);
+
+  void delete_out_of_core_ndarray(OutOfCoreNdarray *ndarray);
+
   Texture *create_texture(const DataType type,
                           int num_channels,
-                          const std::vector<int> &shape);
+                          const std::vector<int> &shape,
+                          int num_mip_levels = 1);
 
   intptr_t get_ndarray_data_ptr_as_int(const Ndarray *ndarray);
 
   void fill_ndarray_fast_u32(Ndarray *ndarray, uint32_t val);
 
+  // Queue a fill or a copy of ndarrays without waiting for the device. Kernels
+  // launched afterwards from the same thread observe the result. The returned
+  // handle completes with the operation (nullptr if it already has) and can
+  // be passed to wait_semaphore() to order work submitted elsewhere after it.
+  StreamSemaphore fill_ndarray_fast_u32_async(Ndarray *ndarray, uint32_t val);
+  StreamSemaphore copy_ndarray_async(Ndarray *dst, Ndarray *src);
+  void wait_semaphore(const StreamSemaphore &sema);
+
   Identifier get_next_global_id(const std::string &name = "") {
     return Identifier(global_id_counter_++, name);
   }
@@ -380,14 +454,45 @@ class TI_DLL_EXPORT Program {
 
   std::unique_ptr<ProgramImpl> program_impl_;
   float64 total_compilation_time_{0.0};
+  // The compiled kernels by their offline cache key, which kernels with the
+  // same IR and config share. See get_shared_kernel_key().
+  std::unordered_map<std::string, FunctionType> shared_kernels_;
   static std::atomic<int> num_instances_;
+  // Guards the instance counts.
+  static std::mutex instances_mut_;
+  static int num_cpu_instances_;
   bool finalized_{false};
 
   std::unique_ptr<MemoryPool> memory_pool_{nullptr};
   // TODO: Move ndarrays_ and textures_ to be managed by runtime
   std::unordered_map<void *, std::unique_ptr<Ndarray>> ndarrays_;
+  // Declared after ndarrays_, as these hold some of the ndarrays.
+  std::unordered_map<void *, std::unique_ptr<OutOfCoreNdarray>>
+      out_of_core_ndarrays_;
   std::vector<std::unique_ptr<Texture>> textures_;
   std::shared_mutex config_map_mut;
+
+  // Returns the key under which |kernel| shares its compiled code with the
+  // identical kernels of this program, or an empty string if it can't.
+  std::string get_shared_kernel_key(const CompileConfig &compile_config,
+                                    Kernel &kernel);
+  // Like ProgramImpl::compile_kernels(), but kernels identical to one that
+  // has already been compiled, or to another one in |kernels|, reuse its
+  // code. |on_compiled| may then be invoked out of the order of |kernels|.
+  void compile_kernels_impl(
+      const CompileConfig &compile_config,
+      const std::vector<Kernel *> &kernels,
+      const ProgramImpl::CompiledKernelCallback &on_compiled);
+
+  // Serializes compilations, which share the codegen state of
+  // |program_impl_|, with each other and with changes to the SNode trees.
+  // Recursive since materializing an SNode tree may compile kernels.
+  std::recursive_mutex compile_mut_;
+  // Created on the first call to warm_up_kernels().
+  std::unique_ptr<ParallelExecutor> warm_up_worker_{nullptr};
+  std::unique_ptr<LaunchQueue> launch_queue_{nullptr};
+
+  void flush_launch_queue();
 };
 
 }  // namespace taichi::lang
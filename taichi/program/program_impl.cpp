@@ -10,4 +10,15 @@ void ProgramImpl::compile_snode_tree_types(SNodeTree *tree) {
   TI_NOT_IMPLEMENTED;
 }
 
+std::unique_ptr<DeferredResults> ProgramImpl::fetch_results_deferred(
+    int n,
+    uint64 *result_buffer) {
+  synchronize();
+  std::vector<uint64> values(n);
+  for (int i = 0; i < n; i++) {
+    values[i] = fetch_result_uint64(i, result_buffer);
+  }
+  return std::make_unique<HostDeferredResults>(std::move(values));
+}
+
 }  // namespace taichi::lang
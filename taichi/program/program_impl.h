@@ -7,6 +7,9 @@
 #include "taichi/struct/snode_tree.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/program/kernel_profiler.h"
+#include "taichi/program/kernel_return_future.h"
+#include "taichi/program/launch_queue.h"
+#include "taichi/program/memory_stats.h"
 #include "taichi/rhi/device.h"
 #include "taichi/aot/graph_data.h"
 
@@ -38,6 +41,22 @@ class ProgramImpl {
   virtual FunctionType compile(const CompileConfig &compile_config,
                                Kernel *kernel) = 0;
 
+  using CompiledKernelCallback = std::function<void(int, FunctionType)>;
+
+  /**
+   * Codegen a batch of kernels. |on_compiled| is invoked on the calling thread
+   * with the index of each kernel as soon as it is ready, in the order of
+   * |kernels|. Backends that can compile different kernels concurrently
+   * override this.
+   */
+  virtual void compile_kernels(const CompileConfig &compile_config,
+                               const std::vector<Kernel *> &kernels,
+                               const CompiledKernelCallback &on_compiled) {
+    for (int i = 0; i < (int)kernels.size(); i++) {
+      on_compiled(i, compile(compile_config, kernels[i]));
+    }
+  }
+
   /**
    * Allocate runtime buffer, e.g result_buffer or backend specific runtime
    * buffer, e.g. preallocated_device_buffer on CUDA.
@@ -101,11 +120,38 @@ class ProgramImpl {
     return kDeviceNullPtr;
   }
 
+  // The bytes of the root buffer of the SNode tree |tree_id|, or 0 if it has
+  // none, e.g. because it was destroyed.
+  virtual std::size_t get_snode_tree_buffer_size(int tree_id) {
+    TI_ERROR(
+        "get_snode_tree_buffer_size() not implemented on the current backend");
+    return 0;
+  }
+
   virtual DeviceAllocation allocate_memory_ndarray(std::size_t alloc_size,
                                                    uint64 *result_buffer) {
     return kDeviceNullAllocation;
   }
 
+  // Wraps |size| bytes of device memory at |ptr|, which Taichi does not own.
+  virtual DeviceAllocation import_memory(void *ptr, std::size_t size) {
+    return kDeviceNullAllocation;
+  }
+
+  // Returns a handle that lets other processes on the same node, or this one,
+  // map the memory at |ptr| with open_memory_ipc_handle(). Empty if not
+  // supported.
+  virtual std::string export_memory_ipc_handle(DevicePtr ptr) {
+    return {};
+  }
+
+  // Maps the memory of a handle from export_memory_ipc_handle(). |release|
+  // is set to the function unmapping it. Returns nullptr if not supported.
+  virtual void *open_memory_ipc_handle(const std::string &handle,
+                                       std::function<void()> *release) {
+    return nullptr;
+  }
+
   virtual bool used_in_kernel(DeviceAllocationId) {
     return false;
   }
@@ -114,6 +160,21 @@ class ProgramImpl {
     return kDeviceNullAllocation;
   }
 
+  virtual void deallocate_texture(DeviceAllocation texture) {
+    static_cast<GraphicsDevice *>(get_graphics_device())
+        ->destroy_image(texture);
+  }
+
+  /* Copies the texels at |src| to |texture| after the work submitted so far.
+   * The graphics backends record the copy into command lists of their own,
+   * see Texture::from_ndarray().
+   */
+  virtual void copy_buffer_to_texture(DeviceAllocation texture,
+                                      DevicePtr src,
+                                      const BufferImageCopyParams &params) {
+    TI_NOT_IMPLEMENTED;
+  }
+
   virtual ~ProgramImpl() {
   }
 
@@ -131,10 +192,100 @@ class ProgramImpl {
     TI_ERROR("fill_ndarray() not implemented on the current backend");
   }
 
+  /**
+   * Fills |size| 32-bit words of |alloc| with |data| without waiting for the
+   * fill to complete. The fill is ordered before the kernels launched
+   * afterwards from the same thread.
+   *
+   * @return A handle that completes with the fill, or nullptr if the fill has
+   * already completed.
+   */
+  virtual StreamSemaphore fill_ndarray_async(const DeviceAllocation &alloc,
+                                             std::size_t size,
+                                             uint32_t data) {
+    fill_ndarray(alloc, size, data);
+    return flush();
+  }
+
+  /**
+   * Copies |size| bytes from |src| to |dst| without waiting for the copy to
+   * complete, with the same ordering as fill_ndarray_async().
+   */
+  virtual StreamSemaphore copy_ndarray_async(DevicePtr dst,
+                                             DevicePtr src,
+                                             std::size_t size) {
+    TI_ERROR("copy_ndarray_async() not implemented on the current backend");
+    return nullptr;
+  }
+
+  /**
+   * Makes the work submitted afterwards wait for |sema|, e.g. a handle
+   * returned to another thread. Each handle can be waited on once.
+   */
+  virtual void wait_semaphore(const StreamSemaphore &sema) {
+    if (sema) {
+      synchronize();
+    }
+  }
+
+  /**
+   * Returns a handle that completes with the work submitted so far.
+   */
+  virtual StreamSemaphore signal_semaphore() {
+    return flush();
+  }
+
+  /**
+   * Copies |size| bytes of host memory at |src| to |dst| once |wait| has
+   * completed, overlapping with the kernels where the backend can. |src| can
+   * be reused when this returns.
+   *
+   * @return A handle that completes with the copy, or nullptr if the copy has
+   * already completed.
+   */
+  virtual StreamSemaphore copy_from_host_async(DevicePtr dst,
+                                               const void *src,
+                                               std::size_t size,
+                                               const StreamSemaphore &wait) {
+    TI_ERROR("copy_from_host_async() not implemented on the current backend");
+    return nullptr;
+  }
+
+  /**
+   * Copies |size| bytes at |src| to host memory at |dst| after the work
+   * submitted so far.
+   */
+  virtual void copy_to_host(void *dst, DevicePtr src, std::size_t size) {
+    TI_ERROR("copy_to_host() not implemented on the current backend");
+  }
+
   // TODO: Move to Runtime Object
   virtual void prepare_runtime_context(RuntimeContext *ctx) {
   }
 
+  // Compute graphs built by GraphBuilder are run by the returned runner, if
+  // any.
+  virtual std::shared_ptr<aot::GraphRunner> make_graph_runner() {
+    return nullptr;
+  }
+
+  // Deferred launches are spread over the returned streams, if any, see
+  // LaunchQueue.
+  virtual std::unique_ptr<LaunchStreams> make_launch_streams() {
+    return nullptr;
+  }
+
+  // Makes the launches, fills and copies of the calling thread go to the
+  // native queue |stream|, e.g. a CUstream. 0 selects the default queue.
+  virtual void set_launch_stream(uint64 stream) {
+    TI_ERROR_IF(stream != 0,
+                "Launch streams are not supported on the current backend");
+  }
+
+  virtual uint64 get_launch_stream() {
+    return 0;
+  }
+
   virtual void enqueue_compute_op_lambda(
       std::function<void(Device *device, CommandList *cmdlist)> op,
       const std::vector<ComputeOpImageRef> &image_refs) {
@@ -148,6 +299,14 @@ class ProgramImpl {
         "print_memory_profiler_info() not implemented on the current backend");
   }
 
+  // Backends without dynamically allocated SNodes leave out the SNodes and
+  // runtime memory.
+  virtual MemoryStats get_memory_stats(
+      const std::vector<std::unique_ptr<SNodeTree>> &snode_trees,
+      uint64 *result_buffer) {
+    return {};
+  }
+
   virtual void check_runtime_error(uint64 *result_buffer) {
     TI_ERROR("check_runtime_error() not implemented on the current backend");
   }
@@ -159,6 +318,11 @@ class ProgramImpl {
     return result_buffer[i];
   }
 
+  // Synchronizes and copies the slots by default.
+  virtual std::unique_ptr<DeferredResults> fetch_results_deferred(
+      int n,
+      uint64 *result_buffer);
+
  private:
 };
 
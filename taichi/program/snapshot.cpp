@@ -0,0 +1,580 @@
+#include "taichi/program/snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <thread>
+
+#include "taichi/common/miniz.h"
+#include "taichi/program/ndarray.h"
+#include "taichi/program/program.h"
+
+#if defined(TI_PLATFORM_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include "taichi/platform/windows/windows.h"
+#endif
+
+namespace taichi::lang {
+namespace {
+
+// File layout:
+//   header:  kMagic, uint64 chunk bytes
+//   chunks:  the data of the buffers, each chunk deflated or raw
+//   index:   uint32 number of buffers, then per buffer
+//              uint32 kind, int32 id, uint64 bytes, uint32 number of chunks,
+//              and per chunk uint64 offset, uint64 stored bytes
+//   trailer: uint64 index offset, uint64 index bytes, kMagic
+// A chunk is raw iff its stored bytes equal its bytes.
+constexpr char kMagic[8] = {'T', 'I', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr std::size_t kChunkBytes = 4 << 20;
+constexpr std::size_t kHeaderBytes = sizeof(kMagic) + sizeof(uint64);
+constexpr std::size_t kTrailerBytes = 2 * sizeof(uint64) + sizeof(kMagic);
+
+enum class BufferKind : uint32 { snode_tree = 0, ndarray = 1 };
+
+struct Chunk {
+  uint64 offset{0};
+  uint64 stored_bytes{0};
+};
+
+struct Buffer {
+  BufferKind kind;
+  int32 id;
+  uint64 bytes;
+  DevicePtr ptr{kDeviceNullPtr};
+  std::vector<Chunk> chunks;
+
+  std::string name() const {
+    const char *kind_name =
+        kind == BufferKind::snode_tree ? "SNode tree" : "ndarray";
+    return fmt::format("{} {}", kind_name, id);
+  }
+
+  std::size_t chunk_bytes(std::size_t i) const {
+    return std::min<std::size_t>(kChunkBytes, bytes - i * kChunkBytes);
+  }
+};
+
+std::size_t num_chunks(std::size_t bytes) {
+  return (bytes + kChunkBytes - 1) / kChunkBytes;
+}
+
+// The number of chunks compressed or decompressed at the same time.
+int batch_chunks() {
+  return std::clamp<int>(std::thread::hardware_concurrency(), 2, 8);
+}
+
+void check_cells_in_root_buffer(const SNode *snode, int tree_id) {
+  TI_ERROR_IF(snode->type == SNodeType::pointer ||
+                  snode->type == SNodeType::dynamic ||
+                  snode->type == SNodeType::hash,
+              "SNode tree {} contains a {} SNode, whose cells are not in the "
+              "root buffer. Snapshots only support trees without them.",
+              tree_id, snode_type_name(snode->type));
+  for (const auto &ch : snode->ch) {
+    check_cells_in_root_buffer(ch.get(), tree_id);
+  }
+}
+
+// The buffers of a snapshot of |prog|, in the order they are stored.
+std::vector<Buffer> collect_buffers(Program *prog,
+                                    const std::vector<Ndarray *> &ndarrays) {
+  std::vector<Buffer> buffers;
+  for (int id = 0; id < prog->get_snode_tree_size(); id++) {
+    const auto bytes = prog->get_snode_tree_buffer_size(id);
+    // Destroyed or compile-only trees.
+    if (bytes == 0) {
+      continue;
+    }
+    check_cells_in_root_buffer(prog->get_snode_root(id), id);
+    buffers.push_back({BufferKind::snode_tree, id, bytes,
+                       prog->get_snode_tree_device_ptr(id)});
+  }
+  for (int i = 0; i < (int)ndarrays.size(); i++) {
+    auto *ndarray = ndarrays[i];
+    TI_ERROR_IF(ndarray == nullptr, "Ndarray {} of the snapshot is null", i);
+    buffers.push_back({BufferKind::ndarray, i,
+                       ndarray->get_nelement() * ndarray->get_element_size(),
+                       ndarray->ndarray_alloc_.get_ptr()});
+  }
+  return buffers;
+}
+
+// Copies between the device and host memory. The LLVM backends go through
+// their pinned staging buffers, the others through a host-visible buffer.
+class Transfer {
+ public:
+  explicit Transfer(Program *prog)
+      : prog_(prog), llvm_(arch_uses_llvm(prog->this_thread_config().arch)) {
+  }
+
+  void download(DevicePtr src, void *dst, std::size_t size) {
+    if (llvm_) {
+      prog_->get_program_impl()->copy_to_host(dst, src, size);
+      return;
+    }
+    auto *staging = get_staging(src.device, /*host_read=*/true);
+    src.device->memcpy_internal(staging->get_ptr(), src, size);
+    void *mapped{nullptr};
+    TI_ASSERT(src.device->map(*staging, &mapped) == RhiResult::success);
+    std::memcpy(dst, mapped, size);
+    src.device->unmap(*staging);
+  }
+
+  // |src| can be reused when this returns.
+  void upload(DevicePtr dst, const void *src, std::size_t size) {
+    if (llvm_) {
+      auto sema = prog_->get_program_impl()->copy_from_host_async(
+          dst, src, size, nullptr);
+      if (sema) {
+        uploads_.push_back(std::move(sema));
+      }
+      return;
+    }
+    auto *staging = get_staging(dst.device, /*host_read=*/false);
+    void *mapped{nullptr};
+    TI_ASSERT(dst.device->map(*staging, &mapped) == RhiResult::success);
+    std::memcpy(mapped, src, size);
+    dst.device->unmap(*staging);
+    dst.device->memcpy_internal(dst, staging->get_ptr(), size);
+  }
+
+  // Orders the kernels launched afterwards after the uploads.
+  void finish_uploads() {
+    for (const auto &sema : uploads_) {
+      prog_->wait_semaphore(sema);
+    }
+    uploads_.clear();
+    prog_->synchronize();
+  }
+
+ private:
+  DeviceAllocationGuard *get_staging(Device *device, bool host_read) {
+    if (staging_ == nullptr || staging_->device != device) {
+      Device::AllocParams params;
+      params.size = kChunkBytes;
+      params.host_read = host_read;
+      params.host_write = !host_read;
+      params.usage = AllocUsage::Storage;
+      staging_ = device->allocate_memory_unique(params);
+    }
+    return staging_.get();
+  }
+
+  Program *prog_{nullptr};
+  bool llvm_{false};
+  std::unique_ptr<DeviceAllocationGuard> staging_;
+  std::vector<StreamSemaphore> uploads_;
+};
+
+class FileWriter {
+ public:
+  explicit FileWriter(const std::string &path) : path_(path) {
+    file_ = std::fopen(path.c_str(), "wb");
+    TI_ERROR_IF(file_ == nullptr, "Failed to open {}", path);
+  }
+
+  ~FileWriter() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  void write(const void *data, std::size_t size) {
+    TI_ERROR_IF(std::fwrite(data, 1, size, file_) != size,
+                "Failed to write {}", path_);
+    offset_ += size;
+  }
+
+  template <typename T>
+  void write(const T &value) {
+    write(&value, sizeof(value));
+  }
+
+  void close() {
+    TI_ERROR_IF(std::fclose(file_) != 0, "Failed to write {}", path_);
+    file_ = nullptr;
+  }
+
+  uint64 offset() const {
+    return offset_;
+  }
+
+ private:
+  std::string path_;
+  std::FILE *file_{nullptr};
+  uint64 offset_{0};
+};
+
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &path) {
+#if defined(TI_PLATFORM_UNIX)
+    fd_ = open(path.c_str(), O_RDONLY);
+    TI_ERROR_IF(fd_ < 0, "Failed to open {}", path);
+    struct stat st;
+    TI_ERROR_IF(fstat(fd_, &st) != 0, "Failed to stat {}", path);
+    size_ = st.st_size;
+    if (size_ > 0) {
+      void *ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      TI_ERROR_IF(ptr == MAP_FAILED, "Failed to map {}", path);
+      madvise(ptr, size_, MADV_SEQUENTIAL);
+      data_ = (const char *)ptr;
+    }
+#else
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    TI_ERROR_IF(file_ == INVALID_HANDLE_VALUE, "Failed to open {}", path);
+    LARGE_INTEGER file_size;
+    TI_ERROR_IF(!GetFileSizeEx(file_, &file_size), "Failed to stat {}", path);
+    size_ = file_size.QuadPart;
+    if (size_ > 0) {
+      mapping_ =
+          CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      TI_ERROR_IF(mapping_ == nullptr, "Failed to map {}", path);
+      data_ = (const char *)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+      TI_ERROR_IF(data_ == nullptr, "Failed to map {}", path);
+    }
+#endif
+  }
+
+  ~MappedFile() {
+#if defined(TI_PLATFORM_UNIX)
+    if (data_ != nullptr) {
+      munmap((void *)data_, size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#else
+    if (data_ != nullptr) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+#endif
+  }
+
+  const char *data() const {
+    return data_;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+ private:
+  const char *data_{nullptr};
+  std::size_t size_{0};
+#if defined(TI_PLATFORM_UNIX)
+  int fd_{-1};
+#else
+  HANDLE file_{INVALID_HANDLE_VALUE};
+  HANDLE mapping_{nullptr};
+#endif
+};
+
+// Reads the index of a snapshot, checking that it is within |file|.
+class IndexReader {
+ public:
+  IndexReader(const std::string &path, const MappedFile &file) : path_(path) {
+    TI_ERROR_IF(file.size() < kHeaderBytes + kTrailerBytes ||
+                    std::memcmp(file.data(), kMagic, sizeof(kMagic)) != 0 ||
+                    std::memcmp(file.data() + file.size() - sizeof(kMagic),
+                                kMagic, sizeof(kMagic)) != 0,
+                "{} is not a snapshot", path);
+    uint64 chunk_bytes;
+    std::memcpy(&chunk_bytes, file.data() + sizeof(kMagic), sizeof(uint64));
+    TI_ERROR_IF(chunk_bytes != kChunkBytes,
+                "{} was saved with chunks of {} B instead of {} B", path,
+                chunk_bytes, kChunkBytes);
+    const char *trailer = file.data() + file.size() - kTrailerBytes;
+    uint64 index_offset, index_bytes;
+    std::memcpy(&index_offset, trailer, sizeof(uint64));
+    std::memcpy(&index_bytes, trailer + sizeof(uint64), sizeof(uint64));
+    data_end_ = index_offset;
+    TI_ERROR_IF(index_offset < kHeaderBytes ||
+                    index_offset + index_bytes != file.size() - kTrailerBytes,
+                "The index of {} is corrupted", path);
+    pos_ = file.data() + index_offset;
+    end_ = pos_ + index_bytes;
+  }
+
+  std::vector<Buffer> read_buffers() {
+    std::vector<Buffer> buffers(read<uint32>());
+    for (auto &buffer : buffers) {
+      buffer.kind = (BufferKind)read<uint32>();
+      buffer.id = read<int32>();
+      buffer.bytes = read<uint64>();
+      buffer.chunks.resize(read<uint32>());
+      TI_ERROR_IF(buffer.chunks.size() != num_chunks(buffer.bytes),
+                  "The index of {} is corrupted", path_);
+      for (std::size_t i = 0; i < buffer.chunks.size(); i++) {
+        auto &chunk = buffer.chunks[i];
+        chunk.offset = read<uint64>();
+        chunk.stored_bytes = read<uint64>();
+        TI_ERROR_IF(chunk.offset < kHeaderBytes ||
+                        chunk.offset + chunk.stored_bytes > data_end_ ||
+                        chunk.stored_bytes > buffer.chunk_bytes(i),
+                    "The index of {} is corrupted", path_);
+      }
+    }
+    return buffers;
+  }
+
+ private:
+  template <typename T>
+  T read() {
+    TI_ERROR_IF(pos_ + sizeof(T) > end_, "The index of {} is corrupted",
+                path_);
+    T value;
+    std::memcpy(&value, pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+
+  std::string path_;
+  uint64 data_end_{0};
+  const char *pos_{nullptr};
+  const char *end_{nullptr};
+};
+
+// The chunks of all the buffers, in file order.
+struct ChunkRef {
+  Buffer *buffer;
+  std::size_t index;
+};
+
+std::vector<ChunkRef> list_chunks(std::vector<Buffer> &buffers) {
+  std::vector<ChunkRef> chunks;
+  for (auto &buffer : buffers) {
+    for (std::size_t i = 0; i < num_chunks(buffer.bytes); i++) {
+      chunks.push_back({&buffer, i});
+    }
+  }
+  return chunks;
+}
+
+// Host memory for the chunks of one batch.
+struct Batch {
+  std::vector<std::vector<char>> raw;
+  std::vector<std::vector<char>> packed;
+
+  explicit Batch(int size, bool compress) : raw(size), packed(size) {
+    for (auto &buffer : raw) {
+      buffer.resize(kChunkBytes);
+    }
+    if (compress) {
+      for (auto &buffer : packed) {
+        buffer.resize(mz_compressBound(kChunkBytes));
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void save_snapshot(Program *prog,
+                   const std::string &path,
+                   const std::vector<Ndarray *> &ndarrays,
+                   bool compress) {
+  auto buffers = collect_buffers(prog, ndarrays);
+  for (auto &buffer : buffers) {
+    buffer.chunks.resize(num_chunks(buffer.bytes));
+  }
+  auto chunks = list_chunks(buffers);
+  prog->synchronize();
+
+  FileWriter file(path);
+  file.write(kMagic, sizeof(kMagic));
+  file.write((uint64)kChunkBytes);
+
+  // Compresses and writes the chunks [begin, begin + count) from |batch|.
+  auto write_batch = [&](std::size_t begin, std::size_t count, Batch &batch) {
+    std::vector<uint64> stored(count);
+    std::vector<std::future<void>> jobs;
+    for (std::size_t j = 0; j < count; j++) {
+      const auto bytes = chunks[begin + j].buffer->chunk_bytes(
+          chunks[begin + j].index);
+      stored[j] = bytes;
+      if (!compress) {
+        continue;
+      }
+      jobs.push_back(std::async(std::launch::async, [&, j, bytes]() {
+        mz_ulong packed_bytes = batch.packed[j].size();
+        if (mz_compress2((unsigned char *)batch.packed[j].data(),
+                         &packed_bytes,
+                         (const unsigned char *)batch.raw[j].data(), bytes,
+                         MZ_BEST_SPEED) == MZ_OK &&
+            packed_bytes < bytes) {
+          stored[j] = packed_bytes;
+        }
+      }));
+    }
+    for (auto &job : jobs) {
+      job.get();
+    }
+    for (std::size_t j = 0; j < count; j++) {
+      const auto &ref = chunks[begin + j];
+      const auto bytes = ref.buffer->chunk_bytes(ref.index);
+      ref.buffer->chunks[ref.index] = {file.offset(), stored[j]};
+      file.write(stored[j] == bytes ? batch.raw[j].data()
+                                    : batch.packed[j].data(),
+                 stored[j]);
+    }
+  };
+
+  // The copies from the device of a batch overlap with the compression and
+  // the writes of the previous one.
+  const int batch_size = batch_chunks();
+  Batch batches[2] = {Batch(batch_size, compress), Batch(batch_size, compress)};
+  Transfer transfer(prog);
+  std::future<void> writing;
+  for (std::size_t begin = 0, b = 0; begin < chunks.size();
+       begin += batch_size, b++) {
+    const auto count = std::min<std::size_t>(batch_size, chunks.size() - begin);
+    auto &batch = batches[b % 2];
+    for (std::size_t j = 0; j < count; j++) {
+      const auto &ref = chunks[begin + j];
+      auto src = ref.buffer->ptr;
+      src.offset += ref.index * kChunkBytes;
+      transfer.download(src, batch.raw[j].data(),
+                        ref.buffer->chunk_bytes(ref.index));
+    }
+    if (writing.valid()) {
+      writing.get();
+    }
+    writing = std::async(std::launch::async, write_batch, begin, count,
+                         std::ref(batch));
+  }
+  if (writing.valid()) {
+    writing.get();
+  }
+
+  std::vector<char> index;
+  auto append = [&](const auto &value) {
+    const char *bytes = (const char *)&value;
+    index.insert(index.end(), bytes, bytes + sizeof(value));
+  };
+  append((uint32)buffers.size());
+  for (const auto &buffer : buffers) {
+    append((uint32)buffer.kind);
+    append(buffer.id);
+    append(buffer.bytes);
+    append((uint32)buffer.chunks.size());
+    for (const auto &chunk : buffer.chunks) {
+      append(chunk.offset);
+      append(chunk.stored_bytes);
+    }
+  }
+  const uint64 index_offset = file.offset();
+  file.write(index.data(), index.size());
+  file.write(index_offset);
+  file.write((uint64)index.size());
+  file.write(kMagic, sizeof(kMagic));
+  file.close();
+}
+
+void load_snapshot(Program *prog,
+                   const std::string &path,
+                   const std::vector<Ndarray *> &ndarrays) {
+  MappedFile file(path);
+  auto buffers = IndexReader(path, file).read_buffers();
+  const auto expected = collect_buffers(prog, ndarrays);
+  TI_ERROR_IF(buffers.size() != expected.size(),
+              "{} holds {} buffers, but the program has {} SNode trees and "
+              "ndarrays",
+              path, buffers.size(), expected.size());
+  for (std::size_t i = 0; i < buffers.size(); i++) {
+    auto &buffer = buffers[i];
+    TI_ERROR_IF(buffer.kind != expected[i].kind || buffer.id != expected[i].id,
+                "Buffer {} of {} is {}, but {} in the program", i, path,
+                buffer.name(), expected[i].name());
+    TI_ERROR_IF(buffer.bytes != expected[i].bytes,
+                "{} of {} has {} B, but {} B in the program", buffer.name(),
+                path, buffer.bytes, expected[i].bytes);
+    buffer.ptr = expected[i].ptr;
+  }
+  auto chunks = list_chunks(buffers);
+  // Kernels in flight may still use the old values.
+  prog->synchronize();
+
+  auto is_raw = [&](const ChunkRef &ref) {
+    return ref.buffer->chunks[ref.index].stored_bytes ==
+           ref.buffer->chunk_bytes(ref.index);
+  };
+  // Decompresses the chunks [begin, begin + count) into |batch|. The raw
+  // chunks are uploaded from the mapping.
+  auto inflate_batch = [&](std::size_t begin, std::size_t count,
+                           Batch &batch) {
+    std::vector<std::future<void>> jobs;
+    for (std::size_t j = 0; j < count; j++) {
+      const auto &ref = chunks[begin + j];
+      if (is_raw(ref)) {
+        continue;
+      }
+      jobs.push_back(std::async(std::launch::async, [&, j, ref]() {
+        const auto &chunk = ref.buffer->chunks[ref.index];
+        const auto bytes = ref.buffer->chunk_bytes(ref.index);
+        mz_ulong inflated_bytes = bytes;
+        TI_ERROR_IF(
+            mz_uncompress((unsigned char *)batch.raw[j].data(),
+                          &inflated_bytes,
+                          (const unsigned char *)file.data() + chunk.offset,
+                          chunk.stored_bytes) != MZ_OK ||
+                inflated_bytes != bytes,
+            "Chunk {} of {} in {} is corrupted", ref.index,
+            ref.buffer->name(), path);
+      }));
+    }
+    for (auto &job : jobs) {
+      job.get();
+    }
+  };
+
+  // The decompression of a batch overlaps with the copies of the previous one
+  // to the device.
+  const int batch_size = batch_chunks();
+  Batch batches[2] = {Batch(batch_size, false), Batch(batch_size, false)};
+  Transfer transfer(prog);
+  std::future<void> inflating;
+  if (!chunks.empty()) {
+    inflating = std::async(std::launch::async, inflate_batch, 0,
+                           std::min<std::size_t>(batch_size, chunks.size()),
+                           std::ref(batches[0]));
+  }
+  for (std::size_t begin = 0, b = 0; begin < chunks.size();
+       begin += batch_size, b++) {
+    const auto count = std::min<std::size_t>(batch_size, chunks.size() - begin);
+    inflating.get();
+    const auto next = begin + batch_size;
+    if (next < chunks.size()) {
+      inflating = std::async(
+          std::launch::async, inflate_batch, next,
+          std::min<std::size_t>(batch_size, chunks.size() - next),
+          std::ref(batches[(b + 1) % 2]));
+    }
+    const auto &batch = batches[b % 2];
+    for (std::size_t j = 0; j < count; j++) {
+      const auto &ref = chunks[begin + j];
+      auto dst = ref.buffer->ptr;
+      dst.offset += ref.index * kChunkBytes;
+      const char *src = is_raw(ref)
+                            ? file.data() + ref.buffer->chunks[ref.index].offset
+                            : batch.raw[j].data();
+      transfer.upload(dst, src, ref.buffer->chunk_bytes(ref.index));
+    }
+  }
+  transfer.finish_uploads();
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+namespace taichi::lang {
+
+class Ndarray;
+class Program;
+
+/* Snapshots of the device state of a program, for checkpointing: the root
+ * buffers of the materialized SNode trees, followed by the data of a list of
+ * ndarrays, copied to and from a file in chunks without going through the
+ * kernels that read and write fields.
+ *
+ * Saving overlaps the copies from the device with the compression and the
+ * writes of the previous chunks. With |compress|, the chunks are deflated in
+ * parallel with miniz. Loading maps the file and copies the chunks that were
+ * not compressed straight from the mapping to the device.
+ *
+ * A snapshot can only be loaded into SNode trees of the same ids and sizes,
+ * and into ndarrays of the same sizes passed in the same order. The cells of
+ * pointer, dynamic and hash SNodes live outside the root buffers, so trees
+ * containing them are not supported.
+ */
+TI_DLL_EXPORT void save_snapshot(Program *prog,
+                                 const std::string &path,
+                                 const std::vector<Ndarray *> &ndarrays,
+                                 bool compress = false);
+
+TI_DLL_EXPORT void load_snapshot(Program *prog,
+                                 const std::string &path,
+                                 const std::vector<Ndarray *> &ndarrays);
+
+}  // namespace taichi::lang
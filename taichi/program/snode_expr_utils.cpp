@@ -35,6 +35,21 @@ class GradInfoImpl final : public SNode::GradInfoProvider {
     return dual.snode();
   }
 
+  SNode *dual_lane_snode(int lane) const override {
+    if (lane == 0) {
+      return dual_snode();
+    }
+    auto &dual = field_->dual;
+    if (dual.expr == nullptr) {
+      return nullptr;
+    }
+    auto &lanes = dual.cast<FieldExpression>()->dual_lanes;
+    if (lane > (int)lanes.size()) {
+      return nullptr;
+    }
+    return lanes[lane - 1].snode();
+  }
+
   SNode *adjoint_checkbit_snode() const override {
     auto &adjoint_checkbit = field_->adjoint_checkbit;
     if (adjoint_checkbit.expr == nullptr) {
@@ -79,6 +94,12 @@ void place_child(Expr *expr_arg,
     child.id_in_bit_struct = id_in_bit_struct;
     if (!offset.empty())
       child.set_index_offsets(offset);
+    TI_ERROR_IF(id_in_bit_struct != -1 && !field->dual_lanes.empty(),
+                "Dual fields with multiple lanes cannot be placed in bit "
+                "structs.");
+    for (auto &lane : field->dual_lanes) {
+      place_child(&lane, offset, id_in_bit_struct, parent, snode_to_exprs);
+    }
   }
 }
 
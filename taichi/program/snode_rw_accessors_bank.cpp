@@ -25,13 +25,26 @@ SNodeRwAccessorsBank::Accessors SNodeRwAccessorsBank::get(SNode *snode) {
   return Accessors(snode, kernels, program_);
 }
 
+SNodeRwAccessorsBank::Accessors SNodeRwAccessorsBank::get_batch(SNode *snode) {
+  auto &kernels = snode_to_kernels_[snode];
+  if (kernels.batch_reader == nullptr) {
+    kernels.batch_reader = &(program_->get_snode_batch_reader(snode));
+  }
+  if (kernels.batch_writer == nullptr) {
+    kernels.batch_writer = &(program_->get_snode_batch_writer(snode));
+  }
+  return get(snode);
+}
+
 SNodeRwAccessorsBank::Accessors::Accessors(const SNode *snode,
                                            const RwKernels &kernels,
                                            Program *prog)
     : snode_(snode),
       prog_(prog),
       reader_(kernels.reader),
-      writer_(kernels.writer) {
+      writer_(kernels.writer),
+      batch_reader_(kernels.batch_reader),
+      batch_writer_(kernels.batch_writer) {
   TI_ASSERT(reader_ != nullptr);
   TI_ASSERT(writer_ != nullptr);
 }
@@ -78,4 +91,75 @@ uint64 SNodeRwAccessorsBank::Accessors::read_uint(const std::vector<int> &I) {
   return (uint64)read_int(I);
 }
 
+void SNodeRwAccessorsBank::Accessors::read_batch(const Ndarray &indices,
+                                                 const Ndarray &values) {
+  TI_ASSERT(batch_reader_ != nullptr);
+  TI_ASSERT(indices.shape.size() == 2 && values.shape.size() == 1);
+  TI_ASSERT(indices.shape[0] == values.shape[0] &&
+            indices.shape[1] == snode_->num_active_indices);
+  prog_->synchronize();
+  auto launch_ctx = batch_reader_->make_launch_context();
+  launch_ctx.set_arg_ndarray(0, indices);
+  launch_ctx.set_arg_ndarray(1, values);
+  launch_ctx.set_arg_int(2, values.shape[0]);
+  (*batch_reader_)(prog_->this_thread_config(), launch_ctx);
+  prog_->synchronize();
+}
+
+void SNodeRwAccessorsBank::Accessors::write_batch(const Ndarray &indices,
+                                                  const Ndarray &values) {
+  TI_ASSERT(batch_writer_ != nullptr);
+  TI_ASSERT(indices.shape.size() == 2 && values.shape.size() == 1);
+  TI_ASSERT(indices.shape[0] == values.shape[0] &&
+            indices.shape[1] == snode_->num_active_indices);
+  auto launch_ctx = batch_writer_->make_launch_context();
+  launch_ctx.set_arg_ndarray(0, indices);
+  launch_ctx.set_arg_ndarray(1, values);
+  launch_ctx.set_arg_int(2, values.shape[0]);
+  prog_->synchronize();
+  (*batch_writer_)(prog_->this_thread_config(), launch_ctx);
+}
+
+void SNodeRwAccessorsBank::Accessors::set_batch_args_external(
+    Kernel::LaunchContextBuilder *launch_ctx,
+    uint64 indices_ptr,
+    uint64 values_ptr,
+    int n) const {
+  const int num_indices = snode_->num_active_indices;
+  launch_ctx->set_arg_external_array_with_shape(
+      0, indices_ptr, (uint64)n * num_indices * sizeof(int32),
+      {n, num_indices});
+  launch_ctx->set_arg_external_array_with_shape(
+      1, values_ptr, (uint64)n * data_type_size(snode_->dt->get_compute_type()),
+      {n});
+  launch_ctx->set_arg_int(2, n);
+}
+
+void SNodeRwAccessorsBank::Accessors::read_batch(uint64 indices_ptr,
+                                                 uint64 values_ptr,
+                                                 int n) {
+  TI_ASSERT(batch_reader_ != nullptr);
+  if (n == 0) {
+    return;
+  }
+  prog_->synchronize();
+  auto launch_ctx = batch_reader_->make_launch_context();
+  set_batch_args_external(&launch_ctx, indices_ptr, values_ptr, n);
+  (*batch_reader_)(prog_->this_thread_config(), launch_ctx);
+  prog_->synchronize();
+}
+
+void SNodeRwAccessorsBank::Accessors::write_batch(uint64 indices_ptr,
+                                                  uint64 values_ptr,
+                                                  int n) {
+  TI_ASSERT(batch_writer_ != nullptr);
+  if (n == 0) {
+    return;
+  }
+  auto launch_ctx = batch_writer_->make_launch_context();
+  set_batch_args_external(&launch_ctx, indices_ptr, values_ptr, n);
+  prog_->synchronize();
+  (*batch_writer_)(prog_->this_thread_config(), launch_ctx);
+}
+
 }  // namespace taichi::lang
@@ -20,6 +20,8 @@ class SNodeRwAccessorsBank {
   struct RwKernels {
     Kernel *reader{nullptr};
     Kernel *writer{nullptr};
+    Kernel *batch_reader{nullptr};
+    Kernel *batch_writer{nullptr};
   };
 
  public:
@@ -38,11 +40,30 @@ class SNodeRwAccessorsBank {
     int64 read_int(const std::vector<int> &I);
     uint64 read_uint(const std::vector<int> &I);
 
+    /* Reads the elements at the rows of |indices|, an [n, num_active_indices]
+     * i32 ndarray, into the [n] ndarray |values| of the compute type of the
+     * SNode, with a single kernel launch. Only available on the Accessors
+     * returned by SNodeRwAccessorsBank::get_batch().
+     */
+    void read_batch(const Ndarray &indices, const Ndarray &values);
+    void write_batch(const Ndarray &indices, const Ndarray &values);
+
+    // Same as above for |n| elements in host (or device) memory.
+    void read_batch(uint64 indices_ptr, uint64 values_ptr, int n);
+    void write_batch(uint64 indices_ptr, uint64 values_ptr, int n);
+
    private:
+    void set_batch_args_external(Kernel::LaunchContextBuilder *launch_ctx,
+                                 uint64 indices_ptr,
+                                 uint64 values_ptr,
+                                 int n) const;
+
     const SNode *snode_;
     Program *prog_;
     Kernel *reader_;
     Kernel *writer_;
+    Kernel *batch_reader_;
+    Kernel *batch_writer_;
   };
 
   explicit SNodeRwAccessorsBank(Program *program) : program_(program) {
@@ -50,6 +71,9 @@ class SNodeRwAccessorsBank {
 
   Accessors get(SNode *snode);
 
+  // Same as get(), with the batched accessor kernels created as well.
+  Accessors get_batch(SNode *snode);
+
  private:
   Program *const program_;
   std::unordered_map<const SNode *, RwKernels> snode_to_kernels_;
@@ -1,5 +1,9 @@
 #include "taichi/program/sparse_matrix.h"
 
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <sstream>
 #include <string>
@@ -9,6 +13,10 @@
 #include "Eigen/Dense"
 #include "Eigen/SparseLU"
 
+#ifdef TI_WITH_LLVM
+#include "taichi/runtime/program_impls/llvm/llvm_program.h"
+#endif
+
 #define BUILD(TYPE)                                                         \
   {                                                                         \
     using T = Eigen::Triplet<float##TYPE>;                                  \
@@ -19,17 +27,14 @@
 #define MAKE_MATRIX(TYPE, STORAGE)                                             \
   {                                                                            \
     Pair("f" #TYPE, #STORAGE),                                                 \
-        [](int rows, int cols, DataType dt) -> std::unique_ptr<SparseMatrix> { \
+        [](int rows, int cols, DataType dt,                                    \
+           SparseThreadPool thread_pool) -> std::unique_ptr<SparseMatrix> {    \
           using FC = Eigen::SparseMatrix<float##TYPE, Eigen::STORAGE>;         \
-          return std::make_unique<EigenSparseMatrix<FC>>(rows, cols, dt);      \
+          return std::make_unique<EigenSparseMatrix<FC>>(                      \
+              rows, cols, dt, std::move(thread_pool));                         \
         }                                                                      \
   }
 
-#define INSTANTIATE_SPMV(type, storage)                               \
-  template void                                                       \
-  EigenSparseMatrix<Eigen::SparseMatrix<type, Eigen::storage>>::spmv( \
-      Program *prog, const Ndarray &x, const Ndarray &y);
-
 namespace {
 using Pair = std::pair<std::string, std::string>;
 struct key_hash {
@@ -63,6 +68,87 @@ void print_triplets_from_csr(int64_t n_rows,
   ostr << Eigen::MatrixXf(m.cast<float>()).format(clean_fmt);
 }
 
+// FNV-1a, fed with the dimensions and then the nonzeros in storage order.
+class PatternHasher {
+ public:
+  void add(int64_t v) {
+    hash_ = (hash_ ^ (uint64_t)v) * 1099511628211ull;
+  }
+  uint64_t get() const {
+    return hash_;
+  }
+
+ private:
+  uint64_t hash_{14695981039346656037ull};
+};
+
+// Splits the outer vectors [0, outer_size) into at most |num_blocks| ranges of
+// about the same weight, where |prefix(k)| is the weight of the outer vectors
+// before k. Returns the bounds of the ranges.
+template <typename F>
+std::vector<int> partition_outer(int outer_size, int num_blocks, F prefix) {
+  num_blocks = std::max(1, std::min(num_blocks, outer_size));
+  std::vector<int> bounds(num_blocks + 1, 0);
+  const int64_t total = prefix(outer_size);
+  for (int b = 1; b < num_blocks; b++) {
+    const int64_t target = total * b / num_blocks;
+    // The first k with prefix(k) >= target.
+    int lo = bounds[b - 1], hi = outer_size;
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (prefix(mid) < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    bounds[b] = lo;
+  }
+  bounds[num_blocks] = outer_size;
+  return bounds;
+}
+
+// Sums the (row, col, value) |triplets| into the BSR arrays of |block_size|
+// blocks. Sorts |triplets|.
+template <typename T>
+void triplets_to_bsr(int block_rows,
+                     int block_size,
+                     std::vector<std::tuple<int, int, T>> &triplets,
+                     std::vector<int> &row_ptr,
+                     std::vector<int> &col_ind,
+                     std::vector<T> &values) {
+  const int bs = block_size;
+  auto block_of = [bs](const std::tuple<int, int, T> &t) {
+    return std::make_pair(std::get<0>(t) / bs, std::get<1>(t) / bs);
+  };
+  std::sort(triplets.begin(), triplets.end(),
+            [&](const auto &a, const auto &b) {
+              return block_of(a) < block_of(b);
+            });
+  row_ptr.assign(block_rows + 1, 0);
+  col_ind.clear();
+  values.clear();
+  std::pair<int, int> last_block{-1, -1};
+  for (const auto &t : triplets) {
+    auto block = block_of(t);
+    if (block != last_block) {
+      col_ind.push_back(block.second);
+      values.resize(values.size() + bs * bs, 0);
+      row_ptr[block.first + 1]++;
+      last_block = block;
+    }
+    auto [row, col, value] = t;
+    values[values.size() - bs * bs + (row % bs) * bs + col % bs] += value;
+  }
+  for (int i = 0; i < block_rows; i++) {
+    row_ptr[i + 1] += row_ptr[i];
+  }
+}
+
+// More blocks than threads, so that the blocks with costly outer vectors do not
+// hold up the others.
+constexpr int kSparseBlocksPerThread = 4;
+
 template <typename T, typename T1, typename T2>
 T2 get_element_from_csr(int row,
                         int col,
@@ -86,17 +172,34 @@ SparseMatrixBuilder::SparseMatrixBuilder(int rows,
                                          int max_num_triplets,
                                          DataType dtype,
                                          const std::string &storage_format,
-                                         Program *prog)
+                                         Program *prog,
+                                         bool reuse_pattern,
+                                         bool parallel,
+                                         int block_size)
     : rows_(rows),
       cols_(cols),
       max_num_triplets_(max_num_triplets),
       dtype_(dtype),
       storage_format_(storage_format),
-      prog_(prog) {
+      prog_(prog),
+      reuse_pattern_(reuse_pattern),
+      parallel_(parallel),
+      block_size_(block_size) {
+  TI_ERROR_IF(block_size_ < 1, "Invalid block size {}.", block_size_);
+  TI_ERROR_IF(block_size_ > 1 && reuse_pattern_,
+              "BSR matrices can not reuse the sparsity pattern.");
   auto element_size = data_type_size(dtype);
   TI_ASSERT((element_size == 4 || element_size == 8));
-  ndarray_data_base_ptr_ = std::make_unique<Ndarray>(
-      prog_, dtype_, std::vector<int>{3 * (int)max_num_triplets_ + 1});
+  // cuSPARSE matrices are always stored in CSR.
+  pattern_by_col_ = storage_format_ == "col_major" &&
+                    !arch_is_cuda(prog_->this_thread_config().arch);
+  num_outer_ = pattern_by_col_ ? cols_ : rows_;
+  auto size = pattern_outer_offset();
+  if (reuse_pattern_) {
+    size = pattern_values_offset() + max_num_triplets_;
+  }
+  ndarray_data_base_ptr_ =
+      std::make_unique<Ndarray>(prog_, dtype_, std::vector<int>{(int)size});
 }
 
 template <typename T, typename G>
@@ -106,7 +209,7 @@ void SparseMatrixBuilder::print_triplets_template() {
   num_triplets_ = data[0];
   fmt::print("n={}, m={}, num_triplets={} (max={})\n", rows_, cols_,
              num_triplets_, max_num_triplets_);
-  data += 1;
+  data += kHeaderSize;
   for (int i = 0; i < num_triplets_; i++) {
     fmt::print("[{}, {}] = {}\n", data[i * 3], data[i * 3 + 1],
                taichi_union_cast<T>(data[i * 3 + 2]));
@@ -134,15 +237,15 @@ void SparseMatrixBuilder::print_triplets_cuda() {
       &num_triplets_, (void *)get_ndarray_data_ptr(), sizeof(int));
   fmt::print("n={}, m={}, num_triplets={} (max={})\n", rows_, cols_,
              num_triplets_, max_num_triplets_);
-  auto len = 3 * num_triplets_ + 1;
+  auto len = 3 * num_triplets_ + kHeaderSize;
   std::vector<float32> trips(len);
   CUDADriver::get_instance().memcpy_device_to_host(
       (void *)trips.data(), (void *)get_ndarray_data_ptr(),
       len * sizeof(float32));
   for (auto i = 0; i < num_triplets_; i++) {
-    int row = taichi_union_cast<int>(trips[3 * i + 1]);
-    int col = taichi_union_cast<int>(trips[3 * i + 2]);
-    auto val = trips[i * 3 + 3];
+    int row = taichi_union_cast<int>(trips[3 * i + kHeaderSize]);
+    int col = taichi_union_cast<int>(trips[3 * i + kHeaderSize + 1]);
+    auto val = trips[3 * i + kHeaderSize + 2];
     fmt::print("[{}, {}] = {}\n", row, col, val);
   }
 #endif
@@ -152,6 +255,138 @@ intptr_t SparseMatrixBuilder::get_ndarray_data_ptr() const {
   return prog_->get_ndarray_data_ptr_as_int(ndarray_data_base_ptr_.get());
 }
 
+void SparseMatrixBuilder::copy_from_ndarray(void *dst,
+                                            std::size_t offset,
+                                            std::size_t num) const {
+  auto element_size = data_type_size(dtype_);
+  auto src = reinterpret_cast<char *>(get_ndarray_data_ptr()) +
+             offset * element_size;
+  if (arch_is_cuda(prog_->this_thread_config().arch)) {
+#ifdef TI_WITH_CUDA
+    CUDADriver::get_instance().memcpy_device_to_host(dst, src,
+                                                     num * element_size);
+#endif
+  } else {
+    std::memcpy(dst, src, num * element_size);
+  }
+}
+
+void SparseMatrixBuilder::copy_to_ndarray(const void *src,
+                                          std::size_t offset,
+                                          std::size_t num) {
+  auto element_size = data_type_size(dtype_);
+  auto dst = reinterpret_cast<char *>(get_ndarray_data_ptr()) +
+             offset * element_size;
+  if (arch_is_cuda(prog_->this_thread_config().arch)) {
+#ifdef TI_WITH_CUDA
+    CUDADriver::get_instance().memcpy_host_to_device(dst, (void *)src,
+                                                     num * element_size);
+#endif
+  } else {
+    std::memcpy(dst, src, num * element_size);
+  }
+}
+
+template <typename T, typename G>
+void SparseMatrixBuilder::update_pattern_template() {
+  G header[kHeaderSize];
+  copy_from_ndarray(header, 0, kHeaderSize);
+  num_triplets_ = header[0];
+  bool has_pattern = !pattern_outer_.empty();
+  if (has_pattern && num_triplets_ == 0) {
+    // All the entries have been accumulated in place.
+    return;
+  }
+  // (outer, inner, value) of the old pattern and of the new triplets.
+  std::vector<std::tuple<G, G, T>> entries;
+  if (has_pattern) {
+    std::vector<T> values(pattern_inner_.size());
+    copy_from_ndarray(values.data(), pattern_values_offset(), values.size());
+    for (int outer = 0; outer < num_outer_; outer++) {
+      for (int k = pattern_outer_[outer]; k < pattern_outer_[outer + 1]; k++) {
+        entries.emplace_back(outer, pattern_inner_[k], values[k]);
+      }
+    }
+  }
+  std::vector<G> triplets(3 * num_triplets_);
+  copy_from_ndarray(triplets.data(), kHeaderSize, triplets.size());
+  for (int i = 0; i < num_triplets_; i++) {
+    G row = triplets[3 * i];
+    G col = triplets[3 * i + 1];
+    entries.emplace_back(pattern_by_col_ ? col : row,
+                         pattern_by_col_ ? row : col,
+                         taichi_union_cast<T>(triplets[3 * i + 2]));
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const auto &a, const auto &b) {
+              return std::tie(std::get<0>(a), std::get<1>(a)) <
+                     std::tie(std::get<0>(b), std::get<1>(b));
+            });
+
+  std::vector<G> outer_index(num_outer_ + 1, 0);
+  std::vector<G> inner_index;
+  std::vector<T> values;
+  for (std::size_t k = 0; k < entries.size(); k++) {
+    auto [outer, inner, value] = entries[k];
+    if (k > 0 && std::get<0>(entries[k - 1]) == outer &&
+        std::get<1>(entries[k - 1]) == inner) {
+      values.back() += value;
+      continue;
+    }
+    outer_index[outer + 1]++;
+    inner_index.push_back(inner);
+    values.push_back(value);
+  }
+  TI_ERROR_IF(inner_index.size() > max_num_triplets_,
+              "The sparsity pattern has {} entries, more than "
+              "max_num_triplets={}.",
+              inner_index.size(), max_num_triplets_);
+  for (int outer = 0; outer < num_outer_; outer++) {
+    outer_index[outer + 1] += outer_index[outer];
+  }
+  copy_to_ndarray(outer_index.data(), pattern_outer_offset(),
+                  outer_index.size());
+  copy_to_ndarray(inner_index.data(), pattern_inner_offset(),
+                  inner_index.size());
+  copy_to_ndarray(values.data(), pattern_values_offset(), values.size());
+  // Publish the pattern to the kernels.
+  G new_header[kHeaderSize] = {0, (G)pattern_outer_offset(),
+                               (G)pattern_inner_offset(),
+                               (G)pattern_values_offset(), pattern_by_col_};
+  copy_to_ndarray(new_header, 0, kHeaderSize);
+  pattern_outer_.assign(outer_index.begin(), outer_index.end());
+  pattern_inner_.assign(inner_index.begin(), inner_index.end());
+}
+
+void SparseMatrixBuilder::build_from_pattern(std::unique_ptr<SparseMatrix> &m) {
+  auto element_size = data_type_size(dtype_);
+  switch (element_size) {
+    case 4:
+      update_pattern_template<float32, int32>();
+      break;
+    case 8:
+      update_pattern_template<float64, int64>();
+      break;
+    default:
+      TI_ERROR("Unsupported sparse matrix data type!");
+      break;
+  }
+  auto data = reinterpret_cast<char *>(get_ndarray_data_ptr());
+  auto values = data + pattern_values_offset() * element_size;
+  if (arch_is_cuda(prog_->this_thread_config().arch)) {
+    TI_ERROR_IF(element_size != 4,
+                "Sparse matrices on CUDA only support f32 for now.");
+    // The indices are already 32-bit in the device copy of the pattern.
+    m->build_compressed(pattern_inner_.size(),
+                        data + pattern_outer_offset() * element_size,
+                        data + pattern_inner_offset() * element_size, values);
+  } else {
+    m->build_compressed(pattern_inner_.size(), pattern_outer_.data(),
+                        pattern_inner_.data(), values);
+  }
+  clear();
+}
+
 template <typename T, typename G>
 void SparseMatrixBuilder::build_template(std::unique_ptr<SparseMatrix> &m) {
   using V = Eigen::Triplet<T>;
@@ -159,7 +394,7 @@ void SparseMatrixBuilder::build_template(std::unique_ptr<SparseMatrix> &m) {
   auto ptr = get_ndarray_data_ptr();
   G *data = reinterpret_cast<G *>(ptr);
   num_triplets_ = data[0];
-  data += 1;
+  data += kHeaderSize;
   for (int i = 0; i < num_triplets_; i++) {
     triplets.push_back(
         V(data[i * 3], data[i * 3 + 1], taichi_union_cast<T>(data[i * 3 + 2])));
@@ -168,10 +403,71 @@ void SparseMatrixBuilder::build_template(std::unique_ptr<SparseMatrix> &m) {
   clear();
 }
 
+template <typename T, typename G>
+std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build_bsr_template() {
+  TI_ERROR_IF(rows_ % block_size_ != 0 || cols_ % block_size_ != 0,
+              "The shape ({}, {}) of a BSR matrix must be a multiple of its "
+              "block size {}.",
+              rows_, cols_, block_size_);
+  G num_triplets = 0;
+  copy_from_ndarray(&num_triplets, 0, 1);
+  num_triplets_ = num_triplets;
+  std::vector<G> data(3 * num_triplets_);
+  copy_from_ndarray(data.data(), kHeaderSize, data.size());
+  std::vector<std::tuple<int, int, T>> triplets;
+  triplets.reserve(num_triplets_);
+  for (int i = 0; i < num_triplets_; i++) {
+    triplets.emplace_back(data[i * 3], data[i * 3 + 1],
+                          taichi_union_cast<T>(data[i * 3 + 2]));
+  }
+  std::vector<int> row_ptr, col_ind;
+  std::vector<T> values;
+  triplets_to_bsr(rows_ / block_size_, block_size_, triplets, row_ptr, col_ind,
+                  values);
+
+  std::unique_ptr<SparseMatrix> sm;
+  if (arch_is_cuda(prog_->this_thread_config().arch)) {
+    if constexpr (std::is_same_v<T, float32>) {
+      sm = make_cu_bsr_sparse_matrix(rows_, cols_, block_size_, dtype_);
+      static_cast<CuBsrSparseMatrix &>(*sm).build_bsr(
+          col_ind.size(), row_ptr.data(), col_ind.data(), values.data());
+    } else {
+      TI_ERROR("BSR matrices only support f32 on CUDA.");
+    }
+  } else {
+    sm = make_bsr_sparse_matrix(rows_, cols_, block_size_, dtype_);
+    static_cast<BsrSparseMatrix<T> &>(*sm).build_bsr(
+        col_ind.size(), row_ptr.data(), col_ind.data(), values.data());
+  }
+  clear();
+  return sm;
+}
+
+std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build_bsr() {
+  auto element_size = data_type_size(dtype_);
+  switch (element_size) {
+    case 4:
+      return build_bsr_template<float32, int32>();
+    case 8:
+      return build_bsr_template<float64, int64>();
+    default:
+      TI_ERROR("Unsupported sparse matrix data type!");
+  }
+}
+
 std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build() {
   TI_ASSERT(built_ == false);
   built_ = true;
-  auto sm = make_sparse_matrix(rows_, cols_, dtype_, storage_format_);
+  if (block_size_ > 1) {
+    return build_bsr();
+  }
+  auto sm = make_sparse_matrix(
+      rows_, cols_, dtype_, storage_format_,
+      parallel_ ? make_sparse_thread_pool(prog_) : SparseThreadPool{});
+  if (reuse_pattern_) {
+    build_from_pattern(sm);
+    return sm;
+  }
   auto element_size = data_type_size(dtype_);
   switch (element_size) {
     case 4:
@@ -190,20 +486,27 @@ std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build() {
 std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build_cuda() {
   TI_ASSERT(built_ == false);
   built_ = true;
+  if (block_size_ > 1) {
+    return build_bsr();
+  }
   auto sm = make_cu_sparse_matrix(rows_, cols_, dtype_);
+  if (reuse_pattern_) {
+    build_from_pattern(sm);
+    return sm;
+  }
 #ifdef TI_WITH_CUDA
   CUDADriver::get_instance().memcpy_device_to_host(
       &num_triplets_, (void *)get_ndarray_data_ptr(), sizeof(int));
-  auto len = 3 * num_triplets_ + 1;
+  auto len = 3 * num_triplets_ + kHeaderSize;
   std::vector<float32> trips(len);
   CUDADriver::get_instance().memcpy_device_to_host(
       (void *)trips.data(), (void *)get_ndarray_data_ptr(),
       len * sizeof(float32));
   std::unordered_map<int, std::tuple<int, int, float32>> entries;
   for (auto i = 0; i < num_triplets_; i++) {
-    int row = taichi_union_cast<int>(trips[3 * i + 1]);
-    int col = taichi_union_cast<int>(trips[3 * i + 2]);
-    auto val = trips[i * 3 + 3];
+    int row = taichi_union_cast<int>(trips[3 * i + kHeaderSize]);
+    int col = taichi_union_cast<int>(trips[3 * i + kHeaderSize + 1]);
+    auto val = trips[3 * i + kHeaderSize + 2];
     auto e_idx = row * cols_ + col;
     if (entries.find(e_idx) == entries.end()) {
       entries[e_idx] = std::make_tuple(row, col, val);
@@ -248,6 +551,19 @@ void SparseMatrixBuilder::clear() {
   built_ = false;
   ndarray_data_base_ptr_->write_int(std::vector<int>{0}, 0);
   num_triplets_ = 0;
+  if (!pattern_inner_.empty()) {
+    // The next assembly accumulates into the pattern from zero.
+    auto element_size = data_type_size(dtype_);
+    auto values = reinterpret_cast<char *>(get_ndarray_data_ptr()) +
+                  pattern_values_offset() * element_size;
+    if (arch_is_cuda(prog_->this_thread_config().arch)) {
+#ifdef TI_WITH_CUDA
+      CUDADriver::get_instance().memsetd32(values, 0, pattern_inner_.size());
+#endif
+    } else {
+      std::memset(values, 0, pattern_inner_.size() * element_size);
+    }
+  }
 }
 
 template <class EigenMatrix>
@@ -272,6 +588,35 @@ void EigenSparseMatrix<EigenMatrix>::build_triplets(void *triplets_adr) {
   }
 }
 
+template <class EigenMatrix>
+void EigenSparseMatrix<EigenMatrix>::build_compressed(int nnz,
+                                                      const void *outer_index,
+                                                      const void *inner_index,
+                                                      const void *values) {
+  using Scalar = typename EigenMatrix::Scalar;
+  using StorageIndex = typename EigenMatrix::StorageIndex;
+  matrix_ = Eigen::Map<const EigenMatrix>(
+      rows_, cols_, nnz, static_cast<const StorageIndex *>(outer_index),
+      static_cast<const StorageIndex *>(inner_index),
+      static_cast<const Scalar *>(values));
+}
+
+template <class EigenMatrix>
+uint64 EigenSparseMatrix<EigenMatrix>::pattern_fingerprint() const {
+  PatternHasher hasher;
+  hasher.add(rows_);
+  hasher.add(cols_);
+  hasher.add(matrix_.nonZeros());
+  for (int k = 0; k < matrix_.outerSize(); ++k) {
+    for (typename EigenMatrix::InnerIterator it(matrix_, k); it; ++it) {
+      hasher.add(it.index());
+    }
+    // Separates the inner vectors.
+    hasher.add(-1);
+  }
+  return hasher.get();
+}
+
 template <class EigenMatrix>
 void EigenSparseMatrix<EigenMatrix>::spmv(Program *prog,
                                           const Ndarray &x,
@@ -279,6 +624,16 @@ void EigenSparseMatrix<EigenMatrix>::spmv(Program *prog,
   size_t dX = prog->get_ndarray_data_ptr_as_int(&x);
   size_t dY = prog->get_ndarray_data_ptr_as_int(&y);
   std::string sdtype = taichi::lang::data_type_name(dtype_);
+  if (thread_pool_ && matrix_.isCompressed()) {
+    if (sdtype == "f32") {
+      parallel_spmv((const float32 *)dX, (float32 *)dY);
+    } else if (sdtype == "f64") {
+      parallel_spmv((const float64 *)dX, (float64 *)dY);
+    } else {
+      TI_ERROR("Unsupported sparse matrix data type {}!", sdtype);
+    }
+    return;
+  }
   if (sdtype == "f32") {
     Eigen::Map<Eigen::VectorXf>((float *)dY, cols_) =
         matrix_.template cast<float>() *
@@ -292,17 +647,247 @@ void EigenSparseMatrix<EigenMatrix>::spmv(Program *prog,
   }
 }
 
-INSTANTIATE_SPMV(float32, ColMajor)
-INSTANTIATE_SPMV(float32, RowMajor)
-INSTANTIATE_SPMV(float64, ColMajor)
-INSTANTIATE_SPMV(float64, RowMajor)
+template <class EigenMatrix>
+template <typename T>
+void EigenSparseMatrix<EigenMatrix>::parallel_spmv(const T *x, T *y) const {
+  const int outer_size = matrix_.outerSize();
+  const auto *outer = matrix_.outerIndexPtr();
+  const auto *inner = matrix_.innerIndexPtr();
+  const auto *values = matrix_.valuePtr();
+  auto bounds = partition_outer(
+      outer_size, thread_pool_.num_threads * kSparseBlocksPerThread,
+      [&](int k) { return (int64_t)outer[k] + k; });
+  const int num_blocks = bounds.size() - 1;
+  if (EigenMatrix::IsRowMajor) {
+    thread_pool_.parallel_for(num_blocks, [&](int, int b) {
+      for (int r = bounds[b]; r < bounds[b + 1]; r++) {
+        T sum = 0;
+        for (auto k = outer[r]; k < outer[r + 1]; k++) {
+          sum += static_cast<T>(values[k]) * x[inner[k]];
+        }
+        y[r] = sum;
+      }
+    });
+    return;
+  }
+  // A column scatters into all of y, so each thread accumulates into a vector
+  // of its own, which are summed up afterwards.
+  std::vector<std::vector<T>> partial(thread_pool_.num_threads);
+  thread_pool_.parallel_for(num_blocks, [&](int thread_id, int b) {
+    auto &acc = partial[thread_id];
+    if (acc.empty()) {
+      acc.assign(rows_, 0);
+    }
+    for (int c = bounds[b]; c < bounds[b + 1]; c++) {
+      const T xc = x[c];
+      for (auto k = outer[c]; k < outer[c + 1]; k++) {
+        acc[inner[k]] += static_cast<T>(values[k]) * xc;
+      }
+    }
+  });
+  auto row_bounds = partition_outer(
+      rows_, thread_pool_.num_threads * kSparseBlocksPerThread,
+      [](int k) { return (int64_t)k; });
+  thread_pool_.parallel_for(row_bounds.size() - 1, [&](int, int b) {
+    for (int r = row_bounds[b]; r < row_bounds[b + 1]; r++) {
+      T sum = 0;
+      for (auto &acc : partial) {
+        if (!acc.empty()) {
+          sum += acc[r];
+        }
+      }
+      y[r] = sum;
+    }
+  });
+}
+
+template <class EigenMatrix>
+EigenMatrix EigenSparseMatrix<EigenMatrix>::parallel_add(
+    const EigenSparseMatrix &other,
+    Scalar sign) const {
+  TI_ASSERT(rows_ == other.rows_ && cols_ == other.cols_);
+  const auto &a = matrix_;
+  const auto &b = other.matrix_;
+  const int outer_size = a.outerSize();
+  auto bounds = partition_outer(
+      outer_size, thread_pool_.num_threads * kSparseBlocksPerThread,
+      [&](int k) {
+        return (int64_t)a.outerIndexPtr()[k] + b.outerIndexPtr()[k] + k;
+      });
+  const int num_blocks = bounds.size() - 1;
+
+  // Merges the sorted outer vectors k of |a| and |b|. With |out_inner| null,
+  // only counts the entries of the result.
+  auto merge = [&](int k, int *out_inner, Scalar *out_values) {
+    auto i = a.outerIndexPtr()[k], i_end = a.outerIndexPtr()[k + 1];
+    auto j = b.outerIndexPtr()[k], j_end = b.outerIndexPtr()[k + 1];
+    int n = 0;
+    while (i < i_end || j < j_end) {
+      int index;
+      Scalar value;
+      if (j == j_end ||
+          (i < i_end && a.innerIndexPtr()[i] < b.innerIndexPtr()[j])) {
+        index = a.innerIndexPtr()[i];
+        value = a.valuePtr()[i++];
+      } else if (i == i_end || b.innerIndexPtr()[j] < a.innerIndexPtr()[i]) {
+        index = b.innerIndexPtr()[j];
+        value = sign * b.valuePtr()[j++];
+      } else {
+        index = a.innerIndexPtr()[i];
+        value = a.valuePtr()[i++] + sign * b.valuePtr()[j++];
+      }
+      if (out_inner) {
+        out_inner[n] = index;
+        out_values[n] = value;
+      }
+      n++;
+    }
+    return n;
+  };
+
+  EigenMatrix result(rows_, cols_);
+  auto *result_outer = result.outerIndexPtr();
+  thread_pool_.parallel_for(num_blocks, [&](int, int block) {
+    for (int k = bounds[block]; k < bounds[block + 1]; k++) {
+      result_outer[k + 1] = merge(k, nullptr, nullptr);
+    }
+  });
+  result_outer[0] = 0;
+  for (int k = 0; k < outer_size; k++) {
+    result_outer[k + 1] += result_outer[k];
+  }
+  result.resizeNonZeros(result_outer[outer_size]);
+  thread_pool_.parallel_for(num_blocks, [&](int, int block) {
+    for (int k = bounds[block]; k < bounds[block + 1]; k++) {
+      merge(k, result.innerIndexPtr() + result_outer[k],
+            result.valuePtr() + result_outer[k]);
+    }
+  });
+  return result;
+}
+
+template <class EigenMatrix>
+EigenMatrix EigenSparseMatrix<EigenMatrix>::parallel_matmul(
+    const EigenSparseMatrix &other) const {
+  TI_ASSERT(cols_ == other.rows_);
+  // An outer vector of the result combines the outer vectors of |q| picked by
+  // the same outer vector of |p|: rows of B by a row of A for row-major
+  // matrices, columns of A by a column of B for column-major ones.
+  const auto &p = EigenMatrix::IsRowMajor ? matrix_ : other.matrix_;
+  const auto &q = EigenMatrix::IsRowMajor ? other.matrix_ : matrix_;
+  const int outer_size = p.outerSize();
+  const int inner_size = q.innerSize();
+  const auto *p_outer = p.outerIndexPtr();
+  const auto *q_outer = q.outerIndexPtr();
+  auto bounds = partition_outer(
+      outer_size, thread_pool_.num_threads * kSparseBlocksPerThread,
+      [&](int k) { return (int64_t)p_outer[k] + k; });
+  const int num_blocks = bounds.size() - 1;
+
+  // Per-thread markers of the last outer vector that touched an inner index,
+  // and the dense accumulators of the numeric pass.
+  std::vector<std::vector<int>> markers(thread_pool_.num_threads);
+  std::vector<std::vector<Scalar>> accumulators(thread_pool_.num_threads);
+  auto get_marker = [&](int thread_id) -> std::vector<int> & {
+    auto &marker = markers[thread_id];
+    if (marker.empty()) {
+      marker.assign(inner_size, -1);
+    }
+    return marker;
+  };
+
+  EigenMatrix result(rows_, other.cols_);
+  auto *result_outer = result.outerIndexPtr();
+  thread_pool_.parallel_for(num_blocks, [&](int thread_id, int block) {
+    auto &marker = get_marker(thread_id);
+    for (int k = bounds[block]; k < bounds[block + 1]; k++) {
+      int n = 0;
+      for (auto i = p_outer[k]; i < p_outer[k + 1]; i++) {
+        auto m = p.innerIndexPtr()[i];
+        for (auto j = q_outer[m]; j < q_outer[m + 1]; j++) {
+          auto index = q.innerIndexPtr()[j];
+          if (marker[index] != k) {
+            marker[index] = k;
+            n++;
+          }
+        }
+      }
+      result_outer[k + 1] = n;
+    }
+  });
+  result_outer[0] = 0;
+  for (int k = 0; k < outer_size; k++) {
+    result_outer[k + 1] += result_outer[k];
+  }
+  result.resizeNonZeros(result_outer[outer_size]);
+
+  for (auto &marker : markers) {
+    std::fill(marker.begin(), marker.end(), -1);
+  }
+  thread_pool_.parallel_for(num_blocks, [&](int thread_id, int block) {
+    auto &marker = get_marker(thread_id);
+    auto &acc = accumulators[thread_id];
+    if (acc.empty()) {
+      acc.assign(inner_size, 0);
+    }
+    for (int k = bounds[block]; k < bounds[block + 1]; k++) {
+      auto *out_inner = result.innerIndexPtr() + result_outer[k];
+      auto *out_values = result.valuePtr() + result_outer[k];
+      int n = 0;
+      for (auto i = p_outer[k]; i < p_outer[k + 1]; i++) {
+        auto m = p.innerIndexPtr()[i];
+        auto v = p.valuePtr()[i];
+        for (auto j = q_outer[m]; j < q_outer[m + 1]; j++) {
+          auto index = q.innerIndexPtr()[j];
+          if (marker[index] != k) {
+            marker[index] = k;
+            acc[index] = v * q.valuePtr()[j];
+            out_inner[n++] = index;
+          } else {
+            acc[index] += v * q.valuePtr()[j];
+          }
+        }
+      }
+      std::sort(out_inner, out_inner + n);
+      for (int t = 0; t < n; t++) {
+        out_values[t] = acc[out_inner[t]];
+      }
+    }
+  });
+  return result;
+}
+
+template class EigenSparseMatrix<Eigen::SparseMatrix<float32, Eigen::ColMajor>>;
+template class EigenSparseMatrix<Eigen::SparseMatrix<float32, Eigen::RowMajor>>;
+template class EigenSparseMatrix<Eigen::SparseMatrix<float64, Eigen::ColMajor>>;
+template class EigenSparseMatrix<Eigen::SparseMatrix<float64, Eigen::RowMajor>>;
+
+SparseThreadPool make_sparse_thread_pool(Program *prog) {
+  TI_ERROR_IF(!arch_is_cpu(prog->this_thread_config().arch),
+              "Parallel sparse matrices are only supported on CPU backends.");
+#ifdef TI_WITH_LLVM
+  auto *executor = get_llvm_program(prog)->get_runtime_executor();
+  SparseThreadPool thread_pool;
+  thread_pool.num_threads = prog->this_thread_config().cpu_max_num_threads;
+  thread_pool.parallel_for = [executor](
+                                 int n,
+                                 const std::function<void(int, int)> &task) {
+    executor->cpu_parallel_for(n, task);
+  };
+  return thread_pool;
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
 
 std::unique_ptr<SparseMatrix> make_sparse_matrix(
     int rows,
     int cols,
     DataType dt,
-    const std::string &storage_format = "col_major") {
-  using func_type = std::unique_ptr<SparseMatrix> (*)(int, int, DataType);
+    const std::string &storage_format,
+    SparseThreadPool thread_pool) {
+  using func_type = std::unique_ptr<SparseMatrix> (*)(int, int, DataType,
+                                                      SparseThreadPool);
   static const std::unordered_map<Pair, func_type, key_hash> map = {
       MAKE_MATRIX(32, ColMajor), MAKE_MATRIX(32, RowMajor),
       MAKE_MATRIX(64, ColMajor), MAKE_MATRIX(64, RowMajor)};
@@ -313,7 +898,7 @@ std::unique_ptr<SparseMatrix> make_sparse_matrix(
   auto it = map.find(key);
   if (it != map.end()) {
     auto func = map.at(key);
-    return func(rows, cols, dt);
+    return func(rows, cols, dt, std::move(thread_pool));
   } else
     TI_ERROR("Unsupported sparse matrix data type: {}, storage format: {}", tdt,
              storage_format);
@@ -435,6 +1020,59 @@ void CuSparseMatrix::build_csr_from_coo(void *coo_row_ptr,
 #endif
 }
 
+void CuSparseMatrix::build_compressed(int nnz,
+                                      const void *outer_index,
+                                      const void *inner_index,
+                                      const void *values) {
+#if defined(TI_WITH_CUDA)
+  // cuMemAlloc rejects empty allocations.
+  auto size = std::max(nnz, 1);
+  CUDADriver::get_instance().malloc(&csr_row_ptr_, sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().malloc(&csr_col_ind_, sizeof(int) * size);
+  CUDADriver::get_instance().malloc(&csr_val_, sizeof(float32) * size);
+  CUDADriver::get_instance().memcpy_device_to_device(
+      csr_row_ptr_, (void *)outer_index, sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().memcpy_device_to_device(
+      csr_col_ind_, (void *)inner_index, sizeof(int) * nnz);
+  CUDADriver::get_instance().memcpy_device_to_device(
+      csr_val_, (void *)values, sizeof(float32) * nnz);
+  CUSPARSEDriver::get_instance().cpCreateCsr(
+      &matrix_, rows_, cols_, nnz, csr_row_ptr_, csr_col_ind_, csr_val_,
+      CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_BASE_ZERO,
+      CUDA_R_32F);
+  nnz_ = nnz;
+#endif
+}
+
+uint64 CuSparseMatrix::pattern_fingerprint() const {
+  PatternHasher hasher;
+  hasher.add(rows_);
+  hasher.add(cols_);
+#if defined(TI_WITH_CUDA)
+  size_t rows, cols, nnz;
+  void *d_row, *d_col, *d_val;
+  cusparseIndexType_t row_type, column_type;
+  cusparseIndexBase_t idx_base;
+  cudaDataType value_type;
+  CUSPARSEDriver::get_instance().cpCsrGet(matrix_, &rows, &cols, &nnz, &d_row,
+                                          &d_col, &d_val, &row_type,
+                                          &column_type, &idx_base, &value_type);
+  hasher.add(nnz);
+  std::vector<int> row(rows + 1), col(nnz);
+  CUDADriver::get_instance().memcpy_device_to_host(row.data(), d_row,
+                                                   sizeof(int) * (rows + 1));
+  CUDADriver::get_instance().memcpy_device_to_host(col.data(), d_col,
+                                                   sizeof(int) * nnz);
+  for (auto r : row) {
+    hasher.add(r);
+  }
+  for (auto c : col) {
+    hasher.add(c);
+  }
+#endif
+  return hasher.get();
+}
+
 CuSparseMatrix::~CuSparseMatrix() {
 #if defined(TI_WITH_CUDA)
   if (matrix_)
@@ -445,6 +1083,10 @@ CuSparseMatrix::~CuSparseMatrix() {
     CUDADriver::get_instance().mem_free(csr_col_ind_);
   if (csr_val_)
     CUDADriver::get_instance().mem_free(csr_val_);
+  if (spmv_handle_)
+    CUSPARSEDriver::get_instance().cpDestroy(spmv_handle_);
+  if (spmv_buffer_)
+    CUDADriver::get_instance().mem_free(spmv_buffer_);
 #endif
 }
 
@@ -744,25 +1386,26 @@ void CuSparseMatrix::spmv(Program *prog, const Ndarray &x, const Ndarray &y) {
   CUSPARSEDriver::get_instance().cpCreateDnVec(&vecY, rows_, (void *)dY,
                                                CUDA_R_32F);
 
-  cusparseHandle_t cusparse_handle;
-  CUSPARSEDriver::get_instance().cpCreate(&cusparse_handle);
+  if (!spmv_handle_)
+    CUSPARSEDriver::get_instance().cpCreate(&spmv_handle_);
   float alpha = 1.0f, beta = 0.0f;
   size_t bufferSize = 0;
   CUSPARSEDriver::get_instance().cpSpMV_bufferSize(
-      cusparse_handle, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matrix_, vecX,
+      spmv_handle_, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matrix_, vecX,
       &beta, vecY, CUDA_R_32F, CUSPARSE_SPMV_CSR_ALG1, &bufferSize);
 
-  void *dBuffer = nullptr;
-  if (bufferSize > 0)
-    CUDADriver::get_instance().malloc(&dBuffer, bufferSize);
+  if (bufferSize > spmv_buffer_size_) {
+    if (spmv_buffer_)
+      CUDADriver::get_instance().mem_free(spmv_buffer_);
+    CUDADriver::get_instance().malloc(&spmv_buffer_, bufferSize);
+    spmv_buffer_size_ = bufferSize;
+  }
   CUSPARSEDriver::get_instance().cpSpMV(
-      cusparse_handle, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matrix_, vecX,
-      &beta, vecY, CUDA_R_32F, CUSPARSE_SPMV_CSR_ALG1, dBuffer);
+      spmv_handle_, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matrix_, vecX,
+      &beta, vecY, CUDA_R_32F, CUSPARSE_SPMV_CSR_ALG1, spmv_buffer_);
 
   CUSPARSEDriver::get_instance().cpDestroyDnVec(vecX);
   CUSPARSEDriver::get_instance().cpDestroyDnVec(vecY);
-  CUSPARSEDriver::get_instance().cpDestroy(cusparse_handle);
-  CUDADriver::get_instance().mem_free(dBuffer);
 #endif
 }
 
@@ -834,4 +1477,329 @@ float CuSparseMatrix::get_element(int row, int col) const {
   return res;
 }
 
+template <typename T>
+void BsrSparseMatrix<T>::build_bsr(int nnzb,
+                                   const int *row_ptr,
+                                   const int *col_ind,
+                                   const T *values) {
+  const int block_rows = rows_ / block_size_;
+  row_ptr_.assign(row_ptr, row_ptr + block_rows + 1);
+  col_ind_.assign(col_ind, col_ind + nnzb);
+  values_.assign(values, values + nnzb * block_size_ * block_size_);
+}
+
+template <typename T>
+uint64 BsrSparseMatrix<T>::pattern_fingerprint() const {
+  PatternHasher hasher;
+  hasher.add(rows_);
+  hasher.add(cols_);
+  hasher.add(block_size_);
+  for (auto i : row_ptr_) {
+    hasher.add(i);
+  }
+  for (auto i : col_ind_) {
+    hasher.add(i);
+  }
+  return hasher.get();
+}
+
+template <typename T>
+T BsrSparseMatrix<T>::get_element(int row, int col) const {
+  TI_ASSERT(row < rows_ && col < cols_);
+  const int bs = block_size_;
+  for (int k = row_ptr_[row / bs]; k < row_ptr_[row / bs + 1]; k++) {
+    if (col_ind_[k] == col / bs) {
+      return values_[k * bs * bs + (row % bs) * bs + col % bs];
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+const std::string BsrSparseMatrix<T>::to_string() const {
+  Eigen::MatrixXf dense(rows_, cols_);
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < cols_; j++) {
+      dense(i, j) = get_element(i, j);
+    }
+  }
+  Eigen::IOFormat clean_fmt(4, 0, ", ", "\n", "[", "]");
+  std::ostringstream ostr;
+  ostr << dense.format(clean_fmt);
+  return ostr.str();
+}
+
+template <typename T>
+template <int B>
+void BsrSparseMatrix<T>::spmv_blocked(const T *x, T *y) const {
+  constexpr int N = B > 0 ? B : Eigen::Dynamic;
+  using Block = Eigen::Matrix<T, N, N, Eigen::RowMajor>;
+  using Vector = Eigen::Matrix<T, N, 1>;
+  const int bs = B > 0 ? B : block_size_;
+  const int block_rows = rows_ / bs;
+  Vector acc(bs);
+  for (int i = 0; i < block_rows; i++) {
+    acc.setZero();
+    for (int k = row_ptr_[i]; k < row_ptr_[i + 1]; k++) {
+      acc.noalias() +=
+          Eigen::Map<const Block>(values_.data() + k * bs * bs, bs, bs) *
+          Eigen::Map<const Vector>(x + col_ind_[k] * bs, bs);
+    }
+    Eigen::Map<Vector>(y + i * bs, bs) = acc;
+  }
+}
+
+template <typename T>
+void BsrSparseMatrix<T>::spmv(Program *prog,
+                              const Ndarray &x,
+                              const Ndarray &y) {
+  TI_ERROR_IF(x.get_element_data_type() != dtype_ ||
+                  y.get_element_data_type() != dtype_,
+              "The vectors must have the data type {} of the matrix.",
+              data_type_name(dtype_));
+  auto *dx = (const T *)prog->get_ndarray_data_ptr_as_int(&x);
+  auto *dy = (T *)prog->get_ndarray_data_ptr_as_int(&y);
+  // The common block sizes get unrolled kernels.
+  switch (block_size_) {
+    case 2:
+      spmv_blocked<2>(dx, dy);
+      break;
+    case 3:
+      spmv_blocked<3>(dx, dy);
+      break;
+    case 4:
+      spmv_blocked<4>(dx, dy);
+      break;
+    default:
+      spmv_blocked<0>(dx, dy);
+  }
+}
+
+template <typename T>
+void BsrSparseMatrix<T>::solve_triangular(Program *prog,
+                                          const Ndarray &b,
+                                          const Ndarray &x,
+                                          bool lower) {
+  TI_ERROR_IF(rows_ != cols_, "Triangular solves need a square matrix.");
+  TI_ERROR_IF(b.get_element_data_type() != dtype_ ||
+                  x.get_element_data_type() != dtype_,
+              "The vectors must have the data type {} of the matrix.",
+              data_type_name(dtype_));
+  auto *db = (const T *)prog->get_ndarray_data_ptr_as_int(&b);
+  auto *dx = (T *)prog->get_ndarray_data_ptr_as_int(&x);
+  const int bs = block_size_;
+  const int block_rows = rows_ / bs;
+  for (int step = 0; step < block_rows; step++) {
+    const int i = lower ? step : block_rows - 1 - step;
+    for (int r_step = 0; r_step < bs; r_step++) {
+      const int r = lower ? r_step : bs - 1 - r_step;
+      T sum = db[i * bs + r];
+      T diag = 0;
+      for (int k = row_ptr_[i]; k < row_ptr_[i + 1]; k++) {
+        const int j = col_ind_[k];
+        const T *block_row = values_.data() + k * bs * bs + r * bs;
+        if (j == i) {
+          diag = block_row[r];
+          for (int c = lower ? 0 : r + 1; c < (lower ? r : bs); c++) {
+            sum -= block_row[c] * dx[j * bs + c];
+          }
+        } else if ((j < i) == lower) {
+          for (int c = 0; c < bs; c++) {
+            sum -= block_row[c] * dx[j * bs + c];
+          }
+        }
+      }
+      TI_ERROR_IF(diag == 0, "Zero diagonal entry in row {}.", i * bs + r);
+      dx[i * bs + r] = sum / diag;
+    }
+  }
+}
+
+template class BsrSparseMatrix<float32>;
+template class BsrSparseMatrix<float64>;
+
+CuBsrSparseMatrix::CuBsrSparseMatrix(int rows,
+                                     int cols,
+                                     int block_size,
+                                     DataType dt)
+    : SparseMatrix(rows, cols, dt), block_size_(block_size) {
+  TI_ERROR_IF(dt != PrimitiveType::f32,
+              "BSR matrices only support f32 on CUDA.");
+#if defined(TI_WITH_CUDA)
+  if (!CUSPARSEDriver::get_instance().is_loaded()) {
+    bool load_success = CUSPARSEDriver::get_instance().load_cusparse();
+    if (!load_success) {
+      TI_ERROR("Failed to load cusparse library!");
+    }
+  }
+  CUSPARSEDriver::get_instance().cpCreate(&handle_);
+  CUSPARSEDriver::get_instance().cpCreateMatDescr(&descr_);
+  CUSPARSEDriver::get_instance().cpSetMatType(descr_,
+                                              CUSPARSE_MATRIX_TYPE_GENERAL);
+  CUSPARSEDriver::get_instance().cpSetMatIndexBase(descr_,
+                                                   CUSPARSE_INDEX_BASE_ZERO);
+#endif
+}
+
+CuBsrSparseMatrix::~CuBsrSparseMatrix() {
+#if defined(TI_WITH_CUDA)
+  for (int i = 0; i < 2; i++) {
+    if (sv_info_[i])
+      CUSPARSEDriver::get_instance().cpDestroyBsrsv2Info(sv_info_[i]);
+    if (sv_descr_[i])
+      CUSPARSEDriver::get_instance().cpDestroyMatDescr(sv_descr_[i]);
+    if (sv_buffer_[i])
+      CUDADriver::get_instance().mem_free(sv_buffer_[i]);
+  }
+  for (void *ptr : {row_ptr_, col_ind_, values_}) {
+    if (ptr)
+      CUDADriver::get_instance().mem_free(ptr);
+  }
+  if (descr_)
+    CUSPARSEDriver::get_instance().cpDestroyMatDescr(descr_);
+  if (handle_)
+    CUSPARSEDriver::get_instance().cpDestroy(handle_);
+#endif
+}
+
+void CuBsrSparseMatrix::build_bsr(int nnzb,
+                                  const int *row_ptr,
+                                  const int *col_ind,
+                                  const float32 *values) {
+#if defined(TI_WITH_CUDA)
+  TI_ASSERT(row_ptr_ == nullptr);
+  const int block_rows = rows_ / block_size_;
+  const size_t num_values = size_t(nnzb) * block_size_ * block_size_;
+  nnzb_ = nnzb;
+  CUDADriver::get_instance().malloc(&row_ptr_, sizeof(int) * (block_rows + 1));
+  CUDADriver::get_instance().malloc(&col_ind_,
+                                    sizeof(int) * std::max(nnzb, 1));
+  CUDADriver::get_instance().malloc(
+      &values_, sizeof(float32) * std::max(num_values, size_t(1)));
+  CUDADriver::get_instance().memcpy_host_to_device(
+      row_ptr_, (void *)row_ptr, sizeof(int) * (block_rows + 1));
+  CUDADriver::get_instance().memcpy_host_to_device(col_ind_, (void *)col_ind,
+                                                   sizeof(int) * nnzb);
+  CUDADriver::get_instance().memcpy_host_to_device(
+      values_, (void *)values, sizeof(float32) * num_values);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+BsrSparseMatrix<float32> CuBsrSparseMatrix::to_host() const {
+  BsrSparseMatrix<float32> host(rows_, cols_, block_size_, dtype_);
+#if defined(TI_WITH_CUDA)
+  const int block_rows = rows_ / block_size_;
+  std::vector<int> row_ptr(block_rows + 1);
+  std::vector<int> col_ind(nnzb_);
+  std::vector<float32> values(size_t(nnzb_) * block_size_ * block_size_);
+  CUDADriver::get_instance().memcpy_device_to_host(
+      row_ptr.data(), row_ptr_, sizeof(int) * row_ptr.size());
+  CUDADriver::get_instance().memcpy_device_to_host(
+      col_ind.data(), col_ind_, sizeof(int) * col_ind.size());
+  CUDADriver::get_instance().memcpy_device_to_host(
+      values.data(), values_, sizeof(float32) * values.size());
+  host.build_bsr(nnzb_, row_ptr.data(), col_ind.data(), values.data());
+#endif
+  return host;
+}
+
+uint64 CuBsrSparseMatrix::pattern_fingerprint() const {
+  return to_host().pattern_fingerprint();
+}
+
+const std::string CuBsrSparseMatrix::to_string() const {
+  return to_host().to_string();
+}
+
+float32 CuBsrSparseMatrix::get_element(int row, int col) const {
+  return to_host().get_element(row, col);
+}
+
+void CuBsrSparseMatrix::spmv(Program *prog,
+                             const Ndarray &x,
+                             const Ndarray &y) {
+#if defined(TI_WITH_CUDA)
+  auto *dx = (const float32 *)prog->get_ndarray_data_ptr_as_int(&x);
+  auto *dy = (float32 *)prog->get_ndarray_data_ptr_as_int(&y);
+  float alpha = 1.0f, beta = 0.0f;
+  CUSPARSEDriver::get_instance().cpSbsrmv(
+      handle_, CUSPARSE_DIRECTION_ROW, CUSPARSE_OPERATION_NON_TRANSPOSE,
+      rows_ / block_size_, cols_ / block_size_, nnzb_, &alpha, descr_,
+      (const float32 *)values_, (const int *)row_ptr_, (const int *)col_ind_,
+      block_size_, dx, &beta, dy);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+void CuBsrSparseMatrix::solve_triangular(Program *prog,
+                                         const Ndarray &b,
+                                         const Ndarray &x,
+                                         bool lower) {
+#if defined(TI_WITH_CUDA)
+  TI_ERROR_IF(rows_ != cols_, "Triangular solves need a square matrix.");
+  auto &cusparse = CUSPARSEDriver::get_instance();
+  const int side = lower ? 0 : 1;
+  const int block_rows = rows_ / block_size_;
+  // The analysis only depends on the matrix, so it is done once per side.
+  if (sv_info_[side] == nullptr) {
+    cusparse.cpCreateMatDescr(&sv_descr_[side]);
+    cusparse.cpSetMatType(sv_descr_[side], CUSPARSE_MATRIX_TYPE_GENERAL);
+    cusparse.cpSetMatIndexBase(sv_descr_[side], CUSPARSE_INDEX_BASE_ZERO);
+    cusparse.cpSetMatFillMode(sv_descr_[side], lower
+                                                   ? CUSPARSE_FILL_MODE_LOWER
+                                                   : CUSPARSE_FILL_MODE_UPPER);
+    cusparse.cpSetMatDiagType(sv_descr_[side], CUSPARSE_DIAG_TYPE_NON_UNIT);
+    cusparse.cpCreateBsrsv2Info(&sv_info_[side]);
+    int buffer_size = 0;
+    cusparse.cpSbsrsv2_bufferSize(
+        handle_, CUSPARSE_DIRECTION_ROW, CUSPARSE_OPERATION_NON_TRANSPOSE,
+        block_rows, nnzb_, sv_descr_[side], (float32 *)values_,
+        (const int *)row_ptr_, (const int *)col_ind_, block_size_,
+        sv_info_[side], &buffer_size);
+    CUDADriver::get_instance().malloc(&sv_buffer_[side],
+                                      std::max(buffer_size, 1));
+    cusparse.cpSbsrsv2_analysis(
+        handle_, CUSPARSE_DIRECTION_ROW, CUSPARSE_OPERATION_NON_TRANSPOSE,
+        block_rows, nnzb_, sv_descr_[side], (const float32 *)values_,
+        (const int *)row_ptr_, (const int *)col_ind_, block_size_,
+        sv_info_[side], CUSPARSE_SOLVE_POLICY_USE_LEVEL, sv_buffer_[side]);
+  }
+  auto *db = (const float32 *)prog->get_ndarray_data_ptr_as_int(&b);
+  auto *dx = (float32 *)prog->get_ndarray_data_ptr_as_int(&x);
+  float alpha = 1.0f;
+  cusparse.cpSbsrsv2_solve(
+      handle_, CUSPARSE_DIRECTION_ROW, CUSPARSE_OPERATION_NON_TRANSPOSE,
+      block_rows, nnzb_, &alpha, sv_descr_[side], (const float32 *)values_,
+      (const int *)row_ptr_, (const int *)col_ind_, block_size_,
+      sv_info_[side], db, dx, CUSPARSE_SOLVE_POLICY_USE_LEVEL,
+      sv_buffer_[side]);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+std::unique_ptr<SparseMatrix> make_bsr_sparse_matrix(int rows,
+                                                     int cols,
+                                                     int block_size,
+                                                     DataType dt) {
+  if (dt == PrimitiveType::f32) {
+    return std::make_unique<BsrSparseMatrix<float32>>(rows, cols, block_size,
+                                                      dt);
+  } else if (dt == PrimitiveType::f64) {
+    return std::make_unique<BsrSparseMatrix<float64>>(rows, cols, block_size,
+                                                      dt);
+  }
+  TI_ERROR("Unsupported sparse matrix data type: {}", data_type_name(dt));
+}
+
+std::unique_ptr<SparseMatrix> make_cu_bsr_sparse_matrix(int rows,
+                                                        int cols,
+                                                        int block_size,
+                                                        DataType dt) {
+  return std::make_unique<CuBsrSparseMatrix>(rows, cols, block_size, dt);
+}
+
 }  // namespace taichi::lang
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "taichi/common/core.h"
 #include "taichi/inc/constants.h"
 #include "taichi/ir/type_utils.h"
@@ -13,6 +15,21 @@ namespace taichi::lang {
 
 class SparseMatrix;
 
+// A CPU thread pool that EigenSparseMatrix runs SpMV, addition and matmul on.
+struct SparseThreadPool {
+  int num_threads{1};
+  // Runs |task(thread_id, i)| for i in [0, n), with thread_id < num_threads.
+  std::function<void(int n, const std::function<void(int, int)> &task)>
+      parallel_for;
+
+  explicit operator bool() const {
+    return bool(parallel_for);
+  }
+};
+
+// The thread pool of the kernels of |prog|, which must run on the CPU.
+SparseThreadPool make_sparse_thread_pool(Program *prog);
+
 class SparseMatrixBuilder {
  public:
   SparseMatrixBuilder(int rows,
@@ -20,7 +37,10 @@ class SparseMatrixBuilder {
                       int max_num_triplets,
                       DataType dtype,
                       const std::string &storage_format,
-                      Program *prog);
+                      Program *prog,
+                      bool reuse_pattern = false,
+                      bool parallel = false,
+                      int block_size = 1);
 
   void print_triplets_eigen();
   void print_triplets_cuda();
@@ -34,13 +54,41 @@ class SparseMatrixBuilder {
   void clear();
 
  private:
+  template <typename T, typename G>
+  std::unique_ptr<SparseMatrix> build_bsr_template();
+  std::unique_ptr<SparseMatrix> build_bsr();
+
   template <typename T, typename G>
   void build_template(std::unique_ptr<SparseMatrix> &);
 
   template <typename T, typename G>
   void print_triplets_template();
 
+  // Merges the triplets appended since the last build into the sparsity
+  // pattern stored after them in the ndarray.
+  template <typename T, typename G>
+  void update_pattern_template();
+
+  void build_from_pattern(std::unique_ptr<SparseMatrix> &m);
+
+  void copy_from_ndarray(void *dst, std::size_t offset, std::size_t num) const;
+  void copy_to_ndarray(const void *src, std::size_t offset, std::size_t num);
+
+  std::size_t pattern_outer_offset() const {
+    return kHeaderSize + 3 * max_num_triplets_;
+  }
+  std::size_t pattern_inner_offset() const {
+    return pattern_outer_offset() + num_outer_ + 1;
+  }
+  std::size_t pattern_values_offset() const {
+    return pattern_inner_offset() + max_num_triplets_;
+  }
+
  private:
+  // Number of ndarray entries in front of the triplets, see ATOMIC_INSERT in
+  // runtime_module/internal_functions.h.
+  static constexpr int kHeaderSize = 5;
+
   uint64 num_triplets_{0};
   std::unique_ptr<Ndarray> ndarray_data_base_ptr_{nullptr};
   int rows_{0};
@@ -50,6 +98,18 @@ class SparseMatrixBuilder {
   DataType dtype_{PrimitiveType::f32};
   std::string storage_format_{"col_major"};
   Program *prog_{nullptr};
+
+  // In pattern-reuse mode the builder keeps the compressed sparsity pattern of
+  // the last build. Later assemblies accumulate into its value array in place,
+  // so a build only sorts the entries that fall outside of it.
+  bool reuse_pattern_{false};
+  bool parallel_{false};
+  // Builds BSR matrices of |block_size_| blocks when greater than 1.
+  int block_size_{1};
+  bool pattern_by_col_{false};
+  int num_outer_{0};
+  std::vector<int32> pattern_outer_;
+  std::vector<int32> pattern_inner_;
 };
 
 class SparseMatrix {
@@ -75,6 +135,22 @@ class SparseMatrix {
                                   int nnz) {
     TI_NOT_IMPLEMENTED;
   }
+
+  // Builds the matrix from compressed arrays with 32-bit indices, which live
+  // on the device for CuSparseMatrix. The arrays are copied.
+  virtual void build_compressed(int nnz,
+                                const void *outer_index,
+                                const void *inner_index,
+                                const void *values) {
+    TI_NOT_IMPLEMENTED;
+  }
+
+  // A hash of the dimensions and the positions of the nonzeros, with which the
+  // sparse solvers detect that the symbolic analysis of a matrix still holds.
+  virtual uint64 pattern_fingerprint() const {
+    TI_NOT_IMPLEMENTED;
+  }
+
   inline const int num_rows() const {
     return rows_;
   }
@@ -116,16 +192,23 @@ class SparseMatrix {
 template <class EigenMatrix>
 class EigenSparseMatrix : public SparseMatrix {
  public:
-  explicit EigenSparseMatrix(int rows, int cols, DataType dt)
-      : SparseMatrix(rows, cols, dt), matrix_(rows, cols) {
+  explicit EigenSparseMatrix(int rows,
+                             int cols,
+                             DataType dt,
+                             SparseThreadPool thread_pool = {})
+      : SparseMatrix(rows, cols, dt),
+        matrix_(rows, cols),
+        thread_pool_(std::move(thread_pool)) {
   }
   EigenSparseMatrix(EigenSparseMatrix &sm)
       : SparseMatrix(sm.num_rows(), sm.num_cols(), sm.dtype_),
-        matrix_(sm.matrix_) {
+        matrix_(sm.matrix_),
+        thread_pool_(sm.thread_pool_) {
   }
   EigenSparseMatrix(EigenSparseMatrix &&sm)
       : SparseMatrix(sm.num_rows(), sm.num_cols(), sm.dtype_),
-        matrix_(sm.matrix_) {
+        matrix_(sm.matrix_),
+        thread_pool_(std::move(sm.thread_pool_)) {
   }
   explicit EigenSparseMatrix(const EigenMatrix &em)
       : SparseMatrix(em.rows(), em.cols()), matrix_(em) {
@@ -134,6 +217,11 @@ class EigenSparseMatrix : public SparseMatrix {
   ~EigenSparseMatrix() override = default;
 
   void build_triplets(void *triplets_adr) override;
+  void build_compressed(int nnz,
+                        const void *outer_index,
+                        const void *inner_index,
+                        const void *values) override;
+  uint64 pattern_fingerprint() const override;
   const std::string to_string() const override;
 
   const void *get_matrix() const override {
@@ -141,23 +229,37 @@ class EigenSparseMatrix : public SparseMatrix {
   };
 
   virtual EigenSparseMatrix &operator+=(const EigenSparseMatrix &other) {
-    this->matrix_ += other.matrix_;
+    if (runs_in_parallel_with(other)) {
+      this->matrix_ = parallel_add(other, 1);
+    } else {
+      this->matrix_ += other.matrix_;
+    }
     return *this;
   };
 
   friend EigenSparseMatrix operator+(const EigenSparseMatrix &lhs,
                                      const EigenSparseMatrix &rhs) {
-    return EigenSparseMatrix(lhs.matrix_ + rhs.matrix_);
+    if (lhs.runs_in_parallel_with(rhs)) {
+      return lhs.derived(lhs.parallel_add(rhs, 1));
+    }
+    return lhs.derived(lhs.matrix_ + rhs.matrix_);
   };
 
   virtual EigenSparseMatrix &operator-=(const EigenSparseMatrix &other) {
-    this->matrix_ -= other.matrix_;
+    if (runs_in_parallel_with(other)) {
+      this->matrix_ = parallel_add(other, -1);
+    } else {
+      this->matrix_ -= other.matrix_;
+    }
     return *this;
   }
 
   friend EigenSparseMatrix operator-(const EigenSparseMatrix &lhs,
                                      const EigenSparseMatrix &rhs) {
-    return EigenSparseMatrix(lhs.matrix_ - rhs.matrix_);
+    if (lhs.runs_in_parallel_with(rhs)) {
+      return lhs.derived(lhs.parallel_add(rhs, -1));
+    }
+    return lhs.derived(lhs.matrix_ - rhs.matrix_);
   };
 
   virtual EigenSparseMatrix &operator*=(float scale) {
@@ -166,24 +268,27 @@ class EigenSparseMatrix : public SparseMatrix {
   }
 
   friend EigenSparseMatrix operator*(const EigenSparseMatrix &sm, float scale) {
-    return EigenSparseMatrix(sm.matrix_ * scale);
+    return sm.derived(sm.matrix_ * scale);
   }
 
   friend EigenSparseMatrix operator*(float scale, const EigenSparseMatrix &sm) {
-    return EigenSparseMatrix(sm.matrix_ * scale);
+    return sm.derived(sm.matrix_ * scale);
   }
 
   friend EigenSparseMatrix operator*(const EigenSparseMatrix &lhs,
                                      const EigenSparseMatrix &rhs) {
-    return EigenSparseMatrix(lhs.matrix_.cwiseProduct(rhs.matrix_));
+    return lhs.derived(lhs.matrix_.cwiseProduct(rhs.matrix_));
   }
 
   EigenSparseMatrix transpose() {
-    return EigenSparseMatrix(matrix_.transpose());
+    return derived(matrix_.transpose());
   }
 
   EigenSparseMatrix matmul(const EigenSparseMatrix &sm) {
-    return EigenSparseMatrix(matrix_ * sm.matrix_);
+    if (runs_in_parallel_with(sm)) {
+      return derived(parallel_matmul(sm));
+    }
+    return derived(matrix_ * sm.matrix_);
   }
 
   template <typename T>
@@ -204,7 +309,31 @@ class EigenSparseMatrix : public SparseMatrix {
   void spmv(Program *prog, const Ndarray &x, const Ndarray &y);
 
  private:
+  using Scalar = typename EigenMatrix::Scalar;
+
+  // A result of this matrix, which runs on the same thread pool.
+  EigenSparseMatrix derived(const EigenMatrix &em) const {
+    EigenSparseMatrix sm(em);
+    sm.dtype_ = dtype_;
+    sm.thread_pool_ = thread_pool_;
+    return sm;
+  }
+
+  // The parallel kernels partition the outer vectors into blocks of about the
+  // same number of nonzeros, one task each. They need compressed operands
+  // with sorted inner indices, which Eigen keeps outside of coeffRef().
+  bool runs_in_parallel_with(const EigenSparseMatrix &other) const {
+    return thread_pool_ && matrix_.isCompressed() &&
+           other.matrix_.isCompressed();
+  }
+  EigenMatrix parallel_add(const EigenSparseMatrix &other, Scalar sign) const;
+  // Row-by-row (column-by-column for column-major) Gustavson product.
+  EigenMatrix parallel_matmul(const EigenSparseMatrix &other) const;
+  template <typename T>
+  void parallel_spmv(const T *x, T *y) const;
+
   EigenMatrix matrix_;
+  SparseThreadPool thread_pool_;
 };
 
 class CuSparseMatrix : public SparseMatrix {
@@ -279,6 +408,11 @@ class CuSparseMatrix : public SparseMatrix {
                           void *coo_col_ptr,
                           void *coo_values_ptr,
                           int nnz) override;
+  void build_compressed(int nnz,
+                        const void *outer_index,
+                        const void *inner_index,
+                        const void *values) override;
+  uint64 pattern_fingerprint() const override;
 
   void spmv(Program *prog, const Ndarray &x, const Ndarray &y);
 
@@ -309,16 +443,125 @@ class CuSparseMatrix : public SparseMatrix {
   void *csr_col_ind_{nullptr};
   void *csr_val_{nullptr};
   int nnz_{0};
+  // Kept across spmv calls so that iterative solvers do not create a handle
+  // or free a buffer, which synchronizes the device, in every iteration.
+  cusparseHandle_t spmv_handle_{nullptr};
+  void *spmv_buffer_{nullptr};
+  size_t spmv_buffer_size_{0};
+};
+
+/**
+ * Block compressed sparse row (BSR) matrix of square blocks, each stored
+ * row-major. Vector-valued systems such as 3D elasticity keep one column index
+ * per 3x3 block instead of one per entry. Only SpMV and triangular solves are
+ * supported.
+ */
+template <typename T>
+class BsrSparseMatrix : public SparseMatrix {
+ public:
+  BsrSparseMatrix(int rows, int cols, int block_size, DataType dt)
+      : SparseMatrix(rows, cols, dt), block_size_(block_size) {
+  }
+
+  // Copies BSR arrays on the host with |nnzb| blocks.
+  void build_bsr(int nnzb,
+                 const int *row_ptr,
+                 const int *col_ind,
+                 const T *values);
+  uint64 pattern_fingerprint() const override;
+  const std::string to_string() const override;
+  T get_element(int row, int col) const;
+
+  void spmv(Program *prog, const Ndarray &x, const Ndarray &y);
+  // Solves L x = b, or U x = b if not |lower|, where L and U are the lower and
+  // upper triangular parts of the matrix, diagonal included.
+  void solve_triangular(Program *prog,
+                        const Ndarray &b,
+                        const Ndarray &x,
+                        bool lower);
+
+  int block_size() const {
+    return block_size_;
+  }
+  int num_blocks() const {
+    return col_ind_.size();
+  }
+
+ private:
+  // |B| is the block size known at compile time, or 0.
+  template <int B>
+  void spmv_blocked(const T *x, T *y) const;
+
+  int block_size_{1};
+  std::vector<int> row_ptr_;
+  std::vector<int> col_ind_;
+  std::vector<T> values_;
+};
+
+class CuBsrSparseMatrix : public SparseMatrix {
+ public:
+  CuBsrSparseMatrix(int rows, int cols, int block_size, DataType dt);
+  ~CuBsrSparseMatrix() override;
+
+  // Uploads BSR arrays on the host with |nnzb| blocks.
+  void build_bsr(int nnzb,
+                 const int *row_ptr,
+                 const int *col_ind,
+                 const float32 *values);
+  uint64 pattern_fingerprint() const override;
+  const std::string to_string() const override;
+  float32 get_element(int row, int col) const;
+
+  // cusparse<t>bsrmv.
+  void spmv(Program *prog, const Ndarray &x, const Ndarray &y);
+  // cusparse<t>bsrsv2, see BsrSparseMatrix::solve_triangular().
+  void solve_triangular(Program *prog,
+                        const Ndarray &b,
+                        const Ndarray &x,
+                        bool lower);
+
+  int block_size() const {
+    return block_size_;
+  }
+  int num_blocks() const {
+    return nnzb_;
+  }
+
+ private:
+  BsrSparseMatrix<float32> to_host() const;
+
+  int block_size_{1};
+  int nnzb_{0};
+  void *row_ptr_{nullptr};
+  void *col_ind_{nullptr};
+  void *values_{nullptr};
+  cusparseHandle_t handle_{nullptr};
+  cusparseMatDescr_t descr_{nullptr};
+  // The analysis of the triangular solves, lower and upper.
+  cusparseMatDescr_t sv_descr_[2]{nullptr, nullptr};
+  bsrsv2Info_t sv_info_[2]{nullptr, nullptr};
+  void *sv_buffer_[2]{nullptr, nullptr};
 };
 
+// With a |thread_pool|, SpMV, addition and matmul of the matrix and of the
+// matrices derived from it run in parallel.
 std::unique_ptr<SparseMatrix> make_sparse_matrix(
     int rows,
     int cols,
     DataType dt,
-    const std::string &storage_format);
+    const std::string &storage_format,
+    SparseThreadPool thread_pool = {});
 std::unique_ptr<SparseMatrix> make_cu_sparse_matrix(int rows,
                                                     int cols,
                                                     DataType dt);
+std::unique_ptr<SparseMatrix> make_bsr_sparse_matrix(int rows,
+                                                     int cols,
+                                                     int block_size,
+                                                     DataType dt);
+std::unique_ptr<SparseMatrix> make_cu_bsr_sparse_matrix(int rows,
+                                                        int cols,
+                                                        int block_size,
+                                                        DataType dt);
 std::unique_ptr<SparseMatrix> make_cu_sparse_matrix(cusparseSpMatDescr_t mat,
                                                     int rows,
                                                     int cols,
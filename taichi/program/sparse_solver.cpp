@@ -2,6 +2,7 @@
 
 #include "sparse_solver.h"
 
+#include <cstring>
 #include <unordered_map>
 
 namespace taichi::lang {
@@ -89,6 +90,8 @@ struct key_hash {
     return h1 ^ h2 ^ h3;
   }
 };
+
+const std::string kMixedSolverPrefix = "Mixed";
 }  // namespace
 
 namespace taichi::lang {
@@ -99,11 +102,8 @@ namespace taichi::lang {
 template <class EigenSolver, class EigenMatrix>
 bool EigenSparseSolver<EigenSolver, EigenMatrix>::compute(
     const SparseMatrix &sm) {
-  if (!is_initialized_) {
-    SparseSolver::init_solver(sm.num_rows(), sm.num_cols(), sm.get_data_type());
-  }
-  GET_EM(sm);
-  solver_.compute(*mat);
+  analyze_pattern(sm);
+  factorize(sm);
   if (solver_.info() != Eigen::Success) {
     return false;
   } else
@@ -115,8 +115,12 @@ void EigenSparseSolver<EigenSolver, EigenMatrix>::analyze_pattern(
   if (!is_initialized_) {
     SparseSolver::init_solver(sm.num_rows(), sm.num_cols(), sm.get_data_type());
   }
+  if (reuse_analysis(sm)) {
+    return;
+  }
   GET_EM(sm);
   solver_.analyzePattern(*mat);
+  is_analyzed_ = true;
 }
 
 template <class EigenSolver, class EigenMatrix>
@@ -162,6 +166,16 @@ void EigenSparseSolver<EigenSolver, EigenMatrix>::solve_rf(
   Eigen::Map<T>((V *)dX, rows_) = solver_.solve(Eigen::Map<T>((V *)db, cols_));
 }
 
+template <class EigenSolver, class EigenMatrix>
+void EigenSparseSolver<EigenSolver, EigenMatrix>::solve_ndarray(
+    Program *prog,
+    const SparseMatrix &sm,
+    const Ndarray &b,
+    const Ndarray &x) {
+  using Scalar = typename EigenMatrix::Scalar;
+  solve_rf<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>, Scalar>(prog, sm, b, x);
+}
+
 INSTANTIATE_LLT_SOLVE_RF(float32, LLT, COLAMD, Eigen::VectorXf)
 INSTANTIATE_LLT_SOLVE_RF(float32, LDLT, COLAMD, Eigen::VectorXf)
 INSTANTIATE_LLT_SOLVE_RF(float32, LLT, AMD, Eigen::VectorXf)
@@ -193,29 +207,54 @@ void CuSparseSolver::init_solver() {
       TI_ERROR("Failed to load cusolver library!");
     }
   }
+  // The handles live as long as the solver.
+  CUSOLVERDriver::get_instance().csSpCreate(&cusolver_handle_);
+  CUSPARSEDriver::get_instance().cpCreate(&cusparse_handel_);
+  CUSPARSEDriver::get_instance().cpCreateMatDescr(&descr_);
+  CUSPARSEDriver::get_instance().cpSetMatType(descr_,
+                                              CUSPARSE_MATRIX_TYPE_GENERAL);
+  CUSPARSEDriver::get_instance().cpSetMatIndexBase(descr_,
+                                                   CUSPARSE_INDEX_BASE_ZERO);
+#endif
+}
+void CuSparseSolver::release_pattern() {
+#if defined(TI_WITH_CUDA)
+  for (void *ptr : {(void *)h_Q_, (void *)h_csrRowPtrB_, (void *)h_csrColIndB_,
+                    (void *)h_csrValB_, (void *)h_mapBfromA_}) {
+    if (ptr != nullptr)
+      free(ptr);
+  }
+  for (void *ptr : {(void *)d_Q_, (void *)d_csrRowPtrB_, (void *)d_csrColIndB_,
+                    (void *)d_csrValB_, (void *)d_mapBfromA_}) {
+    if (ptr != nullptr)
+      CUDADriver::get_instance().mem_free(ptr);
+  }
+  h_Q_ = h_csrRowPtrB_ = h_csrColIndB_ = h_mapBfromA_ = nullptr;
+  d_Q_ = d_csrRowPtrB_ = d_csrColIndB_ = d_mapBfromA_ = nullptr;
+  h_csrValB_ = d_csrValB_ = nullptr;
+  if (info_ != nullptr)
+    CUSOLVERDriver::get_instance().csSpDestroyCsrcholInfo(info_);
+  if (lu_info_ != nullptr)
+    CUSOLVERDriver::get_instance().csSpDestroyCsrluInfoHost(lu_info_);
+  info_ = nullptr;
+  lu_info_ = nullptr;
+  is_analyzed_ = false;
+  is_factorized_ = false;
 #endif
 }
+
 void CuSparseSolver::reorder(const CuSparseMatrix &A) {
 #if defined(TI_WITH_CUDA)
+  release_pattern();
   size_t rowsA = A.num_rows();
   size_t colsA = A.num_cols();
   size_t nnzA = A.get_nnz();
   void *d_csrRowPtrA = A.get_row_ptr();
   void *d_csrColIndA = A.get_col_ind();
-  void *d_csrValA = A.get_val_ptr();
-  CUSOLVERDriver::get_instance().csSpCreate(&cusolver_handle_);
-  CUSPARSEDriver::get_instance().cpCreate(&cusparse_handel_);
-  CUSPARSEDriver::get_instance().cpCreateMatDescr(&descr_);
-  CUSPARSEDriver::get_instance().cpSetMatType(descr_,
-                                              CUSPARSE_MATRIX_TYPE_GENERAL);
-  CUSPARSEDriver::get_instance().cpSetMatIndexBase(descr_,
-                                                   CUSPARSE_INDEX_BASE_ZERO);
-  float *h_csrValA = nullptr;
   h_Q_ = (int *)malloc(sizeof(int) * colsA);
   h_csrRowPtrB_ = (int *)malloc(sizeof(int) * (rowsA + 1));
   h_csrColIndB_ = (int *)malloc(sizeof(int) * nnzA);
   h_csrValB_ = (float *)malloc(sizeof(float) * nnzA);
-  h_csrValA = (float *)malloc(sizeof(float) * nnzA);
   h_mapBfromA_ = (int *)malloc(sizeof(int) * nnzA);
   assert(nullptr != h_Q_);
   assert(nullptr != h_csrRowPtrB_);
@@ -227,8 +266,6 @@ void CuSparseSolver::reorder(const CuSparseMatrix &A) {
                                                    sizeof(int) * (rowsA + 1));
   CUDADriver::get_instance().memcpy_device_to_host(h_csrColIndB_, d_csrColIndA,
                                                    sizeof(int) * nnzA);
-  CUDADriver::get_instance().memcpy_device_to_host(h_csrValA, d_csrValA,
-                                                   sizeof(float) * nnzA);
 
   // compoute h_Q_
   CUSOLVERDriver::get_instance().csSpXcsrsymamdHost(cusolver_handle_, rowsA,
@@ -249,29 +286,61 @@ void CuSparseSolver::reorder(const CuSparseMatrix &A) {
   CUSOLVERDriver::get_instance().csSpXcsrpermHost(
       cusolver_handle_, rowsA, colsA, nnzA, descr_, h_csrRowPtrB_,
       h_csrColIndB_, h_Q_, h_Q_, h_mapBfromA_, buffer_cpu);
-  // B = A( mapBfromA )
-  for (int j = 0; j < nnzA; j++) {
-    h_csrValB_[j] = h_csrValA[h_mapBfromA_[j]];
-  }
+  // The values of B = A(mapBfromA) are gathered by update_values().
   CUDADriver::get_instance().malloc((void **)&d_csrRowPtrB_,
                                     sizeof(int) * (rowsA + 1));
   CUDADriver::get_instance().malloc((void **)&d_csrColIndB_,
                                     sizeof(int) * nnzA);
   CUDADriver::get_instance().malloc((void **)&d_csrValB_, sizeof(float) * nnzA);
+  CUDADriver::get_instance().malloc((void **)&d_mapBfromA_, sizeof(int) * nnzA);
   CUDADriver::get_instance().memcpy_host_to_device(
       (void *)d_csrRowPtrB_, (void *)h_csrRowPtrB_, sizeof(int) * (rowsA + 1));
   CUDADriver::get_instance().memcpy_host_to_device(
       (void *)d_csrColIndB_, (void *)h_csrColIndB_, sizeof(int) * nnzA);
   CUDADriver::get_instance().memcpy_host_to_device(
-      (void *)d_csrValB_, (void *)h_csrValB_, sizeof(float) * nnzA);
-  free(h_csrValA);
+      (void *)d_mapBfromA_, (void *)h_mapBfromA_, sizeof(int) * nnzA);
   free(buffer_cpu);
 #endif
 }
 
+void CuSparseSolver::update_values(const CuSparseMatrix &A) {
+#if defined(TI_WITH_CUDA)
+  int nnzA = A.get_nnz();
+  if (solver_type_ == SolverType::Cholesky) {
+    // The Cholesky factorization runs on the device: gather there.
+    cusparseDnVecDescr_t vec_a;
+    cusparseSpVecDescr_t vec_b;
+    CUSPARSEDriver::get_instance().cpCreateDnVec(&vec_a, nnzA,
+                                                 A.get_val_ptr(), CUDA_R_32F);
+    CUSPARSEDriver::get_instance().cpCreateSpVec(
+        &vec_b, nnzA, nnzA, d_mapBfromA_, d_csrValB_, CUSPARSE_INDEX_32I,
+        CUSPARSE_INDEX_BASE_ZERO, CUDA_R_32F);
+    CUSPARSEDriver::get_instance().cpGather(cusparse_handel_, vec_a, vec_b);
+    CUSPARSEDriver::get_instance().cpDestroyDnVec(vec_a);
+    CUSPARSEDriver::get_instance().cpDestroySpVec(vec_b);
+  } else {
+    std::vector<float> h_csrValA(nnzA);
+    CUDADriver::get_instance().memcpy_device_to_host(
+        h_csrValA.data(), A.get_val_ptr(), sizeof(float) * nnzA);
+    for (int j = 0; j < nnzA; j++) {
+      h_csrValB_[j] = h_csrValA[h_mapBfromA_[j]];
+    }
+  }
+#endif
+}
+
+bool CuSparseSolver::compute(const SparseMatrix &sm) {
+  analyze_pattern(sm);
+  factorize(sm);
+  return true;
+}
+
 // Reference:
 // https://github.com/NVIDIA/cuda-samples/blob/master/Samples/4_CUDA_Libraries/cuSolverSp_LowlevelCholesky/cuSolverSp_LowlevelCholesky.cpp
 void CuSparseSolver::analyze_pattern(const SparseMatrix &sm) {
+  if (reuse_analysis(sm)) {
+    return;
+  }
   switch (solver_type_) {
     case SolverType::Cholesky:
       analyze_pattern_cholesky(sm);
@@ -349,16 +418,21 @@ void CuSparseSolver::factorize_cholesky(const SparseMatrix &sm) {
   CuSparseMatrix *A = static_cast<CuSparseMatrix *>(sm_no_cv);
   size_t rowsA = A->num_rows();
   size_t nnzA = A->get_nnz();
+  update_values(*A);
 
   size_t size_internal = 0;
   size_t size_chol = 0;  // size of working space for csrlu
-  // step 1: workspace for chol(A)
+  // step 1: workspace for chol(A), kept across factorizations
   CUSOLVERDriver::get_instance().csSpScsrcholBufferInfo(
       cusolver_handle_, rowsA, nnzA, descr_, d_csrValB_, d_csrRowPtrB_,
       d_csrColIndB_, info_, &size_internal, &size_chol);
 
-  if (size_chol > 0)
+  if (size_chol > gpu_buffer_size_) {
+    if (gpu_buffer_ != nullptr)
+      CUDADriver::get_instance().mem_free(gpu_buffer_);
     CUDADriver::get_instance().malloc(&gpu_buffer_, sizeof(char) * size_chol);
+    gpu_buffer_size_ = size_chol;
+  }
 
   // step 2: compute A = L*L^T
   CUSOLVERDriver::get_instance().csSpScsrcholFactor(
@@ -382,17 +456,21 @@ void CuSparseSolver::factorize_lu(const SparseMatrix &sm) {
   CuSparseMatrix *A = static_cast<CuSparseMatrix *>(sm_no_cv);
   size_t rowsA = A->num_rows();
   size_t nnzA = A->get_nnz();
-  // step 4: workspace for LU(B)
+  update_values(*A);
+  // step 4: workspace for LU(B), kept across factorizations
   size_t size_lu = 0;
   size_t buffer_size = 0;
   CUSOLVERDriver::get_instance().csSpScsrluBufferInfoHost(
       cusolver_handle_, rowsA, nnzA, descr_, h_csrValB_, h_csrRowPtrB_,
       h_csrColIndB_, lu_info_, &buffer_size, &size_lu);
 
-  if (cpu_buffer_)
-    free(cpu_buffer_);
-  cpu_buffer_ = (void *)malloc(sizeof(char) * size_lu);
-  assert(nullptr != cpu_buffer_);
+  if (size_lu > cpu_buffer_size_) {
+    if (cpu_buffer_)
+      free(cpu_buffer_);
+    cpu_buffer_ = (void *)malloc(sizeof(char) * size_lu);
+    assert(nullptr != cpu_buffer_);
+    cpu_buffer_size_ = size_lu;
+  }
 
   // step 5: compute Ppivot * B = L * U
   CUSOLVERDriver::get_instance().csSpScsrluFactorHost(
@@ -542,6 +620,13 @@ void CuSparseSolver::solve_lu(Program *prog,
 std::unique_ptr<SparseSolver> make_sparse_solver(DataType dt,
                                                  const std::string &solver_type,
                                                  const std::string &ordering) {
+  if (solver_type.rfind(kMixedSolverPrefix, 0) == 0) {
+    return std::make_unique<MixedPrecisionSparseSolver>(
+        make_sparse_solver(PrimitiveType::f32,
+                           solver_type.substr(kMixedSolverPrefix.size()),
+                           ordering),
+        /*on_cuda=*/false);
+  }
   using key_type = Triplets;
   using func_type = std::unique_ptr<SparseSolver> (*)();
   static const std::unordered_map<key_type, func_type, key_hash>
@@ -579,22 +664,9 @@ std::unique_ptr<SparseSolver> make_sparse_solver(DataType dt,
 
 CuSparseSolver::~CuSparseSolver() {
 #if defined(TI_WITH_CUDA)
-  if (h_Q_ != nullptr)
-    free(h_Q_);
-  if (h_csrRowPtrB_ != nullptr)
-    free(h_csrRowPtrB_);
-  if (h_csrColIndB_ != nullptr)
-    free(h_csrColIndB_);
-  if (h_csrValB_ != nullptr)
-    free(h_csrValB_);
-  if (h_mapBfromA_ != nullptr)
-    free(h_mapBfromA_);
+  release_pattern();
   if (cpu_buffer_ != nullptr)
     free(cpu_buffer_);
-  if (info_ != nullptr)
-    CUSOLVERDriver::get_instance().csSpDestroyCsrcholInfo(info_);
-  if (lu_info_ != nullptr)
-    CUSOLVERDriver::get_instance().csSpDestroyCsrluInfoHost(lu_info_);
   if (cusolver_handle_ != nullptr)
     CUSOLVERDriver::get_instance().csSpDestory(cusolver_handle_);
   if (cusparse_handel_ != nullptr)
@@ -603,20 +675,19 @@ CuSparseSolver::~CuSparseSolver() {
     CUSPARSEDriver::get_instance().cpDestroyMatDescr(descr_);
   if (gpu_buffer_ != nullptr)
     CUDADriver::get_instance().mem_free(gpu_buffer_);
-  if (d_Q_ != nullptr)
-    CUDADriver::get_instance().mem_free(d_Q_);
-  if (d_csrRowPtrB_ != nullptr)
-    CUDADriver::get_instance().mem_free(d_csrRowPtrB_);
-  if (d_csrColIndB_ != nullptr)
-    CUDADriver::get_instance().mem_free(d_csrColIndB_);
-  if (d_csrValB_ != nullptr)
-    CUDADriver::get_instance().mem_free(d_csrValB_);
 #endif
 }
 std::unique_ptr<SparseSolver> make_cusparse_solver(
     DataType dt,
     const std::string &solver_type,
     const std::string &ordering) {
+  if (solver_type.rfind(kMixedSolverPrefix, 0) == 0) {
+    return std::make_unique<MixedPrecisionSparseSolver>(
+        make_cusparse_solver(PrimitiveType::f32,
+                             solver_type.substr(kMixedSolverPrefix.size()),
+                             ordering),
+        /*on_cuda=*/true);
+  }
   if (solver_type == "LLT" || solver_type == "LDLT") {
     return std::make_unique<CuSparseSolver>(
         CuSparseSolver::SolverType::Cholesky);
@@ -626,4 +697,492 @@ std::unique_ptr<SparseSolver> make_cusparse_solver(
     TI_ERROR("Not supported sparse solver type: {}", solver_type);
   }
 }
+
+namespace {
+template <typename Scalar, int Options>
+bool to_row_major_f64(const SparseMatrix &sm,
+                      Eigen::SparseMatrix<float64, Eigen::RowMajor> &dst) {
+  using EigenMatrix = Eigen::SparseMatrix<Scalar, Options>;
+  if (dynamic_cast<const EigenSparseMatrix<EigenMatrix> *>(&sm) == nullptr) {
+    return false;
+  }
+  GET_EM(sm);
+  dst = mat->template cast<float64>();
+  return true;
+}
+}  // namespace
+
+void MixedPrecisionSparseSolver::convert(const SparseMatrix &sm) {
+  if (on_cuda_) {
+#if defined(TI_WITH_CUDA)
+    const auto &A = static_cast<const CuSparseMatrix &>(sm);
+    const int nnz = A.get_nnz();
+    std::vector<int> row_ptr(A.num_rows() + 1);
+    std::vector<int> col_ind(nnz);
+    std::vector<float32> values(nnz);
+    CUDADriver::get_instance().memcpy_device_to_host(
+        row_ptr.data(), A.get_row_ptr(), sizeof(int) * row_ptr.size());
+    CUDADriver::get_instance().memcpy_device_to_host(
+        col_ind.data(), A.get_col_ind(), sizeof(int) * nnz);
+    CUDADriver::get_instance().memcpy_device_to_host(
+        values.data(), A.get_val_ptr(), sizeof(float32) * nnz);
+    a64_ = Eigen::Map<const Eigen::SparseMatrix<float32, Eigen::RowMajor>>(
+               A.num_rows(), A.num_cols(), nnz, row_ptr.data(),
+               col_ind.data(), values.data())
+               .cast<float64>();
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+    return;
+  }
+  bool converted = to_row_major_f64<float32, Eigen::ColMajor>(sm, a64_) ||
+                   to_row_major_f64<float32, Eigen::RowMajor>(sm, a64_) ||
+                   to_row_major_f64<float64, Eigen::ColMajor>(sm, a64_) ||
+                   to_row_major_f64<float64, Eigen::RowMajor>(sm, a64_);
+  TI_ERROR_IF(!converted, "Unsupported sparse matrix for the mixed solver.");
+  // The Eigen solvers take column-major matrices.
+  a32_ = std::make_unique<EigenSparseMatrix<Eigen::SparseMatrix<float32>>>(
+      Eigen::SparseMatrix<float32>(a64_.cast<float32>()));
+}
+
+bool MixedPrecisionSparseSolver::compute(const SparseMatrix &sm) {
+  init_solver(sm.num_rows(), sm.num_cols(), PrimitiveType::f64);
+  convert(sm);
+  is_analyzed_ = true;
+  return inner_->compute(inner_matrix(sm));
+}
+
+void MixedPrecisionSparseSolver::analyze_pattern(const SparseMatrix &sm) {
+  init_solver(sm.num_rows(), sm.num_cols(), PrimitiveType::f64);
+  convert(sm);
+  is_analyzed_ = true;
+  inner_->analyze_pattern(inner_matrix(sm));
+}
+
+void MixedPrecisionSparseSolver::factorize(const SparseMatrix &sm) {
+  convert(sm);
+  inner_->factorize(inner_matrix(sm));
+}
+
+void MixedPrecisionSparseSolver::read_ndarray(Program *prog,
+                                              const Ndarray &nd,
+                                              Eigen::VectorXd &v) {
+  const int n = nd.get_nelement();
+  const auto element_size = data_type_size(nd.get_element_data_type());
+  TI_ERROR_IF(element_size != 4 && element_size != 8,
+              "The mixed solver only supports f32 and f64 ndarrays.");
+  std::vector<char> host(n * element_size);
+  void *data = (void *)prog->get_ndarray_data_ptr_as_int(&nd);
+  if (on_cuda_) {
+#if defined(TI_WITH_CUDA)
+    CUDADriver::get_instance().memcpy_device_to_host(host.data(), data,
+                                                     host.size());
+#endif
+  } else {
+    std::memcpy(host.data(), data, host.size());
+  }
+  if (element_size == 4) {
+    v = Eigen::Map<Eigen::VectorXf>((float32 *)host.data(), n).cast<float64>();
+  } else {
+    v = Eigen::Map<Eigen::VectorXd>((float64 *)host.data(), n);
+  }
+}
+
+void MixedPrecisionSparseSolver::write_ndarray(Program *prog,
+                                               const Ndarray &nd,
+                                               const Eigen::VectorXd &v) {
+  const int n = nd.get_nelement();
+  TI_ASSERT(n == v.size());
+  const auto element_size = data_type_size(nd.get_element_data_type());
+  TI_ERROR_IF(element_size != 4 && element_size != 8,
+              "The mixed solver only supports f32 and f64 ndarrays.");
+  std::vector<char> host(n * element_size);
+  if (element_size == 4) {
+    Eigen::Map<Eigen::VectorXf>((float32 *)host.data(), n) =
+        v.cast<float32>();
+  } else {
+    Eigen::Map<Eigen::VectorXd>((float64 *)host.data(), n) = v;
+  }
+  void *data = (void *)prog->get_ndarray_data_ptr_as_int(&nd);
+  if (on_cuda_) {
+#if defined(TI_WITH_CUDA)
+    CUDADriver::get_instance().memcpy_host_to_device(data, host.data(),
+                                                     host.size());
+#endif
+  } else {
+    std::memcpy(data, host.data(), host.size());
+  }
+}
+
+void MixedPrecisionSparseSolver::solve_rf(Program *prog,
+                                          const SparseMatrix &sm,
+                                          const Ndarray &b,
+                                          const Ndarray &x) {
+  TI_ERROR_IF(!is_analyzed_, "Please factorize the matrix before solving.");
+  const int n = rows_;
+  if (!r32_ || r32_->get_nelement() != n) {
+    r32_ = std::make_unique<Ndarray>(prog, PrimitiveType::f32,
+                                     std::vector<int>{n});
+    d32_ = std::make_unique<Ndarray>(prog, PrimitiveType::f32,
+                                     std::vector<int>{n});
+  }
+  Eigen::VectorXd vb, d;
+  read_ndarray(prog, b, vb);
+  const float64 b_norm = vb.norm();
+  Eigen::VectorXd vx = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd r = vb;
+  num_iterations_ = 0;
+  residual_ = b_norm == 0 ? 0 : 1;
+  while (num_iterations_ < max_iter_ && residual_ > tol_) {
+    write_ndarray(prog, *r32_, r);
+    inner_->solve_ndarray(prog, inner_matrix(sm), *r32_, *d32_);
+    read_ndarray(prog, *d32_, d);
+    vx += d;
+    r = vb - a64_ * vx;
+    num_iterations_++;
+    residual_ = r.norm() / b_norm;
+  }
+  write_ndarray(prog, x, vx);
+}
+
+template <class EigenPreconditioner, class EigenMatrix>
+void EigenSparsePreconditioner<EigenPreconditioner, EigenMatrix>::compute(
+    const SparseMatrix &sm) {
+  rows_ = sm.num_rows();
+  GET_EM(sm);
+  preconditioner_.compute(*mat);
+  TI_ERROR_IF(preconditioner_.info() != Eigen::Success,
+              "Failed to compute the preconditioner.");
+}
+
+template <class EigenPreconditioner, class EigenMatrix>
+void EigenSparsePreconditioner<EigenPreconditioner, EigenMatrix>::apply(
+    Program *prog,
+    const Ndarray &r,
+    const Ndarray &z) {
+  using Scalar = typename EigenMatrix::Scalar;
+  using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+  size_t dr = prog->get_ndarray_data_ptr_as_int(&r);
+  size_t dz = prog->get_ndarray_data_ptr_as_int(&z);
+  Eigen::Map<Vector>((Scalar *)dz, rows_) =
+      preconditioner_.solve(Eigen::Map<const Vector>((Scalar *)dr, rows_));
+}
+
+CuSparsePreconditioner::CuSparsePreconditioner(PreconditionerType type)
+    : type_(type) {
+#if defined(TI_WITH_CUDA)
+  if (!CUSPARSEDriver::get_instance().is_loaded()) {
+    bool load_success = CUSPARSEDriver::get_instance().load_cusparse();
+    if (!load_success) {
+      TI_ERROR("Failed to load cusparse library!");
+    }
+  }
+  CUSPARSEDriver::get_instance().cpCreate(&cusparse_handle_);
+#endif
+}
+
+CuSparsePreconditioner::~CuSparsePreconditioner() {
+#if defined(TI_WITH_CUDA)
+  release();
+  if (cusparse_handle_)
+    CUSPARSEDriver::get_instance().cpDestroy(cusparse_handle_);
+#endif
+}
+
+void CuSparsePreconditioner::release() {
+#if defined(TI_WITH_CUDA)
+  auto &cusparse = CUSPARSEDriver::get_instance();
+  if (lower_sv_)
+    cusparse.cpSpSV_destroyDescr(lower_sv_);
+  if (upper_sv_)
+    cusparse.cpSpSV_destroyDescr(upper_sv_);
+  if (inv_diag_)
+    cusparse.cpDestroySpMat(inv_diag_);
+  if (lower_)
+    cusparse.cpDestroySpMat(lower_);
+  if (upper_)
+    cusparse.cpDestroySpMat(upper_);
+  for (void *ptr : {row_ptr_, col_ind_, val_, spmv_buffer_, lower_buffer_,
+                    upper_buffer_, tmp_}) {
+    if (ptr)
+      CUDADriver::get_instance().mem_free(ptr);
+  }
+  lower_sv_ = upper_sv_ = nullptr;
+  inv_diag_ = lower_ = upper_ = nullptr;
+  row_ptr_ = col_ind_ = val_ = nullptr;
+  spmv_buffer_ = lower_buffer_ = upper_buffer_ = tmp_ = nullptr;
+  spmv_buffer_size_ = 0;
+  is_analyzed_ = false;
+#endif
+}
+
+void CuSparsePreconditioner::compute(const SparseMatrix &sm) {
+  TI_ERROR_IF(sm.get_data_type() != PrimitiveType::f32,
+              "Sparse matrices on CUDA only support f32 for now.");
+  const CuSparseMatrix &A = static_cast<const CuSparseMatrix &>(sm);
+  release();
+  rows_ = A.num_rows();
+  if (type_ == PreconditionerType::Jacobi) {
+    compute_jacobi(A);
+  } else {
+    compute_incomplete_factorization(A);
+  }
+}
+
+void CuSparsePreconditioner::compute_jacobi(const CuSparseMatrix &A) {
+#if defined(TI_WITH_CUDA)
+  // The diagonal is extracted on the host once; applying the preconditioner
+  // is a device SpMV.
+  int nnz = A.get_nnz();
+  std::vector<int> row(rows_ + 1), col(nnz);
+  std::vector<float32> val(nnz);
+  CUDADriver::get_instance().memcpy_device_to_host(
+      row.data(), A.get_row_ptr(), sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().memcpy_device_to_host(
+      col.data(), A.get_col_ind(), sizeof(int) * nnz);
+  CUDADriver::get_instance().memcpy_device_to_host(
+      val.data(), A.get_val_ptr(), sizeof(float32) * nnz);
+  // Rows without a nonzero diagonal entry are left unscaled.
+  std::vector<float32> inv_diag(rows_, 1.0f);
+  std::vector<int> diag_row(rows_ + 1), diag_col(rows_);
+  for (int i = 0; i < rows_; i++) {
+    for (int k = row[i]; k < row[i + 1]; k++) {
+      if (col[k] == i && val[k] != 0.0f) {
+        inv_diag[i] = 1.0f / val[k];
+      }
+    }
+    diag_row[i] = i;
+    diag_col[i] = i;
+  }
+  diag_row[rows_] = rows_;
+  CUDADriver::get_instance().malloc(&row_ptr_, sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().malloc(&col_ind_, sizeof(int) * rows_);
+  CUDADriver::get_instance().malloc(&val_, sizeof(float32) * rows_);
+  CUDADriver::get_instance().memcpy_host_to_device(
+      row_ptr_, diag_row.data(), sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().memcpy_host_to_device(
+      col_ind_, diag_col.data(), sizeof(int) * rows_);
+  CUDADriver::get_instance().memcpy_host_to_device(
+      val_, inv_diag.data(), sizeof(float32) * rows_);
+  CUSPARSEDriver::get_instance().cpCreateCsr(
+      &inv_diag_, rows_, rows_, rows_, row_ptr_, col_ind_, val_,
+      CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_BASE_ZERO,
+      CUDA_R_32F);
+#endif
+}
+
+// Reference:
+// https://docs.nvidia.com/cuda/cusparse/index.html#csric02
+// https://docs.nvidia.com/cuda/cusparse/index.html#csrilu02
+// Both keep the sparsity pattern of A, whose diagonal must be present.
+void CuSparsePreconditioner::compute_incomplete_factorization(
+    const CuSparseMatrix &A) {
+#if defined(TI_WITH_CUDA)
+  auto &cusparse = CUSPARSEDriver::get_instance();
+  int nnz = A.get_nnz();
+  CUDADriver::get_instance().malloc(&row_ptr_, sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().malloc(&col_ind_, sizeof(int) * nnz);
+  CUDADriver::get_instance().malloc(&val_, sizeof(float32) * nnz);
+  CUDADriver::get_instance().malloc(&tmp_, sizeof(float32) * rows_);
+  CUDADriver::get_instance().memcpy_device_to_device(
+      row_ptr_, A.get_row_ptr(), sizeof(int) * (rows_ + 1));
+  CUDADriver::get_instance().memcpy_device_to_device(
+      col_ind_, A.get_col_ind(), sizeof(int) * nnz);
+  CUDADriver::get_instance().memcpy_device_to_device(
+      val_, A.get_val_ptr(), sizeof(float32) * nnz);
+
+  cusparseMatDescr_t descr = nullptr;
+  cusparse.cpCreateMatDescr(&descr);
+  cusparse.cpSetMatType(descr, CUSPARSE_MATRIX_TYPE_GENERAL);
+  cusparse.cpSetMatIndexBase(descr, CUSPARSE_INDEX_BASE_ZERO);
+  int buffer_size = 0;
+  void *buffer = nullptr;
+  if (type_ == PreconditionerType::IC0) {
+    csric02Info_t info = nullptr;
+    cusparse.cpCreateCsric02Info(&info);
+    cusparse.cpScsric02_bufferSize(cusparse_handle_, rows_, nnz, descr, val_,
+                                   row_ptr_, col_ind_, info, &buffer_size);
+    CUDADriver::get_instance().malloc(&buffer, std::max(buffer_size, 1));
+    cusparse.cpScsric02_analysis(cusparse_handle_, rows_, nnz, descr, val_,
+                                 row_ptr_, col_ind_, info,
+                                 CUSPARSE_SOLVE_POLICY_USE_LEVEL, buffer);
+    cusparse.cpScsric02(cusparse_handle_, rows_, nnz, descr, val_, row_ptr_,
+                        col_ind_, info, CUSPARSE_SOLVE_POLICY_USE_LEVEL,
+                        buffer);
+    cusparse.cpDestroyCsric02Info(info);
+  } else {
+    csrilu02Info_t info = nullptr;
+    cusparse.cpCreateCsrilu02Info(&info);
+    cusparse.cpScsrilu02_bufferSize(cusparse_handle_, rows_, nnz, descr, val_,
+                                    row_ptr_, col_ind_, info, &buffer_size);
+    CUDADriver::get_instance().malloc(&buffer, std::max(buffer_size, 1));
+    cusparse.cpScsrilu02_analysis(cusparse_handle_, rows_, nnz, descr, val_,
+                                  row_ptr_, col_ind_, info,
+                                  CUSPARSE_SOLVE_POLICY_USE_LEVEL, buffer);
+    cusparse.cpScsrilu02(cusparse_handle_, rows_, nnz, descr, val_, row_ptr_,
+                         col_ind_, info, CUSPARSE_SOLVE_POLICY_USE_LEVEL,
+                         buffer);
+    cusparse.cpDestroyCsrilu02Info(info);
+  }
+  CUDADriver::get_instance().mem_free(buffer);
+  cusparse.cpDestroyMatDescr(descr);
+
+  // IC0 solves with L and L^T, ILU0 with the unit lower L and U.
+  cusparseFillMode_t lower_fill = CUSPARSE_FILL_MODE_LOWER;
+  cusparseFillMode_t upper_fill = CUSPARSE_FILL_MODE_UPPER;
+  cusparseDiagType_t lower_diag = type_ == PreconditionerType::IC0
+                                      ? CUSPARSE_DIAG_TYPE_NON_UNIT
+                                      : CUSPARSE_DIAG_TYPE_UNIT;
+  cusparseDiagType_t upper_diag = CUSPARSE_DIAG_TYPE_NON_UNIT;
+  cusparse.cpCreateCsr(&lower_, rows_, rows_, nnz, row_ptr_, col_ind_, val_,
+                       CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I,
+                       CUSPARSE_INDEX_BASE_ZERO, CUDA_R_32F);
+  cusparse.cpSpMatSetAttribute(lower_, CUSPARSE_SPMAT_FILL_MODE, &lower_fill,
+                               sizeof(lower_fill));
+  cusparse.cpSpMatSetAttribute(lower_, CUSPARSE_SPMAT_DIAG_TYPE, &lower_diag,
+                               sizeof(lower_diag));
+  if (type_ == PreconditionerType::ILU0) {
+    cusparse.cpCreateCsr(&upper_, rows_, rows_, nnz, row_ptr_, col_ind_, val_,
+                         CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I,
+                         CUSPARSE_INDEX_BASE_ZERO, CUDA_R_32F);
+    cusparse.cpSpMatSetAttribute(upper_, CUSPARSE_SPMAT_FILL_MODE,
+                                 &upper_fill, sizeof(upper_fill));
+    cusparse.cpSpMatSetAttribute(upper_, CUSPARSE_SPMAT_DIAG_TYPE,
+                                 &upper_diag, sizeof(upper_diag));
+  }
+#endif
+}
+
+void CuSparsePreconditioner::apply(Program *prog,
+                                   const Ndarray &r,
+                                   const Ndarray &z) {
+#if defined(TI_WITH_CUDA)
+  auto &cusparse = CUSPARSEDriver::get_instance();
+  void *dr = (void *)prog->get_ndarray_data_ptr_as_int(&r);
+  void *dz = (void *)prog->get_ndarray_data_ptr_as_int(&z);
+  cusparseDnVecDescr_t vec_r, vec_z;
+  cusparse.cpCreateDnVec(&vec_r, rows_, dr, CUDA_R_32F);
+  cusparse.cpCreateDnVec(&vec_z, rows_, dz, CUDA_R_32F);
+  float alpha = 1.0f, beta = 0.0f;
+  if (type_ == PreconditionerType::Jacobi) {
+    size_t buffer_size = 0;
+    cusparse.cpSpMV_bufferSize(cusparse_handle_,
+                               CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha,
+                               inv_diag_, vec_r, &beta, vec_z, CUDA_R_32F,
+                               CUSPARSE_SPMV_CSR_ALG1, &buffer_size);
+    if (buffer_size > spmv_buffer_size_) {
+      if (spmv_buffer_)
+        CUDADriver::get_instance().mem_free(spmv_buffer_);
+      CUDADriver::get_instance().malloc(&spmv_buffer_, buffer_size);
+      spmv_buffer_size_ = buffer_size;
+    }
+    cusparse.cpSpMV(cusparse_handle_, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha,
+                    inv_diag_, vec_r, &beta, vec_z, CUDA_R_32F,
+                    CUSPARSE_SPMV_CSR_ALG1, spmv_buffer_);
+  } else {
+    cusparseDnVecDescr_t vec_tmp;
+    cusparse.cpCreateDnVec(&vec_tmp, rows_, tmp_, CUDA_R_32F);
+    auto second = type_ == PreconditionerType::IC0 ? lower_ : upper_;
+    auto second_op = type_ == PreconditionerType::IC0
+                         ? CUSPARSE_OPERATION_TRANSPOSE
+                         : CUSPARSE_OPERATION_NON_TRANSPOSE;
+    if (!is_analyzed_) {
+      size_t lower_size = 0, upper_size = 0;
+      cusparse.cpSpSV_createDescr(&lower_sv_);
+      cusparse.cpSpSV_createDescr(&upper_sv_);
+      cusparse.cpSpSV_bufferSize(
+          cusparse_handle_, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, lower_,
+          vec_r, vec_tmp, CUDA_R_32F, CUSPARSE_SPSV_ALG_DEFAULT, lower_sv_,
+          &lower_size);
+      cusparse.cpSpSV_bufferSize(cusparse_handle_, second_op, &alpha, second,
+                                 vec_tmp, vec_z, CUDA_R_32F,
+                                 CUSPARSE_SPSV_ALG_DEFAULT, upper_sv_,
+                                 &upper_size);
+      CUDADriver::get_instance().malloc(&lower_buffer_,
+                                        std::max(lower_size, size_t(1)));
+      CUDADriver::get_instance().malloc(&upper_buffer_,
+                                        std::max(upper_size, size_t(1)));
+      cusparse.cpSpSV_analysis(
+          cusparse_handle_, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, lower_,
+          vec_r, vec_tmp, CUDA_R_32F, CUSPARSE_SPSV_ALG_DEFAULT, lower_sv_,
+          lower_buffer_);
+      cusparse.cpSpSV_analysis(cusparse_handle_, second_op, &alpha, second,
+                               vec_tmp, vec_z, CUDA_R_32F,
+                               CUSPARSE_SPSV_ALG_DEFAULT, upper_sv_,
+                               upper_buffer_);
+      is_analyzed_ = true;
+    }
+    cusparse.cpSpSV_solve(cusparse_handle_, CUSPARSE_OPERATION_NON_TRANSPOSE,
+                          &alpha, lower_, vec_r, vec_tmp, CUDA_R_32F,
+                          CUSPARSE_SPSV_ALG_DEFAULT, lower_sv_);
+    cusparse.cpSpSV_solve(cusparse_handle_, second_op, &alpha, second,
+                          vec_tmp, vec_z, CUDA_R_32F,
+                          CUSPARSE_SPSV_ALG_DEFAULT, upper_sv_);
+    cusparse.cpDestroyDnVec(vec_tmp);
+  }
+  cusparse.cpDestroyDnVec(vec_r);
+  cusparse.cpDestroyDnVec(vec_z);
+#endif
+}
+
+namespace {
+// Eigen only has ILUT; without dropping and with a fill factor of one it
+// keeps about as many entries as A.
+template <typename T>
+class IncompleteLU0 : public Eigen::IncompleteLUT<T> {
+ public:
+  IncompleteLU0() {
+    this->setDroptol(0);
+    this->setFillfactor(1);
+  }
+};
+
+template <typename T>
+std::unique_ptr<SparsePreconditioner> make_eigen_preconditioner(
+    const std::string &preconditioner_type) {
+  using EigenMatrix = Eigen::SparseMatrix<T>;
+  if (preconditioner_type == "jacobi") {
+    return std::make_unique<EigenSparsePreconditioner<
+        Eigen::DiagonalPreconditioner<T>, EigenMatrix>>();
+  } else if (preconditioner_type == "ic0") {
+    using IC = Eigen::IncompleteCholesky<T, Eigen::Lower,
+                                         Eigen::NaturalOrdering<int>>;
+    return std::make_unique<EigenSparsePreconditioner<IC, EigenMatrix>>();
+  } else if (preconditioner_type == "ilu0") {
+    return std::make_unique<
+        EigenSparsePreconditioner<IncompleteLU0<T>, EigenMatrix>>();
+  }
+  TI_ERROR("Not supported sparse preconditioner type: {}",
+           preconditioner_type);
+}
+}  // namespace
+
+std::unique_ptr<SparsePreconditioner> make_sparse_preconditioner(
+    DataType dt,
+    const std::string &preconditioner_type) {
+  auto sdtype = taichi::lang::data_type_name(dt);
+  if (sdtype == "f32") {
+    return make_eigen_preconditioner<float32>(preconditioner_type);
+  } else if (sdtype == "f64") {
+    return make_eigen_preconditioner<float64>(preconditioner_type);
+  }
+  TI_ERROR("Not supported sparse preconditioner data type: {}", sdtype);
+}
+
+std::unique_ptr<SparsePreconditioner> make_cusparse_preconditioner(
+    DataType dt,
+    const std::string &preconditioner_type) {
+  TI_ERROR_IF(data_type_name(dt) != "f32",
+              "Sparse matrices on CUDA only support f32 for now.");
+  using Type = CuSparsePreconditioner::PreconditionerType;
+  if (preconditioner_type == "jacobi") {
+    return std::make_unique<CuSparsePreconditioner>(Type::Jacobi);
+  } else if (preconditioner_type == "ic0") {
+    return std::make_unique<CuSparsePreconditioner>(Type::IC0);
+  } else if (preconditioner_type == "ilu0") {
+    return std::make_unique<CuSparsePreconditioner>(Type::ILU0);
+  }
+  TI_ERROR("Not supported sparse preconditioner type: {}",
+           preconditioner_type);
+}
 }  // namespace taichi::lang
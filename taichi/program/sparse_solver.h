@@ -27,6 +27,18 @@ class SparseSolver {
   int cols_{0};
   DataType dtype_{PrimitiveType::f32};
   bool is_initialized_{false};
+  bool is_analyzed_{false};
+  // The sparsity pattern of the last matrix given to analyze_pattern().
+  uint64 pattern_fingerprint_{0};
+
+  // Records the pattern of |sm| and returns whether the symbolic analysis of
+  // the previous one can be reused for it.
+  bool reuse_analysis(const SparseMatrix &sm) {
+    auto fingerprint = sm.pattern_fingerprint();
+    bool reusable = is_analyzed_ && fingerprint == pattern_fingerprint_;
+    pattern_fingerprint_ = fingerprint;
+    return reusable;
+  }
 
  public:
   virtual ~SparseSolver() = default;
@@ -38,6 +50,14 @@ class SparseSolver {
   virtual bool compute(const SparseMatrix &sm) = 0;
   virtual void analyze_pattern(const SparseMatrix &sm) = 0;
   virtual void factorize(const SparseMatrix &sm) = 0;
+  // Solves with the last factorization for the ndarrays |b| and |x|, which
+  // have the precision of the solver.
+  virtual void solve_ndarray(Program *prog,
+                             const SparseMatrix &sm,
+                             const Ndarray &b,
+                             const Ndarray &x) {
+    TI_NOT_IMPLEMENTED;
+  }
   virtual bool info() = 0;
 };
 
@@ -59,6 +79,10 @@ class EigenSparseSolver : public SparseSolver {
                 const SparseMatrix &sm,
                 const Ndarray &b,
                 const Ndarray &x);
+  void solve_ndarray(Program *prog,
+                     const SparseMatrix &sm,
+                     const Ndarray &b,
+                     const Ndarray &x) override;
   bool info() override;
 };
 
@@ -88,7 +112,8 @@ class CuSparseSolver : public SparseSolver {
   cusparseMatDescr_t descr_{nullptr};
   void *gpu_buffer_{nullptr};
   void *cpu_buffer_{nullptr};
-  bool is_analyzed_{false};
+  size_t gpu_buffer_size_{0};
+  size_t cpu_buffer_size_{0};
   bool is_factorized_{false};
 
   int *h_Q_{
@@ -98,6 +123,7 @@ class CuSparseSolver : public SparseSolver {
   int *h_csrColIndB_{nullptr}; /* <int> nnzA */
   float *h_csrValB_{nullptr};  /* <float> nnzA */
   int *h_mapBfromA_{nullptr};  /* <int> nnzA */
+  int *d_mapBfromA_{nullptr};  /* <int> nnzA */
   int *d_csrRowPtrB_{nullptr}; /* <int> n+1 */
   int *d_csrColIndB_{nullptr}; /* <int> nnzA */
   float *d_csrValB_{nullptr};  /* <float> nnzA */
@@ -107,9 +133,8 @@ class CuSparseSolver : public SparseSolver {
     init_solver();
   }
   ~CuSparseSolver() override;
-  bool compute(const SparseMatrix &sm) override {
-    TI_NOT_IMPLEMENTED;
-  };
+  bool compute(const SparseMatrix &sm) override;
+  // Skipped when |sm| has the pattern of the last analyzed matrix.
   void analyze_pattern(const SparseMatrix &sm) override;
 
   void factorize(const SparseMatrix &sm) override;
@@ -117,6 +142,12 @@ class CuSparseSolver : public SparseSolver {
                 const SparseMatrix &sm,
                 const Ndarray &b,
                 const Ndarray &x);
+  void solve_ndarray(Program *prog,
+                     const SparseMatrix &sm,
+                     const Ndarray &b,
+                     const Ndarray &x) override {
+    solve_rf(prog, sm, b, x);
+  }
 
   bool info() override {
     TI_NOT_IMPLEMENTED;
@@ -124,7 +155,10 @@ class CuSparseSolver : public SparseSolver {
 
  private:
   void init_solver();
+  void release_pattern();
   void reorder(const CuSparseMatrix &sm);
+  // Gathers the values of A into the reordered matrix B.
+  void update_values(const CuSparseMatrix &A);
   void analyze_pattern_cholesky(const SparseMatrix &sm);
   void analyze_pattern_lu(const SparseMatrix &sm);
   void factorize_cholesky(const SparseMatrix &sm);
@@ -139,6 +173,137 @@ class CuSparseSolver : public SparseSolver {
                 const Ndarray &x);
 };
 
+/**
+ * Mixed-precision direct solver: the matrix is factorized in f32 by an inner
+ * solver, and the solution is refined in f64 with
+ *   x += A^-1 (b - A x)
+ * where A^-1 is the f32 factorization and the residual is computed in f64,
+ * until ||b - A x|| <= tol * ||b||. CuSparseMatrix only holds f32 values, so
+ * on CUDA this converges to the f64 solution of the f32 matrix.
+ */
+class MixedPrecisionSparseSolver : public SparseSolver {
+ public:
+  // |inner| is an f32 solver, for matrices on the device if |on_cuda|.
+  MixedPrecisionSparseSolver(std::unique_ptr<SparseSolver> inner, bool on_cuda)
+      : inner_(std::move(inner)), on_cuda_(on_cuda) {
+  }
+  bool compute(const SparseMatrix &sm) override;
+  void analyze_pattern(const SparseMatrix &sm) override;
+  void factorize(const SparseMatrix &sm) override;
+  void solve_rf(Program *prog,
+                const SparseMatrix &sm,
+                const Ndarray &b,
+                const Ndarray &x);
+  void solve_ndarray(Program *prog,
+                     const SparseMatrix &sm,
+                     const Ndarray &b,
+                     const Ndarray &x) override {
+    solve_rf(prog, sm, b, x);
+  }
+  // Whether the last solve reached the tolerance.
+  bool info() override {
+    return residual_ <= tol_;
+  }
+
+  void set_refinement(int max_iter, float64 tol) {
+    max_iter_ = max_iter;
+    tol_ = tol;
+  }
+  // The number of f32 solves and the relative residual of the last solve.
+  int num_iterations() const {
+    return num_iterations_;
+  }
+  float64 residual() const {
+    return residual_;
+  }
+
+ private:
+  // Updates |a64_|, and |a32_| off CUDA, from |sm|.
+  void convert(const SparseMatrix &sm);
+  // The f32 matrix that |inner_| deals with.
+  const SparseMatrix &inner_matrix(const SparseMatrix &sm) const {
+    return on_cuda_ ? sm : *a32_;
+  }
+  void read_ndarray(Program *prog, const Ndarray &nd, Eigen::VectorXd &v);
+  void write_ndarray(Program *prog, const Ndarray &nd, const Eigen::VectorXd &v);
+
+  std::unique_ptr<SparseSolver> inner_;
+  bool on_cuda_{false};
+  int max_iter_{20};
+  float64 tol_{1e-10};
+  int num_iterations_{0};
+  float64 residual_{0};
+  Eigen::SparseMatrix<float64, Eigen::RowMajor> a64_;
+  std::unique_ptr<SparseMatrix> a32_;
+  // f32 ndarrays for the residual and the correction.
+  std::unique_ptr<Ndarray> r32_;
+  std::unique_ptr<Ndarray> d32_;
+};
+
+/**
+ * Preconditioner M of the iterative solvers in taichi.linalg. It is applied
+ * to ndarrays living where the matrix does, so the solver iterations stay on
+ * the device.
+ */
+class SparsePreconditioner {
+ public:
+  virtual ~SparsePreconditioner() = default;
+  virtual void compute(const SparseMatrix &sm) = 0;
+  // Computes z = M^-1 r.
+  virtual void apply(Program *prog, const Ndarray &r, const Ndarray &z) = 0;
+};
+
+template <class EigenPreconditioner, class EigenMatrix>
+class EigenSparsePreconditioner : public SparsePreconditioner {
+ private:
+  EigenPreconditioner preconditioner_;
+  int rows_{0};
+
+ public:
+  void compute(const SparseMatrix &sm) override;
+  void apply(Program *prog, const Ndarray &r, const Ndarray &z) override;
+};
+
+class CuSparsePreconditioner : public SparsePreconditioner {
+ public:
+  enum class PreconditionerType { Jacobi, IC0, ILU0 };
+
+ private:
+  PreconditionerType type_{PreconditionerType::Jacobi};
+  int rows_{0};
+  cusparseHandle_t cusparse_handle_{nullptr};
+  // Jacobi: the inverse of the diagonal as a CSR matrix, applied with SpMV.
+  // IC0 and ILU0: the factors, stored in place in a copy of the matrix.
+  void *row_ptr_{nullptr};
+  void *col_ind_{nullptr};
+  void *val_{nullptr};
+  cusparseSpMatDescr_t inv_diag_{nullptr};
+  void *spmv_buffer_{nullptr};
+  size_t spmv_buffer_size_{0};
+  cusparseSpMatDescr_t lower_{nullptr};
+  cusparseSpMatDescr_t upper_{nullptr};
+  cusparseSpSVDescr_t lower_sv_{nullptr};
+  cusparseSpSVDescr_t upper_sv_{nullptr};
+  void *lower_buffer_{nullptr};
+  void *upper_buffer_{nullptr};
+  // The intermediate vector between the two triangular solves.
+  void *tmp_{nullptr};
+  bool is_analyzed_{false};
+
+ public:
+  explicit CuSparsePreconditioner(PreconditionerType type);
+  ~CuSparsePreconditioner() override;
+  void compute(const SparseMatrix &sm) override;
+  void apply(Program *prog, const Ndarray &r, const Ndarray &z) override;
+
+ private:
+  void release();
+  void compute_jacobi(const CuSparseMatrix &A);
+  void compute_incomplete_factorization(const CuSparseMatrix &A);
+};
+
+// The solver types prefixed by "Mixed", e.g. "MixedLLT", make a
+// MixedPrecisionSparseSolver around the f32 solver of the rest of the type.
 std::unique_ptr<SparseSolver> make_sparse_solver(DataType dt,
                                                  const std::string &solver_type,
                                                  const std::string &ordering);
@@ -147,4 +312,12 @@ std::unique_ptr<SparseSolver> make_cusparse_solver(
     DataType dt,
     const std::string &solver_type,
     const std::string &ordering);
+
+std::unique_ptr<SparsePreconditioner> make_sparse_preconditioner(
+    DataType dt,
+    const std::string &preconditioner_type);
+
+std::unique_ptr<SparsePreconditioner> make_cusparse_preconditioner(
+    DataType dt,
+    const std::string &preconditioner_type);
 }  // namespace taichi::lang
@@ -152,7 +152,8 @@ Texture::Texture(Program *prog,
                  BufferFormat format,
                  int width,
                  int height,
-                 int depth)
+                 int depth,
+                 int num_mip_levels)
     : format_(format),
       width_(width),
       height_(height),
@@ -167,6 +168,10 @@ Texture::Texture(Program *prog,
            depth);
 
   TI_ASSERT(num_channels > 0 && num_channels <= 4);
+  TI_ERROR_IF(num_mip_levels > 1 && prog_->this_thread_config().arch !=
+                                        Arch::vulkan,
+              "Mipmapped textures are only supported on Vulkan, got {}",
+              arch_name(prog_->this_thread_config().arch));
 
   ImageParams img_params{};
   img_params.dimension = depth > 1 ? ImageDimension::d3D : ImageDimension::d2D;
@@ -174,8 +179,10 @@ Texture::Texture(Program *prog,
   img_params.x = width;
   img_params.y = height;
   img_params.z = depth;
+  img_params.mip_levels = num_mip_levels;
   img_params.initial_layout = ImageLayout::undefined;
   texture_alloc_ = prog_->allocate_texture(img_params);
+  num_mip_levels_ = num_mip_levels;
 
   format_ = img_params.format;
 
@@ -200,18 +207,6 @@ intptr_t Texture::get_device_allocation_ptr_as_int() const {
 }
 
 void Texture::from_ndarray(Ndarray *ndarray) {
-  auto semaphore = prog_->flush();
-
-  GraphicsDevice *device =
-      static_cast<GraphicsDevice *>(prog_->get_graphics_device());
-
-  device->image_transition(texture_alloc_, ImageLayout::undefined,
-                           ImageLayout::transfer_dst);
-
-  Stream *stream = device->get_compute_stream();
-  auto [cmdlist, res] = stream->new_command_list_unique();
-  TI_ASSERT(res == RhiResult::success);
-
   BufferImageCopyParams params;
   params.buffer_row_length = ndarray->shape[0];
   params.buffer_image_height = ndarray->shape[1];
@@ -220,11 +215,13 @@ void Texture::from_ndarray(Ndarray *ndarray) {
   params.image_extent.y = height_;
   params.image_extent.z = depth_;
 
-  cmdlist->buffer_barrier(ndarray->ndarray_alloc_);
-  cmdlist->buffer_to_image(texture_alloc_, ndarray->ndarray_alloc_.get_ptr(0),
-                           ImageLayout::transfer_dst, params);
+  if (arch_uses_llvm(prog_->this_thread_config().arch)) {
+    prog_->get_program_impl()->copy_buffer_to_texture(
+        texture_alloc_, ndarray->ndarray_alloc_.get_ptr(0), params);
+    return;
+  }
 
-  stream->submit_synced(cmdlist.get(), {semaphore});
+  copy_buffer_to_texture(ndarray->ndarray_alloc_.get_ptr(0), params);
 }
 
 DevicePtr get_device_ptr(taichi::lang::Program *program, SNode *snode) {
@@ -238,22 +235,10 @@ DevicePtr get_device_ptr(taichi::lang::Program *program, SNode *snode) {
 }
 
 void Texture::from_snode(SNode *snode) {
-  auto semaphore = prog_->flush();
-
   TI_ASSERT(snode->is_path_all_dense);
 
-  GraphicsDevice *device =
-      static_cast<GraphicsDevice *>(prog_->get_graphics_device());
-
-  device->image_transition(texture_alloc_, ImageLayout::undefined,
-                           ImageLayout::transfer_dst);
-
   DevicePtr devptr = get_device_ptr(prog_, snode);
 
-  Stream *stream = device->get_compute_stream();
-  auto [cmdlist, res] = stream->new_command_list_unique();
-  TI_ASSERT(res == RhiResult::success);
-
   BufferImageCopyParams params;
   params.buffer_row_length = snode->shape_along_axis(0);
   params.buffer_image_height = snode->shape_along_axis(1);
@@ -262,18 +247,48 @@ void Texture::from_snode(SNode *snode) {
   params.image_extent.y = height_;
   params.image_extent.z = depth_;
 
-  cmdlist->buffer_barrier(devptr);
-  cmdlist->buffer_to_image(texture_alloc_, devptr, ImageLayout::transfer_dst,
-                           params);
+  if (arch_uses_llvm(prog_->this_thread_config().arch)) {
+    prog_->get_program_impl()->copy_buffer_to_texture(texture_alloc_, devptr,
+                                                      params);
+    return;
+  }
+
+  copy_buffer_to_texture(devptr, params);
+}
 
-  stream->submit_synced(cmdlist.get(), {semaphore});
+void Texture::copy_buffer_to_texture(DevicePtr src,
+                                     const BufferImageCopyParams &params) {
+  // Goes through the runtime, which tracks the layout of the texture for the
+  // kernels and mip generations after it.
+  DeviceAllocation texture = texture_alloc_;
+  prog_->enqueue_compute_op_lambda(
+      [texture, src, params](Device *device, CommandList *cmdlist) {
+        cmdlist->buffer_barrier(src);
+        cmdlist->buffer_to_image(texture, src, ImageLayout::transfer_dst,
+                                 params);
+      },
+      {ComputeOpImageRef{texture, ImageLayout::transfer_dst,
+                         ImageLayout::transfer_dst}});
+}
+
+void Texture::generate_mipmaps() {
+  if (num_mip_levels_ <= 1) {
+    return;
+  }
+  // Ordered after the kernels and copies writing the first level, which are
+  // tracked by the runtime together with the layout of the texture.
+  DeviceAllocation texture = texture_alloc_;
+  prog_->enqueue_compute_op_lambda(
+      [texture](Device *device, CommandList *cmdlist) {
+        cmdlist->generate_mipmaps(texture, ImageLayout::transfer_dst);
+      },
+      {ComputeOpImageRef{texture, ImageLayout::transfer_dst,
+                         ImageLayout::transfer_dst}});
 }
 
 Texture::~Texture() {
   if (prog_) {
-    GraphicsDevice *device =
-        static_cast<GraphicsDevice *>(prog_->get_graphics_device());
-    device->destroy_image(texture_alloc_);
+    prog_->get_program_impl()->deallocate_texture(texture_alloc_);
   }
 }
 
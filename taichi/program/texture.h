@@ -26,7 +26,8 @@ class TI_DLL_EXPORT Texture {
                    BufferFormat format,
                    int width,
                    int height,
-                   int depth = 1);
+                   int depth = 1,
+                   int num_mip_levels = 1);
 
   /* Constructs a Texture from an existing DeviceAllocation
    * It doesn't handle the allocation and deallocation.
@@ -43,6 +44,11 @@ class TI_DLL_EXPORT Texture {
 
   void from_snode(SNode *snode);
 
+  /* Fills the mip levels but the first one by downsampling the first one,
+   * after the writes submitted so far.
+   */
+  void generate_mipmaps();
+
   DeviceAllocation get_device_allocation() const {
     return texture_alloc_;
   }
@@ -57,7 +63,14 @@ class TI_DLL_EXPORT Texture {
     return {width_, height_, depth_};
   }
 
+  int get_num_mip_levels() const {
+    return num_mip_levels_;
+  }
+
  private:
+  void copy_buffer_to_texture(DevicePtr src,
+                              const BufferImageCopyParams &params);
+
   DeviceAllocation texture_alloc_{kDeviceNullAllocation};
   DataType dtype_;
   BufferFormat format_;
@@ -65,6 +78,7 @@ class TI_DLL_EXPORT Texture {
   int width_;
   int height_;
   int depth_;
+  int num_mip_levels_{1};
 
   Program *prog_{nullptr};
 };
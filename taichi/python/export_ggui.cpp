@@ -206,13 +206,15 @@ struct PyScene {
                  py::tuple color_,
                  float radius,
                  float draw_vertex_count,
-                 float draw_first_vertex) {
+                 float draw_first_vertex,
+                 FieldInfo draw_args) {
     RenderableInfo renderable_info;
     renderable_info.vbo = vbo;
     renderable_info.has_user_customized_draw = true;
     renderable_info.has_per_vertex_color = has_per_vertex_color;
     renderable_info.draw_vertex_count = (int)draw_vertex_count;
     renderable_info.draw_first_vertex = (int)draw_first_vertex;
+    renderable_info.draw_args = draw_args;
 
     ParticlesInfo info;
     info.renderable_info = renderable_info;
@@ -234,7 +236,8 @@ struct PyScene {
                      float draw_first_index,
                      float draw_vertex_count,
                      float draw_first_vertex,
-                     bool show_wireframe) {
+                     bool show_wireframe,
+                     FieldInfo draw_args) {
     RenderableInfo renderable_info;
     renderable_info.vbo = vbo;
     renderable_info.has_per_vertex_color = has_per_vertex_color;
@@ -247,6 +250,7 @@ struct PyScene {
     renderable_info.display_mode = show_wireframe
                                        ? taichi::lang::PolygonMode::Line
                                        : taichi::lang::PolygonMode::Fill;
+    renderable_info.draw_args = draw_args;
 
     MeshInfo info;
     info.renderable_info = renderable_info;
@@ -362,7 +366,8 @@ struct PyWindow {
            bool vsync,
            bool show_window,
            std::string package_path,
-           Arch ti_arch) {
+           Arch ti_arch,
+           bool pipelined) {
     AppConfig config = {name,
                         res[0].cast<int>(),
                         res[1].cast<int>(),
@@ -371,7 +376,8 @@ struct PyWindow {
                         vsync,
                         show_window,
                         package_path,
-                        ti_arch};
+                        ti_arch,
+                        pipelined};
     // todo: support other ggui backends
     if (!(taichi::arch_is_cpu(ti_arch) || ti_arch == Arch::vulkan ||
           ti_arch == Arch::cuda)) {
@@ -429,6 +435,22 @@ struct PyWindow {
         image, free_imgae);
   }
 
+  void start_capture(const std::string &filename_pattern,
+                     const std::string &pipe_command,
+                     int num_readback_slots,
+                     int num_workers) {
+    FrameCaptureConfig config;
+    config.filename_pattern = filename_pattern;
+    config.pipe_command = pipe_command;
+    config.num_readback_slots = num_readback_slots;
+    config.num_workers = num_workers;
+    window->start_capture(config);
+  }
+
+  void stop_capture() {
+    window->stop_capture();
+  }
+
   void show() {
     window->show();
   }
@@ -490,7 +512,7 @@ void export_ggui(py::module &m) {
 
   py::class_<PyWindow>(m, "PyWindow")
       .def(py::init<Program *, std::string, py::tuple, py::tuple, bool, bool,
-                    std::string, Arch>())
+                    std::string, Arch, bool>())
       .def("get_canvas", &PyWindow::get_canvas)
       .def("show", &PyWindow::show)
       .def("get_window_shape", &PyWindow::get_window_shape)
@@ -498,6 +520,8 @@ void export_ggui(py::module &m) {
       .def("copy_depth_buffer_to_ndarray",
            &PyWindow::copy_depth_buffer_to_ndarray)
       .def("get_image_buffer_as_numpy", &PyWindow::get_image_buffer)
+      .def("start_capture", &PyWindow::start_capture)
+      .def("stop_capture", &PyWindow::stop_capture)
       .def("is_pressed", &PyWindow::is_pressed)
       .def("get_cursor_pos", &PyWindow::py_get_cursor_pos)
       .def("is_running", &PyWindow::is_running)
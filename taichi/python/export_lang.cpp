@@ -14,8 +14,10 @@
 #include "pybind11/numpy.h"
 
 #include "taichi/ir/expression_ops.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/frontend_ir.h"
 #include "taichi/ir/statements.h"
+#include "taichi/program/dlpack_funcs.h"
 #include "taichi/program/graph_builder.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/ndarray.h"
@@ -23,11 +25,14 @@
 #include "taichi/math/svd.h"
 #include "taichi/util/action_recorder.h"
 #include "taichi/system/timeline.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/python/snode_registry.h"
+#include "taichi/program/snapshot.h"
 #include "taichi/program/sparse_matrix.h"
 #include "taichi/program/sparse_solver.h"
 #include "taichi/aot/graph_data.h"
 #include "taichi/ir/mesh.h"
+#include "taichi/ir/mesh_patcher.h"
 
 #include "taichi/program/kernel_profiler.h"
 
@@ -44,6 +49,84 @@ namespace taichi::lang {
 
 std::string libdevice_path();
 
+namespace {
+
+// Holds a reference to |obj| that can be dropped without the GIL.
+std::shared_ptr<void> keep_alive(py::object obj) {
+  return std::shared_ptr<void>(new py::object(std::move(obj)), [](void *p) {
+    py::gil_scoped_acquire gil;
+    delete static_cast<py::object *>(p);
+  });
+}
+
+// Wraps |tensor| in a PyCapsule following the DLPack Python protocol: the
+// tensor is deleted with the capsule unless a consumer renamed it.
+py::object make_dlpack_capsule(DLManagedTensor *tensor) {
+  PyObject *capsule =
+      PyCapsule_New(tensor, "dltensor", [](PyObject *capsule) {
+        if (PyCapsule_IsValid(capsule, "dltensor")) {
+          auto *t = static_cast<DLManagedTensor *>(
+              PyCapsule_GetPointer(capsule, "dltensor"));
+          if (t->deleter) {
+            t->deleter(t);
+          }
+        }
+      });
+  if (capsule == nullptr) {
+    tensor->deleter(tensor);
+    throw py::error_already_set();
+  }
+  return py::reinterpret_steal<py::object>(capsule);
+}
+
+template <typename T>
+py::array_t<T> to_array(const std::vector<T> &v) {
+  return py::array_t<T>(v.size(), v.data());
+}
+
+// The layout of the metadata loaded by ti.Mesh.generate_meta().
+py::dict patched_mesh_to_dict(const mesh::PatchedMesh &patched) {
+  py::list elements, relations;
+  for (const auto &e : patched.elements) {
+    py::dict element;
+    element["order"] = e.order;
+    element["num"] = e.num;
+    element["max_num_per_patch"] = e.max_num_per_patch;
+    element["owned_offsets"] = to_array(e.owned_offsets);
+    element["total_offsets"] = to_array(e.total_offsets);
+    element["l2g_mapping"] = to_array(e.l2g_mapping);
+    element["l2r_mapping"] = to_array(e.l2r_mapping);
+    element["g2r_mapping"] = to_array(e.g2r_mapping);
+    if (!e.owned_nums.empty()) {
+      element["owned_nums"] = to_array(e.owned_nums);
+      element["total_nums"] = to_array(e.total_nums);
+    }
+    elements.append(element);
+  }
+  for (const auto &r : patched.relations) {
+    py::dict relation;
+    relation["from_order"] = r.from_order;
+    relation["to_order"] = r.to_order;
+    relation["value"] = to_array(r.value);
+    if (r.from_order <= r.to_order) {
+      relation["offset"] = to_array(r.offset);
+      relation["patch_offset"] = to_array(r.patch_offset);
+    }
+    relations.append(relation);
+  }
+  py::dict data;
+  data["num_patches"] = patched.num_patches;
+  data["elements"] = elements;
+  data["relations"] = relations;
+  return data;
+}
+
+py::tuple scatter_to_tuple(const mesh::DynamicPatchedMesh::Scatter &scatter) {
+  return py::make_tuple(to_array(scatter.indices), to_array(scatter.values));
+}
+
+}  // namespace
+
 }  // namespace taichi::lang
 
 namespace taichi {
@@ -111,6 +194,10 @@ void export_lang(py::module &m) {
       .def("__str__", &DataType::to_string)
       .def("shape", &DataType::get_shape)
       .def("element_type", &DataType::get_element_type)
+      .def("compute_type",
+           [](DataType *dtype) -> DataType {
+             return (*dtype)->get_compute_type();
+           })
       .def(
           "get_ptr", [](DataType *dtype) -> Type * { return *dtype; },
           py::return_value_policy::reference)
@@ -161,6 +248,8 @@ void export_lang(py::module &m) {
                      &CompileConfig::move_loop_invariant_outside_if)
       .def_readwrite("cache_loop_invariant_global_vars",
                      &CompileConfig::cache_loop_invariant_global_vars)
+      .def_readwrite("cache_loop_carried_global_loads",
+                     &CompileConfig::cache_loop_carried_global_loads)
       .def_readwrite("default_cpu_block_dim",
                      &CompileConfig::default_cpu_block_dim)
       .def_readwrite("cpu_block_dim_adaptive",
@@ -171,14 +260,31 @@ void export_lang(py::module &m) {
       .def_readwrite("saturating_grid_dim", &CompileConfig::saturating_grid_dim)
       .def_readwrite("max_block_dim", &CompileConfig::max_block_dim)
       .def_readwrite("cpu_max_num_threads", &CompileConfig::cpu_max_num_threads)
+      .def_readwrite("cpu_work_stealing", &CompileConfig::cpu_work_stealing)
+      .def_readwrite("cpu_pin_threads", &CompileConfig::cpu_pin_threads)
+      .def_readwrite("cpu_tls_per_thread", &CompileConfig::cpu_tls_per_thread)
+      .def_readwrite("cpu_vectorize_width",
+                     &CompileConfig::cpu_vectorize_width)
+      .def_readwrite("cpu_shared_runtime", &CompileConfig::cpu_shared_runtime)
       .def_readwrite("random_seed", &CompileConfig::random_seed)
+      .def_readwrite("counter_based_rand", &CompileConfig::counter_based_rand)
       .def_readwrite("verbose_kernel_launches",
                      &CompileConfig::verbose_kernel_launches)
+      .def_readwrite("async_launch", &CompileConfig::async_launch)
+      .def_readwrite("async_launch_window",
+                     &CompileConfig::async_launch_window)
+      .def_readwrite("sync_after_print", &CompileConfig::sync_after_print)
+      .def_readwrite("print_buffer_size", &CompileConfig::print_buffer_size)
       .def_readwrite("verbose", &CompileConfig::verbose)
       .def_readwrite("demote_dense_struct_fors",
                      &CompileConfig::demote_dense_struct_fors)
+      .def_readwrite("fuse_offloads", &CompileConfig::fuse_offloads)
+      .def_readwrite("struct_for_tile_size",
+                     &CompileConfig::struct_for_tile_size)
       .def_readwrite("kernel_profiler", &CompileConfig::kernel_profiler)
       .def_readwrite("timeline", &CompileConfig::timeline)
+      .def_readwrite("compile_profiler", &CompileConfig::compile_profiler)
+      .def_readwrite("worklist_simplify", &CompileConfig::worklist_simplify)
       .def_readwrite("default_fp", &CompileConfig::default_fp)
       .def_readwrite("default_ip", &CompileConfig::default_ip)
       .def_readwrite("default_up", &CompileConfig::default_up)
@@ -189,12 +295,19 @@ void export_lang(py::module &m) {
       .def_readwrite("advanced_optimization",
                      &CompileConfig::advanced_optimization)
       .def_readwrite("ad_stack_size", &CompileConfig::ad_stack_size)
+      .def_readwrite("ad_stack_memory_budget",
+                     &CompileConfig::ad_stack_memory_budget)
+      .def_readwrite("ad_stack_window_size",
+                     &CompileConfig::ad_stack_window_size)
+      .def_readwrite("forward_ad_lanes", &CompileConfig::forward_ad_lanes)
       .def_readwrite("flatten_if", &CompileConfig::flatten_if)
       .def_readwrite("make_thread_local", &CompileConfig::make_thread_local)
       .def_readwrite("make_block_local", &CompileConfig::make_block_local)
       .def_readwrite("detect_read_only", &CompileConfig::detect_read_only)
       .def_readwrite("ndarray_use_cached_allocator",
                      &CompileConfig::ndarray_use_cached_allocator)
+      .def_readwrite("ndarray_use_managed_memory",
+                     &CompileConfig::ndarray_use_managed_memory)
       .def_readwrite("real_matrix_scalarize",
                      &CompileConfig::real_matrix_scalarize)
       .def_readwrite("cc_compile_cmd", &CompileConfig::cc_compile_cmd)
@@ -205,6 +318,8 @@ void export_lang(py::module &m) {
                      &CompileConfig::quant_opt_atomic_demotion)
       .def_readwrite("allow_nv_shader_extension",
                      &CompileConfig::allow_nv_shader_extension)
+      .def_readwrite("make_ndarray_block_local",
+                     &CompileConfig::make_ndarray_block_local)
       .def_readwrite("make_mesh_block_local",
                      &CompileConfig::make_mesh_block_local)
       .def_readwrite("mesh_localize_to_end_mapping",
@@ -230,9 +345,53 @@ void export_lang(py::module &m) {
                      &CompileConfig::offline_cache_max_size_of_files)
       .def_readwrite("offline_cache_cleaning_factor",
                      &CompileConfig::offline_cache_cleaning_factor)
+      .def_readwrite("offline_cache_packed",
+                     &CompileConfig::offline_cache_packed)
+      .def_readwrite("offline_cache_shared",
+                     &CompileConfig::offline_cache_shared)
+      .def_readwrite("offline_cache_compile_lease_ms",
+                     &CompileConfig::offline_cache_compile_lease_ms)
+      .def_readwrite("offline_cache_tasks",
+                     &CompileConfig::offline_cache_tasks)
+      .def_readwrite("offline_cache_native_code",
+                     &CompileConfig::offline_cache_native_code)
+      .def_readwrite("offline_cache_remote_url",
+                     &CompileConfig::offline_cache_remote_url)
+      .def_readwrite("in_process_kernel_cache",
+                     &CompileConfig::in_process_kernel_cache)
+      .def_readwrite("specialize_ndarray_shapes",
+                     &CompileConfig::specialize_ndarray_shapes)
       .def_readwrite("num_compile_threads", &CompileConfig::num_compile_threads)
+      .def_readwrite("llvm_split_kernel_module",
+                     &CompileConfig::llvm_split_kernel_module)
+      .def_readwrite("tiered_compilation", &CompileConfig::tiered_compilation)
+      .def_readwrite("tiered_compilation_threshold",
+                     &CompileConfig::tiered_compilation_threshold)
+      .def_readwrite("pgo_instrument", &CompileConfig::pgo_instrument)
+      .def_readwrite("pgo_use", &CompileConfig::pgo_use)
+      .def_readwrite("pgo_profile_dir", &CompileConfig::pgo_profile_dir)
+      .def_readwrite("gpu_autotune_block_dim",
+                     &CompileConfig::gpu_autotune_block_dim)
+      .def_readwrite("gpu_tune_max_reg", &CompileConfig::gpu_tune_max_reg)
+      .def_readwrite("gpu_warp_aggregated_atomics",
+                     &CompileConfig::gpu_warp_aggregated_atomics)
+      .def_readwrite("gpu_persistent_kernel",
+                     &CompileConfig::gpu_persistent_kernel)
+      .def_readwrite("gpu_fuse_serial_tasks",
+                     &CompileConfig::gpu_fuse_serial_tasks)
       .def_readwrite("vk_api_version", &CompileConfig::vk_api_version)
-      .def_readwrite("cuda_stack_limit", &CompileConfig::cuda_stack_limit);
+      .def_readwrite("gfx_max_pending_dispatches",
+                     &CompileConfig::gfx_max_pending_dispatches)
+      .def_readwrite("gfx_max_pending_invocations",
+                     &CompileConfig::gfx_max_pending_invocations)
+      .def_readwrite("gfx_max_pending_time_us",
+                     &CompileConfig::gfx_max_pending_time_us)
+      .def_readwrite("gfx_target_device_time_us",
+                     &CompileConfig::gfx_target_device_time_us)
+      .def_readwrite("cuda_stack_limit", &CompileConfig::cuda_stack_limit)
+      .def_readwrite("cuda_aot_archs", &CompileConfig::cuda_aot_archs)
+      .def_readwrite("cached_allocator_high_water_mark",
+                     &CompileConfig::cached_allocator_high_water_mark);
 
   m.def("reset_default_compile_config",
         [&]() { default_compile_config = CompileConfig(); });
@@ -251,6 +410,8 @@ void export_lang(py::module &m) {
   py::class_<KernelProfileTracedRecord>(m, "KernelProfileTracedRecord")
       .def_readwrite("register_per_thread",
                      &KernelProfileTracedRecord::register_per_thread)
+      .def_readwrite("local_mem_per_thread",
+                     &KernelProfileTracedRecord::local_mem_per_thread)
       .def_readwrite("shared_mem_per_block",
                      &KernelProfileTracedRecord::shared_mem_per_block)
       .def_readwrite("grid_size", &KernelProfileTracedRecord::grid_size)
@@ -258,6 +419,7 @@ void export_lang(py::module &m) {
       .def_readwrite(
           "active_blocks_per_multiprocessor",
           &KernelProfileTracedRecord::active_blocks_per_multiprocessor)
+      .def_readwrite("occupancy", &KernelProfileTracedRecord::occupancy)
       .def_readwrite("kernel_time",
                      &KernelProfileTracedRecord::kernel_elapsed_time_in_ms)
       .def_readwrite("base_time", &KernelProfileTracedRecord::time_since_base)
@@ -265,6 +427,55 @@ void export_lang(py::module &m) {
       .def_readwrite("metric_values",
                      &KernelProfileTracedRecord::metric_values);
 
+  py::class_<TaskCost>(m, "TaskCost")
+      .def_readonly("flops_per_iteration", &TaskCost::flops_per_iteration)
+      .def_readonly("bytes_per_iteration", &TaskCost::bytes_per_iteration)
+      .def_readonly("num_iterations", &TaskCost::num_iterations)
+      .def_readonly("is_lower_bound", &TaskCost::is_lower_bound);
+
+  py::class_<SNodeMemoryStats>(m, "SNodeMemoryStats")
+      .def_readonly("snode_id", &SNodeMemoryStats::snode_id)
+      .def_readonly("tree_id", &SNodeMemoryStats::tree_id)
+      .def_readonly("name", &SNodeMemoryStats::name)
+      .def_readonly("element_list_length",
+                    &SNodeMemoryStats::element_list_length)
+      .def_readonly("element_list_bytes", &SNodeMemoryStats::element_list_bytes)
+      .def_readonly("node_size", &SNodeMemoryStats::node_size)
+      .def_readonly("num_allocated_nodes",
+                    &SNodeMemoryStats::num_allocated_nodes)
+      .def_readonly("data_bytes", &SNodeMemoryStats::data_bytes)
+      .def_readonly("num_free_nodes", &SNodeMemoryStats::num_free_nodes)
+      .def_readonly("num_recycled_nodes", &SNodeMemoryStats::num_recycled_nodes)
+      .def_readonly("free_list_bytes", &SNodeMemoryStats::free_list_bytes)
+      .def_property_readonly("num_active_nodes",
+                             &SNodeMemoryStats::num_active_nodes)
+      .def_property_readonly("fragmentation",
+                             &SNodeMemoryStats::fragmentation);
+
+  py::class_<MemoryStats>(m, "MemoryStats")
+      .def_readonly("snodes", &MemoryStats::snodes)
+      .def_readonly("snode_tree_bytes", &MemoryStats::snode_tree_bytes)
+      .def_readonly("runtime_requested_bytes",
+                    &MemoryStats::runtime_requested_bytes)
+      .def_readonly("num_ndarrays", &MemoryStats::num_ndarrays)
+      .def_readonly("ndarray_bytes", &MemoryStats::ndarray_bytes)
+      .def_readonly("cached_allocated_bytes",
+                    &MemoryStats::cached_allocated_bytes)
+      .def_readonly("cached_reserved_bytes",
+                    &MemoryStats::cached_reserved_bytes);
+
+  py::class_<CompileProfiler::Record>(m, "CompileProfilerRecord")
+      .def_readonly("kernel_name", &CompileProfiler::Record::kernel_name)
+      .def_readonly("pass_name", &CompileProfiler::Record::pass_name)
+      .def_readonly("begin_time", &CompileProfiler::Record::begin_time)
+      .def_readonly("end_time", &CompileProfiler::Record::end_time)
+      .def_readonly("num_statements_before",
+                    &CompileProfiler::Record::num_statements_before)
+      .def_readonly("num_statements_after",
+                    &CompileProfiler::Record::num_statements_after)
+      .def_readonly("code_size", &CompileProfiler::Record::code_size)
+      .def_readonly("peak_memory", &CompileProfiler::Record::peak_memory);
+
   py::enum_<SNodeAccessFlag>(m, "SNodeAccessFlag", py::arithmetic())
       .value("block_local", SNodeAccessFlag::block_local)
       .value("read_only", SNodeAccessFlag::read_only)
@@ -323,6 +534,9 @@ void export_lang(py::module &m) {
       .def("parallelize", &ASTBuilder::parallelize)
       .def("strictly_serialize", &ASTBuilder::strictly_serialize)
       .def("block_dim", &ASTBuilder::block_dim)
+      .def("tile_shape", &ASTBuilder::tile_shape)
+      .def("sort_elements", &ASTBuilder::sort_elements)
+      .def("balance_elements", &ASTBuilder::balance_elements)
       .def("insert_snode_access_flag", &ASTBuilder::insert_snode_access_flag)
       .def("reset_snode_access_flag", &ASTBuilder::reset_snode_access_flag);
 
@@ -343,9 +557,28 @@ void export_lang(py::module &m) {
            [](Program *program) {
              return program->profiler->get_traced_records();
            })
+      .def("get_kernel_profiler_counters",
+           [](Program *program) { return program->profiler->get_counters(); })
       .def(
           "get_kernel_profiler_device_name",
           [](Program *program) { return program->profiler->get_device_name(); })
+      .def("get_kernel_profiler_device_peaks",
+           [](Program *program) -> std::optional<std::pair<double, double>> {
+             double gbps = 0, gflops = 0;
+             if (!program->profiler->get_device_peaks(gbps, gflops)) {
+               return std::nullopt;
+             }
+             return std::make_pair(gbps, gflops);
+           })
+      .def("get_task_cost",
+           [](Program *, const std::string &task_name)
+               -> std::optional<TaskCost> {
+             TaskCost cost;
+             if (!KernelProfilerBase::get_task_cost(task_name, cost)) {
+               return std::nullopt;
+             }
+             return cost;
+           })
       .def("get_compute_stream_device_time_elapsed_us",
            [](Program *program) {
              return program->get_compute_device()
@@ -368,12 +601,27 @@ void export_lang(py::module &m) {
            [](Program *, const std::string &fn) {
              Timelines::get_instance().save(fn);
            })
+      .def("get_compile_profiler_records",
+           [](Program *) {
+             return CompileProfiler::get_instance().get_records();
+           })
+      .def("get_compile_profiler_kernel_keys",
+           [](Program *) {
+             return CompileProfiler::get_instance().get_kernel_keys();
+           })
+      .def("clear_compile_profiler",
+           [](Program *) { CompileProfiler::get_instance().clear(); })
+      .def("print_compile_profiler_info",
+           [](Program *) { CompileProfiler::get_instance().print_summary(); })
       .def("print_memory_profiler_info", &Program::print_memory_profiler_info)
       .def("finalize", &Program::finalize)
       .def("get_total_compilation_time", &Program::get_total_compilation_time)
       .def("get_snode_num_dynamically_allocated",
            &Program::get_snode_num_dynamically_allocated)
+      .def("get_memory_stats", &Program::get_memory_stats)
       .def("synchronize", &Program::synchronize)
+      .def("set_launch_stream", &Program::set_launch_stream)
+      .def("get_launch_stream", &Program::get_launch_stream)
       .def("materialize_runtime", &Program::materialize_runtime)
       .def("make_aot_module_builder", &Program::make_aot_module_builder)
       .def("get_snode_tree_size", &Program::get_snode_tree_size)
@@ -389,23 +637,37 @@ void export_lang(py::module &m) {
           py::return_value_policy::reference)
       .def("create_function", &Program::create_function,
            py::return_value_policy::reference)
+      .def("compile_kernels",
+           [](Program *program, const CompileConfig &compile_config,
+              const std::vector<Kernel *> &kernels) {
+             py::gil_scoped_release release;
+             program->compile_kernels(compile_config, kernels);
+           })
+      .def("warm_up_kernels", &Program::warm_up_kernels)
+      .def("wait_for_warm_up", &Program::wait_for_warm_up,
+           py::call_guard<py::gil_scoped_release>())
       .def("create_sparse_matrix_builder",
            [](Program *program, int n, int m, uint64 max_num_entries,
-              DataType dtype, const std::string &storage_format) {
+              DataType dtype, const std::string &storage_format,
+              bool reuse_pattern, bool parallel, int block_size) {
              TI_ERROR_IF(!arch_is_cpu(program->this_thread_config().arch) &&
                              !arch_is_cuda(program->this_thread_config().arch),
                          "SparseMatrix only supports CPU and CUDA for now.");
              return SparseMatrixBuilder(n, m, max_num_entries, dtype,
-                                        storage_format, program);
+                                        storage_format, program,
+                                        reuse_pattern, parallel, block_size);
            })
       .def("create_sparse_matrix",
            [](Program *program, int n, int m, DataType dtype,
-              std::string storage_format) {
+              std::string storage_format, bool parallel) {
              TI_ERROR_IF(!arch_is_cpu(program->this_thread_config().arch) &&
                              !arch_is_cuda(program->this_thread_config().arch),
                          "SparseMatrix only supports CPU and CUDA for now.");
              if (arch_is_cpu(program->this_thread_config().arch))
-               return make_sparse_matrix(n, m, dtype, storage_format);
+               return make_sparse_matrix(
+                   n, m, dtype, storage_format,
+                   parallel ? make_sparse_thread_pool(program)
+                            : SparseThreadPool{});
              else
                return make_cu_sparse_matrix(n, m, dtype);
            })
@@ -431,18 +693,77 @@ void export_lang(py::module &m) {
           py::arg("layout") = ExternalArrayLayout::kNull,
           py::arg("zero_fill") = false, py::return_value_policy::reference)
       .def("delete_ndarray", &Program::delete_ndarray)
+      .def("create_out_of_core_ndarray",
+           &Program::create_out_of_core_ndarray, py::arg("dt"),
+           py::arg("shape"), py::arg("path") = "", py::arg("tile_rows") = 0,
+           py::return_value_policy::reference)
+      .def("delete_out_of_core_ndarray", &Program::delete_out_of_core_ndarray)
+      .def(
+          "save_snapshot",
+          [](Program *program, const std::string &path,
+             const std::vector<Ndarray *> &ndarrays, bool compress) {
+            py::gil_scoped_release release;
+            save_snapshot(program, path, ndarrays, compress);
+          },
+          py::arg("path"), py::arg("ndarrays"), py::arg("compress") = false)
+      .def(
+          "load_snapshot",
+          [](Program *program, const std::string &path,
+             const std::vector<Ndarray *> &ndarrays) {
+            py::gil_scoped_release release;
+            load_snapshot(program, path, ndarrays);
+          },
+          py::arg("path"), py::arg("ndarrays"))
       .def(
           "create_texture",
           [&](Program *program, const DataType &dt, int num_channels,
-              const std::vector<int> &shape) -> Texture * {
-            return program->create_texture(dt, num_channels, shape);
+              const std::vector<int> &shape,
+              int num_mip_levels) -> Texture * {
+            return program->create_texture(dt, num_channels, shape,
+                                           num_mip_levels);
           },
           py::arg("dt"), py::arg("num_channels"),
-          py::arg("shape") = py::tuple(), py::return_value_policy::reference)
+          py::arg("shape") = py::tuple(), py::arg("num_mip_levels") = 1,
+          py::return_value_policy::reference)
       .def("get_ndarray_data_ptr_as_int",
            [](Program *program, Ndarray *ndarray) {
              return program->get_ndarray_data_ptr_as_int(ndarray);
            })
+      .def(
+          "ndarray_from_dlpack",
+          [](Program *program, py::object capsule) -> Ndarray * {
+            auto *tensor = static_cast<DLManagedTensor *>(
+                PyCapsule_GetPointer(capsule.ptr(), "dltensor"));
+            if (tensor == nullptr) {
+              throw py::error_already_set();
+            }
+            auto *ndarray = ndarray_from_dlpack(program, tensor);
+            // The ndarray owns the tensor from now on.
+            PyCapsule_SetName(capsule.ptr(), "used_dltensor");
+            return ndarray;
+          },
+          py::return_value_policy::reference)
+      .def("ndarray_to_dlpack",
+           [](Program *program, py::object owner, Ndarray *ndarray) {
+             return make_dlpack_capsule(
+                 ndarray_to_dlpack(program, ndarray, keep_alive(owner)));
+           })
+      .def("get_ndarray_ipc_handle",
+           [](Program *program, Ndarray *ndarray) {
+             return py::bytes(program->get_ndarray_ipc_handle(ndarray));
+           })
+      .def(
+          "import_ndarray_from_ipc_handle",
+          [](Program *program, py::bytes handle, const DataType &dt,
+             const std::vector<int> &shape) -> Ndarray * {
+            return program->import_ndarray_from_ipc_handle(handle, dt, shape);
+          },
+          py::return_value_policy::reference)
+      .def("field_to_dlpack",
+           [](Program *program, py::object owner, SNode *snode) {
+             return make_dlpack_capsule(
+                 field_to_dlpack(program, snode, keep_alive(owner)));
+           })
       .def("fill_float",
            [](Program *program, Ndarray *ndarray, float val) {
              program->fill_ndarray_fast_u32(ndarray,
@@ -453,14 +774,37 @@ void export_lang(py::module &m) {
              program->fill_ndarray_fast_u32(ndarray,
                                             reinterpret_cast<int32_t &>(val));
            })
-      .def("fill_uint", [](Program *program, Ndarray *ndarray, uint32_t val) {
-        program->fill_ndarray_fast_u32(ndarray, val);
-      });
+      .def("fill_uint",
+           [](Program *program, Ndarray *ndarray, uint32_t val) {
+             program->fill_ndarray_fast_u32(ndarray, val);
+           })
+      .def("fill_float_async",
+           [](Program *program, Ndarray *ndarray, float val) {
+             return program->fill_ndarray_fast_u32_async(
+                 ndarray, reinterpret_cast<uint32_t &>(val));
+           })
+      .def("fill_int_async",
+           [](Program *program, Ndarray *ndarray, int32_t val) {
+             return program->fill_ndarray_fast_u32_async(
+                 ndarray, reinterpret_cast<int32_t &>(val));
+           })
+      .def("fill_uint_async",
+           [](Program *program, Ndarray *ndarray, uint32_t val) {
+             return program->fill_ndarray_fast_u32_async(ndarray, val);
+           })
+      .def("copy_ndarray_async", &Program::copy_ndarray_async)
+      .def("copy_ndarray_rows_async", &Program::copy_ndarray_rows_async)
+      .def("wait_semaphore", &Program::wait_semaphore);
+
+  py::class_<StreamSemaphoreObject, std::shared_ptr<StreamSemaphoreObject>>(
+      m, "StreamSemaphore");
 
   py::class_<AotModuleBuilder>(m, "AotModuleBuilder")
       .def("add_field", &AotModuleBuilder::add_field)
       .def("add", &AotModuleBuilder::add)
       .def("add_kernel_template", &AotModuleBuilder::add_kernel_template)
+      .def("add_with_spec_constants",
+           &AotModuleBuilder::add_with_spec_constants)
       .def("add_graph", &AotModuleBuilder::add_graph)
       .def("dump", &AotModuleBuilder::dump);
 
@@ -480,11 +824,7 @@ void export_lang(py::module &m) {
                                const std::vector<int> &,
                                const std::string &))(&SNode::pointer),
            py::return_value_policy::reference)
-      .def("hash",
-           (SNode & (SNode::*)(const std::vector<Axis> &,
-                               const std::vector<int> &,
-                               const std::string &))(&SNode::hash),
-           py::return_value_policy::reference)
+      .def("hash", &SNode::hash, py::return_value_policy::reference)
       .def("dynamic", &SNode::dynamic, py::return_value_policy::reference)
       .def("bitmasked",
            (SNode & (SNode::*)(const std::vector<Axis> &,
@@ -494,6 +834,7 @@ void export_lang(py::module &m) {
       .def("bit_struct", &SNode::bit_struct, py::return_value_policy::reference)
       .def("quant_array", &SNode::quant_array,
            py::return_value_policy::reference)
+      .def("morton", &SNode::morton, py::return_value_policy::reference)
       .def("place", &SNode::place)
       .def("data_type", [](SNode *snode) { return snode->dt; })
       .def("name", [](SNode *snode) { return snode->name; })
@@ -518,6 +859,8 @@ void export_lang(py::module &m) {
       .def("get_expr", &SNode::get_expr)
       .def("write_int", &SNode::write_int)
       .def("write_float", &SNode::write_float)
+      .def("read_batch", &SNode::read_batch)
+      .def("write_batch", &SNode::write_batch)
       .def("get_shape_along_axis", &SNode::shape_along_axis)
       .def("get_physical_index_position",
            [](SNode *snode) {
@@ -546,12 +889,43 @@ void export_lang(py::module &m) {
       .def("read_float", &Ndarray::read_float)
       .def("write_int", &Ndarray::write_int)
       .def("write_float", &Ndarray::write_float)
+      .def("read_batch",
+           [](Ndarray *ndarray, const std::vector<std::size_t> &indices,
+              uint64 dst) { ndarray->read_batch(indices, (void *)dst); })
+      .def("write_batch",
+           [](Ndarray *ndarray, const std::vector<std::size_t> &indices,
+              uint64 src) { ndarray->write_batch(indices, (void *)src); })
+      .def("read_range",
+           [](Ndarray *ndarray, std::size_t begin, std::size_t count,
+              uint64 dst) { ndarray->read_range(begin, count, (void *)dst); })
+      .def("write_range",
+           [](Ndarray *ndarray, std::size_t begin, std::size_t count,
+              uint64 src) { ndarray->write_range(begin, count, (void *)src); })
+      .def("is_host_mapped", &Ndarray::is_host_mapped)
       .def("total_shape", &Ndarray::total_shape)
       .def("element_shape", &Ndarray::get_element_shape)
       .def("element_data_type", &Ndarray::get_element_data_type)
       .def_readonly("dtype", &Ndarray::dtype)
       .def_readonly("shape", &Ndarray::shape);
 
+  py::class_<OutOfCoreNdarray>(m, "OutOfCoreNdarray")
+      .def("load_tile", &OutOfCoreNdarray::load_tile,
+           py::return_value_policy::reference)
+      .def("store_tile", &OutOfCoreNdarray::store_tile)
+      .def("num_tiles", &OutOfCoreNdarray::get_num_tiles)
+      .def("tile_rows", &OutOfCoreNdarray::get_tile_rows)
+      .def("nbytes", &OutOfCoreNdarray::get_nbytes)
+      .def("read",
+           [](OutOfCoreNdarray *ndarray, uint64 dst) {
+             ndarray->read((void *)dst);
+           })
+      .def("write",
+           [](OutOfCoreNdarray *ndarray, uint64 src) {
+             ndarray->write((void *)src);
+           })
+      .def_readonly("dtype", &OutOfCoreNdarray::dtype)
+      .def_readonly("shape", &OutOfCoreNdarray::shape);
+
   py::enum_<BufferFormat>(m, "Format")
 #define PER_BUFFER_FORMAT(x) .value(#x, BufferFormat::x)
 #include "taichi/inc/rhi_constants.inc.h"
@@ -561,7 +935,8 @@ void export_lang(py::module &m) {
   py::class_<Texture>(m, "Texture")
       .def("device_allocation_ptr", &Texture::get_device_allocation_ptr_as_int)
       .def("from_ndarray", &Texture::from_ndarray)
-      .def("from_snode", &Texture::from_snode);
+      .def("from_snode", &Texture::from_snode)
+      .def("generate_mipmaps", &Texture::generate_mipmaps);
 
   py::enum_<aot::ArgKind>(m, "ArgKind")
       .value("SCALAR", aot::ArgKind::kScalar)
@@ -597,12 +972,18 @@ void export_lang(py::module &m) {
       .def("append", &Sequential::append)
       .def("dispatch", &Sequential::dispatch);
 
+  py::class_<Loop, Node>(m, "Loop").def("body", &Loop::body,
+                                        py::return_value_policy::reference);
+
   py::class_<GraphBuilder>(m, "GraphBuilder")
       .def(py::init<>())
       .def("dispatch", &GraphBuilder::dispatch)
+      .def("declare_temporary", &GraphBuilder::declare_temporary)
       .def("compile", &GraphBuilder::compile)
       .def("create_sequential", &GraphBuilder::new_sequential_node,
            py::return_value_policy::reference)
+      .def("create_loop", &GraphBuilder::new_loop_node,
+           py::return_value_policy::reference)
       .def("seq", &GraphBuilder::seq, py::return_value_policy::reference);
 
   py::class_<aot::CompiledGraph>(m, "CompiledGraph")
@@ -665,6 +1046,17 @@ void export_lang(py::module &m) {
         self->run(args);
       });
 
+  py::class_<KernelReturnFuture>(m, "KernelReturnFuture")
+      .def("ready", &KernelReturnFuture::ready)
+      .def("wait", &KernelReturnFuture::wait,
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_ret_int", &KernelReturnFuture::get_ret_int)
+      .def("get_ret_uint", &KernelReturnFuture::get_ret_uint)
+      .def("get_ret_float", &KernelReturnFuture::get_ret_float)
+      .def("get_ret_int_tensor", &KernelReturnFuture::get_ret_int_tensor)
+      .def("get_ret_uint_tensor", &KernelReturnFuture::get_ret_uint_tensor)
+      .def("get_ret_float_tensor", &KernelReturnFuture::get_ret_float_tensor);
+
   py::class_<Kernel>(m, "Kernel")
       .def("no_activate",
            [](Kernel *self, SNode *snode) {
@@ -682,7 +1074,36 @@ void export_lang(py::module &m) {
       .def("get_ret_int_tensor", &Kernel::get_ret_int_tensor)
       .def("get_ret_uint_tensor", &Kernel::get_ret_uint_tensor)
       .def("get_ret_float_tensor", &Kernel::get_ret_float_tensor)
+      .def("get_ret_future", &Kernel::get_ret_future)
       .def("make_launch_context", &Kernel::make_launch_context)
+      .def("gather_access_footprints",
+           [](Kernel *self, const CompileConfig &compile_config) {
+             // One dict per task from the ids of the SNodes to (reads,
+             // writes), which hold (low, high) (inclusive) or None for each
+             // index of the SNode.
+             auto to_list = [](const std::vector<DiffRange> &ranges) {
+               py::list ret;
+               for (auto &range : ranges) {
+                 if (range.linear_related()) {
+                   ret.append(py::make_tuple(range.low, range.high - 1));
+                 } else {
+                   ret.append(py::none());
+                 }
+               }
+               return ret;
+             };
+             py::list tasks;
+             for (auto &footprints :
+                  self->gather_access_footprints(compile_config)) {
+               py::dict task;
+               for (auto &[snode, footprint] : footprints) {
+                 task[py::int_(snode->id)] = py::make_tuple(
+                     to_list(footprint.reads), to_list(footprint.writes));
+               }
+               tasks.append(task);
+             }
+             return tasks;
+           })
       .def(
           "ast_builder",
           [](Kernel *self) -> ASTBuilder * {
@@ -708,7 +1129,45 @@ void export_lang(py::module &m) {
       .def("set_arg_rw_texture",
            &Kernel::LaunchContextBuilder::set_arg_rw_texture)
       .def("set_extra_arg_int",
-           &Kernel::LaunchContextBuilder::set_extra_arg_int);
+           &Kernel::LaunchContextBuilder::set_extra_arg_int)
+      .def("set_args",
+           [](Kernel::LaunchContextBuilder &self, const py::list &values) {
+             // Converts all the arguments in one call from Python, by the
+             // types of the parameters.
+             const auto &layout = self.get_arg_layout();
+             TI_ERROR_IF(values.size() != layout.num_values,
+                         "{} argument values needed but {} provided",
+                         layout.num_values, values.size());
+             thread_local std::vector<Kernel::LaunchArgValue> packed;
+             packed.resize(layout.num_values);
+             using Kind = Kernel::LaunchArgLayout::Kind;
+             std::size_t i = 0;
+             for (const auto &entry : layout.entries) {
+               if (entry.kind == Kind::kNdarray) {
+                 packed[i].arr = values[i].cast<Ndarray *>();
+                 TI_ERROR_IF(packed[i].arr == nullptr,
+                             "An ndarray argument is None");
+                 packed[i + 1].arr = values[i + 1].is_none()
+                                         ? nullptr
+                                         : values[i + 1].cast<Ndarray *>();
+                 i += 2;
+                 continue;
+               }
+               PyObject *v = values[i].ptr();
+               if (entry.kind == Kind::kFloat) {
+                 packed[i].f = PyFloat_AsDouble(v);
+               } else if (entry.kind == Kind::kInt) {
+                 packed[i].i = PyLong_AsLongLong(v);
+               } else {
+                 packed[i].u = PyLong_AsUnsignedLongLong(v);
+               }
+               if (PyErr_Occurred()) {
+                 throw py::error_already_set();
+               }
+               i++;
+             }
+             self.set_args(packed.data(), packed.size());
+           });
 
   py::class_<Function>(m, "Function")
       .def("insert_scalar_param", &Function::insert_scalar_param)
@@ -749,6 +1208,7 @@ void export_lang(py::module &m) {
       .def("set_adjoint", &Expr::set_adjoint)
       .def("set_adjoint_checkbit", &Expr::set_adjoint_checkbit)
       .def("set_dual", &Expr::set_dual)
+      .def("add_dual_lane", &Expr::add_dual_lane)
       .def("set_dynamic_index_stride",
            [&](Expr *expr, int dynamic_index_stride) {
              auto matrix_field = expr->cast<MatrixFieldExpression>();
@@ -804,9 +1264,9 @@ void export_lang(py::module &m) {
 
   m.def("insert_internal_func_call",
         [&](const std::string &func_name, const ExprGroup &args,
-            bool with_runtime_context) {
-          return Expr::make<InternalFuncCallExpression>(func_name, args.exprs,
-                                                        with_runtime_context);
+            bool with_runtime_context, const DataType &ret_type) {
+          return Expr::make<InternalFuncCallExpression>(
+              func_name, args.exprs, with_runtime_context, ret_type);
         });
 
   m.def("make_get_element_expr",
@@ -871,6 +1331,7 @@ void export_lang(py::module &m) {
   DEFINE_EXPRESSION_OP(rsqrt)
   DEFINE_EXPRESSION_OP(exp)
   DEFINE_EXPRESSION_OP(log)
+  DEFINE_EXPRESSION_OP(popcnt)
 
   DEFINE_EXPRESSION_OP(select)
   DEFINE_EXPRESSION_OP(ifte)
@@ -939,7 +1400,7 @@ void export_lang(py::module &m) {
 
   auto &&texture =
       py::enum_<TextureOpType>(m, "TextureOpType", py::arithmetic());
-  for (int t = 0; t <= (int)TextureOpType::kStore; t++)
+  for (int t = 0; t <= (int)TextureOpType::kSampleGrad; t++)
     texture.value(texture_op_type_name(TextureOpType(t)).c_str(),
                   TextureOpType(t));
   texture.export_values();
@@ -1217,6 +1678,28 @@ void export_lang(py::module &m) {
   MAKE_SPARSE_MATRIX(64, ColMajor, d);
   MAKE_SPARSE_MATRIX(64, RowMajor, d);
 
+#define MAKE_BSR_SPARSE_MATRIX(TYPE, VTYPE)                              \
+  py::class_<BsrSparseMatrix<float##TYPE>, SparseMatrix>(               \
+      m, #VTYPE "_BsrSparseMatrix")                                     \
+      .def("spmv", &BsrSparseMatrix<float##TYPE>::spmv)                 \
+      .def("solve_triangular",                                          \
+           &BsrSparseMatrix<float##TYPE>::solve_triangular)             \
+      .def("get_element", &BsrSparseMatrix<float##TYPE>::get_element)   \
+      .def("block_size", &BsrSparseMatrix<float##TYPE>::block_size)     \
+      .def("num_blocks", &BsrSparseMatrix<float##TYPE>::num_blocks)     \
+      .def("to_string", &BsrSparseMatrix<float##TYPE>::to_string);
+
+  MAKE_BSR_SPARSE_MATRIX(32, f);
+  MAKE_BSR_SPARSE_MATRIX(64, d);
+
+  py::class_<CuBsrSparseMatrix, SparseMatrix>(m, "CuBsrSparseMatrix")
+      .def("spmv", &CuBsrSparseMatrix::spmv)
+      .def("solve_triangular", &CuBsrSparseMatrix::solve_triangular)
+      .def("get_element", &CuBsrSparseMatrix::get_element)
+      .def("block_size", &CuBsrSparseMatrix::block_size)
+      .def("num_blocks", &CuBsrSparseMatrix::num_blocks)
+      .def("to_string", &CuBsrSparseMatrix::to_string);
+
   py::class_<CuSparseMatrix, SparseMatrix>(m, "CuSparseMatrix")
       .def(py::init<int, int, DataType>())
       .def(py::init<const CuSparseMatrix &>())
@@ -1270,9 +1753,27 @@ void export_lang(py::module &m) {
       .def("solve_rf", &CuSparseSolver::solve_rf)
       .def("info", &CuSparseSolver::info);
 
+  py::class_<MixedPrecisionSparseSolver, SparseSolver>(
+      m, "MixedPrecisionSparseSolver")
+      .def("compute", &MixedPrecisionSparseSolver::compute)
+      .def("analyze_pattern", &MixedPrecisionSparseSolver::analyze_pattern)
+      .def("factorize", &MixedPrecisionSparseSolver::factorize)
+      .def("solve_rf", &MixedPrecisionSparseSolver::solve_rf)
+      .def("set_refinement", &MixedPrecisionSparseSolver::set_refinement)
+      .def("num_iterations", &MixedPrecisionSparseSolver::num_iterations)
+      .def("residual", &MixedPrecisionSparseSolver::residual)
+      .def("info", &MixedPrecisionSparseSolver::info);
+
   m.def("make_sparse_solver", &make_sparse_solver);
   m.def("make_cusparse_solver", &make_cusparse_solver);
 
+  py::class_<SparsePreconditioner>(m, "SparsePreconditioner")
+      .def("compute", &SparsePreconditioner::compute)
+      .def("apply", &SparsePreconditioner::apply);
+
+  m.def("make_sparse_preconditioner", &make_sparse_preconditioner);
+  m.def("make_cusparse_preconditioner", &make_cusparse_preconditioner);
+
   // Mesh Class
   // Mesh related.
   py::enum_<mesh::MeshTopology>(m, "MeshTopology", py::arithmetic())
@@ -1340,6 +1841,14 @@ void export_lang(py::module &m) {
         [](mesh::MeshPtr &mesh_ptr, mesh::MeshElementType type, SNode *snode) {
           mesh_ptr.ptr->total_offset.insert(std::pair(type, snode));
         });
+  m.def("set_owned_num",
+        [](mesh::MeshPtr &mesh_ptr, mesh::MeshElementType type, SNode *snode) {
+          mesh_ptr.ptr->owned_num.insert(std::pair(type, snode));
+        });
+  m.def("set_total_num",
+        [](mesh::MeshPtr &mesh_ptr, mesh::MeshElementType type, SNode *snode) {
+          mesh_ptr.ptr->total_num.insert(std::pair(type, snode));
+        });
   m.def("set_num_patches", [](mesh::MeshPtr &mesh_ptr, int num_patches) {
     mesh_ptr.ptr->num_patches = num_patches;
   });
@@ -1381,6 +1890,101 @@ void export_lang(py::module &m) {
               type, mesh::MeshLocalRelation(value, patch_offset, offset)));
         });
 
+  using Float32Array =
+      py::array_t<float, py::array::c_style | py::array::forcecast>;
+  using Uint32Array =
+      py::array_t<uint32_t, py::array::c_style | py::array::forcecast>;
+  m.def("patch_mesh", [](mesh::MeshTopology topology,
+                         const Float32Array &positions,
+                         const Uint32Array &cells,
+                         const std::vector<mesh::MeshRelationType> &relations,
+                         int max_elements_per_patch, int shared_memory_bytes,
+                         int bytes_per_element) {
+    mesh::MeshPatcherConfig config;
+    config.max_elements_per_patch = max_elements_per_patch;
+    config.shared_memory_bytes = shared_memory_bytes;
+    config.bytes_per_element = bytes_per_element;
+    std::vector<float> positions_vec(positions.data(),
+                                     positions.data() + positions.size());
+    std::vector<uint32_t> cells_vec(cells.data(), cells.data() + cells.size());
+    mesh::PatchedMesh patched;
+    {
+      py::gil_scoped_release release;
+      patched = mesh::patch_mesh(topology, positions_vec, cells_vec, relations,
+                                 config);
+    }
+    return patched_mesh_to_dict(patched);
+  });
+
+  py::class_<mesh::DynamicPatchedMesh>(m, "DynamicPatchedMesh")
+      .def(py::init([](mesh::MeshTopology topology,
+                       const Float32Array &positions, const Uint32Array &cells,
+                       const std::vector<mesh::MeshRelationType> &relations,
+                       int max_elements_per_patch, int shared_memory_bytes,
+                       int bytes_per_element, float slack) {
+        mesh::MeshPatcherConfig config;
+        config.max_elements_per_patch = max_elements_per_patch;
+        config.shared_memory_bytes = shared_memory_bytes;
+        config.bytes_per_element = bytes_per_element;
+        std::vector<float> positions_vec(positions.data(),
+                                         positions.data() + positions.size());
+        std::vector<uint32_t> cells_vec(cells.data(),
+                                        cells.data() + cells.size());
+        py::gil_scoped_release release;
+        return std::make_unique<mesh::DynamicPatchedMesh>(
+            topology, positions_vec, cells_vec, relations, config, slack);
+      }))
+      .def("metadata",
+           [](const mesh::DynamicPatchedMesh &self) {
+             return patched_mesh_to_dict(self.mesh());
+           })
+      .def("update", [](mesh::DynamicPatchedMesh &self,
+                        const Uint32Array &removed_cells,
+                        const Uint32Array &added_cells,
+                        uint32_t num_added_vertices) {
+        std::vector<uint32_t> removed(
+            removed_cells.data(), removed_cells.data() + removed_cells.size());
+        std::vector<uint32_t> added(added_cells.data(),
+                                    added_cells.data() + added_cells.size());
+        mesh::DynamicPatchedMesh::Update update;
+        {
+          py::gil_scoped_release release;
+          update = self.update(removed, added, num_added_vertices);
+        }
+        py::list added_list, moved_list, elements, relations;
+        for (size_t d = 0; d < update.elements.size(); d++) {
+          added_list.append(to_array(update.added[d]));
+          std::vector<uint32_t> moved;
+          for (auto [from, to] : update.moved[d]) {
+            moved.push_back(from);
+            moved.push_back(to);
+          }
+          moved_list.append(to_array(moved));
+          const auto &e = update.elements[d];
+          py::dict element;
+          element["owned_nums"] = scatter_to_tuple(e.owned_nums);
+          element["total_nums"] = scatter_to_tuple(e.total_nums);
+          element["l2g_mapping"] = scatter_to_tuple(e.l2g_mapping);
+          element["l2r_mapping"] = scatter_to_tuple(e.l2r_mapping);
+          element["g2r_mapping"] = scatter_to_tuple(e.g2r_mapping);
+          elements.append(element);
+        }
+        for (const auto &r : update.relations) {
+          py::dict relation;
+          relation["value"] = scatter_to_tuple(r.value);
+          relation["offset"] = scatter_to_tuple(r.offset);
+          relation["patch_offset"] = scatter_to_tuple(r.patch_offset);
+          relations.append(relation);
+        }
+        py::dict result;
+        result["dirty_patches"] = update.dirty_patches;
+        result["added"] = added_list;
+        result["moved"] = moved_list;
+        result["elements"] = elements;
+        result["relations"] = relations;
+        return result;
+      });
+
   m.def("wait_for_debugger", []() {
 #ifdef WIN32
     while (!::IsDebuggerPresent())
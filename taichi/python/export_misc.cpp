@@ -17,6 +17,7 @@
 #include "taichi/python/memory_usage_monitor.h"
 #include "taichi/system/benchmark.h"
 #include "taichi/system/dynamic_loader.h"
+#include "taichi/system/flight_recorder.h"
 #include "taichi/system/hacked_signal_handler.h"
 #include "taichi/system/profiler.h"
 #include "taichi/util/offline_cache.h"
@@ -182,6 +183,13 @@ void export_misc(py::module &m) {
   m.def("clean_offline_cache_files",
         lang::offline_cache::clean_offline_cache_files);
 
+  m.def("flight_recorder_enabled", FlightRecorder::enabled);
+  m.def("flight_recorder_dump", [](const std::string &filename) {
+    FlightRecorder::get_instance().dump(filename);
+  });
+  m.def("flight_recorder_clear",
+        []() { FlightRecorder::get_instance().clear(); });
+
   py::class_<HackedSignalRegister>(m, "HackedSignalRegister").def(py::init<>());
 }
 
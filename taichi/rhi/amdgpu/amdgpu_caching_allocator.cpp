@@ -1,38 +1,29 @@
 #include "taichi/rhi/amdgpu/amdgpu_caching_allocator.h"
+#include "taichi/rhi/amdgpu/amdgpu_driver.h"
 
 namespace taichi {
 namespace lang {
 namespace amdgpu {
 
 AmdgpuCachingAllocator::AmdgpuCachingAllocator(LlvmDevice *device)
-    : device_(device) {
+    : LlvmCachingAllocator(device) {
 }
 
-uint64_t *AmdgpuCachingAllocator::allocate(
-    const LlvmDevice::LlvmRuntimeAllocParams &params) {
-  uint64_t *ret{nullptr};
-  auto size_aligned = taichi::iroundup(params.size, taichi_page_size);
-  auto it_blk = mem_blocks_.lower_bound(size_aligned);
-
-  if (it_blk != mem_blocks_.end()) {
-    size_t remaining_sz = it_blk->first - size_aligned;
-    if (remaining_sz > 0) {
-      TI_ASSERT(remaining_sz % taichi_page_size == 0);
-      auto remaining_head =
-          reinterpret_cast<uint8_t *>(it_blk->second) + size_aligned;
-      mem_blocks_.insert(
-          {remaining_sz, reinterpret_cast<uint64_t *>(remaining_head)});
-    }
-    ret = it_blk->second;
-    mem_blocks_.erase(it_blk);
-  } else {
-    ret = device_->allocate_llvm_runtime_memory_jit(params);
+uint64_t *AmdgpuCachingAllocator::driver_allocate(std::size_t size) {
+  void *ptr = nullptr;
+  if (AMDGPUDriver::get_instance().malloc.call(&ptr, size) != 0) {
+    return nullptr;
   }
-  return ret;
+  return (uint64_t *)ptr;
+}
+
+void AmdgpuCachingAllocator::driver_free(uint64_t *ptr) {
+  AMDGPUDriver::get_instance().mem_free(ptr);
 }
 
-void AmdgpuCachingAllocator::release(size_t sz, uint64_t *ptr) {
-  mem_blocks_.insert({sz, ptr});
+void AmdgpuCachingAllocator::synchronize_streams() {
+  // All work is issued on the default stream of the AMDGPU backend.
+  AMDGPUDriver::get_instance().stream_synchronize(nullptr);
 }
 
 }  // namespace amdgpu
@@ -43,6 +43,8 @@ DeviceAllocation AmdgpuDevice::allocate_memory_runtime(
   } else if (params.use_cached) {
     if (caching_allocator_ == nullptr) {
       caching_allocator_ = std::make_unique<AmdgpuCachingAllocator>(this);
+      caching_allocator_->set_high_water_mark(
+          caching_allocator_high_water_mark_);
     }
     info.ptr = caching_allocator_->allocate(params);
     AMDGPUDriver::get_instance().memset((void *)info.ptr, 0, info.size);
@@ -74,6 +74,11 @@ class AmdgpuDevice : public LlvmDevice {
       const LlvmRuntimeAllocParams &params) override;
   void dealloc_memory(DeviceAllocation handle) override;
 
+  CachingAllocatorStats get_caching_allocator_stats() override {
+    return caching_allocator_ ? caching_allocator_->get_stats()
+                              : CachingAllocatorStats{};
+  }
+
   ShaderResourceSet *create_resource_set() final{TI_NOT_IMPLEMENTED};
 
   RhiResult create_pipeline(Pipeline **out_pipeline,
@@ -1,37 +1,33 @@
 #include "taichi/rhi/cuda/cuda_caching_allocator.h"
+#include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/rhi/cuda/cuda_driver.h"
 
 namespace taichi::lang {
 namespace cuda {
 
 CudaCachingAllocator::CudaCachingAllocator(LlvmDevice *device)
-    : device_(device) {
+    : LlvmCachingAllocator(device) {
 }
 
-uint64_t *CudaCachingAllocator::allocate(
-    const LlvmDevice::LlvmRuntimeAllocParams &params) {
-  uint64_t *ret{nullptr};
-  auto size_aligned = taichi::iroundup(params.size, taichi_page_size);
-  auto it_blk = mem_blocks_.lower_bound(size_aligned);
-
-  if (it_blk != mem_blocks_.end()) {
-    size_t remaining_sz = it_blk->first - size_aligned;
-    if (remaining_sz > 0) {
-      TI_ASSERT(remaining_sz % taichi_page_size == 0);
-      auto remaining_head =
-          reinterpret_cast<uint8_t *>(it_blk->second) + size_aligned;
-      mem_blocks_.insert(
-          {remaining_sz, reinterpret_cast<uint64_t *>(remaining_head)});
-    }
-    ret = it_blk->second;
-    mem_blocks_.erase(it_blk);
-  } else {
-    ret = device_->allocate_llvm_runtime_memory_jit(params);
+uint64_t *CudaCachingAllocator::driver_allocate(std::size_t size) {
+  void *ptr = nullptr;
+  if (CUDADriver::get_instance().malloc.call(&ptr, size) != CUDA_SUCCESS) {
+    return nullptr;
   }
-  return ret;
+  return (uint64_t *)ptr;
+}
+
+void CudaCachingAllocator::driver_free(uint64_t *ptr) {
+  CUDAContext::get_instance().invalidate_pointer_cache(ptr);
+  CUDADriver::get_instance().mem_free(ptr);
+}
+
+void *CudaCachingAllocator::current_stream() {
+  return CUDAContext::get_instance().get_stream();
 }
 
-void CudaCachingAllocator::release(size_t sz, uint64_t *ptr) {
-  mem_blocks_.insert({sz, ptr});
+void CudaCachingAllocator::synchronize_streams() {
+  CUDAContext::get_instance().synchronize_streams();
 }
 
 }  // namespace cuda
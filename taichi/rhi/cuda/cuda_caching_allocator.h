@@ -2,6 +2,7 @@
 
 #include "taichi/common/core.h"
 #include "taichi/math/arithmetic.h"
+#include "taichi/rhi/llvm/llvm_caching_allocator.h"
 #include "taichi/rhi/llvm/llvm_device.h"
 #include "taichi/inc/constants.h"
 #include <stdint.h>
@@ -10,16 +11,15 @@
 namespace taichi::lang {
 namespace cuda {
 
-class CudaCachingAllocator {
+class CudaCachingAllocator : public LlvmCachingAllocator {
  public:
   explicit CudaCachingAllocator(LlvmDevice *device);
 
-  uint64_t *allocate(const LlvmDevice::LlvmRuntimeAllocParams &params);
-  void release(size_t sz, uint64_t *ptr);
-
- private:
-  std::multimap<size_t, uint64_t *> mem_blocks_;
-  LlvmDevice *device_{nullptr};
+ protected:
+  uint64_t *driver_allocate(std::size_t size) override;
+  void driver_free(uint64_t *ptr) override;
+  void *current_stream() override;
+  void synchronize_streams() override;
 };
 
 }  // namespace cuda
@@ -1,6 +1,7 @@
 #define TI_RUNTIME_HOST
 #include "cuda_context.h"
 
+#include <cstdlib>
 #include <unordered_map>
 #include <mutex>
 
@@ -11,18 +12,34 @@
 
 namespace taichi::lang {
 
+thread_local void *CUDAContext::current_stream_ = nullptr;
+thread_local std::vector<CUDAContext::RecordedLaunch>
+    *CUDAContext::recorded_launches_ = nullptr;
+thread_local bool CUDAContext::recording_interrupted_ = false;
+
 CUDAContext::CUDAContext()
     : profiler_(nullptr), driver_(CUDADriver::get_instance_without_context()) {
   // CUDA initialization
   dev_count_ = 0;
   driver_.init(0);
   driver_.device_get_count(&dev_count_);
-  driver_.device_get(&device_, 0);
+
+  // Processes sharing a node can each pick their own GPU while still seeing
+  // the others, which peer access between them requires.
+  int device_id = 0;
+  const char *id = std::getenv("TI_VISIBLE_DEVICE");
+  if (id && dev_count_ > 0) {
+    device_id = std::stoi(id);
+    TI_ERROR_IF(device_id < 0 || device_id >= dev_count_,
+                "TI_VISIBLE_DEVICE={} is not valid, found {} CUDA devices",
+                device_id, dev_count_);
+  }
+  driver_.device_get(&device_, (void *)(intptr_t)device_id);
 
   char name[128];
   driver_.device_get_name(name, 128, device_);
 
-  TI_TRACE("Using CUDA device [id=0]: {}", name);
+  TI_TRACE("Using CUDA device [id={}]: {}", device_id, name);
 
   int cc_major, cc_minor;
   driver_.device_get_attribute(
@@ -31,7 +48,7 @@ CUDAContext::CUDAContext()
       &cc_minor, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, device_);
 
   TI_TRACE("CUDA Device Compute Capability: {}.{}", cc_major, cc_minor);
-  driver_.primary_context_retain(&context_, 0);
+  driver_.primary_context_retain(&context_, get_device());
   driver_.context_set_current(context_);
 
   const auto GB = std::pow(1024.0, 3.0);
@@ -72,13 +89,212 @@ std::string CUDAContext::get_device_name() {
   return str;
 }
 
+void *CUDAContext::create_stream() {
+  void *stream = nullptr;
+  driver_.stream_create(&stream, CU_STREAM_NON_BLOCKING);
+  return stream;
+}
+
+void CUDAContext::destroy_stream(void *stream) {
+  TI_ASSERT(stream != nullptr);
+  driver_.stream_synchronize(stream);
+  {
+    std::lock_guard<std::mutex> _(lock_);
+    pending_streams_.erase(stream);
+  }
+  if (current_stream_ == stream) {
+    current_stream_ = nullptr;
+  }
+  driver_.stream_destroy(stream);
+}
+
+void CUDAContext::stream_wait_stream(void *stream, void *dependency) {
+  if (stream == dependency) {
+    return;
+  }
+  void *event = nullptr;
+  driver_.event_create(&event, CU_EVENT_DISABLE_TIMING);
+  driver_.event_record(event, dependency);
+  driver_.stream_wait_event(stream, event, 0);
+  // The pending wait keeps the event alive inside the driver.
+  driver_.event_destroy(event);
+}
+
+void CUDAContext::mark_stream_pending(void *stream) {
+  if (stream == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> _(lock_);
+  pending_streams_.insert(stream);
+}
+
+void CUDAContext::synchronize_streams() {
+  std::unordered_set<void *> streams;
+  {
+    std::lock_guard<std::mutex> _(lock_);
+    streams.swap(pending_streams_);
+  }
+  driver_.stream_synchronize(nullptr);
+  for (auto *stream : streams) {
+    driver_.stream_synchronize(stream);
+  }
+}
+
+bool CUDAContext::is_device_pointer(void *ptr) {
+  const auto addr = (uint64)ptr;
+  {
+    std::lock_guard<std::mutex> _(device_ranges_lock_);
+    auto it = device_ranges_.upper_bound(addr);
+    if (it != device_ranges_.begin()) {
+      --it;
+      if (addr < it->second) {
+        return true;
+      }
+    }
+  }
+
+  unsigned int memory_type = 0;
+  uint32_t ret_code = driver_.mem_get_attribute.call(
+      &memory_type, CU_POINTER_ATTRIBUTE_MEMORY_TYPE, ptr);
+  // - ret_code != CUDA_SUCCESS: the driver does not know about |ptr|, it is
+  //   pageable host memory.
+  // - memory_type != CU_MEMORYTYPE_DEVICE: the driver is aware of |ptr| but it
+  //   lives on the host.
+  // Host pointers are not cached since we cannot observe when they are freed
+  // and their range is unknown.
+  if (ret_code != CUDA_SUCCESS || memory_type != CU_MEMORYTYPE_DEVICE) {
+    return false;
+  }
+
+  uint64 range_start = 0;
+  std::size_t range_size = 0;
+  if (driver_.mem_get_attribute.call(
+          &range_start, CU_POINTER_ATTRIBUTE_RANGE_START_ADDR, ptr) ==
+          CUDA_SUCCESS &&
+      driver_.mem_get_attribute.call(
+          &range_size, CU_POINTER_ATTRIBUTE_RANGE_SIZE, ptr) == CUDA_SUCCESS &&
+      range_size > 0) {
+    std::lock_guard<std::mutex> _(device_ranges_lock_);
+    device_ranges_[range_start] = range_start + range_size;
+  }
+  return true;
+}
+
+void CUDAContext::invalidate_pointer_cache(void *ptr) {
+  const auto addr = (uint64)ptr;
+  std::lock_guard<std::mutex> _(device_ranges_lock_);
+  auto it = device_ranges_.upper_bound(addr);
+  if (it != device_ranges_.begin()) {
+    --it;
+    if (addr < it->second) {
+      device_ranges_.erase(it);
+    }
+  }
+}
+
+void CUDAContext::clear_pointer_cache() {
+  std::lock_guard<std::mutex> _(device_ranges_lock_);
+  device_ranges_.clear();
+}
+
+void CUDAContext::set_stack_limit(std::size_t limit) {
+  std::lock_guard<std::mutex> _(lock_);
+  if (stack_limit_ == limit) {
+    return;
+  }
+  driver_.context_set_limit(CU_LIMIT_STACK_SIZE, limit);
+  stack_limit_ = limit;
+}
+
+void CUDAContext::set_print_buffer_size(std::size_t size) {
+  std::lock_guard<std::mutex> _(lock_);
+  driver_.context_set_limit(CU_LIMIT_PRINTF_FIFO_SIZE, size);
+}
+
+void CUDAContext::begin_recording(std::vector<RecordedLaunch> *launches) {
+  TI_ASSERT(launches != nullptr);
+  TI_ASSERT(!is_recording());
+  recorded_launches_ = launches;
+  recording_interrupted_ = false;
+}
+
+void CUDAContext::interrupt_recording() {
+  if (!is_recording()) {
+    return;
+  }
+  auto *launches = recorded_launches_;
+  recorded_launches_ = nullptr;
+  recording_interrupted_ = true;
+
+  auto context_guard = CUDAContext::get_instance().get_guard();
+  for (auto &launch : *launches) {
+    std::vector<void *> arg_pointers;
+    for (auto &arg : launch.args) {
+      arg_pointers.push_back(arg.data());
+    }
+    enqueue_launch(launch.func, launch.grid_dim, launch.block_dim,
+                   launch.dynamic_shared_mem_bytes, arg_pointers.data());
+  }
+  launches->clear();
+}
+
+bool CUDAContext::end_recording() {
+  const bool completed = !recording_interrupted_;
+  recorded_launches_ = nullptr;
+  recording_interrupted_ = false;
+  return completed;
+}
+
+void CUDAContext::enqueue_launch(void *func,
+                                 unsigned grid_dim,
+                                 unsigned block_dim,
+                                 std::size_t dynamic_shared_mem_bytes,
+                                 void **arg_pointers,
+                                 bool cooperative) {
+  void *stream = current_stream_;
+  std::lock_guard<std::mutex> _(lock_);
+  if (cooperative) {
+    driver_.launch_cooperative_kernel(func, grid_dim, 1, 1, block_dim, 1, 1,
+                                      dynamic_shared_mem_bytes, stream,
+                                      arg_pointers);
+  } else {
+    driver_.launch_kernel(func, grid_dim, 1, 1, block_dim, 1, 1,
+                          dynamic_shared_mem_bytes, stream, arg_pointers,
+                          nullptr);
+  }
+  if (stream != nullptr) {
+    pending_streams_.insert(stream);
+  }
+}
+
 void CUDAContext::launch(void *func,
                          const std::string &task_name,
                          std::vector<void *> arg_pointers,
                          std::vector<int> arg_sizes,
                          unsigned grid_dim,
                          unsigned block_dim,
-                         std::size_t dynamic_shared_mem_bytes) {
+                         std::size_t dynamic_shared_mem_bytes,
+                         bool cooperative) {
+  if (is_recording()) {
+    // The parameters can only be copied if their sizes are known.
+    if (!cooperative && arg_sizes.size() == arg_pointers.size()) {
+      if (grid_dim > 0) {
+        RecordedLaunch launch;
+        launch.func = func;
+        launch.grid_dim = grid_dim;
+        launch.block_dim = block_dim;
+        launch.dynamic_shared_mem_bytes = dynamic_shared_mem_bytes;
+        for (int i = 0; i < (int)arg_pointers.size(); i++) {
+          const auto *bytes = (const uint8 *)arg_pointers[i];
+          launch.args.emplace_back(bytes, bytes + arg_sizes[i]);
+        }
+        recorded_launches_->push_back(std::move(launch));
+      }
+      return;
+    }
+    interrupt_recording();
+  }
+
   // It is important to keep a handle since in async mode (deleted)
   // a constant folding kernel may happen during a kernel launch
   // then profiler->start and profiler->stop mismatch.
@@ -112,16 +328,14 @@ void CUDAContext::launch(void *func,
   // get_current_program().config.max_block_dim);
 
   if (grid_dim > 0) {
-    std::lock_guard<std::mutex> _(lock_);
-    driver_.launch_kernel(func, grid_dim, 1, 1, block_dim, 1, 1,
-                          dynamic_shared_mem_bytes, nullptr,
-                          arg_pointers.data(), nullptr);
+    enqueue_launch(func, grid_dim, block_dim, dynamic_shared_mem_bytes,
+                   arg_pointers.data(), cooperative);
   }
   if (profiler_)
     profiler_->stop(task_handle);
 
   if (debug_) {
-    driver_.stream_synchronize(nullptr);
+    driver_.stream_synchronize(current_stream_);
   }
 }
 
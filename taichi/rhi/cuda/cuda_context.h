@@ -1,8 +1,11 @@
 #pragma once
 
+#include <map>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <thread>
+#include <vector>
 
 #include "taichi/program/kernel_profiler.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
@@ -17,6 +20,16 @@ namespace taichi::lang {
 class CUDADriver;
 
 class CUDAContext {
+ public:
+  struct RecordedLaunch {
+    void *func{nullptr};
+    unsigned grid_dim{0};
+    unsigned block_dim{0};
+    std::size_t dynamic_shared_mem_bytes{0};
+    // The bytes of every kernel parameter.
+    std::vector<std::vector<uint8>> args;
+  };
+
  private:
   void *device_;
   void *context_;
@@ -27,6 +40,19 @@ class CUDAContext {
   KernelProfilerBase *profiler_;
   CUDADriver &driver_;
   bool debug_;
+  // Streams that have received work since the last synchronize_streams().
+  std::unordered_set<void *> pending_streams_;
+  // The stream kernels of the calling thread are launched on. nullptr refers
+  // to the legacy default stream.
+  static thread_local void *current_stream_;
+  // Non-null while the launches of the calling thread are being recorded.
+  static thread_local std::vector<RecordedLaunch> *recorded_launches_;
+  static thread_local bool recording_interrupted_;
+  // Device memory ranges [start, end) known from previous pointer attribute
+  // queries, keyed by start address.
+  std::map<uint64, uint64> device_ranges_;
+  std::mutex device_ranges_lock_;
+  std::size_t stack_limit_{0};
 
  public:
   CUDAContext();
@@ -39,13 +65,104 @@ class CUDAContext {
     return dev_count_ != 0;
   }
 
+  /**
+   * Creates a non-blocking stream, i.e. one that does not implicitly
+   * synchronize with the legacy default stream.
+   */
+  void *create_stream();
+
+  void destroy_stream(void *stream);
+
+  void *get_stream() const {
+    return current_stream_;
+  }
+
+  void set_stream(void *stream) {
+    current_stream_ = stream;
+  }
+
+  /**
+   * Makes all future work on |stream| wait for the work that has been enqueued
+   * on |dependency| so far, without blocking the host.
+   */
+  void stream_wait_stream(void *stream, void *dependency);
+
+  /**
+   * Records that |stream| has work in flight, so that synchronize_streams()
+   * waits on it.
+   */
+  void mark_stream_pending(void *stream);
+
+  /**
+   * Waits on the default stream and on every stream that received work since
+   * the last call. Idle streams are skipped.
+   */
+  void synchronize_streams();
+
+  /**
+   * Returns whether |ptr| points into device memory. Device allocations are
+   * cached by address range, so that repeated launches with the same external
+   * arrays skip the cuPointerGetAttribute round trip.
+   */
+  bool is_device_pointer(void *ptr);
+
+  /**
+   * Drops the cached range containing |ptr|. Must be called before the
+   * underlying device memory is freed.
+   */
+  void invalidate_pointer_cache(void *ptr);
+
+  void clear_pointer_cache();
+
+  /**
+   * Sets CU_LIMIT_STACK_SIZE, skipping the driver call if |limit| has already
+   * been applied.
+   */
+  void set_stack_limit(std::size_t limit);
+
+  /**
+   * Sets CU_LIMIT_PRINTF_FIFO_SIZE, the size of the device-side buffer of
+   * printf output. Has to be called before any kernel that prints.
+   */
+  void set_print_buffer_size(std::size_t size);
+
+  /**
+   * Makes the calling thread append its kernel launches to |launches| instead
+   * of enqueueing them, until end_recording() is called.
+   */
+  void begin_recording(std::vector<RecordedLaunch> *launches);
+
+  /**
+   * Enqueues the launches recorded so far on the current stream, and lets the
+   * following launches of the calling thread run as usual. Must be called
+   * before issuing any other work that has to be ordered with the recorded
+   * launches, e.g. memory copies. No-op if the thread is not recording.
+   */
+  void interrupt_recording();
+
+  /**
+   * Stops recording. Returns false if the recording has been interrupted, in
+   * which case every launch has already been enqueued.
+   */
+  bool end_recording();
+
+  bool is_recording() const {
+    return recorded_launches_ != nullptr;
+  }
+
+  /*
+   * Launches |func| on the current stream. Cooperative launches, whose blocks
+   * are all resident at once so that they can synchronize with each other,
+   * cannot be recorded.
+   */
   void launch(void *func,
               const std::string &task_name,
               std::vector<void *> arg_pointers,
               std::vector<int> arg_sizes,
               unsigned grid_dim,
               unsigned block_dim,
-              std::size_t dynamic_shared_mem_bytes);
+              std::size_t dynamic_shared_mem_bytes,
+              bool cooperative = false);
 
   void set_profiler(KernelProfilerBase *profiler) {
     profiler_ = profiler;
@@ -71,8 +188,23 @@ class CUDAContext {
     return compute_capability_;
   }
 
+  // The CUdevice of the context.
+  int get_device() const {
+    return (int)(intptr_t)device_;
+  }
+
   ~CUDAContext();
 
+ private:
+  void enqueue_launch(void *func,
+                      unsigned grid_dim,
+                      unsigned block_dim,
+                      std::size_t dynamic_shared_mem_bytes,
+                      void **arg_pointers,
+                      bool cooperative = false);
+
+ public:
+
   class ContextGuard {
    private:
     void *old_ctx_;
@@ -97,6 +229,28 @@ class CUDAContext {
     return ContextGuard(this);
   }
 
+  // Binds the calling thread to |stream| for the lifetime of the guard, so
+  // that kernels and compute graphs launched in the scope go to |stream|.
+  class StreamGuard {
+   private:
+    CUDAContext *ctx_;
+    void *old_stream_;
+
+   public:
+    StreamGuard(CUDAContext *ctx, void *stream)
+        : ctx_(ctx), old_stream_(ctx->get_stream()) {
+      ctx_->set_stream(stream);
+    }
+
+    ~StreamGuard() {
+      ctx_->set_stream(old_stream_);
+    }
+  };
+
+  StreamGuard get_stream_guard(void *stream) {
+    return StreamGuard(this, stream);
+  }
+
   std::unique_lock<std::mutex> get_lock_guard() {
     return std::unique_lock<std::mutex>(lock_);
   }
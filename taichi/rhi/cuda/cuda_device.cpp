@@ -4,6 +4,53 @@ namespace taichi::lang {
 
 namespace cuda {
 
+namespace {
+
+struct CudaTextureFormat {
+  CUarray_format format;
+  uint32_t num_channels;
+  uint32_t channel_bytes;
+  bool srgb{false};
+};
+
+CudaTextureFormat get_cuda_texture_format(BufferFormat format) {
+  switch (format) {
+    case BufferFormat::r8:
+      return {CU_AD_FORMAT_UNSIGNED_INT8, 1, 1};
+    case BufferFormat::rg8:
+      return {CU_AD_FORMAT_UNSIGNED_INT8, 2, 1};
+    case BufferFormat::rgba8:
+      return {CU_AD_FORMAT_UNSIGNED_INT8, 4, 1};
+    case BufferFormat::rgba8srgb:
+      return {CU_AD_FORMAT_UNSIGNED_INT8, 4, 1, /*srgb=*/true};
+    case BufferFormat::r16:
+      return {CU_AD_FORMAT_UNSIGNED_INT16, 1, 2};
+    case BufferFormat::rg16:
+      return {CU_AD_FORMAT_UNSIGNED_INT16, 2, 2};
+    case BufferFormat::rgba16:
+      return {CU_AD_FORMAT_UNSIGNED_INT16, 4, 2};
+    case BufferFormat::r16f:
+      return {CU_AD_FORMAT_HALF, 1, 2};
+    case BufferFormat::rg16f:
+      return {CU_AD_FORMAT_HALF, 2, 2};
+    case BufferFormat::rgba16f:
+      return {CU_AD_FORMAT_HALF, 4, 2};
+    case BufferFormat::r32f:
+      return {CU_AD_FORMAT_FLOAT, 1, 4};
+    case BufferFormat::rg32f:
+      return {CU_AD_FORMAT_FLOAT, 2, 4};
+    case BufferFormat::rgba32f:
+      return {CU_AD_FORMAT_FLOAT, 4, 4};
+    default:
+      // CUDA arrays have 1, 2 or 4 channels, and integer textures can't be
+      // filtered.
+      TI_ERROR("Texture format {} is not supported on CUDA", (int)format);
+      return {};
+  }
+}
+
+}  // namespace
+
 CudaDevice::AllocInfo CudaDevice::get_alloc_info(
     const DeviceAllocation handle) {
   validate_device_alloc(handle);
@@ -37,9 +84,23 @@ DeviceAllocation CudaDevice::allocate_memory_runtime(
     const LlvmRuntimeAllocParams &params) {
   AllocInfo info;
   info.size = taichi::iroundup(params.size, taichi_page_size);
-  if (params.use_cached) {
+  if (params.use_managed) {
+    auto &driver = CUDADriver::get_instance();
+    const int device = CUDAContext::get_instance().get_device();
+    driver.malloc_managed(&info.ptr, info.size, CU_MEM_ATTACH_GLOBAL);
+    // Keep the pages on the device unless it is oversubscribed, while the
+    // host can still access them without faulting them back.
+    driver.mem_advise(info.ptr, info.size,
+                      CU_MEM_ADVISE_SET_PREFERRED_LOCATION, device);
+    driver.mem_advise(info.ptr, info.size, CU_MEM_ADVISE_SET_ACCESSED_BY,
+                      (uint32)CU_DEVICE_CPU);
+    driver.memset(info.ptr, 0, info.size);
+    info.is_managed = true;
+  } else if (params.use_cached) {
     if (caching_allocator_ == nullptr) {
       caching_allocator_ = std::make_unique<CudaCachingAllocator>(this);
+      caching_allocator_->set_high_water_mark(
+          caching_allocator_high_water_mark_);
     }
     info.ptr = caching_allocator_->allocate(params);
     CUDADriver::get_instance().memset((void *)info.ptr, 0, info.size);
@@ -47,8 +108,8 @@ DeviceAllocation CudaDevice::allocate_memory_runtime(
     info.ptr = allocate_llvm_runtime_memory_jit(params);
   }
   info.is_imported = false;
-  info.use_cached = params.use_cached;
-  info.use_preallocated = true;
+  info.use_cached = params.use_cached && !params.use_managed;
+  info.use_preallocated = !params.use_managed;
 
   DeviceAllocation alloc;
   alloc.alloc_id = allocations_.size();
@@ -71,6 +132,7 @@ void CudaDevice::dealloc_memory(DeviceAllocation handle) {
     }
     caching_allocator_->release(info.size, (uint64_t *)info.ptr);
   } else if (!info.use_preallocated) {
+    CUDAContext::get_instance().invalidate_pointer_cache(info.ptr);
     CUDADriver::get_instance().mem_free(info.ptr);
     info.ptr = nullptr;
   }
@@ -102,6 +164,113 @@ void CudaDevice::memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) {
   CUDADriver::get_instance().memcpy_device_to_device(dst_ptr, src_ptr, size);
 }
 
+bool CudaDevice::prefetch_managed_memory(DeviceAllocation handle,
+                                         bool read_only,
+                                         void *stream) {
+  validate_device_alloc(handle);
+  AllocInfo &info = allocations_[handle.alloc_id];
+  if (!info.is_managed) {
+    return false;
+  }
+  auto &driver = CUDADriver::get_instance();
+  const int device = CUDAContext::get_instance().get_device();
+  if (info.read_mostly != read_only) {
+    driver.mem_advise(info.ptr, info.size,
+                      read_only ? CU_MEM_ADVISE_SET_READ_MOSTLY
+                                : CU_MEM_ADVISE_UNSET_READ_MOSTLY,
+                      device);
+    info.read_mostly = read_only;
+  }
+  driver.mem_prefetch_async(info.ptr, info.size, device, stream);
+  return true;
+}
+
+DeviceAllocation CudaDevice::create_texture(const ImageParams &params) {
+  const auto format = get_cuda_texture_format(params.format);
+  auto &driver = CUDADriver::get_instance();
+  TextureInfo info;
+  info.texel_bytes = format.num_channels * format.channel_bytes;
+
+  CUDA_ARRAY3D_DESCRIPTOR array_desc{};
+  array_desc.Width = params.x;
+  array_desc.Height = params.dimension == ImageDimension::d1D ? 0 : params.y;
+  array_desc.Depth = params.dimension == ImageDimension::d3D ? params.z : 0;
+  array_desc.Format = format.format;
+  array_desc.NumChannels = format.num_channels;
+  array_desc.Flags = CUDA_ARRAY3D_SURFACE_LDST;
+  driver.array_3d_create(&info.array, &array_desc);
+
+  CUDA_RESOURCE_DESC res_desc{};
+  res_desc.resType = CU_RESOURCE_TYPE_ARRAY;
+  res_desc.res.array.hArray = info.array;
+  CUDA_TEXTURE_DESC tex_desc{};
+  for (auto &mode : tex_desc.addressMode) {
+    mode = CU_TR_ADDRESS_MODE_WRAP;
+  }
+  tex_desc.filterMode = CU_TR_FILTER_MODE_LINEAR;
+  tex_desc.flags = CU_TRSF_NORMALIZED_COORDINATES;
+  if (format.srgb) {
+    tex_desc.flags |= CU_TRSF_SRGB;
+  }
+  driver.tex_object_create(&info.texture, &res_desc, &tex_desc, nullptr);
+  driver.surf_object_create(&info.surface, &res_desc);
+
+  DeviceAllocation alloc;
+  alloc.alloc_id = textures_.size();
+  alloc.device = this;
+  textures_.push_back(info);
+  return alloc;
+}
+
+void CudaDevice::destroy_texture(DeviceAllocation handle) {
+  TI_ASSERT(handle.alloc_id < textures_.size());
+  TextureInfo &info = textures_[handle.alloc_id];
+  TI_ERROR_IF(info.array == nullptr, "The texture is already destroyed");
+  auto &driver = CUDADriver::get_instance();
+  driver.tex_object_destroy(info.texture);
+  driver.surf_object_destroy(info.surface);
+  driver.array_destroy(info.array);
+  info = TextureInfo{};
+}
+
+uint64 CudaDevice::get_texture_object(DeviceAllocation handle) {
+  TI_ASSERT(handle.alloc_id < textures_.size());
+  return textures_[handle.alloc_id].texture;
+}
+
+uint64 CudaDevice::get_surface_object(DeviceAllocation handle) {
+  TI_ASSERT(handle.alloc_id < textures_.size());
+  return textures_[handle.alloc_id].surface;
+}
+
+void CudaDevice::copy_buffer_to_texture(DeviceAllocation texture,
+                                        DevicePtr src,
+                                        const BufferImageCopyParams &params,
+                                        void *stream) {
+  TI_ASSERT(texture.alloc_id < textures_.size());
+  const TextureInfo &info = textures_[texture.alloc_id];
+  validate_device_alloc(src);
+  CUDA_MEMCPY3D copy{};
+  copy.srcMemoryType = ::CU_MEMORYTYPE_DEVICE;
+  copy.srcDevice =
+      (CUdeviceptr)((char *)allocations_[src.alloc_id].ptr + src.offset);
+  // Zero means tightly packed, as on the graphics backends.
+  copy.srcPitch = (params.buffer_row_length ? params.buffer_row_length
+                                            : params.image_extent.x) *
+                  info.texel_bytes;
+  copy.srcHeight = params.buffer_image_height ? params.buffer_image_height
+                                              : params.image_extent.y;
+  copy.dstMemoryType = ::CU_MEMORYTYPE_ARRAY;
+  copy.dstArray = info.array;
+  copy.dstXInBytes = params.image_offset.x * info.texel_bytes;
+  copy.dstY = params.image_offset.y;
+  copy.dstZ = params.image_offset.z;
+  copy.WidthInBytes = params.image_extent.x * info.texel_bytes;
+  copy.Height = params.image_extent.y;
+  copy.Depth = params.image_extent.z;
+  CUDADriver::get_instance().memcpy_3d_async(&copy, stream);
+}
+
 DeviceAllocation CudaDevice::import_memory(void *ptr, size_t size) {
   AllocInfo info;
   info.ptr = ptr;
@@ -116,6 +285,14 @@ DeviceAllocation CudaDevice::import_memory(void *ptr, size_t size) {
   return alloc;
 }
 
+CudaPinnedMemoryPool *CudaDevice::pinned_staging_pool() {
+  std::lock_guard<std::mutex> _(pinned_staging_pool_mut_);
+  if (pinned_staging_pool_ == nullptr) {
+    pinned_staging_pool_ = std::make_unique<CudaPinnedMemoryPool>();
+  }
+  return pinned_staging_pool_.get();
+}
+
 uint64 CudaDevice::fetch_result_uint64(int i, uint64 *result_buffer) {
   CUDADriver::get_instance().stream_synchronize(nullptr);
   uint64 ret;
@@ -6,6 +6,7 @@
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/rhi/cuda/cuda_caching_allocator.h"
 #include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/rhi/cuda/cuda_pinned_memory_pool.h"
 #include "taichi/rhi/llvm/llvm_device.h"
 
 namespace taichi::lang {
@@ -59,6 +60,24 @@ class CudaStream : public Stream {
   void command_sync() override{TI_NOT_IMPLEMENTED};
 };
 
+// A CUDA event recorded on a stream. It is the completion handle of the
+// asynchronous operations of the CUDA backend.
+class CudaStreamSemaphoreObject : public StreamSemaphoreObject {
+ public:
+  explicit CudaStreamSemaphoreObject(void *event) : event_(event) {
+  }
+  ~CudaStreamSemaphoreObject() override {
+    CUDADriver::get_instance().event_destroy(event_);
+  }
+
+  void *event() const {
+    return event_;
+  }
+
+ private:
+  void *event_{nullptr};
+};
+
 class CudaDevice : public LlvmDevice {
  public:
   struct AllocInfo {
@@ -77,6 +96,9 @@ class CudaDevice : public LlvmDevice {
      * */
     bool use_preallocated{true};
     bool use_cached{false};
+    // Allocated with cuMemAllocManaged, see prefetch_managed_memory().
+    bool is_managed{false};
+    bool read_mostly{false};
     void *mapped{nullptr};
   };
 
@@ -89,6 +111,11 @@ class CudaDevice : public LlvmDevice {
       const LlvmRuntimeAllocParams &params) override;
   void dealloc_memory(DeviceAllocation handle) override;
 
+  CachingAllocatorStats get_caching_allocator_stats() override {
+    return caching_allocator_ ? caching_allocator_->get_stats()
+                              : CachingAllocatorStats{};
+  }
+
   ShaderResourceSet *create_resource_set() final{TI_NOT_IMPLEMENTED};
 
   RhiResult create_pipeline(Pipeline **out_pipeline,
@@ -112,6 +139,36 @@ class CudaDevice : public LlvmDevice {
 
   DeviceAllocation import_memory(void *ptr, size_t size);
 
+  /* Hints that the work enqueued next on |stream| accesses |handle|, which
+   * reads it only if |read_only|: starts migrating it to the device and lets
+   * the driver duplicate read-only pages instead of migrating them back and
+   * forth. Returns false and does nothing if |handle| is not managed memory.
+   */
+  bool prefetch_managed_memory(DeviceAllocation handle,
+                               bool read_only,
+                               void *stream);
+
+  /* Textures are CUDA arrays, sampled through a texture object with linear
+   * filtering, normalized coordinates and wrapping (like the samplers of the
+   * graphics backends), and written through a surface object. Their
+   * DeviceAllocations are only valid for the texture functions below.
+   */
+  DeviceAllocation create_texture(const ImageParams &params);
+  void destroy_texture(DeviceAllocation handle);
+  uint64 get_texture_object(DeviceAllocation handle);
+  uint64 get_surface_object(DeviceAllocation handle);
+
+  /* Copies the texels at |src|, laid out as described by |params|, to
+   * |texture| on |stream|.
+   */
+  void copy_buffer_to_texture(DeviceAllocation texture,
+                              DevicePtr src,
+                              const BufferImageCopyParams &params,
+                              void *stream);
+
+  // Page-locked host buffers for staging transfers of host arrays.
+  CudaPinnedMemoryPool *pinned_staging_pool();
+
   Stream *get_compute_stream() override{TI_NOT_IMPLEMENTED};
 
   void wait_idle() override{TI_NOT_IMPLEMENTED};
@@ -124,6 +181,16 @@ class CudaDevice : public LlvmDevice {
     }
   }
   std::unique_ptr<CudaCachingAllocator> caching_allocator_{nullptr};
+
+  struct TextureInfo {
+    CUarray array{nullptr};
+    CUtexObject texture{0};
+    CUsurfObject surface{0};
+    uint32_t texel_bytes{0};
+  };
+  std::vector<TextureInfo> textures_;
+  std::mutex pinned_staging_pool_mut_;
+  std::unique_ptr<CudaPinnedMemoryPool> pinned_staging_pool_{nullptr};
 };
 
 }  // namespace cuda
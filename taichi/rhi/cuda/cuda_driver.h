@@ -25,22 +25,60 @@ namespace taichi::lang {
 // Driver constants from cuda.h
 
 constexpr uint32 CU_EVENT_DEFAULT = 0x0;
+constexpr uint32 CU_EVENT_DISABLE_TIMING = 0x2;
 constexpr uint32 CU_STREAM_DEFAULT = 0x0;
 constexpr uint32 CU_STREAM_NON_BLOCKING = 0x1;
 constexpr uint32 CU_MEM_ATTACH_GLOBAL = 0x1;
+constexpr uint32 CU_MEM_ADVISE_SET_READ_MOSTLY = 1;
+constexpr uint32 CU_MEM_ADVISE_UNSET_READ_MOSTLY = 2;
 constexpr uint32 CU_MEM_ADVISE_SET_PREFERRED_LOCATION = 3;
+constexpr uint32 CU_MEM_ADVISE_SET_ACCESSED_BY = 5;
+constexpr int CU_DEVICE_CPU = -1;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X = 2;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_BLOCKS_PER_MULTIPROCESSOR = 106;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT = 16;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR = 39;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_REGISTERS_PER_MULTIPROCESSOR = 82;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR = 75;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR = 76;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_CLOCK_RATE = 13;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_MEMORY_CLOCK_RATE = 36;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_GLOBAL_MEMORY_BUS_WIDTH = 37;
 constexpr uint32 CUDA_ERROR_ASSERT = 710;
 constexpr uint32 CU_JIT_MAX_REGISTERS = 0;
+constexpr uint32 CU_JIT_INPUT_PTX = 1;
+constexpr uint32 CU_JIT_TARGET = 9;
 constexpr uint32 CU_POINTER_ATTRIBUTE_MEMORY_TYPE = 2;
+constexpr uint32 CU_POINTER_ATTRIBUTE_RANGE_START_ADDR = 11;
+constexpr uint32 CU_POINTER_ATTRIBUTE_RANGE_SIZE = 12;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING = 41;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_COOPERATIVE_LAUNCH = 95;
 constexpr uint32 CUDA_SUCCESS = 0;
 constexpr uint32 CU_MEMORYTYPE_DEVICE = 2;
 constexpr uint32 CU_LIMIT_STACK_SIZE = 0;
+constexpr uint32 CU_LIMIT_PRINTF_FIFO_SIZE = 1;
+constexpr uint32 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS = 0x1;
+
+// Layout of CUipcMemHandle, an opaque handle that other processes can open to
+// access a device allocation.
+struct CUDAIpcMemHandle {
+  char reserved[64];
+};
+
+// Layout of CUDA_KERNEL_NODE_PARAMS_v1, which is what the unversioned
+// cuGraph*KernelNode* entry points take regardless of the toolkit version.
+struct CUDAKernelNodeParams {
+  void *func{nullptr};
+  uint32 grid_dim_x{1};
+  uint32 grid_dim_y{1};
+  uint32 grid_dim_z{1};
+  uint32 block_dim_x{1};
+  uint32 block_dim_y{1};
+  uint32 block_dim_z{1};
+  uint32 shared_mem_bytes{0};
+  void **kernel_params{nullptr};
+  void **extra{nullptr};
+};
 
 std::string get_cuda_error_message(uint32 err);
 
@@ -26,34 +26,71 @@ PER_CUDA_FUNCTION(memcpy_device_to_host, cuMemcpyDtoH_v2, void *, void *, std::s
 PER_CUDA_FUNCTION(memcpy_device_to_device, cuMemcpyDtoD_v2, void *, void *, std::size_t);
 PER_CUDA_FUNCTION(memcpy_host_to_device_async, cuMemcpyHtoDAsync_v2, void *, void *, std::size_t, void *);
 PER_CUDA_FUNCTION(memcpy_device_to_host_async, cuMemcpyDtoHAsync_v2, void *, void *, std::size_t, void*);
+PER_CUDA_FUNCTION(memcpy_device_to_device_async, cuMemcpyDtoDAsync_v2, void *, void *, std::size_t, void*);
 PER_CUDA_FUNCTION(malloc, cuMemAlloc_v2, void **, std::size_t);
 PER_CUDA_FUNCTION(malloc_managed, cuMemAllocManaged, void **, std::size_t, uint32);
 PER_CUDA_FUNCTION(memset, cuMemsetD8_v2, void *, uint8, std::size_t);
 PER_CUDA_FUNCTION(memsetd32, cuMemsetD32_v2, void *, uint32, std::size_t);
+PER_CUDA_FUNCTION(memsetd32_async, cuMemsetD32Async, void *, uint32, std::size_t, void *);
 PER_CUDA_FUNCTION(mem_free, cuMemFree_v2, void *);
+PER_CUDA_FUNCTION(mem_alloc_host, cuMemAllocHost_v2, void **, std::size_t);
+PER_CUDA_FUNCTION(mem_free_host, cuMemFreeHost, void *);
 PER_CUDA_FUNCTION(mem_advise, cuMemAdvise, void *, std::size_t, uint32, uint32);
+PER_CUDA_FUNCTION(mem_prefetch_async, cuMemPrefetchAsync, void *, std::size_t, int, void *);
 PER_CUDA_FUNCTION(mem_get_info, cuMemGetInfo_v2, std::size_t *, std::size_t *);
 PER_CUDA_FUNCTION(mem_get_attribute, cuPointerGetAttribute, void *, uint32, void *);
+PER_CUDA_FUNCTION(mem_get_address_range, cuMemGetAddressRange_v2, void **, std::size_t *, void *);
+
+// Inter-process communication
+PER_CUDA_FUNCTION(ipc_get_mem_handle, cuIpcGetMemHandle, CUDAIpcMemHandle *, void *);
+PER_CUDA_FUNCTION(ipc_open_mem_handle, cuIpcOpenMemHandle_v2, void **, CUDAIpcMemHandle, uint32);
+PER_CUDA_FUNCTION(ipc_close_mem_handle, cuIpcCloseMemHandle, void *);
 
 // Module and kernels
 PER_CUDA_FUNCTION(module_get_function, cuModuleGetFunction, void **, void *, const char *);
 PER_CUDA_FUNCTION(module_load_data_ex, cuModuleLoadDataEx, void **, const char *,
                   uint32, uint32 *, void **)
+PER_CUDA_FUNCTION(link_create, cuLinkCreate_v2, uint32, uint32 *, void **, void **);
+PER_CUDA_FUNCTION(link_add_data, cuLinkAddData_v2, void *, uint32, void *, std::size_t, const char *, uint32, uint32 *, void **);
+PER_CUDA_FUNCTION(link_complete, cuLinkComplete, void *, void **, std::size_t *);
+PER_CUDA_FUNCTION(link_destroy, cuLinkDestroy, void *);
 PER_CUDA_FUNCTION(launch_kernel, cuLaunchKernel, void *, uint32, uint32, uint32,
                   uint32, uint32, uint32, uint32, void *, void **, void **);
+PER_CUDA_FUNCTION(launch_cooperative_kernel, cuLaunchCooperativeKernel, void *, uint32, uint32, uint32,
+                  uint32, uint32, uint32, uint32, void *, void **);
 PER_CUDA_FUNCTION(kernel_get_attribute, cuFuncGetAttribute, int *, uint32, void *);
 PER_CUDA_FUNCTION(kernel_get_occupancy, cuOccupancyMaxActiveBlocksPerMultiprocessor, int *, void *, int, size_t);
 
 // Stream management
 PER_CUDA_FUNCTION(stream_synchronize, cuStreamSynchronize, void *);
+PER_CUDA_FUNCTION(stream_destroy, cuStreamDestroy_v2, void *);
+PER_CUDA_FUNCTION(stream_wait_event, cuStreamWaitEvent, void *, void *, uint32);
+
+// Graph management
+PER_CUDA_FUNCTION(graph_create, cuGraphCreate, void **, uint32);
+PER_CUDA_FUNCTION(graph_destroy, cuGraphDestroy, void *);
+PER_CUDA_FUNCTION(graph_add_kernel_node, cuGraphAddKernelNode, void **, void *, void **, std::size_t, const CUDAKernelNodeParams *);
+PER_CUDA_FUNCTION(graph_instantiate, cuGraphInstantiateWithFlags, void **, void *, uint64);
+PER_CUDA_FUNCTION(graph_exec_kernel_node_set_params, cuGraphExecKernelNodeSetParams, void *, void *, const CUDAKernelNodeParams *);
+PER_CUDA_FUNCTION(graph_exec_destroy, cuGraphExecDestroy, void *);
+PER_CUDA_FUNCTION(graph_launch, cuGraphLaunch, void *, void *);
 
 // Event management
 PER_CUDA_FUNCTION(event_create, cuEventCreate, void **, uint32)
 PER_CUDA_FUNCTION(event_destroy, cuEventDestroy, void *)
 PER_CUDA_FUNCTION(event_record, cuEventRecord, void *, void *)
 PER_CUDA_FUNCTION(event_synchronize, cuEventSynchronize, void *);
+PER_CUDA_FUNCTION(event_query, cuEventQuery, void *);
 PER_CUDA_FUNCTION(event_elapsed_time, cuEventElapsedTime, float *, void *, void *);
 
+// Textures and surfaces
+PER_CUDA_FUNCTION(array_3d_create, cuArray3DCreate_v2, CUarray *, const CUDA_ARRAY3D_DESCRIPTOR *);
+PER_CUDA_FUNCTION(array_destroy, cuArrayDestroy, CUarray);
+PER_CUDA_FUNCTION(memcpy_3d_async, cuMemcpy3DAsync_v2, const CUDA_MEMCPY3D *, void *);
+PER_CUDA_FUNCTION(tex_object_create, cuTexObjectCreate, CUtexObject *, const CUDA_RESOURCE_DESC *, const CUDA_TEXTURE_DESC *, const void *);
+PER_CUDA_FUNCTION(tex_object_destroy, cuTexObjectDestroy, CUtexObject);
+PER_CUDA_FUNCTION(surf_object_destroy, cuSurfObjectDestroy, CUsurfObject);
+
 // Vulkan interop
 PER_CUDA_FUNCTION(import_external_memory, cuImportExternalMemory, CUexternalMemory*, CUDA_EXTERNAL_MEMORY_HANDLE_DESC*)
 PER_CUDA_FUNCTION(external_memory_get_mapped_buffer,cuExternalMemoryGetMappedBuffer,CUdeviceptr *, CUexternalMemory, const CUDA_EXTERNAL_MEMORY_BUFFER_DESC *)
@@ -63,4 +100,6 @@ PER_CUDA_FUNCTION(surf_object_create,cuSurfObjectCreate,CUsurfObject *, const CU
 PER_CUDA_FUNCTION(signal_external_semaphore_async,cuSignalExternalSemaphoresAsync,const CUexternalSemaphore * , const CUDA_EXTERNAL_SEMAPHORE_SIGNAL_PARAMS * , unsigned int  , CUstream)
 PER_CUDA_FUNCTION(wait_external_semaphore_async,cuWaitExternalSemaphoresAsync,const CUexternalSemaphore * , const CUDA_EXTERNAL_SEMAPHORE_WAIT_PARAMS * , unsigned int  , CUstream)
 PER_CUDA_FUNCTION(import_external_semaphore, cuImportExternalSemaphore,CUexternalSemaphore * , const CUDA_EXTERNAL_SEMAPHORE_HANDLE_DESC *)
+PER_CUDA_FUNCTION(destroy_external_memory, cuDestroyExternalMemory, CUexternalMemory)
+PER_CUDA_FUNCTION(destroy_external_semaphore, cuDestroyExternalSemaphore, CUexternalSemaphore)
 // clang-format on
@@ -0,0 +1,90 @@
+#include "taichi/rhi/cuda/cuda_graph.h"
+
+#include "taichi/rhi/cuda/cuda_driver.h"
+
+namespace taichi::lang {
+
+CUDAGraph::CUDAGraph(std::vector<RecordedLaunch> &&launches)
+    : launches_(std::move(launches)) {
+  auto &driver = CUDADriver::get_instance();
+  driver.graph_create(&graph_, 0);
+
+  void *prev_node = nullptr;
+  std::vector<void *> arg_ptrs;
+  for (auto &launch : launches_) {
+    auto params = make_node_params(launch, arg_ptrs);
+    void *node = nullptr;
+    // Chain the nodes, since the kernels may depend on each other.
+    driver.graph_add_kernel_node(&node, graph_, prev_node ? &prev_node : nullptr,
+                                 prev_node ? 1 : 0, &params);
+    nodes_.push_back(node);
+    prev_node = node;
+  }
+
+  driver.graph_instantiate(&graph_exec_, graph_, 0);
+}
+
+CUDAGraph::~CUDAGraph() {
+  auto &driver = CUDADriver::get_instance();
+  if (graph_exec_) {
+    driver.graph_exec_destroy(graph_exec_);
+  }
+  if (graph_) {
+    driver.graph_destroy(graph_);
+  }
+}
+
+bool CUDAGraph::matches(const std::vector<RecordedLaunch> &launches) const {
+  if (launches.size() != launches_.size()) {
+    return false;
+  }
+  for (int i = 0; i < (int)launches.size(); i++) {
+    if (launches[i].func != launches_[i].func ||
+        launches[i].args.size() != launches_[i].args.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CUDAGraph::update(std::vector<RecordedLaunch> &&launches) {
+  TI_ASSERT(matches(launches));
+  auto &driver = CUDADriver::get_instance();
+  std::vector<void *> arg_ptrs;
+  for (int i = 0; i < (int)launches.size(); i++) {
+    auto &old_launch = launches_[i];
+    auto &new_launch = launches[i];
+    if (new_launch.grid_dim == old_launch.grid_dim &&
+        new_launch.block_dim == old_launch.block_dim &&
+        new_launch.dynamic_shared_mem_bytes ==
+            old_launch.dynamic_shared_mem_bytes &&
+        new_launch.args == old_launch.args) {
+      continue;
+    }
+    old_launch = std::move(new_launch);
+    auto params = make_node_params(old_launch, arg_ptrs);
+    driver.graph_exec_kernel_node_set_params(graph_exec_, nodes_[i], &params);
+  }
+}
+
+void CUDAGraph::launch(void *stream) {
+  CUDADriver::get_instance().graph_launch(graph_exec_, stream);
+}
+
+CUDAKernelNodeParams CUDAGraph::make_node_params(
+    RecordedLaunch &launch,
+    std::vector<void *> &arg_ptrs) {
+  arg_ptrs.clear();
+  for (auto &arg : launch.args) {
+    arg_ptrs.push_back(arg.data());
+  }
+  CUDAKernelNodeParams params;
+  params.func = launch.func;
+  params.grid_dim_x = launch.grid_dim;
+  params.block_dim_x = launch.block_dim;
+  params.shared_mem_bytes = (uint32)launch.dynamic_shared_mem_bytes;
+  params.kernel_params = arg_ptrs.data();
+  return params;
+}
+
+}  // namespace taichi::lang
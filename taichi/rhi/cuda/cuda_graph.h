@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "taichi/rhi/cuda/cuda_context.h"
+
+namespace taichi::lang {
+
+// An executable CUDA graph that runs a sequence of recorded kernel launches
+// one after another.
+//
+// The parameters and launch dimensions of the kernels can be updated in place,
+// so that a graph only has to be rebuilt when the sequence of kernels changes.
+class CUDAGraph {
+ public:
+  using RecordedLaunch = CUDAContext::RecordedLaunch;
+
+  explicit CUDAGraph(std::vector<RecordedLaunch> &&launches);
+  ~CUDAGraph();
+
+  CUDAGraph(const CUDAGraph &) = delete;
+  CUDAGraph &operator=(const CUDAGraph &) = delete;
+
+  // Whether |launches| run the same kernels as this graph, in the same order.
+  bool matches(const std::vector<RecordedLaunch> &launches) const;
+
+  // Updates the kernel nodes whose launches differ from |launches|, which must
+  // match this graph.
+  void update(std::vector<RecordedLaunch> &&launches);
+
+  void launch(void *stream);
+
+ private:
+  // The driver copies the parameters when the node is set, so |arg_ptrs| only
+  // has to outlive that call.
+  static CUDAKernelNodeParams make_node_params(RecordedLaunch &launch,
+                                               std::vector<void *> &arg_ptrs);
+
+  // Kept to tell which nodes an update changes.
+  std::vector<RecordedLaunch> launches_;
+  std::vector<void *> nodes_;
+  void *graph_{nullptr};
+  void *graph_exec_{nullptr};
+};
+
+}  // namespace taichi::lang
@@ -0,0 +1,56 @@
+#include "taichi/rhi/cuda/cuda_pinned_memory_pool.h"
+
+#include <algorithm>
+
+#include "taichi/rhi/cuda/cuda_driver.h"
+#include "taichi/util/bit.h"
+
+namespace taichi::lang {
+namespace cuda {
+
+CudaPinnedMemoryPool::~CudaPinnedMemoryPool() {
+  for (auto &[ptr, size] : buffer_sizes_) {
+    CUDADriver::get_instance().mem_free_host(ptr);
+  }
+}
+
+void *CudaPinnedMemoryPool::acquire(std::size_t size) {
+  const std::size_t bin_size =
+      std::max(kMinBufferSize, (std::size_t)bit::least_pot_bound(size));
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    auto it = free_buffers_.find(bin_size);
+    if (it != free_buffers_.end() && !it->second.empty()) {
+      void *ptr = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= bin_size;
+      return ptr;
+    }
+  }
+  void *ptr = nullptr;
+  if (CUDADriver::get_instance().mem_alloc_host.call(&ptr, bin_size) !=
+      CUDA_SUCCESS) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  buffer_sizes_[ptr] = bin_size;
+  return ptr;
+}
+
+void CudaPinnedMemoryPool::release(void *ptr) {
+  std::unique_lock<std::mutex> lock(mut_);
+  auto it = buffer_sizes_.find(ptr);
+  TI_ASSERT(it != buffer_sizes_.end());
+  const std::size_t bin_size = it->second;
+  if (cached_bytes_ + bin_size > kMaxCachedBytes) {
+    buffer_sizes_.erase(it);
+    lock.unlock();
+    CUDADriver::get_instance().mem_free_host(ptr);
+    return;
+  }
+  free_buffers_[bin_size].push_back(ptr);
+  cached_bytes_ += bin_size;
+}
+
+}  // namespace cuda
+}  // namespace taichi::lang
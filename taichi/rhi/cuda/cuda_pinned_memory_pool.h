@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace taichi::lang {
+namespace cuda {
+
+// A pool of page-locked host buffers used to stage transfers between host
+// arrays and the device. Copies from pinned memory are true DMA transfers that
+// do not block the host, whereas copies from pageable memory are staged by the
+// driver synchronously.
+//
+// Buffers are binned by power-of-two size and kept until the pool is
+// destroyed, up to |kMaxCachedBytes| in total.
+class CudaPinnedMemoryPool {
+ public:
+  CudaPinnedMemoryPool() = default;
+  ~CudaPinnedMemoryPool();
+
+  CudaPinnedMemoryPool(const CudaPinnedMemoryPool &) = delete;
+  CudaPinnedMemoryPool &operator=(const CudaPinnedMemoryPool &) = delete;
+
+  // Returns a pinned buffer of at least |size| bytes, or nullptr if the driver
+  // cannot pin more memory.
+  void *acquire(std::size_t size);
+  // |ptr| must not be in use by the device any more, i.e. the stream it was
+  // last used on has been synchronized.
+  void release(void *ptr);
+
+  static constexpr std::size_t kMinBufferSize = 1 << 16;
+  static constexpr std::size_t kMaxCachedBytes = std::size_t(1) << 30;
+
+ private:
+  std::mutex mut_;
+  // Bin size -> idle buffers.
+  std::map<std::size_t, std::vector<void *>> free_buffers_;
+  // Buffer -> bin size, for every buffer allocated by the pool.
+  std::map<void *, std::size_t> buffer_sizes_;
+  std::size_t cached_bytes_{0};
+};
+
+}  // namespace cuda
+}  // namespace taichi::lang
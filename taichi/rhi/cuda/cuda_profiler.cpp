@@ -17,11 +17,72 @@ KernelProfilerCUDA::KernelProfilerCUDA(bool enable) {
   }
 }
 
+namespace {
+
+void fill_kernel_attributes(KernelProfileTracedRecord &record,
+                            void *kernel,
+                            uint32_t grid_size,
+                            uint32_t block_size,
+                            uint32_t dynamic_smem_size) {
+  int register_per_thread = 0;
+  int local_mem_per_thread = 0;
+  int static_shared_mem_per_block = 0;
+  int max_active_blocks_per_multiprocessor = 0;
+  int max_threads_per_multiprocessor = 0;
+
+  CUDADriver::get_instance().kernel_get_attribute(
+      &register_per_thread, CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS,
+      kernel);
+  CUDADriver::get_instance().kernel_get_attribute(
+      &local_mem_per_thread,
+      CUfunction_attribute::CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, kernel);
+  CUDADriver::get_instance().kernel_get_attribute(
+      &static_shared_mem_per_block,
+      CUfunction_attribute::CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kernel);
+  CUDADriver::get_instance().kernel_get_occupancy(
+      &max_active_blocks_per_multiprocessor, kernel, block_size,
+      dynamic_smem_size);
+  CUDADriver::get_instance().device_get_attribute(
+      &max_threads_per_multiprocessor,
+      CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR, nullptr);
+
+  record.register_per_thread = register_per_thread;
+  record.local_mem_per_thread = local_mem_per_thread;
+  record.shared_mem_per_block = static_shared_mem_per_block + dynamic_smem_size;
+  record.grid_size = grid_size;
+  record.block_size = block_size;
+  record.active_blocks_per_multiprocessor =
+      max_active_blocks_per_multiprocessor;
+  if (max_threads_per_multiprocessor > 0) {
+    record.occupancy = std::min(
+        1.0f, (float)(max_active_blocks_per_multiprocessor * block_size) /
+                  max_threads_per_multiprocessor);
+  }
+}
+
+// The FP32 lanes of each multiprocessor, by compute capability.
+int fp32_lanes_per_multiprocessor(int compute_capability) {
+  if (compute_capability < 30) {
+    return 32;
+  } else if (compute_capability < 50) {
+    return 192;
+  } else if (compute_capability == 60 || compute_capability == 70 ||
+             compute_capability == 72 || compute_capability == 75 ||
+             compute_capability == 80) {
+    return 64;
+  }
+  return 128;
+}
+
+}  // namespace
+
 ProfilingToolkit get_toolkit_enum(std::string toolkit_name) {
   if (toolkit_name.compare("default") == 0)
     return ProfilingToolkit::event;
   else if (toolkit_name.compare("cupti") == 0)
     return ProfilingToolkit::cupti;
+  else if (toolkit_name.compare("activity") == 0)
+    return ProfilingToolkit::activity;
   else
     return ProfilingToolkit::undef;
 }
@@ -32,44 +93,82 @@ bool KernelProfilerCUDA::set_profiler_toolkit(std::string toolkit_name) {
   TI_TRACE("profiler toolkit enum = {} >>> {}", tool_, set_toolkit);
   if (set_toolkit == tool_)
     return true;
+  if (set_toolkit == ProfilingToolkit::undef ||
+      tool_ == ProfilingToolkit::undef)
+    return false;
+#if defined(TI_WITH_CUDA_TOOLKIT)
+  // The Activity API needs neither a recent GPU nor the privileges to read
+  // performance counters.
+  if (set_toolkit == ProfilingToolkit::cupti &&
+      !(check_cupti_availability() && check_cupti_privileges()))
+    return false;
+#else
+  if (set_toolkit != ProfilingToolkit::event)
+    return false;
+#endif
 
-  // current toolkit is CUPTI: disable
+  // disable the current toolkit, then enable the new one
   if (tool_ == ProfilingToolkit::cupti) {
     cupti_toolkit_->end_profiling();
     cupti_toolkit_->deinit_cupti();
     cupti_toolkit_->set_status(false);
-    tool_ = ProfilingToolkit::event;
-    TI_TRACE("cupti >>> event ... DONE");
-    return true;
+  } else if (tool_ == ProfilingToolkit::activity) {
+    // The records are dropped with the buffers of the Activity API.
+    update();
+    activity_toolkit_->end_profiling();
   }
-  // current toolkit is cuEvent: check CUPTI availability
-  else if (tool_ == ProfilingToolkit::event) {
-#if defined(TI_WITH_CUDA_TOOLKIT)
-    if (check_cupti_availability() && check_cupti_privileges()) {
-      if (cupti_toolkit_ == nullptr)
-        cupti_toolkit_ = std::make_unique<CuptiToolkit>();
-      cupti_toolkit_->init_cupti();
-      cupti_toolkit_->begin_profiling();
-      tool_ = ProfilingToolkit::cupti;
-      cupti_toolkit_->set_status(true);
-      TI_TRACE("event >>> cupti ... DONE");
-      return true;
-    }
-#endif
+  if (set_toolkit == ProfilingToolkit::cupti) {
+    if (cupti_toolkit_ == nullptr)
+      cupti_toolkit_ = std::make_unique<CuptiToolkit>();
+    cupti_toolkit_->init_cupti();
+    cupti_toolkit_->begin_profiling();
+    cupti_toolkit_->set_status(true);
+  } else if (set_toolkit == ProfilingToolkit::activity) {
+    if (activity_toolkit_ == nullptr)
+      activity_toolkit_ = std::make_unique<CuptiActivityToolkit>();
+    activity_toolkit_->begin_profiling();
   }
-  return false;
+  TI_TRACE("profiler toolkit {} >>> {} ... DONE", tool_, set_toolkit);
+  tool_ = set_toolkit;
+  return true;
 }
 
 std::string KernelProfilerCUDA::get_device_name() {
   return CUDAContext::get_instance().get_device_name();
 }
 
+bool KernelProfilerCUDA::get_device_peaks(double &gbps, double &gflops) {
+  auto &context = CUDAContext::get_instance();
+  auto *device = (void *)(intptr_t)context.get_device();
+  int memory_clock_khz = 0, bus_width_bits = 0;
+  int clock_khz = 0, num_multiprocessors = 0;
+  auto &driver = CUDADriver::get_instance();
+  driver.device_get_attribute(&memory_clock_khz,
+                              CU_DEVICE_ATTRIBUTE_MEMORY_CLOCK_RATE, device);
+  driver.device_get_attribute(
+      &bus_width_bits, CU_DEVICE_ATTRIBUTE_GLOBAL_MEMORY_BUS_WIDTH, device);
+  driver.device_get_attribute(&clock_khz, CU_DEVICE_ATTRIBUTE_CLOCK_RATE,
+                              device);
+  driver.device_get_attribute(&num_multiprocessors,
+                              CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, device);
+  if (memory_clock_khz <= 0 || clock_khz <= 0) {
+    return false;
+  }
+  // Double data rate memory, and one FMA (two FLOPs) per lane and cycle.
+  gbps = 2.0 * memory_clock_khz * 1e3 * (bus_width_bits / 8) / 1e9;
+  gflops = 2.0 * clock_khz * 1e3 * num_multiprocessors *
+           fp32_lanes_per_multiprocessor(context.get_compute_capability()) /
+           1e9;
+  return true;
+}
+
 bool KernelProfilerCUDA::reinit_with_metrics(
     const std::vector<std::string> metrics) {
   // do not pass by reference
   TI_TRACE("KernelProfilerCUDA::reinit_with_metrics");
 
-  if (tool_ == ProfilingToolkit::event) {
+  if (tool_ == ProfilingToolkit::event ||
+      tool_ == ProfilingToolkit::activity) {
     return false;
   } else if (tool_ == ProfilingToolkit::cupti) {
     cupti_toolkit_->end_profiling();
@@ -101,30 +200,13 @@ void KernelProfilerCUDA::trace(KernelProfilerBase::TaskHandle &task_handle,
                                uint32_t grid_size,
                                uint32_t block_size,
                                uint32_t dynamic_smem_size) {
-  int register_per_thread = 0;
-  int static_shared_mem_per_block = 0;
-  int max_active_blocks_per_multiprocessor = 0;
-  CUDADriver::get_instance().kernel_get_attribute(
-      &register_per_thread, CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS,
-      kernel);
-  CUDADriver::get_instance().kernel_get_attribute(
-      &static_shared_mem_per_block,
-      CUfunction_attribute::CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kernel);
-  CUDADriver::get_instance().kernel_get_occupancy(
-      &max_active_blocks_per_multiprocessor, kernel, block_size,
-      dynamic_smem_size);
-
   if (tool_ == ProfilingToolkit::event) {
     task_handle = event_toolkit_->start_with_handle(kernel_name);
   }
   KernelProfileTracedRecord record;
   record.name = kernel_name;
-  record.register_per_thread = register_per_thread;
-  record.shared_mem_per_block = static_shared_mem_per_block + dynamic_smem_size;
-  record.grid_size = grid_size;
-  record.block_size = block_size;
-  record.active_blocks_per_multiprocessor =
-      max_active_blocks_per_multiprocessor;
+  fill_kernel_attributes(record, kernel, grid_size, block_size,
+                         dynamic_smem_size);
 
   traced_records_.push_back(record);
 }
@@ -179,6 +261,11 @@ void KernelProfilerCUDA::update() {
     cupti_toolkit_->update_record(records_size_after_sync_, traced_records_);
     statistics_on_traced_records();  // TODO: deprecated
     this->reinit_with_metrics(metric_list_);
+  } else if (tool_ == ProfilingToolkit::activity) {
+    activity_toolkit_->update_record(records_size_after_sync_,
+                                     traced_records_);
+    activity_toolkit_->update_timeline(traced_records_);
+    statistics_on_traced_records();  // TODO: deprecated
   }
 
   records_size_after_sync_ = traced_records_.size();
@@ -198,29 +285,8 @@ bool KernelProfilerCUDA::record_kernel_attributes(void *kernel,
                                                   uint32_t grid_size,
                                                   uint32_t block_size,
                                                   uint32_t dynamic_smem_size) {
-  int register_per_thread = 0;
-  int static_shared_mem_per_block = 0;
-  int max_active_blocks_per_multiprocessor = 0;
-
-  CUDADriver::get_instance().kernel_get_attribute(
-      &register_per_thread, CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS,
-      kernel);
-  CUDADriver::get_instance().kernel_get_attribute(
-      &static_shared_mem_per_block,
-      CUfunction_attribute::CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kernel);
-  CUDADriver::get_instance().kernel_get_occupancy(
-      &max_active_blocks_per_multiprocessor, kernel, block_size,
-      dynamic_smem_size);
-
-  KernelProfileTracedRecord &traced_record = traced_records_.back();
-  traced_record.register_per_thread = register_per_thread;
-  traced_record.shared_mem_per_block =
-      static_shared_mem_per_block + dynamic_smem_size;
-  traced_record.grid_size = grid_size;
-  traced_record.block_size = block_size;
-  traced_record.active_blocks_per_multiprocessor =
-      max_active_blocks_per_multiprocessor;
-
+  fill_kernel_attributes(traced_records_.back(), kernel, grid_size, block_size,
+                         dynamic_smem_size);
   return true;
 }
 
@@ -232,6 +298,9 @@ KernelProfilerCUDA::KernelProfilerCUDA(bool enable) {
 std::string KernelProfilerCUDA::get_device_name() {
   TI_NOT_IMPLEMENTED;
 }
+bool KernelProfilerCUDA::get_device_peaks(double &gbps, double &gflops) {
+  return false;
+}
 bool KernelProfilerCUDA::reinit_with_metrics(
     const std::vector<std::string> metrics) {
   return false;  // public API for all backend, do not use TI_NOT_IMPLEMENTED;
@@ -15,6 +15,8 @@ enum class ProfilingToolkit : int {
   undef,
   event,
   cupti,
+  // Timing only, through the CUPTI Activity API.
+  activity,
 };
 
 class EventToolkit;
@@ -26,6 +28,8 @@ class KernelProfilerCUDA : public KernelProfilerBase {
 
   std::string get_device_name() override;
 
+  bool get_device_peaks(double &gbps, double &gflops) override;
+
   bool reinit_with_metrics(const std::vector<std::string> metrics) override;
   void trace(KernelProfilerBase::TaskHandle &task_handle,
              const std::string &kernel_name,
@@ -57,6 +61,7 @@ class KernelProfilerCUDA : public KernelProfilerBase {
   // but only one will be enabled.
   std::unique_ptr<EventToolkit> event_toolkit_{nullptr};
   std::unique_ptr<CuptiToolkit> cupti_toolkit_{nullptr};
+  std::unique_ptr<CuptiActivityToolkit> activity_toolkit_{nullptr};
   std::vector<std::string> metric_list_;
   uint32_t records_size_after_sync_{0};
 };
@@ -10,6 +10,7 @@
 using CUexternalMemory = void *;
 using CUexternalSemaphore = void *;
 using CUsurfObject = uint64_t;
+using CUtexObject = uint64_t;
 using CUstream = void *;
 using CUdeviceptr = void *;
 using CUmipmappedArray = void *;
@@ -68,6 +69,83 @@ typedef struct CUDA_ARRAY3D_DESCRIPTOR_st {
   unsigned int Flags;       /**< Flags */
 } CUDA_ARRAY3D_DESCRIPTOR;
 
+/**
+ * Texture reference addressing modes
+ */
+typedef enum CUaddress_mode_enum {
+  CU_TR_ADDRESS_MODE_WRAP = 0,   /**< Wrapping address mode */
+  CU_TR_ADDRESS_MODE_CLAMP = 1,  /**< Clamp to edge address mode */
+  CU_TR_ADDRESS_MODE_MIRROR = 2, /**< Mirror address mode */
+  CU_TR_ADDRESS_MODE_BORDER = 3  /**< Border address mode */
+} CUaddress_mode;
+
+/**
+ * Texture reference filtering modes
+ */
+typedef enum CUfilter_mode_enum {
+  CU_TR_FILTER_MODE_POINT = 0, /**< Point filter mode */
+  CU_TR_FILTER_MODE_LINEAR = 1 /**< Linear filter mode */
+} CUfilter_mode;
+
+/**
+ * Texture descriptor
+ */
+typedef struct CUDA_TEXTURE_DESC_st {
+  CUaddress_mode addressMode[3];  /**< Address modes */
+  CUfilter_mode filterMode;       /**< Filter mode */
+  unsigned int flags;             /**< Flags */
+  unsigned int maxAnisotropy;     /**< Maximum anisotropy ratio */
+  CUfilter_mode mipmapFilterMode; /**< Mipmap filter mode */
+  float mipmapLevelBias;          /**< Mipmap level bias */
+  float minMipmapLevelClamp;      /**< Mipmap minimum level clamp */
+  float maxMipmapLevelClamp;      /**< Mipmap maximum level clamp */
+  float borderColor[4];           /**< Border Color */
+  int reserved[12];
+} CUDA_TEXTURE_DESC;
+
+/**
+ * Memory types
+ */
+typedef enum CUmemorytype_enum {
+  CU_MEMORYTYPE_HOST = 0x01,   /**< Host memory */
+  CU_MEMORYTYPE_DEVICE = 0x02, /**< Device memory */
+  CU_MEMORYTYPE_ARRAY = 0x03,  /**< Array memory */
+  CU_MEMORYTYPE_UNIFIED = 0x04 /**< Unified device or host memory */
+} CUmemorytype;
+
+/**
+ * 3D memory copy parameters
+ */
+typedef struct CUDA_MEMCPY3D_st {
+  size_t srcXInBytes; /**< Source X in bytes */
+  size_t srcY;        /**< Source Y */
+  size_t srcZ;        /**< Source Z */
+  size_t srcLOD;      /**< Source LOD */
+  CUmemorytype srcMemoryType; /**< Source memory type (host, device, array) */
+  const void *srcHost;        /**< Source host pointer */
+  CUdeviceptr srcDevice;      /**< Source device pointer */
+  CUarray srcArray;           /**< Source array reference */
+  void *reserved0;            /**< Must be NULL */
+  size_t srcPitch;  /**< Source pitch (ignored when src is array) */
+  size_t srcHeight; /**< Source height (ignored when src is array) */
+
+  size_t dstXInBytes; /**< Destination X in bytes */
+  size_t dstY;        /**< Destination Y */
+  size_t dstZ;        /**< Destination Z */
+  size_t dstLOD;      /**< Destination LOD */
+  CUmemorytype dstMemoryType; /**< Destination memory type */
+  void *dstHost;              /**< Destination host pointer */
+  CUdeviceptr dstDevice;      /**< Destination device pointer */
+  CUarray dstArray;           /**< Destination array reference */
+  void *reserved1;            /**< Must be NULL */
+  size_t dstPitch;  /**< Destination pitch (ignored when dst is array) */
+  size_t dstHeight; /**< Destination height (ignored when dst is array) */
+
+  size_t WidthInBytes; /**< Width of 3D memory copy in bytes */
+  size_t Height;       /**< Height of 3D memory copy */
+  size_t Depth;        /**< Depth of 3D memory copy */
+} CUDA_MEMCPY3D;
+
 /**
  * CUDA Resource descriptor
  */
@@ -434,6 +512,22 @@ typedef struct CUDA_EXTERNAL_SEMAPHORE_WAIT_PARAMS_st {
  */
 #define CUDA_ARRAY3D_COLOR_ATTACHMENT 0x20
 
+/**
+ * Read the texture as integers rather than promoting the values to floats
+ * in the range [0,1].
+ */
+#define CU_TRSF_READ_AS_INTEGER 0x01
+
+/**
+ * Use normalized texture coordinates in the range [0,1) instead of [0,dim).
+ */
+#define CU_TRSF_NORMALIZED_COORDINATES 0x02
+
+/**
+ * Perform sRGB->linear conversion during texture read.
+ */
+#define CU_TRSF_SRGB 0x10
+
 // copy from cusparse.h
 struct cusparseContext;
 typedef struct cusparseContext *cusparseHandle_t;
@@ -546,6 +640,32 @@ typedef enum {
   CUSPARSE_DIAG_TYPE_UNIT = 1
 } cusparseDiagType_t;
 
+typedef enum {
+  CUSPARSE_SOLVE_POLICY_NO_LEVEL = 0,
+  CUSPARSE_SOLVE_POLICY_USE_LEVEL = 1
+} cusparseSolvePolicy_t;
+
+typedef enum {
+  CUSPARSE_SPMAT_FILL_MODE = 0,
+  CUSPARSE_SPMAT_DIAG_TYPE = 1
+} cusparseSpMatAttribute_t;
+
+typedef enum { CUSPARSE_SPSV_ALG_DEFAULT = 0 } cusparseSpSVAlg_t;
+
+typedef enum {
+  CUSPARSE_DIRECTION_ROW = 0,
+  CUSPARSE_DIRECTION_COLUMN = 1
+} cusparseDirection_t;
+
+struct cusparseSpSVDescr;
+typedef struct cusparseSpSVDescr *cusparseSpSVDescr_t;
+struct csric02Info;
+typedef struct csric02Info *csric02Info_t;
+struct csrilu02Info;
+typedef struct csrilu02Info *csrilu02Info_t;
+struct bsrsv2Info;
+typedef struct bsrsv2Info *bsrsv2Info_t;
+
 // copy from cusolver.h
 typedef enum libraryPropertyType_t {
   MAJOR_VERSION,
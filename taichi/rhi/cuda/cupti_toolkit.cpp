@@ -1,5 +1,8 @@
 #include "taichi/rhi/cuda/cupti_toolkit.h"
 #include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/system/timeline.h"
+
+#include <mutex>
 
 // move from cupti_toolkit.h
 // avoid exposing these headers
@@ -7,6 +10,7 @@
 #include <cupti_target.h>
 #include <cupti_result.h>
 #include <cupti_profiler_target.h>
+#include <cupti_activity.h>
 #include <nvperf_host.h>
 #include <nvperf_cuda_host.h>
 #include <nvperf_target.h>
@@ -1090,6 +1094,138 @@ bool CuptiToolkit::update_record(
   return true;
 }
 
+namespace {
+
+struct ActivityKernelRecord {
+  std::string name;
+  uint32_t correlation_id{0};
+  uint64_t start{0};
+  uint64_t end{0};
+};
+
+constexpr size_t kActivityBufferSize = 8 * 1024 * 1024;
+
+// Filled by the CUPTI callbacks, which may run on a thread of CUPTI.
+std::mutex activity_records_mut;
+std::vector<ActivityKernelRecord> activity_records;
+
+void CUPTIAPI activity_buffer_requested(uint8_t **buffer,
+                                        size_t *size,
+                                        size_t *max_num_records) {
+  // CUPTI requires 8-byte aligned buffers, which malloc() guarantees.
+  *buffer = (uint8_t *)std::malloc(kActivityBufferSize);
+  *size = kActivityBufferSize;
+  // As many records as fit in the buffer.
+  *max_num_records = 0;
+}
+
+void CUPTIAPI activity_buffer_completed(CUcontext ctx,
+                                        uint32_t stream_id,
+                                        uint8_t *buffer,
+                                        size_t size,
+                                        size_t valid_size) {
+  {
+    std::lock_guard<std::mutex> _(activity_records_mut);
+    CUpti_Activity *record = nullptr;
+    while (cuptiActivityGetNextRecord(buffer, valid_size, &record) ==
+           CUPTI_SUCCESS) {
+      if (record->kind != CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL) {
+        continue;
+      }
+      // The later versions of the kernel record only append fields to it.
+      auto *kernel = (CUpti_ActivityKernel4 *)record;
+      activity_records.push_back(
+          {kernel->name, kernel->correlationId, kernel->start, kernel->end});
+    }
+  }
+  std::free(buffer);
+}
+
+}  // namespace
+
+CuptiActivityToolkit::CuptiActivityToolkit() {
+}
+
+CuptiActivityToolkit::~CuptiActivityToolkit() {
+  if (enabled_) {
+    end_profiling();
+  }
+}
+
+bool CuptiActivityToolkit::begin_profiling() {
+  CUPTI_API_CALL(cuptiActivityRegisterCallbacks(activity_buffer_requested,
+                                                activity_buffer_completed));
+  CUPTI_API_CALL(cuptiActivityEnable(CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL));
+  CUPTI_API_CALL(cuptiGetTimestamp(&base_timestamp_));
+  base_time_ = Time::get_time();
+  enabled_ = true;
+  return true;
+}
+
+bool CuptiActivityToolkit::end_profiling() {
+  CUPTI_API_CALL(cuptiActivityFlushAll(0));
+  CUPTI_API_CALL(cuptiActivityDisable(CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL));
+  std::lock_guard<std::mutex> _(activity_records_mut);
+  activity_records.clear();
+  enabled_ = false;
+  return true;
+}
+
+bool CuptiActivityToolkit::update_record(
+    uint32_t records_size_after_sync,
+    std::vector<KernelProfileTracedRecord> &traced_records) {
+  // Delivers the records of the completed kernels to
+  // activity_buffer_completed() before returning.
+  CUPTI_API_CALL(cuptiActivityFlushAll(0));
+  std::vector<ActivityKernelRecord> records;
+  {
+    std::lock_guard<std::mutex> _(activity_records_mut);
+    records.swap(activity_records);
+  }
+  // The buffers are completed out of order, while the correlation ids follow
+  // the order of the launches, like |traced_records|.
+  std::sort(records.begin(), records.end(),
+            [](const ActivityKernelRecord &a, const ActivityKernelRecord &b) {
+              return a.correlation_id < b.correlation_id;
+            });
+
+  size_t j = 0;
+  for (size_t i = records_size_after_sync; i < traced_records.size(); i++) {
+    auto &traced = traced_records[i];
+    // Skips the kernels that are not launched by Taichi.
+    while (j < records.size() && records[j].name != traced.name) {
+      j++;
+    }
+    if (j == records.size()) {
+      TI_WARN("No CUPTI activity record for kernel {}", traced.name);
+      return false;
+    }
+    traced.kernel_elapsed_time_in_ms =
+        (records[j].end - records[j].start) * 1e-6;
+    traced.time_since_base =
+        (int64_t(records[j].start) - int64_t(base_timestamp_)) * 1e-6;
+    j++;
+  }
+  return true;
+}
+
+void CuptiActivityToolkit::update_timeline(
+    std::vector<KernelProfileTracedRecord> &traced_records) {
+  if (Timelines::get_instance().get_enabled()) {
+    auto &timeline = Timeline::get_this_thread_instance();
+    for (auto &record : traced_records) {
+      timeline.insert_event({record.name, /*param_name=begin*/ true,
+                             base_time_ + record.time_since_base * 1e-3,
+                             "cuda"});
+      timeline.insert_event({record.name, /*param_name=begin*/ false,
+                             base_time_ + (record.time_since_base +
+                                           record.kernel_elapsed_time_in_ms) *
+                                              1e-3,
+                             "cuda"});
+    }
+  }
+}
+
 // undef macros
 #undef NV_ANONYMOUS_VARIABLE_DIRECT
 #undef NV_ANONYMOUS_VARIABLE_INDIRECT
@@ -1128,6 +1264,26 @@ bool CuptiToolkit::update_record(
     std::vector<KernelProfileTracedRecord> &traced_records) {
   TI_NOT_IMPLEMENTED;
 }
+CuptiActivityToolkit::CuptiActivityToolkit() {
+  TI_NOT_IMPLEMENTED;
+}
+CuptiActivityToolkit::~CuptiActivityToolkit() {
+}
+bool CuptiActivityToolkit::begin_profiling() {
+  TI_NOT_IMPLEMENTED;
+}
+bool CuptiActivityToolkit::end_profiling() {
+  TI_NOT_IMPLEMENTED;
+}
+bool CuptiActivityToolkit::update_record(
+    uint32_t records_size_after_sync,
+    std::vector<KernelProfileTracedRecord> &traced_records) {
+  TI_NOT_IMPLEMENTED;
+}
+void CuptiActivityToolkit::update_timeline(
+    std::vector<KernelProfileTracedRecord> &traced_records) {
+  TI_NOT_IMPLEMENTED;
+}
 #endif
 
 }  // namespace taichi::lang
@@ -43,4 +43,28 @@ class CuptiToolkit {
   CuptiImage cupti_image_;
 };
 
+// Times the kernels with the CUPTI Activity API. The kernel records are
+// collected asynchronously, so unlike CuptiToolkit the kernels are neither
+// replayed nor serialized, and no event pairs are recorded around them like
+// in EventToolkit. Only the timing is collected, no metrics.
+class CuptiActivityToolkit {
+ public:
+  CuptiActivityToolkit();
+  ~CuptiActivityToolkit();
+
+  bool begin_profiling();
+  bool end_profiling();
+  // The kernels traced since |records_size_after_sync| must have completed.
+  bool update_record(uint32_t records_size_after_sync,
+                     std::vector<KernelProfileTracedRecord> &traced_records);
+  void update_timeline(std::vector<KernelProfileTracedRecord> &traced_records);
+
+ private:
+  [[maybe_unused]] bool enabled_{false};
+  // The host time and the CUPTI timestamp at begin_profiling(), which map
+  // the kernel records onto the timeline.
+  [[maybe_unused]] float64 base_time_{0.0};
+  [[maybe_unused]] uint64_t base_timestamp_{0};
+};
+
 }  // namespace taichi::lang
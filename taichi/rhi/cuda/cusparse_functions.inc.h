@@ -13,6 +13,8 @@ PER_CUSPARSE_FUNCTION(cpCreateMatDescr, cusparseCreateMatDescr, cusparseMatDescr
 PER_CUSPARSE_FUNCTION(cpDestroyMatDescr, cusparseDestroyMatDescr, cusparseMatDescr_t);
 PER_CUSPARSE_FUNCTION(cpSetMatType, cusparseSetMatType, cusparseMatDescr_t, cusparseMatrixType_t);
 PER_CUSPARSE_FUNCTION(cpSetMatIndexBase, cusparseSetMatIndexBase, cusparseMatDescr_t, cusparseIndexBase_t);
+PER_CUSPARSE_FUNCTION(cpSetMatFillMode, cusparseSetMatFillMode, cusparseMatDescr_t, cusparseFillMode_t);
+PER_CUSPARSE_FUNCTION(cpSetMatDiagType, cusparseSetMatDiagType, cusparseMatDescr_t, cusparseDiagType_t);
 PER_CUSPARSE_FUNCTION(cpDestroySpMat, cusparseDestroySpMat, cusparseSpMatDescr_t);
 PER_CUSPARSE_FUNCTION(cpCreateSpVec, cusparseCreateSpVec, cusparseSpVecDescr_t* ,int ,int,void*,void*,cusparseIndexType_t,cusparseIndexBase_t,cudaDataType);
 PER_CUSPARSE_FUNCTION(cpDestroySpVec, cusparseDestroySpVec, cusparseSpVecDescr_t);
@@ -48,3 +50,31 @@ PER_CUSPARSE_FUNCTION(cpDestroySpGEMM, cusparseSpGEMM_destroyDescr, cusparseSpGE
 // cusparse sparse matrix convertions
 PER_CUSPARSE_FUNCTION(cpCsr2cscEx2_bufferSize, cusparseCsr2cscEx2_bufferSize, cusparseHandle_t, int, int, int, const void*, const int*, const int*, void*, int*, int*, cudaDataType, cusparseAction_t, cusparseIndexBase_t, cusparseCsr2CscAlg_t, size_t*);
 PER_CUSPARSE_FUNCTION(cpCsr2cscEx2, cusparseCsr2cscEx2, cusparseHandle_t, int, int, int, const void*, const int*, const int*, void*, int*, int*, cudaDataType, cusparseAction_t, cusparseIndexBase_t, cusparseCsr2CscAlg_t, void*);
+
+// cusparse incomplete factorizations
+PER_CUSPARSE_FUNCTION(cpCreateCsric02Info, cusparseCreateCsric02Info, csric02Info_t*);
+PER_CUSPARSE_FUNCTION(cpDestroyCsric02Info, cusparseDestroyCsric02Info, csric02Info_t);
+PER_CUSPARSE_FUNCTION(cpScsric02_bufferSize, cusparseScsric02_bufferSize, cusparseHandle_t, int, int, const cusparseMatDescr_t, void*, const void*, const void*, csric02Info_t, int*);
+PER_CUSPARSE_FUNCTION(cpScsric02_analysis, cusparseScsric02_analysis, cusparseHandle_t, int, int, const cusparseMatDescr_t, const void*, const void*, const void*, csric02Info_t, cusparseSolvePolicy_t, void*);
+PER_CUSPARSE_FUNCTION(cpScsric02, cusparseScsric02, cusparseHandle_t, int, int, const cusparseMatDescr_t, void*, const void*, const void*, csric02Info_t, cusparseSolvePolicy_t, void*);
+PER_CUSPARSE_FUNCTION(cpCreateCsrilu02Info, cusparseCreateCsrilu02Info, csrilu02Info_t*);
+PER_CUSPARSE_FUNCTION(cpDestroyCsrilu02Info, cusparseDestroyCsrilu02Info, csrilu02Info_t);
+PER_CUSPARSE_FUNCTION(cpScsrilu02_bufferSize, cusparseScsrilu02_bufferSize, cusparseHandle_t, int, int, const cusparseMatDescr_t, void*, const void*, const void*, csrilu02Info_t, int*);
+PER_CUSPARSE_FUNCTION(cpScsrilu02_analysis, cusparseScsrilu02_analysis, cusparseHandle_t, int, int, const cusparseMatDescr_t, const void*, const void*, const void*, csrilu02Info_t, cusparseSolvePolicy_t, void*);
+PER_CUSPARSE_FUNCTION(cpScsrilu02, cusparseScsrilu02, cusparseHandle_t, int, int, const cusparseMatDescr_t, void*, const void*, const void*, csrilu02Info_t, cusparseSolvePolicy_t, void*);
+
+// cusparse sparse triangular solve
+PER_CUSPARSE_FUNCTION(cpSpMatSetAttribute, cusparseSpMatSetAttribute, cusparseSpMatDescr_t, cusparseSpMatAttribute_t, void*, size_t);
+PER_CUSPARSE_FUNCTION(cpSpSV_createDescr, cusparseSpSV_createDescr, cusparseSpSVDescr_t*);
+PER_CUSPARSE_FUNCTION(cpSpSV_destroyDescr, cusparseSpSV_destroyDescr, cusparseSpSVDescr_t);
+PER_CUSPARSE_FUNCTION(cpSpSV_bufferSize, cusparseSpSV_bufferSize, cusparseHandle_t, cusparseOperation_t, const void*, cusparseSpMatDescr_t, cusparseDnVecDescr_t, cusparseDnVecDescr_t, cudaDataType, cusparseSpSVAlg_t, cusparseSpSVDescr_t, size_t*);
+PER_CUSPARSE_FUNCTION(cpSpSV_analysis, cusparseSpSV_analysis, cusparseHandle_t, cusparseOperation_t, const void*, cusparseSpMatDescr_t, cusparseDnVecDescr_t, cusparseDnVecDescr_t, cudaDataType, cusparseSpSVAlg_t, cusparseSpSVDescr_t, void*);
+PER_CUSPARSE_FUNCTION(cpSpSV_solve, cusparseSpSV_solve, cusparseHandle_t, cusparseOperation_t, const void*, cusparseSpMatDescr_t, cusparseDnVecDescr_t, cusparseDnVecDescr_t, cudaDataType, cusparseSpSVAlg_t, cusparseSpSVDescr_t);
+
+// cusparse block sparse row (BSR) matrices
+PER_CUSPARSE_FUNCTION(cpSbsrmv, cusparseSbsrmv, cusparseHandle_t, cusparseDirection_t, cusparseOperation_t, int, int, int, const float*, const cusparseMatDescr_t, const float*, const int*, const int*, int, const float*, const float*, float*);
+PER_CUSPARSE_FUNCTION(cpCreateBsrsv2Info, cusparseCreateBsrsv2Info, bsrsv2Info_t*);
+PER_CUSPARSE_FUNCTION(cpDestroyBsrsv2Info, cusparseDestroyBsrsv2Info, bsrsv2Info_t);
+PER_CUSPARSE_FUNCTION(cpSbsrsv2_bufferSize, cusparseSbsrsv2_bufferSize, cusparseHandle_t, cusparseDirection_t, cusparseOperation_t, int, int, const cusparseMatDescr_t, float*, const int*, const int*, int, bsrsv2Info_t, int*);
+PER_CUSPARSE_FUNCTION(cpSbsrsv2_analysis, cusparseSbsrsv2_analysis, cusparseHandle_t, cusparseDirection_t, cusparseOperation_t, int, int, const cusparseMatDescr_t, const float*, const int*, const int*, int, bsrsv2Info_t, cusparseSolvePolicy_t, void*);
+PER_CUSPARSE_FUNCTION(cpSbsrsv2_solve, cusparseSbsrsv2_solve, cusparseHandle_t, cusparseDirection_t, cusparseOperation_t, int, int, const float*, const cusparseMatDescr_t, const float*, const int*, const int*, int, bsrsv2Info_t, const float*, float*, cusparseSolvePolicy_t, void*);
@@ -97,6 +97,34 @@ constexpr DevicePtr kDeviceNullPtr{};
 // TODO: fill this with the required options
 struct ImageSamplerConfig {};
 
+// The triangle mesh an acceleration structure is built over.
+struct AccelerationStructureParams {
+  // Three float32 per vertex, |vertex_stride| bytes apart.
+  DevicePtr vertices{kDeviceNullPtr};
+  uint32_t num_vertices{0};
+  uint32_t vertex_stride{3 * sizeof(float)};
+  // Three uint32_t per triangle. Without indices, every three consecutive
+  // vertices form a triangle.
+  DevicePtr indices{kDeviceNullPtr};
+  uint32_t num_triangles{0};
+  // Whether the structure can be refit after the vertices have moved, which
+  // is faster than a rebuild but gives a structure of lower quality.
+  bool allow_update{false};
+};
+
+/**
+ * A ray tracing acceleration structure (e.g. a BVH built by the driver) over
+ * a triangle mesh, which shaders can trace rays against with ray queries.
+ * - The structure only refers to the memory of the mesh, whose contents are
+ *   read by CommandList::build_acceleration_structure()
+ */
+class TI_DLL_EXPORT AccelerationStructure {
+ public:
+  virtual ~AccelerationStructure() = default;
+};
+
+using UAccelerationStructure = std::unique_ptr<AccelerationStructure>;
+
 // A set of shader resources (that is bound at once)
 class TI_DLL_EXPORT ShaderResourceSet {
  public:
@@ -160,6 +188,18 @@ class TI_DLL_EXPORT ShaderResourceSet {
                                       int lod) {
     TI_NOT_IMPLEMENTED
   }
+
+  /**
+   * Bind an acceleration structure for ray queries
+   * - The structure must have been built before the bound shaders run
+   * @params binding The binding index of the resource
+   * @params accel The acceleration structure that is going to be bound
+   */
+  virtual ShaderResourceSet &acceleration_structure(
+      uint32_t binding,
+      AccelerationStructure *accel) {
+    TI_NOT_IMPLEMENTED
+  }
 };
 
 // A set of states / resources for rasterization
@@ -370,6 +410,20 @@ class TI_DLL_EXPORT CommandList {
                            size_t size,
                            uint32_t data) noexcept = 0;
 
+  /**
+   * Times the commands recorded until the matching `end_profiler_scope`, e.g.
+   * the dispatches of an offloaded task.
+   * The device time of the scope is returned by `Stream::pop_profiler_records`
+   * once the command list has completed.
+   * - Scopes can not be nested.
+   * - This is a no-op if the backend does not support timestamp queries.
+   * @params[in] name The name that the scope is reported with
+   */
+  virtual void begin_profiler_scope(const std::string &name) noexcept {
+  }
+  virtual void end_profiler_scope() noexcept {
+  }
+
   /**
    * Enqueues a compute operation with {X, Y, Z} amount of workgroups.
    * The block size / workgroup size is pre-determined within the pipeline.
@@ -418,6 +472,24 @@ class TI_DLL_EXPORT CommandList {
     return RhiResult::not_supported;
   }
 
+  /**
+   * Enqueues a compute operation whose workgroup counts are read from device
+   * memory when the operation executes, so that the sizes can be produced by
+   * a previous dispatch without a host round trip.
+   * - `args` must point to three consecutive uint32_t: {X, Y, Z}
+   * - The memory must be allocated with `AllocUsage::Indirect`
+   * - Writes to the arguments must be made visible with a barrier before
+   * - Otherwise behaves like `dispatch(x, y, z)`
+   * @params[in] args The device pointer to the dispatch arguments
+   * @return The status of this operation
+   * - `success` if the operation is successful
+   * - `invalid_operation` if the current pipeline has variable block size
+   * - `not_supported` if the device can't dispatch indirectly
+   */
+  virtual RhiResult dispatch_indirect(DevicePtr args) noexcept {
+    return RhiResult::not_supported;
+  }
+
   // These are not implemented in compute only device
   virtual void begin_renderpass(int x0,
                                 int y0,
@@ -458,6 +530,49 @@ class TI_DLL_EXPORT CommandList {
                                      uint32_t start_instance = 0) {
     TI_NOT_IMPLEMENTED
   }
+  /**
+   * Draws with the parameters read from device memory when the draw executes,
+   * so that they can be produced by a previous compute dispatch.
+   * - `args` must point to four consecutive uint32_t: {vertex count,
+   *   instance count, first vertex, first instance}
+   * - The memory must be allocated with `AllocUsage::Indirect`
+   * @params[in] args The device pointer to the draw arguments
+   * @return The status of this operation
+   * - `success` if the operation is successful
+   * - `not_supported` if the device can't draw indirectly
+   */
+  virtual RhiResult draw_indirect(DevicePtr args) noexcept {
+    return RhiResult::not_supported;
+  }
+  /**
+   * Indexed version of `draw_indirect`.
+   * - `args` must point to five consecutive 32-bit integers: {index count,
+   *   instance count, first index, vertex offset, first instance}
+   * @params[in] args The device pointer to the draw arguments
+   * @return The status of this operation
+   * - `success` if the operation is successful
+   * - `not_supported` if the device can't draw indirectly
+   */
+  virtual RhiResult draw_indexed_indirect(DevicePtr args) noexcept {
+    return RhiResult::not_supported;
+  }
+  /**
+   * Builds an acceleration structure from the current contents of its mesh,
+   * and makes it visible to the shaders dispatched afterwards.
+   * - Writes to the mesh must be made visible with a barrier before
+   * @params[in] accel The acceleration structure to build
+   * @params[in] update Refit the structure that has been built before to the
+   * moved vertices, instead of building it from scratch. The triangles must be
+   * the same, and the structure must be created with `allow_update`.
+   * @return The status of this operation
+   * - `success` if the operation is successful
+   * - `invalid_usage` if `update` is set for a structure that can't be refit
+   * - `not_supported` if the device has no acceleration structures
+   */
+  virtual RhiResult build_acceleration_structure(AccelerationStructure *accel,
+                                                 bool update = false) noexcept {
+    return RhiResult::not_supported;
+  }
   virtual void image_transition(DeviceAllocation img,
                                 ImageLayout old_layout,
                                 ImageLayout new_layout) {
@@ -489,6 +604,16 @@ class TI_DLL_EXPORT CommandList {
                           const ImageCopyParams &params) {
     TI_NOT_IMPLEMENTED
   }
+  /**
+   * Fill every level of the mip chain of an image but the first one, by
+   * downsampling the level above it with a linear filter.
+   * @params[in] img The image whose first level has been written
+   * @params[in] img_layout The layout of all the levels, both before and after
+   * the generation
+   */
+  virtual void generate_mipmaps(DeviceAllocation img, ImageLayout img_layout) {
+    TI_NOT_IMPLEMENTED
+  }
 };
 
 struct PipelineSourceDesc {
@@ -505,6 +630,7 @@ enum class AllocUsage : int {
   Uniform = 2,
   Vertex = 4,
   Index = 8,
+  Indirect = 16,
 };
 
 MAKE_ENUM_FLAGS(AllocUsage)
@@ -548,9 +674,50 @@ class TI_DLL_EXPORT Stream {
 
   virtual void command_sync() = 0;
 
+  /**
+   * Returns the id of the last submission to the stream. The ids increase
+   * monotonically from 1 in submission order, and 0 means no submission.
+   * Streams that don't number their submissions always return 0, and their
+   * waits below wait for all the submissions.
+   */
+  virtual uint64_t last_submission_id() const {
+    return 0;
+  }
+
+  /**
+   * Whether the submission |id| and the ones before it have completed.
+   */
+  virtual bool is_submission_complete(uint64_t id) {
+    command_sync();
+    return true;
+  }
+
+  /**
+   * Waits for the submission |id| and the ones before it, while the later
+   * submissions may stay in flight.
+   */
+  virtual void wait_for_submission(uint64_t id) {
+    command_sync();
+  }
+
   virtual double device_time_elapsed_us() const {
     TI_NOT_IMPLEMENTED
   }
+
+  struct ProfilerRecord {
+    std::string name;
+    double elapsed_us{0.0};
+  };
+
+  /**
+   * Returns the profiler scopes of the command lists that have completed
+   * since the last call, in submission order.
+   * This does not wait for the device, so the scopes of command lists that are
+   * still in flight are returned by later calls.
+   */
+  virtual std::vector<ProfilerRecord> pop_profiler_records() {
+    return {};
+  }
 };
 
 class TI_DLL_EXPORT PipelineCache {
@@ -571,6 +738,18 @@ class TI_DLL_EXPORT PipelineCache {
   virtual size_t size() const noexcept {
     return 0;
   }
+
+  /**
+   * Merge the data of another cache into this one, e.g. the data that another
+   * process has persisted in the meantime.
+   * - The backend API may ignore this data or deem it incompatible.
+   * @params[in] size Size of the data.
+   * @params[in] data The data to be merged.
+   * @return The status of this operation.
+   */
+  virtual RhiResult merge(size_t size, const void *data) noexcept {
+    return RhiResult::not_supported;
+  }
 };
 
 using UPipelineCache = std::unique_ptr<PipelineCache>;
@@ -632,6 +811,15 @@ class TI_DLL_EXPORT Device {
     return std::make_pair(UPipelineCache(cache), res);
   }
 
+  /**
+   * Get a string that identifies the driver and the physical device, so that
+   * pipeline caches persisted for different drivers can be told apart.
+   * - Empty if the backend does not create pipeline caches.
+   */
+  virtual std::string get_pipeline_cache_key() const noexcept {
+    return "";
+  }
+
   /**
    * Create a Pipeline. A Pipeline is a program that can be dispatched into a
    * stream through a command list.
@@ -667,6 +855,34 @@ class TI_DLL_EXPORT Device {
         this->allocate_memory(params));
   }
 
+  /**
+   * Create an acceleration structure over a triangle mesh for ray queries,
+   * which is available if the device has `spirv_has_ray_query`.
+   * - The memory of the mesh must be allocated with `AllocUsage::Storage`,
+   *   `AllocUsage::Vertex` or `AllocUsage::Index`
+   * - The structure is empty until it is built by a command list
+   * @params[out] out_accel The created acceleration structure.
+   * @params[in] params The mesh the structure is built over.
+   * @return The status of this operation.
+   * - `success` if the structure is created successfully.
+   * - `out_of_memory` if operation failed due to lack of device memory.
+   * - `not_supported` if the device has no acceleration structures.
+   */
+  virtual RhiResult create_acceleration_structure(
+      AccelerationStructure **out_accel,
+      const AccelerationStructureParams &params) noexcept {
+    *out_accel = nullptr;
+    return RhiResult::not_supported;
+  }
+
+  inline std::pair<UAccelerationStructure, RhiResult>
+  create_acceleration_structure_unique(
+      const AccelerationStructureParams &params) noexcept {
+    AccelerationStructure *accel{nullptr};
+    RhiResult res = this->create_acceleration_structure(&accel, params);
+    return std::make_pair(UAccelerationStructure(accel), res);
+  }
+
   virtual uint64_t fetch_result_uint64(int i, uint64_t *result_buffer) {
     TI_NOT_IMPLEMENTED
   }
@@ -674,6 +890,19 @@ class TI_DLL_EXPORT Device {
   // Each thraed will acquire its own stream
   virtual Stream *get_compute_stream() = 0;
 
+  /**
+   * Get the stream of the calling thread for transfers, which may run
+   * concurrently with the compute stream when the device has a dedicated
+   * transfer queue. Work on the two streams is only ordered by the semaphores
+   * passed to submit(). Command lists of this stream may only record buffer
+   * copies and fills.
+   * @return The transfer stream, which is the compute stream on devices
+   * without a dedicated transfer queue.
+   */
+  virtual Stream *get_transfer_stream() {
+    return get_compute_stream();
+  }
+
   // Wait for all tasks to complete (task from all streams)
   virtual void wait_idle() = 0;
 
@@ -812,6 +1041,10 @@ struct SurfaceConfig {
   uint32_t width{1};
   uint32_t height{1};
   void *native_surface_handle{nullptr};
+  // Whether present_image() waits for the device to become idle. Callers
+  // tracking the completion of their frames can disable it to keep frames
+  // in flight.
+  bool sync_on_present{true};
 };
 
 enum class ImageAllocUsage : int {
@@ -835,6 +1068,9 @@ struct ImageParams {
   uint32_t x{1};
   uint32_t y{1};
   uint32_t z{1};
+  // The number of levels in the mip chain, clamped to the full chain down to
+  // 1x1x1. Devices without mip chains always create a single level.
+  uint32_t mip_levels{1};
   bool export_sharing{false};
   ImageAllocUsage usage{ImageAllocUsage::Storage | ImageAllocUsage::Sampled |
                         ImageAllocUsage::Attachment};
@@ -232,6 +232,36 @@ RhiResult Dx11CommandList::dispatch(uint32_t x,
   return RhiResult::success;
 }
 
+RhiResult Dx11CommandList::dispatch_indirect(DevicePtr args) noexcept {
+  ID3D11Buffer *args_buf =
+      device_->alloc_id_to_buffer(d3d11_deferred_context_, args.alloc_id);
+
+  // SPIRV_Cross_NumWorkgroups has to mirror the arguments, which only exist
+  // on the GPU, so copy them over instead of filling the CB from the host.
+  auto cb_slot = cb_slot_watermark_ + 1;
+  auto spirv_cross_numworkgroups_cb =
+      device_->create_spirv_cross_numworkgroups_gpu_cb();
+  D3D11_BOX box{};
+  box.left = args.offset;
+  box.right = args.offset + sizeof(uint32_t) * 3;
+  box.top = 0;
+  box.bottom = 1;
+  box.front = 0;
+  box.back = 1;
+  d3d11_deferred_context_->CopySubresourceRegion(
+      spirv_cross_numworkgroups_cb, 0, 0, 0, 0, args_buf, 0, &box);
+  d3d11_deferred_context_->CSSetConstantBuffers(cb_slot, 1,
+                                                &spirv_cross_numworkgroups_cb);
+  used_spv_workgroup_cb.push_back(spirv_cross_numworkgroups_cb);
+
+  // Reset watermark
+  cb_slot_watermark_ = -1;
+
+  d3d11_deferred_context_->DispatchIndirect(args_buf, args.offset);
+
+  return RhiResult::success;
+}
+
 void Dx11CommandList::begin_renderpass(int x0,
                                        int y0,
                                        int x1,
@@ -648,6 +678,9 @@ ID3D11Buffer *Dx11Device::BufferTuple::get_raw_buffer(
     desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
     desc.ByteWidth = size;
     desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+    if (indirect_args) {
+      desc.MiscFlags |= D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+    }
     HRESULT ret = device->CreateBuffer(&desc, nullptr, &raw_buffer);
     check_dx_error(ret, "Create raw buffer");
   }
@@ -731,6 +764,7 @@ DeviceAllocation Dx11Device::allocate_memory(const AllocParams &params) {
   tuple.cpu_read = params.host_read;
   tuple.cpu_write = params.host_write;
   tuple.size = params.size;
+  tuple.indirect_args = params.usage && AllocUsage::Indirect;
   // TODO: pick better default copy
   // FIXME: Fix index / vertex
   if (params.usage && AllocUsage::Storage) {
@@ -930,6 +964,23 @@ ID3D11Buffer *Dx11Device::set_spirv_cross_numworkgroups(uint32_t x,
   return spirv_cross_numworkgroups_cb;
 }
 
+ID3D11Buffer *Dx11Device::create_spirv_cross_numworkgroups_gpu_cb() {
+  D3D11_BUFFER_DESC cb_desc;
+  cb_desc.ByteWidth = 16;
+  cb_desc.Usage = D3D11_USAGE_DEFAULT;
+  cb_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+  cb_desc.CPUAccessFlags = 0;
+  cb_desc.MiscFlags = 0;
+  cb_desc.StructureByteStride = 0;
+
+  ID3D11Buffer *spirv_cross_numworkgroups_cb;
+  HRESULT hr =
+      device_->CreateBuffer(&cb_desc, nullptr, &spirv_cross_numworkgroups_cb);
+  check_dx_error(hr, "Create GPU CB for spirv num_workgroups");
+
+  return spirv_cross_numworkgroups_cb;
+}
+
 Dx11Stream::Dx11Stream(Dx11Device *device_) : device_(device_) {
 }
 
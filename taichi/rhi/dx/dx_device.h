@@ -122,6 +122,7 @@ class Dx11CommandList : public CommandList {
   void buffer_copy(DevicePtr dst, DevicePtr src, size_t size) noexcept final;
   void buffer_fill(DevicePtr ptr, size_t size, uint32_t data) noexcept final;
   RhiResult dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1) noexcept final;
+  RhiResult dispatch_indirect(DevicePtr args) noexcept final;
 
   // These are not implemented in compute only device
   void begin_renderpass(int x0,
@@ -244,6 +245,8 @@ class Dx11Device : public GraphicsDevice {
                                               uint32_t y,
                                               uint32_t z,
                                               int cb_slot);
+  // Same as above, but the contents are copied on the GPU by the caller.
+  ID3D11Buffer *create_spirv_cross_numworkgroups_gpu_cb();
 
  private:
   void create_dx11_device();
@@ -264,6 +267,7 @@ class Dx11Device : public GraphicsDevice {
     size_t size{0};
     bool cpu_read{false};
     bool cpu_write{false};
+    bool indirect_args{false};
     int default_copy{0};
 
     ~BufferTuple();
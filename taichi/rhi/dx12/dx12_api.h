@@ -11,6 +11,12 @@ namespace directx12 {
 
 bool is_dx12_api_available();
 
+// FIXME: there is no DX12 Device yet, so this returns nullptr and DX12 only
+// supports AOT compilation. A device implementation should keep launch
+// overhead on par with Vulkan: sub-allocate descriptor tables from a
+// shader-visible descriptor heap ring, pool command allocators and command
+// lists per submission, cache pipelines in an ID3D12PipelineLibrary (backing
+// the RHI pipeline cache), and pass small kernel arguments as root constants.
 std::shared_ptr<Device> make_dx12_device();
 
 std::vector<uint8_t> validate_and_sign(
@@ -7,6 +7,8 @@
 #include "taichi/rhi/vulkan/vulkan_device.h"
 #endif  // TI_WITH_VULKAN && TI_WITH_CUDA
 
+#include <map>
+#include <mutex>
 #include <unordered_map>
 
 namespace taichi::lang {
@@ -128,13 +130,127 @@ void *get_cuda_memory_pointer(VkDeviceMemory mem,
                               VkDeviceSize mem_size,
                               VkDeviceSize offset,
                               VkDeviceSize buffer_size,
-                              VkDevice device) {
+                              VkDevice device,
+                              CUexternalMemory *ext_mem = nullptr) {
   auto handle = get_device_mem_handle(mem, device);
   CUexternalMemory externalMem =
       import_vk_memory_object_from_handle(handle, mem_size, false);
+  if (ext_mem) {
+    *ext_mem = externalMem;
+  }
   return map_buffer_onto_external_memory(externalMem, offset, buffer_size);
 }
 
+#ifdef _WIN64
+constexpr VkExternalSemaphoreHandleTypeFlagBits kSemaphoreHandleType =
+    VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT;
+
+HANDLE get_semaphore_handle(VkSemaphore semaphore, VkDevice device) {
+  HANDLE handle;
+
+  VkSemaphoreGetWin32HandleInfoKHR semaphore_get_win32_handle_info = {};
+  semaphore_get_win32_handle_info.sType =
+      VK_STRUCTURE_TYPE_SEMAPHORE_GET_WIN32_HANDLE_INFO_KHR;
+  semaphore_get_win32_handle_info.pNext = nullptr;
+  semaphore_get_win32_handle_info.semaphore = semaphore;
+  semaphore_get_win32_handle_info.handleType = kSemaphoreHandleType;
+
+  auto fpGetSemaphoreWin32HandleKHR =
+      (PFN_vkGetSemaphoreWin32HandleKHR)vkGetDeviceProcAddr(
+          device, "vkGetSemaphoreWin32HandleKHR");
+
+  if (fpGetSemaphoreWin32HandleKHR == nullptr) {
+    TI_ERROR("vkGetSemaphoreWin32HandleKHR is nullptr");
+  }
+
+  auto result = fpGetSemaphoreWin32HandleKHR(
+      device, &semaphore_get_win32_handle_info, &handle);
+  if (result != VK_SUCCESS) {
+    TI_ERROR("vkGetSemaphoreWin32HandleKHR failed");
+  }
+
+  return handle;
+}
+#else
+constexpr VkExternalSemaphoreHandleTypeFlagBits kSemaphoreHandleType =
+    VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+int get_semaphore_handle(VkSemaphore semaphore, VkDevice device) {
+  int fd;
+
+  VkSemaphoreGetFdInfoKHR semaphore_get_fd_info = {};
+  semaphore_get_fd_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR;
+  semaphore_get_fd_info.pNext = nullptr;
+  semaphore_get_fd_info.semaphore = semaphore;
+  semaphore_get_fd_info.handleType = kSemaphoreHandleType;
+
+  auto fpGetSemaphoreFdKHR = (PFN_vkGetSemaphoreFdKHR)vkGetDeviceProcAddr(
+      device, "vkGetSemaphoreFdKHR");
+
+  if (fpGetSemaphoreFdKHR == nullptr) {
+    TI_ERROR("vkGetSemaphoreFdKHR is nullptr");
+  }
+  auto result = fpGetSemaphoreFdKHR(device, &semaphore_get_fd_info, &fd);
+  if (result != VK_SUCCESS) {
+    TI_ERROR("vkGetSemaphoreFdKHR failed");
+  }
+
+  return fd;
+}
+#endif
+
+CUexternalSemaphore import_vk_semaphore_object(VkSemaphore semaphore,
+                                               VkDevice device) {
+  CUexternalSemaphore ext_sema = nullptr;
+  CUDA_EXTERNAL_SEMAPHORE_HANDLE_DESC desc = {};
+
+  memset(&desc, 0, sizeof(desc));
+
+#ifdef _WIN64
+  desc.type = CU_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32;
+  desc.handle.win32.handle = get_semaphore_handle(semaphore, device);
+#else
+  desc.type = CU_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD;
+  desc.handle.fd = get_semaphore_handle(semaphore, device);
+#endif
+  CUDADriver::get_instance().import_external_semaphore(&ext_sema, &desc);
+  return ext_sema;
+}
+
+// A Vulkan semaphore that is signalled from a CUDA stream. The CUDA handle of
+// the semaphore can only be destroyed once the signal has been performed.
+class CudaSignalledSemaphoreObject : public VulkanStreamSemaphoreObject {
+ public:
+  CudaSignalledSemaphoreObject(vkapi::IVkSemaphore sema,
+                               CUexternalSemaphore ext_sema,
+                               void *signal_event)
+      : VulkanStreamSemaphoreObject(sema),
+        ext_sema_(ext_sema),
+        signal_event_(signal_event) {
+  }
+
+  ~CudaSignalledSemaphoreObject() override {
+    CUDADriver::get_instance().event_synchronize(signal_event_);
+    CUDADriver::get_instance().event_destroy(signal_event_);
+    CUDADriver::get_instance().destroy_external_semaphore(ext_sema_);
+  }
+
+ private:
+  CUexternalSemaphore ext_sema_{nullptr};
+  void *signal_event_{nullptr};
+};
+
+struct SharedMemoryRecord {
+  DeviceAllocation vk_alloc;
+  uint64_t size{0};
+  CUexternalMemory ext_mem{nullptr};
+};
+
+// Vulkan device -> CUDA base pointer -> shared memory.
+std::mutex shared_memory_mut;
+std::unordered_map<Device *, std::map<uint64_t, SharedMemoryRecord>>
+    shared_memory_records;
+
 void cuda_memcpy(void *dst, void *src, size_t size) {
   CUDADriver::get_instance().memcpy_device_to_device(dst, src, size);
 }
@@ -217,6 +333,139 @@ void memcpy_vulkan_to_cuda(DevicePtr dst, DevicePtr src, uint64_t size) {
   cuda_memcpy(dst_cuda_ptr, src_cuda_ptr, size);
 }
 
+VulkanCudaSharedMemory allocate_vulkan_cuda_shared_memory(Device *vk_dev_,
+                                                          uint64_t size) {
+  VulkanDevice *vk_dev = dynamic_cast<VulkanDevice *>(vk_dev_);
+  TI_ASSERT(vk_dev != nullptr);
+  TI_ERROR_IF(!vk_dev->vk_caps().external_memory,
+              "The Vulkan device does not support exporting memory");
+  CUDAContext::get_instance().make_current();
+
+  VulkanCudaSharedMemory mem;
+  mem.size = size;
+  mem.vk_alloc = vk_dev->allocate_memory({size, /*host_write=*/false,
+                                          /*host_read=*/false,
+                                          /*export_sharing=*/true,
+                                          AllocUsage::Storage});
+  auto [base_mem, alloc_offset, alloc_size] =
+      vk_dev->get_vkmemory_offset_size(mem.vk_alloc);
+  SharedMemoryRecord record{mem.vk_alloc, size, nullptr};
+  mem.cuda_ptr = get_cuda_memory_pointer(
+      base_mem, /*mem_size=*/alloc_offset + alloc_size,
+      /*offset=*/alloc_offset, /*buffer_size=*/alloc_size, vk_dev->vk_device(),
+      &record.ext_mem);
+
+  std::lock_guard<std::mutex> _(shared_memory_mut);
+  shared_memory_records[vk_dev][(uint64_t)mem.cuda_ptr] = record;
+  return mem;
+}
+
+void free_vulkan_cuda_shared_memory(const VulkanCudaSharedMemory &mem) {
+  Device *vk_dev = mem.vk_alloc.device;
+  SharedMemoryRecord record;
+  {
+    std::lock_guard<std::mutex> _(shared_memory_mut);
+    auto &records = shared_memory_records[vk_dev];
+    auto it = records.find((uint64_t)mem.cuda_ptr);
+    TI_ASSERT(it != records.end());
+    record = it->second;
+    records.erase(it);
+  }
+  // Mapped buffers must be freed before their external memory is destroyed.
+  CUDAContext::get_instance().make_current();
+  CUDADriver::get_instance().mem_free(mem.cuda_ptr);
+  CUDADriver::get_instance().destroy_external_memory(record.ext_mem);
+  vk_dev->dealloc_memory(record.vk_alloc);
+}
+
+DevicePtr find_vulkan_cuda_shared_memory(Device *vk_dev, DevicePtr cuda_ptr) {
+  CudaDevice *cuda_dev = dynamic_cast<CudaDevice *>(cuda_ptr.device);
+  if (cuda_dev == nullptr) {
+    return kDeviceNullPtr;
+  }
+  const uint64_t ptr =
+      (uint64_t)cuda_dev->get_alloc_info(cuda_ptr).ptr + cuda_ptr.offset;
+
+  std::lock_guard<std::mutex> _(shared_memory_mut);
+  auto dev_it = shared_memory_records.find(vk_dev);
+  if (dev_it == shared_memory_records.end()) {
+    return kDeviceNullPtr;
+  }
+  auto &records = dev_it->second;
+  auto it = records.upper_bound(ptr);
+  if (it == records.begin()) {
+    return kDeviceNullPtr;
+  }
+  --it;
+  const uint64_t offset = ptr - it->first;
+  if (offset >= it->second.size) {
+    return kDeviceNullPtr;
+  }
+  return it->second.vk_alloc.get_ptr(offset);
+}
+
+StreamSemaphore signal_vulkan_semaphore_from_cuda(Device *vk_dev_) {
+  VulkanDevice *vk_dev = dynamic_cast<VulkanDevice *>(vk_dev_);
+  TI_ASSERT(vk_dev != nullptr);
+  CUDAContext::get_instance().make_current();
+  void *stream = CUDAContext::get_instance().get_stream();
+
+  VkExportSemaphoreCreateInfo export_info = {};
+  export_info.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
+  export_info.pNext = nullptr;
+  export_info.handleTypes = kSemaphoreHandleType;
+  auto sema = vkapi::create_semaphore(vk_dev->vk_device(), 0, &export_info);
+  CUexternalSemaphore ext_sema =
+      import_vk_semaphore_object(sema->semaphore, vk_dev->vk_device());
+
+  CUDA_EXTERNAL_SEMAPHORE_SIGNAL_PARAMS params = {};
+  memset(&params, 0, sizeof(params));
+  CUDADriver::get_instance().signal_external_semaphore_async(
+      &ext_sema, &params, 1, stream);
+
+  void *signal_event = nullptr;
+  CUDADriver::get_instance().event_create(&signal_event, CU_EVENT_DEFAULT);
+  CUDADriver::get_instance().event_record(signal_event, stream);
+  return std::make_shared<CudaSignalledSemaphoreObject>(sema, ext_sema,
+                                                        signal_event);
+}
+
+StreamSemaphore wait_cuda_for_vulkan_graphics(Device *vk_dev_) {
+  VulkanDevice *vk_dev = dynamic_cast<VulkanDevice *>(vk_dev_);
+  TI_ASSERT(vk_dev != nullptr);
+  CUDAContext::get_instance().make_current();
+  void *stream = CUDAContext::get_instance().get_stream();
+
+  VkExportSemaphoreCreateInfo export_info = {};
+  export_info.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
+  export_info.pNext = nullptr;
+  export_info.handleTypes = kSemaphoreHandleType;
+  auto sema = vkapi::create_semaphore(vk_dev->vk_device(), 0, &export_info);
+
+  // An empty batch signals once everything submitted before it completes.
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.signalSemaphoreCount = 1;
+  submit_info.pSignalSemaphores = &sema->semaphore;
+  BAIL_ON_VK_BAD_RESULT_NO_RETURN(
+      vkQueueSubmit(vk_dev->graphics_queue(), /*submitCount=*/1, &submit_info,
+                    /*fence=*/VK_NULL_HANDLE),
+      "failed to submit semaphore signal");
+
+  CUexternalSemaphore ext_sema =
+      import_vk_semaphore_object(sema->semaphore, vk_dev->vk_device());
+  CUDA_EXTERNAL_SEMAPHORE_WAIT_PARAMS params = {};
+  memset(&params, 0, sizeof(params));
+  CUDADriver::get_instance().wait_external_semaphore_async(&ext_sema, &params,
+                                                           1, stream);
+
+  void *wait_event = nullptr;
+  CUDADriver::get_instance().event_create(&wait_event, CU_EVENT_DEFAULT);
+  CUDADriver::get_instance().event_record(wait_event, stream);
+  return std::make_shared<CudaSignalledSemaphoreObject>(sema, ext_sema,
+                                                        wait_event);
+}
+
 #else
 void memcpy_cuda_to_vulkan(DevicePtr dst, DevicePtr src, uint64_t size) {
   TI_NOT_IMPLEMENTED;
@@ -225,6 +474,27 @@ void memcpy_cuda_to_vulkan(DevicePtr dst, DevicePtr src, uint64_t size) {
 void memcpy_vulkan_to_cuda(DevicePtr dst, DevicePtr src, uint64_t size) {
   TI_NOT_IMPLEMENTED;
 }
+
+VulkanCudaSharedMemory allocate_vulkan_cuda_shared_memory(Device *vk_dev,
+                                                          uint64_t size) {
+  TI_NOT_IMPLEMENTED;
+}
+
+void free_vulkan_cuda_shared_memory(const VulkanCudaSharedMemory &mem) {
+  TI_NOT_IMPLEMENTED;
+}
+
+DevicePtr find_vulkan_cuda_shared_memory(Device *vk_dev, DevicePtr cuda_ptr) {
+  return kDeviceNullPtr;
+}
+
+StreamSemaphore signal_vulkan_semaphore_from_cuda(Device *vk_dev) {
+  TI_NOT_IMPLEMENTED;
+}
+
+StreamSemaphore wait_cuda_for_vulkan_graphics(Device *vk_dev) {
+  TI_NOT_IMPLEMENTED;
+}
 #endif  // TI_WITH_VULKAN && TI_WITH_CUDA
 
 }  // namespace taichi::lang
@@ -8,4 +8,35 @@ void memcpy_cuda_to_vulkan(DevicePtr dst, DevicePtr src, uint64_t size);
 
 void memcpy_vulkan_to_cuda(DevicePtr dst, DevicePtr src, uint64_t size);
 
+// Memory allocated on a Vulkan device and mapped into the CUDA address space.
+// Both |vk_alloc| and |cuda_ptr| refer to the same physical memory, so it can
+// be written by CUDA kernels and read by Vulkan (or vice versa) without copies.
+struct VulkanCudaSharedMemory {
+  DeviceAllocation vk_alloc{kDeviceNullAllocation};
+  void *cuda_ptr{nullptr};
+  uint64_t size{0};
+};
+
+// Allocates |size| bytes of exportable memory on the Vulkan device |vk_dev|
+// and maps it into the current CUDA context.
+VulkanCudaSharedMemory allocate_vulkan_cuda_shared_memory(Device *vk_dev,
+                                                          uint64_t size);
+
+void free_vulkan_cuda_shared_memory(const VulkanCudaSharedMemory &mem);
+
+// Returns the Vulkan pointer aliasing |cuda_ptr| if it is a CUDA pointer into
+// shared memory allocated on |vk_dev|, or kDeviceNullPtr otherwise.
+DevicePtr find_vulkan_cuda_shared_memory(Device *vk_dev, DevicePtr cuda_ptr);
+
+// Returns a semaphore of |vk_dev| that is signalled once the work enqueued so
+// far on the CUDA stream of the calling thread completes. Vulkan submissions
+// waiting on it observe all memory writes of that work.
+StreamSemaphore signal_vulkan_semaphore_from_cuda(Device *vk_dev);
+
+// Makes the CUDA stream of the calling thread wait for the work submitted so
+// far to the graphics queue of |vk_dev|. The returned handle has to be kept
+// alive until the CUDA stream has passed the wait; releasing it blocks until
+// then.
+StreamSemaphore wait_cuda_for_vulkan_graphics(Device *vk_dev);
+
 }  // namespace taichi::lang
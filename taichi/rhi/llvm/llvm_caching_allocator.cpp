@@ -0,0 +1,300 @@
+#include "taichi/rhi/llvm/llvm_caching_allocator.h"
+
+#include "taichi/inc/constants.h"
+#include "taichi/math/arithmetic.h"
+
+namespace taichi::lang {
+
+void *const LlvmCachingAllocator::kIdleStream =
+    reinterpret_cast<void *>(~uintptr_t(0));
+
+LlvmCachingAllocator::LlvmCachingAllocator(LlvmDevice *device)
+    : device_(device) {
+}
+
+LlvmCachingAllocator::~LlvmCachingAllocator() {
+  // Memory from the runtime pool is released together with the runtime, and
+  // driver-backed segments are owned by the device at this point. Only the
+  // bookkeeping is destroyed here.
+  std::vector<Block *> blocks;
+  for (auto *pool : {&small_blocks_, &large_blocks_}) {
+    blocks.insert(blocks.end(), pool->begin(), pool->end());
+  }
+  for (auto &it : allocated_blocks_) {
+    blocks.push_back(it.second);
+  }
+  for (auto *block : blocks) {
+    delete block;
+  }
+}
+
+std::size_t LlvmCachingAllocator::round_size(std::size_t size) {
+  if (size <= kSmallSize) {
+    // Zero-sized requests still get a distinct address.
+    return std::max(taichi::iroundup(size, taichi_page_size),
+                    std::size_t(taichi_page_size));
+  }
+  return taichi::iroundup(size, kLargeRoundSize);
+}
+
+LlvmCachingAllocator::Block *LlvmCachingAllocator::find_free_block(
+    BlockPool &pool,
+    void *stream,
+    std::size_t size) {
+  Block key;
+  key.stream = stream;
+  key.size = size;
+  auto it = pool.lower_bound(&key);
+  if (it == pool.end() || (*it)->stream != stream) {
+    return nullptr;
+  }
+  Block *block = *it;
+  pool.erase(it);
+  if (block->stream != kIdleStream) {
+    num_stream_blocks_--;
+  }
+  return block;
+}
+
+LlvmCachingAllocator::Block *LlvmCachingAllocator::allocate_segment(
+    const LlvmDevice::LlvmRuntimeAllocParams &params,
+    std::size_t size,
+    bool is_small) {
+  std::size_t segment_size = is_small ? kSmallSegmentSize : size;
+  uint64_t *ptr = nullptr;
+  bool releasable = false;
+  if (high_water_mark_ > 0) {
+    if (stats_.reserved_bytes + segment_size > high_water_mark_) {
+      release_cached_segments(high_water_mark_ - std::min(high_water_mark_,
+                                                          segment_size));
+    }
+    ptr = driver_allocate(segment_size);
+    if (ptr == nullptr) {
+      // Out of device memory, flush the cache and retry once.
+      release_cached_segments(0);
+      ptr = driver_allocate(segment_size);
+    }
+    releasable = ptr != nullptr;
+  }
+  if (ptr == nullptr) {
+    auto segment_params = params;
+    segment_params.size = segment_size;
+    ptr = device_->allocate_llvm_runtime_memory_jit(segment_params);
+  }
+  TI_ERROR_IF(ptr == nullptr, "Failed to allocate {} bytes of device memory",
+              segment_size);
+
+  auto *block = new Block;
+  block->ptr = reinterpret_cast<uint8_t *>(ptr);
+  block->size = segment_size;
+  block->stream = kIdleStream;
+  block->is_small = is_small;
+  block->releasable = releasable;
+  stats_.reserved_bytes += segment_size;
+  stats_.num_segments++;
+  return block;
+}
+
+uint64_t *LlvmCachingAllocator::allocate(
+    const LlvmDevice::LlvmRuntimeAllocParams &params) {
+  std::lock_guard<std::mutex> _(mut_);
+  const std::size_t size = round_size(params.size);
+  const bool is_small = size <= kSmallSize;
+  auto &pool = is_small ? small_blocks_ : large_blocks_;
+  void *stream = current_stream();
+
+  Block *block = find_free_block(pool, stream, size);
+  if (block == nullptr) {
+    block = find_free_block(pool, kIdleStream, size);
+  }
+  if (block == nullptr && num_stream_blocks_ > 0) {
+    // Blocks released on other streams may still be in use by the device.
+    // Wait for them before giving up on the cache.
+    synchronize_streams();
+    make_blocks_idle();
+    block = find_free_block(pool, kIdleStream, size);
+  }
+  if (block != nullptr) {
+    stats_.num_cache_hits++;
+  } else {
+    stats_.num_cache_misses++;
+    block = allocate_segment(params, size, is_small);
+  }
+
+  // Split off the tail if it is large enough to serve another request.
+  const std::size_t remaining = block->size - size;
+  const std::size_t min_split = is_small ? taichi_page_size : kSmallSize;
+  if (remaining >= min_split) {
+    auto *tail = new Block;
+    tail->ptr = block->ptr + size;
+    tail->size = remaining;
+    tail->stream = block->stream;
+    tail->is_small = block->is_small;
+    tail->releasable = block->releasable;
+    tail->prev = block;
+    tail->next = block->next;
+    if (block->next) {
+      block->next->prev = tail;
+    }
+    block->next = tail;
+    block->size = size;
+    pool.insert(tail);
+    if (tail->stream != kIdleStream) {
+      num_stream_blocks_++;
+    }
+  }
+
+  block->allocated = true;
+  block->stream = stream;
+  allocated_blocks_[block->ptr] = block;
+  stats_.allocated_bytes += block->size;
+  stats_.peak_allocated_bytes =
+      std::max(stats_.peak_allocated_bytes, stats_.allocated_bytes);
+  return reinterpret_cast<uint64_t *>(block->ptr);
+}
+
+bool LlvmCachingAllocator::try_merge(Block *dst, Block *src) {
+  if (src == nullptr || src->allocated) {
+    return false;
+  }
+  // Blocks pending on different streams must stay apart, otherwise the merged
+  // block could be reused before one of the streams is done with it.
+  if (src->stream != dst->stream && src->stream != kIdleStream &&
+      dst->stream != kIdleStream) {
+    return false;
+  }
+  pool_of(src).erase(src);
+  if (src->stream != kIdleStream) {
+    num_stream_blocks_--;
+  }
+  if (dst->stream == kIdleStream) {
+    dst->stream = src->stream;
+  }
+  if (src == dst->prev) {
+    dst->ptr = src->ptr;
+    dst->prev = src->prev;
+    if (dst->prev) {
+      dst->prev->next = dst;
+    }
+  } else {
+    dst->next = src->next;
+    if (dst->next) {
+      dst->next->prev = dst;
+    }
+  }
+  dst->size += src->size;
+  delete src;
+  return true;
+}
+
+void LlvmCachingAllocator::free_block(Block *block) {
+  try_merge(block, block->prev);
+  try_merge(block, block->next);
+  pool_of(block).insert(block);
+  if (block->stream != kIdleStream) {
+    num_stream_blocks_++;
+  }
+}
+
+void LlvmCachingAllocator::release(size_t sz, uint64_t *ptr) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto it = allocated_blocks_.find(reinterpret_cast<uint8_t *>(ptr));
+  TI_ASSERT_INFO(it != allocated_blocks_.end(),
+                 "Releasing memory that was not allocated by the allocator");
+  Block *block = it->second;
+  TI_ASSERT(sz <= block->size);
+  allocated_blocks_.erase(it);
+  stats_.allocated_bytes -= block->size;
+
+  block->allocated = false;
+  block->stream = current_stream();
+  free_block(block);
+
+  if (high_water_mark_ > 0 && stats_.reserved_bytes > high_water_mark_) {
+    release_cached_segments(high_water_mark_);
+  }
+}
+
+void LlvmCachingAllocator::make_blocks_idle() {
+  for (auto *pool : {&small_blocks_, &large_blocks_}) {
+    std::unordered_set<Block *> pending(pool->begin(), pool->end());
+    std::vector<Block *> blocks(pool->begin(), pool->end());
+    pool->clear();
+    for (auto *block : blocks) {
+      block->stream = kIdleStream;
+    }
+    // Neighbours that were kept apart by their streams can be merged now.
+    for (auto *block : blocks) {
+      if (pending.find(block) == pending.end()) {
+        continue;
+      }
+      Block *head = block;
+      while (head->prev && pending.count(head->prev)) {
+        head = head->prev;
+      }
+      pending.erase(head);
+      while (head->next && pending.count(head->next)) {
+        Block *next = head->next;
+        pending.erase(next);
+        head->size += next->size;
+        head->next = next->next;
+        if (head->next) {
+          head->next->prev = head;
+        }
+        delete next;
+      }
+      pool->insert(head);
+    }
+  }
+  num_stream_blocks_ = 0;
+}
+
+void LlvmCachingAllocator::release_cached_segments(
+    std::size_t target_reserved_bytes) {
+  for (auto *pool : {&large_blocks_, &small_blocks_}) {
+    std::vector<Block *> segments;
+    for (auto *block : *pool) {
+      if (block->releasable && block->prev == nullptr &&
+          block->next == nullptr) {
+        segments.push_back(block);
+      }
+    }
+    // Release the largest segments first.
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+      if (stats_.reserved_bytes <= target_reserved_bytes) {
+        return;
+      }
+      Block *block = *it;
+      if (block->stream != kIdleStream) {
+        synchronize_streams();
+        make_blocks_idle();
+        // The pools have been rebuilt, start over.
+        release_cached_segments(target_reserved_bytes);
+        return;
+      }
+      pool->erase(block);
+      driver_free(reinterpret_cast<uint64_t *>(block->ptr));
+      stats_.reserved_bytes -= block->size;
+      stats_.num_segments--;
+      stats_.num_segments_released++;
+      delete block;
+    }
+  }
+}
+
+void LlvmCachingAllocator::set_high_water_mark(std::size_t bytes) {
+  std::lock_guard<std::mutex> _(mut_);
+  high_water_mark_ = bytes;
+}
+
+void LlvmCachingAllocator::empty_cache() {
+  std::lock_guard<std::mutex> _(mut_);
+  release_cached_segments(0);
+}
+
+CachingAllocatorStats LlvmCachingAllocator::get_stats() {
+  std::lock_guard<std::mutex> _(mut_);
+  return stats_;
+}
+
+}  // namespace taichi::lang
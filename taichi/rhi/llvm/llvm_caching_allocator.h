@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "taichi/rhi/llvm/llvm_device.h"
+
+namespace taichi::lang {
+
+// A caching allocator shared by the GPU backends of LLVM.
+//
+// Memory is obtained from upstream in segments, which are split into blocks
+// on allocation. Released blocks are merged with neighbouring free blocks of
+// the same segment, so that resizing cycles do not fragment the cache. Free
+// blocks are binned by size class (small/large) and by the stream they were
+// released on: a block may only be reused on that stream until the allocator
+// has synchronized, after which it becomes idle and can be reused anywhere.
+//
+// Segments come from the preallocated runtime memory pool by default. When a
+// high-water mark is set, segments are instead allocated from the driver, and
+// fully free segments are returned to the driver whenever the reserved memory
+// exceeds the mark.
+class LlvmCachingAllocator {
+ public:
+  explicit LlvmCachingAllocator(LlvmDevice *device);
+  virtual ~LlvmCachingAllocator();
+
+  uint64_t *allocate(const LlvmDevice::LlvmRuntimeAllocParams &params);
+  void release(size_t sz, uint64_t *ptr);
+
+  // 0 (default) disables releasing memory to the driver.
+  void set_high_water_mark(std::size_t bytes);
+
+  // Returns every fully free driver-backed segment to the driver.
+  void empty_cache();
+
+  CachingAllocatorStats get_stats();
+
+  static constexpr std::size_t kSmallSize = 1 << 20;
+  static constexpr std::size_t kSmallSegmentSize = 2 << 20;
+  static constexpr std::size_t kLargeRoundSize = 2 << 20;
+
+ protected:
+  // Returns nullptr if the driver is out of memory.
+  virtual uint64_t *driver_allocate(std::size_t size) = 0;
+  virtual void driver_free(uint64_t *ptr) = 0;
+  virtual void *current_stream() {
+    return nullptr;
+  }
+  // Waits for all streams so that cached blocks become idle.
+  virtual void synchronize_streams() {
+  }
+
+  LlvmDevice *device_{nullptr};
+
+ private:
+  struct Block {
+    uint8_t *ptr{nullptr};
+    std::size_t size{0};
+    // The stream this block was last used on, or kIdleStream.
+    void *stream{nullptr};
+    bool allocated{false};
+    bool is_small{false};
+    bool releasable{false};
+    Block *prev{nullptr};
+    Block *next{nullptr};
+  };
+
+  struct BlockComparator {
+    bool operator()(const Block *a, const Block *b) const {
+      if (a->stream != b->stream) {
+        return a->stream < b->stream;
+      }
+      if (a->size != b->size) {
+        return a->size < b->size;
+      }
+      return a->ptr < b->ptr;
+    }
+  };
+
+  using BlockPool = std::set<Block *, BlockComparator>;
+
+  static void *const kIdleStream;
+
+  static std::size_t round_size(std::size_t size);
+
+  Block *find_free_block(BlockPool &pool, void *stream, std::size_t size);
+  Block *allocate_segment(const LlvmDevice::LlvmRuntimeAllocParams &params,
+                          std::size_t size,
+                          bool is_small);
+  void free_block(Block *block);
+  bool try_merge(Block *dst, Block *src);
+  void make_blocks_idle();
+  void release_cached_segments(std::size_t target_reserved_bytes);
+  BlockPool &pool_of(const Block *block) {
+    return block->is_small ? small_blocks_ : large_blocks_;
+  }
+
+  std::mutex mut_;
+  BlockPool small_blocks_;
+  BlockPool large_blocks_;
+  std::unordered_map<uint8_t *, Block *> allocated_blocks_;
+  std::size_t num_stream_blocks_{0};
+  std::size_t high_water_mark_{0};
+  CachingAllocatorStats stats_;
+};
+
+}  // namespace taichi::lang
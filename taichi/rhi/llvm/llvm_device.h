@@ -7,6 +7,18 @@ namespace taichi::lang {
 class JITModule;
 struct LLVMRuntime;
 
+struct CachingAllocatorStats {
+  // Bytes handed out to callers (after size-class rounding).
+  std::size_t allocated_bytes{0};
+  std::size_t peak_allocated_bytes{0};
+  // Bytes held in segments, whether in use or cached.
+  std::size_t reserved_bytes{0};
+  std::size_t num_segments{0};
+  std::size_t num_cache_hits{0};
+  std::size_t num_cache_misses{0};
+  std::size_t num_segments_released{0};
+};
+
 class LlvmDevice : public Device {
  public:
   struct LlvmRuntimeAllocParams : AllocParams {
@@ -14,6 +26,8 @@ class LlvmDevice : public Device {
     JITModule *runtime_jit{nullptr};
     LLVMRuntime *runtime{nullptr};
     uint64 *result_buffer{nullptr};
+    // Allocate from unified memory instead of the preallocated device memory.
+    bool use_managed{false};
   };
 
   Arch arch() const override {
@@ -27,6 +41,18 @@ class LlvmDevice : public Device {
 
   uint64_t *allocate_llvm_runtime_memory_jit(
       const LlvmRuntimeAllocParams &params);
+
+  virtual CachingAllocatorStats get_caching_allocator_stats() {
+    return {};
+  }
+
+  // See LlvmCachingAllocator::set_high_water_mark().
+  void set_caching_allocator_high_water_mark(std::size_t bytes) {
+    caching_allocator_high_water_mark_ = bytes;
+  }
+
+ protected:
+  std::size_t caching_allocator_high_water_mark_{0};
 };
 
 }  // namespace taichi::lang
@@ -1,5 +1,8 @@
 #pragma once
+#include <array>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "taichi/rhi/device.h"
 #include "taichi/rhi/metal/metal_api.h"
 #include "taichi/rhi/impl_support.h"
@@ -16,6 +19,7 @@
 
 DEFINE_METAL_ID_TYPE(MTLDevice);
 DEFINE_METAL_ID_TYPE(MTLBuffer);
+DEFINE_METAL_ID_TYPE(MTLHeap);
 DEFINE_METAL_ID_TYPE(MTLLibrary);
 DEFINE_METAL_ID_TYPE(MTLFunction);
 DEFINE_METAL_ID_TYPE(MTLComputePipelineState);
@@ -144,18 +148,36 @@ class MetalCommandList final : public CommandList {
   void buffer_copy(DevicePtr dst, DevicePtr src, size_t size) noexcept final;
   void buffer_fill(DevicePtr ptr, size_t size, uint32_t data) noexcept final;
   RhiResult dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1) noexcept final;
+  RhiResult dispatch_indirect(DevicePtr args) noexcept final;
 
   MTLCommandBuffer_id finalize();
 
  private:
   friend class MetalStream;
 
+  // The bindings of a Metal compute function, buffer(0) to buffer(30).
+  static constexpr size_t kMaxBufferBindings = 31;
+
+  // Returns the compute encoder of the consecutive dispatches, with the bound
+  // pipeline and resources set. Only the bindings that changed since the
+  // previous dispatch are set again.
+  MTLComputeCommandEncoder_id begin_compute_encoder();
+  // Ends the compute encoder before blit commands. Metal orders the encoders
+  // of a command buffer by the resources they use.
+  void end_compute_encoder();
+
   const MetalDevice *device_;
   MTLCommandBuffer_id cmdbuf_;
 
   // Non-null after `bind*` methods.
   const MetalPipeline *current_pipeline_;
   const MetalShaderResourceSet *current_shader_resource_set_;
+
+  // A concurrent compute encoder: its dispatches may overlap unless separated
+  // by the memory barriers recorded by `buffer_barrier`/`memory_barrier`.
+  MTLComputeCommandEncoder_id compute_encoder_{nullptr};
+  const MetalPipeline *encoder_pipeline_{nullptr};
+  std::array<MetalShaderBufferResource, kMaxBufferBindings> encoder_buffers_{};
 };
 
 class MetalStream final : public Stream {
@@ -227,9 +249,20 @@ class MetalDevice final : public Device {
 
   void memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) override;
 
+  // Device-local buffers up to this size are placed in shared heaps, rather
+  // than allocated one by one.
+  static constexpr size_t kMaxHeapBufferSize = 4 << 20;
+  static constexpr size_t kHeapSize = 64 << 20;
+
  private:
+  // Places a private buffer of |size| bytes in one of |heaps_|, creating a
+  // heap if none has room. Returns nil if |size| is too large for heaps.
+  MTLBuffer_id new_heap_buffer(size_t size);
+
   MTLDevice_id mtl_device_;
   rhi_impl::SyncedPtrStableObjectList<MetalMemory> memory_allocs_;
+  std::mutex heaps_mut_;
+  std::vector<MTLHeap_id> heaps_;
   std::unique_ptr<MetalStream> compute_stream_;
 
   bool is_destroyed_{false};
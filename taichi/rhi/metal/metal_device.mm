@@ -185,7 +185,10 @@ MetalCommandList::MetalCommandList(const MetalDevice &device,
   cmdbuf_ = [cmd_queue commandBuffer];
 }
 
-MetalCommandList::~MetalCommandList() { [cmdbuf_ release]; }
+MetalCommandList::~MetalCommandList() {
+  end_compute_encoder();
+  [cmdbuf_ release];
+}
 
 void MetalCommandList::bind_pipeline(Pipeline *p) noexcept {
   RHI_ASSERT(p != nullptr);
@@ -204,12 +207,24 @@ MetalCommandList::bind_raster_resources(RasterResources *res) noexcept {
   return RhiResult::not_supported;
 }
 
-void MetalCommandList::buffer_barrier(DeviceAllocation alloc) noexcept {}
-void MetalCommandList::buffer_barrier(DevicePtr ptr, size_t size) noexcept {}
+void MetalCommandList::buffer_barrier(DeviceAllocation alloc) noexcept {
+  buffer_barrier(alloc.get_ptr(0), kBufferSizeEntireSize);
+}
+void MetalCommandList::buffer_barrier(DevicePtr ptr, size_t size) noexcept {
+  // NOTE: Resources are `MTLHazardTrackingModeTracked`, so Metal orders the
+  // encoders that use them. Only the dispatches within the concurrent compute
+  // encoder have to be ordered explicitly.
+  if (compute_encoder_ == nil) {
+    return;
+  }
+  id<MTLResource> resource = device_->get_memory(ptr.alloc_id).mtl_buffer();
+  [compute_encoder_ memoryBarrierWithResources:&resource count:1];
+}
 void MetalCommandList::memory_barrier() noexcept {
-  // NOTE: (penguinliong) Resources created from `MTLDevice` (which is the only
-  // available way to allocate resource here) are `MTLHazardTrackingModeTracked`
-  // by default. So we don't have to barrier explicitly.
+  if (compute_encoder_ == nil) {
+    return;
+  }
+  [compute_encoder_ memoryBarrierWithScope:MTLBarrierScopeBuffers];
 }
 
 void MetalCommandList::buffer_copy(DevicePtr dst, DevicePtr src,
@@ -227,6 +242,8 @@ void MetalCommandList::buffer_copy(DevicePtr dst, DevicePtr src,
   MTLBuffer_id src_mtl_buffer = src_memory.mtl_buffer();
   MTLBuffer_id dst_mtl_buffer = dst_memory.mtl_buffer();
 
+  end_compute_encoder();
+
   @autoreleasepool {
     MTLBlitCommandEncoder_id encoder = [cmdbuf_ blitCommandEncoder];
     [encoder copyFromBuffer:src_mtl_buffer
@@ -250,6 +267,7 @@ void MetalCommandList::buffer_fill(DevicePtr ptr, size_t size,
 
   MTLBuffer_id mtl_buffer = memory.mtl_buffer();
 
+  end_compute_encoder();
   @autoreleasepool {
     MTLBlitCommandEncoder_id encoder = [cmdbuf_ blitCommandEncoder];
     [encoder fillBuffer:mtl_buffer
@@ -259,47 +277,100 @@ void MetalCommandList::buffer_fill(DevicePtr ptr, size_t size,
   }
 }
 
-RhiResult MetalCommandList::dispatch(uint32_t x, uint32_t y,
-                                     uint32_t z) noexcept {
+MTLComputeCommandEncoder_id MetalCommandList::begin_compute_encoder() {
   RHI_ASSERT(current_pipeline_);
   RHI_ASSERT(current_shader_resource_set_);
 
-  MTLComputePipelineState_id mtl_compute_pipeline_state =
-      current_pipeline_->mtl_compute_pipeline_state();
-
-  NSUInteger local_x = current_pipeline_->workgroup_size().x;
-  NSUInteger local_y = current_pipeline_->workgroup_size().y;
-  NSUInteger local_z = current_pipeline_->workgroup_size().z;
-
-  std::vector<MetalShaderResource> shader_resources =
-      current_shader_resource_set_->resources();
-
-  @autoreleasepool {
-    MTLComputeCommandEncoder_id encoder = [cmdbuf_ computeCommandEncoder];
-
-    for (const MetalShaderResource &resource : shader_resources) {
-      switch (resource.ty) {
-      case MetalShaderResourceType::buffer: {
+  if (compute_encoder_ == nil) {
+    // Retained, as it outlives the autorelease pools of the dispatches.
+    compute_encoder_ = [[cmdbuf_
+        computeCommandEncoderWithDispatchType:MTLDispatchTypeConcurrent]
+        retain];
+    encoder_pipeline_ = nullptr;
+    encoder_buffers_.fill(MetalShaderBufferResource{});
+  }
+  MTLComputeCommandEncoder_id encoder = compute_encoder_;
+
+  for (const MetalShaderResource &resource :
+       current_shader_resource_set_->resources()) {
+    switch (resource.ty) {
+    case MetalShaderResourceType::buffer: {
+      RHI_ASSERT(resource.binding < kMaxBufferBindings);
+      MetalShaderBufferResource &bound = encoder_buffers_[resource.binding];
+      if (bound.buffer != resource.buffer.buffer) {
         [encoder setBuffer:resource.buffer.buffer
                     offset:resource.buffer.offset
                    atIndex:resource.binding];
-        break;
-      }
-      default:
-        RHI_ASSERT(false);
+      } else if (bound.offset != resource.buffer.offset) {
+        [encoder setBufferOffset:resource.buffer.offset
+                         atIndex:resource.binding];
       }
+      bound = resource.buffer;
+      break;
     }
+    default:
+      RHI_ASSERT(false);
+    }
+  }
+
+  if (encoder_pipeline_ != current_pipeline_) {
+    [encoder setComputePipelineState:current_pipeline_
+                                         ->mtl_compute_pipeline_state()];
+    encoder_pipeline_ = current_pipeline_;
+  }
+  return encoder;
+}
+
+void MetalCommandList::end_compute_encoder() {
+  if (compute_encoder_ != nil) {
+    [compute_encoder_ endEncoding];
+    [compute_encoder_ release];
+    compute_encoder_ = nil;
+  }
+}
+
+RhiResult MetalCommandList::dispatch(uint32_t x, uint32_t y,
+                                     uint32_t z) noexcept {
+  RHI_ASSERT(current_pipeline_);
+
+  NSUInteger local_x = current_pipeline_->workgroup_size().x;
+  NSUInteger local_y = current_pipeline_->workgroup_size().y;
+  NSUInteger local_z = current_pipeline_->workgroup_size().z;
 
-    [encoder setComputePipelineState:mtl_compute_pipeline_state];
+  @autoreleasepool {
+    MTLComputeCommandEncoder_id encoder = begin_compute_encoder();
     [encoder dispatchThreadgroups:MTLSizeMake(x, y, z)
             threadsPerThreadgroup:MTLSizeMake(local_x, local_y, local_z)];
-    [encoder endEncoding];
   };
 
   return RhiResult::success;
 }
 
-MTLCommandBuffer_id MetalCommandList::finalize() { return cmdbuf_; }
+RhiResult MetalCommandList::dispatch_indirect(DevicePtr args) noexcept {
+  RHI_ASSERT(current_pipeline_);
+
+  NSUInteger local_x = current_pipeline_->workgroup_size().x;
+  NSUInteger local_y = current_pipeline_->workgroup_size().y;
+  NSUInteger local_z = current_pipeline_->workgroup_size().z;
+
+  MTLBuffer_id args_buffer = device_->get_memory(args.alloc_id).mtl_buffer();
+
+  @autoreleasepool {
+    MTLComputeCommandEncoder_id encoder = begin_compute_encoder();
+    [encoder dispatchThreadgroupsWithIndirectBuffer:args_buffer
+                               indirectBufferOffset:(NSUInteger)args.offset
+                              threadsPerThreadgroup:MTLSizeMake(
+                                                        local_x, local_y,
+                                                        local_z)];
+  };
+
+  return RhiResult::success;
+}
+
+MTLCommandBuffer_id MetalCommandList::finalize() {
+  end_compute_encoder();
+  return cmdbuf_;
+}
 
 MetalStream::MetalStream(const MetalDevice &device,
                          MTLCommandQueue_id mtl_command_queue)
@@ -380,6 +451,7 @@ DeviceCapabilityConfig collect_metal_device_caps(MTLDevice_id mtl_device) {
   caps.set(DeviceCapability::spirv_has_int8, 1);
   caps.set(DeviceCapability::spirv_has_int16, 1);
   caps.set(DeviceCapability::spirv_has_float16, 1);
+  caps.set(DeviceCapability::spirv_has_storage_buffer_16bit_access, 1);
   caps.set(DeviceCapability::spirv_has_subgroup_basic, 1);
 
   if (feature_64_bit_integer_math) {
@@ -400,6 +472,9 @@ DeviceCapabilityConfig collect_metal_device_caps(MTLDevice_id mtl_device) {
   if (feature_simd_scoped_reduction_operations) {
     caps.set(DeviceCapability::spirv_has_subgroup_arithmetic, 1);
   }
+  if ([mtl_device hasUnifiedMemory]) {
+    caps.set(DeviceCapability::unified_memory, 1);
+  }
   return caps;
 }
 
@@ -420,6 +495,10 @@ void MetalDevice::destroy() {
   if (!is_destroyed_) {
     compute_stream_.reset();
     memory_allocs_.clear();
+    for (MTLHeap_id heap : heaps_) {
+      [heap release];
+    }
+    heaps_.clear();
     [mtl_device_ release];
     is_destroyed_ = true;
   }
@@ -443,8 +522,14 @@ DeviceAllocation MetalDevice::allocate_memory(const AllocParams &params) {
       (storage_mode << MTLResourceStorageModeShift) |
       (cpu_cache_mode << MTLResourceCPUCacheModeShift);
 
-  MTLBuffer_id buffer = [mtl_device_ newBufferWithLength:params.size
-                                                 options:resource_options];
+  MTLBuffer_id buffer = nil;
+  if (!can_map) {
+    buffer = new_heap_buffer(params.size);
+  }
+  if (buffer == nil) {
+    buffer = [mtl_device_ newBufferWithLength:params.size
+                                      options:resource_options];
+  }
 
   MetalMemory &alloc = memory_allocs_.acquire(buffer);
 
@@ -454,6 +539,40 @@ DeviceAllocation MetalDevice::allocate_memory(const AllocParams &params) {
   return out;
 }
 
+MTLBuffer_id MetalDevice::new_heap_buffer(size_t size) {
+  if (size == 0 || size > kMaxHeapBufferSize) {
+    return nil;
+  }
+  const MTLResourceOptions options = MTLResourceStorageModePrivate |
+                                     MTLResourceHazardTrackingModeTracked;
+  const MTLSizeAndAlign size_align =
+      [mtl_device_ heapBufferSizeAndAlignWithLength:size options:options];
+
+  std::lock_guard<std::mutex> _(heaps_mut_);
+  // The memory of released buffers goes back to their heap.
+  for (MTLHeap_id heap : heaps_) {
+    if ([heap maxAvailableSizeWithAlignment:size_align.align] >=
+        size_align.size) {
+      MTLBuffer_id buffer = [heap newBufferWithLength:size options:options];
+      if (buffer != nil) {
+        return buffer;
+      }
+    }
+  }
+
+  MTLHeapDescriptor *desc = [[MTLHeapDescriptor alloc] init];
+  desc.size = kHeapSize;
+  desc.storageMode = MTLStorageModePrivate;
+  desc.hazardTrackingMode = MTLHazardTrackingModeTracked;
+  MTLHeap_id heap = [mtl_device_ newHeapWithDescriptor:desc];
+  [desc release];
+  if (heap == nil) {
+    return nil;
+  }
+  heaps_.push_back(heap);
+  return [heap newBufferWithLength:size options:options];
+}
+
 void MetalDevice::dealloc_memory(DeviceAllocation handle) {
   RHI_ASSERT(handle.device == this);
   memory_allocs_.release(&get_memory(handle.alloc_id));
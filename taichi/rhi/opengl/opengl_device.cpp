@@ -1,12 +1,28 @@
 #include "opengl_device.h"
 #include "opengl_api.h"
 
+#include <cstdio>
+#include <cstring>
+
 #include "spirv_glsl.hpp"
 
 namespace taichi::lang {
 namespace opengl {
 
 namespace {
+
+// "TIGL"
+constexpr uint32_t kGLPipelineCacheMagic = 0x4c474954;
+
+uint64_t fnv1a_hash(const void *data, size_t size, uint64_t seed = 0) {
+  uint64_t hash = 14695981039346656037ull ^ seed;
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
 const std::unordered_map<BufferFormat, GLuint> format_to_gl_internal_format = {
     {BufferFormat::r8, GL_R8},
     {BufferFormat::rg8, GL_RG8},
@@ -221,8 +237,119 @@ GLResourceSet &GLResourceSet::rw_image(uint32_t binding,
   TI_NOT_IMPLEMENTED;
 }
 
+GLPipelineCache::GLPipelineCache(size_t initial_size,
+                                 const void *initial_data) {
+  load(initial_size, initial_data);
+}
+
+void GLPipelineCache::load(size_t size, const void *data) {
+  // [magic][count] then [source hash][format][size][binary] per program.
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const uint8_t *end = p + size;
+  auto read = [&](void *dst, size_t n) {
+    if (end - p < (ptrdiff_t)n) {
+      return false;
+    }
+    std::memcpy(dst, p, n);
+    p += n;
+    return true;
+  };
+  uint32_t magic = 0, count = 0;
+  if (data == nullptr || !read(&magic, sizeof(magic)) ||
+      magic != kGLPipelineCacheMagic || !read(&count, sizeof(count))) {
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t source_hash = 0;
+    uint32_t format = 0, binary_size = 0;
+    if (!read(&source_hash, sizeof(source_hash)) ||
+        !read(&format, sizeof(format)) ||
+        !read(&binary_size, sizeof(binary_size)) ||
+        end - p < (ptrdiff_t)binary_size) {
+      return;
+    }
+    Binary binary;
+    binary.format = format;
+    binary.data.assign(p, p + binary_size);
+    p += binary_size;
+    binaries_.emplace(source_hash, std::move(binary));
+  }
+}
+
+void *GLPipelineCache::data() noexcept {
+  std::lock_guard<std::mutex> _(mut_);
+  data_shadow_.clear();
+  auto write = [this](const void *src, size_t n) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    data_shadow_.insert(data_shadow_.end(), bytes, bytes + n);
+  };
+  const uint32_t magic = kGLPipelineCacheMagic;
+  const uint32_t count = uint32_t(binaries_.size());
+  write(&magic, sizeof(magic));
+  write(&count, sizeof(count));
+  for (const auto &[source_hash, binary] : binaries_) {
+    const uint32_t format = binary.format;
+    const uint32_t binary_size = uint32_t(binary.data.size());
+    write(&source_hash, sizeof(source_hash));
+    write(&format, sizeof(format));
+    write(&binary_size, sizeof(binary_size));
+    write(binary.data.data(), binary.data.size());
+  }
+  return data_shadow_.data();
+}
+
+size_t GLPipelineCache::size() const noexcept {
+  return data_shadow_.size();
+}
+
+RhiResult GLPipelineCache::merge(size_t size, const void *data) noexcept {
+  std::lock_guard<std::mutex> _(mut_);
+  // The programs linked by this process win over the ones on disk.
+  load(size, data);
+  return RhiResult::success;
+}
+
+bool GLPipelineCache::find(uint64_t source_hash, Binary *binary) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto it = binaries_.find(source_hash);
+  if (it == binaries_.end()) {
+    return false;
+  }
+  *binary = it->second;
+  return true;
+}
+
+void GLPipelineCache::insert(uint64_t source_hash, Binary binary) {
+  std::lock_guard<std::mutex> _(mut_);
+  binaries_[source_hash] = std::move(binary);
+}
+
 GLPipeline::GLPipeline(const PipelineSourceDesc &desc,
-                       const std::string &name) {
+                       const std::string &name,
+                       GLPipelineCache *cache) {
+  uint64_t source_hash = 0;
+  if (cache != nullptr) {
+    source_hash = fnv1a_hash(desc.data, desc.size, uint64_t(desc.type));
+    GLPipelineCache::Binary binary;
+    if (cache->find(source_hash, &binary)) {
+      program_id_ = glCreateProgram();
+      check_opengl_error("glCreateProgram");
+      glProgramBinary(program_id_, binary.format, binary.data.data(),
+                      GLsizei(binary.data.size()));
+      // Drivers reject the binaries of other versions with an error.
+      glGetError();
+      GLint status = GL_FALSE;
+      glGetProgramiv(program_id_, GL_LINK_STATUS, &status);
+      check_opengl_error("glGetProgramiv");
+      if (status == GL_TRUE) {
+        return;
+      }
+      TI_TRACE("Cached program binary of {} rejected, recompiling", name);
+      glDeleteProgram(program_id_);
+      check_opengl_error("glDeleteProgram");
+    }
+  }
+
   GLuint shader_id;
   shader_id = glCreateShader(GL_COMPUTE_SHADER);
   check_opengl_error("glCreateShader");
@@ -278,6 +405,11 @@ GLPipeline::GLPipeline(const PipelineSourceDesc &desc,
   check_opengl_error("glCreateProgram");
   glAttachShader(program_id_, shader_id);
   check_opengl_error("glAttachShader");
+  if (cache != nullptr) {
+    glProgramParameteri(program_id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+    check_opengl_error("glProgramParameteri");
+  }
   glLinkProgram(program_id_);
   check_opengl_error("glLinkProgram");
   glGetProgramiv(program_id_, GL_LINK_STATUS, &status);
@@ -295,6 +427,21 @@ GLPipeline::GLPipeline(const PipelineSourceDesc &desc,
 
   glDeleteShader(shader_id);
   check_opengl_error("glDeleteShader");
+
+  if (cache != nullptr) {
+    GLint binary_size = 0;
+    glGetProgramiv(program_id_, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    check_opengl_error("glGetProgramiv");
+    if (binary_size > 0) {
+      GLPipelineCache::Binary binary;
+      binary.data.resize(binary_size);
+      glGetProgramBinary(program_id_, binary_size, &binary_size,
+                         &binary.format, binary.data.data());
+      check_opengl_error("glGetProgramBinary");
+      binary.data.resize(binary_size);
+      cache->insert(source_hash, std::move(binary));
+    }
+  }
 }
 
 GLPipeline::~GLPipeline() {
@@ -391,6 +538,14 @@ RhiResult GLCommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) noexcept {
   return RhiResult::success;
 }
 
+RhiResult GLCommandList::dispatch_indirect(DevicePtr args) noexcept {
+  auto cmd = std::make_unique<CmdDispatchIndirect>();
+  cmd->buffer = args.alloc_id;
+  cmd->offset = args.offset;
+  recorded_commands_.push_back(std::move(cmd));
+  return RhiResult::success;
+}
+
 void GLCommandList::begin_renderpass(int x0,
                                      int y0,
                                      int x1,
@@ -461,6 +616,27 @@ void GLCommandList::run_commands() {
   }
 }
 
+GLStreamSemaphoreObject::~GLStreamSemaphoreObject() {
+  glDeleteSync(sync_);
+}
+
+void GLStreamSemaphoreObject::wait() {
+  // Flushes on the first try only, so that the fence is sure to be reached.
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  while (true) {
+    const GLenum res =
+        glClientWaitSync(sync_, flags, /*timeout=*/1'000'000'000ull);
+    if (res == GL_ALREADY_SIGNALED || res == GL_CONDITION_SATISFIED) {
+      return;
+    }
+    if (res == GL_WAIT_FAILED) {
+      check_opengl_error("glClientWaitSync");
+      TI_ERROR("glClientWaitSync failed");
+    }
+    flags = 0;
+  }
+}
+
 GLStream::~GLStream() {
 }
 
@@ -473,25 +649,39 @@ StreamSemaphore GLStream::submit(
     CommandList *_cmdlist,
     const std::vector<StreamSemaphore> &wait_semaphores) {
   GLCommandList *cmdlist = static_cast<GLCommandList *>(_cmdlist);
+  // The commands of a context execute in order, so the work behind
+  // |wait_semaphores| is already ahead of these ones.
   cmdlist->run_commands();
 
-  // OpenGL is fully serial
-  return nullptr;
+  GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  check_opengl_error("glFenceSync");
+  last_fence_ = std::make_shared<GLStreamSemaphoreObject>(sync);
+  pending_ = true;
+  return last_fence_;
 }
 
 StreamSemaphore GLStream::submit_synced(
     CommandList *cmdlist,
     const std::vector<StreamSemaphore> &wait_semaphores) {
-  submit(cmdlist);
-  glFinish();
-  check_opengl_error("glFinish");
-
-  // OpenGL is fully serial
-  return nullptr;
+  auto sema = submit(cmdlist, wait_semaphores);
+  command_sync();
+  return sema;
 }
+
 void GLStream::command_sync() {
-  glFinish();
-  check_opengl_error("glFinish");
+  if (!pending_) {
+    return;
+  }
+  if (last_fence_ == nullptr) {
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    check_opengl_error("glFenceSync");
+    last_fence_ = std::make_shared<GLStreamSemaphoreObject>(sync);
+  }
+  // Only waits for the commands of this context, unlike glFinish, which also
+  // drains the presentation work on some drivers.
+  last_fence_->wait();
+  last_fence_ = nullptr;
+  pending_ = false;
 }
 
 GLDevice::GLDevice() : stream_(this) {
@@ -526,14 +716,34 @@ DeviceAllocation GLDevice::allocate_memory(const AllocParams &params) {
   glBindBuffer(target_hint, buffer);
   check_opengl_error("glBindBuffer");
 
-  glBufferData(target_hint, params.size, nullptr,
-               params.host_read ? GL_STATIC_COPY : GL_DYNAMIC_READ);
+  // Host visible buffers stay mapped with glBufferStorage (GL 4.4), so that
+  // mapping them doesn't stall the pipeline.
+  const bool persistent = (params.host_read || params.host_write) &&
+                          !is_gles() && GLAD_GL_VERSION_4_4;
+  GLbitfield map_flags = 0;
+  if (persistent) {
+    map_flags = GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
+                (params.host_read ? GL_MAP_READ_BIT : 0) |
+                (params.host_write ? GL_MAP_WRITE_BIT : 0);
+    glBufferStorage(target_hint, params.size, nullptr,
+                    map_flags | GL_DYNAMIC_STORAGE_BIT);
+  } else {
+    glBufferData(target_hint, params.size, nullptr,
+                 params.host_read ? GL_STATIC_COPY : GL_DYNAMIC_READ);
+  }
   GLuint alloc_res = glGetError();
 
   if (alloc_res == GL_OUT_OF_MEMORY) {
+    glDeleteBuffers(1, &buffer);
     throw std::bad_alloc();
   }
-  check_opengl_error("glBufferData");
+  check_opengl_error(persistent ? "glBufferStorage" : "glBufferData");
+
+  if (persistent && params.size > 0) {
+    void *mapped = glMapBufferRange(target_hint, 0, params.size, map_flags);
+    check_opengl_error("glMapBufferRange");
+    persistent_mappings_[buffer] = mapped;
+  }
 
   DeviceAllocation alloc;
   alloc.device = this;
@@ -552,6 +762,9 @@ DeviceAllocation GLDevice::allocate_memory(const AllocParams &params) {
 
 void GLDevice::dealloc_memory(DeviceAllocation handle) {
   GLuint buffer = GLuint(handle.alloc_id);
+  // Deleting the buffer also unmaps it.
+  persistent_mappings_.erase(buffer);
+  buffer_to_access_.erase(buffer);
   glDeleteBuffers(1, &buffer);
   check_opengl_error("glDeleteBuffers");
 }
@@ -567,12 +780,46 @@ GLint GLDevice::get_devalloc_size(DeviceAllocation handle) {
   return size;
 }
 
+RhiResult GLDevice::create_pipeline_cache(PipelineCache **out_cache,
+                                          size_t initial_size,
+                                          const void *initial_data) noexcept {
+  // Some drivers can't save program binaries at all.
+  GLint num_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+  if (glGetError() != GL_NO_ERROR || num_formats == 0) {
+    *out_cache = nullptr;
+    return RhiResult::not_supported;
+  }
+  try {
+    *out_cache = new GLPipelineCache(initial_size, initial_data);
+  } catch (std::bad_alloc &) {
+    *out_cache = nullptr;
+    return RhiResult::out_of_memory;
+  }
+  return RhiResult::success;
+}
+
+std::string GLDevice::get_pipeline_cache_key() const noexcept {
+  // Program binaries are only accepted by the driver build that made them.
+  std::string driver;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const GLubyte *str = glGetString(name);
+    driver += str ? reinterpret_cast<const char *>(str) : "";
+    driver += '\n';
+  }
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%s_%016llx", is_gles() ? "gles" : "gl",
+                (unsigned long long)fnv1a_hash(driver.data(), driver.size()));
+  return buf;
+}
+
 RhiResult GLDevice::create_pipeline(Pipeline **out_pipeline,
                                     const PipelineSourceDesc &src,
                                     std::string name,
                                     PipelineCache *cache) noexcept {
   try {
-    *out_pipeline = new GLPipeline(src, name);
+    *out_pipeline =
+        new GLPipeline(src, name, static_cast<GLPipelineCache *>(cache));
   } catch (std::bad_alloc &) {
     *out_pipeline = nullptr;
     return RhiResult::out_of_memory;
@@ -584,6 +831,13 @@ RhiResult GLDevice::map_range(DevicePtr ptr, uint64_t size, void **mapped_ptr) {
   TI_ASSERT_INFO(
       buffer_to_access_.find(ptr.alloc_id) != buffer_to_access_.end(),
       "Buffer not created with host_read or write");
+  if (auto it = persistent_mappings_.find(ptr.alloc_id);
+      it != persistent_mappings_.end()) {
+    // glMapBufferRange would have waited for the commands using the buffer.
+    stream_.command_sync();
+    *mapped_ptr = static_cast<char *>(it->second) + ptr.offset;
+    return RhiResult::success;
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, ptr.alloc_id);
   check_opengl_error("glBindBuffer");
   *mapped_ptr = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, ptr.offset, size,
@@ -593,6 +847,9 @@ RhiResult GLDevice::map_range(DevicePtr ptr, uint64_t size, void **mapped_ptr) {
 }
 
 RhiResult GLDevice::map(DeviceAllocation alloc, void **mapped_ptr) {
+  if (persistent_mappings_.count(alloc.alloc_id)) {
+    return map_range(alloc.get_ptr(0), /*size=*/0, mapped_ptr);
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, alloc.alloc_id);
   check_opengl_error("glBindBuffer");
 
@@ -604,6 +861,9 @@ RhiResult GLDevice::map(DeviceAllocation alloc, void **mapped_ptr) {
 }
 
 void GLDevice::unmap(DevicePtr ptr) {
+  if (persistent_mappings_.count(ptr.alloc_id)) {
+    return;
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, ptr.alloc_id);
   check_opengl_error("glBindBuffer");
   glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
@@ -611,6 +871,9 @@ void GLDevice::unmap(DevicePtr ptr) {
 }
 
 void GLDevice::unmap(DeviceAllocation alloc) {
+  if (persistent_mappings_.count(alloc.alloc_id)) {
+    return;
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, alloc.alloc_id);
   check_opengl_error("glBindBuffer");
   glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
@@ -626,8 +889,7 @@ void GLDevice::memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) {
   glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src.offset,
                       dst.offset, size);
   check_opengl_error("glCopyBufferSubData");
-  glFinish();
-  check_opengl_error("glFinish");
+  stream_.mark_pending();
 }
 
 Stream *GLDevice::get_compute_stream() {
@@ -806,7 +1068,9 @@ void GLCommandList::CmdBindTextureToIndex::execute() {
 }
 
 void GLCommandList::CmdBufferBarrier::execute() {
-  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+  // The command bit makes buffers written by shaders visible as indirect
+  // dispatch arguments.
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
   check_opengl_error("glMemoryBarrier");
 }
 
@@ -848,6 +1112,14 @@ void GLCommandList::CmdDispatch::execute() {
   check_opengl_error("glDispatchCompute");
 }
 
+void GLCommandList::CmdDispatchIndirect::execute() {
+  glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer);
+  check_opengl_error("glBindBuffer");
+  glDispatchComputeIndirect(GLintptr(offset));
+  check_opengl_error("glDispatchComputeIndirect");
+  glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
 void GLCommandList::CmdImageTransition::execute() {
   glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT |
                   GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "taichi/rhi/device.h"
 
 #include "glad/gl.h"
@@ -57,9 +61,38 @@ class GLResourceSet : public ShaderResourceSet {
   std::unordered_map<uint32_t, GLuint> texture_binding_map_;
 };
 
+// Program binaries (glGetProgramBinary) by the hash of the source they were
+// compiled from. Binaries are only valid for the driver that made them, which
+// GLDevice::get_pipeline_cache_key() tells apart.
+class GLPipelineCache : public PipelineCache {
+ public:
+  struct Binary {
+    GLenum format{0};
+    std::vector<uint8_t> data;
+  };
+
+  GLPipelineCache(size_t initial_size, const void *initial_data);
+
+  void *data() noexcept final;
+  size_t size() const noexcept final;
+  RhiResult merge(size_t size, const void *data) noexcept final;
+
+  bool find(uint64_t source_hash, Binary *binary);
+  void insert(uint64_t source_hash, Binary binary);
+
+ private:
+  void load(size_t size, const void *data);
+
+  std::mutex mut_;
+  std::unordered_map<uint64_t, Binary> binaries_;
+  std::vector<uint8_t> data_shadow_;
+};
+
 class GLPipeline : public Pipeline {
  public:
-  GLPipeline(const PipelineSourceDesc &desc, const std::string &name);
+  GLPipeline(const PipelineSourceDesc &desc,
+             const std::string &name,
+             GLPipelineCache *cache = nullptr);
   ~GLPipeline() override;
 
   GLuint get_program() {
@@ -86,6 +119,7 @@ class GLCommandList : public CommandList {
   void buffer_copy(DevicePtr dst, DevicePtr src, size_t size) noexcept final;
   void buffer_fill(DevicePtr ptr, size_t size, uint32_t data) noexcept final;
   RhiResult dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1) noexcept final;
+  RhiResult dispatch_indirect(DevicePtr args) noexcept final;
 
   // These are not implemented in compute only device
   void begin_renderpass(int x0,
@@ -172,6 +206,12 @@ class GLCommandList : public CommandList {
     void execute() override;
   };
 
+  struct CmdDispatchIndirect : public Cmd {
+    GLuint buffer{0};
+    size_t offset{0};
+    void execute() override;
+  };
+
   struct CmdImageTransition : public Cmd {
     void execute() override;
   };
@@ -198,12 +238,34 @@ class GLCommandList : public CommandList {
   GLDevice *device_{nullptr};
 };
 
+// A fence inserted after the commands of a submission. The commands of a GL
+// context execute in order, so waiting on it also waits on everything issued
+// before.
+class GLStreamSemaphoreObject : public StreamSemaphoreObject {
+ public:
+  explicit GLStreamSemaphoreObject(GLsync sync) : sync_(sync) {
+  }
+  ~GLStreamSemaphoreObject() override;
+
+  void wait();
+
+ private:
+  GLsync sync_{nullptr};
+};
+
 class GLStream : public Stream {
  public:
   explicit GLStream(GLDevice *device) : device_(device) {
   }
   ~GLStream() override;
 
+  // Records that GL commands have been issued outside of submit(), so that
+  // command_sync() waits for them.
+  void mark_pending() {
+    pending_ = true;
+    last_fence_ = nullptr;
+  }
+
   RhiResult new_command_list(CommandList **out_cmdlist) noexcept final;
   StreamSemaphore submit(
       CommandList *cmdlist,
@@ -216,6 +278,11 @@ class GLStream : public Stream {
 
  private:
   GLDevice *device_{nullptr};
+  // The fence after the latest submitted commands, nullptr if commands have
+  // been issued since.
+  std::shared_ptr<GLStreamSemaphoreObject> last_fence_{nullptr};
+  // Whether commands have been issued since the last command_sync().
+  bool pending_{false};
 };
 
 struct GLImageAllocation {
@@ -242,6 +309,13 @@ class GLDevice : public GraphicsDevice {
 
   GLint get_devalloc_size(DeviceAllocation handle);
 
+  RhiResult create_pipeline_cache(
+      PipelineCache **out_cache,
+      size_t initial_size = 0,
+      const void *initial_data = nullptr) noexcept final;
+
+  std::string get_pipeline_cache_key() const noexcept final;
+
   RhiResult create_pipeline(Pipeline **out_pipeline,
                             const PipelineSourceDesc &src,
                             std::string name,
@@ -262,7 +336,8 @@ class GLDevice : public GraphicsDevice {
   void unmap(DevicePtr ptr) final;
   void unmap(DeviceAllocation alloc) final;
 
-  // Strictly intra device copy (synced)
+  // Strictly intra device copy, ordered with the other commands without
+  // waiting for them
   void memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) override;
 
   // Each thraed will acquire its own stream
@@ -304,6 +379,9 @@ class GLDevice : public GraphicsDevice {
  private:
   GLStream stream_;
   std::unordered_map<GLuint, GLbitfield> buffer_to_access_;
+  // Host visible buffers mapped once at allocation, with persistent coherent
+  // mappings where glBufferStorage is available.
+  std::unordered_map<GLuint, void *> persistent_mappings_;
   std::unordered_map<GLuint, GLImageAllocation> image_allocs_;
 };
 
@@ -630,11 +630,11 @@ IVkAccelerationStructureKHR create_acceleration_structure(
   return obj;
 }
 
-IVkQueryPool create_query_pool(VkDevice device) {
+IVkQueryPool create_query_pool(VkDevice device, uint32_t query_count) {
   VkQueryPoolCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
   info.pNext = nullptr;
-  info.queryCount = 2;
+  info.queryCount = query_count;
   info.queryType = VK_QUERY_TYPE_TIMESTAMP;
 
   VkQueryPool query_pool;
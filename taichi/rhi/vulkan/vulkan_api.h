@@ -304,6 +304,6 @@ struct DeviceObjVkQueryPool : public DeviceObj {
   ~DeviceObjVkQueryPool() override;
 };
 using IVkQueryPool = std::shared_ptr<DeviceObjVkQueryPool>;
-IVkQueryPool create_query_pool(VkDevice device);
+IVkQueryPool create_query_pool(VkDevice device, uint32_t query_count = 2);
 
 }  // namespace vkapi
@@ -4,7 +4,9 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <set>
 
 #include "taichi/rhi/vulkan/vulkan_common.h"
@@ -169,6 +171,18 @@ size_t VulkanPipelineCache::size() const noexcept {
   return size;
 }
 
+RhiResult VulkanPipelineCache::merge(size_t size, const void *data) noexcept {
+  // Drivers start out empty caches from incompatible data.
+  auto src = vkapi::create_pipeline_cache(device_->vk_device(), 0, size, data);
+  VkResult res = vkMergePipelineCaches(device_->vk_device(), cache_->cache,
+                                       /*srcCacheCount=*/1, &src->cache);
+  if (res == VK_ERROR_OUT_OF_HOST_MEMORY ||
+      res == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+    return RhiResult::out_of_memory;
+  }
+  return res == VK_SUCCESS ? RhiResult::success : RhiResult::error;
+}
+
 VulkanPipeline::VulkanPipeline(const Params &params)
     : ti_device_(*params.device),
       device_(params.device->vk_device()),
@@ -637,10 +651,15 @@ ShaderResourceSet &VulkanResourceSet::rw_buffer(uint32_t binding,
                                                 size_t size) {
   dirty_ = true;
 
-  vkapi::IVkBuffer buffer =
-      (ptr != kDeviceNullPtr) ? device_->get_vkbuffer(ptr) : nullptr;
+  vkapi::IVkBuffer buffer = nullptr;
+  size_t offset = ptr.offset;
+  if (ptr != kDeviceNullPtr) {
+    buffer = device_->get_vkbuffer(ptr);
+    size = device_->get_vkbuffer_range(ptr, ptr.offset, size);
+    offset += device_->get_vkbuffer_offset(ptr);
+  }
   bindings_[binding] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                        Buffer{buffer, ptr.offset, size}};
+                        Buffer{buffer, offset, size}};
   return *this;
 }
 
@@ -654,10 +673,15 @@ ShaderResourceSet &VulkanResourceSet::buffer(uint32_t binding,
                                              size_t size) {
   dirty_ = true;
 
-  vkapi::IVkBuffer buffer =
-      (ptr != kDeviceNullPtr) ? device_->get_vkbuffer(ptr) : nullptr;
+  vkapi::IVkBuffer buffer = nullptr;
+  size_t offset = ptr.offset;
+  if (ptr != kDeviceNullPtr) {
+    buffer = device_->get_vkbuffer(ptr);
+    size = device_->get_vkbuffer_range(ptr, ptr.offset, size);
+    offset += device_->get_vkbuffer_offset(ptr);
+  }
   bindings_[binding] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                        Buffer{buffer, ptr.offset, size}};
+                        Buffer{buffer, offset, size}};
   return *this;
 }
 
@@ -688,6 +712,7 @@ ShaderResourceSet &VulkanResourceSet::image(uint32_t binding,
     sampler_info.compareEnable = VK_FALSE;
     sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
     sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
 
     sampler = vkapi::create_sampler(device_->vk_device(), sampler_info);
     view = device_->get_vk_imageview(alloc);
@@ -713,6 +738,22 @@ ShaderResourceSet &VulkanResourceSet::rw_image(uint32_t binding,
   return *this;
 }
 
+ShaderResourceSet &VulkanResourceSet::acceleration_structure(
+    uint32_t binding,
+    AccelerationStructure *accel) {
+  dirty_ = true;
+
+  // Shaders trace rays against the top level.
+  vkapi::IVkAccelerationStructureKHR tlas =
+      accel ? static_cast<VulkanAccelerationStructure *>(accel)->tlas
+            : nullptr;
+
+  bindings_[binding] = {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,
+                        AccelStruct{tlas}};
+
+  return *this;
+}
+
 RhiReturn<vkapi::IVkDescriptorSet> VulkanResourceSet::finalize() {
   if (!dirty_ && set_) {
     // If nothing changed directly return the set
@@ -724,25 +765,25 @@ RhiReturn<vkapi::IVkDescriptorSet> VulkanResourceSet::finalize() {
     return {RhiResult::invalid_usage, nullptr};
   }
 
-  vkapi::IVkDescriptorSetLayout new_layout =
-      device_->get_desc_set_layout(*this);
-  if (new_layout != layout_) {
-    // Layout changed, reset `set`
-    set_ = nullptr;
-    layout_ = new_layout;
+  layout_ = device_->get_desc_set_layout(*this);
+
+  set_ = device_->get_cached_desc_set(*this);
+  if (set_) {
+    dirty_ = false;
+    return {RhiResult::success, set_};
   }
 
-  if (!set_) {
-    // If set_ is null, create a new one
-    auto [status, new_set] = device_->alloc_desc_set(layout_);
-    if (status != RhiResult::success) {
-      return {status, nullptr};
-    }
-    set_ = new_set;
+  // A set that has been finalized before may be cached, or still be in use by
+  // the device, so always write to a new one.
+  auto [status, new_set] = device_->alloc_desc_set(layout_);
+  if (status != RhiResult::success) {
+    return {status, nullptr};
   }
+  set_ = new_set;
 
   std::forward_list<VkDescriptorBufferInfo> buffer_infos;
   std::forward_list<VkDescriptorImageInfo> image_infos;
+  std::forward_list<VkWriteDescriptorSetAccelerationStructureKHR> accel_infos;
   std::vector<VkWriteDescriptorSet> desc_writes;
 
   for (auto &pair : bindings_) {
@@ -796,6 +837,20 @@ RhiReturn<vkapi::IVkDescriptorSet> VulkanResourceSet::finalize() {
       if (tex->sampler) {
         set_->ref_binding_objs.push_back(tex->sampler);
       }
+    } else if (AccelStruct *as = std::get_if<AccelStruct>(&resource)) {
+      VkWriteDescriptorSetAccelerationStructureKHR &accel_info =
+          accel_infos.emplace_front();
+      accel_info.sType =
+          VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+      accel_info.pNext = nullptr;
+      accel_info.accelerationStructureCount = 1;
+      accel_info.pAccelerationStructures = as->accel ? &as->accel->accel
+                                                     : nullptr;
+
+      write.pNext = &accel_info;
+      if (as->accel) {
+        set_->ref_binding_objs.push_back(as->accel);
+      }
     } else {
       RHI_LOG_ERROR("Ignoring unsupported Descriptor Type");
     }
@@ -805,6 +860,7 @@ RhiReturn<vkapi::IVkDescriptorSet> VulkanResourceSet::finalize() {
                          desc_writes.data(), /*descriptorCopyCount=*/0,
                          /*pDescriptorCopies=*/nullptr);
 
+  device_->cache_desc_set(*this, set_);
   dirty_ = false;
 
   return {RhiResult::success, set_};
@@ -817,7 +873,8 @@ RasterResources &VulkanRasterResources::vertex_buffer(DevicePtr ptr,
   if (buffer == nullptr) {
     vertex_buffers.erase(binding);
   } else {
-    vertex_buffers[binding] = {buffer, ptr.offset};
+    vertex_buffers[binding] = {
+        buffer, ptr.offset + device_->get_vkbuffer_offset(ptr)};
   }
   return *this;
 }
@@ -830,7 +887,8 @@ RasterResources &VulkanRasterResources::index_buffer(DevicePtr ptr,
     index_binding = BufferBinding();
     index_type = VK_INDEX_TYPE_MAX_ENUM;
   } else {
-    index_binding = {buffer, ptr.offset};
+    index_binding = {buffer,
+                     ptr.offset + device_->get_vkbuffer_offset(ptr)};
     if (index_width == 32) {
       index_type = VK_INDEX_TYPE_UINT32;
     } else if (index_width == 16) {
@@ -847,7 +905,9 @@ VulkanCommandList::VulkanCommandList(VulkanDevice *ti_device,
       stream_(stream),
       device_(ti_device->vk_device()),
 #if !defined(__APPLE__)
-      query_pool_(vkapi::create_query_pool(ti_device->vk_device())),
+      query_pool_(stream->timestamps_enabled()
+                      ? vkapi::create_query_pool(ti_device->vk_device())
+                      : nullptr),
 #else
       query_pool_(),
 #endif
@@ -862,9 +922,11 @@ VulkanCommandList::VulkanCommandList(VulkanDevice *ti_device,
 
 // Workaround for MacOS: https://github.com/taichi-dev/taichi/issues/5888
 #if !defined(__APPLE__)
-  vkCmdResetQueryPool(buffer->buffer, query_pool_->query_pool, 0, 2);
-  vkCmdWriteTimestamp(buffer->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                      query_pool_->query_pool, 0);
+  if (query_pool_) {
+    vkCmdResetQueryPool(buffer->buffer, query_pool_->query_pool, 0, 2);
+    vkCmdWriteTimestamp(buffer->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                        query_pool_->query_pool, 0);
+  }
 #endif
 }
 
@@ -1006,14 +1068,14 @@ void VulkanCommandList::buffer_barrier(DevicePtr ptr, size_t size) noexcept {
   }
 
   if (saturate_uadd<size_t>(ptr.offset, size) > buffer_size) {
-    size = VK_WHOLE_SIZE;
+    size = ti_device_->get_vkbuffer_range(ptr, ptr.offset, VK_WHOLE_SIZE);
   }
 
   VkBufferMemoryBarrier barrier{};
   barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
   barrier.pNext = nullptr;
   barrier.buffer = buffer->buffer;
-  barrier.offset = ptr.offset;
+  barrier.offset = ptr.offset + ti_device_->get_vkbuffer_offset(ptr);
   barrier.size = size;
   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -1022,14 +1084,16 @@ void VulkanCommandList::buffer_barrier(DevicePtr ptr, size_t size) noexcept {
        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
   barrier.dstAccessMask =
       (VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
-       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+       VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
 
   vkCmdPipelineBarrier(
       buffer_->buffer,
       /*srcStageMask=*/
       VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
       /*dstStageMask=*/VK_PIPELINE_STAGE_TRANSFER_BIT |
-          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+          VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
       /*srcStageMask=*/0, /*memoryBarrierCount=*/0, nullptr,
       /*bufferMemoryBarrierCount=*/1,
       /*pBufferMemoryBarriers=*/&barrier,
@@ -1051,14 +1115,16 @@ void VulkanCommandList::memory_barrier() noexcept {
        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
   barrier.dstAccessMask =
       (VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
-       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+       VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
 
   vkCmdPipelineBarrier(
       buffer_->buffer,
       /*srcStageMask=*/
       VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
       /*dstStageMask=*/VK_PIPELINE_STAGE_TRANSFER_BIT |
-          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+          VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
       /*srcStageMask=*/0, /*memoryBarrierCount=*/1, &barrier,
       /*bufferMemoryBarrierCount=*/0,
       /*pBufferMemoryBarriers=*/nullptr,
@@ -1085,8 +1151,8 @@ void VulkanCommandList::buffer_copy(DevicePtr dst,
   }
 
   VkBufferCopy copy_region{};
-  copy_region.srcOffset = src.offset;
-  copy_region.dstOffset = dst.offset;
+  copy_region.srcOffset = src.offset + ti_device_->get_vkbuffer_offset(src);
+  copy_region.dstOffset = dst.offset + ti_device_->get_vkbuffer_offset(dst);
   copy_region.size = size;
 
   auto src_buffer = ti_device_->get_vkbuffer(src);
@@ -1112,13 +1178,55 @@ void VulkanCommandList::buffer_fill(DevicePtr ptr,
   }
 
   if (saturate_uadd<size_t>(ptr.offset, size) > buffer_size) {
-    size = VK_WHOLE_SIZE;
+    size = ti_device_->get_vkbuffer_range(ptr, ptr.offset, VK_WHOLE_SIZE);
   }
 
-  vkCmdFillBuffer(buffer_->buffer, buffer->buffer, ptr.offset, size, data);
+  vkCmdFillBuffer(buffer_->buffer, buffer->buffer,
+                  ptr.offset + ti_device_->get_vkbuffer_offset(ptr), size,
+                  data);
   buffer_->refs.push_back(buffer);
 }
 
+void VulkanCommandList::begin_profiler_scope(const std::string &name) noexcept {
+// Workaround for MacOS: https://github.com/taichi-dev/taichi/issues/5888
+#if !defined(__APPLE__)
+  if (!stream_->timestamps_enabled() ||
+      !ti_device_->get_vk_physical_device_props()
+           .limits.timestampComputeAndGraphics) {
+    return;
+  }
+  if (!profiler_scopes_) {
+    profiler_scopes_ = std::make_shared<ProfilerScopes>();
+  }
+  const uint32_t kScopesPerPool = ProfilerScopes::kProfilerScopesPerPool;
+  const size_t index = profiler_scopes_->names.size();
+  if (index % kScopesPerPool == 0) {
+    auto query_pool =
+        vkapi::create_query_pool(device_, /*query_count=*/2 * kScopesPerPool);
+    vkCmdResetQueryPool(buffer_->buffer, query_pool->query_pool, 0,
+                        2 * kScopesPerPool);
+    profiler_scopes_->query_pools.push_back(query_pool);
+  }
+  profiler_scopes_->names.push_back(name);
+  vkCmdWriteTimestamp(buffer_->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                      profiler_scopes_->query_pools.back()->query_pool,
+                      2 * (index % kScopesPerPool));
+#endif
+}
+
+void VulkanCommandList::end_profiler_scope() noexcept {
+#if !defined(__APPLE__)
+  if (!profiler_scopes_ || profiler_scopes_->names.empty()) {
+    return;
+  }
+  const uint32_t kScopesPerPool = ProfilerScopes::kProfilerScopesPerPool;
+  const size_t index = profiler_scopes_->names.size() - 1;
+  vkCmdWriteTimestamp(buffer_->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                      profiler_scopes_->query_pools.back()->query_pool,
+                      2 * (index % kScopesPerPool) + 1);
+#endif
+}
+
 RhiResult VulkanCommandList::dispatch(uint32_t x,
                                       uint32_t y,
                                       uint32_t z) noexcept {
@@ -1132,6 +1240,14 @@ RhiResult VulkanCommandList::dispatch(uint32_t x,
   return RhiResult::success;
 }
 
+RhiResult VulkanCommandList::dispatch_indirect(DevicePtr args) noexcept {
+  auto buffer = ti_device_->get_vkbuffer(args);
+  vkCmdDispatchIndirect(buffer_->buffer, buffer->buffer,
+                        args.offset + ti_device_->get_vkbuffer_offset(args));
+  buffer_->refs.push_back(buffer);
+  return RhiResult::success;
+}
+
 vkapi::IVkCommandBuffer VulkanCommandList::vk_command_buffer() {
   return buffer_;
 }
@@ -1140,6 +1256,11 @@ vkapi::IVkQueryPool VulkanCommandList::vk_query_pool() {
   return query_pool_;
 }
 
+std::shared_ptr<VulkanCommandList::ProfilerScopes>
+VulkanCommandList::profiler_scopes() {
+  return profiler_scopes_;
+}
+
 void VulkanCommandList::begin_renderpass(int x0,
                                          int y0,
                                          int x1,
@@ -1369,6 +1490,112 @@ void VulkanCommandList::draw_indexed_instance(uint32_t num_indicies,
                    start_vertex, start_instance);
 }
 
+RhiResult VulkanCommandList::draw_indirect(DevicePtr args) noexcept {
+  auto buffer = ti_device_->get_vkbuffer(args);
+  vkCmdDrawIndirect(buffer_->buffer, buffer->buffer,
+                    args.offset + ti_device_->get_vkbuffer_offset(args),
+                    /*drawCount=*/1, sizeof(VkDrawIndirectCommand));
+  buffer_->refs.push_back(buffer);
+  return RhiResult::success;
+}
+
+RhiResult VulkanCommandList::draw_indexed_indirect(DevicePtr args) noexcept {
+  auto buffer = ti_device_->get_vkbuffer(args);
+  vkCmdDrawIndexedIndirect(buffer_->buffer, buffer->buffer,
+                           args.offset + ti_device_->get_vkbuffer_offset(args),
+                           /*drawCount=*/1,
+                           sizeof(VkDrawIndexedIndirectCommand));
+  buffer_->refs.push_back(buffer);
+  return RhiResult::success;
+}
+
+RhiResult VulkanCommandList::build_acceleration_structure(
+    AccelerationStructure *accel,
+    bool update) noexcept {
+  auto *as = static_cast<VulkanAccelerationStructure *>(accel);
+  if (update && (!as->params.allow_update || !as->built)) {
+    return RhiResult::invalid_usage;
+  }
+
+  const VkBuildAccelerationStructureFlagsKHR flags =
+      VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+      (as->params.allow_update
+           ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR
+           : 0);
+  const VkBuildAccelerationStructureModeKHR mode =
+      update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR
+             : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+  barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR |
+                          VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+  // Bottom level: the triangles of the mesh.
+  VkAccelerationStructureGeometryKHR blas_geometry{};
+  ti_device_->fill_triangle_geometry(*as, &blas_geometry);
+  VkAccelerationStructureBuildGeometryInfoKHR blas_info{};
+  blas_info.sType =
+      VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+  blas_info.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+  blas_info.flags = flags;
+  blas_info.mode = mode;
+  blas_info.srcAccelerationStructure =
+      update ? as->blas->accel : VK_NULL_HANDLE;
+  blas_info.dstAccelerationStructure = as->blas->accel;
+  blas_info.geometryCount = 1;
+  blas_info.pGeometries = &blas_geometry;
+  blas_info.scratchData.deviceAddress = as->scratch_address;
+
+  VkAccelerationStructureBuildRangeInfoKHR blas_range{};
+  blas_range.primitiveCount = as->params.num_triangles;
+  const VkAccelerationStructureBuildRangeInfoKHR *blas_ranges = &blas_range;
+  vkCmdBuildAccelerationStructuresKHR(buffer_->buffer, 1, &blas_info,
+                                      &blas_ranges);
+
+  // The top level reads the bottom level, and reuses the scratch memory.
+  vkCmdPipelineBarrier(buffer_->buffer,
+                       VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                       VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  // Top level: a single instance of the bottom level.
+  VkAccelerationStructureGeometryKHR tlas_geometry{};
+  ti_device_->fill_instance_geometry(*as, &tlas_geometry);
+  VkAccelerationStructureBuildGeometryInfoKHR tlas_info = blas_info;
+  tlas_info.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+  tlas_info.srcAccelerationStructure =
+      update ? as->tlas->accel : VK_NULL_HANDLE;
+  tlas_info.dstAccelerationStructure = as->tlas->accel;
+  tlas_info.pGeometries = &tlas_geometry;
+
+  VkAccelerationStructureBuildRangeInfoKHR tlas_range{};
+  tlas_range.primitiveCount = 1;
+  const VkAccelerationStructureBuildRangeInfoKHR *tlas_ranges = &tlas_range;
+  vkCmdBuildAccelerationStructuresKHR(buffer_->buffer, 1, &tlas_info,
+                                      &tlas_ranges);
+
+  barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+  vkCmdPipelineBarrier(buffer_->buffer,
+                       VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+
+  buffer_->refs.push_back(as->vertex_buffer);
+  if (as->index_buffer) {
+    buffer_->refs.push_back(as->index_buffer);
+  }
+  buffer_->refs.push_back(as->instance_buffer);
+  buffer_->refs.push_back(as->scratch_buffer);
+  buffer_->refs.push_back(as->blas);
+  buffer_->refs.push_back(as->tlas);
+  as->built = true;
+
+  return RhiResult::success;
+}
+
 void VulkanCommandList::image_transition(DeviceAllocation img,
                                          ImageLayout old_layout_,
                                          ImageLayout new_layout_) {
@@ -1386,7 +1613,7 @@ void VulkanCommandList::image_transition(DeviceAllocation img,
   barrier.image = image->image;
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = 1;
 
@@ -1467,7 +1694,9 @@ void VulkanCommandList::buffer_to_image(DeviceAllocation dst_img,
                                         ImageLayout img_layout,
                                         const BufferImageCopyParams &params) {
   VkBufferImageCopy copy_info{};
-  buffer_image_copy_ti_to_vk(copy_info, src_buf.offset, params);
+  buffer_image_copy_ti_to_vk(
+      copy_info, src_buf.offset + ti_device_->get_vkbuffer_offset(src_buf),
+      params);
 
   auto [image, view, format] = ti_device_->get_vk_image(dst_img);
   auto buffer = ti_device_->get_vkbuffer(src_buf);
@@ -1483,7 +1712,9 @@ void VulkanCommandList::image_to_buffer(DevicePtr dst_buf,
                                         ImageLayout img_layout,
                                         const BufferImageCopyParams &params) {
   VkBufferImageCopy copy_info{};
-  buffer_image_copy_ti_to_vk(copy_info, dst_buf.offset, params);
+  buffer_image_copy_ti_to_vk(
+      copy_info, dst_buf.offset + ti_device_->get_vkbuffer_offset(dst_buf),
+      params);
 
   auto [image, view, format] = ti_device_->get_vk_image(src_img);
   auto buffer = ti_device_->get_vkbuffer(dst_buf);
@@ -1548,6 +1779,93 @@ void VulkanCommandList::blit_image(DeviceAllocation dst_img,
   buffer_->refs.push_back(src_vk_image);
 }
 
+void VulkanCommandList::generate_mipmaps(DeviceAllocation img,
+                                         ImageLayout img_layout) {
+  auto [image, view, format] = ti_device_->get_vk_image(img);
+  if (image->mip_levels <= 1) {
+    return;
+  }
+
+  // Not all formats can be filtered linearly, e.g. 32-bit floats on some
+  // mobile devices.
+  VkFormatProperties format_props;
+  vkGetPhysicalDeviceFormatProperties(ti_device_->vk_physical_device(),
+                                      image->format, &format_props);
+  const VkFilter filter = (format_props.optimalTilingFeatures &
+                           VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+                              ? VK_FILTER_LINEAR
+                              : VK_FILTER_NEAREST;
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image->image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  // All levels become blit destinations, and then each level becomes the
+  // source of the next one once it has been written.
+  barrier.oldLayout = image_layout_ti_to_vk(img_layout);
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  vkCmdPipelineBarrier(buffer_->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  int32_t width = image->width;
+  int32_t height = image->height;
+  int32_t depth = image->depth;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  for (uint32_t i = 1; i < image->mip_levels; i++) {
+    barrier.subresourceRange.baseMipLevel = i - 1;
+    vkCmdPipelineBarrier(buffer_->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+
+    VkImageBlit blit{};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = i - 1;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1] = {width, height, depth};
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+    depth = std::max(depth / 2, 1);
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.mipLevel = i;
+    blit.dstSubresource.layerCount = 1;
+    blit.dstOffsets[1] = {width, height, depth};
+    vkCmdBlitImage(buffer_->buffer, image->image,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+  }
+  barrier.subresourceRange.baseMipLevel = image->mip_levels - 1;
+  vkCmdPipelineBarrier(buffer_->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.newLayout = image_layout_ti_to_vk(img_layout);
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  vkCmdPipelineBarrier(buffer_->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  buffer_->refs.push_back(image);
+}
+
 void VulkanCommandList::set_line_width(float width) {
   if (ti_device_->vk_caps().wide_line) {
     vkCmdSetLineWidth(buffer_->buffer, width);
@@ -1568,8 +1886,10 @@ vkapi::IVkCommandBuffer VulkanCommandList::finalize() {
   if (!finalized_) {
 // Workaround for MacOS: https://github.com/taichi-dev/taichi/issues/5888
 #if !defined(__APPLE__)
-    vkCmdWriteTimestamp(buffer_->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                        query_pool_->query_pool, 1);
+    if (query_pool_) {
+      vkCmdWriteTimestamp(buffer_->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                          query_pool_->query_pool, 1);
+    }
 #endif
     vkEndCommandBuffer(buffer_->buffer);
     finalized_ = true;
@@ -1583,7 +1903,8 @@ struct VulkanDevice::ThreadLocalStreams {
 
 VulkanDevice::VulkanDevice()
     : compute_streams_(std::make_unique<ThreadLocalStreams>()),
-      graphics_streams_(std::make_unique<ThreadLocalStreams>()) {
+      graphics_streams_(std::make_unique<ThreadLocalStreams>()),
+      transfer_streams_(std::make_unique<ThreadLocalStreams>()) {
   DeviceCapabilityConfig caps{};
   caps.set(DeviceCapability::spirv_version, 0x10000);
   set_caps(std::move(caps));
@@ -1597,6 +1918,21 @@ void VulkanDevice::init_vulkan_structs(Params &params) {
   compute_queue_family_index_ = params.compute_queue_family_index;
   graphics_queue_ = params.graphics_queue;
   graphics_queue_family_index_ = params.graphics_queue_family_index;
+  transfer_queue_ = params.transfer_queue;
+  transfer_queue_family_index_ = params.transfer_queue_family_index;
+
+  buffer_queue_family_indices_ = {compute_queue_family_index_};
+  auto add_buffer_queue_family = [&](uint32_t index) {
+    if (std::find(buffer_queue_family_indices_.begin(),
+                  buffer_queue_family_indices_.end(),
+                  index) == buffer_queue_family_indices_.end()) {
+      buffer_queue_family_indices_.push_back(index);
+    }
+  };
+  add_buffer_queue_family(graphics_queue_family_index_);
+  if (has_transfer_queue()) {
+    add_buffer_queue_family(transfer_queue_family_index_);
+  }
 
   create_vma_allocator();
   RHI_ASSERT(new_descriptor_pool() == RhiResult::success &&
@@ -1621,8 +1957,11 @@ VulkanDevice::~VulkanDevice() {
 
   vkDeviceWaitIdle(device_);
 
+  desc_set_cache_.clear();
   desc_pool_ = nullptr;
 
+  buffer_pools_.clear();
+
   framebuffer_pools_.clear();
   renderpass_pools_.clear();
 
@@ -1689,7 +2028,33 @@ RhiResult VulkanDevice::create_pipeline(Pipeline **out_pipeline,
   return RhiResult::success;
 }
 
+std::string VulkanDevice::get_pipeline_cache_key() const noexcept {
+  const VkPhysicalDeviceProperties &props = get_vk_physical_device_props();
+  std::string key;
+  char buf[16];
+  for (uint8_t byte : props.pipelineCacheUUID) {
+    std::snprintf(buf, sizeof(buf), "%02x", byte);
+    key += buf;
+  }
+  std::snprintf(buf, sizeof(buf), "_%04x", props.vendorID);
+  key += buf;
+  std::snprintf(buf, sizeof(buf), "_%04x", props.deviceID);
+  key += buf;
+  std::snprintf(buf, sizeof(buf), "_%08x", props.driverVersion);
+  key += buf;
+  return key;
+}
+
 DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
+  if (params.export_sharing || params.size == 0 ||
+      params.size > kMaxSuballocSize) {
+    return allocate_dedicated_memory(params);
+  }
+  return suballocate_memory(params);
+}
+
+DeviceAllocation VulkanDevice::allocate_dedicated_memory(
+    const AllocParams &params) {
   AllocationInternal &alloc = allocations_.acquire();
 
   VkBufferCreateInfo buffer_info{};
@@ -1711,16 +2076,24 @@ DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
   if (params.usage && AllocUsage::Index) {
     buffer_info.usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
   }
+  if (params.usage && AllocUsage::Indirect) {
+    buffer_info.usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+  }
+  if (get_caps().get(DeviceCapability::spirv_has_ray_query) &&
+      (params.usage &&
+       (AllocUsage::Storage | AllocUsage::Vertex | AllocUsage::Index))) {
+    // Meshes may be built into acceleration structures.
+    buffer_info.usage |=
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+  }
 
-  uint32_t queue_family_indices[] = {compute_queue_family_index_,
-                                     graphics_queue_family_index_};
-
-  if (compute_queue_family_index_ == graphics_queue_family_index_) {
+  // Buffers may be accessed by the transfer queue as well.
+  if (buffer_queue_family_indices_.size() == 1) {
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   } else {
     buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    buffer_info.queueFamilyIndexCount = 2;
-    buffer_info.pQueueFamilyIndices = queue_family_indices;
+    buffer_info.queueFamilyIndexCount = buffer_queue_family_indices_.size();
+    buffer_info.pQueueFamilyIndices = buffer_queue_family_indices_.data();
   }
 
   VkExternalMemoryBufferCreateInfo external_mem_buffer_create_info = {};
@@ -1767,8 +2140,17 @@ DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
   } else {
     alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
   }
+  if (params.host_read && params.host_write &&
+      get_caps().get(DeviceCapability::unified_memory)) {
+    // Kernels access it at full speed, and the host through a persistent
+    // mapping which needs no flushes.
+    alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    alloc_info.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+  }
 
-  if (get_caps().get(DeviceCapability::spirv_has_physical_storage_buffer)) {
+  if (has_buffer_device_address()) {
     buffer_info.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR;
   }
 
@@ -1778,7 +2160,7 @@ DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
   vmaGetAllocationInfo(alloc.buffer->allocator, alloc.buffer->allocation,
                        &alloc.alloc_info);
 
-  if (get_caps().get(DeviceCapability::spirv_has_physical_storage_buffer)) {
+  if (has_buffer_device_address()) {
     VkBufferDeviceAddressInfoKHR info{};
     info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
     info.buffer = alloc.buffer->buffer;
@@ -1789,6 +2171,73 @@ DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
   return DeviceAllocation{this, (uint64_t)&alloc};
 }
 
+DeviceAllocation VulkanDevice::suballocate_memory(const AllocParams &params) {
+  int size_class = 0;
+  while ((kMinSuballocSize << size_class) < params.size) {
+    size_class++;
+  }
+  const VkDeviceSize range_size = kMinSuballocSize << size_class;
+
+  std::shared_ptr<BufferPool> pool;
+  {
+    const uint32_t key = uint32_t(params.usage) << 2 |
+                         uint32_t(params.host_read) << 1 |
+                         uint32_t(params.host_write);
+    std::lock_guard<std::mutex> _(buffer_pools_mut_);
+    auto &pool_ref = buffer_pools_[key];
+    if (!pool_ref) {
+      pool_ref = std::make_shared<BufferPool>();
+    }
+    pool = pool_ref;
+  }
+
+  std::shared_ptr<BufferBlock> block;
+  VkDeviceSize offset = 0;
+  {
+    std::lock_guard<std::mutex> _(pool->mut);
+    auto &free_ranges = pool->free_ranges[size_class];
+    if (!free_ranges.empty()) {
+      std::tie(block, offset) = std::move(free_ranges.back());
+      free_ranges.pop_back();
+    } else {
+      if (!pool->current_block ||
+          pool->current_block_used + range_size > kBufferBlockSize) {
+        AllocParams block_params = params;
+        block_params.size = kBufferBlockSize;
+        DeviceAllocation block_alloc = allocate_dedicated_memory(block_params);
+        AllocationInternal &block_alloc_int = get_alloc_internal(block_alloc);
+        pool->current_block = std::make_shared<BufferBlock>();
+        pool->current_block->buffer = block_alloc_int.buffer;
+        pool->current_block->alloc_info = block_alloc_int.alloc_info;
+        pool->current_block->addr = block_alloc_int.addr;
+        pool->current_block_used = 0;
+        allocations_.release(&block_alloc_int);
+      }
+      block = pool->current_block;
+      offset = pool->current_block_used;
+      pool->current_block_used += range_size;
+    }
+  }
+
+  AllocationInternal &alloc = allocations_.acquire();
+  // The reference shares the VkBuffer of the block, and puts the range back
+  // to the free list when it is released by the allocation itself, cached
+  // descriptor sets and command lists.
+  alloc.buffer = vkapi::IVkBuffer(
+      block->buffer.get(),
+      [pool, block, size_class, offset](vkapi::DeviceObjVkBuffer *) {
+        std::lock_guard<std::mutex> _(pool->mut);
+        pool->free_ranges[size_class].emplace_back(block, offset);
+      });
+  alloc.alloc_info = block->alloc_info;
+  alloc.alloc_info.size = params.size;
+  alloc.addr = block->addr ? block->addr + offset : 0;
+  alloc.suballocated = true;
+  alloc.buffer_offset = offset;
+
+  return DeviceAllocation{this, (uint64_t)&alloc};
+}
+
 RhiResult VulkanDevice::map_internal(AllocationInternal &alloc_int,
                                      size_t offset,
                                      size_t size,
@@ -1807,7 +2256,8 @@ RhiResult VulkanDevice::map_internal(AllocationInternal &alloc_int,
   if (alloc_int.buffer->allocator) {
     res = vmaMapMemory(alloc_int.buffer->allocator,
                        alloc_int.buffer->allocation, &alloc_int.mapped);
-    alloc_int.mapped = (uint8_t *)(alloc_int.mapped) + offset;
+    alloc_int.mapped =
+        (uint8_t *)(alloc_int.mapped) + alloc_int.buffer_offset + offset;
   } else {
     res = vkMapMemory(device_, alloc_int.alloc_info.deviceMemory,
                       alloc_int.alloc_info.offset + offset, size, 0,
@@ -1835,7 +2285,16 @@ RhiResult VulkanDevice::map_internal(AllocationInternal &alloc_int,
 }
 
 void VulkanDevice::dealloc_memory(DeviceAllocation handle) {
-  allocations_.release(&get_alloc_internal(handle));
+  AllocationInternal &alloc_int = get_alloc_internal(handle);
+  if (alloc_int.buffer) {
+    evict_cached_desc_sets([&](const VulkanResourceSet::Binding &binding) {
+      const auto *buf = std::get_if<VulkanResourceSet::Buffer>(&binding.res);
+      // Suballocations share the VkBuffer, but not the reference to it.
+      return buf && !buf->buffer.owner_before(alloc_int.buffer) &&
+             !alloc_int.buffer.owner_before(buf->buffer);
+    });
+  }
+  allocations_.release(&alloc_int);
 }
 
 ShaderResourceSet *VulkanDevice::create_resource_set() {
@@ -1850,6 +2309,195 @@ uint64_t VulkanDevice::get_memory_physical_pointer(DeviceAllocation handle) {
   return uint64_t(get_alloc_internal(handle).addr);
 }
 
+RhiResult VulkanDevice::create_acceleration_structure(
+    AccelerationStructure **out_accel,
+    const AccelerationStructureParams &params) noexcept {
+  if (!get_caps().get(DeviceCapability::spirv_has_ray_query)) {
+    return RhiResult::not_supported;
+  }
+  if (params.vertices == kDeviceNullPtr || params.num_triangles == 0 ||
+      (params.indices == kDeviceNullPtr &&
+       params.num_vertices < params.num_triangles * 3)) {
+    return RhiResult::invalid_usage;
+  }
+
+  try {
+    auto as = std::make_unique<VulkanAccelerationStructure>();
+    as->params = params;
+    as->vertex_buffer = get_vkbuffer(params.vertices);
+    as->vertex_address =
+        get_memory_physical_pointer(params.vertices) + params.vertices.offset;
+    if (params.indices != kDeviceNullPtr) {
+      as->index_buffer = get_vkbuffer(params.indices);
+      as->index_address =
+          get_memory_physical_pointer(params.indices) + params.indices.offset;
+    }
+
+    const VkBuildAccelerationStructureFlagsKHR flags =
+        VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+        (params.allow_update
+             ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR
+             : 0);
+    VkDeviceSize scratch_size = 0;
+
+    // Creates the storage of one level, sized for its single geometry.
+    auto create_level = [&](VkAccelerationStructureTypeKHR type,
+                            const VkAccelerationStructureGeometryKHR &geometry,
+                            uint32_t num_primitives) {
+      VkAccelerationStructureBuildGeometryInfoKHR info{};
+      info.sType =
+          VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+      info.type = type;
+      info.flags = flags;
+      info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+      info.geometryCount = 1;
+      info.pGeometries = &geometry;
+
+      VkAccelerationStructureBuildSizesInfoKHR sizes{};
+      sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+      vkGetAccelerationStructureBuildSizesKHR(
+          device_, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &info,
+          &num_primitives, &sizes);
+      scratch_size = std::max(
+          {scratch_size, sizes.buildScratchSize, sizes.updateScratchSize});
+
+      vkapi::IVkBuffer buffer = create_internal_buffer(
+          sizes.accelerationStructureSize,
+          VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR,
+          /*host_write=*/false, /*address=*/nullptr);
+      return vkapi::create_acceleration_structure(
+          0, buffer, 0, sizes.accelerationStructureSize, type);
+    };
+
+    VkAccelerationStructureGeometryKHR blas_geometry{};
+    fill_triangle_geometry(*as, &blas_geometry);
+    as->blas = create_level(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+                            blas_geometry, params.num_triangles);
+
+    // The instance is written once, and only the levels are rebuilt.
+    as->instance_buffer = create_internal_buffer(
+        sizeof(VkAccelerationStructureInstanceKHR),
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+        /*host_write=*/true, &as->instance_address);
+    VkAccelerationStructureDeviceAddressInfoKHR blas_address_info{};
+    blas_address_info.sType =
+        VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+    blas_address_info.accelerationStructure = as->blas->accel;
+
+    VkAccelerationStructureInstanceKHR instance{};
+    instance.transform.matrix[0][0] = 1.0f;
+    instance.transform.matrix[1][1] = 1.0f;
+    instance.transform.matrix[2][2] = 1.0f;
+    instance.mask = 0xFF;
+    instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+    instance.accelerationStructureReference =
+        vkGetAccelerationStructureDeviceAddressKHR(device_, &blas_address_info);
+
+    void *mapped = nullptr;
+    if (vmaMapMemory(allocator_, as->instance_buffer->allocation, &mapped) !=
+        VK_SUCCESS) {
+      *out_accel = nullptr;
+      return RhiResult::error;
+    }
+    std::memcpy(mapped, &instance, sizeof(instance));
+    vmaFlushAllocation(allocator_, as->instance_buffer->allocation, 0,
+                       VK_WHOLE_SIZE);
+    vmaUnmapMemory(allocator_, as->instance_buffer->allocation);
+
+    VkAccelerationStructureGeometryKHR tlas_geometry{};
+    fill_instance_geometry(*as, &tlas_geometry);
+    as->tlas = create_level(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+                            tlas_geometry, 1);
+
+    // Scratch addresses must be aligned to
+    // minAccelerationStructureScratchOffsetAlignment, which is at most 256.
+    constexpr VkDeviceSize kScratchAlignment = 256;
+    as->scratch_buffer = create_internal_buffer(
+        scratch_size + kScratchAlignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        /*host_write=*/false, &as->scratch_address);
+    as->scratch_address = (as->scratch_address + kScratchAlignment - 1) &
+                          ~(kScratchAlignment - 1);
+
+    *out_accel = as.release();
+  } catch (std::bad_alloc &) {
+    *out_accel = nullptr;
+    return RhiResult::out_of_memory;
+  }
+
+  return RhiResult::success;
+}
+
+void VulkanDevice::fill_triangle_geometry(
+    const VulkanAccelerationStructure &accel,
+    VkAccelerationStructureGeometryKHR *geometry) const {
+  const AccelerationStructureParams &params = accel.params;
+  geometry->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+  geometry->geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+  geometry->flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+  auto &triangles = geometry->geometry.triangles;
+  triangles.sType =
+      VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+  triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+  triangles.vertexData.deviceAddress = accel.vertex_address;
+  triangles.vertexStride = params.vertex_stride;
+  triangles.maxVertex = params.num_vertices ? params.num_vertices - 1 : 0;
+  triangles.indexType = accel.index_buffer ? VK_INDEX_TYPE_UINT32
+                                           : VK_INDEX_TYPE_NONE_KHR;
+  triangles.indexData.deviceAddress = accel.index_address;
+}
+
+void VulkanDevice::fill_instance_geometry(
+    const VulkanAccelerationStructure &accel,
+    VkAccelerationStructureGeometryKHR *geometry) const {
+  geometry->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+  geometry->geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+  geometry->flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+  auto &instances = geometry->geometry.instances;
+  instances.sType =
+      VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+  instances.arrayOfPointers = VK_FALSE;
+  instances.data.deviceAddress = accel.instance_address;
+}
+
+vkapi::IVkBuffer VulkanDevice::create_internal_buffer(
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    bool host_write,
+    VkDeviceAddress *address) {
+  VkBufferCreateInfo buffer_info{};
+  buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buffer_info.size = size;
+  buffer_info.usage = usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR;
+  if (buffer_queue_family_indices_.size() == 1) {
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  } else {
+    buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    buffer_info.queueFamilyIndexCount = buffer_queue_family_indices_.size();
+    buffer_info.pQueueFamilyIndices = buffer_queue_family_indices_.data();
+  }
+
+  VmaAllocationCreateInfo alloc_info{};
+  if (host_write) {
+    alloc_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    alloc_info.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  } else {
+    alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
+
+  vkapi::IVkBuffer buffer =
+      vkapi::create_buffer(device_, allocator_, &buffer_info, &alloc_info);
+
+  if (address) {
+    VkBufferDeviceAddressInfoKHR info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+    info.buffer = buffer->buffer;
+    info.pNext = nullptr;
+    *address = vkGetBufferDeviceAddressKHR(device_, &info);
+  }
+
+  return buffer;
+}
+
 RhiResult VulkanDevice::map_range(DevicePtr ptr,
                                   uint64_t size,
                                   void **mapped_ptr) {
@@ -1884,8 +2532,11 @@ void VulkanDevice::unmap(DeviceAllocation alloc) {
 void VulkanDevice::memcpy_internal(DevicePtr dst,
                                    DevicePtr src,
                                    uint64_t size) {
-  // TODO: always create a queue specifically for transfer
-  Stream *stream = get_compute_stream();
+  Stream *stream = get_transfer_stream();
+  if (stream != get_compute_stream()) {
+    // The copy is not ordered with the work on the compute queue otherwise.
+    get_compute_stream()->command_sync();
+  }
   auto [cmd, res] = stream->new_command_list_unique();
   TI_ASSERT(res == RhiResult::success);
   cmd->buffer_copy(dst, src, size);
@@ -1916,6 +2567,22 @@ Stream *VulkanDevice::get_graphics_stream() {
   return iter->second.get();
 }
 
+Stream *VulkanDevice::get_transfer_stream() {
+  if (!has_transfer_queue()) {
+    return get_compute_stream();
+  }
+  auto tid = std::this_thread::get_id();
+  auto &stream_map = transfer_streams_->map;
+  auto iter = stream_map.find(tid);
+  if (iter == stream_map.end()) {
+    stream_map[tid] = std::make_unique<VulkanStream>(
+        *this, transfer_queue_, transfer_queue_family_index_,
+        /*timestamps=*/false);
+    return stream_map.at(tid).get();
+  }
+  return iter->second.get();
+}
+
 void VulkanDevice::wait_idle() {
   for (auto &[tid, stream] : compute_streams_->map) {
     stream->command_sync();
@@ -1923,6 +2590,9 @@ void VulkanDevice::wait_idle() {
   for (auto &[tid, stream] : graphics_streams_->map) {
     stream->command_sync();
   }
+  for (auto &[tid, stream] : transfer_streams_->map) {
+    stream->command_sync();
+  }
 }
 
 RhiResult VulkanStream::new_command_list(CommandList **out_cmdlist) noexcept {
@@ -1965,16 +2635,49 @@ StreamSemaphore VulkanStream::submit(
     vk_wait_stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
     buffer->refs.push_back(sema->vkapi_ref);
   }
+  // Binary semaphores ignore their values.
+  std::vector<uint64_t> wait_values(vk_wait_semaphores.size(), 0);
+
+  auto semaphore = vkapi::create_semaphore(buffer->device, 0);
+  buffer->refs.push_back(semaphore);
+
+  const uint64_t id = last_submission_id() + 1;
+  std::vector<VkSemaphore> vk_signal_semaphores{semaphore->semaphore};
+  std::vector<uint64_t> signal_values{0};
+  if (timeline_) {
+    vk_signal_semaphores.push_back(timeline_->semaphore);
+    signal_values.push_back(id);
+  }
+
+  for (auto [sema, value] : external_waits_) {
+    vk_wait_semaphores.push_back(sema);
+    vk_wait_stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    wait_values.push_back(value);
+  }
+  for (auto [sema, value] : external_signals_) {
+    vk_signal_semaphores.push_back(sema);
+    signal_values.push_back(value);
+  }
+  const bool has_timeline_values = timeline_ || external_timeline_;
+  external_waits_.clear();
+  external_signals_.clear();
+  external_timeline_ = false;
 
   submit_info.pWaitSemaphores = vk_wait_semaphores.data();
   submit_info.waitSemaphoreCount = vk_wait_semaphores.size();
   submit_info.pWaitDstStageMask = vk_wait_stages.data();
+  submit_info.signalSemaphoreCount = vk_signal_semaphores.size();
+  submit_info.pSignalSemaphores = vk_signal_semaphores.data();
 
-  auto semaphore = vkapi::create_semaphore(buffer->device, 0);
-  buffer->refs.push_back(semaphore);
-
-  submit_info.signalSemaphoreCount = 1;
-  submit_info.pSignalSemaphores = &semaphore->semaphore;
+  VkTimelineSemaphoreSubmitInfoKHR timeline_info{};
+  if (has_timeline_values) {
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timeline_info.waitSemaphoreValueCount = wait_values.size();
+    timeline_info.pWaitSemaphoreValues = wait_values.data();
+    timeline_info.signalSemaphoreValueCount = signal_values.size();
+    timeline_info.pSignalSemaphoreValues = signal_values.data();
+    submit_info.pNext = &timeline_info;
+  }
 
   auto fence = vkapi::create_fence(buffer->device, 0);
 
@@ -1990,7 +2693,8 @@ StreamSemaphore VulkanStream::submit(
     });
   */
 
-  submitted_cmdbuffers_.push_back(TrackedCmdbuf{fence, buffer, query_pool});
+  submitted_cmdbuffers_.push_back(
+      TrackedCmdbuf{fence, buffer, query_pool, cmdlist->profiler_scopes()});
 
   BAIL_ON_VK_BAD_RESULT_NO_RETURN(
       vkQueueSubmit(queue_, /*submitCount=*/1, &submit_info,
@@ -2000,6 +2704,16 @@ StreamSemaphore VulkanStream::submit(
   return std::make_shared<VulkanStreamSemaphoreObject>(semaphore);
 }
 
+void VulkanStream::add_external_semaphores(
+    const std::vector<std::pair<VkSemaphore, uint64_t>> &waits,
+    const std::vector<std::pair<VkSemaphore, uint64_t>> &signals,
+    bool timeline) {
+  external_waits_.insert(external_waits_.end(), waits.begin(), waits.end());
+  external_signals_.insert(external_signals_.end(), signals.begin(),
+                           signals.end());
+  external_timeline_ = external_timeline_ || timeline;
+}
+
 StreamSemaphore VulkanStream::submit_synced(
     CommandList *cmdlist,
     const std::vector<StreamSemaphore> &wait_semaphores) {
@@ -2010,11 +2724,65 @@ StreamSemaphore VulkanStream::submit_synced(
 
 void VulkanStream::command_sync() {
   vkQueueWaitIdle(queue_);
+  retire_submissions(last_submission_id());
+}
+
+void VulkanStream::wait_for_submissions() {
+  wait_for_submission(last_submission_id());
+}
+
+bool VulkanStream::is_submission_complete(uint64_t id) {
+  TI_ASSERT(id <= last_submission_id());
+  if (id <= num_retired_submissions_) {
+    return true;
+  }
+  if (timeline_) {
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValueKHR(device_.vk_device(), timeline_->semaphore,
+                                  &value);
+    return value >= id;
+  }
+  const auto &cmdbuf =
+      submitted_cmdbuffers_[id - num_retired_submissions_ - 1];
+  return vkGetFenceStatus(device_.vk_device(), cmdbuf.fence->fence) ==
+         VK_SUCCESS;
+}
+
+void VulkanStream::wait_for_submission(uint64_t id) {
+  TI_ASSERT(id <= last_submission_id());
+  if (id <= num_retired_submissions_) {
+    return;
+  }
+  if (timeline_) {
+    VkSemaphoreWaitInfoKHR wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &timeline_->semaphore;
+    wait_info.pValues = &id;
+    vkWaitSemaphoresKHR(device_.vk_device(), &wait_info, UINT64_MAX);
+  } else {
+    // Fences of a queue are signaled in submission order.
+    const auto &cmdbuf =
+        submitted_cmdbuffers_[id - num_retired_submissions_ - 1];
+    vkWaitForFences(device_.vk_device(), 1, &cmdbuf.fence->fence, VK_TRUE,
+                    UINT64_MAX);
+  }
+  // The later submissions may still be in flight.
+  retire_submissions(id);
+}
+
+void VulkanStream::retire_submissions(uint64_t id) {
+  if (id <= num_retired_submissions_) {
+    return;
+  }
+  const size_t num_retired = std::min<size_t>(
+      id - num_retired_submissions_, submitted_cmdbuffers_.size());
 
   VkPhysicalDeviceProperties props{};
   vkGetPhysicalDeviceProperties(device_.vk_physical_device(), &props);
 
-  for (const auto &cmdbuf : submitted_cmdbuffers_) {
+  for (size_t i = 0; i < num_retired; ++i) {
+    const auto &cmdbuf = submitted_cmdbuffers_[i];
     if (cmdbuf.query_pool == nullptr) {
       continue;
     }
@@ -2033,13 +2801,60 @@ void VulkanStream::command_sync() {
     device_time_elapsed_us_ += duration_us;
   }
 
-  submitted_cmdbuffers_.clear();
+  for (size_t i = num_resolved_cmdbuffers_; i < num_retired; ++i) {
+    resolve_profiler_scopes(submitted_cmdbuffers_[i],
+                            props.limits.timestampPeriod);
+  }
+  num_resolved_cmdbuffers_ -= std::min(num_resolved_cmdbuffers_, num_retired);
+  num_retired_submissions_ += num_retired;
+  submitted_cmdbuffers_.erase(submitted_cmdbuffers_.begin(),
+                              submitted_cmdbuffers_.begin() + num_retired);
 }
 
 double VulkanStream::device_time_elapsed_us() const {
   return device_time_elapsed_us_;
 }
 
+std::vector<Stream::ProfilerRecord> VulkanStream::pop_profiler_records() {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(device_.vk_physical_device(), &props);
+
+  // Fences of a queue are signaled in submission order.
+  while (num_resolved_cmdbuffers_ < submitted_cmdbuffers_.size()) {
+    const auto &cmdbuf = submitted_cmdbuffers_[num_resolved_cmdbuffers_];
+    if (vkGetFenceStatus(device_.vk_device(), cmdbuf.fence->fence) !=
+        VK_SUCCESS) {
+      break;
+    }
+    resolve_profiler_scopes(cmdbuf, props.limits.timestampPeriod);
+    num_resolved_cmdbuffers_++;
+  }
+
+  std::vector<ProfilerRecord> records;
+  records.swap(profiler_records_);
+  return records;
+}
+
+void VulkanStream::resolve_profiler_scopes(const TrackedCmdbuf &cmdbuf,
+                                           float timestamp_period) {
+  if (!cmdbuf.profiler_scopes) {
+    return;
+  }
+  const uint32_t kScopesPerPool =
+      VulkanCommandList::ProfilerScopes::kProfilerScopesPerPool;
+  const auto &names = cmdbuf.profiler_scopes->names;
+  for (size_t i = 0; i < names.size(); ++i) {
+    uint64_t t[2];
+    vkGetQueryPoolResults(
+        device_.vk_device(),
+        cmdbuf.profiler_scopes->query_pools[i / kScopesPerPool]->query_pool,
+        2 * (i % kScopesPerPool), 2, sizeof(uint64_t) * 2, &t,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    profiler_records_.push_back(
+        {names[i], (t[1] - t[0]) * timestamp_period / 1000.0});
+  }
+}
+
 std::unique_ptr<Pipeline> VulkanDevice::create_raster_pipeline(
     const std::vector<PipelineSourceDesc> &src,
     const RasterParams &raster_params,
@@ -2081,9 +2896,10 @@ std::unique_ptr<Surface> VulkanDevice::create_surface(
 std::tuple<VkDeviceMemory, size_t, size_t>
 VulkanDevice::get_vkmemory_offset_size(const DeviceAllocation &alloc) const {
   auto &buffer_alloc = get_alloc_internal(alloc);
-  return std::make_tuple(buffer_alloc.alloc_info.deviceMemory,
-                         buffer_alloc.alloc_info.offset,
-                         buffer_alloc.alloc_info.size);
+  return std::make_tuple(
+      buffer_alloc.alloc_info.deviceMemory,
+      buffer_alloc.alloc_info.offset + buffer_alloc.buffer_offset,
+      buffer_alloc.alloc_info.size);
 }
 
 vkapi::IVkBuffer VulkanDevice::get_vkbuffer(
@@ -2099,6 +2915,26 @@ size_t VulkanDevice::get_vkbuffer_size(const DeviceAllocation &alloc) const {
   return alloc_int.alloc_info.size;
 }
 
+size_t VulkanDevice::get_vkbuffer_offset(const DeviceAllocation &alloc) const {
+  return get_alloc_internal(alloc).buffer_offset;
+}
+
+VkDeviceSize VulkanDevice::get_vkbuffer_range(const DeviceAllocation &alloc,
+                                              size_t offset,
+                                              size_t size) const {
+  const AllocationInternal &alloc_int = get_alloc_internal(alloc);
+  if (!alloc_int.suballocated) {
+    return size;
+  }
+  // The rest of the shared buffer belongs to other allocations.
+  const size_t alloc_size = alloc_int.alloc_info.size;
+  if (size == VK_WHOLE_SIZE ||
+      saturate_uadd<size_t>(offset, size) > alloc_size) {
+    return saturate_usub<size_t>(alloc_size, offset);
+  }
+  return size;
+}
+
 std::tuple<vkapi::IVkImage, vkapi::IVkImageView, VkFormat>
 VulkanDevice::get_vk_image(const DeviceAllocation &alloc) const {
   const ImageAllocInternal &alloc_int = get_image_alloc_internal(alloc);
@@ -2130,7 +2966,7 @@ DeviceAllocation VulkanDevice::import_vkbuffer(vkapi::IVkBuffer buffer,
   alloc_int.external = true;
   alloc_int.buffer = buffer;
   alloc_int.mapped = nullptr;
-  if (get_caps().get(DeviceCapability::spirv_has_physical_storage_buffer)) {
+  if (has_buffer_device_address()) {
     VkBufferDeviceAddressInfoKHR info{};
     info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
     info.buffer = buffer->buffer;
@@ -2172,7 +3008,11 @@ vkapi::IVkImageView VulkanDevice::get_vk_lod_imageview(
 DeviceAllocation VulkanDevice::create_image(const ImageParams &params) {
   ImageAllocInternal &alloc = image_allocations_.acquire();
 
-  int num_mip_levels = 1;
+  uint32_t num_mip_levels = 1;
+  while (num_mip_levels < params.mip_levels &&
+         (std::max({params.x, params.y, params.z}) >> num_mip_levels) > 0) {
+    num_mip_levels++;
+  }
 
   bool is_depth = params.format == BufferFormat::depth16 ||
                   params.format == BufferFormat::depth24stencil8 ||
@@ -2285,7 +3125,7 @@ DeviceAllocation VulkanDevice::create_image(const ImageParams &params) {
 
   alloc.view = vkapi::create_image_view(device_, alloc.image, &view_info);
 
-  for (int i = 0; i < num_mip_levels; i++) {
+  for (uint32_t i = 0; i < num_mip_levels; i++) {
     view_info.subresourceRange.baseMipLevel = i;
     view_info.subresourceRange.levelCount = 1;
     alloc.view_lods.push_back(
@@ -2302,7 +3142,24 @@ DeviceAllocation VulkanDevice::create_image(const ImageParams &params) {
 }
 
 void VulkanDevice::destroy_image(DeviceAllocation handle) {
-  image_allocations_.release(&get_image_alloc_internal(handle));
+  ImageAllocInternal &alloc_int = get_image_alloc_internal(handle);
+  auto is_view_of_image = [&](const vkapi::IVkImageView &view) {
+    return view && (view == alloc_int.view ||
+                    std::find(alloc_int.view_lods.begin(),
+                              alloc_int.view_lods.end(),
+                              view) != alloc_int.view_lods.end());
+  };
+  evict_cached_desc_sets([&](const VulkanResourceSet::Binding &binding) {
+    if (const auto *img = std::get_if<VulkanResourceSet::Image>(&binding.res)) {
+      return is_view_of_image(img->view);
+    }
+    if (const auto *tex =
+            std::get_if<VulkanResourceSet::Texture>(&binding.res)) {
+      return is_view_of_image(tex->view);
+    }
+    return false;
+  });
+  image_allocations_.release(&alloc_int);
 }
 
 vkapi::IVkRenderPass VulkanDevice::get_renderpass(
@@ -2390,6 +3247,7 @@ vkapi::IVkRenderPass VulkanDevice::get_renderpass(
 
 vkapi::IVkDescriptorSetLayout VulkanDevice::get_desc_set_layout(
     VulkanResourceSet &set) {
+  std::lock_guard<std::mutex> _(desc_set_layouts_mut_);
   if (desc_set_layouts_.find(set) == desc_set_layouts_.end()) {
     std::vector<VkDescriptorSetLayoutBinding> bindings;
     for (const auto &pair : set.get_bindings()) {
@@ -2433,6 +3291,44 @@ RhiReturn<vkapi::IVkDescriptorSet> VulkanDevice::alloc_desc_set(
   return {RhiResult::success, set};
 }
 
+vkapi::IVkDescriptorSet VulkanDevice::get_cached_desc_set(
+    const VulkanResourceSet &set) {
+  auto iter = desc_set_cache_.find(set);
+  if (iter == desc_set_cache_.end()) {
+    return nullptr;
+  }
+  return iter->second;
+}
+
+void VulkanDevice::cache_desc_set(const VulkanResourceSet &set,
+                                  vkapi::IVkDescriptorSet desc_set) {
+  // Bindings that change all the time would otherwise grow the cache without
+  // bound.
+  constexpr size_t kMaxCachedDescSets = 1024;
+  if (desc_set_cache_.size() >= kMaxCachedDescSets) {
+    desc_set_cache_.clear();
+  }
+  desc_set_cache_[set] = desc_set;
+}
+
+void VulkanDevice::evict_cached_desc_sets(
+    const std::function<bool(const VulkanResourceSet::Binding &)> &pred) {
+  for (auto iter = desc_set_cache_.begin(); iter != desc_set_cache_.end();) {
+    bool uses_resource = false;
+    for (const auto &[binding, res] : iter->first.get_bindings()) {
+      if (pred(res)) {
+        uses_resource = true;
+        break;
+      }
+    }
+    if (uses_resource) {
+      iter = desc_set_cache_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
 void VulkanDevice::create_vma_allocator() {
   VmaAllocatorCreateInfo allocatorInfo = {};
   allocatorInfo.vulkanApiVersion = vk_caps().vk_api_version;
@@ -2487,7 +3383,7 @@ void VulkanDevice::create_vma_allocator() {
 
   allocatorInfo.pVulkanFunctions = &vk_vma_functions;
 
-  if (get_caps().get(DeviceCapability::spirv_has_physical_storage_buffer)) {
+  if (has_buffer_device_address()) {
     allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
   }
 
@@ -2517,6 +3413,11 @@ void VulkanDevice::create_vma_allocator() {
   vmaCreateAllocator(&allocatorInfo, &allocator_export_);
 }
 
+bool VulkanDevice::has_buffer_device_address() const {
+  return get_caps().get(DeviceCapability::spirv_has_physical_storage_buffer) ||
+         get_caps().get(DeviceCapability::spirv_has_ray_query);
+}
+
 RhiResult VulkanDevice::new_descriptor_pool() {
   std::vector<VkDescriptorPoolSize> pool_sizes{
       {VK_DESCRIPTOR_TYPE_SAMPLER, 64},
@@ -2530,6 +3431,9 @@ RhiResult VulkanDevice::new_descriptor_pool() {
       {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 128},
       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 128},
       {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 128}};
+  if (get_caps().get(DeviceCapability::spirv_has_ray_query)) {
+    pool_sizes.push_back({VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 64});
+  }
   VkDescriptorPoolCreateInfo pool_info = {};
   pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
@@ -2855,7 +3759,9 @@ void VulkanSurface::present_image(
 
   vkQueuePresentKHR(device_->graphics_queue(), &presentInfo);
 
-  device_->wait_idle();
+  if (config_.sync_on_present) {
+    device_->wait_idle();
+  }
 }
 
 DeviceAllocation VulkanSurface::get_depth_data(DeviceAllocation &depth_alloc) {
@@ -2953,11 +3859,23 @@ DeviceAllocation VulkanSurface::get_image_data() {
 
 VulkanStream::VulkanStream(VulkanDevice &device,
                            VkQueue queue,
-                           uint32_t queue_family_index)
-    : device_(device), queue_(queue), queue_family_index_(queue_family_index) {
+                           uint32_t queue_family_index,
+                           bool timestamps)
+    : device_(device),
+      queue_(queue),
+      queue_family_index_(queue_family_index),
+      timestamps_(timestamps),
+      device_time_elapsed_us_(0.0) {
   command_pool_ = vkapi::create_command_pool(
       device_.vk_device(), VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
       queue_family_index);
+  if (device_.vk_caps().timeline_semaphore) {
+    VkSemaphoreTypeCreateInfoKHR type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    type_info.initialValue = 0;
+    timeline_ = vkapi::create_semaphore(device_.vk_device(), 0, &type_info);
+  }
 }
 
 VulkanStream::~VulkanStream() {
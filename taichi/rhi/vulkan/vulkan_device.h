@@ -13,7 +13,9 @@
 #include <GLFW/glfw3.h>
 #endif
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <list>
 #include <variant>
@@ -136,9 +138,21 @@ class VulkanResourceSet : public ShaderResourceSet {
     }
   };
 
+  struct AccelStruct {
+    vkapi::IVkAccelerationStructureKHR accel{nullptr};
+
+    bool operator==(const AccelStruct &rhs) const {
+      return accel == rhs.accel;
+    }
+
+    bool operator!=(const AccelStruct &rhs) const {
+      return accel != rhs.accel;
+    }
+  };
+
   struct Binding {
     VkDescriptorType type{VK_DESCRIPTOR_TYPE_MAX_ENUM};
-    std::variant<Buffer, Image, Texture> res{Buffer()};
+    std::variant<Buffer, Image, Texture, AccelStruct> res{Buffer()};
 
     bool operator==(const Binding &other) const {
       return other.type == type && other.res == res;
@@ -160,6 +174,8 @@ class VulkanResourceSet : public ShaderResourceSet {
       } else if (const Texture *tex = std::get_if<Texture>(&res)) {
         rhi_impl::hash_combine(hash, (void *)tex->view.get());
         rhi_impl::hash_combine(hash, (void *)tex->sampler.get());
+      } else if (const AccelStruct *as = std::get_if<AccelStruct>(&res)) {
+        rhi_impl::hash_combine(hash, (void *)as->accel.get());
       }
       return hash;
     }
@@ -237,6 +253,9 @@ class VulkanResourceSet : public ShaderResourceSet {
   ShaderResourceSet &rw_image(uint32_t binding,
                               DeviceAllocation alloc,
                               int lod) final;
+  ShaderResourceSet &acceleration_structure(
+      uint32_t binding,
+      AccelerationStructure *accel) final;
 
   rhi_impl::RhiReturn<vkapi::IVkDescriptorSet> finalize();
 
@@ -290,6 +309,7 @@ class VulkanPipelineCache : public PipelineCache {
 
   void *data() noexcept final;
   size_t size() const noexcept final;
+  RhiResult merge(size_t size, const void *data) noexcept final;
 
   vkapi::IVkPipelineCache vk_pipeline_cache() {
     return cache_;
@@ -419,7 +439,10 @@ class VulkanCommandList : public CommandList {
   void memory_barrier() noexcept final;
   void buffer_copy(DevicePtr dst, DevicePtr src, size_t size) noexcept final;
   void buffer_fill(DevicePtr ptr, size_t size, uint32_t data) noexcept final;
+  void begin_profiler_scope(const std::string &name) noexcept final;
+  void end_profiler_scope() noexcept final;
   RhiResult dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1) noexcept final;
+  RhiResult dispatch_indirect(DevicePtr args) noexcept final;
   void begin_renderpass(int x0,
                         int y0,
                         int x1,
@@ -444,6 +467,10 @@ class VulkanCommandList : public CommandList {
                              uint32_t start_vertex = 0,
                              uint32_t start_index = 0,
                              uint32_t start_instance = 0) override;
+  RhiResult draw_indirect(DevicePtr args) noexcept final;
+  RhiResult draw_indexed_indirect(DevicePtr args) noexcept final;
+  RhiResult build_acceleration_structure(AccelerationStructure *accel,
+                                         bool update) noexcept final;
   void set_line_width(float width) override;
   void image_transition(DeviceAllocation img,
                         ImageLayout old_layout,
@@ -469,6 +496,8 @@ class VulkanCommandList : public CommandList {
                   ImageLayout src_img_layout,
                   const ImageCopyParams &params) override;
 
+  void generate_mipmaps(DeviceAllocation img, ImageLayout img_layout) override;
+
   vkapi::IVkRenderPass current_renderpass();
 
   // Vulkan specific functions
@@ -477,6 +506,16 @@ class VulkanCommandList : public CommandList {
   vkapi::IVkCommandBuffer vk_command_buffer();
   vkapi::IVkQueryPool vk_query_pool();
 
+  // The timestamps of the profiler scopes, which start at query 2 * i of
+  // query pool i / kProfilerScopesPerPool.
+  struct ProfilerScopes {
+    static constexpr uint32_t kProfilerScopesPerPool = 64;
+
+    std::vector<vkapi::IVkQueryPool> query_pools;
+    std::vector<std::string> names;
+  };
+  std::shared_ptr<ProfilerScopes> profiler_scopes();
+
  private:
   bool finalized_{false};
   VulkanDevice *ti_device_;
@@ -485,6 +524,7 @@ class VulkanCommandList : public CommandList {
   vkapi::IVkQueryPool query_pool_;
   vkapi::IVkCommandBuffer buffer_;
   VulkanPipeline *current_pipeline_{nullptr};
+  std::shared_ptr<ProfilerScopes> profiler_scopes_{nullptr};
 
   // Renderpass & raster pipeline
   std::vector<vkapi::IVkImage> current_dynamic_targets_;
@@ -563,11 +603,18 @@ class VulkanStreamSemaphoreObject : public StreamSemaphoreObject {
 
 class VulkanStream : public Stream {
  public:
+  // Queues of transfer-only families can not reset or write the timestamp
+  // queries of command lists, so those have to be disabled.
   VulkanStream(VulkanDevice &device,
                VkQueue queue,
-               uint32_t queue_family_index);
+               uint32_t queue_family_index,
+               bool timestamps = true);
   ~VulkanStream() override;
 
+  bool timestamps_enabled() const {
+    return timestamps_;
+  }
+
   RhiResult new_command_list(CommandList **out_cmdlist) noexcept final;
   StreamSemaphore submit(
       CommandList *cmdlist,
@@ -576,25 +623,91 @@ class VulkanStream : public Stream {
       CommandList *cmdlist,
       const std::vector<StreamSemaphore> &wait_semaphores = {}) override;
 
+  // Makes the next submission to this stream wait for |waits| and signal
+  // |signals|, e.g. the semaphores of an engine sharing the queue. The values
+  // are only used if |timeline| is set, in which case the semaphores may be
+  // timeline semaphores.
+  void add_external_semaphores(
+      const std::vector<std::pair<VkSemaphore, uint64_t>> &waits,
+      const std::vector<std::pair<VkSemaphore, uint64_t>> &signals,
+      bool timeline);
+
   void command_sync() override;
+  // Waits for the command lists submitted to this stream only, unlike
+  // command_sync() which waits for everything on its queue.
+  void wait_for_submissions();
+
+  // Submissions to this stream are numbered from 1 in submission order, and
+  // signal |timeline_| to their ids if timeline semaphores are supported.
+  uint64_t last_submission_id() const override {
+    return num_retired_submissions_ + submitted_cmdbuffers_.size();
+  }
+  bool is_submission_complete(uint64_t id) override;
+  void wait_for_submission(uint64_t id) override;
 
   double device_time_elapsed_us() const override;
 
+  std::vector<ProfilerRecord> pop_profiler_records() override;
+
  private:
   struct TrackedCmdbuf {
     vkapi::IVkFence fence;
     vkapi::IVkCommandBuffer buf;
     vkapi::IVkQueryPool query_pool;
+    std::shared_ptr<VulkanCommandList::ProfilerScopes> profiler_scopes;
   };
 
+  void resolve_profiler_scopes(const TrackedCmdbuf &cmdbuf,
+                               float timestamp_period);
+  // Collects the timings of |submitted_cmdbuffers_| up to the submission
+  // |id|, which must have completed, and releases them.
+  void retire_submissions(uint64_t id);
+
   VulkanDevice &device_;
   VkQueue queue_;
   uint32_t queue_family_index_;
+  bool timestamps_;
 
   // Command pools are per-thread
   vkapi::IVkCommandPool command_pool_;
+  // Null if timeline semaphores are not supported, in which case the
+  // submissions are waited for through their fences.
+  vkapi::IVkSemaphore timeline_{nullptr};
   std::vector<TrackedCmdbuf> submitted_cmdbuffers_;
+  // See add_external_semaphores().
+  std::vector<std::pair<VkSemaphore, uint64_t>> external_waits_;
+  std::vector<std::pair<VkSemaphore, uint64_t>> external_signals_;
+  bool external_timeline_{false};
   double device_time_elapsed_us_;
+  // The number of |submitted_cmdbuffers_| whose profiler scopes are already
+  // in |profiler_records_|.
+  size_t num_resolved_cmdbuffers_{0};
+  // The number of submissions completed and removed from
+  // |submitted_cmdbuffers_|.
+  uint64_t num_retired_submissions_{0};
+  std::vector<ProfilerRecord> profiler_records_;
+};
+
+// A bottom-level acceleration structure over the mesh, and a top-level one
+// with a single instance of it that shaders trace rays against.
+class VulkanAccelerationStructure : public AccelerationStructure {
+ public:
+  AccelerationStructureParams params;
+  // The mesh, kept alive while the structure may be built from it.
+  vkapi::IVkBuffer vertex_buffer{nullptr};
+  vkapi::IVkBuffer index_buffer{nullptr};
+  VkDeviceAddress vertex_address{0};
+  VkDeviceAddress index_address{0};
+
+  vkapi::IVkAccelerationStructureKHR blas{nullptr};
+  vkapi::IVkAccelerationStructureKHR tlas{nullptr};
+  vkapi::IVkBuffer instance_buffer{nullptr};
+  VkDeviceAddress instance_address{0};
+  // Shared by the two builds, which are separated by a barrier.
+  vkapi::IVkBuffer scratch_buffer{nullptr};
+  VkDeviceAddress scratch_address{0};
+
+  bool built{false};
 };
 
 struct VulkanCapabilities {
@@ -605,6 +718,7 @@ struct VulkanCapabilities {
   bool surface{false};
   bool present{false};
   bool dynamic_rendering{false};
+  bool timeline_semaphore{false};
 };
 
 class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
@@ -618,6 +732,9 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
     uint32_t compute_queue_family_index{0};
     VkQueue graphics_queue{VK_NULL_HANDLE};
     uint32_t graphics_queue_family_index{0};
+    // Optional. Transfers go to the compute queue if not set.
+    VkQueue transfer_queue{VK_NULL_HANDLE};
+    uint32_t transfer_queue_family_index{0};
   };
 
   VulkanDevice();
@@ -632,17 +749,33 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
       PipelineCache **out_cache,
       size_t initial_size = 0,
       const void *initial_data = nullptr) noexcept final;
+  std::string get_pipeline_cache_key() const noexcept final;
 
   RhiResult create_pipeline(Pipeline **out_pipeline,
                             const PipelineSourceDesc &src,
                             std::string name,
                             PipelineCache *cache) noexcept final;
 
+  // Small allocations are suballocated from buffers shared by the
+  // allocations with the same usage and host access, see |BufferPool|.
   DeviceAllocation allocate_memory(const AllocParams &params) override;
+  // Always creates a VkBuffer for the allocation alone, e.g. for memory that
+  // is exported to other APIs which can not express an offset in the buffer.
+  DeviceAllocation allocate_dedicated_memory(const AllocParams &params);
   void dealloc_memory(DeviceAllocation handle) override;
 
   uint64_t get_memory_physical_pointer(DeviceAllocation handle) override;
 
+  RhiResult create_acceleration_structure(
+      AccelerationStructure **out_accel,
+      const AccelerationStructureParams &params) noexcept final;
+  void fill_triangle_geometry(
+      const VulkanAccelerationStructure &accel,
+      VkAccelerationStructureGeometryKHR *geometry) const;
+  void fill_instance_geometry(
+      const VulkanAccelerationStructure &accel,
+      VkAccelerationStructureGeometryKHR *geometry) const;
+
   ShaderResourceSet *create_resource_set() final;
 
   RasterResources *create_raster_resources() final;
@@ -658,6 +791,7 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
 
   Stream *get_compute_stream() override;
   Stream *get_graphics_stream() override;
+  Stream *get_transfer_stream() override;
 
   void wait_idle() override;
 
@@ -702,6 +836,10 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
     return compute_queue_;
   }
 
+  bool has_transfer_queue() const {
+    return transfer_queue_ != VK_NULL_HANDLE;
+  }
+
   std::tuple<VkDeviceMemory, size_t, size_t> get_vkmemory_offset_size(
       const DeviceAllocation &alloc) const;
 
@@ -709,6 +847,16 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
 
   size_t get_vkbuffer_size(const DeviceAllocation &alloc) const;
 
+  // The offset of |alloc| in its VkBuffer, which is non-zero for some of the
+  // suballocated allocations. Offsets in DevicePtrs are relative to this.
+  size_t get_vkbuffer_offset(const DeviceAllocation &alloc) const;
+
+  // The range of |size| bytes from |offset| in |alloc| to pass to Vulkan,
+  // where VK_WHOLE_SIZE is kept only for dedicated buffers.
+  VkDeviceSize get_vkbuffer_range(const DeviceAllocation &alloc,
+                                  size_t offset,
+                                  size_t size) const;
+
   std::tuple<vkapi::IVkImage, vkapi::IVkImageView, VkFormat> get_vk_image(
       const DeviceAllocation &alloc) const;
 
@@ -734,6 +882,13 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
   rhi_impl::RhiReturn<vkapi::IVkDescriptorSet> alloc_desc_set(
       vkapi::IVkDescriptorSetLayout layout);
 
+  // Descriptor sets that have been written with the bindings of |set|, so
+  // that they can be reused instead of being allocated and written again.
+  // Cached descriptor sets are never written to afterwards.
+  vkapi::IVkDescriptorSet get_cached_desc_set(const VulkanResourceSet &set);
+  void cache_desc_set(const VulkanResourceSet &set,
+                      vkapi::IVkDescriptorSet desc_set);
+
   constexpr VulkanCapabilities &vk_caps() {
     return vk_caps_;
   }
@@ -749,6 +904,15 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
   friend VulkanSurface;
 
   void create_vma_allocator();
+  // Buffer device addresses are needed by physical storage buffers and by the
+  // builds of acceleration structures.
+  bool has_buffer_device_address() const;
+  // A buffer that is not visible to the RHI, e.g. the storage of an
+  // acceleration structure.
+  vkapi::IVkBuffer create_internal_buffer(VkDeviceSize size,
+                                          VkBufferUsageFlags usage,
+                                          bool host_write,
+                                          VkDeviceAddress *address);
   [[nodiscard]] RhiResult new_descriptor_pool();
 
   VulkanCapabilities vk_caps_;
@@ -766,9 +930,16 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
   VkQueue graphics_queue_{VK_NULL_HANDLE};
   uint32_t graphics_queue_family_index_{0};
 
+  VkQueue transfer_queue_{VK_NULL_HANDLE};
+  uint32_t transfer_queue_family_index_{0};
+
+  // The distinct queue families that buffers are shared between.
+  std::vector<uint32_t> buffer_queue_family_indices_;
+
   struct ThreadLocalStreams;
   std::unique_ptr<ThreadLocalStreams> compute_streams_{nullptr};
   std::unique_ptr<ThreadLocalStreams> graphics_streams_{nullptr};
+  std::unique_ptr<ThreadLocalStreams> transfer_streams_{nullptr};
 
   // Memory allocation
   struct AllocationInternal {
@@ -782,8 +953,42 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
     void *mapped{nullptr};
     // Is the allocation external (imported) or not (VMA)
     bool external{false};
+    // Whether |buffer| is shared with other allocations of a BufferPool, and
+    // the offset of this allocation in it
+    bool suballocated{false};
+    VkDeviceSize buffer_offset{0};
+  };
+
+  // Allocations of up to |kMaxSuballocSize| bytes are rounded up to a power
+  // of two and suballocated from blocks of |kBufferBlockSize| bytes. Freed
+  // ranges are kept on a free list per size class for reuse. A range is freed
+  // once the VkBuffer reference of its allocation is released, so that it is
+  // not reused while command lists in flight still refer to it.
+  static constexpr VkDeviceSize kMinSuballocSize = 256;
+  static constexpr VkDeviceSize kMaxSuballocSize = 256 << 10;
+  static constexpr VkDeviceSize kBufferBlockSize = 4 << 20;
+  static constexpr int kNumSuballocSizeClasses = 11;
+
+  struct BufferBlock {
+    vkapi::IVkBuffer buffer{nullptr};
+    VmaAllocationInfo alloc_info{};
+    VkDeviceAddress addr{0};
   };
 
+  struct BufferPool {
+    std::mutex mut;
+    std::shared_ptr<BufferBlock> current_block{nullptr};
+    VkDeviceSize current_block_used{0};
+    std::vector<std::pair<std::shared_ptr<BufferBlock>, VkDeviceSize>>
+        free_ranges[kNumSuballocSizeClasses];
+  };
+
+  // Keyed by the usage and host access of the allocations.
+  std::unordered_map<uint32_t, std::shared_ptr<BufferPool>> buffer_pools_;
+  std::mutex buffer_pools_mut_;
+
+  DeviceAllocation suballocate_memory(const AllocParams &params);
+
   // Images / Image views
   struct ImageAllocInternal {
     bool external{false};
@@ -814,7 +1019,19 @@ class TI_DLL_EXPORT VulkanDevice : public GraphicsDevice {
                 VulkanResourceSet::SetLayoutHasher,
                 VulkanResourceSet::SetLayoutCmp>
       desc_set_layouts_;
+  // Pipelines can be created on other threads, e.g. by AOT module loaders.
+  std::mutex desc_set_layouts_mut_;
   vkapi::IVkDescriptorPool desc_pool_{nullptr};
+  unordered_map<VulkanResourceSet,
+                vkapi::IVkDescriptorSet,
+                VulkanResourceSet::DescSetHasher,
+                VulkanResourceSet::SetCmp>
+      desc_set_cache_;
+
+  // Drops the cached descriptor sets that bind any resource |pred| returns
+  // true for, as they keep the resource alive.
+  void evict_cached_desc_sets(
+      const std::function<bool(const VulkanResourceSet::Binding &)> &pred);
 
   // Internal implementaion functions
   inline static AllocationInternal &get_alloc_internal(
@@ -148,6 +148,15 @@ VulkanQueueFamilyIndices find_queue_families(VkPhysicalDevice device,
   constexpr VkQueueFlags kFlagMask =
       (~(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT));
 
+  for (int i = 0; i < (int)queue_family_count; ++i) {
+    const VkQueueFlags flags = queue_families[i].queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_COMPUTE_BIT | VK_QUEUE_GRAPHICS_BIT))) {
+      indices.transfer_family = i;
+      break;
+    }
+  }
+
   // first try and find a queue that has just the compute bit set
   for (int i = 0; i < (int)queue_family_count; ++i) {
     const VkQueueFlags masked_flags = kFlagMask & queue_families[i].queueFlags;
@@ -265,6 +274,11 @@ VulkanDeviceCreator::VulkanDeviceCreator(
     params.graphics_queue = graphics_queue_;
     params.graphics_queue_family_index =
         queue_family_indices_.graphics_family.value();
+    if (queue_family_indices_.transfer_family.has_value()) {
+      params.transfer_queue = transfer_queue_;
+      params.transfer_queue_family_index =
+          queue_family_indices_.transfer_family.value();
+    }
     ti_device_->init_vulkan_structs(params);
   }
 }
@@ -478,6 +492,9 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
   if (queue_family_indices_.graphics_family.has_value()) {
     unique_families.insert(queue_family_indices_.graphics_family.value());
   }
+  if (queue_family_indices_.transfer_family.has_value()) {
+    unique_families.insert(queue_family_indices_.transfer_family.value());
+  }
 
   float queue_priority = 1.0f;
   for (uint32_t queue_family : unique_families) {
@@ -526,6 +543,25 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
     caps.set(DeviceCapability::spirv_version, 0x10000);
   }
 
+  // Integrated GPUs (and Apple GPUs behind MoltenVK) share the system memory,
+  // which they expose as a device-local, host-visible memory type.
+  if (physical_device_properties.deviceType ==
+      VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) {
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    vkGetPhysicalDeviceMemoryProperties(physical_device_, &memory_properties);
+    const VkMemoryPropertyFlags unified_flags =
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+      if ((memory_properties.memoryTypes[i].propertyFlags & unified_flags) ==
+          unified_flags) {
+        caps.set(DeviceCapability::unified_memory, true);
+        break;
+      }
+    }
+  }
+
   // Detect extensions
   std::vector<const char *> enabled_extensions;
 
@@ -567,6 +603,8 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
       enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) {
       enabled_extensions.push_back(ext.extensionName);
+    } else if (name == VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) {
+      enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_SPIRV_1_4_EXTENSION_NAME) {
       if (caps.get(DeviceCapability::spirv_version) < 0x10400) {
         caps.set(DeviceCapability::spirv_version, 0x10400);
@@ -580,6 +618,8 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
       enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME) {
       enabled_extensions.push_back(ext.extensionName);
+    } else if (name == VK_KHR_16BIT_STORAGE_EXTENSION_NAME) {
+      enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME) {
       enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME) {
@@ -590,6 +630,10 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
       enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) {
       enabled_extensions.push_back(ext.extensionName);
+    } else if (name == VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME ||
+               name == VK_KHR_RAY_QUERY_EXTENSION_NAME ||
+               name == VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME) {
+      enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME &&
                params_.enable_validation_layer) {
       // VK_KHR_shader_non_semantic_info isn't supported on molten-vk.
@@ -687,6 +731,9 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
   VkPhysicalDeviceFloat16Int8FeaturesKHR shader_f16_i8_feature{};
   shader_f16_i8_feature.sType =
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FLOAT16_INT8_FEATURES_KHR;
+  VkPhysicalDevice16BitStorageFeaturesKHR storage_16bit_feature{};
+  storage_16bit_feature.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES_KHR;
   VkPhysicalDeviceBufferDeviceAddressFeaturesKHR
       buffer_device_address_feature{};
   buffer_device_address_feature.sType =
@@ -694,6 +741,15 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
   VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_feature{};
   dynamic_rendering_feature.sType =
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  VkPhysicalDeviceAccelerationStructureFeaturesKHR accel_struct_feature{};
+  accel_struct_feature.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+  VkPhysicalDeviceRayQueryFeaturesKHR ray_query_feature{};
+  ray_query_feature.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_feature{};
+  timeline_semaphore_feature.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
 
   if (ti_device_->vk_caps().physical_device_features2) {
     VkPhysicalDeviceFeatures2KHR features2{};
@@ -781,6 +837,20 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
       pNextEnd = &shader_f16_i8_feature.pNext;
     }
 
+    // 16-bit storage
+    if (CHECK_VERSION(1, 1) ||
+        CHECK_EXTENSION(VK_KHR_16BIT_STORAGE_EXTENSION_NAME)) {
+      features2.pNext = &storage_16bit_feature;
+      vkGetPhysicalDeviceFeatures2KHR(physical_device_, &features2);
+
+      if (storage_16bit_feature.storageBuffer16BitAccess) {
+        caps.set(DeviceCapability::spirv_has_storage_buffer_16bit_access,
+                 true);
+      }
+      *pNextEnd = &storage_16bit_feature;
+      pNextEnd = &storage_16bit_feature.pNext;
+    }
+
     // Buffer Device Address
     if (CHECK_VERSION(1, 2) ||
         CHECK_EXTENSION(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME)) {
@@ -802,6 +872,40 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
       pNextEnd = &buffer_device_address_feature.pNext;
     }
 
+    // Ray query
+    if (CHECK_EXTENSION(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME) &&
+        CHECK_EXTENSION(VK_KHR_RAY_QUERY_EXTENSION_NAME) &&
+        CHECK_EXTENSION(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME)) {
+      features2.pNext = &accel_struct_feature;
+      accel_struct_feature.pNext = &ray_query_feature;
+      vkGetPhysicalDeviceFeatures2KHR(physical_device_, &features2);
+      accel_struct_feature.pNext = nullptr;
+
+      // The builds read the geometry and write the structures through buffer
+      // device addresses.
+      if (accel_struct_feature.accelerationStructure &&
+          ray_query_feature.rayQuery &&
+          buffer_device_address_feature.bufferDeviceAddress) {
+        caps.set(DeviceCapability::spirv_has_ray_query, true);
+        *pNextEnd = &accel_struct_feature;
+        pNextEnd = &accel_struct_feature.pNext;
+        *pNextEnd = &ray_query_feature;
+        pNextEnd = &ray_query_feature.pNext;
+      }
+    }
+
+    // Timeline semaphore
+    if (CHECK_EXTENSION(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+      features2.pNext = &timeline_semaphore_feature;
+      vkGetPhysicalDeviceFeatures2KHR(physical_device_, &features2);
+
+      if (timeline_semaphore_feature.timelineSemaphore) {
+        ti_device_->vk_caps().timeline_semaphore = true;
+        *pNextEnd = &timeline_semaphore_feature;
+        pNextEnd = &timeline_semaphore_feature.pNext;
+      }
+    }
+
     // Dynamic rendering
     // TODO: Figure out how to integrate this correctly with ImGui,
     //       and then figure out the layout & barrier stuff
@@ -841,6 +945,10 @@ void VulkanDeviceCreator::create_logical_device(bool manual_create) {
     vkGetDeviceQueue(device_, queue_family_indices_.graphics_family.value(), 0,
                      &graphics_queue_);
   }
+  if (queue_family_indices_.transfer_family.has_value()) {
+    vkGetDeviceQueue(device_, queue_family_indices_.transfer_family.value(), 0,
+                     &transfer_queue_);
+  }
 
   // Dump capabilities
   caps.dbg_print_all();
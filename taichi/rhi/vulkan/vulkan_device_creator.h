@@ -23,10 +23,11 @@ struct VulkanQueueFamilyIndices {
   std::optional<uint32_t> compute_family;
   std::optional<uint32_t> graphics_family;
   std::optional<uint32_t> present_family;
-  // TODO: While it is the case that all COMPUTE/GRAPHICS queue also support
-  // TRANSFER by default, maye there are some performance benefits to find a
-  // TRANSFER-dedicated queue family.
+  // A TRANSFER-dedicated queue family, if any. All COMPUTE/GRAPHICS queues
+  // also support TRANSFER, but copies on a dedicated queue (usually backed by
+  // DMA engines) can overlap with compute work.
   // https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer#page_Transfer-queue
+  std::optional<uint32_t> transfer_family;
 
   bool is_complete() const {
     return compute_family.has_value();
@@ -88,6 +89,7 @@ class TI_DLL_EXPORT VulkanDeviceCreator {
 
   VkQueue compute_queue_{VK_NULL_HANDLE};
   VkQueue graphics_queue_{VK_NULL_HANDLE};
+  VkQueue transfer_queue_{VK_NULL_HANDLE};
 
   VkSurfaceKHR surface_{VK_NULL_HANDLE};
 
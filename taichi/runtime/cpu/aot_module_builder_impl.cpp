@@ -9,6 +9,9 @@ namespace taichi::lang {
 namespace cpu {
 
 LLVMCompiledKernel AotModuleBuilderImpl::compile_kernel(Kernel *kernel) {
+  // The kernels would call the runtime functions of this process.
+  TI_ERROR_IF(get_compile_config()->cpu_shared_runtime,
+              "AOT modules cannot be built with cpu_shared_runtime=True");
   auto cgen = KernelCodeGenCPU(get_compile_config(), kernel);
   return cgen.compile_kernel_to_module();
 }
@@ -5,6 +5,7 @@
 #ifdef TI_WITH_LLVM
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/BinaryFormat/Magic.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
@@ -28,15 +29,19 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Object/Archive.h"
+#include "llvm/Object/ArchiveWriter.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
 
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/Host.h"
@@ -105,6 +110,8 @@ class JITSessionCPU : public JITSession {
   std::vector<llvm::orc::JITDylib *> all_libs_;
   int module_counter_;
   SectionMemoryManager *memory_manager_;
+  JITTargetMachineBuilder jtmb_;
+  JITDylib *shared_dylib_{nullptr};
 
  public:
   JITSessionCPU(TaichiLLVMContext *tlctx,
@@ -130,7 +137,8 @@ class JITSessionCPU : public JITSession {
         dl_(DL),
         mangle_(es_, this->dl_),
         module_counter_(0),
-        memory_manager_(nullptr) {
+        memory_manager_(nullptr),
+        jtmb_(JTMB) {
     if (JTMB.getTargetTriple().isOSBinFormatCOFF()) {
       object_layer_.setOverrideObjectFlagsWithResponsibilityFlags(true);
       object_layer_.setAutoClaimResponsibilityForObjectSymbols(true);
@@ -158,23 +166,101 @@ class JITSessionCPU : public JITSession {
     TI_ASSERT(M);
     global_optimize_module_cpu(M.get());
     std::lock_guard<std::mutex> _(mut_);
-    auto dylib_expect = es_.createJITDylib(fmt::format("{}", module_counter_));
-    TI_ASSERT(dylib_expect);
-    auto &dylib = dylib_expect.get();
-    dylib.addGenerator(
-        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            dl_.getGlobalPrefix())));
+    auto &dylib = create_dylib();
     auto *thread_safe_context =
         this->tlctx_->get_this_thread_thread_safe_context();
     cantFail(compile_layer_.add(
         dylib,
         llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
-    all_libs_.push_back(&dylib);
-    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
-    auto new_module_raw_ptr = new_module.get();
-    modules.push_back(std::move(new_module));
+    return add_jit_module(dylib);
+  }
+
+  void add_shared_module(std::unique_ptr<llvm::Module> M) override {
+    TI_ASSERT(M);
+    global_optimize_module_cpu(M.get());
+    std::lock_guard<std::mutex> _(mut_);
+    TI_ASSERT(shared_dylib_ == nullptr);
+    auto &dylib = create_dylib();
+    auto *thread_safe_context =
+        this->tlctx_->get_this_thread_thread_safe_context();
+    cantFail(compile_layer_.add(
+        dylib,
+        llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
+    // Not in |all_libs_|, lookup() finds the runtime functions in the runtime
+    // JIT module.
+    shared_dylib_ = &dylib;
     module_counter_++;
-    return new_module_raw_ptr;
+  }
+
+  // The native code is an object file for the host CPU.
+  std::string get_native_code_key() override {
+    return fmt::format("{}-{}-{}", jtmb_.getTargetTriple().str(),
+                       jtmb_.getCPU(), jtmb_.getFeatures().getString());
+  }
+
+  std::string compile_module_to_native(std::unique_ptr<llvm::Module> M,
+                                       int max_reg) override {
+    TI_ASSERT(max_reg == 0);
+    return compile_module_to_object(std::move(M));
+  }
+
+  std::string compile_module_to_object(
+      std::unique_ptr<llvm::Module> M) override {
+    TI_ASSERT(M);
+    global_optimize_module_cpu(M.get());
+    ConcurrentIRCompiler compiler(jtmb_);
+    auto object = compiler(*M);
+    TI_ERROR_IF(!object, "Failed to compile the module to an object: {}",
+                llvm::toString(object.takeError()));
+    return std::string((*object)->getBufferStart(), (*object)->getBufferSize());
+  }
+
+  // Several objects are packed into an archive, all of whose members are
+  // loaded by add_native_module().
+  std::string link_objects_to_native(const std::vector<std::string> &objects,
+                                     int max_reg) override {
+    TI_ASSERT(max_reg == 0);
+    if (objects.size() == 1) {
+      return objects[0];
+    }
+    std::vector<std::string> names;
+    for (int i = 0; i < (int)objects.size(); i++) {
+      names.push_back(fmt::format("taichi_kernel_{}.o", i));
+    }
+    std::vector<llvm::NewArchiveMember> members;
+    for (int i = 0; i < (int)objects.size(); i++) {
+      members.emplace_back(llvm::MemoryBufferRef(objects[i], names[i]));
+    }
+    auto archive = llvm::writeArchiveToBuffer(
+        members, /*WriteSymtab=*/false, llvm::object::Archive::K_GNU,
+        /*Deterministic=*/true, /*Thin=*/false);
+    TI_ERROR_IF(!archive, "Failed to archive the objects: {}",
+                llvm::toString(archive.takeError()));
+    return std::string((*archive)->getBufferStart(),
+                       (*archive)->getBufferSize());
+  }
+
+  JITModule *add_native_module(const std::string &native_code) override {
+    std::lock_guard<std::mutex> _(mut_);
+    auto &dylib = create_dylib();
+    if (llvm::identify_magic(native_code) != llvm::file_magic::archive) {
+      cantFail(object_layer_.add(
+          dylib, llvm::MemoryBuffer::getMemBufferCopy(native_code)));
+      return add_jit_module(dylib);
+    }
+    auto archive = llvm::object::Archive::create(
+        llvm::MemoryBufferRef(native_code, "taichi_kernel"));
+    TI_ERROR_IF(!archive, "Invalid archive of objects: {}",
+                llvm::toString(archive.takeError()));
+    llvm::Error err = llvm::Error::success();
+    for (auto &child : (*archive)->children(err)) {
+      auto buffer = cantFail(child.getMemoryBufferRef());
+      cantFail(object_layer_.add(
+          dylib, llvm::MemoryBuffer::getMemBufferCopy(buffer.getBuffer())));
+    }
+    TI_ERROR_IF(err, "Invalid archive of objects: {}",
+                llvm::toString(std::move(err)));
+    return add_jit_module(dylib);
   }
 
   void *lookup(const std::string Name) override {
@@ -203,6 +289,32 @@ class JITSessionCPU : public JITSession {
 
  private:
   void global_optimize_module_cpu(llvm::Module *module);
+
+  // Both called with |mut_| held.
+  JITDylib &create_dylib() {
+    auto dylib_expect = es_.createJITDylib(fmt::format("{}", module_counter_));
+    TI_ASSERT(dylib_expect);
+    auto &dylib = dylib_expect.get();
+    if (shared_dylib_ != nullptr) {
+      // The shared dylib resolves the symbols of the process too. A generator
+      // here would run before the lookup in the shared dylib.
+      dylib.addToLinkOrder(*shared_dylib_);
+      return dylib;
+    }
+    dylib.addGenerator(
+        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            dl_.getGlobalPrefix())));
+    return dylib;
+  }
+
+  JITModule *add_jit_module(JITDylib &dylib) {
+    all_libs_.push_back(&dylib);
+    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
+    auto new_module_raw_ptr = new_module.get();
+    modules.push_back(std::move(new_module));
+    module_counter_++;
+    return new_module_raw_ptr;
+  }
 };
 
 void *JITModuleCPU::lookup_function(const std::string &name) {
@@ -216,7 +328,7 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
     TI_ERROR("Module broken");
   }
 
-  auto triple = get_host_target_info().first.getTargetTriple();
+  auto triple = jtmb_.getTargetTriple();
 
   std::string err_str;
   const llvm::Target *target =
@@ -242,14 +354,26 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
   legacy::FunctionPassManager function_pass_manager(module);
   legacy::PassManager module_pass_manager;
 
-  llvm::StringRef mcpu = llvm::sys::getHostCPUName();
+  // Target the ISA extensions of the host, e.g. AVX-512 or SVE, rather than
+  // the baseline of the CPU family.
+  const auto &mcpu = jtmb_.getCPU();
+  const auto features = jtmb_.getFeatures().getString();
   std::unique_ptr<TargetMachine> target_machine(target->createTargetMachine(
-      triple.str(), mcpu.str(), "", options, llvm::Reloc::PIC_,
+      triple.str(), mcpu, features, options, llvm::Reloc::PIC_,
       llvm::CodeModel::Small, CodeGenOpt::Aggressive));
 
   TI_ERROR_UNLESS(target_machine.get(), "Could not allocate target machine!");
 
   module->setDataLayout(target_machine->createDataLayout());
+  const int opt_level = get_module_opt_level(*module);
+  // The runtime functions are compiled for the baseline. Their target
+  // attributes would hold back inlining and vectorization.
+  for (auto &f : *module) {
+    if (!f.isDeclaration()) {
+      f.addFnAttr("target-cpu", mcpu);
+      f.addFnAttr("target-features", features);
+    }
+  }
 
   module_pass_manager.add(createTargetTransformInfoWrapperPass(
       target_machine->getTargetIRAnalysis()));
@@ -257,10 +381,13 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
       target_machine->getTargetIRAnalysis()));
 
   PassManagerBuilder b;
-  b.OptLevel = 3;
-  b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
-  b.LoopVectorize = true;
-  b.SLPVectorize = true;
+  b.OptLevel = opt_level;
+  // Without optimization, only the functions marked as such are inlined.
+  b.Inliner = opt_level > 0
+                  ? createFunctionInliningPass(b.OptLevel, 0, false)
+                  : createAlwaysInlinerLegacyPass();
+  b.LoopVectorize = opt_level > 1;
+  b.SLPVectorize = opt_level > 1;
 
   target_machine->adjustPassManager(b);
 
@@ -284,10 +411,12 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
 
     Note there's an update for "separate-const-offset-gep" in llvm-12.
   */
-  module_pass_manager.add(llvm::createLoopStrengthReducePass());
-  module_pass_manager.add(llvm::createIndVarSimplifyPass());
-  module_pass_manager.add(llvm::createSeparateConstOffsetFromGEPPass(false));
-  module_pass_manager.add(llvm::createEarlyCSEPass(true));
+  if (opt_level > 0) {
+    module_pass_manager.add(llvm::createLoopStrengthReducePass());
+    module_pass_manager.add(llvm::createIndVarSimplifyPass());
+    module_pass_manager.add(llvm::createSeparateConstOffsetFromGEPPass(false));
+    module_pass_manager.add(llvm::createEarlyCSEPass(true));
+  }
 
   {
     TI_PROFILER("llvm_module_pass");
@@ -312,6 +441,8 @@ std::unique_ptr<JITSession> create_llvm_jit_session_cpu(
     Arch arch) {
   TI_ASSERT(arch_is_cpu(arch));
   auto target_info = get_host_target_info();
+  TI_TRACE("Host CPU: {}, features: {}", target_info.first.getCPU(),
+           target_info.first.getFeatures().getString());
   auto EPC = SelfExecutorProcessControl::Create();
   TI_ASSERT(EPC);
   return std::make_unique<JITSessionCPU>(tlctx, std::move(*EPC), config,
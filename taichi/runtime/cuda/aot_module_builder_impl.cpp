@@ -3,14 +3,55 @@
 #include <algorithm>
 
 #include "taichi/codegen/cuda/codegen_cuda.h"
+#include "taichi/runtime/cuda/jit_cuda.h"
 #include "taichi/runtime/llvm/launch_arg_info.h"
+#include "taichi/runtime/program_impls/llvm/llvm_program.h"
 
 namespace taichi::lang {
 namespace cuda {
+namespace {
+
+std::vector<int> parse_compute_capabilities(const std::string &archs) {
+  std::vector<int> ccs;
+  std::size_t begin = 0;
+  while (begin < archs.size()) {
+    std::size_t end = std::min(archs.find(',', begin), archs.size());
+    std::string arch = archs.substr(begin, end - begin);
+    if (arch.rfind("sm_", 0) == 0) {
+      arch = arch.substr(3);
+    }
+    char *parsed_end = nullptr;
+    const long cc = std::strtol(arch.c_str(), &parsed_end, 10);
+    TI_ERROR_IF(arch.empty() || *parsed_end != '\0' || cc < 30,
+                "Invalid compute capability '{}' in cuda_aot_archs='{}'", arch,
+                archs);
+    ccs.push_back((int)cc);
+    begin = end + 1;
+  }
+  return ccs;
+}
+
+}  // namespace
 
 LLVMCompiledKernel AotModuleBuilderImpl::compile_kernel(Kernel *kernel) {
+  const auto &config = *get_compile_config();
   auto cgen = KernelCodeGenCUDA(get_compile_config(), kernel);
-  return cgen.compile_kernel_to_module();
+  auto compiled = cgen.compile_kernel_to_module();
+  const auto ccs = parse_compute_capabilities(config.cuda_aot_archs);
+  if (ccs.empty()) {
+    return compiled;
+  }
+  auto *jit = dynamic_cast<JITSessionCUDA *>(
+      get_program()->get_llvm_context(Arch::cuda)->jit.get());
+  TI_ASSERT(jit != nullptr);
+  // The LLVM IR is still saved for the loaders that JIT the kernels.
+  auto native = compiled.clone();
+  compiled.native_code_key = CUDAFatBinary::kNativeCodeKey;
+  compiled.native_code =
+      jit->compile_module_to_fat_binary(std::move(native.module), ccs,
+                                        config.gpu_max_reg)
+          .serialize();
+  return compiled;
 }
 
 }  // namespace cuda
@@ -4,6 +4,8 @@
 #include "taichi/runtime/llvm/llvm_offline_cache.h"
 #include "taichi/runtime/llvm/llvm_runtime_executor.h"
 #include "taichi/codegen/cuda/codegen_cuda.h"
+#include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/runtime/cuda/jit_cuda.h"
 
 namespace taichi::lang {
 namespace {
@@ -27,6 +29,28 @@ class AotModuleImpl : public LlvmAotModule {
                              std::move(loaded.compiled_data));
   }
 
+  bool load_native_code(const std::string &name,
+                        LlvmOfflineCache::KernelCacheData &loaded) override {
+    if (!cache_reader_->get_native_kernel_cache(
+            loaded, name, CUDAFatBinary::kNativeCodeKey)) {
+      return false;
+    }
+    CUDAFatBinary fatbin;
+    if (!CUDAFatBinary::deserialize(loaded.compiled_data.native_code,
+                                    fatbin)) {
+      TI_WARN("The CUDA fat binary of kernel={} is corrupted", name);
+      return false;
+    }
+    const int cc = CUDAContext::get_instance().get_compute_capability();
+    const std::string *code = fatbin.select(cc);
+    if (code == nullptr) {
+      TI_DEBUG("Kernel={} has no CUDA code for sm_{}", name, cc);
+      return false;
+    }
+    loaded.compiled_data.native_code = *code;
+    return true;
+  }
+
   std::unique_ptr<aot::KernelTemplate> make_new_kernel_template(
       const std::string &name) override {
     TI_NOT_IMPLEMENTED;
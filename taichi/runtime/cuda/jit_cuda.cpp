@@ -3,16 +3,48 @@
 
 namespace taichi::lang {
 
+const std::string *CUDAFatBinary::select(int compute_capability) const {
+  // A CUBIN runs on the GPUs of the same major version and a minor version no
+  // older than its own.
+  const Image *best = nullptr;
+  for (const auto &image : images) {
+    if (image.compute_capability / 10 == compute_capability / 10 &&
+        image.compute_capability <= compute_capability &&
+        (best == nullptr ||
+         image.compute_capability > best->compute_capability)) {
+      best = &image;
+    }
+  }
+  if (best != nullptr) {
+    return &best->cubin;
+  }
+  if (!ptx.empty() && ptx_compute_capability <= compute_capability) {
+    return &ptx;
+  }
+  return nullptr;
+}
+
+std::string CUDAFatBinary::serialize() const {
+  BinaryOutputSerializer writer;
+  writer.initialize();
+  writer(*this);
+  writer.finalize();
+  return std::string(writer.data.begin(), writer.data.begin() + writer.head);
+}
+
+bool CUDAFatBinary::deserialize(const std::string &data,
+                                CUDAFatBinary &fatbin) {
+  if (data.size() < sizeof(std::size_t)) {
+    return false;
+  }
+  return read_from_binary(fatbin, data.data(), data.size());
+}
+
 #if defined(TI_WITH_CUDA)
 
 JITModule *JITSessionCUDA ::add_module(std::unique_ptr<llvm::Module> M,
                                        int max_reg) {
   auto ptx = compile_module_to_ptx(M);
-  if (this->config_->print_kernel_nvptx) {
-    static FileSequenceWriter writer("taichi_kernel_nvptx_{:04d}.ptx",
-                                     "module NVPTX");
-    writer.write(ptx);
-  }
   // TODO: figure out why using the guard leads to wrong tests results
   // auto context_guard = CUDAContext::get_instance().get_guard();
   CUDAContext::get_instance().make_current();
@@ -45,6 +77,104 @@ JITModule *JITSessionCUDA ::add_module(std::unique_ptr<llvm::Module> M,
   return modules.back().get();
 }
 
+std::string JITSessionCUDA::get_native_code_key() {
+  int driver_version = 0;
+  CUDADriver::get_instance().driver_get_version(&driver_version);
+  return fmt::format("{}-driver{}-maxreg{}",
+                     CUDAContext::get_instance().get_mcpu(), driver_version,
+                     config_->gpu_max_reg);
+}
+
+std::string JITSessionCUDA::compile_module_to_native(
+    std::unique_ptr<llvm::Module> M,
+    int max_reg) {
+  return link_objects_to_native({compile_module_to_ptx(M)}, max_reg);
+}
+
+std::string JITSessionCUDA::compile_module_to_object(
+    std::unique_ptr<llvm::Module> M) {
+  return compile_module_to_ptx(M);
+}
+
+std::string JITSessionCUDA::link_objects_to_native(
+    const std::vector<std::string> &objects,
+    int max_reg) {
+  return link_ptx_to_cubin(objects, max_reg);
+}
+
+CUDAFatBinary JITSessionCUDA::compile_module_to_fat_binary(
+    std::unique_ptr<llvm::Module> M,
+    const std::vector<int> &compute_capabilities,
+    int max_reg) {
+  TI_ASSERT(!compute_capabilities.empty());
+  CUDAFatBinary fatbin;
+  fatbin.ptx_compute_capability = *std::min_element(
+      compute_capabilities.begin(), compute_capabilities.end());
+  fatbin.ptx = compile_module_to_ptx(M, fatbin.ptx_compute_capability);
+  for (int cc : compute_capabilities) {
+    fatbin.images.push_back({cc, link_ptx_to_cubin({fatbin.ptx}, max_reg, cc)});
+  }
+  return fatbin;
+}
+
+std::string JITSessionCUDA::link_ptx_to_cubin(
+    const std::vector<std::string> &objects,
+    int max_reg,
+    int compute_capability) {
+  CUDAContext::get_instance().make_current();
+  auto t = Time::get_time();
+  [[maybe_unused]] auto _ = CUDAContext::get_instance().get_lock_guard();
+
+  constexpr int max_num_options = 8;
+  int num_options = 0;
+  uint32 options[max_num_options];
+  void *option_values[max_num_options];
+  if (max_reg != 0) {
+    options[num_options] = CU_JIT_MAX_REGISTERS;
+    option_values[num_options] = (void *)(std::intptr_t)max_reg;
+    num_options++;
+  }
+  if (compute_capability != 0) {
+    options[num_options] = CU_JIT_TARGET;
+    option_values[num_options] = (void *)(std::intptr_t)compute_capability;
+    num_options++;
+  }
+  TI_ASSERT(num_options <= max_num_options);
+
+  // Assembles the PTX to a CUBIN for the current device unless a target is
+  // given, which is what module_load_data_ex() does implicitly.
+  auto &driver = CUDADriver::get_instance();
+  void *link_state = nullptr;
+  driver.link_create(num_options, options, option_values, &link_state);
+  for (int i = 0; i < (int)objects.size(); i++) {
+    const auto name = fmt::format("taichi_kernel_{}", i);
+    driver.link_add_data(link_state, CU_JIT_INPUT_PTX,
+                         (void *)objects[i].c_str(), objects[i].size(),
+                         name.c_str(), 0, nullptr, nullptr);
+  }
+  void *cubin = nullptr;
+  std::size_t cubin_size = 0;
+  driver.link_complete(link_state, &cubin, &cubin_size);
+  // The CUBIN is owned by the link state.
+  std::string ret((const char *)cubin, cubin_size);
+  driver.link_destroy(link_state);
+  TI_TRACE("CUBIN size: {:.2f}KB, linked from {} PTX in {}ms",
+           cubin_size / 1024.0, objects.size(), (Time::get_time() - t) * 1000);
+  return ret;
+}
+
+JITModule *JITSessionCUDA::add_native_module(const std::string &native_code) {
+  CUDAContext::get_instance().make_current();
+  void *cuda_module = nullptr;
+  auto t = Time::get_time();
+  [[maybe_unused]] auto _ = CUDAContext::get_instance().get_lock_guard();
+  CUDADriver::get_instance().module_load_data_ex(
+      &cuda_module, native_code.data(), 0, nullptr, nullptr);
+  TI_TRACE("CUDA CUBIN load time : {}ms", (Time::get_time() - t) * 1000);
+  modules.push_back(std::make_unique<JITModuleCUDA>(cuda_module));
+  return modules.back().get();
+}
+
 std::string cuda_mattrs() {
   return "+ptx63";
 }
@@ -72,7 +202,8 @@ std::string convert(std::string new_name) {
 }
 
 std::string JITSessionCUDA::compile_module_to_ptx(
-    std::unique_ptr<llvm::Module> &module) {
+    std::unique_ptr<llvm::Module> &module,
+    int compute_capability) {
   TI_AUTO_PROF
   // Part of this function is borrowed from Halide::CodeGen_PTX_Dev.cpp
   if (llvm::verifyModule(*module, &llvm::errs())) {
@@ -121,10 +252,14 @@ std::string JITSessionCUDA::compile_module_to_ptx(
   options.NoZerosInBSS = 0;
   options.GuaranteedTailCallOpt = 0;
 
+  const int opt_level = get_module_opt_level(*module);
+  const std::string mcpu = compute_capability == 0
+                               ? CUDAContext::get_instance().get_mcpu()
+                               : fmt::format("sm_{}", compute_capability);
   std::unique_ptr<TargetMachine> target_machine(target->createTargetMachine(
-      triple.str(), CUDAContext::get_instance().get_mcpu(), cuda_mattrs(),
+      triple.str(), mcpu, cuda_mattrs(),
       options, llvm::Reloc::PIC_, llvm::CodeModel::Small,
-      CodeGenOpt::Aggressive));
+      opt_level > 0 ? CodeGenOpt::Aggressive : CodeGenOpt::None));
 
   TI_ERROR_UNLESS(target_machine.get(), "Could not allocate target machine!");
 
@@ -177,8 +312,11 @@ std::string JITSessionCUDA::compile_module_to_ptx(
   }
 
   PassManagerBuilder b;
-  b.OptLevel = 3;
-  b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+  b.OptLevel = opt_level;
+  // Without optimization, only the functions marked as such are inlined.
+  b.Inliner = opt_level > 0
+                  ? createFunctionInliningPass(b.OptLevel, 0, false)
+                  : createAlwaysInlinerLegacyPass();
   b.LoopVectorize = false;
   b.SLPVectorize = false;
 
@@ -198,10 +336,12 @@ std::string JITSessionCUDA::compile_module_to_ptx(
 
     Note there's an update for "separate-const-offset-gep" in llvm-12.
   */
-  module_pass_manager.add(llvm::createLoopStrengthReducePass());
-  module_pass_manager.add(llvm::createIndVarSimplifyPass());
-  module_pass_manager.add(llvm::createSeparateConstOffsetFromGEPPass(false));
-  module_pass_manager.add(llvm::createEarlyCSEPass(true));
+  if (opt_level > 0) {
+    module_pass_manager.add(llvm::createLoopStrengthReducePass());
+    module_pass_manager.add(llvm::createIndVarSimplifyPass());
+    module_pass_manager.add(llvm::createSeparateConstOffsetFromGEPPass(false));
+    module_pass_manager.add(llvm::createEarlyCSEPass(true));
+  }
 
   // Ask the target to add backend passes as necessary.
   bool fail = target_machine->addPassesToEmitFile(
@@ -231,6 +371,11 @@ std::string JITSessionCUDA::compile_module_to_ptx(
   }
 
   std::string buffer(outstr.begin(), outstr.end());
+  if (this->config_->print_kernel_nvptx) {
+    static FileSequenceWriter writer("taichi_kernel_nvptx_{:04d}.ptx",
+                                     "module NVPTX");
+    writer.write(buffer);
+  }
 
   // Null-terminate the ptx source
   buffer.push_back(0);
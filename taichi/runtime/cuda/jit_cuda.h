@@ -13,6 +13,7 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/MC/TargetRegistry.h"
@@ -33,6 +34,33 @@
 
 namespace taichi::lang {
 
+// The CUBINs of a CUDA kernel for a few GPU architectures, and its PTX for the
+// oldest of them that the driver can compile for any newer GPU. This is the
+// native code of the kernels in CUDA AOT modules.
+struct CUDAFatBinary {
+  static constexpr const char *kNativeCodeKey = "cuda-fatbin";
+
+  struct Image {
+    // e.g. 86 for sm_86.
+    int compute_capability{0};
+    std::string cubin;
+
+    TI_IO_DEF(compute_capability, cubin);
+  };
+  std::vector<Image> images;
+  int ptx_compute_capability{0};
+  std::string ptx;
+
+  TI_IO_DEF(images, ptx_compute_capability, ptx);
+
+  // Returns the CUBIN or the PTX to load on a GPU of |compute_capability|, or
+  // nullptr if there is none.
+  const std::string *select(int compute_capability) const;
+
+  std::string serialize() const;
+  static bool deserialize(const std::string &data, CUDAFatBinary &fatbin);
+};
+
 #if defined(TI_WITH_CUDA)
 class JITModuleCUDA : public JITModule {
  private:
@@ -94,12 +122,40 @@ class JITSessionCUDA : public JITSession {
 
   JITModule *add_module(std::unique_ptr<llvm::Module> M, int max_reg) override;
 
+  // The native code is a CUBIN of the current device.
+  std::string get_native_code_key() override;
+
+  std::string compile_module_to_native(std::unique_ptr<llvm::Module> M,
+                                       int max_reg) override;
+
+  JITModule *add_native_module(const std::string &native_code) override;
+
+  // The objects are PTX, assembled and linked to a CUBIN by the driver.
+  std::string compile_module_to_object(
+      std::unique_ptr<llvm::Module> M) override;
+
+  std::string link_objects_to_native(const std::vector<std::string> &objects,
+                                     int max_reg) override;
+
+  // Generates the PTX for the oldest of |compute_capabilities|, and assembles
+  // it to a CUBIN for each of them. They don't have to be the current GPU.
+  CUDAFatBinary compile_module_to_fat_binary(
+      std::unique_ptr<llvm::Module> M,
+      const std::vector<int> &compute_capabilities,
+      int max_reg);
+
   llvm::DataLayout get_data_layout() override {
     return data_layout;
   }
 
  private:
-  std::string compile_module_to_ptx(std::unique_ptr<llvm::Module> &module);
+  // Targets the current GPU if |compute_capability| is 0.
+  std::string compile_module_to_ptx(std::unique_ptr<llvm::Module> &module,
+                                    int compute_capability = 0);
+
+  std::string link_ptx_to_cubin(const std::vector<std::string> &ptx,
+                                int max_reg,
+                                int compute_capability = 0);
 };
 
 #endif
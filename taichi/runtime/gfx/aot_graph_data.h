@@ -9,6 +9,13 @@ class KernelImpl : public aot::Kernel {
       : runtime_(runtime), params_(std::move(params)) {
     handle_ = runtime_->register_taichi_kernel(params_);
   }
+  // Registers |compiled| that has been built off the runtime from |params|.
+  KernelImpl(GfxRuntime *runtime,
+             GfxRuntime::RegisterParams &&params,
+             std::unique_ptr<CompiledTaichiKernel> compiled)
+      : runtime_(runtime), params_(std::move(params)) {
+    handle_ = runtime_->register_taichi_kernel(std::move(compiled));
+  }
 
   void launch(RuntimeContext *ctx) override {
     runtime_->launch_kernel(handle_, ctx);
@@ -18,6 +25,10 @@ class KernelImpl : public aot::Kernel {
     return params_;
   }
 
+  GfxRuntime::KernelHandle handle() const {
+    return handle_;
+  }
+
  private:
   GfxRuntime *const runtime_;
   GfxRuntime::KernelHandle handle_;
@@ -111,6 +111,10 @@ AotModuleBuilderImpl::AotModuleBuilderImpl(
       config_(compile_config),
       caps_(caps) {
   for (const auto &pair : caps.to_inner()) {
+    // Only affects how the runtime allocates memory, not the shaders.
+    if (pair.first == DeviceCapability::unified_memory) {
+      continue;
+    }
     ti_aot_data_.required_caps[to_string(pair.first)] = pair.second;
   }
   if (!compiled_structs.empty()) {
@@ -199,6 +203,13 @@ AotModuleBuilderImpl::try_get_kernel_register_params(
   return std::nullopt;
 }
 
+void AotModuleBuilderImpl::add_compiled_kernel(
+    const TaichiKernelAttributes &kernel_attribs,
+    const std::vector<std::vector<uint32_t>> &task_spirv_source_codes) {
+  ti_aot_data_.kernels.push_back(kernel_attribs);
+  ti_aot_data_.spirv_codes.push_back(task_spirv_source_codes);
+}
+
 void AotModuleBuilderImpl::add_per_backend(const std::string &identifier,
                                            Kernel *kernel) {
   spirv::lower(config_, kernel);
@@ -251,5 +262,21 @@ void AotModuleBuilderImpl::add_per_backend_tmpl(const std::string &identifier,
   ti_aot_data_.spirv_codes.push_back(compiled.task_spirv_source_codes);
 }
 
+void AotModuleBuilderImpl::add_per_backend_with_spec_constants(
+    const std::string &identifier,
+    Kernel *kernel,
+    const std::vector<std::pair<std::string, int>> &spec_constant_args) {
+  std::vector<spirv::SpecConstantArg> spec_args;
+  for (const auto &[name, arg_id] : spec_constant_args) {
+    spec_args.push_back({name, arg_id});
+  }
+  spirv::lower(config_, kernel);
+  auto compiled = run_codegen(kernel, device_api_backend_, caps_,
+                              compiled_structs_, config_, spec_args);
+  compiled.kernel_attribs.name = identifier;
+  ti_aot_data_.kernels.push_back(compiled.kernel_attribs);
+  ti_aot_data_.spirv_codes.push_back(compiled.task_spirv_source_codes);
+}
+
 }  // namespace gfx
 }  // namespace taichi::lang
@@ -27,6 +27,11 @@ class AotModuleBuilderImpl : public AotModuleBuilder {
   void merge_with_old_meta_data(const std::string &path);
   std::optional<GfxRuntime::RegisterParams> try_get_kernel_register_params(
       const std::string &kernel_name) const;
+  // Adds a kernel compiled elsewhere, e.g. by another machine sharing the
+  // offline cache.
+  void add_compiled_kernel(
+      const TaichiKernelAttributes &kernel_attribs,
+      const std::vector<std::vector<uint32_t>> &task_spirv_source_codes);
 
  private:
   void add_per_backend(const std::string &identifier, Kernel *kernel) override;
@@ -43,6 +48,12 @@ class AotModuleBuilderImpl : public AotModuleBuilder {
                             const std::string &key,
                             Kernel *kernel) override;
 
+  void add_per_backend_with_spec_constants(
+      const std::string &identifier,
+      Kernel *kernel,
+      const std::vector<std::pair<std::string, int>> &spec_constant_args)
+      override;
+
   std::string write_spv_file(const std::string &output_dir,
                              const TaskAttributes &k,
                              const std::vector<uint32_t> &source_code) const;
@@ -1,7 +1,14 @@
 #include "taichi/runtime/gfx/aot_module_loader_impl.h"
 
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <type_traits>
+#include <unordered_set>
 
 #include "taichi/runtime/gfx/runtime.h"
 #include "taichi/aot/graph_data.h"
@@ -20,16 +27,136 @@ class FieldImpl : public aot::Field {
   aot::CompiledFieldData field_;
 };
 
+// Replays the commands recorded for the last few sets of ndarrays a graph has
+// been run with.
+class GraphRunnerImpl : public aot::GraphRunner {
+ public:
+  explicit GraphRunnerImpl(GfxRuntime *runtime) : runtime_(runtime) {
+  }
+
+  bool run(const aot::CompiledGraph &graph,
+           const std::vector<int> &dispatch_ids,
+           const std::vector<RuntimeContext *> &ctxs) override {
+    std::vector<std::pair<GfxRuntime::KernelHandle, RuntimeContext *>>
+        launches;
+    for (int i = 0; i < dispatch_ids.size(); ++i) {
+      auto *kernel = static_cast<KernelImpl *>(
+          graph.dispatches[dispatch_ids[i]].compiled_kernel);
+      if (kernel == nullptr) {
+        return false;
+      }
+      launches.push_back({kernel->handle(), ctxs[i]});
+    }
+
+    for (auto &recorded : recorded_) {
+      if (runtime_->replay_launches(*recorded, launches)) {
+        return true;
+      }
+    }
+    auto recorded = runtime_->record_launches(launches);
+    if (!recorded) {
+      return false;
+    }
+    TI_ASSERT(runtime_->replay_launches(*recorded, launches));
+    // e.g. For graphs that swap ping-pong buffers on every run.
+    constexpr size_t kMaxRecordings = 4;
+    if (recorded_.size() >= kMaxRecordings) {
+      recorded_.erase(recorded_.begin());
+    }
+    recorded_.push_back(std::move(recorded));
+    return true;
+  }
+
+ private:
+  GfxRuntime *const runtime_;
+  std::vector<std::unique_ptr<GfxRuntime::RecordedLaunches>> recorded_;
+};
+
+// Patches the specialization constants of a kernel into its SPIR-V before the
+// pipelines are created. A constant that is not specified is zero.
+class KernelTemplateImpl : public aot::KernelTemplate {
+ public:
+  explicit KernelTemplateImpl(GfxRuntime *runtime,
+                              GfxRuntime::RegisterParams params)
+      : runtime_(runtime), params_(std::move(params)) {
+  }
+
+ protected:
+  std::unique_ptr<aot::Kernel> make_new_kernel(
+      const std::vector<aot::KernelTemplateArg> &template_args) override {
+    const auto &ctx_attribs = params_.kernel_attribs.ctx_attribs;
+    const auto &spec_args = ctx_attribs.spec_constant_args;
+    std::unordered_map<uint32_t, uint32_t> values;
+    for (const auto &targ : template_args) {
+      auto it = std::find_if(spec_args.begin(), spec_args.end(),
+                             [&](const spirv::SpecConstantArg &a) {
+                               return a.name == targ.name();
+                             });
+      if (it == spec_args.end()) {
+        TI_DEBUG("Kernel {} has no specialization constant {}",
+                 params_.kernel_attribs.name, targ.name());
+        return nullptr;
+      }
+      const auto dtype = ctx_attribs.args()[it->arg_id].dtype;
+      std::optional<uint32_t> bits = to_bits(dtype, targ.targ());
+      if (!bits.has_value()) {
+        TI_DEBUG("Invalid value for the specialization constant {}",
+                 targ.name());
+        return nullptr;
+      }
+      values[it - spec_args.begin()] = *bits;
+    }
+
+    GfxRuntime::RegisterParams kparams = params_;
+    for (auto &spirv : kparams.task_spirv_source_codes) {
+      spirv::specialize_spirv(spirv, values);
+    }
+    return std::make_unique<KernelImpl>(runtime_, std::move(kparams));
+  }
+
+ private:
+  static std::optional<uint32_t> to_bits(
+      PrimitiveTypeID dtype,
+      const aot::KernelTemplateArg::ArgUnion &value) {
+    if (std::holds_alternative<const aot::Field *>(value)) {
+      return std::nullopt;
+    }
+    double d = 0.0;
+    int64_t i = 0;
+    std::visit(
+        [&](const auto &v) {
+          using T = std::decay_t<decltype(v)>;
+          if constexpr (!std::is_same_v<T, const aot::Field *>) {
+            d = static_cast<double>(v);
+            i = static_cast<int64_t>(v);
+          }
+        },
+        value);
+    if (dtype == PrimitiveTypeID::f32) {
+      const float f = static_cast<float>(d);
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      return bits;
+    }
+    return static_cast<uint32_t>(i);
+  }
+
+  GfxRuntime *const runtime_;
+  const GfxRuntime::RegisterParams params_;
+};
+
 class AotModuleImpl : public aot::Module {
  public:
   explicit AotModuleImpl(const AotModuleParams &params, Arch device_api_backend)
       : module_path_(params.module_path),
         runtime_(params.runtime),
         device_api_backend_(device_api_backend) {
-    std::unique_ptr<io::VirtualDir> dir_alt =
-        io::VirtualDir::from_fs_dir(module_path_);
-    const io::VirtualDir *dir =
-        params.dir == nullptr ? dir_alt.get() : params.dir;
+    if (params.shared_dir != nullptr) {
+      dir_ = params.shared_dir;
+    } else if (params.dir == nullptr) {
+      dir_ = io::VirtualDir::from_fs_dir(module_path_);
+    }
+    const io::VirtualDir *dir = dir_ != nullptr ? dir_.get() : params.dir;
 
     bool succ = true;
 
@@ -46,29 +173,19 @@ class AotModuleImpl : public aot::Module {
         (const char *)(metadata_json.data() + metadata_json.size()));
     liong::json::deserialize(json, ti_aot_data_);
 
-    if (!params.enable_lazy_loading) {
+    // The SPIR-V of a kernel is only read when the kernel is first asked for,
+    // which needs the module to keep its directory.
+    ti_aot_data_.spirv_codes.clear();
+    ti_aot_data_.spirv_codes.resize(ti_aot_data_.kernels.size());
+    if (!params.enable_lazy_loading || dir_ == nullptr) {
       for (int i = 0; i < ti_aot_data_.kernels.size(); ++i) {
-        auto k = ti_aot_data_.kernels[i];
-        std::vector<std::vector<uint32_t>> spirv_sources_codes;
-        for (int j = 0; j < k.tasks_attribs.size(); ++j) {
-          std::string spirv_path = k.tasks_attribs[j].name + ".spv";
-
-          std::vector<uint32_t> spirv;
-          dir->load_file(spirv_path, spirv);
-
-          if (spirv.size() == 0) {
-            mark_corrupted();
-            TI_WARN("spirv '{}' cannot be read", spirv_path);
-            return;
-          }
-          if (spirv.at(0) != 0x07230203) {
-            TI_WARN("spirv '{}' has a incorrect magic number {}", spirv_path,
-                    spirv.at(0));
-          }
-          spirv_sources_codes.emplace_back(std::move(spirv));
+        if (!load_spirv(*dir, ti_aot_data_.kernels[i],
+                        ti_aot_data_.spirv_codes[i])) {
+          mark_corrupted();
+          return;
         }
-        ti_aot_data_.spirv_codes.emplace_back(std::move(spirv_sources_codes));
       }
+      dir_ = nullptr;
     }
 
     std::vector<uint8_t> graphs_tcb{};
@@ -96,9 +213,76 @@ class AotModuleImpl : public aot::Module {
                             get_kernel(dispatch.kernel_name)});
     }
     aot::CompiledGraph graph{dispatches};
+    graph.runner = std::make_shared<GraphRunnerImpl>(runtime_);
     return std::make_unique<aot::CompiledGraph>(std::move(graph));
   }
 
+  void prefetch_kernels(const std::vector<std::string> &names) override {
+    std::vector<int> todo;
+    auto add_todo = [&](int i) {
+      if (i >= 0 && !prefetched_.count(i) && !made_kernels_.count(i)) {
+        todo.push_back(i);
+      }
+    };
+    if (names.empty()) {
+      for (int i = 0; i < ti_aot_data_.kernels.size(); ++i) {
+        add_todo(i);
+      }
+    } else {
+      for (const auto &name : names) {
+        add_todo(find_kernel(name));
+      }
+    }
+    std::sort(todo.begin(), todo.end());
+    todo.erase(std::unique(todo.begin(), todo.end()), todo.end());
+    if (todo.empty()) {
+      return;
+    }
+
+    // Only Vulkan can create pipelines off the runtime's thread. The kernel
+    // specific parts of |base| are filled in by the workers.
+    std::optional<CompiledTaichiKernel::Params> base;
+    if (device_api_backend_ == Arch::vulkan) {
+      base = runtime_->get_compiled_kernel_params({});
+    }
+    auto jobs = std::make_shared<PrefetchJobs>();
+    jobs->kernels = todo;
+    jobs->promises.resize(todo.size());
+    for (int i = 0; i < todo.size(); ++i) {
+      prefetched_[todo[i]] = jobs->promises[i].get_future();
+    }
+    num_kernels_to_prefetch_ += todo.size();
+
+    // Driver shader compilers are mostly single-threaded, so a few workers
+    // are enough to keep the cores of a phone busy.
+    constexpr std::size_t kMaxPrefetchWorkers = 4;
+    std::size_t num_workers = std::min<std::size_t>(
+        {kMaxPrefetchWorkers, todo.size(),
+         std::max(std::thread::hardware_concurrency(), 1u)});
+    for (int w = 0; w < num_workers; ++w) {
+      prefetch_workers_.push_back(
+          std::async(std::launch::async, [this, jobs, base]() {
+            for (std::size_t i = jobs->next++; i < jobs->kernels.size();
+                 i = jobs->next++) {
+              try {
+                jobs->promises[i].set_value(
+                    prefetch_kernel(jobs->kernels[i], base));
+              } catch (...) {
+                jobs->promises[i].set_exception(std::current_exception());
+              }
+              num_prefetched_kernels_++;
+            }
+          }));
+    }
+  }
+
+  PrefetchProgress get_prefetch_progress() const override {
+    PrefetchProgress out;
+    out.num_kernels = num_kernels_to_prefetch_;
+    out.num_prefetched_kernels = num_prefetched_kernels_;
+    return out;
+  }
+
   size_t get_root_size() const override {
     return ti_aot_data_.root_buffer_size;
   }
@@ -112,6 +296,18 @@ class AotModuleImpl : public aot::Module {
   }
 
  private:
+  struct PrefetchedKernel {
+    GfxRuntime::RegisterParams params;
+    // Null if the pipelines are left to the runtime's thread.
+    std::unique_ptr<CompiledTaichiKernel> compiled;
+  };
+  // Kernels shared by the workers of a prefetch_kernels() call.
+  struct PrefetchJobs {
+    std::vector<int> kernels;
+    std::vector<std::promise<std::unique_ptr<PrefetchedKernel>>> promises;
+    std::atomic<std::size_t> next{0};
+  };
+
   bool get_field_data_by_name(const std::string &name,
                               aot::CompiledFieldData &field) {
     for (int i = 0; i < ti_aot_data_.fields.size(); ++i) {
@@ -123,32 +319,76 @@ class AotModuleImpl : public aot::Module {
     return false;
   }
 
-  bool get_kernel_params_by_name(const std::string &name,
-                                 GfxRuntime::RegisterParams &kernel) {
+  // Returns the index of the kernel called |name|, or -1 if there is none.
+  int find_kernel(const std::string &name) const {
     for (int i = 0; i < ti_aot_data_.kernels.size(); ++i) {
       // Offloaded task names encode more than the name of the function, but for
       // AOT, only use the name of the function which should be the first part
       // of the struct
       if (ti_aot_data_.kernels[i].name.rfind(name, 0) == 0) {
-        if (!try_load_spv_kernel(i)) {
-          return false;
-        }
-        kernel.kernel_attribs = ti_aot_data_.kernels[i];
-        kernel.task_spirv_source_codes = ti_aot_data_.spirv_codes[i];
-        // We don't have to store the number of SNodeTree in |ti_aot_data_| yet,
-        // because right now we only support a single SNodeTree during AOT.
-        // TODO: Support multiple SNodeTrees in AOT.
-        kernel.num_snode_trees = 1;
-        return true;
+        return i;
       }
     }
-    return false;
+    return -1;
+  }
+
+  // Thread-safe.
+  bool get_kernel_params(int index, GfxRuntime::RegisterParams &kernel) {
+    if (!try_load_spv_kernel(index, kernel.task_spirv_source_codes)) {
+      return false;
+    }
+    kernel.kernel_attribs = ti_aot_data_.kernels[index];
+    // We don't have to store the number of SNodeTree in |ti_aot_data_| yet,
+    // because right now we only support a single SNodeTree during AOT.
+    // TODO: Support multiple SNodeTrees in AOT.
+    kernel.num_snode_trees = 1;
+    return true;
+  }
+
+  // Runs on a loader thread.
+  std::unique_ptr<PrefetchedKernel> prefetch_kernel(
+      int index,
+      const std::optional<CompiledTaichiKernel::Params> &base) {
+    auto out = std::make_unique<PrefetchedKernel>();
+    if (!get_kernel_params(index, out->params)) {
+      return nullptr;
+    }
+    if (base.has_value()) {
+      CompiledTaichiKernel::Params params = *base;
+      params.ti_kernel_attribs = &out->params.kernel_attribs;
+      params.num_snode_trees = out->params.num_snode_trees;
+      params.spirv_bins = out->params.task_spirv_source_codes;
+      out->compiled = std::make_unique<CompiledTaichiKernel>(params);
+    }
+    return out;
   }
 
   std::unique_ptr<aot::Kernel> make_new_kernel(
       const std::string &name) override {
+    int index = find_kernel(name);
+    if (index < 0) {
+      TI_DEBUG("Failed to load kernel {}", name);
+      return nullptr;
+    }
+    made_kernels_.insert(index);
+
     GfxRuntime::RegisterParams kparams;
-    if (!get_kernel_params_by_name(name, kparams)) {
+    bool loaded = false;
+    auto it = prefetched_.find(index);
+    if (it != prefetched_.end()) {
+      std::unique_ptr<PrefetchedKernel> prefetched = it->second.get();
+      prefetched_.erase(it);
+      if (prefetched != nullptr && prefetched->compiled != nullptr) {
+        return std::make_unique<KernelImpl>(runtime_,
+                                            std::move(prefetched->params),
+                                            std::move(prefetched->compiled));
+      } else if (prefetched != nullptr) {
+        kparams = std::move(prefetched->params);
+        loaded = true;
+      }
+    }
+
+    if (!loaded && !get_kernel_params(index, kparams)) {
       TI_DEBUG("Failed to load kernel {}", name);
       return nullptr;
     }
@@ -157,8 +397,13 @@ class AotModuleImpl : public aot::Module {
 
   std::unique_ptr<aot::KernelTemplate> make_new_kernel_template(
       const std::string &name) override {
-    TI_NOT_IMPLEMENTED;
-    return nullptr;
+    int index = find_kernel(name);
+    GfxRuntime::RegisterParams kparams;
+    if (index < 0 || !get_kernel_params(index, kparams)) {
+      TI_DEBUG("Failed to load kernel template {}", name);
+      return nullptr;
+    }
+    return std::make_unique<KernelTemplateImpl>(runtime_, std::move(kparams));
   }
 
   std::unique_ptr<aot::Field> make_new_field(const std::string &name) override {
@@ -170,43 +415,59 @@ class AotModuleImpl : public aot::Module {
     return std::make_unique<FieldImpl>(runtime_, field);
   }
 
-  bool try_load_spv_kernel(std::size_t index) {
-    if (index >= ti_aot_data_.spirv_codes.size() ||
-        ti_aot_data_.spirv_codes[index].empty()) {
-      ti_aot_data_.spirv_codes.resize(index + 1);
-      auto &codes = ti_aot_data_.spirv_codes[index];
-      const auto &k = ti_aot_data_.kernels[index];
-      for (const auto &t : k.tasks_attribs) {
-        auto spv = read_spv_file(module_path_, t);
-        if (spv.empty()) {
-          mark_corrupted();
-          return false;
-        }
-        codes.push_back(spv);
-      }
+  bool try_load_spv_kernel(std::size_t index,
+                           std::vector<std::vector<uint32_t>> &codes) {
+    std::lock_guard<std::mutex> _(spirv_mut_);
+    auto &cached = ti_aot_data_.spirv_codes[index];
+    const auto &k = ti_aot_data_.kernels[index];
+    if (cached.size() != k.tasks_attribs.size() &&
+        (dir_ == nullptr || !load_spirv(*dir_, k, cached))) {
+      return false;
     }
+    codes = cached;
     return true;
   }
 
-  static std::vector<uint32_t> read_spv_file(const std::string &output_dir,
-                                             const TaskAttributes &k) {
-    const std::string spv_path = fmt::format("{}/{}.spv", output_dir, k.name);
-    std::vector<uint32_t> source_code;
-    std::ifstream fs(spv_path, std::ios_base::binary | std::ios::ate);
-    if (fs.is_open()) {
-      size_t size = fs.tellg();
-      fs.seekg(0, std::ios::beg);
-      source_code.resize(size / sizeof(uint32_t));
-      fs.read((char *)source_code.data(), size);
-      fs.close();
+  static bool load_spirv(const io::VirtualDir &dir,
+                         const TaichiKernelAttributes &k,
+                         std::vector<std::vector<uint32_t>> &codes) {
+    codes.clear();
+    for (const auto &t : k.tasks_attribs) {
+      std::string spirv_path = t.name + ".spv";
+
+      std::vector<uint32_t> spirv;
+      dir.load_file(spirv_path, spirv);
+
+      if (spirv.size() == 0) {
+        TI_WARN("spirv '{}' cannot be read", spirv_path);
+        codes.clear();
+        return false;
+      }
+      if (spirv.at(0) != 0x07230203) {
+        TI_WARN("spirv '{}' has a incorrect magic number {}", spirv_path,
+                spirv.at(0));
+      }
+      codes.emplace_back(std::move(spirv));
     }
-    return source_code;
+    return true;
   }
 
   std::string module_path_;
+  // Null unless the kernels are loaded lazily.
+  std::shared_ptr<const io::VirtualDir> dir_;
   TaichiAotData ti_aot_data_;
+  std::mutex spirv_mut_;
   GfxRuntime *runtime_{nullptr};
   Arch device_api_backend_;
+
+  // Keyed by the index of the kernel.
+  std::unordered_set<int> made_kernels_;
+  std::unordered_map<int, std::future<std::unique_ptr<PrefetchedKernel>>>
+      prefetched_;
+  std::size_t num_kernels_to_prefetch_{0};
+  std::atomic<std::size_t> num_prefetched_kernels_{0};
+  // Declared last to be joined before the states they use are destroyed.
+  std::vector<std::future<void>> prefetch_workers_;
 };
 
 }  // namespace
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <any>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -19,7 +20,12 @@ namespace gfx {
 struct TI_DLL_EXPORT AotModuleParams {
   std::string module_path{};
   const io::VirtualDir *dir{nullptr};
+  // Takes the place of |dir| and is kept alive by the module, which is needed
+  // for lazy loading from anything other than |module_path|.
+  std::shared_ptr<const io::VirtualDir> shared_dir{nullptr};
   GfxRuntime *runtime{nullptr};
+  // Only reads the SPIR-V of a kernel, and creates its pipelines, when the
+  // kernel is first asked for.
   bool enable_lazy_loading{false};
 
   AotModuleParams() = default;
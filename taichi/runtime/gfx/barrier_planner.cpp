@@ -0,0 +1,67 @@
+#include "taichi/runtime/gfx/barrier_planner.h"
+
+namespace taichi::lang {
+namespace gfx {
+
+void BarrierPlanner::before_dispatch(
+    CommandList *cmdlist,
+    const std::vector<BufferAccess> &accesses) {
+  if (pending_unknown_) {
+    flush(cmdlist);
+  }
+
+  // The same buffer may be bound more than once.
+  std::unordered_map<DeviceAllocationId, BufferAccess> merged;
+  for (const auto &access : accesses) {
+    if (access.alloc == kDeviceNullAllocation) {
+      continue;
+    }
+    auto [iter, inserted] = merged.try_emplace(access.alloc.alloc_id, access);
+    if (!inserted) {
+      iter->second.is_written |= access.is_written;
+    }
+  }
+
+  bool has_barrier = false;
+  for (const auto &[id, access] : merged) {
+    const bool raw_or_waw = pending_writes_.count(id) > 0;
+    const bool war = access.is_written && pending_reads_.count(id) > 0;
+    if (raw_or_waw || war) {
+      cmdlist->buffer_barrier(access.alloc);
+      pending_writes_.erase(id);
+      has_barrier = true;
+    }
+  }
+  if (has_barrier) {
+    pending_reads_.clear();
+  }
+
+  for (const auto &[id, access] : merged) {
+    if (access.is_written) {
+      pending_writes_[id] = access.alloc;
+    } else {
+      pending_reads_.insert(id);
+    }
+  }
+}
+
+void BarrierPlanner::before_unknown_dispatch(CommandList *cmdlist) {
+  flush(cmdlist);
+  pending_unknown_ = true;
+}
+
+void BarrierPlanner::flush(CommandList *cmdlist) {
+  if (pending_unknown_ || !pending_writes_.empty() || !pending_reads_.empty()) {
+    cmdlist->memory_barrier();
+  }
+  reset();
+}
+
+void BarrierPlanner::reset() {
+  pending_writes_.clear();
+  pending_reads_.clear();
+  pending_unknown_ = false;
+}
+
+}  // namespace gfx
+}  // namespace taichi::lang
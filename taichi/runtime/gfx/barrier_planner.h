@@ -0,0 +1,50 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "taichi/rhi/device.h"
+
+namespace taichi::lang {
+namespace gfx {
+
+// Decides which barriers to record between the dispatches of a command list.
+//
+// Dispatches that are not separated by a barrier may overlap on the device.
+// The planner keeps track of the buffers that have been read or written since
+// the last barrier, and only records buffer barriers for the hazards of the
+// next dispatch (read-after-write, write-after-read, write-after-write). Note
+// that any barrier orders the execution of everything recorded before it, so
+// only the visibility of writes needs to be tracked per buffer across barriers.
+class BarrierPlanner {
+ public:
+  struct BufferAccess {
+    DeviceAllocation alloc;
+    bool is_written{false};
+  };
+
+  // Records the barriers needed before a dispatch that accesses |accesses|.
+  void before_dispatch(CommandList *cmdlist,
+                       const std::vector<BufferAccess> &accesses);
+
+  // Records a full barrier before a dispatch whose accesses are unknown, and
+  // makes the next dispatch wait for it.
+  void before_unknown_dispatch(CommandList *cmdlist);
+
+  // Records a full barrier if any dispatch is not yet ordered with the
+  // commands that follow.
+  void flush(CommandList *cmdlist);
+
+ private:
+  void reset();
+
+  // Buffers whose writes have not been made visible yet.
+  std::unordered_map<DeviceAllocationId, DeviceAllocation> pending_writes_;
+  // Buffers read since the last barrier.
+  std::unordered_set<DeviceAllocationId> pending_reads_;
+  bool pending_unknown_{false};
+};
+
+}  // namespace gfx
+}  // namespace taichi::lang
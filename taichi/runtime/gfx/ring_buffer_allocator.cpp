@@ -0,0 +1,103 @@
+#include "taichi/runtime/gfx/ring_buffer_allocator.h"
+
+#include <algorithm>
+
+namespace taichi::lang {
+namespace gfx {
+
+namespace {
+
+constexpr size_t kBlockSize = 256 << 10;
+// Upper bound of the memory held by one allocator.
+constexpr size_t kMaxAllocatedBytes = 16 << 20;
+// No less than the offset alignment of any uniform or storage buffer binding
+// the backends may require.
+constexpr size_t kAlignment = 256;
+
+size_t align_up(size_t size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+}  // namespace
+
+RingBufferAllocator::RingBufferAllocator(Device *device,
+                                         const Device::AllocParams &params)
+    : device_(device),
+      params_(params),
+      // Other backends may not use memory while it is mapped.
+      persistently_mapped_(device->arch() == Arch::vulkan) {
+}
+
+RingBufferAllocator::~RingBufferAllocator() {
+  for (auto &block : blocks_) {
+    if (block.mapped) {
+      device_->unmap(*block.alloc);
+    }
+  }
+}
+
+bool RingBufferAllocator::allocate(size_t size, Suballocation *out) {
+  const size_t aligned_size = align_up(std::max(size, size_t(1)));
+  while (current_block_ < blocks_.size()) {
+    const auto &block = blocks_[current_block_];
+    if (offset_ + aligned_size <= block.size) {
+      break;
+    }
+    current_block_++;
+    offset_ = 0;
+  }
+
+  if (current_block_ == blocks_.size()) {
+    const size_t block_size = std::max(kBlockSize, aligned_size);
+    if (!blocks_.empty() &&
+        num_allocated_bytes_ + block_size > kMaxAllocatedBytes) {
+      return false;
+    }
+    blocks_.push_back(make_block(block_size));
+    num_allocated_bytes_ += block_size;
+  }
+
+  const auto &block = blocks_[current_block_];
+  out->ptr = block.alloc->get_ptr(offset_);
+  out->size = size;
+  out->mapped = block.mapped ? (uint8_t *)block.mapped + offset_ : nullptr;
+  offset_ += aligned_size;
+  return true;
+}
+
+void RingBufferAllocator::reclaim() {
+  current_block_ = 0;
+  offset_ = 0;
+}
+
+void *RingBufferAllocator::map(const Suballocation &suballoc) {
+  if (suballoc.mapped) {
+    return suballoc.mapped;
+  }
+  void *mapped{nullptr};
+  TI_ASSERT(device_->map_range(suballoc.ptr, suballoc.size, &mapped) ==
+            RhiResult::success);
+  return mapped;
+}
+
+void RingBufferAllocator::unmap(const Suballocation &suballoc) {
+  if (!suballoc.mapped) {
+    device_->unmap(suballoc.ptr);
+  }
+}
+
+RingBufferAllocator::Block RingBufferAllocator::make_block(size_t size) {
+  Device::AllocParams params = params_;
+  params.size = size;
+  Block block;
+  block.alloc = device_->allocate_memory_unique(params);
+  block.size = size;
+  if (persistently_mapped_ &&
+      device_->map(*block.alloc, &block.mapped) != RhiResult::success) {
+    block.mapped = nullptr;
+  }
+  return block;
+}
+
+}  // namespace gfx
+}  // namespace taichi::lang
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "taichi/rhi/device.h"
+
+namespace taichi::lang {
+namespace gfx {
+
+// Suballocates short-lived, host-visible buffers (e.g. the argument and return
+// buffers of kernel launches) out of a few large device allocations.
+//
+// Memory is handed out linearly, and is only recycled once reclaim() is called,
+// i.e. when the caller knows that the device no longer uses any of it. The
+// allocations stay mapped on devices that allow it, so that writing to a
+// suballocation does not cost a map call.
+class RingBufferAllocator {
+ public:
+  struct Suballocation {
+    DevicePtr ptr{kDeviceNullPtr};
+    size_t size{0};
+    // Non-null if the memory is persistently mapped.
+    void *mapped{nullptr};
+  };
+
+  RingBufferAllocator(Device *device, const Device::AllocParams &params);
+  ~RingBufferAllocator();
+
+  RingBufferAllocator(const RingBufferAllocator &) = delete;
+  RingBufferAllocator &operator=(const RingBufferAllocator &) = delete;
+
+  // Returns false if the memory in use has hit the limit, in which case the
+  // caller should wait for the device and reclaim().
+  bool allocate(size_t size, Suballocation *out);
+
+  // Makes all the suballocations available again.
+  void reclaim();
+
+  // Returns the host address of |suballoc|, which must be unmapped before the
+  // device uses it.
+  void *map(const Suballocation &suballoc);
+  void unmap(const Suballocation &suballoc);
+
+ private:
+  struct Block {
+    std::unique_ptr<DeviceAllocationGuard> alloc;
+    size_t size{0};
+    // Non-null if the block is persistently mapped.
+    void *mapped{nullptr};
+  };
+
+  Block make_block(size_t size);
+
+  Device *const device_;
+  const Device::AllocParams params_;
+  const bool persistently_mapped_;
+
+  std::vector<Block> blocks_;
+  size_t current_block_{0};
+  size_t offset_{0};
+  size_t num_allocated_bytes_{0};
+};
+
+}  // namespace gfx
+}  // namespace taichi::lang
@@ -1,9 +1,15 @@
 #include "taichi/runtime/gfx/runtime.h"
+#include "taichi/runtime/gfx/barrier_planner.h"
+#include "taichi/runtime/gfx/ring_buffer_allocator.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/program.h"
 #include "taichi/common/filesystem.hpp"
+#include "taichi/util/lock.h"
 
 #include <chrono>
 #include <array>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <optional>
@@ -28,13 +34,17 @@ class HostDeviceContextBlitter {
                            RuntimeContext *host_ctx,
                            Device *device,
                            uint64_t *host_result_buffer,
-                           DeviceAllocation *device_args_buffer,
-                           DeviceAllocation *device_ret_buffer)
+                           RingBufferAllocator *args_allocator,
+                           const RingBufferAllocator::Suballocation &args_buffer,
+                           RingBufferAllocator *ret_allocator,
+                           const RingBufferAllocator::Suballocation &ret_buffer)
       : ctx_attribs_(ctx_attribs),
         host_ctx_(host_ctx),
         host_result_buffer_(host_result_buffer),
-        device_args_buffer_(device_args_buffer),
-        device_ret_buffer_(device_ret_buffer),
+        args_allocator_(args_allocator),
+        args_buffer_(args_buffer),
+        ret_allocator_(ret_allocator),
+        ret_buffer_(ret_buffer),
         device_(device) {
   }
 
@@ -45,9 +55,7 @@ class HostDeviceContextBlitter {
       return;
     }
 
-    void *device_base{nullptr};
-    TI_ASSERT(device_->map(*device_args_buffer_, &device_base) ==
-              RhiResult::success);
+    void *device_base = args_allocator_->map(args_buffer_);
 
 #define TO_DEVICE(short_type, type)               \
   if (arg.dtype == PrimitiveTypeID::short_type) { \
@@ -119,7 +127,7 @@ class HostDeviceContextBlitter {
     std::memcpy(device_ptr, host_ctx_->extra_args,
                 ctx_attribs_->extra_args_bytes());
 
-    device_->unmap(*device_args_buffer_);
+    args_allocator_->unmap(args_buffer_);
 #undef TO_DEVICE
   }
 
@@ -147,7 +155,7 @@ class HostDeviceContextBlitter {
     }
 
     if (require_sync) {
-      device_->get_compute_stream()->submit_synced(cmdlist);
+      device_->get_compute_stream()->submit_synced(cmdlist, wait_semaphore);
     } else {
       return false;
     }
@@ -176,9 +184,7 @@ class HostDeviceContextBlitter {
     if (!ctx_attribs_->has_rets())
       return require_sync;
 
-    void *device_base{nullptr};
-    TI_ASSERT(device_->map(*device_ret_buffer_, &device_base) ==
-              RhiResult::success);
+    void *device_base = ret_allocator_->map(ret_buffer_);
 
 #define TO_HOST(short_type, type, offset)                            \
   if (dt->is_primitive(PrimitiveTypeID::short_type)) {               \
@@ -221,7 +227,7 @@ class HostDeviceContextBlitter {
     }
 #undef TO_HOST
 
-    device_->unmap(*device_ret_buffer_);
+    ret_allocator_->unmap(ret_buffer_);
 
     return true;
   }
@@ -231,29 +237,70 @@ class HostDeviceContextBlitter {
       RuntimeContext *host_ctx,
       Device *device,
       uint64_t *host_result_buffer,
-      DeviceAllocation *device_args_buffer,
-      DeviceAllocation *device_ret_buffer) {
+      RingBufferAllocator *args_allocator,
+      const RingBufferAllocator::Suballocation &args_buffer,
+      RingBufferAllocator *ret_allocator,
+      const RingBufferAllocator::Suballocation &ret_buffer) {
     if (ctx_attribs->empty()) {
       return nullptr;
     }
     return std::make_unique<HostDeviceContextBlitter>(
-        ctx_attribs, host_ctx, device, host_result_buffer, device_args_buffer,
-        device_ret_buffer);
+        ctx_attribs, host_ctx, device, host_result_buffer, args_allocator,
+        args_buffer, ret_allocator, ret_buffer);
   }
 
  private:
   const KernelContextAttributes *const ctx_attribs_;
   RuntimeContext *const host_ctx_;
   uint64_t *const host_result_buffer_;
-  DeviceAllocation *const device_args_buffer_;
-  DeviceAllocation *const device_ret_buffer_;
+  RingBufferAllocator *const args_allocator_;
+  const RingBufferAllocator::Suballocation args_buffer_;
+  RingBufferAllocator *const ret_allocator_;
+  const RingBufferAllocator::Suballocation ret_buffer_;
   Device *const device_;
 };
 
+// Collects the ndarrays passed in |host_ctx|. Returns false if there are
+// arguments that prevent the launch from being recorded, i.e. host arrays and
+// textures.
+bool get_recordable_ndarrays(
+    const KernelContextAttributes &ctx_attribs,
+    const RuntimeContext *host_ctx,
+    std::unordered_map<int, DeviceAllocation> *ndarrays) {
+  const auto &args = ctx_attribs.args();
+  for (int i = 0; i < args.size(); ++i) {
+    if (!args[i].is_array) {
+      continue;
+    }
+    if (host_ctx->device_allocation_type[i] !=
+            RuntimeContext::DevAllocType::kNdarray ||
+        !host_ctx->args[i]) {
+      return false;
+    }
+    (*ndarrays)[i] = *(DeviceAllocation *)(host_ctx->args[i]);
+  }
+  return true;
+}
+
+std::vector<char> read_pipeline_cache(const std::string &path) {
+  std::vector<char> data;
+  if (std::filesystem::exists(path)) {
+    TI_TRACE("Loading pipeline cache from {}", path);
+    std::ifstream cache_file(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(cache_file),
+                std::istreambuf_iterator<char>());
+  } else {
+    TI_TRACE("Pipeline cache not found at {}", path);
+  }
+  return data;
+}
+
 }  // namespace
 
 constexpr size_t kGtmpBufferSize = 1024 * 1024;
 constexpr size_t kListGenBufferSize = 32 << 20;
+constexpr size_t kDispatchArgsBufferSize =
+    kMaxDispatchArgsSlots * kDispatchArgsSlotSize;
 
 // Info for launching a compiled Taichi kernel, which consists of a series of
 // Unified Device API pipelines.
@@ -263,6 +310,7 @@ CompiledTaichiKernel::CompiledTaichiKernel(const Params &ti_params)
       device_(ti_params.device) {
   input_buffers_[BufferType::GlobalTmps] = ti_params.global_tmps_buffer;
   input_buffers_[BufferType::ListGen] = ti_params.listgen_buffer;
+  input_buffers_[BufferType::DispatchArgs] = ti_params.dispatch_args_buffer;
 
   // Compiled_structs can be empty if loading a kernel from an AOT module as
   // the SNode are not re-compiled/structured. In this case, we assume a
@@ -317,23 +365,34 @@ Pipeline *CompiledTaichiKernel::get_pipeline(int i) {
 }
 
 GfxRuntime::GfxRuntime(const Params &params)
-    : device_(params.device), host_result_buffer_(params.host_result_buffer) {
+    : device_(params.device),
+      host_result_buffer_(params.host_result_buffer),
+      submission_policy_(make_submission_policy(params.submission)),
+      profiler_(params.profiler) {
   TI_ASSERT(host_result_buffer_ != nullptr);
   current_cmdlist_pending_since_ = high_res_clock::now();
-  init_nonroot_buffers();
-
-  // Read pipeline cache from disk if available.
-  std::filesystem::path cache_path(get_repo_dir());
-  cache_path /= "rhi_cache.bin";
-  std::vector<char> cache_data;
-  if (std::filesystem::exists(cache_path)) {
-    TI_TRACE("Loading pipeline cache from {}", cache_path.generic_string());
-    std::ifstream cache_file(cache_path, std::ios::binary);
-    cache_data.assign(std::istreambuf_iterator<char>(cache_file),
-                      std::istreambuf_iterator<char>());
-  } else {
-    TI_TRACE("Pipeline cache not found at {}", cache_path.generic_string());
-  }
+  last_synchronized_at_ = high_res_clock::now();
+  args_buffer_allocator_ = std::make_unique<RingBufferAllocator>(
+      device_, Device::AllocParams{/*size=*/0,
+                                   /*host_write=*/true, /*host_read=*/false,
+                                   /*export_sharing=*/false,
+                                   AllocUsage::Uniform});
+  ret_buffer_allocator_ = std::make_unique<RingBufferAllocator>(
+      device_, Device::AllocParams{/*size=*/0,
+                                   /*host_write=*/false, /*host_read=*/true,
+                                   /*export_sharing=*/false,
+                                   AllocUsage::Storage});
+
+  // Read pipeline cache from disk if available. Caches of different drivers
+  // are kept apart, so that machines with several GPUs do not thrash them.
+  std::filesystem::path cache_path(params.pipeline_cache_dir.empty()
+                                       ? get_repo_dir()
+                                       : params.pipeline_cache_dir);
+  const std::string cache_key = device_->get_pipeline_cache_key();
+  cache_path /=
+      cache_key.empty() ? "rhi_cache.bin" : "rhi_cache_" + cache_key + ".bin";
+  pipeline_cache_path_ = cache_path.string();
+  std::vector<char> cache_data = read_pipeline_cache(pipeline_cache_path_);
   auto [cache, res] = device_->create_pipeline_cache_unique(cache_data.size(),
                                                             cache_data.data());
   if (res == RhiResult::success) {
@@ -346,15 +405,7 @@ GfxRuntime::~GfxRuntime() {
 
   // Write pipeline cache back to disk.
   if (backend_cache_) {
-    uint8_t *cache_data = (uint8_t *)backend_cache_->data();
-    size_t cache_size = backend_cache_->size();
-    if (cache_data) {
-      std::filesystem::path cache_path =
-          std::filesystem::path(get_repo_dir()) / "rhi_cache.bin";
-      std::ofstream cache_file(cache_path, std::ios::binary | std::ios::trunc);
-      std::ostreambuf_iterator<char> output_iterator(cache_file);
-      std::copy(cache_data, cache_data + cache_size, output_iterator);
-    }
+    save_pipeline_cache();
     backend_cache_.reset();
   }
 
@@ -364,10 +415,56 @@ GfxRuntime::~GfxRuntime() {
   }
   global_tmps_buffer_.reset();
   listgen_buffer_.reset();
+  dispatch_args_buffer_.reset();
+}
+
+void GfxRuntime::save_pipeline_cache() {
+  std::filesystem::path cache_path(pipeline_cache_path_);
+  std::error_code ec;
+  std::filesystem::create_directories(cache_path.parent_path(), ec);
+
+  // Other processes sharing the cache may have written to it since it was
+  // loaded, so merge their pipelines instead of overwriting them.
+  const std::string lock_path = pipeline_cache_path_ + ".lock";
+  if (!lock_with_file(lock_path)) {
+    TI_WARN("Lock {} failed, the pipeline cache is not saved", lock_path);
+    return;
+  }
+  auto _ = make_unlocker(lock_path);
+
+  std::vector<char> disk_data = read_pipeline_cache(pipeline_cache_path_);
+  if (!disk_data.empty()) {
+    backend_cache_->merge(disk_data.size(), disk_data.data());
+  }
+  uint8_t *cache_data = (uint8_t *)backend_cache_->data();
+  size_t cache_size = backend_cache_->size();
+  if (!cache_data) {
+    return;
+  }
+
+  // Readers never see a partially written cache.
+  const std::string tmp_path = pipeline_cache_path_ + ".tmp";
+  {
+    std::ofstream cache_file(tmp_path, std::ios::binary | std::ios::trunc);
+    std::ostreambuf_iterator<char> output_iterator(cache_file);
+    std::copy(cache_data, cache_data + cache_size, output_iterator);
+  }
+  std::filesystem::rename(tmp_path, cache_path, ec);
+  if (ec) {
+    TI_WARN("Failed to save the pipeline cache to {}: {}", pipeline_cache_path_,
+            ec.message());
+  }
 }
 
 GfxRuntime::KernelHandle GfxRuntime::register_taichi_kernel(
     GfxRuntime::RegisterParams reg_params) {
+  return register_taichi_kernel(std::make_unique<CompiledTaichiKernel>(
+      get_compiled_kernel_params(reg_params)));
+}
+
+CompiledTaichiKernel::Params GfxRuntime::get_compiled_kernel_params(
+    const RegisterParams &reg_params) {
+  init_nonroot_buffers(reg_params.kernel_attribs);
   CompiledTaichiKernel::Params params;
   params.ti_kernel_attribs = &(reg_params.kernel_attribs);
   params.num_snode_trees = reg_params.num_snode_trees;
@@ -378,45 +475,43 @@ GfxRuntime::KernelHandle GfxRuntime::register_taichi_kernel(
   }
   params.global_tmps_buffer = global_tmps_buffer_.get();
   params.listgen_buffer = listgen_buffer_.get();
+  params.dispatch_args_buffer = dispatch_args_buffer_.get();
   params.backend_cache = backend_cache_.get();
+  params.spirv_bins = reg_params.task_spirv_source_codes;
+  return params;
+}
 
-  for (int i = 0; i < reg_params.task_spirv_source_codes.size(); ++i) {
-    const auto &spirv_src = reg_params.task_spirv_source_codes[i];
-
-    // If we can reach here, we have succeeded. Otherwise
-    // std::optional::value() would have killed us.
-    params.spirv_bins.push_back(std::move(spirv_src));
-  }
+GfxRuntime::KernelHandle GfxRuntime::register_taichi_kernel(
+    std::unique_ptr<CompiledTaichiKernel> kernel) {
   KernelHandle res;
   res.id_ = ti_kernels_.size();
-  ti_kernels_.push_back(std::make_unique<CompiledTaichiKernel>(params));
+  ti_kernels_.push_back(std::move(kernel));
   return res;
 }
 
 void GfxRuntime::launch_kernel(KernelHandle handle, RuntimeContext *host_ctx) {
   auto *ti_kernel = ti_kernels_[handle.id_].get();
 
-  std::unique_ptr<DeviceAllocationGuard> args_buffer{nullptr},
-      ret_buffer{nullptr};
-
-  if (ti_kernel->get_args_buffer_size()) {
-    args_buffer = device_->allocate_memory_unique(
-        {ti_kernel->get_args_buffer_size(),
-         /*host_write=*/true, /*host_read=*/false,
-         /*export_sharing=*/false, AllocUsage::Uniform});
-  }
-
-  if (ti_kernel->get_ret_buffer_size()) {
-    ret_buffer = device_->allocate_memory_unique(
-        {ti_kernel->get_ret_buffer_size(),
-         /*host_write=*/false, /*host_read=*/true,
-         /*export_sharing=*/false, AllocUsage::Storage});
+  RingBufferAllocator::Suballocation args_buffer, ret_buffer;
+  auto allocate_ctx_buffers = [&]() {
+    return (!ti_kernel->get_args_buffer_size() ||
+            args_buffer_allocator_->allocate(ti_kernel->get_args_buffer_size(),
+                                             &args_buffer)) &&
+           (!ti_kernel->get_ret_buffer_size() ||
+            ret_buffer_allocator_->allocate(ti_kernel->get_ret_buffer_size(),
+                                            &ret_buffer));
+  };
+  if (!allocate_ctx_buffers()) {
+    // Wait for the in-flight launches to retire their context buffers.
+    synchronize();
+    TI_ASSERT(allocate_ctx_buffers());
   }
 
   // Create context blitter
   auto ctx_blitter = HostDeviceContextBlitter::maybe_make(
       &ti_kernel->ti_kernel_attribs().ctx_attribs, host_ctx, device_,
-      host_result_buffer_, args_buffer.get(), ret_buffer.get());
+      host_result_buffer_, args_buffer_allocator_.get(), args_buffer,
+      ret_buffer_allocator_.get(), ret_buffer);
 
   // `any_arrays` contain both external arrays and NDArrays
   std::vector<std::unique_ptr<DeviceAllocationGuard>> allocated_buffers;
@@ -490,12 +585,72 @@ void GfxRuntime::launch_kernel(KernelHandle handle, RuntimeContext *host_ctx) {
   }
 
   ensure_current_cmdlist();
+  current_cmdlist_work_.num_dispatches +=
+      ti_kernel->ti_kernel_attribs().tasks_attribs.size();
+  current_cmdlist_work_.num_invocations +=
+      record_dispatches(ti_kernel, current_cmdlist_.get(), args_buffer,
+                        ret_buffer, any_arrays, textures);
+
+  for (auto &[id, shadow] : any_array_shadows) {
+    current_cmdlist_->buffer_copy(
+        shadow.get_ptr(0), any_arrays.at(id).get_ptr(0), ext_array_size.at(id));
+  }
+
+  // If we need to host sync, sync and remove in-flight references
+  std::vector<StreamSemaphore> wait_semaphore = pending_transfers_;
 
-  // Record commands
+  if (ctx_blitter) {
+    if (ctx_blitter->device_to_host(current_cmdlist_.get(), any_array_shadows,
+                                    ext_array_size, wait_semaphore)) {
+      current_cmdlist_ = nullptr;
+      pending_transfers_.clear();
+      on_submitted(current_cmdlist_work_);
+      on_synchronized();
+      reclaim_ctx_buffers();
+    }
+  }
+
+  submit_current_cmdlist_if_needed();
+}
+
+uint64_t GfxRuntime::record_dispatches(
+    CompiledTaichiKernel *ti_kernel,
+    CommandList *cmdlist,
+    const RingBufferAllocator::Suballocation &args_buffer,
+    const RingBufferAllocator::Suballocation &ret_buffer,
+    const std::unordered_map<int, DeviceAllocation> &any_arrays,
+    const std::unordered_map<int, DeviceAllocation> &textures) {
   const auto &task_attribs = ti_kernel->ti_kernel_attribs().tasks_attribs;
 
+  auto get_buffer_alloc =
+      [&](const TaskAttributes::BufferInfo &buffer) -> DeviceAllocation {
+    // We might have to bind a invalid buffer (this is fine as long as
+    // shader don't do anything with it)
+    if (buffer.type == BufferType::ExtArr) {
+      return any_arrays.at(buffer.root_id);
+    } else if (buffer.type == BufferType::Args) {
+      return args_buffer.ptr;
+    } else if (buffer.type == BufferType::Rets) {
+      return ret_buffer.ptr;
+    }
+    DeviceAllocation *alloc = ti_kernel->get_buffer_bind(buffer);
+    return alloc ? *alloc : kDeviceNullAllocation;
+  };
+
+  // Tasks only wait for the preceding tasks they conflict with. The kernel
+  // still ends with a full barrier, so that later commands need not care.
+  BarrierPlanner barrier_planner;
+  uint64_t num_invocations = 0;
+
   for (int i = 0; i < task_attribs.size(); ++i) {
     const auto &attribs = task_attribs[i];
+    // Without indirect dispatches, the tasks run with the largest grids.
+    if (attribs.writes_dispatch_args && !indirect_dispatch_supported_) {
+      continue;
+    }
+    const bool dispatch_indirectly = attribs.dispatch_args_slot >= 0 &&
+                                     !attribs.writes_dispatch_args &&
+                                     indirect_dispatch_supported_;
     auto vp = ti_kernel->get_pipeline(i);
     const int group_x = (attribs.advisory_total_num_threads +
                          attribs.advisory_num_threads_per_group - 1) /
@@ -503,28 +658,24 @@ void GfxRuntime::launch_kernel(KernelHandle handle, RuntimeContext *host_ctx) {
     std::unique_ptr<ShaderResourceSet> bindings =
         device_->create_resource_set_unique();
     for (auto &bind : attribs.buffer_binds) {
-      // We might have to bind a invalid buffer (this is fine as long as
-      // shader don't do anything with it)
-      if (bind.buffer.type == BufferType::ExtArr) {
-        bindings->rw_buffer(bind.binding, any_arrays.at(bind.buffer.root_id));
-      } else if (bind.buffer.type == BufferType::Args) {
-        bindings->buffer(bind.binding,
-                         args_buffer ? *args_buffer : kDeviceNullAllocation);
+      if (bind.buffer.type == BufferType::Args) {
+        bindings->buffer(bind.binding, args_buffer.ptr, args_buffer.size);
       } else if (bind.buffer.type == BufferType::Rets) {
-        bindings->rw_buffer(bind.binding,
-                            ret_buffer ? *ret_buffer : kDeviceNullAllocation);
+        bindings->rw_buffer(bind.binding, ret_buffer.ptr, ret_buffer.size);
       } else {
-        DeviceAllocation *alloc = ti_kernel->get_buffer_bind(bind.buffer);
-        bindings->rw_buffer(bind.binding,
-                            alloc ? *alloc : kDeviceNullAllocation);
+        bindings->rw_buffer(bind.binding, get_buffer_alloc(bind.buffer));
       }
     }
 
+    // Layout transitions go to |current_cmdlist_|, so textures can not be
+    // recorded into other command lists.
+    TI_ASSERT(attribs.texture_binds.empty() ||
+              cmdlist == current_cmdlist_.get());
     for (auto &bind : attribs.texture_binds) {
       DeviceAllocation texture = textures.at(bind.arg_id);
       if (bind.is_storage) {
         transition_image(texture, ImageLayout::shader_read_write);
-        bindings->rw_image(bind.binding, texture, 0);
+        bindings->rw_image(bind.binding, texture, bind.lod);
       } else {
         transition_image(texture, ImageLayout::shader_read);
         bindings->image(bind.binding, texture, {});
@@ -532,59 +683,247 @@ void GfxRuntime::launch_kernel(KernelHandle handle, RuntimeContext *host_ctx) {
     }
 
     if (attribs.task_type == OffloadedTaskType::listgen) {
+      // The fill below is not tracked by |barrier_planner|.
+      barrier_planner.flush(cmdlist);
       for (auto &bind : attribs.buffer_binds) {
         if (bind.buffer.type == BufferType::ListGen) {
           // FIXME: properlly support multiple list
-          current_cmdlist_->buffer_fill(
+          cmdlist->buffer_fill(
               ti_kernel->get_buffer_bind(bind.buffer)->get_ptr(0),
               kBufferSizeEntireSize,
               /*data=*/0);
-          current_cmdlist_->buffer_barrier(
-              *ti_kernel->get_buffer_bind(bind.buffer));
+          cmdlist->buffer_barrier(*ti_kernel->get_buffer_bind(bind.buffer));
         }
       }
     }
 
-    current_cmdlist_->bind_pipeline(vp);
-    RhiResult status = current_cmdlist_->bind_shader_resources(bindings.get());
+    // Textures are left to full barriers.
+    if (attribs.buffer_accesses.empty() || !attribs.texture_binds.empty()) {
+      barrier_planner.before_unknown_dispatch(cmdlist);
+    } else {
+      std::vector<BarrierPlanner::BufferAccess> accesses;
+      for (const auto &access : attribs.buffer_accesses) {
+        accesses.push_back({get_buffer_alloc(access.buffer), access.is_written});
+      }
+      if (dispatch_indirectly) {
+        accesses.push_back(
+            {get_buffer_alloc(BufferType::DispatchArgs), /*is_written=*/false});
+      }
+      barrier_planner.before_dispatch(cmdlist, accesses);
+    }
+
+    cmdlist->bind_pipeline(vp);
+    RhiResult status = cmdlist->bind_shader_resources(bindings.get());
     TI_ERROR_IF(status != RhiResult::success,
                 "Resource binding error : RhiResult({})", status);
-    status = current_cmdlist_->dispatch(group_x);
+    if (profiler_) {
+      cmdlist->begin_profiler_scope(attribs.name);
+    }
+    if (dispatch_indirectly) {
+      status = cmdlist->dispatch_indirect(
+          get_buffer_alloc(BufferType::DispatchArgs)
+              .get_ptr(attribs.dispatch_args_slot * kDispatchArgsSlotSize));
+      if (status == RhiResult::not_supported) {
+        // The counts written by the preceding task are left unused.
+        indirect_dispatch_supported_ = false;
+        status = cmdlist->dispatch(group_x);
+      }
+    } else {
+      status = cmdlist->dispatch(group_x);
+    }
     TI_ERROR_IF(status != RhiResult::success, "Dispatch error : RhiResult({})",
                 status);
-    current_cmdlist_->memory_barrier();
+    if (profiler_) {
+      cmdlist->end_profiler_scope();
+    }
+    // Indirect dispatches are counted with their upper bound.
+    num_invocations +=
+        uint64_t(group_x) * uint64_t(attribs.advisory_num_threads_per_group);
   }
+  barrier_planner.flush(cmdlist);
+  return num_invocations;
+}
 
-  for (auto &[id, shadow] : any_array_shadows) {
-    current_cmdlist_->buffer_copy(
-        shadow.get_ptr(0), any_arrays.at(id).get_ptr(0), ext_array_size.at(id));
+std::unique_ptr<GfxRuntime::RecordedLaunches> GfxRuntime::record_launches(
+    const std::vector<std::pair<KernelHandle, RuntimeContext *>> &launches) {
+  // Only Vulkan command lists can be submitted more than once. The timestamps
+  // of profiler scopes would be overwritten by overlapping replays.
+  if (device_->arch() != Arch::vulkan || launches.empty() || profiler_) {
+    return nullptr;
   }
 
-  // Keep context buffers used in this dispatch
-  if (ti_kernel->get_args_buffer_size()) {
-    ctx_buffers_.push_back(std::move(args_buffer));
+  auto recorded = std::make_unique<RecordedLaunches>();
+  recorded->epoch_ = recording_epoch_;
+  for (const auto &[handle, host_ctx] : launches) {
+    auto *ti_kernel = ti_kernels_[handle.id_].get();
+    RecordedLaunches::Launch launch;
+    launch.handle = handle;
+    if (ti_kernel->get_ret_buffer_size() ||
+        !get_recordable_ndarrays(ti_kernel->ti_kernel_attribs().ctx_attribs,
+                                 host_ctx, &launch.ndarrays)) {
+      return nullptr;
+    }
+    recorded->launches_.push_back(std::move(launch));
   }
-  if (ti_kernel->get_ret_buffer_size()) {
-    ctx_buffers_.push_back(std::move(ret_buffer));
+
+  auto [cmdlist, res] =
+      device_->get_compute_stream()->new_command_list_unique();
+  TI_ASSERT(res == RhiResult::success);
+  for (auto &launch : recorded->launches_) {
+    auto *ti_kernel = ti_kernels_[launch.handle.id_].get();
+    RingBufferAllocator::Suballocation args_buffer;
+    if (size_t size = ti_kernel->get_args_buffer_size()) {
+      // Filled in by every replay.
+      launch.args_buffer = device_->allocate_memory_unique(
+          {size,
+           /*host_write=*/false, /*host_read=*/false,
+           /*export_sharing=*/false, AllocUsage::Uniform});
+      args_buffer.ptr = launch.args_buffer->get_ptr(0);
+      args_buffer.size = size;
+    }
+    recorded->num_invocations_ +=
+        record_dispatches(ti_kernel, cmdlist.get(), args_buffer,
+                          /*ret_buffer=*/{}, launch.ndarrays, /*textures=*/{});
   }
+  recorded->cmdlist_ = std::move(cmdlist);
+  return recorded;
+}
 
-  // If we need to host sync, sync and remove in-flight references
-  std::vector<StreamSemaphore> wait_semaphore;
+bool GfxRuntime::replay_launches(
+    RecordedLaunches &recorded,
+    const std::vector<std::pair<KernelHandle, RuntimeContext *>> &launches) {
+  if (recorded.epoch_ != recording_epoch_ ||
+      recorded.launches_.size() != launches.size()) {
+    return false;
+  }
+  for (int i = 0; i < launches.size(); ++i) {
+    const auto &[handle, host_ctx] = launches[i];
+    const auto &launch = recorded.launches_[i];
+    auto *ti_kernel = ti_kernels_[handle.id_].get();
+    std::unordered_map<int, DeviceAllocation> ndarrays;
+    if (handle.id_ != launch.handle.id_ ||
+        !get_recordable_ndarrays(ti_kernel->ti_kernel_attribs().ctx_attribs,
+                                 host_ctx, &ndarrays) ||
+        ndarrays != launch.ndarrays) {
+      return false;
+    }
+  }
 
-  if (ctx_blitter) {
-    if (ctx_blitter->device_to_host(current_cmdlist_.get(), any_array_shadows,
-                                    ext_array_size, wait_semaphore)) {
-      current_cmdlist_ = nullptr;
-      ctx_buffers_.clear();
+  // Upload the new arguments in a separate command list, which is submitted
+  // right before the recorded one.
+  ensure_current_cmdlist();
+  current_cmdlist_->memory_barrier();
+  for (int i = 0; i < launches.size(); ++i) {
+    const auto &launch = recorded.launches_[i];
+    auto *ti_kernel = ti_kernels_[launch.handle.id_].get();
+    for (const auto &[arg_id, ndarray] : launch.ndarrays) {
+      ndarrays_in_use_.insert(ndarray.alloc_id);
+    }
+    const size_t size = ti_kernel->get_args_buffer_size();
+    if (!size) {
+      continue;
     }
+    RingBufferAllocator::Suballocation staging;
+    if (!args_buffer_allocator_->allocate(size, &staging)) {
+      synchronize();
+      ensure_current_cmdlist();
+      TI_ASSERT(args_buffer_allocator_->allocate(size, &staging));
+    }
+    HostDeviceContextBlitter blitter(
+        &ti_kernel->ti_kernel_attribs().ctx_attribs, launches[i].second,
+        device_, host_result_buffer_, args_buffer_allocator_.get(), staging,
+        ret_buffer_allocator_.get(), /*ret_buffer=*/{});
+    blitter.host_to_device(launch.ndarrays, /*ext_arr_size=*/{});
+    current_cmdlist_->buffer_copy(launch.args_buffer->get_ptr(0), staging.ptr,
+                                  size);
   }
+  current_cmdlist_->memory_barrier();
+  flush();
 
-  submit_current_cmdlist_if_timeout();
+  // Every recorded launch ends with a full barrier, which also orders the
+  // commands submitted afterwards.
+  device_->get_compute_stream()->submit(recorded.cmdlist_.get());
+  PendingWork work;
+  work.num_dispatches = int(recorded.launches_.size());
+  work.num_invocations = recorded.num_invocations_;
+  on_submitted(work);
+  return true;
+}
+
+void GfxRuntime::invalidate_recorded_launches() {
+  recording_epoch_++;
 }
 
 void GfxRuntime::buffer_copy(DevicePtr dst, DevicePtr src, size_t size) {
   ensure_current_cmdlist();
   current_cmdlist_->buffer_copy(dst, src, size);
+  // Lets asynchronous copies know that the buffers are in use.
+  ndarrays_in_use_.insert(dst.alloc_id);
+  ndarrays_in_use_.insert(src.alloc_id);
+}
+
+void GfxRuntime::buffer_copy_async(DevicePtr dst, DevicePtr src, size_t size) {
+  Stream *transfer_stream = device_->get_transfer_stream();
+  if (transfer_stream == device_->get_compute_stream()) {
+    buffer_copy(dst, src, size);
+    return;
+  }
+
+  std::vector<StreamSemaphore> wait_semaphores;
+  if (used_by_pending_commands(dst.alloc_id) ||
+      used_by_pending_commands(src.alloc_id)) {
+    wait_semaphores.push_back(flush());
+  }
+  if (buffers_in_transfer_.count(dst.alloc_id) ||
+      buffers_in_transfer_.count(src.alloc_id)) {
+    // Transfer command lists can not record barriers, so wait for the
+    // conflicting copy instead.
+    transfer_stream->command_sync();
+    buffers_in_transfer_.clear();
+  }
+
+  auto [cmdlist, res] = transfer_stream->new_command_list_unique();
+  TI_ASSERT(res == RhiResult::success);
+  cmdlist->buffer_copy(dst, src, size);
+  pending_transfers_.push_back(
+      transfer_stream->submit(cmdlist.get(), wait_semaphores));
+  buffers_in_transfer_.insert(dst.alloc_id);
+  buffers_in_transfer_.insert(src.alloc_id);
+}
+
+void GfxRuntime::buffer_fill(DevicePtr ptr, size_t size, uint32_t data) {
+  ensure_current_cmdlist();
+  current_cmdlist_->buffer_barrier(ptr);
+  current_cmdlist_->buffer_fill(ptr, size, data);
+  current_cmdlist_->buffer_barrier(ptr);
+  ndarrays_in_use_.insert(ptr.alloc_id);
+}
+
+void GfxRuntime::wait_semaphore(StreamSemaphore sema) {
+  if (sema) {
+    pending_transfers_.push_back(std::move(sema));
+  }
+}
+
+bool GfxRuntime::used_by_pending_commands(DeviceAllocationId id) const {
+  if (ndarrays_in_use_.count(id)) {
+    return true;
+  }
+  // Kernels do not report their use of the buffers of the runtime.
+  for (const auto &buffer : root_buffers_) {
+    if (buffer->alloc_id == id) {
+      return true;
+    }
+  }
+  return (global_tmps_buffer_ && global_tmps_buffer_->alloc_id == id) ||
+         (listgen_buffer_ && listgen_buffer_->alloc_id == id) ||
+         (dispatch_args_buffer_ && dispatch_args_buffer_->alloc_id == id);
+}
+
+std::vector<StreamSemaphore> GfxRuntime::take_pending_transfers() {
+  std::vector<StreamSemaphore> semaphores;
+  semaphores.swap(pending_transfers_);
+  return semaphores;
 }
 
 void GfxRuntime::copy_image(DeviceAllocation dst,
@@ -623,7 +962,9 @@ void GfxRuntime::transition_image(DeviceAllocation image, ImageLayout layout) {
 void GfxRuntime::synchronize() {
   flush();
   device_->wait_idle();
-  ctx_buffers_.clear();
+  buffers_in_transfer_.clear();
+  on_synchronized();
+  reclaim_ctx_buffers();
   ndarrays_in_use_.clear();
   fflush(stdout);
 }
@@ -631,18 +972,30 @@ void GfxRuntime::synchronize() {
 StreamSemaphore GfxRuntime::flush() {
   StreamSemaphore sema;
   if (current_cmdlist_) {
-    sema = device_->get_compute_stream()->submit(current_cmdlist_.get());
+    sema = device_->get_compute_stream()->submit(current_cmdlist_.get(),
+                                                 take_pending_transfers());
     current_cmdlist_ = nullptr;
+    on_submitted(current_cmdlist_work_);
   } else {
     auto [cmdlist, res] =
         device_->get_compute_stream()->new_command_list_unique();
     TI_ASSERT(res == RhiResult::success);
     cmdlist->memory_barrier();
-    sema = device_->get_compute_stream()->submit(cmdlist.get());
+    sema = device_->get_compute_stream()->submit(cmdlist.get(),
+                                                 take_pending_transfers());
   }
   return sema;
 }
 
+uint64_t GfxRuntime::signal() {
+  flush();
+  return device_->get_compute_stream()->last_submission_id();
+}
+
+void GfxRuntime::wait_for(uint64_t value) {
+  device_->get_compute_stream()->wait_for_submission(value);
+}
+
 Device *GfxRuntime::get_ti_device() const {
   return device_;
 }
@@ -650,51 +1003,158 @@ Device *GfxRuntime::get_ti_device() const {
 void GfxRuntime::ensure_current_cmdlist() {
   // Create new command list if current one is nullptr
   if (!current_cmdlist_) {
-    ctx_buffers_.clear();
     current_cmdlist_pending_since_ = high_res_clock::now();
+    current_cmdlist_work_ = {};
     auto [cmdlist, res] =
         device_->get_compute_stream()->new_command_list_unique();
     TI_ASSERT(res == RhiResult::success);
     current_cmdlist_ = std::move(cmdlist);
   }
 }
-void GfxRuntime::submit_current_cmdlist_if_timeout() {
-  // If we have accumulated some work but does not require sync
-  // and if the accumulated cmdlist has been pending for some time
-  // launch the cmdlist to start processing.
+void GfxRuntime::reclaim_ctx_buffers() {
+  args_buffer_allocator_->reclaim();
+  ret_buffer_allocator_->reclaim();
+}
+
+void GfxRuntime::submit_current_cmdlist_if_needed() {
+  // If we have accumulated some work but does not require sync, let the
+  // policy decide whether the device should start processing it.
   if (current_cmdlist_) {
-    constexpr uint64_t max_pending_time = 2000;  // 2000us = 2ms
     auto duration = high_res_clock::now() - current_cmdlist_pending_since_;
-    if (std::chrono::duration_cast<std::chrono::microseconds>(duration)
-            .count() > max_pending_time) {
+    current_cmdlist_work_.pending_time_us =
+        std::chrono::duration<double, std::micro>(duration).count();
+    if (submission_policy_->should_submit(current_cmdlist_work_)) {
       flush();
     }
   }
 }
 
-void GfxRuntime::init_nonroot_buffers() {
-  global_tmps_buffer_ = device_->allocate_memory_unique(
-      {kGtmpBufferSize,
-       /*host_write=*/false, /*host_read=*/false,
-       /*export_sharing=*/false, AllocUsage::Storage});
+void GfxRuntime::set_submission_policy(
+    std::unique_ptr<SubmissionPolicy> policy) {
+  TI_ASSERT(policy != nullptr);
+  submission_policy_ = std::move(policy);
+}
+
+void GfxRuntime::on_submitted(const PendingWork &work) {
+  submission_stats_.num_submissions++;
+  submission_stats_.num_dispatches += work.num_dispatches;
+  num_submitted_invocations_ += work.num_invocations;
+  queue_depth_++;
+  submission_stats_.max_queue_depth =
+      std::max(submission_stats_.max_queue_depth, queue_depth_);
+  collect_profiler_records();
+}
+
+void GfxRuntime::on_synchronized() {
+  const auto now = high_res_clock::now();
+  // Only Vulkan streams time the command lists they run.
+  if (device_->arch() == Arch::vulkan) {
+    const double device_time_us =
+        device_->get_compute_stream()->device_time_elapsed_us();
+    const double busy_us = device_time_us - last_device_time_us_;
+    const double wall_us =
+        std::chrono::duration<double, std::micro>(now - last_synchronized_at_)
+            .count();
+    last_device_time_us_ = device_time_us;
+    submission_policy_->on_device_time(num_submitted_invocations_, busy_us);
+    submission_stats_.device_busy_time_us += busy_us;
+    submission_stats_.device_idle_time_us += std::max(0.0, wall_us - busy_us);
+  }
+  last_synchronized_at_ = now;
+  num_submitted_invocations_ = 0;
+  queue_depth_ = 0;
+
+  if (profiler_) {
+    const auto &stats = submission_stats_;
+    profiler_->set_counter("gfx_submissions", stats.num_submissions);
+    profiler_->set_counter(
+        "gfx_dispatches_per_submission",
+        stats.num_submissions
+            ? double(stats.num_dispatches) / stats.num_submissions
+            : 0.0);
+    profiler_->set_counter("gfx_max_queue_depth", stats.max_queue_depth);
+    profiler_->set_counter("gfx_device_busy_time_us",
+                           stats.device_busy_time_us);
+    profiler_->set_counter("gfx_device_idle_time_us",
+                           stats.device_idle_time_us);
+  }
+  collect_profiler_records();
+}
+
+void GfxRuntime::collect_profiler_records() {
+  if (!profiler_) {
+    return;
+  }
+  for (const auto &record :
+       device_->get_compute_stream()->pop_profiler_records()) {
+    profiler_->insert_record(record.name, record.elapsed_us / 1000.0);
+  }
+}
+
+void GfxRuntime::init_nonroot_buffers(
+    const TaichiKernelAttributes &kernel_attribs) {
+  const bool all = kernel_attribs.tasks_attribs.empty();
+  bool needs_global_tmps = all;
+  bool needs_listgen = all;
+  bool needs_dispatch_args = all;
+  for (const auto &task : kernel_attribs.tasks_attribs) {
+    for (const auto &bind : task.buffer_binds) {
+      needs_global_tmps |= bind.buffer.type == BufferType::GlobalTmps;
+      needs_listgen |= bind.buffer.type == BufferType::ListGen;
+      needs_dispatch_args |= bind.buffer.type == BufferType::DispatchArgs;
+    }
+    needs_dispatch_args |= task.dispatch_args_slot >= 0;
+  }
+  needs_global_tmps &= !global_tmps_buffer_;
+  needs_listgen &= !listgen_buffer_;
+  needs_dispatch_args &= !dispatch_args_buffer_;
+  if (!needs_global_tmps && !needs_listgen && !needs_dispatch_args) {
+    return;
+  }
 
-  listgen_buffer_ = device_->allocate_memory_unique(
-      {kListGenBufferSize,
-       /*host_write=*/false, /*host_read=*/false,
-       /*export_sharing=*/false, AllocUsage::Storage});
+  if (needs_global_tmps) {
+    global_tmps_buffer_ = device_->allocate_memory_unique(
+        {kGtmpBufferSize,
+         /*host_write=*/false, /*host_read=*/false,
+         /*export_sharing=*/false, AllocUsage::Storage});
+  }
 
-  // Need to zero fill the buffers, otherwise there could be NaN.
+  if (needs_listgen) {
+    listgen_buffer_ = device_->allocate_memory_unique(
+        {kListGenBufferSize,
+         /*host_write=*/false, /*host_read=*/false,
+         /*export_sharing=*/false, AllocUsage::Storage});
+  }
+
+  if (needs_dispatch_args) {
+    dispatch_args_buffer_ = device_->allocate_memory_unique(
+        {kDispatchArgsBufferSize,
+         /*host_write=*/false, /*host_read=*/false,
+         /*export_sharing=*/false,
+         AllocUsage::Storage | AllocUsage::Indirect});
+  }
+
+  if (!needs_global_tmps && !needs_listgen) {
+    return;
+  }
+
+  // Need to zero fill the buffers, otherwise there could be NaN. Only the
+  // command lists on the compute stream use them, which are submitted after
+  // this one, so the barrier is enough and there is no need to wait.
   Stream *stream = device_->get_compute_stream();
-  auto [cmdlist, res] =
-      device_->get_compute_stream()->new_command_list_unique();
+  auto [cmdlist, res] = stream->new_command_list_unique();
   TI_ASSERT(res == RhiResult::success);
 
-  cmdlist->buffer_fill(global_tmps_buffer_->get_ptr(0), kBufferSizeEntireSize,
-                       /*data=*/0);
-  cmdlist->buffer_fill(listgen_buffer_->get_ptr(0), kBufferSizeEntireSize,
-                       /*data=*/0);
+  for (auto *buffer : {needs_global_tmps ? global_tmps_buffer_.get() : nullptr,
+                       needs_listgen ? listgen_buffer_.get() : nullptr}) {
+    if (buffer) {
+      cmdlist->buffer_fill(buffer->get_ptr(0), kBufferSizeEntireSize,
+                           /*data=*/0);
+      cmdlist->buffer_barrier(*buffer);
+    }
+  }
 
-  stream->submit_synced(cmdlist.get());
+  stream->submit(cmdlist.get());
 }
 
 void GfxRuntime::add_root_buffer(size_t root_buffer_size) {
@@ -755,7 +1215,8 @@ GfxRuntime::RegisterParams run_codegen(
     Arch arch,
     const DeviceCapabilityConfig &caps,
     const std::vector<CompiledSNodeStructs> &compiled_structs,
-    const CompileConfig &compile_config) {
+    const CompileConfig &compile_config,
+    const std::vector<spirv::SpecConstantArg> &spec_constant_args) {
   const auto id = Program::get_kernel_id();
   const auto taichi_kernel_name(fmt::format("{}_k{:04d}_vk", kernel->name, id));
   TI_TRACE("VK codegen for Taichi kernel={}", taichi_kernel_name);
@@ -766,10 +1227,31 @@ GfxRuntime::RegisterParams run_codegen(
   params.arch = arch;
   params.caps = caps;
   params.enable_spv_opt = compile_config.external_optimization_level > 0;
+  params.spec_constant_args = spec_constant_args;
   spirv::KernelCodegen codegen(params);
   GfxRuntime::RegisterParams res;
-  codegen.run(res.kernel_attribs, res.task_spirv_source_codes);
+  {
+    CompileProfiler::Scope profiled(kernel->get_name(), "codegen_spirv");
+    codegen.run(res.kernel_attribs, res.task_spirv_source_codes);
+    int64 code_size = 0;
+    for (const auto &code : res.task_spirv_source_codes) {
+      code_size += code.size() * sizeof(uint32_t);
+    }
+    profiled.set_code_size(code_size);
+  }
   res.num_snode_trees = compiled_structs.size();
+  if (compile_config.kernel_profiler) {
+    // The tasks writing dispatch args run before the task they are made for.
+    auto &tasks = kernel->ir->as<Block>()->statements;
+    int i = 0;
+    for (const auto &attribs : res.kernel_attribs.tasks_attribs) {
+      if (!ends_with(attribs.name, "_args")) {
+        KernelProfilerBase::register_task_cost(
+            attribs.name, irpass::analysis::estimate_task_cost(
+                              tasks[i++]->as<OffloadedStmt>()));
+      }
+    }
+  }
   return res;
 }
 
@@ -5,6 +5,8 @@
 #include <chrono>
 
 #include "taichi/rhi/device.h"
+#include "taichi/runtime/gfx/ring_buffer_allocator.h"
+#include "taichi/runtime/gfx/submission_policy.h"
 #include "taichi/codegen/spirv/snode_struct_compiler.h"
 #include "taichi/codegen/spirv/kernel_utils.h"
 #include "taichi/codegen/spirv/spirv_codegen.h"
@@ -12,6 +14,7 @@
 #include "taichi/struct/snode_tree.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/program/program_impl.h"
+#include "taichi/program/kernel_profiler.h"
 
 namespace taichi::lang {
 namespace gfx {
@@ -43,6 +46,7 @@ class CompiledTaichiKernel {
     std::vector<DeviceAllocation *> root_buffers;
     DeviceAllocation *global_tmps_buffer{nullptr};
     DeviceAllocation *listgen_buffer{nullptr};
+    DeviceAllocation *dispatch_args_buffer{nullptr};
 
     PipelineCache *backend_cache{nullptr};
   };
@@ -80,6 +84,24 @@ class TI_DLL_EXPORT GfxRuntime {
   struct Params {
     uint64_t *host_result_buffer{nullptr};
     Device *device{nullptr};
+    SubmissionConfig submission{};
+    // Receives the submission counters, if not null.
+    KernelProfilerBase *profiler{nullptr};
+    // Where the pipeline cache of the device is persisted, e.g. next to the
+    // offline cache. Defaults to the repo directory.
+    std::string pipeline_cache_dir;
+  };
+
+  // How the command queue has been used, accumulated over the lifetime of the
+  // runtime.
+  struct SubmissionStats {
+    uint64_t num_submissions{0};
+    uint64_t num_dispatches{0};
+    // The most command lists submitted between two synchronizations.
+    uint64_t max_queue_depth{0};
+    // Only measured on devices that can time their work.
+    double device_busy_time_us{0.0};
+    double device_idle_time_us{0.0};
   };
 
   explicit GfxRuntime(const Params &params);
@@ -99,10 +121,63 @@ class TI_DLL_EXPORT GfxRuntime {
   };
 
   KernelHandle register_taichi_kernel(RegisterParams params);
+  // Snapshots the buffers of the runtime a kernel binds, so that the kernel
+  // can be built off the runtime, e.g. by a loader thread. Pipeline creation
+  // is only thread-safe on Vulkan. Creates the buffers of the runtime that the
+  // kernel binds if they do not exist yet, or all of them if |params| has no
+  // tasks.
+  CompiledTaichiKernel::Params get_compiled_kernel_params(
+      const RegisterParams &params);
+  KernelHandle register_taichi_kernel(
+      std::unique_ptr<CompiledTaichiKernel> kernel);
 
   void launch_kernel(KernelHandle handle, RuntimeContext *host_ctx);
 
+  // The commands of a sequence of kernel launches, which can be submitted
+  // again with other scalar arguments.
+  class RecordedLaunches {
+   private:
+    friend class GfxRuntime;
+
+    struct Launch {
+      KernelHandle handle;
+      std::unique_ptr<DeviceAllocationGuard> args_buffer{nullptr};
+      std::unordered_map<int, DeviceAllocation> ndarrays;
+    };
+
+    std::vector<Launch> launches_;
+    std::unique_ptr<CommandList> cmdlist_{nullptr};
+    uint64_t num_invocations_{0};
+    uint64_t epoch_{0};
+  };
+
+  // Records |launches| without submitting them. Returns nullptr if they can
+  // not be recorded, e.g. because they return values, or take host arrays or
+  // textures, or the kernel profiler is on.
+  std::unique_ptr<RecordedLaunches> record_launches(
+      const std::vector<std::pair<KernelHandle, RuntimeContext *>> &launches);
+  // Submits |recorded| with the arguments of |launches|. Returns false without
+  // doing anything if |launches| do not match the recorded ones, or bind other
+  // ndarrays.
+  bool replay_launches(
+      RecordedLaunches &recorded,
+      const std::vector<std::pair<KernelHandle, RuntimeContext *>> &launches);
+  // Must be called when memory is freed, as a recording can not tell a new
+  // allocation that reuses the handle of a freed one.
+  void invalidate_recorded_launches();
+
   void buffer_copy(DevicePtr dst, DevicePtr src, size_t size);
+  // Copies on the transfer stream of the device, so that e.g. the inputs of
+  // the next frame can be uploaded while the kernels of the current one run.
+  // Kernels launched afterwards wait for the copy, and the copy waits for the
+  // pending work that may use |dst| or |src|. |src| must not be written to by
+  // the host until the next synchronize().
+  void buffer_copy_async(DevicePtr dst, DevicePtr src, size_t size);
+  // Fills |size| bytes at |ptr| with |data|, ordered with the kernels
+  // launched before and after it.
+  void buffer_fill(DevicePtr ptr, size_t size, uint32_t data);
+  // Makes the next compute submission wait for |sema|.
+  void wait_semaphore(StreamSemaphore sema);
   void copy_image(DeviceAllocation dst,
                   DeviceAllocation src,
                   const ImageCopyParams &params);
@@ -115,6 +190,14 @@ class TI_DLL_EXPORT GfxRuntime {
   void synchronize();
 
   StreamSemaphore flush();
+  // Flushes the pending work and returns the value that wait_for() waits on
+  // for it. The values increase monotonically on each thread, as the
+  // streams of the device are per-thread.
+  uint64_t signal();
+  // Waits for the work flushed by the signal() that returned |value|, while
+  // the work flushed after it stays in flight. Unlike synchronize(), nothing
+  // in use by the device is released.
+  void wait_for(uint64_t value);
 
   Device *get_ti_device() const;
 
@@ -132,28 +215,79 @@ class TI_DLL_EXPORT GfxRuntime {
     return ndarrays_in_use_.count(id) > 0;
   }
 
+  void set_submission_policy(std::unique_ptr<SubmissionPolicy> policy);
+
+  const SubmissionStats &get_submission_stats() const {
+    return submission_stats_;
+  }
+
  private:
   friend class taichi::lang::gfx::SNodeTreeManager;
 
   void ensure_current_cmdlist();
-  void submit_current_cmdlist_if_timeout();
-
-  void init_nonroot_buffers();
+  void submit_current_cmdlist_if_needed();
+  // Must be called whenever a command list with |work| has been submitted.
+  void on_submitted(const PendingWork &work);
+  // Must be called whenever the compute stream has been drained.
+  void on_synchronized();
+  // Hands the tasks timed by the command lists that have completed to the
+  // kernel profiler.
+  void collect_profiler_records();
+  // Returns the number of shader invocations recorded.
+  uint64_t record_dispatches(
+      CompiledTaichiKernel *ti_kernel,
+      CommandList *cmdlist,
+      const RingBufferAllocator::Suballocation &args_buffer,
+      const RingBufferAllocator::Suballocation &ret_buffer,
+      const std::unordered_map<int, DeviceAllocation> &any_arrays,
+      const std::unordered_map<int, DeviceAllocation> &textures);
+  // Must only be called when the device has finished all the submitted work.
+  void reclaim_ctx_buffers();
+
+  // The global temporaries, list and dispatch argument buffers are created
+  // for the first kernel that binds them, so that short-lived runtimes do not
+  // pay for the allocations and the zero fill at startup.
+  void init_nonroot_buffers(const TaichiKernelAttributes &kernel_attribs);
+  void save_pipeline_cache();
+
+  // Whether commands that have not completed yet may access |id|.
+  bool used_by_pending_commands(DeviceAllocationId id) const;
+  // The semaphores that the next compute submission has to wait on.
+  std::vector<StreamSemaphore> take_pending_transfers();
 
   Device *device_{nullptr};
   uint64_t *const host_result_buffer_;
 
   std::unique_ptr<PipelineCache> backend_cache_{nullptr};
+  std::string pipeline_cache_path_;
 
   std::vector<std::unique_ptr<DeviceAllocationGuard>> root_buffers_;
   std::unique_ptr<DeviceAllocationGuard> global_tmps_buffer_;
   // FIXME: Support proper multiple lists
   std::unique_ptr<DeviceAllocationGuard> listgen_buffer_;
+  // The workgroup counts of indirect dispatches, written by the kernels.
+  std::unique_ptr<DeviceAllocationGuard> dispatch_args_buffer_;
+  // Cleared once the device fails an indirect dispatch.
+  bool indirect_dispatch_supported_{true};
+
+  // Argument and return buffers of kernel launches.
+  std::unique_ptr<RingBufferAllocator> args_buffer_allocator_;
+  std::unique_ptr<RingBufferAllocator> ret_buffer_allocator_;
 
-  std::vector<std::unique_ptr<DeviceAllocationGuard>> ctx_buffers_;
+  uint64_t recording_epoch_{0};
 
   std::unique_ptr<CommandList> current_cmdlist_{nullptr};
   high_res_clock::time_point current_cmdlist_pending_since_;
+  PendingWork current_cmdlist_work_;
+
+  std::unique_ptr<SubmissionPolicy> submission_policy_{nullptr};
+  KernelProfilerBase *const profiler_;
+  SubmissionStats submission_stats_;
+  // Since the last synchronization.
+  uint64_t num_submitted_invocations_{0};
+  uint64_t queue_depth_{0};
+  double last_device_time_us_{0.0};
+  high_res_clock::time_point last_synchronized_at_;
 
   std::vector<std::unique_ptr<CompiledTaichiKernel>> ti_kernels_;
 
@@ -165,6 +299,11 @@ class TI_DLL_EXPORT GfxRuntime {
   // ndarray_in_use_ to track this so that we can free memory allocated for
   // ndarray whenever it's safe to do so.
   std::unordered_set<DeviceAllocationId> ndarrays_in_use_;
+
+  // Copies submitted to the transfer stream that no compute submission waits
+  // on yet, and the buffers they access.
+  std::vector<StreamSemaphore> pending_transfers_;
+  std::unordered_set<DeviceAllocationId> buffers_in_transfer_;
 };
 
 GfxRuntime::RegisterParams run_codegen(
@@ -172,7 +311,8 @@ GfxRuntime::RegisterParams run_codegen(
     Arch arch,
     const DeviceCapabilityConfig &caps,
     const std::vector<CompiledSNodeStructs> &compiled_structs,
-    const CompileConfig &compile_config);
+    const CompileConfig &compile_config,
+    const std::vector<spirv::SpecConstantArg> &spec_constant_args = {});
 
 }  // namespace gfx
 }  // namespace taichi::lang
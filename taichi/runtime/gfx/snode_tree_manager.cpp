@@ -50,5 +50,13 @@ DevicePtr SNodeTreeManager::get_snode_tree_device_ptr(int tree_id) {
   return runtime_->root_buffers_[tree_id]->get_ptr();
 }
 
+size_t SNodeTreeManager::get_snode_tree_buffer_size(int tree_id) {
+  if (tree_id >= runtime_->root_buffers_.size() ||
+      !runtime_->root_buffers_[tree_id]) {
+    return 0;
+  }
+  return runtime_->get_root_buffer_size(tree_id);
+}
+
 }  // namespace gfx
 }  // namespace taichi::lang
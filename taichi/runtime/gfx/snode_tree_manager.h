@@ -34,6 +34,9 @@ class SNodeTreeManager {
 
   DevicePtr get_snode_tree_device_ptr(int tree_id);
 
+  // 0 if the tree was destroyed.
+  size_t get_snode_tree_buffer_size(int tree_id);
+
  private:
   GfxRuntime *const runtime_;
   std::vector<CompiledSNodeStructs> compiled_snode_structs_;
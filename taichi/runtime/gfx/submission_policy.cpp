@@ -0,0 +1,69 @@
+#include "taichi/runtime/gfx/submission_policy.h"
+
+#include "taichi/program/compile_config.h"
+
+namespace taichi::lang {
+namespace gfx {
+
+namespace {
+
+// Weight of the latest report in the estimated device time per invocation.
+constexpr double kDeviceTimeSmoothing = 0.25;
+
+}  // namespace
+
+SubmissionConfig SubmissionConfig::from_compile_config(
+    const CompileConfig &config) {
+  SubmissionConfig res;
+  res.max_pending_dispatches = config.gfx_max_pending_dispatches;
+  res.max_pending_invocations = config.gfx_max_pending_invocations;
+  res.max_pending_time_us = config.gfx_max_pending_time_us;
+  res.target_device_time_us = config.gfx_target_device_time_us;
+  return res;
+}
+
+ThresholdSubmissionPolicy::ThresholdSubmissionPolicy(
+    const SubmissionConfig &config)
+    : config_(config) {
+}
+
+bool ThresholdSubmissionPolicy::should_submit(const PendingWork &work) {
+  if (config_.max_pending_dispatches > 0 &&
+      work.num_dispatches >= config_.max_pending_dispatches) {
+    return true;
+  }
+  if (config_.max_pending_invocations > 0 &&
+      work.num_invocations >= config_.max_pending_invocations) {
+    return true;
+  }
+  if (config_.target_device_time_us > 0.0 &&
+      device_time_per_invocation_us_ > 0.0 &&
+      work.num_invocations * device_time_per_invocation_us_ >=
+          config_.target_device_time_us) {
+    return true;
+  }
+  return config_.max_pending_time_us > 0.0 &&
+         work.pending_time_us > config_.max_pending_time_us;
+}
+
+void ThresholdSubmissionPolicy::on_device_time(uint64_t num_invocations,
+                                               double device_time_us) {
+  if (num_invocations == 0 || device_time_us <= 0.0) {
+    return;
+  }
+  const double sample = device_time_us / num_invocations;
+  if (device_time_per_invocation_us_ == 0.0) {
+    device_time_per_invocation_us_ = sample;
+  } else {
+    device_time_per_invocation_us_ +=
+        kDeviceTimeSmoothing * (sample - device_time_per_invocation_us_);
+  }
+}
+
+std::unique_ptr<SubmissionPolicy> make_submission_policy(
+    const SubmissionConfig &config) {
+  return std::make_unique<ThresholdSubmissionPolicy>(config);
+}
+
+}  // namespace gfx
+}  // namespace taichi::lang
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace taichi::lang {
+
+struct CompileConfig;
+
+namespace gfx {
+
+// The work recorded into the current command list of the runtime, which has
+// not been submitted yet.
+struct PendingWork {
+  int num_dispatches{0};
+  // The number of shader invocations of the dispatches, as an estimate of how
+  // much work they are.
+  uint64_t num_invocations{0};
+  // Host time since the first command was recorded.
+  double pending_time_us{0.0};
+};
+
+// Decides when the runtime submits the command list it is recording.
+//
+// Submitting late keeps the device idle while the host records, submitting
+// early adds the overhead of many small command lists.
+class SubmissionPolicy {
+ public:
+  virtual ~SubmissionPolicy() = default;
+
+  virtual bool should_submit(const PendingWork &work) = 0;
+
+  // Reports the device time that |num_invocations| invocations submitted since
+  // the last report took. Only called on devices that can time their work.
+  virtual void on_device_time(uint64_t num_invocations, double device_time_us) {
+  }
+};
+
+struct SubmissionConfig {
+  // Thresholds of the pending work. A threshold of 0 is disabled.
+  int max_pending_dispatches{0};
+  uint64_t max_pending_invocations{0};
+  double max_pending_time_us{2000.0};
+  // Submits once the pending work is estimated to keep the device busy for
+  // this long, measured from the previous submissions. Disabled if 0.
+  double target_device_time_us{0.0};
+
+  static SubmissionConfig from_compile_config(const CompileConfig &config);
+};
+
+// Submits as soon as any of the thresholds of |config| is reached.
+class ThresholdSubmissionPolicy : public SubmissionPolicy {
+ public:
+  explicit ThresholdSubmissionPolicy(const SubmissionConfig &config);
+
+  bool should_submit(const PendingWork &work) override;
+  void on_device_time(uint64_t num_invocations, double device_time_us) override;
+
+  // The estimated device time of one invocation, 0 until the first report.
+  double device_time_per_invocation_us() const {
+    return device_time_per_invocation_us_;
+  }
+
+ private:
+  const SubmissionConfig config_;
+  double device_time_per_invocation_us_{0.0};
+};
+
+std::unique_ptr<SubmissionPolicy> make_submission_policy(
+    const SubmissionConfig &config);
+
+}  // namespace gfx
+}  // namespace taichi::lang
@@ -0,0 +1,50 @@
+#include "taichi/runtime/llvm/branch_profile.h"
+
+#include <fstream>
+
+#include "taichi/util/io.h"
+
+namespace taichi::lang {
+
+std::string get_branch_profile_symbol(const std::string &task_key) {
+  return "taichi_branch_profile_" + task_key;
+}
+
+std::string get_branch_profile_path(const std::string &dir,
+                                    const std::string &task_key) {
+  return join_path(dir, task_key + ".prof");
+}
+
+BranchProfile load_branch_profile(const std::string &path) {
+  BranchProfile profile;
+  std::ifstream is(path);
+  uint64 taken = 0, not_taken = 0;
+  while (is >> taken >> not_taken) {
+    profile.emplace_back(taken, not_taken);
+  }
+  return profile;
+}
+
+void save_branch_profile(const std::string &path,
+                         const BranchProfile &profile) {
+  auto saved = load_branch_profile(path);
+  if (saved.size() == profile.size()) {
+    for (std::size_t i = 0; i < saved.size(); i++) {
+      saved[i].first += profile[i].first;
+      saved[i].second += profile[i].second;
+    }
+  } else {
+    // The task has changed since the profile was saved.
+    saved = profile;
+  }
+  std::ofstream os(path, std::ios::trunc);
+  if (!os) {
+    TI_WARN("Failed to save the branch profile to {}", path);
+    return;
+  }
+  for (const auto &[taken, not_taken] : saved) {
+    os << taken << ' ' << not_taken << '\n';
+  }
+}
+
+}  // namespace taichi::lang
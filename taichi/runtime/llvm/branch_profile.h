@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+namespace taichi::lang {
+
+// The (taken, not taken) counts of the branches of an offloaded task, in the
+// order the LLVM codegen numbers them.
+using BranchProfile = std::vector<std::pair<uint64, uint64>>;
+
+// The global the instrumented code of the task with offline cache key
+// |task_key| counts its branches in.
+std::string get_branch_profile_symbol(const std::string &task_key);
+
+std::string get_branch_profile_path(const std::string &dir,
+                                    const std::string &task_key);
+
+// Empty if there is no profile at |path|.
+BranchProfile load_branch_profile(const std::string &path);
+
+// Adds |profile| to the one saved at |path|, unless that one has a different
+// number of branches.
+void save_branch_profile(const std::string &path,
+                         const BranchProfile &profile);
+
+}  // namespace taichi::lang
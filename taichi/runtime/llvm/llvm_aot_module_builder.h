@@ -36,6 +36,10 @@ class LlvmAotModuleBuilder : public AotModuleBuilder {
     return compile_config_;
   }
 
+  LlvmProgramImpl *get_program() const {
+    return prog_;
+  }
+
  private:
   mutable LlvmOfflineCache cache_;
   const CompileConfig *compile_config_{nullptr};
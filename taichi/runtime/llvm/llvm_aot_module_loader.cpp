@@ -6,8 +6,11 @@ namespace taichi::lang {
 LlvmOfflineCache::KernelCacheData LlvmAotModule::load_kernel_from_cache(
     const std::string &name) {
   TI_ASSERT(cache_reader_ != nullptr);
-  auto *tlctx = executor_->get_llvm_context(executor_->get_config()->arch);
   LlvmOfflineCache::KernelCacheData loaded;
+  if (load_native_code(name, loaded)) {
+    return loaded;
+  }
+  auto *tlctx = executor_->get_llvm_context(executor_->get_config()->arch);
   auto ok = cache_reader_->get_kernel_cache(loaded, name,
                                             *tlctx->get_this_thread_context());
   TI_ERROR_IF(!ok, "Failed to load kernel={}", name);
@@ -55,6 +58,7 @@ std::unique_ptr<aot::CompiledGraph> LlvmAotModule::get_graph(
 
   aot::CompiledGraph graph = aot::CompiledGraph({dispatches});
   executor_->prepare_runtime_context(&graph.ctx_);
+  graph.runner = executor_->make_graph_runner();
 
   return std::make_unique<aot::CompiledGraph>(std::move(graph));
 }
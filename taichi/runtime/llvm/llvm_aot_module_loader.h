@@ -61,6 +61,13 @@ class LlvmAotModule : public aot::Module {
       const std::string &name,
       LlvmOfflineCache::KernelCacheData &&loaded) = 0;
 
+  // Loads the native code of kernel |name| for the current device, if the
+  // module has any, so that the kernel skips LLVM.
+  virtual bool load_native_code(const std::string &name,
+                                LlvmOfflineCache::KernelCacheData &loaded) {
+    return false;
+  }
+
   LlvmOfflineCache::KernelCacheData load_kernel_from_cache(
       const std::string &name);
 
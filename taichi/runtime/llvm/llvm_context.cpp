@@ -313,6 +313,77 @@ static void remove_useless_cuda_libdevice_functions(llvm::Module *module) {
 
 void TaichiLLVMContext::init_runtime_jit_module() {
   update_runtime_jit_module(clone_runtime_module());
+  if (config_->cpu_shared_runtime && arch_is_cpu(arch_)) {
+    init_shared_runtime_module();
+  }
+}
+
+namespace {
+
+// With cpu_shared_runtime, the runtime functions of at most this many
+// instructions are still linked into each kernel, so that they are inlined.
+constexpr int kMaxInlinedRuntimeFunctionSize = 32;
+
+// Whether |gv| is defined by the shared runtime module only, instead of being
+// copied into each kernel.
+bool is_shared_runtime_value(const llvm::GlobalValue &gv) {
+  if (auto *var = llvm::dyn_cast<llvm::GlobalVariable>(&gv)) {
+    return !var->isConstant();
+  }
+  return llvm::isa<llvm::Function>(gv);
+}
+
+}  // namespace
+
+void TaichiLLVMContext::init_shared_runtime_module() {
+  TI_AUTO_PROF
+  auto *runtime_module = linking_context_data->runtime_module.get();
+  // The kernels refer to the static functions of the runtime by name now.
+  for (auto &gv : runtime_module->global_values()) {
+    if (gv.hasLocalLinkage() && !gv.isDeclaration() && gv.hasName() &&
+        is_shared_runtime_value(gv)) {
+      gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+      gv.setVisibility(llvm::GlobalValue::DefaultVisibility);
+    }
+  }
+
+  auto shared_module =
+      clone_module_to_context(runtime_module, get_this_thread_context());
+  for (auto &gv : shared_module->global_values()) {
+    // Keep the unused definitions, kernels linked later may need them.
+    if (gv.hasLinkOnceLinkage()) {
+      gv.setLinkage(
+          llvm::GlobalValue::getWeakLinkage(gv.hasLinkOnceODRLinkage()));
+    }
+  }
+  jit->add_shared_module(std::move(shared_module));
+
+  // From now on, link_compiled_tasks() only links the small functions into the
+  // kernels, and declarations of the others.
+  int num_inlined = 0;
+  for (auto &f : *runtime_module) {
+    if (f.isDeclaration()) {
+      continue;
+    }
+    // add_struct_for_func() patches the body of parallel_struct_for.
+    if (f.getName() == "parallel_struct_for" ||
+        f.hasFnAttribute(llvm::Attribute::AlwaysInline) ||
+        num_instructions(&f) <= kMaxInlinedRuntimeFunctionSize) {
+      num_inlined++;
+      continue;
+    }
+    f.deleteBody();
+    f.setComdat(nullptr);
+  }
+  for (auto &var : runtime_module->globals()) {
+    if (!var.isDeclaration() && is_shared_runtime_value(var)) {
+      var.setInitializer(nullptr);
+      var.setLinkage(llvm::GlobalValue::ExternalLinkage);
+      var.setComdat(nullptr);
+    }
+  }
+  TI_TRACE("Shared runtime module created, {} small functions are inlined",
+           num_inlined);
 }
 
 // Note: runtime_module = init_module < struct_module
@@ -498,6 +569,13 @@ std::unique_ptr<llvm::Module> TaichiLLVMContext::module_from_file(
       function_pass_manager.doFinalization();
       patch_intrinsic("thread_idx", llvm::Intrinsic::amdgcn_workitem_id_x);
       patch_intrinsic("block_idx", llvm::Intrinsic::amdgcn_workgroup_id_x);
+
+      patch_intrinsic("amdgpu_wavefront_size",
+                      llvm::Intrinsic::amdgcn_wavefrontsize);
+      patch_intrinsic("amdgpu_ballot", llvm::Intrinsic::amdgcn_ballot, true,
+                      {llvm::Type::getInt64Ty(*ctx)});
+      patch_intrinsic("amdgpu_ds_bpermute",
+                      llvm::Intrinsic::amdgcn_ds_bpermute);
 #endif
     }
   }
@@ -551,14 +629,10 @@ void TaichiLLVMContext::add_struct_module(std::unique_ptr<Module> module,
   linking_context_data->struct_modules[tree_id] =
       clone_module_to_context(module.get(), linking_context_data->llvm_context);
 
-  for (auto &[id, data] : per_thread_data_) {
-    if (id == std::this_thread::get_id()) {
-      continue;
-    }
-    data->struct_modules[tree_id] =
-        clone_module_to_context(module.get(), data->llvm_context);
-  }
-
+  // The other threads clone the module once they compile a kernel accessing
+  // the tree, see get_struct_function(), so that declaring a tree does not
+  // cost a clone per compilation thread.
+  std::lock_guard<std::mutex> _(struct_modules_mut_);
   this_thread_data->struct_modules[tree_id] = std::move(module);
 }
 template <typename T>
@@ -716,6 +790,11 @@ void TaichiLLVMContext::mark_function_as_cuda_kernel(llvm::Function *func,
   }
 }
 
+void TaichiLLVMContext::set_cuda_kernel_max_reg(llvm::Function *func,
+                                                int max_reg) {
+  insert_nvvm_annotation(func, "maxnreg", max_reg);
+}
+
 void TaichiLLVMContext::eliminate_unused_functions(
     llvm::Module *module,
     std::function<bool(const std::string &)> export_indicator) {
@@ -835,17 +914,11 @@ void TaichiLLVMContext::update_runtime_jit_module(
 
 void TaichiLLVMContext::delete_snode_tree(int id) {
   TI_ASSERT(linking_context_data->struct_modules.erase(id));
+  std::lock_guard<std::mutex> _(struct_modules_mut_);
+  TI_ASSERT(main_thread_data_->struct_modules.erase(id));
   for (auto &[thread_id, data] : per_thread_data_) {
-    TI_ASSERT(data->struct_modules.erase(id));
-  }
-}
-
-void TaichiLLVMContext::fetch_this_thread_struct_module() {
-  ThreadLocalData *data = get_this_thread_data();
-  if (data->struct_modules.empty()) {
-    for (auto &[id, mod] : main_thread_data_->struct_modules) {
-      data->struct_modules[id] = clone_module_to_this_thread_context(mod.get());
-    }
+    // Only the threads that have used the tree have a clone.
+    data->struct_modules.erase(id);
   }
 }
 
@@ -866,7 +939,15 @@ llvm::Module *TaichiLLVMContext::get_this_thread_runtime_module() {
 llvm::Function *TaichiLLVMContext::get_struct_function(const std::string &name,
                                                        int tree_id) {
   auto *data = get_this_thread_data();
-  return data->struct_modules[tree_id]->getFunction(name);
+  auto iter = data->struct_modules.find(tree_id);
+  if (iter == data->struct_modules.end()) {
+    std::lock_guard<std::mutex> _(struct_modules_mut_);
+    auto *mod = main_thread_data_->struct_modules.at(tree_id).get();
+    iter = data->struct_modules
+               .emplace(tree_id, clone_module_to_this_thread_context(mod))
+               .first;
+  }
+  return iter->second->getFunction(name);
 }
 
 llvm::Type *TaichiLLVMContext::get_runtime_type(const std::string &name) {
@@ -925,6 +1006,8 @@ LLVMCompiledKernel TaichiLLVMContext::link_compiled_tasks(
         llvm::CloneModule(*linking_context_data->struct_modules[tree_id]),
         llvm::Linker::LinkOnlyNeeded | llvm::Linker::OverrideFromSrc);
   }
+  // With cpu_shared_runtime, this only has the definitions of the small
+  // runtime functions, see init_shared_runtime_module().
   auto runtime_module =
       llvm::CloneModule(*linking_context_data->runtime_module);
   for (auto tls_size : tls_sizes) {
@@ -125,7 +125,9 @@ class TaichiLLVMContext {
 
   void mark_function_as_cuda_kernel(llvm::Function *func, int block_dim = 0);
 
-  void fetch_this_thread_struct_module();
+  // Caps the registers per thread of a CUDA kernel function.
+  void set_cuda_kernel_max_reg(llvm::Function *func, int max_reg);
+
   llvm::Module *get_this_thread_runtime_module();
   llvm::Function *get_runtime_function(const std::string &name);
   llvm::Function *get_struct_function(const std::string &name, int tree_id);
@@ -162,6 +164,11 @@ class TaichiLLVMContext {
 
   void update_runtime_jit_module(std::unique_ptr<llvm::Module> module);
 
+  // Compiles the runtime module once for the JIT session, and strips the
+  // runtime module used by link_compiled_tasks() down to declarations, except
+  // for small functions.
+  void init_shared_runtime_module();
+
   std::unordered_map<std::thread::id, std::unique_ptr<ThreadLocalData>>
       per_thread_data_;
 
@@ -171,6 +178,9 @@ class TaichiLLVMContext {
   ThreadLocalData *main_thread_data_{nullptr};
   std::mutex mut_;
   std::mutex thread_map_mut_;
+  // Guards the struct modules of the main thread, which the other threads
+  // clone theirs from.
+  std::mutex struct_modules_mut_;
 
   std::unordered_map<int, std::vector<std::string>> snode_tree_funcs_;
 };
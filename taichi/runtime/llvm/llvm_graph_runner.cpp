@@ -0,0 +1,79 @@
+#include "taichi/runtime/llvm/llvm_graph_runner.h"
+
+#include <algorithm>
+
+#if defined(TI_WITH_CUDA)
+#include "taichi/runtime/llvm/llvm_runtime_executor.h"
+#include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/rhi/cuda/cuda_graph.h"
+
+namespace taichi::lang {
+
+namespace {
+
+constexpr std::size_t kMaxCachedCudaGraphs = 4;
+
+}  // namespace
+
+CudaGraphRunner::CudaGraphRunner(LlvmRuntimeExecutor *executor)
+    : executor_(executor) {
+}
+
+CudaGraphRunner::~CudaGraphRunner() = default;
+
+bool CudaGraphRunner::run(const aot::CompiledGraph &graph,
+                          const std::vector<int> &dispatch_ids,
+                          const std::vector<RuntimeContext *> &ctxs) {
+  const auto *config = executor_->get_config();
+  // Debug mode checks for errors after every kernel, and the profiler times
+  // every kernel, neither of which works with deferred launches.
+  if (config->debug || config->kernel_profiler) {
+    return false;
+  }
+  auto &cuda_ctx = CUDAContext::get_instance();
+  if (cuda_ctx.is_recording()) {
+    return false;
+  }
+
+  std::vector<CUDAGraph::RecordedLaunch> launches;
+  cuda_ctx.begin_recording(&launches);
+  try {
+    for (int i = 0; i < (int)dispatch_ids.size(); i++) {
+      graph.launch_dispatch(dispatch_ids[i], ctxs[i]);
+    }
+  } catch (...) {
+    cuda_ctx.interrupt_recording();
+    cuda_ctx.end_recording();
+    throw;
+  }
+  if (!cuda_ctx.end_recording() || launches.empty()) {
+    // Everything has been launched already.
+    return true;
+  }
+
+  std::lock_guard<std::mutex> _(mut_);
+  cuda_ctx.make_current();
+  auto iter = std::find_if(
+      cuda_graphs_.begin(), cuda_graphs_.end(),
+      [&](const std::unique_ptr<CUDAGraph> &g) { return g->matches(launches); });
+  std::unique_ptr<CUDAGraph> cuda_graph;
+  if (iter != cuda_graphs_.end()) {
+    cuda_graph = std::move(*iter);
+    cuda_graphs_.erase(iter);
+    cuda_graph->update(std::move(launches));
+  } else {
+    if (cuda_graphs_.size() == kMaxCachedCudaGraphs) {
+      cuda_graphs_.pop_back();
+    }
+    cuda_graph = std::make_unique<CUDAGraph>(std::move(launches));
+  }
+
+  void *stream = cuda_ctx.get_stream();
+  cuda_graph->launch(stream);
+  cuda_ctx.mark_stream_pending(stream);
+  cuda_graphs_.insert(cuda_graphs_.begin(), std::move(cuda_graph));
+  return true;
+}
+
+}  // namespace taichi::lang
+#endif  // TI_WITH_CUDA
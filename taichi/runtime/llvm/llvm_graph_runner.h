@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "taichi/aot/graph_data.h"
+
+namespace taichi::lang {
+
+class LlvmRuntimeExecutor;
+class CUDAGraph;
+
+// Runs the compute graphs of the CUDA backend as CUDA graphs.
+//
+// The kernel launches of every run are recorded rather than enqueued. If they
+// run the same kernels as a previous run, the executable graph built for that
+// run is updated with the new parameters and launch dimensions, so that the
+// whole sequence is submitted by a single cuGraphLaunch. A few graphs are kept
+// for sequences whose kernels depend on the arguments. Runs that have to copy
+// host arrays are launched kernel by kernel instead.
+class CudaGraphRunner : public aot::GraphRunner {
+ public:
+  explicit CudaGraphRunner(LlvmRuntimeExecutor *executor);
+  ~CudaGraphRunner() override;
+
+  bool run(const aot::CompiledGraph &graph,
+           const std::vector<int> &dispatch_ids,
+           const std::vector<RuntimeContext *> &ctxs) override;
+
+ private:
+  LlvmRuntimeExecutor *const executor_;
+  std::mutex mut_;
+  // Most recently used first.
+  std::vector<std::unique_ptr<CUDAGraph>> cuda_graphs_;
+};
+
+}  // namespace taichi::lang
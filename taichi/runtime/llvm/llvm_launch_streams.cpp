@@ -0,0 +1,48 @@
+#include "taichi/runtime/llvm/llvm_launch_streams.h"
+
+#include <algorithm>
+
+#if defined(TI_WITH_CUDA)
+#include "taichi/rhi/cuda/cuda_context.h"
+
+namespace taichi::lang {
+
+CudaLaunchStreams::CudaLaunchStreams(int num_streams) {
+  for (int i = 1; i < num_streams; i++) {
+    streams_.push_back(CUDAContext::get_instance().create_stream());
+  }
+}
+
+CudaLaunchStreams::~CudaLaunchStreams() {
+  for (auto *stream : streams_) {
+    CUDAContext::get_instance().destroy_stream(stream);
+  }
+}
+
+int CudaLaunchStreams::num_streams() const {
+  return streams_.size() + 1;
+}
+
+void CudaLaunchStreams::select(int stream) {
+  update_origin();
+  CUDAContext::get_instance().set_stream(get(stream));
+}
+
+void CudaLaunchStreams::wait(int stream, int dependency) {
+  update_origin();
+  CUDAContext::get_instance().stream_wait_stream(get(stream), get(dependency));
+}
+
+void CudaLaunchStreams::update_origin() {
+  void *current = CUDAContext::get_instance().get_stream();
+  if (std::find(streams_.begin(), streams_.end(), current) == streams_.end()) {
+    origin_ = current;
+  }
+}
+
+void *CudaLaunchStreams::get(int stream) const {
+  return stream == 0 ? origin_ : streams_[stream - 1];
+}
+
+}  // namespace taichi::lang
+#endif  // TI_WITH_CUDA
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "taichi/program/launch_queue.h"
+
+namespace taichi::lang {
+
+// Spreads the deferred launches of the CUDA backend over a few non-blocking
+// streams besides the one the calling thread is bound to. Dependencies
+// between the streams are expressed by events.
+class CudaLaunchStreams : public LaunchStreams {
+ public:
+  explicit CudaLaunchStreams(int num_streams);
+  ~CudaLaunchStreams() override;
+
+  int num_streams() const override;
+
+  void select(int stream) override;
+
+  void wait(int stream, int dependency) override;
+
+ private:
+  // Stream 0 is whichever stream the calling thread is bound to when none of
+  // |streams_| is selected.
+  void update_origin();
+  void *get(int stream) const;
+
+  void *origin_{nullptr};
+  std::vector<void *> streams_;
+};
+
+}  // namespace taichi::lang
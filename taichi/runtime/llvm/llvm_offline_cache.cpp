@@ -1,5 +1,6 @@
 #include "llvm_offline_cache.h"
 
+#include <algorithm>
 #include <queue>
 
 #include "llvm/AsmParser/Parser.h"
@@ -15,6 +16,7 @@
 #include "taichi/ir/transforms.h"
 #include "taichi/program/kernel.h"
 #include "taichi/runtime/llvm/llvm_context.h"
+#include "taichi/runtime/llvm/llvm_offline_cache_pack.h"
 #include "taichi/util/io.h"
 #include "taichi/util/lock.h"
 #include "taichi/util/offline_cache.h"
@@ -40,9 +42,57 @@ static std::vector<std::string> get_possible_llvm_cache_filename_by_key(
   return {
       key + "." + offline_cache::kLlvmCacheFilenameLLExt,
       key + "." + offline_cache::kLlvmCacheFilenameBCExt,
+      key + "." + offline_cache::kLlvmCacheFilenameNativeExt,
   };
 }
 
+static std::string get_llvm_cache_native_code_file_path(
+    const std::string &dir,
+    const std::string &key) {
+  return taichi::join_path(
+      dir, key + "." + offline_cache::kLlvmCacheFilenameNativeExt);
+}
+
+static std::string get_llvm_cache_shared_kernel_file_path(
+    const std::string &dir,
+    const std::string &key) {
+  return taichi::join_path(
+      dir, key + "." + offline_cache::kLlvmCacheFilenameKernelPackExt);
+}
+
+void copy_pack_metadata(const std::string &key,
+                        const LlvmOfflineCachePack::Entry &entry,
+                        LlvmOfflineCache::KernelCacheData &kernel) {
+  kernel.kernel_key = key;
+  kernel.args = entry.metadata.args;
+  kernel.compiled_data.tasks = entry.metadata.compiled_data.tasks;
+  kernel.size = entry.metadata.size;
+  kernel.created_at = entry.metadata.created_at;
+  kernel.last_used_at = entry.metadata.last_used_at;
+}
+
+void mangle_task_names(const std::string &kernel_key,
+                       LLVMCompiledKernel &compiled_data) {
+  for (auto &offload : compiled_data.tasks) {
+    std::string mangled_name =
+        offline_cache::mangle_name(offload.name, kernel_key);
+    auto func = compiled_data.module->getFunction(offload.name);
+    TI_ASSERT(func != nullptr);
+    func->setName(mangled_name);
+    offload.name = mangled_name;
+  }
+}
+
+bool has_new_fields(const LlvmOfflineCache &data,
+                    const LlvmOfflineCache &old_data) {
+  for (const auto &[id, field] : data.fields) {
+    if (old_data.fields.find(id) == old_data.fields.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace
 
 namespace offline_cache {
@@ -90,7 +140,8 @@ struct CacheCleanerUtils<LlvmOfflineCache> {
   static bool is_valid_cache_file(const CacheCleanerConfig &config,
                                   const std::string &name) {
     std::string ext = filename_extension(name);
-    return ext == kLlvmCacheFilenameLLExt || ext == kLlvmCacheFilenameBCExt;
+    return ext == kLlvmCacheFilenameLLExt || ext == kLlvmCacheFilenameBCExt ||
+           ext == kLlvmCacheFilenameNativeExt;
   }
 };
 
@@ -99,13 +150,38 @@ struct CacheCleanerUtils<LlvmOfflineCache> {
 // static
 std::unique_ptr<LlvmOfflineCacheFileReader> LlvmOfflineCacheFileReader::make(
     const std::string &path,
-    LlvmOfflineCache::Format format) {
+    LlvmOfflineCache::Format format,
+    offline_cache::CacheStorage *remote) {
   LlvmOfflineCache data;
+  if (format & Format::SHARED) {
+    // The metadata file is replaced in one step, so it is read without the
+    // lock. It only holds the fields, and may not be written yet while the
+    // kernels of other processes are already there.
+    load_meta_data(data, path, /*with_lock=*/false);
+    data.kernels.clear();
+    return std::unique_ptr<LlvmOfflineCacheFileReader>(
+        new LlvmOfflineCacheFileReader(path, std::move(data), format,
+                                       nullptr, remote));
+  }
   if (!load_meta_data(data, path)) {
     return nullptr;
   }
+  std::unique_ptr<LlvmOfflineCachePack> pack{nullptr};
+  if (format & Format::PACKED) {
+    // No lock needed: records are only ever appended, and compaction replaces
+    // the file in one step.
+    pack = LlvmOfflineCachePack::open(path);
+    if (!pack) {
+      return nullptr;
+    }
+    data.kernels.clear();
+    for (const auto &[key, entry] : pack->entries()) {
+      copy_pack_metadata(key, entry, data.kernels[key]);
+    }
+  }
   return std::unique_ptr<LlvmOfflineCacheFileReader>(
-      new LlvmOfflineCacheFileReader(path, std::move(data), format));
+      new LlvmOfflineCacheFileReader(path, std::move(data), format,
+                                     std::move(pack), nullptr));
 }
 
 bool LlvmOfflineCacheFileReader::load_meta_data(
@@ -146,10 +222,18 @@ bool LlvmOfflineCacheFileReader::load_meta_data(
 LlvmOfflineCacheFileReader::LlvmOfflineCacheFileReader(
     const std::string &path,
     LlvmOfflineCache &&data,
-    LlvmOfflineCache::Format format)
-    : path_(path), data_(std::move(data)), format_(format) {
+    LlvmOfflineCache::Format format,
+    std::unique_ptr<LlvmOfflineCachePack> pack,
+    offline_cache::CacheStorage *remote)
+    : path_(path),
+      data_(std::move(data)),
+      format_(format),
+      pack_(std::move(pack)),
+      remote_(remote) {
 }
 
+LlvmOfflineCacheFileReader::~LlvmOfflineCacheFileReader() = default;
+
 size_t LlvmOfflineCacheFileReader::get_num_snode_trees() {
   return data_.fields.size();
 }
@@ -168,28 +252,147 @@ bool LlvmOfflineCacheFileReader::get_field_cache(
   return true;
 }
 
+bool LlvmOfflineCacheFileReader::has_kernel(const std::string &key) {
+  std::lock_guard<std::mutex> _(kernels_mut_);
+  if (data_.kernels.find(key) != data_.kernels.end()) {
+    return true;
+  }
+  if (!(format_ & Format::SHARED)) {
+    return false;
+  }
+  const auto path = get_llvm_cache_shared_kernel_file_path(path_, key);
+  return taichi::path_exists(path) ||
+         fetch_remote_file(
+             key + "." + offline_cache::kLlvmCacheFilenameKernelPackExt, path);
+}
+
+LlvmOfflineCache::KernelCacheData *LlvmOfflineCacheFileReader::find_kernel(
+    const std::string &key) {
+  auto itr = data_.kernels.find(key);
+  if (itr != data_.kernels.end()) {
+    return &itr->second;
+  }
+  if (!(format_ & Format::SHARED)) {
+    return nullptr;
+  }
+  // Only the metadata is kept, load_module() maps the file again.
+  const auto path = get_llvm_cache_shared_kernel_file_path(path_, key);
+  if (!taichi::path_exists(path)) {
+    fetch_remote_file(
+        key + "." + offline_cache::kLlvmCacheFilenameKernelPackExt, path);
+  }
+  auto pack = LlvmOfflineCachePack::open_file(path);
+  const auto *entry = pack ? pack->find(key) : nullptr;
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  // The cleaning evicts the kernels used least recently first.
+  taichi::touch_file(path);
+  auto &kernel = data_.kernels[key];
+  copy_pack_metadata(key, *entry, kernel);
+  return &kernel;
+}
+
+bool LlvmOfflineCacheFileReader::fetch_remote_file(
+    const std::string &filename,
+    const std::string &path,
+    const std::string &device) const {
+  if (remote_ == nullptr) {
+    return false;
+  }
+  std::string bytes;
+  const auto key = offline_cache::make_remote_cache_key(
+      offline_cache::kLlvmCachSubPath, filename, device);
+  if (!remote_->get(key, bytes)) {
+    return false;
+  }
+  TI_DEBUG("Fetched {} from the remote offline cache", key);
+  // Other processes may be looking it up too.
+  return taichi::write_file_atomically(path, bytes.data(), bytes.size());
+}
+
+bool LlvmOfflineCacheFileReader::get_native_code(
+    LLVMCompiledKernel &res,
+    const std::string &key,
+    const std::string &native_code_key) {
+  TI_AUTO_PROF;
+  std::lock_guard<std::mutex> _(kernels_mut_);
+  auto *kernel_data = find_kernel(key);
+  if (kernel_data == nullptr) {
+    return false;
+  }
+  const auto path = get_llvm_cache_native_code_file_path(path_, key);
+  const auto filename =
+      key + "." + offline_cache::kLlvmCacheFilenameNativeExt;
+  LlvmOfflineCache::NativeCodeCacheData data;
+  bool found = taichi::path_exists(path) && read_from_binary_file(data, path);
+  if (found && data.native_code_key != native_code_key) {
+    TI_DEBUG("Native code of kernel={} is for {}, not {}", key,
+             data.native_code_key, native_code_key);
+    found = false;
+  }
+  // The remote store keeps the native code of each device.
+  if (!found && fetch_remote_file(filename, path, native_code_key)) {
+    found = read_from_binary_file(data, path) &&
+            data.native_code_key == native_code_key;
+  }
+  if (!found) {
+    return false;
+  }
+  kernel_data->last_used_at = std::time(nullptr);
+  res = LLVMCompiledKernel(std::move(data.tasks), nullptr);
+  res.native_code_key = std::move(data.native_code_key);
+  res.native_code = std::move(data.native_code);
+  return true;
+}
+
+bool LlvmOfflineCacheFileReader::get_native_kernel_cache(
+    LlvmOfflineCache::KernelCacheData &res,
+    const std::string &key,
+    const std::string &native_code_key) {
+  if (!get_native_code(res.compiled_data, key, native_code_key)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> _(kernels_mut_);
+  const auto &kernel_data = data_.kernels.at(key);
+  res.kernel_key = key;
+  res.args = kernel_data.args;
+  res.created_at = kernel_data.created_at;
+  res.last_used_at = kernel_data.last_used_at;
+  return true;
+}
+
 bool LlvmOfflineCacheFileReader::get_kernel_cache(
     LlvmOfflineCache::KernelCacheData &res,
     const std::string &key,
-    llvm::LLVMContext &llvm_ctx) {
+    llvm::LLVMContext &llvm_ctx,
+    bool keep_module) {
   TI_AUTO_PROF;
-  auto itr = data_.kernels.find(key);
-  if (itr == data_.kernels.end()) {
+  std::lock_guard<std::mutex> _(kernels_mut_);
+  auto *found = find_kernel(key);
+  if (found == nullptr) {
     TI_DEBUG("Cannot find kernel={}", key);
     return false;
   }
 
-  auto &kernel_data = itr->second;
+  auto &kernel_data = *found;
   auto &data = kernel_data.compiled_data;
   if (!data.module) {
     std::string filename_prefix = taichi::join_path(path_, key);
-    data.module = load_module(filename_prefix, key, llvm_ctx);
-    if (!data.module) {
-      data_.kernels.erase(itr);
+    auto module = load_module(filename_prefix, key, llvm_ctx);
+    if (!module) {
+      data_.kernels.erase(key);
       return false;  // Must return
     }
+    if (keep_module) {
+      data.module = std::move(module);
+      res.compiled_data = data.clone();
+    } else {
+      res.compiled_data = LLVMCompiledKernel(data.tasks, std::move(module));
+    }
+  } else {
+    res.compiled_data = data.clone();
   }
-  res.compiled_data = data.clone();
 
   kernel_data.last_used_at = std::time(nullptr);
 
@@ -207,7 +410,9 @@ bool LlvmOfflineCacheFileReader::get_kernel_cache(
       verified = false;
     }
   }
-  if (!verified) {
+  if (!verified && (format_ & Format::SHARED)) {
+    taichi::remove(get_llvm_cache_shared_kernel_file_path(path_, key));
+  } else if (!verified && !(format_ & Format::PACKED)) {
     for (const auto &f : get_possible_llvm_cache_filename_by_key(key)) {
       taichi::remove(taichi::join_path(path_, f));
     }
@@ -221,7 +426,13 @@ std::unique_ptr<llvm::Module> LlvmOfflineCacheFileReader::load_module(
     const std::string &key,
     llvm::LLVMContext &llvm_ctx) const {
   TI_AUTO_PROF;
-  if (format_ & Format::BC) {
+  if (format_ & Format::SHARED) {
+    auto pack = LlvmOfflineCachePack::open_file(
+        get_llvm_cache_shared_kernel_file_path(path_, key));
+    return pack ? pack->load_module(key, llvm_ctx) : nullptr;
+  } else if (format_ & Format::PACKED) {
+    return pack_->load_module(key, llvm_ctx);
+  } else if (format_ & Format::BC) {
     LlvmModuleBitcodeLoader loader;
     return loader
         .set_bitcode_path(path_prefix + "." +
@@ -247,6 +458,16 @@ std::unique_ptr<llvm::Module> LlvmOfflineCacheFileReader::load_module(
 void LlvmOfflineCacheFileWriter::dump(const std::string &path,
                                       LlvmOfflineCache::Format format,
                                       bool merge_with_old) {
+  // Before the task names are mangled, as they are in the native code.
+  dump_native_code(path);
+  if (format & Format::SHARED) {
+    dump_shared(path, merge_with_old);
+    return;
+  } else if (format & Format::PACKED) {
+    dump_packed(path, merge_with_old);
+    return;
+  }
+
   auto write_llvm_module =
       [](const std::string &filename,
          std::function<void(llvm::raw_os_ostream & os)> writer) {
@@ -266,11 +487,11 @@ void LlvmOfflineCacheFileWriter::dump(const std::string &path,
     auto &[k, v] = *iter;
     std::size_t size = 0;  // bytes
     std::string filename_prefix = taichi::join_path(path, k);
-    {
+    // Kernels loaded from native code are cached already.
+    if (v.compiled_data.module) {
       mangle_offloaded_task_name(k, v.compiled_data);
       auto &data = v.compiled_data;
       auto *mod = data.module.get();
-      TI_ASSERT(mod != nullptr);
       if (format & Format::LL) {
         std::string filename =
             filename_prefix + "." + offline_cache::kLlvmCacheFilenameLLExt;
@@ -354,6 +575,217 @@ void LlvmOfflineCacheFileWriter::dump(const std::string &path,
   ts.write_to_file(get_llvm_cache_metadata_json_file_path(path));
 }
 
+void LlvmOfflineCacheFileWriter::dump_packed(const std::string &path,
+                                             bool merge_with_old) {
+  taichi::create_directories(path);
+  std::string lock_path = taichi::join_path(path, kMetadataFileLockName);
+  if (!lock_with_file(lock_path)) {
+    TI_WARN(
+        "Lock {} failed. You can run 'ti ticache clean -p {}' and try again.",
+        lock_path, path);
+    return;
+  }
+  auto _ = make_cleanup([&lock_path]() {
+    if (!unlock_with_file(lock_path)) {
+      TI_WARN(
+          "Unlock {} failed. You can remove this .lock file manually and try "
+          "again.",
+          lock_path);
+    }
+  });
+
+  std::unique_ptr<LlvmOfflineCachePack> pack{nullptr};
+  if (merge_with_old) {
+    pack = LlvmOfflineCachePack::open(path);
+  }
+  if (!pack) {
+    // Start over. This also drops a pack file of another version, which
+    // cannot be appended to.
+    LlvmOfflineCachePack::remove(path);
+  }
+
+  // Kernels that are already cached only need their last-used time updated.
+  LlvmOfflineCachePack::RecordBuilder builder;
+  for (auto &[k, v] : data_.kernels) {
+    TI_ASSERT(v.created_at);
+    TI_ASSERT(v.last_used_at);
+    if (pack && pack->find(k)) {
+      builder.touch_kernel(k, v.last_used_at);
+    } else if (v.compiled_data.module) {
+      mangle_offloaded_task_name(k, v.compiled_data);
+      v.size = builder.add_kernel(v);
+    }
+  }
+  if (!LlvmOfflineCachePack::append(path, builder)) {
+    TI_WARN("Failed to write the offline cache to {}", path);
+    return;
+  }
+
+  // The metadata file only holds the fields now, and is left untouched
+  // unless a new field is cached.
+  data_.kernels.clear();
+  LlvmOfflineCache old_data;
+  const bool has_old_data =
+      merge_with_old &&
+      LlvmOfflineCacheFileReader::load_meta_data(old_data, path, false);
+  if (has_old_data) {
+    if (!has_new_fields(data_, old_data)) {
+      return;
+    }
+    merge_with(std::move(old_data));
+  }
+  data_.version[0] = TI_VERSION_MAJOR;
+  data_.version[1] = TI_VERSION_MINOR;
+  data_.version[2] = TI_VERSION_PATCH;
+  write_to_binary_file(data_, get_llvm_cache_metadata_file_path(path));
+}
+
+// static
+bool LlvmOfflineCacheFileWriter::publish_kernel(
+    const std::string &path,
+    const LlvmOfflineCache::KernelCacheData &data,
+    offline_cache::CacheStorage *remote) {
+  const auto file_path =
+      get_llvm_cache_shared_kernel_file_path(path, data.kernel_key);
+  if (!data.compiled_data.module || taichi::path_exists(file_path)) {
+    return true;
+  }
+  auto kernel = data.clone();
+  mangle_task_names(kernel.kernel_key, kernel.compiled_data);
+  LlvmOfflineCachePack::RecordBuilder builder;
+  builder.add_kernel(kernel);
+  if (!LlvmOfflineCachePack::publish(file_path, builder)) {
+    TI_DEBUG("Failed to write {}", file_path);
+    return false;
+  }
+  if (remote != nullptr) {
+    const auto file = io::MappedFile::create(file_path);
+    const auto key = offline_cache::make_remote_cache_key(
+        offline_cache::kLlvmCachSubPath,
+        data.kernel_key + "." +
+            offline_cache::kLlvmCacheFilenameKernelPackExt);
+    if (file == nullptr || !remote->put(key, file->data(), file->size())) {
+      TI_DEBUG("Failed to put {} to the remote offline cache", key);
+    }
+  }
+  return true;
+}
+
+// static
+bool LlvmOfflineCacheFileWriter::publish_native_code(
+    offline_cache::CacheStorage *remote,
+    const std::string &kernel_key,
+    const LLVMCompiledKernel &data) {
+  if (remote == nullptr || data.native_code.empty()) {
+    return true;
+  }
+  LlvmOfflineCache::NativeCodeCacheData native;
+  native.native_code_key = data.native_code_key;
+  native.tasks = data.tasks;
+  native.native_code = data.native_code;
+  BinaryOutputSerializer writer;
+  writer.initialize();
+  writer(native);
+  writer.finalize();
+  const auto key = offline_cache::make_remote_cache_key(
+      offline_cache::kLlvmCachSubPath,
+      kernel_key + "." + offline_cache::kLlvmCacheFilenameNativeExt,
+      data.native_code_key);
+  if (!remote->put(key, writer.data.data(), writer.head)) {
+    TI_DEBUG("Failed to put {} to the remote offline cache", key);
+    return false;
+  }
+  return true;
+}
+
+void LlvmOfflineCacheFileWriter::dump_shared(const std::string &path,
+                                             bool merge_with_old) {
+  taichi::create_directories(path);
+  // LlvmProgramImpl publishes its kernels as they are compiled.
+  for (auto &[k, v] : data_.kernels) {
+    TI_ASSERT(v.created_at);
+    TI_ASSERT(v.last_used_at);
+    const auto file_path = get_llvm_cache_shared_kernel_file_path(path, k);
+    if (!v.compiled_data.module || taichi::path_exists(file_path)) {
+      continue;
+    }
+    mangle_offloaded_task_name(k, v.compiled_data);
+    LlvmOfflineCachePack::RecordBuilder builder;
+    v.size = builder.add_kernel(v);
+    if (!LlvmOfflineCachePack::publish(file_path, builder)) {
+      TI_WARN("Failed to write the offline cache to {}", file_path);
+    }
+  }
+
+  // The metadata file only holds the fields. It is only rewritten when a new
+  // field is cached, under the lock, and replaced in one step for the readers
+  // that don't take it.
+  data_.kernels.clear();
+  LlvmOfflineCache old_data;
+  if (merge_with_old &&
+      LlvmOfflineCacheFileReader::load_meta_data(old_data, path, false) &&
+      !has_new_fields(data_, old_data)) {
+    return;
+  }
+  std::string lock_path = taichi::join_path(path, kMetadataFileLockName);
+  if (!lock_with_file(lock_path)) {
+    TI_WARN(
+        "Lock {} failed. You can run 'ti ticache clean -p {}' and try again.",
+        lock_path, path);
+    return;
+  }
+  auto _ = make_cleanup([&lock_path]() {
+    if (!unlock_with_file(lock_path)) {
+      TI_WARN(
+          "Unlock {} failed. You can remove this .lock file manually and try "
+          "again.",
+          lock_path);
+    }
+  });
+  old_data = LlvmOfflineCache();
+  if (merge_with_old &&
+      LlvmOfflineCacheFileReader::load_meta_data(old_data, path, false)) {
+    merge_with(std::move(old_data));
+  }
+  data_.version[0] = TI_VERSION_MAJOR;
+  data_.version[1] = TI_VERSION_MINOR;
+  data_.version[2] = TI_VERSION_PATCH;
+  BinaryOutputSerializer writer;
+  writer.initialize();
+  writer(data_);
+  writer.finalize();
+  const auto metadata_path = get_llvm_cache_metadata_file_path(path);
+  if (!taichi::write_file_atomically(metadata_path, writer.data.data(),
+                                     writer.head)) {
+    TI_WARN("Failed to write {}", metadata_path);
+  }
+}
+
+void LlvmOfflineCacheFileWriter::dump_native_code(const std::string &path) {
+  taichi::create_directories(path);
+  for (auto &[k, v] : data_.kernels) {
+    auto &compiled_data = v.compiled_data;
+    if (compiled_data.native_code.empty()) {
+      continue;
+    }
+    LlvmOfflineCache::NativeCodeCacheData data;
+    data.native_code_key = compiled_data.native_code_key;
+    data.tasks = compiled_data.tasks;
+    data.native_code = std::move(compiled_data.native_code);
+    // Replaces the native code for another target, if any. Other processes
+    // may have the file mapped, so it is replaced rather than overwritten.
+    BinaryOutputSerializer writer;
+    writer.initialize();
+    writer(data);
+    writer.finalize();
+    const auto native_path = get_llvm_cache_native_code_file_path(path, k);
+    if (!taichi::write_file_atomically(native_path, writer.data.data(),
+                                       writer.head)) {
+      TI_DEBUG("Failed to write {}", native_path);
+    }
+  }
+}
+
 void LlvmOfflineCacheFileWriter::merge_with(LlvmOfflineCache &&data) {
   // Note: merge this->data_ with data, new cover old
   auto &new_kernels = data_.kernels;
@@ -382,21 +814,22 @@ void LlvmOfflineCacheFileWriter::mangle_offloaded_task_name(
     const std::string &kernel_key,
     LLVMCompiledKernel &compiled_data) {
   if (!mangled_) {
-    for (auto &offload : compiled_data.tasks) {
-      std::string mangled_name =
-          offline_cache::mangle_name(offload.name, kernel_key);
-      auto func = compiled_data.module->getFunction(offload.name);
-      TI_ASSERT(func != nullptr);
-      func->setName(mangled_name);
-      offload.name = mangled_name;
-    }
+    mangle_task_names(kernel_key, compiled_data);
   }
 }
 
 void LlvmOfflineCacheFileWriter::clean_cache(const std::string &path,
                                              CleanCachePolicy policy,
                                              int max_bytes,
-                                             double cleaning_factor) {
+                                             double cleaning_factor,
+                                             LlvmOfflineCache::Format format) {
+  if (format & Format::SHARED) {
+    clean_shared_cache(path, policy, max_bytes, cleaning_factor);
+    return;
+  } else if (format & Format::PACKED) {
+    clean_packed_cache(path, policy, max_bytes, cleaning_factor);
+    return;
+  }
   using CacheCleaner = offline_cache::CacheCleaner<LlvmOfflineCache>;
   offline_cache::CacheCleanerConfig config;
   config.path = path;
@@ -409,6 +842,165 @@ void LlvmOfflineCacheFileWriter::clean_cache(const std::string &path,
   CacheCleaner::run(config);
 }
 
+void LlvmOfflineCacheFileWriter::clean_packed_cache(const std::string &path,
+                                                    CleanCachePolicy policy,
+                                                    int max_bytes,
+                                                    double cleaning_factor) {
+  using offline_cache::CleanOldCreated;
+  using offline_cache::CleanOldUsed;
+  using offline_cache::CleanOldVersion;
+  if (policy == offline_cache::NotClean || !taichi::path_exists(path)) {
+    return;
+  }
+  std::string lock_path = taichi::join_path(path, kMetadataFileLockName);
+  if (!lock_with_file(lock_path)) {
+    TI_WARN("Lock {} failed. You can run 'ti cache clean -p {}' and try again.",
+            lock_path, path);
+    return;
+  }
+  auto _ = make_cleanup([&lock_path]() {
+    if (!unlock_with_file(lock_path)) {
+      TI_WARN(
+          "Unlock {} failed. You can remove this .lock file manually and try "
+          "again.",
+          lock_path);
+    }
+  });
+
+  auto pack = LlvmOfflineCachePack::open(path);
+  if (!pack) {
+    if (policy & CleanOldVersion) {  // Corrupted or written by another version
+      LlvmOfflineCachePack::remove(path);
+    }
+    return;
+  }
+  const auto &entries = pack->entries();
+  const std::size_t cnt = cleaning_factor * entries.size();
+  if (pack->live_bytes() < (std::size_t)max_bytes || cnt == 0) {
+    return;
+  }
+
+  using Entry = std::pair<const std::string, LlvmOfflineCachePack::Entry>;
+  std::function<bool(const Entry *, const Entry *)> cmp{nullptr};
+  if (policy & CleanOldUsed) {  // LRU
+    cmp = [](const Entry *a, const Entry *b) {
+      return a->second.metadata.last_used_at < b->second.metadata.last_used_at;
+    };
+  } else if (policy & CleanOldCreated) {  // FIFO
+    cmp = [](const Entry *a, const Entry *b) {
+      return a->second.metadata.created_at < b->second.metadata.created_at;
+    };
+  }
+  if (!cmp) {
+    return;
+  }
+  // Keeps the |cnt| oldest entries.
+  std::priority_queue<const Entry *, std::vector<const Entry *>,
+                      decltype(cmp)>
+      q(cmp);
+  for (const auto &e : entries) {
+    if (q.size() == cnt && cmp(&e, q.top())) {
+      q.pop();
+    }
+    if (q.size() < cnt) {
+      q.push(&e);
+    }
+  }
+
+  // Evicting only appends a record per kernel. The file is compacted once
+  // most of it is taken by stale records.
+  LlvmOfflineCachePack::RecordBuilder builder;
+  std::size_t evicted_bytes = 0;
+  while (!q.empty()) {
+    builder.evict_kernel(q.top()->first);
+    taichi::remove(get_llvm_cache_native_code_file_path(path, q.top()->first));
+    evicted_bytes += q.top()->second.bitcode_size;
+    q.pop();
+  }
+  if (!LlvmOfflineCachePack::append(path, builder)) {
+    TI_WARN("Failed to write the offline cache to {}", path);
+    return;
+  }
+  if (pack->file_size() > 2 * (pack->live_bytes() - evicted_bytes)) {
+    pack.reset();
+    LlvmOfflineCachePack::compact(path);
+  }
+}
+
+void LlvmOfflineCacheFileWriter::clean_shared_cache(const std::string &path,
+                                                    CleanCachePolicy policy,
+                                                    int max_bytes,
+                                                    double cleaning_factor) {
+  using offline_cache::CleanOldCreated;
+  using offline_cache::CleanOldUsed;
+  using offline_cache::CleanOldVersion;
+  if (policy == offline_cache::NotClean || !taichi::path_exists(path)) {
+    return;
+  }
+  // One process cleans at a time, the others skip it instead of waiting.
+  std::string lock_path = taichi::join_path(path, kMetadataFileLockName);
+  if (!try_lock_with_file(lock_path)) {
+    return;
+  }
+  auto _ = make_unlocker(lock_path);
+
+  struct KernelFile {
+    std::string key;
+    std::size_t size{0};
+    std::time_t modified_at{0};  // Touched by the readers on every use
+  };
+  std::vector<KernelFile> files;
+  std::size_t total_bytes = 0;
+  const std::string ext =
+      std::string(".") + offline_cache::kLlvmCacheFilenameKernelPackExt;
+  taichi::traverse_directory(path, [&](const std::string &name, bool is_dir) {
+    struct stat st;
+    if (is_dir || !ends_with(name, ext) ||
+        ::stat(taichi::join_path(path, name).c_str(), &st) != 0) {
+      return;
+    }
+    files.push_back({name.substr(0, name.size() - ext.size()),
+                     (std::size_t)st.st_size, st.st_mtime});
+    total_bytes += st.st_size;
+  });
+  const std::size_t cnt = cleaning_factor * files.size();
+  if (total_bytes < (std::size_t)max_bytes || cnt == 0) {
+    return;
+  }
+
+  // Files of other versions of Taichi fail to open, and go first.
+  std::vector<std::pair<std::time_t, const KernelFile *>> order;
+  for (const auto &f : files) {
+    std::time_t time = 0;
+    if (policy & CleanOldUsed) {  // LRU
+      time = f.modified_at;
+    } else if (auto pack = LlvmOfflineCachePack::open_file(
+                   get_llvm_cache_shared_kernel_file_path(path, f.key))) {
+      const auto *entry = pack->find(f.key);
+      time = entry ? entry->metadata.created_at : 0;  // FIFO
+    }
+    order.emplace_back(time, &f);
+  }
+  if (!(policy & (CleanOldUsed | CleanOldCreated))) {
+    if (!(policy & CleanOldVersion)) {
+      return;
+    }
+    // Only the files of other versions.
+    order.erase(std::remove_if(order.begin(), order.end(),
+                               [](const auto &o) { return o.first != 0; }),
+                order.end());
+  }
+  std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+    return a.first < b.first;
+  });
+  // Readers that have opened a file keep it, the others recompile.
+  for (std::size_t i = 0; i < std::min(cnt, order.size()); i++) {
+    const auto &key = order[i].second->key;
+    taichi::remove(get_llvm_cache_shared_kernel_file_path(path, key));
+    taichi::remove(get_llvm_cache_native_code_file_path(path, key));
+  }
+}
+
 LlvmOfflineCache::KernelCacheData LlvmOfflineCache::KernelCacheData::clone()
     const {
   LlvmOfflineCache::KernelCacheData result;
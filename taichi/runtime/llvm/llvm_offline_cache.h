@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 
 #ifdef TI_WITH_LLVM
 #include "llvm/IR/Module.h"
@@ -13,12 +14,22 @@
 
 namespace taichi::lang {
 
+class LlvmOfflineCachePack;
+
 struct LlvmOfflineCache {
   using Version = uint16[3];  // {MAJOR, MINOR, PATCH}
 
   enum Format {
     LL = 0x01,
     BC = 0x10,
+    // Bitcode of all the kernels in a single, memory-mapped file. See
+    // LlvmOfflineCachePack.
+    PACKED = 0x100,
+    // A pack file per kernel, named after its key and replaced in one step
+    // when written. Kernels are published as soon as they are compiled and
+    // loaded on first use, so that processes sharing the cache neither take
+    // its lock nor wait for each other to exit.
+    SHARED = 0x1000,
   };
 
   struct KernelCacheData {
@@ -41,6 +52,17 @@ struct LlvmOfflineCache {
     TI_IO_DEF(kernel_key, args, compiled_data, size, created_at, last_used_at);
   };
 
+  // The machine code of a kernel, kept in a file of its own next to the
+  // kernel regardless of the format. |tasks| are named after the symbols in
+  // |native_code|.
+  struct NativeCodeCacheData {
+    std::string native_code_key;
+    std::vector<OffloadedTask> tasks;
+    std::string native_code;
+
+    TI_IO_DEF(native_code_key, tasks, native_code);
+  };
+
   struct FieldCacheData {
     struct SNodeCacheData {
       int id{0};
@@ -105,9 +127,31 @@ struct LlvmOfflineCache {
 
 class LlvmOfflineCacheFileReader {
  public:
+  ~LlvmOfflineCacheFileReader();
+
+  // The loaded module is kept for later queries of |key| unless |keep_module|
+  // is false. Modules of offloaded tasks are loaded on the compilation
+  // threads, each with an LLVM context of its own, and are not kept.
   bool get_kernel_cache(LlvmOfflineCache::KernelCacheData &res,
                         const std::string &key,
-                        llvm::LLVMContext &llvm_ctx);
+                        llvm::LLVMContext &llvm_ctx,
+                        bool keep_module = true);
+
+  // Whether |key| is in the cache. The module may still fail to load. With
+  // Format::SHARED, this includes the kernels published by other processes
+  // since the reader was made, and those of the remote store of the reader.
+  bool has_kernel(const std::string &key);
+
+  // Loads the native code of |key| into |res| without its module, if it has
+  // been cached for |native_code_key|.
+  bool get_native_code(LLVMCompiledKernel &res,
+                       const std::string &key,
+                       const std::string &native_code_key);
+
+  // Same as above, along with the launch arguments of the kernel.
+  bool get_native_kernel_cache(LlvmOfflineCache::KernelCacheData &res,
+                               const std::string &key,
+                               const std::string &native_code_key);
 
   bool get_field_cache(LlvmOfflineCache::FieldCacheData &res,
                        int snode_tree_id);
@@ -116,7 +160,8 @@ class LlvmOfflineCacheFileReader {
 
   static std::unique_ptr<LlvmOfflineCacheFileReader> make(
       const std::string &path,
-      LlvmOfflineCache::Format format = LlvmOfflineCache::Format::LL);
+      LlvmOfflineCache::Format format = LlvmOfflineCache::Format::LL,
+      offline_cache::CacheStorage *remote = nullptr);
 
   static bool load_meta_data(LlvmOfflineCache &data,
                              const std::string &cache_file_path,
@@ -125,15 +170,33 @@ class LlvmOfflineCacheFileReader {
  private:
   LlvmOfflineCacheFileReader(const std::string &path,
                              LlvmOfflineCache &&data,
-                             LlvmOfflineCache::Format format);
+                             LlvmOfflineCache::Format format,
+                             std::unique_ptr<LlvmOfflineCachePack> pack,
+                             offline_cache::CacheStorage *remote);
 
   std::unique_ptr<llvm::Module> load_module(const std::string &path_prefix,
                                             const std::string &key,
                                             llvm::LLVMContext &llvm_ctx) const;
 
+  // Requires |kernels_mut_|. Returns nullptr if |key| is not cached.
+  LlvmOfflineCache::KernelCacheData *find_kernel(const std::string &key);
+
+  // Format::SHARED: copies the file |filename| of the remote store, made for
+  // |device|, to |path|.
+  bool fetch_remote_file(const std::string &filename,
+                         const std::string &path,
+                         const std::string &device = "") const;
+
   std::string path_;
   LlvmOfflineCache data_;
   LlvmOfflineCache::Format format_;
+  // Only set for Format::PACKED.
+  std::unique_ptr<LlvmOfflineCachePack> pack_;
+  // Only used with Format::SHARED. Not owned.
+  offline_cache::CacheStorage *remote_{nullptr};
+  // Guards |data_.kernels|, which may be queried while other kernels are
+  // being compiled.
+  std::mutex kernels_mut_;
 };
 
 class LlvmOfflineCacheFileWriter {
@@ -162,12 +225,43 @@ class LlvmOfflineCacheFileWriter {
     mangled_ = true;
   }
 
-  static void clean_cache(const std::string &path,
-                          CleanCachePolicy policy,
-                          int max_bytes,
-                          double cleaning_factor);
+  // Format::SHARED: writes |data| to the cache in |path| right away, unless
+  // it is there already, so that other processes can load it before this one
+  // exits, and to |remote|, if any. |data| is left as is.
+  static bool publish_kernel(const std::string &path,
+                             const LlvmOfflineCache::KernelCacheData &data,
+                             offline_cache::CacheStorage *remote = nullptr);
+
+  // Format::SHARED: puts the native code of |kernel_key| to |remote|, for the
+  // device of its native_code_key. The local cache gets it from dump().
+  static bool publish_native_code(offline_cache::CacheStorage *remote,
+                                  const std::string &kernel_key,
+                                  const LLVMCompiledKernel &data);
+
+  static void clean_cache(
+      const std::string &path,
+      CleanCachePolicy policy,
+      int max_bytes,
+      double cleaning_factor,
+      LlvmOfflineCache::Format format = LlvmOfflineCache::Format::LL);
 
  private:
+  void dump_packed(const std::string &path, bool merge_with_old);
+
+  void dump_shared(const std::string &path, bool merge_with_old);
+
+  void dump_native_code(const std::string &path);
+
+  static void clean_packed_cache(const std::string &path,
+                                 CleanCachePolicy policy,
+                                 int max_bytes,
+                                 double cleaning_factor);
+
+  static void clean_shared_cache(const std::string &path,
+                                 CleanCachePolicy policy,
+                                 int max_bytes,
+                                 double cleaning_factor);
+
   void merge_with(LlvmOfflineCache &&data);
 
   void mangle_offloaded_task_name(const std::string &kernel_key,
@@ -0,0 +1,333 @@
+#include "taichi/runtime/llvm/llvm_offline_cache_pack.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Support/raw_ostream.h"
+#include "taichi/common/serialization.h"
+#include "taichi/common/version.h"
+#include "taichi/util/io.h"
+#include "taichi/util/offline_cache.h"
+
+namespace taichi::lang {
+namespace {
+
+constexpr char kPackFilename[] = "kernels";
+constexpr char kFileMagic[4] = {'T', 'I', 'P', 'K'};
+constexpr uint32 kRecordMagic = 0x52504954;  // "TIPR"
+// Every record starts at a multiple of this, which keeps the serialized
+// metadata and the bitcode aligned in the mapped file.
+constexpr std::size_t kRecordAlignment = 8;
+
+enum RecordKind : uint32 {
+  kKernelRecord = 1,  // Metadata and bitcode of a kernel
+  kTouchRecord = 2,   // New last-used time of a kernel
+  kEvictRecord = 3,   // The kernel is no longer cached
+};
+
+struct FileHeader {
+  char magic[4];
+  uint16 version[3];
+  uint16 padding{0};
+  uint32 reserved{0};
+};
+
+struct RecordHeader {
+  uint32 magic{kRecordMagic};
+  uint32 kind{0};
+  uint64 key_size{0};
+  uint64 metadata_size{0};
+  uint64 bitcode_size{0};
+};
+
+static_assert(sizeof(FileHeader) % kRecordAlignment == 0);
+static_assert(sizeof(RecordHeader) % kRecordAlignment == 0);
+
+std::size_t align_up(std::size_t size) {
+  return (size + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+FileHeader make_file_header() {
+  FileHeader header;
+  std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.version[0] = TI_VERSION_MAJOR;
+  header.version[1] = TI_VERSION_MINOR;
+  header.version[2] = TI_VERSION_PATCH;
+  return header;
+}
+
+template <typename T>
+std::vector<uint8> serialize(const T &t) {
+  BinaryOutputSerializer writer;
+  writer.initialize();
+  writer(t);
+  writer.finalize();
+  return std::vector<uint8>(writer.data.begin(),
+                            writer.data.begin() + writer.head);
+}
+
+bool write_file(const std::string &path,
+                const std::vector<uint8> &data,
+                bool append) {
+  auto mode = std::ios::out | std::ios::binary;
+  if (append) {
+    mode |= std::ios::app;
+  }
+  std::ofstream os(path, mode);
+  if (!os.is_open()) {
+    TI_DEBUG("File {} open failed", path);
+    return false;
+  }
+  os.write((const char *)data.data(), data.size());
+  return os.good();
+}
+
+}  // namespace
+
+void LlvmOfflineCachePack::RecordBuilder::add_record(
+    uint32 kind,
+    const std::string &key,
+    const void *metadata,
+    std::size_t metadata_size,
+    const void *bitcode,
+    std::size_t bitcode_size) {
+  RecordHeader header;
+  header.kind = kind;
+  header.key_size = key.size();
+  header.metadata_size = metadata_size;
+  header.bitcode_size = bitcode_size;
+
+  auto append = [this](const void *data, std::size_t size) {
+    auto *bytes = (const uint8 *)data;
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+    buffer_.resize(align_up(buffer_.size()), 0);
+  };
+  append(&header, sizeof(header));
+  append(key.data(), key.size());
+  append(metadata, metadata_size);
+  append(bitcode, bitcode_size);
+}
+
+std::size_t LlvmOfflineCachePack::RecordBuilder::add_kernel(
+    const LlvmOfflineCache::KernelCacheData &data) {
+  auto *mod = data.compiled_data.module.get();
+  TI_ASSERT(mod != nullptr);
+  std::string bitcode;
+  {
+    llvm::raw_string_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(*mod, os);
+  }
+  // |compiled_data.module| is not serialized.
+  auto metadata = serialize(data);
+  add_record(kKernelRecord, data.kernel_key, metadata.data(), metadata.size(),
+             bitcode.data(), bitcode.size());
+  return bitcode.size();
+}
+
+void LlvmOfflineCachePack::RecordBuilder::touch_kernel(
+    const std::string &key,
+    std::time_t last_used_at) {
+  int64 time = last_used_at;
+  add_record(kTouchRecord, key, &time, sizeof(time), nullptr, 0);
+}
+
+void LlvmOfflineCachePack::RecordBuilder::evict_kernel(const std::string &key) {
+  add_record(kEvictRecord, key, nullptr, 0, nullptr, 0);
+}
+
+// static
+std::string LlvmOfflineCachePack::get_pack_file_path(const std::string &dir) {
+  return taichi::join_path(dir, std::string(kPackFilename) + "." +
+                                    offline_cache::kLlvmCacheFilenamePackExt);
+}
+
+// static
+std::unique_ptr<LlvmOfflineCachePack> LlvmOfflineCachePack::open(
+    const std::string &dir) {
+  return open_file(get_pack_file_path(dir));
+}
+
+// static
+std::unique_ptr<LlvmOfflineCachePack> LlvmOfflineCachePack::open_file(
+    const std::string &path) {
+  TI_AUTO_PROF;
+  if (!taichi::path_exists(path)) {
+    TI_DEBUG("File {} not found", path);
+    return nullptr;
+  }
+  // Large files are memory-mapped by LLVM.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    TI_DEBUG("Fail to open {}: {}", path, buffer.getError().message());
+    return nullptr;
+  }
+  auto pack = std::unique_ptr<LlvmOfflineCachePack>(
+      new LlvmOfflineCachePack(std::move(buffer.get())));
+  if (!pack->build_index()) {
+    TI_DEBUG("The offline cache file {} is corrupted or old", path);
+    return nullptr;
+  }
+  return pack;
+}
+
+// static
+bool LlvmOfflineCachePack::append(const std::string &dir,
+                                  const RecordBuilder &builder) {
+  if (builder.empty()) {
+    return true;
+  }
+  const auto path = get_pack_file_path(dir);
+  if (!taichi::path_exists(path)) {
+    auto header = make_file_header();
+    std::vector<uint8> data((uint8 *)&header,
+                            (uint8 *)&header + sizeof(header));
+    data.insert(data.end(), builder.buffer_.begin(), builder.buffer_.end());
+    return write_file(path, data, /*append=*/false);
+  }
+  return write_file(path, builder.buffer_, /*append=*/true);
+}
+
+// static
+bool LlvmOfflineCachePack::publish(const std::string &path,
+                                   const RecordBuilder &builder) {
+  auto header = make_file_header();
+  std::vector<uint8> data((uint8 *)&header, (uint8 *)&header + sizeof(header));
+  data.insert(data.end(), builder.buffer_.begin(), builder.buffer_.end());
+  return taichi::write_file_atomically(path, data.data(), data.size());
+}
+
+// static
+bool LlvmOfflineCachePack::compact(const std::string &dir) {
+  TI_AUTO_PROF;
+  auto pack = open(dir);
+  if (!pack) {
+    return false;
+  }
+  auto header = make_file_header();
+  RecordBuilder builder;
+  builder.buffer_.assign((uint8 *)&header, (uint8 *)&header + sizeof(header));
+  for (const auto &[key, entry] : pack->entries()) {
+    auto metadata = serialize(entry.metadata);
+    builder.add_record(kKernelRecord, key, metadata.data(), metadata.size(),
+                       pack->buffer_->getBufferStart() + entry.bitcode_offset,
+                       entry.bitcode_size);
+  }
+  const auto path = get_pack_file_path(dir);
+  // Replaces the file in one step. Readers keep the old file mapped.
+  if (!taichi::write_file_atomically(path, builder.buffer_.data(),
+                                     builder.buffer_.size())) {
+    TI_WARN("Failed to replace {}", path);
+    return false;
+  }
+  return true;
+}
+
+// static
+bool LlvmOfflineCachePack::remove(const std::string &dir) {
+  return taichi::remove(get_pack_file_path(dir));
+}
+
+LlvmOfflineCachePack::LlvmOfflineCachePack(
+    std::unique_ptr<llvm::MemoryBuffer> buffer)
+    : buffer_(std::move(buffer)) {
+}
+
+bool LlvmOfflineCachePack::build_index() {
+  const auto *data = (const uint8 *)buffer_->getBufferStart();
+  const std::size_t size = buffer_->getBufferSize();
+
+  FileHeader file_header;
+  if (size < sizeof(file_header)) {
+    return false;
+  }
+  std::memcpy(&file_header, data, sizeof(file_header));
+  const auto expected_header = make_file_header();
+  if (std::memcmp(file_header.magic, expected_header.magic,
+                  sizeof(kFileMagic)) != 0 ||
+      std::memcmp(file_header.version, expected_header.version,
+                  sizeof(file_header.version)) != 0) {
+    return false;
+  }
+
+  std::size_t offset = sizeof(file_header);
+  while (offset + sizeof(RecordHeader) <= size) {
+    RecordHeader header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    std::size_t key_offset = offset + sizeof(header);
+    std::size_t metadata_offset = key_offset + align_up(header.key_size);
+    std::size_t bitcode_offset =
+        metadata_offset + align_up(header.metadata_size);
+    std::size_t end = bitcode_offset + align_up(header.bitcode_size);
+    if (header.magic != kRecordMagic || header.key_size > size ||
+        header.metadata_size > size || header.bitcode_size > size ||
+        end > size) {
+      // A torn write at the end of the file. Everything before it is intact.
+      TI_DEBUG("Stop reading the offline cache at offset {}", offset);
+      break;
+    }
+    std::string key((const char *)data + key_offset, header.key_size);
+    offset = end;
+
+    if (header.kind == kKernelRecord) {
+      Entry entry;
+      if (!read_from_binary(entry.metadata, data + metadata_offset,
+                            header.metadata_size)) {
+        continue;
+      }
+      entry.bitcode_offset = bitcode_offset;
+      entry.bitcode_size = header.bitcode_size;
+      entry.metadata.size = header.bitcode_size;
+      auto iter = entries_.find(key);
+      if (iter != entries_.end()) {
+        live_bytes_ -= iter->second.bitcode_size;
+      }
+      live_bytes_ += entry.bitcode_size;
+      entries_[key] = std::move(entry);
+    } else if (header.kind == kTouchRecord) {
+      auto iter = entries_.find(key);
+      if (iter != entries_.end() && header.metadata_size == sizeof(int64)) {
+        int64 time{0};
+        std::memcpy(&time, data + metadata_offset, sizeof(time));
+        iter->second.metadata.last_used_at = time;
+      }
+    } else if (header.kind == kEvictRecord) {
+      auto iter = entries_.find(key);
+      if (iter != entries_.end()) {
+        live_bytes_ -= iter->second.bitcode_size;
+        entries_.erase(iter);
+      }
+    }
+  }
+  return true;
+}
+
+const LlvmOfflineCachePack::Entry *LlvmOfflineCachePack::find(
+    const std::string &key) const {
+  auto iter = entries_.find(key);
+  return iter == entries_.end() ? nullptr : &iter->second;
+}
+
+std::unique_ptr<llvm::Module> LlvmOfflineCachePack::load_module(
+    const std::string &key,
+    llvm::LLVMContext &llvm_ctx) const {
+  TI_AUTO_PROF;
+  const auto *entry = find(key);
+  if (!entry) {
+    return nullptr;
+  }
+  llvm::StringRef bitcode(buffer_->getBufferStart() + entry->bitcode_offset,
+                          entry->bitcode_size);
+  auto mod =
+      llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, key), llvm_ctx);
+  if (!mod) {
+    TI_DEBUG("Fail to parse the bitcode of kernel={}: {}", key,
+             llvm::toString(mod.takeError()));
+    return nullptr;
+  }
+  return std::move(mod.get());
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef TI_WITH_LLVM
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "taichi/runtime/llvm/llvm_offline_cache.h"
+
+namespace taichi::lang {
+
+// A single-file store for the kernels of the LLVM offline cache.
+//
+// The file is an append-only log of records. A record either adds a kernel
+// (its metadata and bitcode), updates the last-used time of a kernel, or
+// evicts a kernel; later records override earlier ones with the same key.
+// Readers map the file and build a hashed index from kernel keys to their
+// latest kernel record, so that a module is only parsed once its kernel is
+// requested. New records are appended to the end of the file, so writers never
+// rewrite data that other processes may have mapped. The space held by
+// overridden or evicted records is reclaimed by compact().
+//
+// Appending and compacting must happen under the lock of the cache metadata.
+// Publishing a whole pack file does not need it.
+class LlvmOfflineCachePack {
+ public:
+  struct Entry {
+    // |compiled_data.module| is always nullptr.
+    LlvmOfflineCache::KernelCacheData metadata;
+    std::size_t bitcode_offset{0};
+    std::size_t bitcode_size{0};
+  };
+
+  // Collects records in memory, so that they are appended with a single
+  // write.
+  class RecordBuilder {
+   public:
+    // Serializes |data| along with the bitcode of |data.compiled_data.module|.
+    // Returns the size of the bitcode in bytes.
+    std::size_t add_kernel(const LlvmOfflineCache::KernelCacheData &data);
+    void touch_kernel(const std::string &key, std::time_t last_used_at);
+    void evict_kernel(const std::string &key);
+
+    bool empty() const {
+      return buffer_.empty();
+    }
+
+   private:
+    friend class LlvmOfflineCachePack;
+
+    void add_record(uint32 kind,
+                    const std::string &key,
+                    const void *metadata,
+                    std::size_t metadata_size,
+                    const void *bitcode,
+                    std::size_t bitcode_size);
+
+    std::vector<uint8> buffer_;
+  };
+
+  static std::string get_pack_file_path(const std::string &dir);
+
+  // Maps the pack file of the cache in |dir| and indexes its records. Returns
+  // nullptr if there is no such file, or if it was written by another version
+  // of Taichi.
+  static std::unique_ptr<LlvmOfflineCachePack> open(const std::string &dir);
+
+  // Same as above, for the pack file at |path|.
+  static std::unique_ptr<LlvmOfflineCachePack> open_file(
+      const std::string &path);
+
+  // Appends the records of |builder| to the pack file of the cache in |dir|,
+  // which is created if needed.
+  static bool append(const std::string &dir, const RecordBuilder &builder);
+
+  // Writes a pack file holding the records of |builder| to |path|, replacing
+  // the file in one step. This needs no lock: other processes open either the
+  // old or the new file. Used for the files of Format::SHARED, one per kernel.
+  static bool publish(const std::string &path, const RecordBuilder &builder);
+
+  // Rewrites the pack file of the cache in |dir| with only the latest record
+  // of every kernel that is still cached. Readers that have mapped the old
+  // file are not affected.
+  static bool compact(const std::string &dir);
+
+  // Removes the pack file of the cache in |dir|.
+  static bool remove(const std::string &dir);
+
+  const Entry *find(const std::string &key) const;
+
+  const std::unordered_map<std::string, Entry> &entries() const {
+    return entries_;
+  }
+
+  // Parses the bitcode of kernel |key| straight out of the mapped file.
+  // Returns nullptr if the kernel is not cached or its bitcode is broken.
+  std::unique_ptr<llvm::Module> load_module(const std::string &key,
+                                            llvm::LLVMContext &llvm_ctx) const;
+
+  // The bitcode size of every cached kernel, in bytes.
+  std::size_t live_bytes() const {
+    return live_bytes_;
+  }
+
+  std::size_t file_size() const {
+    return buffer_->getBufferSize();
+  }
+
+ private:
+  explicit LlvmOfflineCachePack(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+  // Returns false if the header of the file does not match.
+  bool build_index();
+
+  std::unique_ptr<llvm::MemoryBuffer> buffer_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::size_t live_bytes_{0};
+};
+
+}  // namespace taichi::lang
+#endif  // TI_WITH_LLVM
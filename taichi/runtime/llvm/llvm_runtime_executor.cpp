@@ -1,7 +1,15 @@
 #include "taichi/runtime/llvm/llvm_runtime_executor.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "taichi/runtime/llvm/branch_profile.h"
+#include "taichi/util/io.h"
 #include "taichi/runtime/llvm/llvm_offline_cache.h"
+#include "taichi/runtime/llvm/llvm_graph_runner.h"
+#include "taichi/runtime/llvm/llvm_launch_streams.h"
 #include "taichi/runtime/llvm/runtime_module/mem_request.h"
+#include "taichi/system/virtual_memory.h"
 #include "taichi/rhi/cpu/cpu_device.h"
 #include "taichi/rhi/cuda/cuda_device.h"
 #include "taichi/platform/cuda/detect_cuda.h"
@@ -55,7 +63,12 @@ LlvmRuntimeExecutor::LlvmRuntimeExecutor(CompileConfig &config,
   }
 
   snode_tree_buffer_manager_ = std::make_unique<SNodeTreeBufferManager>(this);
-  thread_pool_ = std::make_unique<ThreadPool>(config.cpu_max_num_threads);
+  if (config.cpu_work_stealing) {
+    work_stealing_thread_pool_ = std::make_unique<WorkStealingThreadPool>(
+        config.cpu_max_num_threads, config.cpu_pin_threads);
+  } else {
+    thread_pool_ = std::make_unique<ThreadPool>(config.cpu_max_num_threads);
+  }
   preallocated_device_buffer_ = nullptr;
 
   llvm_runtime_ = nullptr;
@@ -115,7 +128,13 @@ LlvmRuntimeExecutor::LlvmRuntimeExecutor(CompileConfig &config,
       CUDAContext::get_instance().set_profiler(nullptr);
     }
     CUDAContext::get_instance().set_debug(config.debug);
+    if (config.print_buffer_size > 0) {
+      CUDAContext::get_instance().set_print_buffer_size(
+          config.print_buffer_size);
+    }
     device_ = std::make_shared<cuda::CudaDevice>();
+    llvm_device()->set_caching_allocator_high_water_mark(
+        config.cached_allocator_high_water_mark);
 
     this->maybe_initialize_cuda_llvm_context();
   }
@@ -125,6 +144,8 @@ LlvmRuntimeExecutor::LlvmRuntimeExecutor(CompileConfig &config,
   if (config.arch == Arch::amdgpu) {
     AMDGPUContext::get_instance().set_debug(config.debug);
     device_ = std::make_shared<amdgpu::AmdgpuDevice>();
+    llvm_device()->set_caching_allocator_high_water_mark(
+        config.cached_allocator_high_water_mark);
 
     this->maybe_initialize_amdgpu_llvm_context();
   }
@@ -145,6 +166,23 @@ LlvmRuntimeExecutor::LlvmRuntimeExecutor(CompileConfig &config,
   this->initialize_host();
 }
 
+void LlvmRuntimeExecutor::cpu_parallel_for(
+    int splits,
+    const std::function<void(int, int)> &task) {
+  TI_ASSERT(thread_pool_ || work_stealing_thread_pool_);
+  auto body = [](void *context, int thread_id, int i) {
+    (*static_cast<const std::function<void(int, int)> *>(context))(thread_id,
+                                                                    i);
+  };
+  void *context = const_cast<std::function<void(int, int)> *>(&task);
+  if (work_stealing_thread_pool_) {
+    work_stealing_thread_pool_->run(splits, config_->cpu_max_num_threads,
+                                    context, body);
+  } else {
+    thread_pool_->run(splits, config_->cpu_max_num_threads, context, body);
+  }
+}
+
 TaichiLLVMContext *LlvmRuntimeExecutor::get_llvm_context(Arch arch) {
   if (arch_is_cpu(arch)) {
     return llvm_context_host_.get();
@@ -201,7 +239,7 @@ void LlvmRuntimeExecutor::print_list_manager_info(void *list_manager,
 void LlvmRuntimeExecutor::synchronize() {
   if (config_->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
-    CUDADriver::get_instance().stream_synchronize(nullptr);
+    CUDAContext::get_instance().synchronize_streams();
 #else
     TI_ERROR("No CUDA support");
 #endif
@@ -209,6 +247,41 @@ void LlvmRuntimeExecutor::synchronize() {
   fflush(stdout);
 }
 
+void LlvmRuntimeExecutor::ensure_ad_stack_spill_buffer(std::size_t size) {
+  std::lock_guard<std::mutex> _(ad_stack_spill_mut_);
+  if (size <= ad_stack_spill_size_) {
+    return;
+  }
+#if defined(TI_WITH_CUDA)
+  if (config_->arch == Arch::cuda) {
+    // The launches recorded so far read the arena pointer when they run.
+    CUDAContext::get_instance().interrupt_recording();
+  }
+#endif
+  synchronize();
+  if (ad_stack_spill_size_ > 0) {
+    llvm_device()->dealloc_memory(ad_stack_spill_alloc_);
+  }
+  // Grows geometrically so that a series of slightly larger launches do not
+  // reallocate every time.
+  size = std::max(size, ad_stack_spill_size_ * 2);
+  ad_stack_spill_alloc_ = llvm_device()->allocate_memory(
+      {size, /*host_write=*/false, /*host_read=*/false,
+       /*export_sharing=*/false, AllocUsage::Storage});
+  ad_stack_spill_size_ = size;
+  TI_TRACE("AD-stack spill arena grown to {} bytes", size);
+
+  auto *tlctx = llvm_context_device_ ? llvm_context_device_.get()
+                                     : llvm_context_host_.get();
+  tlctx->runtime_jit_module->call<void *, void *>(
+      "LLVMRuntime_set_ad_stack_spill_buffer", llvm_runtime_,
+      (void *)get_ndarray_alloc_info_ptr(ad_stack_spill_alloc_));
+}
+
+CachingAllocatorStats LlvmRuntimeExecutor::get_caching_allocator_stats() {
+  return llvm_device()->get_caching_allocator_stats();
+}
+
 uint64 LlvmRuntimeExecutor::fetch_result_uint64(int i, uint64 *result_buffer) {
   // TODO: We are likely doing more synchronization than necessary. Simplify the
   // sync logic when we fetch the result.
@@ -227,6 +300,152 @@ uint64 LlvmRuntimeExecutor::fetch_result_uint64(int i, uint64 *result_buffer) {
   return ret;
 }
 
+void LlvmRuntimeExecutor::fetch_results(int begin,
+                                        int n,
+                                        uint64 *dst,
+                                        uint64 *result_buffer) {
+  synchronize();
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    CUDADriver::get_instance().memcpy_device_to_host(
+        dst, result_buffer + begin, n * sizeof(uint64));
+#else
+    TI_NOT_IMPLEMENTED;
+#endif
+  } else {
+    std::memcpy(dst, result_buffer + begin, n * sizeof(uint64));
+  }
+}
+
+#if defined(TI_WITH_CUDA)
+namespace {
+
+class CudaDeferredResults : public DeferredResults {
+ public:
+  CudaDeferredResults(cuda::CudaPinnedMemoryPool *pool,
+                      void *staging,
+                      int n,
+                      void *event)
+      : pool_(pool), staging_(staging), values_(n), event_(event) {
+  }
+
+  ~CudaDeferredResults() override {
+    // The staging buffer can't be reused while the copy is in flight.
+    wait();
+  }
+
+  bool ready() override {
+    return staging_ == nullptr ||
+           CUDADriver::get_instance().event_query.call(event_) == 0;
+  }
+
+  const uint64 *wait() override {
+    if (staging_ != nullptr) {
+      // Gives the staging buffer and the event back as soon as possible.
+      CUDADriver::get_instance().event_synchronize(event_);
+      std::memcpy(values_.data(), staging_, values_.size() * sizeof(uint64));
+      CUDADriver::get_instance().event_destroy(event_);
+      pool_->release(staging_);
+      staging_ = nullptr;
+    }
+    return values_.data();
+  }
+
+ private:
+  cuda::CudaPinnedMemoryPool *pool_{nullptr};
+  void *staging_{nullptr};
+  std::vector<uint64> values_;
+  void *event_{nullptr};
+};
+
+}  // namespace
+#endif
+
+std::unique_ptr<DeferredResults> LlvmRuntimeExecutor::fetch_results_deferred(
+    int n,
+    uint64 *result_buffer) {
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    auto &driver = CUDADriver::get_instance();
+    // The copy has to be ordered with the launches recorded so far.
+    CUDAContext::get_instance().interrupt_recording();
+    void *stream = CUDAContext::get_instance().get_stream();
+    auto *pool = pinned_staging_pool();
+    if (void *staging = pool->acquire(n * sizeof(uint64))) {
+      driver.memcpy_device_to_host_async(staging, result_buffer,
+                                         n * sizeof(uint64), stream);
+      void *event = nullptr;
+      driver.event_create(&event, CU_EVENT_DISABLE_TIMING);
+      driver.event_record(event, stream);
+      return std::make_unique<CudaDeferredResults>(pool, staging, n, event);
+    }
+#else
+    TI_NOT_IMPLEMENTED;
+#endif
+  }
+  // The CPU kernels have returned by now.
+  std::vector<uint64> values(n);
+  fetch_results(0, n, values.data(), result_buffer);
+  return std::make_unique<HostDeferredResults>(std::move(values));
+}
+
+SNodeMemoryStats LlvmRuntimeExecutor::get_snode_memory_stats(
+    SNode *snode,
+    uint64 *result_buffer) {
+  TaichiLLVMContext *tlctx = llvm_context_device_ ? llvm_context_device_.get()
+                                                  : llvm_context_host_.get();
+  tlctx->runtime_jit_module->call<void *, int>(
+      "runtime_get_snode_memory_stats", llvm_runtime_, snode->id);
+  uint64 raw[taichi_snode_memory_stats_entries];
+  fetch_results(taichi_result_buffer_ret_value_id,
+                taichi_snode_memory_stats_entries, raw, result_buffer);
+
+  SNodeMemoryStats stats;
+  stats.snode_id = snode->id;
+  stats.tree_id = snode->get_snode_tree_id();
+  stats.name = snode->get_node_type_name_hinted();
+  stats.element_list_length = raw[0];
+  stats.element_list_bytes = raw[1];
+  stats.num_allocated_nodes = raw[2];
+  stats.data_bytes = raw[3];
+  // The free list is consumed from its front until the next gc.
+  stats.num_free_nodes = raw[4] > raw[8] ? raw[4] - raw[8] : 0;
+  stats.free_list_bytes = raw[5] + raw[7];
+  stats.num_recycled_nodes = raw[6];
+  stats.node_size = raw[9];
+  return stats;
+}
+
+MemoryStats LlvmRuntimeExecutor::get_memory_stats(
+    const std::vector<std::unique_ptr<SNodeTree>> &snode_trees,
+    uint64 *result_buffer) {
+  TI_ASSERT(arch_uses_llvm(config_->arch));
+  MemoryStats stats;
+  std::function<void(SNode *)> visit = [&](SNode *snode) {
+    if (snode->type != SNodeType::place) {
+      stats.snodes.push_back(get_snode_memory_stats(snode, result_buffer));
+    }
+    for (const auto &ch : snode->ch) {
+      visit(ch.get());
+    }
+  };
+  for (const auto &[_, size] : snode_tree_sizes_) {
+    stats.snode_tree_bytes += size;
+  }
+  for (const auto &tree : snode_trees) {
+    // Skip the destroyed trees.
+    if (snode_tree_sizes_.count(tree->id())) {
+      visit(tree->root());
+    }
+  }
+  stats.runtime_requested_bytes = runtime_query<std::size_t>(
+      "LLVMRuntime_get_total_requested_memory", result_buffer, llvm_runtime_);
+  auto caching_allocator_stats = get_caching_allocator_stats();
+  stats.cached_allocated_bytes = caching_allocator_stats.allocated_bytes;
+  stats.cached_reserved_bytes = caching_allocator_stats.reserved_bytes;
+  return stats;
+}
+
 std::size_t LlvmRuntimeExecutor::get_snode_num_dynamically_allocated(
     SNode *snode,
     uint64 *result_buffer) {
@@ -302,64 +521,28 @@ void LlvmRuntimeExecutor::print_memory_profiler_info(
   // E.g., 10000 is printed as "10,000".
   // TODO: is there a way to set locale only locally in this function?
 
-  std::function<void(SNode *, int)> visit = [&](SNode *snode, int depth) {
-    auto element_list =
-        runtime_query<void *>("LLVMRuntime_get_element_lists", result_buffer,
-                              llvm_runtime_, snode->id);
-
-    if (snode->type != SNodeType::place) {
-      fmt::print("SNode {:10}\n", snode->get_node_type_name_hinted());
-
-      if (element_list) {
-        fmt::print("  active element list:");
-        print_list_manager_info(element_list, result_buffer);
-
-        auto node_allocator =
-            runtime_query<void *>("LLVMRuntime_get_node_allocators",
-                                  result_buffer, llvm_runtime_, snode->id);
-
-        if (node_allocator) {
-          auto free_list = runtime_query<void *>("NodeManager_get_free_list",
-                                                 result_buffer, node_allocator);
-          auto recycled_list = runtime_query<void *>(
-              "NodeManager_get_recycled_list", result_buffer, node_allocator);
-
-          auto free_list_len = runtime_query<int32>(
-              "ListManager_get_num_elements", result_buffer, free_list);
-
-          auto recycled_list_len = runtime_query<int32>(
-              "ListManager_get_num_elements", result_buffer, recycled_list);
-
-          auto free_list_used = runtime_query<int32>(
-              "NodeManager_get_free_list_used", result_buffer, node_allocator);
-
-          auto data_list = runtime_query<void *>("NodeManager_get_data_list",
-                                                 result_buffer, node_allocator);
-          fmt::print("  data list:          ");
-          print_list_manager_info(data_list, result_buffer);
-
-          fmt::print(
-              "  Allocated elements={:n}; free list length={:n}; recycled list "
-              "length={:n}\n",
-              free_list_used, free_list_len, recycled_list_len);
-        }
-      }
+  const auto stats = get_memory_stats(snode_trees_, result_buffer);
+  for (const auto &sn : stats.snodes) {
+    fmt::print("SNode {:10}\n", sn.name);
+    if (sn.element_list_bytes == 0) {
+      continue;
     }
-    for (const auto &ch : snode->ch) {
-      visit(ch.get(), depth + 1);
+    fmt::print("  active element list: length={:n}  total={:.4f} MB\n",
+               sn.element_list_length, 1e-6 * sn.element_list_bytes);
+    if (sn.node_size != 0) {
+      fmt::print(
+          "  data list:           length={:n} x {:n} B  total={:.4f} MB\n",
+          sn.num_allocated_nodes, sn.node_size, 1e-6 * sn.data_bytes);
+      fmt::print(
+          "  Active elements={:n}; free elements={:n}; recycled "
+          "elements={:n}\n",
+          sn.num_active_nodes(), sn.num_free_nodes, sn.num_recycled_nodes);
     }
-  };
-
-  for (auto &a : snode_trees_) {
-    visit(a->root(), /*depth=*/0);
   }
 
-  auto total_requested_memory = runtime_query<std::size_t>(
-      "LLVMRuntime_get_total_requested_memory", result_buffer, llvm_runtime_);
-
   fmt::print(
       "Total requested dynamic memory (excluding alignment padding): {:n} B\n",
-      total_requested_memory);
+      stats.runtime_requested_bytes);
 }
 
 DevicePtr LlvmRuntimeExecutor::get_snode_tree_device_ptr(int tree_id) {
@@ -367,6 +550,12 @@ DevicePtr LlvmRuntimeExecutor::get_snode_tree_device_ptr(int tree_id) {
   return tree_alloc.get_ptr();
 }
 
+std::size_t LlvmRuntimeExecutor::get_snode_tree_buffer_size(
+    int tree_id) const {
+  auto it = snode_tree_sizes_.find(tree_id);
+  return it == snode_tree_sizes_.end() ? 0 : it->second;
+}
+
 void LlvmRuntimeExecutor::initialize_llvm_runtime_snodes(
     const LlvmOfflineCache::FieldCacheData &field_cache_data,
     uint64 *result_buffer) {
@@ -418,6 +607,7 @@ void LlvmRuntimeExecutor::initialize_llvm_runtime_snodes(
   }
 
   snode_tree_allocs_[tree_id] = alloc;
+  snode_tree_sizes_[tree_id] = rounded_size;
 
   bool all_dense = config_->demote_dense_struct_fors;
   for (size_t i = 0; i < snode_metas.size(); i++) {
@@ -438,12 +628,13 @@ void LlvmRuntimeExecutor::initialize_llvm_runtime_snodes(
       const auto snode_id = snode_metas[i].id;
       std::size_t node_size;
       auto element_size = snode_metas[i].cell_size_bytes;
-      if (snode_metas[i].type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
+      if (snode_metas[i].type == SNodeType::pointer ||
+          snode_metas[i].type == SNodeType::hash) {
+        // pointer or hash. Allocators are for single elements
         node_size = element_size;
       } else {
         // dynamic. Allocators are for the chunks
-        node_size = sizeof(void *) + element_size * snode_metas[i].chunk_size;
+        node_size = element_size * snode_metas[i].chunk_size;
       }
       TI_TRACE("Initializing allocator for snode {} (node size {})", snode_id,
                node_size);
@@ -491,20 +682,122 @@ DeviceAllocation LlvmRuntimeExecutor::allocate_memory_ndarray(
        config_->ndarray_use_cached_allocator,
        tlctx->runtime_jit_module,
        get_llvm_runtime(),
-       result_buffer});
+       result_buffer,
+       config_->arch == Arch::cuda && config_->ndarray_use_managed_memory});
+}
+
+void LlvmRuntimeExecutor::prefetch_ndarray(const DeviceAllocation &alloc,
+                                           bool read_only,
+                                           void *stream) {
+#if defined(TI_WITH_CUDA)
+  if (config_->arch == Arch::cuda && config_->ndarray_use_managed_memory) {
+    cuda_device()->prefetch_managed_memory(alloc, read_only, stream);
+  }
+#endif
 }
 
 void LlvmRuntimeExecutor::deallocate_memory_ndarray(DeviceAllocation handle) {
   cuda_device()->dealloc_memory(handle);
 }
 
+DeviceAllocation LlvmRuntimeExecutor::import_memory(void *ptr,
+                                                   std::size_t size) {
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    return cuda_device()->import_memory(ptr, size);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    return cpu_device()->import_memory(ptr, size);
+  }
+}
+
+namespace {
+
+struct MemoryIpcHandle {
+  int32 pid{0};
+  // The address in the exporting process.
+  uint64 ptr{0};
+  // From the base of the CUDA allocation |cuda_handle| refers to.
+  uint64 offset{0};
+  char cuda_handle[64]{};
+};
+
+}  // namespace
+
+std::string LlvmRuntimeExecutor::export_memory_ipc_handle(DevicePtr ptr) {
+  MemoryIpcHandle handle;
+  handle.pid = PID::get_pid();
+  handle.ptr = (uint64)get_ndarray_alloc_info_ptr(ptr) + ptr.offset;
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    void *base = nullptr;
+    std::size_t size = 0;
+    CUDADriver::get_instance().mem_get_address_range(&base, &size,
+                                                     (void *)handle.ptr);
+    handle.offset = handle.ptr - (uint64)base;
+    CUDAIpcMemHandle cuda_handle;
+    CUDADriver::get_instance().ipc_get_mem_handle(&cuda_handle, base);
+    std::memcpy(handle.cuda_handle, cuda_handle.reserved,
+                sizeof(handle.cuda_handle));
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  return std::string((const char *)&handle, sizeof(handle));
+}
+
+void *LlvmRuntimeExecutor::open_memory_ipc_handle(
+    const std::string &handle_bytes,
+    std::function<void()> *release) {
+  MemoryIpcHandle handle;
+  TI_ERROR_IF(handle_bytes.size() != sizeof(handle),
+              "Invalid memory IPC handle of {} bytes", handle_bytes.size());
+  std::memcpy(&handle, handle_bytes.data(), sizeof(handle));
+  *release = nullptr;
+  if (handle.pid == PID::get_pid()) {
+    return (void *)handle.ptr;
+  }
+  TI_ERROR_IF(config_->arch != Arch::cuda,
+              "Memory of other processes can not be opened on {}",
+              arch_name(config_->arch));
+#if defined(TI_WITH_CUDA)
+  CUDAIpcMemHandle cuda_handle;
+  std::memcpy(cuda_handle.reserved, handle.cuda_handle,
+              sizeof(cuda_handle.reserved));
+  void *base = nullptr;
+  CUDADriver::get_instance().ipc_open_mem_handle(
+      &base, cuda_handle, CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+  *release = [base]() {
+    CUDADriver::get_instance().ipc_close_mem_handle(base);
+  };
+  return (char *)base + handle.offset;
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+cuda::CudaPinnedMemoryPool *LlvmRuntimeExecutor::pinned_staging_pool() {
+#if defined(TI_WITH_CUDA)
+  return cuda_device()->pinned_staging_pool();
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
 void LlvmRuntimeExecutor::fill_ndarray(const DeviceAllocation &alloc,
                                        std::size_t size,
                                        uint32_t data) {
   auto ptr = get_ndarray_alloc_info_ptr(alloc);
   if (config_->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
-    CUDADriver::get_instance().memsetd32((void *)ptr, data, size);
+    // Issued on the stream of the calling thread, as a synchronous memset on
+    // the legacy stream would not be ordered with non-blocking streams.
+    CUDAContext::get_instance().interrupt_recording();
+    void *stream = CUDAContext::get_instance().get_stream();
+    CUDADriver::get_instance().memsetd32_async((void *)ptr, data, size, stream);
+    CUDAContext::get_instance().mark_stream_pending(stream);
 #else
     TI_NOT_IMPLEMENTED
 #endif
@@ -513,6 +806,215 @@ void LlvmRuntimeExecutor::fill_ndarray(const DeviceAllocation &alloc,
   }
 }
 
+#if defined(TI_WITH_CUDA)
+namespace {
+
+StreamSemaphore record_cuda_semaphore(void *stream) {
+  void *event = nullptr;
+  CUDADriver::get_instance().event_create(&event, CU_EVENT_DISABLE_TIMING);
+  CUDADriver::get_instance().event_record(event, stream);
+  return std::make_shared<cuda::CudaStreamSemaphoreObject>(event);
+}
+
+}  // namespace
+#endif
+
+StreamSemaphore LlvmRuntimeExecutor::fill_ndarray_async(
+    const DeviceAllocation &alloc,
+    std::size_t size,
+    uint32_t data) {
+  auto ptr = get_ndarray_alloc_info_ptr(alloc);
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    // The fill has to be ordered with the launches recorded so far.
+    CUDAContext::get_instance().interrupt_recording();
+    void *stream = CUDAContext::get_instance().get_stream();
+    CUDADriver::get_instance().memsetd32_async((void *)ptr, data, size, stream);
+    return record_cuda_semaphore(stream);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  std::fill((uint32_t *)ptr, (uint32_t *)ptr + size, data);
+  return nullptr;
+}
+
+StreamSemaphore LlvmRuntimeExecutor::copy_ndarray_async(DevicePtr dst,
+                                                        DevicePtr src,
+                                                        std::size_t size) {
+  auto dst_ptr = (char *)get_ndarray_alloc_info_ptr(dst) + dst.offset;
+  auto src_ptr = (char *)get_ndarray_alloc_info_ptr(src) + src.offset;
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    CUDAContext::get_instance().interrupt_recording();
+    void *stream = CUDAContext::get_instance().get_stream();
+    CUDADriver::get_instance().memcpy_device_to_device_async(dst_ptr, src_ptr,
+                                                             size, stream);
+    return record_cuda_semaphore(stream);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  std::memcpy(dst_ptr, src_ptr, size);
+  return nullptr;
+}
+
+DeviceAllocation LlvmRuntimeExecutor::allocate_texture(
+    const ImageParams &params) {
+  TI_ERROR_IF(config_->arch != Arch::cuda,
+              "Textures are not supported on {}", arch_name(config_->arch));
+#if defined(TI_WITH_CUDA)
+  return cuda_device()->create_texture(params);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+void LlvmRuntimeExecutor::deallocate_texture(DeviceAllocation texture) {
+#if defined(TI_WITH_CUDA)
+  cuda_device()->destroy_texture(texture);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+void LlvmRuntimeExecutor::copy_buffer_to_texture(
+    DeviceAllocation texture,
+    DevicePtr src,
+    const BufferImageCopyParams &params) {
+#if defined(TI_WITH_CUDA)
+  CUDAContext::get_instance().interrupt_recording();
+  void *stream = CUDAContext::get_instance().get_stream();
+  cuda_device()->copy_buffer_to_texture(texture, src, params, stream);
+  CUDAContext::get_instance().mark_stream_pending(stream);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+uint64 LlvmRuntimeExecutor::get_texture_handle(const DeviceAllocation &texture,
+                                               bool rw) {
+#if defined(TI_WITH_CUDA)
+  return rw ? cuda_device()->get_surface_object(texture)
+            : cuda_device()->get_texture_object(texture);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+void LlvmRuntimeExecutor::wait_semaphore(const StreamSemaphore &sema) {
+  if (sema == nullptr || config_->arch != Arch::cuda) {
+    return;
+  }
+#if defined(TI_WITH_CUDA)
+  auto cuda_sema =
+      std::static_pointer_cast<cuda::CudaStreamSemaphoreObject>(sema);
+  CUDAContext::get_instance().interrupt_recording();
+  CUDADriver::get_instance().stream_wait_event(
+      CUDAContext::get_instance().get_stream(), cuda_sema->event(), 0);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+StreamSemaphore LlvmRuntimeExecutor::signal_semaphore() {
+  if (config_->arch != Arch::cuda) {
+    return nullptr;
+  }
+#if defined(TI_WITH_CUDA)
+  CUDAContext::get_instance().interrupt_recording();
+  return record_cuda_semaphore(CUDAContext::get_instance().get_stream());
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+StreamSemaphore LlvmRuntimeExecutor::copy_from_host_async(
+    DevicePtr dst,
+    const void *src,
+    std::size_t size,
+    const StreamSemaphore &wait) {
+  auto dst_ptr = (char *)get_ndarray_alloc_info_ptr(dst) + dst.offset;
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    std::lock_guard<std::mutex> _(transfer_mut_);
+    auto &driver = CUDADriver::get_instance();
+    auto *pool = pinned_staging_pool();
+    // Recycle the staging buffers of the copies that have completed.
+    auto &buffers = transfer_staging_buffers_;
+    buffers.erase(
+        std::remove_if(buffers.begin(), buffers.end(),
+                       [&](const std::pair<StreamSemaphore, void *> &buffer) {
+                         auto event = std::static_pointer_cast<
+                                          cuda::CudaStreamSemaphoreObject>(
+                                          buffer.first)
+                                          ->event();
+                         if (driver.event_query.call(event) != 0) {
+                           return false;
+                         }
+                         pool->release(buffer.second);
+                         return true;
+                       }),
+        buffers.end());
+
+    // Copies from pageable memory are staged by the driver before returning,
+    // so |src| is only used directly if no pinned memory is left.
+    void *staging = pool->acquire(size);
+    if (staging != nullptr) {
+      std::memcpy(staging, src, size);
+    }
+    if (transfer_stream_ == nullptr) {
+      transfer_stream_ = CUDAContext::get_instance().create_stream();
+    }
+    if (wait != nullptr) {
+      driver.stream_wait_event(
+          transfer_stream_,
+          std::static_pointer_cast<cuda::CudaStreamSemaphoreObject>(wait)
+              ->event(),
+          0);
+    }
+    driver.memcpy_host_to_device_async(
+        dst_ptr, staging ? staging : const_cast<void *>(src), size,
+        transfer_stream_);
+    CUDAContext::get_instance().mark_stream_pending(transfer_stream_);
+    auto sema = record_cuda_semaphore(transfer_stream_);
+    if (staging != nullptr) {
+      buffers.emplace_back(sema, staging);
+    }
+    return sema;
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  std::memcpy(dst_ptr, src, size);
+  return nullptr;
+}
+
+void LlvmRuntimeExecutor::copy_to_host(void *dst,
+                                       DevicePtr src,
+                                       std::size_t size) {
+  auto src_ptr = (char *)get_ndarray_alloc_info_ptr(src) + src.offset;
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    CUDAContext::get_instance().interrupt_recording();
+    void *stream = CUDAContext::get_instance().get_stream();
+    auto *pool = pinned_staging_pool();
+    void *staging = pool->acquire(size);
+    CUDADriver::get_instance().memcpy_device_to_host_async(
+        staging ? staging : dst, src_ptr, size, stream);
+    CUDADriver::get_instance().stream_synchronize(stream);
+    if (staging != nullptr) {
+      std::memcpy(dst, staging, size);
+      pool->release(staging);
+    }
+    return;
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  std::memcpy(dst, src_ptr, size);
+}
+
 uint64_t *LlvmRuntimeExecutor::get_ndarray_alloc_info_ptr(
     const DeviceAllocation &alloc) {
   if (config_->arch == Arch::cuda) {
@@ -526,8 +1028,51 @@ uint64_t *LlvmRuntimeExecutor::get_ndarray_alloc_info_ptr(
   }
 }
 
+uint64 *LlvmRuntimeExecutor::allocate_branch_profile_counters(
+    const std::string &task_key,
+    int num_branches) {
+  std::lock_guard<std::mutex> _(branch_profile_mut_);
+  branch_profile_counters_.emplace_back(
+      task_key, std::vector<uint64>(2 * num_branches, 0));
+  return branch_profile_counters_.back().second.data();
+}
+
 void LlvmRuntimeExecutor::finalize() {
   profiler_ = nullptr;
+  if (!branch_profile_counters_.empty()) {
+    // Identical tasks of different kernels share a profile.
+    std::unordered_map<std::string, BranchProfile> profiles;
+    for (const auto &[task_key, counters] : branch_profile_counters_) {
+      auto &profile = profiles[task_key];
+      profile.resize(counters.size() / 2);
+      for (std::size_t i = 0; i < profile.size(); i++) {
+        profile[i].first += counters[2 * i];
+        profile[i].second += counters[2 * i + 1];
+      }
+    }
+    create_directories(config_->pgo_profile_dir);
+    for (const auto &[task_key, profile] : profiles) {
+      save_branch_profile(
+          get_branch_profile_path(config_->pgo_profile_dir, task_key),
+          profile);
+    }
+    branch_profile_counters_.clear();
+  }
+#if defined(TI_WITH_CUDA)
+  if (transfer_stream_ != nullptr) {
+    CUDADriver::get_instance().stream_synchronize(transfer_stream_);
+    for (auto &[_, staging] : transfer_staging_buffers_) {
+      pinned_staging_pool()->release(staging);
+    }
+    transfer_staging_buffers_.clear();
+    CUDAContext::get_instance().destroy_stream(transfer_stream_);
+    transfer_stream_ = nullptr;
+  }
+#endif
+  if (ad_stack_spill_size_ > 0) {
+    llvm_device()->dealloc_memory(ad_stack_spill_alloc_);
+    ad_stack_spill_size_ = 0;
+  }
 #if defined(TI_WITH_CUDA)
   if (preallocated_device_buffer_ != nullptr) {
     cuda_device()->dealloc_memory(preallocated_device_buffer_alloc_);
@@ -624,16 +1169,22 @@ void LlvmRuntimeExecutor::materialize_runtime(MemoryPool *memory_pool,
   }
 
   if (arch_use_host_memory(config_->arch)) {
-    runtime_jit->call<void *>("runtime_get_mem_req_queue", llvm_runtime_);
-    auto mem_req_queue = fetch_result<void *>(taichi_result_buffer_ret_value_id,
-                                              *result_buffer_ptr);
-    memory_pool->set_queue((MemRequestQueue *)mem_req_queue);
-  }
-
-  if (arch_use_host_memory(config_->arch)) {
-    runtime_jit->call<void *, void *, void *>(
-        "LLVMRuntime_initialize_thread_pool", llvm_runtime_, thread_pool_.get(),
-        (void *)ThreadPool::static_run);
+    // The runtime allocates from |memory_pool| directly on CPUs, so the
+    // request queue is not served.
+    runtime_jit->call<void *, void *>(
+        "LLVMRuntime_set_release_pages", llvm_runtime_,
+        (void *)&VirtualMemoryAllocator::release_pages);
+
+    if (work_stealing_thread_pool_) {
+      runtime_jit->call<void *, void *, void *>(
+          "LLVMRuntime_initialize_thread_pool", llvm_runtime_,
+          work_stealing_thread_pool_.get(),
+          (void *)WorkStealingThreadPool::static_run);
+    } else {
+      runtime_jit->call<void *, void *, void *>(
+          "LLVMRuntime_initialize_thread_pool", llvm_runtime_,
+          thread_pool_.get(), (void *)ThreadPool::static_run);
+    }
 
     runtime_jit->call<void *, void *>("LLVMRuntime_set_assert_failed",
                                       llvm_runtime_,
@@ -658,6 +1209,7 @@ void LlvmRuntimeExecutor::materialize_runtime(MemoryPool *memory_pool,
 
 void LlvmRuntimeExecutor::destroy_snode_tree(SNodeTree *snode_tree) {
   get_llvm_context(config_->arch)->delete_snode_tree(snode_tree->id());
+  snode_tree_sizes_.erase(snode_tree->id());
   snode_tree_buffer_manager_->destroy(snode_tree);
 }
 
@@ -671,6 +1223,50 @@ LLVMRuntime *LlvmRuntimeExecutor::get_llvm_runtime() {
 
 void LlvmRuntimeExecutor::prepare_runtime_context(RuntimeContext *ctx) {
   ctx->runtime = get_llvm_runtime();
+  ctx->rand_launch_id = num_prepared_contexts_++;
+}
+
+std::shared_ptr<aot::GraphRunner> LlvmRuntimeExecutor::make_graph_runner() {
+#if defined(TI_WITH_CUDA)
+  if (config_->arch == Arch::cuda) {
+    return std::make_shared<CudaGraphRunner>(this);
+  }
+#endif
+  return nullptr;
+}
+
+std::unique_ptr<LaunchStreams> LlvmRuntimeExecutor::make_launch_streams() {
+#if defined(TI_WITH_CUDA)
+  if (config_->arch == Arch::cuda) {
+    constexpr int kNumLaunchStreams = 4;
+    return std::make_unique<CudaLaunchStreams>(kNumLaunchStreams);
+  }
+#endif
+  return nullptr;
+}
+
+void LlvmRuntimeExecutor::set_launch_stream(uint64 stream) {
+  if (config_->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    // The launches recorded so far are enqueued on the previous stream.
+    CUDAContext::get_instance().interrupt_recording();
+    CUDAContext::get_instance().set_stream((void *)stream);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+    return;
+  }
+  TI_ERROR_IF(stream != 0, "Launch streams are not supported on {}",
+              arch_name(config_->arch));
+}
+
+uint64 LlvmRuntimeExecutor::get_launch_stream() {
+#if defined(TI_WITH_CUDA)
+  if (config_->arch == Arch::cuda) {
+    return (uint64)CUDAContext::get_instance().get_stream();
+  }
+#endif
+  return 0;
 }
 
 }  // namespace taichi::lang
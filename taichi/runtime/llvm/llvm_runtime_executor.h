@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #ifdef TI_WITH_LLVM
 
@@ -11,6 +16,9 @@
 #include "taichi/runtime/llvm/llvm_context.h"
 #include "taichi/struct/snode_tree.h"
 #include "taichi/program/compile_config.h"
+#include "taichi/program/kernel_return_future.h"
+#include "taichi/program/launch_queue.h"
+#include "taichi/program/memory_stats.h"
 
 #include "taichi/system/threading.h"
 #include "taichi/system/memory_pool.h"
@@ -23,12 +31,17 @@ namespace taichi::lang {
 
 namespace cuda {
 class CudaDevice;
+class CudaPinnedMemoryPool;
 }  // namespace cuda
 
 namespace cpu {
 class CpuDevice;
 }  // namespace cpu
 
+namespace aot {
+class GraphRunner;
+}  // namespace aot
+
 class LlvmRuntimeExecutor {
  public:
   LlvmRuntimeExecutor(CompileConfig &config, KernelProfilerBase *profiler);
@@ -51,6 +64,67 @@ class LlvmRuntimeExecutor {
 
   void deallocate_memory_ndarray(DeviceAllocation handle);
 
+  // With ndarray_use_managed_memory, starts migrating the ndarray |alloc| to
+  // the device ahead of the work issued next on |stream|, which reads it only
+  // if |read_only|. No-op for other allocations.
+  void prefetch_ndarray(const DeviceAllocation &alloc,
+                        bool read_only,
+                        void *stream);
+
+  // Wraps device memory not owned by Taichi, e.g. a DLPack tensor.
+  DeviceAllocation import_memory(void *ptr, std::size_t size);
+
+  // Shares memory with the other processes of the node. A handle opened by
+  // the process that exported it maps to the same address; otherwise only
+  // CUDA memory can be opened, with peer access enabled as needed.
+  std::string export_memory_ipc_handle(DevicePtr ptr);
+  void *open_memory_ipc_handle(const std::string &handle,
+                               std::function<void()> *release);
+
+  // Page-locked host buffers for staging external arrays on CUDA.
+  cuda::CudaPinnedMemoryPool *pinned_staging_pool();
+
+  // Fill and copy ndarrays without waiting. On CUDA they are issued on the
+  // stream of the calling thread and return an event recorded after them; on
+  // the CPU they complete before returning and return nullptr.
+  StreamSemaphore fill_ndarray_async(const DeviceAllocation &alloc,
+                                     std::size_t size,
+                                     uint32_t data);
+  StreamSemaphore copy_ndarray_async(DevicePtr dst,
+                                     DevicePtr src,
+                                     std::size_t size);
+  // Makes the work issued afterwards on the stream of the calling thread wait
+  // for |sema|.
+  void wait_semaphore(const StreamSemaphore &sema);
+  // Returns a semaphore signalled once the work issued so far on the stream of
+  // the calling thread completes, or nullptr on the CPU.
+  StreamSemaphore signal_semaphore();
+
+  // Copies |size| bytes of host memory at |src| to |dst| once |wait| is
+  // signalled, and returns a semaphore signalled after the copy. On CUDA the
+  // data is staged through pinned memory and copied on a transfer stream of
+  // its own, so that the copy overlaps with the kernels. |src| can be reused as
+  // soon as this returns. On the CPU the copy completes before returning.
+  StreamSemaphore copy_from_host_async(DevicePtr dst,
+                                       const void *src,
+                                       std::size_t size,
+                                       const StreamSemaphore &wait);
+  // Copies |size| bytes at |src| to host memory at |dst| after the work issued
+  // so far on the stream of the calling thread.
+  void copy_to_host(void *dst, DevicePtr src, std::size_t size);
+
+  // Textures are only supported on CUDA, see CudaDevice::create_texture().
+  DeviceAllocation allocate_texture(const ImageParams &params);
+  void deallocate_texture(DeviceAllocation texture);
+  // Copies the texels at |src| to |texture| after the work issued so far on
+  // the stream of the calling thread.
+  void copy_buffer_to_texture(DeviceAllocation texture,
+                              DevicePtr src,
+                              const BufferImageCopyParams &params);
+  // Returns the handle kernels access |texture| through: the texture object
+  // for sampling, or the surface object for loads and stores if |rw|.
+  uint64 get_texture_handle(const DeviceAllocation &texture, bool rw);
+
   void check_runtime_error(uint64 *result_buffer);
 
   uint64_t *get_ndarray_alloc_info_ptr(const DeviceAllocation &alloc);
@@ -59,18 +133,52 @@ class LlvmRuntimeExecutor {
     return config_;
   }
 
+  // Runs |task(thread_id, i)| for i in [0, splits) on the CPU thread pool that
+  // also runs the kernels, with 0 <= thread_id < cpu_max_num_threads. Must not
+  // be called while a kernel is running.
+  void cpu_parallel_for(int splits,
+                        const std::function<void(int, int)> &task);
+
   TaichiLLVMContext *get_llvm_context(Arch arch);
 
   LLVMRuntime *get_llvm_runtime();
 
   void prepare_runtime_context(RuntimeContext *ctx);
 
+  // Returns the runner of a compute graph on this backend, if any.
+  std::shared_ptr<aot::GraphRunner> make_graph_runner();
+
+  // Returns the streams deferred launches overlap on, if any.
+  std::unique_ptr<LaunchStreams> make_launch_streams();
+
+  // See Program::set_launch_stream().
+  void set_launch_stream(uint64 stream);
+  uint64 get_launch_stream();
+
   Device *get_compute_device();
 
   LlvmDevice *llvm_device();
 
   void synchronize();
 
+  // Grows the arena that long AD-stacks spill to to at least |size| bytes.
+  // Waits for the kernels in flight before replacing it.
+  void ensure_ad_stack_spill_buffer(std::size_t size);
+
+  // CompileConfig::pgo_instrument: returns zeroed (taken, not taken) counters
+  // for the |num_branches| branches of the task with offline cache key
+  // |task_key|. They are added to its profile in finalize().
+  uint64 *allocate_branch_profile_counters(const std::string &task_key,
+                                           int num_branches);
+
+  CachingAllocatorStats get_caching_allocator_stats();
+
+  // Reports the SNodes of |snode_trees|. Costs one runtime call and one copy
+  // per SNode, so that it can be sampled every frame.
+  MemoryStats get_memory_stats(
+      const std::vector<std::unique_ptr<SNodeTree>> &snode_trees,
+      uint64 *result_buffer);
+
  private:
   /* ----------------------- */
   /* ------ Allocation ----- */
@@ -83,6 +191,8 @@ class LlvmRuntimeExecutor {
 
   DevicePtr get_snode_tree_device_ptr(int tree_id);
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) const;
+
   void fill_ndarray(const DeviceAllocation &alloc,
                     std::size_t size,
                     uint32_t data);
@@ -91,6 +201,7 @@ class LlvmRuntimeExecutor {
   /* ---- Runtime Helpers ---- */
   /* ------------------------- */
   void print_list_manager_info(void *list_manager, uint64 *result_buffer);
+  SNodeMemoryStats get_snode_memory_stats(SNode *snode, uint64 *result_buffer);
   void print_memory_profiler_info(
       std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
       uint64 *result_buffer);
@@ -135,6 +246,12 @@ class LlvmRuntimeExecutor {
   void finalize();
 
   uint64 fetch_result_uint64(int i, uint64 *result_buffer);
+  void fetch_results(int begin, int n, uint64 *dst, uint64 *result_buffer);
+  // On CUDA, copies the slots to pinned memory on the current stream and
+  // only waits for the copy when they are read.
+  std::unique_ptr<DeferredResults> fetch_results_deferred(
+      int n,
+      uint64 *result_buffer);
   void destroy_snode_tree(SNodeTree *snode_tree);
   std::size_t get_snode_num_dynamically_allocated(SNode *snode,
                                                   uint64 *result_buffer);
@@ -151,13 +268,34 @@ class LlvmRuntimeExecutor {
   void *llvm_runtime_{nullptr};
 
   std::unique_ptr<ThreadPool> thread_pool_{nullptr};
+  std::unique_ptr<WorkStealingThreadPool> work_stealing_thread_pool_{nullptr};
   std::shared_ptr<Device> device_{nullptr};
 
   std::unique_ptr<SNodeTreeBufferManager> snode_tree_buffer_manager_{nullptr};
   std::unordered_map<int, DeviceAllocation> snode_tree_allocs_;
+  std::unordered_map<int, std::size_t> snode_tree_sizes_;
   void *preallocated_device_buffer_{nullptr};  // TODO: move to memory allocator
   DeviceAllocation preallocated_device_buffer_alloc_{kDeviceNullAllocation};
 
+  std::mutex ad_stack_spill_mut_;
+  DeviceAllocation ad_stack_spill_alloc_{kDeviceNullAllocation};
+  std::size_t ad_stack_spill_size_{0};
+
+  // The number of contexts prepared, which tells the launches apart with
+  // counter_based_rand.
+  std::atomic<uint64> num_prepared_contexts_{0};
+
+  std::mutex branch_profile_mut_;
+  // The buffers of the vectors don't move when more are allocated.
+  std::vector<std::pair<std::string, std::vector<uint64>>>
+      branch_profile_counters_;
+
+  // State of copy_from_host_async() on CUDA.
+  std::mutex transfer_mut_;
+  void *transfer_stream_{nullptr};
+  // Pinned staging buffers of the copies that may still be in flight.
+  std::vector<std::pair<StreamSemaphore, void *>> transfer_staging_buffers_;
+
   // good buddy
   friend LlvmProgramImpl;
   friend SNodeTreeBufferManager;
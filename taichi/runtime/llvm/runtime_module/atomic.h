@@ -15,6 +15,16 @@ DEFINE_ATOMIC_EXCHANGE(i64)
 DEFINE_ATOMIC_EXCHANGE(u32)
 DEFINE_ATOMIC_EXCHANGE(u64)
 
+#define DEFINE_ATOMIC_COMPARE_EXCHANGE(T)                                     \
+  bool atomic_compare_exchange_##T(volatile T *dest, T expected, T desired) { \
+    return __atomic_compare_exchange(dest, &expected, &desired, false,        \
+                                     std::memory_order::memory_order_seq_cst, \
+                                     std::memory_order::memory_order_seq_cst); \
+  }
+
+DEFINE_ATOMIC_COMPARE_EXCHANGE(i32)
+DEFINE_ATOMIC_COMPARE_EXCHANGE(u64)
+
 #define DEFINE_ATOMIC_OP_INTRINSIC(OP, T)                                \
   T atomic_##OP##_##T(volatile T *dest, T val) {                         \
     return __atomic_fetch_##OP(dest, val,                                \
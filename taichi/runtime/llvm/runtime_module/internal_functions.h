@@ -9,11 +9,35 @@
     }                                                        \
   } while (0)
 
+// The builder ndarray starts with a header of five entries: the number of
+// triplets, the offsets of the outer index, inner index and value arrays of a
+// reused pattern (zero when there is none) and whether the pattern is
+// compressed by columns. In pattern mode, entries found in the pattern are
+// accumulated in place and only the others are appended as triplets.
 #define ATOMIC_INSERT(T)                                                  \
   do {                                                                    \
     auto base_ptr = reinterpret_cast<int##T *>(base_ptr_);                \
     int##T *num_triplets = base_ptr;                                      \
-    auto data_base_ptr = base_ptr + 1;                                    \
+    if (base_ptr[1] != 0) {                                               \
+      auto outer_ptr = base_ptr + base_ptr[1];                            \
+      auto inner_idx = base_ptr + base_ptr[2];                            \
+      auto values = reinterpret_cast<float##T *>(base_ptr + base_ptr[3]); \
+      int##T outer = base_ptr[4] ? j : i;                                 \
+      int##T inner = base_ptr[4] ? i : j;                                 \
+      int##T lo = outer_ptr[outer], hi = outer_ptr[outer + 1];            \
+      while (lo < hi) {                                                   \
+        int##T mid = (lo + hi) / 2;                                       \
+        if (inner_idx[mid] < inner)                                       \
+          lo = mid + 1;                                                   \
+        else                                                              \
+          hi = mid;                                                       \
+      }                                                                   \
+      if (lo < outer_ptr[outer + 1] && inner_idx[lo] == inner) {          \
+        atomic_add_f##T(values + lo, value);                              \
+        break;                                                            \
+      }                                                                   \
+    }                                                                     \
+    auto data_base_ptr = base_ptr + 5;                                    \
     auto triplet_id = atomic_add_i##T(num_triplets, 1);                   \
     data_base_ptr[triplet_id * 3] = i;                                    \
     data_base_ptr[triplet_id * 3 + 1] = j;                                \
@@ -17,7 +17,11 @@ void Bitmasked_activate(Ptr meta, Ptr node, int i) {
   auto num_elements = Bitmasked_get_num_elements(meta, node);
   auto data_section_size = element_size * num_elements;
   auto mask_begin = (u32 *)(node + data_section_size);
-  atomic_or_u32(&mask_begin[i / 32], 1UL << (i % 32));
+  u32 bit = 1UL << (i % 32);
+  if (!(mask_begin[i / 32] & bit)) {
+    atomic_or_u32(&mask_begin[i / 32], bit);
+    mark_topology_changed(smeta->context->runtime, smeta->snode_id);
+  }
 }
 
 void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
@@ -26,7 +30,11 @@ void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
   auto num_elements = Bitmasked_get_num_elements(meta, node);
   auto data_section_size = element_size * num_elements;
   auto mask_begin = (u32 *)(node + data_section_size);
-  atomic_and_u32(&mask_begin[i / 32], ~(1UL << (i % 32)));
+  u32 bit = 1UL << (i % 32);
+  if (mask_begin[i / 32] & bit) {
+    atomic_and_u32(&mask_begin[i / 32], ~bit);
+    mark_topology_changed(smeta->context->runtime, smeta->snode_id);
+  }
 }
 
 i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
@@ -41,3 +49,92 @@ i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
 Ptr Bitmasked_lookup_element(Ptr meta, Ptr node, int i) {
   return node + ((StructMeta *)meta)->element_size * i;
 }
+
+// Returns the first active cell in [i, end), or |end| if there is none. The
+// mask is read a word at a time, so that runs of inactive cells are skipped
+// without testing each of them.
+i32 Bitmasked_next_active(Ptr meta, Ptr node, i32 i, i32 end) {
+  auto smeta = (StructMeta *)meta;
+  auto data_section_size = smeta->element_size * smeta->max_num_elements;
+  auto mask_begin = (u32 *)(node + data_section_size);
+  while (i < end) {
+    u32 word = mask_begin[i / 32] >> (i % 32);
+    if (word != 0) {
+      return std::min(i + __builtin_ctz(word), end);
+    }
+    i = (i / 32 + 1) * 32;
+  }
+  return end;
+}
+
+#if ARCH_cuda
+// Loads the mask words of the cells in [lower, upper) into the lanes of the
+// warp, one word per lane with the bits of the other cells cleared, and
+// returns the number of active cells. |sum| is set to the inclusive prefix
+// sum of the numbers of active cells in the words of the lanes.
+//
+// The elements of struct-for lists start at a multiple of the list element
+// size, so the cells of one of them span no more words than there are lanes.
+i32 Bitmasked_gpu_scan_active(Ptr meta,
+                              Ptr node,
+                              i32 lower,
+                              i32 upper,
+                              i32 *word,
+                              i32 *sum) {
+  auto smeta = (StructMeta *)meta;
+  auto data_section_size = smeta->element_size * smeta->max_num_elements;
+  auto mask_begin = (u32 *)(node + data_section_size);
+  const i32 lane = warp_idx();
+  const i32 first = lower / 32;
+  const i32 w = first + lane;
+  u32 bits = 0;
+  if (w * 32 < upper) {
+    bits = mask_begin[w];
+    if (w == first) {
+      bits &= UINT32_MAX << (lower % 32);
+    }
+    if (upper - w * 32 < 32) {
+      bits &= (1u << (upper - w * 32)) - 1;
+    }
+  }
+  i32 s = __builtin_popcount(bits);
+  for (int offset = 1; offset < warp_size(); offset *= 2) {
+    auto prev = cuda_shfl_up_sync_i32(UINT32_MAX, s, offset, 0);
+    if (lane >= offset) {
+      s += prev;
+    }
+  }
+  *word = (i32)bits;
+  *sum = s;
+  return cuda_shfl_sync_i32(UINT32_MAX, s, warp_size() - 1, 31);
+}
+
+// Returns the |rank|-th active cell of the ones scanned by
+// Bitmasked_gpu_scan_active, or -1 if there are not that many. All the lanes
+// of the warp must call it together.
+i32 Bitmasked_gpu_active_cell(Ptr meta,
+                              Ptr node,
+                              i32 lower,
+                              i32 word,
+                              i32 sum,
+                              i32 rank) {
+  // The word of the cell is the one of the first lane whose sum exceeds the
+  // rank.
+  int k = 0;
+  for (int step = warp_size() / 2; step > 0; step /= 2) {
+    if (cuda_shfl_sync_i32(UINT32_MAX, sum, k + step - 1, 31) <= rank) {
+      k += step;
+    }
+  }
+  const i32 k_sum = cuda_shfl_sync_i32(UINT32_MAX, sum, k, 31);
+  auto bits = (u32)cuda_shfl_sync_i32(UINT32_MAX, word, k, 31);
+  if (rank >= k_sum) {
+    return -1;
+  }
+  // Clears the lower set bits of the word up to the one of the cell.
+  for (i32 n = rank - (k_sum - __builtin_popcount(bits)); n > 0; n--) {
+    bits &= bits - 1;
+  }
+  return (lower / 32 + k) * 32 + __builtin_ctz(bits);
+}
+#endif
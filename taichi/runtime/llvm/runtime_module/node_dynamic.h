@@ -1,9 +1,13 @@
 #pragma once
 
+// The elements of a dynamic node are stored in chunks of |chunk_size|
+// elements, allocated on demand. Chunk k holds the elements
+// [k * chunk_size, (k + 1) * chunk_size), and is found in O(1) through the
+// chunk directory of the node.
 struct DynamicNode {
   i32 lock;
   i32 n;
-  Ptr ptr;
+  Ptr chunks[1];  // actually |num_chunks| entries
 };
 
 // Specialized Attributes and functions
@@ -13,31 +17,47 @@ struct DynamicMeta : public StructMeta {
 
 STRUCT_FIELD(DynamicMeta, chunk_size);
 
+i32 Dynamic_get_num_chunks(DynamicMeta *meta) {
+  return i32((meta->max_num_elements + meta->chunk_size - 1) /
+             meta->chunk_size);
+}
+
+// Returns the chunk containing element i, allocating it if needed. This does
+// not take the lock of the node: when several threads try to install the
+// chunk, the losers give back the chunks they allocated.
+Ptr Dynamic_touch_chunk(DynamicMeta *meta, DynamicNode *node, int i) {
+  auto chunk_id = i / meta->chunk_size;
+  auto rt = meta->context->runtime;
+  if (chunk_id >= Dynamic_get_num_chunks(meta)) {
+    taichi_assert_runtime(rt, false, "Dynamic SNode out of chunks.");
+    return nullptr;
+  }
+  auto p_chunk_ptr = &node->chunks[chunk_id];
+  if (*p_chunk_ptr == nullptr) {
+    auto alloc = rt->node_allocators[meta->snode_id];
+    auto chunk_ptr = alloc->allocate();
+    if (!atomic_compare_exchange_u64((u64 *)p_chunk_ptr, 0, (u64)chunk_ptr)) {
+      alloc->recycle(chunk_ptr);
+    }
+  }
+  return *p_chunk_ptr;
+}
+
+Ptr Dynamic_get_element_ptr(DynamicMeta *meta, Ptr chunk_ptr, int i) {
+  return chunk_ptr + (i % meta->chunk_size) * meta->element_size;
+}
+
 void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   // We need to not only update node->n, but also make sure the chunk containing
-  // element i is allocated.
-  atomic_max_i32(&node->n, i + 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  auto chunk_size = meta->chunk_size;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      return;
-    }
-    p_chunk_ptr = (Ptr *)*p_chunk_ptr;
-    chunk_start += chunk_size;
+  // element i is allocated. The chunks of the elements before i are allocated
+  // when they are written.
+  if (node->n < i + 1) {
+    atomic_max_i32(&node->n, i + 1);
+    mark_topology_changed(meta->context->runtime, meta->snode_id);
   }
+  Dynamic_touch_chunk(meta, node, i);
 }
 
 void Dynamic_deactivate(Ptr meta_, Ptr node_) {
@@ -45,15 +65,20 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
   auto node = (DynamicNode *)(node_);
   if (node->n > 0) {
     locked_task(Ptr(&node->lock), [&] {
+      // Chunks are only allocated for the elements before n.
+      auto num_chunks =
+          min_i32((node->n + meta->chunk_size - 1) / meta->chunk_size,
+                  Dynamic_get_num_chunks(meta));
       node->n = 0;
-      auto p_chunk_ptr = &node->ptr;
       auto rt = meta->context->runtime;
+      mark_topology_changed(rt, meta->snode_id);
       auto alloc = rt->node_allocators[meta->snode_id];
-      while (*p_chunk_ptr) {
-        alloc->recycle(*p_chunk_ptr);
-        p_chunk_ptr = (Ptr *)*p_chunk_ptr;
+      for (int k = 0; k < num_chunks; k++) {
+        if (node->chunks[k]) {
+          alloc->recycle(node->chunks[k]);
+          node->chunks[k] = nullptr;
+        }
       }
-      node->ptr = nullptr;
     });
   }
 }
@@ -61,30 +86,14 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
 Ptr Dynamic_allocate(Ptr meta_, Ptr node_, i32 *len) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
-  auto chunk_size = meta->chunk_size;
   auto i = atomic_add_i32(&node->n, 1);
   *len = i;
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      return *p_chunk_ptr + sizeof(Ptr) +
-             (i - chunk_start) * meta->element_size;
-    }
-    p_chunk_ptr = (Ptr *)(*p_chunk_ptr);
-    chunk_start += chunk_size;
+  mark_topology_changed(meta->context->runtime, meta->snode_id);
+  auto chunk_ptr = Dynamic_touch_chunk(meta, node, i);
+  if (chunk_ptr == nullptr) {
+    return (meta->context->runtime)->ambient_elements[meta->snode_id];
   }
-  // Unreachable
-  return nullptr;
+  return Dynamic_get_element_ptr(meta, chunk_ptr, i);
 }
 
 i32 Dynamic_is_active(Ptr meta_, Ptr node_, int i) {
@@ -95,22 +104,15 @@ i32 Dynamic_is_active(Ptr meta_, Ptr node_, int i) {
 Ptr Dynamic_lookup_element(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
-  if (Dynamic_is_active(meta_, node_, i)) {
-    int chunk_start = 0;
-    auto chunk_ptr = node->ptr;
-    auto chunk_size = meta->chunk_size;
-    while (true) {
-      if (i < chunk_start + chunk_size) {
-        auto addr =
-            chunk_ptr + sizeof(Ptr) + (i - chunk_start) * meta->element_size;
-        return addr;
-      }
-      chunk_ptr = *(Ptr *)chunk_ptr;
-      chunk_start += chunk_size;
+  if (Dynamic_is_active(meta_, node_, i) &&
+      i / meta->chunk_size < Dynamic_get_num_chunks(meta)) {
+    auto chunk_ptr = node->chunks[i / meta->chunk_size];
+    // A chunk that has not been written to yet reads as zeros.
+    if (chunk_ptr != nullptr) {
+      return Dynamic_get_element_ptr(meta, chunk_ptr, i);
     }
-  } else {
-    return (meta->context->runtime)->ambient_elements[meta->snode_id];
   }
+  return (meta->context->runtime)->ambient_elements[meta->snode_id];
 }
 
 i32 Dynamic_get_num_elements(Ptr meta_, Ptr node_) {
@@ -0,0 +1,164 @@
+#pragma once
+
+// A hash node is an open-addressing table with |table_size| slots, probed
+// linearly. Each slot holds
+//  - the key: the index of the cell in the slot plus one, so that the zeros
+//    of a fresh root buffer mark empty slots,
+//  - a lock for allocating the child,
+//  - a pointer to the child, null if the cell is not active.
+// A claimed slot keeps its key, so deactivating and activating a cell again
+// reuses the slot.
+// Listgen and struct-fors iterate over the slots, and map them to cells with
+// Hash_get_element_index.
+
+// Specialized Attributes and functions
+struct HashMeta : public StructMeta {
+  int table_size;
+};
+
+STRUCT_FIELD(HashMeta, table_size);
+
+i32 Hash_get_num_elements(Ptr meta, Ptr node) {
+  return ((HashMeta *)meta)->table_size;
+}
+
+i32 Hash_get_probe_start(int i, int table_size) {
+  // Fibonacci hashing scatters neighbouring cells over the table.
+  return (i32)(((u32)i * 2654435761u) % (u32)table_size);
+}
+
+volatile i32 *Hash_get_keys(Ptr node) {
+  return (volatile i32 *)node;
+}
+
+Ptr Hash_get_lock(Ptr meta, Ptr node, int slot) {
+  auto table_size = Hash_get_num_elements(meta, node);
+  return node + 4 * (table_size + slot);
+}
+
+Ptr *Hash_get_data_ptr(Ptr meta, Ptr node, int slot) {
+  auto table_size = Hash_get_num_elements(meta, node);
+  return (Ptr *)(node + 8 * (table_size + slot));
+}
+
+// Returns the slot of cell |i|, or -1 if the cell has never been activated.
+i32 Hash_find_slot(Ptr meta, Ptr node, int i) {
+  auto table_size = Hash_get_num_elements(meta, node);
+  auto keys = Hash_get_keys(node);
+  auto slot = Hash_get_probe_start(i, table_size);
+  for (int k = 0; k < table_size; k++) {
+    auto key = keys[slot];
+    if (key == i + 1) {
+      return slot;
+    }
+    if (key == 0) {
+      return -1;
+    }
+    slot = slot + 1 == table_size ? 0 : slot + 1;
+  }
+  return -1;
+}
+
+// Returns the slot of cell |i|, claiming an empty one if needed.
+i32 Hash_claim_slot(Ptr meta, Ptr node, int i) {
+  auto table_size = Hash_get_num_elements(meta, node);
+  auto keys = Hash_get_keys(node);
+  auto slot = Hash_get_probe_start(i, table_size);
+  for (int k = 0; k < table_size; k++) {
+    auto key = keys[slot];
+    if (key == 0) {
+      if (atomic_compare_exchange_i32(keys + slot, 0, i + 1)) {
+        return slot;
+      }
+      // Lost to another thread, which may have claimed it for the same cell.
+      key = keys[slot];
+    }
+    if (key == i + 1) {
+      return slot;
+    }
+    slot = slot + 1 == table_size ? 0 : slot + 1;
+  }
+  auto runtime = ((StructMeta *)meta)->context->runtime;
+  taichi_assert_runtime(runtime, 0, "Hash SNode table is full.");
+  return -1;
+}
+
+i32 Hash_get_element_index(Ptr meta, Ptr node, int slot) {
+  return Hash_get_keys(node)[slot] - 1;
+}
+
+void Hash_activate(Ptr meta_, Ptr node, int i) {
+  auto meta = (StructMeta *)meta_;
+  auto slot = Hash_claim_slot(meta_, node, i);
+  if (slot == -1) {
+    return;
+  }
+  volatile Ptr lock = Hash_get_lock(meta_, node, slot);
+  volatile Ptr *data_ptr = Hash_get_data_ptr(meta_, node, slot);
+
+  if (*data_ptr == nullptr) {
+    // The same election as in Pointer_activate.
+    u32 mask = cuda_active_mask();
+    if (is_representative(mask, (u64)lock)) {
+      while (*data_ptr == nullptr) {
+        if (*(volatile i32 *)lock == 0 &&
+            atomic_compare_exchange_i32((i32 *)lock, 0, 1)) {
+          if (*data_ptr == nullptr) {
+            auto rt = meta->context->runtime;
+            auto alloc = rt->node_allocators[meta->snode_id];
+            auto allocated = (u64)alloc->allocate();
+            grid_memfence();
+            atomic_exchange_u64((u64 *)data_ptr, allocated);
+            mark_topology_changed(rt, meta->snode_id);
+          }
+          atomic_exchange_i32((i32 *)lock, 0);
+        }
+      }
+    }
+    warp_barrier(mask);
+  }
+}
+
+void Hash_deactivate(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot == -1) {
+    return;
+  }
+  Ptr lock = Hash_get_lock(meta, node, slot);
+  Ptr &data_ptr = *Hash_get_data_ptr(meta, node, slot);
+  if (data_ptr != nullptr) {
+    locked_task(lock, [&] {
+      if (data_ptr != nullptr) {
+        auto smeta = (StructMeta *)meta;
+        auto rt = smeta->context->runtime;
+        auto alloc = rt->node_allocators[smeta->snode_id];
+        alloc->recycle(data_ptr);
+        data_ptr = nullptr;
+        mark_topology_changed(rt, smeta->snode_id);
+      }
+    });
+  }
+}
+
+i32 Hash_is_active(Ptr meta, Ptr node, int i) {
+  // |i| is -1 for the empty slots in struct-fors.
+  if (i < 0) {
+    return 0;
+  }
+  auto slot = Hash_find_slot(meta, node, i);
+  return slot != -1 && *Hash_get_data_ptr(meta, node, slot) != nullptr;
+}
+
+Ptr Hash_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  Ptr data_ptr = nullptr;
+  if (slot != -1) {
+    data_ptr = *Hash_get_data_ptr(meta, node, slot);
+  }
+  if (data_ptr == nullptr) {
+    auto smeta = (StructMeta *)meta;
+    auto context = smeta->context;
+    data_ptr = (context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return data_ptr;
+}
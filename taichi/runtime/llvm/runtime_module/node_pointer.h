@@ -48,17 +48,23 @@ void Pointer_activate(Ptr meta_, Ptr node, int i) {
     // The cuda_ calls will return 0 or do noop on CPUs
     u32 mask = cuda_active_mask();
     if (is_representative(mask, (u64)lock)) {
-      locked_task(
-          lock,
-          [&] {
+      // A compare-exchange on the lock elects the thread that allocates the
+      // node. The others wait for it to be published, and never take the lock
+      // themselves once it has been.
+      while (*data_ptr == nullptr) {
+        if (*(volatile i32 *)lock == 0 &&
+            atomic_compare_exchange_i32((i32 *)lock, 0, 1)) {
+          if (*data_ptr == nullptr) {
             auto rt = meta->context->runtime;
             auto alloc = rt->node_allocators[meta->snode_id];
             auto allocated = (u64)alloc->allocate();
-            // TODO: Not sure if we really need atomic_exchange here,
-            // just to be safe.
+            grid_memfence();
             atomic_exchange_u64((u64 *)data_ptr, allocated);
-          },
-          [&]() { return *data_ptr == nullptr; });
+            mark_topology_changed(rt, meta->snode_id);
+          }
+          atomic_exchange_i32((i32 *)lock, 0);
+        }
+      }
     }
     warp_barrier(mask);
   }
@@ -76,6 +82,7 @@ void Pointer_deactivate(Ptr meta, Ptr node, int i) {
         auto alloc = rt->node_allocators[smeta->snode_id];
         alloc->recycle(data_ptr);
         data_ptr = nullptr;
+        mark_topology_changed(rt, smeta->snode_id);
       }
     });
   }
@@ -40,7 +40,20 @@ using host_vsnprintf_type = int (*)(char *,
                                     const char *,
                                     std::va_list);
 using vm_allocator_type = void *(*)(void *, std::size_t, std::size_t);
-using RangeForTaskFunc = void(RuntimeContext *, const char *tls, int i);
+using release_pages_type = void (*)(void *, std::size_t);
+// The body of a CPU range-for runs over the indices [begin, end) of a block,
+// so that the loop over the block is visible to the LLVM vectorizer.
+using RangeForTaskFunc = void(RuntimeContext *,
+                              const char *tls,
+                              int begin,
+                              int end);
+using RangeForTaskFuncI64 = void(RuntimeContext *,
+                                 const char *tls,
+                                 int64_t begin,
+                                 int64_t end);
+// The bodies of GPU range-fors and of mesh-fors run a single index.
+using IndexTaskFunc = void(RuntimeContext *, const char *tls, int i);
+using IndexTaskFuncI64 = void(RuntimeContext *, const char *tls, int64_t i);
 using MeshForTaskFunc = void(RuntimeContext *, const char *tls, uint32_t i);
 using parallel_for_type = void (*)(void *thread_pool,
                                    int splits,
@@ -290,6 +303,7 @@ STRUCT_FIELD_ARRAY(RuntimeContext, args);
 STRUCT_FIELD_ARRAY(RuntimeContext, grad_args);
 STRUCT_FIELD(RuntimeContext, runtime);
 STRUCT_FIELD(RuntimeContext, result_buffer)
+STRUCT_FIELD(RuntimeContext, rand_launch_id)
 
 int32 RuntimeContext_get_extra_args(RuntimeContext *ctx, int32 i, int32 j) {
   return ctx->extra_args[i][j];
@@ -320,6 +334,10 @@ struct StructMeta {
                              PhysicalCoordinates *refined_coord,
                              int index);
 
+  // Maps the index of an iterated slot to the cell in it, or to -1 if there
+  // is none. Null for the SNodes that iterate over their cells directly.
+  i32 (*get_element_index)(Ptr, Ptr, int slot);
+
   RuntimeContext *context;
 };
 
@@ -331,6 +349,7 @@ STRUCT_FIELD(StructMeta, lookup_element);
 STRUCT_FIELD(StructMeta, from_parent_element);
 STRUCT_FIELD(StructMeta, refine_coordinates);
 STRUCT_FIELD(StructMeta, is_active);
+STRUCT_FIELD(StructMeta, get_element_index);
 STRUCT_FIELD(StructMeta, context);
 
 struct LLVMRuntime;
@@ -415,6 +434,29 @@ bool is_power_of_two(uint32 x) {
   return x != 0 && (x & (x - 1)) == 0;
 }
 
+extern "C" {
+u32 cuda_active_mask();
+i32 cuda_shfl_sync_i32(u32 mask, i32 val, i32 delta, int width);
+int32 cttz_i32(i32 val);
+}
+
+// Same as atomic_add_i32(dest, 1), but on GPUs the active threads of a warp
+// claim their slots with a single atomic, issued by the lowest lane.
+i32 atomic_increment_warp_aggregated_i32(volatile i32 *dest) {
+#if ARCH_cuda
+  auto mask = cuda_active_mask();
+  auto leader = cttz_i32(mask);
+  i32 base = 0;
+  if (warp_idx() == leader) {
+    base = atomic_add_i32(dest, __builtin_popcount(mask));
+  }
+  base = cuda_shfl_sync_i32(mask, base, leader, 31);
+  return base + __builtin_popcount(mask & ((1u << warp_idx()) - 1));
+#else
+  return atomic_add_i32(dest, 1);
+#endif
+}
+
 /*
 A simple list data structure that is infinitely long.
 Data are organized in chunks, where each chunk is allocated on demand.
@@ -430,6 +472,7 @@ struct ListManager {
   i32 log2chunk_num_elements;
   i32 lock;
   i32 num_elements;
+  i32 num_chunks;
   LLVMRuntime *runtime;
 
   ListManager(LLVMRuntime *runtime,
@@ -442,13 +485,14 @@ struct ListManager {
                           "max_num_elements_per_chunk must be POT.");
     lock = 0;
     num_elements = 0;
+    num_chunks = 0;
     log2chunk_num_elements = taichi::log2int(num_elements_per_chunk);
   }
 
   void append(void *data_ptr);
 
   i32 reserve_new_element() {
-    auto i = atomic_add_i32(&num_elements, 1);
+    auto i = atomic_increment_warp_aggregated_i32(&num_elements);
     auto chunk_id = i >> log2chunk_num_elements;
     touch_chunk(chunk_id);
     return i;
@@ -463,12 +507,19 @@ struct ListManager {
 
   void touch_chunk(int chunk_id);
 
-  i32 get_num_active_chunks() {
-    i32 counter = 0;
-    for (int i = 0; i < max_num_chunks; i++) {
-      counter += (chunks[i] != nullptr);
+  // Allocates the chunks for the first |n| elements ahead of time, so that
+  // the threads appending them don't have to under |lock|.
+  void reserve(i32 n) {
+    auto n_chunks = std::min<i64>(
+        (i64(n) + max_num_elements_per_chunk - 1) >> log2chunk_num_elements,
+        max_num_chunks);
+    for (int i = 0; i < n_chunks; i++) {
+      touch_chunk(i);
     }
-    return counter;
+  }
+
+  i32 get_num_active_chunks() {
+    return num_chunks;
   }
 
   void clear() {
@@ -550,6 +601,9 @@ struct LLVMRuntime {
   Ptr preallocated_tail;
 
   vm_allocator_type vm_allocator;
+  // Zero-fills a range of the memory pool and returns its pages to the OS.
+  // Only set on CPUs.
+  release_pages_type release_pages;
   assert_failed_type assert_failed;
   host_printf_type host_printf;
   host_vsnprintf_type host_vsnprintf;
@@ -564,6 +618,20 @@ struct LLVMRuntime {
   NodeManager *node_allocators[taichi_max_num_snodes];
   NodeManager *runtime_context_buffer_allocator;
   Ptr ambient_elements[taichi_max_num_snodes];
+  // The element lists of an SNode tree are reused by the struct-fors as long
+  // as nothing in the tree has been activated or deactivated. The topology
+  // version of a tree is bumped at the first listgen after a change.
+  i32 snode_tree_ids[taichi_max_num_snodes];
+  i32 topology_changed[kMaxNumSnodeTreesLlvm];
+  i64 topology_versions[kMaxNumSnodeTreesLlvm];
+  // One plus the topology version each element list was generated at, or zero
+  // if it has never been generated.
+  i64 element_list_versions[taichi_max_num_snodes];
+  i32 element_list_reused[taichi_max_num_snodes];
+  // Whether each element list is in the coordinate order of the SNode tree.
+  i32 element_list_sorted[taichi_max_num_snodes];
+  // Holds the prefix sums of element_listgen_nonroot_sorted.
+  Ptr listgen_scratch;
   Ptr temporaries;
   RandState *rand_states;
   MemRequestQueue *mem_req_queue;
@@ -587,6 +655,10 @@ struct LLVMRuntime {
 
   i64 total_requested_memory;
 
+  // The arena that the bottom entries of long AD-stacks spill to. Every
+  // thread of a task owns a region of the same size in it.
+  Ptr ad_stack_spill_buffer = nullptr;
+
   Ptr wasm_print_buffer = nullptr;
 
   template <typename T>
@@ -616,6 +688,7 @@ STRUCT_FIELD(LLVMRuntime, host_vsnprintf);
 STRUCT_FIELD(LLVMRuntime, profiler);
 STRUCT_FIELD(LLVMRuntime, profiler_start);
 STRUCT_FIELD(LLVMRuntime, profiler_stop);
+STRUCT_FIELD(LLVMRuntime, ad_stack_spill_buffer);
 
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
@@ -632,6 +705,8 @@ struct NodeManager {
 
   using list_data_type = i32;
 
+  static constexpr i32 kMinReleasedNodeSize = 16 * taichi_page_size;
+
   NodeManager(LLVMRuntime *runtime,
               i32 element_size,
               i32 chunk_num_elements = -1)
@@ -656,7 +731,7 @@ struct NodeManager {
   }
 
   Ptr allocate() {
-    int old_cursor = atomic_add_i32(&free_list_used, 1);
+    int old_cursor = atomic_increment_warp_aggregated_i32(&free_list_used);
     i32 l;
     if (old_cursor >= free_list->size()) {
       // running out of free list. allocate new.
@@ -677,6 +752,17 @@ struct NodeManager {
     recycled_list->append(&index);
   }
 
+  // Nodes spanning many pages are given back to the OS rather than
+  // zero-filled, so that the resident memory follows the active nodes.
+  void zero_fill(Ptr ptr) {
+    if (runtime->release_pages != nullptr &&
+        element_size >= kMinReleasedNodeSize) {
+      runtime->release_pages(ptr, element_size);
+    } else {
+      std::memset(ptr, 0, element_size);
+    }
+  }
+
   void gc_serial() {
     // compact free list
     for (int i = free_list_used; i < free_list->size(); i++) {
@@ -688,13 +774,80 @@ struct NodeManager {
     free_list->resize(num_unused);
 
     // zero-fill recycled and push to free list
-    for (int i = 0; i < recycled_list->size(); i++) {
+    const i32 num_recycled = recycled_list->size();
+    for (int i = 0; i < num_recycled; i++) {
       auto idx = recycled_list->get<list_data_type>(i);
       auto ptr = data_list->get_element_ptr(idx);
-      std::memset(ptr, 0, element_size);
+      zero_fill(ptr);
       free_list->push_back(idx);
     }
     recycled_list->clear();
+
+    if (runtime->release_pages != nullptr && num_recycled > 0 &&
+        free_list->size() >= chunk_num_elements) {
+      trim();
+    }
+  }
+
+  // Shrinks the data list to its last node in use, and gives the pages of the
+  // free nodes after it back to the OS, so that the resident memory follows
+  // the active nodes after a peak. The free list is sorted so that the nodes
+  // near the beginning of the data list are reused first.
+  void trim() {
+    sort_free_list();
+    i32 num_used = data_list->size();
+    i32 num_free = free_list->size();
+    while (num_free > 0 &&
+           free_list->get<list_data_type>(num_free - 1) == num_used - 1) {
+      num_free--;
+      num_used--;
+    }
+    if (num_used == data_list->size()) {
+      return;
+    }
+    for (i32 i = num_used; i < data_list->size();) {
+      // The rest of the chunk of node i.
+      const i32 chunk_end =
+          min_i32((i / chunk_num_elements + 1) * chunk_num_elements,
+                  data_list->size());
+      runtime->release_pages(data_list->get_element_ptr(i),
+                             (std::size_t)(chunk_end - i) * element_size);
+      i = chunk_end;
+    }
+    free_list->resize(num_free);
+    data_list->resize(num_used);
+  }
+
+  // Heap sort, which needs no extra memory.
+  void sort_free_list() {
+    auto at = [&](i32 i) -> list_data_type & {
+      return free_list->get<list_data_type>(i);
+    };
+    auto sift_down = [&](i32 root, i32 size) {
+      while (2 * root + 1 < size) {
+        i32 child = 2 * root + 1;
+        if (child + 1 < size && at(child) < at(child + 1)) {
+          child++;
+        }
+        if (at(root) >= at(child)) {
+          return;
+        }
+        auto tmp = at(root);
+        at(root) = at(child);
+        at(child) = tmp;
+        root = child;
+      }
+    };
+    const i32 n = free_list->size();
+    for (i32 i = n / 2 - 1; i >= 0; i--) {
+      sift_down(i, n);
+    }
+    for (i32 i = n - 1; i > 0; i--) {
+      auto tmp = at(0);
+      at(0) = at(i);
+      at(i) = tmp;
+      sift_down(0, i);
+    }
   }
 };
 
@@ -738,6 +891,31 @@ void runtime_ListManager_get_num_active_chunks(LLVMRuntime *runtime,
                       list_manager->get_num_active_chunks());
 }
 
+// Writes the memory statistics of an SNode to the return value slots of the
+// result buffer, so that the host fetches them with a single copy. The layout
+// is read by LlvmRuntimeExecutor::get_snode_memory_stats.
+void runtime_get_snode_memory_stats(LLVMRuntime *runtime, i32 snode_id) {
+  u64 stats[taichi_snode_memory_stats_entries] = {0};
+  auto list_stats = [&](ListManager *list, int i) {
+    stats[i] = list->num_elements;
+    stats[i + 1] = (u64)list->num_chunks * list->max_num_elements_per_chunk *
+                   list->element_size;
+  };
+  if (auto element_list = runtime->element_lists[snode_id]) {
+    list_stats(element_list, 0);
+  }
+  if (auto allocator = runtime->node_allocators[snode_id]) {
+    list_stats(allocator->data_list, 2);
+    list_stats(allocator->free_list, 4);
+    list_stats(allocator->recycled_list, 6);
+    stats[8] = allocator->free_list_used;
+    stats[9] = allocator->element_size;
+  }
+  for (int i = 0; i < taichi_snode_memory_stats_entries; i++) {
+    runtime->set_result(taichi_result_buffer_ret_value_id + i, stats[i]);
+  }
+}
+
 RUNTIME_STRUCT_FIELD_ARRAY(LLVMRuntime, node_allocators);
 RUNTIME_STRUCT_FIELD_ARRAY(LLVMRuntime, element_lists);
 RUNTIME_STRUCT_FIELD(LLVMRuntime, total_requested_memory);
@@ -851,6 +1029,10 @@ Ptr LLVMRuntime::request_allocate_aligned(std::size_t size,
   atomic_add_i64(&total_requested_memory, size);
   if (preallocated)
     return allocate_from_buffer(size, alignment);
+#if ARCH_x64 || ARCH_arm64
+  // The memory pool is on the same host, and locks itself.
+  return (Ptr)vm_allocator(memory_pool, size, alignment);
+#else
   else {
     auto i = atomic_add_i32(&mem_req_queue->tail, 1);
     taichi_assert_runtime(this, i <= taichi_max_num_mem_requests,
@@ -867,6 +1049,7 @@ Ptr LLVMRuntime::request_allocate_aligned(std::size_t size,
     };
     return r->ptr;
   }
+#endif
 }
 
 RuntimeContext *allocate_runtime_context(LLVMRuntime *runtime) {
@@ -935,6 +1118,9 @@ void runtime_initialize(
   runtime->temporaries = (Ptr)runtime->allocate_aligned(
       taichi_global_tmp_buffer_size, taichi_page_size);
 
+  runtime->listgen_scratch = (Ptr)runtime->allocate_aligned(
+      taichi_max_gpu_block_dim * sizeof(i32), taichi_page_size);
+
   runtime->num_rand_states = num_rand_states;
   runtime->rand_states = (RandState *)runtime->allocate_aligned(
       sizeof(RandState) * runtime->num_rand_states, taichi_page_size);
@@ -970,6 +1156,16 @@ void runtime_initialize_snodes(LLVMRuntime *runtime,
   // and the size of the root buffer memory are aligned to page size.
   runtime->root_mem_sizes[snode_tree_id] = rounded_size;
   runtime->roots[snode_tree_id] = ptr;
+  runtime->topology_changed[snode_tree_id] = 1;
+  runtime->topology_versions[snode_tree_id] = 0;
+  for (int i = root_id; i < root_id + num_snodes; i++) {
+    runtime->snode_tree_ids[i] = snode_tree_id;
+    runtime->element_list_versions[i] = 0;
+    runtime->element_list_reused[i] = 0;
+    runtime->element_list_sorted[i] = 0;
+  }
+  // The list of the root holds a single element.
+  runtime->element_list_sorted[root_id] = 1;
   // runtime->request_allocate_aligned ready to use
   // initialize the root node element list
   if (all_dense) {
@@ -991,6 +1187,10 @@ void runtime_initialize_snodes(LLVMRuntime *runtime,
   runtime->element_lists[root_id]->append(&elem);
 }
 
+void LLVMRuntime_set_release_pages(LLVMRuntime *runtime, void *release_pages) {
+  runtime->release_pages = (release_pages_type)release_pages;
+}
+
 void LLVMRuntime_initialize_thread_pool(LLVMRuntime *runtime,
                                         void *thread_pool,
                                         void *parallel_for) {
@@ -1151,6 +1351,149 @@ uint32 cuda_active_mask() {
 }
 #endif
 
+// AMDGPU wavefront intrinsics, patched in TaichiLLVMContext::module_from_file.
+i32 amdgpu_wavefront_size() {
+  return 0;
+}
+
+u64 amdgpu_ballot(bool bit) {
+  return 0;
+}
+
+// Reads |data| of the lane |addr| / 4.
+i32 amdgpu_ds_bpermute(i32 addr, i32 data) {
+  return 0;
+}
+
+i32 amdgpu_shfl_i32(i32 val, i32 src_lane) {
+  return amdgpu_ds_bpermute(src_lane * 4, val);
+}
+
+f32 amdgpu_shfl_f32(f32 val, i32 src_lane) {
+  return taichi_union_cast<f32>(
+      amdgpu_ds_bpermute(src_lane * 4, taichi_union_cast<i32>(val)));
+}
+
+// Warp-level matrix multiply-accumulate, D = A * B + C, with an m16n8kK tile:
+// A is 16xK, B is Kx8, and C and D are 16x8. Every lane holds a fragment of
+// each matrix in the layout of mma.sync. With lane = 4 * g + t:
+// - K = 8 (TF32): a0..a3 are A[g][t], A[g + 8][t], A[g][t + 4],
+//   A[g + 8][t + 4], and b0, b1 are B[t][g], B[t + 4][g].
+// - K = 16 (F16 and BF16): a0..a7 are A[g][2t], A[g][2t + 1], A[g + 8][2t],
+//   A[g + 8][2t + 1], then the same at columns 2t + 8 and 2t + 9, and b0..b3
+//   are B[2t][g], B[2t + 1][g], B[2t + 8][g], B[2t + 9][g].
+// - c0..c3 and d0..d3 are C[g][2t], C[g][2t + 1], C[g + 8][2t],
+//   C[g + 8][2t + 1].
+// All the 32 lanes of the warp must take part. The functions return the
+// element |k| of the fragment of D; the mma.sync of the four calls with the
+// same operands are merged by the optimizer.
+
+// The tile product with shuffles, for the GPUs without the mma.sync variant.
+void warp_mma_emulated(i32 K, const f32 *a, const f32 *b, f32 *d) {
+  const i32 lane = thread_idx() & (warp_size() - 1);
+  const i32 g = lane / 4;
+  const i32 t = lane % 4;
+  for (int kk = 0; kk < K; kk++) {
+    // The lane of a group of four holding column |kk| of A and row |kk| of B,
+    // and the registers it holds them in.
+    const i32 owner = K == 8 ? kk % 4 : kk % 8 / 2;
+    const i32 a_reg = K == 8 ? 2 * (kk / 4) : kk % 2 + 4 * (kk / 8);
+    const i32 a_reg_lower = a_reg + (K == 8 ? 1 : 2);
+    const i32 b_reg = K == 8 ? kk / 4 : kk % 2 + 2 * (kk / 8);
+    const f32 a_upper =
+        cuda_shfl_sync_f32(UINT32_MAX, a[a_reg], g * 4 + owner, 31);
+    const f32 a_lower =
+        cuda_shfl_sync_f32(UINT32_MAX, a[a_reg_lower], g * 4 + owner, 31);
+    const f32 b_even =
+        cuda_shfl_sync_f32(UINT32_MAX, b[b_reg], 2 * t * 4 + owner, 31);
+    const f32 b_odd =
+        cuda_shfl_sync_f32(UINT32_MAX, b[b_reg], (2 * t + 1) * 4 + owner, 31);
+    d[0] += a_upper * b_even;
+    d[1] += a_upper * b_odd;
+    d[2] += a_lower * b_even;
+    d[3] += a_lower * b_odd;
+  }
+}
+
+f32 cuda_mma_sync_m16n8k8_tf32(f32 a0,
+                               f32 a1,
+                               f32 a2,
+                               f32 a3,
+                               f32 b0,
+                               f32 b1,
+                               f32 c0,
+                               f32 c1,
+                               f32 c2,
+                               f32 c3,
+                               i32 k) {
+  f32 d[4] = {c0, c1, c2, c3};
+#if ARCH_cuda
+  if (cuda_compute_capability() >= 80) {
+    asm("{\n"
+        ".reg .b32 ta<4>, tb<2>;\n"
+        "cvt.rna.tf32.f32 ta0, %4;\n"
+        "cvt.rna.tf32.f32 ta1, %5;\n"
+        "cvt.rna.tf32.f32 ta2, %6;\n"
+        "cvt.rna.tf32.f32 ta3, %7;\n"
+        "cvt.rna.tf32.f32 tb0, %8;\n"
+        "cvt.rna.tf32.f32 tb1, %9;\n"
+        "mma.sync.aligned.m16n8k8.row.col.f32.tf32.tf32.f32 "
+        "{%0, %1, %2, %3}, {ta0, ta1, ta2, ta3}, {tb0, tb1}, "
+        "{%10, %11, %12, %13};\n"
+        "}"
+        : "=f"(d[0]), "=f"(d[1]), "=f"(d[2]), "=f"(d[3])
+        : "f"(a0), "f"(a1), "f"(a2), "f"(a3), "f"(b0), "f"(b1), "f"(c0),
+          "f"(c1), "f"(c2), "f"(c3));
+    return d[k];
+  }
+#endif
+  const f32 a[4] = {a0, a1, a2, a3};
+  const f32 b[2] = {b0, b1};
+  warp_mma_emulated(8, a, b, d);
+  return d[k];
+}
+
+#if ARCH_cuda
+// cvt.rn.<type>x2.f32 puts its first operand in the upper half.
+#define MMA_SYNC_M16N8K16_ASM(type)                                          \
+  asm("{\n"                                                                  \
+      ".reg .b32 ta<4>, tb<2>;\n"                                            \
+      "cvt.rn." #type "x2.f32 ta0, %5, %4;\n"                               \
+      "cvt.rn." #type "x2.f32 ta1, %7, %6;\n"                               \
+      "cvt.rn." #type "x2.f32 ta2, %9, %8;\n"                               \
+      "cvt.rn." #type "x2.f32 ta3, %11, %10;\n"                             \
+      "cvt.rn." #type "x2.f32 tb0, %13, %12;\n"                             \
+      "cvt.rn." #type "x2.f32 tb1, %15, %14;\n"                             \
+      "mma.sync.aligned.m16n8k16.row.col.f32." #type "." #type ".f32 "      \
+      "{%0, %1, %2, %3}, {ta0, ta1, ta2, ta3}, {tb0, tb1}, "                 \
+      "{%16, %17, %18, %19};\n"                                              \
+      "}"                                                                    \
+      : "=f"(d[0]), "=f"(d[1]), "=f"(d[2]), "=f"(d[3])                       \
+      : "f"(a0), "f"(a1), "f"(a2), "f"(a3), "f"(a4), "f"(a5), "f"(a6),       \
+        "f"(a7), "f"(b0), "f"(b1), "f"(b2), "f"(b3), "f"(c0), "f"(c1),       \
+        "f"(c2), "f"(c3))
+#else
+#define MMA_SYNC_M16N8K16_ASM(type)
+#endif
+
+#define DEFINE_MMA_SYNC_M16N8K16(type)                                        \
+  f32 cuda_mma_sync_m16n8k16_##type(                                         \
+      f32 a0, f32 a1, f32 a2, f32 a3, f32 a4, f32 a5, f32 a6, f32 a7, f32 b0, \
+      f32 b1, f32 b2, f32 b3, f32 c0, f32 c1, f32 c2, f32 c3, i32 k) {        \
+    f32 d[4] = {c0, c1, c2, c3};                                              \
+    if (cuda_compute_capability() >= 80) {                                    \
+      MMA_SYNC_M16N8K16_ASM(type);                                            \
+      return d[k];                                                            \
+    }                                                                         \
+    const f32 a[8] = {a0, a1, a2, a3, a4, a5, a6, a7};                        \
+    const f32 b[4] = {b0, b1, b2, b3};                                        \
+    warp_mma_emulated(16, a, b, d);                                           \
+    return d[k];                                                              \
+  }
+
+DEFINE_MMA_SYNC_M16N8K16(f16);
+DEFINE_MMA_SYNC_M16N8K16(bf16);
+
 void block_barrier() {
 }
 
@@ -1228,10 +1571,120 @@ DEFINE_REDUCTION(and, i32);
 DEFINE_REDUCTION(or, i32);
 DEFINE_REDUCTION(xor, i32);
 
+// The active lanes of a warp updating the same address combine their values
+// with shuffles, one peer per round, and only the lowest of them issues the
+// atomic. The old value is not returned: the results of these atomics must be
+// unused.
+#define DEFINE_WARP_AGGREGATED_ATOMIC(op, dtype)                           \
+  void warp_aggregated_atomic_##op##_##dtype(dtype *dest, dtype val) {     \
+    if (cuda_compute_capability() < 70) {                                  \
+      /* match.any needs Volta or later. */                                \
+      atomic_##op##_##dtype(dest, val);                                    \
+      return;                                                              \
+    }                                                                      \
+    u32 mask = cuda_active_mask();                                         \
+    u32 peers = cuda_match_any_sync_i64(mask, (i64)dest);                  \
+    i32 lane = thread_idx() & (warp_size() - 1);                           \
+    u32 rest = peers & ~(1u << lane);                                      \
+    dtype combined = val;                                                  \
+    while (cuda_any_sync(mask, rest != 0)) {                               \
+      i32 src = rest != 0 ? cttz_i32(rest) : lane;                         \
+      dtype other = cuda_shfl_sync_##dtype(mask, val, src, 31);            \
+      if (rest != 0) {                                                     \
+        combined = op_##op##_##dtype(combined, other);                     \
+        rest &= rest - 1;                                                  \
+      }                                                                    \
+    }                                                                      \
+    if (lane == cttz_i32(peers)) {                                         \
+      atomic_##op##_##dtype(dest, combined);                               \
+    }                                                                      \
+  }
+
+DEFINE_WARP_AGGREGATED_ATOMIC(add, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(add, f32);
+
+DEFINE_WARP_AGGREGATED_ATOMIC(min, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(min, f32);
+
+DEFINE_WARP_AGGREGATED_ATOMIC(max, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(max, f32);
+
+DEFINE_WARP_AGGREGATED_ATOMIC(and, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(or, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(xor, i32);
+
+// The AMDGPU counterpart of DEFINE_REDUCTION, over wavefronts of 32 or 64
+// lanes. Lanes past the end of the wavefront wrap around in ds_bpermute,
+// which only pollutes the partial results of the upper lanes.
+#define DEFINE_AMDGPU_REDUCTION(op, dtype)                                  \
+  dtype amdgpu_reduce_##op##_##dtype(dtype *result, dtype val) {            \
+    const i32 wave_size = amdgpu_wavefront_size();                          \
+    const u64 full_mask = wave_size == 64 ? ~(u64)0 : (u64)0xFFFFFFFF;      \
+    if (amdgpu_ballot(true) != full_mask) {                                 \
+      atomic_##op##_##dtype(result, val);                                   \
+      return val;                                                           \
+    }                                                                       \
+    const i32 lane = thread_idx() & (wave_size - 1);                        \
+    dtype wave_result = val;                                                \
+    for (i32 offset = wave_size / 2; offset > 0; offset /= 2)               \
+      wave_result = op_##op##_##dtype(                                      \
+          wave_result, amdgpu_shfl_##dtype(wave_result, lane + offset));    \
+    if (lane == 0) {                                                        \
+      atomic_##op##_##dtype(result, wave_result);                           \
+    }                                                                       \
+    return val;                                                             \
+  }
+
+DEFINE_AMDGPU_REDUCTION(add, i32);
+DEFINE_AMDGPU_REDUCTION(add, f32);
+
+DEFINE_AMDGPU_REDUCTION(min, i32);
+DEFINE_AMDGPU_REDUCTION(min, f32);
+
+DEFINE_AMDGPU_REDUCTION(max, i32);
+DEFINE_AMDGPU_REDUCTION(max, f32);
+
+DEFINE_AMDGPU_REDUCTION(and, i32);
+DEFINE_AMDGPU_REDUCTION(or, i32);
+DEFINE_AMDGPU_REDUCTION(xor, i32);
+
+// Called whenever a node of the SNode is activated or deactivated, so that the
+// element lists of its tree are regenerated.
+void mark_topology_changed(LLVMRuntime *runtime, int snode_id) {
+  auto changed = &runtime->topology_changed[runtime->snode_tree_ids[snode_id]];
+  // Avoid writing the shared flag from every thread.
+  if (!*changed) {
+    *changed = 1;
+  }
+}
+
 // "Element", "component" are different concepts
 
+// Runs in a serial task before each listgen. The list is only cleared, and
+// regenerated by the listgen task that follows, if the topology of its tree
+// has changed since it was generated.
 void clear_list(LLVMRuntime *runtime, StructMeta *parent, StructMeta *child) {
-  auto child_list = runtime->element_lists[child->snode_id];
+  auto snode_id = child->snode_id;
+  auto tree_id = runtime->snode_tree_ids[snode_id];
+  if (runtime->topology_changed[tree_id]) {
+    runtime->topology_changed[tree_id] = 0;
+    runtime->topology_versions[tree_id]++;
+  }
+  auto version = runtime->topology_versions[tree_id] + 1;
+  if (runtime->element_list_versions[snode_id] == version) {
+    runtime->element_list_reused[snode_id] = 1;
+    return;
+  }
+  runtime->element_list_reused[snode_id] = 0;
+  runtime->element_list_sorted[snode_id] = 0;
+  runtime->element_list_versions[snode_id] = version;
+  auto child_list = runtime->element_lists[snode_id];
+  // Chunks are kept across listgens, and list sizes barely change from one
+  // listgen to the next, so reserving some headroom over the previous size
+  // here, in a serial task, keeps a slowly growing list from allocating its
+  // chunks in the middle of the parallel listgen.
+  auto prev_size = child_list->size();
+  child_list->reserve(prev_size + prev_size / 4);
   child_list->clear();
 }
 
@@ -1245,6 +1698,9 @@ void clear_list(LLVMRuntime *runtime, StructMeta *parent, StructMeta *child) {
 void element_listgen_root(LLVMRuntime *runtime,
                           StructMeta *parent,
                           StructMeta *child) {
+  if (runtime->element_list_reused[child->snode_id]) {
+    return;
+  }
   // If there's just one element in the parent list, we need to use the blocks
   // (instead of threads) to split the parent container
   auto parent_list = runtime->element_lists[parent->snode_id];
@@ -1278,8 +1734,18 @@ void element_listgen_root(LLVMRuntime *runtime,
   auto ch_element_size =
       std::min(ch_num_elements, taichi_listgen_max_element_size);
 
+  // The elements are stored in order, so the list is also sorted, unless the
+  // child iterates over slots rather than cells.
+  auto num_child_elements =
+      ch_num_elements == 0
+          ? 0
+          : (ch_num_elements + ch_element_size - 1) / ch_element_size;
+  child_list->resize(num_child_elements);
+  runtime->element_list_sorted[child->snode_id] =
+      child->get_element_index == nullptr;
+
   // Here is a grid-stride loop.
-  for (int c = c_start; c * ch_element_size < ch_num_elements; c += c_step) {
+  for (int c = c_start; c < num_child_elements; c += c_step) {
     Element elem;
     elem.element = ch_element;
     elem.loop_bounds[0] = c * ch_element_size;
@@ -1287,13 +1753,16 @@ void element_listgen_root(LLVMRuntime *runtime,
     // There is no need to refine coordinates for root listgen, since its
     // num_bits is always zero
     elem.pcoord = element.pcoord;
-    child_list->append(&elem);
+    *(Element *)child_list->touch_and_get(c) = elem;
   }
 }
 
 void element_listgen_nonroot(LLVMRuntime *runtime,
                              StructMeta *parent,
                              StructMeta *child) {
+  if (runtime->element_list_reused[child->snode_id]) {
+    return;
+  }
   auto parent_list = runtime->element_lists[parent->snode_id];
   int num_parent_elements = parent_list->size();
   auto child_list = runtime->element_lists[child->snode_id];
@@ -1301,6 +1770,7 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
   auto parent_refine_coordinates = parent->refine_coordinates;
   auto parent_is_active = parent->is_active;
   auto parent_lookup_element = parent->lookup_element;
+  auto parent_get_element_index = parent->get_element_index;
   auto child_get_num_elements = child->get_num_elements;
   auto child_from_parent_element = child->from_parent_element;
 #if ARCH_cuda
@@ -1321,11 +1791,18 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
     int j_lower = element.loop_bounds[0] + j_start;
     int j_higher = element.loop_bounds[1];
     for (int j = j_lower; j < j_higher; j += j_step) {
+      int index = j;
+      if (parent_get_element_index != nullptr) {
+        index = parent_get_element_index((Ptr)parent, element.element, j);
+        if (index == -1) {
+          continue;
+        }
+      }
       PhysicalCoordinates refined_coord;
-      parent_refine_coordinates(&element.pcoord, &refined_coord, j);
-      if (parent_is_active((Ptr)parent, element.element, j)) {
+      parent_refine_coordinates(&element.pcoord, &refined_coord, index);
+      if (parent_is_active((Ptr)parent, element.element, index)) {
         auto ch_element =
-            parent_lookup_element((Ptr)parent, element.element, j);
+            parent_lookup_element((Ptr)parent, element.element, index);
         ch_element = child_from_parent_element((Ptr)ch_element);
         auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
         auto ch_element_size =
@@ -1345,6 +1822,100 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
   }
 }
 
+// Generates the same list as element_listgen_nonroot, but in the order of the
+// parent list, and then of the cells in each parent element. If the parent
+// list is sorted, the child list ends up in the coordinate order of the SNode
+// tree. On GPUs this runs in a single block, which compacts the elements with
+// a block-wide prefix sum.
+void element_listgen_nonroot_sorted(LLVMRuntime *runtime,
+                                    StructMeta *parent,
+                                    StructMeta *child) {
+  if (runtime->element_list_reused[child->snode_id] &&
+      runtime->element_list_sorted[child->snode_id]) {
+    return;
+  }
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  int num_parent_elements = parent_list->size();
+  auto child_list = runtime->element_lists[child->snode_id];
+  // Cache the func pointers here for better compiler optimization
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto parent_is_active = parent->is_active;
+  auto parent_lookup_element = parent->lookup_element;
+  auto parent_get_element_index = parent->get_element_index;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+#if ARCH_cuda
+  int tid = thread_idx();
+  int num_threads = block_dim();
+#else
+  int tid = 0;
+  int num_threads = 1;
+#endif
+  auto scan = (volatile i32 *)runtime->listgen_scratch;
+  int num_child_elements = 0;
+  for (int i = 0; i < num_parent_elements; i++) {
+    auto element = parent_list->get<Element>(i);
+    for (int j_begin = element.loop_bounds[0];
+         j_begin < element.loop_bounds[1]; j_begin += num_threads) {
+      int j = j_begin + tid;
+      int index = j;
+      if (j < element.loop_bounds[1] && parent_get_element_index != nullptr) {
+        index = parent_get_element_index((Ptr)parent, element.element, j);
+      }
+      Ptr ch_element = nullptr;
+      i32 ch_num_elements = 0;
+      i32 ch_element_size = 0;
+      i32 count = 0;
+      if (j < element.loop_bounds[1] && index != -1 &&
+          parent_is_active((Ptr)parent, element.element, index)) {
+        ch_element =
+            parent_lookup_element((Ptr)parent, element.element, index);
+        ch_element = child_from_parent_element((Ptr)ch_element);
+        ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+        ch_element_size =
+            std::min(ch_num_elements, taichi_listgen_max_element_size);
+        if (ch_num_elements > 0) {
+          count = (ch_num_elements + ch_element_size - 1) / ch_element_size;
+        }
+      }
+      // Inclusive prefix sum of the counts of the threads in the block.
+      scan[tid] = count;
+      block_barrier();
+      for (int offset = 1; offset < num_threads; offset *= 2) {
+        auto sum = scan[tid];
+        if (tid >= offset) {
+          sum += scan[tid - offset];
+        }
+        block_barrier();
+        scan[tid] = sum;
+        block_barrier();
+      }
+      auto start = num_child_elements + scan[tid] - count;
+      num_child_elements += scan[num_threads - 1];
+      block_barrier();
+      if (count > 0) {
+        PhysicalCoordinates refined_coord;
+        parent_refine_coordinates(&element.pcoord, &refined_coord, index);
+        for (int k = 0; k < count; k++) {
+          Element elem;
+          elem.element = ch_element;
+          elem.loop_bounds[0] = k * ch_element_size;
+          elem.loop_bounds[1] =
+              std::min((k + 1) * ch_element_size, ch_num_elements);
+          elem.pcoord = refined_coord;
+          *(Element *)child_list->touch_and_get(start + k) = elem;
+        }
+      }
+    }
+  }
+  if (tid == 0) {
+    child_list->resize(num_child_elements);
+    runtime->element_list_sorted[child->snode_id] =
+        runtime->element_list_sorted[parent->snode_id] &&
+        parent_get_element_index == nullptr;
+  }
+}
+
 using BlockTask = void(RuntimeContext *, char *, Element *, int, int);
 
 struct cpu_block_task_helper_context {
@@ -1382,10 +1953,70 @@ void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
   }
 }
 
+#if ARCH_cuda
+// Runs the cells of the elements in |list| on the threads one by one, instead
+// of an element per block. Each warp takes 32 elements at a time and spreads
+// all of their cells over its lanes, using a warp-wide prefix sum of the
+// element sizes to find the element of each cell. Crowded and nearly empty
+// elements thus keep all the lanes equally busy.
+//
+// |task| is compiled for a block per element. Each call here makes it run a
+// single cell on the calling thread, so the tasks must not synchronize the
+// block, as those with block local storage do.
+void gpu_balanced_struct_for(RuntimeContext *context,
+                             char *tls_buffer,
+                             ListManager *list,
+                             BlockTask *task) {
+  const int list_tail = list->size();
+  const int lane = warp_idx();
+  const int num_warps = grid_dim() * block_dim() / warp_size();
+  const int warp_id = (block_idx() * block_dim() + thread_idx()) / warp_size();
+  for (int base = warp_id * warp_size(); base < list_tail;
+       base += num_warps * warp_size()) {
+    i32 size = 0;
+    if (base + lane < list_tail) {
+      auto &e = list->get<Element>(base + lane);
+      size = e.loop_bounds[1] - e.loop_bounds[0];
+    }
+    // Inclusive prefix sum of the sizes of the elements of the lanes.
+    i32 sum = size;
+    for (int offset = 1; offset < warp_size(); offset *= 2) {
+      auto prev = cuda_shfl_up_sync_i32(UINT32_MAX, sum, offset, 0);
+      if (lane >= offset) {
+        sum += prev;
+      }
+    }
+    const i32 total =
+        cuda_shfl_sync_i32(UINT32_MAX, sum, warp_size() - 1, 31);
+    for (i32 begin = 0; begin < total; begin += warp_size()) {
+      const i32 cell_id = begin + lane;
+      // The element of the cell is the one of the first lane whose sum
+      // exceeds the cell ID.
+      int k = 0;
+      for (int step = warp_size() / 2; step > 0; step /= 2) {
+        if (cuda_shfl_sync_i32(UINT32_MAX, sum, k + step - 1, 31) <=
+            cell_id) {
+          k += step;
+        }
+      }
+      const i32 k_sum = cuda_shfl_sync_i32(UINT32_MAX, sum, k, 31);
+      if (cell_id < total) {
+        auto &e = list->get<Element>(base + k);
+        const int cell = e.loop_bounds[1] - (k_sum - cell_id);
+        // The task starts at |lower| plus the thread index, and strides over
+        // the block.
+        task(context, tls_buffer, &e, cell - thread_idx(), cell + 1);
+      }
+    }
+  }
+}
+#endif
+
 void parallel_struct_for(RuntimeContext *context,
                          int snode_id,
                          int element_size,
                          int element_split,
+                         int balanced,
                          BlockTask *task,
                          std::size_t tls_buffer_size,
                          int num_threads) {
@@ -1396,6 +2027,11 @@ void parallel_struct_for(RuntimeContext *context,
   // Note: CUDA requires compile-time constant local array sizes.
   // We use "1" here and modify it during codegen to tls_buffer_size.
   alignas(8) char tls_buffer[1];
+  char *tls = tls_buffer;
+  if (balanced && block_dim() % warp_size() == 0) {
+    gpu_balanced_struct_for(context, tls, list, task);
+    return;
+  }
   // TODO: refactor element_split more systematically.
   element_split = 1;
   const auto part_size = element_size / element_split;
@@ -1409,7 +2045,7 @@ void parallel_struct_for(RuntimeContext *context,
     int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
     upper = std::min(upper, e.loop_bounds[1]);
     if (lower < upper)
-      task(context, tls_buffer, &list->get<Element>(element_id), lower, upper);
+      task(context, tls, &list->get<Element>(element_id), lower, upper);
     i += grid_dim();
   }
 #else
@@ -1441,8 +2077,29 @@ struct range_task_helper_context {
   int end;
   int block_size;
   int step;
+  // Only used when the TLS prologue/epilogue run once per thread. Threads
+  // then claim blocks from |block_counter| until |num_blocks| is reached.
+  int num_blocks;
+  i32 *block_counter{nullptr};
 };
 
+void cpu_parallel_range_for_block(const range_task_helper_context &ctx,
+                                  RuntimeContext *this_thread_context,
+                                  char *tls_ptr,
+                                  int block_id) {
+  if (ctx.step == 1) {
+    int block_start = ctx.begin + block_id * ctx.block_size;
+    int block_end = std::min(block_start + ctx.block_size, ctx.end);
+    ctx.body(this_thread_context, tls_ptr, block_start, block_end);
+  } else if (ctx.step == -1) {
+    // Blocks are taken from the end of the range, and the body iterates over
+    // each of them backwards.
+    int block_end = ctx.end - block_id * ctx.block_size;
+    int block_start = std::max(ctx.begin, block_end - ctx.block_size);
+    ctx.body(this_thread_context, tls_ptr, block_start, block_end);
+  }
+}
+
 void cpu_parallel_range_for_task(void *range_context,
                                  int thread_id,
                                  int task_id) {
@@ -1454,18 +2111,31 @@ void cpu_parallel_range_for_task(void *range_context,
 
   RuntimeContext this_thread_context = *ctx.context;
   this_thread_context.cpu_thread_id = thread_id;
-  if (ctx.step == 1) {
-    int block_start = ctx.begin + task_id * ctx.block_size;
-    int block_end = std::min(block_start + ctx.block_size, ctx.end);
-    for (int i = block_start; i < block_end; i++) {
-      ctx.body(&this_thread_context, tls_ptr, i);
-    }
-  } else if (ctx.step == -1) {
-    int block_start = ctx.end - task_id * ctx.block_size;
-    int block_end = std::max(ctx.begin, block_start * ctx.block_size);
-    for (int i = block_start - 1; i >= block_end; i--) {
-      ctx.body(&this_thread_context, tls_ptr, i);
-    }
+  cpu_parallel_range_for_block(ctx, &this_thread_context, tls_ptr, task_id);
+  if (ctx.epilogue)
+    ctx.epilogue(ctx.context, tls_ptr);
+}
+
+// Same as cpu_parallel_range_for_task, but each task stands for a thread that
+// keeps claiming blocks, so that the TLS prologue/epilogue (e.g. the global
+// atomics of a thread-local reduction) run once per thread instead of once
+// per block.
+void cpu_parallel_range_for_thread_task(void *range_context,
+                                        int thread_id,
+                                        int task_id) {
+  auto ctx = *(range_task_helper_context *)range_context;
+  alignas(8) char tls_buffer[ctx.tls_size];
+  auto tls_ptr = &tls_buffer[0];
+  if (ctx.prologue)
+    ctx.prologue(ctx.context, tls_ptr);
+
+  RuntimeContext this_thread_context = *ctx.context;
+  this_thread_context.cpu_thread_id = thread_id;
+  while (true) {
+    int block_id = atomic_add_i32(ctx.block_counter, 1);
+    if (block_id >= ctx.num_blocks)
+      break;
+    cpu_parallel_range_for_block(ctx, &this_thread_context, tls_ptr, block_id);
   }
   if (ctx.epilogue)
     ctx.epilogue(ctx.context, tls_ptr);
@@ -1480,7 +2150,8 @@ void cpu_parallel_range_for(RuntimeContext *context,
                             range_for_xlogue prologue,
                             RangeForTaskFunc *body,
                             range_for_xlogue epilogue,
-                            std::size_t tls_size) {
+                            std::size_t tls_size,
+                            bool tls_per_thread) {
   range_task_helper_context ctx;
   ctx.context = context;
   ctx.prologue = prologue;
@@ -1496,16 +2167,107 @@ void cpu_parallel_range_for(RuntimeContext *context,
   }
   ctx.block_size = block_dim;
   auto runtime = context->runtime;
+  int num_blocks = (end - begin + block_dim - 1) / block_dim;
+  if (tls_per_thread && (prologue || epilogue)) {
+    i32 block_counter = 0;
+    ctx.num_blocks = num_blocks;
+    ctx.block_counter = &block_counter;
+    runtime->parallel_for(runtime->thread_pool,
+                          std::min(num_blocks, num_threads), num_threads, &ctx,
+                          cpu_parallel_range_for_thread_task);
+  } else {
+    runtime->parallel_for(runtime->thread_pool, num_blocks, num_threads, &ctx,
+                          cpu_parallel_range_for_task);
+  }
+}
+
+// The 64-bit counterpart of cpu_parallel_range_for, used when the bounds of a
+// range-for may not fit in 32 bits. Since task ids of the thread pool are
+// 32-bit, each task stands for a thread that claims blocks from a 64-bit
+// counter, as in cpu_parallel_range_for_thread_task.
+struct range_task_helper_context_i64 {
+  RuntimeContext *context;
+  range_for_xlogue prologue{nullptr};
+  RangeForTaskFuncI64 *body{nullptr};
+  range_for_xlogue epilogue{nullptr};
+  std::size_t tls_size{1};
+  i64 begin;
+  i64 end;
+  i64 block_size;
+  int step;
+  i64 num_blocks;
+  i64 *block_counter{nullptr};
+};
+
+void cpu_parallel_range_for_i64_task(void *range_context,
+                                     int thread_id,
+                                     int task_id) {
+  auto ctx = *(range_task_helper_context_i64 *)range_context;
+  alignas(8) char tls_buffer[ctx.tls_size];
+  auto tls_ptr = &tls_buffer[0];
+  if (ctx.prologue)
+    ctx.prologue(ctx.context, tls_ptr);
+
+  RuntimeContext this_thread_context = *ctx.context;
+  this_thread_context.cpu_thread_id = thread_id;
+  while (true) {
+    i64 block_id = atomic_add_i64(ctx.block_counter, 1);
+    if (block_id >= ctx.num_blocks)
+      break;
+    if (ctx.step == 1) {
+      i64 block_start = ctx.begin + block_id * ctx.block_size;
+      i64 block_end = std::min(block_start + ctx.block_size, ctx.end);
+      ctx.body(&this_thread_context, tls_ptr, block_start, block_end);
+    } else if (ctx.step == -1) {
+      i64 block_end = ctx.end - block_id * ctx.block_size;
+      i64 block_start = std::max(ctx.begin, block_end - ctx.block_size);
+      ctx.body(&this_thread_context, tls_ptr, block_start, block_end);
+    }
+  }
+  if (ctx.epilogue)
+    ctx.epilogue(ctx.context, tls_ptr);
+}
+
+void cpu_parallel_range_for_i64(RuntimeContext *context,
+                                int num_threads,
+                                i64 begin,
+                                i64 end,
+                                int step,
+                                int block_dim,
+                                range_for_xlogue prologue,
+                                RangeForTaskFuncI64 *body,
+                                range_for_xlogue epilogue,
+                                std::size_t tls_size) {
+  range_task_helper_context_i64 ctx;
+  ctx.context = context;
+  ctx.prologue = prologue;
+  ctx.tls_size = tls_size;
+  ctx.body = body;
+  ctx.epilogue = epilogue;
+  ctx.begin = begin;
+  ctx.end = end;
+  ctx.step = step;
+  if (step != 1 && step != -1) {
+    taichi_printf(context->runtime, "step must not be %d\n", step);
+    exit(-1);
+  }
+  ctx.block_size = block_dim;
+  if (end <= begin)
+    return;
+  i64 block_counter = 0;
+  ctx.num_blocks = (end - begin + block_dim - 1) / block_dim;
+  ctx.block_counter = &block_counter;
+  auto runtime = context->runtime;
   runtime->parallel_for(runtime->thread_pool,
-                        (end - begin + block_dim - 1) / block_dim, num_threads,
-                        &ctx, cpu_parallel_range_for_task);
+                        (int)std::min<i64>(ctx.num_blocks, num_threads),
+                        num_threads, &ctx, cpu_parallel_range_for_i64_task);
 }
 
 void gpu_parallel_range_for(RuntimeContext *context,
                             int begin,
                             int end,
                             range_for_xlogue prologue,
-                            RangeForTaskFunc *func,
+                            IndexTaskFunc *func,
                             range_for_xlogue epilogue,
                             const std::size_t tls_size) {
   int idx = thread_idx() + block_dim() * block_idx() + begin;
@@ -1521,14 +2283,61 @@ void gpu_parallel_range_for(RuntimeContext *context,
     epilogue(context, tls_ptr);
 }
 
+void gpu_parallel_range_for_i64(RuntimeContext *context,
+                                i64 begin,
+                                i64 end,
+                                range_for_xlogue prologue,
+                                IndexTaskFuncI64 *func,
+                                range_for_xlogue epilogue,
+                                const std::size_t tls_size) {
+  i64 idx = thread_idx() + (i64)block_dim() * block_idx() + begin;
+  alignas(8) char tls_buffer[tls_size];
+  auto tls_ptr = &tls_buffer[0];
+  if (prologue)
+    prologue(context, tls_ptr);
+  while (idx < end) {
+    func(context, tls_ptr, idx);
+    idx += (i64)block_dim() * grid_dim();
+  }
+  if (epilogue)
+    epilogue(context, tls_ptr);
+}
+
+// Unlike gpu_parallel_range_for(), all the threads of a block call |func| with
+// the first index of the block, even if some of the indices of the block are
+// beyond |end|. This lets the threads cooperate through shared memory and
+// barriers. |func| masks off the indices beyond |end|.
+void gpu_parallel_range_for_blocks(RuntimeContext *context,
+                                   int begin,
+                                   int end,
+                                   range_for_xlogue prologue,
+                                   RangeForTaskFunc *func,
+                                   range_for_xlogue epilogue,
+                                   const std::size_t tls_size) {
+  int block_begin = block_dim() * block_idx() + begin;
+  alignas(8) char tls_buffer[tls_size];
+  auto tls_ptr = &tls_buffer[0];
+  if (prologue)
+    prologue(context, tls_ptr);
+  while (block_begin < end) {
+    func(context, tls_ptr, block_begin, end);
+    block_begin += block_dim() * grid_dim();
+  }
+  if (epilogue)
+    epilogue(context, tls_ptr);
+}
+
 struct mesh_task_helper_context {
   RuntimeContext *context;
   mesh_for_xlogue prologue{nullptr};
-  RangeForTaskFunc *body{nullptr};
+  IndexTaskFunc *body{nullptr};
   mesh_for_xlogue epilogue{nullptr};
   std::size_t tls_size{1};
   int num_patches;
   int block_size;
+  // See range_task_helper_context.
+  int num_blocks;
+  i32 *block_counter{nullptr};
 };
 
 void cpu_parallel_mesh_for_task(void *range_context,
@@ -1553,14 +2362,45 @@ void cpu_parallel_mesh_for_task(void *range_context,
   }
 }
 
+// See cpu_parallel_range_for_thread_task. The TLS xlogues are handed the
+// first and the last patch processed by the thread respectively.
+void cpu_parallel_mesh_for_thread_task(void *range_context,
+                                       int thread_id,
+                                       int task_id) {
+  auto ctx = *(mesh_task_helper_context *)range_context;
+  alignas(8) char tls_buffer[ctx.tls_size];
+  auto tls_ptr = &tls_buffer[0];
+
+  RuntimeContext this_thread_context = *ctx.context;
+  this_thread_context.cpu_thread_id = thread_id;
+
+  int last_idx = -1;
+  while (true) {
+    int block_id = atomic_add_i32(ctx.block_counter, 1);
+    if (block_id >= ctx.num_blocks)
+      break;
+    int block_start = block_id * ctx.block_size;
+    int block_end = std::min(block_start + ctx.block_size, ctx.num_patches);
+    for (int idx = block_start; idx < block_end; idx++) {
+      if (last_idx == -1 && ctx.prologue)
+        ctx.prologue(ctx.context, tls_ptr, idx);
+      ctx.body(&this_thread_context, tls_ptr, idx);
+      last_idx = idx;
+    }
+  }
+  if (last_idx != -1 && ctx.epilogue)
+    ctx.epilogue(ctx.context, tls_ptr, last_idx);
+}
+
 void cpu_parallel_mesh_for(RuntimeContext *context,
                            int num_threads,
                            int num_patches,
                            int block_dim,
                            mesh_for_xlogue prologue,
-                           RangeForTaskFunc *body,
+                           IndexTaskFunc *body,
                            mesh_for_xlogue epilogue,
-                           std::size_t tls_size) {
+                           std::size_t tls_size,
+                           bool tls_per_thread) {
   mesh_task_helper_context ctx;
   ctx.context = context;
   ctx.prologue = prologue;
@@ -1576,9 +2416,18 @@ void cpu_parallel_mesh_for(RuntimeContext *context,
   }
   ctx.block_size = block_dim;
   auto runtime = context->runtime;
-  runtime->parallel_for(runtime->thread_pool,
-                        (num_patches + block_dim - 1) / block_dim, num_threads,
-                        &ctx, cpu_parallel_mesh_for_task);
+  int num_blocks = (num_patches + block_dim - 1) / block_dim;
+  if (tls_per_thread && (prologue || epilogue)) {
+    i32 block_counter = 0;
+    ctx.num_blocks = num_blocks;
+    ctx.block_counter = &block_counter;
+    runtime->parallel_for(runtime->thread_pool,
+                          std::min(num_blocks, num_threads), num_threads, &ctx,
+                          cpu_parallel_mesh_for_thread_task);
+  } else {
+    runtime->parallel_for(runtime->thread_pool, num_blocks, num_threads, &ctx,
+                          cpu_parallel_mesh_for_task);
+  }
 }
 
 void gpu_parallel_mesh_for(RuntimeContext *context,
@@ -1609,6 +2458,7 @@ i32 linear_thread_idx(RuntimeContext *context) {
 #include "node_dense.h"
 #include "node_dynamic.h"
 #include "node_pointer.h"
+#include "node_hash.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
 
@@ -1623,6 +2473,7 @@ void ListManager::touch_chunk(int chunk_id) {
         auto chunk_ptr = runtime->request_allocate_aligned(
             max_num_elements_per_chunk * element_size, 4096);
         atomic_exchange_u64((u64 *)&chunks[chunk_id], (u64)chunk_ptr);
+        num_chunks++;
       }
     });
   }
@@ -1640,6 +2491,7 @@ Ptr ListManager::allocate() {
 
 void node_gc(LLVMRuntime *runtime, int snode_id) {
   runtime->node_allocators[snode_id]->gc_serial();
+  mark_topology_changed(runtime, snode_id);
 }
 
 void runtime_context_gc(LLVMRuntime *runtime) {
@@ -1697,6 +2549,7 @@ void gc_parallel_impl_1(NodeManager *allocator) {
 void gc_parallel_1(RuntimeContext *context, int snode_id) {
   LLVMRuntime *runtime = context->runtime;
   gc_parallel_impl_1(runtime->node_allocators[snode_id]);
+  mark_topology_changed(runtime, snode_id);
 }
 
 void gc_rc_parallel_1(RuntimeContext *context) {
@@ -1794,6 +2647,80 @@ i32 rand_i32(RuntimeContext *context) {
 i64 rand_i64(RuntimeContext *context) {
   return rand_u64(context);
 }
+
+// Philox4x32-10 from "Parallel random numbers: as easy as 1, 2, 3" (Salmon et
+// al., 2011). The random numbers are a function of (seed, launch, task,
+// iteration, counter) only, so there are no states to load or store.
+u64 rand_philox(RuntimeContext *context,
+                u32 seed,
+                u32 task_id,
+                u64 iteration,
+                u32 counter) {
+  u32 c0 = counter, c1 = task_id, c2 = (u32)iteration,
+      c3 = (u32)(iteration >> 32);
+  u32 k0 = seed, k1 = (u32)context->rand_launch_id;
+  for (int i = 0; i < 10; i++) {
+    u64 p0 = (u64)0xD2511F53u * c0;
+    u64 p1 = (u64)0xCD9E8D57u * c2;
+    c0 = (u32)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (u32)p1;
+    c2 = (u32)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (u32)p0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  return ((u64)c0 << 32) | c1;
+}
+
+u32 rand_philox_u32(RuntimeContext *context,
+                    u32 seed,
+                    u32 task_id,
+                    u64 iteration,
+                    u32 counter) {
+  return (u32)rand_philox(context, seed, task_id, iteration, counter);
+}
+
+u64 rand_philox_u64(RuntimeContext *context,
+                    u32 seed,
+                    u32 task_id,
+                    u64 iteration,
+                    u32 counter) {
+  return rand_philox(context, seed, task_id, iteration, counter);
+}
+
+f32 rand_philox_f32(RuntimeContext *context,
+                    u32 seed,
+                    u32 task_id,
+                    u64 iteration,
+                    u32 counter) {
+  return (rand_philox_u32(context, seed, task_id, iteration, counter) >> 8) *
+         (1.0f / 16777216.0f);
+}
+
+f64 rand_philox_f64(RuntimeContext *context,
+                    u32 seed,
+                    u32 task_id,
+                    u64 iteration,
+                    u32 counter) {
+  return (rand_philox(context, seed, task_id, iteration, counter) >> 11) *
+         (1.0 / 9007199254740992.0);
+}
+
+i32 rand_philox_i32(RuntimeContext *context,
+                    u32 seed,
+                    u32 task_id,
+                    u64 iteration,
+                    u32 counter) {
+  return rand_philox_u32(context, seed, task_id, iteration, counter);
+}
+
+i64 rand_philox_i64(RuntimeContext *context,
+                    u32 seed,
+                    u32 task_id,
+                    u64 iteration,
+                    u32 counter) {
+  return rand_philox(context, seed, task_id, iteration, counter);
+}
 };
 
 struct printf_helper {
@@ -1865,6 +2792,63 @@ void stack_push(Ptr stack, size_t max_num_elements, std::size_t element_size) {
   std::memset(stack_top_primal(stack, element_size), 0, element_size * 2);
 }
 
+// AD-stacks that only keep their top |window| entries in the thread-local
+// buffer. Entry i sits in slot i % window while it is one of them, and is
+// moved to spill + (i - window) * entry_size when entry i + window is pushed.
+// The header holds the number of entries and the spill pointer.
+
+Ptr stack_top_primal_spilled(Ptr stack,
+                             std::size_t window,
+                             std::size_t element_size) {
+  auto n = *(u64 *)stack;
+  return stack + 2 * sizeof(u64) + (n - 1) % window * 2 * element_size;
+}
+
+Ptr stack_top_adjoint_spilled(Ptr stack,
+                              std::size_t window,
+                              std::size_t element_size) {
+  return stack_top_primal_spilled(stack, window, element_size) + element_size;
+}
+
+void stack_init_spilled(Ptr stack, Ptr spill) {
+  *(u64 *)stack = 0;
+  *(Ptr *)(stack + sizeof(u64)) = spill;
+}
+
+void stack_push_spilled(Ptr stack,
+                        std::size_t window,
+                        std::size_t element_size) {
+  u64 &n = *(u64 *)stack;
+  auto entry_size = 2 * element_size;
+  auto slot = stack + 2 * sizeof(u64) + n % window * entry_size;
+  if (n >= window) {
+    auto spill = *(Ptr *)(stack + sizeof(u64));
+    std::memcpy(spill + (n - window) * entry_size, slot, entry_size);
+  }
+  n += 1;
+  std::memset(slot, 0, entry_size);
+}
+
+void stack_pop_spilled(Ptr stack,
+                       std::size_t window,
+                       std::size_t element_size) {
+  u64 &n = *(u64 *)stack;
+  n--;
+  if (n >= window) {
+    auto entry_size = 2 * element_size;
+    auto spill = *(Ptr *)(stack + sizeof(u64));
+    std::memcpy(stack + 2 * sizeof(u64) + n % window * entry_size,
+                spill + (n - window) * entry_size, entry_size);
+  }
+}
+
+Ptr stack_spill_region(RuntimeContext *context,
+                       std::size_t bytes_per_thread,
+                       std::size_t offset) {
+  return context->runtime->ad_stack_spill_buffer +
+         linear_thread_idx(context) * bytes_per_thread + offset;
+}
+
 #include "internal_functions.h"
 
 // TODO: make here less repetitious.
@@ -1881,6 +2865,18 @@ void stack_push(Ptr stack, size_t max_num_elements, std::size_t element_size) {
                                                                               \
   void atomic_set_mask_b##N(u##N *ptr, u64 mask, u##N value) {                \
     u##N mask_N = (u##N)mask;                                                 \
+    /* Clearing or filling the bits, e.g. of 1-bit flags, takes a single */   \
+    /* atomic.                                                           */   \
+    if ((value & mask_N) == 0) {                                              \
+      __atomic_fetch_and(ptr, (u##N)~mask_N,                                  \
+                         std::memory_order::memory_order_seq_cst);            \
+      return;                                                                 \
+    }                                                                         \
+    if ((value & mask_N) == mask_N) {                                         \
+      __atomic_fetch_or(ptr, mask_N,                                          \
+                        std::memory_order::memory_order_seq_cst);             \
+      return;                                                                 \
+    }                                                                         \
     u##N new_value = 0;                                                       \
     u##N old_value = *ptr;                                                    \
     do {                                                                      \
@@ -1905,6 +2901,11 @@ void stack_push(Ptr stack, size_t max_num_elements, std::size_t element_size) {
                                                                               \
   u##N atomic_add_partial_bits_b##N(u##N *ptr, u32 offset, u32 bits,          \
                                     u##N value) {                             \
+    /* The carry out of the highest bits of the word is dropped anyway. */    \
+    if (offset + bits == N) {                                                 \
+      return __atomic_fetch_add(ptr, value << offset,                         \
+                                std::memory_order::memory_order_seq_cst);     \
+    }                                                                         \
     u##N mask = ((~(u##N)0) << (N - bits)) >> (N - offset - bits);            \
     u##N new_value = 0;                                                       \
     u##N old_value = *ptr;                                                    \
@@ -1948,6 +2949,8 @@ f64 rounding_prepare_f64(f64 f) {
 }
 }
 
+#include "svd.h"
+
 namespace {
 i32 kWasmPrintBufferSize = 1024 * 1024;
 }
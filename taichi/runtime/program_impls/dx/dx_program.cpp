@@ -44,6 +44,8 @@ void Dx11ProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   gfx::GfxRuntime::Params params;
   params.host_result_buffer = *result_buffer_ptr;
   params.device = device_.get();
+  params.submission = gfx::SubmissionConfig::from_compile_config(*config);
+  params.profiler = profiler;
   runtime_ = std::make_unique<gfx::GfxRuntime>(std::move(params));
   snode_tree_mgr_ = std::make_unique<gfx::SNodeTreeManager>(runtime_.get());
 }
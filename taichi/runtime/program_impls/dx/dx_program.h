@@ -63,6 +63,10 @@ class Dx11ProgramImpl : public ProgramImpl {
     return snode_tree_mgr_->get_snode_tree_device_ptr(tree_id);
   }
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) override {
+    return snode_tree_mgr_->get_snode_tree_buffer_size(tree_id);
+  }
+
  private:
   std::shared_ptr<Device> device_{nullptr};
   std::unique_ptr<gfx::GfxRuntime> runtime_{nullptr};
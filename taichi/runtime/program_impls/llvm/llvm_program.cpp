@@ -8,6 +8,7 @@
 #include "taichi/runtime/llvm/aot_graph_data.h"
 #include "taichi/runtime/llvm/llvm_offline_cache.h"
 #include "taichi/analysis/offline_cache_util.h"
+#include "taichi/util/lock.h"
 #include "taichi/runtime/cpu/aot_module_builder_impl.h"
 
 #if defined(TI_WITH_CUDA)
@@ -21,17 +22,38 @@
 #endif
 
 namespace taichi::lang {
+namespace {
+
+LlvmOfflineCache::Format offline_cache_format(const CompileConfig &config) {
+  if (config.offline_cache_shared) {
+    return LlvmOfflineCache::SHARED;
+  }
+  return config.offline_cache_packed ? LlvmOfflineCache::PACKED
+                                     : LlvmOfflineCache::LL;
+}
+
+}  // namespace
 
 LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
                                  KernelProfilerBase *profiler)
     : ProgramImpl(config_),
-      compilation_workers("compile", config_.num_compile_threads) {
+      compilation_workers("compile", config_.num_compile_threads),
+      kernel_pipeline_workers("compile_pipeline", config_.num_compile_threads) {
   runtime_exec_ = std::make_unique<LlvmRuntimeExecutor>(config_, profiler);
   cache_data_ = std::make_unique<LlvmOfflineCache>();
   if (config_.offline_cache) {
-    cache_reader_ =
-        LlvmOfflineCacheFileReader::make(offline_cache::get_cache_path_by_arch(
-            config_.offline_cache_file_path, config->arch));
+    const auto cache_path = offline_cache::get_cache_path_by_arch(
+        config_.offline_cache_file_path, config->arch);
+    if (config_.offline_cache_shared) {
+      // Kernels are written there as they are compiled.
+      taichi::create_directories(cache_path);
+      remote_cache_ =
+          offline_cache::make_cache_storage(config_.offline_cache_remote_url);
+    } else if (!config_.offline_cache_remote_url.empty()) {
+      TI_WARN("offline_cache_remote_url requires offline_cache_shared");
+    }
+    cache_reader_ = LlvmOfflineCacheFileReader::make(
+        cache_path, offline_cache_format(config_), remote_cache_.get());
   }
 }
 
@@ -41,6 +63,48 @@ FunctionType LlvmProgramImpl::compile(const CompileConfig &compile_config,
   return codegen->compile_to_function();
 }
 
+void LlvmProgramImpl::compile_kernels(
+    const CompileConfig &compile_config,
+    const std::vector<Kernel *> &kernels,
+    const CompiledKernelCallback &on_compiled) {
+  const auto arch = compile_config.arch;
+  const bool supports_pipeline =
+      arch_is_cpu(arch) || arch == Arch::cuda || arch == Arch::amdgpu;
+  if (!supports_pipeline || kernel_pipeline_workers.get_num_threads() <= 0 ||
+      kernels.size() <= 1) {
+    ProgramImpl::compile_kernels(compile_config, kernels, on_compiled);
+    return;
+  }
+
+  std::vector<std::unique_ptr<KernelCodeGen>> codegens;
+  std::vector<std::optional<KernelCodeGen::CompiledTasks>> tasks(
+      kernels.size());
+  std::vector<std::future<void>> compilations;
+  for (int i = 0; i < (int)kernels.size(); i++) {
+    codegens.push_back(KernelCodeGen::create(&compile_config, kernels[i]));
+  }
+  for (int i = 0; i < (int)kernels.size(); i++) {
+    compilations.push_back(kernel_pipeline_workers.enqueue(
+        [&, i]() { tasks[i] = codegens[i]->compile_kernel_to_tasks(); }));
+  }
+
+  try {
+    for (int i = 0; i < (int)kernels.size(); i++) {
+      compilations[i].get();
+      auto linked = codegens[i]->link_kernel_tasks(std::move(tasks[i]));
+      on_compiled(i, codegens[i]->convert_to_function(std::move(linked)));
+    }
+  } catch (...) {
+    // The pending compilations refer to |codegens| and |tasks|.
+    for (auto &compilation : compilations) {
+      if (compilation.valid()) {
+        compilation.wait();
+      }
+    }
+    throw;
+  }
+}
+
 std::unique_ptr<StructCompiler> LlvmProgramImpl::compile_snode_tree_types_impl(
     SNodeTree *tree) {
   auto *const root = tree->root();
@@ -118,9 +182,65 @@ void LlvmProgramImpl::cache_kernel(const std::string &kernel_key,
   auto &kernel_cache = cache_data_->kernels[kernel_key];
   kernel_cache.kernel_key = kernel_key;
   kernel_cache.compiled_data = data.clone();
+  // Native code is only written by cache_native_code().
+  kernel_cache.compiled_data.native_code_key.clear();
+  kernel_cache.compiled_data.native_code.clear();
   kernel_cache.args = std::move(args);
   kernel_cache.created_at = std::time(nullptr);
   kernel_cache.last_used_at = std::time(nullptr);
+  if (config->offline_cache && config->offline_cache_shared) {
+    LlvmOfflineCacheFileWriter::publish_kernel(
+        offline_cache::get_cache_path_by_arch(config->offline_cache_file_path,
+                                              config->arch),
+        kernel_cache, remote_cache_.get());
+  }
+}
+
+std::optional<RaiiCleanup> LlvmProgramImpl::acquire_compile_lease(
+    const std::string &kernel_key) {
+  const int timeout_ms = config->offline_cache_compile_lease_ms;
+  if (!config->offline_cache || !config->offline_cache_shared ||
+      timeout_ms <= 0) {
+    return std::nullopt;
+  }
+  const auto lease_path = taichi::join_path(
+      offline_cache::get_cache_path_by_arch(config->offline_cache_file_path,
+                                            config->arch),
+      kernel_key + "." + offline_cache::kLlvmCacheFilenameLeaseExt);
+  if (!acquire_file_lease(lease_path, timeout_ms)) {
+    TI_DEBUG("Timed out waiting for {}", lease_path);
+    return std::nullopt;
+  }
+  return make_cleanup([lease_path]() { unlock_with_file(lease_path); });
+}
+
+void LlvmProgramImpl::cache_native_code(const std::string &kernel_key,
+                                        const LLVMCompiledKernel &data) {
+  auto itr = cache_data_->kernels.find(kernel_key);
+  if (itr == cache_data_->kernels.end()) {
+    return;
+  }
+  auto &compiled_data = itr->second.compiled_data;
+  compiled_data.native_code_key = data.native_code_key;
+  compiled_data.native_code = data.native_code;
+  LlvmOfflineCacheFileWriter::publish_native_code(remote_cache_.get(),
+                                                  kernel_key, data);
+}
+
+void LlvmProgramImpl::cache_block_dims(
+    const std::string &kernel_key,
+    const std::vector<OffloadedTask> &tasks) {
+  auto itr = cache_data_->kernels.find(kernel_key);
+  if (itr == cache_data_->kernels.end()) {
+    return;
+  }
+  auto &cached_tasks = itr->second.compiled_data.tasks;
+  TI_ASSERT(cached_tasks.size() == tasks.size());
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    cached_tasks[i].block_dim = tasks[i].block_dim;
+    cached_tasks[i].grid_dim = tasks[i].grid_dim;
+    cached_tasks[i].block_dim_tuned = tasks[i].block_dim_tuned;
+  }
 }
 
 void LlvmProgramImpl::cache_field(int snode_tree_id,
@@ -158,7 +278,7 @@ void LlvmProgramImpl::dump_cache_data_to_disk() {
         offline_cache::get_cache_path_by_arch(config->offline_cache_file_path,
                                               config->arch),
         policy, config->offline_cache_max_size_of_files,
-        config->offline_cache_cleaning_factor);
+        config->offline_cache_cleaning_factor, offline_cache_format(*config));
     if (!cache_data_->kernels.empty()) {
       LlvmOfflineCacheFileWriter writer{};
       writer.set_data(std::move(cache_data_));
@@ -167,7 +287,7 @@ void LlvmProgramImpl::dump_cache_data_to_disk() {
       // old-metadata
       writer.dump(offline_cache::get_cache_path_by_arch(
                       config->offline_cache_file_path, config->arch),
-                  LlvmOfflineCache::LL, true);
+                  offline_cache_format(*config), true);
     }
   }
 }
@@ -2,7 +2,9 @@
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 
+#include "taichi/common/cleanup.h"
 #include "taichi/runtime/llvm/llvm_offline_cache.h"
 #include "taichi/program/compile_config.h"
 #include "taichi/runtime/llvm/llvm_runtime_executor.h"
@@ -43,6 +45,14 @@ class LlvmProgramImpl : public ProgramImpl {
   FunctionType compile(const CompileConfig &compile_config,
                        Kernel *kernel) override;
 
+  // Lowers and compiles the offloaded tasks of different kernels concurrently
+  // on |kernel_pipeline_workers|. Linking and loading happen on the calling
+  // thread in the order of |kernels|, overlapping with the compilation of the
+  // kernels that follow.
+  void compile_kernels(const CompileConfig &compile_config,
+                       const std::vector<Kernel *> &kernels,
+                       const CompiledKernelCallback &on_compiled) override;
+
   void compile_snode_tree_types(SNodeTree *tree) override;
 
   // TODO(zhanlue): refactor materialize_snode_tree()
@@ -55,6 +65,22 @@ class LlvmProgramImpl : public ProgramImpl {
                     std::vector<LlvmLaunchArgInfo> &&args);
   ;
 
+  // With CompileConfig::offline_cache_compile_lease_ms, waits while another
+  // process compiles the kernel cached as |kernel_key|, then returns a lease
+  // that makes the other processes wait in turn until it is destroyed.
+  // Returns std::nullopt if leases are disabled or the wait timed out.
+  std::optional<RaiiCleanup> acquire_compile_lease(
+      const std::string &kernel_key);
+
+  // Adds the native code of |data| to the kernel cached as |kernel_key|.
+  void cache_native_code(const std::string &kernel_key,
+                         const LLVMCompiledKernel &data);
+
+  // Saves the tuned launch parameters of |tasks|, see
+  // CompileConfig::gpu_autotune_block_dim.
+  void cache_block_dims(const std::string &kernel_key,
+                        const std::vector<OffloadedTask> &tasks);
+
   void cache_field(int snode_tree_id,
                    int root_id,
                    const StructCompiler &struct_compiler);
@@ -114,6 +140,8 @@ class LlvmProgramImpl : public ProgramImpl {
   }
 
   void finalize() override {
+    // Tiered kernels may be recompiling in the background.
+    compilation_workers.flush();
     runtime_exec_->finalize();
   }
 
@@ -127,15 +155,89 @@ class LlvmProgramImpl : public ProgramImpl {
     return runtime_exec_->fill_ndarray(alloc, size, data);
   }
 
+  StreamSemaphore fill_ndarray_async(const DeviceAllocation &alloc,
+                                     std::size_t size,
+                                     uint32_t data) override {
+    return runtime_exec_->fill_ndarray_async(alloc, size, data);
+  }
+
+  StreamSemaphore copy_ndarray_async(DevicePtr dst,
+                                     DevicePtr src,
+                                     std::size_t size) override {
+    return runtime_exec_->copy_ndarray_async(dst, src, size);
+  }
+
+  void wait_semaphore(const StreamSemaphore &sema) override {
+    runtime_exec_->wait_semaphore(sema);
+  }
+
+  StreamSemaphore signal_semaphore() override {
+    return runtime_exec_->signal_semaphore();
+  }
+
+  StreamSemaphore copy_from_host_async(DevicePtr dst,
+                                       const void *src,
+                                       std::size_t size,
+                                       const StreamSemaphore &wait) override {
+    return runtime_exec_->copy_from_host_async(dst, src, size, wait);
+  }
+
+  void copy_to_host(void *dst, DevicePtr src, std::size_t size) override {
+    runtime_exec_->copy_to_host(dst, src, size);
+  }
+
   void prepare_runtime_context(RuntimeContext *ctx) override {
     runtime_exec_->prepare_runtime_context(ctx);
   }
 
+  std::shared_ptr<aot::GraphRunner> make_graph_runner() override {
+    return runtime_exec_->make_graph_runner();
+  }
+
+  std::unique_ptr<LaunchStreams> make_launch_streams() override {
+    return runtime_exec_->make_launch_streams();
+  }
+
+  void set_launch_stream(uint64 stream) override {
+    runtime_exec_->set_launch_stream(stream);
+  }
+
+  uint64 get_launch_stream() override {
+    return runtime_exec_->get_launch_stream();
+  }
+
   DeviceAllocation allocate_memory_ndarray(std::size_t alloc_size,
                                            uint64 *result_buffer) override {
     return runtime_exec_->allocate_memory_ndarray(alloc_size, result_buffer);
   }
 
+  DeviceAllocation import_memory(void *ptr, std::size_t size) override {
+    return runtime_exec_->import_memory(ptr, size);
+  }
+
+  std::string export_memory_ipc_handle(DevicePtr ptr) override {
+    return runtime_exec_->export_memory_ipc_handle(ptr);
+  }
+
+  void *open_memory_ipc_handle(const std::string &handle,
+                               std::function<void()> *release) override {
+    return runtime_exec_->open_memory_ipc_handle(handle, release);
+  }
+
+  DeviceAllocation allocate_texture(const ImageParams &params) override {
+    return runtime_exec_->allocate_texture(params);
+  }
+
+  void deallocate_texture(DeviceAllocation texture) override {
+    runtime_exec_->deallocate_texture(texture);
+  }
+
+  void copy_buffer_to_texture(DeviceAllocation texture,
+                              DevicePtr src,
+                              const BufferImageCopyParams &params) override {
+    runtime_exec_->copy_buffer_to_texture(texture, src, params);
+  }
+
   Device *get_compute_device() override {
     return runtime_exec_->get_compute_device();
   }
@@ -166,6 +268,12 @@ class LlvmProgramImpl : public ProgramImpl {
     return runtime_exec_->fetch_result_uint64(i, result_buffer);
   }
 
+  std::unique_ptr<DeferredResults> fetch_results_deferred(
+      int n,
+      uint64 *result_buffer) override {
+    return runtime_exec_->fetch_results_deferred(n, result_buffer);
+  }
+
   template <typename T, typename... Args>
   T runtime_query(const std::string &key,
                   uint64 *result_buffer,
@@ -184,6 +292,12 @@ class LlvmProgramImpl : public ProgramImpl {
     runtime_exec_->print_memory_profiler_info(snode_trees_, result_buffer);
   }
 
+  MemoryStats get_memory_stats(
+      const std::vector<std::unique_ptr<SNodeTree>> &snode_trees,
+      uint64 *result_buffer) override {
+    return runtime_exec_->get_memory_stats(snode_trees, result_buffer);
+  }
+
   TaichiLLVMContext *get_llvm_context(Arch arch) {
     return runtime_exec_->get_llvm_context(arch);
   }
@@ -228,6 +342,10 @@ class LlvmProgramImpl : public ProgramImpl {
     return runtime_exec_->get_snode_tree_device_ptr(tree_id);
   }
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) override {
+    return runtime_exec_->get_snode_tree_buffer_size(tree_id);
+  }
+
   cuda::CudaDevice *cuda_device() {
     return runtime_exec_->cuda_device();
   }
@@ -292,11 +410,16 @@ class LlvmProgramImpl : public ProgramImpl {
     runtime_exec_.reset();
   }
   ParallelExecutor compilation_workers;  // parallel compilation
+  // Runs the per-kernel part of compile_kernels(). Kept apart from
+  // |compilation_workers| since its tasks wait for the tasks of the latter.
+  ParallelExecutor kernel_pipeline_workers;
 
  private:
   std::size_t num_snode_trees_processed_{0};
   std::unique_ptr<LlvmRuntimeExecutor> runtime_exec_;
   std::unique_ptr<LlvmOfflineCache> cache_data_;
+  // The store of offline_cache_remote_url. Outlives |cache_reader_|.
+  std::unique_ptr<offline_cache::CacheStorage> remote_cache_;
   std::unique_ptr<LlvmOfflineCacheFileReader> cache_reader_;
 };
 
@@ -2,6 +2,7 @@
 
 #include "taichi/analysis/offline_cache_util.h"
 #include "taichi/aot/graph_data.h"
+#include "taichi/program/ndarray.h"
 #include "taichi/rhi/metal/metal_device.h"
 #include "taichi/runtime/gfx/aot_module_builder_impl.h"
 #include "taichi/runtime/gfx/snode_tree_manager.h"
@@ -46,6 +47,8 @@ void MetalProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   gfx::GfxRuntime::Params params;
   params.host_result_buffer = *result_buffer_ptr;
   params.device = embedded_device_.get();
+  params.submission = gfx::SubmissionConfig::from_compile_config(*config);
+  params.profiler = profiler;
   gfx_runtime_ = std::make_unique<gfx::GfxRuntime>(std::move(params));
   snode_tree_mgr_ = std::make_unique<gfx::SNodeTreeManager>(gfx_runtime_.get());
 }
@@ -79,8 +82,14 @@ std::unique_ptr<AotModuleBuilder> MetalProgramImpl::make_aot_module_builder(
 DeviceAllocation MetalProgramImpl::allocate_memory_ndarray(
     std::size_t alloc_size,
     uint64 *result_buffer) {
+  // Ndarrays go to shared storage so that host access reads the memory
+  // directly instead of going through staging buffers. Without unified memory
+  // only small ones do, as kernels access shared storage through the bus.
+  bool host_access =
+      get_compute_device()->get_caps().get(DeviceCapability::unified_memory) ||
+      alloc_size <= Ndarray::kHostMappedMaxBytes;
   return get_compute_device()->allocate_memory(
-      {alloc_size, /*host_write=*/false, /*host_read=*/false,
+      {alloc_size, /*host_write=*/host_access, /*host_read=*/host_access,
        /*export_sharing=*/false});
 }
 
@@ -48,6 +48,24 @@ class MetalProgramImpl : public ProgramImpl {
     return gfx_runtime_->flush();
   }
 
+  StreamSemaphore fill_ndarray_async(const DeviceAllocation &alloc,
+                                     std::size_t size,
+                                     uint32_t data) override {
+    gfx_runtime_->buffer_fill(alloc.get_ptr(0), size * sizeof(uint32_t), data);
+    return gfx_runtime_->flush();
+  }
+
+  StreamSemaphore copy_ndarray_async(DevicePtr dst,
+                                     DevicePtr src,
+                                     std::size_t size) override {
+    gfx_runtime_->buffer_copy(dst, src, size);
+    return gfx_runtime_->flush();
+  }
+
+  void wait_semaphore(const StreamSemaphore &sema) override {
+    gfx_runtime_->wait_semaphore(sema);
+  }
+
   std::unique_ptr<AotModuleBuilder> make_aot_module_builder(
       const DeviceCapabilityConfig &caps) override;
 
@@ -86,6 +104,10 @@ class MetalProgramImpl : public ProgramImpl {
     return snode_tree_mgr_->get_snode_tree_device_ptr(tree_id);
   }
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) override {
+    return snode_tree_mgr_->get_snode_tree_buffer_size(tree_id);
+  }
+
   void enqueue_compute_op_lambda(
       std::function<void(Device *device, CommandList *cmdlist)> op,
       const std::vector<ComputeOpImageRef> &image_refs) override;
@@ -4,6 +4,7 @@
 #include "taichi/rhi/opengl/opengl_api.h"
 #include "taichi/runtime/gfx/aot_module_builder_impl.h"
 #include "taichi/runtime/gfx/aot_module_loader_impl.h"
+#include "taichi/util/offline_cache.h"
 
 namespace taichi::lang {
 
@@ -42,6 +43,13 @@ void OpenglProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   gfx::GfxRuntime::Params params;
   params.host_result_buffer = *result_buffer_ptr;
   params.device = device_.get();
+  params.submission = gfx::SubmissionConfig::from_compile_config(*config);
+  params.profiler = profiler;
+  if (config->offline_cache) {
+    // Next to the kernels, so that later runs also skip linking them.
+    params.pipeline_cache_dir = offline_cache::get_cache_path_by_arch(
+        config->offline_cache_file_path, config->arch);
+  }
   runtime_ = std::make_unique<gfx::GfxRuntime>(std::move(params));
   snode_tree_mgr_ = std::make_unique<gfx::SNodeTreeManager>(runtime_.get());
 }
@@ -84,6 +92,12 @@ DeviceAllocation OpenglProgramImpl::allocate_texture(
   return runtime_->create_image(params);
 }
 
+void OpenglProgramImpl::enqueue_compute_op_lambda(
+    std::function<void(Device *device, CommandList *cmdlist)> op,
+    const std::vector<ComputeOpImageRef> &image_refs) {
+  runtime_->enqueue_compute_op_lambda(op, image_refs);
+}
+
 void OpenglProgramImpl::dump_cache_data_to_disk() {
   const auto &mgr = get_cache_manager();
   mgr->clean_offline_cache(offline_cache::string_to_clean_cache_policy(
@@ -38,6 +38,24 @@ class OpenglProgramImpl : public ProgramImpl {
     return runtime_->flush();
   }
 
+  StreamSemaphore fill_ndarray_async(const DeviceAllocation &alloc,
+                                     std::size_t size,
+                                     uint32_t data) override {
+    runtime_->buffer_fill(alloc.get_ptr(0), size * sizeof(uint32_t), data);
+    return runtime_->flush();
+  }
+
+  StreamSemaphore copy_ndarray_async(DevicePtr dst,
+                                     DevicePtr src,
+                                     std::size_t size) override {
+    runtime_->buffer_copy(dst, src, size);
+    return runtime_->flush();
+  }
+
+  void wait_semaphore(const StreamSemaphore &sema) override {
+    runtime_->wait_semaphore(sema);
+  }
+
   std::unique_ptr<AotModuleBuilder> make_aot_module_builder(
       const DeviceCapabilityConfig &caps) override;
 
@@ -55,6 +73,10 @@ class OpenglProgramImpl : public ProgramImpl {
 
   DeviceAllocation allocate_texture(const ImageParams &params) override;
 
+  void enqueue_compute_op_lambda(
+      std::function<void(Device *device, CommandList *cmdlist)> op,
+      const std::vector<ComputeOpImageRef> &image_refs) override;
+
   Device *get_compute_device() override {
     return device_.get();
   }
@@ -71,6 +93,10 @@ class OpenglProgramImpl : public ProgramImpl {
     return snode_tree_mgr_->get_snode_tree_device_ptr(tree_id);
   }
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) override {
+    return snode_tree_mgr_->get_snode_tree_buffer_size(tree_id);
+  }
+
   void dump_cache_data_to_disk() override;
 
   const std::unique_ptr<gfx::CacheManager> &get_cache_manager();
@@ -52,10 +52,13 @@ std::vector<std::string> get_required_device_extensions() {
 #if TI_WITH_CUDA
         // so that we can do cuda-vk interop
         VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
 #ifdef _WIN64
         VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_WIN32_EXTENSION_NAME,
 #else
         VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME,
 #endif
 #endif  // TI_WITH_CUDA
   };
@@ -161,6 +164,12 @@ void VulkanProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   gfx::GfxRuntime::Params params;
   params.host_result_buffer = *result_buffer_ptr;
   params.device = embedded_device_->device();
+  params.submission = gfx::SubmissionConfig::from_compile_config(*config);
+  params.profiler = profiler;
+  if (config->offline_cache) {
+    params.pipeline_cache_dir = offline_cache::get_cache_path_by_arch(
+        config->offline_cache_file_path, Arch::vulkan);
+  }
   vulkan_runtime_ = std::make_unique<gfx::GfxRuntime>(std::move(params));
   snode_tree_mgr_ =
       std::make_unique<gfx::SNodeTreeManager>(vulkan_runtime_.get());
@@ -195,8 +204,11 @@ std::unique_ptr<AotModuleBuilder> VulkanProgramImpl::make_aot_module_builder(
 DeviceAllocation VulkanProgramImpl::allocate_memory_ndarray(
     std::size_t alloc_size,
     uint64 *result_buffer) {
+  // On unified memory, ndarrays are mapped for host access without staging.
+  bool host_access =
+      get_compute_device()->get_caps().get(DeviceCapability::unified_memory);
   return get_compute_device()->allocate_memory(
-      {alloc_size, /*host_write=*/false, /*host_read=*/false,
+      {alloc_size, /*host_write=*/host_access, /*host_read=*/host_access,
        /*export_sharing=*/false});
 }
 
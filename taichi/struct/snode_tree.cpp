@@ -1,5 +1,7 @@
 #include "taichi/struct/snode_tree.h"
 
+#include "taichi/analysis/offline_cache_util.h"
+
 namespace taichi::lang {
 namespace {
 
@@ -19,6 +21,14 @@ SNodeTree::SNodeTree(int id, std::unique_ptr<SNode> root)
   check_tree_validity(*root_);
 }
 
+const std::string &SNodeTree::get_offline_cache_key() {
+  std::lock_guard<std::mutex> _(offline_cache_key_mut_);
+  if (offline_cache_key_.empty()) {
+    offline_cache_key_ = get_hashed_offline_cache_key_of_snode(root_.get());
+  }
+  return offline_cache_key_;
+}
+
 void SNodeTree::check_tree_validity(SNode &node) {
   if (node.ch.empty()) {
     if (node.type != SNodeType::place && node.type != SNodeType::root) {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 
 #include "taichi/ir/snode.h"
@@ -36,9 +38,18 @@ class SNodeTree {
     return root_.get();
   }
 
+  /**
+   * Returns the offline cache key of the tree, which is part of the keys of
+   * the kernels accessing it. Computed once, since the tree doesn't change
+   * once it is materialized.
+   */
+  const std::string &get_offline_cache_key();
+
  private:
   int id_{0};
   std::unique_ptr<SNode> root_{nullptr};
+  std::mutex offline_cache_key_mut_;
+  std::string offline_cache_key_;
 
   void check_tree_validity(SNode &node);
 };
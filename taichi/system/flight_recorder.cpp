@@ -0,0 +1,239 @@
+#include "taichi/system/flight_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "taichi/common/core.h"
+#include "taichi/common/logging.h"
+
+namespace taichi {
+
+namespace {
+
+bool read_enabled_from_env() {
+  const char *value = std::getenv("TI_FLIGHT_RECORDER");
+  return value != nullptr && std::atoi(value) != 0;
+}
+
+}  // namespace
+
+std::atomic<bool> FlightRecorder::enabled_{read_enabled_from_env()};
+
+const char *trace_event_name(TraceEvent event) {
+  switch (event) {
+    case TraceEvent::compile:
+      return "compile";
+    case TraceEvent::launch:
+      return "launch";
+    case TraceEvent::synchronize:
+      return "synchronize";
+    case TraceEvent::memory_alloc:
+      return "memory_alloc";
+    case TraceEvent::memory_fill:
+      return "memory_fill";
+    case TraceEvent::memory_copy:
+      return "memory_copy";
+  }
+  return "unknown";
+}
+
+// Single producer: only the owning thread writes |records| and |head|.
+// Readers copy the last records before |head| and drop those the producer
+// may have overwritten in the meantime.
+struct FlightRecorder::ThreadBuffer {
+  ThreadBuffer(std::size_t size, uint32_t id)
+      : records(std::make_unique<TraceRecord[]>(size)),
+        mask(size - 1),
+        id(id) {
+  }
+
+  std::unique_ptr<TraceRecord[]> records;
+  std::size_t mask;
+  uint32_t id;
+  // The number of records ever written.
+  std::atomic<uint64_t> head{0};
+  // Records before |tail| were cleared.
+  std::atomic<uint64_t> tail{0};
+  // Cleared when the owning thread exits, so that a new thread can take over
+  // the buffer. The records of the exited thread stay until overwritten.
+  std::atomic<bool> in_use{true};
+  ThreadBuffer *next{nullptr};
+};
+
+FlightRecorder &FlightRecorder::get_instance() {
+  // Never destroyed, so that threads exiting after main() can still record.
+  static auto instance = new FlightRecorder();
+  return *instance;
+}
+
+FlightRecorder::FlightRecorder() {
+  std::size_t size = 8192;
+  if (const char *value = std::getenv("TI_FLIGHT_RECORDER_SIZE")) {
+    size = std::max(std::atoll(value), 2LL);
+  }
+  buffer_size_ = 2;
+  while (buffer_size_ < size) {
+    buffer_size_ <<= 1;
+  }
+  const char *filename = std::getenv("TI_FLIGHT_RECORDER_FILE");
+  crash_filename_ = filename ? filename : "taichi_flight_recorder.json";
+  names_.emplace_back();
+}
+
+uint64_t FlightRecorder::now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint32_t FlightRecorder::intern(const std::string &name) {
+  std::lock_guard<std::mutex> _(names_mut_);
+  auto [iter, inserted] = name_ids_.try_emplace(name, (uint32_t)names_.size());
+  if (inserted) {
+    names_.push_back(name);
+  }
+  return iter->second;
+}
+
+const std::string &FlightRecorder::get_name(uint32_t name_id) {
+  std::lock_guard<std::mutex> _(names_mut_);
+  TI_ASSERT(name_id < names_.size());
+  return names_[name_id];
+}
+
+FlightRecorder::ThreadBuffer *FlightRecorder::acquire_buffer() {
+  for (auto *buffer = buffers_.load(std::memory_order_acquire); buffer;
+       buffer = buffer->next) {
+    bool in_use = false;
+    if (buffer->in_use.compare_exchange_strong(in_use, true,
+                                               std::memory_order_acquire)) {
+      return buffer;
+    }
+  }
+  auto *buffer = new ThreadBuffer(
+      buffer_size_, num_buffers_.fetch_add(1, std::memory_order_relaxed));
+  buffer->next = buffers_.load(std::memory_order_relaxed);
+  while (!buffers_.compare_exchange_weak(buffer->next, buffer,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+  }
+  return buffer;
+}
+
+void FlightRecorder::record(const TraceRecord &record) {
+  struct Releaser {
+    std::atomic<bool> *in_use{nullptr};
+    ~Releaser() {
+      if (in_use) {
+        in_use->store(false, std::memory_order_release);
+      }
+    }
+  };
+  thread_local ThreadBuffer *buffer = nullptr;
+  thread_local Releaser releaser;
+  if (!buffer) {
+    buffer = acquire_buffer();
+    releaser.in_use = &buffer->in_use;
+  }
+  auto head = buffer->head.load(std::memory_order_relaxed);
+  buffer->records[head & buffer->mask] = record;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<std::vector<TraceRecord>> FlightRecorder::collect() {
+  std::vector<std::vector<TraceRecord>> result(
+      num_buffers_.load(std::memory_order_acquire));
+  for (auto *buffer = buffers_.load(std::memory_order_acquire); buffer;
+       buffer = buffer->next) {
+    const uint64_t capacity = buffer->mask + 1;
+    auto head = buffer->head.load(std::memory_order_acquire);
+    auto begin = std::max(head - std::min(head, capacity),
+                          buffer->tail.load(std::memory_order_relaxed));
+    std::vector<TraceRecord> records;
+    records.reserve(head - begin);
+    for (auto i = begin; i < head; i++) {
+      records.push_back(buffer->records[i & buffer->mask]);
+    }
+    // Drop the records the owner overwrote while they were copied.
+    auto new_head = buffer->head.load(std::memory_order_acquire);
+    if (new_head - begin > capacity) {
+      auto overwritten = std::min<uint64_t>(new_head - capacity - begin,
+                                            records.size());
+      records.erase(records.begin(), records.begin() + overwritten);
+    }
+    if (buffer->id < result.size()) {
+      result[buffer->id] = std::move(records);
+    }
+  }
+  return result;
+}
+
+void FlightRecorder::clear() {
+  for (auto *buffer = buffers_.load(std::memory_order_acquire); buffer;
+       buffer = buffer->next) {
+    buffer->tail.store(buffer->head.load(std::memory_order_acquire),
+                       std::memory_order_relaxed);
+  }
+}
+
+void FlightRecorder::write_trace(std::FILE *file, bool wait_for_names) {
+  std::unique_lock<std::mutex> names_lock(names_mut_, std::defer_lock);
+  if (wait_for_names) {
+    names_lock.lock();
+  } else {
+    names_lock.try_lock();
+  }
+  auto threads = collect();
+  std::fprintf(file, "[");
+  bool first = true;
+  for (std::size_t tid = 0; tid < threads.size(); tid++) {
+    for (const auto &r : threads[tid]) {
+      std::fprintf(file, "%s{\"cat\":\"%s\",\"pid\":0,\"tid\":%zu,",
+                   first ? "" : ",\n", trace_event_name(r.event), tid);
+      first = false;
+      if (r.name_id == 0) {
+        std::fprintf(file, "\"name\":\"%s\",", trace_event_name(r.event));
+      } else if (names_lock.owns_lock() && r.name_id < names_.size()) {
+        std::fprintf(file, "\"name\":\"%s\",", names_[r.name_id].c_str());
+      } else {
+        std::fprintf(file, "\"name\":\"#%u\",", r.name_id);
+      }
+      if (r.end_ns == r.begin_ns) {
+        std::fprintf(file, "\"ph\":\"i\",\"s\":\"t\",");
+      } else {
+        std::fprintf(file, "\"ph\":\"X\",\"dur\":%.3f,",
+                     (r.end_ns - r.begin_ns) / 1000.0);
+      }
+      std::fprintf(file, "\"ts\":%.3f,\"args\":{\"payload\":%llu}}",
+                   r.begin_ns / 1000.0, (unsigned long long)r.payload);
+    }
+  }
+  std::fprintf(file, "]\n");
+}
+
+void FlightRecorder::dump(const std::string &filename) {
+  if (!ends_with(filename, ".json")) {
+    TI_WARN("Flight recorder filename {} should end with '.json'.", filename);
+  }
+  std::FILE *file = std::fopen(filename.c_str(), "w");
+  TI_ERROR_IF(file == nullptr, "Cannot open {} to dump the flight recorder",
+              filename);
+  write_trace(file, /*wait_for_names=*/true);
+  std::fclose(file);
+}
+
+void FlightRecorder::dump_on_crash() {
+  std::FILE *file = std::fopen(crash_filename_.c_str(), "w");
+  if (file == nullptr) {
+    std::fprintf(stderr, "Cannot open %s to dump the flight recorder\n",
+                 crash_filename_.c_str());
+    return;
+  }
+  write_trace(file, /*wait_for_names=*/false);
+  std::fclose(file);
+  std::fprintf(stderr, "Flight recorder dumped to %s\n",
+               crash_filename_.c_str());
+}
+
+}  // namespace taichi
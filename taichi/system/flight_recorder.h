@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace taichi {
+
+enum class TraceEvent : uint8_t {
+  compile,
+  launch,
+  synchronize,
+  memory_alloc,
+  memory_fill,
+  memory_copy,
+};
+
+const char *trace_event_name(TraceEvent event);
+
+// A fixed-size record of one operation. |name_id| refers to a name interned
+// by FlightRecorder::intern(), 0 if the operation has none. |payload| is the
+// number of kernels for compile, the bytes of the array arguments for launch
+// and the bytes touched for the memory operations.
+struct TraceRecord {
+  uint64_t begin_ns{0};
+  uint64_t end_ns{0};
+  uint64_t payload{0};
+  uint32_t name_id{0};
+  TraceEvent event{TraceEvent::launch};
+};
+
+// An always-on tracer for production runs, enabled by TI_FLIGHT_RECORDER=1.
+//
+// Unlike Timeline, recording an operation never takes a lock or allocates:
+// each thread appends records to its own ring buffer of
+// TI_FLIGHT_RECORDER_SIZE records (8192 by default), with the oldest records
+// overwritten. The records still in the buffers can be dumped at any time
+// as a Chrome trace, and are dumped to TI_FLIGHT_RECORDER_FILE
+// (taichi_flight_recorder.json by default) when the process receives a fatal
+// signal, see HackedSignalRegister.
+class FlightRecorder {
+ public:
+  static FlightRecorder &get_instance();
+
+  static bool enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  static uint64_t now_ns();
+
+  // Returns the id of |name|. Takes a lock, so callers cache the id of the
+  // names they record repeatedly.
+  uint32_t intern(const std::string &name);
+
+  // The number of records kept per thread.
+  std::size_t buffer_size() const {
+    return buffer_size_;
+  }
+
+  // Appends |record| to the ring buffer of the calling thread.
+  void record(const TraceRecord &record);
+
+  // The records of each thread that are still in its buffer, oldest first.
+  // Records written concurrently with the call may be skipped.
+  std::vector<std::vector<TraceRecord>> collect();
+
+  const std::string &get_name(uint32_t name_id);
+
+  // Writes the records of every thread as a Chrome trace.
+  void dump(const std::string &filename);
+
+  // Dumps to TI_FLIGHT_RECORDER_FILE without waiting on the name table, as
+  // the crashing thread may hold its lock.
+  void dump_on_crash();
+
+  // Forgets all records, e.g. before a test.
+  void clear();
+
+  // Records an operation from its construction to its destruction.
+  class Scope {
+   public:
+    explicit Scope(TraceEvent event, uint32_t name_id = 0, uint64_t payload = 0)
+        : active_(enabled()) {
+      if (active_) {
+        record_.event = event;
+        record_.name_id = name_id;
+        record_.payload = payload;
+        record_.begin_ns = now_ns();
+      }
+    }
+
+    ~Scope() {
+      if (active_) {
+        record_.end_ns = now_ns();
+        get_instance().record(record_);
+      }
+    }
+
+   private:
+    bool active_;
+    TraceRecord record_;
+  };
+
+ private:
+  struct ThreadBuffer;
+
+  FlightRecorder();
+
+  ThreadBuffer *acquire_buffer();
+
+  void write_trace(std::FILE *file, bool wait_for_names);
+
+  static std::atomic<bool> enabled_;
+
+  std::size_t buffer_size_;
+  std::string crash_filename_;
+  std::atomic<ThreadBuffer *> buffers_{nullptr};
+  std::atomic<uint32_t> num_buffers_{0};
+
+  std::mutex names_mut_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint32_t> name_ids_;
+};
+
+// Records an operation that has no duration.
+inline void flight_record(TraceEvent event,
+                          uint32_t name_id = 0,
+                          uint64_t payload = 0) {
+  if (FlightRecorder::enabled()) {
+    auto now = FlightRecorder::now_ns();
+    FlightRecorder::get_instance().record({now, now, payload, name_id, event});
+  }
+}
+
+}  // namespace taichi
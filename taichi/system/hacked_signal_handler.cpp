@@ -1,6 +1,7 @@
 #include <csignal>
 
 #include "taichi/common/logging.h"
+#include "taichi/system/flight_recorder.h"
 #include "taichi/system/hacked_signal_handler.h"
 #include "taichi/system/threading.h"
 #include "taichi/system/traceback.h"
@@ -34,6 +35,9 @@ void signal_handler(int signo) {
   // @archibate found that in fact there are such solution:
   // https://docs.python.org/3/library/faulthandler.html#module-faulthandler
   auto sig_name = signal_name(signo);
+  if (FlightRecorder::enabled()) {
+    FlightRecorder::get_instance().dump_on_crash();
+  }
   Logger::get_instance().error(
       fmt::format("Received signal {} ({})", signo, sig_name), false);
   exit(-1);
@@ -0,0 +1,113 @@
+/*******************************************************************************
+    Copyright (c) The Taichi Authors (2016- ). All Rights Reserved.
+    The use of this software is governed by the LICENSE file.
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace taichi {
+
+// A bounded multi-producer multi-consumer queue that never takes a lock.
+//
+// Each cell carries a sequence number which tells producers and consumers
+// whether the cell is ready for them, so that claiming a cell is a single CAS
+// on the enqueue/dequeue position (D. Vyukov's algorithm). try_push() fails
+// when the queue is full and try_pop() fails when it is empty; callers decide
+// how to back off.
+template <typename T>
+class LockFreeQueue {
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit LockFreeQueue(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_ = std::make_unique<Cell[]>(size);
+    for (std::size_t i = 0; i < size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LockFreeQueue(const LockFreeQueue &) = delete;
+  LockFreeQueue &operator=(const LockFreeQueue &) = delete;
+
+  bool try_push(T &&value) {
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The cell still holds an element from the previous lap.
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T &value) {
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->value = T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only a hint when other threads are using the queue concurrently.
+  bool empty() const {
+    return enqueue_pos_.load(std::memory_order_seq_cst) ==
+           dequeue_pos_.load(std::memory_order_seq_cst);
+  }
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  struct alignas(64) Cell {
+    std::atomic<std::size_t> sequence{0};
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_{0};
+  // Kept on separate cache lines so that producers and consumers do not
+  // contend on the same line.
+  alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+}  // namespace taichi
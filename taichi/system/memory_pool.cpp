@@ -1,5 +1,4 @@
 #include "memory_pool.h"
-#include "taichi/system/timer.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/rhi/cuda/cuda_device.h"
 
@@ -25,18 +24,28 @@ MemoryPool::MemoryPool(Arch arch, Device *device)
                                              CU_STREAM_NON_BLOCKING);
   }
 #endif
-  th = std::make_unique<std::thread>([this] { this->daemon(); });
 }
 
 void MemoryPool::set_queue(MemRequestQueue *queue) {
   std::lock_guard<std::mutex> _(mut);
   this->queue = queue;
+  // The daemon only runs once there are requests to serve.
+  if (!th) {
+    th = std::make_unique<std::thread>([this] { this->daemon(); });
+  }
 }
 
 void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
+  // Fast path: bump the current allocator without taking any lock.
+  if (auto current = current_allocator_.load(std::memory_order_acquire)) {
+    if (auto ret = current->allocate(size, alignment)) {
+      return ret;
+    }
+  }
   std::lock_guard<std::mutex> _(mut_allocators);
   void *ret = nullptr;
   if (!allocators.empty()) {
+    // Another thread may have added an allocator in the meantime.
     ret = allocators.back()->allocate(size, alignment);
   }
   if (!ret) {
@@ -45,6 +54,8 @@ void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
     allocators.emplace_back(
         std::make_unique<UnifiedAllocator>(new_buffer_size, arch_, device_));
     ret = allocators.back()->allocate(size, alignment);
+    current_allocator_.store(allocators.back().get(),
+                             std::memory_order_release);
   }
   TI_ASSERT(ret);
   return ret;
@@ -83,36 +94,47 @@ void MemoryPool::push(volatile T *dest, const T &val) {
   }
 }
 
+bool MemoryPool::process_requests() {
+  using tail_type = decltype(MemRequestQueue::tail);
+  auto tail = fetch<tail_type>(&queue->tail);
+  bool processed = false;
+  while (tail > processed_tail) {
+    // allocate new buffer
+    auto i = processed_tail;
+    TI_DEBUG("Processing memory alloc request {}", i);
+    auto req = fetch<MemRequest>(&queue->requests[i]);
+    if (req.size == 0 || req.alignment == 0) {
+      TI_DEBUG(" Incomplete memory alloc request {} fetched. Skipping", i);
+      // The device is still writing the request, so check again soon.
+      return true;
+    }
+    TI_DEBUG("  Allocating memory {} B (alignment {}B) ", req.size,
+             req.alignment);
+    auto ptr = allocate(req.size, req.alignment);
+    TI_DEBUG("  Allocated. Ptr = {:p}", ptr);
+    push(&queue->requests[i].ptr, (uint8 *)ptr);
+    processed_tail += 1;
+    processed = true;
+  }
+  return processed;
+}
+
 void MemoryPool::daemon() {
+  // The device cannot signal the host, so the queue is polled. The interval
+  // is reset after each request, since requests come in bursts when pools
+  // grow, and backs off while the queue stays idle.
+  auto interval = min_poll_interval;
+  std::unique_lock<std::mutex> lock(mut);
   while (true) {
-    Time::usleep(1000);
-    std::lock_guard<std::mutex> _(mut);
+    cv_.wait_for(lock, interval, [this] { return terminating; });
     if (terminating) {
       killed = true;
       break;
     }
-    if (!queue) {
-      continue;
-    }
-
-    // poll allocation requests.
-    using tail_type = decltype(MemRequestQueue::tail);
-    auto tail = fetch<tail_type>(&queue->tail);
-    if (tail > processed_tail) {
-      // allocate new buffer
-      auto i = processed_tail;
-      TI_DEBUG("Processing memory alloc request {}", i);
-      auto req = fetch<MemRequest>(&queue->requests[i]);
-      if (req.size == 0 || req.alignment == 0) {
-        TI_DEBUG(" Incomplete memory alloc request {} fetched. Skipping", i);
-        continue;
-      }
-      TI_DEBUG("  Allocating memory {} B (alignment {}B) ", req.size,
-               req.alignment);
-      auto ptr = allocate(req.size, req.alignment);
-      TI_DEBUG("  Allocated. Ptr = {:p}", ptr);
-      push(&queue->requests[i].ptr, (uint8 *)ptr);
-      processed_tail += 1;
+    if (queue && process_requests()) {
+      interval = min_poll_interval;
+    } else {
+      interval = std::min(interval * 2, max_poll_interval);
     }
   }
 }
@@ -121,7 +143,12 @@ void MemoryPool::terminate() {
   {
     std::lock_guard<std::mutex> _(mut);
     terminating = true;
+    if (!th) {
+      killed = true;
+      return;
+    }
   }
+  cv_.notify_all();
   th->join();
   TI_ASSERT(killed);
 #if 0 && defined(TI_WITH_CUDA)
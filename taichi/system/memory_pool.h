@@ -5,6 +5,9 @@
 #include "taichi/runtime/llvm/runtime_module/mem_request.h"
 #undef TI_RUNTIME_HOST
 #include "taichi/rhi/device.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 #include <memory>
@@ -50,6 +53,17 @@ class TI_DLL_EXPORT MemoryPool {
 
  private:
   static constexpr bool use_cuda_stream = false;
+  static constexpr std::chrono::microseconds min_poll_interval{10};
+  static constexpr std::chrono::microseconds max_poll_interval{1000};
+
+  // Serves the pending requests in |queue|. Returns whether the device may
+  // still be waiting for the host.
+  bool process_requests();
+
+  // Wakes up the daemon for termination.
+  std::condition_variable cv_;
+  // The last of |allocators|, which is read without |mut_allocators|.
+  std::atomic<UnifiedAllocator *> current_allocator_{nullptr};
   Arch arch_;
   Device *device_;
 };
@@ -7,9 +7,16 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <vector>
 
+#if defined(TI_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace taichi {
 
 bool test_threading() {
@@ -136,4 +143,248 @@ ThreadPool::~ThreadPool() {
     th.join();
 }
 
+namespace {
+
+// Roughly tens of microseconds, which covers the gap between the tasks of a
+// kernel with several short offloads.
+constexpr int kSpinIterations = 1 << 14;
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64)
+  __builtin_ia32_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+#if defined(TI_PLATFORM_LINUX)
+// Parses lists such as "0-3,8-11".
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    auto dash = item.find('-');
+    int lo = std::stoi(item.substr(0, dash));
+    int hi = dash == std::string::npos ? lo : std::stoi(item.substr(dash + 1));
+    for (int c = lo; c <= hi; c++) {
+      cpus.push_back(c);
+    }
+  }
+  return cpus;
+}
+
+// CPUs grouped by NUMA node, so that consecutive thread ids share a node.
+std::vector<int> cpus_ordered_by_numa_node() {
+  std::vector<int> cpus;
+  for (int node = 0;; node++) {
+    std::ifstream ifs(
+        fmt::format("/sys/devices/system/node/node{}/cpulist", node));
+    if (!ifs) {
+      break;
+    }
+    std::string list;
+    std::getline(ifs, list);
+    auto node_cpus = parse_cpu_list(list);
+    cpus.insert(cpus.end(), node_cpus.begin(), node_cpus.end());
+  }
+  if (cpus.empty()) {
+    for (int c = 0; c < (int)std::thread::hardware_concurrency(); c++) {
+      cpus.push_back(c);
+    }
+  }
+  return cpus;
+}
+#endif
+
+}  // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(int max_num_threads,
+                                               bool pin_threads)
+    : max_num_threads_(std::max(max_num_threads, 1)) {
+  ranges_ = std::make_unique<TaskRange[]>(max_num_threads_);
+  // Thread 0 is the thread calling run().
+  for (int i = 1; i < max_num_threads_; i++) {
+    threads_.emplace_back([this, i] { this->target(i); });
+  }
+  if (pin_threads) {
+#if defined(TI_PLATFORM_LINUX)
+    auto cpus = cpus_ordered_by_numa_node();
+    for (int i = 1; i < max_num_threads_; i++) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpus[i % cpus.size()], &cpu_set);
+      pthread_setaffinity_np(threads_[i - 1].native_handle(), sizeof(cpu_set),
+                             &cpu_set);
+    }
+#else
+    TI_WARN("Thread pinning is only supported on Linux.");
+#endif
+  }
+}
+
+void WorkStealingThreadPool::run(int splits,
+                                 int desired_num_threads,
+                                 void *range_for_task_context,
+                                 RangeForTaskFunc *func) {
+  if (splits <= 0) {
+    return;
+  }
+  // Enter the preparation phase, and wait until no worker is looking at the
+  // state of the previous run.
+  epoch_.fetch_add(1);
+  while (active_workers_.load() != 0) {
+    cpu_relax();
+  }
+
+  num_threads_ =
+      std::min({std::max(desired_num_threads, 1), max_num_threads_, splits});
+  splits_ = splits;
+  func_ = func;
+  range_for_task_context_ = range_for_task_context;
+  completed_tasks_.store(0);
+  for (int i = 0; i < max_num_threads_; i++) {
+    uint32 begin = 0, end = 0;
+    if (i < num_threads_) {
+      begin = uint32(int64(splits) * i / num_threads_);
+      end = uint32(int64(splits) * (i + 1) / num_threads_);
+    }
+    ranges_[i].range.store(pack(begin, end), std::memory_order_relaxed);
+  }
+
+  // Publish.
+  epoch_.fetch_add(1);
+  if (num_parked_.load() > 0) {
+    { std::lock_guard<std::mutex> _(mutex_); }
+    worker_cv_.notify_all();
+  }
+
+  work(0, func, range_for_task_context);
+
+  for (int i = 0; completed_tasks_.load() < splits; i++) {
+    if (i < kSpinIterations) {
+      cpu_relax();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    master_parked_.store(true);
+    master_cv_.wait(lock, [&] { return completed_tasks_.load() >= splits; });
+    master_parked_.store(false);
+    break;
+  }
+}
+
+bool WorkStealingThreadPool::pop(int thread_id, int &task_id) {
+  auto &range = ranges_[thread_id].range;
+  uint64 cur = range.load(std::memory_order_relaxed);
+  while (true) {
+    uint32 begin = uint32(cur >> 32), end = uint32(cur);
+    if (begin >= end) {
+      return false;
+    }
+    if (range.compare_exchange_weak(cur, pack(begin + 1, end))) {
+      task_id = int(begin);
+      return true;
+    }
+  }
+}
+
+bool WorkStealingThreadPool::steal(int thread_id) {
+  // Victims are visited starting from the closest thread id, which with
+  // pinning enabled is most likely on the same NUMA node.
+  for (int k = 1; k < num_threads_; k++) {
+    auto &victim = ranges_[(thread_id + k) % num_threads_].range;
+    uint64 cur = victim.load(std::memory_order_relaxed);
+    while (true) {
+      uint32 begin = uint32(cur >> 32), end = uint32(cur);
+      if (begin >= end) {
+        break;
+      }
+      uint32 take = (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(cur, pack(begin, end - take))) {
+        // Our own range is empty and nobody steals from an empty range, so a
+        // plain store suffices.
+        ranges_[thread_id].range.store(pack(end - take, end));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void WorkStealingThreadPool::work(int thread_id,
+                                  RangeForTaskFunc *func,
+                                  void *context) {
+  int executed = 0;
+  int task_id;
+  do {
+    while (pop(thread_id, task_id)) {
+      func(context, thread_id, task_id);
+      executed++;
+    }
+  } while (steal(thread_id));
+  if (executed == 0) {
+    return;
+  }
+  if (completed_tasks_.fetch_add(executed) + executed == splits_ &&
+      master_parked_.load()) {
+    { std::lock_guard<std::mutex> _(mutex_); }
+    master_cv_.notify_one();
+  }
+}
+
+void WorkStealingThreadPool::target(int thread_id) {
+  uint64 last_epoch = 0;
+  while (true) {
+    uint64 epoch = 0;
+    int spins = 0;
+    while (true) {
+      if (exiting_.load()) {
+        return;
+      }
+      epoch = epoch_.load();
+      if (epoch % 2 == 0 && epoch != last_epoch) {
+        active_workers_.fetch_add(1);
+        // The master may have started preparing the next run in between.
+        if (epoch_.load() == epoch) {
+          break;
+        }
+        active_workers_.fetch_sub(1);
+        continue;
+      }
+      if (++spins < kSpinIterations) {
+        cpu_relax();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      num_parked_.fetch_add(1);
+      worker_cv_.wait(lock, [&] {
+        auto e = epoch_.load();
+        return exiting_.load() || (e % 2 == 0 && e != last_epoch);
+      });
+      num_parked_.fetch_sub(1);
+      spins = 0;
+    }
+    last_epoch = epoch;
+    if (thread_id < num_threads_) {
+      work(thread_id, func_, range_for_task_context_);
+    }
+    active_workers_.fetch_sub(1);
+  }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::lock_guard<std::mutex> _(mutex_);
+    exiting_.store(true);
+  }
+  worker_cv_.notify_all();
+  for (auto &th : threads_) {
+    th.join();
+  }
+}
+
 }  // namespace taichi
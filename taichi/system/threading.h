@@ -59,4 +59,74 @@ class ThreadPool {
   ~ThreadPool();
 };
 
+// A drop-in alternative to ThreadPool with the same ParallelFor entry point.
+//
+// Instead of handing out tasks through one shared counter, each run() splits
+// the task range evenly across the participating threads. Every thread owns a
+// range that it consumes from the front; once it runs dry it steals half of
+// the remaining range of another thread from the back. The calling thread
+// takes part as thread 0. Idle workers spin for a short while before parking
+// on a condition variable, so back-to-back short kernels do not pay for a
+// wake-up.
+//
+// Optionally, threads are pinned to CPUs ordered by NUMA node, so that
+// neighbouring thread ids (which start with neighbouring task ranges and are
+// stolen from first) share a node.
+class WorkStealingThreadPool {
+ public:
+  WorkStealingThreadPool(int max_num_threads, bool pin_threads);
+
+  void run(int splits,
+           int desired_num_threads,
+           void *range_for_task_context,
+           RangeForTaskFunc *func);
+
+  static void static_run(WorkStealingThreadPool *pool,
+                         int splits,
+                         int desired_num_threads,
+                         void *range_for_task_context,
+                         RangeForTaskFunc *func) {
+    return pool->run(splits, desired_num_threads, range_for_task_context, func);
+  }
+
+  ~WorkStealingThreadPool();
+
+ private:
+  // [begin, end) packed into one word so that the owner and thieves can
+  // update it with a single CAS.
+  struct alignas(64) TaskRange {
+    std::atomic<uint64> range{0};
+  };
+
+  static uint64 pack(uint32 begin, uint32 end) {
+    return (uint64(begin) << 32) | end;
+  }
+
+  void target(int thread_id);
+  void work(int thread_id, RangeForTaskFunc *func, void *context);
+  bool pop(int thread_id, int &task_id);
+  bool steal(int thread_id);
+
+  int max_num_threads_;
+  std::vector<std::thread> threads_;
+  std::unique_ptr<TaskRange[]> ranges_;
+
+  // Odd while the master is preparing a run, even once it is published.
+  std::atomic<uint64> epoch_{0};
+  std::atomic<int> active_workers_{0};
+  std::atomic<int> completed_tasks_{0};
+  std::atomic<int> num_parked_{0};
+  std::atomic<bool> exiting_{false};
+  std::atomic<bool> master_parked_{false};
+
+  int splits_{0};
+  int num_threads_{0};
+  RangeForTaskFunc *func_{nullptr};
+  void *range_for_task_context_{nullptr};
+
+  std::mutex mutex_;
+  std::condition_variable worker_cv_;
+  std::condition_variable master_cv_;
+};
+
 }  // namespace taichi
@@ -41,7 +41,7 @@ UnifiedAllocator::UnifiedAllocator(std::size_t size, Arch arch, Device *device)
   TI_ASSERT(uint64(data) % 4096 == 0);
 
   head = data;
-  tail = head + size;
+  tail = data + size;
   TI_TRACE("Memory allocated. Allocation time = {:.3} s", Time::get_time() - t);
 }
 
@@ -1,5 +1,5 @@
 #pragma once
-#include <mutex>
+#include <atomic>
 #include <vector>
 #include <memory>
 
@@ -22,30 +22,31 @@ class UnifiedAllocator {
  public:
   uint8 *data;
   DeviceAllocation alloc{kDeviceNullAllocation};
-  uint8 *head;
+  std::atomic<uint8 *> head;
   uint8 *tail;
-  std::mutex lock;
 
  public:
   UnifiedAllocator(std::size_t size, Arch arch, Device *device);
 
   ~UnifiedAllocator();
 
+  // Lock-free. Returns nullptr if the allocator is exhausted, in which case
+  // |head| is left untouched.
   void *allocate(std::size_t size, std::size_t alignment) {
-    std::lock_guard<std::mutex> _(lock);
-    auto ret =
-        head + alignment - 1 - ((std::size_t)head + alignment - 1) % alignment;
-    TI_TRACE("UM [data={}] allocate() request={} remain={}", (intptr_t)data,
-             size, (tail - head));
-    head = ret + size;
-    if (head > tail) {
-      // allocation failed
-      return nullptr;
-    } else {
-      // success
-      TI_ASSERT((std::size_t)ret % alignment == 0);
-      return ret;
-    }
+    auto old_head = head.load(std::memory_order_relaxed);
+    uint8 *ret;
+    do {
+      ret = old_head + alignment - 1 -
+            ((std::size_t)old_head + alignment - 1) % alignment;
+      if (ret + size > tail) {
+        TI_TRACE("UM [data={}] allocate() request={} remain={} failed",
+                 (intptr_t)data, size, (tail - old_head));
+        return nullptr;
+      }
+    } while (!head.compare_exchange_weak(old_head, ret + size,
+                                         std::memory_order_relaxed));
+    TI_ASSERT((std::size_t)ret % alignment == 0);
+    return ret;
   }
 
   void memset(unsigned char val);
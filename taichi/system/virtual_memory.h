@@ -2,8 +2,11 @@
 
 #include "taichi/common/core.h"
 
+#include <cstring>
+
 #if defined(TI_PLATFORM_UNIX)
 #include <sys/mman.h>
+#include <unistd.h>
 #else
 #include "taichi/platform/windows/windows.h"
 #endif
@@ -19,8 +22,10 @@ class VirtualMemoryAllocator {
   explicit VirtualMemoryAllocator(size_t size) : size(size) {
 // http://pages.cs.wisc.edu/~sifakis/papers/SPGrid.pdf Sec 3.1
 #if defined(TI_PLATFORM_UNIX)
+    // Only the pages touched are backed by physical memory, so reserving far
+    // more than is used is cheap.
     ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
-               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
     TI_ERROR_IF(ptr == MAP_FAILED, "Virtual memory allocation ({} B) failed.",
                 size);
 #else
@@ -41,6 +46,54 @@ class VirtualMemoryAllocator {
                 page_size);
   }
 
+  // Zero-fills [ptr, ptr + size) of a region reserved by this class. The
+  // whole pages in the range are given back to the OS, and read as zeros when
+  // touched again.
+  static void release_pages(void *ptr, size_t size) {
+    auto begin = (uint8_t *)ptr;
+    auto end = begin + size;
+    auto page = get_os_page_size();
+    auto first_page = (uint8_t *)(((uint64_t)begin + page - 1) / page * page);
+    auto last_page = (uint8_t *)((uint64_t)end / page * page);
+    if (first_page >= last_page) {
+      std::memset(begin, 0, size);
+      return;
+    }
+    std::memset(begin, 0, first_page - begin);
+    std::memset(last_page, 0, end - last_page);
+    auto length = last_page - first_page;
+#if defined(__linux__)
+    // Private anonymous pages read as zeros after MADV_DONTNEED.
+    bool released = madvise(first_page, length, MADV_DONTNEED) == 0;
+#elif defined(TI_PLATFORM_UNIX)
+    // MADV_DONTNEED keeps the contents on macOS. Mapping fresh pages over the
+    // range does not.
+    bool released = mmap(first_page, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1,
+                         0) != MAP_FAILED;
+#else
+    bool released =
+        VirtualFree(first_page, length, MEM_DECOMMIT) &&
+        VirtualAlloc(first_page, length, MEM_COMMIT, PAGE_READWRITE);
+#endif
+    if (!released) {
+      std::memset(first_page, 0, length);
+    }
+  }
+
+  static size_t get_os_page_size() {
+#if defined(TI_PLATFORM_UNIX)
+    static const size_t os_page_size = sysconf(_SC_PAGESIZE);
+#else
+    static const size_t os_page_size = [] {
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return (size_t)info.dwPageSize;
+    }();
+#endif
+    return os_page_size;
+  }
+
   ~VirtualMemoryAllocator() {
 #if defined(TI_PLATFORM_UNIX)
     if (munmap(ptr, size) != 0)
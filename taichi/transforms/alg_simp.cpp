@@ -437,6 +437,24 @@ class AlgSimp : public BasicStmtVisitor {
   }
 };
 
+namespace {
+
+class AlgSimpRewriter : public StmtRewriter {
+ public:
+  explicit AlgSimpRewriter(bool fast_math) : simplifier_(fast_math) {
+  }
+
+  bool rewrite(Stmt *stmt) override {
+    stmt->accept(&simplifier_);
+    return simplifier_.modifier.modify_ir();
+  }
+
+ private:
+  AlgSimp simplifier_;
+};
+
+}  // namespace
+
 namespace irpass {
 
 bool alg_simp(IRNode *root, const CompileConfig &config) {
@@ -444,6 +462,11 @@ bool alg_simp(IRNode *root, const CompileConfig &config) {
   return AlgSimp::run(root, config.fast_math);
 }
 
+std::unique_ptr<StmtRewriter> make_alg_simp_rewriter(
+    const CompileConfig &config) {
+  return std::make_unique<AlgSimpRewriter>(config.fast_math);
+}
+
 }  // namespace irpass
 
 }  // namespace taichi::lang
@@ -7,6 +7,9 @@
 
 #include <typeinfo>
 #include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace taichi::lang {
 
@@ -529,6 +532,163 @@ class ReverseOuterLoops : public BasicStmtVisitor {
   }
 };
 
+// The trip count of a range-for with constant bounds, or -1.
+static int64 constant_trip_count(RangeForStmt *stmt) {
+  auto begin = stmt->begin->cast<ConstStmt>();
+  auto end = stmt->end->cast<ConstStmt>();
+  if (!begin || !end || !begin->ret_type->is_primitive(PrimitiveTypeID::i32) ||
+      !end->ret_type->is_primitive(PrimitiveTypeID::i32)) {
+    return -1;
+  }
+  return std::max(end->val.val_as_int64() - begin->val.val_as_int64(),
+                  (int64)0);
+}
+
+// Collects the locals written by the body of an inner loop of an IB, for
+// checkpointing the loop in MakeAdjoint. Rejects the bodies that cannot be
+// run again in the backward pass, and those whose number of writes per
+// iteration is unknown.
+class CheckpointedLoopAnalyzer : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  struct Local {
+    // An AllocaStmt or an AdStackAllocaStmt.
+    Stmt *alloca;
+    DataType dt;
+    // An upper bound of the writes per iteration.
+    int64 num_writes{0};
+    // Whether the value from the previous iteration may be read.
+    bool carried{false};
+  };
+
+  bool eligible{true};
+  std::vector<Local> locals;
+
+  CheckpointedLoopAnalyzer() {
+    allow_undefined_visitor = true;
+  }
+
+  void visit(LocalLoadStmt *stmt) override {
+    if (!stmt->src->is<AllocaStmt>()) {
+      eligible = false;
+      return;
+    }
+    read(stmt->src);
+  }
+
+  void visit(LocalStoreStmt *stmt) override {
+    if (!stmt->dest->is<AllocaStmt>() ||
+        stmt->dest->ret_type.ptr_removed()->is<TensorType>()) {
+      eligible = false;
+      return;
+    }
+    write(stmt->dest, stmt->dest->ret_type.ptr_removed());
+  }
+
+  void visit(AdStackLoadTopStmt *stmt) override {
+    read(stmt->stack);
+  }
+
+  void visit(AdStackPushStmt *stmt) override {
+    write(stmt->stack, stmt->stack->as<AdStackAllocaStmt>()->dt);
+  }
+
+  void visit(AtomicOpStmt *stmt) override {
+    // The atomics without adjoints would be applied again by the
+    // recomputation.
+    auto dest = stmt->dest;
+    if (auto ptr = dest->cast<MatrixPtrStmt>()) {
+      dest = ptr->origin;
+    }
+    if (!dest->is<GlobalPtrStmt>() ||
+        !dest->as<GlobalPtrStmt>()->snode->has_adjoint()) {
+      eligible = false;
+    }
+  }
+
+  void visit(MatrixPtrStmt *stmt) override {
+    if (stmt->origin->is<AllocaStmt>()) {
+      eligible = false;
+    }
+  }
+
+  void visit(PrintStmt *stmt) override {
+    eligible = false;
+  }
+
+  void visit(RandStmt *stmt) override {
+    eligible = false;
+  }
+
+  void visit(ExternalPtrStmt *stmt) override {
+    eligible = false;
+  }
+
+  void visit(IfStmt *stmt) override {
+    depth_++;
+    BasicStmtVisitor::visit(stmt);
+    depth_--;
+  }
+
+  void visit(RangeForStmt *stmt) override {
+    auto trip_count = constant_trip_count(stmt);
+    if (trip_count < 0) {
+      eligible = false;
+      return;
+    }
+    auto old_multiplier = multiplier_;
+    multiplier_ *= trip_count;
+    depth_++;
+    stmt->body->accept(this);
+    depth_--;
+    multiplier_ = old_multiplier;
+  }
+
+  void visit(StructForStmt *stmt) override {
+    eligible = false;
+  }
+
+  void visit(WhileStmt *stmt) override {
+    eligible = false;
+  }
+
+  static CheckpointedLoopAnalyzer run(RangeForStmt *stmt) {
+    CheckpointedLoopAnalyzer analyzer;
+    stmt->body->accept(&analyzer);
+    for (auto &local : analyzer.locals) {
+      local.carried = analyzer.read_first_.count(local.alloca) > 0;
+    }
+    return analyzer;
+  }
+
+ private:
+  void read(Stmt *alloca) {
+    if (accessed_.insert(alloca).second) {
+      read_first_.insert(alloca);
+    }
+  }
+
+  void write(Stmt *alloca, DataType dt) {
+    if (accessed_.insert(alloca).second && depth_ > 0) {
+      // The write may be skipped, leaving the previous value.
+      read_first_.insert(alloca);
+    }
+    auto it = local_ids_.find(alloca);
+    if (it == local_ids_.end()) {
+      it = local_ids_.insert({alloca, (int)locals.size()}).first;
+      locals.push_back({alloca, dt});
+    }
+    locals[it->second].num_writes += multiplier_;
+  }
+
+  int depth_{0};
+  int64 multiplier_{1};
+  std::unordered_set<Stmt *> accessed_;
+  std::unordered_set<Stmt *> read_first_;
+  std::unordered_map<Stmt *, int> local_ids_;
+};
+
 // Base class for both reverse (make adjoint) and forward (make dual) mode
 class ADTransform : public IRVisitor {
  protected:
@@ -707,15 +867,20 @@ class MakeAdjoint : public ADTransform {
   // Should be restored after processing every statement in the two cases above
   Block *forward_backup;
   std::map<Stmt *, Stmt *> adjoint_stmt;
+  Block *independent_block;
+  // See CompileConfig::ad_stack_memory_budget.
+  int64 ad_stack_memory_budget;
 
-  explicit MakeAdjoint(Block *block) {
+  explicit MakeAdjoint(Block *block, int64 ad_stack_memory_budget) {
     current_block = nullptr;
     alloca_block = block;
     forward_backup = block;
+    independent_block = block;
+    this->ad_stack_memory_budget = ad_stack_memory_budget;
   }
 
-  static void run(Block *block) {
-    auto p = MakeAdjoint(block);
+  static void run(Block *block, int64 ad_stack_memory_budget = 0) {
+    auto p = MakeAdjoint(block, ad_stack_memory_budget);
     block->accept(&p);
   }
 
@@ -955,6 +1120,10 @@ class MakeAdjoint : public ADTransform {
   }
 
   void visit(RangeForStmt *for_stmt) override {
+    if (ad_stack_memory_budget > 0 && for_stmt->parent == independent_block &&
+        checkpoint(for_stmt)) {
+      return;
+    }
     auto new_for = for_stmt->clone();
     auto new_for_ptr = new_for->as<RangeForStmt>();
     new_for_ptr->reversed = !new_for_ptr->reversed;
@@ -993,6 +1162,316 @@ class MakeAdjoint : public ADTransform {
     for_stmt->body->accept(this);
   }
 
+  // Checkpoints an inner loop whose AD-stacks would exceed the budget.
+  // Processing the loop in segments of |k| iterations, the forward pass runs
+  // the body on plain locals, only pushing the locals written by the loop
+  // onto checkpoint stacks at the beginning of each segment. The backward
+  // pass recomputes every segment from its checkpoint onto AD-stacks of |k|
+  // iterations, and runs the adjoint of the recomputation:
+  //
+  //   for c in range(n):                 for c in reversed(range(n)):
+  //     checkpoint.push(x)                 stack.push(checkpoint.top())
+  //     for i in segment(c):               for i in segment(c):
+  //       x = f(x)                           stack.push(f(stack.top()))
+  //                                        <adjoint of the loop above>
+  //                                        checkpoint.pop()
+  //
+  // The adjoints of the locals at the beginning of a segment seed those at
+  // the end of the previous one.
+  bool checkpoint(RangeForStmt *for_stmt) {
+    if (for_stmt->reversed) {
+      return false;
+    }
+    const int64 trip_count = constant_trip_count(for_stmt);
+    if (trip_count <= 1) {
+      return false;
+    }
+    auto analyzer = CheckpointedLoopAnalyzer::run(for_stmt);
+    if (!analyzer.eligible || analyzer.locals.empty()) {
+      return false;
+    }
+    // Bytes per thread of the stacks: storing every iteration, and then per
+    // iteration recomputed and per checkpoint.
+    int64 full_bytes = 0, iteration_bytes = 0, checkpoint_bytes = 0;
+    for (auto &local : analyzer.locals) {
+      const int64 entry_bytes = data_type_size(local.dt) * 2;
+      if (local.alloca->is<AdStackAllocaStmt>()) {
+        full_bytes += trip_count * local.num_writes * entry_bytes;
+      }
+      iteration_bytes += local.num_writes * entry_bytes;
+      if (local.carried) {
+        checkpoint_bytes += entry_bytes;
+      }
+    }
+    if (full_bytes <= ad_stack_memory_budget || iteration_bytes == 0) {
+      return false;
+    }
+    auto bytes = [&](int64 k) {
+      return (trip_count + k - 1) / k * checkpoint_bytes + k * iteration_bytes;
+    };
+    int64 k = std::clamp(
+        (int64)std::sqrt((double)trip_count * checkpoint_bytes /
+                         iteration_bytes),
+        (int64)1, trip_count);
+    if (k < trip_count && bytes(k + 1) < bytes(k)) {
+      k++;
+    }
+    if (bytes(k) >= full_bytes) {
+      return false;
+    }
+    if (bytes(k) > ad_stack_memory_budget) {
+      TI_WARN(
+          "The AD-stacks of a loop take {} B per thread even with "
+          "checkpointing, more than the budget of {} B.",
+          bytes(k), ad_stack_memory_budget);
+    }
+    const int64 num_segments = (trip_count + k - 1) / k;
+    const int num_locals = analyzer.locals.size();
+
+    auto recomputed = irpass::analysis::clone(for_stmt);
+    auto recomputed_ptr = recomputed->as<RangeForStmt>();
+
+    auto append = [](Block *block, std::unique_ptr<Stmt> &&stmt) {
+      return block->insert(std::move(stmt), -1);
+    };
+    // Emits the bounds of segment |c| of the loop to |block|.
+    auto segment_bounds = [&](Block *block, Stmt *loop) {
+      auto c = append(block, Stmt::make<LoopIndexStmt>(loop, 0));
+      auto k_stmt =
+          append(block, Stmt::make<ConstStmt>(TypedConstant((int32)k)));
+      auto offset = append(
+          block, Stmt::make<BinaryOpStmt>(BinaryOpType::mul, c, k_stmt));
+      auto begin =
+          append(block, Stmt::make<BinaryOpStmt>(BinaryOpType::add,
+                                                 for_stmt->begin, offset));
+      auto end = append(block, Stmt::make<BinaryOpStmt>(BinaryOpType::add,
+                                                        begin, k_stmt));
+      end = append(block, Stmt::make<BinaryOpStmt>(BinaryOpType::min, end,
+                                                   for_stmt->end));
+      return std::make_pair(begin, end);
+    };
+    auto make_loop = [&](Stmt *begin, Stmt *end) {
+      auto loop = Stmt::make_typed<RangeForStmt>(
+          begin, end, std::make_unique<Block>(), for_stmt->is_bit_vectorized,
+          for_stmt->num_cpu_threads, for_stmt->block_dim,
+          for_stmt->strictly_serialized);
+      return loop;
+    };
+
+    // The forward pass.
+    auto forward = std::make_unique<Block>();
+    auto zero_i32 =
+        append(forward.get(), Stmt::make<ConstStmt>(TypedConstant((int32)0)));
+    auto num_segments_stmt =
+        append(forward.get(),
+               Stmt::make<ConstStmt>(TypedConstant((int32)num_segments)));
+    // The plain locals replacing the AD-stacks, and the checkpoint stacks.
+    std::vector<Stmt *> plain(num_locals);
+    std::vector<Stmt *> checkpoints(num_locals, nullptr);
+    for (int i = 0; i < num_locals; i++) {
+      auto &local = analyzer.locals[i];
+      if (local.alloca->is<AdStackAllocaStmt>()) {
+        plain[i] = append(forward.get(), Stmt::make<AllocaStmt>(local.dt));
+        auto top = append(forward.get(),
+                          Stmt::make<AdStackLoadTopStmt>(local.alloca));
+        append(forward.get(), Stmt::make<LocalStoreStmt>(plain[i], top));
+      } else {
+        plain[i] = local.alloca;
+      }
+      if (local.carried) {
+        checkpoints[i] = append(forward.get(), Stmt::make<AdStackAllocaStmt>(
+                                                   local.dt, num_segments));
+        checkpoints[i]->ret_type = local.dt;
+      }
+    }
+    auto segments = make_loop(zero_i32, num_segments_stmt);
+    auto segments_body = segments->body.get();
+    auto bounds = segment_bounds(segments_body, segments.get());
+    for (int i = 0; i < num_locals; i++) {
+      if (checkpoints[i]) {
+        auto value = append(segments_body, Stmt::make<LocalLoadStmt>(plain[i]));
+        append(segments_body,
+               Stmt::make<AdStackPushStmt>(checkpoints[i], value));
+      }
+    }
+    for (int i = 0; i < num_locals; i++) {
+      if (plain[i] != analyzer.locals[i].alloca) {
+        replace_stack_with_local(for_stmt->body.get(),
+                                 analyzer.locals[i].alloca, plain[i]);
+      }
+    }
+    erase_global_writes_with_adjoints(for_stmt->body.get());
+    for_stmt->begin = bounds.first;
+    for_stmt->end = bounds.second;
+    auto location = for_stmt->parent->locate(for_stmt);
+    append(segments_body, for_stmt->parent->extract(location));
+    append(forward.get(), std::move(segments));
+    for (int i = 0; i < num_locals; i++) {
+      if (plain[i] != analyzer.locals[i].alloca) {
+        auto value = append(forward.get(), Stmt::make<LocalLoadStmt>(plain[i]));
+        append(forward.get(),
+               Stmt::make<AdStackPushStmt>(analyzer.locals[i].alloca, value));
+      }
+    }
+    independent_block->insert(VecStatement(std::move(forward->statements)),
+                              location);
+
+    // The backward pass. |adjoints[i]| is the adjoint of local |i| at the end
+    // of the segment being processed.
+    std::vector<Stmt *> adjoints(num_locals, nullptr);
+    for (int i = 0; i < num_locals; i++) {
+      auto &local = analyzer.locals[i];
+      if (is_real(local.dt)) {
+        adjoints[i] = insert<AllocaStmt>(local.dt);
+      }
+      if (local.alloca->is<AdStackAllocaStmt>()) {
+        if (adjoints[i]) {
+          insert<LocalStoreStmt>(adjoints[i],
+                                 insert<AdStackLoadTopAdjStmt>(local.alloca));
+        }
+        insert<AdStackPopStmt>(local.alloca);
+      } else if (adjoints[i]) {
+        insert<LocalStoreStmt>(adjoints[i], load(adjoint(local.alloca)));
+      }
+    }
+    auto reversed_segments = make_loop(
+        insert<ConstStmt>(TypedConstant((int32)0)),
+        insert<ConstStmt>(TypedConstant((int32)num_segments)));
+    reversed_segments->reversed = true;
+    auto reversed_body = reversed_segments->body.get();
+    auto old_current_block = current_block;
+    auto old_alloca_block = alloca_block;
+    insert_grad_stmt(std::move(reversed_segments));
+    current_block = reversed_body;
+    bounds = segment_bounds(reversed_body, reversed_body->parent_stmt);
+    // The AD-stacks of the recomputation.
+    std::vector<Stmt *> stacks(num_locals);
+    for (int i = 0; i < num_locals; i++) {
+      auto &local = analyzer.locals[i];
+      stacks[i] = insert<AdStackAllocaStmt>(local.dt, 1 + k * local.num_writes);
+      stacks[i]->ret_type = local.dt;
+      Stmt *value;
+      if (checkpoints[i]) {
+        value = insert<AdStackLoadTopStmt>(checkpoints[i]);
+      } else {
+        value = insert<ConstStmt>(TypedConstant(local.dt, 0));
+      }
+      insert<AdStackPushStmt>(stacks[i], value);
+    }
+    recomputed_ptr->begin = bounds.first;
+    recomputed_ptr->end = bounds.second;
+    insert_grad_stmt(std::unique_ptr<Stmt>(
+        static_cast<Stmt *>(recomputed.release())));
+    for (int i = 0; i < num_locals; i++) {
+      replace_local_with_stack(recomputed_ptr->body.get(),
+                               analyzer.locals[i].alloca, stacks[i]);
+    }
+    for (int i = 0; i < num_locals; i++) {
+      if (adjoints[i]) {
+        insert<AdStackAccAdjointStmt>(stacks[i],
+                                      insert<LocalLoadStmt>(adjoints[i]));
+      }
+    }
+    alloca_block = reversed_body;
+    visit(recomputed_ptr);
+    current_block = reversed_body;
+    for (int i = 0; i < num_locals; i++) {
+      if (adjoints[i]) {
+        insert<LocalStoreStmt>(adjoints[i],
+                               insert<AdStackLoadTopAdjStmt>(stacks[i]));
+      }
+      insert<AdStackPopStmt>(stacks[i]);
+      if (checkpoints[i]) {
+        insert<AdStackPopStmt>(checkpoints[i]);
+      }
+    }
+    current_block = old_current_block;
+    alloca_block = old_alloca_block;
+    for (int i = 0; i < num_locals; i++) {
+      if (!adjoints[i]) {
+        continue;
+      }
+      auto &local = analyzer.locals[i];
+      auto value = insert<LocalLoadStmt>(adjoints[i]);
+      if (local.alloca->is<AdStackAllocaStmt>()) {
+        insert<AdStackAccAdjointStmt>(local.alloca, value);
+      } else {
+        insert<LocalStoreStmt>(adjoint(local.alloca), value);
+      }
+    }
+    return true;
+  }
+
+  // Turns the AD-stack |stack| into the plain local |alloca| in |block|.
+  static void replace_stack_with_local(Block *block,
+                                       Stmt *stack,
+                                       Stmt *alloca) {
+    for (auto push : irpass::analysis::gather_statements(block, [&](Stmt *s) {
+           auto push = s->cast<AdStackPushStmt>();
+           return push && push->stack == stack;
+         })) {
+      push->replace_with(Stmt::make<LocalStoreStmt>(
+          alloca, push->as<AdStackPushStmt>()->v));
+    }
+    for (auto top : irpass::analysis::gather_statements(block, [&](Stmt *s) {
+           auto top = s->cast<AdStackLoadTopStmt>();
+           return top && top->stack == stack;
+         })) {
+      auto load = Stmt::make<LocalLoadStmt>(alloca);
+      load->ret_type = top->ret_type;
+      top->replace_with(std::move(load));
+    }
+  }
+
+  // Turns the local |local|, plain or not, into the AD-stack |stack| in
+  // |block|.
+  static void replace_local_with_stack(Block *block,
+                                       Stmt *local,
+                                       Stmt *stack) {
+    if (local->is<AdStackAllocaStmt>()) {
+      irpass::replace_all_usages_with(block, local, stack);
+      return;
+    }
+    for (auto store : irpass::analysis::gather_statements(block, [&](Stmt *s) {
+           auto store = s->cast<LocalStoreStmt>();
+           return store && store->dest == local;
+         })) {
+      store->replace_with(Stmt::make<AdStackPushStmt>(
+          stack, store->as<LocalStoreStmt>()->val));
+    }
+    for (auto load : irpass::analysis::gather_statements(block, [&](Stmt *s) {
+           auto load = s->cast<LocalLoadStmt>();
+           return load && load->src == local;
+         })) {
+      auto top = Stmt::make<AdStackLoadTopStmt>(stack);
+      top->ret_type = load->ret_type;
+      load->replace_with(std::move(top));
+    }
+  }
+
+  // The forward pass of a checkpointed loop runs outside the adjoint
+  // transform, which would otherwise erase these.
+  static void erase_global_writes_with_adjoints(Block *block) {
+    auto has_adjoint = [](Stmt *dest) {
+      if (auto ptr = dest->cast<MatrixPtrStmt>()) {
+        dest = ptr->origin;
+      }
+      return dest->is<GlobalPtrStmt>() &&
+             dest->as<GlobalPtrStmt>()->snode->has_adjoint();
+    };
+    for (auto stmt : irpass::analysis::gather_statements(block, [&](Stmt *s) {
+           if (auto store = s->cast<GlobalStoreStmt>()) {
+             return has_adjoint(store->dest);
+           }
+           if (auto atomic = s->cast<AtomicOpStmt>()) {
+             return has_adjoint(atomic->dest);
+           }
+           return false;
+         })) {
+      stmt->parent->erase(stmt);
+    }
+  }
+
   // Equivalent to AdStackLoadTopStmt when no stack is needed
   void visit(LocalLoadStmt *stmt) override {
     // TI_ASSERT(!needs_grad(stmt->ret_type));
@@ -1138,16 +1617,22 @@ class MakeDual : public ADTransform {
   Stmt *current_stmt;
   Block *current_block;
   Block *alloca_block;
-  std::map<Stmt *, Stmt *> dual_stmt;
-
-  explicit MakeDual(Block *block) {
+  // Each primal statement carries |num_lanes| tangents. The code of all the
+  // lanes of a statement is emitted right after it, lane by lane.
+  int num_lanes;
+  int lane{0};
+  std::vector<std::map<Stmt *, Stmt *>> dual_stmt;
+
+  explicit MakeDual(Block *block, int num_lanes)
+      : num_lanes(num_lanes), dual_stmt(num_lanes) {
     current_stmt = nullptr;
     alloca_block = block;
     current_block = block;
   }
 
-  static void run(Block *block) {
-    auto p = MakeDual(block);
+  static void run(Block *block, int num_lanes = 1) {
+    TI_ASSERT(num_lanes >= 1);
+    auto p = MakeDual(block, num_lanes);
     block->accept(&p);
   }
 
@@ -1164,9 +1649,30 @@ class MakeDual : public ADTransform {
       statements.push_back(stmt.get());
     }
     for (auto stmt : statements) {
-      current_stmt = stmt;
+      differentiate(stmt);
+    }
+  }
+
+  void differentiate(Stmt *stmt) {
+    current_stmt = stmt;
+    if (stmt->is_container_statement()) {
+      stmt->accept(this);
+      return;
+    }
+    for (lane = 0; lane < num_lanes; lane++) {
       stmt->accept(this);
     }
+    lane = 0;
+  }
+
+  // The dual of |snode| for the current lane.
+  SNode *dual_snode(SNode *snode) {
+    auto dual = snode->get_dual_lane(lane);
+    TI_ERROR_IF(dual == nullptr,
+                "The dual of {} has no lane {}. It should be created after "
+                "setting forward_ad_lanes to {}.",
+                snode->get_node_type_name_hinted(), lane, num_lanes);
+    return dual;
   }
 
   // Accumulate [value] to the dual of [primal]
@@ -1185,6 +1691,7 @@ class MakeDual : public ADTransform {
     if (!is_real(stmt->ret_type) || stmt->is<ConstStmt>()) {
       return constant(0);
     }
+    auto &dual_stmt = this->dual_stmt[lane];
     if (dual_stmt.find(stmt) == dual_stmt.end()) {
       // normal SSA cases
 
@@ -1309,8 +1816,7 @@ class MakeDual : public ADTransform {
       }
 
       for (auto stmt : true_statements) {
-        current_stmt = stmt;
-        stmt->accept(this);
+        differentiate(stmt);
       }
     }
     if (if_stmt->false_statements) {
@@ -1320,8 +1826,7 @@ class MakeDual : public ADTransform {
       }
 
       for (auto stmt : false_statements) {
-        current_stmt = stmt;
-        stmt->accept(this);
+        differentiate(stmt);
       }
     }
   }
@@ -1335,8 +1840,7 @@ class MakeDual : public ADTransform {
     auto previous_alloca_block = alloca_block;
     alloca_block = for_stmt->body.get();
     for (auto stmt : statements) {
-      current_stmt = stmt;
-      stmt->accept(this);
+      differentiate(stmt);
     }
     alloca_block = previous_alloca_block;
   }
@@ -1385,8 +1889,7 @@ class MakeDual : public ADTransform {
       // gradients stopped, do nothing.
       return;
     }
-    TI_ASSERT(snode->get_dual() != nullptr);
-    snode = snode->get_dual();
+    snode = dual_snode(snode);
     auto dual_ptr = insert<GlobalPtrStmt>(snode, src->indices);
     if (is_ptr_offset) {
       dual_ptr = insert<MatrixPtrStmt>(dual_ptr,
@@ -1409,8 +1912,7 @@ class MakeDual : public ADTransform {
       // no gradient (likely integer types)
       return;
     }
-    TI_ASSERT(snode->get_dual() != nullptr);
-    snode = snode->get_dual();
+    snode = dual_snode(snode);
     auto dual_ptr = insert<GlobalPtrStmt>(snode, dest->indices);
     if (is_ptr_offset) {
       dual_ptr = insert<MatrixPtrStmt>(dual_ptr,
@@ -1433,8 +1935,7 @@ class MakeDual : public ADTransform {
       // no gradient (likely integer types)
       return;
     }
-    TI_ASSERT(snode->get_dual() != nullptr);
-    snode = snode->get_dual();
+    snode = dual_snode(snode);
     auto dual_ptr = insert<GlobalPtrStmt>(snode, dest->indices);
     if (is_ptr_offset) {
       dual_ptr = insert<MatrixPtrStmt>(dual_ptr,
@@ -1572,7 +2073,7 @@ void auto_diff(IRNode *root,
         ReplaceLocalVarWithStacks replace(config.ad_stack_size);
         ib->accept(&replace);
         type_check(root, config);
-        MakeAdjoint::run(ib);
+        MakeAdjoint::run(ib, config.ad_stack_memory_budget);
         type_check(root, config);
         BackupSSA::run(ib);
         irpass::analysis::verify(root);
@@ -1588,7 +2089,7 @@ void auto_diff(IRNode *root,
   } else if (autodiff_mode == AutodiffMode::kForward) {
     // Forward mode autodiff
     Block *block = root->as<Block>();
-    MakeDual::run(block);
+    MakeDual::run(block, config.forward_ad_lanes);
   }
   type_check(root, config);
   irpass::analysis::verify(root);
@@ -183,6 +183,25 @@ class BinaryOpSimp : public BasicStmtVisitor {
   }
 };
 
+namespace {
+
+class BinaryOpSimpRewriter : public StmtRewriter {
+ public:
+  explicit BinaryOpSimpRewriter(bool fast_math) : simplifier_(fast_math) {
+  }
+
+  bool rewrite(Stmt *stmt) override {
+    simplifier_.operand_swapped = false;
+    stmt->accept(&simplifier_);
+    return simplifier_.modifier.modify_ir() || simplifier_.operand_swapped;
+  }
+
+ private:
+  BinaryOpSimp simplifier_;
+};
+
+}  // namespace
+
 namespace irpass {
 
 bool binary_op_simplify(IRNode *root, const CompileConfig &config) {
@@ -190,6 +209,11 @@ bool binary_op_simplify(IRNode *root, const CompileConfig &config) {
   return BinaryOpSimp::run(root, config.fast_math);
 }
 
+std::unique_ptr<StmtRewriter> make_binary_op_simplify_rewriter(
+    const CompileConfig &config) {
+  return std::make_unique<BinaryOpSimpRewriter>(config.fast_math);
+}
+
 }  // namespace irpass
 
 }  // namespace taichi::lang
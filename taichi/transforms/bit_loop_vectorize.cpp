@@ -242,6 +242,14 @@ class BitLoopVectorize : public IRVisitor {
   }
 
   void visit(AtomicOpStmt *stmt) override {
+    if (in_struct_for_loop && is_bit_vectorized) {
+      // A reduction of the bits into a field, unlike the local adders below
+      if (auto dest = stmt->dest->cast<GlobalPtrStmt>();
+          dest && !dest->snode->is_bit_level) {
+        transform_bit_reduction(stmt);
+        return;
+      }
+    }
     DataType dt(quant_array_physical_type);
     if (in_struct_for_loop && is_bit_vectorized &&
         stmt->op_type == AtomicOpType::add) {
@@ -273,6 +281,61 @@ class BitLoopVectorize : public IRVisitor {
   }
 
  private:
+  // The vectorized load of a word of a quant array of 1-bit unsigned
+  // integers that |val| is, possibly cast.
+  GlobalLoadStmt *get_vectorized_bit_load(Stmt *val) {
+    if (auto cast = val->cast<UnaryOpStmt>();
+        cast && cast->op_type == UnaryOpType::cast_value) {
+      val = cast->operand;
+    }
+    auto load = val->cast<GlobalLoadStmt>();
+    if (!load) {
+      return nullptr;
+    }
+    auto ptr = load->src->cast<GlobalPtrStmt>();
+    if (!ptr || !ptr->is_bit_vectorized) {
+      return nullptr;
+    }
+    auto qit = ptr->snode->dt->cast<QuantIntType>();
+    if (!qit || qit->get_num_bits() != 1 || qit->get_is_signed()) {
+      return nullptr;
+    }
+    return load;
+  }
+
+  void transform_bit_reduction(AtomicOpStmt *stmt) {
+    // Each thread reduces a whole word of bits, so that counting the set bits
+    // takes a popcount, and any and all take a comparison of the word.
+    auto load = get_vectorized_bit_load(stmt->val);
+    if (!load) {
+      return;
+    }
+    DataType dt(quant_array_physical_type);
+    VecStatement reduced;
+    if (stmt->op_type == AtomicOpType::add) {
+      reduced.push_back<UnaryOpStmt>(UnaryOpType::popcnt, load);
+    } else if (stmt->op_type == AtomicOpType::bit_or ||
+               stmt->op_type == AtomicOpType::max ||
+               stmt->op_type == AtomicOpType::bit_and ||
+               stmt->op_type == AtomicOpType::min) {
+      bool any = stmt->op_type == AtomicOpType::bit_or ||
+                 stmt->op_type == AtomicOpType::max;
+      auto *word = reduced.push_back<ConstStmt>(
+          TypedConstant(dt, any ? 0 : -1));
+      // Comparisons yield -1 for true.
+      auto *cmp = reduced.push_back<BinaryOpStmt>(
+          any ? BinaryOpType::cmp_ne : BinaryOpType::cmp_eq, load, word);
+      auto *one = reduced.push_back<ConstStmt>(TypedConstant(1));
+      reduced.push_back<BinaryOpStmt>(BinaryOpType::bit_and, cmp, one);
+    } else {
+      return;
+    }
+    stmt->val = reduced.back().get();
+    for (auto &s : reduced.stmts) {
+      stmt->insert_before_me(std::move(s));
+    }
+  }
+
   void transform_atomic_add(const std::vector<Stmt *> &buffer_vec,
                             AtomicOpStmt *stmt,
                             DataType &dt) {
@@ -0,0 +1,339 @@
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/system/profiler.h"
+
+#include <map>
+
+namespace taichi::lang {
+
+namespace {
+
+// The maximum number of registers kept for a neighbourhood.
+constexpr int kMaxWindowSize = 16;
+
+// Scalar replacement of the loads of a stencil along the index of a serial
+// range-for. For example,
+//
+//   for i in range(begin, end):
+//     y[i] = x[i - 1] + x[i] + x[i + 1]
+//
+// loads each element of x three times. After this pass, x[i + 1] is loaded
+// into a register at the beginning of each iteration, the registers of x[i - 1]
+// and x[i] are rotated at the end of each iteration, and the registers of the
+// first iteration are loaded before the loop:
+//
+//   if begin < end:
+//     r[-1] = x[begin - 1]; r[0] = x[begin]
+//   for i in range(begin, end):
+//     r[1] = x[i + 1]
+//     y[i] = r[-1] + r[0] + r[1]
+//     r[-1] = r[0]; r[0] = r[1]
+//
+// Only innermost loops without continue statements are handled, and only
+// neighbourhoods with a load of each offset in the top level of the loop body
+// are cached, so that no element is loaded that the original loop would not
+// load.
+class CacheLoopCarriedGlobalLoads : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  DelayedIRModifier modifier;
+
+  void visit(RangeForStmt *stmt) override {
+    BasicStmtVisitor::visit(stmt);
+    if (!stmt->reversed && !stmt->is_bit_vectorized) {
+      cache_loads(stmt);
+    }
+  }
+
+ private:
+  // The loads of a global variable at constant offsets from the loop index
+  // along the same axis.
+  struct Neighbourhood {
+    Stmt *prototype{nullptr};
+    int axis{0};
+    std::set<int> top_level_offsets;
+    std::map<int, std::vector<GlobalLoadStmt *>> loads;
+  };
+
+  using NeighbourhoodKey =
+      std::tuple<const SNode *, Stmt *, std::vector<Stmt *>, int>;
+
+  static bool is_defined_outside(Stmt *stmt, RangeForStmt *loop) {
+    for (Block *block = stmt->parent; block != nullptr;) {
+      if (block->parent_stmt == loop) {
+        return false;
+      }
+      block = block->parent_stmt ? block->parent_stmt->parent : nullptr;
+    }
+    return true;
+  }
+
+  // Returns c if |index| is "i + c" where i is the index of |loop|.
+  static std::optional<int> get_offset_from_loop_index(Stmt *index,
+                                                       RangeForStmt *loop) {
+    auto is_loop_index = [&](Stmt *stmt) {
+      auto loop_index = stmt->cast<LoopIndexStmt>();
+      return loop_index && loop_index->loop == loop;
+    };
+    if (is_loop_index(index)) {
+      return 0;
+    }
+    auto binary = index->cast<BinaryOpStmt>();
+    if (!binary || (binary->op_type != BinaryOpType::add &&
+                    binary->op_type != BinaryOpType::sub)) {
+      return std::nullopt;
+    }
+    Stmt *lhs = binary->lhs;
+    Stmt *rhs = binary->rhs;
+    if (binary->op_type == BinaryOpType::add && !is_loop_index(lhs)) {
+      std::swap(lhs, rhs);
+    }
+    auto offset = rhs->cast<ConstStmt>();
+    if (!is_loop_index(lhs) || !offset || !is_integral(offset->val.dt)) {
+      return std::nullopt;
+    }
+    auto value = offset->val.val_int();
+    if (std::abs(value) > (1 << 20)) {
+      return std::nullopt;
+    }
+    return binary->op_type == BinaryOpType::add ? (int)value : -(int)value;
+  }
+
+  static std::optional<std::pair<NeighbourhoodKey, int>> get_neighbourhood(
+      Stmt *ptr,
+      RangeForStmt *loop) {
+    const SNode *snode = nullptr;
+    Stmt *base_ptr = nullptr;
+    std::vector<Stmt *> indices;
+    if (auto global_ptr = ptr->cast<GlobalPtrStmt>()) {
+      snode = global_ptr->snode;
+      indices = global_ptr->indices;
+    } else if (auto external_ptr = ptr->cast<ExternalPtrStmt>()) {
+      base_ptr = external_ptr->base_ptr;
+      if (!is_defined_outside(base_ptr, loop)) {
+        return std::nullopt;
+      }
+      indices = external_ptr->indices;
+    } else {
+      return std::nullopt;
+    }
+    std::optional<std::pair<int, int>> axis_and_offset;
+    for (int i = 0; i < (int)indices.size(); i++) {
+      if (is_defined_outside(indices[i], loop)) {
+        continue;
+      }
+      auto offset = get_offset_from_loop_index(indices[i], loop);
+      if (!offset.has_value() || axis_and_offset.has_value()) {
+        return std::nullopt;
+      }
+      axis_and_offset = std::make_pair(i, offset.value());
+      indices[i] = nullptr;
+    }
+    if (!axis_and_offset.has_value()) {
+      return std::nullopt;
+    }
+    return std::make_pair(
+        NeighbourhoodKey{snode, base_ptr, indices, axis_and_offset->first},
+        axis_and_offset->second);
+  }
+
+  // Returns true if a write to |dest| in some iteration may change a value
+  // that |ptr| points to in another iteration.
+  static bool may_clobber(Stmt *dest, Stmt *ptr) {
+    if (auto matrix_ptr = dest->cast<MatrixPtrStmt>()) {
+      dest = matrix_ptr->origin;
+    }
+    if (dest->is<GlobalPtrStmt>() && ptr->is<GlobalPtrStmt>()) {
+      return dest->as<GlobalPtrStmt>()->snode ==
+             ptr->as<GlobalPtrStmt>()->snode;
+    }
+    if (dest->is<ExternalPtrStmt>() && ptr->is<ExternalPtrStmt>()) {
+      auto base1 = dest->as<ExternalPtrStmt>()->base_ptr->as<ArgLoadStmt>();
+      auto base2 = ptr->as<ExternalPtrStmt>()->base_ptr->as<ArgLoadStmt>();
+      return base1->arg_id == base2->arg_id && base1->is_grad == base2->is_grad;
+    }
+    return irpass::analysis::maybe_same_address(dest, ptr);
+  }
+
+  // Returns the destinations of all the global writes in |body|, or nullopt
+  // if |body| cannot be handled.
+  static std::optional<std::vector<Stmt *>> gather_writes(Block *body) {
+    std::vector<Stmt *> writes;
+    bool unsupported = false;
+    irpass::analysis::gather_statements(body, [&](Stmt *stmt) {
+      if (auto store = stmt->cast<GlobalStoreStmt>()) {
+        writes.push_back(store->dest);
+      } else if (auto global_ptr = stmt->cast<GlobalPtrStmt>()) {
+        if (global_ptr->activate) {
+          writes.push_back(global_ptr);
+        }
+      } else if (auto atomic = stmt->cast<AtomicOpStmt>()) {
+        writes.push_back(atomic->dest);
+      } else if (stmt->is<IfStmt>() || stmt->is<LocalStoreStmt>() ||
+                 stmt->is<AssertStmt>() || stmt->is<PrintStmt>()) {
+        // Does not write to global memory.
+      } else if (stmt->is_container_statement() || stmt->is<ContinueStmt>() ||
+                 stmt->is<WhileControlStmt>() ||
+                 stmt->has_global_side_effect()) {
+        unsupported = true;
+      }
+      return false;
+    });
+    if (unsupported) {
+      return std::nullopt;
+    }
+    return writes;
+  }
+
+  static Stmt *create_load(VecStatement &statements,
+                           const Neighbourhood &neighbourhood,
+                           Stmt *index) {
+    auto ptr = neighbourhood.prototype->clone();
+    if (auto global_ptr = ptr->cast<GlobalPtrStmt>()) {
+      global_ptr->indices[neighbourhood.axis] = index;
+    } else {
+      ptr->as<ExternalPtrStmt>()->indices[neighbourhood.axis] = index;
+    }
+    return statements.push_back<GlobalLoadStmt>(
+        statements.push_back(std::move(ptr)));
+  }
+
+  void cache_loads(RangeForStmt *loop) {
+    auto *body = loop->body.get();
+    if (body->statements.empty()) {
+      return;
+    }
+    auto writes = gather_writes(body);
+    if (!writes.has_value()) {
+      return;
+    }
+
+    std::map<NeighbourhoodKey, Neighbourhood> neighbourhoods;
+    irpass::analysis::gather_statements(body, [&](Stmt *stmt) {
+      auto load = stmt->cast<GlobalLoadStmt>();
+      if (!load || !load->ret_type->is<PrimitiveType>()) {
+        return false;
+      }
+      auto key_and_offset = get_neighbourhood(load->src, loop);
+      if (!key_and_offset.has_value()) {
+        return false;
+      }
+      auto &[key, offset] = key_and_offset.value();
+      auto &neighbourhood = neighbourhoods[key];
+      neighbourhood.axis = std::get<3>(key);
+      neighbourhood.loads[offset].push_back(load);
+      if (load->parent == body) {
+        neighbourhood.top_level_offsets.insert(offset);
+        if (!neighbourhood.prototype ||
+            offset == *neighbourhood.top_level_offsets.rbegin()) {
+          neighbourhood.prototype = load->src;
+        }
+      }
+      return false;
+    });
+
+    for (auto &[key, neighbourhood] : neighbourhoods) {
+      auto &offsets = neighbourhood.top_level_offsets;
+      if (offsets.size() < 2) {
+        continue;
+      }
+      const int low = *offsets.begin();
+      const int high = *offsets.rbegin();
+      const int window_size = high - low + 1;
+      if (window_size != (int)offsets.size() || window_size > kMaxWindowSize) {
+        continue;
+      }
+      bool clobbered = false;
+      for (auto dest : writes.value()) {
+        clobbered |= may_clobber(dest, neighbourhood.prototype);
+      }
+      if (clobbered) {
+        continue;
+      }
+      cache_neighbourhood(loop, neighbourhood, low, high);
+    }
+  }
+
+  void cache_neighbourhood(RangeForStmt *loop,
+                           const Neighbourhood &neighbourhood,
+                           int low,
+                           int high) {
+    auto *body = loop->body.get();
+    auto dt = neighbourhood.loads.at(high)[0]->ret_type;
+
+    // Load the registers of the first iteration before the loop.
+    VecStatement preheader;
+    std::vector<Stmt *> registers;
+    for (int offset = low; offset <= high; offset++) {
+      registers.push_back(preheader.push_back<AllocaStmt>(dt));
+    }
+    VecStatement first_iteration;
+    for (int offset = low; offset < high; offset++) {
+      auto *index = first_iteration.push_back<BinaryOpStmt>(
+          BinaryOpType::add, loop->begin,
+          first_iteration.push_back<ConstStmt>(TypedConstant(offset)));
+      first_iteration.push_back<LocalStoreStmt>(
+          registers[offset - low],
+          create_load(first_iteration, neighbourhood, index));
+    }
+    auto *not_empty = preheader.push_back<BinaryOpStmt>(
+        BinaryOpType::cmp_lt, loop->begin, loop->end);
+    auto *if_stmt = preheader.push_back<IfStmt>(not_empty);
+    if_stmt->set_true_statements(std::make_unique<Block>());
+    if_stmt->true_statements->insert(std::move(first_iteration));
+    modifier.insert_before(loop, std::move(preheader));
+
+    // Load the new element at the beginning of each iteration.
+    VecStatement head;
+    auto *index = head.push_back<BinaryOpStmt>(
+        BinaryOpType::add, head.push_back<LoopIndexStmt>(loop, 0),
+        head.push_back<ConstStmt>(TypedConstant(high)));
+    head.push_back<LocalStoreStmt>(registers[high - low],
+                                   create_load(head, neighbourhood, index));
+    modifier.insert_before(body->statements[0].get(), std::move(head));
+
+    // Rotate the registers at the end of each iteration.
+    VecStatement tail;
+    for (int offset = low; offset < high; offset++) {
+      tail.push_back<LocalStoreStmt>(
+          registers[offset - low],
+          tail.push_back<LocalLoadStmt>(registers[offset - low + 1]));
+    }
+    modifier.insert_after(body->statements.back().get(), std::move(tail));
+
+    for (auto &[offset, loads] : neighbourhood.loads) {
+      if (offset < low || offset > high) {
+        continue;
+      }
+      for (auto load : loads) {
+        auto local_load =
+            std::make_unique<LocalLoadStmt>(registers[offset - low]);
+        modifier.replace_with(load, VecStatement(std::move(local_load)));
+      }
+    }
+  }
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool cache_loop_carried_global_loads(IRNode *root,
+                                     const CompileConfig &config) {
+  TI_AUTO_PROF;
+  CacheLoopCarriedGlobalLoads pass;
+  root->accept(&pass);
+  if (!pass.modifier.modify_ir()) {
+    return false;
+  }
+  type_check(root, config);
+  return true;
+}
+
+}  // namespace irpass
+
+}  // namespace taichi::lang
@@ -4,6 +4,7 @@
 #include "taichi/ir/visitors.h"
 #include "taichi/transforms/check_out_of_bound.h"
 #include "taichi/transforms/utils.h"
+#include <limits>
 #include <set>
 
 namespace taichi::lang {
@@ -40,10 +41,81 @@ class CheckOutOfBound : public BasicStmtVisitor {
     // TODO: implement bound check here for other situations.
   }
 
+  // Returns the range [first, second] of the values of |stmt| if it only
+  // depends on constants and the indices of range-fors with constant bounds.
+  static std::optional<std::pair<int64, int64>> get_value_range(Stmt *stmt) {
+    std::optional<std::pair<int64, int64>> range;
+    if (auto const_stmt = stmt->cast<ConstStmt>()) {
+      if (is_integral(const_stmt->val.dt)) {
+        auto value = const_stmt->val.val_int();
+        range = std::make_pair(value, value);
+      }
+    } else if (auto loop_index = stmt->cast<LoopIndexStmt>()) {
+      auto loop = loop_index->loop->cast<RangeForStmt>();
+      if (loop && loop->begin->is<ConstStmt>() && loop->end->is<ConstStmt>()) {
+        auto begin = loop->begin->as<ConstStmt>()->val;
+        auto end = loop->end->as<ConstStmt>()->val;
+        if (is_integral(begin.dt) && is_integral(end.dt) &&
+            begin.val_int() < end.val_int()) {
+          range = std::make_pair(begin.val_int(), end.val_int() - 1);
+        }
+      }
+    } else if (auto binary = stmt->cast<BinaryOpStmt>()) {
+      auto lhs = get_value_range(binary->lhs);
+      auto rhs = get_value_range(binary->rhs);
+      if (!lhs.has_value() || !rhs.has_value()) {
+        return std::nullopt;
+      }
+      auto [a, b] = lhs.value();
+      auto [c, d] = rhs.value();
+      // Division and modulo are only handled for non-negative dividends and
+      // constant positive divisors.
+      bool positive_divisor = a >= 0 && c == d && c > 0;
+      if (binary->op_type == BinaryOpType::add) {
+        range = std::make_pair(a + c, b + d);
+      } else if (binary->op_type == BinaryOpType::sub) {
+        range = std::make_pair(a - d, b - c);
+      } else if (binary->op_type == BinaryOpType::mul) {
+        auto products = {a * c, a * d, b * c, b * d};
+        range = std::make_pair(std::min(products), std::max(products));
+      } else if ((binary->op_type == BinaryOpType::div ||
+                  binary->op_type == BinaryOpType::floordiv) &&
+                 positive_divisor) {
+        range = std::make_pair(a / c, b / c);
+      } else if (binary->op_type == BinaryOpType::mod && positive_divisor) {
+        if (b - a + 1 < c && a % c <= b % c) {
+          range = std::make_pair(a % c, b % c);
+        } else {
+          range = std::make_pair(int64(0), c - 1);
+        }
+      }
+    }
+    // The index arithmetic is done in i32, so a range that does not fit may
+    // wrap around.
+    if (range.has_value() &&
+        (range->first < std::numeric_limits<int32>::min() ||
+         range->second > std::numeric_limits<int32>::max())) {
+      return std::nullopt;
+    }
+    return range;
+  }
+
   void visit(GlobalPtrStmt *stmt) override {
     if (is_done(stmt))
       return;
     auto snode = stmt->snode;
+    // Accesses with indices that are in bounds for every iteration of the
+    // enclosing range-fors need no check at runtime.
+    bool in_bounds = true;
+    for (int i = 0; i < stmt->indices.size() && in_bounds; i++) {
+      auto range = get_value_range(stmt->indices[i]);
+      in_bounds = range.has_value() && range->first >= 0 &&
+                  range->second < snode->shape_along_axis(i);
+    }
+    if (in_bounds) {
+      set_done(stmt);
+      return;
+    }
     bool has_offset = !(snode->index_offsets.empty());
     auto new_stmts = VecStatement();
     auto zero = new_stmts.push_back<ConstStmt>(TypedConstant(0));
@@ -1,29 +1,63 @@
+#include "taichi/analysis/offline_cache_util.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/pass.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/program/compile_config.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
+#include "taichi/system/timer.h"
 
 namespace taichi::lang {
 
 namespace irpass {
 namespace {
 
+// The returned function is called after each pass. It prints the IR if
+// |verbose|, and records the pass to the CompileProfiler if it is enabled.
 std::function<void(const std::string &)>
 make_pass_printer(bool verbose, const std::string &kernel_name, IRNode *ir) {
-  if (!verbose) {
+  const bool profiled = CompileProfiler::get_instance().get_enabled();
+  if (!verbose && !profiled) {
     return [](const std::string &) {};
   }
-  return [ir, kernel_name](const std::string &pass) {
-    TI_INFO("[{}] {}:", kernel_name, pass);
-    std::cout << std::flush;
-    irpass::re_id(ir);
-    irpass::print(ir);
-    std::cout << std::flush;
+  // Where the previous pass ended.
+  struct Checkpoint {
+    float64 time{0};
+    int num_statements{0};
+  };
+  std::shared_ptr<Checkpoint> last{nullptr};
+  if (profiled) {
+    last = std::make_shared<Checkpoint>();
+    last->num_statements = irpass::analysis::count_statements(ir);
+    last->time = Time::get_time();
+  }
+  return [ir, kernel_name, verbose, last](const std::string &pass) {
+    if (last) {
+      CompileProfiler::Record record;
+      record.kernel_name = kernel_name;
+      record.pass_name = pass;
+      record.begin_time = last->time;
+      record.end_time = Time::get_time();
+      record.num_statements_before = last->num_statements;
+      record.num_statements_after = irpass::analysis::count_statements(ir);
+      CompileProfiler::get_instance().insert_record(record);
+      last->num_statements = record.num_statements_after;
+    }
+    if (verbose) {
+      TI_INFO("[{}] {}:", kernel_name, pass);
+      std::cout << std::flush;
+      irpass::re_id(ir);
+      irpass::print(ir);
+      std::cout << std::flush;
+    }
+    if (last) {
+      // Neither counting nor printing is part of the next pass.
+      last->time = Time::get_time();
+    }
   };
 }
 
@@ -54,12 +88,28 @@ void compile_to_offloads(IRNode *ir,
     print("Segment reversed (for autodiff)");
   }
 
+  // The variants of the kernel specialized on ndarray shapes start from its
+  // lowered AST, and are cached under the key of the AST.
+  const bool keeps_ir = start_from_ast && kernel->may_specialize_shapes(config);
+  if (keeps_ir && kernel->get_cached_ast_key().empty()) {
+    kernel->set_ast_key_for_cache(
+        get_hashed_offline_cache_key_of_ast(kernel->program, ir));
+  }
+
   if (start_from_ast) {
     irpass::frontend_type_check(ir);
     irpass::lower_ast(ir);
     print("Lowered");
   }
 
+  if (keeps_ir) {
+    kernel->set_shape_dynamic_ir(irpass::analysis::clone(ir));
+  }
+  if (!kernel->get_specialized_shapes().empty()) {
+    irpass::specialize_ndarray_shapes(ir, kernel->get_specialized_shapes());
+    print("Ndarray shapes specialized");
+  }
+
   irpass::eliminate_immutable_local_vars(ir);
   print("Immutable local vars eliminated");
 
@@ -78,6 +128,12 @@ void compile_to_offloads(IRNode *ir,
   print("Typechecked");
   irpass::analysis::verify(ir);
 
+  if (irpass::lower_quant_external_access(ir)) {
+    irpass::type_check(ir, config);
+    print("Quant external accesses lowered");
+    irpass::analysis::verify(ir);
+  }
+
   if (kernel->is_evaluator) {
     TI_ASSERT(autodiff_mode == AutodiffMode::kNone);
 
@@ -206,9 +262,13 @@ void offload_to_executable(IRNode *ir,
     irpass::cache_loop_invariant_global_vars(ir, config);
     print("Cache loop-invariant global vars");
   }
+  if (config.cache_loop_carried_global_loads) {
+    irpass::cache_loop_carried_global_loads(ir, config);
+    print("Cache loop-carried global loads");
+  }
 
   if (config.demote_dense_struct_fors) {
-    irpass::demote_dense_struct_fors(ir);
+    irpass::demote_dense_struct_fors(ir, config);
     irpass::type_check(ir, config);
     print("Dense struct-for demoted");
     irpass::analysis::verify(ir);
@@ -222,6 +282,13 @@ void offload_to_executable(IRNode *ir,
     irpass::analysis::verify(ir);
   }
 
+  if (config.opt_level > 0 && config.fuse_offloads) {
+    if (irpass::fuse_offloads(ir)) {
+      print("Offloaded tasks fused");
+      irpass::analysis::verify(ir);
+    }
+  }
+
   if (make_thread_local) {
     irpass::make_thread_local(ir, config);
     print("Make thread local");
@@ -230,7 +297,8 @@ void offload_to_executable(IRNode *ir,
   if (is_extension_supported(config.arch, Extension::mesh)) {
     irpass::make_mesh_thread_local(ir, config, {kernel->get_name()});
     print("Make mesh thread local");
-    if (config.make_mesh_block_local && config.arch == Arch::cuda) {
+    if (config.make_mesh_block_local &&
+        (config.arch == Arch::cuda || config.arch == Arch::vulkan)) {
       irpass::make_mesh_block_local(ir, config, {kernel->get_name()});
       print("Make mesh block local");
       irpass::full_simplify(
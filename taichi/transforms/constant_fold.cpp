@@ -1,15 +1,10 @@
-#include <cmath>
-#include <deque>
-#include <set>
-#include <thread>
-
+#include "taichi/analysis/arithmetic_interpretor.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/transforms/constant_fold.h"
-#include "taichi/program/program.h"
 
 namespace taichi::lang {
 
@@ -17,65 +12,14 @@ class ConstantFold : public BasicStmtVisitor {
  public:
   using BasicStmtVisitor::visit;
   DelayedIRModifier modifier;
-  Program *program;
-  CompileConfig compile_config;
-
-  explicit ConstantFold(Program *program, const CompileConfig &compile_config)
-      : program(program), compile_config(compile_config) {
-    this->compile_config.advanced_optimization = false;
-    this->compile_config.constant_folding = false;
-    this->compile_config.external_optimization_level = 0;
-  }
-
-  Kernel *get_jit_evaluator_kernel(JITEvaluatorId const &id) {
-    auto &cache = program->jit_evaluator_cache;
-    // Discussion:
-    // https://github.com/taichi-dev/taichi/pull/954#discussion_r423442606
-    std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-    auto it = cache.find(id);
-    if (it != cache.end())  // cached?
-      return it->second.get();
-
-    auto kernel_name = fmt::format("jit_evaluator_{}", cache.size());
-    auto func = [&id](Kernel *kernel) {
-      auto lhstmt =
-          Stmt::make<ArgLoadStmt>(/*arg_id=*/0, id.lhs, /*is_ptr=*/false);
-      auto rhstmt =
-          Stmt::make<ArgLoadStmt>(/*arg_id=*/1, id.rhs, /*is_ptr=*/false);
-      pStmt oper;
-      if (id.is_binary) {
-        oper = Stmt::make<BinaryOpStmt>(id.binary_op(), lhstmt.get(),
-                                        rhstmt.get());
-        oper->set_tb(id.tb);
-      } else {
-        oper = Stmt::make<UnaryOpStmt>(id.unary_op(), lhstmt.get());
-        if (unary_op_is_cast(id.unary_op())) {
-          oper->cast<UnaryOpStmt>()->cast_type = id.rhs;
-        }
-      }
-      auto &ast_builder = kernel->context->builder();
-      auto ret = Stmt::make<ReturnStmt>(oper.get());
-      ast_builder.insert(std::move(lhstmt));
-      if (id.is_binary) {
-        ast_builder.insert(std::move(rhstmt));
-      }
-      ast_builder.insert(std::move(oper));
-      ast_builder.insert(std::move(ret));
-    };
-
-    auto ker = std::make_unique<Kernel>(*program, func, kernel_name);
-    ker->insert_ret(id.ret);
-    ker->insert_scalar_param(id.lhs);
-    if (id.is_binary)
-      ker->insert_scalar_param(id.rhs);
-    ker->is_evaluator = true;
-
-    auto *ker_ptr = ker.get();
-    TI_TRACE("Saving JIT evaluator cache entry id={}",
-             std::hash<JITEvaluatorId>{}(id));
-    cache[id] = std::move(ker);
-
-    return ker_ptr;
+  ArithmeticInterpretor::EvalOptions eval_options;
+
+  explicit ConstantFold(const CompileConfig &compile_config) {
+    // The CPU runtime calls the host's libm, so transcendental functions fold
+    // bit-exactly only there. Other backends keep them for the device.
+    eval_options.host_math = compile_config.arch == Arch::x64 ||
+                             compile_config.arch == Arch::arm64;
+    eval_options.check_overflow = compile_config.debug;
   }
 
   static bool is_good_type(DataType dt) {
@@ -93,52 +37,11 @@ class ConstantFold : public BasicStmtVisitor {
       return false;
   }
 
-  bool jit_evaluate_binary_op(TypedConstant &ret,
-                              BinaryOpStmt *stmt,
-                              const TypedConstant &lhs,
-                              const TypedConstant &rhs) {
-    if (!is_good_type(ret.dt))
-      return false;
-    JITEvaluatorId id{std::this_thread::get_id(),
-                      (int)stmt->op_type,
-                      ret.dt,
-                      lhs.dt,
-                      rhs.dt,
-                      compile_config.debug ? stmt->tb : "",
-                      true};
-    auto *ker = get_jit_evaluator_kernel(id);
-    auto launch_ctx = ker->make_launch_context();
-    launch_ctx.set_arg_raw(0, lhs.val_u64);
-    launch_ctx.set_arg_raw(1, rhs.val_u64);
-    {
-      std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-      (*ker)(compile_config, launch_ctx);
-      ret.val_i64 = program->fetch_result<int64_t>(0);
-    }
-    return true;
-  }
-
-  bool jit_evaluate_unary_op(TypedConstant &ret,
-                             UnaryOpStmt *stmt,
-                             const TypedConstant &operand) {
-    if (!is_good_type(ret.dt))
-      return false;
-    JITEvaluatorId id{std::this_thread::get_id(),
-                      (int)stmt->op_type,
-                      ret.dt,
-                      operand.dt,
-                      stmt->cast_type,
-                      "",
-                      false};
-    auto *ker = get_jit_evaluator_kernel(id);
-    auto launch_ctx = ker->make_launch_context();
-    launch_ctx.set_arg_raw(0, operand.val_u64);
-    {
-      std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-      (*ker)(compile_config, launch_ctx);
-      ret.val_i64 = program->fetch_result<int64_t>(0);
-    }
-    return true;
+  void replace_with_constant(Stmt *stmt, const TypedConstant &val) {
+    auto evaluated = Stmt::make<ConstStmt>(val);
+    stmt->replace_usages_with(evaluated.get());
+    modifier.insert_before(stmt, std::move(evaluated));
+    modifier.erase(stmt);
   }
 
   void visit(BinaryOpStmt *stmt) override {
@@ -146,8 +49,8 @@ class ConstantFold : public BasicStmtVisitor {
     auto rhs = stmt->rhs->cast<ConstStmt>();
     if (!lhs || !rhs)
       return;
-    auto dst_type = stmt->ret_type;
-    TypedConstant new_constant(dst_type);
+    if (!is_good_type(stmt->ret_type))
+      return;
 
     if (stmt->op_type == BinaryOpType::pow) {
       if (is_integral(rhs->ret_type)) {
@@ -158,11 +61,10 @@ class ConstantFold : public BasicStmtVisitor {
       }
     }
 
-    if (jit_evaluate_binary_op(new_constant, stmt, lhs->val, rhs->val)) {
-      auto evaluated = Stmt::make<ConstStmt>(TypedConstant(new_constant));
-      stmt->replace_usages_with(evaluated.get());
-      modifier.insert_before(stmt, std::move(evaluated));
-      modifier.erase(stmt);
+    auto result = ArithmeticInterpretor::eval_binary_op(
+        stmt->op_type, stmt->ret_type, lhs->val, rhs->val, eval_options);
+    if (result) {
+      replace_with_constant(stmt, result.value());
     }
   }
 
@@ -175,36 +77,14 @@ class ConstantFold : public BasicStmtVisitor {
     auto operand = stmt->operand->cast<ConstStmt>();
     if (!operand)
       return;
-    if (stmt->is_cast()) {
-      bool cast_available = true;
-      TypedConstant new_constant(stmt->ret_type);
-      auto operand = stmt->operand->cast<ConstStmt>();
-      if (stmt->op_type == UnaryOpType::cast_bits) {
-        new_constant.value_bits = operand->val.value_bits;
-      } else {
-        if (stmt->cast_type == PrimitiveType::f32) {
-          new_constant.val_f32 = float32(operand->val.val_cast_to_float64());
-        } else if (stmt->cast_type == PrimitiveType::f64) {
-          new_constant.val_f64 = operand->val.val_cast_to_float64();
-        } else {
-          cast_available = false;
-        }
-      }
-      if (cast_available) {
-        auto evaluated = Stmt::make<ConstStmt>(TypedConstant(new_constant));
-        stmt->replace_usages_with(evaluated.get());
-        modifier.insert_before(stmt, std::move(evaluated));
-        modifier.erase(stmt);
-        return;
-      }
-    }
-    auto dst_type = stmt->ret_type;
-    TypedConstant new_constant(dst_type);
-    if (jit_evaluate_unary_op(new_constant, stmt, operand->val)) {
-      auto evaluated = Stmt::make<ConstStmt>(TypedConstant(new_constant));
-      stmt->replace_usages_with(evaluated.get());
-      modifier.insert_before(stmt, std::move(evaluated));
-      modifier.erase(stmt);
+    if (stmt->op_type != UnaryOpType::cast_bits &&
+        !is_good_type(stmt->ret_type))
+      return;
+    auto result = ArithmeticInterpretor::eval_unary_op(
+        stmt->op_type, stmt->ret_type, stmt->cast_type, operand->val,
+        eval_options);
+    if (result) {
+      replace_with_constant(stmt, result.value());
     }
   }
 
@@ -227,10 +107,8 @@ class ConstantFold : public BasicStmtVisitor {
     modifier.erase(stmt);
   }
 
-  static bool run(IRNode *node,
-                  Program *program,
-                  const CompileConfig &compile_config) {
-    ConstantFold folder(program, compile_config);
+  static bool run(IRNode *node, const CompileConfig &compile_config) {
+    ConstantFold folder(compile_config);
     bool modified = false;
 
     while (true) {
@@ -246,6 +124,25 @@ class ConstantFold : public BasicStmtVisitor {
   }
 };
 
+namespace {
+
+class ConstantFoldRewriter : public StmtRewriter {
+ public:
+  explicit ConstantFoldRewriter(const CompileConfig &compile_config)
+      : folder_(compile_config) {
+  }
+
+  bool rewrite(Stmt *stmt) override {
+    stmt->accept(&folder_);
+    return folder_.modifier.modify_ir();
+  }
+
+ private:
+  ConstantFold folder_;
+};
+
+}  // namespace
+
 const PassID ConstantFoldPass::id = "ConstantFoldPass";
 
 namespace irpass {
@@ -256,7 +153,13 @@ bool constant_fold(IRNode *root,
   TI_AUTO_PROF;
   if (!compile_config.advanced_optimization)
     return false;
-  return ConstantFold::run(root, args.program, compile_config);
+  return ConstantFold::run(root, compile_config);
+}
+
+std::unique_ptr<StmtRewriter> make_constant_fold_rewriter(
+    const CompileConfig &compile_config,
+    const ConstantFoldPass::Args &args) {
+  return std::make_unique<ConstantFoldRewriter>(compile_config);
 }
 
 }  // namespace irpass
@@ -1,3 +1,5 @@
+#include <numeric>
+
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
@@ -10,7 +12,107 @@ namespace {
 
 using TaskType = OffloadedStmt::TaskType;
 
-void convert_to_range_for(OffloadedStmt *offloaded) {
+// Returns the shape of the tiles to iterate over, along the loop indices of
+// |snode|, or an empty vector if the loop is not tiled. Tiling changes the
+// iteration order of the struct-for so that consecutive iterations, i.e. the
+// iterations of a CPU task or a GPU block, cover a tile of the field rather
+// than a few of its rows.
+std::vector<int> get_tile_shape(OffloadedStmt *offloaded,
+                                const std::vector<SNode *> &snodes,
+                                const std::vector<int> &physical_indices,
+                                const CompileConfig &config) {
+  // Only a single level of dense SNodes is tiled for now. The cells of a
+  // Morton-ordered SNode are already visited tile by tile.
+  const int num_indices = (int)physical_indices.size();
+  if (snodes.size() != 1 || num_indices < 2 || snodes[0]->_morton) {
+    return {};
+  }
+  std::vector<int> shape;
+  for (auto p : physical_indices) {
+    shape.push_back(snodes[0]->extractors[p].shape);
+  }
+
+  std::vector<int> tile_shape(num_indices, 1);
+  const auto &hint = offloaded->tile_shape;
+  if (!hint.empty()) {
+    if (hint.size() != 1 && (int)hint.size() != num_indices) {
+      TI_WARN("Ignoring the tile size of a {}-D struct-for with {} dimensions",
+              num_indices, hint.size());
+      return {};
+    }
+    // Tiles must evenly divide the field.
+    for (int i = 0; i < num_indices; i++) {
+      tile_shape[i] = std::gcd(hint.size() == 1 ? hint[0] : hint[i], shape[i]);
+    }
+  } else if (config.struct_for_tile_size > 1) {
+    // Grows square-ish tiles of powers of two, starting from the innermost
+    // index.
+    int64 tile_size = 1;
+    bool grown = true;
+    while (grown) {
+      grown = false;
+      for (int i = num_indices - 1; i >= 0; i--) {
+        if (tile_size * 2 <= config.struct_for_tile_size &&
+            shape[i] % (tile_shape[i] * 2) == 0) {
+          tile_shape[i] *= 2;
+          tile_size *= 2;
+          grown = true;
+        }
+      }
+    }
+  } else {
+    return {};
+  }
+
+  // Tiles that span whole rows do not change the iteration order.
+  for (int i = 1; i < num_indices; i++) {
+    if (tile_shape[i] != shape[i]) {
+      return tile_shape;
+    }
+  }
+  return {};
+}
+
+// Computes the indices of a tiled loop from the linear loop index
+// |main_loop_var|, which first runs over a tile and then over the tiles.
+void generate_tiled_loop_vars(VecStatement *body_header,
+                              Stmt *main_loop_var,
+                              SNode *snode,
+                              const std::vector<int> &physical_indices,
+                              const std::vector<int> &tile_shape,
+                              std::vector<Stmt *> *new_loop_vars) {
+  std::vector<int> num_tiles;
+  int num_total_tiles = 1;
+  int tile_size = 1;
+  for (int i = 0; i < (int)physical_indices.size(); i++) {
+    num_tiles.push_back(snode->extractors[physical_indices[i]].shape /
+                        tile_shape[i]);
+    num_total_tiles *= num_tiles[i];
+    tile_size *= tile_shape[i];
+  }
+  auto *tile_id = generate_div(body_header, main_loop_var, tile_size);
+  auto *index_in_tile = generate_mod(body_header, main_loop_var, tile_size);
+  for (int i = 0; i < (int)physical_indices.size(); i++) {
+    num_total_tiles /= num_tiles[i];
+    tile_size /= tile_shape[i];
+    Stmt *tile_index = generate_div(body_header, tile_id, num_total_tiles);
+    Stmt *local_index = generate_div(body_header, index_in_tile, tile_size);
+    // The first extraction doesn't need a mod.
+    if (i != 0) {
+      tile_index = generate_mod(body_header, tile_index, num_tiles[i]);
+      local_index = generate_mod(body_header, local_index, tile_shape[i]);
+    }
+    auto *tile_edge =
+        body_header->push_back<ConstStmt>(TypedConstant(tile_shape[i]));
+    auto *corner = body_header->push_back<BinaryOpStmt>(BinaryOpType::mul,
+                                                        tile_index, tile_edge);
+    (*new_loop_vars)[i] = body_header->push_back<BinaryOpStmt>(
+        BinaryOpType::add, corner, local_index);
+  }
+}
+
+void convert_to_range_for(OffloadedStmt *offloaded,
+                          const CompileConfig &config) {
   TI_ASSERT(offloaded->task_type == TaskType::struct_for);
 
   std::vector<SNode *> snodes;
@@ -53,6 +155,14 @@ void convert_to_range_for(OffloadedStmt *offloaded) {
   auto main_loop_var = body_header.push_back<LoopIndexStmt>(nullptr, 0);
   // We will set main_loop_var->loop later.
 
+  const auto tile_shape =
+      get_tile_shape(offloaded, snodes, physical_indices, config);
+  if (!tile_shape.empty()) {
+    generate_tiled_loop_vars(&body_header, main_loop_var, snodes[0],
+                             physical_indices, tile_shape, &new_loop_vars);
+    snodes.clear();
+  }
+
   for (int i = 0; i < (int)snodes.size(); i++) {
     auto snode = snodes[i];
     Stmt *extracted = main_loop_var;
@@ -68,12 +178,17 @@ void convert_to_range_for(OffloadedStmt *offloaded) {
       if (!ext.active)
         continue;
       Stmt *index = extracted;
-      if (is_first_extraction) {  // first extraction doesn't need a mod
-        is_first_extraction = false;
+      if (snode->_morton) {
+        index = generate_morton_decode(&body_header, snode, p, index);
       } else {
-        index = generate_mod(&body_header, index, ext.acc_shape * ext.shape);
+        if (is_first_extraction) {  // first extraction doesn't need a mod
+          is_first_extraction = false;
+        } else {
+          index =
+              generate_mod(&body_header, index, ext.acc_shape * ext.shape);
+        }
+        index = generate_div(&body_header, index, ext.acc_shape);
       }
-      index = generate_div(&body_header, index, ext.acc_shape);
       total_shape[p] /= ext.shape;
       auto multiplier =
           body_header.push_back<ConstStmt>(TypedConstant(total_shape[p]));
@@ -111,10 +226,10 @@ void convert_to_range_for(OffloadedStmt *offloaded) {
   offloaded->task_type = TaskType::range_for;
 }
 
-void maybe_convert(OffloadedStmt *stmt) {
+void maybe_convert(OffloadedStmt *stmt, const CompileConfig &config) {
   if ((stmt->task_type == TaskType::struct_for) &&
       stmt->snode->is_path_all_dense) {
-    convert_to_range_for(stmt);
+    convert_to_range_for(stmt, config);
   }
 }
 
@@ -122,15 +237,15 @@ void maybe_convert(OffloadedStmt *stmt) {
 
 namespace irpass {
 
-void demote_dense_struct_fors(IRNode *root) {
+void demote_dense_struct_fors(IRNode *root, const CompileConfig &config) {
   if (auto *block = root->cast<Block>()) {
     for (auto &s_ : block->statements) {
       if (auto *s = s_->cast<OffloadedStmt>()) {
-        maybe_convert(s);
+        maybe_convert(s, config);
       }
     }
   } else if (auto *s = root->cast<OffloadedStmt>()) {
-    maybe_convert(s);
+    maybe_convert(s, config);
   }
   re_id(root);
 }
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+
+#include "taichi/ir/ir.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+
+namespace taichi::lang {
+
+namespace {
+
+using TaskType = OffloadedTaskType;
+
+enum class ResourceKind { snode, external_array, global_temporary };
+
+// External arrays are treated as a single resource, since different kernel
+// arguments may refer to the same array.
+using Resource = std::pair<ResourceKind, int64>;
+
+struct Access {
+  std::vector<Stmt *> indices;
+  bool is_written{false};
+};
+
+struct TaskAccesses {
+  std::map<Resource, std::vector<Access>> accesses;
+  // Whether the task has side effects that are not tracked by |accesses|.
+  bool has_unknown_side_effects{false};
+
+  bool writes(const Resource &resource) const {
+    auto iter = accesses.find(resource);
+    if (iter == accesses.end()) {
+      return false;
+    }
+    return std::any_of(iter->second.begin(), iter->second.end(),
+                       [](const Access &access) { return access.is_written; });
+  }
+
+  bool accesses_resource(const Resource &resource) const {
+    return accesses.count(resource) > 0;
+  }
+};
+
+TaskAccesses gather_task_accesses(OffloadedStmt *task) {
+  TaskAccesses result;
+  auto add_access = [&](Stmt *ptr, bool is_written) {
+    Access access;
+    access.is_written = is_written;
+    Stmt *offset = nullptr;
+    if (auto *matrix_ptr = ptr->cast<MatrixPtrStmt>()) {
+      offset = matrix_ptr->offset;
+      ptr = matrix_ptr->origin;
+    }
+    if (ptr->is<AllocaStmt>()) {
+      return;
+    }
+    Resource resource;
+    if (auto *global_ptr = ptr->cast<GlobalPtrStmt>()) {
+      // Accessing sparse SNodes may activate (and race on) their ancestors.
+      if (!global_ptr->snode->is_path_all_dense) {
+        result.has_unknown_side_effects = true;
+        return;
+      }
+      resource = {ResourceKind::snode, global_ptr->snode->id};
+      access.indices = global_ptr->indices;
+    } else if (auto *external_ptr = ptr->cast<ExternalPtrStmt>()) {
+      resource = {ResourceKind::external_array, 0};
+      access.indices = external_ptr->indices;
+    } else if (auto *global_tmp = ptr->cast<GlobalTemporaryStmt>()) {
+      resource = {ResourceKind::global_temporary, (int64)global_tmp->offset};
+    } else {
+      result.has_unknown_side_effects = true;
+      return;
+    }
+    if (offset) {
+      access.indices.push_back(offset);
+    }
+    result.accesses[resource].push_back(std::move(access));
+  };
+
+  irpass::analysis::gather_statements(task->body.get(), [&](Stmt *stmt) {
+    if (auto *load = stmt->cast<GlobalLoadStmt>()) {
+      add_access(load->src, /*is_written=*/false);
+    } else if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+      add_access(store->dest, /*is_written=*/true);
+    } else if (auto *atomic = stmt->cast<AtomicOpStmt>()) {
+      add_access(atomic->dest, /*is_written=*/true);
+    } else if (stmt->is<SNodeOpStmt>() || stmt->is<ExternalFuncCallStmt>() ||
+               stmt->is<FuncCallStmt>() || stmt->is<ReturnStmt>()) {
+      result.has_unknown_side_effects = true;
+    }
+    return false;
+  });
+  return result;
+}
+
+// Whether |a| and |b| compute the same value from the loop indices of the
+// tasks in |loops|.
+bool same_index(Stmt *a, Stmt *b, const std::vector<Stmt *> &loops) {
+  if (a == b) {
+    return true;
+  }
+  if (a->ret_type != b->ret_type) {
+    return false;
+  }
+  auto is_fused_loop = [&](Stmt *loop) {
+    return std::find(loops.begin(), loops.end(), loop) != loops.end();
+  };
+  if (auto *index_a = a->cast<LoopIndexStmt>()) {
+    auto *index_b = b->cast<LoopIndexStmt>();
+    return index_b && index_a->index == index_b->index &&
+           is_fused_loop(index_a->loop) && is_fused_loop(index_b->loop);
+  }
+  if (auto *const_a = a->cast<ConstStmt>()) {
+    auto *const_b = b->cast<ConstStmt>();
+    return const_b && const_a->val.equal_type_and_value(const_b->val);
+  }
+  if (auto *unary_a = a->cast<UnaryOpStmt>()) {
+    auto *unary_b = b->cast<UnaryOpStmt>();
+    return unary_b && unary_a->op_type == unary_b->op_type &&
+           unary_a->cast_type == unary_b->cast_type &&
+           same_index(unary_a->operand, unary_b->operand, loops);
+  }
+  if (auto *binary_a = a->cast<BinaryOpStmt>()) {
+    auto *binary_b = b->cast<BinaryOpStmt>();
+    return binary_b && binary_a->op_type == binary_b->op_type &&
+           same_index(binary_a->lhs, binary_b->lhs, loops) &&
+           same_index(binary_a->rhs, binary_b->rhs, loops);
+  }
+  return false;
+}
+
+std::optional<int64> get_positive_constant(Stmt *stmt) {
+  if (auto *const_stmt = stmt->cast<ConstStmt>()) {
+    if (is_integral(const_stmt->val.dt)) {
+      auto value = const_stmt->val.val_as_int64();
+      if (value > 0) {
+        return value;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// A digit of the loop index, i.e. (index / divisor) % modulus. A modulus of
+// 0 stands for no modulo.
+struct Digit {
+  int64 divisor{1};
+  int64 modulus{0};
+};
+
+std::optional<Digit> get_digit(Stmt *stmt, const std::vector<Stmt *> &loops) {
+  if (auto *index = stmt->cast<LoopIndexStmt>()) {
+    if (index->index == 0 && std::find(loops.begin(), loops.end(),
+                                       index->loop) != loops.end()) {
+      return Digit{};
+    }
+    return std::nullopt;
+  }
+  auto *binary = stmt->cast<BinaryOpStmt>();
+  if (!binary) {
+    return std::nullopt;
+  }
+  auto divide = [](Digit digit, int64 c) -> std::optional<Digit> {
+    if (digit.modulus != 0 && digit.modulus % c != 0) {
+      return std::nullopt;
+    }
+    if (digit.divisor > std::numeric_limits<int32>::max() ||
+        c > std::numeric_limits<int32>::max()) {
+      return std::nullopt;
+    }
+    return Digit{digit.divisor * c, digit.modulus / c};
+  };
+  auto modulo = [](Digit digit, int64 c) -> std::optional<Digit> {
+    if (digit.modulus != 0 && digit.modulus % c != 0) {
+      return std::nullopt;
+    }
+    return Digit{digit.divisor, c};
+  };
+  auto c = get_positive_constant(binary->rhs);
+  if (c && (binary->op_type == BinaryOpType::div ||
+            binary->op_type == BinaryOpType::floordiv)) {
+    auto digit = get_digit(binary->lhs, loops);
+    return digit ? divide(*digit, *c) : std::nullopt;
+  }
+  if (c && binary->op_type == BinaryOpType::mod) {
+    auto digit = get_digit(binary->lhs, loops);
+    return digit ? modulo(*digit, *c) : std::nullopt;
+  }
+  // Divisions and modulos by powers of two, see generate_div() and
+  // generate_mod().
+  if (binary->op_type == BinaryOpType::bit_shr) {
+    auto *shift = binary->rhs->cast<ConstStmt>();
+    if (!shift || !is_integral(shift->val.dt) ||
+        shift->val.val_as_int64() < 0 || shift->val.val_as_int64() >= 31) {
+      return std::nullopt;
+    }
+    auto digit = get_digit(binary->lhs, loops);
+    return digit ? divide(*digit, int64(1) << shift->val.val_as_int64())
+                 : std::nullopt;
+  }
+  if (c && binary->op_type == BinaryOpType::bit_and &&
+      bit::is_power_of_two(*c + 1)) {
+    auto digit = get_digit(binary->lhs, loops);
+    return digit ? modulo(*digit, *c + 1) : std::nullopt;
+  }
+  // The frontend lowers the indices of ndrange-fors to x - (x / c) * c.
+  if (binary->op_type == BinaryOpType::sub) {
+    auto *mul = binary->rhs->cast<BinaryOpStmt>();
+    if (!mul || mul->op_type != BinaryOpType::mul) {
+      return std::nullopt;
+    }
+    for (auto [quotient, multiplier] :
+         {std::pair{mul->lhs, mul->rhs}, std::pair{mul->rhs, mul->lhs}}) {
+      auto *div = quotient->cast<BinaryOpStmt>();
+      auto m = get_positive_constant(multiplier);
+      if (div && m &&
+          (div->op_type == BinaryOpType::div ||
+           div->op_type == BinaryOpType::floordiv) &&
+          get_positive_constant(div->rhs) == m &&
+          same_index(div->lhs, binary->lhs, loops)) {
+        auto digit = get_digit(binary->lhs, loops);
+        return digit ? modulo(*digit, *m) : std::nullopt;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// Strips the operations that do not affect whether |stmt| is an injective
+// function of the loop index.
+Stmt *strip_injective_ops(Stmt *stmt) {
+  while (true) {
+    if (auto *unary = stmt->cast<UnaryOpStmt>()) {
+      if (unary->op_type == UnaryOpType::cast_value &&
+          is_integral(unary->cast_type) &&
+          is_integral(unary->operand->ret_type) &&
+          data_type_bits(unary->cast_type) >=
+              data_type_bits(unary->operand->ret_type)) {
+        stmt = unary->operand;
+        continue;
+      }
+    }
+    if (auto *binary = stmt->cast<BinaryOpStmt>()) {
+      // x + c, c + x, x - c, x * c and c * x with a positive c.
+      const auto op = binary->op_type;
+      const bool is_shift = op == BinaryOpType::add || op == BinaryOpType::sub;
+      const bool is_scale = op == BinaryOpType::mul;
+      auto is_operand_ok = [&](Stmt *operand) {
+        return is_shift ? operand->is<ConstStmt>()
+                        : get_positive_constant(operand).has_value();
+      };
+      if ((is_shift || is_scale) && is_operand_ok(binary->rhs)) {
+        stmt = binary->lhs;
+        continue;
+      }
+      if ((op == BinaryOpType::add || is_scale) && is_operand_ok(binary->lhs)) {
+        stmt = binary->rhs;
+        continue;
+      }
+    }
+    return stmt;
+  }
+}
+
+// Whether different iterations of the loop never access the same element
+// through |indices|, i.e. the digits of the loop index extracted by the
+// indices add up to the whole index.
+bool is_injective(const std::vector<Stmt *> &indices,
+                  const std::vector<Stmt *> &loops) {
+  std::vector<Digit> digits;
+  for (auto *index : indices) {
+    if (auto digit = get_digit(strip_injective_ops(index), loops)) {
+      digits.push_back(*digit);
+    }
+  }
+  int64 covered = 1;
+  for (std::size_t i = 0; i <= digits.size(); i++) {
+    std::optional<Digit> next;
+    for (const auto &digit : digits) {
+      if (digit.divisor != covered) {
+        continue;
+      }
+      if (digit.modulus == 0) {
+        return true;
+      }
+      if (!next || digit.modulus > next->modulus) {
+        next = digit;
+      }
+    }
+    if (!next || covered > std::numeric_limits<int32>::max() ||
+        next->modulus > std::numeric_limits<int32>::max()) {
+      return false;
+    }
+    covered *= next->modulus;
+  }
+  return false;
+}
+
+bool has_continue_of(OffloadedStmt *task) {
+  return !irpass::analysis::gather_statements(task->body.get(), [&](Stmt *s) {
+            auto *continue_stmt = s->cast<ContinueStmt>();
+            return continue_stmt && continue_stmt->scope == task;
+          }).empty();
+}
+
+bool same_iteration_space(OffloadedStmt *a, OffloadedStmt *b) {
+  auto is_plain_range_for = [](OffloadedStmt *task) {
+    return task->task_type == TaskType::range_for && task->const_begin &&
+           task->const_end && task->begin_value >= 0 && !task->reversed &&
+           !task->is_bit_vectorized && !task->tls_prologue &&
+           !task->bls_prologue && !task->bls_epilogue && !task->tls_epilogue;
+  };
+  return is_plain_range_for(a) && is_plain_range_for(b) &&
+         a->begin_value == b->begin_value && a->end_value == b->end_value &&
+         a->index_type == b->index_type && a->block_dim == b->block_dim &&
+         a->grid_dim == b->grid_dim &&
+         a->num_cpu_threads == b->num_cpu_threads;
+}
+
+// Whether every iteration of |b| only depends on the same iteration of |a|,
+// so that |b| can run right after each iteration of |a|.
+bool can_fuse(OffloadedStmt *a, OffloadedStmt *b) {
+  if (!same_iteration_space(a, b) || has_continue_of(a)) {
+    return false;
+  }
+  auto accesses_a = gather_task_accesses(a);
+  auto accesses_b = gather_task_accesses(b);
+  if (accesses_a.has_unknown_side_effects ||
+      accesses_b.has_unknown_side_effects) {
+    return false;
+  }
+  const std::vector<Stmt *> loops = {a, b};
+  for (const auto &[resource, resource_accesses] : accesses_a.accesses) {
+    if (!accesses_b.accesses_resource(resource)) {
+      continue;
+    }
+    if (!accesses_a.writes(resource) && !accesses_b.writes(resource)) {
+      continue;
+    }
+    // All the accesses must hit the element of the current iteration.
+    const auto &indices = resource_accesses.front().indices;
+    if (!is_injective(indices, loops)) {
+      return false;
+    }
+    for (const auto *task_accesses : {&accesses_a, &accesses_b}) {
+      for (const auto &access : task_accesses->accesses.at(resource)) {
+        if (access.indices.size() != indices.size()) {
+          return false;
+        }
+        for (std::size_t i = 0; i < indices.size(); i++) {
+          if (!same_index(access.indices[i], indices[i], loops)) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Appends the body of |b| to the body of |a|.
+void fuse(OffloadedStmt *a, OffloadedStmt *b) {
+  irpass::analysis::gather_statements(b->body.get(), [&](Stmt *stmt) {
+    if (auto *index = stmt->cast<LoopIndexStmt>()) {
+      if (index->loop == b) {
+        index->loop = a;
+      }
+    } else if (auto *linear_index = stmt->cast<LoopLinearIndexStmt>()) {
+      if (linear_index->loop == b) {
+        linear_index->loop = a;
+      }
+    } else if (auto *continue_stmt = stmt->cast<ContinueStmt>()) {
+      if (continue_stmt->scope == b) {
+        continue_stmt->scope = a;
+      }
+    }
+    return false;
+  });
+  for (auto &stmt : b->body->statements) {
+    a->body->insert(std::move(stmt));
+  }
+  b->body->statements.clear();
+}
+
+}  // namespace
+
+namespace irpass {
+
+// Fuses adjacent range-for tasks that have the same iteration space, and
+// whose iterations only depend on the same iteration of the previous task.
+// Intermediate values then stay in registers instead of global memory.
+bool fuse_offloads(IRNode *root) {
+  auto *block = root->cast<Block>();
+  if (!block) {
+    return false;
+  }
+  bool modified = false;
+  OffloadedStmt *prev = nullptr;
+  for (int i = 0; i < (int)block->statements.size();) {
+    auto *task = block->statements[i]->cast<OffloadedStmt>();
+    if (prev && task && can_fuse(prev, task)) {
+      fuse(prev, task);
+      block->erase(i);
+      modified = true;
+      continue;
+    }
+    prev = task;
+    i++;
+  }
+  if (modified) {
+    re_id(root);
+  }
+  return modified;
+}
+
+}  // namespace irpass
+
+}  // namespace taichi::lang
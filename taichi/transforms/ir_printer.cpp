@@ -626,6 +626,9 @@ class IRPrinter : public IRVisitor {
       details =
           fmt::format("range_for({}, {}) grid_dim={} block_dim={}", begin_str,
                       end_str, stmt->grid_dim, stmt->block_dim);
+      if (stmt->index_type != PrimitiveType::i32) {
+        details += fmt::format(" index_type={}", stmt->index_type.to_string());
+      }
     } else if (stmt->task_type == OffloadedTaskType::struct_for) {
       details =
           fmt::format("struct_for({}) grid_dim={} block_dim={} bls={}",
@@ -247,6 +247,9 @@ class LowerAST : public IRVisitor {
       }
       new_for->body->insert(std::move(new_statements), 0);
       new_for->mem_access_opt = stmt->mem_access_opt;
+      new_for->tile_shape = stmt->tile_shape;
+      new_for->sort_elements = stmt->sort_elements;
+      new_for->balance_elements = stmt->balance_elements;
       fctx.push_back(std::move(new_for));
     } else if (stmt->external_tensor) {
       int arg_id = -1;
@@ -327,10 +330,13 @@ class LowerAST : public IRVisitor {
         // transform into a structure as
         // i = begin - 1; while (1) { i += 1; if (i >= end) break; original
         // body; }
-        fctx.push_back<AllocaStmt>(PrimitiveType::i32);
+        const bool is_i64 = begin_stmt->ret_type == PrimitiveType::i64;
+        fctx.push_back<AllocaStmt>(is_i64 ? PrimitiveType::i64
+                                          : PrimitiveType::i32);
         auto loop_var = fctx.back_stmt();
         stmt->parent->local_var_to_stmt[stmt->loop_var_ids[0]] = loop_var;
-        auto const_one = fctx.push_back<ConstStmt>(TypedConstant((int32)1));
+        auto const_one = fctx.push_back<ConstStmt>(
+            is_i64 ? TypedConstant((int64)1) : TypedConstant((int32)1));
         auto begin_minus_one = fctx.push_back<BinaryOpStmt>(
             BinaryOpType::sub, begin_stmt, const_one);
         fctx.push_back<LocalStoreStmt>(loop_var, begin_minus_one);
@@ -0,0 +1,263 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/system/profiler.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// Outside of bit structs, each quantized element of an external array is
+// stored in its own unsigned integer container, see quant_storage_type().
+// Quant ints and quant fixeds keep their digits in the low bits. Quant floats
+// keep their digits (with the sign bit on top) in the low bits, followed by the
+// exponent.
+//
+// This pass rewrites the loads and stores of such elements into integer loads
+// and stores of the containers plus ordinary arithmetic converting from/to the
+// compute type, so no backend needs to know about quant types in ndarrays.
+class LowerQuantExternalAccess : public BasicStmtVisitor {
+ private:
+  using BasicStmtVisitor::visit;
+  DelayedIRModifier modifier_;
+
+  // Helper building a sequence of untyped statements. The types are inferred
+  // by the type_check() following this pass.
+  struct Builder {
+    VecStatement stmts;
+
+    Stmt *u32(uint32 x) {
+      return stmts.push_back<ConstStmt>(TypedConstant(x));
+    }
+
+    Stmt *i32(int32 x) {
+      return stmts.push_back<ConstStmt>(TypedConstant(x));
+    }
+
+    Stmt *cast(Stmt *x, DataType dt, bool bits = false) {
+      auto ret = stmts.push_back<UnaryOpStmt>(
+          bits ? UnaryOpType::cast_bits : UnaryOpType::cast_value, x);
+      ret->cast_type = dt;
+      return ret;
+    }
+
+    Stmt *op(BinaryOpType type, Stmt *x, Stmt *y) {
+      return stmts.push_back<BinaryOpStmt>(type, x, y);
+    }
+
+    Stmt *select(Stmt *cond, Stmt *x, Stmt *y) {
+      return stmts.push_back<TernaryOpStmt>(TernaryOpType::select, cond, x, y);
+    }
+
+    Stmt *mask(Stmt *x, int num_bits) {
+      return op(BinaryOpType::bit_and, x,
+                u32((uint32)((1ULL << num_bits) - 1)));
+    }
+
+    // Returns the integer held by the low most |qit->get_num_bits()| bits of
+    // the u32 |x|, as an i32 or u32.
+    Stmt *extract_int(Stmt *x, QuantIntType *qit) {
+      const int shift = 32 - qit->get_num_bits();
+      if (!qit->get_is_signed()) {
+        return shift ? mask(x, qit->get_num_bits()) : x;
+      }
+      x = cast(x, PrimitiveType::i32);
+      if (shift) {
+        x = op(BinaryOpType::bit_shl, x, i32(shift));
+        x = op(BinaryOpType::bit_sar, x, i32(shift));
+      }
+      return x;
+    }
+
+    // The inverse of extract_int(): returns |x| truncated to the low most
+    // |qit->get_num_bits()| bits of a u32.
+    Stmt *insert_int(Stmt *x, QuantIntType *qit) {
+      x = cast(x, PrimitiveType::u32);
+      return qit->get_num_bits() < 32 ? mask(x, qit->get_num_bits()) : x;
+    }
+
+    Stmt *decode(Stmt *bits, Type *type) {
+      bits = cast(bits, PrimitiveType::u32);
+      if (auto qit = type->cast<QuantIntType>()) {
+        return cast(extract_int(bits, qit), qit->get_compute_type());
+      } else if (auto qfxt = type->cast<QuantFixedType>()) {
+        // Compute float(digits) * scale
+        auto compute_type = qfxt->get_compute_type();
+        auto digits = cast(
+            extract_int(bits, qfxt->get_digits_type()->as<QuantIntType>()),
+            compute_type);
+        auto scale = stmts.push_back<ConstStmt>(
+            TypedConstant(compute_type, qfxt->get_scale()));
+        return op(BinaryOpType::mul, digits, scale);
+      }
+      auto qflt = type->as<QuantFloatType>();
+      const int digit_bits = qflt->get_digit_bits();
+      const int num_digits_bits =
+          qflt->get_digits_type()->as<QuantIntType>()->get_num_bits();
+      const int num_exponent_bits =
+          qflt->get_exponent_type()->as<QuantIntType>()->get_num_bits();
+      // f32 = 1 sign bit + 8 exponent bits + 23 fraction bits
+      auto digits = mask(bits, num_digits_bits);
+      auto exponent =
+          mask(op(BinaryOpType::bit_shr, bits, u32(num_digits_bits)),
+               num_exponent_bits);
+      Stmt *offset = u32(qflt->get_exponent_conversion_offset());
+      if (num_exponent_bits < 8) {
+        // Zeros are stored with a zero exponent.
+        auto non_zero = op(BinaryOpType::cmp_ne, exponent, u32(0));
+        offset = select(non_zero, offset, u32(0));
+      }
+      exponent = op(BinaryOpType::add, exponent, offset);
+      auto fraction = mask(
+          op(BinaryOpType::bit_shl, digits, u32(23 - digit_bits)), 23);
+      auto f32_bits =
+          op(BinaryOpType::bit_or,
+             op(BinaryOpType::bit_shl, exponent, u32(23)), fraction);
+      if (qflt->get_is_signed()) {
+        auto sign = op(BinaryOpType::bit_shr, digits, u32(digit_bits));
+        f32_bits = op(BinaryOpType::bit_or, f32_bits,
+                      op(BinaryOpType::bit_shl, sign, u32(31)));
+      }
+      return cast(f32_bits, PrimitiveType::f32, /*bits=*/true);
+    }
+
+    Stmt *encode(Stmt *val, Type *type, DataType storage_type) {
+      Stmt *bits = nullptr;
+      if (auto qit = type->cast<QuantIntType>()) {
+        bits = insert_int(val, qit);
+      } else if (auto qfxt = type->cast<QuantFixedType>()) {
+        // Compute int(round(val * (1.0 / scale)))
+        auto compute_type = qfxt->get_compute_type();
+        auto inv_scale = stmts.push_back<ConstStmt>(
+            TypedConstant(compute_type, 1.0 / qfxt->get_scale()));
+        auto scaled = op(BinaryOpType::mul, cast(val, compute_type), inv_scale);
+        auto qit = qfxt->get_digits_type()->as<QuantIntType>();
+        auto rounded = stmts.push_back<UnaryOpStmt>(UnaryOpType::round, scaled);
+        auto digits = cast(rounded, qit->get_is_signed() ? PrimitiveType::i32
+                                                         : PrimitiveType::u32);
+        bits = insert_int(digits, qit);
+      } else {
+        auto qflt = type->as<QuantFloatType>();
+        const int digit_bits = qflt->get_digit_bits();
+        const int num_digits_bits =
+            qflt->get_digits_type()->as<QuantIntType>()->get_num_bits();
+        const int num_exponent_bits =
+            qflt->get_exponent_type()->as<QuantIntType>()->get_num_bits();
+        auto f32_bits = cast(cast(val, PrimitiveType::f32), PrimitiveType::u32,
+                             /*bits=*/true);
+        auto rounded = f32_bits;
+        if (digit_bits < 23) {
+          // Rounding to nearest. If the digits overflow, the carry goes to
+          // the exponent, which is desired.
+          rounded =
+              op(BinaryOpType::add, f32_bits, u32(1 << (22 - digit_bits)));
+        }
+        auto exponent = cast(
+            mask(op(BinaryOpType::bit_shr, rounded, u32(23)), 8),
+            PrimitiveType::i32);
+        Stmt *digits = mask(
+            op(BinaryOpType::bit_shr, rounded, u32(23 - digit_bits)),
+            digit_bits);
+        if (qflt->get_is_signed()) {
+          auto sign = op(BinaryOpType::bit_shr, f32_bits, u32(31));
+          digits = op(BinaryOpType::bit_or, digits,
+                      op(BinaryOpType::bit_shl, sign, u32(digit_bits)));
+        }
+        // Values too large for the exponent saturate, and values too small
+        // for it are flushed to zero.
+        auto non_zero = op(BinaryOpType::cmp_ne, exponent, i32(0));
+        auto offset =
+            select(non_zero, i32(qflt->get_exponent_conversion_offset()),
+                   i32(0));
+        exponent = op(BinaryOpType::sub, exponent, offset);
+        exponent = op(BinaryOpType::max, exponent, i32(0));
+        exponent =
+            op(BinaryOpType::min, exponent, i32((1 << num_exponent_bits) - 1));
+        non_zero = op(BinaryOpType::cmp_ne, exponent, i32(0));
+        digits = select(non_zero, digits, u32(0));
+        bits = op(BinaryOpType::bit_or, digits,
+                  op(BinaryOpType::bit_shl, cast(exponent, PrimitiveType::u32),
+                     u32(num_digits_bits)));
+      }
+      return cast(bits, storage_type);
+    }
+  };
+
+  static Type *get_quant_pointee_type(Stmt *ptr) {
+    if (!ptr->is<ExternalPtrStmt>()) {
+      return nullptr;
+    }
+    auto pointee_type = ptr->ret_type.ptr_removed();
+    if (auto tensor_type = pointee_type->cast<TensorType>()) {
+      TI_ERROR_IF(is_quant(tensor_type->get_element_type()),
+                  "Accessing quantized ndarrays as a whole matrix requires "
+                  "real_matrix_scalarize=True");
+      return nullptr;
+    }
+    return is_quant(pointee_type) ? (Type *)pointee_type : nullptr;
+  }
+
+ public:
+  void visit(GlobalLoadStmt *stmt) override {
+    if (auto type = get_quant_pointee_type(stmt->src)) {
+      Builder builder;
+      auto bits = builder.stmts.push_back<GlobalLoadStmt>(stmt->src);
+      builder.decode(bits, type);
+      modifier_.replace_with(stmt, std::move(builder.stmts));
+    }
+  }
+
+  void visit(GlobalStoreStmt *stmt) override {
+    if (auto type = get_quant_pointee_type(stmt->dest)) {
+      Builder builder;
+      auto bits = builder.encode(stmt->val, type, quant_storage_type(type));
+      builder.stmts.push_back<GlobalStoreStmt>(stmt->dest, bits);
+      modifier_.replace_with(stmt, std::move(builder.stmts));
+    }
+  }
+
+  void visit(AtomicOpStmt *stmt) override {
+    TI_ERROR_IF(get_quant_pointee_type(stmt->dest) != nullptr,
+                "Atomic operations on quantized ndarrays are not supported\n{}",
+                stmt->tb);
+  }
+
+  void visit(ArgLoadStmt *stmt) override {
+    if (!stmt->is_ptr) {
+      return;
+    }
+    auto dt = stmt->ret_type.ptr_removed();
+    auto element_type = dt.get_element_type();
+    if (!is_quant(element_type)) {
+      return;
+    }
+    if (dt->is<TensorType>()) {
+      stmt->ret_type = TypeFactory::create_tensor_type(
+          dt.get_shape(), quant_storage_type(element_type));
+    } else {
+      stmt->ret_type = quant_storage_type(element_type);
+    }
+    stmt->ret_type.set_is_pointer(true);
+    modifier_.mark_as_modified();
+  }
+
+  static bool run(IRNode *node) {
+    LowerQuantExternalAccess pass;
+    node->accept(&pass);
+    return pass.modifier_.modify_ir();
+  }
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool lower_quant_external_access(IRNode *root) {
+  TI_AUTO_PROF;
+  return LowerQuantExternalAccess::run(root);
+}
+
+}  // namespace irpass
+
+}  // namespace taichi::lang
@@ -5,13 +5,217 @@
 #include "taichi/ir/scratch_pad.h"
 #include "taichi/transforms/make_block_local.h"
 
+#include <limits>
+#include <map>
+
 namespace taichi::lang {
 
 namespace {
 
+// The elements of an ndarray that a range-for reads at block-relative offsets
+// [low, high) of its loop index, through the first index of the ndarray. The
+// other indices of these reads are the same constants.
+struct NdarrayPad {
+  Stmt *base_ptr{nullptr};
+  std::vector<int> other_indices;
+  std::vector<ExternalPtrStmt *> ptrs;
+  int low{std::numeric_limits<int>::max()};
+  int high{std::numeric_limits<int>::min()};
+};
+
+// Stages the ndarray elements that a range-for reads at several offsets of its
+// loop index (e.g. a 1-D stencil) in shared memory. Each block of threads then
+// fetches the elements of its block_dim consecutive iterations once, instead
+// of every thread reading its neighbors from global memory.
+void make_block_local_range_for(OffloadedStmt *offload,
+                                const CompileConfig &config) {
+  // The codegen of block-local range-fors is only implemented on CUDA.
+  if (!config.make_ndarray_block_local || config.arch != Arch::cuda ||
+      offload->bls_prologue ||
+      offload->index_type != PrimitiveType::i32 || offload->block_dim <= 0) {
+    return;
+  }
+
+  // Ndarrays that are written, or accessed in any way other than by scalar
+  // loads, are not staged.
+  std::unordered_set<int> excluded_args;
+  std::vector<ExternalPtrStmt *> loaded_ptrs;
+  auto exclude = [&](Stmt *ptr) {
+    if (auto *matrix_ptr = ptr->cast<MatrixPtrStmt>()) {
+      ptr = matrix_ptr->origin;
+    }
+    if (auto *external_ptr = ptr->cast<ExternalPtrStmt>()) {
+      if (auto *arg = external_ptr->base_ptr->cast<ArgLoadStmt>()) {
+        excluded_args.insert(arg->arg_id);
+      }
+    }
+  };
+  irpass::analysis::gather_statements(offload->body.get(), [&](Stmt *stmt) {
+    if (auto *load = stmt->cast<GlobalLoadStmt>()) {
+      if (auto *external_ptr = load->src->cast<ExternalPtrStmt>()) {
+        loaded_ptrs.push_back(external_ptr);
+      } else {
+        exclude(load->src);
+      }
+    } else if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+      exclude(store->dest);
+    } else if (auto *atomic = stmt->cast<AtomicOpStmt>()) {
+      exclude(atomic->dest);
+    } else if (auto *matrix_ptr = stmt->cast<MatrixPtrStmt>()) {
+      exclude(matrix_ptr);
+    }
+    return false;
+  });
+
+  std::map<std::pair<int, std::vector<int>>, NdarrayPad> pads;
+  for (auto *ptr : loaded_ptrs) {
+    auto *base_ptr = ptr->base_ptr->cast<ArgLoadStmt>();
+    // In SOA layouts the element indices come first.
+    if (!base_ptr || excluded_args.count(base_ptr->arg_id) ||
+        ptr->indices.empty() || ptr->element_dim > 0) {
+      continue;
+    }
+    std::vector<int> other_indices;
+    bool constant_other_indices = true;
+    for (int i = 1; i < (int)ptr->indices.size(); i++) {
+      auto *index = ptr->indices[i]->cast<ConstStmt>();
+      if (!index) {
+        constant_other_indices = false;
+        break;
+      }
+      other_indices.push_back((int)index->val.val_as_int64());
+    }
+    auto diff = irpass::analysis::value_diff_loop_index(ptr->indices[0],
+                                                        offload, /*index=*/0);
+    if (!constant_other_indices || !diff.related() || diff.coeff != 1) {
+      excluded_args.insert(base_ptr->arg_id);
+      continue;
+    }
+    auto &pad = pads[{base_ptr->arg_id, other_indices}];
+    pad.base_ptr = base_ptr;
+    pad.other_indices = other_indices;
+    pad.ptrs.push_back(ptr);
+    pad.low = std::min(pad.low, diff.low);
+    pad.high = std::max(pad.high, diff.high);
+  }
+
+  // Generous enough for any CUDA device, see create_bls_buffer().
+  constexpr std::size_t kMaxBLSSize = 48 << 10;
+  const int block_dim = offload->block_dim;
+  std::size_t bls_offset_in_bytes = 0;
+  for (auto &[key, pad] : pads) {
+    if (excluded_args.count(key.first) || pad.high - pad.low < 2) {
+      // Nothing to share between the threads.
+      continue;
+    }
+    auto data_type = pad.ptrs[0]->ret_type.ptr_removed();
+    const auto dtype_size = data_type_size(data_type);
+    const int bls_num_elements = block_dim + (pad.high - pad.low) - 1;
+    bls_offset_in_bytes +=
+        (dtype_size - bls_offset_in_bytes % dtype_size) % dtype_size;
+    if (bls_offset_in_bytes + dtype_size * bls_num_elements > kMaxBLSSize) {
+      break;
+    }
+    auto *element_ptr_type =
+        TypeFactory::get_instance().get_pointer_type(data_type);
+
+    // Step 1: fetch [block_corner + low, block_corner + block_dim - 1 + high)
+    // into the BLS buffer. Out-of-bound elements are never read by the body.
+    if (!offload->bls_prologue) {
+      offload->bls_prologue = std::make_unique<Block>();
+      offload->bls_prologue->parent_stmt = offload;
+    }
+    auto *block = offload->bls_prologue.get();
+    auto *thread_idx = block->push_back<LoopLinearIndexStmt>(offload);
+    auto *block_corner = block->push_back<BlockCornerIndexStmt>(offload, 0);
+    auto *shape = block->push_back<ExternalTensorShapeAlongAxisStmt>(
+        /*axis=*/0, key.first);
+    for (int loop_offset = 0; loop_offset < bls_num_elements;
+         loop_offset += block_dim) {
+      auto *bls_element_id = block->push_back<BinaryOpStmt>(
+          BinaryOpType::add, thread_idx,
+          block->push_back<ConstStmt>(TypedConstant(loop_offset)));
+      auto *global_index = block->push_back<BinaryOpStmt>(
+          BinaryOpType::add, bls_element_id, block_corner);
+      global_index = block->push_back<BinaryOpStmt>(
+          BinaryOpType::add, global_index,
+          block->push_back<ConstStmt>(TypedConstant(pad.low)));
+      Stmt *cond = block->push_back<BinaryOpStmt>(
+          BinaryOpType::bit_and,
+          block->push_back<BinaryOpStmt>(
+              BinaryOpType::cmp_ge, global_index,
+              block->push_back<ConstStmt>(TypedConstant(0))),
+          block->push_back<BinaryOpStmt>(BinaryOpType::cmp_lt, global_index,
+                                         shape));
+      if (loop_offset + block_dim > bls_num_elements) {
+        cond = block->push_back<BinaryOpStmt>(
+            BinaryOpType::bit_and, cond,
+            block->push_back<BinaryOpStmt>(
+                BinaryOpType::cmp_lt, bls_element_id,
+                block->push_back<ConstStmt>(TypedConstant(bls_num_elements))));
+      }
+      auto *if_stmt = block->push_back<IfStmt>(cond)->as<IfStmt>();
+      if_stmt->set_true_statements(std::make_unique<Block>());
+      auto *element_block = if_stmt->true_statements.get();
+
+      auto *base_ptr = element_block->insert(pad.base_ptr->clone());
+      std::vector<Stmt *> indices{global_index};
+      for (auto index : pad.other_indices) {
+        indices.push_back(
+            element_block->push_back<ConstStmt>(TypedConstant(index)));
+      }
+      auto *global_ptr = element_block->push_back<ExternalPtrStmt>(
+          base_ptr, indices, pad.ptrs[0]->element_shape,
+          pad.ptrs[0]->element_dim);
+      auto *value = element_block->push_back<GlobalLoadStmt>(global_ptr);
+      auto *bls_element_offset_bytes = element_block->push_back<BinaryOpStmt>(
+          BinaryOpType::add,
+          element_block->push_back<BinaryOpStmt>(
+              BinaryOpType::mul, bls_element_id,
+              element_block->push_back<ConstStmt>(
+                  TypedConstant((int32)dtype_size))),
+          element_block->push_back<ConstStmt>(
+              TypedConstant((int32)bls_offset_in_bytes)));
+      auto *bls_ptr = element_block->push_back<BlockLocalPtrStmt>(
+          bls_element_offset_bytes, element_ptr_type);
+      element_block->push_back<GlobalStoreStmt>(bls_ptr, value);
+    }
+
+    // Step 2: make the loop body load from BLS instead of the ndarray.
+    for (auto *ptr : pad.ptrs) {
+      VecStatement bls;
+      auto *inc = bls.push_back<BinaryOpStmt>(
+          BinaryOpType::sub, ptr->indices[0],
+          bls.push_back<BlockCornerIndexStmt>(offload, 0));
+      inc = bls.push_back<BinaryOpStmt>(
+          BinaryOpType::sub, inc,
+          bls.push_back<ConstStmt>(TypedConstant(pad.low)));
+      auto *bls_element_offset_bytes = bls.push_back<BinaryOpStmt>(
+          BinaryOpType::add,
+          bls.push_back<BinaryOpStmt>(
+              BinaryOpType::mul, inc,
+              bls.push_back<ConstStmt>(TypedConstant((int32)dtype_size))),
+          bls.push_back<ConstStmt>(TypedConstant((int32)bls_offset_in_bytes)));
+      bls.push_back<BlockLocalPtrStmt>(bls_element_offset_bytes,
+                                       element_ptr_type);
+      ptr->replace_with(std::move(bls));
+    }
+
+    bls_offset_in_bytes += dtype_size * bls_num_elements;
+  }
+
+  if (offload->bls_prologue) {
+    offload->bls_size = std::max(std::size_t(1), bls_offset_in_bytes);
+  }
+}
+
 void make_block_local_offload(OffloadedStmt *offload,
                               const CompileConfig &config,
                               const std::string &kernel_name) {
+  if (offload->task_type == OffloadedStmt::TaskType::range_for) {
+    make_block_local_range_for(offload, config);
+    return;
+  }
   if (offload->task_type != OffloadedStmt::TaskType::struct_for)
     return;
 
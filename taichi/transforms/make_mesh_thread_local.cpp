@@ -46,6 +46,7 @@ void make_mesh_thread_local_offload(OffloadedStmt *offload,
   auto make_thread_local_store =
       [&](mesh::MeshElementType element_type,
           const std::unordered_map<mesh::MeshElementType, SNode *> &offset_,
+          const std::unordered_map<mesh::MeshElementType, SNode *> &num_,
           std::unordered_map<mesh::MeshElementType, Stmt *> &offset_local,
           std::unordered_map<mesh::MeshElementType, Stmt *> &num_local) {
         const auto offset_tls_offset =
@@ -75,16 +76,28 @@ void make_mesh_thread_local_offload(OffloadedStmt *offload,
               -1);
           auto offset_load = offload->tls_prologue->insert(
               std::make_unique<GlobalLoadStmt>(offset_globalptr), -1);
-          auto offset_1_globalptr = offload->tls_prologue->insert(
-              std::make_unique<GlobalPtrStmt>(offset_snode->second,
-                                              std::vector<Stmt *>{patch_idx_1}),
-              -1);
-          auto offset_1_load = offload->tls_prologue->insert(
-              std::make_unique<GlobalLoadStmt>(offset_1_globalptr), -1);
-          auto num_load = offload->tls_prologue->insert(
-              std::make_unique<BinaryOpStmt>(BinaryOpType::sub, offset_1_load,
-                                             offset_load),
-              -1);
+          Stmt *num_load = nullptr;
+          if (const auto num_snode = num_.find(element_type);
+              num_snode != num_.end()) {
+            // Patches of dynamic meshes leave room between their offsets.
+            auto num_globalptr = offload->tls_prologue->insert(
+                std::make_unique<GlobalPtrStmt>(num_snode->second,
+                                                std::vector<Stmt *>{patch_idx}),
+                -1);
+            num_load = offload->tls_prologue->insert(
+                std::make_unique<GlobalLoadStmt>(num_globalptr), -1);
+          } else {
+            auto offset_1_globalptr = offload->tls_prologue->insert(
+                std::make_unique<GlobalPtrStmt>(
+                    offset_snode->second, std::vector<Stmt *>{patch_idx_1}),
+                -1);
+            auto offset_1_load = offload->tls_prologue->insert(
+                std::make_unique<GlobalLoadStmt>(offset_1_globalptr), -1);
+            num_load = offload->tls_prologue->insert(
+                std::make_unique<BinaryOpStmt>(BinaryOpType::sub,
+                                               offset_1_load, offset_load),
+                -1);
+          }
 
           // TODO: do not use GlobalStore for TLS ptr.
           offload->tls_prologue->push_back<GlobalStoreStmt>(offset_ptr,
@@ -120,12 +133,14 @@ void make_mesh_thread_local_offload(OffloadedStmt *offload,
 
   for (auto element_type : accessed.first) {
     make_thread_local_store(element_type, offload->mesh->owned_offset,
+                            offload->mesh->owned_num,
                             offload->owned_offset_local,
                             offload->owned_num_local);
   }
 
   for (auto element_type : accessed.second) {
     make_thread_local_store(element_type, offload->mesh->total_offset,
+                            offload->mesh->total_num,
                             offload->total_offset_local,
                             offload->total_num_local);
   }
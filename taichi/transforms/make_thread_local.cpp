@@ -96,6 +96,34 @@ std::vector<std::pair<T *, AtomicOpType>> find_global_reduction_destinations(
   return valid_reduction_values;
 }
 
+// Whether |stmt| has the same value in all the iterations of an offloaded
+// loop, and can be recomputed in its TLS epilogue.
+bool is_loop_invariant_index(Stmt *stmt) {
+  if (stmt->is<ConstStmt>()) {
+    return true;
+  }
+  if (auto arg = stmt->cast<ArgLoadStmt>()) {
+    return !arg->is_ptr && arg->ret_type->is<PrimitiveType>();
+  }
+  if (auto unary = stmt->cast<UnaryOpStmt>()) {
+    return is_loop_invariant_index(unary->operand);
+  }
+  if (auto binary = stmt->cast<BinaryOpStmt>()) {
+    return is_loop_invariant_index(binary->lhs) &&
+           is_loop_invariant_index(binary->rhs);
+  }
+  return false;
+}
+
+// Recomputes a loop-invariant |stmt| at the end of |block|.
+Stmt *clone_loop_invariant_stmt(Stmt *stmt, Block *block) {
+  auto cloned = stmt->clone();
+  for (int i = 0; i < stmt->num_operands(); i++) {
+    cloned->set_operand(i, clone_loop_invariant_stmt(stmt->operand(i), block));
+  }
+  return block->insert(std::move(cloned), -1);
+}
+
 void make_thread_local_offload(OffloadedStmt *offload) {
   if (offload->task_type != OffloadedTaskType::range_for &&
       offload->task_type != OffloadedTaskType::struct_for)
@@ -105,11 +133,14 @@ void make_thread_local_offload(OffloadedStmt *offload) {
   {
     auto valid_global_ptrs = find_global_reduction_destinations<GlobalPtrStmt>(
         offload, [](GlobalPtrStmt *dest) {
-          // We can only optimized reductions to global ptrs with form like
-          // loss[None] (0-D fields) for now.
+          // We can only optimize reductions to global ptrs with the same
+          // indices in all iterations, like loss[None] or the gradients of
+          // w[0], w[i0] with a scalar argument i0, etc.
           // No TLS on quant types.
           return (dest->snode->type == SNodeType::place) &&
-                 dest->indices.empty() && dest->snode->dt->is<PrimitiveType>();
+                 std::all_of(dest->indices.begin(), dest->indices.end(),
+                             is_loop_invariant_index) &&
+                 dest->snode->dt->is<PrimitiveType>();
         });
     auto valid_global_tmps =
         find_global_reduction_destinations<GlobalTemporaryStmt>(
@@ -174,10 +205,16 @@ void make_thread_local_offload(OffloadedStmt *offload) {
           tls_offset, TypeFactory::get_instance().get_pointer_type(data_type));
       // TODO: do not use global load from TLS.
       auto tls_load = offload->tls_epilogue->push_back<GlobalLoadStmt>(tls_ptr);
-      auto global_ptr = offload->tls_epilogue->insert(
-          std::unique_ptr<Stmt>(
-              (Stmt *)irpass::analysis::clone(dest.first).release()),
-          -1);
+      // The indices are recomputed since the epilogue cannot refer to the
+      // statements of the loop body.
+      auto cloned_ptr = dest.first->clone();
+      for (int i = 0; i < dest.first->num_operands(); i++) {
+        cloned_ptr->set_operand(
+            i, clone_loop_invariant_stmt(dest.first->operand(i),
+                                         offload->tls_epilogue.get()));
+      }
+      auto global_ptr =
+          offload->tls_epilogue->insert(std::move(cloned_ptr), -1);
       offload->tls_epilogue->insert(
           AtomicOpStmt::make_for_reduction(dest.second, global_ptr, tls_load),
           -1);
@@ -100,9 +100,10 @@ class Offloader {
         } else {
           offloaded->block_dim = s->block_dim;
         }
+        offloaded->index_type = s->begin->ret_type;
         if (auto val = s->begin->cast<ConstStmt>()) {
           offloaded->const_begin = true;
-          offloaded->begin_value = val->val.val_int32();
+          offloaded->begin_value = val->val.val_int();
         } else {
           offloaded_ranges.begin_stmts.insert(
               std::make_pair(offloaded.get(), s->begin));
@@ -110,7 +111,7 @@ class Offloader {
 
         if (auto val = s->end->cast<ConstStmt>()) {
           offloaded->const_end = true;
-          offloaded->end_value = val->val.val_int32();
+          offloaded->end_value = val->val.val_int();
         } else {
           if ((arch == Arch::opengl || arch == Arch::vulkan ||
                arch == Arch::gles) &&
@@ -208,6 +209,7 @@ class Offloader {
         auto offloaded_listgen = Stmt::make_typed<OffloadedStmt>(
             OffloadedStmt::TaskType::listgen, arch);
         offloaded_listgen->snode = snode_child;
+        offloaded_listgen->sort_elements = for_stmt->sort_elements;
         offloaded_listgen->grid_dim = config.saturating_grid_dim;
         offloaded_listgen->block_dim =
             std::min(snode_child->max_num_elements(),
@@ -253,6 +255,8 @@ class Offloader {
     offloaded_struct_for->num_cpu_threads =
         std::min(for_stmt->num_cpu_threads, config.cpu_max_num_threads);
     offloaded_struct_for->mem_access_opt = mem_access_opt;
+    offloaded_struct_for->tile_shape = for_stmt->tile_shape;
+    offloaded_struct_for->balance_elements = for_stmt->balance_elements;
 
     root_block->insert(std::move(offloaded_struct_for));
   }
@@ -63,41 +63,56 @@ class MergeBitStructStores : public BasicStmtVisitor {
     std::unordered_map<Stmt *, std::vector<BitStructStoreStmt *>>
         ptr_to_bit_struct_stores;
     std::vector<Stmt *> statements_to_delete;
+    auto merge_stores = [&](Stmt *ptr,
+                            const std::vector<BitStructStoreStmt *> &stores) {
+      if (stores.size() == 1)
+        return;
+      std::map<int, Stmt *> values;
+      for (auto s : stores) {
+        for (int j = 0; j < (int)s->ch_ids.size(); j++) {
+          values[s->ch_ids[j]] = s->values[j];
+        }
+      }
+      std::vector<int> ch_ids;
+      std::vector<Stmt *> store_values;
+      for (auto &ch_id_and_value : values) {
+        ch_ids.push_back(ch_id_and_value.first);
+        store_values.push_back(ch_id_and_value.second);
+      }
+      // Now erase all (except the last) related BitSturctStoreStmts.
+      // Replace the last one with a merged version.
+      for (int j = 0; j < (int)stores.size() - 1; j++) {
+        statements_to_delete.push_back(stores[j]);
+      }
+      stores.back()->replace_with(
+          Stmt::make<BitStructStoreStmt>(ptr, ch_ids, store_values));
+      modified_ = true;
+    };
     for (int i = 0; i <= (int)statements.size(); i++) {
       // TODO: in some cases BitStructStoreStmts across container statements can
       // still be merged, similar to basic block v.s. CFG optimizations.
       if (i == statements.size() || statements[i]->is_container_statement()) {
         for (const auto &item : ptr_to_bit_struct_stores) {
-          auto ptr = item.first;
-          auto stores = item.second;
-          if (stores.size() == 1)
-            continue;
-          std::map<int, Stmt *> values;
-          for (auto s : stores) {
-            for (int j = 0; j < (int)s->ch_ids.size(); j++) {
-              values[s->ch_ids[j]] = s->values[j];
-            }
-          }
-          std::vector<int> ch_ids;
-          std::vector<Stmt *> store_values;
-          for (auto &ch_id_and_value : values) {
-            ch_ids.push_back(ch_id_and_value.first);
-            store_values.push_back(ch_id_and_value.second);
-          }
-          // Now erase all (except the last) related BitSturctStoreStmts.
-          // Replace the last one with a merged version.
-          for (int j = 0; j < (int)stores.size() - 1; j++) {
-            statements_to_delete.push_back(stores[j]);
-          }
-          stores.back()->replace_with(
-              Stmt::make<BitStructStoreStmt>(ptr, ch_ids, store_values));
-          modified_ = true;
+          merge_stores(item.first, item.second);
         }
         ptr_to_bit_struct_stores.clear();
         continue;
       }
       if (auto stmt = statements[i]->cast<BitStructStoreStmt>()) {
         ptr_to_bit_struct_stores[stmt->ptr].push_back(stmt);
+      } else if (auto *snode = get_accessed_bit_struct(statements[i].get())) {
+        // The stores before a read of the same bit struct, e.g. from the next
+        // task after offloaded tasks are fused, cannot be moved past it. The
+        // pointers are compared by SNode since they may alias.
+        for (auto iter = ptr_to_bit_struct_stores.begin();
+             iter != ptr_to_bit_struct_stores.end();) {
+          if (iter->first->as<SNodeLookupStmt>()->snode == snode) {
+            merge_stores(iter->first, iter->second);
+            iter = ptr_to_bit_struct_stores.erase(iter);
+          } else {
+            iter++;
+          }
+        }
       }
     }
 
@@ -111,6 +126,20 @@ class MergeBitStructStores : public BasicStmtVisitor {
   }
 
  private:
+  // Returns the bit struct read by |stmt|, if any.
+  static SNode *get_accessed_bit_struct(Stmt *stmt) {
+    Stmt *ptr = nullptr;
+    if (auto *load = stmt->cast<GlobalLoadStmt>()) {
+      ptr = load->src;
+    } else if (auto *atomic = stmt->cast<AtomicOpStmt>()) {
+      ptr = atomic->dest;
+    }
+    auto *get_ch = ptr ? ptr->cast<GetChStmt>() : nullptr;
+    if (!get_ch || get_ch->input_snode->type != SNodeType::bit_struct)
+      return nullptr;
+    return get_ch->input_snode;
+  }
+
   bool modified_{false};
 };
 
@@ -54,6 +54,7 @@ void ScalarPointerLowerer::run() {
     }
     std::vector<Stmt *> lowered_indices;
     std::vector<int> strides;
+    std::vector<int> axes;
     // extract lowered indices
     for (int k_ = 0; k_ < (int)indices_.size(); k_++) {
       int k = leaf_snode->physical_index_position[k_];
@@ -76,6 +77,12 @@ void ScalarPointerLowerer::run() {
       is_first_extraction[k] = false;
       lowered_indices.push_back(extracted);
       strides.push_back(snode->extractors[k].shape);
+      axes.push_back(k);
+    }
+    if (snode->_morton) {
+      lowered_indices = {
+          generate_morton_encode(lowered_, snode, axes, lowered_indices)};
+      strides = {snode->num_cells_per_container};
     }
     // linearize
     auto *linearized =
@@ -613,15 +613,20 @@ void full_simplify(IRNode *root,
         modified = true;
       if (unreachable_code_elimination(root))
         modified = true;
-      if (binary_op_simplify(root, config))
-        modified = true;
-      if (config.constant_folding &&
-          constant_fold(root, config, {args.program}))
-        modified = true;
-      if (die(root))
-        modified = true;
-      if (alg_simp(root, config))
-        modified = true;
+      if (config.worklist_simplify) {
+        if (worklist_simplify(root, config, {args.program}))
+          modified = true;
+      } else {
+        if (binary_op_simplify(root, config))
+          modified = true;
+        if (config.constant_folding &&
+            constant_fold(root, config, {args.program}))
+          modified = true;
+        if (die(root))
+          modified = true;
+        if (alg_simp(root, config))
+          modified = true;
+      }
       if (loop_invariant_code_motion(root, config))
         modified = true;
       if (die(root))
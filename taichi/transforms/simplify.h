@@ -17,4 +17,16 @@ class FullSimplifyPass : public Pass {
   };
 };
 
+// Applies the rules of a simplification pass to a single statement, so that
+// the worklist-driven simplifier can revisit only the statements around the
+// previous rewrites.
+class StmtRewriter {
+ public:
+  virtual ~StmtRewriter() = default;
+
+  // Returns true if |stmt| is modified or replaced. New statements may only be
+  // inserted right before |stmt|. Container statements are never passed in.
+  virtual bool rewrite(Stmt *stmt) = 0;
+};
+
 }  // namespace taichi::lang
@@ -0,0 +1,57 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/system/profiler.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// Replaces the shapes of the ndarray arguments with constants, so that the
+// passes after it can fold them, e.g. into constant loop bounds.
+class SpecializeNdarrayShapes : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+  DelayedIRModifier modifier;
+
+  explicit SpecializeNdarrayShapes(
+      const std::vector<std::vector<int32>> &shapes)
+      : shapes_(shapes) {
+  }
+
+  void visit(ExternalTensorShapeAlongAxisStmt *stmt) override {
+    if (stmt->arg_id >= (int)shapes_.size() ||
+        stmt->axis >= (int)shapes_[stmt->arg_id].size()) {
+      return;
+    }
+    VecStatement replacement;
+    replacement.push_back<ConstStmt>(
+        TypedConstant(shapes_[stmt->arg_id][stmt->axis]));
+    modifier.replace_with(stmt, std::move(replacement));
+  }
+
+  static bool run(IRNode *node,
+                  const std::vector<std::vector<int32>> &shapes) {
+    SpecializeNdarrayShapes pass(shapes);
+    node->accept(&pass);
+    return pass.modifier.modify_ir();
+  }
+
+ private:
+  const std::vector<std::vector<int32>> &shapes_;
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool specialize_ndarray_shapes(IRNode *root,
+                               const std::vector<std::vector<int32>> &shapes) {
+  TI_AUTO_PROF;
+  return SpecializeNdarrayShapes::run(root, shapes);
+}
+
+}  // namespace irpass
+
+}  // namespace taichi::lang
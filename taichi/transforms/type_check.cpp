@@ -471,6 +471,16 @@ class TypeCheck : public IRVisitor {
 
   void visit(LoopIndexStmt *stmt) override {
     stmt->ret_type = PrimitiveType::i32;
+    // Range-fors over 64-bit bounds have 64-bit indices.
+    if (auto range_for = stmt->loop->cast<RangeForStmt>()) {
+      if (range_for->begin->ret_type == PrimitiveType::i64) {
+        stmt->ret_type = PrimitiveType::i64;
+      }
+    } else if (auto offload = stmt->loop->cast<OffloadedStmt>()) {
+      if (offload->task_type == OffloadedTaskType::range_for) {
+        stmt->ret_type = offload->index_type;
+      }
+    }
   }
 
   void visit(LoopLinearIndexStmt *stmt) override {
@@ -570,8 +580,7 @@ class TypeCheck : public IRVisitor {
   }
 
   void visit(InternalFuncStmt *stmt) override {
-    // TODO: support return type specification
-    stmt->ret_type = PrimitiveType::i32;
+    // The return type is specified on construction and defaults to i32.
   }
 
   void visit(BitStructStoreStmt *stmt) override {
@@ -1,3 +1,4 @@
+#include "taichi/ir/snode.h"
 #include "taichi/ir/statements.h"
 
 namespace taichi::lang {
@@ -21,4 +22,61 @@ Stmt *generate_div(VecStatement *stmts, Stmt *x, int y) {
   return stmts->push_back<BinaryOpStmt>(BinaryOpType::div, x, const_stmt);
 }
 
+namespace {
+
+// Moves the bits [from, from + num_bits) of |x| to [to, to + num_bits).
+Stmt *generate_move_bits(VecStatement *stmts,
+                         Stmt *x,
+                         int from,
+                         int to,
+                         int num_bits) {
+  auto shift = [&](Stmt *val, BinaryOpType op, int bits) -> Stmt * {
+    if (bits == 0) {
+      return val;
+    }
+    auto const_stmt = stmts->push_back<ConstStmt>(
+        TypedConstant(PrimitiveType::i32, bits));
+    return stmts->push_back<BinaryOpStmt>(op, val, const_stmt);
+  };
+  auto mask = stmts->push_back<ConstStmt>(
+      TypedConstant(PrimitiveType::i32,
+                    (int32)(((1LL << num_bits) - 1) << from)));
+  auto masked = stmts->push_back<BinaryOpStmt>(BinaryOpType::bit_and, x, mask);
+  if (to >= from) {
+    return shift(masked, BinaryOpType::bit_shl, to - from);
+  }
+  return shift(masked, BinaryOpType::bit_shr, from - to);
+}
+
+}  // namespace
+
+Stmt *generate_morton_encode(VecStatement *stmts,
+                             const SNode *snode,
+                             const std::vector<int> &axes,
+                             const std::vector<Stmt *> &indices) {
+  Stmt *result = stmts->push_back<ConstStmt>(TypedConstant(0));
+  for (int i = 0; i < (int)axes.size(); i++) {
+    for (const auto &run : snode->morton_runs(axes[i])) {
+      auto bits = generate_move_bits(stmts, indices[i], run.coord_bit,
+                                     run.index_bit, run.num_bits);
+      result =
+          stmts->push_back<BinaryOpStmt>(BinaryOpType::bit_or, result, bits);
+    }
+  }
+  return result;
+}
+
+Stmt *generate_morton_decode(VecStatement *stmts,
+                             const SNode *snode,
+                             int axis,
+                             Stmt *linearized) {
+  Stmt *result = stmts->push_back<ConstStmt>(TypedConstant(0));
+  for (const auto &run : snode->morton_runs(axis)) {
+    auto bits = generate_move_bits(stmts, linearized, run.index_bit,
+                                   run.coord_bit, run.num_bits);
+    result = stmts->push_back<BinaryOpStmt>(BinaryOpType::bit_or, result, bits);
+  }
+  return result;
+}
+
 }  // namespace taichi::lang
@@ -8,4 +8,15 @@ namespace taichi::lang {
 Stmt *generate_mod(VecStatement *stmts, Stmt *x, int y);
 Stmt *generate_div(VecStatement *stmts, Stmt *x, int y);
 
+// Interleaves the coordinates |indices| on the physical axes |axes| into the
+// linearized index of the Morton-ordered |snode|, and the other way around.
+Stmt *generate_morton_encode(VecStatement *stmts,
+                             const SNode *snode,
+                             const std::vector<int> &axes,
+                             const std::vector<Stmt *> &indices);
+Stmt *generate_morton_decode(VecStatement *stmts,
+                             const SNode *snode,
+                             int axis,
+                             Stmt *linearized);
+
 }  // namespace taichi::lang
@@ -9,36 +9,52 @@
 
 namespace taichi::lang {
 
-// A helper class to maintain WholeKernelCSE::visited
-class MarkUndone : public BasicStmtVisitor {
+// Replaces the operands eliminated by WholeKernelCSE, and marks the
+// statements using them as not done, so that they are checked again.
+class ReplaceEliminatedOperands : public BasicStmtVisitor {
  private:
   std::unordered_set<int> *const visited_;
-  Stmt *const modified_operand_;
+  const std::unordered_map<Stmt *, Stmt *> &replacements_;
 
  public:
   using BasicStmtVisitor::visit;
 
-  MarkUndone(std::unordered_set<int> *visited, Stmt *modified_operand)
-      : visited_(visited), modified_operand_(modified_operand) {
+  ReplaceEliminatedOperands(
+      std::unordered_set<int> *visited,
+      const std::unordered_map<Stmt *, Stmt *> &replacements)
+      : visited_(visited), replacements_(replacements) {
     allow_undefined_visitor = true;
     invoke_default_visitor = true;
   }
 
-  void visit(Stmt *stmt) override {
-    if (stmt->has_operand(modified_operand_)) {
-      visited_->erase(stmt->instance_id);
+  static void replace(Stmt *stmt,
+                      std::unordered_set<int> *visited,
+                      const std::unordered_map<Stmt *, Stmt *> &replacements) {
+    if (replacements.empty()) {
+      return;
+    }
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      auto it = replacements.find(stmt->operand(i));
+      if (it != replacements.end()) {
+        stmt->replace_operand_with(it->first, it->second);
+        visited->erase(stmt->instance_id);
+      }
     }
   }
 
+  void visit(Stmt *stmt) override {
+    replace(stmt, visited_, replacements_);
+  }
+
   void preprocess_container_stmt(Stmt *stmt) override {
-    if (stmt->has_operand(modified_operand_)) {
-      visited_->erase(stmt->instance_id);
-    }
+    replace(stmt, visited_, replacements_);
   }
 
-  static void run(std::unordered_set<int> *visited, Stmt *modified_operand) {
-    MarkUndone marker(visited, modified_operand);
-    modified_operand->get_ir_root()->accept(&marker);
+  static void run(IRNode *root,
+                  std::unordered_set<int> *visited,
+                  const std::unordered_map<Stmt *, Stmt *> &replacements) {
+    ReplaceEliminatedOperands replacer(visited, replacements);
+    root->accept(&replacer);
   }
 };
 
@@ -49,6 +65,8 @@ class WholeKernelCSE : public BasicStmtVisitor {
   // each scope corresponds to an unordered_set
   std::vector<std::unordered_map<std::size_t, std::unordered_set<Stmt *> > >
       visible_stmts_;
+  // The statements eliminated in the current pass, and their replacements.
+  std::unordered_map<Stmt *, Stmt *> eliminated_;
   DelayedIRModifier modifier_;
 
  public:
@@ -67,24 +85,39 @@ class WholeKernelCSE : public BasicStmtVisitor {
     visited_.insert(stmt->instance_id);
   }
 
-  static std::size_t operand_hash(const Stmt *stmt) {
-    std::size_t hash_code{0};
-    auto hash_type =
-        std::hash<std::type_index>{}(std::type_index(typeid(stmt)));
-    if (stmt->is<GlobalPtrStmt>() || stmt->is<LoopUniqueStmt>()) {
+  // Hashes the operation, the operands and the type of |stmt|, so that only
+  // the statements that are likely the same are compared with
+  // common_statement_eliminable().
+  static std::size_t statement_hash(const Stmt *stmt) {
+    std::size_t hash_code =
+        std::hash<std::type_index>{}(std::type_index(typeid(*stmt)));
+    auto combine = [&](std::size_t value) {
+      hash_code = (hash_code * 33) ^ value;
+    };
+    // Types are uniquely allocated, so their addresses can be hashed.
+    combine(std::hash<const Type *>{}((const Type *)stmt->ret_type));
+    if (auto global_ptr = stmt->cast<GlobalPtrStmt>()) {
       // special cases in common_statement_eliminable()
-      return hash_type;
+      combine(std::hash<SNode *>{}(global_ptr->snode));
+      return hash_code;
     }
-    auto op = stmt->get_operands();
-    for (auto &x : op) {
+    if (stmt->is<LoopUniqueStmt>()) {
+      return hash_code;
+    }
+    if (auto constant = stmt->cast<ConstStmt>()) {
+      combine(std::hash<std::string>{}(constant->val.stringify()));
+    } else if (auto binary = stmt->cast<BinaryOpStmt>()) {
+      combine((std::size_t)binary->op_type);
+    } else if (auto unary = stmt->cast<UnaryOpStmt>()) {
+      combine((std::size_t)unary->op_type);
+    }
+    for (auto &x : stmt->get_operands()) {
       if (x == nullptr)
         continue;
       // Hash the addresses of the operand pointers.
-      hash_code =
-          (hash_code * 33) ^
-          (std::hash<unsigned long>{}(reinterpret_cast<unsigned long>(x)));
+      combine(std::hash<Stmt *>{}(x));
     }
-    return hash_type ^ hash_code;
+    return hash_code;
   }
 
   static bool common_statement_eliminable(Stmt *this_stmt, Stmt *prev_stmt) {
@@ -120,22 +153,30 @@ class WholeKernelCSE : public BasicStmtVisitor {
   }
 
   void visit(Stmt *stmt) override {
+    // The statements are visited after the ones they use, so the operands
+    // eliminated earlier in this pass are replaced here, without the whole IR
+    // being traversed for each elimination.
+    ReplaceEliminatedOperands::replace(stmt, &visited_, eliminated_);
     if (!stmt->common_statement_eliminable())
       return;
     // container_statement does not need to be CSE-ed
     if (stmt->is_container_statement())
       return;
     // Generic visitor for all CSE-able statements.
-    std::size_t hash_value = operand_hash(stmt);
+    std::size_t hash_value = statement_hash(stmt);
     if (is_done(stmt)) {
       visible_stmts_.back()[hash_value].insert(stmt);
       return;
     }
     for (auto &scope : visible_stmts_) {
-      for (auto &prev_stmt : scope[hash_value]) {
+      auto it = scope.find(hash_value);
+      if (it == scope.end()) {
+        continue;
+      }
+      // The hashes can collide, so the candidates are still compared.
+      for (auto &prev_stmt : it->second) {
         if (common_statement_eliminable(stmt, prev_stmt)) {
-          MarkUndone::run(&visited_, stmt);
-          stmt->replace_usages_with(prev_stmt);
+          eliminated_[stmt] = prev_stmt;
           modifier_.erase(stmt);
           return;
         }
@@ -145,6 +186,10 @@ class WholeKernelCSE : public BasicStmtVisitor {
     set_done(stmt);
   }
 
+  void preprocess_container_stmt(Stmt *stmt) override {
+    ReplaceEliminatedOperands::replace(stmt, &visited_, eliminated_);
+  }
+
   void visit(Block *stmt_list) override {
     visible_stmts_.emplace_back();
     for (auto &stmt : stmt_list->statements) {
@@ -154,6 +199,7 @@ class WholeKernelCSE : public BasicStmtVisitor {
   }
 
   void visit(IfStmt *if_stmt) override {
+    ReplaceEliminatedOperands::replace(if_stmt, &visited_, eliminated_);
     if (if_stmt->true_statements) {
       if (if_stmt->true_statements->statements.empty()) {
         if_stmt->set_true_statements(nullptr);
@@ -208,6 +254,13 @@ class WholeKernelCSE : public BasicStmtVisitor {
     bool modified = false;
     while (true) {
       node->accept(&eliminator);
+      if (!eliminator.eliminated_.empty()) {
+        // For the usages that the traversal did not reach after the
+        // eliminated statements.
+        ReplaceEliminatedOperands::run(node, &eliminator.visited_,
+                                       eliminator.eliminated_);
+        eliminator.eliminated_.clear();
+      }
       if (eliminator.modifier_.modify_ir())
         modified = true;
       else
@@ -0,0 +1,191 @@
+// Worklist-driven simplification
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/system/profiler.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// Applies the rules of constant_fold, binary_op_simplify, alg_simp and die
+// until none of them applies. Rather than traversing the whole IR again after
+// every change, only the statements around a rewrite are revisited: the users
+// of the rewritten statement, its operands, and the statements inserted in its
+// place.
+class WorklistSimplify {
+ public:
+  WorklistSimplify(IRNode *root,
+                   const CompileConfig &config,
+                   const ConstantFoldPass::Args &args) {
+    if (config.constant_folding) {
+      rules_.push_back(irpass::make_constant_fold_rewriter(config, args));
+    }
+    rules_.push_back(irpass::make_binary_op_simplify_rewriter(config));
+    rules_.push_back(irpass::make_alg_simp_rewriter(config));
+
+    for (auto &[stmt, usages] :
+         irpass::analysis::gather_statement_usages(root)) {
+      auto &users = users_[stmt];
+      for (auto &usage : usages) {
+        users.push_back(usage.first);
+      }
+    }
+    // TODO: A hack to make sure end_stmt is kept, the same as the one in DIE.
+    if (auto *block = dynamic_cast<Block *>(root)) {
+      for (auto &stmt : block->statements) {
+        if (auto *offload = stmt->cast<OffloadedStmt>();
+            offload && offload->end_stmt) {
+          pinned_.insert(offload->end_stmt);
+        }
+      }
+    }
+    auto stmts = irpass::analysis::gather_statements(
+        root, [](Stmt *) { return true; });
+    for (auto *stmt : stmts) {
+      push(stmt);
+    }
+  }
+
+  bool run() {
+    bool modified = false;
+    while (!worklist_.empty()) {
+      auto *stmt = worklist_.front();
+      worklist_.pop_front();
+      queued_.erase(stmt);
+      if (stmt->erased || stmt->is_container_statement()) {
+        continue;
+      }
+      if (try_eliminate(stmt) || try_rewrite(stmt)) {
+        modified = true;
+      }
+    }
+    return modified;
+  }
+
+ private:
+  void push(Stmt *stmt) {
+    if (queued_.insert(stmt).second) {
+      worklist_.push_back(stmt);
+    }
+  }
+
+  void add_usages(Stmt *stmt) {
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      if (auto *op = stmt->operand(i)) {
+        users_[op].push_back(stmt);
+      }
+    }
+  }
+
+  static bool uses(Stmt *user, Stmt *stmt) {
+    for (int i = 0; i < user->num_operands(); i++) {
+      if (user->operand(i) == stmt) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool is_used(Stmt *stmt) {
+    if (pinned_.count(stmt)) {
+      return true;
+    }
+    auto iter = users_.find(stmt);
+    if (iter == users_.end()) {
+      return false;
+    }
+    // The list may contain statements that have been erased, or that have
+    // stopped using |stmt| since.
+    auto &users = iter->second;
+    users.erase(std::remove_if(users.begin(), users.end(),
+                               [&](Stmt *user) {
+                                 return user->erased || !uses(user, stmt);
+                               }),
+                users.end());
+    return !users.empty();
+  }
+
+  bool try_eliminate(Stmt *stmt) {
+    if (!stmt->dead_instruction_eliminable() || is_used(stmt)) {
+      return false;
+    }
+    auto operands = stmt->get_operands();
+    stmt->parent->erase(stmt);
+    for (auto *op : operands) {
+      if (op) {
+        push(op);
+      }
+    }
+    return true;
+  }
+
+  bool try_rewrite(Stmt *stmt) {
+    auto *block = stmt->parent;
+    const int location = block->locate(stmt);
+    const int size = (int)block->size();
+    const auto operands = stmt->get_operands();
+    for (auto &rule : rules_) {
+      if (!rule->rewrite(stmt)) {
+        continue;
+      }
+      // The statements inserted before |stmt|, and |stmt| itself if it is
+      // still there.
+      const int new_size = (int)block->size();
+      const int end = std::min(location + new_size - size + 1, new_size);
+      for (int i = location; i < end; i++) {
+        auto *new_stmt = block->statements[i].get();
+        add_usages(new_stmt);
+        push(new_stmt);
+      }
+      // The users may have been redirected to a new statement.
+      std::vector<Stmt *> users;
+      if (auto iter = users_.find(stmt); iter != users_.end()) {
+        users = iter->second;
+      }
+      for (auto *user : users) {
+        if (!user->erased) {
+          add_usages(user);
+          push(user);
+        }
+      }
+      for (auto *op : operands) {
+        if (op) {
+          push(op);
+        }
+      }
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<StmtRewriter>> rules_;
+  // An over-approximation of the users of each statement.
+  std::unordered_map<Stmt *, std::vector<Stmt *>> users_;
+  std::unordered_set<Stmt *> pinned_;
+  std::deque<Stmt *> worklist_;
+  std::unordered_set<Stmt *> queued_;
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool worklist_simplify(IRNode *root,
+                       const CompileConfig &config,
+                       const ConstantFoldPass::Args &args) {
+  TI_AUTO_PROF;
+  WorklistSimplify simplifier(root, config, args);
+  return simplifier.run();
+}
+
+}  // namespace irpass
+
+}  // namespace taichi::lang
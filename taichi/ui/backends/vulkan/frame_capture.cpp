@@ -0,0 +1,240 @@
+#include "taichi/ui/backends/vulkan/frame_capture.h"
+
+#include <cstring>
+#include <memory>
+
+#include "taichi/rhi/vulkan/vulkan_device.h"
+#include "taichi/ui/backends/vulkan/app_context.h"
+#include "taichi/util/image_io.h"
+
+namespace taichi::ui {
+
+namespace vulkan {
+
+using namespace taichi::lang;
+using namespace taichi::lang::vulkan;
+
+namespace {
+
+VulkanStream *graphics_stream(AppContext *app_context) {
+  return static_cast<VulkanStream *>(
+      app_context->device().get_graphics_stream());
+}
+
+void to_rgba8(std::vector<uint32_t> &pixels, BufferFormat format) {
+  if (format != BufferFormat::bgra8 && format != BufferFormat::bgra8srgb) {
+    return;
+  }
+  for (auto &pixel : pixels) {
+    pixel = ((pixel << 16) & 0xFF0000) | (pixel & 0x0000FF00) |
+            ((pixel >> 16) & 0xFF) | (pixel & 0xFF000000);
+  }
+}
+
+}  // namespace
+
+FrameCapture::FrameCapture(AppContext *app_context,
+                           const FrameCaptureConfig &config)
+    : app_context_(app_context), config_(config) {
+  TI_ERROR_IF(config_.filename_pattern.empty() && config_.pipe_command.empty(),
+              "Either a file name pattern or a pipe command is required to "
+              "capture frames");
+  TI_ERROR_IF(config_.num_readback_slots < 1 || config_.num_workers < 1,
+              "Frame capture needs at least one readback slot and worker");
+  slots_.resize(config_.num_readback_slots);
+
+  int num_workers = config_.num_workers;
+  if (!config_.pipe_command.empty()) {
+#ifdef _WIN32
+    pipe_ = _popen(config_.pipe_command.c_str(), "wb");
+#else
+    pipe_ = popen(config_.pipe_command.c_str(), "w");
+#endif
+    TI_ERROR_IF(pipe_ == nullptr, "Cannot run [{}]", config_.pipe_command);
+    num_workers = 1;
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this]() { worker_loop(); });
+  }
+}
+
+FrameCapture::~FrameCapture() {
+  retire_slots(/*wait=*/true);
+  wait_for_jobs();
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    stopping_ = true;
+  }
+  jobs_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  if (pipe_) {
+#ifdef _WIN32
+    _pclose(pipe_);
+#else
+    pclose(pipe_);
+#endif
+  }
+  for (auto &slot : slots_) {
+    if (slot.buffer != kDeviceNullAllocation) {
+      app_context_->device().dealloc_memory(slot.buffer);
+    }
+  }
+}
+
+StreamSemaphore FrameCapture::capture(Surface &surface,
+                                      StreamSemaphore render_complete) {
+  VulkanStream *stream = graphics_stream(app_context_);
+  Slot &slot = slots_[next_slot_];
+  if (slot.pending) {
+    // The ring is full, so |slot| is the oldest one in flight.
+    stream->wait_for_submission(slot.submission);
+    retire_slots(/*wait=*/false);
+  }
+  next_slot_ = (next_slot_ + 1) % slots_.size();
+
+  auto [w, h] = surface.get_size();
+  const size_t size = size_t(w) * h * sizeof(uint32_t);
+  if (slot.size != size) {
+    if (slot.buffer != kDeviceNullAllocation) {
+      app_context_->device().dealloc_memory(slot.buffer);
+    }
+    Device::AllocParams params{size, /*host_write=*/false, /*host_read=*/true,
+                               /*export_sharing=*/false, AllocUsage::Uniform};
+    slot.buffer = app_context_->device().allocate_memory(params);
+    slot.size = size;
+  }
+
+  DeviceAllocation image = surface.get_target_image();
+  BufferImageCopyParams copy_params;
+  copy_params.image_extent.x = w;
+  copy_params.image_extent.y = h;
+  copy_params.image_aspect_flag = VK_IMAGE_ASPECT_COLOR_BIT;
+  auto [cmd_list, res] = stream->new_command_list_unique();
+  TI_ASSERT(res == RhiResult::success);
+  cmd_list->image_transition(image, ImageLayout::present_src,
+                             ImageLayout::transfer_src);
+  cmd_list->image_to_buffer(slot.buffer.get_ptr(), image,
+                            ImageLayout::transfer_src, copy_params);
+  cmd_list->image_transition(image, ImageLayout::transfer_src,
+                             ImageLayout::present_src);
+  StreamSemaphore copy_complete =
+      stream->submit(cmd_list.get(), {render_complete});
+
+  slot.submission = stream->last_submission_id();
+  slot.pending = true;
+  slot.frame = next_frame_++;
+  slot.width = w;
+  slot.height = h;
+  slot.format = surface.image_format();
+
+  retire_slots(/*wait=*/false);
+  return copy_complete;
+}
+
+void FrameCapture::finish() {
+  retire_slots(/*wait=*/true);
+  wait_for_jobs();
+  if (pipe_) {
+    std::fflush(pipe_);
+  }
+  std::string error;
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    std::swap(error, error_);
+  }
+  TI_ERROR_IF(!error.empty(), "Frame capture failed: {}", error);
+}
+
+void FrameCapture::retire_slots(bool wait) {
+  VulkanStream *stream = graphics_stream(app_context_);
+  while (slots_[oldest_slot_].pending) {
+    Slot &slot = slots_[oldest_slot_];
+    if (wait) {
+      stream->wait_for_submission(slot.submission);
+    } else if (!stream->is_submission_complete(slot.submission)) {
+      break;
+    }
+    retire(slot);
+    oldest_slot_ = (oldest_slot_ + 1) % slots_.size();
+  }
+}
+
+void FrameCapture::retire(Slot &slot) {
+  // Mapping stays on this thread, the workers only see the copied pixels.
+  auto pixels =
+      std::make_shared<std::vector<uint32_t>>(size_t(slot.width) * slot.height);
+  void *mapped{nullptr};
+  TI_ASSERT(app_context_->device().map(slot.buffer, &mapped) ==
+            RhiResult::success);
+  std::memcpy(pixels->data(), mapped, pixels->size() * sizeof(uint32_t));
+  app_context_->device().unmap(slot.buffer);
+  slot.pending = false;
+
+  const int frame = slot.frame;
+  const uint32_t w = slot.width;
+  const uint32_t h = slot.height;
+  const BufferFormat format = slot.format;
+  post([this, pixels, frame, w, h, format]() {
+    to_rgba8(*pixels, format);
+    if (pipe_) {
+      const size_t written =
+          std::fwrite(pixels->data(), sizeof(uint32_t), pixels->size(), pipe_);
+      TI_ERROR_IF(written != pixels->size(), "Cannot write frame {} to [{}]",
+                  frame, config_.pipe_command);
+    } else {
+      imwrite(fmt::format(config_.filename_pattern, frame),
+              (size_t)pixels->data(), w, h, 4);
+    }
+  });
+}
+
+void FrameCapture::post(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    jobs_.push_back(std::move(job));
+  }
+  jobs_cv_.notify_one();
+}
+
+void FrameCapture::wait_for_jobs() {
+  std::unique_lock<std::mutex> lock(mut_);
+  idle_cv_.wait(lock, [this]() { return jobs_.empty() && !num_busy_workers_; });
+}
+
+void FrameCapture::worker_loop() {
+  std::unique_lock<std::mutex> lock(mut_);
+  while (true) {
+    jobs_cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+      return;
+    }
+    auto job = std::move(jobs_.front());
+    jobs_.pop_front();
+    num_busy_workers_++;
+    lock.unlock();
+
+    std::string error;
+    try {
+      job();
+    } catch (const std::exception &e) {
+      error = e.what();
+    } catch (...) {
+      error = "unknown error";
+    }
+
+    lock.lock();
+    if (!error.empty() && error_.empty()) {
+      error_ = error;
+    }
+    num_busy_workers_--;
+    if (jobs_.empty() && !num_busy_workers_) {
+      idle_cv_.notify_all();
+    }
+  }
+}
+
+}  // namespace vulkan
+
+}  // namespace taichi::ui
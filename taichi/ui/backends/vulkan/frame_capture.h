@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taichi/rhi/device.h"
+#include "taichi/ui/common/frame_capture_config.h"
+
+namespace taichi::ui {
+
+namespace vulkan {
+
+class AppContext;
+
+// Reads the frames of a surface back into a ring of host buffers without
+// waiting for the device, and writes them out on worker threads.
+class FrameCapture {
+ public:
+  FrameCapture(AppContext *app_context, const FrameCaptureConfig &config);
+  ~FrameCapture();
+
+  // Copies the image last drawn on |surface| to a readback slot once
+  // |render_complete| is signalled, and returns the semaphore the presentation
+  // of the image has to wait for instead. Waits for the oldest readback only if
+  // all slots are in use.
+  taichi::lang::StreamSemaphore capture(
+      taichi::lang::Surface &surface,
+      taichi::lang::StreamSemaphore render_complete);
+
+  // Waits until the frames captured so far are written, and raises the first
+  // error of the workers if any.
+  void finish();
+
+ private:
+  struct Slot {
+    taichi::lang::DeviceAllocation buffer{taichi::lang::kDeviceNullAllocation};
+    size_t size{0};
+    // The submission of the copy to the graphics stream, see
+    // VulkanStream::last_submission_id().
+    uint64_t submission{0};
+    bool pending{false};
+    int frame{0};
+    uint32_t width{0};
+    uint32_t height{0};
+    taichi::lang::BufferFormat format{taichi::lang::BufferFormat::rgba8};
+  };
+
+  // Hands the completed slots off to the workers, in capture order. Waits for
+  // them to complete if |wait| is true.
+  void retire_slots(bool wait);
+  void retire(Slot &slot);
+  void post(std::function<void()> job);
+  void wait_for_jobs();
+  void worker_loop();
+
+  AppContext *app_context_;
+  FrameCaptureConfig config_;
+
+  std::vector<Slot> slots_;
+  // The slot the next frame is copied to, and the oldest slot in flight.
+  size_t next_slot_{0};
+  size_t oldest_slot_{0};
+  int next_frame_{0};
+
+  std::FILE *pipe_{nullptr};
+
+  std::vector<std::thread> workers_;
+  std::mutex mut_;
+  std::condition_variable jobs_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::function<void()>> jobs_;
+  int num_busy_workers_{0};
+  bool stopping_{false};
+  std::string error_;
+};
+
+}  // namespace vulkan
+
+}  // namespace taichi::ui
@@ -1,6 +1,7 @@
 #include "taichi/ui/backends/vulkan/renderable.h"
 
 #include "taichi/program/program.h"
+#include "taichi/rhi/interop/vulkan_cuda_interop.h"
 #include "taichi/ui/utils/utils.h"
 
 namespace taichi::ui {
@@ -10,6 +11,13 @@ namespace vulkan {
 using namespace taichi::lang;
 using namespace taichi::lang::vulkan;
 
+namespace {
+
+// Large enough for the parameters of both indexed and non-indexed draws.
+constexpr size_t kMaxDrawArgsSize = 8 * sizeof(uint32_t);
+
+}  // namespace
+
 void Renderable::init(const RenderableConfig &config, AppContext *app_context) {
   config_ = config;
   app_context_ = app_context;
@@ -25,6 +33,8 @@ void Renderable::free_buffers() {
   app_context_->device().dealloc_memory(staging_vertex_buffer_);
   app_context_->device().dealloc_memory(index_buffer_);
   app_context_->device().dealloc_memory(staging_index_buffer_);
+  app_context_->device().dealloc_memory(indirect_buffer_);
+  app_context_->device().dealloc_memory(staging_indirect_buffer_);
 
   destroy_uniform_buffers();
   destroy_storage_buffers();
@@ -33,37 +43,59 @@ void Renderable::free_buffers() {
 void Renderable::init_buffers() {
   create_vertex_buffer();
   create_index_buffer();
+  create_indirect_buffer();
   create_uniform_buffers();
   create_storage_buffers();
 
   create_bindings();
 }
 
-void copy_helper(Program *prog,
-                 DevicePtr dst,
-                 DevicePtr src,
-                 DevicePtr staging,
-                 size_t size) {
-  if (prog && dst.device == src.device &&
-      dst.device == prog->get_graphics_device()) {
-    prog->enqueue_compute_op_lambda(
-        [=](Device *device, CommandList *cmdlist) {
-          cmdlist->buffer_barrier(src);
-          cmdlist->buffer_copy(dst, src, size);
-          cmdlist->buffer_barrier(dst);
-        },
-        {});
+void copy_helper(DevicePtr dst, DevicePtr src, DevicePtr staging, size_t size) {
+  Device::MemcpyCapability memcpy_cap =
+      Device::check_memcpy_capability(dst, src, size);
+  if (memcpy_cap == Device::MemcpyCapability::Direct) {
+    Device::memcpy_direct(dst, src, size);
+  } else if (memcpy_cap == Device::MemcpyCapability::RequiresStagingBuffer) {
+    Device::memcpy_via_staging(dst, staging, src, size);
   } else {
-    Device::MemcpyCapability memcpy_cap =
-        Device::check_memcpy_capability(dst, src, size);
-    if (memcpy_cap == Device::MemcpyCapability::Direct) {
-      Device::memcpy_direct(dst, src, size);
-    } else if (memcpy_cap == Device::MemcpyCapability::RequiresStagingBuffer) {
-      Device::memcpy_via_staging(dst, staging, src, size);
-    } else {
-      TI_NOT_IMPLEMENTED;
+    TI_NOT_IMPLEMENTED;
+  }
+}
+
+DevicePtr Renderable::borrow_or_copy(Program *prog,
+                                     DevicePtr dst,
+                                     DevicePtr src,
+                                     DevicePtr staging,
+                                     size_t size) {
+  Device *device = &app_context_->device();
+  if (src.device == device) {
+    // The graphics submission waits for the kernels writing |src|, see
+    // Renderer::draw_frame().
+    if (prog && prog->get_graphics_device() == device) {
+      prog->enqueue_compute_op_lambda(
+          [=](Device *, CommandList *cmdlist) {
+            cmdlist->buffer_barrier(src);
+          },
+          {});
     }
+    borrows_device_memory_ = true;
+    return src;
   }
+  if (DevicePtr shared_src = find_vulkan_cuda_shared_memory(device, src);
+      shared_src != kDeviceNullPtr) {
+    // The CUDA array lives in memory of this Vulkan device, so drawing only
+    // waits for the CUDA work writing it.
+    StreamSemaphore cuda_done = signal_vulkan_semaphore_from_cuda(device);
+    Stream *stream = device->get_graphics_stream();
+    auto [cmdlist, res] = stream->new_command_list_unique();
+    TI_ASSERT(res == RhiResult::success);
+    cmdlist->buffer_barrier(shared_src);
+    stream->submit(cmdlist.get(), {cuda_done});
+    borrows_cuda_memory_ = true;
+    return shared_src;
+  }
+  copy_helper(dst, src, staging, size);
+  return dst;
 }
 
 void Renderable::update_data(const RenderableInfo &info) {
@@ -140,9 +172,14 @@ void Renderable::update_data(const RenderableInfo &info) {
     vbo_dev_ptr = get_device_ptr(prog, info.vbo.snode);
   }
 
+  borrows_device_memory_ = false;
+  borrows_cuda_memory_ = false;
+
   const uint64_t vbo_size = config_.vbo_size() * num_vertices;
-  copy_helper(prog, vertex_buffer_.get_ptr(0), vbo_dev_ptr,
-              staging_vertex_buffer_.get_ptr(), vbo_size);
+  raster_state_->vertex_buffer(
+      borrow_or_copy(prog, vertex_buffer_.get_ptr(0), vbo_dev_ptr,
+                     staging_vertex_buffer_.get_ptr(), vbo_size),
+      0);
 
   if (info.indices.valid) {
     indexed_ = true;
@@ -151,8 +188,27 @@ void Renderable::update_data(const RenderableInfo &info) {
       ibo_dev_ptr = get_device_ptr(prog, info.indices.snode);
     }
     uint64_t ibo_size = num_indices * sizeof(int);
-    copy_helper(prog, index_buffer_.get_ptr(), ibo_dev_ptr,
-                staging_index_buffer_.get_ptr(), ibo_size);
+    raster_state_->index_buffer(
+        borrow_or_copy(prog, index_buffer_.get_ptr(), ibo_dev_ptr,
+                       staging_index_buffer_.get_ptr(), ibo_size),
+        32);
+  }
+
+  draw_args_ = kDeviceNullPtr;
+  if (info.draw_args.valid) {
+    TI_ERROR_IF(info.draw_args.dtype != PrimitiveType::i32 &&
+                    info.draw_args.dtype != PrimitiveType::u32,
+                "draw_args must be a 32-bit int field");
+    DevicePtr args_dev_ptr = info.draw_args.dev_alloc.get_ptr();
+    if (prog) {
+      args_dev_ptr = get_device_ptr(prog, info.draw_args.snode);
+    }
+    const size_t args_size = info.draw_args.shape[0] * sizeof(uint32_t);
+    TI_ERROR_IF(args_size > kMaxDrawArgsSize,
+                "draw_args can hold at most {} integers",
+                kMaxDrawArgsSize / sizeof(uint32_t));
+    draw_args_ = borrow_or_copy(prog, indirect_buffer_.get_ptr(), args_dev_ptr,
+                                staging_indirect_buffer_.get_ptr(), args_size);
   }
 }
 
@@ -257,6 +313,18 @@ void Renderable::create_index_buffer() {
       app_context_->device().allocate_memory(staging_ib_params);
 }
 
+void Renderable::create_indirect_buffer() {
+  Device::AllocParams params{kMaxDrawArgsSize, false, false,
+                             app_context_->requires_export_sharing(),
+                             AllocUsage::Indirect};
+  indirect_buffer_ = app_context_->device().allocate_memory(params);
+
+  Device::AllocParams staging_params{kMaxDrawArgsSize, true, false, false,
+                                     AllocUsage::Indirect};
+  staging_indirect_buffer_ =
+      app_context_->device().allocate_memory(staging_params);
+}
+
 void Renderable::create_uniform_buffers() {
   const size_t buffer_size = config_.ubo_size;
   if (buffer_size == 0) {
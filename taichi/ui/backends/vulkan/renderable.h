@@ -58,6 +58,17 @@ class Renderable {
 
   virtual ~Renderable() = default;
 
+  // Whether the last update_data() bound memory of the program for drawing
+  // instead of copying it, directly or through CUDA memory exported from the
+  // Vulkan device. The program must not overwrite that memory before the
+  // frame is rendered.
+  bool borrows_device_memory() const {
+    return borrows_device_memory_;
+  }
+  bool borrows_cuda_memory() const {
+    return borrows_cuda_memory_;
+  }
+
   taichi::lang::Pipeline &pipeline();
   const taichi::lang::Pipeline &pipeline() const;
 
@@ -82,7 +93,16 @@ class Renderable {
   taichi::lang::DeviceAllocation uniform_buffer_;
   taichi::lang::DeviceAllocation storage_buffer_;
 
+  // Holds the indirect draw parameters if they can not be read in place.
+  taichi::lang::DeviceAllocation indirect_buffer_;
+  taichi::lang::DeviceAllocation staging_indirect_buffer_;
+  // Where the draw parameters are read from, or kDeviceNullPtr if the draw
+  // counts of the config are used. See RenderableInfo::draw_args.
+  taichi::lang::DevicePtr draw_args_{taichi::lang::kDeviceNullPtr};
+
   bool indexed_{false};
+  bool borrows_device_memory_{false};
+  bool borrows_cuda_memory_{false};
 
  protected:
   void init(const RenderableConfig &config_, AppContext *app_context);
@@ -92,12 +112,22 @@ class Renderable {
 
   virtual void create_bindings();
 
+  // Returns the pointer to draw |size| bytes at |src| from, which is |src|
+  // itself if the device can read it in place, or |dst| after copying it.
+  taichi::lang::DevicePtr borrow_or_copy(taichi::lang::Program *prog,
+                                         taichi::lang::DevicePtr dst,
+                                         taichi::lang::DevicePtr src,
+                                         taichi::lang::DevicePtr staging,
+                                         size_t size);
+
   void create_graphics_pipeline();
 
   void create_vertex_buffer();
 
   void create_index_buffer();
 
+  void create_indirect_buffer();
+
   void create_uniform_buffers();
 
   void create_storage_buffers();
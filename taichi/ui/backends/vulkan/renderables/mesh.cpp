@@ -121,6 +121,14 @@ void Mesh::record_this_frame_commands(taichi::lang::CommandList *command_list) {
   command_list->bind_raster_resources(raster_state_.get());
   command_list->bind_shader_resources(resource_set_.get());
 
+  if (draw_args_ != kDeviceNullPtr) {
+    // The instances left after culling on the device.
+    RhiResult res = indexed_ ? command_list->draw_indexed_indirect(draw_args_)
+                             : command_list->draw_indirect(draw_args_);
+    TI_ASSERT(res == RhiResult::success);
+    return;
+  }
+
   if (indexed_) {
     command_list->draw_indexed_instance(
         config_.draw_index_count, num_instances_, config_.draw_first_vertex,
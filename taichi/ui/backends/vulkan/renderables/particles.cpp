@@ -84,6 +84,12 @@ void Particles::record_this_frame_commands(CommandList *command_list) {
   command_list->bind_raster_resources(raster_state_.get());
   command_list->bind_shader_resources(resource_set_.get());
 
+  if (draw_args_ != kDeviceNullPtr) {
+    // The particles left after culling on the device.
+    TI_ASSERT(command_list->draw_indirect(draw_args_) == RhiResult::success);
+    return;
+  }
+
   // We draw num_particles * 6, 6 forms a quad
   // The `first_instance` should then instead set with `draw_first_vertex`,
   // and the first index always need to be 0
@@ -1,5 +1,6 @@
 #include "renderer.h"
 
+#include "taichi/rhi/interop/vulkan_cuda_interop.h"
 #include "taichi/ui/utils/utils.h"
 
 using taichi::lang::Program;
@@ -26,6 +27,7 @@ std::unique_ptr<Renderable> get_new_renderable(AppContext *app_context,
 
 template <typename T>
 T *Renderer::get_renderable_of_type(VertexAttributes vbo_attrs) {
+  wait_for_frame_in_flight();
   if (next_renderable_ >= renderables_.size()) {
     renderables_.push_back(get_new_renderable<T>(&app_context_, vbo_attrs));
   } else if (dynamic_cast<T *>(renderables_[next_renderable_].get()) ==
@@ -139,7 +141,9 @@ Renderer::~Renderer() {
 }
 
 void Renderer::cleanup() {
+  wait_for_frame_in_flight();
   render_complete_semaphore_ = nullptr;
+  cuda_render_wait_ = nullptr;
   for (auto &renderable : renderables_) {
     renderable->cleanup();
   }
@@ -153,6 +157,7 @@ void Renderer::prepare_for_next_frame() {
 }
 
 void Renderer::draw_frame(Gui *gui) {
+  wait_for_frame_in_flight();
   auto stream = app_context_.device().get_graphics_stream();
   auto [cmd_list, res] = stream->new_command_list_unique();
   assert(res == RhiResult::success && "Failed to allocate command list");
@@ -202,6 +207,39 @@ void Renderer::draw_frame(Gui *gui) {
   }
 
   render_complete_semaphore_ = stream->submit(cmd_list.get(), wait_semaphores);
+
+  // Renderables may draw from the memory of the program in place, so the
+  // kernels launched after this frame must not overwrite it before rendering
+  // completes.
+  bool borrows_device_memory = false;
+  bool borrows_cuda_memory = false;
+  for (int i = 0; i < next_renderable_; ++i) {
+    borrows_device_memory |= renderables_[i]->borrows_device_memory();
+    borrows_cuda_memory |= renderables_[i]->borrows_cuda_memory();
+  }
+  Program *prog = app_context_.prog();
+  if (borrows_device_memory && prog &&
+      prog->get_graphics_device() == &app_context_.device()) {
+    // An empty submission signals once the frame above is rendered.
+    auto [sync_list, sync_res] = stream->new_command_list_unique();
+    assert(sync_res == RhiResult::success && "Failed to allocate command list");
+    prog->wait_semaphore(stream->submit(sync_list.get(), {}));
+  }
+  if (borrows_cuda_memory) {
+    cuda_render_wait_ = wait_cuda_for_vulkan_graphics(&app_context_.device());
+  }
+  frame_in_flight_ = app_context_.config.pipelined;
+}
+
+void Renderer::wait_for_frame_in_flight() {
+  if (!frame_in_flight_) {
+    return;
+  }
+  // Only the work of this frame is waited for, kernels launched since then
+  // keep running.
+  static_cast<VulkanStream *>(app_context_.device().get_graphics_stream())
+      ->wait_for_submissions();
+  frame_in_flight_ = false;
 }
 
 const AppContext &Renderer::app_context() const {
@@ -70,6 +70,10 @@ class TI_DLL_EXPORT Renderer {
 
   void draw_frame(Gui *gui);
 
+  // In pipelined mode, waits for the frame submitted last to be rendered, so
+  // that the resources it uses can be updated. Returns immediately otherwise.
+  void wait_for_frame_in_flight();
+
   const AppContext &app_context() const;
   AppContext &app_context();
   const SwapChain &swap_chain() const;
@@ -84,6 +88,9 @@ class TI_DLL_EXPORT Renderer {
   int next_renderable_;
 
   taichi::lang::StreamSemaphore render_complete_semaphore_{nullptr};
+  // Keeps the CUDA stream waiting for the last frame drawn from CUDA memory.
+  taichi::lang::StreamSemaphore cuda_render_wait_{nullptr};
+  bool frame_in_flight_{false};
 
   SwapChain swap_chain_;
   AppContext app_context_;
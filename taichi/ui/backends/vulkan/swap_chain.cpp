@@ -17,6 +17,8 @@ void SwapChain::init(class AppContext *app_context) {
   config.window_handle = app_context_->taichi_window();
   config.width = app_context_->config.width;
   config.height = app_context_->config.height;
+  // The renderer waits for its frames itself in pipelined mode.
+  config.sync_on_present = !app_context_->config.pipelined;
   surface_ = app_context_->device().create_surface(config);
   auto [w, h] = surface_->get_size();
   curr_width_ = w;
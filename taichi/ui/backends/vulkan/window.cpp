@@ -60,6 +60,7 @@ void Window::framebuffer_resize_callback(GLFWwindow *glfw_window_,
 }
 
 void Window::resize() {
+  renderer_->wait_for_frame_in_flight();
   int width = 0, height = 0;
   glfwGetFramebufferSize(glfw_window_, &width, &height);
   while (width == 0 || height == 0) {
@@ -83,11 +84,16 @@ void Window::draw_frame() {
 }
 
 void Window::present_frame() {
-  renderer_->swap_chain().surface().present_image(
-      {renderer_->get_render_complete_semaphore()});
+  auto &surface = renderer_->swap_chain().surface();
+  auto semaphore = renderer_->get_render_complete_semaphore();
+  if (capture_) {
+    semaphore = capture_->capture(surface, semaphore);
+  }
+  surface.present_image({semaphore});
 }
 
 Window::~Window() {
+  capture_.reset();
   gui_.reset();
   renderer_.reset();
   if (config_.show_window) {
@@ -95,6 +101,19 @@ Window::~Window() {
   }
 }
 
+void Window::start_capture(const FrameCaptureConfig &config) {
+  stop_capture();
+  capture_ = std::make_unique<FrameCapture>(&renderer_->app_context(), config);
+}
+
+void Window::stop_capture() {
+  if (capture_) {
+    // Resets the capture even if some frames could not be written.
+    auto capture = std::move(capture_);
+    capture->finish();
+  }
+}
+
 std::pair<uint32_t, uint32_t> Window::get_window_shape() {
   return {renderer_->swap_chain().width(), renderer_->swap_chain().height()};
 }
@@ -103,6 +122,7 @@ void Window::write_image(const std::string &filename) {
   if (!drawn_frame_) {
     draw_frame();
   }
+  renderer_->wait_for_frame_in_flight();
   renderer_->swap_chain().write_image(filename);
   if (!config_.show_window) {
     prepare_for_next_frame();
@@ -142,6 +162,7 @@ void Window::copy_depth_buffer_to_ndarray(
   }
 
   auto arr_dev_ptr = depth_arr.ndarray_alloc_.get_ptr();
+  renderer_->wait_for_frame_in_flight();
   renderer_->swap_chain().copy_depth_buffer_to_ndarray(arr_dev_ptr);
 
   if (!config_.show_window) {
@@ -153,6 +174,7 @@ std::vector<uint32_t> &Window::get_image_buffer(uint32_t &w, uint32_t &h) {
   if (!drawn_frame_) {
     draw_frame();
   }
+  renderer_->wait_for_frame_in_flight();
   w = renderer_->swap_chain().width();
   h = renderer_->swap_chain().height();
   auto &img_buffer = renderer_->swap_chain().dump_image_buffer();
@@ -18,6 +18,7 @@
 #include "taichi/ui/backends/vulkan/swap_chain.h"
 #include "taichi/ui/backends/vulkan/app_context.h"
 #include "taichi/ui/backends/vulkan/canvas.h"
+#include "taichi/ui/backends/vulkan/frame_capture.h"
 #include "taichi/ui/backends/vulkan/renderer.h"
 #include "taichi/ui/common/window_base.h"
 #include "taichi/ui/backends/vulkan/gui.h"
@@ -48,12 +49,17 @@ class Window final : public WindowBase {
 
   std::vector<uint32_t> &get_image_buffer(uint32_t &w, uint32_t &h) override;
 
+  void start_capture(const FrameCaptureConfig &config) override;
+
+  void stop_capture() override;
+
   ~Window() override;
 
  private:
   std::unique_ptr<Canvas> canvas_;
   std::unique_ptr<Gui> gui_;
   std::unique_ptr<Renderer> renderer_;
+  std::unique_ptr<FrameCapture> capture_;
   bool drawn_frame_{false};
 
  private:
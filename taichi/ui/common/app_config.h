@@ -17,6 +17,10 @@ struct AppConfig {
   bool show_window{true};
   std::string package_path;
   Arch ti_arch;
+  // If true, show() returns once the frame is submitted, and the frame is
+  // only waited for before the next one is updated. Simulation steps launched
+  // in between then overlap with rendering.
+  bool pipelined{false};
 };
 
 }  // namespace ui
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+namespace taichi::ui {
+
+struct FrameCaptureConfig {
+  // Pattern of the image file of each frame, formatted with the index of the
+  // frame, e.g. "frames/{:06d}.png". The suffix selects the format, see
+  // imwrite().
+  std::string filename_pattern;
+  // If not empty, the frames are written as raw RGBA8 to the standard input
+  // of this command instead, in the order they were captured. For example an
+  // ffmpeg command line feeding a hardware video encoder.
+  std::string pipe_command;
+  // The number of frames whose readback can be in flight at once.
+  int num_readback_slots{3};
+  // The number of threads encoding image files. Frames written to a pipe are
+  // always written by a single thread.
+  int num_workers{4};
+};
+
+}  // namespace taichi::ui
@@ -17,6 +17,10 @@ struct RenderableInfo {
   int draw_index_count{0};
   int draw_first_index{0};
   taichi::lang::PolygonMode display_mode{taichi::lang::PolygonMode::Fill};
+  // If valid, a 32-bit int field holding the parameters of an indirect draw,
+  // which override the draw counts above. They are read on the device when
+  // the frame is drawn, so culling kernels can produce them.
+  FieldInfo draw_args;
 };
 
 }  // namespace taichi::ui
@@ -14,6 +14,7 @@
 #include "taichi/ui/common/event.h"
 #include "taichi/ui/common/gui_base.h"
 #include "taichi/ui/common/app_config.h"
+#include "taichi/ui/common/frame_capture_config.h"
 #include "taichi/program/ndarray.h"
 
 namespace taichi::ui {
@@ -48,6 +49,12 @@ class WindowBase {
 
   virtual std::vector<uint32_t> &get_image_buffer(uint32_t &w, uint32_t &h) = 0;
 
+  // Writes every shown frame out until stop_capture() is called, which waits
+  // for the frames in flight and reports the errors of the capture.
+  virtual void start_capture(const FrameCaptureConfig &config) = 0;
+
+  virtual void stop_capture() = 0;
+
   virtual GuiBase *gui();
 
   virtual ~WindowBase();
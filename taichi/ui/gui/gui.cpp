@@ -1,9 +1,86 @@
 #include "taichi/ui/gui/gui.h"
 
+#include <algorithm>
+#include <array>
+#include <thread>
+
+#include "taichi/system/threading.h"
+
 namespace taichi {
 
 Vector2 Canvas::Line::vertices[128];
 
+namespace {
+
+// The batched primitives are binned into bands of this many columns (with
+// the same i) of the image, which are rasterized in parallel.
+constexpr int kBandWidth = 16;
+// Fewer primitives are rasterized on the calling thread.
+constexpr int kMinParallelPrimitives = 1024;
+
+ThreadPool &get_raster_thread_pool() {
+  static ThreadPool pool(
+      std::max(1, (int)std::thread::hardware_concurrency()));
+  return pool;
+}
+
+// Calls |rasterize(k, i_begin, i_end)| for each of the |n| primitives whose
+// columns |get_columns(k)| (inclusive) overlap with each band [i_begin,
+// i_end). The primitives of a band are drawn in order, so that blending gives
+// the same image as drawing them one by one.
+template <typename GetColumns, typename Rasterize>
+void rasterize_in_bands(int n,
+                        int width,
+                        const GetColumns &get_columns,
+                        const Rasterize &rasterize) {
+  if (n < kMinParallelPrimitives || width <= kBandWidth) {
+    for (int k = 0; k < n; k++) {
+      rasterize(k, 0, width);
+    }
+    return;
+  }
+  const int num_bands = (width + kBandWidth - 1) / kBandWidth;
+  std::vector<Vector2i> bands(n);
+  std::vector<int> band_begin(num_bands + 1, 0);
+  for (int k = 0; k < n; k++) {
+    auto columns = get_columns(k);
+    const int i_lower = std::max(columns(0), 0);
+    const int i_higher = std::min(columns(1), width - 1);
+    if (i_lower > i_higher) {
+      bands[k] = Vector2i(0, -1);
+      continue;
+    }
+    bands[k] = Vector2i(i_lower / kBandWidth, i_higher / kBandWidth);
+    for (int band = bands[k](0); band <= bands[k](1); band++) {
+      band_begin[band + 1]++;
+    }
+  }
+  for (int band = 0; band < num_bands; band++) {
+    band_begin[band + 1] += band_begin[band];
+  }
+  std::vector<int> binned(band_begin[num_bands]);
+  std::vector<int> band_end(band_begin.begin(), band_begin.end() - 1);
+  for (int k = 0; k < n; k++) {
+    for (int band = bands[k](0); band <= bands[k](1); band++) {
+      binned[band_end[band]++] = k;
+    }
+  }
+  auto rasterize_band = [&](int band) {
+    const int i_begin = band * kBandWidth;
+    const int i_end = std::min(i_begin + kBandWidth, width);
+    for (int t = band_begin[band]; t < band_begin[band + 1]; t++) {
+      rasterize(binned[t], i_begin, i_end);
+    }
+  };
+  auto &pool = get_raster_thread_pool();
+  pool.run(num_bands, pool.max_num_threads, &rasterize_band,
+           [](void *context, int /*thread_id*/, int band) {
+             (*(decltype(rasterize_band) *)context)(band);
+           });
+}
+
+}  // namespace
+
 void Canvas::triangles_batched(int n,
                                std::size_t a_,
                                std::size_t b_,
@@ -14,14 +91,24 @@ void Canvas::triangles_batched(int n,
   auto b = (real *)b_;
   auto c = (real *)c_;
   auto color_arr = (uint32 *)color_array;
-  for (int i = 0; i < n; i++) {
-    auto clr = color_single;
-    if (color_arr) {
-      clr = color_arr[i];
-    }
-    triangle_single(a[i * 2], a[i * 2 + 1], b[i * 2], b[i * 2 + 1], c[i * 2],
-                    c[i * 2 + 1], clr);
-  }
+  auto vertices = [&](int k) {
+    return std::array<Vector2, 3>{
+        transform(Vector2(a[k * 2], a[k * 2 + 1])),
+        transform(Vector2(b[k * 2], b[k * 2 + 1])),
+        transform(Vector2(c[k * 2], c[k * 2 + 1]))};
+  };
+  rasterize_in_bands(
+      n, img.get_width(),
+      [&](int k) {
+        auto [va, vb, vc] = vertices(k);
+        return Vector2i((int)std::floor(min(va.x, min(vb.x, vc.x))),
+                        (int)std::ceil(max(va.x, max(vb.x, vc.x))) - 1);
+      },
+      [&](int k, int i_begin, int i_end) {
+        auto [va, vb, vc] = vertices(k);
+        auto color = color_from_hex(color_arr ? color_arr[k] : color_single);
+        rasterize_triangle(va, vb, vc, color, i_begin, i_end);
+      });
 }
 
 void Canvas::paths_batched(int n,
@@ -35,19 +122,24 @@ void Canvas::paths_batched(int n,
   auto b = (real *)b_;
   auto color_arr = (uint32 *)color_array;
   auto radius_arr = (real *)radius_array;
-  for (int i = 0; i < n; i++) {
-    auto r = radius_single;
-    if (radius_arr) {
-      r = radius_arr[i];
-    }
-    auto clr = color_single;
-    if (color_arr) {
-      clr = color_arr[i];
-    }
+  auto endpoints = [&](int k) {
     // FIXME: path_single seems not displaying correct without the 1e-6 term:
-    path_single(a[i * 2], a[i * 2 + 1], b[i * 2] + 1e-6 * (i % 18 + 6),
-                b[i * 2 + 1], clr, r);
-  }
+    return std::make_pair(
+        transform(Vector2(a[k * 2], a[k * 2 + 1])),
+        transform(Vector2(b[k * 2] + 1e-6 * (k % 18 + 6), b[k * 2 + 1])));
+  };
+  auto radius = [&](int k) { return radius_arr ? radius_arr[k] : radius_single; };
+  rasterize_in_bands(
+      n, img.get_width(),
+      [&](int k) {
+        auto [va, vb] = endpoints(k);
+        return stroke_columns(va, vb, radius(k));
+      },
+      [&](int k, int i_begin, int i_end) {
+        auto [va, vb] = endpoints(k);
+        auto color = color_from_hex(color_arr ? color_arr[k] : color_single);
+        rasterize_stroke(va, vb, radius(k), color, i_begin, i_end);
+      });
 }
 
 void Canvas::circles_batched(int n,
@@ -59,17 +151,20 @@ void Canvas::circles_batched(int n,
   auto x = (real *)x_;
   auto color_arr = (uint32 *)color_array;
   auto radius_arr = (real *)radius_array;
-  for (int i = 0; i < n; i++) {
-    auto r = radius_single;
-    if (radius_arr) {
-      r = radius_arr[i];
-    }
-    auto c = color_single;
-    if (color_arr) {
-      c = color_arr[i];
-    }
-    circle(x[i * 2], x[i * 2 + 1]).radius(r).color(c).finish();
-  }
+  auto center = [&](int k) { return transform(Vector2(x[k * 2], x[k * 2 + 1])); };
+  auto radius = [&](int k) { return radius_arr ? radius_arr[k] : radius_single; };
+  rasterize_in_bands(
+      n, img.get_width(),
+      [&](int k) {
+        auto center_k = center(k);
+        auto r = radius(k);
+        return Vector2i((int)std::ceil(center_k(0) - r),
+                        (int)std::floor(center_k(0) + r));
+      },
+      [&](int k, int i_begin, int i_end) {
+        auto color = color_from_hex(color_arr ? color_arr[k] : color_single);
+        rasterize_circle(center(k), radius(k), color, i_begin, i_end);
+      });
 }
 
 void Canvas::circle_single(real x, real y, uint32 color, real radius) {
@@ -86,23 +181,28 @@ void Canvas::path_single(real x0,
 }
 
 void Canvas::triangle(Vector2 a, Vector2 b, Vector2 c, Vector4 color) {
-  a = transform(a);
-  b = transform(b);
-  c = transform(c);
-
-  // real points[3] = {a, b, c};
-  // std::sort(points, points + 3, [](const Vector2 &a, const Vector2 &b) {
-  //  return a.y < b.y;
-  //});
+  rasterize_triangle(transform(a), transform(b), transform(c), color, 0,
+                     img.get_width());
+}
+
+void Canvas::rasterize_triangle(Vector2 a,
+                                Vector2 b,
+                                Vector2 c,
+                                Vector4 color,
+                                int i_begin,
+                                int i_end) {
   Vector2 limits[2];
   limits[0].x = min(a.x, min(b.x, c.x));
   limits[0].y = min(a.y, min(b.y, c.y));
   limits[1].x = max(a.x, max(b.x, c.x));
   limits[1].y = max(a.y, max(b.y, c.y));
-  for (int i = (int)std::floor(limits[0].x); i < (int)std::ceil(limits[1].x);
-       i++) {
-    for (int j = (int)std::floor(limits[0].y); j < (int)std::ceil(limits[1].y);
-         j++) {
+  const int i_lower = std::max((int)std::floor(limits[0].x), i_begin);
+  const int i_higher = std::min((int)std::ceil(limits[1].x), i_end);
+  const int j_lower = std::max((int)std::floor(limits[0].y), 0);
+  const int j_higher = std::min((int)std::ceil(limits[1].y), img.get_height());
+  for (int i = i_lower; i < i_higher; i++) {
+    auto *column = img[i];
+    for (int j = j_lower; j < j_higher; j++) {
       Vector2 pixel(i + 0.5_f, j + 0.5_f);
       bool inside_a = cross(pixel - a, b - a) <= 0;
       bool inside_b = cross(pixel - b, c - b) <= 0;
@@ -111,13 +211,77 @@ void Canvas::triangle(Vector2 a, Vector2 b, Vector2 c, Vector4 color) {
       // cover both clockwise and counterclockwise case for vertices [a, b, c]
       bool inside_triangle = (inside_a == inside_b) && (inside_a == inside_c);
 
-      if (inside_triangle && img.inside(i, j)) {
-        img[i][j] = color;
+      if (inside_triangle) {
+        column[j] = color;
       }
     }
   }
 }
 
+Vector2i Canvas::stroke_columns(Vector2 a, Vector2 b, real radius) const {
+  auto a_i = (a + Vector2(0.5_f)).template cast<int>();
+  auto b_i = (b + Vector2(0.5_f)).template cast<int>();
+  auto radius_i = (int)std::ceil(radius + 0.5_f);
+  return Vector2i(std::min(a_i.x, b_i.x) - radius_i,
+                  std::max(a_i.x, b_i.x) + radius_i);
+}
+
+void Canvas::rasterize_stroke(Vector2 a,
+                              Vector2 b,
+                              real radius,
+                              Vector4 color,
+                              int i_begin,
+                              int i_end) {
+  auto rows = stroke_columns(a, b, radius);
+  auto a_i = (a + Vector2(0.5_f)).template cast<int>();
+  auto b_i = (b + Vector2(0.5_f)).template cast<int>();
+  auto radius_i = (int)std::ceil(radius + 0.5_f);
+  const int i_lower = std::max({0, rows(0), i_begin});
+  const int i_higher = std::min({img.get_width() - 1, rows(1), i_end - 1});
+  const int j_lower = std::max(0, std::min(a_i.y, b_i.y) - radius_i);
+  const int j_higher =
+      std::min(img.get_height() - 1, std::max(a_i.y, b_i.y) + radius_i);
+  auto direction = normalized(b - a);
+  auto l = length(b - a);
+  auto tangent = Vector2(-direction.y, direction.x);
+  for (int i = i_lower; i <= i_higher; i++) {
+    auto *column = img[i];
+    for (int j = j_lower; j <= j_higher; j++) {
+      auto pixel_coord = Vector2(i + 0.5_f, j + 0.5_f) - a;
+      auto u = dot(tangent, pixel_coord);
+      auto v = dot(direction, pixel_coord);
+      if (v > 0) {
+        v = std::max(0.0_f, v - l);
+      }
+      real dist = length(Vector2(u, v));
+      auto alpha = color.w * clamp(radius - dist);
+      column[j] = lerp(alpha, column[j], color);
+    }
+  }
+}
+
+void Canvas::rasterize_circle(Vector2 center,
+                              real radius,
+                              Vector4 color,
+                              int i_begin,
+                              int i_end) {
+  const auto r = radius;
+  int i_lower = std::max(i_begin, (int)std::ceil(center(0) - r));
+  int j_lower = std::max(0, (int)std::ceil(center(1) - r));
+  int i_higher = std::min((int)std::floor(center(0) + r),
+                          std::min(img.get_width(), i_end) - 1);
+  int j_higher = std::min((int)std::floor(center(1) + r), img.get_height() - 1);
+  const auto w = color.w;
+  for (int i = i_lower; i <= i_higher; i++) {
+    auto *column = img[i];
+    for (int j = j_lower; j <= j_higher; j++) {
+      real dist = length(center - Vector2(i, j));
+      auto alpha = w * clamp(r - dist);
+      column[j] = lerp(alpha, column[j], color);
+    }
+  }
+}
+
 void Canvas::triangle_single(real x0,
                              real y0,
                              real x1,
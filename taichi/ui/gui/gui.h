@@ -184,35 +184,8 @@ class TI_DLL_EXPORT Canvas {
     // TODO: end style e.g. arrow
 
     void stroke(Vector2 a, Vector2 b) {
-      // TODO: accelerate
-      auto a_i = (a + Vector2(0.5_f)).template cast<int>();
-      auto b_i = (b + Vector2(0.5_f)).template cast<int>();
-      auto radius_i = (int)std::ceil(_radius + 0.5_f);
-      auto range_lower = Vector2i(std::min(a_i.x, b_i.x) - radius_i,
-                                  std::min(a_i.y, b_i.y) - radius_i);
-      range_lower(0) = std::max(0, range_lower(0));
-      range_lower(1) = std::max(0, range_lower(1));
-      auto range_higher = Vector2i(std::max(a_i.x, b_i.x) + radius_i,
-                                   std::max(a_i.y, b_i.y) + radius_i);
-      range_higher(0) = std::min(canvas.img.get_width() - 1, range_higher(0));
-      range_higher(1) = std::min(canvas.img.get_height() - 1, range_higher(1));
-      auto direction = normalized(b - a);
-      auto l = length(b - a);
-      auto tangent = Vector2(-direction.y, direction.x);
-      for (int i = range_lower.x; i <= range_higher.x; i++) {
-        for (int j = range_lower.y; j <= range_higher.y; j++) {
-          auto pixel_coord = Vector2(i + 0.5_f, j + 0.5_f) - a;
-          auto u = dot(tangent, pixel_coord);
-          auto v = dot(direction, pixel_coord);
-          if (v > 0) {
-            v = std::max(0.0_f, v - l);
-          }
-          real dist = length(Vector2(u, v));
-          auto alpha = _color.w * clamp(_radius - dist);
-          auto &dest = canvas.img[Vector2i(i, j)];
-          dest = lerp(alpha, dest, _color);
-        }
-      }
+      canvas.rasterize_stroke(a, b, _radius, _color, 0,
+                              canvas.img.get_width());
     }
 
     void finish() {
@@ -267,24 +240,8 @@ class TI_DLL_EXPORT Canvas {
     void finish() {
       TI_ASSERT(finished == false);
       finished = true;
-      auto center = canvas.transform(_center);
-      auto const canvas_width = canvas.img.get_width();
-      auto const canvas_height = canvas.img.get_height();
-      const auto r = _radius;
-      int i_lower = std::max(0, (int)std::ceil(center(0) - r));
-      int j_lower = std::max(0, (int)std::ceil(center(1) - r));
-      int i_higher = std::min((int)std::floor(center(0) + r), canvas_width - 1);
-      int j_higher =
-          std::min((int)std::floor(center(1) + r), canvas_height - 1);
-      const auto w = _color.w;
-      for (int i = i_lower; i <= i_higher; i++) {
-        for (int j = j_lower; j <= j_higher; j++) {
-          real dist = length(center - Vector2(i, j));
-          auto alpha = w * clamp(r - dist);
-          auto &dest = canvas.img[Vector2i(i, j)];
-          dest = lerp(alpha, dest, _color);
-        }
-      }
+      canvas.rasterize_circle(canvas.transform(_center), _radius, _color, 0,
+                              canvas.img.get_width());
     }
 
     TI_FORCE_INLINE ~Circle() {
@@ -393,6 +350,31 @@ class TI_DLL_EXPORT Canvas {
 
   void triangle(Vector2 a, Vector2 b, Vector2 c, Vector4 color);
 
+  // Rasterize a primitive in screen space, only in the columns [i_begin,
+  // i_end) of the image.
+  void rasterize_triangle(Vector2 a,
+                          Vector2 b,
+                          Vector2 c,
+                          Vector4 color,
+                          int i_begin,
+                          int i_end);
+
+  void rasterize_stroke(Vector2 a,
+                        Vector2 b,
+                        real radius,
+                        Vector4 color,
+                        int i_begin,
+                        int i_end);
+
+  void rasterize_circle(Vector2 center,
+                        real radius,
+                        Vector4 color,
+                        int i_begin,
+                        int i_end);
+
+  // The columns (inclusive) that a stroke from |a| to |b| covers.
+  Vector2i stroke_columns(Vector2 a, Vector2 b, real radius) const;
+
   void triangles_batched(int n,
                          std::size_t a_,
                          std::size_t b_,
@@ -46,10 +46,22 @@ bool Bitset::none() const {
   return !any();
 }
 
+bool Bitset::test(int x) const {
+  return (vec_[x / kBits] >> (x % kBits)) & 1;
+}
+
 Bitset::reference Bitset::operator[](int x) {
   return reference(vec_, x);
 }
 
+bool Bitset::operator==(const Bitset &other) const {
+  return vec_ == other.vec_;
+}
+
+bool Bitset::operator!=(const Bitset &other) const {
+  return vec_ != other.vec_;
+}
+
 Bitset &Bitset::operator&=(const Bitset &other) {
   const int len = vec_.size();
   TI_ASSERT(len == other.vec_.size());
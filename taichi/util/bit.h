@@ -173,7 +173,10 @@ class Bitset {
   void flip(int x);
   bool any() const;
   bool none() const;
+  bool test(int x) const;
   reference operator[](int x);
+  bool operator==(const Bitset &other) const;
+  bool operator!=(const Bitset &other) const;
   Bitset &operator&=(const Bitset &other);
   Bitset operator&(const Bitset &other) const;
   Bitset &operator|=(const Bitset &other);
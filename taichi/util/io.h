@@ -10,11 +10,14 @@
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
+#include <random>
 #include <sys/stat.h>
 
 #if defined(TI_PLATFORM_WINDOWS)
 #include <filesystem>
+#include <sys/utime.h>
 #else  // POSIX
+#include <utime.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/types.h>
@@ -56,6 +59,46 @@ inline bool remove(const std::string &path) {
   return std::remove(path.c_str()) == 0;
 }
 
+// Sets the modification time of |path| to now.
+inline bool touch_file(const std::string &path) {
+#if defined(TI_PLATFORM_WINDOWS)
+  return ::_utime(path.c_str(), nullptr) == 0;
+#else
+  return ::utime(path.c_str(), nullptr) == 0;
+#endif
+}
+
+// Writes |data| to a temporary file next to |path|, then renames it to |path|.
+// Processes reading |path| at the same time see either the old or the new
+// file, never a partial one.
+inline bool write_file_atomically(const std::string &path,
+                                  const void *data,
+                                  std::size_t size) {
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+  const auto tmp_path = fmt::format("{}.{:016x}.tmp", path, rng());
+  std::FILE *f = std::fopen(tmp_path.c_str(), "wb");
+  if (f == nullptr) {
+    return false;
+  }
+  const bool written = std::fwrite(data, 1, size, f) == size;
+  if (std::fclose(f) != 0 || !written) {
+    taichi::remove(tmp_path);
+    return false;
+  }
+#if defined(TI_PLATFORM_WINDOWS)
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  const bool renamed = !ec;
+#else
+  const bool renamed = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+  if (!renamed) {
+    taichi::remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
 template <typename Visitor>  // void(const std::string &name, bool is_dir)
 inline bool traverse_directory(const std::string &dir, Visitor v) {
 #if defined(TI_PLATFORM_WINDOWS)
@@ -78,8 +121,10 @@ inline bool traverse_directory(const std::string &dir, Visitor v) {
   while ((f = ::readdir(directory))) {
     auto fullpath = join_path(dir, f->d_name);
     struct stat stat_buf;
-    auto ret = ::stat(fullpath.c_str(), &stat_buf);
-    TI_ASSERT(ret == 0);
+    // Other processes may remove files in the meantime.
+    if (::stat(fullpath.c_str(), &stat_buf) != 0) {
+      continue;
+    }
     v(f->d_name, S_ISDIR(stat_buf.st_mode));
   }
   auto ret = ::closedir(directory);
@@ -2,11 +2,14 @@
 
 #include "taichi/common/cleanup.h"
 #include "taichi/common/core.h"
+#include <chrono>
+#include <ctime>
 #include <thread>
 
 #if defined(TI_PLATFORM_WINDOWS)
 #include <io.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #else  // POSIX
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -55,6 +58,32 @@ inline bool lock_with_file(const std::string &path,
   return false;
 }
 
+// Takes the lease file |path|, which tells other processes that this one is
+// producing what the lease is for. While another process holds it, waits for
+// up to |timeout_ms| for it to be released. A lease older than |timeout_ms| is
+// left by a process that died, and is taken over. Returns false on timeout.
+// The lease is released with unlock_with_file().
+inline bool acquire_file_lease(const std::string &path, int timeout_ms) {
+  constexpr int kPollMs = 20;
+  const auto start = std::chrono::steady_clock::now();
+  while (!try_lock_with_file(path)) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 &&
+        std::time(nullptr) > st.st_mtime + (timeout_ms + 999) / 1000) {
+      TI_DEBUG("Taking over the stale lease {}", path);
+      unlock_with_file(path);
+      continue;
+    }
+    const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    if (waited.count() >= timeout_ms) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+  }
+  return true;
+}
+
 inline RaiiCleanup make_unlocker(const std::string &path) {
   return make_cleanup([&path]() {
     if (!unlock_with_file(path)) {
@@ -14,6 +14,12 @@ void disable_offline_cache_if_needed(CompileConfig *config) {
       TI_WARN(
           "Disable offline_cache because print_preprocessed_ir or print_ir or "
           "print_accessor_ir is enabled");
+    } else if (config->pgo_instrument || config->pgo_use) {
+      // The cached kernels would not pick up the changes to the profiles.
+      config->offline_cache = false;
+      TI_WARN(
+          "Disable offline_cache because pgo_instrument or pgo_use is "
+          "enabled");
     }
   }
 }
@@ -93,8 +99,14 @@ std::size_t clean_offline_cache_files(const std::string &path) {
   auto is_cache_filename = [](const std::string &name) {
     const auto ext = taichi::filename_extension(name);
     return ext == kLlvmCacheFilenameBCExt || ext == kLlvmCacheFilenameLLExt ||
+           ext == kLlvmCacheFilenamePackExt ||
+           ext == kLlvmCacheFilenameKernelPackExt ||
+           ext == kLlvmCacheFilenameNativeExt ||
+           ext == kLlvmCacheFilenameLeaseExt || ext == "tmp" ||
            ext == kSpirvCacheFilenameExt || ext == kMetalCacheFilenameExt ||
-           ext == "lock" || ext == "tcb";
+           ext == "lock" || ext == "tcb" ||
+           // Pipeline caches of the RHI
+           ext == "bin";
   };
 
   std::size_t count = 0;
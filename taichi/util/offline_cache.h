@@ -2,6 +2,7 @@
 
 #include <ctime>
 #include <cstdint>
+#include <memory>
 #include <queue>
 #include <string>
 #include <type_traits>
@@ -9,6 +10,7 @@
 
 #include "taichi/common/core.h"
 #include "taichi/common/cleanup.h"
+#include "taichi/common/mapped_file.h"
 #include "taichi/common/version.h"
 #include "taichi/rhi/arch.h"
 #include "taichi/util/io.h"
@@ -20,6 +22,10 @@ namespace offline_cache {
 
 constexpr char kLlvmCacheFilenameLLExt[] = "ll";
 constexpr char kLlvmCacheFilenameBCExt[] = "bc";
+constexpr char kLlvmCacheFilenamePackExt[] = "pack";
+constexpr char kLlvmCacheFilenameNativeExt[] = "native";
+constexpr char kLlvmCacheFilenameKernelPackExt[] = "kpack";
+constexpr char kLlvmCacheFilenameLeaseExt[] = "lease";
 constexpr char kSpirvCacheFilenameExt[] = "spv";
 constexpr char kMetalCacheFilenameExt[] = "metal";
 constexpr char kLlvmCachSubPath[] = "llvm";
@@ -85,10 +91,13 @@ inline LoadMetadataError load_metadata_with_checking(
 
   using VerType = std::remove_reference_t<decltype(result.version)>;
   static_assert(std::is_same_v<VerType, Version>);
-  const std::vector<uint8> bytes = read_data_from_file(filepath);
+  const auto file = io::MappedFile::create(filepath);
+  if (file == nullptr) {
+    return LoadMetadataError::kCorrupted;
+  }
 
   VerType ver{};
-  if (!read_from_binary(ver, bytes.data(), bytes.size(), false)) {
+  if (!read_from_binary(ver, file->data(), file->size(), false)) {
     return LoadMetadataError::kCorrupted;
   }
   if (ver[0] != TI_VERSION_MAJOR || ver[1] != TI_VERSION_MINOR ||
@@ -98,7 +107,7 @@ inline LoadMetadataError load_metadata_with_checking(
     return LoadMetadataError::kVersionNotMatched;
   }
 
-  return !read_from_binary(result, bytes.data(), bytes.size())
+  return !read_from_binary(result, file->data(), file->size())
              ? LoadMetadataError::kCorrupted
              : LoadMetadataError::kNoError;
 }
@@ -293,6 +302,37 @@ class CacheCleaner {
   }
 };
 
+// A store of offline cache files shared by the machines of a cluster, so that
+// the kernels compiled on one of them are loaded by the others. It is looked
+// up when a kernel is not in the local cache, and the kernels compiled locally
+// are put there. Keys are relative paths made by make_remote_cache_key().
+class CacheStorage {
+ public:
+  virtual ~CacheStorage() = default;
+
+  // Returns false if |key| is not in the store, or it can't be reached.
+  virtual bool get(const std::string &key, std::string &bytes) = 0;
+  // Replaces the value of |key|, if any.
+  virtual bool put(const std::string &key,
+                   const void *data,
+                   std::size_t size) = 0;
+};
+
+// Makes the store of offline_cache_remote_url:
+//   file://<directory>          A directory, e.g. on a network file system.
+//   http://<host>[:<port>][/<prefix>]
+//                               A server that answers GET and PUT requests,
+//                               e.g. a WebDAV share or an object store.
+// Returns nullptr if |url| is empty or not supported.
+std::unique_ptr<CacheStorage> make_cache_storage(const std::string &url);
+
+// The key of the file |name| of the cache of |subdir|. Caches of other
+// versions of Taichi are kept apart. |device| identifies the device the file
+// was compiled for, if it depends on more than the kernel key.
+std::string make_remote_cache_key(const std::string &subdir,
+                                  const std::string &name,
+                                  const std::string &device = "");
+
 void disable_offline_cache_if_needed(CompileConfig *config);
 std::string get_cache_path_by_arch(const std::string &base_path, Arch arch);
 std::string mangle_name(const std::string &primal_name, const std::string &key);
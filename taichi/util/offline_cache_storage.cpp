@@ -0,0 +1,264 @@
+#include "taichi/util/offline_cache.h"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(TI_PLATFORM_UNIX)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace taichi::lang::offline_cache {
+namespace {
+
+constexpr char kFileUrlScheme[] = "file://";
+constexpr char kHttpUrlScheme[] = "http://";
+
+bool starts_with(const std::string &str, const char *prefix) {
+  return str.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+class FileCacheStorage : public CacheStorage {
+ public:
+  explicit FileCacheStorage(const std::string &root) : root_(root) {
+  }
+
+  bool get(const std::string &key, std::string &bytes) override {
+    std::ifstream ifs(taichi::join_path(root_, key), std::ios::binary);
+    if (!ifs) {
+      return false;
+    }
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    bytes = oss.str();
+    return !bytes.empty();
+  }
+
+  bool put(const std::string &key,
+           const void *data,
+           std::size_t size) override {
+    const auto path = taichi::join_path(root_, key);
+    taichi::create_directories(path.substr(0, path.find_last_of("/\\")));
+    // Other machines may be reading the file.
+    return taichi::write_file_atomically(path, data, size);
+  }
+
+ private:
+  std::string root_;
+};
+
+#if defined(TI_PLATFORM_UNIX)
+// A minimal HTTP/1.1 client: one connection per request, no TLS, no redirects.
+class HttpCacheStorage : public CacheStorage {
+ public:
+  HttpCacheStorage(const std::string &host,
+                   const std::string &port,
+                   const std::string &prefix)
+      : host_(host), port_(port), prefix_(prefix) {
+  }
+
+  bool get(const std::string &key, std::string &bytes) override {
+    std::string request = fmt::format(
+        "GET {}/{} HTTP/1.1\r\nHost: {}\r\nConnection: close\r\n\r\n", prefix_,
+        key, host_);
+    return request_and_check(request, nullptr, 0, &bytes) && !bytes.empty();
+  }
+
+  bool put(const std::string &key,
+           const void *data,
+           std::size_t size) override {
+    std::string request = fmt::format(
+        "PUT {}/{} HTTP/1.1\r\nHost: {}\r\nContent-Length: {}\r\n"
+        "Content-Type: application/octet-stream\r\nConnection: close\r\n\r\n",
+        prefix_, key, host_, size);
+    return request_and_check(request, data, size, nullptr);
+  }
+
+ private:
+  bool request_and_check(const std::string &header,
+                         const void *data,
+                         std::size_t size,
+                         std::string *body) {
+    if (unreachable_) {
+      return false;
+    }
+    std::string response;
+    if (!send_request(header, data, size, response)) {
+      // Don't wait for the timeouts again for each kernel.
+      TI_WARN("The offline cache server {}:{} can't be reached", host_, port_);
+      unreachable_ = true;
+      return false;
+    }
+    int status = 0;
+    if (std::sscanf(response.c_str(), "HTTP/%*d.%*d %d", &status) != 1) {
+      return false;
+    }
+    const auto header_end = response.find("\r\n\r\n");
+    if (status < 200 || status >= 300 || header_end == std::string::npos) {
+      return false;
+    }
+    if (body != nullptr) {
+      const auto headers = response.substr(0, header_end);
+      *body = response.substr(header_end + 4);
+      if (headers.find("chunked") != std::string::npos &&
+          !decode_chunked(*body)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool send_request(const std::string &header,
+                    const void *data,
+                    std::size_t size,
+                    std::string &response) const {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addrs = nullptr;
+    if (::getaddrinfo(host_.c_str(), port_.c_str(), &hints, &addrs) != 0) {
+      return false;
+    }
+    int fd = -1;
+    for (auto *a = addrs; a != nullptr && fd < 0; a = a->ai_next) {
+      fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd < 0) {
+        continue;
+      }
+      timeval timeout{kTimeoutSeconds, 0};
+      ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#if defined(SO_NOSIGPIPE)
+      int on = 1;
+      ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+      if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    ::freeaddrinfo(addrs);
+    if (fd < 0) {
+      return false;
+    }
+    const bool sent = send_all(fd, header.data(), header.size()) &&
+                      send_all(fd, data, size);
+    if (sent) {
+      char buf[1 << 16];
+      ssize_t n = 0;
+      while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, n);
+      }
+    }
+    ::close(fd);
+    return sent && !response.empty();
+  }
+
+  static bool send_all(int fd, const void *data, std::size_t size) {
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+#if defined(MSG_NOSIGNAL)
+      const ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+#else
+      const ssize_t n = ::send(fd, p, size, 0);
+#endif
+      if (n <= 0) {
+        return false;
+      }
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  static bool decode_chunked(std::string &body) {
+    std::string decoded;
+    std::size_t pos = 0;
+    while (true) {
+      const auto line_end = body.find("\r\n", pos);
+      if (line_end == std::string::npos) {
+        return false;
+      }
+      const auto chunk_size =
+          std::strtoull(body.c_str() + pos, nullptr, /*base=*/16);
+      pos = line_end + 2;
+      if (chunk_size == 0) {
+        break;
+      }
+      if (pos + chunk_size > body.size()) {
+        return false;
+      }
+      decoded.append(body, pos, chunk_size);
+      pos += chunk_size + 2;
+    }
+    body = std::move(decoded);
+    return true;
+  }
+
+  static constexpr int kTimeoutSeconds = 10;
+
+  std::string host_;
+  std::string port_;
+  std::string prefix_;
+  std::atomic<bool> unreachable_{false};
+};
+#endif
+
+}  // namespace
+
+std::unique_ptr<CacheStorage> make_cache_storage(const std::string &url) {
+  if (url.empty()) {
+    return nullptr;
+  }
+  if (starts_with(url, kFileUrlScheme)) {
+    return std::make_unique<FileCacheStorage>(
+        url.substr(std::strlen(kFileUrlScheme)));
+  }
+  if (starts_with(url, kHttpUrlScheme)) {
+#if defined(TI_PLATFORM_UNIX)
+    auto rest = url.substr(std::strlen(kHttpUrlScheme));
+    std::string prefix;
+    if (const auto slash = rest.find('/'); slash != std::string::npos) {
+      prefix = rest.substr(slash);
+      rest = rest.substr(0, slash);
+    }
+    while (!prefix.empty() && prefix.back() == '/') {
+      prefix.pop_back();
+    }
+    std::string port = "80";
+    if (const auto colon = rest.find(':'); colon != std::string::npos) {
+      port = rest.substr(colon + 1);
+      rest = rest.substr(0, colon);
+    }
+    return std::make_unique<HttpCacheStorage>(rest, port, prefix);
+#else
+    TI_WARN("HTTP offline cache servers are not supported on this platform");
+    return nullptr;
+#endif
+  }
+  TI_WARN("Unsupported offline_cache_remote_url: {}", url);
+  return nullptr;
+}
+
+std::string make_remote_cache_key(const std::string &subdir,
+                                  const std::string &name,
+                                  const std::string &device) {
+  auto prefix = fmt::format("{}.{}.{}/{}/", TI_VERSION_MAJOR, TI_VERSION_MINOR,
+                            TI_VERSION_PATCH, subdir);
+  if (device.empty()) {
+    return prefix + name;
+  }
+  // FNV-1a, so that keys only contain characters which are safe in paths and
+  // URLs.
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : device) {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  return fmt::format("{}{:016x}/{}", prefix, hash, name);
+}
+
+}  // namespace taichi::lang::offline_cache
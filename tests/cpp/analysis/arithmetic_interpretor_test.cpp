@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include "taichi/analysis/arithmetic_interpretor.h"
+
+namespace taichi::lang {
+
+using EvalOptions = ArithmeticInterpretor::EvalOptions;
+
+TEST(ArithmeticInterpretor, EvalIntegerBinaryOps) {
+  auto eval = [](BinaryOpType op, int32 a, int32 b) {
+    return ArithmeticInterpretor::eval_binary_op(
+        op, PrimitiveType::i32, TypedConstant(a), TypedConstant(b),
+        EvalOptions());
+  };
+  EXPECT_EQ(eval(BinaryOpType::add, 3, 4)->val_i32, 7);
+  EXPECT_EQ(eval(BinaryOpType::mul, 1 << 30, 4)->val_i32, 0);
+  EXPECT_EQ(eval(BinaryOpType::div, -7, 2)->val_i32, -3);
+  EXPECT_EQ(eval(BinaryOpType::floordiv, -7, 2)->val_i32, -4);
+  EXPECT_EQ(eval(BinaryOpType::mod, -7, 2)->val_i32, -1);
+  EXPECT_EQ(eval(BinaryOpType::bit_shr, -1, 28)->val_i32, 15);
+  EXPECT_EQ(eval(BinaryOpType::bit_sar, -16, 2)->val_i32, -4);
+  EXPECT_EQ(eval(BinaryOpType::cmp_lt, 1, 2)->val_i32, -1);
+  EXPECT_EQ(eval(BinaryOpType::cmp_ge, 1, 2)->val_i32, 0);
+  EXPECT_EQ(eval(BinaryOpType::pow, 3, 4)->val_i32, 81);
+
+  // Undefined on the device, so these are left to the runtime.
+  EXPECT_FALSE(eval(BinaryOpType::div, 1, 0).has_value());
+  EXPECT_FALSE(eval(BinaryOpType::mod, 1, 0).has_value());
+  EXPECT_FALSE(eval(BinaryOpType::bit_shl, 1, 32).has_value());
+}
+
+TEST(ArithmeticInterpretor, EvalOverflowInDebugMode) {
+  EvalOptions options;
+  options.check_overflow = true;
+  auto sum = ArithmeticInterpretor::eval_binary_op(
+      BinaryOpType::add, PrimitiveType::i32, TypedConstant(int32(1 << 30)),
+      TypedConstant(int32(1 << 30)), options);
+  EXPECT_FALSE(sum.has_value());
+}
+
+TEST(ArithmeticInterpretor, EvalRealOps) {
+  auto eval = [](BinaryOpType op, float32 a, float32 b, bool host_math) {
+    EvalOptions options;
+    options.host_math = host_math;
+    return ArithmeticInterpretor::eval_binary_op(
+        op, PrimitiveType::f32, TypedConstant(a), TypedConstant(b), options);
+  };
+  EXPECT_EQ(eval(BinaryOpType::div, 1.0f, 3.0f, false)->val_f32, 1.0f / 3.0f);
+  EXPECT_EQ(eval(BinaryOpType::floordiv, -7.0f, 2.0f, false)->val_f32, -4.0f);
+  EXPECT_EQ(eval(BinaryOpType::max, NAN, 2.0f, false)->val_f32, 2.0f);
+  EXPECT_FALSE(eval(BinaryOpType::pow, 2.0f, 0.5f, false).has_value());
+  EXPECT_EQ(eval(BinaryOpType::pow, 2.0f, 0.5f, true)->val_f32,
+            std::pow(2.0f, 0.5f));
+
+  auto ne = ArithmeticInterpretor::eval_binary_op(
+      BinaryOpType::cmp_ne, PrimitiveType::i32, TypedConstant(float32(NAN)),
+      TypedConstant(1.0f), EvalOptions());
+  EXPECT_EQ(ne->val_i32, 0);
+
+  auto pow = ArithmeticInterpretor::eval_binary_op(
+      BinaryOpType::pow, PrimitiveType::f32, TypedConstant(2.0f),
+      TypedConstant(int32(-2)), EvalOptions());
+  EXPECT_EQ(pow->val_f32, 0.25f);
+}
+
+TEST(ArithmeticInterpretor, EvalUnaryOps) {
+  auto cast = [](DataType to, const TypedConstant &val) {
+    return ArithmeticInterpretor::eval_unary_op(UnaryOpType::cast_value, to,
+                                                to, val, EvalOptions());
+  };
+  // Rounded once from i64, not through f64.
+  const int64 big = (1LL << 60) + (1LL << 36) + 1;
+  EXPECT_EQ(cast(PrimitiveType::f32, TypedConstant(big))->val_f32,
+            float32(big));
+  EXPECT_EQ(cast(PrimitiveType::i32, TypedConstant(-2.5f))->val_i32, -2);
+  EXPECT_EQ(cast(PrimitiveType::u32, TypedConstant(int32(-1)))->val_u32,
+            0xffffffffu);
+  EXPECT_FALSE(cast(PrimitiveType::i32, TypedConstant(3e9f)).has_value());
+  EXPECT_FALSE(
+      cast(PrimitiveType::i32, TypedConstant(float32(NAN))).has_value());
+
+  auto bits = ArithmeticInterpretor::eval_unary_op(
+      UnaryOpType::cast_bits, PrimitiveType::i32, PrimitiveType::i32,
+      TypedConstant(1.0f), EvalOptions());
+  EXPECT_EQ(bits->val_i32, 0x3f800000);
+
+  auto round = ArithmeticInterpretor::eval_unary_op(
+      UnaryOpType::round, PrimitiveType::f32, PrimitiveType::unknown,
+      TypedConstant(-2.5f), EvalOptions());
+  EXPECT_EQ(round->val_f32, -3.0f);
+
+  auto popcnt = ArithmeticInterpretor::eval_unary_op(
+      UnaryOpType::popcnt, PrimitiveType::i32, PrimitiveType::unknown,
+      TypedConstant(int32(-1)), EvalOptions());
+  EXPECT_EQ(popcnt->val_i32, 32);
+
+  auto sin = ArithmeticInterpretor::eval_unary_op(
+      UnaryOpType::sin, PrimitiveType::f32, PrimitiveType::unknown,
+      TypedConstant(1.0f), EvalOptions());
+  EXPECT_FALSE(sin.has_value());
+}
+
+}  // namespace taichi::lang
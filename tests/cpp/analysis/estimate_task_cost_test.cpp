@@ -0,0 +1,117 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/program/compile_config.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi::lang {
+namespace {
+
+class EstimateTaskCostTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    dense_ = &root_snode_->dense(Axis{0}, /*size=*/8, "");
+    x_ = &(dense_->insert_children(SNodeType::place));
+    x_->dt = PrimitiveType::f32;
+    y_ = &(dense_->insert_children(SNodeType::place));
+    y_->dt = PrimitiveType::f32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+    root_ = std::make_unique<Block>();
+  }
+
+  OffloadedStmt *add_task(OffloadedTaskType task_type) {
+    auto *task = root_->insert(std::make_unique<OffloadedStmt>(
+                                   /*task_type=*/task_type,
+                                   /*arch=*/Arch::x64))
+                     ->as<OffloadedStmt>();
+    builder_.set_insertion_point({/*block=*/task->body.get(), /*position=*/0});
+    return task;
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *dense_{nullptr};
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  std::unique_ptr<Block> root_{nullptr};
+
+  IRBuilder builder_;
+};
+
+TEST_F(EstimateTaskCostTest, RangeFor) {
+  auto *task = add_task(OffloadedTaskType::range_for);
+  task->const_begin = task->const_end = true;
+  task->begin_value = 0;
+  task->end_value = 1024;
+  auto *i = builder_.get_loop_index(task, /*index=*/0);
+  // y[i] = x[i] * 2 + 1, with a comparison that isn't a FLOP.
+  auto *x = builder_.create_global_load(builder_.create_global_ptr(x_, {i}));
+  builder_.create_cmp_lt(x, builder_.get_float32(0));
+  builder_.create_global_store(
+      builder_.create_global_ptr(y_, {i}),
+      builder_.create_add(builder_.create_mul(x, builder_.get_float32(2)),
+                          builder_.get_float32(1)));
+  // for j in range(4): y[i] += x[i]
+  auto *inner =
+      builder_.create_range_for(builder_.get_int32(0), builder_.get_int32(4));
+  {
+    auto _ = builder_.get_loop_guard(inner);
+    builder_.create_atomic_add(
+        builder_.create_global_ptr(y_, {i}),
+        builder_.create_global_load(builder_.create_global_ptr(x_, {i})));
+  }
+  // Local variables aren't memory traffic.
+  auto *sum = builder_.create_local_var(PrimitiveType::f32);
+  builder_.create_atomic_add(sum, x);
+  irpass::type_check(root_.get(), CompileConfig());
+
+  auto cost = irpass::analysis::estimate_task_cost(task);
+  EXPECT_EQ(cost.num_iterations, 1024);
+  EXPECT_EQ(cost.bytes_per_iteration, 4 + 4 + 4 * (4 + 4 + 4));
+  EXPECT_EQ(cost.flops_per_iteration, 2 + 4 + 1);
+  EXPECT_FALSE(cost.is_lower_bound);
+}
+
+TEST_F(EstimateTaskCostTest, UnknownTripCount) {
+  auto *task = add_task(OffloadedTaskType::serial);
+  auto *loop = builder_.create_while_true();
+  {
+    auto _ = builder_.get_loop_guard(loop);
+    builder_.create_global_store(
+        builder_.create_global_ptr(y_, {builder_.get_int32(0)}),
+        builder_.get_float32(1));
+  }
+  irpass::type_check(root_.get(), CompileConfig());
+
+  auto cost = irpass::analysis::estimate_task_cost(task);
+  EXPECT_EQ(cost.num_iterations, 1);
+  EXPECT_EQ(cost.bytes_per_iteration, 4);
+  EXPECT_EQ(cost.flops_per_iteration, 0);
+  EXPECT_TRUE(cost.is_lower_bound);
+}
+
+TEST_F(EstimateTaskCostTest, DenseStructFor) {
+  auto *task = add_task(OffloadedTaskType::struct_for);
+  task->snode = dense_;
+  auto *i = builder_.get_loop_index(task, /*index=*/0);
+  builder_.create_global_store(builder_.create_global_ptr(y_, {i}),
+                               builder_.get_float32(1));
+  irpass::type_check(root_.get(), CompileConfig());
+
+  auto cost = irpass::analysis::estimate_task_cost(task);
+  EXPECT_EQ(cost.num_iterations, 8);
+  EXPECT_EQ(cost.bytes_per_iteration, 4);
+
+  auto *range = add_task(OffloadedTaskType::range_for);
+  EXPECT_EQ(irpass::analysis::estimate_task_cost(range).num_iterations, -1);
+}
+
+}  // namespace
+}  // namespace taichi::lang
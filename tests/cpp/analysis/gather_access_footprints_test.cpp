@@ -0,0 +1,98 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi::lang {
+namespace {
+
+class GatherAccessFootprintsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const std::vector<Axis> axes = {Axis{0}, Axis{1}};
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    auto &dense = root_snode_->dense(axes, /*sizes=*/8, "");
+    x_ = &(dense.insert_children(SNodeType::place));
+    x_->dt = PrimitiveType::i32;
+    y_ = &(dense.insert_children(SNodeType::place));
+    y_->dt = PrimitiveType::i32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+
+    root_ = std::make_unique<Block>();
+    for_stmt_ = root_->insert(std::make_unique<OffloadedStmt>(
+                                  /*task_type=*/OffloadedTaskType::struct_for,
+                                  /*arch=*/Arch::x64))
+                    ->as<OffloadedStmt>();
+    builder_.set_insertion_point(
+        {/*block=*/for_stmt_->body.get(), /*position=*/0});
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  std::unique_ptr<Block> root_{nullptr};
+  OffloadedStmt *for_stmt_{nullptr};
+
+  IRBuilder builder_;
+};
+
+TEST_F(GatherAccessFootprintsTest, Stencil) {
+  auto *i = builder_.get_loop_index(for_stmt_, /*index=*/0);
+  auto *j = builder_.get_loop_index(for_stmt_, /*index=*/1);
+  // y[i, j] = x[i - 1, j] + x[i + 2, j * 2]
+  auto *left = builder_.create_global_load(builder_.create_global_ptr(
+      x_, {builder_.create_sub(i, builder_.get_int32(1)), j}));
+  auto *right = builder_.create_global_load(builder_.create_global_ptr(
+      x_, {builder_.create_add(i, builder_.get_int32(2)),
+           builder_.create_mul(j, builder_.get_int32(2))}));
+  builder_.create_global_store(builder_.create_global_ptr(y_, {i, j}),
+                               builder_.create_add(left, right));
+
+  auto footprints = irpass::analysis::gather_access_footprints(root_.get());
+  ASSERT_EQ(footprints.size(), 1);
+  const auto &x = footprints[0].at(x_);
+  ASSERT_EQ(x.reads.size(), 2);
+  EXPECT_TRUE(x.reads[0].linear_related());
+  EXPECT_EQ(x.reads[0].low, -1);
+  EXPECT_EQ(x.reads[0].high, 3);
+  EXPECT_FALSE(x.reads[1].related());
+  EXPECT_TRUE(x.writes.empty());
+
+  const auto &y = footprints[0].at(y_);
+  EXPECT_TRUE(y.reads.empty());
+  ASSERT_EQ(y.writes.size(), 2);
+  EXPECT_EQ(y.writes[0].low, 0);
+  EXPECT_EQ(y.writes[0].high, 1);
+  EXPECT_EQ(y.writes[1].low, 0);
+  EXPECT_EQ(y.writes[1].high, 1);
+}
+
+TEST_F(GatherAccessFootprintsTest, Offsets) {
+  x_->set_index_offsets({-4, 0});
+  for_stmt_->index_offsets = {2, 0};
+  auto *i = builder_.get_loop_index(for_stmt_, /*index=*/0);
+  auto *j = builder_.get_loop_index(for_stmt_, /*index=*/1);
+  // The loop index i is 2 below the index of the program, and the index of
+  // x is 4 above it, so this is x[i + 1, j] in the program.
+  builder_.create_atomic_add(
+      builder_.create_global_ptr(
+          x_, {builder_.create_add(i, builder_.get_int32(7)), j}),
+      builder_.get_int32(1));
+
+  auto footprints = irpass::analysis::gather_access_footprints(root_.get());
+  const auto &x = footprints[0].at(x_);
+  EXPECT_EQ(x.reads[0].low, 1);
+  EXPECT_EQ(x.reads[0].high, 2);
+  EXPECT_EQ(x.reads[1].low, 0);
+  ASSERT_EQ(x.writes.size(), 2);
+  EXPECT_EQ(x.writes[0].low, 1);
+}
+
+}  // namespace
+}  // namespace taichi::lang
@@ -0,0 +1,59 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi::lang {
+namespace {
+
+class GatherUniquelyAccessedPointersTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // ti.root.dense(ti.i, 16).place(x, y)
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    auto &dense = root_snode_->dense({Axis{0}}, /*sizes=*/16, "");
+    x_ = &(dense.insert_children(SNodeType::place));
+    x_->dt = PrimitiveType::i32;
+    y_ = &(dense.insert_children(SNodeType::place));
+    y_->dt = PrimitiveType::i32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+
+    for_stmt_ = std::make_unique<OffloadedStmt>(
+        /*task_type=*/OffloadedTaskType::range_for, /*arch=*/Arch::x64);
+    builder_.set_insertion_point(
+        {/*block=*/for_stmt_->body.get(), /*position=*/0});
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  std::unique_ptr<OffloadedStmt> for_stmt_{nullptr};
+
+  IRBuilder builder_;
+};
+
+TEST_F(GatherUniquelyAccessedPointersTest, ScaledLoopIndex) {
+  // x[i * 2 + 1] += 1; y[i * 0] += 1
+  auto *i = builder_.get_loop_index(for_stmt_.get());
+  auto *one = builder_.get_int32(1);
+  auto *x_index = builder_.create_add(
+      builder_.create_mul(i, builder_.get_int32(2)), one);
+  builder_.create_atomic_add(builder_.create_global_ptr(x_, {x_index}), one);
+  auto *y_index = builder_.create_mul(builder_.get_int32(0), i);
+  builder_.create_atomic_add(builder_.create_global_ptr(y_, {y_index}), one);
+
+  auto unique_ptrs =
+      irpass::analysis::gather_uniquely_accessed_pointers(for_stmt_.get())
+          .first;
+  EXPECT_NE(unique_ptrs[x_], nullptr);
+  EXPECT_EQ(unique_ptrs[y_], nullptr);
+}
+
+}  // namespace
+}  // namespace taichi::lang
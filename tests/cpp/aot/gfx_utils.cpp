@@ -47,7 +47,9 @@ void view_devalloc_as_ndarray(Device *device_) {
   device_->dealloc_memory(devalloc_arr_);
 }
 
-void run_dense_field_kernel(Arch arch, taichi::lang::Device *device) {
+void run_dense_field_kernel(Arch arch,
+                            taichi::lang::Device *device,
+                            bool prefetch) {
   // API based on proposal https://github.com/taichi-dev/taichi/issues/3642
   // Initialize program
   taichi::uint64 *result_buffer{nullptr};
@@ -70,6 +72,7 @@ void run_dense_field_kernel(Arch arch, taichi::lang::Device *device) {
   gfx::AotModuleParams mod_params;
   mod_params.module_path = ss.str();
   mod_params.runtime = gfx_runtime.get();
+  mod_params.enable_lazy_loading = prefetch;
 
   std::unique_ptr<aot::Module> vk_module = aot::Module::load(arch, mod_params);
   EXPECT_TRUE(vk_module);
@@ -78,6 +81,11 @@ void run_dense_field_kernel(Arch arch, taichi::lang::Device *device) {
   auto root_size = vk_module->get_root_size();
   EXPECT_EQ(root_size, 40);
   gfx_runtime->add_root_buffer(root_size);
+  if (prefetch) {
+    vk_module->prefetch_kernels({"simple_ret", "init", "ret", "ret2"});
+    // `ret2` is not in the module.
+    EXPECT_EQ(vk_module->get_prefetch_progress().num_kernels, 3);
+  }
 
   auto simple_ret_kernel = vk_module->get_kernel("simple_ret");
   EXPECT_TRUE(simple_ret_kernel);
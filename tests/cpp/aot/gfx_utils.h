@@ -27,7 +27,8 @@ void view_devalloc_as_ndarray(Device *device_);
 [[maybe_unused]] void run_kernel_test2(Arch arch, taichi::lang::Device *device);
 
 [[maybe_unused]] void run_dense_field_kernel(Arch arch,
-                                             taichi::lang::Device *device);
+                                             taichi::lang::Device *device,
+                                             bool prefetch = false);
 
 [[maybe_unused]] void run_mpm88_graph(Arch arch, taichi::lang::Device *device_);
 }  // namespace aot_test_utils
@@ -11,6 +11,7 @@
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/platform/cuda/detect_cuda.h"
 #include "taichi/runtime/cuda/aot_module_loader_impl.h"
+#include "taichi/runtime/cuda/jit_cuda.h"
 
 #endif
 
@@ -65,58 +66,101 @@ TEST(LlvmAotTest, CpuKernel) {
   }
 }
 
+#ifdef TI_WITH_CUDA
+namespace {
+
+void run_cuda_kernel_aot_test() {
+  CompileConfig cfg;
+  cfg.arch = Arch::cuda;
+  cfg.kernel_profiler = false;
+  constexpr KernelProfilerBase *kNoProfiler = nullptr;
+  LlvmRuntimeExecutor exec{cfg, kNoProfiler};
+
+  // Must have handled all the arch fallback logic by this point.
+  uint64 *result_buffer{nullptr};
+  exec.materialize_runtime(nullptr, kNoProfiler, &result_buffer);
+
+  constexpr int kArrLen = 32;
+  constexpr int kArrBytes = kArrLen * sizeof(int32_t);
+  auto arr_devalloc = exec.allocate_memory_ndarray(kArrBytes, result_buffer);
+  Ndarray arr = Ndarray(arr_devalloc, PrimitiveType::i32, {kArrLen});
+
+  cuda::AotModuleParams aot_params;
+  const auto folder_dir = getenv("TAICHI_AOT_FOLDER_PATH");
+
+  std::stringstream aot_mod_ss;
+  aot_mod_ss << folder_dir;
+  aot_params.module_path = aot_mod_ss.str();
+  aot_params.executor_ = &exec;
+  auto mod = cuda::make_aot_module(aot_params);
+  auto *k_run = mod->get_kernel("run");
+  RuntimeContext ctx;
+  ctx.runtime = exec.get_llvm_runtime();
+  ctx.set_arg(0, /*v=*/0);
+  ctx.set_arg_ndarray(/*arg_id=*/1, arr.get_device_allocation_ptr_as_int(),
+                      /*shape=*/arr.shape);
+  std::vector<int> vec = {1, 2, 3};
+  for (int i = 0; i < vec.size(); ++i) {
+    ctx.set_arg(/*arg_id=*/i + 2, vec[i]);
+  }
+  k_run->launch(&ctx);
+
+  auto *data = reinterpret_cast<int32_t *>(
+      exec.get_ndarray_alloc_info_ptr(arr_devalloc));
+
+  std::vector<int32_t> cpu_data(kArrLen);
+  CUDADriver::get_instance().memcpy_device_to_host(
+      (void *)cpu_data.data(), (void *)data, kArrLen * sizeof(int32_t));
+
+  for (int i = 0; i < kArrLen; ++i) {
+    EXPECT_EQ(cpu_data[i], i + vec[0]);
+  }
+}
+
+}  // namespace
+#endif
+
 TEST(LlvmAotTest, CudaKernel) {
 #ifdef TI_WITH_CUDA
   if (is_cuda_api_available()) {
-    CompileConfig cfg;
-    cfg.arch = Arch::cuda;
-    cfg.kernel_profiler = false;
-    constexpr KernelProfilerBase *kNoProfiler = nullptr;
-    LlvmRuntimeExecutor exec{cfg, kNoProfiler};
-
-    // Must have handled all the arch fallback logic by this point.
-    uint64 *result_buffer{nullptr};
-    exec.materialize_runtime(nullptr, kNoProfiler, &result_buffer);
-
-    constexpr int kArrLen = 32;
-    constexpr int kArrBytes = kArrLen * sizeof(int32_t);
-    auto arr_devalloc = exec.allocate_memory_ndarray(kArrBytes, result_buffer);
-    Ndarray arr = Ndarray(arr_devalloc, PrimitiveType::i32, {kArrLen});
-
-    cuda::AotModuleParams aot_params;
-    const auto folder_dir = getenv("TAICHI_AOT_FOLDER_PATH");
-
-    std::stringstream aot_mod_ss;
-    aot_mod_ss << folder_dir;
-    aot_params.module_path = aot_mod_ss.str();
-    aot_params.executor_ = &exec;
-    auto mod = cuda::make_aot_module(aot_params);
-    auto *k_run = mod->get_kernel("run");
-    RuntimeContext ctx;
-    ctx.runtime = exec.get_llvm_runtime();
-    ctx.set_arg(0, /*v=*/0);
-    ctx.set_arg_ndarray(/*arg_id=*/1, arr.get_device_allocation_ptr_as_int(),
-                        /*shape=*/arr.shape);
-    std::vector<int> vec = {1, 2, 3};
-    for (int i = 0; i < vec.size(); ++i) {
-      ctx.set_arg(/*arg_id=*/i + 2, vec[i]);
-    }
-    k_run->launch(&ctx);
-
-    auto *data = reinterpret_cast<int32_t *>(
-        exec.get_ndarray_alloc_info_ptr(arr_devalloc));
-
-    std::vector<int32_t> cpu_data(kArrLen);
-    CUDADriver::get_instance().memcpy_device_to_host(
-        (void *)cpu_data.data(), (void *)data, kArrLen * sizeof(int32_t));
-
-    for (int i = 0; i < kArrLen; ++i) {
-      EXPECT_EQ(cpu_data[i], i + vec[0]);
-    }
+    run_cuda_kernel_aot_test();
   }
 #endif
 }
 
+TEST(LlvmAotTest, CudaFatBinaryKernel) {
+#ifdef TI_WITH_CUDA
+  if (is_cuda_api_available()) {
+    const std::string folder_dir = getenv("TAICHI_AOT_FOLDER_PATH");
+    EXPECT_TRUE(path_exists(join_path(folder_dir, "run.native")));
+    run_cuda_kernel_aot_test();
+  }
+#endif
+}
+
+#ifdef TI_WITH_CUDA
+TEST(LlvmAotTest, CudaFatBinarySelect) {
+  CUDAFatBinary fatbin;
+  fatbin.images = {{75, "sm_75"}, {80, "sm_80"}, {86, "sm_86"}};
+  fatbin.ptx_compute_capability = 70;
+  fatbin.ptx = "ptx";
+  EXPECT_EQ(*fatbin.select(75), "sm_75");
+  EXPECT_EQ(*fatbin.select(89), "sm_86");
+  EXPECT_EQ(*fatbin.select(80), "sm_80");
+  EXPECT_EQ(*fatbin.select(72), "ptx");
+  EXPECT_EQ(*fatbin.select(90), "ptx");
+  EXPECT_EQ(fatbin.select(61), nullptr);
+
+  CUDAFatBinary loaded;
+  ASSERT_TRUE(CUDAFatBinary::deserialize(fatbin.serialize(), loaded));
+  ASSERT_EQ(loaded.images.size(), 3);
+  EXPECT_EQ(loaded.images[1].compute_capability, 80);
+  EXPECT_EQ(loaded.images[1].cubin, "sm_80");
+  EXPECT_EQ(loaded.ptx, "ptx");
+  EXPECT_FALSE(CUDAFatBinary::deserialize("", loaded));
+}
+#endif
+
 #ifdef TI_WITH_DX12
 TEST(LlvmAotTest, DX12Kernel) {
   directx12::AotModuleParams aot_params;
@@ -8,6 +8,9 @@ import taichi as ti
 
 parser = argparse.ArgumentParser()
 parser.add_argument("--arch", type=str)
+# Used by benchmarks/app/run.py to scale the problem.
+parser.add_argument("--particles", type=int, default=1024 * 8)
+parser.add_argument("--res", type=int, default=640)
 args = parser.parse_args()
 
 if args.arch == "cuda":
@@ -20,7 +23,7 @@ else:
 ti.init(arch=arch)
 
 dim = 3
-N = 1024 * 8
+N = args.particles
 dt = 2e-4
 steps = 7
 sun = ti.Vector([0.5, 0.5, 0.0])
@@ -30,7 +33,7 @@ tail_paticle_scale = 0.4
 color_init = 0.3
 color_decay = 1.6
 vel_init = 0.07
-res = 640
+res = args.res
 
 inv_m = ti.field(ti.f32)
 color = ti.field(ti.f32)
@@ -4,12 +4,20 @@ import os
 import taichi as ti
 
 
-def compile_kernel_aot_test1(arch):
+def compile_kernel_aot_test1(arch, fatbin=False):
     ti.init(arch=arch)
 
     if ti.lang.impl.current_cfg().arch != arch:
         return
 
+    if fatbin:
+        # The CUBIN of the current GPU, and another one with the PTX for an
+        # older GPU.
+        cc = ti.lang.impl.get_cuda_compute_capability()
+        ccs = sorted({60, cc})
+        ti.lang.impl.current_cfg().cuda_aot_archs = ','.join(
+            str(x) for x in ccs)
+
     @ti.kernel
     def run(base: int, arr: ti.types.ndarray(), v: ti.types.vector(3, ti.i32)):
         for i in arr:
@@ -28,12 +36,13 @@ def compile_kernel_aot_test1(arch):
 if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--arch", type=str)
+    parser.add_argument("--fatbin", action="store_true")
     args = parser.parse_args()
 
     if args.arch == "cpu":
         compile_kernel_aot_test1(arch=ti.cpu)
     elif args.arch == "cuda":
-        compile_kernel_aot_test1(arch=ti.cuda)
+        compile_kernel_aot_test1(arch=ti.cuda, fatbin=args.fatbin)
     elif args.arch == "vulkan":
         compile_kernel_aot_test1(arch=ti.vulkan)
     elif args.arch == "opengl":
@@ -6,16 +6,22 @@ import numpy as np
 
 import taichi as ti
 
+parser = argparse.ArgumentParser()
+parser.add_argument("--arch", type=str)
+# Used by benchmarks/app/run.py to scale the problem.
+parser.add_argument("--particles-per-axis", type=int, default=20)
+args = parser.parse_args()
+
 screen_res = (1000, 1000)
 
 boundary_box_np = np.array([[0, 0, 0], [1, 1, 1]], dtype=np.float32)
 spawn_box_np = np.array([[0.3, 0.3, 0.3], [0.7, 0.7, 0.7]], dtype=np.float32)
 
-particle_radius = 0.01
-particle_diameter = particle_radius * 2
+# The particles fill the spawn box, 0.02 apart by default.
+N_np = np.full(3, args.particles_per_axis, dtype=np.int32)
+particle_diameter = 0.4 / args.particles_per_axis
+particle_radius = particle_diameter / 2
 h = 4.0 * particle_radius
-N_np = ((spawn_box_np[1] - spawn_box_np[0]) / particle_diameter + 1).astype(
-    np.int32)
 particle_num = N_np[0] * N_np[1] * N_np[2]
 
 rest_density = 1000.0
@@ -75,9 +81,9 @@ def initialize(boundary_box: ti.any_arr(ndim=1), spawn_box: ti.any_arr(ndim=1),
     spawn_box[0] = [0.3, 0.3, 0.3]
     spawn_box[1] = [0.7, 0.7, 0.7]
 
-    N[0] = 20
-    N[1] = 20
-    N[2] = 20
+    N[0] = args.particles_per_axis
+    N[1] = args.particles_per_axis
+    N[2] = args.particles_per_axis
 
 
 @ti.kernel
@@ -161,10 +167,6 @@ def copy_data_from_ndarray_to_field(src: ti.template(), dst: ti.any_arr()):
         src[I] = dst[I]
 
 
-parser = argparse.ArgumentParser()
-parser.add_argument("--arch", type=str)
-args = parser.parse_args()
-
 if __name__ == "__main__":
     if args.arch == "cuda":
         arch = ti.cuda
@@ -24,6 +24,24 @@ TEST(GfxAotTest, VulkanDenseField) {
                                          embedded_device->device());
 }
 
+TEST(GfxAotTest, VulkanPrefetchedDenseField) {
+  // Otherwise will segfault on macOS VM,
+  // where Vulkan is installed but no devices are present
+  if (!vulkan::is_vulkan_api_available()) {
+    return;
+  }
+
+  // Create Taichi Device for computation
+  lang::vulkan::VulkanDeviceCreator::Params evd_params;
+  evd_params.api_version = std::nullopt;
+  auto embedded_device =
+      std::make_unique<taichi::lang::vulkan::VulkanDeviceCreator>(evd_params);
+
+  aot_test_utils::run_dense_field_kernel(Arch::vulkan,
+                                         embedded_device->device(),
+                                         /*prefetch=*/true);
+}
+
 TEST(GfxAotTest, VulkanKernelTest2) {
   // Otherwise will segfault on macOS VM,
   // where Vulkan is installed but no devices are present
@@ -0,0 +1,54 @@
+#include "gtest/gtest.h"
+
+#include <spirv/unified1/spirv.hpp>
+
+#include "taichi/codegen/spirv/kernel_utils.h"
+
+namespace taichi::lang {
+namespace spirv {
+namespace {
+
+uint32_t make_opcode(spv::Op op, uint32_t num_words) {
+  return (num_words << spv::WordCountShift) | op;
+}
+
+// A module that only declares a u32 type and two specialization constants.
+std::vector<uint32_t> make_module() {
+  return {
+      spv::MagicNumber, 0x00010300, 0, 10, 0,
+      // OpDecorate %2 SpecId 0
+      make_opcode(spv::OpDecorate, 4), 2, spv::DecorationSpecId, 0,
+      // OpDecorate %3 SpecId 1
+      make_opcode(spv::OpDecorate, 4), 3, spv::DecorationSpecId, 1,
+      // %1 = OpTypeInt 32 0
+      make_opcode(spv::OpTypeInt, 4), 1, 32, 0,
+      // %2 = OpSpecConstant %1 0
+      make_opcode(spv::OpSpecConstant, 4), 1, 2, 0,
+      // %3 = OpSpecConstant %1 7
+      make_opcode(spv::OpSpecConstant, 4), 1, 3, 7,
+  };
+}
+
+TEST(SpirvSpecialization, PatchesDefaults) {
+  auto spirv = make_module();
+  specialize_spirv(spirv, {{0, 42}});
+  auto expected = make_module();
+  expected[20] = 42;
+  EXPECT_EQ(spirv, expected);
+
+  specialize_spirv(spirv, {{1, 3}, {5, 9}});
+  expected[24] = 3;
+  EXPECT_EQ(spirv, expected);
+}
+
+TEST(SpirvSpecialization, SpecConstantIds) {
+  KernelContextAttributes attribs;
+  attribs.spec_constant_args = {{"n", 2}, {"k", 0}};
+  EXPECT_EQ(attribs.get_spec_constant_id(2), 0);
+  EXPECT_EQ(attribs.get_spec_constant_id(0), 1);
+  EXPECT_EQ(attribs.get_spec_constant_id(1), -1);
+}
+
+}  // namespace
+}  // namespace spirv
+}  // namespace taichi::lang
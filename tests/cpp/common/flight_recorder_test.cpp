@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taichi/system/flight_recorder.h"
+
+namespace taichi {
+
+namespace {
+
+int count_records(const std::vector<std::vector<TraceRecord>> &threads,
+                  uint32_t name_id) {
+  int count = 0;
+  for (auto &records : threads) {
+    for (auto &r : records) {
+      count += r.name_id == name_id;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(FlightRecorder, KeepsTheLatestRecords) {
+  auto &recorder = FlightRecorder::get_instance();
+  FlightRecorder::set_enabled(true);
+  recorder.clear();
+  const auto id = recorder.intern("ring");
+  EXPECT_EQ(recorder.intern("ring"), id);
+  EXPECT_EQ(recorder.get_name(id), "ring");
+
+  const uint64_t n = recorder.buffer_size() + 100;
+  for (uint64_t i = 0; i < n; i++) {
+    flight_record(TraceEvent::memory_alloc, id, i);
+  }
+  std::vector<TraceRecord> records;
+  for (auto &thread_records : recorder.collect()) {
+    for (auto &r : thread_records) {
+      if (r.name_id == id) {
+        records.push_back(r);
+      }
+    }
+  }
+  ASSERT_EQ(records.size(), recorder.buffer_size());
+  for (std::size_t i = 0; i < records.size(); i++) {
+    EXPECT_EQ(records[i].payload, 100 + i);
+    EXPECT_EQ(records[i].event, TraceEvent::memory_alloc);
+  }
+
+  recorder.clear();
+  EXPECT_EQ(count_records(recorder.collect(), id), 0);
+  FlightRecorder::set_enabled(false);
+}
+
+TEST(FlightRecorder, RecordsEveryThread) {
+  constexpr int kNumThreads = 4;
+  constexpr int kRecordsPerThread = 50;
+  auto &recorder = FlightRecorder::get_instance();
+  FlightRecorder::set_enabled(true);
+  recorder.clear();
+  const auto id = recorder.intern("threads");
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < kRecordsPerThread; i++) {
+        FlightRecorder::Scope scope(TraceEvent::launch, id, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // The records of exited threads stay around.
+  auto collected = recorder.collect();
+  EXPECT_EQ(count_records(collected, id), kNumThreads * kRecordsPerThread);
+  for (auto &records : collected) {
+    for (auto &r : records) {
+      EXPECT_LE(r.begin_ns, r.end_ns);
+    }
+  }
+
+  FlightRecorder::set_enabled(false);
+  {
+    FlightRecorder::Scope scope(TraceEvent::launch, id);
+  }
+  EXPECT_EQ(count_records(recorder.collect(), id),
+            kNumThreads * kRecordsPerThread);
+}
+
+TEST(FlightRecorder, DumpsChromeTrace) {
+  auto &recorder = FlightRecorder::get_instance();
+  FlightRecorder::set_enabled(true);
+  recorder.clear();
+  const auto id = recorder.intern("dumped_kernel");
+  {
+    FlightRecorder::Scope scope(TraceEvent::compile, id, 1);
+  }
+  flight_record(TraceEvent::memory_fill, 0, 64);
+  FlightRecorder::set_enabled(false);
+
+  const std::string filename = "flight_recorder_test.json";
+  recorder.dump(filename);
+  std::ifstream file(filename);
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  std::remove(filename.c_str());
+  EXPECT_EQ(content.front(), '[');
+  EXPECT_NE(content.find("\"name\":\"dumped_kernel\""), std::string::npos);
+  EXPECT_NE(content.find("\"cat\":\"compile\""), std::string::npos);
+  EXPECT_NE(content.find("\"name\":\"memory_fill\""), std::string::npos);
+  EXPECT_NE(content.find("\"payload\":64"), std::string::npos);
+}
+
+}  // namespace taichi
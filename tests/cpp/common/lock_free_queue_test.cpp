@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "taichi/system/lock_free_queue.h"
+
+namespace taichi {
+
+TEST(LockFreeQueue, FifoAndBounded) {
+  LockFreeQueue<int> queue(3);
+  EXPECT_EQ(queue.capacity(), 4);
+  EXPECT_TRUE(queue.empty());
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.try_push(int(i)));
+  }
+  EXPECT_FALSE(queue.try_push(4));
+  int value = -1;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.try_pop(value));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(LockFreeQueue, MultiProducerMultiConsumer) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumConsumers = 4;
+  constexpr int kItemsPerProducer = 20000;
+  LockFreeQueue<int> queue(64);
+  std::vector<std::atomic<int>> seen(kNumProducers * kItemsPerProducer);
+  std::atomic<int> num_popped{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumProducers; p++) {
+    threads.emplace_back([&, p]() {
+      for (int i = 0; i < kItemsPerProducer; i++) {
+        while (!queue.try_push(p * kItemsPerProducer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < kNumConsumers; c++) {
+    threads.emplace_back([&]() {
+      int value;
+      while (num_popped.load() < kNumProducers * kItemsPerProducer) {
+        if (queue.try_pop(value)) {
+          seen[value]++;
+          num_popped++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+  for (auto &count : seen) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+}  // namespace taichi
@@ -0,0 +1,58 @@
+#ifdef TI_WITH_LLVM
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "taichi/rhi/cpu/cpu_device.h"
+#include "taichi/system/memory_pool.h"
+
+namespace taichi::lang {
+
+TEST(UnifiedAllocator, ExhaustedKeepsHead) {
+  cpu::CpuDevice device;
+  UnifiedAllocator allocator(1 << 16, Arch::x64, &device);
+  EXPECT_NE(allocator.allocate(1 << 15, 64), nullptr);
+  EXPECT_EQ(allocator.allocate(1 << 16, 64), nullptr);
+  // The failed request above does not waste the rest of the buffer.
+  EXPECT_NE(allocator.allocate(1 << 15, 64), nullptr);
+  EXPECT_EQ(allocator.allocate(1, 1), nullptr);
+}
+
+TEST(MemoryPool, ConcurrentAllocations) {
+  constexpr int kNumThreads = 8;
+  constexpr int kAllocationsPerThread = 4096;
+  constexpr std::size_t kSize = 48;
+  constexpr std::size_t kAlignment = 64;
+  cpu::CpuDevice device;
+  MemoryPool pool(Arch::x64, &device);
+
+  std::vector<std::vector<uint8 *>> ptrs(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kAllocationsPerThread; i++) {
+        ptrs[t].push_back((uint8 *)pool.allocate(kSize, kAlignment));
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  std::vector<uint8 *> all;
+  for (auto &p : ptrs) {
+    all.insert(all.end(), p.begin(), p.end());
+  }
+  std::sort(all.begin(), all.end());
+  for (int i = 0; i < all.size(); i++) {
+    EXPECT_EQ((std::size_t)all[i] % kAlignment, 0);
+    if (i > 0) {
+      EXPECT_GE(all[i], all[i - 1] + kSize);
+    }
+  }
+}
+
+}  // namespace taichi::lang
+#endif
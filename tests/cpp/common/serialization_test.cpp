@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <optional>
 #include <string>
 #include <vector>
@@ -144,5 +145,45 @@ TEST(Serialization, MoveOnly) {
   EXPECT_EQ(act_item1.ptr, nullptr);
 }
 
+struct Module {
+  std::vector<std::vector<uint32_t>> spirv;
+  std::vector<Parent> parents;
+  std::string bitcode;
+
+  TI_IO_DEF(spirv, parents, bitcode);
+};
+
+TEST(Serialization, StreamToFile) {
+  Module module;
+  // Larger than the stream buffer, in pieces both smaller and larger.
+  for (int i = 0; i < 8; i++) {
+    module.spirv.emplace_back(std::size_t(100000) << (i % 3), i);
+  }
+  for (int i = 0; i < 20000; i++) {
+    module.parents.push_back(Parent{Parent::Child{i, 0.5f, i % 2 == 0},
+                                    std::to_string(i)});
+  }
+  module.bitcode = std::string(3 << 20, 'x');
+
+  BinaryOutputSerializer os;
+  os.initialize();
+  os(module);
+  os.finalize();
+
+  const std::string path = "serialization_test_stream.tcb";
+  write_to_binary_file(module, path);
+  // The same bytes as serializing into memory.
+  EXPECT_EQ(read_data_from_file(path), os.data);
+
+  Module actual;
+  EXPECT_TRUE(read_from_binary_file(actual, path));
+  EXPECT_EQ(actual.spirv, module.spirv);
+  EXPECT_EQ(actual.parents, module.parents);
+  EXPECT_EQ(actual.bitcode, module.bitcode);
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(read_from_binary_file(actual, path));
+}
+
 }  // namespace
 }  // namespace taichi::lang
@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace {
+
+struct Counters {
+  std::vector<std::atomic<int>> hits;
+  std::atomic<int> max_thread_id{0};
+
+  explicit Counters(int n) : hits(n) {
+  }
+};
+
+void count_task(void *ctx, int thread_id, int i) {
+  auto *counters = (Counters *)ctx;
+  counters->hits[i]++;
+  int cur = counters->max_thread_id.load();
+  while (thread_id > cur &&
+         !counters->max_thread_id.compare_exchange_weak(cur, thread_id)) {
+  }
+}
+
+}  // namespace
+
+TEST(WorkStealingThreadPool, EveryTaskRunsOnce) {
+  constexpr int kMaxThreads = 8;
+  WorkStealingThreadPool pool(kMaxThreads, /*pin_threads=*/false);
+  for (int splits : {1, 3, 8, 100, 10007}) {
+    for (int desired : {1, 2, kMaxThreads, 2 * kMaxThreads}) {
+      Counters counters(splits);
+      WorkStealingThreadPool::static_run(&pool, splits, desired, &counters,
+                                         count_task);
+      for (int i = 0; i < splits; i++) {
+        EXPECT_EQ(counters.hits[i].load(), 1);
+      }
+      EXPECT_LT(counters.max_thread_id.load(),
+                std::min(desired, kMaxThreads));
+    }
+  }
+}
+
+TEST(WorkStealingThreadPool, BackToBackRuns) {
+  WorkStealingThreadPool pool(4, /*pin_threads=*/false);
+  Counters counters(64);
+  for (int r = 0; r < 2000; r++) {
+    pool.run(64, 4, &counters, count_task);
+  }
+  for (int i = 0; i < 64; i++) {
+    EXPECT_EQ(counters.hits[i].load(), 2000);
+  }
+}
+
+}  // namespace taichi
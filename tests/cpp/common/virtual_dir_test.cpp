@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "taichi/common/miniz.h"
+#include "taichi/common/virtual_dir.h"
+
+namespace taichi::io {
+
+TEST(VirtualDir, MappedZipArchive) {
+  const std::string stored(1000, 's');
+  std::string deflated;
+  for (int i = 0; i < 1000; ++i) {
+    deflated += std::to_string(i % 17);
+  }
+
+  mz_zip_archive zip;
+  mz_zip_zero_struct(&zip);
+  ASSERT_TRUE(mz_zip_writer_init_heap(&zip, 0, 0));
+  ASSERT_TRUE(mz_zip_writer_add_mem(&zip, "stored.bin", stored.data(),
+                                    stored.size(), MZ_NO_COMPRESSION));
+  ASSERT_TRUE(mz_zip_writer_add_mem(&zip, "deflated.bin", deflated.data(),
+                                    deflated.size(), MZ_DEFAULT_COMPRESSION));
+  void *archive = nullptr;
+  size_t archive_size = 0;
+  ASSERT_TRUE(mz_zip_writer_finalize_heap_archive(&zip, &archive,
+                                                  &archive_size));
+  const std::string path = std::string(std::tmpnam(nullptr)) + ".tcm";
+  {
+    std::ofstream f(path, std::ios::binary);
+    f.write((const char *)archive, archive_size);
+  }
+  mz_free(archive);
+  mz_zip_writer_end(&zip);
+
+  auto dir = VirtualDir::open(path);
+  ASSERT_NE(dir, nullptr);
+
+  size_t size = 0;
+  EXPECT_FALSE(dir->get_file_size("missing.bin", size));
+  EXPECT_TRUE(dir->get_file_size("deflated.bin", size));
+  EXPECT_EQ(size, deflated.size());
+
+  for (const auto &[name, content] :
+       {std::make_pair("stored.bin", stored),
+        std::make_pair("deflated.bin", deflated)}) {
+    std::vector<char> data;
+    EXPECT_TRUE(dir->load_file(name, data));
+    EXPECT_EQ(std::string(data.begin(), data.end()), content);
+
+    // Loads a prefix of the file.
+    char prefix[10];
+    EXPECT_EQ(dir->load_file(name, prefix, sizeof(prefix)), sizeof(prefix));
+    EXPECT_EQ(std::string(prefix, sizeof(prefix)), content.substr(0, 10));
+  }
+
+  dir.reset();
+  std::remove(path.c_str());
+}
+
+}  // namespace taichi::io
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/control_flow_graph.h"
+#include "taichi/ir/dataflow.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// 0 -> 1 -> 2 -> 3, with a back edge 2 -> 1.
+std::unique_ptr<ControlFlowGraph> make_loop_graph() {
+  auto graph = std::make_unique<ControlFlowGraph>();
+  for (int i = 0; i < 4; i++) {
+    graph->push_back();
+  }
+  CFGNode::add_edge(graph->nodes[0].get(), graph->nodes[1].get());
+  CFGNode::add_edge(graph->nodes[1].get(), graph->nodes[2].get());
+  CFGNode::add_edge(graph->nodes[2].get(), graph->nodes[1].get());
+  CFGNode::add_edge(graph->nodes[2].get(), graph->nodes[3].get());
+  graph->final_node = 3;
+  return graph;
+}
+
+}  // namespace
+
+TEST(Dataflow, Forward) {
+  auto graph = make_loop_graph();
+  GenKillDataflow dataflow(*graph, GenKillDataflow::Direction::forward,
+                           /*num_elements=*/2);
+  dataflow.gen(0)[0] = true;
+  dataflow.gen(2)[1] = true;
+  int num_kill_queries = 0;
+  // Node 2 kills element 0.
+  dataflow.solve([&](int node_id, int element) {
+    num_kill_queries++;
+    return node_id == 2 && element == 0;
+  });
+
+  // Element 1 reaches node 1 through the back edge.
+  EXPECT_TRUE(dataflow.input(1).test(0));
+  EXPECT_TRUE(dataflow.input(1).test(1));
+  EXPECT_FALSE(dataflow.output(2).test(0));
+  EXPECT_TRUE(dataflow.output(2).test(1));
+  EXPECT_FALSE(dataflow.input(3).test(0));
+  EXPECT_TRUE(dataflow.input(3).test(1));
+  EXPECT_TRUE(dataflow.input(0).none());
+  // Each pair of a node and an element reaching it is queried once.
+  EXPECT_LE(num_kill_queries, 6);
+}
+
+TEST(Dataflow, Backward) {
+  auto graph = make_loop_graph();
+  GenKillDataflow dataflow(*graph, GenKillDataflow::Direction::backward,
+                           /*num_elements=*/1);
+  // Used in node 1, defined in node 0.
+  dataflow.gen(1)[0] = true;
+  dataflow.solve(
+      [&](int node_id, int element) { return node_id == 0 && element == 0; });
+
+  // In a backward problem, input() is the set at the exit of a node.
+  EXPECT_TRUE(dataflow.input(0).test(0));
+  EXPECT_FALSE(dataflow.output(0).test(0));
+  EXPECT_TRUE(dataflow.output(1).test(0));
+  // Live around the loop, but not after it.
+  EXPECT_TRUE(dataflow.input(2).test(0));
+  EXPECT_FALSE(dataflow.input(3).test(0));
+}
+
+TEST(Dataflow, StmtBitSet) {
+  auto a = Stmt::make<ConstStmt>(TypedConstant(1));
+  auto b = Stmt::make<ConstStmt>(TypedConstant(2));
+  auto c = Stmt::make<ConstStmt>(TypedConstant(3));
+  StmtNumbering numbering;
+  EXPECT_EQ(numbering.insert(a.get()), 0);
+  EXPECT_EQ(numbering.insert(b.get()), 1);
+  EXPECT_EQ(numbering.insert(a.get()), 0);
+  EXPECT_EQ(numbering.find(c.get()), -1);
+
+  bit::Bitset bits(numbering.size());
+  bits[1] = true;
+  StmtBitSet set(&numbering, bits);
+  EXPECT_FALSE(set.empty());
+  EXPECT_EQ(set.count(a.get()), 0);
+  EXPECT_EQ(set.count(b.get()), 1);
+  EXPECT_EQ(set.count(c.get()), 0);
+  std::vector<Stmt *> stmts(set.begin(), set.end());
+  EXPECT_EQ(stmts, std::vector<Stmt *>{b.get()});
+  EXPECT_TRUE(StmtBitSet().empty());
+}
+
+}  // namespace taichi::lang
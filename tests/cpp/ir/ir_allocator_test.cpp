@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "taichi/ir/ir_allocator.h"
+
+namespace taichi::lang {
+namespace {
+
+TEST(IRAllocator, ReusesFreedBlocks) {
+  void *a = allocate_ir_object(40);
+  deallocate_ir_object(a, 40);
+  // Same size class.
+  void *b = allocate_ir_object(48);
+  EXPECT_EQ(a, b);
+  void *c = allocate_ir_object(48);
+  EXPECT_NE(b, c);
+  deallocate_ir_object(b, 48);
+  deallocate_ir_object(c, 48);
+}
+
+TEST(IRAllocator, LargeObjects) {
+  void *a = allocate_ir_object(4096);
+  EXPECT_NE(a, nullptr);
+  deallocate_ir_object(a, 4096);
+}
+
+TEST(IRAllocator, FreedOnAnotherThread) {
+  std::vector<void *> ptrs;
+  for (int i = 0; i < 1000; i++) {
+    ptrs.push_back(allocate_ir_object(64));
+  }
+  std::thread([&] {
+    for (auto *ptr : ptrs) {
+      deallocate_ir_object(ptr, 64);
+    }
+  }).join();
+  // The blocks freed by the exited thread are handed to the next thread.
+  std::thread([&] {
+    void *ptr = allocate_ir_object(64);
+    EXPECT_NE(std::find(ptrs.begin(), ptrs.end(), ptr), ptrs.end());
+    deallocate_ir_object(ptr, 64);
+  }).join();
+}
+
+}  // namespace
+}  // namespace taichi::lang
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#include "taichi/ir/mesh_patcher.h"
+
+namespace taichi::lang {
+namespace mesh {
+namespace {
+
+// A cube of n^3 unit cells, each split into 6 tetrahedra along a diagonal.
+void make_cube(int n,
+               std::vector<float> &positions,
+               std::vector<uint32_t> &cells) {
+  auto id = [&](int i, int j, int k) {
+    return uint32_t((i * (n + 1) + j) * (n + 1) + k);
+  };
+  for (int i = 0; i <= n; i++) {
+    for (int j = 0; j <= n; j++) {
+      for (int k = 0; k <= n; k++) {
+        positions.insert(positions.end(), {float(i), float(j), float(k)});
+      }
+    }
+  }
+  const int axes[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+                          {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      for (int k = 0; k < n; k++) {
+        for (auto &axis : axes) {
+          int c[3] = {i, j, k};
+          cells.push_back(id(c[0], c[1], c[2]));
+          for (int s = 0; s < 3; s++) {
+            c[axis[s]]++;
+            cells.push_back(id(c[0], c[1], c[2]));
+          }
+        }
+      }
+    }
+  }
+}
+
+uint32_t num_owned(const PatchedMesh::Element &element, int p) {
+  return element.owned_nums.empty()
+             ? element.owned_offsets[p + 1] - element.owned_offsets[p]
+             : element.owned_nums[p];
+}
+
+uint32_t num_total(const PatchedMesh::Element &element, int p) {
+  return element.total_nums.empty()
+             ? element.total_offsets[p + 1] - element.total_offsets[p]
+             : element.total_nums[p];
+}
+
+// Reads relation |i| back in global indices.
+std::vector<std::set<uint32_t>> global_relation(const PatchedMesh &mesh,
+                                                int i) {
+  const auto &rel = mesh.relations[i];
+  const auto &from = mesh.elements[rel.from_order];
+  const auto &to = mesh.elements[rel.to_order];
+  std::vector<std::set<uint32_t>> result(from.num);
+  for (int p = 0; p < mesh.num_patches; p++) {
+    auto to_global = [&](uint16_t l) {
+      EXPECT_LT(l, num_total(to, p));
+      return to.l2g_mapping[to.total_offsets[p] + l];
+    };
+    if (rel.from_order > rel.to_order) {
+      const int arity = rel.value.size() / from.total_offsets.back();
+      for (uint32_t l = from.total_offsets[p];
+           l < from.total_offsets[p] + num_total(from, p); l++) {
+        std::set<uint32_t> neighbors;
+        for (int k = 0; k < arity; k++) {
+          neighbors.insert(to_global(rel.value[l * arity + k]));
+        }
+        auto &x = result[from.l2g_mapping[l]];
+        // Fixed relations are repeated in every patch seeing the element.
+        EXPECT_TRUE(x.empty() || x == neighbors);
+        x = neighbors;
+      }
+    } else {
+      for (uint32_t l = 0; l < num_owned(from, p); l++) {
+        const size_t index = p + from.owned_offsets[p] + l;
+        for (uint32_t j = rel.offset[index]; j < rel.offset[index + 1]; j++) {
+          result[from.l2g_mapping[from.total_offsets[p] + l]].insert(
+              to_global(rel.value[rel.patch_offset[p] + j]));
+        }
+      }
+    }
+  }
+  return result;
+}
+
+TEST(MeshPatcher, TetrahedralCube) {
+  std::vector<float> positions;
+  std::vector<uint32_t> cells;
+  make_cube(5, positions, cells);
+  const std::vector<MeshRelationType> relations = {
+      MeshRelationType::CV, MeshRelationType::VC, MeshRelationType::VV,
+      MeshRelationType::CC, MeshRelationType::FE, MeshRelationType::EF};
+  MeshPatcherConfig config;
+  config.max_elements_per_patch = 64;
+  config.num_threads = 4;
+  auto mesh = patch_mesh(MeshTopology::Tetrahedron, positions, cells,
+                         relations, config);
+  EXPECT_GT(mesh.num_patches, 1);
+  ASSERT_EQ(mesh.elements.size(), 4);
+  // Euler characteristic of a ball.
+  EXPECT_EQ(mesh.elements[0].num - mesh.elements[1].num +
+                mesh.elements[2].num - mesh.elements[3].num,
+            1);
+
+  for (const auto &element : mesh.elements) {
+    // Owned ranges partition the reordered indices, and the local mappings
+    // agree with each other.
+    EXPECT_EQ(element.owned_offsets.back(), element.num);
+    std::vector<int> count(element.num, 0);
+    for (uint32_t r : element.g2r_mapping) {
+      count[r]++;
+    }
+    EXPECT_TRUE(std::all_of(count.begin(), count.end(),
+                            [](int c) { return c == 1; }));
+    for (size_t l = 0; l < element.l2g_mapping.size(); l++) {
+      EXPECT_EQ(element.g2r_mapping[element.l2g_mapping[l]],
+                element.l2r_mapping[l]);
+    }
+  }
+  // A patch owns at most max_elements_per_patch cells.
+  for (int p = 0; p < mesh.num_patches; p++) {
+    EXPECT_LE(mesh.elements[3].owned_offsets[p + 1] -
+                  mesh.elements[3].owned_offsets[p],
+              64);
+  }
+
+  auto cv = global_relation(mesh, 0);
+  auto vc = global_relation(mesh, 1);
+  auto vv = global_relation(mesh, 2);
+  auto cc = global_relation(mesh, 3);
+  size_t num_vc = 0;
+  for (uint32_t c = 0; c < cv.size(); c++) {
+    EXPECT_EQ(cv[c], std::set<uint32_t>(cells.begin() + c * 4,
+                                        cells.begin() + c * 4 + 4));
+    for (uint32_t v : cv[c]) {
+      EXPECT_TRUE(vc[v].count(c));
+      for (uint32_t u : cv[c]) {
+        EXPECT_EQ(u != v, vv[v].count(u) == 1);
+      }
+    }
+    for (uint32_t d : cc[c]) {
+      int shared = 0;
+      for (uint32_t v : cv[d]) {
+        shared += cv[c].count(v);
+      }
+      EXPECT_EQ(shared, 3);
+    }
+  }
+  for (const auto &cells_of_vertex : vc) {
+    num_vc += cells_of_vertex.size();
+  }
+  EXPECT_EQ(num_vc, cells.size());
+
+  auto fe = global_relation(mesh, 4);
+  auto ef = global_relation(mesh, 5);
+  for (uint32_t f = 0; f < fe.size(); f++) {
+    EXPECT_EQ(fe[f].size(), 3);
+    for (uint32_t e : fe[f]) {
+      EXPECT_TRUE(ef[e].count(f));
+    }
+  }
+}
+
+TEST(MeshPatcher, TriangleOrientation) {
+  std::vector<float> positions = {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0};
+  std::vector<uint32_t> cells = {0, 1, 2, 0, 2, 3};
+  MeshPatcherConfig config;
+  config.max_elements_per_patch = 3;
+  auto mesh = patch_mesh(MeshTopology::Triangle, positions, cells,
+                         {MeshRelationType::FV, MeshRelationType::EV}, config);
+  EXPECT_EQ(mesh.num_patches, 2);
+  EXPECT_EQ(mesh.elements[1].num, 5);
+  // Faces keep the order of their vertices.
+  const auto &faces = mesh.elements[2];
+  const auto &verts = mesh.elements[0];
+  const auto &fv = mesh.relations[0];
+  for (int p = 0; p < mesh.num_patches; p++) {
+    for (uint32_t l = faces.total_offsets[p]; l < faces.total_offsets[p + 1];
+         l++) {
+      const uint32_t f = faces.l2g_mapping[l];
+      for (int k = 0; k < 3; k++) {
+        EXPECT_EQ(verts.l2g_mapping[verts.total_offsets[p] +
+                                    fv.value[l * 3 + k]],
+                  cells[f * 3 + k]);
+      }
+    }
+  }
+
+  EXPECT_THROW(patch_mesh(MeshTopology::Triangle, positions, cells,
+                          {MeshRelationType::CV}, config),
+               std::exception);
+}
+
+template <typename T>
+void apply_scatter(const DynamicPatchedMesh::Scatter &scatter,
+                   std::vector<T> &array) {
+  for (size_t i = 0; i < scatter.indices.size(); i++) {
+    array[scatter.indices[i]] = T(scatter.values[i]);
+  }
+}
+
+TEST(MeshPatcher, DynamicTetrahedralCube) {
+  std::vector<float> positions;
+  std::vector<uint32_t> cells;
+  make_cube(4, positions, cells);
+  const std::vector<MeshRelationType> relations = {
+      MeshRelationType::CV, MeshRelationType::VC, MeshRelationType::VV,
+      MeshRelationType::CC, MeshRelationType::FE, MeshRelationType::EF};
+  MeshPatcherConfig config;
+  config.max_elements_per_patch = 64;
+  config.num_threads = 4;
+  DynamicPatchedMesh dynamic(MeshTopology::Tetrahedron, positions, cells,
+                             relations, config, 0.5f);
+  const int num_patches = dynamic.mesh().num_patches;
+  EXPECT_GT(num_patches, 4);
+
+  // The cells of the mesh by global index, empty once removed.
+  std::vector<std::vector<uint32_t>> alive;
+  for (size_t c = 0; c < cells.size(); c += 4) {
+    alive.emplace_back(cells.begin() + c, cells.begin() + c + 4);
+  }
+  uint32_t num_vertices = positions.size() / 3;
+  auto check = [&](const PatchedMesh &mesh) {
+    auto cv = global_relation(mesh, 0);
+    auto vc = global_relation(mesh, 1);
+    auto vv = global_relation(mesh, 2);
+    auto cc = global_relation(mesh, 3);
+    std::vector<std::set<uint32_t>> expected_vc(num_vertices);
+    std::vector<std::set<uint32_t>> expected_vv(num_vertices);
+    for (uint32_t c = 0; c < alive.size(); c++) {
+      EXPECT_EQ(cv[c], std::set<uint32_t>(alive[c].begin(), alive[c].end()));
+      for (uint32_t v : alive[c]) {
+        expected_vc[v].insert(c);
+        for (uint32_t u : alive[c]) {
+          if (u != v) {
+            expected_vv[v].insert(u);
+          }
+        }
+      }
+      for (uint32_t d = 0; d < alive.size(); d++) {
+        int shared = 0;
+        for (uint32_t v : alive[d]) {
+          shared += cv[c].count(v);
+        }
+        EXPECT_EQ(cc[c].count(d) == 1, alive[c].size() && shared == 3);
+      }
+    }
+    for (uint32_t v = 0; v < num_vertices; v++) {
+      EXPECT_EQ(vc[v], expected_vc[v]);
+      EXPECT_EQ(vv[v], expected_vv[v]);
+    }
+    auto fe = global_relation(mesh, 4);
+    auto ef = global_relation(mesh, 5);
+    for (uint32_t f = 0; f < fe.size(); f++) {
+      for (uint32_t e : fe[f]) {
+        EXPECT_TRUE(ef[e].count(f));
+      }
+    }
+    for (const auto &element : mesh.elements) {
+      for (int p = 0; p < mesh.num_patches; p++) {
+        for (uint32_t l = 0; l < num_total(element, p); l++) {
+          const uint32_t i = element.total_offsets[p] + l;
+          EXPECT_EQ(element.g2r_mapping[element.l2g_mapping[i]],
+                    element.l2r_mapping[i]);
+        }
+      }
+    }
+  };
+  check(dynamic.mesh());
+
+  // Removes a few cells, and puts a new vertex on top of their hole.
+  std::vector<uint32_t> removed = {0, 1, 2, 7};
+  std::vector<uint32_t> added;
+  for (uint32_t c : removed) {
+    for (int k = 0; k < 3; k++) {
+      added.push_back(alive[c][k]);
+    }
+    added.push_back(num_vertices);
+    alive[c].clear();
+  }
+  PatchedMesh before = dynamic.mesh();
+  auto update = dynamic.update(removed, added, 1);
+  num_vertices++;
+  ASSERT_EQ(update.added[3].size(), removed.size());
+  for (size_t i = 0; i < removed.size(); i++) {
+    const uint32_t c = update.added[3][i];
+    ASSERT_LT(c, alive.size());
+    EXPECT_TRUE(alive[c].empty());
+    alive[c].assign(added.begin() + i * 4, added.begin() + i * 4 + 4);
+  }
+  EXPECT_EQ(update.added[0], std::vector<uint32_t>{num_vertices - 1});
+  EXPECT_LT(update.dirty_patches.size(), num_patches);
+  check(dynamic.mesh());
+
+  // Applying the update to the previous arrays gives the new ones.
+  for (size_t d = 0; d < before.elements.size(); d++) {
+    auto &element = before.elements[d];
+    const auto &scatter = update.elements[d];
+    apply_scatter(scatter.owned_nums, element.owned_nums);
+    apply_scatter(scatter.total_nums, element.total_nums);
+    apply_scatter(scatter.l2g_mapping, element.l2g_mapping);
+    apply_scatter(scatter.l2r_mapping, element.l2r_mapping);
+    apply_scatter(scatter.g2r_mapping, element.g2r_mapping);
+    const auto &after = dynamic.mesh().elements[d];
+    EXPECT_EQ(element.owned_nums, after.owned_nums);
+    EXPECT_EQ(element.total_nums, after.total_nums);
+    EXPECT_EQ(element.l2g_mapping, after.l2g_mapping);
+    EXPECT_EQ(element.l2r_mapping, after.l2r_mapping);
+    EXPECT_EQ(element.g2r_mapping, after.g2r_mapping);
+  }
+  for (size_t i = 0; i < before.relations.size(); i++) {
+    auto &relation = before.relations[i];
+    apply_scatter(update.relations[i].value, relation.value);
+    apply_scatter(update.relations[i].offset, relation.offset);
+    apply_scatter(update.relations[i].patch_offset, relation.patch_offset);
+    EXPECT_EQ(relation.value, dynamic.mesh().relations[i].value);
+    EXPECT_EQ(relation.offset, dynamic.mesh().relations[i].offset);
+    EXPECT_EQ(relation.patch_offset, dynamic.mesh().relations[i].patch_offset);
+  }
+
+  // Removes the new cells again, which leaves the new vertex on its own.
+  for (uint32_t c : update.added[3]) {
+    alive[c].clear();
+  }
+  auto second = dynamic.update(update.added[3], {}, 0);
+  EXPECT_FALSE(second.dirty_patches.empty());
+  check(dynamic.mesh());
+
+  EXPECT_THROW(dynamic.update({0, 0}, {}, 0), std::exception);
+}
+
+}  // namespace
+}  // namespace mesh
+}  // namespace taichi::lang
@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <set>
+
+#include "taichi/inc/constants.h"
+#include "taichi/rhi/llvm/llvm_caching_allocator.h"
+
+namespace taichi::lang {
+namespace {
+
+// Serves segments from host memory so that the bookkeeping can be tested
+// without a GPU.
+class HostCachingAllocator : public LlvmCachingAllocator {
+ public:
+  HostCachingAllocator() : LlvmCachingAllocator(nullptr) {
+  }
+
+  ~HostCachingAllocator() override {
+    for (auto *ptr : live_segments) {
+      std::free(ptr);
+    }
+  }
+
+  void *stream{nullptr};
+  int num_syncs{0};
+  std::set<uint64_t *> live_segments;
+
+ protected:
+  uint64_t *driver_allocate(std::size_t size) override {
+    auto *ptr = (uint64_t *)std::aligned_alloc(taichi_page_size, size);
+    live_segments.insert(ptr);
+    return ptr;
+  }
+
+  void driver_free(uint64_t *ptr) override {
+    live_segments.erase(ptr);
+    std::free(ptr);
+  }
+
+  void *current_stream() override {
+    return stream;
+  }
+
+  void synchronize_streams() override {
+    num_syncs++;
+  }
+};
+
+LlvmDevice::LlvmRuntimeAllocParams make_params(std::size_t size) {
+  LlvmDevice::LlvmRuntimeAllocParams params;
+  params.size = size;
+  return params;
+}
+
+constexpr std::size_t kMB = 1 << 20;
+
+}  // namespace
+
+TEST(LlvmCachingAllocator, ReuseAndMerge) {
+  HostCachingAllocator allocator;
+  allocator.set_high_water_mark(64 * kMB);
+
+  auto *a = allocator.allocate(make_params(3 * kMB));
+  auto *b = allocator.allocate(make_params(3 * kMB));
+  EXPECT_EQ(allocator.get_stats().num_cache_misses, 2);
+
+  allocator.release(3 * kMB, a);
+  allocator.release(3 * kMB, b);
+
+  // Small requests are carved out of a shared segment.
+  auto *c = allocator.allocate(make_params(4096));
+  auto *d = allocator.allocate(make_params(4096));
+  EXPECT_EQ((uint8_t *)d - (uint8_t *)c, 4096);
+  allocator.release(4096, c);
+  allocator.release(4096, d);
+  auto *e = allocator.allocate(make_params(8192));
+  EXPECT_EQ(e, c);
+  allocator.release(8192, e);
+
+  // A large request is served from the cache once freed blocks are available.
+  auto *f = allocator.allocate(make_params(2 * kMB));
+  EXPECT_EQ(allocator.get_stats().num_cache_hits, 3);
+  allocator.release(2 * kMB, f);
+  EXPECT_EQ(allocator.get_stats().allocated_bytes, 0);
+}
+
+TEST(LlvmCachingAllocator, PerStreamReuse) {
+  HostCachingAllocator allocator;
+  allocator.set_high_water_mark(64 * kMB);
+
+  int s1 = 0, s2 = 0;
+  allocator.stream = &s1;
+  auto *a = allocator.allocate(make_params(4 * kMB));
+  allocator.release(4 * kMB, a);
+
+  // Reused on the same stream without synchronization.
+  auto *b = allocator.allocate(make_params(4 * kMB));
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(allocator.num_syncs, 0);
+  allocator.release(4 * kMB, b);
+
+  // Another stream may only reuse the block after synchronizing.
+  allocator.stream = &s2;
+  auto *c = allocator.allocate(make_params(4 * kMB));
+  EXPECT_EQ(a, c);
+  EXPECT_EQ(allocator.num_syncs, 1);
+  allocator.release(4 * kMB, c);
+}
+
+TEST(LlvmCachingAllocator, ReleaseToDriver) {
+  HostCachingAllocator allocator;
+  allocator.set_high_water_mark(8 * kMB);
+
+  auto *a = allocator.allocate(make_params(6 * kMB));
+  allocator.release(6 * kMB, a);
+  EXPECT_EQ(allocator.get_stats().reserved_bytes, 6 * kMB);
+
+  // Exceeding the high-water mark drops the cached segment first.
+  auto *b = allocator.allocate(make_params(8 * kMB));
+  auto stats = allocator.get_stats();
+  EXPECT_EQ(stats.num_segments_released, 1);
+  EXPECT_EQ(stats.reserved_bytes, 8 * kMB);
+  allocator.release(8 * kMB, b);
+
+  allocator.empty_cache();
+  EXPECT_EQ(allocator.get_stats().reserved_bytes, 0);
+  EXPECT_TRUE(allocator.live_segments.empty());
+}
+
+}  // namespace taichi::lang
@@ -147,9 +147,63 @@ TEST_P(LlvmOfflineCacheTest, ReadWrite) {
   };
 }
 
+TEST_F(LlvmOfflineCacheTest, PackedAppendAndClean) {
+  fs::path tmp_dir{fs::temp_directory_path() /= std::tmpnam(nullptr)};
+  auto cleanup = make_cleanup([tmp_dir]() { fs::remove_all(tmp_dir); });
+  const auto tmp_dir_str{tmp_dir.u8string()};
+  ASSERT_TRUE(fs::create_directories(tmp_dir));
+
+  constexpr int kNumKernels = 4;
+  {
+    auto llvm_ctx = std::make_unique<llvm::LLVMContext>();
+    llvm_ctx->setOpaquePointers(false);
+    // Each writer appends to the same file, as separate processes would.
+    for (int i = 0; i < kNumKernels; i++) {
+      LlvmOfflineCache::KernelCacheData kcache;
+      kcache.created_at = i + 1;
+      kcache.last_used_at = i + 1;
+      kcache.kernel_key = fmt::format("{}{}", kKernelName, i);
+      OffloadedTask task;
+      task.name = kTaskName;
+      kcache.compiled_data.tasks.push_back(task);
+      kcache.compiled_data.module = make_module(*llvm_ctx);
+      LlvmOfflineCacheFileWriter writer;
+      writer.add_kernel_cache(kcache.kernel_key, std::move(kcache));
+      writer.set_no_mangle();
+      writer.dump(tmp_dir_str, Format::PACKED, /*merge_with_old=*/true);
+    }
+  }
+  {
+    auto reader = LlvmOfflineCacheFileReader::make(tmp_dir_str, Format::PACKED);
+    ASSERT_NE(reader, nullptr);
+    for (int i = 0; i < kNumKernels; i++) {
+      EXPECT_TRUE(reader->has_kernel(fmt::format("{}{}", kKernelName, i)));
+    }
+  }
+
+  // Evicts the two least recently used kernels.
+  LlvmOfflineCacheFileWriter::clean_cache(
+      tmp_dir_str, offline_cache::CleanCachePolicy::LRU, /*max_bytes=*/1,
+      /*cleaning_factor=*/0.5, Format::PACKED);
+  auto reader = LlvmOfflineCacheFileReader::make(tmp_dir_str, Format::PACKED);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_FALSE(reader->has_kernel(fmt::format("{}0", kKernelName)));
+  EXPECT_FALSE(reader->has_kernel(fmt::format("{}1", kKernelName)));
+  EXPECT_TRUE(reader->has_kernel(fmt::format("{}2", kKernelName)));
+
+  auto *llvm_ctx = tlctx_->get_this_thread_context();
+  LlvmOfflineCache::KernelCacheData kcache;
+  ASSERT_TRUE(reader->get_kernel_cache(
+      kcache, fmt::format("{}3", kKernelName), *llvm_ctx));
+  ASSERT_NE(kcache.compiled_data.module, nullptr);
+  EXPECT_NE(kcache.compiled_data.module->getFunction(kTaskName), nullptr);
+}
+
 INSTANTIATE_TEST_SUITE_P(Format,
                          LlvmOfflineCacheTest,
-                         testing::Values(Format::LL, Format::BC));
+                         testing::Values(Format::LL,
+                                         Format::BC,
+                                         Format::PACKED));
 
 }  // namespace
 }  // namespace taichi::lang
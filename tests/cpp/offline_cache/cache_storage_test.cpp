@@ -0,0 +1,167 @@
+#include <filesystem>
+#include <map>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "taichi/common/cleanup.h"
+#include "taichi/util/offline_cache.h"
+
+#if defined(TI_PLATFORM_UNIX)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace taichi::lang {
+namespace {
+
+namespace fs = std::filesystem;
+namespace oc = offline_cache;
+
+TEST(CacheStorage, RemoteKey) {
+  const auto key = oc::make_remote_cache_key("llvm", "T1234.kpack");
+  EXPECT_EQ(key, fmt::format("{}.{}.{}/llvm/T1234.kpack", TI_VERSION_MAJOR,
+                             TI_VERSION_MINOR, TI_VERSION_PATCH));
+  const auto sm_80 = oc::make_remote_cache_key("llvm", "T1.native", "sm_80");
+  const auto sm_86 = oc::make_remote_cache_key("llvm", "T1.native", "sm_86");
+  EXPECT_NE(sm_80, sm_86);
+  EXPECT_EQ(sm_80.find(':'), std::string::npos);
+  EXPECT_EQ(sm_80, oc::make_remote_cache_key("llvm", "T1.native", "sm_80"));
+}
+
+TEST(CacheStorage, UnsupportedUrl) {
+  EXPECT_EQ(oc::make_cache_storage(""), nullptr);
+  EXPECT_EQ(oc::make_cache_storage("ftp://cache-server/ticache"), nullptr);
+}
+
+TEST(CacheStorage, Directory) {
+  fs::path tmp_dir{fs::temp_directory_path() /= std::tmpnam(nullptr)};
+  auto cleanup = make_cleanup([tmp_dir]() { fs::remove_all(tmp_dir); });
+
+  auto storage = oc::make_cache_storage("file://" + tmp_dir.u8string());
+  ASSERT_NE(storage, nullptr);
+  const auto key = oc::make_remote_cache_key("gfx", "T1.spvpack", "vulkan");
+  std::string bytes;
+  EXPECT_FALSE(storage->get(key, bytes));
+
+  const std::string value = "compiled kernel";
+  ASSERT_TRUE(storage->put(key, value.data(), value.size()));
+  ASSERT_TRUE(storage->get(key, bytes));
+  EXPECT_EQ(bytes, value);
+
+  // Another machine replaces it.
+  auto other = oc::make_cache_storage("file://" + tmp_dir.u8string());
+  const std::string new_value = "recompiled kernel";
+  ASSERT_TRUE(other->put(key, new_value.data(), new_value.size()));
+  ASSERT_TRUE(storage->get(key, bytes));
+  EXPECT_EQ(bytes, new_value);
+}
+
+#if defined(TI_PLATFORM_UNIX)
+// Answers the GET and PUT requests of |num_requests| connections with
+// |values|.
+class TestHttpServer {
+ public:
+  TestHttpServer(int num_requests, std::map<std::string, std::string> &values)
+      : values_(values) {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    ::listen(fd_, 4);
+    thread_ = std::thread([this, num_requests]() {
+      for (int i = 0; i < num_requests; i++) {
+        serve(::accept(fd_, nullptr, nullptr));
+      }
+    });
+  }
+
+  ~TestHttpServer() {
+    thread_.join();
+    ::close(fd_);
+  }
+
+  int port() const {
+    return port_;
+  }
+
+ private:
+  void serve(int conn) {
+    std::string request;
+    char buf[4096];
+    std::size_t header_end = std::string::npos;
+    std::size_t content_length = 0;
+    while (true) {
+      if (header_end == std::string::npos) {
+        header_end = request.find("\r\n\r\n");
+        const auto pos = request.find("Content-Length: ");
+        if (header_end != std::string::npos && pos != std::string::npos) {
+          content_length = std::stoull(request.substr(pos + 16));
+        }
+      }
+      if (header_end != std::string::npos &&
+          request.size() >= header_end + 4 + content_length) {
+        break;
+      }
+      const auto n = ::recv(conn, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        break;
+      }
+      request.append(buf, n);
+    }
+    const auto method = request.substr(0, request.find(' '));
+    const auto path_begin = method.size() + 1;
+    const auto path =
+        request.substr(path_begin, request.find(' ', path_begin) - path_begin);
+    std::string response;
+    if (method == "PUT") {
+      values_[path] = request.substr(header_end + 4, content_length);
+      response = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+    } else if (auto itr = values_.find(path); itr != values_.end()) {
+      // Chunked, as servers do when they don't know the length in advance.
+      const auto &v = itr->second;
+      const auto half = v.size() / 2;
+      response = fmt::format(
+          "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "{:x}\r\n{}\r\n{:x}\r\n{}\r\n0\r\n\r\n",
+          half, v.substr(0, half), v.size() - half, v.substr(half));
+    } else {
+      response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+    ::send(conn, response.data(), response.size(), 0);
+    ::close(conn);
+  }
+
+  std::map<std::string, std::string> &values_;
+  int fd_{-1};
+  int port_{0};
+  std::thread thread_;
+};
+
+TEST(CacheStorage, Http) {
+  const auto key = oc::make_remote_cache_key("llvm", "T1.kpack");
+  const std::string value = "compiled kernel";
+  std::string bytes;
+  std::map<std::string, std::string> values;
+  {
+    TestHttpServer server(/*num_requests=*/3, values);
+    auto storage = oc::make_cache_storage(
+        fmt::format("http://127.0.0.1:{}/ticache/", server.port()));
+    EXPECT_FALSE(storage->get(key, bytes));
+    // The server is joined at the end of the scope, so it must get all the
+    // requests.
+    EXPECT_TRUE(storage->put(key, value.data(), value.size()));
+    EXPECT_TRUE(storage->get(key, bytes));
+    EXPECT_EQ(bytes, value);
+  }
+  EXPECT_EQ(values.count("/ticache/" + key), 1);
+}
+#endif
+
+}  // namespace
+}  // namespace taichi::lang
@@ -0,0 +1,130 @@
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// a[i] = i * factor for i in range(n)
+std::unique_ptr<Kernel> make_scale_kernel(Program *prog, int factor) {
+  IRBuilder builder;
+  auto *arg = builder.create_arg_load(/*arg_id=*/0, get_data_type<int>(),
+                                      /*is_ptr=*/true);
+  auto *n = builder.create_arg_load(/*arg_id=*/1, get_data_type<int>(),
+                                    /*is_ptr=*/false);
+  auto *loop = builder.create_range_for(builder.get_int32(0), n);
+  {
+    auto _ = builder.get_loop_guard(loop);
+    auto *index = builder.get_loop_index(loop);
+    auto *value = builder.create_mul(index, builder.get_int32(factor));
+    builder.create_global_store(builder.create_external_ptr(arg, {index}),
+                                value);
+  }
+  auto kernel = std::make_unique<Kernel>(*prog, builder.extract_ir(),
+                                         fmt::format("scale_{}", factor));
+  kernel->insert_arr_param(get_data_type<int>(), /*total_dim=*/1, {1});
+  kernel->insert_scalar_param(get_data_type<int>());
+  return kernel;
+}
+
+}  // namespace
+
+TEST(Program, CompileKernels) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  constexpr int kNumKernels = 8;
+  constexpr int kSize = 100;
+  std::vector<std::unique_ptr<Kernel>> kernels;
+  std::vector<Kernel *> kernel_ptrs;
+  for (int k = 0; k < kNumKernels; k++) {
+    kernels.push_back(make_scale_kernel(prog, k));
+    kernel_ptrs.push_back(kernels.back().get());
+  }
+  prog->compile_kernels(prog->this_thread_config(), kernel_ptrs);
+  for (auto *kernel : kernel_ptrs) {
+    EXPECT_TRUE(kernel->is_compiled());
+  }
+
+  auto array = std::make_unique<int[]>(kSize);
+  for (int k = 0; k < kNumKernels; k++) {
+    auto launch_ctx = kernels[k]->make_launch_context();
+    launch_ctx.set_arg_external_array_with_shape(
+        /*arg_id=*/0, (uint64)array.get(), kSize * sizeof(int), {kSize});
+    launch_ctx.set_arg_int(/*arg_id=*/1, kSize);
+    (*kernels[k])(prog->this_thread_config(), launch_ctx);
+    for (int i = 0; i < kSize; i++) {
+      ASSERT_EQ(array[i], i * k);
+    }
+  }
+}
+
+TEST(Program, WarmUpKernels) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  constexpr int kNumKernels = 4;
+  constexpr int kSize = 100;
+  std::vector<std::unique_ptr<Kernel>> kernels;
+  std::vector<Kernel *> kernel_ptrs;
+  for (int k = 0; k < kNumKernels; k++) {
+    kernels.push_back(make_scale_kernel(prog, k + 1));
+    kernel_ptrs.push_back(kernels.back().get());
+  }
+  prog->warm_up_kernels(prog->this_thread_config(), kernel_ptrs);
+
+  // Launching right away waits for the background compilation of the kernel.
+  auto array = std::make_unique<int[]>(kSize);
+  for (int k = kNumKernels - 1; k >= 0; k--) {
+    auto launch_ctx = kernels[k]->make_launch_context();
+    launch_ctx.set_arg_external_array_with_shape(
+        /*arg_id=*/0, (uint64)array.get(), kSize * sizeof(int), {kSize});
+    launch_ctx.set_arg_int(/*arg_id=*/1, kSize);
+    (*kernels[k])(prog->this_thread_config(), launch_ctx);
+    for (int i = 0; i < kSize; i++) {
+      ASSERT_EQ(array[i], i * (k + 1));
+    }
+  }
+  prog->wait_for_warm_up();
+  for (auto *kernel : kernel_ptrs) {
+    EXPECT_TRUE(kernel->is_compiled());
+  }
+}
+
+TEST(Program, ConcurrentCpuPrograms) {
+  constexpr int kNumPrograms = 4;
+  constexpr int kSize = 100;
+  std::vector<std::unique_ptr<int[]>> arrays;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumPrograms; p++) {
+    arrays.push_back(std::make_unique<int[]>(kSize));
+    threads.emplace_back([&, p] {
+      TestProgram test_prog;
+      test_prog.setup();
+      auto *prog = test_prog.prog();
+      auto kernel = make_scale_kernel(prog, p + 1);
+      auto launch_ctx = kernel->make_launch_context();
+      launch_ctx.set_arg_external_array_with_shape(
+          /*arg_id=*/0, (uint64)arrays[p].get(), kSize * sizeof(int), {kSize});
+      launch_ctx.set_arg_int(/*arg_id=*/1, kSize);
+      (*kernel)(prog->this_thread_config(), launch_ctx);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (int p = 0; p < kNumPrograms; p++) {
+    for (int i = 0; i < kSize; i++) {
+      ASSERT_EQ(arrays[p][i], i * (p + 1));
+    }
+  }
+}
+
+}  // namespace taichi::lang
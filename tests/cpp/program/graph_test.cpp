@@ -53,4 +53,52 @@ TEST(GraphTest, SimpleGraphRun) {
   EXPECT_EQ(array.read_int({1}), 2);
   EXPECT_EQ(array.read_int({2}), 42);
 }
+
+TEST(GraphTest, BoundGraphRun) {
+  if (!vulkan::is_vulkan_api_available()) {
+    return;
+  }
+  TestProgram test_prog;
+  test_prog.setup(Arch::vulkan);
+
+  const int size = 10;
+
+  auto ker1 = setup_kernel1(test_prog.prog());
+  auto ker2 = setup_kernel2(test_prog.prog());
+
+  auto g_builder = std::make_unique<GraphBuilder>();
+  auto seq = g_builder->seq();
+  auto arr_arg = aot::Arg{aot::ArgKind::kNdarray, "arr", PrimitiveType::i32, 1};
+  seq->dispatch(ker1.get(), {arr_arg});
+  seq->dispatch(ker2.get(), {arr_arg, aot::Arg{
+                                          aot::ArgKind::kScalar,
+                                          "x",
+                                          PrimitiveType::i32,
+                                      }});
+
+  auto g = g_builder->compile();
+  const int arr_slot = g->get_arg_slot("arr");
+  const int x_slot = g->get_arg_slot("x");
+  EXPECT_GE(arr_slot, 0);
+  EXPECT_GE(x_slot, 0);
+  EXPECT_NE(arr_slot, x_slot);
+  EXPECT_EQ(g->get_arg_slot("y"), -1);
+
+  auto array = Ndarray(test_prog.prog(), PrimitiveType::i32, {size});
+  array.write_int({0}, 2);
+  array.write_int({2}, 40);
+  g->bind(arr_slot, aot::IValue::create(array));
+  g->bind(x_slot, aot::IValue::create<int>(2));
+  g->run_bound();
+  test_prog.prog()->synchronize();
+  EXPECT_EQ(array.read_int({1}), 2);
+  EXPECT_EQ(array.read_int({2}), 42);
+
+  // Only the scalar changes, the ndarray stays bound.
+  g->bind(x_slot, aot::IValue::create<int>(5));
+  g->run_bound();
+  test_prog.prog()->synchronize();
+  EXPECT_EQ(array.read_int({1}), 5);
+  EXPECT_EQ(array.read_int({2}), 44);
+}
 #endif
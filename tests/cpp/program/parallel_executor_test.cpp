@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "taichi/program/parallel_executor.h"
+
+namespace taichi::lang {
+
+TEST(ParallelExecutor, FuturesAndFlush) {
+  std::atomic<int> counter{0};
+  {
+    ParallelExecutor executor("test", 4);
+    std::vector<std::future<void>> futures;
+    // More tasks than the queue can hold at once.
+    const int n = ParallelExecutor::kTaskQueueCapacity * 2;
+    for (int i = 0; i < n; i++) {
+      futures.push_back(executor.enqueue([&]() { counter++; }));
+    }
+    futures.front().get();
+    EXPECT_GE(counter.load(), 1);
+    executor.flush();
+    EXPECT_EQ(counter.load(), n);
+
+    // Workers park once idle and are woken up by new tasks.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    executor.enqueue([&]() { counter++; }).get();
+    EXPECT_EQ(counter.load(), n + 1);
+  }
+}
+
+TEST(ParallelExecutor, ExceptionThroughFuture) {
+  ParallelExecutor executor("test", 2);
+  auto future =
+      executor.enqueue([]() { throw std::runtime_error("compile failed"); });
+  EXPECT_THROW(future.get(), std::runtime_error);
+  executor.flush();
+}
+
+TEST(ParallelExecutor, NoWorkerThreads) {
+  ParallelExecutor executor("test", 0);
+  int counter = 0;
+  auto future = executor.enqueue([&]() { counter++; });
+  EXPECT_EQ(counter, 1);
+  future.get();
+  executor.flush();
+}
+
+}  // namespace taichi::lang
@@ -25,4 +25,24 @@ TEST(SNodeTree, GetSNodeToRootMapping) {
   }
 }
 
+TEST(SNode, MortonRuns) {
+  SNode root{/*depth=*/0, /*t=*/SNodeType::root};
+  // 1 bit on ti.i and 4 bits on ti.j: the linearized index is jjjij from the
+  // most significant bit.
+  auto &dense =
+      root.dense({Axis{0}, Axis{1}}, std::vector<int>{2, 16}, "").morton();
+  auto i_runs = dense.morton_runs(0);
+  ASSERT_EQ(i_runs.size(), 1);
+  EXPECT_EQ(i_runs[0].coord_bit, 0);
+  EXPECT_EQ(i_runs[0].index_bit, 1);
+  EXPECT_EQ(i_runs[0].num_bits, 1);
+  auto j_runs = dense.morton_runs(1);
+  ASSERT_EQ(j_runs.size(), 2);
+  EXPECT_EQ(j_runs[0].coord_bit, 0);
+  EXPECT_EQ(j_runs[0].index_bit, 0);
+  EXPECT_EQ(j_runs[1].coord_bit, 1);
+  EXPECT_EQ(j_runs[1].index_bit, 2);
+  EXPECT_EQ(j_runs[1].num_bits, 3);
+}
+
 }  // namespace taichi::lang
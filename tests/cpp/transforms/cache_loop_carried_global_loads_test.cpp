@@ -0,0 +1,88 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi::lang {
+namespace {
+
+constexpr int kSize = 16;
+
+class CacheLoopCarriedGlobalLoadsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // ti.root.dense(ti.i, kSize).place(x, y)
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    auto &dense = root_snode_->dense({Axis{0}}, /*sizes=*/kSize, "");
+    x_ = &dense.insert_children(SNodeType::place);
+    x_->dt = PrimitiveType::f32;
+    y_ = &dense.insert_children(SNodeType::place);
+    y_->dt = PrimitiveType::f32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+  }
+
+  // for i in range(1, kSize - 1): |dest|[i] = x[i - 1] + x[i] + x[i + 1]
+  void build_stencil(SNode *dest) {
+    loop_ = builder_.create_range_for(builder_.get_int32(1),
+                                      builder_.get_int32(kSize - 1));
+    {
+      auto _ = builder_.get_loop_guard(loop_);
+      auto *i = builder_.get_loop_index(loop_);
+      auto load_x = [&](Stmt *index) {
+        return builder_.create_global_load(
+            builder_.create_global_ptr(x_, {index}));
+      };
+      auto *sum = builder_.create_add(
+          builder_.create_add(
+              load_x(builder_.create_sub(i, builder_.get_int32(1))),
+              load_x(i)),
+          load_x(builder_.create_add(i, builder_.get_int32(1))));
+      builder_.create_global_store(builder_.create_global_ptr(dest, {i}), sum);
+    }
+    block_ = builder_.extract_ir();
+    irpass::flag_access(block_.get());
+    irpass::type_check(block_.get(), config_);
+  }
+
+  static int count_global_loads(Block *block) {
+    return irpass::analysis::gather_statements(block, [](Stmt *stmt) {
+             return stmt->is<GlobalLoadStmt>();
+           }).size();
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  RangeForStmt *loop_{nullptr};
+  std::unique_ptr<Block> block_{nullptr};
+  CompileConfig config_;
+  IRBuilder builder_;
+};
+
+TEST_F(CacheLoopCarriedGlobalLoadsTest, Stencil) {
+  build_stencil(y_);
+  EXPECT_TRUE(irpass::cache_loop_carried_global_loads(block_.get(), config_));
+  irpass::analysis::verify(block_.get());
+
+  // x[i - 1] and x[i] of the first iteration are loaded before the loop, and
+  // only x[i + 1] is loaded in each iteration.
+  EXPECT_EQ(count_global_loads(loop_->body.get()), 1);
+  EXPECT_EQ(count_global_loads(block_.get()), 3);
+}
+
+TEST_F(CacheLoopCarriedGlobalLoadsTest, InPlaceStencil) {
+  // The loaded elements of x are written in later iterations.
+  build_stencil(x_);
+  EXPECT_FALSE(irpass::cache_loop_carried_global_loads(block_.get(), config_));
+  EXPECT_EQ(count_global_loads(loop_->body.get()), 3);
+}
+
+}  // namespace
+}  // namespace taichi::lang
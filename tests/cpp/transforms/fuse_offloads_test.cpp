@@ -0,0 +1,134 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/struct/struct.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi::lang {
+namespace {
+
+constexpr int kSize = 8;
+
+class FuseOffloadsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // ti.root.dense(ti.ij, kSize).place(x, y)
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    auto &dense = root_snode_->dense({Axis{0}, Axis{1}}, /*sizes=*/kSize, "");
+    x_ = &dense.insert_children(SNodeType::place);
+    x_->dt = PrimitiveType::f32;
+    y_ = &dense.insert_children(SNodeType::place);
+    y_->dt = PrimitiveType::f32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+
+    block_ = std::make_unique<Block>();
+  }
+
+  // Appends a range-for over [0, |end|) and moves the builder into its body.
+  OffloadedStmt *add_task(int end = kSize * kSize) {
+    auto task = std::make_unique<OffloadedStmt>(
+        /*task_type=*/OffloadedTaskType::range_for, /*arch=*/Arch::x64);
+    task->const_begin = true;
+    task->const_end = true;
+    task->begin_value = 0;
+    task->end_value = end;
+    task->block_dim = 32;
+    auto *result = block_->insert(std::move(task))->as<OffloadedStmt>();
+    builder_.set_insertion_point({/*block=*/result->body.get(),
+                                  /*position=*/0});
+    return result;
+  }
+
+  // The indices of an ndrange(kSize, kSize)-for.
+  std::vector<Stmt *> get_ij(OffloadedStmt *task) {
+    auto *index = builder_.get_loop_index(task);
+    auto *size = builder_.get_int32(kSize);
+    return {builder_.create_div(index, size), builder_.create_mod(index, size)};
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  std::unique_ptr<Block> block_{nullptr};
+  IRBuilder builder_;
+};
+
+TEST_F(FuseOffloadsTest, Elementwise) {
+  // x[i, j] = 1; y[i, j] = x[i, j]
+  auto *a = add_task();
+  builder_.create_global_store(builder_.create_global_ptr(x_, get_ij(a)),
+                               builder_.get_float32(1.0f));
+  auto *b = add_task();
+  auto ij = get_ij(b);
+  auto *x_ij = builder_.create_global_load(builder_.create_global_ptr(x_, ij));
+  builder_.create_global_store(builder_.create_global_ptr(y_, ij), x_ij);
+
+  EXPECT_TRUE(irpass::fuse_offloads(block_.get()));
+  ASSERT_EQ(block_->size(), 1);
+  auto *fused = block_->statements[0]->as<OffloadedStmt>();
+  int num_loop_indices = 0;
+  for (auto &stmt : fused->body->statements) {
+    if (auto *index = stmt->cast<LoopIndexStmt>()) {
+      EXPECT_EQ(index->loop, fused);
+      num_loop_indices++;
+    }
+  }
+  EXPECT_EQ(num_loop_indices, 2);
+}
+
+TEST_F(FuseOffloadsTest, Neighbor) {
+  // x[i, j] = 1; y[i, j] = x[i, 0]
+  auto *a = add_task();
+  builder_.create_global_store(builder_.create_global_ptr(x_, get_ij(a)),
+                               builder_.get_float32(1.0f));
+  auto *b = add_task();
+  auto ij = get_ij(b);
+  auto *x_i0 = builder_.create_global_load(
+      builder_.create_global_ptr(x_, {ij[0], builder_.get_int32(0)}));
+  builder_.create_global_store(builder_.create_global_ptr(y_, ij), x_i0);
+
+  EXPECT_FALSE(irpass::fuse_offloads(block_.get()));
+  EXPECT_EQ(block_->size(), 2);
+}
+
+TEST_F(FuseOffloadsTest, NotInjective) {
+  // x[i, 0] = 1; y[i, 0] = x[i, 0]
+  for (int t = 0; t < 2; t++) {
+    auto *task = add_task();
+    auto *i = get_ij(task)[0];
+    auto *zero = builder_.get_int32(0);
+    auto *x_i0 = builder_.create_global_ptr(x_, {i, zero});
+    if (t == 0) {
+      builder_.create_global_store(x_i0, builder_.get_float32(1.0f));
+    } else {
+      builder_.create_global_store(builder_.create_global_ptr(y_, {i, zero}),
+                                   builder_.create_global_load(x_i0));
+    }
+  }
+
+  EXPECT_FALSE(irpass::fuse_offloads(block_.get()));
+  EXPECT_EQ(block_->size(), 2);
+}
+
+TEST_F(FuseOffloadsTest, DifferentRanges) {
+  // x[i, j] = 1 over the whole field, then y[i, j] = x[i, j] over half of it.
+  auto *a = add_task();
+  builder_.create_global_store(builder_.create_global_ptr(x_, get_ij(a)),
+                               builder_.get_float32(1.0f));
+  auto *b = add_task(/*end=*/kSize * kSize / 2);
+  builder_.create_global_store(
+      builder_.create_global_ptr(y_, get_ij(b)),
+      builder_.create_global_load(builder_.create_global_ptr(x_, get_ij(b))));
+
+  EXPECT_FALSE(irpass::fuse_offloads(block_.get()));
+  EXPECT_EQ(block_->size(), 2);
+}
+
+}  // namespace
+}  // namespace taichi::lang
@@ -0,0 +1,100 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi::lang {
+namespace {
+
+class MakeThreadLocalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // ti.root.dense(ti.i, 8).place(x)
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    auto &dense = root_snode_->dense({Axis{0}}, /*sizes=*/8, "");
+    place_snode_ = &(dense.insert_children(SNodeType::place));
+    place_snode_->dt = PrimitiveType::f32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+
+    for_stmt_ = std::make_unique<OffloadedStmt>(
+        /*task_type=*/OffloadedTaskType::range_for,
+        /*arch=*/Arch::x64);
+    for_stmt_->const_begin = true;
+    for_stmt_->const_end = true;
+    for_stmt_->begin_value = 0;
+    for_stmt_->end_value = 1024;
+    builder_.set_insertion_point(
+        {/*block=*/for_stmt_->body.get(), /*position=*/0});
+  }
+
+  std::vector<AtomicOpStmt *> epilogue_atomics() const {
+    std::vector<AtomicOpStmt *> atomics;
+    if (for_stmt_->tls_epilogue) {
+      for (auto &s : for_stmt_->tls_epilogue->statements) {
+        if (auto atomic = s->cast<AtomicOpStmt>()) {
+          atomics.push_back(atomic);
+        }
+      }
+    }
+    return atomics;
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *place_snode_{nullptr};
+  std::unique_ptr<OffloadedStmt> for_stmt_{nullptr};
+
+  IRBuilder builder_;
+};
+
+TEST_F(MakeThreadLocalTest, LoopInvariantIndices) {
+  // x[2] += 1.0; x[i0 + 1] += 1.0 with an argument i0; x[i] += 1.0
+  auto *one = builder_.get_float32(1.0f);
+  auto *ptr_const =
+      builder_.create_global_ptr(place_snode_, {builder_.get_int32(2)});
+  builder_.create_atomic_add(ptr_const, one);
+  auto *arg = builder_.create_arg_load(/*arg_id=*/0, PrimitiveType::i32,
+                                       /*is_ptr=*/false);
+  auto *ptr_arg = builder_.create_global_ptr(
+      place_snode_, {builder_.create_add(arg, builder_.get_int32(1))});
+  builder_.create_atomic_add(ptr_arg, one);
+  auto *loop_index = builder_.get_loop_index(for_stmt_.get());
+  auto *ptr_loop = builder_.create_global_ptr(place_snode_, {loop_index});
+  builder_.create_atomic_add(ptr_loop, one);
+
+  irpass::make_thread_local(for_stmt_.get(), CompileConfig{});
+
+  // |ptr_arg| may alias the others, but all of them are only added to.
+  auto atomics = epilogue_atomics();
+  ASSERT_EQ(atomics.size(), 2);
+  for (auto *atomic : atomics) {
+    EXPECT_TRUE(atomic->is_reduction);
+    auto *dest = atomic->dest->as<GlobalPtrStmt>();
+    ASSERT_EQ(dest->indices.size(), 1);
+    // The indices are recomputed in the epilogue.
+    EXPECT_EQ(dest->indices[0]->parent, for_stmt_->tls_epilogue.get());
+  }
+  EXPECT_EQ(for_stmt_->tls_size, 2 * sizeof(float32));
+  // The accumulation to x[i] is left global.
+  EXPECT_EQ(ptr_loop->parent, for_stmt_->body.get());
+}
+
+TEST_F(MakeThreadLocalTest, LoadedDestinationStaysGlobal) {
+  // x[3] += 1.0; y = x[3]
+  auto *ptr = builder_.create_global_ptr(place_snode_, {builder_.get_int32(3)});
+  builder_.create_atomic_add(ptr, builder_.get_float32(1.0f));
+  builder_.create_global_load(
+      builder_.create_global_ptr(place_snode_, {builder_.get_int32(3)}));
+
+  irpass::make_thread_local(for_stmt_.get(), CompileConfig{});
+
+  EXPECT_TRUE(epilogue_atomics().empty());
+}
+
+}  // namespace
+}  // namespace taichi::lang
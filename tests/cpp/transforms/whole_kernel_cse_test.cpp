@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/statements.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi::lang {
+
+TEST(WholeKernelCSE, ChainedEliminations) {
+  IRBuilder builder;
+  // (x + y) * 2 and (x + y) * 2, and x * y which shares the operands of
+  // x + y but not its operation.
+  auto *x = builder.create_arg_load(0, get_data_type<int>(), false);
+  auto *y = builder.create_arg_load(1, get_data_type<int>(), false);
+  auto *a = builder.create_mul(builder.create_add(x, y), builder.get_int32(2));
+  auto *b = builder.create_mul(builder.create_add(x, y), builder.get_int32(2));
+  auto *c = builder.create_mul(x, y);
+  builder.create_return(builder.create_add(builder.create_add(a, b), c));
+  auto ir = builder.extract_ir();
+  auto *ir_block = ir->as<Block>();
+  irpass::type_check(ir_block, CompileConfig());
+  EXPECT_EQ(ir_block->size(), 12);
+
+  EXPECT_TRUE(irpass::whole_kernel_cse(ir_block));
+  // The second x + y, 2 and their product are eliminated.
+  EXPECT_EQ(ir_block->size(), 9);
+  auto *sum = ir_block->statements[ir_block->size() - 3]->as<BinaryOpStmt>();
+  EXPECT_EQ(sum->lhs, a);
+  EXPECT_EQ(sum->rhs, a);
+  EXPECT_EQ(ir_block->statements[ir_block->size() - 4].get(), c);
+
+  EXPECT_FALSE(irpass::whole_kernel_cse(ir_block));
+}
+
+}  // namespace taichi::lang
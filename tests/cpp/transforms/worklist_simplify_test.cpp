@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi::lang {
+
+class WorklistSimplifyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tp_.setup();
+    // Keeps the JIT evaluator out of these tests.
+    config_.constant_folding = false;
+  }
+
+  Program &prog() {
+    return *tp_.prog();
+  }
+
+  TestProgram tp_;
+  CompileConfig config_;
+};
+
+TEST_F(WorklistSimplifyTest, Chain) {
+  auto block = std::make_unique<Block>();
+
+  auto func = []() {};
+  auto kernel = std::make_unique<Kernel>(prog(), func, "fake_kernel");
+
+  // ((a * 1) + 0) * 1
+  auto global_load_addr =
+      block->push_back<GlobalTemporaryStmt>(0, PrimitiveType::i32);
+  auto global_load = block->push_back<GlobalLoadStmt>(global_load_addr);
+  auto zero = block->push_back<ConstStmt>(TypedConstant(0));
+  auto one = block->push_back<ConstStmt>(TypedConstant(1));
+  auto mul1 =
+      block->push_back<BinaryOpStmt>(BinaryOpType::mul, global_load, one);
+  auto add = block->push_back<BinaryOpStmt>(BinaryOpType::add, mul1, zero);
+  auto mul2 = block->push_back<BinaryOpStmt>(BinaryOpType::mul, add, one);
+  auto global_store_addr =
+      block->push_back<GlobalTemporaryStmt>(4, PrimitiveType::i32);
+  auto global_store =
+      block->push_back<GlobalStoreStmt>(global_store_addr, mul2)
+          ->as<GlobalStoreStmt>();
+
+  irpass::type_check(block.get(), config_);
+  EXPECT_EQ(block->size(), 9);
+
+  EXPECT_TRUE(irpass::worklist_simplify(block.get(), config_, {&prog()}));
+
+  EXPECT_EQ(block->size(), 4);  // two addresses, one load, one store
+  EXPECT_EQ(global_store->val, global_load);
+  EXPECT_FALSE(irpass::worklist_simplify(block.get(), config_, {&prog()}));
+}
+
+TEST_F(WorklistSimplifyTest, DeadChainInIf) {
+  auto block = std::make_unique<Block>();
+
+  auto func = []() {};
+  auto kernel = std::make_unique<Kernel>(prog(), func, "fake_kernel");
+
+  auto global_load_addr =
+      block->push_back<GlobalTemporaryStmt>(0, PrimitiveType::i32);
+  auto global_load = block->push_back<GlobalLoadStmt>(global_load_addr);
+  auto if_stmt = block->push_back<IfStmt>(global_load)->as<IfStmt>();
+  auto true_block = std::make_unique<Block>();
+  auto two = true_block->push_back<ConstStmt>(TypedConstant(2));
+  auto add =
+      true_block->push_back<BinaryOpStmt>(BinaryOpType::add, global_load, two);
+  true_block->push_back<BinaryOpStmt>(BinaryOpType::mul, add, add);
+  if_stmt->set_true_statements(std::move(true_block));
+
+  irpass::type_check(block.get(), config_);
+
+  EXPECT_TRUE(irpass::worklist_simplify(block.get(), config_, {&prog()}));
+
+  EXPECT_EQ(block->size(), 3);
+  EXPECT_EQ(if_stmt->true_statements->size(), 0);
+}
+
+}  // namespace taichi::lang
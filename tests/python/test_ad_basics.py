@@ -508,3 +508,27 @@ def test_ad_global_store_forwarding():
     assert b.grad[None] == 0.0
     assert c.grad[None] == 0.0
     assert d.grad[None] == 0.0
+
+
+@test_utils.test()
+def test_ad_shared_parameter_gradients():
+    N = 4096
+    x = ti.field(ti.f32, shape=N)
+    w = ti.field(ti.f32, shape=2, needs_grad=True)
+    loss = ti.field(ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def compute():
+        for i in x:
+            # Every thread reads w[0] and w[1], so their gradients are
+            # reduced in thread-local storage before the global atomics.
+            loss[None] += w[0] * x[i] + w[1]
+
+    x.from_numpy(np.arange(N, dtype=np.float32) / N)
+    w[0] = 2.0
+    w[1] = 3.0
+    with ti.ad.Tape(loss=loss):
+        compute()
+
+    assert w.grad[0] == test_utils.approx((N - 1) / 2, rel=1e-4)
+    assert w.grad[1] == test_utils.approx(N, rel=1e-4)
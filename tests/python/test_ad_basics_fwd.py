@@ -1,3 +1,7 @@
+import math
+
+import pytest
+
 import taichi as ti
 from tests import test_utils
 
@@ -123,3 +127,43 @@ def test_clear_all_dual_field():
         with ti.ad.FwdMode(loss=loss, param=x):
             clear_dual_test()
         assert y.dual[None] == 4.0
+
+
+@test_utils.test(forward_ad_lanes=4)
+def test_ad_fwd_lanes():
+    N = 4
+    x = ti.field(ti.f32, shape=N)
+    y = ti.field(ti.f32, shape=N)
+    loss = ti.field(ti.f32, shape=N)
+    ti.root.lazy_dual()
+
+    for i in range(N):
+        x[i] = i + 1
+
+    @ti.kernel
+    def compute():
+        for i in range(N):
+            y[i] = x[i] * x[(i + 1) % N]
+            loss[i] = ti.sin(y[i])
+
+    # The four columns of the Jacobian in one pass.
+    seeds = [[1 if j == k else 0 for j in range(N)] for k in range(N)]
+    with ti.ad.FwdMode(loss=loss, param=x, seed=seeds):
+        compute()
+
+    for k in range(N):
+        for i in range(N):
+            xi, xj = i + 1, (i + 1) % N + 1
+            dy = (xj if i == k else 0) + (xi if (i + 1) % N == k else 0)
+            assert loss.duals[k][i] == test_utils.approx(
+                math.cos(xi * xj) * dy, rel=1e-4)
+
+
+@test_utils.test(forward_ad_lanes=2)
+def test_ad_fwd_too_many_seeds():
+    x = ti.field(ti.f32, shape=2, needs_dual=True)
+    loss = ti.field(ti.f32, shape=2, needs_dual=True)
+
+    with pytest.raises(RuntimeError, match='dual lanes'):
+        with ti.ad.FwdMode(loss=loss, param=x, seed=[[1, 0], [0, 1], [1, 1]]):
+            pass
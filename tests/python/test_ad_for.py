@@ -1,3 +1,5 @@
+import math
+
 import taichi as ti
 from tests import test_utils
 
@@ -1010,3 +1012,75 @@ def test_ib_global_load():
     compute.grad()
     for i in range(N):
         assert a.grad[i] == i
+
+
+@test_utils.test(require=ti.extension.adstack, ad_stack_memory_budget=128)
+def test_ad_stack_checkpointing():
+    N = 4
+    M = 100
+    x = ti.field(ti.f32, shape=N, needs_grad=True)
+    y = ti.field(ti.f32, shape=N, needs_grad=True)
+
+    @ti.kernel
+    def compute():
+        for i in range(N):
+            v = x[i]
+            # The stacks of |v| would take far more than 128 bytes, so only
+            # a checkpoint of every few iterations is kept.
+            for j in range(M):
+                v = ti.sin(v) * 0.9 + v * 0.1
+            y[i] = v
+
+    def reference(v):
+        dv = 1.0
+        for _ in range(M):
+            dv *= math.cos(v) * 0.9 + 0.1
+            v = math.sin(v) * 0.9 + v * 0.1
+        return v, dv
+
+    for i in range(N):
+        x[i] = 0.5 + i * 0.25
+        y.grad[i] = 1
+
+    compute()
+    compute.grad()
+
+    for i in range(N):
+        v, dv = reference(0.5 + i * 0.25)
+        assert y[i] == test_utils.approx(v, rel=1e-4)
+        assert x.grad[i] == test_utils.approx(dv, rel=1e-3)
+
+
+@test_utils.test(require=ti.extension.adstack,
+                 ad_stack_size=128,
+                 ad_stack_window_size=4)
+def test_ad_stack_spill():
+    N = 8
+    a = ti.field(ti.f32, shape=N, needs_grad=True)
+    b = ti.field(ti.i32, shape=N)
+    p = ti.field(ti.f32, shape=N, needs_grad=True)
+
+    @ti.kernel
+    def power():
+        for i in range(N):
+            ret = 1.0
+            # All but the top 4 entries of the stack of |ret| spill.
+            for j in range(b[i]):
+                ret = ret * a[i]
+            p[i] = ret
+
+    for i in range(N):
+        a[i] = 1.01
+        b[i] = i * 15
+
+    power()
+
+    for i in range(N):
+        assert p[i] == test_utils.approx(1.01**b[i], rel=1e-4)
+        p.grad[i] = 1
+
+    power.grad()
+
+    for i in range(N):
+        assert a.grad[i] == test_utils.approx(b[i] * 1.01**(b[i] - 1),
+                                              rel=1e-4)
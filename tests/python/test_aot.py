@@ -527,6 +527,41 @@ def test_aot_ndarray_template_mixed():
                     assert args_count == 2, res  # `arr` and `val1`
 
 
+@test_utils.test(arch=[ti.opengl, ti.vulkan])
+def test_aot_spec_constants():
+    @ti.kernel
+    def run(arr: ti.types.ndarray(), scale: ti.f32, n: ti.i32):
+        for i in range(n):
+            arr[i] = i * scale
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        x = ti.ndarray(dtype=ti.f32, shape=16)
+        m = ti.aot.Module()
+        m.add_kernel(run,
+                     template_args={'arr': x},
+                     spec_constants=['n', 'scale'])
+        m.save(tmpdir)
+        with open(os.path.join(tmpdir, 'metadata.json')) as json_file:
+            res = json.load(json_file)
+            kernel = next(k for k in res['kernels'] if k['name'] == 'run')
+            spec_args = [(a['name'], a['arg_id'])
+                         for a in kernel['ctx_attribs']['spec_constant_args']]
+            assert spec_args == [('n', 2), ('scale', 1)], res
+
+
+@test_utils.test(arch=[ti.opengl, ti.vulkan])
+def test_aot_spec_constants_unknown_arg():
+    @ti.kernel
+    def run(arr: ti.types.ndarray(), n: ti.i32):
+        for i in range(n):
+            arr[i] = i
+
+    x = ti.ndarray(dtype=ti.f32, shape=16)
+    m = ti.aot.Module()
+    with pytest.raises(ValueError, match="'count' is not"):
+        m.add_kernel(run, template_args={'arr': x}, spec_constants=['count'])
+
+
 @test_utils.test(arch=[ti.opengl, ti.vulkan])
 def test_archive():
     density = ti.field(float, shape=(4, 4))
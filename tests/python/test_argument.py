@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 import taichi as ti
@@ -232,3 +233,25 @@ def test_args_with_many_ndarrays():
                            outClusterIndices, particle_pos, particle_prev_pos,
                            particle_rest_pos, cluster_rest_mass_center,
                            cluster_begin, particle_index)
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda, ti.vulkan, ti.metal])
+def test_args_packed_in_one_call():
+    @ti.kernel
+    def foo(a: ti.i32, b: ti.f32, c: ti.u8, d: ti.types.vector(
+        2, ti.i32), x: ti.types.ndarray(), y: ti.types.ndarray()) -> ti.f32:
+        x[0] = a + c
+        y[0] = b
+        return d[0] + d[1] + b
+
+    x = ti.ndarray(ti.i32, shape=4)
+    y = ti.ndarray(ti.f32, shape=4, needs_grad=True)
+    assert foo(-3, 1.5, 255, ti.Vector([1, 2]), x, y) == 4.5
+    assert x[0] == 252
+    assert y[0] == 1.5
+
+    # Not ti.ndarrays, so the arguments are set one by one.
+    z = np.zeros(4, dtype=np.float32)
+    assert foo(1, 2, 3, ti.Vector([1, 2]), x, z) == 5
+    assert x[0] == 4
+    assert z[0] == 2
@@ -0,0 +1,56 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda], async_launch=True)
+def test_async_launch_order():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill(v: ti.i32):
+        for i in range(n):
+            x[i] = v
+
+    @ti.kernel
+    def increment():
+        for i in range(n):
+            x[i] += 1
+
+    @ti.kernel
+    def copy():
+        for i in range(n):
+            y[i] = x[i] * 2
+
+    fill(1)
+    fill(1)
+    increment()
+    increment()
+    copy()
+    fill(7)
+    assert (y.to_numpy() == np.full(n, 6)).all()
+    assert x[0] == 7
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda], async_launch=True)
+def test_async_launch_ndarray():
+    n = 8
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(v: ti.f32):
+        for i in range(n):
+            x[i] = v
+
+    @ti.kernel
+    def read(a: ti.types.ndarray(ndim=1)):
+        for i in range(n):
+            a[i] = x[i]
+
+    a = ti.ndarray(ti.f32, shape=n)
+    fill(2.0)
+    read(a)
+    assert (a.to_numpy() == np.full(n, 2.0)).all()
@@ -0,0 +1,30 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=ti.cuda, gpu_autotune_block_dim=True)
+def test_autotune_block_dim():
+    n = 100000
+    x = ti.field(ti.f32, shape=n)
+    total = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def step(k: ti.f32, m: ti.i32):
+        for i in x:
+            x[i] += k
+        for i in range(m):
+            total[None] += 1
+        ti.loop_config(block_dim=32)
+        for i in range(16):
+            x[i] += 1
+
+    expected = np.zeros(n, dtype=np.float32)
+    for k in range(12):
+        total[None] = 0
+        step(k, 1000)
+        expected += k
+        expected[:16] += 1
+        np.testing.assert_allclose(x.to_numpy(), expected)
+        assert total[None] == 1000
@@ -293,3 +293,30 @@ def test_root_deactivate():
     ti.root.deactivate_all()
     is_active()
     assert c[None] == 0
+
+
+@test_utils.test(require=ti.extension.sparse)
+def test_sparse_mask_words():
+    n = 3000
+    x = ti.field(ti.i32)
+    visits = ti.field(ti.i32, shape=n)
+    ti.root.pointer(ti.i, 2).bitmasked(ti.i, n).place(x)
+
+    cells = [0, 31, 32, 63, 100, 1023, 1024, 1055, 2047, 2500, 2999]
+    cells += list(range(1200, 1300))
+
+    for k in cells:
+        x[k] = k
+    x[n + 5] = 1
+
+    @ti.kernel
+    def visit():
+        for i in x:
+            if i < n:
+                visits[i] += 1
+
+    visit()
+    expected = [0] * n
+    for k in cells:
+        expected[k] = 1
+    assert visits.to_numpy().tolist() == expected
@@ -215,6 +215,36 @@ def test_multiple_types():
     verify_val()
 
 
+@test_utils.test(require=ti.extension.quant_basic, debug=True)
+def test_bitpacked_fields_consecutive_loops():
+    qi8 = ti.types.quant.int(8, True)
+    qu8 = ti.types.quant.int(8, False)
+
+    x = ti.field(dtype=qi8)
+    y = ti.field(dtype=qu8)
+    z = ti.field(dtype=qi8)
+
+    bitpack = ti.BitpackedFields(max_num_bits=32)
+    bitpack.place(x, y, z)
+    ti.root.dense(ti.i, 64).place(bitpack)
+
+    @ti.kernel
+    def foo():
+        # The loops are fused, and the store of x cannot be merged with the
+        # stores of y and z past the read of x.
+        for i in range(64):
+            x[i] = i - 32
+        for i in range(64):
+            y[i] = x[i] + 32
+            z[i] = -x[i] // 2
+
+    foo()
+    for i in range(64):
+        assert x[i] == i - 32
+        assert y[i] == i
+        assert z[i] == -(i - 32) // 2
+
+
 @test_utils.test()
 def test_invalid_place():
     f15 = ti.types.quant.float(exp=5, frac=10)
@@ -174,3 +174,23 @@ def test_bls_large_block():
 # TODO: BLS on CPU
 # TODO: BLS boundary out of bound
 # TODO: BLS with TLS
+
+
+@test_utils.test(arch=ti.cuda)
+def test_ndarray_stencil_1d():
+    N = 1000
+
+    @ti.kernel
+    def blur(x: ti.types.ndarray(), y: ti.types.ndarray()):
+        ti.loop_config(block_dim=64)
+        for i in range(1, N - 1):
+            y[i] = x[i - 1] + x[i] + x[i + 1]
+
+    x = ti.ndarray(ti.f32, shape=N)
+    y = ti.ndarray(ti.f32, shape=N)
+    for i in range(N):
+        x[i] = i
+    blur(x, y)
+
+    for i in range(1, N - 1):
+        assert y[i] == 3 * i
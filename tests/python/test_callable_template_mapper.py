@@ -31,6 +31,7 @@ def test_callable_template_mapper():
     assert mapper.lookup((0, 0, 0))[0] == 0
     assert mapper.lookup((0, 0, 1))[0] == 0
     assert mapper.lookup((0, 1, 0))[0] == 0
+    assert mapper.lookup((0, 1, 0))[1] == ('#', '#', '#')
 
     mapper = TaichiCallableTemplateMapper((KernelArgument(
         ti.i32, ti.i32), KernelArgument(
@@ -39,6 +40,7 @@ def test_callable_template_mapper():
     assert mapper.lookup((0, x, 0))[0] == 0
     assert mapper.lookup((0, y, 0))[0] == 1
     assert mapper.lookup((0, x, 1))[0] == 0
+    assert mapper.lookup((2, 1, 3))[1] == ('#', 1, '#')
 
 
 @test_utils.test()
@@ -0,0 +1,80 @@
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(compile_profiler=True)
+def test_compile_profiler_records():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 2
+
+    ti.profiler.clear_compile_profiler_info()
+    fill()
+
+    records = [
+        r for r in ti.profiler.get_compile_profiler_records()
+        if r['kernel'].startswith('fill')
+    ]
+    assert len(records) > 0
+    for r in records:
+        assert r['time_ms'] >= 0
+        assert r['num_statements_before'] >= 0
+        assert r['num_statements_after'] >= 0
+    assert any(r['pass'] == 'Lowered' for r in records)
+
+    ti.profiler.clear_compile_profiler_info()
+    assert len(ti.profiler.get_compile_profiler_records()) == 0
+
+
+@test_utils.test(compile_profiler=True, offline_cache=False)
+def test_compile_profiler_codegen_records():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 2
+
+    ti.profiler.clear_compile_profiler_info()
+    fill()
+
+    records = [
+        r for r in ti.profiler.get_compile_profiler_records()
+        if r['kernel'].startswith('fill')
+    ]
+    codegen = [r for r in records if r['code_size'] is not None]
+    assert len(codegen) > 0
+    assert all(r['code_size'] > 0 for r in codegen)
+    assert all(r['code_size'] is None for r in records
+               if r['pass'] == 'Lowered')
+
+    keys = ti.profiler.get_compile_profiler_kernel_keys()
+    fill_keys = [k for name, k in keys.items() if name.startswith('fill')]
+    assert len(fill_keys) == 1
+    assert fill_keys[0].startswith('T')
+
+
+@test_utils.test(compile_profiler=True, offline_cache=False)
+def test_compile_profiler_peak_memory():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 2
+
+    ti.profiler.clear_compile_profiler_info()
+    fill()
+
+    peaks = [
+        r['peak_memory'] for r in ti.profiler.get_compile_profiler_records()
+        if r['kernel'].startswith('fill')
+    ]
+    assert len(peaks) > 0
+    assert all(p is None or p > 0 for p in peaks)
+    # A high-water mark never decreases.
+    known = [p for p in peaks if p is not None]
+    assert known == sorted(known)
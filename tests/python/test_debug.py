@@ -112,6 +112,25 @@ def test_out_of_bound_with_offset():
         func()
 
 
+@test_utils.test(arch=[ti.cpu, ti.cuda],
+                 check_out_of_bound=True,
+                 gdb_trigger=False)
+def test_out_of_bound_reported_on_sync():
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def func(i: ti.i32):
+        for j in range(8):
+            x[j] = j
+        x[i] = 1
+
+    func(3)
+    ti.sync()
+    func(8)
+    with pytest.raises(RuntimeError):
+        ti.sync()
+
+
 @test_utils.test(require=ti.extension.assertion, debug=True, gdb_trigger=False)
 def test_not_out_of_bound_with_offset():
     x = ti.field(ti.i32, shape=(8, 16), offset=(-4, -8))
@@ -0,0 +1,114 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test()
+def test_gather_access_footprints():
+    n, m = 16, 4
+    x = ti.field(ti.f32, shape=(n, m), offset=(-2, 0))
+    y = ti.field(ti.f32, shape=(n, m))
+
+    @ti.kernel
+    def stencil(lo: ti.i32, hi: ti.i32):
+        for i in range(lo, hi):
+            for j in range(m):
+                y[i, j] = x[i - 1, j] + x[i + 2, j]
+        for i, j in y:
+            x[i, j] = y[i, j] * 2
+
+    # Leaves out the serial task that computes the bounds of the range-for.
+    footprints = [
+        task for task in stencil._primal.gather_access_footprints(1, n - 2)
+        if task
+    ]
+    assert len(footprints) == 2
+    x_id = x.snode.ptr.id
+    y_id = y.snode.ptr.id
+    assert footprints[0][x_id] == ([(-1, 2), None], [])
+    assert footprints[0][y_id] == ([], [(0, 0), None])
+    assert footprints[1][y_id] == ([(0, 0), (0, 0)], [])
+    assert footprints[1][x_id] == ([], [(0, 0), (0, 0)])
+
+
+def _make_ranks(num_ranks, shape, **kwargs):
+    xs, ys = [], []
+    for comm in ti.experimental.LocalComm(num_ranks).ranks():
+        xs.append(
+            ti.experimental.DistributedField(ti.f32,
+                                             shape,
+                                             comm,
+                                             ghost=2,
+                                             tag=0,
+                                             **kwargs))
+        ys.append(
+            ti.experimental.DistributedField(ti.f32,
+                                             shape,
+                                             comm,
+                                             ghost=2,
+                                             tag=1,
+                                             **kwargs))
+    return xs, ys
+
+
+@pytest.mark.parametrize('block_shape', [None, (2, 4)])
+@test_utils.test()
+def test_distributed_stencil(block_shape):
+    n, m = 30, 4
+    xs, ys = _make_ranks(3, (n, m), block_shape=block_shape)
+
+    @ti.kernel
+    def smooth(lo: ti.i32, hi: ti.i32, src: ti.template(),
+               dst: ti.template()):
+        for i in range(lo, hi):
+            for j in range(m):
+                dst[i, j] = src[i - 1, j] + src[i, j] + src[i + 2, j]
+
+    a = np.random.rand(n, m).astype(np.float32)
+    for x in xs:
+        x.from_numpy(a[x.begin:x.end])
+    kernels = [
+        ti.experimental.DistributedKernel(smooth, [x, y])
+        for x, y in zip(xs, ys)
+    ]
+    for _ in range(2):
+        # Each rank starts exchanging its ghost rows before any of them waits
+        # for those of its neighbors.
+        for src, dst in [(xs, ys), (ys, xs)]:
+            launches = [
+                k.start(s.field, d.field)
+                for k, s, d in zip(kernels, src, dst)
+            ]
+            for launch in launches:
+                launch.finish()
+            padded = np.pad(a, ((1, 2), (0, 0)))
+            a = padded[:-3] + padded[1:-2] + padded[3:]
+    np.testing.assert_allclose(np.concatenate([x.to_numpy() for x in xs]),
+                               a,
+                               rtol=1e-5)
+
+
+@test_utils.test()
+def test_distributed_kernel_checks():
+    n, m = 12, 2
+    xs, ys = _make_ranks(1, (n, m))
+    x, y = xs[0], ys[0]
+
+    @ti.kernel
+    def too_far(lo: ti.i32, hi: ti.i32):
+        for i in range(lo, hi):
+            for j in range(m):
+                y.field[i, j] = x.field[i + 3, j]
+
+    @ti.kernel
+    def scatter(lo: ti.i32, hi: ti.i32):
+        for i in range(lo, hi):
+            for j in range(m):
+                y.field[i + 1, j] = x.field[i, j]
+
+    with pytest.raises(ValueError, match='ghost rows'):
+        ti.experimental.DistributedKernel(too_far, [x, y])()
+    with pytest.raises(ValueError, match='other than its own rows'):
+        ti.experimental.DistributedKernel(scatter, [x, y])()
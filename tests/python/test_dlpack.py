@@ -0,0 +1,71 @@
+import numpy as np
+import pytest
+from taichi.lang.util import has_pytorch
+
+import taichi as ti
+from tests import test_utils
+
+if has_pytorch():
+    import torch
+
+requires_numpy_dlpack = pytest.mark.skipif(not hasattr(np, 'from_dlpack'),
+                                           reason='NumPy has no DLPack')
+
+
+@requires_numpy_dlpack
+@test_utils.test(arch=ti.cpu)
+def test_ndarray_dlpack_numpy():
+    src = np.arange(12, dtype=np.float32).reshape(3, 4)
+    x = ti.from_dlpack(src)
+    assert x.shape == (3, 4)
+
+    @ti.kernel
+    def double(a: ti.types.ndarray()):
+        for i, j in a:
+            a[i, j] *= 2
+
+    double(x)
+    # |src| shares its memory with |x|.
+    assert (src == np.arange(12).reshape(3, 4) * 2).all()
+
+    y = ti.ndarray(ti.i32, shape=(5, ))
+    y.fill(7)
+    view = np.from_dlpack(y)
+    assert (view == 7).all()
+    y[2] = 3
+    assert view[2] == 3
+
+
+@requires_numpy_dlpack
+@test_utils.test(arch=ti.cpu)
+def test_field_dlpack_numpy():
+    x = ti.field(ti.f32, shape=(4, 6))
+    y = ti.field(ti.i32, shape=5)
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = i * 10 + j
+        for i in y:
+            y[i] = -i
+
+    fill()
+    assert (np.from_dlpack(x) == x.to_numpy()).all()
+    assert (np.from_dlpack(y) == -np.arange(5)).all()
+
+
+@pytest.mark.skipif(not has_pytorch(), reason='Pytorch not installed.')
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_ndarray_dlpack_torch():
+    device = 'cuda' if ti.lang.impl.current_cfg().arch == ti.cuda else 'cpu'
+    t = torch.zeros(8, 3, device=device)
+    x = ti.from_dlpack(t)
+    x.fill(2)
+    ti.sync()
+    assert (t == 2).all()
+
+    y = ti.ndarray(ti.f32, shape=(8, 3))
+    y.fill(5)
+    u = torch.from_dlpack(y)
+    assert u.device.type == device
+    assert (u == 5).all()
@@ -315,3 +315,72 @@ def test_append_matrix_in_struct():
             for k in range(4):
                 assert f[i, j].b[k // 2, k % 2] == i * j * (k + 1) % 256
             assert f[i, j].c == i * j * 5000 % 65536
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_append_many_chunks():
+    x = ti.field(ti.i32)
+    n = 100000
+    # More chunks than the chunk directory holds: larger chunks are used.
+    ti.root.dense(ti.i, 2).dynamic(ti.j, n, chunk_size=32).place(x)
+
+    @ti.kernel
+    def fill():
+        for i, j in ti.ndrange(2, n):
+            x[i].append(j)
+
+    @ti.kernel
+    def length(i: ti.i32) -> ti.i32:
+        return ti.length(x.parent(), i)
+
+    @ti.kernel
+    def total(i: ti.i32) -> ti.i64:
+        s = ti.i64(0)
+        for j in range(n):
+            s += x[i, j]
+        return s
+
+    for _ in range(2):
+        fill()
+        for i in range(2):
+            assert length(i) == n
+            assert total(i) == n * (n - 1) // 2
+        x.parent().deactivate_all()
+        for i in range(2):
+            assert length(i) == 0
+
+
+@test_utils.test(arch=[ti.vulkan])
+def test_dynamic_gfx_append():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+    l = ti.field(ti.i32)
+
+    n = 16
+    lst = ti.root.dense(ti.i, n).dynamic(ti.j, n)
+    lst.place(x)
+    ti.root.dense(ti.i, n).place(s, l)
+
+    @ti.kernel
+    def fill():
+        for i in range(n * n):
+            if i % n < i // n:
+                ti.append(lst, i // n, i % n)
+
+    @ti.kernel
+    def fetch():
+        for i, j in x:
+            s[i] += x[i, j] + 1
+        for i in range(n):
+            l[i] = ti.length(lst, i)
+
+    fill()
+    fetch()
+    for i in range(n):
+        assert l[i] == i
+        assert s[i] == i * (i - 1) // 2 + i
+    # Appends past the end are dropped.
+    fill()
+    fetch()
+    for i in range(n):
+        assert l[i] == min(i * 2, n)
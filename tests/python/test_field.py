@@ -283,6 +283,26 @@ def test_invalid_slicing():
         val[0, :]
 
 
+@pytest.mark.parametrize('dtype', [ti.i32, ti.f32])
+@test_utils.test()
+def test_field_batched_access(dtype):
+    x = ti.field(dtype, shape=(4, 5))
+    x.from_numpy(np.arange(20).reshape(4, 5).astype(np.int32))
+
+    i = np.array([0, 3, 2])
+    j = np.array([4, 1, 2])
+    assert (x[i, j] == [4, 16, 12]).all()
+    # Integer coordinates broadcast against the arrays.
+    assert (x[1, np.arange(5)] == np.arange(5, 10)).all()
+
+    x[i, j] = np.array([-1, -2, -3])
+    x[np.array([[3]]), np.array([[0, 4]])] = 7
+    ref = np.arange(20).reshape(4, 5)
+    ref[i, j] = [-1, -2, -3]
+    ref[3, [0, 4]] = 7
+    assert (x.to_numpy() == ref).all()
+
+
 @test_utils.test()
 def test_indexing_with_np_int():
     val = ti.field(ti.i32, shape=(2))
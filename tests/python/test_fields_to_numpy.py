@@ -0,0 +1,39 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test()
+def test_fields_to_numpy():
+    x = ti.field(ti.f32, shape=(4, 5))
+    y = ti.Vector.field(3, ti.i32, shape=7)
+    z = ti.Matrix.field(2, 3, ti.f32, shape=(2, 3))
+    w = ti.field(ti.i32, shape=())
+
+    x_np = np.random.rand(4, 5).astype(np.float32)
+    y_np = np.arange(21, dtype=np.int32).reshape(7, 3)
+    z_np = np.random.rand(2, 3, 2, 3).astype(np.float32)
+    x.from_numpy(x_np)
+    y.from_numpy(y_np)
+    z.from_numpy(z_np)
+    w[None] = 42
+
+    arrays = ti.fields_to_numpy([x, y, z, w])
+    for arr, field in zip(arrays, [x, y, z, w]):
+        np.testing.assert_equal(arr, field.to_numpy())
+
+
+@test_utils.test()
+def test_fields_from_numpy():
+    x = ti.field(ti.f32, shape=(4, 5))
+    y = ti.Vector.field(3, ti.i32, shape=7)
+    z = ti.Matrix.field(2, 3, ti.f32, shape=(2, 3))
+
+    x_np = np.random.rand(4, 5).astype(np.float32)
+    y_np = np.arange(21, dtype=np.int32).reshape(7, 3)
+    z_np = np.random.rand(2, 3, 2, 3).astype(np.float32)
+    ti.fields_from_numpy([x, y, z], [x_np, y_np, z_np])
+    np.testing.assert_equal(x.to_numpy(), x_np)
+    np.testing.assert_equal(y.to_numpy(), y_np)
+    np.testing.assert_equal(z.to_numpy(), z_np)
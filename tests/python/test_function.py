@@ -497,3 +497,32 @@ def test_real_func_struct_ret_with_matrix():
         return s.a + s.b.a[0] + s.b.a[1] + s.b.a[2] + s.b.b
 
     assert foo() == pytest.approx(105.2)
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_real_func_called_from_tasks():
+    n = 16
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    @ti.experimental.real_func
+    def poly(v: ti.f32) -> ti.f32:
+        s = 0.0
+        for k in ti.static(range(64)):
+            s = s * v + k
+        return s
+
+    @ti.kernel
+    def run():
+        for i in x:
+            x[i] = poly(i * 0.01)
+        for i in y:
+            y[i] = poly(x[i] * 0.0)
+
+    run()
+    for i in range(n):
+        expected = 0.0
+        for k in range(64):
+            expected = expected * (i * 0.01) + k
+        assert x[i] == pytest.approx(expected, rel=1e-4)
+        assert y[i] == pytest.approx(63)
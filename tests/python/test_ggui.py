@@ -962,3 +962,152 @@ def test_wireframe_mode():
     render()
     verify_image(window.get_image_buffer_as_numpy(), 'test_wireframe_mode')
     window.destroy()
+
+
+@pytest.mark.skipif(not _ti_core.GGUI_AVAILABLE, reason="GGUI Not Available")
+@test_utils.test(arch=supported_archs)
+def test_cull_particles():
+    from taichi.ui.culling import get_culled_fields
+    from taichi.ui.staging_buffer import get_vbo_field
+
+    N = 100
+    particles_pos = ti.Vector.field(3, dtype=ti.f32, shape=N)
+
+    @ti.kernel
+    def init_particles_pos():
+        for i in range(N):
+            # In front of the camera, behind it, and off to the side.
+            if i % 3 == 0:
+                particles_pos[i] = [0, 0, 5]
+            elif i % 3 == 1:
+                particles_pos[i] = [0, 0, -5]
+            else:
+                particles_pos[i] = [50, 0, 5]
+
+    init_particles_pos()
+
+    window = ti.ui.Window("Test", (768, 768), show_window=False)
+    canvas = window.get_canvas()
+    scene = ti.ui.Scene()
+    camera = ti.ui.Camera()
+    camera.position(0, 0, 0)
+    camera.lookat(0, 0, 1)
+    scene.set_camera(camera)
+    scene.point_light(pos=(0.5, 1.5, 1.5), color=(1, 1, 1))
+    scene.particles(particles_pos, radius=0.1, culling=True)
+    canvas.scene(scene)
+    window.get_image_buffer_as_numpy()
+
+    _, draw_args = get_culled_fields(get_vbo_field(particles_pos), 4)
+    assert list(draw_args.to_numpy()) == [6, (N + 2) // 3, 0, 0]
+    window.destroy()
+
+
+@pytest.mark.skipif(not _ti_core.GGUI_AVAILABLE, reason="GGUI Not Available")
+@test_utils.test(arch=supported_archs)
+def test_cull_mesh_instances():
+    from taichi.ui.culling import get_culled_fields
+
+    vertices = ti.Vector.field(3, dtype=ti.f32, shape=3)
+    vertices.from_numpy(
+        np.array([[0, 0, 0], [1, 0, 0], [0, 1, 0]], dtype=np.float32))
+    transforms = ti.Matrix.field(4, 4, dtype=ti.f32, shape=4)
+
+    @ti.kernel
+    def init_transforms():
+        for i in range(4):
+            transforms[i] = ti.Matrix.identity(ti.f32, 4)
+            # In front of the camera except for the last instance.
+            transforms[i][2, 3] = 5.0 if i < 3 else -5.0
+
+    init_transforms()
+
+    window = ti.ui.Window("Test", (768, 768), show_window=False)
+    canvas = window.get_canvas()
+    scene = ti.ui.Scene()
+    camera = ti.ui.Camera()
+    camera.position(0, 0, 0)
+    camera.lookat(0, 0, 1)
+    scene.set_camera(camera)
+    scene.point_light(pos=(0.5, 1.5, 1.5), color=(1, 1, 1))
+    scene.mesh_instance(vertices,
+                        transforms=transforms,
+                        instance_offset=1,
+                        culling=True)
+    canvas.scene(scene)
+    window.get_image_buffer_as_numpy()
+
+    culled, draw_args = get_culled_fields(transforms, 5)
+    assert list(draw_args.to_numpy()[:4]) == [3, 2, 0, 0]
+    np.testing.assert_allclose(culled.to_numpy()[:2],
+                               transforms.to_numpy()[1:3])
+    window.destroy()
+
+
+@pytest.mark.skipif(not _ti_core.GGUI_AVAILABLE, reason="GGUI Not Available")
+@test_utils.test(arch=supported_archs)
+def test_pipelined_window():
+    N = 10
+    particles_pos = ti.Vector.field(3, dtype=ti.f32, shape=N)
+
+    @ti.kernel
+    def step(t: ti.f32):
+        for i in range(N):
+            particles_pos[i] = [i * 0.1 + t, i * 0.1, 0.0]
+
+    def render(window, t):
+        canvas = window.get_canvas()
+        scene = ti.ui.Scene()
+        camera = ti.ui.Camera()
+        camera.position(0.5, 0.5, -2)
+        camera.lookat(0.5, 0.5, 0)
+        scene.set_camera(camera)
+        scene.point_light(pos=(0.5, 1.5, -1.5), color=(1, 1, 1))
+        step(t)
+        scene.particles(particles_pos, radius=0.05)
+        canvas.scene(scene)
+        return window.get_image_buffer_as_numpy()
+
+    window = ti.ui.Window("Test", (256, 256), show_window=False)
+    pipelined_window = ti.ui.Window("Test", (256, 256),
+                                    show_window=False,
+                                    pipelined=True)
+    for i in range(RENDER_REPEAT):
+        expected = render(window, i * 0.01)
+        np.testing.assert_array_equal(render(pipelined_window, i * 0.01),
+                                      expected)
+    window.destroy()
+    pipelined_window.destroy()
+
+
+@pytest.mark.skipif(not _ti_core.GGUI_AVAILABLE, reason="GGUI Not Available")
+@test_utils.test(arch=supported_archs)
+def test_frame_capture():
+    import os
+    import tempfile
+    num_frames = 7
+    w, h = 64, 48
+    window = ti.ui.Window("Test", (w, h), show_window=False)
+    canvas = window.get_canvas()
+    with tempfile.TemporaryDirectory() as tmp:
+        window.start_capture(os.path.join(tmp, "{:03d}.png"),
+                             num_readback_slots=2)
+        for i in range(num_frames):
+            canvas.set_background_color((i / num_frames, 0.5, 0.0))
+            window.show()
+        window.stop_capture()
+        assert sorted(os.listdir(tmp)) == [
+            f"{i:03d}.png" for i in range(num_frames)
+        ]
+
+        if platform.system() != "Windows":
+            raw = os.path.join(tmp, "frames.rgba")
+            window.start_capture(pipe_command=f'cat > "{raw}"')
+            for i in range(num_frames):
+                window.show()
+            window.stop_capture()
+            assert os.path.getsize(raw) == num_frames * w * h * 4
+
+    with pytest.raises(ValueError):
+        window.start_capture()
+    window.destroy()
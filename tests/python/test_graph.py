@@ -446,3 +446,71 @@ def test_texture_struct_for():
 
     graph.run({'tex': tex, 'arr': arr})
     assert arr.to_numpy().sum() == 128 * 128
+
+
+@test_utils.test(arch=supported_archs_cgraph)
+def test_temporaries():
+    n = 8
+
+    @ti.kernel
+    def scale(src: ti.types.ndarray(ndim=1), dst: ti.types.ndarray(ndim=1)):
+        for i in range(n):
+            dst[i] = src[i] * 2
+
+    src = ti.graph.Arg(ti.graph.ArgKind.NDARRAY, 'src', ti.i32, ndim=1)
+    dst = ti.graph.Arg(ti.graph.ArgKind.NDARRAY, 'dst', ti.i32, ndim=1)
+    temps = [
+        ti.graph.Arg(ti.graph.ArgKind.NDARRAY, f'tmp{i}', ti.i32, ndim=1)
+        for i in range(3)
+    ]
+    g_builder = ti.graph.GraphBuilder()
+    for temp in temps:
+        g_builder.declare_temporary(temp, (n, ))
+    # tmp2 reuses the memory of tmp0.
+    g_builder.dispatch(scale, src, temps[0])
+    g_builder.dispatch(scale, temps[0], temps[1])
+    g_builder.dispatch(scale, temps[1], temps[2])
+    g_builder.dispatch(scale, temps[2], dst)
+    g = g_builder.compile()
+
+    a = ti.ndarray(ti.i32, shape=(n, ))
+    a.from_numpy(np.arange(n, dtype=np.int32))
+    b = ti.ndarray(ti.i32, shape=(n, ))
+    g.run({'src': a, 'dst': b})
+    assert (b.to_numpy() == np.arange(n) * 16).all()
+
+
+@test_utils.test(arch=supported_archs_cgraph)
+def test_loop():
+    n = 8
+
+    @ti.kernel
+    def init(x: ti.types.ndarray(ndim=1), running: ti.types.ndarray(ndim=0)):
+        for i in range(n):
+            x[i] = i
+        running[None] = 1
+
+    @ti.kernel
+    def step(x: ti.types.ndarray(ndim=1), running: ti.types.ndarray(ndim=0)):
+        # Does nothing once the condition is cleared.
+        if running[None] != 0:
+            for i in range(n):
+                x[i] += 1
+            if x[0] >= 10:
+                running[None] = 0
+
+    x = ti.graph.Arg(ti.graph.ArgKind.NDARRAY, 'x', ti.i32, ndim=1)
+    running = ti.graph.Arg(ti.graph.ArgKind.NDARRAY, 'running', ti.i32, ndim=0)
+    a = ti.ndarray(ti.i32, shape=(n, ))
+    r = ti.ndarray(ti.i32, shape=())
+    for check_every in [0, 1, 3]:
+        g_builder = ti.graph.GraphBuilder()
+        g_builder.dispatch(init, x, running)
+        loop = g_builder.create_loop(running, 100, check_every)
+        loop.dispatch(step, x, running)
+        g_builder.append(loop)
+        g = g_builder.compile()
+
+        g.run({'x': a, 'running': r})
+        assert (a.to_numpy() == np.arange(n) + 10).all()
+        assert r[None] == 0
@@ -0,0 +1,125 @@
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_basic():
+    x = ti.field(ti.i32)
+    c = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    # Far more cells than slots.
+    h = ti.root.hash(ti.ij, 1 << 14, table_size=64)
+    h.place(x)
+    ti.root.place(c, s)
+
+    @ti.kernel
+    def run():
+        x[5, 1] = 2
+        x[9000, 4] = 20
+        x[0, 16000] = 20
+
+    @ti.kernel
+    def sum():
+        for i, j in x:
+            c[None] += ti.is_active(h, [i, j])
+            s[None] += x[i, j]
+
+    run()
+    sum()
+
+    assert c[None] == 3
+    assert s[None] == 42
+    assert x[9000, 4] == 20
+    assert x[4, 9000] == 0
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_hash_then_dense():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    ti.root.hash(ti.i, 1 << 16, table_size=128).dense(ti.i, 16).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def fill():
+        for i in range(100):
+            x[i * 997] = i
+
+    @ti.kernel
+    def sum():
+        for i in x:
+            s[None] += x[i]
+
+    fill()
+    sum()
+
+    assert s[None] == 99 * 100 // 2
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_parallel_activate():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 1000
+    ti.root.hash(ti.i, 1 << 20, table_size=1024).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def fill():
+        # Every cell is activated by four threads at once.
+        for i in range(n * 4):
+            ti.atomic_add(x[(i % n) * 1009], 1)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    fill()
+    count()
+
+    assert s[None] == n * 4
+    for i in range(n):
+        assert x[i * 1009] == 4
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_deactivate():
+    x = ti.field(ti.i32)
+    c = ti.field(ti.i32)
+
+    h = ti.root.hash(ti.i, 1 << 16, table_size=16)
+    h.place(x)
+    ti.root.place(c)
+
+    @ti.kernel
+    def activate(start: ti.i32):
+        for i in range(8):
+            x[start + i * 100] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in x:
+            ti.deactivate(h, i)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            c[None] += 1
+
+    activate(0)
+    deactivate()
+    c[None] = 0
+    count()
+    assert c[None] == 0
+
+    # The slots of the cells deactivated above are reused.
+    activate(0)
+    c[None] = 0
+    count()
+    assert c[None] == 8
+    assert x[700] == 1
+    assert x[701] == 0
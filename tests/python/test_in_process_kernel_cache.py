@@ -0,0 +1,69 @@
+import taichi as ti
+from tests import test_utils
+
+
+def make_fill(x):
+    @ti.kernel
+    def fill(v: ti.i32):
+        for i in x:
+            x[i] = v + i
+
+    return fill
+
+
+@test_utils.test(compile_profiler=True)
+def test_identical_kernels_share_code():
+    x = ti.field(ti.i32, shape=8)
+    a = make_fill(x)
+    b = make_fill(x)
+
+    ti.profiler.clear_compile_profiler_info()
+    a(1)
+    b(2)
+    assert x.to_numpy().tolist() == [2 + i for i in range(8)]
+
+    compiled = {
+        r['kernel']
+        for r in ti.profiler.get_compile_profiler_records()
+        if r['kernel'].startswith('fill')
+    }
+    assert len(compiled) == 1
+
+
+@test_utils.test(compile_profiler=True)
+def test_different_kernels_dont_share_code():
+    x = ti.field(ti.i32, shape=8)
+    y = ti.field(ti.i32, shape=8)
+    a = make_fill(x)
+    b = make_fill(y)
+
+    ti.profiler.clear_compile_profiler_info()
+    a(1)
+    b(2)
+    assert x.to_numpy().tolist() == [1 + i for i in range(8)]
+    assert y.to_numpy().tolist() == [2 + i for i in range(8)]
+
+    compiled = {
+        r['kernel']
+        for r in ti.profiler.get_compile_profiler_records()
+        if r['kernel'].startswith('fill')
+    }
+    assert len(compiled) == 2
+
+
+@test_utils.test(compile_profiler=True, in_process_kernel_cache=False)
+def test_in_process_kernel_cache_disabled():
+    x = ti.field(ti.i32, shape=8)
+    a = make_fill(x)
+    b = make_fill(x)
+
+    ti.profiler.clear_compile_profiler_info()
+    a(1)
+    b(2)
+
+    compiled = {
+        r['kernel']
+        for r in ti.profiler.get_compile_profiler_records()
+        if r['kernel'].startswith('fill')
+    }
+    assert len(compiled) == 2
@@ -0,0 +1,52 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+@pytest.mark.parametrize('n', [0, 1, 100, 200000])
+@test_utils.test(arch=[ti.vulkan, ti.metal, ti.opengl, ti.dx11])
+def test_indirect_dispatch_range_for(n):
+    size = 200000
+    x = ti.field(ti.i32, shape=size)
+    end = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        # The bound is only known on the device.
+        end[None] = n
+        for i in range(end[None]):
+            x[i] = i + 1
+
+    fill()
+    expected = np.zeros(size, dtype=np.int32)
+    expected[:n] = np.arange(1, n + 1)
+    np.testing.assert_array_equal(x.to_numpy(), expected)
+
+
+# Pointer SNodes are only supported on Vulkan among the gfx backends.
+@test_utils.test(arch=[ti.vulkan])
+def test_indirect_dispatch_struct_for():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.i, 256)
+    block.dense(ti.i, 16).place(x)
+    count = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def activate(k: ti.i32):
+        for i in range(4096):
+            if i % k == 0:
+                x[i] = 1
+
+    @ti.kernel
+    def reduce():
+        for i in x:
+            count[None] += x[i]
+
+    for k in [1, 7, 5000]:
+        block.deactivate_all()
+        count[None] = 0
+        activate(k)
+        reduce()
+        assert count[None] == len(range(0, 4096, k))
@@ -0,0 +1,62 @@
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=[ti.cpu], kernel_profiler=True)
+def test_kernel_profiler_cpu_counters():
+    x = ti.field(ti.f32, shape=1024)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    # Hardware counters may be unavailable, e.g. in virtual machines, in which
+    # case kernels are only timed.
+    ti.profiler.set_kernel_profiler_metrics(
+        ti.profiler.get_predefined_cupti_metrics('cpu_counters'))
+    for _ in range(4):
+        fill()
+    ti.profiler.get_default_kernel_profiler()._update_records()
+    records = ti.profiler.get_default_kernel_profiler()._traced_records
+    assert len(records) >= 4
+    for record in records:
+        assert len(record.metric_values) in (0, 4)
+        assert all(value >= 0 for value in record.metric_values)
+
+    ti.profiler.set_kernel_profiler_metrics()
+    fill()
+    ti.profiler.get_default_kernel_profiler()._update_records()
+    records = ti.profiler.get_default_kernel_profiler()._traced_records
+    assert len(records) >= 1
+    assert all(len(record.metric_values) == 0 for record in records)
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda, ti.vulkan],
+                 kernel_profiler=True,
+                 offline_cache=False)
+def test_kernel_profiler_roofline():
+    n = 4096
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def saxpy(a: ti.f32):
+        for i in x:
+            x[i] = a * x[i] + 1.0
+
+    ti.profiler.clear_kernel_profiler_info()
+    for _ in range(3):
+        saxpy(2.0)
+    rows = ti.profiler.get_kernel_profiler_roofline(peak_gbps=100,
+                                                    peak_gflops=1000)
+    rows = [row for row in rows if 'saxpy' in row['name']]
+    assert len(rows) >= 1
+    row = max(rows, key=lambda row: row['bytes'] or 0)
+    assert row['counter'] == 3
+    # One load and one store of 4 bytes, one multiplication and one addition.
+    assert row['bytes'] == 8 * n
+    assert row['flops'] == 2 * n
+    assert row['arithmetic_intensity'] == 0.25
+    assert row['bound'] == 'memory'
+    assert row['gbps'] > 0
+    assert not row['is_lower_bound']
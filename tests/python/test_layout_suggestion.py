@@ -0,0 +1,28 @@
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test()
+def test_suggest_layout():
+    n = 64
+    x = ti.Vector.field(3, ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    idx = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def stream():
+        for i in range(n):
+            y[i] = x[i][0] * 2
+
+    @ti.kernel
+    def gather():
+        for i in range(n):
+            y[i] = x[idx[i]].sum()
+
+    assert ti.experimental.suggest_layout([x],
+                                          [(stream, ())]) == ti.Layout.SOA
+    assert ti.experimental.suggest_layout([x],
+                                          [(gather, ())]) == ti.Layout.AOS
+    # Only x is counted, not y or idx.
+    assert ti.experimental.suggest_layout(
+        [x], [(stream, ()), (gather, ())]) == ti.Layout.AOS
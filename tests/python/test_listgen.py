@@ -60,3 +60,74 @@ def test_nested_3d():
     for _ in range(1000):
         i, j, k = randrange(n), randrange(n), randrange(n)
         assert x[i, j, k] == (i * n + j) * n + k
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_listgen_after_topology_change():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.i, 8)
+    block.bitmasked(ti.i, 4).place(x)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        c = 0
+        for i in x:
+            c += 1
+        return c
+
+    @ti.kernel
+    def activate(i: ti.i32):
+        x[i] = 1
+
+    @ti.kernel
+    def deactivate(i: ti.i32):
+        ti.deactivate(block, i // 4)
+
+    assert count() == 0
+    activate(3)
+    # The element lists are reused while nothing changes.
+    assert count() == 1
+    assert count() == 1
+    activate(5)
+    activate(6)
+    assert count() == 3
+    deactivate(5)
+    assert count() == 1
+    ti.deactivate_all_snodes()
+    assert count() == 0
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_listgen_sorted():
+    x = ti.field(ti.i32)
+    n = 256
+    ti.root.pointer(ti.ij, 16).pointer(ti.ij, 4).bitmasked(ti.ij,
+                                                           4).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n, n):
+            if (i * 7 + j * 13) % 5 == 0:
+                x[i, j] = i * n + j
+
+    @ti.kernel
+    def total_sorted() -> ti.i64:
+        s = ti.i64(0)
+        ti.loop_config(sort_elements=True)
+        for i, j in x:
+            s += x[i, j] - (i * n + j) + 1
+        return s
+
+    @ti.kernel
+    def total() -> ti.i64:
+        s = ti.i64(0)
+        for i, j in x:
+            s += x[i, j] - (i * n + j) + 1
+        return s
+
+    activate()
+    expected = sum(1 for i in range(n) for j in range(n)
+                   if (i * 7 + j * 13) % 5 == 0)
+    assert total_sorted() == expected
+    assert total() == expected
+    assert total_sorted() == expected
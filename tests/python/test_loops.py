@@ -187,3 +187,27 @@ def test_break_in_outermost_for_not_in_outermost_scope():
         return a
 
     assert foo() == 100
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda, ti.amdgpu])
+def test_range_for_i64_bounds():
+    x = ti.field(ti.i64, 16)
+
+    @ti.kernel
+    def test(b: ti.i64, e: ti.i64):
+        for i in range(b, e):
+            x[i - b] = i
+
+    @ti.kernel
+    def test_serial(b: ti.i64, e: ti.i64) -> ti.i64:
+        s = ti.i64(0)
+        for _ in range(1):
+            for i in range(b, e):
+                s += i
+        return s
+
+    b = (1 << 33) + 5
+    test(b, b + 16)
+    for i in range(16):
+        assert x[i] == b + i
+    assert test_serial(b, b + 16) == sum(range(b, b + 16))
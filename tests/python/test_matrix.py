@@ -197,6 +197,18 @@ def test_local_matrix_non_constant_index_real_matrix():
     _test_local_matrix_non_constant_index()
 
 
+@test_utils.test(real_matrix_scalarize=False)
+def test_real_matrix_falls_back_to_scalarize():
+    # Backends without vector codegen scalarize the matrices anyway.
+    @ti.kernel
+    def func(a: ti.math.vec4, b: ti.math.vec4) -> ti.f32:
+        return (a * b + a).dot(b)
+
+    a = ti.math.vec4(1, 2, 3, 4)
+    b = ti.math.vec4(5, 6, 7, 8)
+    assert func(a, b) == pytest.approx(570)
+
+
 @test_utils.test(exclude=[ti.cc])
 def test_matrix_ndarray_non_constant_index():
     @ti.kernel
@@ -49,3 +49,73 @@ def test_oop_memory_leak():
         curr_mem = get_process_memory()
         assert (curr_mem - ref_mem < 5
                 )  # shouldn't increase more than 5.0 MB each loop
+
+
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal, ti.vulkan])
+def test_memory_stats():
+    x = ti.field(ti.i32)
+    ptr = ti.root.pointer(ti.i, 16)
+    ptr.dense(ti.i, 4).place(x)
+    _ = ti.ndarray(ti.f32, shape=100)
+
+    @ti.kernel
+    def activate():
+        for i in range(5):
+            x[i * 4] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in range(2):
+            ti.deactivate(ptr, i)
+
+    activate()
+    deactivate()
+
+    stats = ti.profiler.get_memory_stats()
+    assert stats.snode_tree_bytes > 0
+    assert stats.num_ndarrays == 1
+    assert stats.ndarray_bytes == 100 * 4
+    s = [s for s in stats.snodes if s.snode_id == ptr.ptr.id][0]
+    assert s.num_allocated_nodes == 5
+    assert s.num_recycled_nodes == 2
+    assert s.num_active_nodes == 3
+
+
+@test_utils.test(arch=ti.cpu)
+def test_memory_trimmed_after_gc():
+    n = 40000
+    x = ti.field(ti.i32)
+    ptr = ti.root.pointer(ti.i, n)
+    ptr.dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def activate(lo: ti.i32, hi: ti.i32):
+        # Serialized so that the nodes are allocated in order.
+        ti.loop_config(serialize=True)
+        for i in range(lo, hi):
+            x[i * 4] = i
+
+    @ti.kernel
+    def deactivate(lo: ti.i32, hi: ti.i32):
+        for i in range(lo, hi):
+            ti.deactivate(ptr, i)
+
+    @ti.kernel
+    def total() -> ti.i64:
+        s = ti.i64(0)
+        for i in x:
+            s += x[i]
+        return s
+
+    def allocated_nodes():
+        stats = ti.profiler.get_memory_stats()
+        return [s for s in stats.snodes
+                if s.snode_id == ptr.ptr.id][0].num_allocated_nodes
+
+    activate(0, n)
+    assert allocated_nodes() == n
+    deactivate(n // 5, n)
+    assert allocated_nodes() == n // 5
+    assert total() == sum(range(n // 5))
+    activate(n // 5, n)
+    assert total() == sum(range(n))
@@ -1,6 +1,7 @@
 import os
 
 import numpy as np
+import pytest
 
 import taichi as ti
 from tests import test_utils
@@ -221,6 +222,29 @@ def test_mesh_local():
         assert res1[i] == res4[i]
 
 
+@test_utils.test(require=ti.extension.mesh)
+def test_mesh_local_f32():
+    mesh_builder = ti.TetMesh()
+    mesh_builder.verts.place({'a': ti.f32})
+    model = mesh_builder.build(ti.Mesh.load_meta(model_file_path))
+
+    @ti.kernel
+    def foo(cache: ti.template()):
+        if ti.static(cache):
+            ti.mesh_local(model.verts.a)
+        for c in model.cells:
+            for j in ti.static(range(4)):
+                c.verts[j].a += 0.5
+
+    foo(False)
+    res1 = model.verts.a.to_numpy()
+    model.verts.a.fill(0)
+    foo(True)
+    res2 = model.verts.a.to_numpy()
+    assert res1.sum() > 0
+    assert (res1 == res2).all()
+
+
 @test_utils.test(require=ti.extension.mesh, experimental_auto_mesh_local=True)
 def test_auto_mesh_local():
     mesh_builder = ti.TetMesh()
@@ -329,3 +353,131 @@ def test_multiple_mesh_major_relations():
     sum1 = model.verts.s.to_numpy().sum()
     sum2 = model.verts.s_.to_numpy().sum()
     assert sum1 == sum2
+
+
+def _tet_cube(n):
+    grid = np.stack(np.meshgrid(*[np.arange(n + 1)] * 3, indexing='ij'), -1)
+    positions = grid.reshape(-1, 3).astype(np.float32)
+
+    def vid(c):
+        return (c[:, 0] * (n + 1) + c[:, 1]) * (n + 1) + c[:, 2]
+
+    corners = grid[:-1, :-1, :-1].reshape(-1, 3)
+    cells = []
+    for axes in [(0, 1, 2), (0, 2, 1), (1, 0, 2), (1, 2, 0), (2, 0, 1),
+                 (2, 1, 0)]:
+        c = corners.copy()
+        tet = [vid(c)]
+        for axis in axes:
+            c[:, axis] += 1
+            tet.append(vid(c))
+        cells.append(np.stack(tet, -1))
+    return positions, np.concatenate(cells)
+
+
+@pytest.mark.parametrize('reorder', [False, True])
+@test_utils.test(require=ti.extension.mesh)
+def test_mesh_build_meta(reorder):
+    positions, cells = _tet_cube(4)
+    meta = ti.Mesh.build_meta(positions,
+                              cells,
+                              relations=['CV', 'VC', 'VV'],
+                              max_elements_per_patch=40)
+    assert meta.num_patches > 1
+    mesh_builder = ti.TetMesh()
+    mesh_builder.verts.place({'t': ti.i32}, reorder=reorder)
+    mesh_builder.cells.place({'t': ti.i32}, reorder=reorder)
+    model = mesh_builder.build(meta)
+    np.testing.assert_array_equal(model.get_position_as_numpy(), positions)
+
+    @ti.kernel
+    def cell_vert():
+        for c in model.cells:
+            for j in range(c.verts.size):
+                c.t += c.verts[j].id
+
+    @ti.kernel
+    def vert_cell():
+        for v in model.verts:
+            for j in range(v.cells.size):
+                v.t += 1
+
+    @ti.kernel
+    def vert_vert():
+        for v in model.verts:
+            for j in range(v.verts.size):
+                v.t += v.verts[j].id
+
+    cell_vert()
+    np.testing.assert_array_equal(model.cells.t.to_numpy(), cells.sum(1))
+    vert_cell()
+    np.testing.assert_array_equal(model.verts.t.to_numpy(),
+                                  np.bincount(cells.ravel()))
+
+    model.verts.t.fill(0)
+    vert_vert()
+    edges = set()
+    for tet in cells:
+        for a in tet:
+            for b in tet:
+                if a != b:
+                    edges.add((a, b))
+    expected = np.zeros(len(positions), dtype=np.int64)
+    for a, b in edges:
+        expected[a] += b
+    np.testing.assert_array_equal(model.verts.t.to_numpy(), expected)
+
+
+@pytest.mark.parametrize('reorder', [False, True])
+@test_utils.test(require=ti.extension.mesh)
+def test_mesh_update_topology(reorder):
+    positions, cells = _tet_cube(4)
+    meta = ti.Mesh.build_meta(positions,
+                              cells,
+                              relations=['CV', 'VC'],
+                              max_elements_per_patch=40,
+                              dynamic=True,
+                              slack=0.5)
+    mesh_builder = ti.TetMesh()
+    mesh_builder.verts.place({'t': ti.i32}, reorder=reorder)
+    mesh_builder.cells.place({'t': ti.i32}, reorder=reorder)
+    model = mesh_builder.build(meta)
+
+    @ti.kernel
+    def cell_vert():
+        for c in model.cells:
+            c.t = 0
+            for j in range(c.verts.size):
+                c.t += c.verts[j].id
+
+    @ti.kernel
+    def vert_cell():
+        for v in model.verts:
+            v.t = 0
+            for j in range(v.cells.size):
+                v.t += 1
+
+    # Replaces a few cells by cones over their first faces.
+    removed = np.array([0, 3, 5])
+    added = np.concatenate(
+        [cells[removed, :3],
+         np.full((len(removed), 1), len(positions))], 1)
+    new = model.update_topology(remove_cells=removed,
+                                add_cells=added,
+                                add_positions=[[2.0, 2.0, 5.0]])
+    assert len(new['verts']) == 1 and len(new['cells']) == len(removed)
+    alive = dict(enumerate(cells))
+    for c in removed:
+        del alive[c]
+    for c, tet in zip(new['cells'], added):
+        alive[c] = tet
+    assert len(model.get_position_as_numpy()) == len(positions) + 1
+
+    cell_vert()
+    t = model.cells.t.to_numpy()
+    for c, tet in alive.items():
+        assert t[c] == tet.sum()
+    vert_cell()
+    count = np.bincount(np.concatenate(list(alive.values())))
+    np.testing.assert_array_equal(model.verts.t.to_numpy()[:len(count)],
+                                  count)
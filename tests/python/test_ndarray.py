@@ -220,6 +220,31 @@ def test_ndarray_copy_from_ndarray():
     assert x[4][1, 0] == 6
 
 
+@test_utils.test(arch=supported_archs_taichi_ndarray)
+def test_ndarray_non_blocking_fill_and_copy():
+    n = 16
+    a = ti.ndarray(ti.f32, shape=n)
+    b = ti.Vector.ndarray(2, ti.i32, shape=n)
+    c = ti.Vector.ndarray(2, ti.i32, shape=n)
+
+    @ti.kernel
+    def add(x: ti.types.ndarray(), y: ti.types.ndarray()):
+        for i in x:
+            x[i] += 1.0
+            y[i] += 1
+
+    a.fill(2.0, blocking=False)
+    b.fill(3, blocking=False)
+    add(a, b)
+    c.copy_from(b, blocking=False)
+    b.fill(0, blocking=False)
+
+    for i in range(n):
+        assert a[i] == 3.0
+        assert c[i][0] == 4 and c[i][1] == 4
+        assert b[i][1] == 0
+
+
 @test_utils.test(arch=supported_archs_taichi_ndarray)
 def test_ndarray_deepcopy():
     n = 16
@@ -282,6 +307,24 @@ def test_ndarray_cuda_caching_allocator():
     b.fill(2)
 
 
+@test_utils.test(arch=[ti.cuda], ndarray_use_managed_memory=True)
+def test_ndarray_cuda_managed_memory():
+    n = 1024
+    a = ti.ndarray(ti.f32, shape=n)
+    b = ti.ndarray(ti.f32, shape=n)
+
+    @ti.kernel
+    def saxpy(a: ti.types.ndarray(), b: ti.types.ndarray(), k: ti.f32):
+        for i in a:
+            b[i] += k * a[i]
+
+    a.from_numpy(np.arange(n, dtype=np.float32))
+    b.fill(1)
+    saxpy(a, b, 2)
+    saxpy(a, b, 2)
+    np.testing.assert_allclose(b.to_numpy(), np.arange(n) * 4 + 1)
+
+
 @test_utils.test(arch=supported_archs_taichi_ndarray)
 def test_ndarray_fill():
     n = 8
@@ -348,6 +391,33 @@ def test_ndarray_numpy_io():
     _test_ndarray_numpy_io()
 
 
+@test_utils.test(arch=supported_archs_taichi_ndarray)
+def test_ndarray_numpy_io_between_kernels():
+    # Large enough to be mapped only on unified memory.
+    n = 1 << 19
+    x = ti.ndarray(ti.f32, n)
+    v = ti.Vector.ndarray(3, ti.i32, n // 4)
+
+    @ti.kernel
+    def inc(x: ti.types.ndarray(), v: ti.types.ndarray()):
+        for i in x:
+            x[i] += 1
+        for i in v:
+            v[i] += 1
+
+    x_np = np.arange(n, dtype=np.float32)
+    v_np = np.arange(3 * (n // 4), dtype=np.int32).reshape(n // 4, 3)
+    x.from_numpy(x_np)
+    v.from_numpy(v_np)
+    inc(x, v)
+    np.testing.assert_allclose(x.to_numpy(), x_np + 1)
+    np.testing.assert_equal(v.to_numpy(), v_np + 1)
+    # Another dtype goes through the conversion kernels.
+    x.from_numpy(np.zeros(n, dtype=np.int32))
+    inc(x, v)
+    np.testing.assert_allclose(x.to_numpy(), np.ones(n))
+
+
 @test_utils.test(arch=supported_archs_taichi_ndarray)
 def test_ndarray_matrix_numpy_io():
     n = 5
@@ -692,6 +762,29 @@ def test_ndarray_python_scope_read_64bit(dtype):
         assert a[i] == i + 2**40
 
 
+@pytest.mark.parametrize('dtype', [ti.i32, ti.f32])
+@test_utils.test(arch=supported_archs_taichi_ndarray)
+def test_ndarray_python_scope_batched_access(dtype):
+    @ti.kernel
+    def run(x: ti.types.ndarray()):
+        for i, j in x:
+            x[i, j] = i * 10 + j
+
+    a = ti.ndarray(dtype, shape=(6, 4))
+    run(a)
+    ref = np.arange(6)[:, None] * 10 + np.arange(4)[None, :]
+    assert (a[1:4] == ref[1:4]).all()
+    assert (a.read([(5, 3), (0, 1), (2, 2)]) == [53, 1, 22]).all()
+
+    a.write([(0, 0), (5, 3)], [-1, -2])
+    a[2:3] = 7
+    ref[0, 0], ref[5, 3], ref[2] = -1, -2, 7
+    assert (a.to_numpy() == ref).all()
+    # Element writes keep the dtype of the ndarray.
+    a[4, 1] = 3
+    assert a[4, 1] == 3 and a[4, 2] == 42
+
+
 @test_utils.test(arch=supported_archs_taichi_ndarray)
 def test_ndarray_init_as_zero():
     a = ti.ndarray(dtype=ti.f32, shape=(6, 10))
@@ -716,3 +809,40 @@ def test_ndarray_in_python_func():
 
     for i in range(300):
         test()
+
+
+@test_utils.test(arch=[ti.vulkan])
+def test_small_ndarrays_share_buffers():
+    @ti.kernel
+    def fill(x: ti.types.ndarray(), v: ti.i32):
+        for i in x:
+            x[i] = v + i
+
+    arrays = []
+    for k in range(64):
+        arrays.append(ti.ndarray(ti.i32, shape=(k + 1)))
+        fill(arrays[-1], k * 100)
+    # Freed ranges are reused by the arrays allocated afterwards.
+    del arrays[::2]
+    for k in range(32):
+        arrays.append(ti.ndarray(ti.i32, shape=(k + 1)))
+        fill(arrays[-1], -k * 100)
+    for a in arrays:
+        v = a.to_numpy()
+        assert (v == v[0] + np.arange(v.shape[0])).all()
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda], specialize_ndarray_shapes=2)
+def test_ndarray_shape_specialization():
+    @ti.kernel
+    def fill(x: ti.types.ndarray(dtype=ti.i32, ndim=2)):
+        for i, j in ti.ndrange(x.shape[0], x.shape[1]):
+            x[i, j] = i * x.shape[1] + j
+
+    # The variant of (4, 6) is compiled after its second launch.
+    for shape in [(4, 6), (4, 6), (3, 5), (4, 6), (4, 6), (6, 4)]:
+        x = ti.ndarray(ti.i32, shape=shape)
+        fill(x)
+        impl.get_runtime().prog.wait_for_warm_up()
+        n, m = shape
+        assert (x.to_numpy() == np.arange(n * m).reshape(n, m)).all()
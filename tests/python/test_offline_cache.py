@@ -613,3 +613,150 @@ def test_offline_cache_for_kernels_calling_real_func(curr_arch):
     ti.reset()
     assert added_files(curr_arch) == expected_num_cache_files(
         curr_arch, [1, 1])
+
+
+@pytest.mark.parametrize(
+    'curr_arch', supported_llvm_archs & supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_tasks(curr_arch):
+    count_of_cache_file = cache_files_cnt(curr_arch)
+
+    def added_files(arch):
+        return cache_files_cnt(curr_arch) - count_of_cache_file
+
+    def helper(y_value):
+        x = ti.field(ti.i32, shape=8)
+        y = ti.field(ti.i32, shape=16)
+
+        @ti.kernel
+        def fill() -> ti.i32:
+            for i in x:
+                x[i] = 1
+            for i in y:
+                y[i] = y_value
+            return y[1]
+
+        assert fill() == y_value
+
+    def my_init():
+        ti.init(arch=curr_arch,
+                enable_fallback=False,
+                offline_cache_tasks=True,
+                **current_thread_ext_options())
+
+    my_init()
+    helper(2)
+
+    # One file for each of the 3 tasks of the kernel.
+    my_init()
+    assert added_files(curr_arch) == expected_num_cache_files(curr_arch,
+                                                              [3]) + 3
+    helper(3)
+
+    # Only the loop over y differs from the cached kernel.
+    ti.reset()
+    assert added_files(curr_arch) == expected_num_cache_files(
+        curr_arch, [3, 3]) + 4
+
+
+@pytest.mark.parametrize(
+    'curr_arch', supported_llvm_archs & supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_native_code(curr_arch):
+    count_of_cache_file = cache_files_cnt(curr_arch)
+
+    def added_files(arch):
+        return cache_files_cnt(curr_arch) - count_of_cache_file
+
+    def my_init():
+        ti.init(arch=curr_arch,
+                enable_fallback=False,
+                offline_cache_native_code=True,
+                **current_thread_ext_options())
+
+    my_init()
+    assert kernel2(1024) == python_kernel2(1024)
+
+    # One native code file next to the kernel.
+    my_init()
+    assert added_files(curr_arch) == expected_num_cache_files(curr_arch,
+                                                              [3]) + 1
+    assert any(
+        f.endswith('.native')
+        for f in listdir(backend_specified_cache_path(curr_arch)))
+    assert kernel2(1024) == python_kernel2(1024)
+
+    ti.reset()
+    assert added_files(curr_arch) == expected_num_cache_files(curr_arch,
+                                                              [3]) + 1
+
+
+@pytest.mark.parametrize(
+    'curr_arch', supported_llvm_archs & supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_shared(curr_arch):
+    def kernel_files():
+        try:
+            files = listdir(backend_specified_cache_path(curr_arch))
+        except FileNotFoundError:
+            return []
+        return [f for f in files if f.endswith('.kpack')]
+
+    def my_init():
+        ti.init(arch=curr_arch,
+                enable_fallback=False,
+                offline_cache_shared=True,
+                offline_cache_compile_lease_ms=10000,
+                **current_thread_ext_options())
+
+    my_init()
+    assert kernel2(1024) == python_kernel2(1024)
+    # Published before the program exits, and the lease is released.
+    assert len(kernel_files()) == 1
+    files = listdir(backend_specified_cache_path(curr_arch))
+    assert not any(f.endswith(('.lease', '.tmp')) for f in files)
+
+    my_init()
+    assert kernel2(1024) == python_kernel2(1024)
+    assert kernel1(1, 2, 3.0) == test_utils.approx(python_kernel1(1, 2, 3.0))
+    assert len(kernel_files()) == 2
+
+    ti.reset()
+    assert len(kernel_files()) == 2
+
+
+@pytest.mark.parametrize('curr_arch', supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_remote(curr_arch):
+    remote_dir = mkdtemp()
+
+    def remote_files():
+        return [
+            f for _, _, files in os.walk(remote_dir) for f in files
+            if not f.endswith('.tmp')
+        ]
+
+    def my_init():
+        ti.init(arch=curr_arch,
+                enable_fallback=False,
+                offline_cache_shared=True,
+                offline_cache_remote_url='file://' + remote_dir,
+                **current_thread_ext_options())
+
+    try:
+        my_init()
+        assert kernel2(1024) == python_kernel2(1024)
+        ti.reset()
+        assert len(remote_files()) == 1
+
+        # Another machine, with an empty local cache.
+        shutil.rmtree(tmp_offline_cache_file_path())
+        my_init()
+        assert kernel2(1024) == python_kernel2(1024)
+        assert kernel1(1, 2, 3.0) == test_utils.approx(
+            python_kernel1(1, 2, 3.0))
+        ti.reset()
+        assert len(remote_files()) == 2
+        assert len(listdir(backend_specified_cache_path(curr_arch))) > 0
+    finally:
+        shutil.rmtree(remote_dir)
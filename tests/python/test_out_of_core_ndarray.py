@@ -0,0 +1,55 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_out_of_core_ndarray():
+    n, m = 37, 5
+    x = ti.OutOfCoreNdarray(ti.f32, shape=(n, m), tile_rows=8)
+    assert x.tile_rows == 8
+    assert x.num_tiles == 5
+
+    @ti.kernel
+    def scale(x: ti.types.ndarray(), k: ti.f32):
+        for i, j in x:
+            x[i, j] = x[i, j] * k + 1
+
+    values = np.arange(n * m, dtype=np.float32).reshape(n, m)
+    x.from_numpy(values)
+    x.for_each_tile(scale, x, 2.0)
+    np.testing.assert_allclose(x.to_numpy(), values * 2 + 1)
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_out_of_core_ndarray_reduce():
+    x = ti.OutOfCoreNdarray(ti.i32, shape=100, tile_rows=16)
+    total = ti.ndarray(ti.i32, shape=())
+
+    @ti.kernel
+    def accumulate(x: ti.types.ndarray(), total: ti.types.ndarray()):
+        for i in x:
+            total[None] += x[i]
+
+    x.from_numpy(np.arange(100, dtype=np.int32))
+    x.for_each_tile(accumulate, x, total, writeback=False)
+    assert total[None] == sum(range(100))
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_out_of_core_ndarray_file(tmp_path):
+    path = str(tmp_path / 'data.bin')
+    x = ti.OutOfCoreNdarray(ti.i32, shape=(10, 3), path=path, tile_rows=4)
+
+    @ti.kernel
+    def fill(x: ti.types.ndarray()):
+        for i, j in x:
+            x[i, j] = i * 3 + j
+
+    x.for_each_tile(fill, x)
+    expected = np.arange(30, dtype=np.int32).reshape(10, 3)
+    np.testing.assert_equal(x.to_numpy(), expected)
+    del x
+    np.testing.assert_equal(
+        np.fromfile(path, dtype=np.int32).reshape(10, 3), expected)
@@ -0,0 +1,112 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+def _ndarray(a, dtype):
+    arr = ti.ndarray(dtype, a.shape)
+    arr.from_numpy(a)
+    return arr
+
+
+@pytest.mark.parametrize('n', [1, 64, 1000, 100000])
+@pytest.mark.parametrize('inclusive', [True, False])
+@test_utils.test(exclude=[ti.cc])
+def test_scan(n, inclusive):
+    a = np.random.randint(-100, 100, n).astype(np.int32)
+    src = _ndarray(a, ti.i32)
+    dst = ti.ndarray(ti.i32, n)
+    ti.algorithms.scan(src, dst, inclusive=inclusive)
+    expected = np.cumsum(a)
+    if not inclusive:
+        expected = np.concatenate([[0], expected[:-1]])
+    np.testing.assert_array_equal(dst.to_numpy(), expected)
+    # In place.
+    ti.algorithms.scan(src, inclusive=inclusive)
+    np.testing.assert_array_equal(src.to_numpy(), expected)
+
+
+@pytest.mark.parametrize('dtype,np_dtype', [(ti.i32, np.int32),
+                                            (ti.u32, np.uint32),
+                                            (ti.f32, np.float32)])
+@test_utils.test(exclude=[ti.cc])
+def test_radix_sort(dtype, np_dtype):
+    n = 10000
+    if np_dtype == np.uint32:
+        a = np.random.randint(0, 2**32, n, dtype=np.uint64).astype(np_dtype)
+    elif np_dtype == np.int32:
+        a = np.random.randint(-2**31, 2**31, n, dtype=np.int64).astype(np_dtype)
+    else:
+        a = (np.random.randn(n) * 1000).astype(np_dtype)
+    keys = _ndarray(a, dtype)
+    values = _ndarray(np.arange(n, dtype=np.int32), ti.i32)
+    ti.algorithms.radix_sort(keys, values)
+    order = np.argsort(a, kind='stable')
+    np.testing.assert_array_equal(keys.to_numpy(), a[order])
+    np.testing.assert_array_equal(values.to_numpy(), order)
+
+
+@test_utils.test(exclude=[ti.cc])
+def test_radix_sort_cells():
+    n, num_cells = 20000, 1 << 10
+    cells = np.random.randint(0, num_cells, n).astype(np.int32)
+    keys = _ndarray(cells, ti.i32)
+    values = _ndarray(np.arange(n, dtype=np.int32), ti.i32)
+    # An odd number of passes.
+    ti.algorithms.radix_sort(keys, values, key_bits=10)
+    order = np.argsort(cells, kind='stable')
+    np.testing.assert_array_equal(keys.to_numpy(), cells[order])
+    np.testing.assert_array_equal(values.to_numpy(), order)
+
+
+@test_utils.test(exclude=[ti.cc])
+def test_compact():
+    n = 5000
+    a = np.random.rand(n).astype(np.float32)
+    flags = (a > 0.3).astype(np.int32)
+    dst = ti.ndarray(ti.f32, n)
+    count = ti.algorithms.compact(_ndarray(a, ti.f32),
+                                  _ndarray(flags, ti.i32), dst)
+    assert count == flags.sum()
+    np.testing.assert_array_equal(dst.to_numpy()[:count], a[a > 0.3])
+
+
+@pytest.mark.parametrize('op,np_op', [('add', np.sum), ('min', np.min),
+                                      ('max', np.max)])
+@test_utils.test(exclude=[ti.cc])
+def test_segmented_reduce(op, np_op):
+    a = np.random.randint(-1000, 1000, 300).astype(np.int32)
+    offsets = np.array([0, 10, 10, 150, 151, 300], dtype=np.int32)
+    dst = ti.ndarray(ti.i32, len(offsets) - 1)
+    ti.algorithms.segmented_reduce(_ndarray(a, ti.i32),
+                                   _ndarray(offsets, ti.i32), dst, op)
+    result = dst.to_numpy()
+    for s in range(len(offsets) - 1):
+        segment = a[offsets[s]:offsets[s + 1]]
+        if len(segment):
+            assert result[s] == np_op(segment)
+    # The empty segment.
+    identity = {'add': 0, 'min': 2**31 - 1, 'max': -2**31}[op]
+    assert result[1] == identity
+
+
+@test_utils.test(exclude=[ti.cc])
+def test_histogram():
+    n, num_bins = 10000, 16
+    bins = np.random.randint(-2, num_bins + 2, n).astype(np.int32)
+    counts = ti.ndarray(ti.i32, num_bins)
+    counts.fill(0)
+    ti.algorithms.histogram(_ndarray(bins, ti.i32), counts)
+    np.testing.assert_array_equal(
+        counts.to_numpy(),
+        np.bincount(bins[(bins >= 0) & (bins < num_bins)],
+                    minlength=num_bins))
+
+    a = np.random.rand(n).astype(np.float32)
+    counts.fill(0)
+    ti.algorithms.histogram(_ndarray(a, ti.f32), counts, 0.0, 1.0)
+    expected, _ = np.histogram(a, num_bins, (0.0, 1.0))
+    assert counts.to_numpy().sum() == n
+    assert np.abs(counts.to_numpy() - expected).max() <= 2
@@ -0,0 +1,81 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=ti.cuda, gpu_persistent_kernel=True)
+def test_persistent_kernel_phases():
+    n = 100000
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    total = ti.field(ti.f32, shape=())
+    m = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def step():
+        for i in x:
+            x[i] = i % 7
+        for i in y:
+            # Reads the neighbors written by other blocks in the previous loop.
+            y[i] = x[(i + 1) % n] + x[(i + n - 1) % n]
+        total[None] = 0
+        m[None] = n // 2
+        for i in range(m[None]):
+            total[None] += y[i]
+
+    for _ in range(3):
+        step()
+    xs = np.arange(n) % 7
+    ys = np.roll(xs, -1) + np.roll(xs, 1)
+    np.testing.assert_allclose(y.to_numpy(), ys)
+    assert total[None] == test_utils.approx(ys[:n // 2].sum(), rel=1e-4)
+
+
+@test_utils.test(arch=ti.cuda, gpu_persistent_kernel=True)
+def test_persistent_kernel_sparse():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.i, 64)
+    block.dense(ti.i, 16).place(x)
+    count = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def activate(k: ti.i32):
+        for i in range(1024):
+            if i % k == 0:
+                x[i] = 1
+        count[None] = 0
+        for i in x:
+            count[None] += x[i]
+
+    for k in [3, 5]:
+        block.deactivate_all()
+        activate(k)
+        assert count[None] == len(range(0, 1024, k))
+
+
+@test_utils.test(arch=ti.cuda, gpu_fuse_serial_tasks=True)
+def test_fuse_serial_tasks():
+    n = 4096
+    x = ti.field(ti.i32, shape=n)
+    m = ti.field(ti.i32, shape=())
+    total = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def step(k: ti.i32):
+        # Read by every block of the loop running them.
+        m[None] = n // k
+        total[None] = 0
+        for i in range(m[None]):
+            x[i] = i
+            total[None] += 1
+        for i in x:
+            x[i] += 1
+
+    for k in [2, 4]:
+        x.fill(0)
+        step(k)
+        assert total[None] == n // k
+        xs = np.zeros(n, dtype=np.int32)
+        xs[:n // k] = np.arange(n // k)
+        np.testing.assert_array_equal(x.to_numpy(), xs + 1)
@@ -0,0 +1,42 @@
+import os
+
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+def _run(n):
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def classify():
+        for i in x:
+            if i % 8 == 0:
+                x[i] = -i
+            else:
+                for j in range(i % 4):
+                    x[i] += j
+
+    classify()
+    expected = np.array(
+        [-i if i % 8 == 0 else sum(range(i % 4)) for i in range(n)])
+    np.testing.assert_array_equal(x.to_numpy(), expected)
+
+
+@test_utils.test(arch=ti.cpu)
+def test_pgo(tmp_path):
+    profile_dir = str(tmp_path)
+    ti.init(arch=ti.cpu, pgo_instrument=True, pgo_profile_dir=profile_dir)
+    _run(64)
+    ti.reset()
+    profiles = [f for f in os.listdir(profile_dir) if f.endswith('.prof')]
+    assert len(profiles) == 1
+    with open(os.path.join(profile_dir, profiles[0])) as f:
+        counts = [tuple(map(int, line.split())) for line in f]
+    # The if, and the test of the inner loop.
+    assert (8, 56) in counts
+    assert (sum(i % 4 for i in range(64) if i % 8), 56) in counts
+
+    ti.init(arch=ti.cpu, pgo_use=True, pgo_profile_dir=profile_dir)
+    _run(64)
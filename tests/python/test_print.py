@@ -201,3 +201,19 @@ def test_print_seq(capfd):
     print("outside kernel")
     out = capfd.readouterr().out
     assert "inside kernel\noutside kernel" in out
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda],
+                 exclude=[cuda_on_windows],
+                 sync_after_print=False)
+def test_print_without_sync(capfd):
+    @ti.kernel
+    def foo(i: ti.i32):
+        print("inside kernel", i)
+
+    for i in range(3):
+        foo(i)
+    ti.sync()
+    out = capfd.readouterr().out
+    for i in range(3):
+        assert f"inside kernel {i}" in out
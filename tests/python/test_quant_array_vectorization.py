@@ -175,3 +175,42 @@ def test_evolve():
     evolve_naive(x, z)
     evolve_vectorized(x, y)
     verify()
+
+
+@test_utils.test(require=ti.extension.quant, debug=True)
+def test_vectorized_reductions():
+    qu1 = ti.types.quant.int(1, False)
+
+    x = ti.field(dtype=qu1)
+    count = ti.field(ti.i32, shape=())
+    any_set = ti.field(ti.i32, shape=())
+    all_set = ti.field(ti.i32, shape=())
+
+    N = 256
+    bits = 32
+    ti.root.dense(ti.ij, (N, N // bits)).quant_array(
+        ti.j, bits, max_num_bits=bits).place(x)
+
+    @ti.kernel
+    def init(k: ti.i32):
+        for i, j in ti.ndrange(N, N):
+            x[i, j] = ti.select((i * N + j) % k == 0, 1, 0)
+
+    @ti.kernel
+    def reduce_vectorized():
+        ti.loop_config(bit_vectorize=True)
+        for i, j in x:
+            count[None] += x[i, j]
+            ti.atomic_or(any_set[None], x[i, j])
+            ti.atomic_and(all_set[None], x[i, j])
+
+    for k in [1, 3, N * N + 1]:
+        init(k)
+        count[None] = 0
+        any_set[None] = 0
+        all_set[None] = 1
+        reduce_vectorized()
+        num_set = len(range(0, N * N, k))
+        assert count[None] == num_set
+        assert any_set[None] == 1
+        assert all_set[None] == int(num_set == N * N)
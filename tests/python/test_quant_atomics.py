@@ -91,3 +91,24 @@ def test_quant_fixed_atomics():
     foo()
     assert x[None] == approx(-3.3)
     assert y[None] == approx(1124.4)
+
+
+@test_utils.test(require=ti.extension.quant_basic, debug=True)
+def test_quant_bit_flags_atomics():
+    qu1 = ti.types.quant.int(1, False)
+
+    x = ti.field(dtype=qu1)
+
+    ti.root.dense(ti.i, 4).quant_array(ti.i, 32, max_num_bits=32).place(x)
+
+    @ti.kernel
+    def foo():
+        for i in range(128):
+            x[i] = 1
+        for i in range(128):
+            if i % 3 == 0:
+                x[i] = 0
+
+    foo()
+    for i in range(128):
+        assert x[i] == (i % 3 != 0)
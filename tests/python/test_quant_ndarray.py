@@ -0,0 +1,80 @@
+import numpy as np
+import pytest
+from taichi._lib import core as _ti_core
+
+import taichi as ti
+from tests import test_utils
+
+supported_archs_quant_ndarray = [
+    ti.cpu, ti.cuda, ti.opengl, ti.vulkan, ti.metal
+]
+
+
+@test_utils.test(arch=supported_archs_quant_ndarray)
+def test_quant_int_ndarray():
+    qi12 = ti.types.quant.int(bits=12)
+    x = ti.ndarray(qi12, shape=8)
+    assert _ti_core.data_type_size(x.dtype) == 2
+
+    @ti.kernel
+    def fill(x: ti.types.ndarray(dtype=qi12)):
+        for i in x:
+            x[i] = (i - 4) * 500
+
+    fill(x)
+    # Values wrap around within 12 bits.
+    expected = [((i - 4) * 500 + 2048) % 4096 - 2048 for i in range(8)]
+    assert x.to_numpy().tolist() == expected
+
+
+@test_utils.test(arch=supported_archs_quant_ndarray)
+def test_quant_fixed_ndarray():
+    qfxt = ti.types.quant.fixed(bits=12, max_value=2.0)
+    x = ti.ndarray(qfxt, shape=(4, 4))
+    y = ti.ndarray(ti.f32, shape=(4, 4))
+    assert _ti_core.data_type_size(x.dtype) == 2
+
+    @ti.kernel
+    def scale(x: ti.types.ndarray(dtype=qfxt), y: ti.types.ndarray()):
+        for i, j in x:
+            x[i, j] = x[i, j] * 0.5
+            y[i, j] = x[i, j]
+
+    values = np.linspace(-1.9, 1.9, 16, dtype=np.float32).reshape(4, 4)
+    x.from_numpy(values)
+    scale(x, y)
+    np.testing.assert_allclose(y.to_numpy(), values * 0.5, atol=2.0 / 2048)
+    np.testing.assert_allclose(x.to_numpy(), y.to_numpy())
+
+
+@test_utils.test(arch=supported_archs_quant_ndarray)
+def test_quant_float_ndarray():
+    bf16 = ti.types.quant.float(exp=8, frac=8)
+    x = ti.ndarray(bf16, shape=16)
+    assert _ti_core.data_type_size(x.dtype) == 2
+
+    @ti.kernel
+    def accumulate(x: ti.types.ndarray(dtype=bf16)):
+        for i in x:
+            x[i] = x[i] + 1.0
+
+    values = np.array([0, 1, -1, 0.5, 3.14, -100, 1e-3, 1e5] * 2,
+                      dtype=np.float32)
+    x.from_numpy(values)
+    accumulate(x)
+    np.testing.assert_allclose(x.to_numpy(), values + 1, rtol=2**-7)
+
+
+@test_utils.test(arch=supported_archs_quant_ndarray)
+def test_quant_ndarray_atomic():
+    qi8 = ti.types.quant.int(bits=8)
+    x = ti.ndarray(qi8, shape=4)
+
+    @ti.kernel
+    def add(x: ti.types.ndarray(dtype=qi8)):
+        for i in range(4):
+            x[0] += 1
+
+    with pytest.raises(RuntimeError,
+                       match='Atomic operations on quantized ndarrays'):
+        add(x)
@@ -168,3 +168,32 @@ def test_randn():
         for i in range(4):
             assert (X**(i + 1)).mean() == test_utils.approx(moments[i],
                                                             abs=3e-2)
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_counter_based_random():
+    import numpy as np
+    arch = ti.lang.impl.current_cfg().arch
+    n = 1024
+    result = []
+    for num_threads in [1, 4]:
+        ti.init(arch=arch, counter_based_rand=True,
+                cpu_max_num_threads=num_threads)
+        x = ti.field(ti.f32, shape=(n, n))
+
+        @ti.kernel
+        def fill():
+            for i in range(n):
+                for j in range(n):
+                    x[i, j] = ti.random()
+
+        fill()
+        result.append(x.to_numpy())
+        ti.reset()
+
+    # The streams do not depend on the threads the iterations run on.
+    assert np.array_equal(result[0], result[1])
+    X = result[0]
+    for i in range(1, 4):
+        assert (X**i).mean() == test_utils.approx(1 / (i + 1), rel=1e-2)
+    assert (X[:, 0] * X[:, 1]).mean() == test_utils.approx(1 / 4, rel=5e-2)
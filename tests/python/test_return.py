@@ -181,3 +181,46 @@ def test_return_uint64_vec():
         return ti.Vector([ti.u64(2**64 - 1), ti.u64(2**64 - 1)])
 
     assert (foo()[0] == 2**64 - 1)
+
+
+@test_utils.test()
+def test_return_deferred():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def fill(v: ti.f32):
+        for i in x:
+            x[i] = v
+
+    @ti.kernel
+    def total() -> ti.f32:
+        s = 0.0
+        for i in x:
+            s += x[i]
+        return s
+
+    @ti.kernel
+    def bounds() -> ti.types.vector(2, ti.i32):
+        return ti.Vector([-1, 16])
+
+    fill(1)
+    first = total.deferred()
+    fill(2)
+    second = total.deferred()
+    vec = bounds.deferred()
+    # Each future holds the value of its own launch.
+    assert second.result() == 32
+    assert first.result() == 16
+    assert first.ready()
+    assert vec.result()[0] == -1
+    assert vec.result()[1] == 16
+
+
+@test_utils.test()
+def test_return_deferred_without_return():
+    @ti.kernel
+    def foo():
+        pass
+
+    with pytest.raises(ti.TaichiRuntimeError, match='has no return value'):
+        foo.deferred()
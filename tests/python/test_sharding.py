@@ -0,0 +1,44 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+def test_shard_range():
+    ranges = [ti.experimental.shard_range(10, 3, i) for i in range(3)]
+    assert ranges == [(0, 4), (4, 7), (7, 10)]
+
+
+@pytest.mark.parametrize('num_shards', [1, 3])
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_sharded_ndarray_halo_exchange(num_shards):
+    n, m, halo = 10, 3, 1
+    shards = [
+        ti.experimental.ShardedNdarray(ti.i32, (n, m), num_shards, i, halo)
+        for i in range(num_shards)
+    ]
+    handles = [shard.ipc_handle for shard in shards]
+    for shard in shards:
+        shard.connect(handles)
+
+    @ti.kernel
+    def fill(x: ti.types.ndarray(), halo: ti.i32, rows: ti.i32,
+             begin: ti.i32):
+        for i, j in ti.ndrange(rows, x.shape[1]):
+            x[halo + i, j] = (begin + i) * 10 + j
+
+    for shard in shards:
+        fill(shard.local, halo, shard.num_local_rows, shard.begin)
+    for shard in shards:
+        shard.exchange_halos()
+
+    expected = np.arange(n)[:, None] * 10 + np.arange(m)[None, :]
+    np.testing.assert_array_equal(
+        np.concatenate([shard.to_numpy() for shard in shards]), expected)
+    for shard in shards:
+        local = shard.local.to_numpy()
+        if shard.shard_id > 0:
+            np.testing.assert_array_equal(local[0], expected[shard.begin - 1])
+        if shard.shard_id + 1 < num_shards:
+            np.testing.assert_array_equal(local[-1], expected[shard.end])
@@ -0,0 +1,60 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=ti.cpu, cpu_shared_runtime=True)
+def test_shared_runtime_range_for():
+    x = ti.field(ti.f32, shape=128)
+    total = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = ti.sqrt(i)
+
+    @ti.kernel
+    def reduce():
+        for i in range(128):
+            total[None] += x[i]
+
+    fill()
+    reduce()
+    expected = np.sqrt(np.arange(128, dtype=np.float32))
+    np.testing.assert_allclose(x.to_numpy(), expected, rtol=1e-6)
+    assert total[None] == test_utils.approx(expected.sum(), rel=1e-5)
+
+
+@test_utils.test(arch=ti.cpu, cpu_shared_runtime=True)
+def test_shared_runtime_sparse():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.i, 16)
+    block.dynamic(ti.j, 64, chunk_size=8).place(x)
+    lengths = ti.field(ti.i32, shape=16)
+    count = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def append():
+        for i in range(0, 16, 3):
+            for j in range(i):
+                ti.append(x.parent(), i, j)
+
+    @ti.kernel
+    def count_active():
+        for i in range(16):
+            lengths[i] = ti.length(x.parent(), i)
+        for i, j in x:
+            count[None] += 1
+
+    append()
+    count_active()
+    assert count[None] == sum(range(0, 16, 3))
+    assert lengths.to_numpy().tolist() == [
+        i if i % 3 == 0 else 0 for i in range(16)
+    ]
+
+    block.deactivate_all()
+    count[None] = 0
+    count_active()
+    assert count[None] == 0
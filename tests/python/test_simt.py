@@ -342,6 +342,70 @@ def test_active_mask():
         assert a[i] == 65535
 
 
+def _test_mma_sync(precision, k):
+    A = ti.field(ti.f32, shape=(16, k))
+    B = ti.field(ti.f32, shape=(k, 8))
+    C = ti.field(ti.f32, shape=(16, 8))
+    D = ti.field(ti.f32, shape=(16, 8))
+
+    @ti.kernel
+    def mma():
+        ti.loop_config(block_dim=32)
+        for lane in range(32):
+            g = lane // 4
+            t = lane % 4
+            c = ti.Vector([
+                C[g, 2 * t], C[g, 2 * t + 1], C[g + 8, 2 * t],
+                C[g + 8, 2 * t + 1]
+            ])
+            d = ti.Vector([0.0, 0.0, 0.0, 0.0])
+            if ti.static(k == 8):
+                a = ti.Vector(
+                    [A[g, t], A[g + 8, t], A[g, t + 4], A[g + 8, t + 4]])
+                b = ti.Vector([B[t, g], B[t + 4, g]])
+                d = ti.simt.warp.mma_sync(a, b, c, precision)
+            else:
+                a = ti.Vector([
+                    A[g, 2 * t], A[g, 2 * t + 1], A[g + 8, 2 * t],
+                    A[g + 8, 2 * t + 1], A[g, 2 * t + 8], A[g, 2 * t + 9],
+                    A[g + 8, 2 * t + 8], A[g + 8, 2 * t + 9]
+                ])
+                b = ti.Vector([
+                    B[2 * t, g], B[2 * t + 1, g], B[2 * t + 8, g],
+                    B[2 * t + 9, g]
+                ])
+                d = ti.simt.warp.mma_sync(a, b, c, precision)
+            D[g, 2 * t] = d[0]
+            D[g, 2 * t + 1] = d[1]
+            D[g + 8, 2 * t] = d[2]
+            D[g + 8, 2 * t + 1] = d[3]
+
+    # Small integers are exact in every precision.
+    a = np.random.randint(-4, 5, size=(16, k)).astype(np.float32)
+    b = np.random.randint(-4, 5, size=(k, 8)).astype(np.float32)
+    c = np.random.randint(-4, 5, size=(16, 8)).astype(np.float32)
+    A.from_numpy(a)
+    B.from_numpy(b)
+    C.from_numpy(c)
+    mma()
+    np.testing.assert_array_equal(D.to_numpy(), a @ b + c)
+
+
+@test_utils.test(arch=ti.cuda)
+def test_mma_sync_tf32():
+    _test_mma_sync('tf32', 8)
+
+
+@test_utils.test(arch=ti.cuda)
+def test_mma_sync_f16():
+    _test_mma_sync('f16', 16)
+
+
+@test_utils.test(arch=ti.cuda)
+def test_mma_sync_bf16():
+    _test_mma_sync('bf16', 16)
+
+
 @test_utils.test(arch=ti.cuda)
 def test_warp_sync():
     a = ti.field(dtype=ti.u32, shape=32)
@@ -0,0 +1,85 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+@pytest.mark.parametrize('compress', [False, True])
+@test_utils.test()
+def test_snapshot(tmp_path, compress):
+    path = str(tmp_path / 'state.bin')
+    x = ti.field(ti.f32, shape=(64, 33))
+    y = ti.Vector.field(3, ti.i32, shape=1000)
+    a = ti.ndarray(ti.f32, shape=(5, 7))
+    b = ti.Vector.ndarray(2, ti.i32, shape=300)
+
+    x_np = np.random.rand(64, 33).astype(np.float32)
+    y_np = np.arange(3000, dtype=np.int32).reshape(1000, 3)
+    a_np = np.random.rand(5, 7).astype(np.float32)
+    b_np = np.zeros((300, 2), dtype=np.int32)
+    x.from_numpy(x_np)
+    y.from_numpy(y_np)
+    a.from_numpy(a_np)
+    b.from_numpy(b_np)
+    ti.save_snapshot(path, [a, b], compress=compress)
+
+    x.fill(0)
+    y.fill(-1)
+    a.fill(0)
+    b.fill(5)
+    ti.load_snapshot(path, [a, b])
+    np.testing.assert_equal(x.to_numpy(), x_np)
+    np.testing.assert_equal(y.to_numpy(), y_np)
+    np.testing.assert_equal(a.to_numpy(), a_np)
+    np.testing.assert_equal(b.to_numpy(), b_np)
+
+
+@test_utils.test(require=ti.extension.sparse)
+def test_snapshot_bitmasked(tmp_path):
+    path = str(tmp_path / 'state.bin')
+    x = ti.field(ti.i32)
+    ti.root.bitmasked(ti.i, 128).place(x)
+
+    @ti.kernel
+    def activate():
+        for i in range(128):
+            if i % 3 == 0:
+                x[i] = i
+
+    @ti.kernel
+    def count() -> ti.i32:
+        n = 0
+        for i in x:
+            n += 1
+        return n
+
+    activate()
+    ti.save_snapshot(path)
+    ti.deactivate_all_snodes()
+    assert count() == 0
+    ti.load_snapshot(path)
+    assert count() == 43
+    assert x[9] == 9
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_snapshot_pointer_unsupported(tmp_path):
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.i, 4).dense(ti.i, 4).place(x)
+    x[0] = 1
+    with pytest.raises(RuntimeError, match='pointer'):
+        ti.save_snapshot(str(tmp_path / 'state.bin'))
+
+
+@test_utils.test()
+def test_snapshot_mismatch(tmp_path):
+    path = str(tmp_path / 'state.bin')
+    ti.field(ti.f32, shape=16)
+    a = ti.ndarray(ti.f32, shape=8)
+    ti.save_snapshot(path, [a])
+    b = ti.ndarray(ti.f32, shape=9)
+    with pytest.raises(RuntimeError, match='ndarray 0'):
+        ti.load_snapshot(path, [b])
+    with pytest.raises(RuntimeError, match='holds 2 buffers'):
+        ti.load_snapshot(path)
@@ -1,3 +1,5 @@
+import numpy as np
+
 import taichi as ti
 from tests import test_utils
 
@@ -55,3 +57,31 @@ def test_non_dfs_snode_order():
 
     foo()  # Just make sure it doesn't crash
     ti.sync()
+
+
+@test_utils.test(require=ti.extension.sparse)
+def test_activate_cells():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.ij, 8)
+    cell = block.bitmasked(ti.ij, 4)
+    cell.place(x)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        c = 0
+        for i, j in x:
+            c += 1
+        return c
+
+    # Duplicates are ignored.
+    cell.activate_cells([[0, 0], [3, 5], [3, 5], [31, 31]])
+    assert count() == 3
+    assert block._num_dynamically_allocated == 3
+
+    mask = np.zeros(cell.shape, dtype=bool)
+    mask[4:8, 4:8] = True
+    cell.activate_cells(mask)
+    assert count() == 3 + 16
+
+    cell.deactivate_cells([[0, 0], [4, 4]])
+    assert count() == 3 + 16 - 2
@@ -1,3 +1,5 @@
+from taichi.lang.misc import get_host_arch_list
+
 import taichi as ti
 from tests import test_utils
 
@@ -216,3 +218,78 @@ def test_dynamic():
     fetch_length()
     for i in range(n):
         assert s[i] == i * i * 4
+
+
+@test_utils.test(arch=[ti.vulkan])
+def test_pointer_gfx_reuse_cells():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+
+    n = 64
+    ptr = ti.root.pointer(ti.i, n)
+    ptr.dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def activate(k: ti.i32):
+        for i in range(n * 4):
+            if i // 4 % 2 == k:
+                x[i] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in ptr:
+            ti.deactivate(ptr, i)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    # Every round reuses the cells freed by the previous one.
+    for k in range(8):
+        activate(k % 2)
+        s[None] = 0
+        count()
+        assert s[None] == n * 2
+        assert x[4 * (k % 2) + 1] == 1
+        assert x[4 * (1 - k % 2)] == 0
+        deactivate()
+
+
+@test_utils.test(arch=get_host_arch_list())
+def test_pointer_large_nodes_zeroed():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+
+    # Nodes of 256 KB, whose pages are given back to the OS on gc.
+    block = 1 << 16
+    ptr = ti.root.pointer(ti.i, 8)
+    ptr.dense(ti.i, block).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(8 * block):
+            x[i] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in ptr:
+            ti.deactivate(ptr, i)
+
+    @ti.kernel
+    def activate():
+        for i in range(8):
+            ti.activate(ptr, [i])
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    for _ in range(2):
+        fill()
+        deactivate()
+        activate()
+        s[None] = 0
+        count()
+        assert s[None] == 0
@@ -165,3 +165,140 @@ def test_gpu_sparse_solver2(dtype, solver_type):
     res = np.linalg.solve(A_psd, b.to_numpy())
     for i in range(n):
         assert x[i] == test_utils.approx(res[i], rel=1.0)
+
+
+@pytest.mark.parametrize("solver_type", ["LLT", "LU"])
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_sparse_solver_same_pattern(solver_type):
+    n = 10
+    b = ti.ndarray(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(),
+             InputArray: ti.types.ndarray(), b: ti.types.ndarray()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+        for i in range(n):
+            b[i] = i + 1
+
+    solver = ti.linalg.SparseSolver(solver_type=solver_type)
+    # The second matrix has the pattern of the first one, so its symbolic
+    # analysis is reused.
+    for _ in range(2):
+        A = np.random.rand(n, n)
+        A_psd = np.dot(A, A.transpose()) + n * np.eye(n)
+        Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=300)
+        fill(Abuilder, A_psd, b)
+        solver.compute(Abuilder.build())
+        x = solver.solve(b)
+
+        res = np.linalg.solve(A_psd, b.to_numpy())
+        for i in range(n):
+            assert x[i] == test_utils.approx(res[i], rel=1e-3)
+
+
+@pytest.mark.parametrize("solver_type, preconditioner",
+                         [("CG", None), ("CG", "jacobi"), ("CG", "ic0"),
+                          ("MINRES", None), ("MINRES", "jacobi"),
+                          ("BiCGSTAB", None), ("BiCGSTAB", "jacobi"),
+                          ("BiCGSTAB", "ilu0")])
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_sparse_iterative_solver(solver_type, preconditioner):
+    n = 64
+    # A diagonally dominant tridiagonal matrix, nonsymmetric for BiCGSTAB.
+    lower = -1.0 if solver_type != "BiCGSTAB" else -1.5
+    A_np = np.diag(np.full(n, 4.0)) + np.diag(np.full(n - 1, lower), -1) + \
+        np.diag(np.full(n - 1, -1.0), 1)
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=3 * n)
+    b = ti.ndarray(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(),
+             InputArray: ti.types.ndarray(), b: ti.types.ndarray()):
+        for i, j in ti.ndrange(n, n):
+            if InputArray[i, j] != 0:
+                Abuilder[i, j] += InputArray[i, j]
+        for i in range(n):
+            b[i] = i % 5 + 1
+
+    fill(Abuilder, A_np, b)
+    A = Abuilder.build()
+    solver = ti.linalg.IterativeSolver(solver_type=solver_type,
+                                       preconditioner=preconditioner,
+                                       tol=1e-6,
+                                       check_every=4)
+    solver.compute(A)
+    x = solver.solve(b)
+    assert solver.info()
+    num_iterations = solver.num_iterations
+    assert 0 < num_iterations <= n
+    res = np.linalg.solve(A_np, b.to_numpy())
+    assert np.allclose(x.to_numpy(), res, atol=1e-4)
+
+    # Starting from the solution, the solve converges right away.
+    solver.solve(b, x)
+    assert solver.info()
+    assert solver.num_iterations < num_iterations
+
+
+@pytest.mark.parametrize("solver_type", ["MixedLLT", "MixedLDLT", "MixedLU"])
+@test_utils.test(arch=ti.cpu)
+def test_sparse_mixed_precision_solver(solver_type):
+    n = 10
+    A = np.random.rand(n, n)
+    A_psd = np.dot(A, A.transpose()) + n * np.eye(n)
+    Abuilder = ti.linalg.SparseMatrixBuilder(n,
+                                             n,
+                                             max_num_triplets=300,
+                                             dtype=ti.f64)
+    b = ti.ndarray(ti.f64, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(),
+             InputArray: ti.types.ndarray(), b: ti.types.ndarray()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+        for i in range(n):
+            b[i] = i + 1
+
+    fill(Abuilder, A_psd, b)
+    A = Abuilder.build(dtype=ti.f64)
+    solver = ti.linalg.SparseSolver(dtype=ti.f64, solver_type=solver_type)
+    solver.compute(A)
+    x = solver.solve(b)
+    assert solver.info()
+
+    res = np.linalg.solve(A_psd, b.to_numpy())
+    for i in range(n):
+        assert x[i] == test_utils.approx(res[i], rel=1e-8)
+
+
+@pytest.mark.parametrize("solver_type", ["MixedLLT", "MixedLU"])
+@test_utils.test(arch=ti.cuda)
+def test_gpu_sparse_mixed_precision_solver(solver_type):
+    n = 10
+    A = np.random.rand(n, n)
+    A_psd = np.dot(A, A.transpose()) + n * np.eye(n)
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=300)
+    b = ti.ndarray(ti.f64, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(),
+             InputArray: ti.types.ndarray(), b: ti.types.ndarray()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+        for i in range(n):
+            b[i] = i + 1
+
+    fill(Abuilder, A_psd, b)
+    A = Abuilder.build()
+    solver = ti.linalg.SparseSolver(dtype=ti.f64, solver_type=solver_type)
+    solver.compute(A)
+    x = solver.solve(b)
+    assert solver.info()
+
+    # The matrix is stored in f32 on CUDA.
+    A_f32 = A_psd.astype(np.float32).astype(np.float64)
+    res = np.linalg.solve(A_f32, b.to_numpy())
+    for i in range(n):
+        assert x[i] == test_utils.approx(res[i], rel=1e-8)
@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 import taichi as ti
@@ -54,6 +55,46 @@ def test_sparse_matrix_builder(dtype, storage_format):
             assert A[i, j] == i + j
 
 
+@pytest.mark.parametrize('dtype, storage_format', [(ti.f32, 'col_major'),
+                                                   (ti.f32, 'row_major'),
+                                                   (ti.f64, 'col_major'),
+                                                   (ti.f64, 'row_major')])
+@test_utils.test(arch=ti.cpu)
+def test_sparse_matrix_builder_reuse_pattern(dtype, storage_format):
+    n = 8
+    Abuilder = ti.linalg.SparseMatrixBuilder(n,
+                                             n,
+                                             max_num_triplets=100,
+                                             dtype=dtype,
+                                             storage_format=storage_format,
+                                             reuse_pattern=True)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(), scale: ti.f32,
+             extra: ti.i32):
+        for i in range(n):
+            Abuilder[i, i] += scale * (i + 1)
+            Abuilder[i, (i + 1) % n] += scale
+            Abuilder[i, (i + 1) % n] += scale
+            if extra:
+                Abuilder[i, (i + 3) % n] += 1.0
+
+    for it in range(3):
+        scale = it + 1.0
+        fill(Abuilder, scale, it == 2)
+        A = Abuilder.build()
+        for i in range(n):
+            for j in range(n):
+                expected = 0.0
+                if j == i:
+                    expected = scale * (i + 1)
+                elif j == (i + 1) % n:
+                    expected = 2 * scale
+                elif j == (i + 3) % n and it == 2:
+                    expected = 1.0
+                assert A[i, j] == test_utils.approx(expected)
+
+
 @pytest.mark.parametrize('dtype, storage_format', [(ti.f32, 'col_major'),
                                                    (ti.f32, 'row_major'),
                                                    (ti.f64, 'col_major'),
@@ -404,6 +445,102 @@ def test_sparse_matrix_ndarray_vector_multiplication(dtype, storage_format):
     assert res_n[1] == 3.0
 
 
+@pytest.mark.parametrize('dtype, storage_format', [(ti.f32, 'col_major'),
+                                                   (ti.f32, 'row_major'),
+                                                   (ti.f64, 'col_major'),
+                                                   (ti.f64, 'row_major')])
+@test_utils.test(arch=ti.cpu)
+def test_sparse_matrix_parallel(dtype, storage_format):
+    n, k = 37, 23
+    A_np = np.random.rand(n, k) * (np.random.rand(n, k) < 0.2)
+    B_np = np.random.rand(n, k) * (np.random.rand(n, k) < 0.2)
+    C_np = np.random.rand(k, n) * (np.random.rand(k, n) < 0.2)
+
+    @ti.kernel
+    def fill(builder: ti.types.sparse_matrix_builder(),
+             InputArray: ti.types.ndarray()):
+        for i, j in ti.ndrange(InputArray.shape[0], InputArray.shape[1]):
+            if InputArray[i, j] != 0:
+                builder[i, j] += InputArray[i, j]
+
+    def build(M_np):
+        builder = ti.linalg.SparseMatrixBuilder(*M_np.shape,
+                                                max_num_triplets=M_np.size,
+                                                dtype=dtype,
+                                                storage_format=storage_format,
+                                                parallel=True)
+        fill(builder, M_np)
+        return builder.build()
+
+    def check(M, GT):
+        for i in range(GT.shape[0]):
+            for j in range(GT.shape[1]):
+                assert M[i, j] == test_utils.approx(GT[i, j], rel=1e-4)
+
+    A, B, C = build(A_np), build(B_np), build(C_np)
+    check(A + B, A_np + B_np)
+    check(A - B, A_np - B_np)
+    check(A @ C, A_np @ C_np)
+    check((A @ C) @ A, A_np @ C_np @ A_np)
+
+    x = ti.ndarray(dtype, k)
+    x_np = np.random.rand(k)
+    x.from_numpy(x_np)
+    res = (A @ x).to_numpy()
+    res_np = A_np @ x_np
+    for i in range(n):
+        assert res[i] == test_utils.approx(res_np[i], rel=1e-4)
+
+
+@pytest.mark.parametrize('block_size', [2, 3, 5])
+@test_utils.test(arch=[ti.cpu, ti.cuda])
+def test_sparse_matrix_bsr(block_size):
+    nb = 4
+    n = nb * block_size
+    # A block tridiagonal matrix with a dominant diagonal.
+    A_np = np.zeros((n, n))
+    for i in range(nb):
+        for j in range(max(i - 1, 0), min(i + 2, nb)):
+            A_np[i * block_size:(i + 1) * block_size,
+                 j * block_size:(j + 1) * block_size] = np.random.rand(
+                     block_size, block_size)
+    A_np += n * np.eye(n)
+    builder = ti.linalg.SparseMatrixBuilder(n,
+                                            n,
+                                            max_num_triplets=2 * n * n,
+                                            block_size=block_size)
+
+    @ti.kernel
+    def fill(builder: ti.types.sparse_matrix_builder(),
+             InputArray: ti.types.ndarray()):
+        for i, j in ti.ndrange(n, n):
+            if InputArray[i, j] != 0:
+                # Duplicates are summed up.
+                builder[i, j] += 0.5 * InputArray[i, j]
+                builder[i, j] += 0.5 * InputArray[i, j]
+
+    fill(builder, A_np)
+    A = builder.build()
+    A_f32 = A_np.astype(np.float32)
+    for i in range(n):
+        for j in range(n):
+            assert A[i, j] == test_utils.approx(A_f32[i, j], rel=1e-5)
+
+    x = ti.ndarray(ti.f32, n)
+    x.from_numpy(np.random.rand(n).astype(np.float32))
+    res = (A @ x).to_numpy()
+    gt = A_f32 @ x.to_numpy()
+    for i in range(n):
+        assert res[i] == test_utils.approx(gt[i], rel=1e-4)
+
+    for lower in [True, False]:
+        y = A.solve_triangular(x, lower=lower).to_numpy()
+        T = np.tril(A_f32) if lower else np.triu(A_f32)
+        gt = np.linalg.solve(T, x.to_numpy())
+        for i in range(n):
+            assert y[i] == test_utils.approx(gt[i], rel=1e-4)
+
+
 @test_utils.test(arch=ti.cuda)
 def test_gpu_sparse_matrix():
     import numpy as np
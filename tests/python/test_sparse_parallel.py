@@ -78,3 +78,25 @@ def test_nested_struct_fill_and_clear():
     for i in range(10):
         task()
         ti.sync()
+
+
+@test_utils.test(require=ti.extension.sparse)
+def test_pointer_activate_contended():
+    x = ti.field(ti.i32)
+    n = 64
+    m = 1024 * 64
+
+    block = ti.root.pointer(ti.i, n)
+    block.dense(ti.i, 16).place(x)
+
+    @ti.kernel
+    def scatter():
+        # Many threads activate each block at the same time.
+        for i in range(m):
+            ti.atomic_add(x[i % (n * 16)], 1)
+
+    scatter()
+    for i in range(n * 16):
+        assert x[i] == m // (n * 16)
+    # Exactly one node is allocated for each block.
+    assert block._num_dynamically_allocated == n
@@ -0,0 +1,33 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda],
+                 llvm_split_kernel_module=True,
+                 num_compile_threads=3)
+def test_split_kernel_module():
+    n = 64
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32)
+    ti.root.pointer(ti.i, n // 8).dense(ti.i, 8).place(y)
+    total = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def many_tasks():
+        for i in x:
+            x[i] = i
+        for i in range(n // 2):
+            y[i * 2] = x[i * 2] * 2
+        for i in y:
+            total[None] += y[i]
+        for i in x:
+            x[i] += 1
+        total[None] += 1000
+
+    many_tasks()
+    expected_x = np.arange(n, dtype=np.float32) + 1
+    np.testing.assert_allclose(x.to_numpy(), expected_x)
+    assert total[None] == test_utils.approx(
+        sum(i * 4 for i in range(n // 2)) + 1000)
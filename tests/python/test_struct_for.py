@@ -315,3 +315,71 @@ def test_struct_for_continue():
     init()
     assert struct_for_continue() == n * (n - 1)
     assert range_for_continue() == n * (n - 1)
+
+
+@test_utils.test()
+def test_struct_for_tiled():
+    x = ti.field(ti.i32, shape=(24, 40))
+    y = ti.field(ti.i32, shape=(24, 40))
+
+    @ti.kernel
+    def fill():
+        ti.loop_config(tile_size=(8, 16))
+        for i, j in x:
+            x[i, j] = i * 100 + j
+
+    @ti.kernel
+    def stencil():
+        ti.loop_config(tile_size=4)
+        for i, j in y:
+            y[i, j] = x[i, j] + x[min(i + 1, 23), j]
+
+    fill()
+    stencil()
+    for i in range(24):
+        for j in range(40):
+            assert x[i, j] == i * 100 + j
+            assert y[i, j] == x[i, j] + x[min(i + 1, 23), j]
+
+
+@test_utils.test()
+def test_struct_for_morton():
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i32, shape=(4, 8, 2))
+    ti.root.dense(ti.ijk, (4, 8, 2), morton=True).place(x)
+
+    @ti.kernel
+    def fill():
+        for i, j, k in x:
+            x[i, j, k] = i * 100 + j * 10 + k
+        for i, j, k in y:
+            y[i, j, k] = x[i, j, k] + x[3 - i, 7 - j, k]
+
+    fill()
+    for i in range(4):
+        for j in range(8):
+            for k in range(2):
+                assert x[i, j, k] == i * 100 + j * 10 + k
+                assert y[i, j, k] == 377 + 2 * k
+
+
+@test_utils.test(require=ti.extension.sparse)
+def test_struct_for_morton_sparse():
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.ij, 2).dense(ti.ij, (4, 2), morton=True).place(x)
+
+    @ti.kernel
+    def fill():
+        for i, j in ti.ndrange(8, 4):
+            if i >= 4:
+                x[i, j] = 1
+
+    @ti.kernel
+    def count() -> ti.i32:
+        total = 0
+        for i, j in x:
+            total += x[i, j] * (i * 10 + j)
+        return total
+
+    fill()
+    assert count() == sum(i * 10 + j for i in range(4, 8) for j in range(4))
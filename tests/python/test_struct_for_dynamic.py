@@ -42,3 +42,30 @@ def test_dense_dynamic():
     for i in range(n):
         for j in range(i):
             assert x[i, j] == j * 2
+
+
+@test_utils.test(exclude=[ti.opengl, ti.gles, ti.cc, ti.vulkan, ti.metal])
+def test_dense_dynamic_balanced():
+    n = 64
+    x = ti.field(ti.i32)
+    ti.root.dense(ti.i, n).dynamic(ti.j, 4096, 32).place(x)
+
+    @ti.kernel
+    def append():
+        for i in range(n):
+            # One crowded cell, and mostly short or empty ones.
+            length = 3000 if i == 5 else i % 3
+            for j in range(length):
+                ti.append(x.parent(), i, i + j)
+
+    @ti.kernel
+    def total() -> ti.i64:
+        s = ti.i64(0)
+        ti.loop_config(balance_elements=True)
+        for i, j in x:
+            s += x[i, j] - i - j + 1
+        return s
+
+    append()
+    expected = sum(3000 if i == 5 else i % 3 for i in range(n))
+    assert total() == expected
@@ -9,8 +9,8 @@ from taichi.lang import impl
 import taichi as ti
 from tests import test_utils
 
-supported_archs_texture = [ti.vulkan]
-supported_archs_texture_excluding_load_store = [ti.vulkan, ti.opengl]
+supported_archs_texture = [ti.vulkan, ti.cuda]
+supported_archs_texture_excluding_load_store = [ti.vulkan, ti.opengl, ti.cuda]
 
 
 @ti.func
@@ -198,3 +198,44 @@ def test_rw_texture_2d_struct_for_dim_check():
             "Number of struct-for indices does not match loop variable dimensionality \(2 != 3\)."
     ) as e:
         write(tex)
+
+
+@test_utils.test(arch=ti.vulkan)
+def test_texture_mipmaps():
+    res = (4, 4)
+    tex = ti.Texture(ti.Format.rgba8, res, mip_levels=3)
+    arr = ti.ndarray(ti.f32, 4)
+
+    @ti.kernel
+    def write_checkerboard(tex: ti.types.rw_texture(
+        num_dimensions=2, fmt=ti.Format.rgba8, lod=0)):
+        for i, j in ti.ndrange(4, 4):
+            val = ti.cast((i + j) % 2, ti.f32)
+            tex.store(ti.Vector([i, j]), ti.Vector([val, 0.0, 0.0, 0.0]))
+
+    @ti.kernel
+    def write_last_level(tex: ti.types.rw_texture(
+        num_dimensions=2, fmt=ti.Format.rgba8, lod=2)):
+        for _ in range(1):
+            tex.store(ti.Vector([0, 0]), ti.Vector([0.25, 0.0, 0.0, 0.0]))
+
+    @ti.kernel
+    def read(tex: ti.types.texture(num_dimensions=2),
+             arr: ti.types.ndarray()):
+        for _ in range(1):
+            arr[0] = tex.fetch(ti.Vector([1, 0]), 0).x
+            arr[1] = tex.fetch(ti.Vector([0, 0]), 1).x
+            arr[2] = tex.fetch(ti.Vector([0, 0]), 2).x
+            # The footprint spans all the texels of the first level.
+            arr[3] = tex.sample_grad(ti.Vector([0.5, 0.5]),
+                                     ti.Vector([1.0, 0.0]),
+                                     ti.Vector([0.0, 1.0])).x
+
+    write_checkerboard(tex)
+    tex.generate_mipmaps()
+    read(tex, arr)
+    assert arr.to_numpy() == pytest.approx([1.0, 0.5, 0.5, 0.5], abs=1e-2)
+
+    write_last_level(tex)
+    read(tex, arr)
+    assert arr.to_numpy()[2] == pytest.approx(0.25, abs=1e-2)
@@ -0,0 +1,29 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=[ti.cpu, ti.cuda],
+                 tiered_compilation=True,
+                 tiered_compilation_threshold=3)
+def test_tiered_compilation():
+    n = 256
+    x = ti.field(ti.f32, shape=n)
+    total = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def step(k: ti.f32):
+        for i in x:
+            x[i] += ti.sin(i * 0.1) * k
+        for i in x:
+            total[None] += x[i]
+
+    expected = np.zeros(n, dtype=np.float32)
+    for k in range(20):
+        total[None] = 0
+        step(k)
+        expected += np.sin(np.arange(n) * 0.1).astype(np.float32) * k
+        np.testing.assert_allclose(x.to_numpy(), expected, rtol=1e-4,
+                                   atol=1e-3)
+        assert total[None] == test_utils.approx(expected.sum(), abs=1e-1)
@@ -286,3 +286,23 @@ def test_torch_view():
     with pytest.raises(ValueError,
                        match=r'Non contiguous tensors are not supported'):
         copy(x, y)
+
+
+@pytest.mark.skipif(not has_pytorch(), reason='Pytorch not installed.')
+@test_utils.test(arch=ti.cuda)
+def test_torch_cuda_stream():
+    n = 1 << 20
+
+    @ti.kernel
+    def double(x: ti.types.ndarray()):
+        for i in x:
+            x[i] *= 2
+
+    s = torch.cuda.Stream()
+    with torch.cuda.stream(s), ti.cuda_stream(s):
+        x = torch.ones(n, device='cuda:0')
+        double(x)
+        total = x.sum()
+    assert impl.get_runtime().prog.get_launch_stream() == 0
+    s.synchronize()
+    assert total.item() == 2 * n
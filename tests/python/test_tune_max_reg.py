@@ -0,0 +1,32 @@
+import numpy as np
+
+import taichi as ti
+from taichi.lang import impl
+from tests import test_utils
+
+
+@test_utils.test(arch=ti.cuda, gpu_tune_max_reg=True, kernel_profiler=True)
+def test_tune_max_reg():
+    n = 4096
+    a = ti.Matrix.field(3, 3, dtype=ti.f32, shape=n)
+    err = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def svd_error():
+        for i in a:
+            U, S, V = ti.svd(a[i])
+            err[i] = (U @ S @ V.transpose() - a[i]).norm()
+
+    a.from_numpy(np.random.rand(n, 3, 3).astype(np.float32))
+    svd_error()
+    assert err.to_numpy().max() < 1e-3
+
+    prog = impl.get_runtime().prog
+    prog.sync_kernel_profiler()
+    prog.update_kernel_profiler()
+    records = prog.get_kernel_profiler_records()
+    assert len(records) > 0
+    for record in records:
+        assert record.register_per_thread > 0
+        assert record.local_mem_per_thread >= 0
+        assert 0 < record.occupancy <= 1
@@ -0,0 +1,55 @@
+import numpy as np
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=ti.cuda, gpu_warp_aggregated_atomics=True)
+def test_warp_aggregated_histogram():
+    n = 100000
+    num_bins = 7
+    data = ti.field(ti.i32, shape=n)
+    hist = ti.field(ti.i32, shape=num_bins)
+    lo = ti.field(ti.f32, shape=num_bins)
+
+    @ti.kernel
+    def histogram():
+        for i in data:
+            b = data[i]
+            hist[b] += 1
+            ti.atomic_min(lo[b], ti.cast(i, ti.f32))
+
+    values = np.random.randint(0, num_bins, size=n).astype(np.int32)
+    data.from_numpy(values)
+    lo.fill(n)
+    histogram()
+    np.testing.assert_array_equal(hist.to_numpy(),
+                                  np.bincount(values, minlength=num_bins))
+    for b in range(num_bins):
+        assert lo[b] == np.argmax(values == b)
+
+
+@test_utils.test(arch=ti.cuda, gpu_warp_aggregated_atomics=True)
+def test_warp_aggregated_scatter():
+    n = 4096
+    grid = ti.field(ti.f32, shape=64)
+    pos = ti.field(ti.i32, shape=n)
+    counter = ti.field(ti.i32, shape=())
+    slot = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def scatter():
+        for p in pos:
+            base = pos[p]
+            for j in range(2):
+                grid[base + j] += 0.5
+            # The old value is used, so this atomic is kept as is.
+            slot[p] = ti.atomic_add(counter[None], 1)
+
+    pos.from_numpy(np.random.randint(0, 62, size=n).astype(np.int32))
+    scatter()
+    expected = np.zeros(64, dtype=np.float32)
+    for p in pos.to_numpy():
+        expected[p:p + 2] += 0.5
+    np.testing.assert_allclose(grid.to_numpy(), expected)
+    assert sorted(slot.to_numpy().tolist()) == list(range(n))